@@ -0,0 +1,150 @@
+/**
+ * @file concurrency.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Measures how the throughput of the binary layer scales with the number of concurrent clients.
+ *
+ * All threads share the main collection, writing, reading or scanning random keys in it.
+ * The UCSet engine, built with `USTORE_UCSET_PARTITIONED`, spreads the pairs across independently
+ * locked partitions, so the writes of different threads rarely wait for each other.
+ * Comparing it to the default build shows where the single lock of the engine saturates.
+ */
+#include <array>   // `std::array`
+#include <numeric> // `std::iota`
+#include <random>  // `std::mt19937_64`
+
+#include <benchmark/benchmark.h>
+
+#include <ustore/ustore.hpp>
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+
+constexpr std::size_t keys_count_k = 1'000'000;
+constexpr std::size_t batch_size_k = 16;
+constexpr std::size_t value_size_k = 64;
+constexpr ustore_length_t scan_length_k = 100;
+constexpr int max_threads_k = 64;
+
+static database_t db;
+
+/**
+ * @brief Batch of random keys, all mapped to the same value.
+ */
+struct batch_t {
+    std::array<ustore_key_t, batch_size_k> keys {};
+    std::array<char, value_size_k> value {};
+    ustore_bytes_ptr_t value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+    ustore_length_t value_length = static_cast<ustore_length_t>(value_size_k);
+
+    template <typename generator_at>
+    void shuffle(generator_at& generator) noexcept {
+        for (auto& key : keys)
+            key = static_cast<ustore_key_t>(generator() % keys_count_k);
+    }
+
+    contents_arg_t contents() const noexcept {
+        contents_arg_t arg {};
+        arg.lengths_begin = {&value_length, 0};
+        arg.contents_begin = {&value_ptr, 0};
+        arg.count = batch_size_k;
+        return arg;
+    }
+};
+
+static void fill(bm::State& state) {
+    batch_t batch;
+    blobs_collection_t collection = db.main();
+    for (auto _ : state)
+        for (ustore_key_t key = 0; key < static_cast<ustore_key_t>(keys_count_k); key += batch_size_k) {
+            std::iota(batch.keys.begin(), batch.keys.end(), key);
+            collection[batch.keys].assign(batch.contents()).throw_unhandled();
+        }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * keys_count_k, bm::Counter::kIsRate);
+}
+
+static void upsert(bm::State& state) {
+    std::mt19937_64 generator(state.thread_index() + 1);
+    batch_t batch;
+    blobs_collection_t collection = db.main();
+    for (auto _ : state) {
+        batch.shuffle(generator);
+        collection[batch.keys].assign(batch.contents()).throw_unhandled();
+    }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * batch_size_k, bm::Counter::kIsRate);
+}
+
+static void read(bm::State& state) {
+    std::mt19937_64 generator(state.thread_index() + 1);
+    batch_t batch;
+    blobs_collection_t collection = db.main();
+    for (auto _ : state) {
+        batch.shuffle(generator);
+        auto values = collection[batch.keys].value();
+        bm::DoNotOptimize(values);
+    }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * batch_size_k, bm::Counter::kIsRate);
+}
+
+static void scan(bm::State& state) {
+    std::mt19937_64 generator(state.thread_index() + 1);
+    arena_t arena(db);
+    ustore_collection_t collection = ustore_collection_main_k;
+    std::size_t scanned = 0;
+    for (auto _ : state) {
+        ustore_key_t start_key = static_cast<ustore_key_t>(generator() % keys_count_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+
+        status_t status;
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = status.member_ptr();
+        scan.arena = arena.member_ptr();
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &scan_length_k;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        status.throw_unhandled();
+        scanned += *found_counts;
+    }
+    state.counters["pairs/s"] = bm::Counter(scanned, bm::Counter::kIsRate);
+}
+
+static void mixed(bm::State& state) {
+    std::mt19937_64 generator(state.thread_index() + 1);
+    batch_t batch;
+    blobs_collection_t collection = db.main();
+    std::size_t operation_idx = 0;
+    for (auto _ : state) {
+        batch.shuffle(generator);
+        // Every fifth batch is a write
+        if (++operation_idx % 5 == 0)
+            collection[batch.keys].assign(batch.contents()).throw_unhandled();
+        else
+            bm::DoNotOptimize(collection[batch.keys].value());
+    }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * batch_size_k, bm::Counter::kIsRate);
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    db.open().throw_unhandled();
+
+    bm::RegisterBenchmark("fill", fill)->Iterations(1)->Unit(bm::kMillisecond);
+    for (auto benchmark : {
+             bm::RegisterBenchmark("upsert", upsert),
+             bm::RegisterBenchmark("read", read),
+             bm::RegisterBenchmark("scan", scan),
+             bm::RegisterBenchmark("mixed", mixed),
+         })
+        benchmark->ThreadRange(1, max_threads_k)->UseRealTime();
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+    db.close();
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file distances.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Compares SIMD distance kernels against the serial baseline.
+ *
+ * Every kernel is evaluated on pairs of vectors from a small pool,
+ * that fits into L1 cache, so that reported numbers reflect the
+ * compute throughput rather than the memory bandwidth.
+ */
+#include <random> // `std::mt19937`
+#include <vector> // `std::vector`
+
+#include <fmt/format.h> // `fmt::format`
+#include <benchmark/benchmark.h>
+
+#include "../src/helpers/distances.hpp"
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+
+constexpr std::size_t vectors_in_pool_k = 16;
+constexpr std::size_t dimensions_k[] = {96, 256, 768, 1536};
+
+template <typename scalar_at>
+std::vector<scalar_at> random_pool(std::size_t dims) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<scalar_at> pool(vectors_in_pool_k * dims);
+    for (auto& scalar : pool) {
+        float value = distribution(generator);
+        if constexpr (std::is_same_v<scalar_at, std::int8_t>)
+            scalar = static_cast<std::int8_t>(value * 100);
+        else if constexpr (std::is_same_v<scalar_at, f16_bits_t>)
+            scalar = f32_to_f16(value);
+        else if constexpr (std::is_same_v<scalar_at, std::uint8_t>)
+            scalar = static_cast<std::uint8_t>(generator());
+        else
+            scalar = value;
+    }
+    return pool;
+}
+
+template <typename scalar_at, typename kernel_at>
+void measure(bm::State& state, kernel_at kernel, std::size_t dims) {
+    std::vector<scalar_at> pool = random_pool<scalar_at>(dims);
+    std::size_t pair_idx = 0;
+    for (auto _ : state) {
+        scalar_at const* a = pool.data() + dims * (pair_idx % vectors_in_pool_k);
+        scalar_at const* b = pool.data() + dims * ((pair_idx + 1) % vectors_in_pool_k);
+        bm::DoNotOptimize(kernel(a, b, dims));
+        ++pair_idx;
+    }
+    state.counters["pairs/s"] = bm::Counter(state.iterations(), bm::Counter::kIsRate);
+    state.counters["bytes/s"] = bm::Counter(state.iterations() * 2.0 * dims * sizeof(scalar_at), bm::Counter::kIsRate);
+}
+
+template <typename scalar_at, typename kernel_at>
+void register_kernel(distance_kernels_t const& kernels, char const* kernel_name, kernel_at kernel) {
+    for (std::size_t dims : dimensions_k) {
+        auto name = fmt::format("{}/{}/{}", kernel_name, kernels.name, dims);
+        bm::RegisterBenchmark(name.c_str(), [=](bm::State& state) { measure<scalar_at>(state, kernel, dims); });
+    }
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+
+    simd_isa_t isas[] = {
+        simd_isa_t::serial_k,
+        simd_isa_t::avx2_k,
+        simd_isa_t::avx512_k,
+        simd_isa_t::neon_k,
+        simd_isa_t::sve_k,
+    };
+    std::printf("Default kernels: %s\n", distance_kernels().name);
+
+    for (simd_isa_t isa : isas) {
+        if (!simd_isa_supported(isa))
+            continue;
+
+        distance_kernels_t kernels = distance_kernels_for(isa);
+        register_kernel<std::int8_t>(kernels, "i8_dot", kernels.i8_dot);
+        register_kernel<std::int8_t>(kernels, "i8_cos", kernels.i8_dot_and_norms);
+        register_kernel<std::int8_t>(kernels, "i8_l2", kernels.i8_l2_squared);
+        register_kernel<float>(kernels, "f32_dot", kernels.f32_dot);
+        register_kernel<float>(kernels, "f32_cos", kernels.f32_dot_and_norms);
+        register_kernel<float>(kernels, "f32_l2", kernels.f32_l2_squared);
+        register_kernel<f16_bits_t>(kernels, "f16_dot", kernels.f16_dot);
+        register_kernel<f16_bits_t>(kernels, "f16_cos", kernels.f16_dot_and_norms);
+        register_kernel<f16_bits_t>(kernels, "f16_l2", kernels.f16_l2_squared);
+        register_kernel<std::uint8_t>(kernels, "b1_hamming", kernels.b1_hamming);
+    }
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+    return 0;
+}
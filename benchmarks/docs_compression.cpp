@@ -0,0 +1,141 @@
+/**
+ * @file docs_compression.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Compares reading plain JSON documents against the ones compressed with a shared dictionary.
+ *
+ * Documents are small records of the same schema, like the ones stored in a collection,
+ * so that the dictionary, trained on a sample of them, captures the repeated keys and values.
+ * Every collection goes through `ustore_docs_read`, including the lookup of the dictionary,
+ * decompression and serialization. Reported numbers include the compression ratio, computed
+ * from the lengths of stored binary values, to weigh the decoding cost against the space savings.
+ */
+#include <numeric> // `std::iota`
+#include <random>  // `std::mt19937`
+#include <string>  // `std::string`
+#include <vector>  // `std::vector`
+
+#include <fmt/format.h> // `fmt::format`
+#include <benchmark/benchmark.h>
+
+#include <ustore/ustore.hpp>
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+
+constexpr std::size_t docs_count_k = 10'000;
+constexpr std::size_t batch_size_k = 64;
+constexpr ustore_size_t samples_count_k = 1'000;
+constexpr ustore_size_t dictionary_sizes_k[] = {4 * 1024, 32 * 1024, 110 * 1024};
+
+static database_t db;
+
+std::vector<std::string> random_docs() {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> ages(18, 90);
+    char const* cities[] = {"Yerevan", "Berlin", "San Francisco", "Tokyo", "Lagos"};
+    std::vector<std::string> docs(docs_count_k);
+    for (std::size_t i = 0; i != docs_count_k; ++i)
+        docs[i] = fmt::format( //
+            R"({{"id":{},"name":"user-{}","age":{},"city":"{}","active":{},"tags":["member","tier-{}"],"score":{}.{}}})",
+            i,
+            generator(),
+            ages(generator),
+            cities[generator() % 5],
+            generator() % 2 ? "true" : "false",
+            generator() % 4,
+            generator() % 1000,
+            generator() % 100);
+    return docs;
+}
+
+/**
+ * @brief Fills a new collection with `docs`, compressing it, if the `dictionary_size` isn't zero.
+ * @return The total length of stored binary values.
+ */
+std::size_t fill(ustore_str_view_t name, std::vector<std::string> const& docs, ustore_size_t dictionary_size) {
+    docs_collection_t collection = *db.create<docs_collection_t>(name);
+    for (std::size_t i = 0; i != docs.size(); ++i)
+        collection[static_cast<ustore_key_t>(i)].assign(docs[i].c_str()).throw_unhandled();
+    if (dictionary_size)
+        collection.set_compression(samples_count_k, dictionary_size).throw_unhandled();
+
+    std::vector<ustore_key_t> keys(docs.size());
+    std::iota(keys.begin(), keys.end(), 0);
+    ustore_collection_t collection_handle = collection;
+    ustore_length_t* lengths = nullptr;
+    arena_t arena(db);
+    status_t status;
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.arena = arena.member_ptr();
+    read.tasks_count = keys.size();
+    read.collections = &collection_handle;
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.lengths = &lengths;
+    ustore_read(&read);
+    status.throw_unhandled();
+    return std::accumulate(lengths, lengths + keys.size(), std::size_t(0));
+}
+
+void read_docs(bm::State& state, ustore_str_view_t name, std::size_t plain_bytes, std::size_t stored_bytes) {
+    docs_collection_t collection = *db.find<docs_collection_t>(name);
+    ustore_collection_t collection_handle = collection;
+    std::vector<ustore_key_t> keys(batch_size_k);
+    arena_t arena(db);
+    std::size_t batch_idx = 0;
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        ustore_key_t first = static_cast<ustore_key_t>(batch_idx++ * batch_size_k % docs_count_k);
+        std::iota(keys.begin(), keys.end(), first);
+
+        ustore_length_t* lengths = nullptr;
+        ustore_bytes_ptr_t values = nullptr;
+        status_t status;
+        ustore_docs_read_t docs_read {};
+        docs_read.db = db;
+        docs_read.error = status.member_ptr();
+        docs_read.arena = arena.member_ptr();
+        docs_read.type = ustore_doc_field_json_k;
+        docs_read.tasks_count = batch_size_k;
+        docs_read.collections = &collection_handle;
+        docs_read.keys = keys.data();
+        docs_read.keys_stride = sizeof(ustore_key_t);
+        docs_read.lengths = &lengths;
+        docs_read.values = &values;
+        ustore_docs_read(&docs_read);
+        if (!status)
+            return state.SkipWithError(status.message());
+        bm::DoNotOptimize(values);
+        bytes += std::accumulate(lengths, lengths + batch_size_k, std::size_t(0));
+    }
+
+    state.counters["docs/s"] = bm::Counter(state.iterations() * batch_size_k, bm::Counter::kIsRate);
+    state.counters["bytes/s"] = bm::Counter(bytes, bm::Counter::kIsRate);
+    state.counters["ratio"] = double(plain_bytes) / stored_bytes;
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    db.open().throw_unhandled();
+
+    std::vector<std::string> docs = random_docs();
+    std::size_t plain_bytes = fill("plain", docs, 0);
+    bm::RegisterBenchmark("read/plain", [=](bm::State& state) {
+        read_docs(state, "plain", plain_bytes, plain_bytes);
+    });
+    for (ustore_size_t dictionary_size : dictionary_sizes_k) {
+        auto name = fmt::format("zstd-{}", dictionary_size);
+        std::size_t stored_bytes = fill(name.c_str(), docs, dictionary_size);
+        bm::RegisterBenchmark(fmt::format("read/zstd/{}", dictionary_size).c_str(), [=](bm::State& state) {
+            read_docs(state, name.c_str(), plain_bytes, stored_bytes);
+        });
+    }
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+    db.close();
+    return 0;
+}
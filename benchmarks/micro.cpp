@@ -0,0 +1,557 @@
+/**
+ * @file micro.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Self-contained microbenchmarks of the core primitives, that need no external datasets.
+ *
+ * Covers the binary layer at different batch and value sizes, the memory arenas,
+ * the layout-specialized walks over the arguments of batches, the neighborhoods codec
+ * of graphs, and the most common calls of every modality.
+ * The SIMD distance kernels are compared separately in `distances.cpp`.
+ * Pass `--benchmark_format=json` or `--benchmark_out=<path>` to track regressions.
+ */
+#include <random>  // `std::mt19937_64`
+#include <string>  // `std::string`
+#include <vector>  // `std::vector`
+#include <numeric> // `std::iota`
+
+#include <fmt/format.h> // `fmt::format`
+#include <benchmark/benchmark.h>
+
+#include <ustore/ustore.hpp>
+#include <ustore/paths.h>
+#include <ustore/vectors.h>
+
+#include "../src/helpers/linked_memory.hpp"   // `linked_memory`
+#include "../src/helpers/integer_packing.hpp" // `pack_integers`
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+
+constexpr std::size_t keys_count_k = 1 << 16;
+constexpr std::size_t vectors_count_k = 1 << 14;
+
+static database_t db;
+
+/**
+ * @brief Batch of random keys, all mapped to the same value of a given size.
+ */
+struct batch_t {
+    std::vector<ustore_key_t> keys;
+    std::string value;
+    ustore_bytes_ptr_t value_ptr = nullptr;
+    ustore_length_t value_length = 0;
+
+    batch_t(std::size_t count, std::size_t value_size) : keys(count), value(value_size, 'x') {
+        value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+        value_length = static_cast<ustore_length_t>(value_size);
+    }
+
+    template <typename generator_at>
+    void shuffle(generator_at& generator) noexcept {
+        for (auto& key : keys)
+            key = static_cast<ustore_key_t>(generator() % keys_count_k);
+    }
+
+    contents_arg_t contents() const noexcept {
+        contents_arg_t arg {};
+        arg.lengths_begin = {&value_length, 0};
+        arg.contents_begin = {&value_ptr, 0};
+        arg.count = keys.size();
+        return arg;
+    }
+};
+
+/**
+ * @brief Fills the main collection with values of the given size, unless already done.
+ * Reads and scans of different value sizes shouldn't share the same dataset.
+ */
+static void prefill(std::size_t value_size) {
+    static std::size_t filled_value_size = 0;
+    if (filled_value_size == value_size)
+        return;
+
+    constexpr std::size_t fill_batch_k = 256;
+    batch_t batch(fill_batch_k, value_size);
+    blobs_collection_t collection = db.main();
+    for (std::size_t key = 0; key < keys_count_k; key += fill_batch_k) {
+        std::iota(batch.keys.begin(), batch.keys.end(), static_cast<ustore_key_t>(key));
+        collection[batch.keys].assign(batch.contents()).throw_unhandled();
+    }
+    filled_value_size = value_size;
+}
+
+static void blobs_write(bm::State& state) {
+    std::mt19937_64 generator(42);
+    batch_t batch(state.range(0), state.range(1));
+    blobs_collection_t collection = db.main();
+    for (auto _ : state) {
+        batch.shuffle(generator);
+        collection[batch.keys].assign(batch.contents()).throw_unhandled();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+static void blobs_read(bm::State& state) {
+    prefill(state.range(1));
+    std::mt19937_64 generator(42);
+    batch_t batch(state.range(0), state.range(1));
+    blobs_collection_t collection = db.main();
+    arena_t arena(db);
+    for (auto _ : state) {
+        batch.shuffle(generator);
+        auto values = collection[batch.keys].on(arena).value();
+        bm::DoNotOptimize(values);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+static void blobs_scan(bm::State& state) {
+    prefill(state.range(1));
+    std::mt19937_64 generator(42);
+    arena_t arena(db);
+    ustore_collection_t collection = ustore_collection_main_k;
+    ustore_length_t scan_length = static_cast<ustore_length_t>(state.range(0));
+    std::size_t scanned = 0;
+    for (auto _ : state) {
+        ustore_key_t start_key = static_cast<ustore_key_t>(generator() % keys_count_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+
+        status_t status;
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = status.member_ptr();
+        scan.arena = arena.member_ptr();
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &scan_length;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        status.throw_unhandled();
+        scanned += *found_counts;
+    }
+    state.SetItemsProcessed(scanned);
+}
+
+/**
+ * @brief Reuses the same arena between calls, like most of the bindings do.
+ */
+static void arena_reuse(bm::State& state) {
+    std::size_t const allocation_size = state.range(0);
+    std::size_t const allocations_count = state.range(1);
+    ustore_arena_t c_arena = nullptr;
+    for (auto _ : state) {
+        status_t status;
+        linked_memory_lock_t arena = linked_memory(&c_arena, ustore_options_default_k, status.member_ptr());
+        for (std::size_t i = 0; i != allocations_count; ++i)
+            bm::DoNotOptimize(arena.alloc<ustore_byte_t>(allocation_size, status.member_ptr()).begin());
+        status.throw_unhandled();
+    }
+    ustore_arena_free(c_arena);
+    state.SetItemsProcessed(state.iterations() * allocations_count);
+}
+
+/**
+ * @brief Starts every call with a new arena, recycled through the thread-local pools.
+ */
+static void arena_fresh(bm::State& state) {
+    std::size_t const allocation_size = state.range(0);
+    std::size_t const allocations_count = state.range(1);
+    for (auto _ : state) {
+        status_t status;
+        ustore_arena_t c_arena = nullptr;
+        {
+            linked_memory_lock_t arena = linked_memory(&c_arena, ustore_options_default_k, status.member_ptr());
+            for (std::size_t i = 0; i != allocations_count; ++i)
+                bm::DoNotOptimize(arena.alloc<ustore_byte_t>(allocation_size, status.member_ptr()).begin());
+        }
+        ustore_arena_free(c_arena);
+        status.throw_unhandled();
+    }
+    state.SetItemsProcessed(state.iterations() * allocations_count);
+}
+
+static std::string random_doc(std::size_t fields_count, std::mt19937_64& generator) {
+    std::string doc = "{";
+    for (std::size_t i = 0; i != fields_count; ++i)
+        doc += fmt::format("{}\"field{}\":{}", i ? "," : "", i, generator() % 1000);
+    doc += "}";
+    return doc;
+}
+
+static void docs_write(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::string doc = random_doc(state.range(0), generator);
+    docs_collection_t collection = *db.find_or_create<docs_collection_t>("docs");
+    ustore_key_t key = 0;
+    for (auto _ : state) {
+        collection[key].assign(doc.c_str()).throw_unhandled();
+        key = (key + 1) % keys_count_k;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void docs_patch(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::string doc = random_doc(state.range(0), generator);
+    docs_collection_t collection = *db.find_or_create<docs_collection_t>("docs");
+    collection[0].assign(doc.c_str()).throw_unhandled();
+    std::string patch;
+    for (auto _ : state) {
+        patch = fmt::format(R"([{{"op":"replace","path":"/field0","value":{}}}])", generator() % 1000);
+        collection[0].patch(patch.c_str()).throw_unhandled();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void docs_field_read(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::string doc = random_doc(state.range(0), generator);
+    docs_collection_t collection = *db.find_or_create<docs_collection_t>("docs");
+    collection[0].assign(doc.c_str()).throw_unhandled();
+    std::string field = fmt::format("/field{}", state.range(0) - 1);
+    arena_t arena(db);
+    for (auto _ : state) {
+        auto value = collection[ckf(0, field.c_str())].on(arena).value();
+        bm::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Sorted neighbor IDs with random gaps, like the ones stored in every vertex.
+ */
+static std::vector<ustore_key_t> random_neighbors(std::size_t degree) {
+    std::mt19937_64 generator(42);
+    std::vector<ustore_key_t> neighbors(degree);
+    ustore_key_t last = 0;
+    for (auto& neighbor : neighbors)
+        neighbor = last += static_cast<ustore_key_t>(generator() % 1000 + 1);
+    return neighbors;
+}
+
+static void neighborhood_pack(bm::State& state) {
+    std::vector<ustore_key_t> neighbors = random_neighbors(state.range(0));
+    std::vector<std::uint8_t> packed(packed_integers_bound(neighbors.size()));
+    auto delta = [&](std::size_t i) { return zigzag_encode(i ? neighbors[i] - neighbors[i - 1] : neighbors[0]); };
+    for (auto _ : state)
+        bm::DoNotOptimize(pack_integers(neighbors.size(), delta, packed.data()));
+    state.SetItemsProcessed(state.iterations() * neighbors.size());
+}
+
+static void neighborhood_unpack(bm::State& state) {
+    std::vector<ustore_key_t> neighbors = random_neighbors(state.range(0));
+    std::vector<std::uint8_t> packed(packed_integers_bound(neighbors.size()));
+    auto delta = [&](std::size_t i) { return zigzag_encode(i ? neighbors[i] - neighbors[i - 1] : neighbors[0]); };
+    std::uint8_t* packed_end = pack_integers(neighbors.size(), delta, packed.data());
+    for (auto _ : state) {
+        ustore_key_t last = 0;
+        unpack_integers(packed.data(), packed_end, neighbors.size(), [&](std::size_t, std::uint64_t value) noexcept {
+            last += zigzag_decode(value);
+        });
+        bm::DoNotOptimize(last);
+    }
+    state.SetItemsProcessed(state.iterations() * neighbors.size());
+}
+
+/**
+ * @brief Arguments of a batch of 1M keys in the main collection with 8-byte values
+ * in a shared buffer, addressed by lengths or, with a non-zero argument, Arrow-like offsets.
+ */
+struct dense_batch_t {
+    static constexpr std::size_t count_k = 1'000'000;
+    std::vector<ustore_key_t> keys;
+    std::vector<ustore_length_t> lengths;
+    std::vector<ustore_length_t> offsets;
+    std::string values;
+    ustore_bytes_cptr_t values_ptr = nullptr;
+
+    dense_batch_t() : keys(count_k), lengths(count_k, 8), offsets(count_k + 1), values(count_k * 8, 'x') {
+        std::iota(keys.begin(), keys.end(), 0);
+        for (std::size_t i = 0; i != offsets.size(); ++i)
+            offsets[i] = static_cast<ustore_length_t>(i * 8);
+        values_ptr = reinterpret_cast<ustore_bytes_cptr_t>(values.data());
+    }
+
+    places_arg_t places() const noexcept { return {{}, {keys.data(), sizeof(ustore_key_t)}, {}, count_k}; }
+    contents_arg_t contents(bool arrow) const noexcept {
+        contents_arg_t arg {};
+        arg.contents_begin = {&values_ptr, 0};
+        if (arrow)
+            arg.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
+        else
+            arg.lengths_begin = {lengths.data(), sizeof(ustore_length_t)};
+        arg.count = count_k;
+        return arg;
+    }
+};
+
+/**
+ * @brief Touches every place and value, like the engines do, when serializing a batch.
+ */
+template <typename places_at, typename contents_at>
+std::size_t walk_args(places_at const& places, contents_at const& contents) noexcept {
+    std::size_t checksum = 0;
+    for (std::size_t i = 0; i != places.size(); ++i)
+        checksum += places[i].collection + static_cast<std::size_t>(places[i].key) + contents[i].size();
+    return checksum;
+}
+
+static void args_strided(bm::State& state) {
+    dense_batch_t batch;
+    places_arg_t places = batch.places();
+    contents_arg_t contents = batch.contents(state.range(0));
+    for (auto _ : state)
+        bm::DoNotOptimize(walk_args(places, contents));
+    state.SetItemsProcessed(state.iterations() * dense_batch_t::count_k);
+}
+
+static void args_dense(bm::State& state) {
+    dense_batch_t batch;
+    places_arg_t places = batch.places();
+    contents_arg_t contents = batch.contents(state.range(0));
+    for (auto _ : state)
+        bm::DoNotOptimize(dispatch_places(places, [&](auto const& places) noexcept {
+            return dispatch_contents(contents, [&](auto const& contents) noexcept { //
+                return walk_args(places, contents);
+            });
+        }));
+    state.SetItemsProcessed(state.iterations() * dense_batch_t::count_k);
+}
+
+static void graph_upsert_edges(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::vector<edge_t> batch(state.range(0));
+    graph_collection_t graph = *db.find_or_create<graph_collection_t>("graph");
+    ustore_key_t edge_id = 0;
+    for (auto _ : state) {
+        for (auto& edge : batch)
+            edge = edge_t {static_cast<ustore_key_t>(generator() % keys_count_k),
+                           static_cast<ustore_key_t>(generator() % keys_count_k),
+                           edge_id++};
+        graph.upsert_edges(edges(batch)).throw_unhandled();
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+
+static void graph_neighbors(bm::State& state) {
+    std::mt19937_64 generator(42);
+    graph_collection_t graph = *db.find_or_create<graph_collection_t>("graph");
+    std::size_t exported = 0;
+    for (auto _ : state) {
+        auto neighbors = graph.neighbors(static_cast<ustore_key_t>(generator() % keys_count_k)).throw_or_release();
+        exported += neighbors.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["neighbors/s"] = bm::Counter(exported, bm::Counter::kIsRate);
+}
+
+static void vectors_search(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    ustore_size_t const dims = static_cast<ustore_size_t>(state.range(0));
+    std::vector<float> vectors(vectors_count_k * dims);
+    for (auto& scalar : vectors)
+        scalar = distribution(generator);
+    std::vector<ustore_key_t> keys(vectors_count_k);
+    std::iota(keys.begin(), keys.end(), 0);
+
+    ustore_collection_t collection = *db.find_or_create(fmt::format("vectors{}", dims).c_str());
+    arena_t arena(db);
+    status_t status;
+    float const* vectors_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.tasks_count = vectors_count_k;
+    write.dimensions = dims;
+    write.collections = &collection;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = reinterpret_cast<ustore_bytes_cptr_t const*>(&vectors_begin);
+    write.vectors_stride = sizeof(float) * dims;
+    ustore_vectors_write(&write);
+    status.throw_unhandled();
+
+    ustore_length_t max_results = 10;
+    for (auto _ : state) {
+        float const* query_begin = vectors.data() + (generator() % vectors_count_k) * dims;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.tasks_count = 1;
+        search.dimensions = dims;
+        search.collections = &collection;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = reinterpret_cast<ustore_bytes_cptr_t const*>(&query_begin);
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_cos_k;
+        ustore_vectors_search(&search);
+        status.throw_unhandled();
+        bm::DoNotOptimize(found_keys);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Random paths, resembling the hierarchical names of files or of fields.
+ */
+static std::vector<std::string> random_paths(std::size_t count, std::mt19937_64& generator) {
+    std::vector<std::string> paths(count);
+    for (auto& path : paths)
+        path = fmt::format("/users/{}/posts/{}", generator() % 1000, generator() % keys_count_k);
+    return paths;
+}
+
+static void paths_write(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::vector<std::string> paths = random_paths(state.range(0), generator);
+    std::vector<ustore_str_view_t> paths_ptrs(paths.size());
+    ustore_collection_t collection = *db.find_or_create("paths");
+    arena_t arena(db);
+    ustore_str_view_t value = "value";
+    for (auto _ : state) {
+        state.PauseTiming();
+        paths = random_paths(paths.size(), generator);
+        for (std::size_t i = 0; i != paths.size(); ++i)
+            paths_ptrs[i] = paths[i].c_str();
+        state.ResumeTiming();
+
+        status_t status;
+        ustore_paths_write_t paths_write {};
+        paths_write.db = db;
+        paths_write.error = status.member_ptr();
+        paths_write.arena = arena.member_ptr();
+        paths_write.tasks_count = paths.size();
+        paths_write.collections = &collection;
+        paths_write.paths = paths_ptrs.data();
+        paths_write.paths_stride = sizeof(ustore_str_view_t);
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t const*>(&value);
+        ustore_paths_write(&paths_write);
+        status.throw_unhandled();
+    }
+    state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+static void paths_read(bm::State& state) {
+    std::mt19937_64 generator(42);
+    std::vector<std::string> paths = random_paths(state.range(0), generator);
+    std::vector<ustore_str_view_t> paths_ptrs(paths.size());
+    for (std::size_t i = 0; i != paths.size(); ++i)
+        paths_ptrs[i] = paths[i].c_str();
+    ustore_collection_t collection = *db.find_or_create("paths");
+    arena_t arena(db);
+    for (auto _ : state) {
+        status_t status;
+        ustore_char_t* found_values = nullptr;
+        ustore_paths_read_t paths_read {};
+        paths_read.db = db;
+        paths_read.error = status.member_ptr();
+        paths_read.arena = arena.member_ptr();
+        paths_read.tasks_count = paths.size();
+        paths_read.collections = &collection;
+        paths_read.paths = paths_ptrs.data();
+        paths_read.paths_stride = sizeof(ustore_str_view_t);
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&found_values);
+        ustore_paths_read(&paths_read);
+        status.throw_unhandled();
+        bm::DoNotOptimize(found_values);
+    }
+    state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+static void paths_match(bm::State& state) {
+    std::mt19937_64 generator(42);
+    ustore_collection_t collection = *db.find_or_create("paths");
+    arena_t arena(db);
+    ustore_length_t max_count = static_cast<ustore_length_t>(state.range(0));
+    std::string pattern;
+    for (auto _ : state) {
+        pattern = fmt::format("/users/{}/", generator() % 1000);
+        ustore_str_view_t pattern_ptr = pattern.c_str();
+        ustore_length_t* found_counts = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_char_t* found_paths = nullptr;
+
+        status_t status;
+        ustore_paths_match_t paths_match {};
+        paths_match.db = db;
+        paths_match.error = status.member_ptr();
+        paths_match.arena = arena.member_ptr();
+        paths_match.tasks_count = 1;
+        paths_match.collections = &collection;
+        paths_match.match_counts_limits = &max_count;
+        paths_match.patterns = &pattern_ptr;
+        paths_match.match_counts = &found_counts;
+        paths_match.paths_offsets = &found_offsets;
+        paths_match.paths_strings = &found_paths;
+        ustore_paths_match(&paths_match);
+        status.throw_unhandled();
+        bm::DoNotOptimize(found_paths);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    db.open().throw_unhandled();
+
+    for (auto benchmark : {
+             bm::RegisterBenchmark("blobs_write", blobs_write),
+             bm::RegisterBenchmark("blobs_read", blobs_read),
+         })
+        benchmark->ArgsProduct({{1, 16, 256}, {8, 256, 4096}})->ArgNames({"batch", "value"});
+    bm::RegisterBenchmark("blobs_scan", blobs_scan)
+        ->ArgsProduct({{16, 256, 4096}, {8, 256}})
+        ->ArgNames({"length", "value"});
+
+    for (auto benchmark : {
+             bm::RegisterBenchmark("arena_reuse", arena_reuse),
+             bm::RegisterBenchmark("arena_fresh", arena_fresh),
+         })
+        benchmark->ArgsProduct({{64, 4096, 1 << 20}, {1, 64}})->ArgNames({"size", "count"});
+
+    for (auto benchmark : {
+             bm::RegisterBenchmark("docs_write", docs_write),
+             bm::RegisterBenchmark("docs_patch", docs_patch),
+             bm::RegisterBenchmark("docs_field_read", docs_field_read),
+         })
+        benchmark->Arg(4)->Arg(64)->ArgName("fields");
+
+    for (auto benchmark : {
+             bm::RegisterBenchmark("neighborhood_pack", neighborhood_pack),
+             bm::RegisterBenchmark("neighborhood_unpack", neighborhood_unpack),
+         })
+        benchmark->Arg(16)->Arg(256)->Arg(4096)->ArgName("degree");
+    for (auto benchmark : {
+             bm::RegisterBenchmark("args_strided", args_strided),
+             bm::RegisterBenchmark("args_dense", args_dense),
+         })
+        benchmark->Arg(0)->Arg(1)->ArgName("arrow");
+    bm::RegisterBenchmark("graph_upsert_edges", graph_upsert_edges)->Arg(1)->Arg(256)->ArgName("batch");
+    bm::RegisterBenchmark("graph_neighbors", graph_neighbors);
+
+    bm::RegisterBenchmark("vectors_search", vectors_search)->Arg(96)->Arg(768)->ArgName("dims");
+
+    bm::RegisterBenchmark("paths_write", paths_write)->Arg(1)->Arg(256)->ArgName("batch");
+    bm::RegisterBenchmark("paths_read", paths_read)->Arg(1)->Arg(256)->ArgName("batch");
+    bm::RegisterBenchmark("paths_match", paths_match)->Arg(16)->Arg(256)->ArgName("limit");
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+    db.close();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file transactions.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Measures how transactional read-modify-writes scale under contention.
+ *
+ * Every transaction reads and overwrites `txn_size` keys, `hot_percent` of which are drawn
+ * from a small set of popular keys, and the rest - uniformly from the whole key space.
+ * Transactions started without watching can't conflict, so their commits should never fail.
+ * Watched ones are retried until they commit, reporting the share of aborted attempts
+ * and the latency percentiles of commits and of whole transactions, including the retries.
+ *
+ * The `batch` runs do the same writes without transactions, to show what the isolation costs.
+ */
+#include <array>   // `std::array`
+#include <chrono>  // `std::chrono::steady_clock`
+#include <random>  // `std::mt19937_64`
+#include <vector>  // `std::vector`
+#include <numeric> // `std::iota`
+
+#include <benchmark/benchmark.h>
+
+#include <ustore/ustore.hpp>
+
+#include "../src/helpers/metrics.hpp" // `latency_histogram_t`
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+
+constexpr std::size_t keys_count_k = 1'000'000;
+constexpr std::size_t hot_keys_count_k = 64;
+constexpr std::size_t value_size_k = 64;
+constexpr int max_threads_k = 64;
+
+static database_t db;
+
+/**
+ * @brief Latencies are shared by all the threads of a benchmark. They are reset
+ * by the first thread before the timed loop, and summarized after it, relying on
+ * Google Benchmark synchronizing the threads at both ends of the loop.
+ */
+static latency_histogram_t commit_latencies;
+static latency_histogram_t transaction_latencies;
+
+static void reset(latency_histogram_t& histogram) noexcept {
+    for (auto& count : histogram.counts)
+        count.store(0, std::memory_order_relaxed);
+    histogram.total_ns.store(0, std::memory_order_relaxed);
+}
+
+static void report(bm::State& state, char const* name, latency_histogram_t const& histogram) {
+    latency_summary_t summary;
+    summary.add(histogram);
+    std::string prefix = name;
+    state.counters[prefix + "_p50_us"] = summary.quantile(0.5) / 1e3;
+    state.counters[prefix + "_p99_us"] = summary.quantile(0.99) / 1e3;
+    state.counters[prefix + "_p999_us"] = summary.quantile(0.999) / 1e3;
+}
+
+struct batch_t {
+    std::vector<ustore_key_t> keys;
+    std::array<char, value_size_k> value {};
+    ustore_bytes_ptr_t value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+    ustore_length_t value_length = static_cast<ustore_length_t>(value_size_k);
+
+    explicit batch_t(std::size_t size) : keys(size) {}
+
+    template <typename generator_at>
+    void shuffle(generator_at& generator, std::size_t hot_percent) noexcept {
+        for (auto& key : keys)
+            key = static_cast<ustore_key_t>(generator() % 100 < hot_percent ? generator() % hot_keys_count_k
+                                                                             : generator() % keys_count_k);
+    }
+
+    contents_arg_t contents() const noexcept {
+        contents_arg_t arg {};
+        arg.lengths_begin = {&value_length, 0};
+        arg.contents_begin = {&value_ptr, 0};
+        arg.count = keys.size();
+        return arg;
+    }
+};
+
+/**
+ * @brief Begins a new transaction or resets the existing one, optionally without watching.
+ */
+static status_t begin(ustore_transaction_t& txn, bool watch) noexcept {
+    status_t status;
+    ustore_transaction_init_t txn_init {};
+    txn_init.db = db;
+    txn_init.error = status.member_ptr();
+    txn_init.options = watch ? ustore_options_default_k : ustore_option_transaction_dont_watch_k;
+    txn_init.transaction = &txn;
+    ustore_transaction_init(&txn_init);
+    return status;
+}
+
+static void fill(bm::State& state) {
+    constexpr std::size_t fill_batch_k = 256;
+    batch_t batch(fill_batch_k);
+    blobs_collection_t collection = db.main();
+    for (auto _ : state)
+        for (ustore_key_t key = 0; key < static_cast<ustore_key_t>(keys_count_k); key += fill_batch_k) {
+            std::iota(batch.keys.begin(), batch.keys.end(), key);
+            collection[batch.keys].assign(batch.contents()).throw_unhandled();
+        }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * keys_count_k, bm::Counter::kIsRate);
+}
+
+static void transact(bm::State& state) {
+    std::size_t const txn_size = static_cast<std::size_t>(state.range(0));
+    std::size_t const hot_percent = static_cast<std::size_t>(state.range(1));
+    bool const watch = state.range(2) != 0;
+
+    std::mt19937_64 generator(state.thread_index() + 1);
+    batch_t batch(txn_size);
+    ustore_transaction_t raw = nullptr;
+    begin(raw, watch).throw_unhandled();
+    context_t txn {db, raw};
+
+    if (state.thread_index() == 0) {
+        reset(commit_latencies);
+        reset(transaction_latencies);
+    }
+
+    std::size_t commits = 0, aborts = 0;
+    for (auto _ : state) {
+        batch.shuffle(generator, hot_percent);
+        auto transaction_start = std::chrono::steady_clock::now();
+        while (true) {
+            begin(raw, watch).throw_unhandled();
+            txn[batch.keys].value(watch).throw_unhandled();
+            txn[batch.keys].assign(batch.contents()).throw_unhandled();
+
+            auto commit_start = std::chrono::steady_clock::now();
+            status_t status = txn.commit();
+            auto commit_end = std::chrono::steady_clock::now();
+            commit_latencies.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(commit_end - commit_start).count()));
+            if (status) {
+                transaction_latencies.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(commit_end - transaction_start).count()));
+                break;
+            }
+            ++aborts;
+        }
+        ++commits;
+    }
+
+    state.counters["commits/s"] = bm::Counter(commits, bm::Counter::kIsRate);
+    state.counters["aborts/s"] = bm::Counter(aborts, bm::Counter::kIsRate);
+    state.counters["pairs/s"] = bm::Counter(commits * txn_size, bm::Counter::kIsRate);
+    state.counters["aborts/commit"] = bm::Counter(commits ? double(aborts) / commits : 0, bm::Counter::kAvgThreads);
+    if (state.thread_index() == 0) {
+        report(state, "commit", commit_latencies);
+        report(state, "txn", transaction_latencies);
+    }
+}
+
+static void batch(bm::State& state) {
+    std::size_t const batch_size = static_cast<std::size_t>(state.range(0));
+    std::size_t const hot_percent = static_cast<std::size_t>(state.range(1));
+
+    std::mt19937_64 generator(state.thread_index() + 1);
+    batch_t batch(batch_size);
+    blobs_collection_t collection = db.main();
+    for (auto _ : state) {
+        batch.shuffle(generator, hot_percent);
+        bm::DoNotOptimize(collection[batch.keys].value());
+        collection[batch.keys].assign(batch.contents()).throw_unhandled();
+    }
+    state.counters["pairs/s"] = bm::Counter(state.iterations() * batch_size, bm::Counter::kIsRate);
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    if (!ustore_supports_transactions_k) {
+        std::printf("Selected UStore Engine doesn't support ACID transactions\n");
+        return 0;
+    }
+    db.open().throw_unhandled();
+
+    bm::RegisterBenchmark("fill", fill)->Iterations(1)->Unit(bm::kMillisecond);
+    bm::RegisterBenchmark("transact", transact)
+        ->ArgsProduct({{1, 4, 16, 64}, {0, 10, 50, 100}, {0, 1}})
+        ->ArgNames({"txn_size", "hot_percent", "watch"})
+        ->ThreadRange(1, max_threads_k)
+        ->UseRealTime();
+    bm::RegisterBenchmark("batch", batch)
+        ->ArgsProduct({{1, 4, 16, 64}, {0, 10, 50, 100}})
+        ->ArgNames({"batch_size", "hot_percent"})
+        ->ThreadRange(1, max_threads_k)
+        ->UseRealTime();
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+    db.close();
+    return 0;
+}
@@ -616,6 +616,42 @@ static void graph_traverse_two_hops(bm::State& state) {
     state.counters["edges/s"] = bm::Counter(received_edges, bm::Counter::kIsRate);
 }
 
+static void graph_traverse_two_hops_server(bm::State& state) {
+    arena_t arena(db);
+
+    std::size_t received_bytes = 0;
+    std::size_t received_vertices = 0;
+    sample_tweet_id_batches(state, [&](ustore_key_t const* ids_tweets, ustore_size_t count) {
+        ustore_key_t* visited = nullptr;
+        ustore_size_t visited_count = 0;
+
+        status_t status;
+        ustore_graph_traverse_t graph_traverse {};
+        graph_traverse.db = db;
+        graph_traverse.error = status.member_ptr();
+        graph_traverse.arena = arena.member_ptr();
+        graph_traverse.collection = collection_graph_k;
+        graph_traverse.sources_count = count;
+        graph_traverse.sources = ids_tweets;
+        graph_traverse.sources_stride = sizeof(ustore_key_t);
+        graph_traverse.role = ustore_vertex_role_any_k;
+        graph_traverse.hops = 2;
+        graph_traverse.visited = &visited;
+        graph_traverse.visited_count = &visited_count;
+
+        ustore_graph_traverse(&graph_traverse);
+        if (!status)
+            return false;
+
+        received_bytes += visited_count * sizeof(ustore_key_t);
+        received_vertices += visited_count;
+        return true;
+    });
+    state.counters["bytes/s"] = bm::Counter(received_bytes, bm::Counter::kIsRate);
+    state.counters["bytes/it"] = bm::Counter(received_bytes, bm::Counter::kAvgIterations);
+    state.counters["vertices/s"] = bm::Counter(received_vertices, bm::Counter::kIsRate);
+}
+
 int main(int argc, char** argv) {
     bm::Initialize(&argc, argv);
 
@@ -819,13 +855,20 @@ int main(int argc, char** argv) {
         ->Arg(settings.mid_batch_size)
         ->Arg(settings.big_batch_size);
 
-    if (can_build_graph)
+    if (can_build_graph) {
         bm::RegisterBenchmark("graph_traverse_two_hops", &graph_traverse_two_hops) //
             ->MinTime(settings.min_seconds)
             ->Threads(settings.threads_count)
             ->Arg(settings.small_batch_size)
             ->Arg(settings.mid_batch_size)
             ->Arg(settings.big_batch_size);
+        bm::RegisterBenchmark("graph_traverse_two_hops_server", &graph_traverse_two_hops_server) //
+            ->MinTime(settings.min_seconds)
+            ->Threads(settings.threads_count)
+            ->Arg(settings.small_batch_size)
+            ->Arg(settings.mid_batch_size)
+            ->Arg(settings.big_batch_size);
+    }
 
     bm::RunSpecifiedBenchmarks();
     bm::Shutdown();
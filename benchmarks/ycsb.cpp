@@ -0,0 +1,526 @@
+/**
+ * @file ycsb.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief YCSB-style workload driver, reporting the throughput and latency percentiles over time.
+ *
+ * Runs one of the YCSB A-F mixes, or a custom mix of reads, updates, inserts, scans and
+ * read-modify-writes, against any engine or the Flight client. Keys are chosen uniformly,
+ * from a scrambled Zipfian distribution, or favoring the latest inserts, as in YCSB.
+ * Unlike the Google Benchmark suites, that report averages, every interval prints the
+ * p50, p99 and p999 latencies of every kind of operation.
+ *
+ * With a `--target` throughput, operations are scheduled in advance, and the latency is
+ * measured from the scheduled time, so that a stalled server can't hide the queueing delay.
+ * Multiple client `--processes` share the server, so are only supported by the Flight client.
+ */
+#include <atomic>  // `std::atomic`
+#include <chrono>  // `std::chrono::steady_clock`
+#include <cmath>   // `std::pow`
+#include <random>  // `std::mt19937_64`
+#include <string>  // `std::string`
+#include <thread>  // `std::thread`
+#include <vector>  // `std::vector`
+#include <numeric> // `std::iota`
+#include <array>   // `std::array`
+#include <limits>  // `std::numeric_limits`
+
+#include <sys/wait.h> // `waitpid`
+#include <unistd.h>   // `fork`
+
+#include <fmt/format.h>
+#include <argparse/argparse.hpp>
+
+#include <ustore/ustore.hpp>
+
+#include "../src/helpers/metrics.hpp" // `latency_histogram_t`
+
+using namespace unum::ustore;
+using clock_t_ = std::chrono::steady_clock;
+
+enum class op_kind_t : std::size_t { read_k = 0, update_k, insert_k, scan_k, read_modify_write_k, count_k };
+constexpr std::size_t op_kinds_k = static_cast<std::size_t>(op_kind_t::count_k);
+constexpr char const* op_names_k[op_kinds_k] = {"read", "update", "insert", "scan", "read_modify_write"};
+
+enum class distribution_t { uniform_k, zipfian_k, latest_k };
+
+struct settings_t {
+    std::string config;
+    std::size_t records_count = 1'000'000;
+    std::size_t operations_count = 0;
+    std::size_t seconds = 60;
+    std::size_t threads_count = 1;
+    std::size_t processes_count = 1;
+    std::size_t process_idx = 0;
+    std::size_t target_throughput = 0;
+    std::size_t report_interval = 1;
+    std::size_t value_min_length = 1000;
+    std::size_t value_max_length = 1000;
+    std::size_t scan_max_length = 100;
+    double proportions[op_kinds_k] = {};
+    distribution_t distribution = distribution_t::zipfian_k;
+    bool load = true;
+    bool run = true;
+    bool json = false;
+};
+
+static settings_t settings;
+
+/**
+ * @brief The standard YCSB mixes, all using Zipfian keys, except for the D workload,
+ * which favors the latest inserts.
+ */
+static bool apply_workload(char workload) {
+    auto& p = settings.proportions;
+    std::fill(std::begin(p), std::end(p), 0.0);
+    settings.distribution = distribution_t::zipfian_k;
+    switch (workload) {
+    case 'a': p[0] = 0.5, p[1] = 0.5; return true;
+    case 'b': p[0] = 0.95, p[1] = 0.05; return true;
+    case 'c': p[0] = 1.0; return true;
+    case 'd': p[0] = 0.95, p[2] = 0.05, settings.distribution = distribution_t::latest_k; return true;
+    case 'e': p[3] = 0.95, p[2] = 0.05; return true;
+    case 'f': p[0] = 0.5, p[4] = 0.5; return true;
+    default: return false;
+    }
+}
+
+/**
+ * @brief Zipfian generator of ranks in `[0, items_count)`, following "Quickly Generating
+ * Billion-Record Synthetic Databases" by Gray et al., just like YCSB does.
+ */
+class zipfian_t {
+    std::size_t items_count_;
+    double theta_, alpha_, zeta_n_, eta_;
+
+  public:
+    explicit zipfian_t(std::size_t items_count, double theta = 0.99) noexcept
+        : items_count_(items_count), theta_(theta), alpha_(1.0 / (1.0 - theta)) {
+        zeta_n_ = 0;
+        for (std::size_t i = 1; i <= items_count_; ++i)
+            zeta_n_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+        double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta_);
+        eta_ = (1.0 - std::pow(2.0 / items_count_, 1.0 - theta_)) / (1.0 - zeta_2 / zeta_n_);
+    }
+
+    template <typename generator_at>
+    std::size_t operator()(generator_at& generator) const noexcept {
+        double u = std::uniform_real_distribution<double>(0, 1)(generator);
+        double uz = u * zeta_n_;
+        if (uz < 1.0)
+            return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_))
+            return 1;
+        auto rank = static_cast<std::size_t>(items_count_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(rank, items_count_ - 1);
+    }
+};
+
+inline std::uint64_t fnv_hash(std::uint64_t value) noexcept {
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    for (std::size_t i = 0; i != 8; ++i, value >>= 8)
+        hash = (hash ^ (value & 0xFF)) * 0x100000001B3ull;
+    return hash;
+}
+
+/**
+ * @brief Keys of inserts are interleaved between processes, so that they never collide.
+ */
+static std::atomic<std::size_t> inserted_count {0};
+
+static ustore_key_t inserted_key(std::size_t insert_idx) noexcept {
+    return static_cast<ustore_key_t>(settings.records_count + insert_idx * settings.processes_count +
+                                     settings.process_idx);
+}
+
+struct alignas(64) thread_stats_t {
+    std::array<latency_histogram_t, op_kinds_k> latencies;
+    std::array<std::atomic<std::uint64_t>, op_kinds_k> errors {};
+};
+
+class worker_t {
+    blobs_collection_t collection_;
+    arena_t arena_;
+    pairs_stream_t stream_;
+    std::mt19937_64 generator_;
+    zipfian_t const& zipfian_;
+    thread_stats_t& stats_;
+    std::string value_;
+
+    ustore_key_t next_key() noexcept {
+        std::size_t const records_count = settings.records_count;
+        switch (settings.distribution) {
+        case distribution_t::uniform_k: return static_cast<ustore_key_t>(generator_() % records_count);
+        case distribution_t::zipfian_k:
+            return static_cast<ustore_key_t>(fnv_hash(zipfian_(generator_)) % records_count);
+        case distribution_t::latest_k: break;
+        }
+        // The latest inserted keys are the most popular, followed by the last loaded ones
+        std::size_t rank = zipfian_(generator_);
+        std::size_t inserted = inserted_count.load(std::memory_order_relaxed);
+        if (rank < inserted)
+            return inserted_key(inserted - 1 - rank);
+        return static_cast<ustore_key_t>(records_count - 1 - std::min(rank - inserted, records_count - 1));
+    }
+
+    value_view_t next_value() noexcept {
+        std::size_t length = settings.value_min_length;
+        if (settings.value_max_length > settings.value_min_length)
+            length += generator_() % (settings.value_max_length - settings.value_min_length + 1);
+        return {reinterpret_cast<ustore_bytes_cptr_t>(value_.data()), static_cast<ustore_length_t>(length)};
+    }
+
+    op_kind_t next_kind() noexcept {
+        double u = std::uniform_real_distribution<double>(0, 1)(generator_);
+        for (std::size_t i = 0; i != op_kinds_k; ++i)
+            if ((u -= settings.proportions[i]) < 0)
+                return static_cast<op_kind_t>(i);
+        return op_kind_t::read_k;
+    }
+
+    bool execute(op_kind_t kind) noexcept {
+        switch (kind) {
+        case op_kind_t::read_k: return static_cast<bool>(collection_[next_key()].on(arena_).value());
+        case op_kind_t::update_k: return collection_[next_key()].on(arena_).assign(next_value());
+        case op_kind_t::insert_k: {
+            ustore_key_t key = inserted_key(inserted_count.fetch_add(1, std::memory_order_relaxed));
+            return collection_[key].on(arena_).assign(next_value());
+        }
+        case op_kind_t::scan_k: {
+            std::size_t length = generator_() % settings.scan_max_length + 1;
+            status_t status = stream_.seek(next_key());
+            for (std::size_t i = 0; status && i != length && !stream_.is_end(); ++i) {
+                value_view_t value = stream_.value();
+                benchmark_do_not_optimize(value);
+                status = stream_.advance();
+            }
+            return status;
+        }
+        case op_kind_t::read_modify_write_k: {
+            ustore_key_t key = next_key();
+            if (!collection_[key].on(arena_).value())
+                return false;
+            return collection_[key].on(arena_).assign(next_value());
+        }
+        default: return false;
+        }
+    }
+
+    template <typename value_at>
+    static void benchmark_do_not_optimize(value_at const& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+  public:
+    worker_t(database_t& db, std::size_t seed, zipfian_t const& zipfian, thread_stats_t& stats)
+        : collection_(db.main()), arena_(db), stream_(db, ustore_collection_main_k, settings.scan_max_length),
+          generator_(seed), zipfian_(zipfian), stats_(stats), value_(settings.value_max_length, 'x') {}
+
+    void run(clock_t_::time_point deadline, std::size_t operations_count, double ops_per_second) noexcept {
+        std::chrono::duration<double> const pause(ops_per_second > 0 ? 1.0 / ops_per_second : 0);
+        clock_t_::time_point scheduled = clock_t_::now();
+        for (std::size_t i = 0; i != operations_count && scheduled < deadline; ++i) {
+            op_kind_t kind = next_kind();
+            if (ops_per_second > 0) {
+                scheduled += std::chrono::duration_cast<clock_t_::duration>(pause);
+                std::this_thread::sleep_until(scheduled);
+            }
+            else
+                scheduled = clock_t_::now();
+
+            bool succeeded = execute(kind);
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t_::now() - scheduled);
+            std::size_t kind_idx = static_cast<std::size_t>(kind);
+            stats_.latencies[kind_idx].record(static_cast<std::uint64_t>(elapsed.count()));
+            if (!succeeded)
+                stats_.errors[kind_idx].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * @brief Inserts the share of the initial records, that belongs to this process, in batches.
+ */
+static void load(database_t& db) {
+    constexpr std::size_t batch_size_k = 256;
+    std::size_t const first = settings.records_count * settings.process_idx / settings.processes_count;
+    std::size_t const last = settings.records_count * (settings.process_idx + 1) / settings.processes_count;
+    std::size_t const threads_count = settings.threads_count;
+
+    std::string value(settings.value_max_length, 'x');
+    auto started = clock_t_::now();
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back([&, thread_idx] {
+            std::mt19937_64 generator(thread_idx);
+            blobs_collection_t collection = db.main();
+            std::vector<ustore_key_t> keys;
+            std::vector<ustore_length_t> lengths;
+            ustore_bytes_ptr_t value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+            for (std::size_t begin = first + thread_idx * batch_size_k; begin < last;
+                 begin += threads_count * batch_size_k) {
+                std::size_t end = std::min(begin + batch_size_k, last);
+                keys.resize(end - begin);
+                lengths.resize(end - begin);
+                std::iota(keys.begin(), keys.end(), static_cast<ustore_key_t>(begin));
+                for (auto& length : lengths)
+                    length = static_cast<ustore_length_t>(
+                        settings.value_min_length +
+                        generator() % (settings.value_max_length - settings.value_min_length + 1));
+
+                contents_arg_t contents {};
+                contents.lengths_begin = {lengths.data(), sizeof(ustore_length_t)};
+                contents.contents_begin = {&value_ptr, 0};
+                contents.count = keys.size();
+                collection[keys].assign(contents).throw_unhandled();
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(clock_t_::now() - started).count();
+    if (settings.json)
+        fmt::print("{{\"process\":{},\"phase\":\"load\",\"records\":{},\"seconds\":{:.3f}}}\n",
+                   settings.process_idx,
+                   last - first,
+                   seconds);
+    else
+        fmt::print("[{}] Loaded {} records in {:.3f} s\n", settings.process_idx, last - first, seconds);
+}
+
+struct report_t {
+    std::array<latency_summary_t, op_kinds_k> latencies;
+    std::array<std::uint64_t, op_kinds_k> errors {};
+
+    void collect(std::vector<thread_stats_t> const& stats) noexcept {
+        for (thread_stats_t const& thread : stats)
+            for (std::size_t i = 0; i != op_kinds_k; ++i) {
+                latencies[i].add(thread.latencies[i]);
+                errors[i] += thread.errors[i].load(std::memory_order_relaxed);
+            }
+    }
+
+    /// @brief Counts of the interval, since the @p previous report.
+    report_t since(report_t const& previous) const noexcept {
+        report_t result = *this;
+        for (std::size_t i = 0; i != op_kinds_k; ++i) {
+            for (std::size_t bucket = 0; bucket != latency_histogram_t::buckets_k; ++bucket)
+                result.latencies[i].counts[bucket] -= previous.latencies[i].counts[bucket];
+            result.latencies[i].count -= previous.latencies[i].count;
+            result.latencies[i].total_ns -= previous.latencies[i].total_ns;
+            result.errors[i] -= previous.errors[i];
+        }
+        return result;
+    }
+
+    void print(char const* phase, double time, double duration) const {
+        std::uint64_t operations = 0;
+        for (auto const& latency : latencies)
+            operations += latency.count;
+        double throughput = duration > 0 ? operations / duration : 0;
+
+        std::string line;
+        if (settings.json)
+            line = fmt::format("{{\"process\":{},\"phase\":\"{}\",\"time_s\":{:.3f},\"ops_per_second\":{:.1f}",
+                               settings.process_idx,
+                               phase,
+                               time,
+                               throughput);
+        else
+            line = fmt::format("[{}] {:>4} {:8.1f} s {:12.1f} ops/s", settings.process_idx, phase, time, throughput);
+
+        for (std::size_t i = 0; i != op_kinds_k; ++i) {
+            latency_summary_t const& latency = latencies[i];
+            if (!latency.count)
+                continue;
+            if (settings.json)
+                line += fmt::format(
+                    ",\"{}\":{{\"count\":{},\"errors\":{},\"p50_ns\":{},\"p99_ns\":{},\"p999_ns\":{}}}",
+                    op_names_k[i],
+                    latency.count,
+                    errors[i],
+                    latency.quantile(0.5),
+                    latency.quantile(0.99),
+                    latency.quantile(0.999));
+            else
+                line += fmt::format(" | {}: {:.1f}/{:.1f}/{:.1f} us",
+                                    op_names_k[i],
+                                    latency.quantile(0.5) / 1e3,
+                                    latency.quantile(0.99) / 1e3,
+                                    latency.quantile(0.999) / 1e3);
+            if (!settings.json && errors[i])
+                line += fmt::format(" ({} errors)", errors[i]);
+        }
+        if (settings.json)
+            line += "}";
+        fmt::print("{}\n", line);
+        std::fflush(stdout);
+    }
+};
+
+static void run(database_t& db) {
+    zipfian_t zipfian(settings.records_count);
+    std::vector<thread_stats_t> stats(settings.threads_count);
+    std::size_t operations_per_thread = settings.operations_count
+                                            ? (settings.operations_count + settings.threads_count - 1) /
+                                                  settings.threads_count
+                                            : std::numeric_limits<std::size_t>::max();
+    double ops_per_second_per_thread =
+        static_cast<double>(settings.target_throughput) / settings.threads_count / settings.processes_count;
+
+    auto started = clock_t_::now();
+    auto deadline = started + std::chrono::seconds(settings.seconds);
+    std::atomic<std::size_t> running_threads {settings.threads_count};
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != settings.threads_count; ++thread_idx)
+        threads.emplace_back([&, thread_idx] {
+            std::size_t seed = settings.process_idx * settings.threads_count + thread_idx + 1;
+            worker_t worker(db, seed, zipfian, stats[thread_idx]);
+            worker.run(deadline, operations_per_thread, ops_per_second_per_thread);
+            running_threads.fetch_sub(1, std::memory_order_release);
+        });
+
+    // Report the percentiles of every interval separately, to see how they change over time
+    report_t previous;
+    auto previous_time = started;
+    auto interval = std::chrono::seconds(settings.report_interval);
+    while (running_threads.load(std::memory_order_acquire)) {
+        auto wakeup = std::min(previous_time + interval, deadline);
+        while (running_threads.load(std::memory_order_acquire) && clock_t_::now() < wakeup)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto now = clock_t_::now();
+        report_t current;
+        current.collect(stats);
+        current.since(previous).print("run",
+                                      std::chrono::duration<double>(now - started).count(),
+                                      std::chrono::duration<double>(now - previous_time).count());
+        previous = current;
+        previous_time = now;
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    report_t total;
+    total.collect(stats);
+    total.print("all", 0, std::chrono::duration<double>(clock_t_::now() - started).count());
+}
+
+static void parse_args(int argc, char* argv[]) {
+    argparse::ArgumentParser program(argv[0]);
+    program.add_argument("-c", "--config").default_value(std::string()).help("Database config or server URL");
+    program.add_argument("-w", "--workload").default_value(std::string("a")).help("YCSB workload from A to F");
+    program.add_argument("--proportions")
+        .default_value(std::string())
+        .help("Custom mix, overriding the workload, like \"read=0.9,update=0.05,insert=0.05\"");
+    program.add_argument("-d", "--distribution")
+        .default_value(std::string())
+        .help("Overrides the keys distribution: uniform, zipfian or latest");
+    program.add_argument("-r", "--records").default_value(std::string("1000000")).help("Initial records count");
+    program.add_argument("-o", "--operations").default_value(std::string("0")).help("Operations limit, if any");
+    program.add_argument("-s", "--seconds").default_value(std::string("60")).help("Duration limit");
+    program.add_argument("-t", "--threads").default_value(std::string("1")).help("Threads per process");
+    program.add_argument("-p", "--processes").default_value(std::string("1")).help("Client processes");
+    program.add_argument("--target").default_value(std::string("0")).help("Total operations per second, if any");
+    program.add_argument("--interval").default_value(std::string("1")).help("Seconds between reports");
+    program.add_argument("--value_min").default_value(std::string("1000")).help("Minimum value length");
+    program.add_argument("--value_max").default_value(std::string("1000")).help("Maximum value length");
+    program.add_argument("--scan_max").default_value(std::string("100")).help("Maximum scan length");
+    program.add_argument("--skip_load").default_value(false).implicit_value(true).help("Only run the workload");
+    program.add_argument("--skip_run").default_value(false).implicit_value(true).help("Only load the records");
+    program.add_argument("--json").default_value(false).implicit_value(true).help("Print reports as NDJSON");
+    program.parse_args(argc, argv);
+
+    auto to_size = [&](char const* name) { return static_cast<std::size_t>(std::stoull(program.get(name))); };
+    settings.config = program.get("config");
+    settings.records_count = to_size("records");
+    settings.operations_count = to_size("operations");
+    settings.seconds = to_size("seconds");
+    settings.threads_count = to_size("threads");
+    settings.processes_count = to_size("processes");
+    settings.target_throughput = to_size("target");
+    settings.report_interval = to_size("interval");
+    settings.value_min_length = to_size("value_min");
+    settings.value_max_length = to_size("value_max");
+    settings.scan_max_length = to_size("scan_max");
+    settings.load = !program.get<bool>("skip_load");
+    settings.run = !program.get<bool>("skip_run");
+    settings.json = program.get<bool>("json");
+
+    auto fail = [](std::string const& message) {
+        fmt::print(stderr, "{}\n", message);
+        std::exit(1);
+    };
+    std::string workload = program.get("workload");
+    if (workload.size() != 1 || !apply_workload(static_cast<char>(std::tolower(workload[0]))))
+        fail("--workload: Expecting a letter from A to F");
+
+    std::string proportions = program.get("proportions");
+    if (!proportions.empty()) {
+        std::fill(std::begin(settings.proportions), std::end(settings.proportions), 0.0);
+        for (std::size_t begin = 0; begin < proportions.size();) {
+            std::size_t end = std::min(proportions.find(',', begin), proportions.size());
+            std::string pair = proportions.substr(begin, end - begin);
+            std::size_t equals = pair.find('=');
+            auto name = std::find(std::begin(op_names_k), std::end(op_names_k), pair.substr(0, equals));
+            if (equals == std::string::npos || name == std::end(op_names_k))
+                fail(fmt::format("--proportions: Unknown operation in \"{}\"", pair));
+            settings.proportions[name - std::begin(op_names_k)] = std::stod(pair.substr(equals + 1));
+            begin = end + 1;
+        }
+    }
+    double sum = std::accumulate(std::begin(settings.proportions), std::end(settings.proportions), 0.0);
+    if (sum <= 0)
+        fail("--proportions: At least one operation must have a positive share");
+    for (double& proportion : settings.proportions)
+        proportion /= sum;
+
+    std::string distribution = program.get("distribution");
+    if (distribution == "uniform")
+        settings.distribution = distribution_t::uniform_k;
+    else if (distribution == "zipfian")
+        settings.distribution = distribution_t::zipfian_k;
+    else if (distribution == "latest")
+        settings.distribution = distribution_t::latest_k;
+    else if (!distribution.empty())
+        fail("--distribution: Expecting uniform, zipfian or latest");
+
+    if (!settings.records_count || !settings.threads_count || !settings.processes_count || !settings.report_interval)
+        fail("--records, --threads, --processes and --interval must be positive");
+    if (settings.value_min_length > settings.value_max_length || !settings.scan_max_length)
+        fail("--value_min can't exceed --value_max, and --scan_max must be positive");
+#if !defined(USTORE_FLIGHT_CLIENT)
+    if (settings.processes_count > 1)
+        fail("--processes: Embedded engines can't be shared between processes, use the Flight client");
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    // Fork the other clients before opening any connections
+    for (std::size_t process_idx = 1; process_idx != settings.processes_count; ++process_idx) {
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            fmt::print(stderr, "Failed to start process #{}\n", process_idx);
+            return 1;
+        }
+        if (pid == 0) {
+            settings.process_idx = process_idx;
+            break;
+        }
+    }
+
+    database_t db;
+    db.open(settings.config.empty() ? nullptr : settings.config.c_str()).throw_unhandled();
+    if (settings.load)
+        load(db);
+    if (settings.run)
+        run(db);
+    db.close();
+
+    // The first process waits for the others
+    if (settings.process_idx == 0)
+        while (::wait(nullptr) > 0)
+            ;
+    return 0;
+}
@@ -42,6 +42,8 @@ ExternalProject_Add(
     -DARROW_COMPUTE=ON
     -DARROW_FLIGHT=ON
     -DARROW_WITH_UTF8PROC=ON
+    -DARROW_WITH_LZ4=ON
+    -DARROW_WITH_ZSTD=ON
 
     -DPARQUET_REQUIRE_ENCRYPTION=OFF
     -DARROW_CUDA=OFF
@@ -70,6 +72,8 @@ ExternalProject_Add(
     -DZLIB_SOURCE=BUNDLED
     -DThrift_SOURCE=BUNDLED
     -Dutf8proc_SOURCE=BUNDLED
+    -Dlz4_SOURCE=BUNDLED
+    -Dzstd_SOURCE=BUNDLED
 )
 
 ExternalProject_Get_Property(Arrow-external SOURCE_DIR)
@@ -0,0 +1,33 @@
+# ZStandard Compression with shared dictionaries for small documents
+# https://facebook.github.io/zstd/#small-data
+
+include(ExternalProject)
+find_package(Git REQUIRED)
+find_program(MAKE_EXE NAMES gmake nmake make)
+
+# Get zstd
+ExternalProject_Add(
+    zstd_src
+    PREFIX "_deps/zstd"
+    GIT_REPOSITORY https://github.com/facebook/zstd.git
+    GIT_TAG v1.5.5
+    TIMEOUT 10
+    CONFIGURE_COMMAND ""
+    BUILD_IN_SOURCE TRUE
+    BUILD_COMMAND make -C lib libzstd.a "CFLAGS=-O3 -fPIC"
+    UPDATE_COMMAND ""
+    INSTALL_COMMAND ""
+)
+
+# Prepare zstd
+ExternalProject_Get_Property(zstd_src source_dir)
+set(zstd_INCLUDE_DIR ${source_dir}/lib)
+set(zstd_LIBRARY_PATH ${source_dir}/lib/libzstd.a)
+file(MAKE_DIRECTORY ${zstd_INCLUDE_DIR})
+add_library(zstd STATIC IMPORTED)
+
+set_property(TARGET zstd PROPERTY IMPORTED_LOCATION ${zstd_LIBRARY_PATH})
+set_property(TARGET zstd APPEND PROPERTY INTERFACE_INCLUDE_DIRECTORIES ${zstd_INCLUDE_DIR})
+
+# Dependencies
+add_dependencies(zstd zstd_src)
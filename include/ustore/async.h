@@ -0,0 +1,144 @@
+/**
+ * @file async.h
+ * @author Ashot Vardanian
+ * @date 14 Oct 2026
+ * @addtogroup C
+ *
+ * @brief Binary Interface Standard for @b asynchronous submission of BLOB operations.
+ *
+ * Every call of `ustore_read()`, `ustore_write()`, `ustore_scan()` or `ustore_sample()`
+ * blocks the calling thread until the answer arrives. For remote databases that means
+ * one request in flight per thread. Submitting them with `ustore_submit()` instead,
+ * a single thread can have many independent requests running at once, over the same
+ * connection, and collect the results later with `ustore_future_wait()`.
+ *
+ * ## Ownership
+ *
+ * Same rules as for the synchronous calls apply, but for longer:
+ *
+ * - The task structure and every input it references must stay alive and unchanged
+ *   until the operation completes.
+ * - Outputs are written through the task structure, into its `arena`, on completion.
+ * - Every outstanding operation needs its own `arena`, as arenas aren't thread-safe.
+ * - Errors of the operation itself are reported through the `error` of the task.
+ *
+ * Embedded engines have no network latency to hide, so they may complete the
+ * operation before `ustore_submit()` returns.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ustore/blobs.h"
+
+/*********************************************************/
+/*****************   Structures & Consts  ****************/
+/*********************************************************/
+
+/**
+ * @brief Opaque handle of a submitted operation.
+ * @see `ustore_future_wait()`, `ustore_future_free()`.
+ */
+typedef void* ustore_future_t;
+
+/**
+ * @brief Completion handler of a submitted operation.
+ * May be called from a background thread, and must not free the future.
+ */
+typedef void (*ustore_callback_t)(void* context);
+
+/*********************************************************/
+/*****************	 Primary Functions	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Schedules one of the BLOB operations for execution in the background.
+ * @see `ustore_submit()`.
+ */
+typedef struct ustore_submit_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /**
+     * @brief Pointer to exported error message, if the operation couldn't be submitted.
+     * Errors of the operation are exported into the `error` of the task itself.
+     */
+    ustore_error_t* error;
+
+    /// @}
+    /// @name Task
+    /// @{
+
+    /**
+     * @brief The operation to submit. Exactly one of these must be set.
+     * Must stay alive, until the operation completes.
+     */
+    ustore_read_t* read;
+    ustore_write_t* write;
+    ustore_scan_t* scan;
+    ustore_sample_t* sample;
+
+    /**
+     * @brief Optional function to call, once the operation completes,
+     * before the future becomes ready.
+     */
+    ustore_callback_t callback;
+    /** @brief The argument passed into the `callback`. */
+    void* callback_context;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /**
+     * @brief Output handle to wait for.
+     * Must be released with `ustore_future_free()`.
+     */
+    ustore_future_t* future;
+
+    /// @}
+
+} ustore_submit_t;
+
+/**
+ * @brief Schedules one of the BLOB operations for execution in the background.
+ * @see `ustore_submit_t`.
+ */
+void ustore_submit(ustore_submit_t*);
+
+/**
+ * @brief Checks if a submitted operation has completed, optionally waiting for it.
+ * @see `ustore_future_wait()`.
+ */
+typedef struct ustore_future_wait_t {
+
+    /** @brief The handle exported by `ustore_submit()`. */
+    ustore_future_t future;
+    /** @brief Blocks until the operation completes, if true. Otherwise, only checks its state. */
+    bool blocking;
+    /** @brief Output completion state. Is @b optional for blocking waits. */
+    bool* done;
+
+} ustore_future_wait_t;
+
+/**
+ * @brief Checks if a submitted operation has completed, optionally waiting for it.
+ * @see `ustore_future_wait_t`.
+ */
+void ustore_future_wait(ustore_future_wait_t*);
+
+/**
+ * @brief Waits for the operation to complete, if it hasn't yet, and releases the handle.
+ * Passing NULL is safe.
+ */
+void ustore_future_free(ustore_future_t);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
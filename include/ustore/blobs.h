@@ -113,6 +113,8 @@ typedef struct ustore_write_t {
      *
      * Possible values:
      * - `::ustore_option_write_flush_k`: Forces to persist non-transactional writes on disk before returning.
+     * - `::ustore_option_write_adopt_k`: Transfers the ownership of `malloc`-ed values to the engine, if supported.
+     * - `::ustore_option_write_bulk_k`: Loads big non-transactional batches directly into persistent storage.
      * - `::ustore_option_transaction_dont_watch_k`: Disables collision-detection for transactional writes.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
      */
@@ -285,7 +287,10 @@ typedef struct ustore_read_t {
      * - `::ustore_option_transaction_dont_watch_k`: Disables collision-detection for transactional reads.
      * - `::ustore_option_read_shared_memory_k`: Exports to shared memory to accelerate inter-process communication.
      * - `::ustore_option_scan_bulk_k`: Suggests that the list of keys was received from a bulk scan.
+     * - `::ustore_option_read_bypass_cache_k`: Fetches the values from the server, skipping the client cache.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
+     * - `::ustore_option_arena_numa_local_k`, `::ustore_option_arena_huge_pages_k`,
+     *   `::ustore_option_arena_giant_pages_k`, `::ustore_option_arena_unified_k`: Choose the memory of the `arena`.
      */
     ustore_options_t options;
 
@@ -398,8 +403,8 @@ void ustore_read(ustore_read_t*);
  *
  * Retrieves the following (upto) `count_limits[i]` keys starting
  * from `start_key[i]` or the smallest following key in each collection.
- * Values are not exported, for that - follow up with a `ustore_read()` or
- * a higher-level interface for Graphs, Docs or other modalities.
+ * Values are only exported, if `values` are requested, in the same pass over the collection.
+ * Otherwise, follow up with a `ustore_read()` or a higher-level interface for Graphs, Docs or other modalities.
  *
  * ## Scans vs Iterators
  *
@@ -444,6 +449,8 @@ typedef struct ustore_scan_t {
      * - `::ustore_option_transaction_dont_watch_k`: Disables collision-detection for transactional reads.
      * - `::ustore_option_read_shared_memory_k`: Exports to shared memory to accelerate inter-process communication.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
+     * - `::ustore_option_arena_numa_local_k`, `::ustore_option_arena_huge_pages_k`,
+     *   `::ustore_option_arena_giant_pages_k`, `::ustore_option_arena_unified_k`: Choose the memory of the `arena`.
      */
     ustore_options_t options;
 
@@ -539,6 +546,22 @@ typedef struct ustore_scan_t {
      * runtime- or library-specific implementations.
      */
     ustore_key_t** keys;
+    /**
+     * @brief Output offsets of the values of all the found keys.
+     *
+     * Will contain a pointer to an array of one more offset, than the total number
+     * of found keys, with the `i`-th value of the `keys` tape spanning
+     * from `values_offsets[i]` to `values_offsets[i + 1]` bytes within `*values`.
+     * Is @b optional and is only exported together with `values`.
+     */
+    ustore_length_t** values_offsets;
+    /**
+     * @brief Output tape of the values of all the found keys.
+     *
+     * Is @b optional. If passed, the values are fetched in the same pass, as the keys,
+     * instead of a follow-up `ustore_read()` with a lookup per key.
+     */
+    ustore_byte_t** values;
     /// @}
 
 } ustore_scan_t;
@@ -588,6 +611,7 @@ typedef struct ustore_sample_t {
      * - `::ustore_option_transaction_dont_watch_k`: Disables collision-detection for transactional reads.
      * - `::ustore_option_read_shared_memory_k`: Exports to shared memory to accelerate inter-process communication.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
+     * - `::ustore_option_sample_approximate_k`: Seeks to random points of the keys range, if supported.
      */
     ustore_options_t options;
 
@@ -783,11 +807,28 @@ typedef struct ustore_measure_t {
     /// @name Outputs
     /// @{
 
+    /**
+     * @brief Output lower estimates of the number of entries in each range.
+     *
+     * Will contain a pointer to an array of `tasks_count` integers.
+     * Engines, that can't count the entries exactly, export their best estimate here,
+     * so it's the number to compare against the cost of point reads.
+     * Is @b optional.
+     */
     ustore_size_t** min_cardinalities;
+    /**
+     * @brief Output upper bounds of the number of entries in each range.
+     * Equal to `min_cardinalities` for engines, that count exactly.
+     * Is @b optional.
+     */
     ustore_size_t** max_cardinalities;
+    /** @brief Output lower estimates of the total length of values in each range. Is @b optional. */
     ustore_size_t** min_value_bytes;
+    /** @brief Output upper bounds of the total length of values in each range. Is @b optional. */
     ustore_size_t** max_value_bytes;
+    /** @brief Output lower estimates of the memory or disk space used by each range. Is @b optional. */
     ustore_size_t** min_space_usages;
+    /** @brief Output upper bounds of the memory or disk space used by each range. Is @b optional. */
     ustore_size_t** max_space_usages;
 
     /// @}
@@ -800,6 +841,82 @@ typedef struct ustore_measure_t {
  */
 void ustore_measure(ustore_measure_t*);
 
+/**
+ * @brief Removes all the keys in one or more `[start_key, end_key)` ranges.
+ * @see `ustore_erase_ranges()`.
+ *
+ * Unlike writing missing values for every key, the engines do it without
+ * enumerating the keys on the client side, and some - without visiting them at all.
+ * Erasures aren't transactional, but are atomic within every single range.
+ */
+typedef struct ustore_erase_ranges_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /**
+     * @brief Pointer to exported error message.
+     * If not NULL, must be deallocated with `ustore_error_free()`.
+     */
+    ustore_error_t* error;
+    /**
+     * @brief Erasure options.
+     *
+     * Possible values:
+     * - `::ustore_option_write_flush_k`: Forces the erasure to be persisted before the function returns.
+     */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /**
+     * @brief Number of separate ranges to erase.
+     * Always equal to the number of provided `start_keys`.
+     */
+    ustore_size_t tasks_count;
+    /**
+     * @brief Sequence of collections owning the ranges.
+     *
+     * If `NULL` is passed, the default collection is assumed.
+     * If multiple collections are passed, the step between them is defined by `collections_stride`.
+     * Is @b optional.
+     */
+    ustore_collection_t const* collections;
+    /**
+     * @brief Step between `collections`.
+     * Zero stride would reuse the same address for all tasks.
+     * Is @b optional.
+     */
+    ustore_size_t collections_stride;
+    /**
+     * @brief Smallest keys to erase in every range.
+     * If multiple ranges are passed, the step between them is defined by `start_keys_stride`.
+     */
+    ustore_key_t const* start_keys;
+    /** @brief Step between `start_keys`. Is @b optional. */
+    ustore_size_t start_keys_stride;
+    /**
+     * @brief Keys, following the last erased key of every range. Those aren't erased.
+     * Ranges, where `end_key <= start_key`, are empty.
+     */
+    ustore_key_t const* end_keys;
+    /** @brief Step between `end_keys`. Is @b optional. */
+    ustore_size_t end_keys_stride;
+
+    /// @}
+
+} ustore_erase_ranges_t;
+
+/**
+ * @brief Removes all the keys in one or more `[start_key, end_key)` ranges.
+ * @see `ustore_erase_ranges_t`.
+ */
+void ustore_erase_ranges(ustore_erase_ranges_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
@@ -137,6 +137,24 @@ class blobs_collection_t {
         return status;
     }
 
+    /**
+     * @brief Removes all the keys in `[min_key, max_key)`, without enumerating them.
+     * Isn't affected by the transaction this collection is bound to.
+     */
+    status_t erase(ustore_key_t min_key, ustore_key_t max_key, bool flush = false) noexcept {
+        status_t status;
+        ustore_erase_ranges_t erase {};
+        erase.db = db_;
+        erase.error = status.member_ptr();
+        erase.options = flush ? ustore_option_write_flush_k : ustore_options_default_k;
+        erase.tasks_count = 1;
+        erase.collections = &collection_;
+        erase.start_keys = &min_key;
+        erase.end_keys = &max_key;
+        ustore_erase_ranges(&erase);
+        return status;
+    }
+
     status_t drop() noexcept {
         status_t status;
         ustore_collection_drop_t collection_drop {};
@@ -8,30 +8,520 @@
  */
 
 #pragma once
+#include <vector>  // `std::vector`
+#include <thread>  // `std::thread`
+#include <mutex>   // `std::mutex`
+#include <numeric> // `std::iota`
+
 #include "ustore/ustore.h"
-#include "ustore/cpp/ranges.hpp"
+#include "ustore/cpp/types.hpp"  // `arena_t`
+#include "ustore/cpp/status.hpp" // `status_t`
+#include "ustore/cpp/ranges.hpp" // `ptr_range_gt`
 
 namespace unum::ustore {
 
+class keys_join_stream_t;
+class keys_join_t;
+
+/**
+ * @brief Exponential search for the first key, that isn't smaller than @p key.
+ * Cheaper than `std::lower_bound`, when the answer is close to the @p begin,
+ * as it is for the majority of steps in a merge of similarly sized lists.
+ */
+inline ustore_key_t const* gallop_lower_bound(ustore_key_t const* begin,
+                                              ustore_key_t const* end,
+                                              ustore_key_t key) noexcept {
+    std::size_t step = 1;
+    std::size_t remaining = static_cast<std::size_t>(end - begin);
+    while (step < remaining && begin[step] < key) {
+        begin += step;
+        remaining -= step;
+        step <<= 1;
+    }
+    return std::lower_bound(begin, begin + std::min(step + 1, remaining), key);
+}
+
 /**
  * @brief Implements multi-way set intersection to join entities
  * from different collections, that have matching identifiers.
  *
  * Implementation-wise, scans the smallest collection and batch-selects
- * in others.
+ * in others. Collections are ordered by their estimated cardinality in the
+ * requested range, so that the candidates list shrinks as fast as possible.
+ * Collections of similar size are intersected with a galloping merge over
+ * their scanned keys, while much larger ones are probed with a single
+ * presence-only read per batch.
+ *
+ * ## Class Specs
+ * - Concurrency: Must be used from a single thread!
+ * - Lifetime: @b Must live shorter then the collections it joins.
+ * - Copyable: No.
+ * - Exceptions: Never.
+ */
+class keys_join_stream_t {
+
+    ustore_database_t db_ {nullptr};
+    ustore_transaction_t txn_ {nullptr};
+    ustore_snapshot_t snap_ {0};
+
+    arena_t arena_ {nullptr};
+    ustore_length_t read_ahead_ {0};
+
+    /// @brief Joined collections, ordered by ascending estimated cardinality.
+    std::vector<ustore_collection_t> collections_;
+    std::vector<ustore_size_t> cardinalities_;
+    bool ordered_ {false};
+
+    ustore_key_t next_min_key_ {std::numeric_limits<ustore_key_t>::min()};
+    ustore_key_t max_key_ {std::numeric_limits<ustore_key_t>::max()};
+    std::vector<ustore_key_t> fetched_keys_;
+    std::size_t fetched_offset_ {0};
+
+    status_t order() noexcept {
+
+        auto count = static_cast<ustore_size_t>(collections_.size());
+        ustore_size_t* max_cardinalities = nullptr;
+        status_t status;
+        ustore_measure_t measure {};
+        measure.db = db_;
+        measure.error = status.member_ptr();
+        measure.transaction = txn_;
+        measure.snapshot = snap_;
+        measure.arena = arena_.member_ptr();
+        measure.tasks_count = count;
+        measure.collections = collections_.data();
+        measure.collections_stride = sizeof(ustore_collection_t);
+        measure.start_keys = &next_min_key_;
+        measure.end_keys = &max_key_;
+        measure.max_cardinalities = &max_cardinalities;
+
+        ustore_measure(&measure);
+        if (!status)
+            return status;
+
+        try {
+            std::vector<std::size_t> order(count);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+                return max_cardinalities[a] < max_cardinalities[b];
+            });
+            std::vector<ustore_collection_t> collections(count);
+            cardinalities_.resize(count);
+            for (std::size_t i = 0; i != count; ++i) {
+                collections[i] = collections_[order[i]];
+                cardinalities_[i] = max_cardinalities[order[i]];
+            }
+            collections_ = std::move(collections);
+        }
+        catch (...) {
+            return status_t::status_view("Failed to allocate memory!");
+        }
+        ordered_ = true;
+        return {};
+    }
+
+    /**
+     * @brief Keeps only those `fetched_keys_`, that are present in the collection,
+     * checking them all at once with a read, that exports no values.
+     */
+    status_t probe(ustore_collection_t collection) noexcept {
+
+        ustore_octet_t* found_presences = nullptr;
+        status_t status;
+        ustore_read_t read {};
+        read.db = db_;
+        read.error = status.member_ptr();
+        read.transaction = txn_;
+        read.snapshot = snap_;
+        read.arena = arena_.member_ptr();
+        read.tasks_count = static_cast<ustore_size_t>(fetched_keys_.size());
+        read.collections = &collection;
+        read.keys = fetched_keys_.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.presences = &found_presences;
+
+        ustore_read(&read);
+        if (!status)
+            return status;
+
+        bits_view_t presences {found_presences};
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i != fetched_keys_.size(); ++i)
+            if (presences[i])
+                fetched_keys_[kept++] = fetched_keys_[i];
+        fetched_keys_.resize(kept);
+        return {};
+    }
+
+    /**
+     * @brief Keeps only those `fetched_keys_`, that are present in the collection,
+     * scanning it over the same range and galloping through both sorted lists.
+     */
+    status_t merge(ustore_collection_t collection) noexcept {
+
+        ustore_key_t const* candidates = fetched_keys_.data();
+        ustore_key_t const* candidates_end = candidates + fetched_keys_.size();
+        ustore_key_t* kept = fetched_keys_.data();
+        ustore_key_t start_key = *candidates;
+
+        while (candidates != candidates_end) {
+            ustore_length_t* found_counts = nullptr;
+            ustore_key_t* found_keys = nullptr;
+            status_t status;
+            ustore_scan_t scan {};
+            scan.db = db_;
+            scan.error = status.member_ptr();
+            scan.transaction = txn_;
+            scan.snapshot = snap_;
+            scan.arena = arena_.member_ptr();
+            scan.tasks_count = 1;
+            scan.collections = &collection;
+            scan.start_keys = &start_key;
+            scan.count_limits = &read_ahead_;
+            scan.counts = &found_counts;
+            scan.keys = &found_keys;
+
+            ustore_scan(&scan);
+            if (!status)
+                return status;
+
+            ustore_key_t const* others = found_keys;
+            ustore_key_t const* others_end = found_keys + *found_counts;
+            while (candidates != candidates_end && others != others_end) {
+                if (*candidates < *others)
+                    candidates = gallop_lower_bound(candidates, candidates_end, *others);
+                else if (*others < *candidates)
+                    others = gallop_lower_bound(others, others_end, *candidates);
+                else
+                    *kept++ = *candidates++, ++others;
+            }
+
+            bool is_last_page = *found_counts < read_ahead_;
+            if (is_last_page || candidates == candidates_end)
+                break;
+            start_key = others_end[-1] + 1;
+        }
+
+        fetched_keys_.resize(static_cast<std::size_t>(kept - fetched_keys_.data()));
+        return {};
+    }
+
+    status_t prefetch() noexcept {
+
+        fetched_keys_.clear();
+        fetched_offset_ = 0;
+        if (!ordered_ && next_min_key_ != ustore_key_unknown_k)
+            if (status_t status = order(); !status)
+                return status;
+
+        // Keep scanning the smallest collection, until some keys are present in all the others
+        while (fetched_keys_.empty() && next_min_key_ != ustore_key_unknown_k) {
+            ustore_length_t* found_counts = nullptr;
+            ustore_key_t* found_keys = nullptr;
+            status_t status;
+            ustore_scan_t scan {};
+            scan.db = db_;
+            scan.error = status.member_ptr();
+            scan.transaction = txn_;
+            scan.snapshot = snap_;
+            scan.arena = arena_.member_ptr();
+            scan.tasks_count = 1;
+            scan.collections = collections_.data();
+            scan.start_keys = &next_min_key_;
+            scan.count_limits = &read_ahead_;
+            scan.counts = &found_counts;
+            scan.keys = &found_keys;
+
+            ustore_scan(&scan);
+            if (!status)
+                return status;
+
+            ustore_key_t* found_end = std::lower_bound(found_keys, found_keys + *found_counts, max_key_);
+            bool is_last_page = *found_counts < read_ahead_ || found_end != found_keys + *found_counts;
+            next_min_key_ = is_last_page ? ustore_key_unknown_k : found_end[-1] + 1;
+
+            try {
+                fetched_keys_.assign(found_keys, found_end);
+            }
+            catch (...) {
+                return status_t::status_view("Failed to allocate memory!");
+            }
+
+            // Similarly sized collections are cheaper to scan, than to probe key-by-key
+            for (std::size_t i = 1; i != collections_.size() && !fetched_keys_.empty(); ++i) {
+                bool is_similar = cardinalities_[i] <= cardinalities_[0] * merge_cardinality_ratio_k;
+                status = is_similar ? merge(collections_[i]) : probe(collections_[i]);
+                if (!status)
+                    return status;
+            }
+        }
+        return {};
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = ustore_key_t;
+    using pointer = ustore_key_t*;
+    using reference = ustore_key_t&;
+
+    static constexpr std::size_t default_read_ahead_k = 256;
+    static constexpr std::size_t merge_cardinality_ratio_k = 4;
+
+    /**
+     * @param collections Collections to join. Their order doesn't matter.
+     * @param min_key     Inclusive lower bound of the joined keys.
+     * @param max_key     Exclusive upper bound of the joined keys.
+     */
+    keys_join_stream_t(ustore_database_t db,
+                       std::vector<ustore_collection_t> collections,
+                       std::size_t read_ahead = keys_join_stream_t::default_read_ahead_k,
+                       ustore_transaction_t txn = nullptr,
+                       ustore_snapshot_t snap = 0,
+                       ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min(),
+                       ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max()) noexcept
+        : db_(db), txn_(txn), snap_(snap), arena_(db), read_ahead_(static_cast<ustore_length_t>(std::max<std::size_t>(read_ahead, 1))),
+          collections_(std::move(collections)), next_min_key_(min_key), max_key_(max_key) {}
+
+    keys_join_stream_t(keys_join_stream_t&&) = default;
+    keys_join_stream_t& operator=(keys_join_stream_t&&) = default;
+
+    keys_join_stream_t(keys_join_stream_t const&) = delete;
+    keys_join_stream_t& operator=(keys_join_stream_t const&) = delete;
+
+    status_t seek(ustore_key_t key) noexcept {
+        next_min_key_ = key;
+        if (collections_.empty() || key >= max_key_)
+            next_min_key_ = ustore_key_unknown_k;
+        return prefetch();
+    }
+
+    status_t advance() noexcept {
+
+        if (fetched_offset_ + 1 >= fetched_keys_.size())
+            return prefetch();
+
+        ++fetched_offset_;
+        return {};
+    }
+
+    /**
+     * ! Unlike the `advance()`, canonically returns a self-reference,
+     * ! meaning that the error must be propagated in a different way.
+     * ! So we promote this iterator to `end()`, once an error occurs.
+     */
+    keys_join_stream_t& operator++() noexcept {
+        status_t status = advance();
+        if (status)
+            return *this;
+
+        fetched_keys_.clear();
+        fetched_offset_ = 0;
+        next_min_key_ = ustore_key_unknown_k;
+        return *this;
+    }
+
+    ustore_key_t key() const noexcept { return fetched_keys_[fetched_offset_]; }
+    ustore_key_t operator*() const noexcept { return key(); }
+    status_t seek_to_first() noexcept { return seek(std::numeric_limits<ustore_key_t>::min()); }
+    status_t seek_to_next_batch() noexcept { return prefetch(); }
+
+    /**
+     * @brief Exposes all the joined keys of the current batch at once.
+     * Should be used with `seek_to_next_batch`. Next `advance` will do the same.
+     */
+    ptr_range_gt<ustore_key_t const> keys_batch() noexcept {
+        fetched_offset_ = fetched_keys_.size();
+        return {fetched_keys_.data(), fetched_keys_.data() + fetched_keys_.size()};
+    }
+
+    bool is_end() const noexcept {
+        return next_min_key_ == ustore_key_unknown_k && fetched_offset_ >= fetched_keys_.size();
+    }
+};
+
+/**
+ * @brief Keys present in all of the given collections within a range.
+ * Can be consumed with a single `keys_join_stream_t`, or split into
+ * partitions of similar size, joined concurrently.
+ *
+ * ## Class Specs
+ * - Concurrency: Thread-safe, unless a transaction is passed.
+ * - Lifetime: @b Must live shorter then the collections it joins.
+ * - Copyable: Yes.
+ * - Exceptions: Only on allocations in the constructor.
  */
-struct keys_join_stream_t {
+class keys_join_t {
+
+    ustore_database_t db_;
+    ustore_transaction_t txn_;
+    ustore_snapshot_t snap_;
+    std::vector<ustore_collection_t> collections_;
+    ustore_key_t min_key_;
+    ustore_key_t max_key_;
+
+  public:
+    static constexpr std::size_t samples_per_partition_k = 64;
+
+    keys_join_t(ustore_database_t db,
+                ptr_range_gt<ustore_collection_t const> collections,
+                ustore_transaction_t txn = nullptr,
+                ustore_snapshot_t snap = 0,
+                ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min(),
+                ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max()) noexcept(false)
+        : db_(db), txn_(txn), snap_(snap), collections_(collections.begin(), collections.end()), min_key_(min_key),
+          max_key_(max_key) {}
+
+    expected_gt<keys_join_stream_t> keys_begin(
+        std::size_t read_ahead = keys_join_stream_t::default_read_ahead_k) noexcept {
+        try {
+            keys_join_stream_t stream {db_, collections_, read_ahead, txn_, snap_, min_key_, max_key_};
+            status_t status = stream.seek(min_key_);
+            return {std::move(status), std::move(stream)};
+        }
+        catch (...) {
+            return {status_t::status_view("Failed to allocate memory!"), keys_join_stream_t {db_, {}}};
+        }
+    }
+
+    /**
+     * @brief Splits the range into at most @p count partitions by sampling the
+     * keys of the smallest collection, as only those can appear in the join.
+     * @return Sorted boundaries, where the i-th partition spans `[bounds[i], bounds[i + 1])`.
+     */
+    expected_gt<std::vector<ustore_key_t>> split(std::size_t count) noexcept {
+
+        if (collections_.empty() || count <= 1)
+            return std::vector<ustore_key_t> {min_key_, max_key_};
+
+        arena_t arena(db_);
+        status_t status;
+        auto collections_count = static_cast<ustore_size_t>(collections_.size());
+        ustore_size_t* max_cardinalities = nullptr;
+        ustore_measure_t measure {};
+        measure.db = db_;
+        measure.error = status.member_ptr();
+        measure.transaction = txn_;
+        measure.snapshot = snap_;
+        measure.arena = arena.member_ptr();
+        measure.tasks_count = collections_count;
+        measure.collections = collections_.data();
+        measure.collections_stride = sizeof(ustore_collection_t);
+        measure.start_keys = &min_key_;
+        measure.end_keys = &max_key_;
+        measure.max_cardinalities = &max_cardinalities;
+        ustore_measure(&measure);
+        if (!status)
+            return status;
+
+        auto smallest = std::min_element(max_cardinalities, max_cardinalities + collections_count) - max_cardinalities;
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        auto samples_count = static_cast<ustore_length_t>(count * samples_per_partition_k);
+        ustore_sample_t sample {};
+        sample.db = db_;
+        sample.error = status.member_ptr();
+        sample.transaction = txn_;
+        sample.snapshot = snap_;
+        sample.arena = arena.member_ptr();
+        sample.tasks_count = 1;
+        sample.collections = &collections_[smallest];
+        sample.count_limits = &samples_count;
+        sample.counts = &found_counts;
+        sample.keys = &found_keys;
+        ustore_sample(&sample);
+        if (!status)
+            return status;
+
+        ustore_key_t* samples_end = std::remove_if(found_keys, found_keys + *found_counts, [&](ustore_key_t key) {
+            return key <= min_key_ || key >= max_key_;
+        });
+        std::sort(found_keys, samples_end);
+        samples_end = std::unique(found_keys, samples_end);
+        std::size_t unique_samples = static_cast<std::size_t>(samples_end - found_keys);
+
+        try {
+            std::vector<ustore_key_t> bounds {min_key_};
+            for (std::size_t i = 1; i < count; ++i) {
+                ustore_key_t bound = found_keys[i * unique_samples / count];
+                if (unique_samples && bound > bounds.back())
+                    bounds.push_back(bound);
+            }
+            bounds.push_back(max_key_);
+            return bounds;
+        }
+        catch (...) {
+            return status_t::status_view("Failed to allocate memory!");
+        }
+    }
+
+    /**
+     * @brief Joins @p threads_count partitions concurrently, passing every
+     * non-empty batch of joined keys into the @p callback, potentially from
+     * different threads at once. Stops at the first error.
+     */
+    template <typename callback_at>
+    status_t for_each_batch(callback_at&& callback,
+                            std::size_t threads_count = std::thread::hardware_concurrency(),
+                            std::size_t read_ahead = keys_join_stream_t::default_read_ahead_k) noexcept {
+
+        auto maybe_bounds = split(std::max<std::size_t>(threads_count, 1));
+        if (!maybe_bounds)
+            return maybe_bounds.release_status();
+        std::vector<ustore_key_t> const& bounds = *maybe_bounds;
+
+        std::mutex error_mutex;
+        status_t first_error;
+        auto report = [&](status_t&& status) noexcept {
+            std::lock_guard<std::mutex> lock {error_mutex};
+            if (first_error)
+                first_error = std::move(status);
+        };
+        auto join_partition = [&](std::size_t i) noexcept {
+            std::vector<ustore_collection_t> collections;
+            try {
+                collections = collections_;
+            }
+            catch (...) {
+                return report(status_t::status_view("Failed to allocate memory!"));
+            }
+            keys_join_stream_t stream {db_, std::move(collections), read_ahead, txn_, snap_, bounds[i], bounds[i + 1]};
+            status_t status = stream.seek(bounds[i]);
+            for (; status && !stream.is_end(); status = stream.seek_to_next_batch())
+                if (auto batch = stream.keys_batch(); batch.size())
+                    callback(batch);
+            if (!status)
+                report(std::move(status));
+        };
 
-    ustore_database_t db {nullptr};
-    ustore_transaction_t txn {nullptr};
-    ustore_arena_t* arena {nullptr};
+        // The calling thread joins the first partition, others get a dedicated thread each
+        std::size_t partitions_count = bounds.size() - 1;
+        std::vector<std::thread> threads;
+        try {
+            threads.reserve(partitions_count - 1);
+            for (std::size_t i = 1; i < partitions_count; ++i)
+                threads.emplace_back(join_partition, i);
+        }
+        catch (...) {
+            report(status_t::status_view("Failed to spawn threads!"));
+        }
+        join_partition(0);
+        for (auto& thread : threads)
+            thread.join();
+        return first_error;
+    }
 
-    strided_range_gt<ustore_collection_t const> collections;
-    ustore_key_t next_min_key_ {0};
-    ustore_size_t window_size_ {0};
+    keys_join_t& since(ustore_key_t min_key) noexcept {
+        min_key_ = min_key;
+        return *this;
+    }
+    keys_join_t& until(ustore_key_t max_key) noexcept {
+        max_key_ = max_key;
+        return *this;
+    }
 
-    strided_range_gt<ustore_key_t*> fetched_keys_;
-    strided_range_gt<ustore_length_t> fetched_lengths;
+    ustore_key_t min_key() noexcept { return min_key_; }
+    ustore_key_t max_key() noexcept { return max_key_; }
 };
 
 } // namespace unum::ustore
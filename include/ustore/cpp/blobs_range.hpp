@@ -8,8 +8,11 @@
  */
 
 #pragma once
+#include <memory> // `std::unique_ptr`
+
 #include "ustore/ustore.h"
-#include "ustore/cpp/ranges.hpp" // `indexed_range_gt`
+#include "ustore/cpp/ranges.hpp"           // `indexed_range_gt`
+#include "ustore/cpp/windows_prefetch.hpp" // `windows_prefetch_gt`
 
 namespace unum::ustore {
 
@@ -28,6 +31,9 @@ struct size_estimates_t;
  * Unlike classical iterators, keeps an internal state,
  * which makes it @b non copy-constructible!
  *
+ * After `fetch_in_background()`, the following windows of keys are scanned
+ * by a separate thread, while the current one is being processed.
+ *
  * ## Class Specs
  * - Concurrency: Must be used from a single thread!
  * - Lifetime: @b Must live shorter then the collection it belongs to.
@@ -39,6 +45,7 @@ class keys_stream_t {
     ustore_database_t db_ {nullptr};
     ustore_collection_t collection_ {ustore_collection_main_k};
     ustore_transaction_t txn_ {nullptr};
+    ustore_snapshot_t snap_ {0};
 
     arena_t arena_ {nullptr};
     ustore_length_t read_ahead_ {0};
@@ -47,26 +54,34 @@ class keys_stream_t {
     ptr_range_gt<ustore_key_t> fetched_keys_ {};
     std::size_t fetched_offset_ {0};
 
-    status_t prefetch() noexcept {
+    using background_t = windows_prefetch_gt<ptr_range_gt<ustore_key_t>>;
+    std::unique_ptr<background_t> background_;
 
-        if (next_min_key_ == ustore_key_unknown_k) {
-            ++fetched_offset_;
-            return {};
-        }
+    static status_t fetch( //
+        ustore_database_t db,
+        ustore_collection_t collection,
+        ustore_transaction_t txn,
+        ustore_snapshot_t snap,
+        ustore_length_t read_ahead,
+        ustore_key_t start_key,
+        arena_t& arena,
+        ptr_range_gt<ustore_key_t>& keys,
+        ustore_key_t& next_key) noexcept {
 
         ustore_length_t* found_counts = nullptr;
         ustore_key_t* found_keys = nullptr;
 
         status_t status;
         ustore_scan_t scan {};
-        scan.db = db_;
+        scan.db = db;
         scan.error = status.member_ptr();
-        scan.transaction = txn_;
-        scan.arena = arena_.member_ptr();
+        scan.transaction = txn;
+        scan.snapshot = snap;
+        scan.arena = arena.member_ptr();
         scan.tasks_count = 1;
-        scan.collections = &collection_;
-        scan.start_keys = &next_min_key_;
-        scan.count_limits = &read_ahead_;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
         scan.counts = &found_counts;
         scan.keys = &found_keys;
 
@@ -74,11 +89,40 @@ class keys_stream_t {
         if (!status)
             return status;
 
-        fetched_keys_ = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
-        fetched_offset_ = 0;
+        keys = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
+        auto count = static_cast<ustore_length_t>(keys.size());
+        next_key = count < read_ahead ? ustore_key_unknown_k : keys[count - 1] + 1;
+        return {};
+    }
+
+    status_t prefetch() noexcept {
 
-        auto count = static_cast<ustore_length_t>(fetched_keys_.size());
-        next_min_key_ = count < read_ahead_ ? ustore_key_unknown_k : fetched_keys_[count - 1] + 1;
+        if (next_min_key_ == ustore_key_unknown_k) {
+            ++fetched_offset_;
+            return {};
+        }
+
+        status_t status;
+        if (background_) {
+            if (background_->upcoming_key() != next_min_key_)
+                status = background_->restart(next_min_key_);
+            if (status)
+                status = background_->next(fetched_keys_, next_min_key_);
+        }
+        else
+            status = fetch(db_,
+                           collection_,
+                           txn_,
+                           snap_,
+                           read_ahead_,
+                           next_min_key_,
+                           arena_,
+                           fetched_keys_,
+                           next_min_key_);
+        if (!status)
+            return status;
+
+        fetched_offset_ = 0;
         return {};
     }
 
@@ -94,8 +138,10 @@ class keys_stream_t {
     keys_stream_t(ustore_database_t db,
                   ustore_collection_t collection = ustore_collection_main_k,
                   std::size_t read_ahead = keys_stream_t::default_read_ahead_k,
-                  ustore_transaction_t txn = nullptr) noexcept
-        : db_(db), collection_(collection), txn_(txn), arena_(db), read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
+                  ustore_transaction_t txn = nullptr,
+                  ustore_snapshot_t snap = 0) noexcept
+        : db_(db), collection_(collection), txn_(txn), snap_(snap), arena_(db),
+          read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
 
     keys_stream_t(keys_stream_t&&) = default;
     keys_stream_t& operator=(keys_stream_t&&) = default;
@@ -103,6 +149,31 @@ class keys_stream_t {
     keys_stream_t(keys_stream_t const&) = delete;
     keys_stream_t& operator=(keys_stream_t const&) = delete;
 
+    /**
+     * @brief Scans up to `windows_ahead` following windows in a separate thread, each into its own arena.
+     * Zero returns to synchronous scans. Transactions aren't thread-safe, so their scans stay synchronous.
+     * Windows, fetched ahead, won't reflect the writes made after they were fetched.
+     */
+    status_t fetch_in_background(std::size_t windows_ahead = 1) noexcept {
+        background_.reset();
+        if (!windows_ahead || txn_)
+            return {};
+        try {
+            auto fetch_window = [db = db_, collection = collection_, snap = snap_, read_ahead = read_ahead_](
+                                    ustore_key_t start_key,
+                                    arena_t& arena,
+                                    ptr_range_gt<ustore_key_t>& keys,
+                                    ustore_key_t& next_key) noexcept {
+                return fetch(db, collection, nullptr, snap, read_ahead, start_key, arena, keys, next_key);
+            };
+            background_ = std::make_unique<background_t>(db_, windows_ahead, fetch_window);
+        }
+        catch (...) {
+            return status_t::status_view("Failed to allocate memory!");
+        }
+        return next_min_key_ == ustore_key_unknown_k ? status_t {} : background_->restart(next_min_key_);
+    }
+
     status_t seek(ustore_key_t key) noexcept {
         fetched_keys_ = {};
         fetched_offset_ = 0;
@@ -140,6 +211,11 @@ class keys_stream_t {
     status_t seek_to_first() noexcept { return seek(std::numeric_limits<ustore_key_t>::min()); }
     status_t seek_to_next_batch() noexcept { return seek(next_min_key_); }
 
+    /**
+     * @brief First key of the next batch, or `ustore_key_unknown_k`, if the current one is the last.
+     */
+    ustore_key_t next_batch_key() const noexcept { return next_min_key_; }
+
     /**
      * @brief Exposes all the fetched keys at once, including the passed ones.
      * Should be used with `seek_to_next_batch`. Next `advance` will do the same.
@@ -170,11 +246,28 @@ class keys_stream_t {
     }
 };
 
+/**
+ * @brief Iterator (almost) over the key-value pairs in a single collection.
+ * Fetches the values of every window of keys in a single read.
+ * Like the `keys_stream_t`, can fetch the following windows in the background.
+ *
+ * ## Class Specs
+ * - Concurrency: Must be used from a single thread!
+ * - Lifetime: @b Must live shorter then the collection it belongs to.
+ * - Copyable: No.
+ * - Exceptions: Never.
+ */
 class pairs_stream_t {
 
+    struct window_t {
+        ptr_range_gt<ustore_key_t> keys;
+        joined_blobs_t values;
+    };
+
     ustore_database_t db_ {nullptr};
     ustore_collection_t collection_ {ustore_collection_main_k};
     ustore_transaction_t txn_ {nullptr};
+    ustore_snapshot_t snap_ {0};
 
     arena_t arena_ {nullptr};
     ustore_length_t read_ahead_ {0};
@@ -185,25 +278,33 @@ class pairs_stream_t {
     joined_blobs_iterator_t values_iterator_ {};
     std::size_t fetched_offset_ {0};
 
-    status_t prefetch() noexcept {
+    using background_t = windows_prefetch_gt<window_t>;
+    std::unique_ptr<background_t> background_;
 
-        if (next_min_key_ == ustore_key_unknown_k) {
-            ++fetched_offset_;
-            return {};
-        }
+    static status_t fetch( //
+        ustore_database_t db,
+        ustore_collection_t collection,
+        ustore_transaction_t txn,
+        ustore_snapshot_t snap,
+        ustore_length_t read_ahead,
+        ustore_key_t start_key,
+        arena_t& arena,
+        window_t& window,
+        ustore_key_t& next_key) noexcept {
 
         ustore_length_t* found_counts = nullptr;
         ustore_key_t* found_keys = nullptr;
         status_t status;
         ustore_scan_t scan {};
-        scan.db = db_;
+        scan.db = db;
         scan.error = status.member_ptr();
-        scan.transaction = txn_;
-        scan.arena = arena_.member_ptr();
+        scan.transaction = txn;
+        scan.snapshot = snap;
+        scan.arena = arena.member_ptr();
         scan.tasks_count = 1;
-        scan.collections = &collection_;
-        scan.start_keys = &next_min_key_;
-        scan.count_limits = &read_ahead_;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
         scan.counts = &found_counts;
         scan.keys = &found_keys;
 
@@ -211,20 +312,19 @@ class pairs_stream_t {
         if (!status)
             return status;
 
-        fetched_keys_ = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
-        fetched_offset_ = 0;
-        auto count = static_cast<ustore_size_t>(fetched_keys_.size());
+        auto count = static_cast<ustore_size_t>(*found_counts);
 
         ustore_bytes_ptr_t found_vals {};
         ustore_length_t* found_offs {};
         ustore_read_t read {};
-        read.db = db_;
+        read.db = db;
         read.error = status.member_ptr();
-        read.transaction = txn_;
-        read.arena = arena_.member_ptr();
+        read.transaction = txn;
+        read.snapshot = snap;
+        read.arena = arena.member_ptr();
         read.options = ustore_option_dont_discard_memory_k;
         read.tasks_count = count;
-        read.collections = &collection_;
+        read.collections = &collection;
         read.keys = found_keys;
         read.keys_stride = sizeof(ustore_key_t);
         read.offsets = &found_offs;
@@ -234,9 +334,36 @@ class pairs_stream_t {
         if (!status)
             return status;
 
-        values_view_ = joined_blobs_t {count, found_offs, found_vals};
+        window.keys = ptr_range_gt<ustore_key_t> {found_keys, found_keys + count};
+        window.values = joined_blobs_t {count, found_offs, found_vals};
+        next_key = count < read_ahead ? ustore_key_unknown_k : found_keys[count - 1] + 1;
+        return {};
+    }
+
+    status_t prefetch() noexcept {
+
+        if (next_min_key_ == ustore_key_unknown_k) {
+            ++fetched_offset_;
+            return {};
+        }
+
+        status_t status;
+        window_t window;
+        if (background_) {
+            if (background_->upcoming_key() != next_min_key_)
+                status = background_->restart(next_min_key_);
+            if (status)
+                status = background_->next(window, next_min_key_);
+        }
+        else
+            status = fetch(db_, collection_, txn_, snap_, read_ahead_, next_min_key_, arena_, window, next_min_key_);
+        if (!status)
+            return status;
+
+        fetched_keys_ = window.keys;
+        fetched_offset_ = 0;
+        values_view_ = window.values;
         values_iterator_ = values_view_.begin();
-        next_min_key_ = count < read_ahead_ ? ustore_key_unknown_k : fetched_keys_[count - 1] + 1;
         return {};
     }
 
@@ -251,8 +378,10 @@ class pairs_stream_t {
         ustore_database_t db,
         ustore_collection_t collection = ustore_collection_main_k,
         std::size_t read_ahead = pairs_stream_t::default_read_ahead_k,
-        ustore_transaction_t txn = nullptr) noexcept
-        : db_(db), collection_(collection), txn_(txn), arena_(db_), read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
+        ustore_transaction_t txn = nullptr,
+        ustore_snapshot_t snap = 0) noexcept
+        : db_(db), collection_(collection), txn_(txn), snap_(snap), arena_(db_),
+          read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
 
     pairs_stream_t(pairs_stream_t&&) = default;
     pairs_stream_t& operator=(pairs_stream_t&&) = default;
@@ -260,6 +389,31 @@ class pairs_stream_t {
     pairs_stream_t(pairs_stream_t const&) = delete;
     pairs_stream_t& operator=(pairs_stream_t const&) = delete;
 
+    /**
+     * @brief Fetches up to `windows_ahead` following windows in a separate thread, each into its own arena.
+     * Zero returns to synchronous fetches. Transactions aren't thread-safe, so their fetches stay synchronous.
+     * Windows, fetched ahead, won't reflect the writes made after they were fetched.
+     */
+    status_t fetch_in_background(std::size_t windows_ahead = 1) noexcept {
+        background_.reset();
+        if (!windows_ahead || txn_)
+            return {};
+        try {
+            auto fetch_window = [db = db_, collection = collection_, snap = snap_, read_ahead = read_ahead_](
+                                    ustore_key_t start_key,
+                                    arena_t& arena,
+                                    window_t& window,
+                                    ustore_key_t& next_key) noexcept {
+                return fetch(db, collection, nullptr, snap, read_ahead, start_key, arena, window, next_key);
+            };
+            background_ = std::make_unique<background_t>(db_, windows_ahead, fetch_window);
+        }
+        catch (...) {
+            return status_t::status_view("Failed to allocate memory!");
+        }
+        return next_min_key_ == ustore_key_unknown_k ? status_t {} : background_->restart(next_min_key_);
+    }
+
     status_t seek(ustore_key_t key) noexcept {
         fetched_keys_ = {};
         fetched_offset_ = 0;
@@ -370,7 +524,7 @@ class blobs_range_t {
     expected_gt<stream_at> make_stream( //
         ustore_key_t target,
         std::size_t read_ahead = keys_stream_t::default_read_ahead_k) noexcept {
-        stream_at stream {db_, collection_, read_ahead, txn_};
+        stream_at stream {db_, collection_, read_ahead, txn_, snap_};
         status_t status = stream.seek(target);
         return {std::move(status), std::move(stream)};
     }
@@ -8,10 +8,46 @@
  */
 
 #pragma once
+#include <optional> // `std::optional`
+
 #include "ustore/cpp/docs_ref.hpp"
+#include "ustore/cpp/docs_table_stream.hpp"
 
 namespace unum::ustore {
 
+/**
+ * @brief Aggregates of documents, with a row of results for every aggregation
+ * and a column for every group.
+ * @see `ustore_docs_aggregate_t`.
+ */
+struct docs_aggregates_t {
+    std::size_t groups_count = 0;
+    ustore_length_t const* groups_offsets = nullptr;
+    ustore_length_t const* groups_lengths = nullptr;
+    ustore_byte_t const* groups_strings = nullptr;
+    ustore_size_t const* counts = nullptr;
+    double const* results = nullptr;
+
+    /**
+     * @brief Grouping value of the `group_idx`-th group.
+     * @return NULL-opt for the group of documents without the grouping field.
+     */
+    std::optional<std::string_view> group(std::size_t group_idx) const noexcept {
+        if (groups_lengths[group_idx] == ustore_length_missing_k)
+            return std::nullopt;
+        auto begin = reinterpret_cast<char const*>(groups_strings) + groups_offsets[group_idx];
+        return std::string_view {begin, groups_lengths[group_idx]};
+    }
+
+    double result(std::size_t aggregation_idx, std::size_t group_idx) const noexcept {
+        return results[aggregation_idx * groups_count + group_idx];
+    }
+
+    std::size_t count(std::size_t aggregation_idx, std::size_t group_idx) const noexcept {
+        return counts[aggregation_idx * groups_count + group_idx];
+    }
+};
+
 /**
  * @brief Collection is persistent associative container,
  * essentially a transactional @b map<id,std::map<..>>.
@@ -149,6 +185,255 @@ class docs_collection_t {
         return status;
     }
 
+    /**
+     * @brief Creates a secondary index on a document field and indexes the present documents.
+     * @see `ustore_docs_index_create_t`.
+     */
+    status_t create_index(ustore_str_view_t field, ustore_doc_field_type_t type) noexcept {
+        status_t status;
+        ustore_docs_index_create_t index_create {};
+        index_create.db = db_;
+        index_create.error = status.member_ptr();
+        index_create.arena = arena_.member_ptr();
+        index_create.collection = collection_;
+        index_create.field = field;
+        index_create.type = type;
+        ustore_docs_index_create(&index_create);
+        return status;
+    }
+
+    status_t drop_index(ustore_str_view_t field, ustore_doc_field_type_t type) noexcept {
+        status_t status;
+        ustore_docs_index_drop_t index_drop {};
+        index_drop.db = db_;
+        index_drop.error = status.member_ptr();
+        index_drop.arena = arena_.member_ptr();
+        index_drop.collection = collection_;
+        index_drop.field = field;
+        index_drop.type = type;
+        ustore_docs_index_drop(&index_drop);
+        return status;
+    }
+
+    /**
+     * @brief Materializes a document field, letting `gather` skip parsing the documents for it.
+     * @see `ustore_docs_column_create_t`.
+     */
+    status_t create_column(ustore_str_view_t field) noexcept {
+        status_t status;
+        ustore_docs_column_create_t column_create {};
+        column_create.db = db_;
+        column_create.error = status.member_ptr();
+        column_create.arena = arena_.member_ptr();
+        column_create.collection = collection_;
+        column_create.field = field;
+        ustore_docs_column_create(&column_create);
+        return status;
+    }
+
+    status_t drop_column(ustore_str_view_t field) noexcept {
+        status_t status;
+        ustore_docs_column_drop_t column_drop {};
+        column_drop.db = db_;
+        column_drop.error = status.member_ptr();
+        column_drop.arena = arena_.member_ptr();
+        column_drop.collection = collection_;
+        column_drop.field = field;
+        ustore_docs_column_drop(&column_drop);
+        return status;
+    }
+
+    /**
+     * @brief Changes the form, in which the documents are stored, converting the present ones.
+     * @see `ustore_docs_storage_set_t`.
+     */
+    status_t set_storage(ustore_doc_storage_t storage) noexcept {
+        status_t status;
+        ustore_docs_storage_set_t storage_set {};
+        storage_set.db = db_;
+        storage_set.error = status.member_ptr();
+        storage_set.arena = arena_.member_ptr();
+        storage_set.collection = collection_;
+        storage_set.storage = storage;
+        ustore_docs_storage_set(&storage_set);
+        return status;
+    }
+
+    /**
+     * @brief Compresses the documents with a dictionary, trained on `samples_count` present ones.
+     * Passing zero samples disables the compression.
+     * @see `ustore_docs_compression_set_t`.
+     */
+    status_t set_compression(ustore_size_t samples_count, ustore_size_t dictionary_size = 0) noexcept {
+        status_t status;
+        ustore_docs_compression_set_t compression_set {};
+        compression_set.db = db_;
+        compression_set.error = status.member_ptr();
+        compression_set.arena = arena_.member_ptr();
+        compression_set.collection = collection_;
+        compression_set.samples_count = samples_count;
+        compression_set.dictionary_size = dictionary_size;
+        ustore_docs_compression_set(&compression_set);
+        return status;
+    }
+
+    /**
+     * @brief Enables or disables the field catalog, counting the types of values under every path.
+     * @see `ustore_docs_catalog_set_t`.
+     */
+    status_t set_catalog(bool enabled) noexcept {
+        status_t status;
+        ustore_docs_catalog_set_t catalog_set {};
+        catalog_set.db = db_;
+        catalog_set.error = status.member_ptr();
+        catalog_set.arena = arena_.member_ptr();
+        catalog_set.collection = collection_;
+        catalog_set.enabled = enabled;
+        ustore_docs_catalog_set(&catalog_set);
+        return status;
+    }
+
+    /**
+     * @brief Lists the fields present in the collection, looking them up in the field catalog.
+     * @see `ustore_docs_gist_t`, `set_catalog()`.
+     */
+    expected_gt<joined_strs_t> fields() noexcept {
+        status_t status;
+        ustore_size_t found_count = 0;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_str_span_t found_strings = nullptr;
+        ustore_docs_gist_t docs_gist {};
+        docs_gist.db = db_;
+        docs_gist.error = status.member_ptr();
+        docs_gist.transaction = txn_;
+        docs_gist.snapshot = snap_;
+        docs_gist.arena = arena_.member_ptr();
+        docs_gist.docs_count = 1;
+        docs_gist.collections = &collection_;
+        docs_gist.fields_count = &found_count;
+        docs_gist.offsets = &found_offsets;
+        docs_gist.fields = &found_strings;
+        ustore_docs_gist(&docs_gist);
+        joined_strs_t view {found_count, found_offsets, found_strings};
+        return {std::move(status), std::move(view)};
+    }
+
+    /**
+     * @brief Finds keys of documents, which have the indexed `field` in the `[min, max]` range.
+     * Passing the same value as both bounds performs an equality lookup.
+     * @see `ustore_docs_find_t`.
+     */
+    expected_gt<ptr_range_gt<ustore_key_t>> find( //
+        ustore_str_view_t field,
+        ustore_doc_field_type_t type,
+        ustore_str_view_t min_value,
+        ustore_str_view_t max_value) noexcept {
+
+        status_t status;
+        ustore_size_t count = 0;
+        ustore_key_t* keys = nullptr;
+        ustore_docs_find_t docs_find {};
+        docs_find.db = db_;
+        docs_find.error = status.member_ptr();
+        docs_find.transaction = txn_;
+        docs_find.snapshot = snap_;
+        docs_find.arena = arena_.member_ptr();
+        docs_find.collection = collection_;
+        docs_find.field = field;
+        docs_find.type = type;
+        docs_find.min_value = min_value;
+        docs_find.max_value = max_value;
+        docs_find.count = &count;
+        docs_find.keys = &keys;
+        ustore_docs_find(&docs_find);
+        if (!status)
+            return status;
+        return ptr_range_gt<ustore_key_t> {keys, keys + count};
+    }
+
+    /**
+     * @brief Pages through the `header` fields of documents with keys from `min_key` to `max_key`
+     * inclusive, gathering `rows_per_page` rows at a time, instead of the whole table at once.
+     * @see `docs_table_stream_t`.
+     */
+    docs_table_stream_t table_stream( //
+        table_header_view_t header,
+        std::size_t rows_per_page = docs_table_stream_t::default_rows_per_page_k,
+        std::size_t threads_count = 1,
+        ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min(),
+        ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max()) const noexcept {
+        return {db_, collection_, txn_, snap_, header, rows_per_page, threads_count, min_key, max_key};
+    }
+
+    /**
+     * @brief Pages through the `header` fields of documents with the given `keys`.
+     * @see `docs_table_stream_t`.
+     */
+    docs_table_stream_t table_stream( //
+        table_header_view_t header,
+        ptr_range_gt<ustore_key_t const> keys,
+        std::size_t rows_per_page = docs_table_stream_t::default_rows_per_page_k,
+        std::size_t threads_count = 1) const noexcept {
+        return {db_, collection_, txn_, snap_, header, keys, rows_per_page, threads_count};
+    }
+
+    /**
+     * @brief Computes the `functions` over the respective `fields` of documents with keys
+     * from `min_key` to `max_key` inclusive, grouping them by the `group_by` field, if it's set.
+     * Missing `fields` count the documents.
+     * @see `ustore_docs_aggregate_t`.
+     */
+    expected_gt<docs_aggregates_t> aggregate( //
+        ptr_range_gt<ustore_doc_aggregation_t const> functions,
+        ptr_range_gt<ustore_str_view_t const> fields,
+        ustore_str_view_t group_by = nullptr,
+        std::size_t threads_count = 1,
+        ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min(),
+        ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max()) noexcept {
+
+        status_t status;
+        docs_aggregates_t aggregates;
+        ustore_size_t groups_count = 0;
+        ustore_length_t* groups_offsets = nullptr;
+        ustore_length_t* groups_lengths = nullptr;
+        ustore_byte_t* groups_strings = nullptr;
+        ustore_size_t* counts = nullptr;
+        double* results = nullptr;
+        ustore_docs_aggregate_t docs_aggregate {};
+        docs_aggregate.db = db_;
+        docs_aggregate.error = status.member_ptr();
+        docs_aggregate.transaction = txn_;
+        docs_aggregate.snapshot = snap_;
+        docs_aggregate.arena = arena_.member_ptr();
+        docs_aggregate.collection = collection_;
+        docs_aggregate.min_key = &min_key;
+        docs_aggregate.max_key = &max_key;
+        docs_aggregate.aggregations_count = functions.size();
+        docs_aggregate.functions = functions.begin();
+        docs_aggregate.functions_stride = sizeof(ustore_doc_aggregation_t);
+        docs_aggregate.fields = fields.begin();
+        docs_aggregate.fields_stride = fields.empty() ? 0 : sizeof(ustore_str_view_t);
+        docs_aggregate.group_by = group_by;
+        docs_aggregate.threads_count = threads_count;
+        docs_aggregate.groups_count = &groups_count;
+        docs_aggregate.groups_offsets = &groups_offsets;
+        docs_aggregate.groups_lengths = &groups_lengths;
+        docs_aggregate.groups_strings = &groups_strings;
+        docs_aggregate.counts = &counts;
+        docs_aggregate.results = &results;
+        ustore_docs_aggregate(&docs_aggregate);
+        if (!status)
+            return status;
+
+        aggregates.groups_count = groups_count;
+        aggregates.groups_offsets = groups_offsets;
+        aggregates.groups_lengths = groups_lengths;
+        aggregates.groups_strings = groups_strings;
+        aggregates.counts = counts;
+        aggregates.results = results;
+        return aggregates;
+    }
+
     inline docs_ref_gt<places_arg_t> operator[](std::initializer_list<ustore_key_t> keys) noexcept { return at(keys); }
     inline docs_ref_gt<places_arg_t> at(std::initializer_list<ustore_key_t> keys) noexcept { //
         return at(strided_range(keys));
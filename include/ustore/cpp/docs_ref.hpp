@@ -80,7 +80,7 @@ class docs_ref_gt {
     expected_gt<expected_at> any_get(ustore_doc_field_type_t, ustore_options_t) noexcept;
 
     template <typename expected_at, typename layout_at>
-    expected_gt<expected_at> any_gather(layout_at&&, ustore_options_t) noexcept;
+    expected_gt<expected_at> any_gather(layout_at&&, ustore_options_t, std::size_t threads_count) noexcept;
 
   public:
     docs_ref_gt(ustore_database_t db,
@@ -248,25 +248,31 @@ class docs_ref_gt {
      * @brief For N documents and M fields gather (N * M) responses.
      * You put in a @c table_layout_view_gt and you receive a @c `docs_table_gt`.
      * Any column type annotation is optional.
+     * @param threads_count Number of threads to split the parsing of large batches between.
      */
-    expected_gt<docs_table_t> gather(table_header_t const& header, bool watch = true) noexcept {
+    expected_gt<docs_table_t> gather(table_header_t const& header,
+                                     bool watch = true,
+                                     std::size_t threads_count = 1) noexcept {
         auto options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
-        return any_gather<docs_table_t, table_header_t const&>(header, options);
+        return any_gather<docs_table_t, table_header_t const&>(header, options, threads_count);
     }
 
-    expected_gt<docs_table_t> gather(table_header_view_t const& header, bool watch = true) noexcept {
+    expected_gt<docs_table_t> gather(table_header_view_t const& header,
+                                     bool watch = true,
+                                     std::size_t threads_count = 1) noexcept {
         auto options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
-        return any_gather<docs_table_t, table_header_view_t const&>(header, options);
+        return any_gather<docs_table_t, table_header_view_t const&>(header, options, threads_count);
     }
 
     template <typename... column_types_at>
     expected_gt<docs_table_gt<column_types_at...>> gather( //
         table_header_gt<column_types_at...> const& header,
-        bool watch = true) noexcept {
+        bool watch = true,
+        std::size_t threads_count = 1) noexcept {
         auto options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
         using input_t = table_header_gt<column_types_at...>;
         using output_t = docs_table_gt<column_types_at...>;
-        return any_gather<output_t, input_t const&>(header, options);
+        return any_gather<output_t, input_t const&>(header, options, threads_count);
     }
 };
 
@@ -428,7 +434,9 @@ expected_gt<joined_strs_t> docs_ref_gt<locations_at>::gist(bool watch) noexcept
 
 template <typename locations_at>
 template <typename expected_at, typename layout_at>
-expected_gt<expected_at> docs_ref_gt<locations_at>::any_gather(layout_at&& layout, ustore_options_t options) noexcept {
+expected_gt<expected_at> docs_ref_gt<locations_at>::any_gather(layout_at&& layout,
+                                                                ustore_options_t options,
+                                                                std::size_t threads_count) noexcept {
 
     decltype(auto) locs = locations_.ref();
     auto count = keys_extractor_t {}.count(locs);
@@ -469,6 +477,7 @@ expected_gt<expected_at> docs_ref_gt<locations_at>::any_gather(layout_at&& layou
     docs_gather.columns_offsets = view.member_offsets();
     docs_gather.columns_lengths = view.member_lengths();
     docs_gather.joined_strings = view.member_tape();
+    docs_gather.threads_count = threads_count;
 
     ustore_docs_gather(&docs_gather);
 
@@ -0,0 +1,220 @@
+/**
+ * @file docs_table_stream.hpp
+ * @author Ashot Vardanian
+ * @addtogroup Cpp
+ *
+ * @brief C++ bindings for "ustore/docs.h".
+ *
+ * Paged alternative to a single `ustore_docs_gather` over all the rows,
+ * for tables that don't fit into memory at once.
+ */
+
+#pragma once
+#include <algorithm> // `std::upper_bound`
+#include <limits>    // `std::numeric_limits`
+
+#include "ustore/docs.h"
+#include "ustore/cpp/types.hpp"      // `arena_t`
+#include "ustore/cpp/status.hpp"     // `status_t`
+#include "ustore/cpp/docs_table.hpp" // `docs_table_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief A stream of pages of a table, each gathering the same fields
+ * from the next @b fixed-size chunk of rows. The rows are either the keys
+ * from a given range, scanned lazily, or an externally owned list of keys.
+ *
+ * Every page is gathered into the same arena, so memory usage is bounded
+ * by the size of a single page. To keep the previous pages alive, direct
+ * every next page into a separate arena with `on(...)`.
+ *
+ * ## Class Specs
+ * - Concurrency: Must be used from a single thread!
+ * - Lifetime: @b Must live shorter then the collection, the header and the keys it views.
+ * - Copyable: No.
+ * - Exceptions: Never.
+ */
+class docs_table_stream_t {
+
+    ustore_database_t db_ {nullptr};
+    ustore_collection_t collection_ {ustore_collection_main_k};
+    ustore_transaction_t txn_ {nullptr};
+    ustore_snapshot_t snap_ {0};
+
+    table_header_view_t header_ {};
+    std::size_t rows_per_page_ {0};
+    std::size_t threads_count_ {1};
+
+    /// Externally owned keys, if the stream isn't scanning a range.
+    ptr_range_gt<ustore_key_t const> keys_ {};
+    std::size_t keys_offset_ {0};
+    bool scans_ {false};
+    ustore_key_t next_min_key_ {std::numeric_limits<ustore_key_t>::min()};
+    ustore_key_t max_key_ {std::numeric_limits<ustore_key_t>::max()};
+
+    arena_t keys_arena_ {nullptr};
+    arena_t pages_arena_ {nullptr};
+    ustore_arena_t* page_arena_ {nullptr};
+
+    ptr_range_gt<ustore_key_t const> page_keys_ {};
+    docs_table_t page_ {0, 0, {}, {}, {}, {}};
+
+    status_t prefetch_keys() noexcept {
+
+        if (!scans_) {
+            std::size_t count = std::min(rows_per_page_, keys_.size() - keys_offset_);
+            page_keys_ = {keys_.begin() + keys_offset_, count};
+            keys_offset_ += count;
+            return {};
+        }
+
+        page_keys_ = {};
+        if (next_min_key_ == ustore_key_unknown_k)
+            return {};
+
+        status_t status;
+        ustore_length_t count_limit = static_cast<ustore_length_t>(rows_per_page_);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = db_;
+        scan.error = status.member_ptr();
+        scan.transaction = txn_;
+        scan.snapshot = snap_;
+        scan.arena = keys_arena_.member_ptr();
+        scan.tasks_count = 1;
+        scan.collections = &collection_;
+        scan.start_keys = &next_min_key_;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        if (!status)
+            return status;
+
+        // Cut the keys past the end of the range
+        ustore_key_t const* found_end = std::upper_bound(found_keys, found_keys + *found_counts, max_key_);
+        page_keys_ = {found_keys, found_end};
+        bool const is_last = found_end != found_keys + count_limit || page_keys_.empty() ||
+                             page_keys_[page_keys_.size() - 1] == max_key_;
+        next_min_key_ = is_last ? ustore_key_unknown_k : page_keys_[page_keys_.size() - 1] + 1;
+        return {};
+    }
+
+    status_t prefetch_gather() noexcept {
+
+        status_t status = prefetch_keys();
+        if (!status)
+            return status;
+
+        page_ = docs_table_t {
+            page_keys_.size(),
+            header_.count,
+            {&collection_, 0},
+            {page_keys_.begin(), sizeof(ustore_key_t)},
+            header_.fields_begin,
+            header_.types_begin,
+        };
+        if (page_keys_.empty())
+            return {};
+
+        ustore_docs_gather_t docs_gather {};
+        docs_gather.db = db_;
+        docs_gather.error = status.member_ptr();
+        docs_gather.transaction = txn_;
+        docs_gather.snapshot = snap_;
+        docs_gather.arena = page_arena_;
+        docs_gather.docs_count = page_keys_.size();
+        docs_gather.fields_count = header_.count;
+        docs_gather.collections = &collection_;
+        docs_gather.keys = page_keys_.begin();
+        docs_gather.keys_stride = sizeof(ustore_key_t);
+        docs_gather.fields = header_.fields_begin.get();
+        docs_gather.fields_stride = header_.fields_begin.stride();
+        docs_gather.types = header_.types_begin.get();
+        docs_gather.types_stride = header_.types_begin.stride();
+        docs_gather.columns_validities = page_.member_validities();
+        docs_gather.columns_conversions = page_.member_conversions();
+        docs_gather.columns_collisions = page_.member_collisions();
+        docs_gather.columns_scalars = page_.member_scalars();
+        docs_gather.columns_offsets = page_.member_offsets();
+        docs_gather.columns_lengths = page_.member_lengths();
+        docs_gather.joined_strings = page_.member_tape();
+        docs_gather.threads_count = threads_count_;
+        ustore_docs_gather(&docs_gather);
+        return status;
+    }
+
+  public:
+    static constexpr std::size_t default_rows_per_page_k = 64 * 1024;
+
+    /**
+     * @brief Pages through the documents with keys from `min_key` to `max_key` inclusive.
+     */
+    docs_table_stream_t(ustore_database_t db,
+                        ustore_collection_t collection,
+                        ustore_transaction_t txn,
+                        ustore_snapshot_t snap,
+                        table_header_view_t header,
+                        std::size_t rows_per_page = default_rows_per_page_k,
+                        std::size_t threads_count = 1,
+                        ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min(),
+                        ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max()) noexcept
+        : db_(db), collection_(collection), txn_(txn), snap_(snap), header_(header),
+          rows_per_page_(std::max<std::size_t>(rows_per_page, 1)), threads_count_(threads_count), scans_(true),
+          next_min_key_(min_key), max_key_(max_key), keys_arena_(db), pages_arena_(db),
+          page_arena_(pages_arena_.member_ptr()) {}
+
+    /**
+     * @brief Pages through the documents with the given `keys`, in the same order.
+     */
+    docs_table_stream_t(ustore_database_t db,
+                        ustore_collection_t collection,
+                        ustore_transaction_t txn,
+                        ustore_snapshot_t snap,
+                        table_header_view_t header,
+                        ptr_range_gt<ustore_key_t const> keys,
+                        std::size_t rows_per_page = default_rows_per_page_k,
+                        std::size_t threads_count = 1) noexcept
+        : db_(db), collection_(collection), txn_(txn), snap_(snap), header_(header),
+          rows_per_page_(std::max<std::size_t>(rows_per_page, 1)), threads_count_(threads_count), keys_(keys),
+          keys_arena_(db), pages_arena_(db), page_arena_(pages_arena_.member_ptr()) {}
+
+    docs_table_stream_t(docs_table_stream_t&&) = delete;
+    docs_table_stream_t& operator=(docs_table_stream_t&&) = delete;
+    docs_table_stream_t(docs_table_stream_t const&) = delete;
+    docs_table_stream_t& operator=(docs_table_stream_t const&) = delete;
+
+    /**
+     * @brief Directs the following pages into an external `arena`,
+     * so that the current page stays valid after `seek_to_next_batch()`.
+     */
+    docs_table_stream_t& on(arena_t& arena) noexcept {
+        page_arena_ = arena.member_ptr();
+        return *this;
+    }
+
+    /**
+     * @brief Gathers the first page. Must be called before anything else.
+     */
+    status_t seek_to_first() noexcept { return prefetch_gather(); }
+
+    /**
+     * @brief Gathers the next page, invalidating the current one,
+     * unless a different arena was passed with `on(...)`.
+     */
+    status_t seek_to_next_batch() noexcept { return prefetch_gather(); }
+
+    /**
+     * @brief Checks if the last gathered page is empty, meaning that all the rows have been passed.
+     */
+    bool is_end() const noexcept { return page_keys_.empty(); }
+
+    docs_table_t const& page() const noexcept { return page_; }
+    ptr_range_gt<ustore_key_t const> keys_batch() const noexcept { return page_keys_; }
+    table_header_view_t header() const noexcept { return header_; }
+    std::size_t rows_per_page() const noexcept { return rows_per_page_; }
+};
+
+} // namespace unum::ustore
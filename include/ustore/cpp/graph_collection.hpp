@@ -14,6 +14,48 @@
 
 namespace unum::ustore {
 
+/**
+ * @brief Adjacency of a graph in the Compressed Sparse Row format, living in an arena.
+ * Neighbors of `vertices[i]` span from `offsets[i]` to `offsets[i + 1]` in `neighbors` and `edges`.
+ * @see `ustore_graph_export_csr_t`.
+ */
+struct graph_csr_t {
+    ptr_range_gt<ustore_key_t> vertices;
+    ptr_range_gt<ustore_size_t> offsets;
+    ptr_range_gt<ustore_key_t> neighbors;
+    ptr_range_gt<ustore_key_t> edges;
+};
+
+/**
+ * @brief PageRank of every vertex of a graph.
+ * @see `ustore_graph_pagerank_t`.
+ */
+struct graph_ranks_t {
+    ptr_range_gt<ustore_key_t> vertices;
+    ptr_range_gt<ustore_float_t> ranks;
+    std::size_t iterations = 0;
+};
+
+/**
+ * @brief Weakly connected component of every vertex of a graph, labeled with its smallest vertex.
+ * @see `ustore_graph_components_t`.
+ */
+struct graph_components_t {
+    ptr_range_gt<ustore_key_t> vertices;
+    ptr_range_gt<ustore_key_t> components;
+    std::size_t count = 0;
+};
+
+/**
+ * @brief Number of triangles containing every vertex of a graph.
+ * @see `ustore_graph_triangles_t`.
+ */
+struct graph_triangles_t {
+    ptr_range_gt<ustore_key_t> vertices;
+    ptr_range_gt<ustore_size_t> triangles;
+    std::size_t count = 0;
+};
+
 /**
  * @brief Wraps relational/linking operations with cleaner type system.
  * Controls mainly just the inverted index collection and keeps a local
@@ -58,7 +100,9 @@ class graph_collection_t {
         return status;
     }
 
-    status_t upsert_edges(edges_view_t const& edges) noexcept {
+    status_t upsert_edges(edges_view_t const& edges,
+                          ustore_graph_encoding_t encoding = ustore_graph_encoding_plain_k,
+                          ustore_vertex_degree_t max_bucket_degree = 0) noexcept {
         status_t status;
 
         ustore_graph_upsert_edges_t graph_upsert_edges {};
@@ -74,6 +118,8 @@ class graph_collection_t {
         graph_upsert_edges.sources_stride = edges.source_ids.stride();
         graph_upsert_edges.targets_ids = edges.target_ids.begin().get();
         graph_upsert_edges.targets_stride = edges.target_ids.stride();
+        graph_upsert_edges.encoding = encoding;
+        graph_upsert_edges.max_bucket_degree = max_bucket_degree;
 
         ustore_graph_upsert_edges(&graph_upsert_edges);
         return status;
@@ -333,19 +379,44 @@ class graph_collection_t {
         return edges_span_t {edges_begin, edges_begin + edges_count};
     }
 
+    /**
+     * @brief Finds the edges from `source` to `target`, limiting the lookup to a
+     * single neighbor ID, so only one bucket of a high-degree vertex is read.
+     */
     expected_gt<edges_span_t> edges_between(ustore_key_t source, ustore_key_t target, bool watch = true) noexcept {
-        auto maybe_all = edges_containing(source, ustore_vertex_source_k, watch);
-        if (!maybe_all)
-            return maybe_all;
-
-        edges_span_t all = *maybe_all;
-        auto begin_and_end = std::equal_range(all.target_ids.begin(), all.target_ids.end(), target);
-        auto begin_offset = begin_and_end.first - all.target_ids.begin();
-        auto count = begin_and_end.second - begin_and_end.first;
-        all.source_ids = all.source_ids.subspan(begin_offset, count);
-        all.target_ids = all.target_ids.subspan(begin_offset, count);
-        all.edge_ids = all.edge_ids.subspan(begin_offset, count);
-        return all;
+
+        status_t status {};
+        ustore_vertex_degree_t* degrees_per_vertex {};
+        ustore_key_t* edges_per_vertex {};
+        ustore_vertex_role_t role = ustore_vertex_source_k;
+
+        ustore_graph_find_edges_t graph_find_edges {};
+        graph_find_edges.db = db_;
+        graph_find_edges.error = status.member_ptr();
+        graph_find_edges.transaction = transaction_;
+        graph_find_edges.snapshot = snapshot_;
+        graph_find_edges.arena = arena_;
+        graph_find_edges.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_find_edges.tasks_count = 1;
+        graph_find_edges.collections = &collection_;
+        graph_find_edges.vertices = &source;
+        graph_find_edges.roles = &role;
+        graph_find_edges.neighbors_min = &target;
+        graph_find_edges.neighbors_max = &target;
+        graph_find_edges.degrees_per_vertex = &degrees_per_vertex;
+        graph_find_edges.edges_per_vertex = &edges_per_vertex;
+
+        ustore_graph_find_edges(&graph_find_edges);
+
+        if (!status)
+            return status;
+
+        ustore_vertex_degree_t edges_count = degrees_per_vertex[0];
+        if (edges_count == ustore_vertex_degree_missing_k)
+            return edges_span_t {};
+
+        auto edges_begin = reinterpret_cast<edge_t*>(edges_per_vertex);
+        return edges_span_t {edges_begin, edges_begin + edges_count};
     }
 
     /**
@@ -429,6 +500,253 @@ class graph_collection_t {
         return strided_range_gt<ustore_key_t> {{neighbors.begin()}, count};
     }
 
+    /**
+     * @brief Finds all the vertices within `hops` from any of the `sources`.
+     * @param fanout Maximum number of neighbors followed from every vertex, zero for no limit.
+     * @see `ustore_graph_traverse_t`.
+     */
+    expected_gt<ptr_range_gt<ustore_key_t>> traverse( //
+        strided_range_gt<ustore_key_t const> sources,
+        std::size_t hops,
+        ustore_vertex_role_t role = ustore_vertex_role_any_k,
+        std::size_t fanout = 0,
+        bool watch = true) noexcept {
+
+        status_t status;
+        ustore_key_t* visited = nullptr;
+        ustore_size_t visited_count = 0;
+
+        ustore_graph_traverse_t graph_traverse {};
+        graph_traverse.db = db_;
+        graph_traverse.error = status.member_ptr();
+        graph_traverse.transaction = transaction_;
+        graph_traverse.snapshot = snapshot_;
+        graph_traverse.arena = arena_;
+        graph_traverse.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_traverse.collection = collection_;
+        graph_traverse.sources_count = sources.count();
+        graph_traverse.sources = sources.begin().get();
+        graph_traverse.sources_stride = sources.stride();
+        graph_traverse.role = role;
+        graph_traverse.hops = hops;
+        graph_traverse.fanouts = &fanout;
+        graph_traverse.visited = &visited;
+        graph_traverse.visited_count = &visited_count;
+
+        ustore_graph_traverse(&graph_traverse);
+        if (!status)
+            return status;
+        return ptr_range_gt<ustore_key_t> {visited, visited + visited_count};
+    }
+
+    /**
+     * @brief Exports the adjacency of vertices with IDs from `min_vertex` to `max_vertex` inclusive.
+     * @see `ustore_graph_export_csr_t`.
+     */
+    expected_gt<graph_csr_t> export_csr( //
+        ustore_vertex_role_t role = ustore_vertex_source_k,
+        bool export_edges = true,
+        ustore_key_t min_vertex = std::numeric_limits<ustore_key_t>::min(),
+        ustore_key_t max_vertex = std::numeric_limits<ustore_key_t>::max(),
+        bool watch = true) noexcept {
+
+        status_t status;
+        ustore_size_t vertices_count = 0;
+        ustore_key_t* vertices = nullptr;
+        ustore_size_t* offsets = nullptr;
+        ustore_key_t* neighbors = nullptr;
+        ustore_key_t* edges = nullptr;
+
+        ustore_graph_export_csr_t graph_export {};
+        graph_export.db = db_;
+        graph_export.error = status.member_ptr();
+        graph_export.transaction = transaction_;
+        graph_export.snapshot = snapshot_;
+        graph_export.arena = arena_;
+        graph_export.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_export.collection = collection_;
+        graph_export.role = role;
+        graph_export.min_vertex = &min_vertex;
+        graph_export.max_vertex = &max_vertex;
+        graph_export.vertices_count = &vertices_count;
+        graph_export.vertices = &vertices;
+        graph_export.offsets = &offsets;
+        graph_export.neighbors = &neighbors;
+        graph_export.edges = export_edges ? &edges : nullptr;
+
+        ustore_graph_export_csr(&graph_export);
+        if (!status)
+            return status;
+
+        ustore_size_t neighbors_count = offsets[vertices_count];
+        graph_csr_t csr;
+        csr.vertices = {vertices, vertices + vertices_count};
+        csr.offsets = {offsets, offsets + vertices_count + 1};
+        csr.neighbors = {neighbors, neighbors + neighbors_count};
+        csr.edges = {edges, edges ? edges + neighbors_count : nullptr};
+        return csr;
+    }
+
+    /**
+     * @brief Exports the IDs and the degrees of vertices from `min_vertex` to `max_vertex` inclusive,
+     * parsed from the headers of entries. Degree of `vertices[i]` is `offsets[i + 1] - offsets[i]`.
+     * @see `ustore_graph_export_csr_t`.
+     */
+    expected_gt<graph_csr_t> export_degrees( //
+        ustore_vertex_role_t role = ustore_vertex_role_any_k,
+        ustore_key_t min_vertex = std::numeric_limits<ustore_key_t>::min(),
+        ustore_key_t max_vertex = std::numeric_limits<ustore_key_t>::max(),
+        bool watch = true) noexcept {
+
+        status_t status;
+        ustore_size_t vertices_count = 0;
+        ustore_key_t* vertices = nullptr;
+        ustore_size_t* offsets = nullptr;
+
+        ustore_graph_export_csr_t graph_export {};
+        graph_export.db = db_;
+        graph_export.error = status.member_ptr();
+        graph_export.transaction = transaction_;
+        graph_export.snapshot = snapshot_;
+        graph_export.arena = arena_;
+        graph_export.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_export.collection = collection_;
+        graph_export.role = role;
+        graph_export.min_vertex = &min_vertex;
+        graph_export.max_vertex = &max_vertex;
+        graph_export.vertices_count = &vertices_count;
+        graph_export.vertices = &vertices;
+        graph_export.offsets = &offsets;
+
+        ustore_graph_export_csr(&graph_export);
+        if (!status)
+            return status;
+
+        graph_csr_t csr;
+        csr.vertices = {vertices, vertices + vertices_count};
+        csr.offsets = {offsets, offsets + vertices_count + 1};
+        return csr;
+    }
+
+    /**
+     * @brief Ranks all the vertices with PageRank, in up to `threads_count` threads.
+     * @see `ustore_graph_pagerank_t`.
+     */
+    expected_gt<graph_ranks_t> pagerank( //
+        std::size_t threads_count = 1,
+        ustore_float_t damping = 0.85f,
+        ustore_float_t tolerance = 1e-6f,
+        std::size_t iterations_limit = 100,
+        bool watch = true) noexcept {
+
+        status_t status;
+        ustore_size_t vertices_count = 0;
+        ustore_size_t iterations = 0;
+        ustore_key_t* vertices = nullptr;
+        ustore_float_t* ranks = nullptr;
+
+        ustore_graph_pagerank_t graph_pagerank {};
+        graph_pagerank.db = db_;
+        graph_pagerank.error = status.member_ptr();
+        graph_pagerank.transaction = transaction_;
+        graph_pagerank.snapshot = snapshot_;
+        graph_pagerank.arena = arena_;
+        graph_pagerank.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_pagerank.collection = collection_;
+        graph_pagerank.damping = damping;
+        graph_pagerank.tolerance = tolerance;
+        graph_pagerank.iterations_limit = iterations_limit;
+        graph_pagerank.threads_count = threads_count;
+        graph_pagerank.vertices_count = &vertices_count;
+        graph_pagerank.vertices = &vertices;
+        graph_pagerank.ranks = &ranks;
+        graph_pagerank.iterations = &iterations;
+
+        ustore_graph_pagerank(&graph_pagerank);
+        if (!status)
+            return status;
+
+        graph_ranks_t result;
+        result.vertices = {vertices, vertices + vertices_count};
+        result.ranks = {ranks, ranks + vertices_count};
+        result.iterations = iterations;
+        return result;
+    }
+
+    /**
+     * @brief Finds the weakly connected components, in up to `threads_count` threads.
+     * @see `ustore_graph_components_t`.
+     */
+    expected_gt<graph_components_t> components(std::size_t threads_count = 1, bool watch = true) noexcept {
+
+        status_t status;
+        ustore_size_t vertices_count = 0;
+        ustore_size_t components_count = 0;
+        ustore_key_t* vertices = nullptr;
+        ustore_key_t* components = nullptr;
+
+        ustore_graph_components_t graph_components {};
+        graph_components.db = db_;
+        graph_components.error = status.member_ptr();
+        graph_components.transaction = transaction_;
+        graph_components.snapshot = snapshot_;
+        graph_components.arena = arena_;
+        graph_components.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_components.collection = collection_;
+        graph_components.threads_count = threads_count;
+        graph_components.vertices_count = &vertices_count;
+        graph_components.vertices = &vertices;
+        graph_components.components = &components;
+        graph_components.components_count = &components_count;
+
+        ustore_graph_components(&graph_components);
+        if (!status)
+            return status;
+
+        graph_components_t result;
+        result.vertices = {vertices, vertices + vertices_count};
+        result.components = {components, components + vertices_count};
+        result.count = components_count;
+        return result;
+    }
+
+    /**
+     * @brief Counts the triangles of every vertex, in up to `threads_count` threads.
+     * @see `ustore_graph_triangles_t`.
+     */
+    expected_gt<graph_triangles_t> triangles(std::size_t threads_count = 1, bool watch = true) noexcept {
+
+        status_t status;
+        ustore_size_t vertices_count = 0;
+        ustore_size_t triangles_count = 0;
+        ustore_key_t* vertices = nullptr;
+        ustore_size_t* triangles = nullptr;
+
+        ustore_graph_triangles_t graph_triangles {};
+        graph_triangles.db = db_;
+        graph_triangles.error = status.member_ptr();
+        graph_triangles.transaction = transaction_;
+        graph_triangles.snapshot = snapshot_;
+        graph_triangles.arena = arena_;
+        graph_triangles.options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        graph_triangles.collection = collection_;
+        graph_triangles.threads_count = threads_count;
+        graph_triangles.vertices_count = &vertices_count;
+        graph_triangles.vertices = &vertices;
+        graph_triangles.triangles = &triangles;
+        graph_triangles.triangles_count = &triangles_count;
+
+        ustore_graph_triangles(&graph_triangles);
+        if (!status)
+            return status;
+
+        graph_triangles_t result;
+        result.vertices = {vertices, vertices + vertices_count};
+        result.triangles = {triangles, triangles + vertices_count};
+        result.count = triangles_count;
+        return result;
+    }
+
     status_t export_adjacency_list(std::string const& path,
                                    std::string_view column_separator,
                                    std::string_view line_delimiter);
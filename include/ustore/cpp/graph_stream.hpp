@@ -17,6 +17,10 @@ namespace unum::ustore {
 /**
  * @brief A stream of all @c edge_t's in a graph.
  * No particular order is guaranteed.
+ *
+ * After `fetch_in_background()`, the following windows of vertices are scanned
+ * and their edges are gathered by a separate thread, while the current ones are
+ * being processed.
  */
 class graph_stream_t {
 
@@ -25,6 +29,7 @@ class graph_stream_t {
     ustore_transaction_t transaction_ {nullptr};
     ustore_snapshot_t snapshot_ {};
     ustore_vertex_role_t role_ = ustore_vertex_role_any_k;
+    std::size_t read_ahead_vertices_ {0};
 
     edges_span_t fetched_edges_ {};
     std::size_t fetched_offset_ {0};
@@ -32,6 +37,85 @@ class graph_stream_t {
     arena_t arena_;
     keys_stream_t vertex_stream_;
 
+    /// Replaces the `vertex_stream_`, once the windows are fetched in the background.
+    using background_t = windows_prefetch_gt<edges_span_t>;
+    std::unique_ptr<background_t> background_;
+    ustore_key_t next_vertex_ {ustore_key_unknown_k};
+
+    static status_t fetch_window( //
+        ustore_database_t db,
+        ustore_collection_t collection,
+        ustore_snapshot_t snapshot,
+        ustore_vertex_role_t role,
+        ustore_length_t read_ahead,
+        ustore_key_t start_key,
+        arena_t& arena,
+        edges_span_t& edges,
+        ustore_key_t& next_key) noexcept {
+
+        status_t status;
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_vertices = nullptr;
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = status.member_ptr();
+        scan.snapshot = snapshot;
+        scan.arena = arena.member_ptr();
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
+        scan.counts = &found_counts;
+        scan.keys = &found_vertices;
+        ustore_scan(&scan);
+        if (!status)
+            return status;
+
+        ustore_length_t vertices_count = *found_counts;
+        ustore_vertex_degree_t* degrees_per_vertex = nullptr;
+        ustore_key_t* edges_per_vertex = nullptr;
+        ustore_graph_find_edges_t graph_find_edges {};
+        graph_find_edges.db = db;
+        graph_find_edges.error = status.member_ptr();
+        graph_find_edges.snapshot = snapshot;
+        graph_find_edges.arena = arena.member_ptr();
+        graph_find_edges.options = ustore_option_dont_discard_memory_k;
+        graph_find_edges.tasks_count = vertices_count;
+        graph_find_edges.collections = &collection;
+        graph_find_edges.vertices = found_vertices;
+        graph_find_edges.vertices_stride = sizeof(ustore_key_t);
+        graph_find_edges.roles = &role;
+        graph_find_edges.degrees_per_vertex = &degrees_per_vertex;
+        graph_find_edges.edges_per_vertex = &edges_per_vertex;
+        ustore_graph_find_edges(&graph_find_edges);
+        if (!status)
+            return status;
+
+        auto edges_begin = reinterpret_cast<edge_t*>(edges_per_vertex);
+        auto edges_count = transform_reduce_n(degrees_per_vertex, vertices_count, 0ul, [](ustore_vertex_degree_t deg) {
+            return deg == ustore_vertex_degree_missing_k ? 0 : deg;
+        });
+        edges = {edges_begin, edges_begin + edges_count};
+        next_key = vertices_count < read_ahead ? ustore_key_unknown_k : found_vertices[vertices_count - 1] + 1;
+        return {};
+    }
+
+    status_t prefetch_background(ustore_key_t vertex_id) noexcept {
+        fetched_offset_ = 0;
+        if (vertex_id == ustore_key_unknown_k) {
+            fetched_edges_ = {};
+            next_vertex_ = vertex_id;
+            return {};
+        }
+
+        status_t status;
+        if (background_->upcoming_key() != vertex_id)
+            status = background_->restart(vertex_id);
+        if (status)
+            status = background_->next(fetched_edges_, next_vertex_);
+        return status;
+    }
+
     status_t prefetch_gather() noexcept {
 
         auto vertices = vertex_stream_.keys_batch().strided();
@@ -83,7 +167,8 @@ class graph_stream_t {
                    ustore_snapshot_t snap = 0,
                    std::size_t read_ahead_vertices = keys_stream_t::default_read_ahead_k,
                    ustore_vertex_role_t role = ustore_vertex_role_any_k) noexcept
-        : db_(db), collection_(collection), transaction_(txn), snapshot_(snap), role_(role), arena_(db),
+        : db_(db), collection_(collection), transaction_(txn), snapshot_(snap), role_(role),
+          read_ahead_vertices_(read_ahead_vertices), arena_(db),
           vertex_stream_(db, collection, read_ahead_vertices, txn) {}
 
     graph_stream_t(graph_stream_t&&) = default;
@@ -92,7 +177,38 @@ class graph_stream_t {
     graph_stream_t(graph_stream_t const&) = delete;
     graph_stream_t& operator=(graph_stream_t const&) = delete;
 
+    /**
+     * @brief Gathers up to `windows_ahead` following windows of edges in a separate thread, each into its
+     * own arena. Zero returns to synchronous fetches. Transactions aren't thread-safe, so their fetches stay
+     * synchronous.
+     */
+    status_t fetch_in_background(std::size_t windows_ahead = 1) noexcept {
+        background_.reset();
+        if (!windows_ahead || transaction_)
+            return {};
+        try {
+            auto fetch = [db = db_,
+                          collection = collection_,
+                          snapshot = snapshot_,
+                          role = role_,
+                          read_ahead = static_cast<ustore_length_t>(read_ahead_vertices_)](ustore_key_t start_key,
+                                                                                          arena_t& arena,
+                                                                                          edges_span_t& edges,
+                                                                                          ustore_key_t& next_key) noexcept {
+                return fetch_window(db, collection, snapshot, role, read_ahead, start_key, arena, edges, next_key);
+            };
+            background_ = std::make_unique<background_t>(db_, windows_ahead, fetch);
+        }
+        catch (...) {
+            return status_t::status_view("Failed to allocate memory!");
+        }
+        next_vertex_ = vertex_stream_.next_batch_key();
+        return next_vertex_ == ustore_key_unknown_k ? status_t {} : background_->restart(next_vertex_);
+    }
+
     status_t seek(ustore_key_t vertex_id) noexcept {
+        if (background_)
+            return prefetch_background(vertex_id);
         auto status = vertex_stream_.seek(vertex_id);
         if (!status)
             return status;
@@ -101,12 +217,8 @@ class graph_stream_t {
 
     status_t advance() noexcept {
 
-        if (fetched_offset_ >= fetched_edges_.size() - 1) {
-            auto status = vertex_stream_.seek_to_next_batch();
-            if (!status)
-                return status;
-            return prefetch_gather();
-        }
+        if (fetched_offset_ >= fetched_edges_.size() - 1)
+            return seek_to_next_batch();
 
         ++fetched_offset_;
         return {};
@@ -131,6 +243,8 @@ class graph_stream_t {
     edge_t operator*() const noexcept { return edge(); }
     status_t seek_to_first() noexcept { return seek(std::numeric_limits<ustore_key_t>::min()); }
     status_t seek_to_next_batch() noexcept {
+        if (background_)
+            return prefetch_background(next_vertex_);
         auto status = vertex_stream_.seek_to_next_batch();
         if (!status)
             return status;
@@ -146,15 +260,21 @@ class graph_stream_t {
         return fetched_edges_;
     }
 
-    bool is_end() const noexcept { return vertex_stream_.is_end() && fetched_offset_ >= fetched_edges_.size(); }
+    bool is_end() const noexcept {
+        bool vertices_end = background_ ? next_vertex_ == ustore_key_unknown_k : vertex_stream_.is_end();
+        return vertices_end && fetched_offset_ >= fetched_edges_.size();
+    }
 
     bool operator==(graph_stream_t const& other) const noexcept {
+        if (background_ || other.background_) {
+            if (is_end() || other.is_end())
+                return is_end() == other.is_end();
+            return edge() == other.edge();
+        }
         return vertex_stream_ == other.vertex_stream_ && fetched_offset_ == other.fetched_offset_;
     }
 
-    bool operator!=(graph_stream_t const& other) const noexcept {
-        return vertex_stream_ != other.vertex_stream_ || fetched_offset_ != other.fetched_offset_;
-    }
+    bool operator!=(graph_stream_t const& other) const noexcept { return !operator==(other); }
 };
 
 } // namespace unum::ustore
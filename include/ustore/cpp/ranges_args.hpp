@@ -12,6 +12,7 @@
 
 #include "ustore/cpp/ranges.hpp" // `strided_iterator_gt`
 #include "ustore/cpp/status.hpp" // `return_error_if_m`
+#include "ustore/async.h"         // `ustore_submit_t`
 
 namespace unum::ustore {
 
@@ -100,6 +101,98 @@ struct contents_arg_t {
     }
 };
 
+/**
+ * @brief Places in a single collection with a dense array of keys, the most common layout.
+ * Mirrors the interface of `places_arg_t`, so that hot loops written as generic lambdas
+ * can be compiled for it without multiplying strides or checking for NULLs per element.
+ * @see `dispatch_places()`.
+ */
+struct dense_places_t {
+    using value_type = place_t;
+    ustore_collection_t collection {ustore_collection_main_k};
+    ustore_key_t const* keys_begin {nullptr};
+    ustore_size_t count {0};
+
+    inline std::size_t size() const noexcept { return count; }
+    inline place_t operator[](std::size_t i) const noexcept { return {collection, keys_begin[i], nullptr}; }
+    inline bool same_collection() const noexcept { return true; }
+};
+
+/**
+ * @brief Values without a presence bitmask, addressed by dense arrays of lengths and offsets.
+ * Mirrors the interface of `contents_arg_t`, just like `dense_places_t`.
+ *
+ * @tparam shared_buffer_ak Whether all the values are packed into one buffer, as in Apache Arrow,
+ *                          or every value has a separate pointer.
+ * @tparam lengths_ak       Whether the lengths are passed explicitly, or derived from N+1 offsets.
+ * @see `dispatch_contents()`.
+ */
+template <bool shared_buffer_ak, bool lengths_ak>
+struct dense_contents_gt {
+    using value_type = value_view_t;
+    ustore_bytes_cptr_t const* contents_begin {nullptr};
+    ustore_length_t const* offsets_begin {nullptr};
+    ustore_length_t const* lengths_begin {nullptr};
+    ustore_size_t count {0};
+
+    inline std::size_t size() const noexcept { return count; }
+    inline value_view_t operator[](std::size_t i) const noexcept {
+        auto begin = reinterpret_cast<byte_t const*>(contents_begin[shared_buffer_ak ? 0 : i]);
+        if (!begin)
+            return {};
+        if constexpr (lengths_ak) {
+            auto off = offsets_begin ? offsets_begin[i] : 0u;
+            return {begin + off, lengths_begin[i]};
+        }
+        else
+            return {begin + offsets_begin[i], offsets_begin[i + 1] - offsets_begin[i]};
+    }
+};
+
+/**
+ * @brief Calls @p callback with a `dense_places_t`, if the keys are dense and belong to the
+ * same collection, or with the original @p places otherwise. The callback is expected to be
+ * a generic lambda, instantiated for both layouts.
+ */
+template <typename callback_at>
+decltype(auto) dispatch_places(places_arg_t const& places, callback_at&& callback) {
+    bool const dense = places.keys_begin.is_continuous() && !places.fields_begin &&
+                       (!places.collections_begin || places.collections_begin.repeats());
+    if (!dense)
+        return callback(places);
+
+    ustore_collection_t collection = places.collections_begin ? places.collections_begin[0] : ustore_collection_main_k;
+    return callback(dense_places_t {collection, places.keys_begin.get(), places.count});
+}
+
+/**
+ * @brief Calls @p callback with one of the `dense_contents_gt` layouts, if the @p contents fit
+ * any of them, or with the original @p contents otherwise. Like with `dispatch_places()`,
+ * the callback is expected to be a generic lambda.
+ */
+template <typename callback_at>
+decltype(auto) dispatch_contents(contents_arg_t const& contents, callback_at&& callback) {
+
+    auto const& ptrs = contents.contents_begin;
+    auto const& offs = contents.offsets_begin;
+    auto const& lens = contents.lengths_begin;
+    bool const dense_ptrs = ptrs && (ptrs.repeats() || ptrs.is_continuous());
+    bool const dense_offs = !offs || offs.is_continuous();
+    bool const dense_lens = lens ? lens.is_continuous() : bool(offs);
+    bool const dense = !contents.presences_begin && dense_ptrs && dense_offs && dense_lens;
+    if (!dense)
+        return callback(contents);
+
+    if (lens) {
+        if (ptrs.repeats())
+            return callback(dense_contents_gt<true, true> {ptrs.get(), offs.get(), lens.get(), contents.count});
+        return callback(dense_contents_gt<false, true> {ptrs.get(), offs.get(), lens.get(), contents.count});
+    }
+    if (ptrs.repeats())
+        return callback(dense_contents_gt<true, false> {ptrs.get(), offs.get(), nullptr, contents.count});
+    return callback(dense_contents_gt<false, false> {ptrs.get(), offs.get(), nullptr, contents.count});
+}
+
 struct scan_t {
     ustore_collection_t collection;
     ustore_key_t min_key;
@@ -255,6 +348,15 @@ inline bool enum_is_subset(enum_at enum_value, allowed_mask_at allowed) noexcept
     return (enum_value & ~allowed) == 0;
 }
 
+/**
+ * @brief Options choosing the kind of memory for the exported data.
+ */
+constexpr int arena_options_k =        //
+    ustore_option_arena_numa_local_k |  //
+    ustore_option_arena_huge_pages_k |  //
+    ustore_option_arena_giant_pages_k | //
+    ustore_option_arena_unified_k;
+
 inline void validate_write(ustore_transaction_t const c_txn,
                            places_arg_t const& places,
                            contents_arg_t const& contents,
@@ -264,7 +366,8 @@ inline void validate_write(ustore_transaction_t const c_txn,
     auto allowed_options =                       //
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
-        ustore_option_write_flush_k;
+        ustore_option_write_flush_k |            //
+        ustore_option_write_bulk_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
 
     return_error_if_m(places.keys_begin, c_error, args_wrong_k, "No keys were provided!");
@@ -297,7 +400,9 @@ inline void validate_read(ustore_transaction_t const c_txn,
     auto allowed_options =                       //
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
-        ustore_option_read_shared_memory_k;
+        ustore_option_read_shared_memory_k |     //
+        ustore_option_read_bypass_cache_k |      //
+        arena_options_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
 
     return_error_if_m(places.keys_begin, c_error, args_wrong_k, "No keys were provided!");
@@ -324,7 +429,8 @@ inline void validate_scan(ustore_transaction_t const c_txn,
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
         ustore_option_read_shared_memory_k |     //
-        ustore_option_scan_bulk_k;
+        ustore_option_scan_bulk_k |              //
+        arena_options_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
 
     return_error_if_m(args.limits, c_error, args_wrong_k, "Full scans aren't supported - paginate!");
@@ -342,6 +448,14 @@ inline void validate_scan(ustore_transaction_t const c_txn,
                           "Current engine does not support transactions!");
 }
 
+inline void validate_submit(ustore_submit_t const& c, ustore_error_t* c_error) noexcept {
+
+    return_error_if_m(c.db, c_error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.future, c_error, args_wrong_k, "No output future was provided!");
+    auto tasks_count = bool(c.read) + bool(c.write) + bool(c.scan) + bool(c.sample);
+    return_error_if_m(tasks_count == 1, c_error, args_combo_k, "Exactly one operation must be submitted!");
+}
+
 inline void validate_transaction_begin(ustore_transaction_t const c_txn,
                                        ustore_options_t const c_options,
                                        ustore_error_t* c_error) noexcept {
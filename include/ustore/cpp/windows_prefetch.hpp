@@ -0,0 +1,166 @@
+/**
+ * @file windows_prefetch.hpp
+ * @author Ashot Vardanian
+ * @addtogroup Cpp
+ *
+ * @brief Background read-ahead for the streams, that fetch keys in windows.
+ *
+ * Every window starts where the previous one ended, so they can only be fetched
+ * one after another. A dedicated thread does that ahead of the consumer, into
+ * separate arenas, so that the window being processed stays valid, while the
+ * following ones are already travelling over the network or from disk.
+ */
+
+#pragma once
+#include <algorithm>          // `std::max`
+#include <condition_variable> // `std::condition_variable`
+#include <functional>         // `std::function`
+#include <mutex>              // `std::mutex`
+#include <thread>             // `std::thread`
+#include <vector>             // `std::vector`
+
+#include "ustore/db.h"
+#include "ustore/cpp/types.hpp"  // `arena_t`
+#include "ustore/cpp/status.hpp" // `status_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Fetches up to `windows_ahead` windows past the one, the consumer is processing.
+ * With `windows_ahead` of one, it is a classical double-buffer.
+ *
+ * ## Class Specs
+ * - Concurrency: Must be consumed from a single thread!
+ * - Lifetime: @b Must live shorter then the collection it fetches from.
+ * - Copyable: No.
+ * - Exceptions: Never.
+ */
+template <typename window_at>
+class windows_prefetch_gt {
+  public:
+    /**
+     * @brief Fetches the window, starting at `start_key`, into the `arena`, exporting the first key
+     * of the following window, or `ustore_key_unknown_k`, if this one is the last.
+     */
+    using fetch_t = std::function<status_t(ustore_key_t start_key, arena_t& arena, window_at& window, ustore_key_t& next_key)>;
+
+  private:
+    struct slot_t {
+        arena_t arena;
+        window_at window {};
+        ustore_key_t next_key {ustore_key_unknown_k};
+        status_t status {};
+
+        slot_t(ustore_database_t db) noexcept : arena(db) {}
+    };
+
+    fetch_t fetch_;
+    std::vector<slot_t> slots_;
+    std::size_t windows_ahead_ {0};
+
+    std::mutex mutex_;
+    std::condition_variable produced_cv_;
+    std::condition_variable consumed_cv_;
+    std::thread thread_;
+    std::size_t produced_ {0};
+    std::size_t consumed_ {0};
+    ustore_key_t produce_from_ {ustore_key_unknown_k};
+    ustore_key_t upcoming_key_ {ustore_key_unknown_k};
+    bool stopping_ {false};
+
+    void produce() noexcept {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            consumed_cv_.wait(lock, [&] { return stopping_ || produced_ - consumed_ < windows_ahead_; });
+            if (stopping_ || produce_from_ == ustore_key_unknown_k)
+                return;
+
+            // The slot isn't visible to the consumer, until `produced_` is incremented
+            slot_t& slot = slots_[produced_ % slots_.size()];
+            ustore_key_t start_key = produce_from_;
+            lock.unlock();
+            slot.window = {};
+            slot.next_key = ustore_key_unknown_k;
+            slot.status = fetch_(start_key, slot.arena, slot.window, slot.next_key);
+            lock.lock();
+
+            produce_from_ = slot.status ? slot.next_key : ustore_key_unknown_k;
+            ++produced_;
+            produced_cv_.notify_one();
+        }
+    }
+
+    void stop() noexcept {
+        if (!thread_.joinable())
+            return;
+        {
+            std::unique_lock lock(mutex_);
+            stopping_ = true;
+        }
+        consumed_cv_.notify_one();
+        thread_.join();
+    }
+
+  public:
+    /**
+     * @param windows_ahead Number of windows to keep ready, besides the consumed one.
+     */
+    windows_prefetch_gt(ustore_database_t db, std::size_t windows_ahead, fetch_t&& fetch) noexcept(false)
+        : fetch_(std::move(fetch)), windows_ahead_(std::max<std::size_t>(windows_ahead, 1)) {
+        slots_.reserve(windows_ahead_ + 1);
+        for (std::size_t i = 0; i != windows_ahead_ + 1; ++i)
+            slots_.emplace_back(db);
+    }
+
+    windows_prefetch_gt(windows_prefetch_gt const&) = delete;
+    windows_prefetch_gt& operator=(windows_prefetch_gt const&) = delete;
+    ~windows_prefetch_gt() noexcept { stop(); }
+
+    /**
+     * @brief Drops the fetched windows and starts fetching from the `start_key`.
+     * Invalidates the window, exported by the last `next()`.
+     */
+    status_t restart(ustore_key_t start_key) noexcept {
+        stop();
+        stopping_ = false;
+        produced_ = consumed_ = 0;
+        produce_from_ = upcoming_key_ = start_key;
+        try {
+            thread_ = std::thread(&windows_prefetch_gt::produce, this);
+        }
+        catch (...) {
+            produce_from_ = upcoming_key_ = ustore_key_unknown_k;
+            return status_t::status_view("Failed to spawn a thread!");
+        }
+        return {};
+    }
+
+    /**
+     * @brief First key of the window, that the next `next()` will export.
+     */
+    ustore_key_t upcoming_key() const noexcept { return upcoming_key_; }
+
+    /**
+     * @brief Waits for the following window, releasing the previous one for further fetches.
+     * The `window` stays valid until the next call. Only expects to be called,
+     * while the `upcoming_key()` isn't `ustore_key_unknown_k`.
+     */
+    status_t next(window_at& window, ustore_key_t& next_key) noexcept {
+        std::unique_lock lock(mutex_);
+        produced_cv_.wait(lock, [&] { return produced_ > consumed_; });
+        slot_t& slot = slots_[consumed_ % slots_.size()];
+        ++consumed_;
+        lock.unlock();
+        consumed_cv_.notify_one();
+
+        if (!slot.status) {
+            upcoming_key_ = ustore_key_unknown_k;
+            return std::move(slot.status);
+        }
+        window = slot.window;
+        next_key = upcoming_key_ = slot.next_key;
+        return {};
+    }
+};
+
+} // namespace unum::ustore
@@ -194,6 +194,55 @@ typedef enum {
      * Apache Arrow buffers or standardized Tensor representations.
      */
     ustore_option_read_shared_memory_k = 1 << 5,
+    /**
+     * @brief Transfers the ownership of the written values to the engine, avoiding copies.
+     * Every non-empty value must be a separate allocation from `malloc`, addressed with
+     * zero offsets. Once the arguments are validated, the engine owns the values, even if
+     * the write fails. Engines, that can't adopt the memory, reject the option.
+     * Only applies to non-transactional writes.
+     */
+    ustore_option_write_adopt_k = 1 << 6,
+    /**
+     * @brief Hints, that the write is a part of a bulk load, like an initial import.
+     * Engines may then write the batch directly into persistent structures, bypassing
+     * in-memory buffers and logs, if the batch is big enough. Others treat it as a regular write.
+     * Only applies to non-transactional writes.
+     */
+    ustore_option_write_bulk_k = 1 << 7,
+    /**
+     * @brief Allows `ustore_sample()` to trade uniformity for speed.
+     * Engines may then seek to random points of the keys range, costing time proportional
+     * to the number of samples, instead of the collection size. Keys following wide gaps
+     * in the keys space will be picked more often. Others sample uniformly regardless.
+     */
+    ustore_option_sample_approximate_k = 1 << 8,
+    /**
+     * @brief Skips the client-side read cache, fetching the values from the server.
+     * Is relevant for remote clients opened with a cache. Others ignore it.
+     */
+    ustore_option_read_bypass_cache_k = 1 << 9,
+    /**
+     * @brief Places the exported data into arenas on the NUMA node of the calling CPU,
+     * instead of wherever the allocator finds memory. Mind, that the arena will be read
+     * quicker only from the cores of that node.
+     */
+    ustore_option_arena_numa_local_k = 1 << 10,
+    /**
+     * @brief Backs the arenas with 2 MB pages, bound to the NUMA node of the calling CPU.
+     * Reduces TLB misses on large exports. Falls back to regular pages, if none are reserved.
+     */
+    ustore_option_arena_huge_pages_k = 1 << 11,
+    /**
+     * @brief Backs the arenas with 1 GB pages, bound to the NUMA node of the calling CPU.
+     * Every arena occupies at least a gigabyte. Falls back to 2 MB and then regular pages.
+     */
+    ustore_option_arena_giant_pages_k = 1 << 12,
+    /**
+     * @brief Exports data into memory addressable from both the CPU and the GPU,
+     * like CUDA managed memory, to pass the results to accelerators without copies.
+     * Without GPU support in the build, regular memory is used.
+     */
+    ustore_option_arena_unified_k = 1 << 13,
     /**
      * @brief When set, the underlying engine may avoid strict keys ordering
      * and may include irrelevant (deleted & duplicate) keys in order to maximize
@@ -469,6 +518,12 @@ void ustore_collection_drop(ustore_collection_drop_t*);
  * - "compact": Flushes and compacts all the data in LSM-tree implementations.
  * - "info":    Metadata about the current software version, used for debugging.
  * - "usage":   Metadata about approximate collection sizes, RAM and disk usage.
+ * - "arenas":  Process-wide counters of memory arenas and the usage of the passed one.
+ * - "metrics": Counters and latency quantiles of API calls, if compiled with `USTORE_USE_METRICS`.
+ * - "metrics/prometheus": Same metrics in the Prometheus text exposition format.
+ * - "traces":  Spans finished since the last request in OTLP/JSON, if compiled with `USTORE_USE_TRACING`.
+ * - "export_image <path>": Writes all the pairs into a file, that UCSet can memory-map on start.
+ * - "migrate_keys <native|bytewise> <path>": Copies a RocksDB or LevelDB into a new one with another key format.
  */
 typedef struct ustore_database_control_t {
     /** @brief Already open database instance. */
@@ -508,6 +563,8 @@ typedef struct ustore_transaction_init_t {
      * @brief Transaction options.
      *
      * Possible values:
+     * - `::ustore_option_transaction_dont_watch_k`: Won't watch any reads or writes of this transaction,
+     *   so it can't conflict on commit. Read-only transactions can avoid the tracking costs that way.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
      */
     ustore_options_t options;
@@ -95,6 +95,17 @@ typedef enum ustore_doc_modification_t {
     ustore_doc_modify_merge_k = 4,
 } ustore_doc_modification_t;
 
+/**
+ * @brief Reduction of field values to be computed by `ustore_docs_aggregate()`.
+ */
+typedef enum ustore_doc_aggregation_t {
+    ustore_doc_aggregate_count_k = 0,
+    ustore_doc_aggregate_sum_k = 1,
+    ustore_doc_aggregate_min_k = 2,
+    ustore_doc_aggregate_max_k = 3,
+    ustore_doc_aggregate_avg_k = 4,
+} ustore_doc_aggregation_t;
+
 /*********************************************************/
 /*****************	 Primary Functions	  ****************/
 /*********************************************************/
@@ -110,6 +121,12 @@ typedef enum ustore_doc_modification_t {
  * With documents, you can skip the `keys` and pass just `fields`, which will be
  * used to dynamically extract the keys. To make it compatible with MongoDB and
  * ElasticSearch you can pass @b "_id" into `fields`.
+ *
+ * ## Secondary Indexes
+ *
+ * If the collection has indexes, declared with `ustore_docs_index_create()`,
+ * or materialized columns, declared with `ustore_docs_column_create()`,
+ * the affected index entries and cells are written in the same batch with the documents.
  */
 
 typedef struct ustore_docs_write_t {
@@ -207,6 +224,13 @@ typedef struct ustore_docs_read_t {
     ustore_str_view_t const* fields;
     ustore_size_t fields_stride;
 
+    /**
+     * @brief Number of threads to split the parsing of documents between.
+     * Zero or one means that only the calling thread is used.
+     * Small batches are parsed in the calling thread regardless.
+     */
+    ustore_size_t threads_count;
+
     /// @}
     /// @name Outputs
     /// @{
@@ -230,6 +254,13 @@ void ustore_docs_read(ustore_docs_read_t*);
 /**
  * @brief Lists fields & paths present in wanted documents or entire collections.
  * @see `ustore_docs_gist()`.
+ *
+ * Listing the fields of specific documents parses every one of them.
+ * Entire collections are listed from their field catalogs without touching
+ * the documents, if the `keys` are NULL. Then the `docs_count` is the number
+ * of `collections` and the number of documents with every field and
+ * its suggested type are optionally exported as well.
+ * @see `ustore_docs_catalog_set_t`.
  */
 typedef struct ustore_docs_gist_t {
 
@@ -269,6 +300,17 @@ typedef struct ustore_docs_gist_t {
     ustore_length_t** offsets;
     ustore_char_t** fields;
 
+    /**
+     * @brief Number of documents with every field, exported only for entire collections.
+     * Is @b optional.
+     */
+    ustore_size_t** counts;
+    /**
+     * @brief Narrowest type, that fits all the values of every field, exported only for entire collections.
+     * Is @b optional.
+     */
+    ustore_doc_field_type_t** types;
+
     /// @}
 
 } ustore_docs_gist_t;
@@ -317,6 +359,12 @@ void ustore_docs_gist(ustore_docs_gist_t*);
  * entries in every column, but the contents of the joined string will be organized
  * in a @b row-major order. It will make the data easier to pass into bulk text-search
  * systems or Language Models training pipelines.
+ *
+ * ## Materialized Columns
+ *
+ * Fields, materialized with `ustore_docs_column_create()` under the exact same name,
+ * are read from the cached cells, instead of parsing the documents.
+ * If all the requested fields are materialized, the documents aren't even read.
  */
 
 typedef struct ustore_docs_gather_t {
@@ -353,9 +401,21 @@ typedef struct ustore_docs_gather_t {
     ustore_str_view_t const* fields;
     ustore_size_t fields_stride;
 
+    /**
+     * @brief Types of the exported columns.
+     * Fields of the `ustore_doc_field_default_k` type take the type, suggested by the field
+     * catalogs of the collections of the documents, or are exported as strings without catalogs.
+     */
     ustore_doc_field_type_t const* types;
     ustore_size_t types_stride;
 
+    /**
+     * @brief Number of threads to split the parsing of documents between.
+     * Zero or one means that only the calling thread is used.
+     * The exported columns are identical for any number of threads.
+     */
+    ustore_size_t threads_count;
+
     /// @}
     /// @name Outputs
     /// @{
@@ -370,6 +430,12 @@ typedef struct ustore_docs_gather_t {
     ustore_length_t*** columns_lengths;
     ustore_byte_t** joined_strings;
 
+    /**
+     * @brief Types of the exported columns, with the default ones resolved.
+     * Is @b optional.
+     */
+    ustore_doc_field_type_t** columns_types;
+
     /// @}
 
 } ustore_docs_gather_t;
@@ -381,6 +447,493 @@ typedef struct ustore_docs_gather_t {
  */
 void ustore_docs_gather(ustore_docs_gather_t*);
 
+/**
+ * @brief Computes aggregates of fields over all the documents in a range of keys,
+ * optionally grouped by the values of another field.
+ * @see `ustore_docs_aggregate()`.
+ *
+ * ## Values and Groups
+ *
+ * Fields are cast to 64-bit floats, just like with `ustore_docs_gather()`,
+ * so materialized columns and field catalogs apply here as well. Documents missing
+ * the field, or holding values, that can't be cast, are skipped by its aggregations.
+ * Counting a NULL field counts the documents themselves.
+ *
+ * The grouping field is cast to strings. Groups are sorted by those strings bytes,
+ * and the documents missing it form the last group, which has a missing length.
+ * Without a grouping field, there is exactly one such group, even in empty ranges.
+ *
+ * ## Streaming
+ *
+ * Documents are read in batches, parsed by `threads_count` threads, each taking a
+ * contiguous range of keys, and only the results are kept in the `arena`. Through
+ * the Arrow Flight client the whole aggregation is evaluated by the server.
+ */
+typedef struct ustore_docs_aggregate_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    /** @brief Optional inclusive lower bound for the keys of aggregated documents. */
+    ustore_key_t const* min_key;
+    /** @brief Optional inclusive upper bound for the keys of aggregated documents. */
+    ustore_key_t const* max_key;
+
+    ustore_size_t aggregations_count;
+
+    ustore_doc_aggregation_t const* functions;
+    ustore_size_t functions_stride;
+
+    /** @brief Aggregated fields. Can be NULL only for `::ustore_doc_aggregate_count_k`. */
+    ustore_str_view_t const* fields;
+    ustore_size_t fields_stride;
+
+    /** @brief Optional field to group the documents by, preferably with few distinct values. */
+    ustore_str_view_t group_by;
+
+    /**
+     * @brief Number of threads to split the parsing of documents between.
+     * Zero or one means that only the calling thread is used.
+     * The results are identical for any number of threads.
+     */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    ustore_size_t* groups_count;
+    /** @brief Offsets of grouping values in `groups_strings`, with one more trailing entry. */
+    ustore_length_t** groups_offsets;
+    /** @brief Lengths of grouping values, missing for the group of documents without them. */
+    ustore_length_t** groups_lengths;
+    ustore_byte_t** groups_strings;
+
+    /**
+     * @brief Number of values aggregated in every group, `aggregations_count` arrays
+     * of `groups_count` entries each. Is @b optional.
+     */
+    ustore_size_t** counts;
+    /**
+     * @brief Results, laid out like `counts`. Minimums, maximums and averages
+     * of groups without aggregated values are NaNs.
+     */
+    double** results;
+
+    /// @}
+
+} ustore_docs_aggregate_t;
+
+/**
+ * @brief Vectorized "aggregate" interface, that reduces fields of documents
+ * into counts, sums, minimums, maximums and averages, without exporting them.
+ * @see `ustore_docs_aggregate_t`.
+ */
+void ustore_docs_aggregate(ustore_docs_aggregate_t*);
+
+/*********************************************************/
+/*****************	 Secondary Indexes	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Declares an ordered secondary index on a field of documents in a collection.
+ * @see `ustore_docs_index_create()`.
+ *
+ * ## Storage
+ *
+ * Every index is stored in a hidden collection, named like the indexed one,
+ * followed by `.index.f64:` or `.index.str:` and the field. Its keys are the
+ * field values, mapped into integers preserving the order, and its values are
+ * the sorted IDs of documents with those field values. Numbers of all types are
+ * compared as 64-bit floats, and strings - lexicographically by bytes.
+ *
+ * ## Maintenance
+ *
+ * Once declared, the index is updated by every `ustore_docs_write()` into the
+ * collection, in the same batch with the documents. Documents missing the field,
+ * or holding a value of another type, aren't indexed. Arrays aren't expanded.
+ * Concurrent writers of documents with the same field values should use transactions,
+ * as all IDs sharing a value are rewritten together. For the same reason indexes
+ * suit selective fields best. Clearing the collection with `ustore_collection_drop()`
+ * doesn't clear its indexes.
+ */
+typedef struct ustore_docs_index_create_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read and write options for indexing the existing documents. @see `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The collection of documents to index. */
+    ustore_collection_t collection;
+    /** @brief Field name or a JSON-Pointer path to index. */
+    ustore_str_view_t field;
+    /** @brief `::ustore_doc_field_str_k` for strings or any numeric type for numbers. */
+    ustore_doc_field_type_t type;
+
+    /// @}
+
+} ustore_docs_index_create_t;
+
+/**
+ * @brief Declares a secondary index and indexes the existing documents.
+ * @see `ustore_docs_index_create_t`.
+ */
+void ustore_docs_index_create(ustore_docs_index_create_t*);
+
+/**
+ * @brief Removes a secondary index, declared with `ustore_docs_index_create()`.
+ * @see `ustore_docs_index_drop()`.
+ */
+typedef struct ustore_docs_index_drop_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Drop options. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    ustore_str_view_t field;
+    ustore_doc_field_type_t type;
+
+    /// @}
+
+} ustore_docs_index_drop_t;
+
+/**
+ * @brief Removes a secondary index.
+ * @see `ustore_docs_index_drop_t`.
+ */
+void ustore_docs_index_drop(ustore_docs_index_drop_t*);
+
+/**
+ * @brief Finds the IDs of documents, which indexed field lies in an inclusive range.
+ * @see `ustore_docs_find()`, `ustore_docs_index_create_t`.
+ *
+ * Bounds are passed as text: strings as they are, numbers in the decimal notation.
+ * Passing the same bound twice is an equality lookup. The IDs are exported in the
+ * order of field values, and then in the order of IDs.
+ */
+typedef struct ustore_docs_find_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    /** @brief The indexed field, exactly as passed to `ustore_docs_index_create()`. */
+    ustore_str_view_t field;
+    /** @brief Type of the index: `::ustore_doc_field_str_k` or any numeric type. */
+    ustore_doc_field_type_t type;
+    /** @brief Optional inclusive lower bound. */
+    ustore_str_view_t min_value;
+    /** @brief Optional inclusive upper bound. */
+    ustore_str_view_t max_value;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    ustore_size_t* count;
+    ustore_key_t** keys;
+
+    /// @}
+
+} ustore_docs_find_t;
+
+/**
+ * @brief Equality and range lookups of documents through secondary indexes.
+ * @see `ustore_docs_find_t`.
+ */
+void ustore_docs_find(ustore_docs_find_t*);
+
+/**
+ * @brief Materializes a field of every document in a hidden collection.
+ * @see `ustore_docs_column_create()`.
+ *
+ * The cells are named like the collection, followed by the ".column:" infix and the field.
+ * Every cell keeps the type of the value and its binary representation, updated by
+ * `ustore_docs_write()` in the same batch with the document, so it never goes stale.
+ * Repeated `ustore_docs_gather()` calls over hot fields can then skip JSON parsing,
+ * trading extra work on every write for cheaper analytical reads.
+ */
+typedef struct ustore_docs_column_create_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options for filling the column with present documents. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    /** @brief JSON-Pointer to the materialized field, matched exactly in `ustore_docs_gather_t::fields`. */
+    ustore_str_view_t field;
+
+    /// @}
+
+} ustore_docs_column_create_t;
+
+/**
+ * @brief Creates a materialized column, filling it with the present documents.
+ * @see `ustore_docs_column_create_t`.
+ */
+void ustore_docs_column_create(ustore_docs_column_create_t*);
+
+typedef struct ustore_docs_column_drop_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Drop options. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    ustore_str_view_t field;
+
+    /// @}
+
+} ustore_docs_column_drop_t;
+
+/**
+ * @brief Removes a materialized column.
+ * @see `ustore_docs_column_drop_t`.
+ */
+void ustore_docs_column_drop(ustore_docs_column_drop_t*);
+
+/*********************************************************/
+/*****************	   Storage Formats	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Forms, in which a collection stores its documents.
+ * @see `ustore_docs_storage_set_t`.
+ */
+typedef enum ustore_doc_storage_t {
+    /** @brief JSON texts, exported by `ustore_docs_read()` without any conversions. */
+    ustore_doc_storage_json_k = 0,
+    /** @brief Already parsed trees, searched without parsing and transcoded to JSON only on exports. */
+    ustore_doc_storage_packed_k = 1,
+} ustore_doc_storage_t;
+
+/**
+ * @brief Changes the form, in which the documents of a collection are stored.
+ * @see `ustore_docs_storage_set()`.
+ *
+ * Packed documents keep the tree of values of a parsed JSON with relative offsets
+ * between the nodes, so `ustore_docs_gather()` and `ustore_docs_read()` of fields
+ * seek them in place, and partial updates skip parsing the stored version.
+ * Packed collections are marked with an empty hidden collection, named like the collection,
+ * followed by the ".storage:packed" suffix. Present documents are converted, when the form changes,
+ * while the interfaces keep accepting and exporting JSON, BSON and MsgPack, as before.
+ */
+typedef struct ustore_docs_storage_set_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options for converting the present documents. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    ustore_doc_storage_t storage;
+
+    /// @}
+
+} ustore_docs_storage_set_t;
+
+/**
+ * @brief Changes the storage form of a collection, converting the present documents.
+ * @see `ustore_docs_storage_set_t`.
+ */
+void ustore_docs_storage_set(ustore_docs_storage_set_t*);
+
+/**
+ * @brief Compresses the documents of a collection with a shared dictionary.
+ * @see `ustore_docs_compression_set()`.
+ *
+ * Small documents of the same schema compress poorly one by one, as the repeated keys
+ * and values are spread across different entries. A dictionary, trained on a uniform
+ * sample of the present documents, captures those repetitions once, so that every
+ * document is compressed with ZStandard against it and decompressed into the `arena`
+ * on reads, while the interfaces keep exchanging JSON, BSON and MsgPack, as before.
+ *
+ * Dictionaries are stored in a hidden collection, named like the collection,
+ * followed by the ".storage:zstd" suffix. Training a new dictionary or disabling
+ * the compression converts the present documents. Compression composes with the
+ * packed storage form, compressing the packed documents.
+ */
+typedef struct ustore_docs_compression_set_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options for converting the present documents. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    /**
+     * @brief Number of present documents to sample for training.
+     * Zero disables the compression, decompressing the present documents.
+     */
+    ustore_size_t samples_count;
+    /**
+     * @brief Capacity of the trained dictionary in bytes, 32 KB by default.
+     * Is @b optional.
+     */
+    ustore_size_t dictionary_size;
+
+    /// @}
+
+} ustore_docs_compression_set_t;
+
+/**
+ * @brief Trains a shared dictionary for a collection, compressing its documents, or disables it.
+ * @see `ustore_docs_compression_set_t`.
+ */
+void ustore_docs_compression_set(ustore_docs_compression_set_t*);
+
+/*********************************************************/
+/*****************	    Field Catalogs	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Enables or disables the field catalog of a collection.
+ * @see `ustore_docs_catalog_set()`.
+ *
+ * The catalog counts the documents, holding every kind of scalar value under
+ * every path, and is updated atomically with every write. So `ustore_docs_gist()`
+ * of the entire collection and the types of `ustore_docs_gather()` columns turn into
+ * a lookup, instead of sampling the documents. Catalogs are stored in a hidden collection,
+ * named like the collection, followed by the ".catalog" suffix, and are filled with the
+ * present documents, when enabled. Counts may drift, if documents are written concurrently.
+ */
+typedef struct ustore_docs_catalog_set_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options for filling the catalog. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    bool enabled;
+
+    /// @}
+
+} ustore_docs_catalog_set_t;
+
+/**
+ * @brief Enables the field catalog of a collection, filling it with the present documents, or drops it.
+ * @see `ustore_docs_catalog_set_t`.
+ */
+void ustore_docs_catalog_set(ustore_docs_catalog_set_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
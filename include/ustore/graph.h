@@ -48,6 +48,12 @@
  * If working with Hyper-Graphs (multiple vertices linked by one edge), you are expected
  * to use Undirected Graphs, with vertices and hyper-edges mixed together. You would be
  * differentiating them not by parent collection, but by stored metadata at runtime.
+ *
+ * ## Companion Collections
+ *
+ * High-degree vertices keep parts of their adjacency lists in collections named like
+ * the graph one, but with ".deltas" and ".buckets" suffixes. They are dropped or cleared
+ * with it by `ustore_collection_drop()`.
  */
 
 #pragma once
@@ -86,6 +92,19 @@ typedef enum ustore_vertex_role_t {
 typedef uint32_t ustore_vertex_degree_t;
 extern ustore_vertex_degree_t ustore_vertex_degree_missing_k;
 
+/**
+ * @brief Binary layout of the neighborhood stored for every vertex.
+ *
+ * Plain neighborhoods keep 16 bytes per every edge of a vertex. Packed ones keep
+ * sorted neighbor IDs as deltas and edge IDs as a separate stream, both bit-packed
+ * in blocks of 128. Layouts can be mixed within a collection, as every vertex
+ * is marked with its own layout, and reads handle both transparently.
+ */
+typedef enum ustore_graph_encoding_t {
+    ustore_graph_encoding_plain_k = 0,
+    ustore_graph_encoding_packed_k = 1,
+} ustore_graph_encoding_t;
+
 /*********************************************************/
 /*****************	 Primary Functions	  ****************/
 /*********************************************************/
@@ -159,6 +178,20 @@ typedef struct ustore_graph_find_edges_t {
     /** @brief Step between `roles`. */
     ustore_size_t roles_stride;
 
+    /**
+     * @brief Optional inclusive lower bounds for the IDs of exported neighbors.
+     * Either of `neighbors_min` and `neighbors_max` may be omitted, leaving that side
+     * of the range open. For high-degree vertices, split into buckets, only the buckets
+     * overlapping the range are read.
+     */
+    ustore_key_t const* neighbors_min;
+    /** @brief Step between `neighbors_min`. */
+    ustore_size_t neighbors_min_stride;
+    /** @brief Optional inclusive upper bounds for the IDs of exported neighbors. */
+    ustore_key_t const* neighbors_max;
+    /** @brief Step between `neighbors_max`. */
+    ustore_size_t neighbors_max_stride;
+
     /// @}
     /// @name Outputs
     /// @{
@@ -176,6 +209,351 @@ typedef struct ustore_graph_find_edges_t {
  */
 void ustore_graph_find_edges(ustore_graph_find_edges_t*);
 
+/**
+ * @brief Expands the neighborhoods of given vertices breadth-first.
+ * @see `ustore_graph_traverse()`.
+ *
+ * Every hop reads the adjacency lists of the previous frontier and keeps
+ * only the vertices never visited before, so every vertex is reported once,
+ * at the smallest number of hops from the `sources`. Replaces a chain of
+ * `ustore_graph_find_edges()` calls without exporting the edges themselves.
+ */
+typedef struct ustore_graph_traverse_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph collection to traverse. */
+    ustore_collection_t collection;
+
+    /** @brief Number of starting vertices. Duplicates are ignored. */
+    ustore_size_t sources_count;
+    ustore_key_t const* sources;
+    ustore_size_t sources_stride;
+
+    /**
+     * @brief The role of the frontier vertices within the followed edges.
+     * `::ustore_vertex_source_k` follows outgoing edges, `::ustore_vertex_target_k` - incoming,
+     * and `::ustore_vertex_role_any_k` ignores the direction.
+     */
+    ustore_vertex_role_t role;
+
+    /** @brief Maximum number of hops from `sources`. */
+    ustore_size_t hops;
+
+    /**
+     * @brief Optional limits on the number of neighbors followed from every vertex, one per hop.
+     * Neighbors are followed in ascending order of their IDs, outgoing before incoming.
+     * Zero stride broadcasts the same limit to every hop, NULL or zero limit means no limit.
+     */
+    ustore_size_t const* fanouts;
+    /** @brief Step between `fanouts`. */
+    ustore_size_t fanouts_stride;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /**
+     * @brief Visited vertices, starting with the deduplicated sources, grouped by hops.
+     * Within a single hop, vertices are sorted.
+     */
+    ustore_key_t** visited;
+    /** @brief Total number of `visited` vertices. */
+    ustore_size_t* visited_count;
+    /**
+     * @brief Optional `hops + 2` offsets into `visited`, where the vertices discovered
+     * on the `i`-th hop span from `offsets_per_hop[i]` to `offsets_per_hop[i + 1]`.
+     */
+    ustore_length_t** offsets_per_hop;
+
+    /// @}
+
+} ustore_graph_traverse_t;
+
+/**
+ * @brief Finds all the vertices within a given number of hops from the sources.
+ * @see `ustore_graph_traverse_t`.
+ */
+void ustore_graph_traverse(ustore_graph_traverse_t*);
+
+/**
+ * @brief Exports the whole graph or a range of its vertices in the Compressed Sparse Row format.
+ * @see `ustore_graph_export_csr()`.
+ *
+ * Vertices are exported in the ascending order of their IDs, and the neighbors
+ * of the `i`-th vertex span from `offsets[i]` to `offsets[i + 1]` in `neighbors`.
+ * Neighbors and edge IDs are placed into a single allocation of known size.
+ * Without `neighbors`, only the degrees are parsed from the headers of entries,
+ * producing the `offsets` without decoding any neighborhoods.
+ * Disjoint key ranges can be exported from separate threads with separate arenas.
+ */
+typedef struct ustore_graph_export_csr_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /**
+     * @brief A snapshot captures a point-in-time view of the DB at the time it's created.
+     * Without one, concurrent updates of exported vertices may fail the export.
+     */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_scan_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph collection to export. */
+    ustore_collection_t collection;
+
+    /**
+     * @brief The role of exported vertices within the exported edges.
+     * `::ustore_vertex_source_k` exports successors, `::ustore_vertex_target_k` - predecessors,
+     * and `::ustore_vertex_role_any_k` - both, outgoing before incoming.
+     */
+    ustore_vertex_role_t role;
+
+    /** @brief Optional inclusive lower bound for the IDs of exported vertices. */
+    ustore_key_t const* min_vertex;
+    /** @brief Optional inclusive upper bound for the IDs of exported vertices. */
+    ustore_key_t const* max_vertex;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Number of exported vertices. */
+    ustore_size_t* vertices_count;
+    /** @brief Sorted IDs of exported vertices. */
+    ustore_key_t** vertices;
+    /** @brief `vertices_count + 1` offsets into `neighbors` and `edges`. */
+    ustore_size_t** offsets;
+    /** @brief Optional neighbor IDs of every vertex, sorted within every role. */
+    ustore_key_t** neighbors;
+    /** @brief Optional IDs of edges, matching the `neighbors`. */
+    ustore_key_t** edges;
+
+    /// @}
+
+} ustore_graph_export_csr_t;
+
+/**
+ * @brief Exports the adjacency of the graph in the Compressed Sparse Row format.
+ * @see `ustore_graph_export_csr_t`.
+ */
+void ustore_graph_export_csr(ustore_graph_export_csr_t*);
+
+/**
+ * @brief Ranks all the vertices of a graph with PageRank, following the outgoing edges.
+ * @see `ustore_graph_pagerank()`.
+ *
+ * The adjacency is exported at once, like with `ustore_graph_export_csr()`, and ranked
+ * in memory. Vertices are split into small chunks, which threads take from a shared
+ * queue, so that a few high-degree vertices don't leave the other threads idle.
+ * Ranks of vertices without outgoing edges are spread evenly among all vertices.
+ */
+typedef struct ustore_graph_pagerank_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /**
+     * @brief A snapshot captures a point-in-time view of the DB at the time it's created.
+     * Without one, concurrent updates of the graph may fail the export.
+     */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_scan_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph collection to rank. */
+    ustore_collection_t collection;
+    /** @brief Probability of following an edge, rather than jumping to a random vertex. Zero means 0.85. */
+    ustore_float_t damping;
+    /** @brief Iterations stop once the sum of changes of all ranks is lower. Zero means 1e-6. */
+    ustore_float_t tolerance;
+    /** @brief Maximum number of iterations. Zero means 100. */
+    ustore_size_t iterations_limit;
+    /** @brief Number of threads to use, including the calling one. Zero means one. */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Number of ranked vertices. */
+    ustore_size_t* vertices_count;
+    /** @brief Sorted IDs of ranked vertices. */
+    ustore_key_t** vertices;
+    /** @brief Ranks of the `vertices`, that sum up to one. */
+    ustore_float_t** ranks;
+    /** @brief Optional number of performed iterations. */
+    ustore_size_t* iterations;
+
+    /// @}
+
+} ustore_graph_pagerank_t;
+
+/**
+ * @brief Ranks all the vertices of a graph with PageRank.
+ * @see `ustore_graph_pagerank_t`.
+ */
+void ustore_graph_pagerank(ustore_graph_pagerank_t*);
+
+/**
+ * @brief Finds the weakly connected components of a graph, ignoring the directions of edges.
+ * @see `ustore_graph_components()`.
+ *
+ * Vertices are merged in a shared lock-free disjoint set, processing the chunks
+ * of vertices in the same way as `ustore_graph_pagerank()`.
+ * Every component is labeled with its smallest vertex ID.
+ */
+typedef struct ustore_graph_components_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_scan_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph collection to split. */
+    ustore_collection_t collection;
+    /** @brief Number of threads to use, including the calling one. Zero means one. */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Number of labeled vertices. */
+    ustore_size_t* vertices_count;
+    /** @brief Sorted IDs of labeled vertices. */
+    ustore_key_t** vertices;
+    /** @brief The smallest vertex ID in the component of every one of `vertices`. */
+    ustore_key_t** components;
+    /** @brief Optional number of distinct components. */
+    ustore_size_t* components_count;
+
+    /// @}
+
+} ustore_graph_components_t;
+
+/**
+ * @brief Finds the weakly connected components of a graph.
+ * @see `ustore_graph_components_t`.
+ */
+void ustore_graph_components(ustore_graph_components_t*);
+
+/**
+ * @brief Counts the triangles every vertex belongs to, ignoring the directions of edges,
+ * self-loops and repeated edges between the same vertices.
+ * @see `ustore_graph_triangles()`.
+ *
+ * Every triangle is found once, from its smallest vertex, by intersecting sorted neighborhoods.
+ * Chunks of vertices are processed in the same way as in `ustore_graph_pagerank()`.
+ */
+typedef struct ustore_graph_triangles_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_scan_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph collection to analyze. */
+    ustore_collection_t collection;
+    /** @brief Number of threads to use, including the calling one. Zero means one. */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Number of analyzed vertices. */
+    ustore_size_t* vertices_count;
+    /** @brief Sorted IDs of analyzed vertices. */
+    ustore_key_t** vertices;
+    /** @brief Optional number of triangles containing every one of `vertices`. */
+    ustore_size_t** triangles;
+    /** @brief Optional total number of distinct triangles. */
+    ustore_size_t* triangles_count;
+
+    /// @}
+
+} ustore_graph_triangles_t;
+
+/**
+ * @brief Counts the triangles in a graph.
+ * @see `ustore_graph_triangles_t`.
+ */
+void ustore_graph_triangles(ustore_graph_triangles_t*);
+
 /**
  * @brief Inserts edges between provided vertices.
  * @see `ustore_graph_upsert_edges()`.
@@ -213,6 +591,20 @@ typedef struct ustore_graph_upsert_edges_t {
     ustore_key_t const* targets_ids;
     ustore_size_t targets_stride;
 
+    /**
+     * @brief Layout for the updated vertices.
+     * Already packed vertices stay packed, even if updated with `::ustore_graph_encoding_plain_k`,
+     * so choosing the layout on the first write into a collection is enough.
+     */
+    ustore_graph_encoding_t encoding;
+
+    /**
+     * @brief Vertices with more neighborships are split into buckets of neighbor ID ranges,
+     * each stored separately, so that updates only rewrite the bucket they touch.
+     * Zero picks the default of 65536. Already split vertices stay split.
+     */
+    ustore_vertex_degree_t max_bucket_degree;
+
     /// @}
 
 } ustore_graph_upsert_edges_t;
@@ -23,6 +23,12 @@
  * for both RegEx and prefix matches it is recommended to avoid RegEx special characters
  * in names: ., +, *, ?, ^, $, (, ), [, ], {, }, |, \.
  * The other punctuation marks like: /, :, @, -, _, #, ~, comma.
+ *
+ * ## Hashing
+ *
+ * Paths are hashed into buckets with a stable 64-bit hash, identical across platforms.
+ * Collections filled by older versions keep their original hash. In both cases
+ * the smallest integer key of a paths collection is reserved for metadata.
  */
 
 #pragma once
@@ -171,6 +177,7 @@ void ustore_paths_read(ustore_paths_read_t*);
  * If a "pattern" contains RegEx special symbols, than it is
  * treated as a RegEx pattern: ., +, *, ?, ^, $, (, ), [, ], {, }, |, \.
  * Otherwise, it is treated as a prefix for search.
+ * Compiled RegEx patterns are cached and reused between calls.
  */
 typedef struct ustore_paths_match_t {
 
@@ -225,6 +232,13 @@ typedef struct ustore_paths_match_t {
     ustore_size_t previous_lengths_stride;
     /// @}
 
+    /**
+     * @brief Number of threads to split the scans of hash buckets between.
+     * Zero or one means that only the calling thread is used.
+     * Scans inside of transactions and over prefix indexes use the calling thread regardless.
+     */
+    ustore_size_t threads_count;
+
     /// @}
     /// @name Outputs
     /// @{
@@ -241,6 +255,60 @@ typedef struct ustore_paths_match_t {
  */
 void ustore_paths_match(ustore_paths_match_t*);
 
+/**
+ * @brief Declares an ordered prefix index over the paths of a collection.
+ * @see `ustore_paths_index_create()`.
+ *
+ * ## Storage
+ *
+ * Paths are hashed into buckets, so without an index every `ustore_paths_match()`
+ * scans the whole collection. The index is stored in a hidden collection, named
+ * like the indexed one, followed by `.paths.prefix`. Its keys are the first 8 bytes
+ * of paths, mapped into integers preserving the lexicographic order, and its values
+ * are the sorted paths sharing those bytes. Prefix matches on indexed collections
+ * become range scans, exporting paths in lexicographic order. RegEx patterns
+ * anchored with `^` only check the paths sharing their literal prefix, while
+ * the others are still matched against every bucket.
+ *
+ * ## Maintenance
+ *
+ * Once declared, the index is updated by every `ustore_paths_write()` into the
+ * collection, in the same batch with the buckets, whenever a path is added or removed.
+ * All paths sharing the first 8 bytes are rewritten together, so concurrent writers
+ * should use transactions, and long shared roots make larger index entries.
+ * Clearing the collection with `ustore_collection_drop()` doesn't clear its index.
+ */
+typedef struct ustore_paths_index_create_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read and write options for indexing the existing paths. @see `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The collection of paths to index. */
+    ustore_collection_t collection;
+
+    /// @}
+
+} ustore_paths_index_create_t;
+
+/**
+ * @brief Declares a prefix index and indexes the existing paths.
+ * @see `ustore_paths_index_create_t`.
+ */
+void ustore_paths_index_create(ustore_paths_index_create_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
\ No newline at end of file
@@ -46,6 +46,7 @@
 #pragma once
 #include "ustore/db.h"
 #include "ustore/blobs.h"
+#include "ustore/async.h"
 #include "ustore/paths.h"
 #include "ustore/docs.h"
 #include "ustore/graph.h"
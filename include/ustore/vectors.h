@@ -27,11 +27,35 @@ typedef enum {
 
     ustore_vector_scalar_f32_k = 0,
     ustore_vector_scalar_f16_k = 1,
+    /**
+     * @brief Plain integers, unrelated to the fixed scale of `ustore_vector_quantization_i8_k`.
+     * Exact metrics, like the re-ranked ones, are computed in the same units, as for `f32` vectors.
+     */
     ustore_vector_scalar_i8_k = 2,
     ustore_vector_scalar_f64_k = 3,
 
 } ustore_vector_scalar_t;
 
+/**
+ * @brief Compressed representations of vectors, kept next to the originals.
+ * Searches compare those codes, while reads return the originals.
+ */
+typedef enum {
+
+    /** @brief One byte per dimension, with a fixed scale, suited for unit vectors. */
+    ustore_vector_quantization_i8_k = 0,
+    /** @brief One byte per dimension, scaled by the largest magnitude of every vector. */
+    ustore_vector_quantization_i8_scaled_k = 1,
+    /**
+     * @brief Half a byte per two dimensions, indexing centroids trained once the collection holds 256 vectors.
+     * Until then, vectors are stored with `ustore_vector_quantization_i8_k` and searched exhaustively.
+     */
+    ustore_vector_quantization_pq4_k = 2,
+    /** @brief One sign bit per dimension, compared with Hamming distance. */
+    ustore_vector_quantization_b1_k = 3,
+
+} ustore_vector_quantization_t;
+
 /**
  * @brief Maps keys to High-Dimensional Vectors.
  * Generalization of @c ustore_write_t to numerical vectors.
@@ -41,6 +65,12 @@ typedef enum {
  * same dimensionality and their scalar components would form
  * continuous chunks, we need less arguments for this call,
  * than some binary methods.
+ *
+ * Every written vector is also linked into a Hierarchical Navigable Small
+ * World graph, stored in a companion collection with a ".hnsw" name suffix.
+ * Engines without named collections support keep no index.
+ * Dropping or clearing the collection with `ustore_collection_drop()` drops
+ * or clears the index as well.
  */
 typedef struct ustore_vectors_write_t {
 
@@ -80,6 +110,32 @@ typedef struct ustore_vectors_write_t {
     ustore_size_t offsets_stride;
 
     // @}
+    /// @name Index
+    /// @{
+
+    /**
+     * @brief Metric used to organize the HNSW index of a collection.
+     * Only affects the first write, that creates the index.
+     */
+    ustore_vector_metric_t metric;
+    /**
+     * @brief Compression scheme for vectors of a collection, used by the index and exhaustive search.
+     * Only affects the first write, that creates the index.
+     */
+    ustore_vector_quantization_t quantization;
+    /**
+     * @brief Maximum number of neighbors per node in upper layers of the index.
+     * The bottom layer fits twice as many. Zero means the default of 16.
+     * Only affects the first write, that creates the index.
+     */
+    ustore_length_t max_neighbors;
+    /**
+     * @brief Size of the candidates pool, used to pick neighbors for new nodes.
+     * Higher values improve recall at the cost of slower writes. Zero means the default of 64.
+     */
+    ustore_length_t ef_construction;
+
+    /// @}
 
 } ustore_vectors_write_t;
 
@@ -126,13 +182,19 @@ typedef struct ustore_vectors_read_t {
     ustore_key_t const* keys;
     ustore_size_t keys_stride;
 
-    /// @}
-
     /// @}
     /// @name Outputs
     /// @{
+
+    /** @brief Bitset of vectors present in the DB. @see `ustore_read_t`. */
     ustore_octet_t** presences;
+    /** @brief Offsets of rows within `vectors`, always multiples of the row size. Is @b optional. */
     ustore_length_t** offsets;
+    /**
+     * @brief Row-major matrix of `tasks_count` rows, each with `dimensions` scalars of `scalar_type`.
+     * Vectors written with a different scalar type are converted, missing ones are zero-filled.
+     * When no conversion is needed, the matrix is exported straight from the read tape.
+     */
     ustore_byte_t** vectors;
     /// @}
 
@@ -145,9 +207,114 @@ typedef struct ustore_vectors_read_t {
  */
 void ustore_vectors_read(ustore_vectors_read_t*);
 
+/**
+ * @brief Handle of a disk-resident vectors index, opened with `ustore_vectors_index_open()`.
+ * Can be shared between concurrent searches and must be released with `ustore_vectors_index_free()`.
+ */
+typedef void* ustore_vectors_index_t;
+
+/**
+ * @brief Exports a disk-resident index over all the vectors of a collection.
+ * @see `ustore_vectors_index_build()`, `ustore_vectors_index_open()`.
+ *
+ * Unlike the HNSW graph, that is updated on every write and lives in a
+ * companion collection, this Vamana graph is built once from the current
+ * state of the collection and saved into a standalone file. Every node
+ * of the graph keeps its full-precision vector and its neighbors in the
+ * same disk page, while the quantized codes of all vectors form a compact
+ * head of the file. Only the head is loaded into memory on open, so the
+ * indexed collection can be much larger than RAM.
+ *
+ * Building still needs all the vectors in memory at once. Vectors of
+ * other dimensions, than `dimensions`, are skipped.
+ */
+typedef struct ustore_vectors_index_build_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the collection will be scanned. */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    ustore_length_t dimensions;
+    ustore_vector_metric_t metric;
+    /** @brief Compression scheme for the codes, kept in memory during searches. */
+    ustore_vector_quantization_t quantization;
+    /** @brief NULL-terminated path of the exported file. Existing files are replaced. */
+    ustore_str_view_t path;
+
+    /// @}
+    /// @name Graph
+    /// @{
+
+    /** @brief Maximum number of neighbors per node. Zero means the default of 64. */
+    ustore_length_t max_neighbors;
+    /** @brief Size of the candidates pool, used to pick neighbors. Zero means the default of 100. */
+    ustore_length_t ef_construction;
+    /**
+     * @brief Pruning relaxation, above one, that keeps some longer edges,
+     * so that searches need fewer hops. Zero means the default of 1.2.
+     */
+    ustore_float_t alpha;
+    /** @brief Number of threads to insert nodes from. Zero or one means only the calling thread. */
+    ustore_size_t threads_count;
+
+    /// @}
+
+} ustore_vectors_index_build_t;
+
+/**
+ * @brief Exports a disk-resident index over all the vectors of a collection.
+ * @see `ustore_vectors_index_build_t`.
+ */
+void ustore_vectors_index_build(ustore_vectors_index_build_t*);
+
+typedef struct ustore_vectors_index_open_t {
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief NULL-terminated path of a file, exported by `ustore_vectors_index_build()`. */
+    ustore_str_view_t path;
+    /** @brief Output for the handle of the index. */
+    ustore_vectors_index_t* index;
+} ustore_vectors_index_open_t;
+
+/**
+ * @brief Memory-maps a disk-resident index, loading only the quantized codes.
+ * @see `ustore_vectors_index_open_t`, `ustore_vectors_search_t::disk_index`.
+ */
+void ustore_vectors_index_open(ustore_vectors_index_open_t*);
+
+/**
+ * @brief Unmaps a disk-resident index. Must be called after all the searches over it have finished.
+ */
+void ustore_vectors_index_free(ustore_vectors_index_t);
+
 /**
  * @brief Performs K-Approximate Nearest Neighbors Search.
  * @see `ustore_vectors_search()`.
+ *
+ * Traverses the HNSW index, built by `ustore_vectors_write()`, if it was
+ * constructed for the same `metric` and `dimensions`. Otherwise, falls back
+ * to a full scan of the collection. Consecutive tasks targeting the same
+ * collection share that scan, so batching queries is much cheaper than
+ * submitting them one by one.
+ *
+ * Queries are compressed with the scheme chosen for the collection on its
+ * first write. Coarse schemes, like `ustore_vector_quantization_b1_k`, are
+ * best combined with `oversampling`.
  */
 typedef struct ustore_vectors_search_t {
 
@@ -188,6 +355,50 @@ typedef struct ustore_vectors_search_t {
     ustore_length_t const* queries_offsets;
     ustore_size_t queries_offsets_stride;
 
+    /**
+     * @brief Size of the candidates pool, used to traverse the HNSW index.
+     * Higher values improve recall at the cost of slower searches. Zero means the default of 64.
+     * Never smaller than the number of requested matches.
+     */
+    ustore_length_t ef_search;
+
+    /**
+     * @brief Number of threads to split an exhaustive search between.
+     * Zero or one means that only the calling thread is used.
+     * Only applies to collections without an HNSW index.
+     */
+    ustore_size_t threads_count;
+
+    /**
+     * @brief Fetches `match_counts_limits * oversampling` candidates comparing
+     * the quantized vectors and re-ranks them by comparing the originals.
+     * Recovers the precision lost by quantization at the cost of a batched read.
+     * Originals must have the same `scalar_type` as the queries.
+     * Zero or one means no re-ranking.
+     */
+    ustore_length_t oversampling;
+
+    /**
+     * @brief Optional @b sorted list of keys, that are allowed among the matches of all tasks.
+     * Applied during the traversal of the index or, for short lists, by comparing only
+     * the allowed vectors, so that filtered searches don't have to over-fetch.
+     * NULL means no filtering, while an empty non-NULL list allows nothing.
+     */
+    ustore_key_t const* allowed_keys;
+    ustore_size_t allowed_keys_count;
+
+    /**
+     * @brief Optional disk-resident index, that is searched instead of the `collections`.
+     * Its matches are always ranked by the full-precision vectors, so `oversampling` is ignored.
+     * Must be built for the same `metric` and `dimensions`.
+     */
+    ustore_vectors_index_t disk_index;
+    /**
+     * @brief Number of closest candidates, expanded at once in the `disk_index`.
+     * Their pages are fetched with a single batch of reads. Zero means the default of 4.
+     */
+    ustore_length_t beam_width;
+
     /// @}
     /// @name Outputs
     /// @{
@@ -8,6 +8,8 @@ import java.nio.file.StandardCopyOption;
 import java.util.Map; // Map abstract class
 import java.lang.AutoCloseable; // Finalization
 import java.util.Arrays; // Arrays.equals
+import java.nio.ByteBuffer; // Zero-copy batches
+import java.nio.ByteOrder; // Native-endian offsets
 
 /**
  * @brief An Embedded Persistent Key-Value Store with
@@ -42,7 +44,17 @@ import java.util.Arrays; // Arrays.equals
  * - putIfAbsent(key, value)
  * - getOrDefault(key, defaultValue)
  * - putAll(Map<Key, Value>)
- 
+ *
+ * For bulk workloads, batched calls cross the JNI boundary once per
+ * batch instead of once per key, and exchange values through direct
+ * `ByteBuffer`s without copying them into Java arrays:
+ * - containsKeys(long[] keys)
+ * - putMany(long[] keys, int[] offsets, ByteBuffer contents)
+ * - getMany(long[] keys) -> Values
+ * - eraseMany(long[] keys)
+ * The returned `Values` view memory owned by the native library,
+ * so close them once you are done, or reuse them for the next batch.
+
  * You can expect similar behavior to native classes described here:
  * https://docs.oracle.com/javase/7/docs/api/java/util/Dictionary.html
  * https://docs.oracle.com/javase/7/docs/api/java/util/Hashtable.html
@@ -91,6 +103,72 @@ public abstract class DataBase {
         }
     }
 
+    /**
+     * @brief Results of a batched read, viewing the native memory directly.
+     *        All buffers stay valid until `close` or until the same object is
+     *        passed into another `getMany`, which recycles the memory.
+     */
+    public static class Values implements AutoCloseable {
+
+        public long arenaAddress = 0;
+        public int count = 0;
+
+        /** Concatenated values of all the requested keys. */
+        public ByteBuffer contents = null;
+        /** `count + 1` native-endian 32-bit offsets into `contents`. */
+        public ByteBuffer offsets = null;
+        /** Bitmap with one bit per requested key, set if it was found. */
+        public ByteBuffer presences = null;
+
+        /**
+         * @return True, if the key with the given index in the batch was found.
+         */
+        public boolean contains(int index) {
+            return (presences.get(index / 8) & (1 << (index % 8))) != 0;
+        }
+
+        /**
+         * @return A read-only slice of `contents` with the value of the key with
+         *         the given index in the batch, or null if it is missing.
+         */
+        public ByteBuffer get(int index) {
+            if (!contains(index))
+                return null;
+            // Buffers created in JNI are big-endian by default
+            offsets.order(ByteOrder.nativeOrder());
+            int begin = offsets.getInt(index * 4);
+            int end = offsets.getInt(index * 4 + 4);
+            ByteBuffer view = contents.asReadOnlyBuffer();
+            view.limit(end);
+            view.position(begin);
+            return view.slice();
+        }
+
+        /**
+         * Copies the value of the key with the given index into a Java array,
+         * matching the output of `Transaction.get`.
+         */
+        public byte[] getBytes(int index) {
+            ByteBuffer view = get(index);
+            if (view == null)
+                return null;
+            byte[] value = new byte[view.remaining()];
+            view.get(value);
+            return value;
+        }
+
+        private native void free_();
+
+        @Override
+        public void close() {
+            free_();
+            contents = null;
+            offsets = null;
+            presences = null;
+            count = 0;
+        }
+    }
+
     public static class Transaction implements AutoCloseable {
 
         public long transactionAddress = 0;
@@ -156,6 +234,59 @@ public abstract class DataBase {
             erase(null, key);
         }
 
+        /**
+         * Tests which of the specified keys are present in this collection,
+         * in a single native call.
+         */
+        public native boolean[] containsKeys(String collection, long[] keys);
+
+        public boolean[] containsKeys(long[] keys) {
+            return containsKeys(null, keys);
+        }
+
+        /**
+         * Maps many keys to values at once. The values are concatenated in a
+         * direct `contents` buffer, and the i-th one spans from `offsets[i]`
+         * to `offsets[i + 1]`, so `offsets` has one more entry than `keys`.
+         */
+        public native void putMany(String collection, long[] keys, int[] offsets, ByteBuffer contents);
+
+        public void putMany(long[] keys, int[] offsets, ByteBuffer contents) {
+            putMany(null, keys, offsets, contents);
+        }
+
+        /**
+         * Reads the values of many keys at once into `values`, recycling the
+         * native memory from their previous batch, if any.
+         */
+        public native void getMany(String collection, long[] keys, Values values);
+
+        public void getMany(long[] keys, Values values) {
+            getMany(null, keys, values);
+        }
+
+        /**
+         * Reads the values of many keys at once. The result must be closed.
+         */
+        public Values getMany(String collection, long[] keys) {
+            Values values = new Values();
+            getMany(collection, keys, values);
+            return values;
+        }
+
+        public Values getMany(long[] keys) {
+            return getMany(null, keys);
+        }
+
+        /**
+         * Removes many keys (and their corresponding values) from this collection.
+         */
+        public native void eraseMany(String collection, long[] keys);
+
+        public void eraseMany(long[] keys) {
+            eraseMany(null, keys);
+        }
+
         /**
          * Removes the key (and its corresponding value) from this collection.
          *
@@ -1,6 +1,8 @@
 #include "cloud_unum_ustore_Shared.h"
 #include "cloud_unum_ustore_DataBase_Transaction.h"
 
+#include <limits.h> // `CHAR_BIT`
+
 JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_put( //
     JNIEnv* env_java,
     jobject txn_java,
@@ -261,4 +263,264 @@ JNIEXPORT jboolean JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_comm
 
     ustore_transaction_commit(&txn_commit);
     return error_c ? JNI_FALSE : JNI_TRUE;
-}
\ No newline at end of file
+}
+
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_putMany( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jlongArray keys_java,
+    jintArray offsets_java,
+    jobject contents_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    // Values are passed in place, only the keys and offsets may be copied by the JVM
+    jsize count_java = (*env_java)->GetArrayLength(env_java, keys_java);
+    if ((*env_java)->GetArrayLength(env_java, offsets_java) != count_java + 1) {
+        forward_error(env_java, "Offsets must have one more entry than keys!");
+        return;
+    }
+    ustore_bytes_cptr_t contents_c = (ustore_bytes_cptr_t)(*env_java)->GetDirectBufferAddress(env_java, contents_java);
+    jlong contents_capacity_java = (*env_java)->GetDirectBufferCapacity(env_java, contents_java);
+    if (!contents_c) {
+        forward_error(env_java, "Values must be passed in a direct ByteBuffer!");
+        return;
+    }
+
+    jlong* keys_ptr_java = (*env_java)->GetLongArrayElements(env_java, keys_java, NULL);
+    jint* offsets_ptr_java = (*env_java)->GetIntArrayElements(env_java, offsets_java, NULL);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    ustore_error_t error_c = NULL;
+    if (offsets_ptr_java[0] < 0 || offsets_ptr_java[count_java] > contents_capacity_java)
+        error_c = "Offsets exceed the capacity of the ByteBuffer!";
+
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_arena_t arena_c = NULL;
+    struct ustore_write_t write = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = &arena_c,
+        .options = options_c,
+        .tasks_count = (ustore_size_t)count_java,
+        .collections = &collection_ptr_c,
+        .keys = (ustore_key_t const*)keys_ptr_java,
+        .keys_stride = sizeof(jlong),
+        .offsets = (ustore_length_t const*)offsets_ptr_java,
+        .offsets_stride = sizeof(jint),
+        .values = &contents_c,
+    };
+
+    if (!error_c) {
+        ustore_write(&write);
+        ustore_arena_free(arena_c);
+        forward_ustore_error(env_java, error_c);
+    }
+    else
+        forward_error(env_java, error_c);
+
+    (*env_java)->ReleaseLongArrayElements(env_java, keys_java, keys_ptr_java, JNI_ABORT);
+    (*env_java)->ReleaseIntArrayElements(env_java, offsets_java, offsets_ptr_java, JNI_ABORT);
+}
+
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_getMany( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jlongArray keys_java,
+    jobject values_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    jsize count_java = (*env_java)->GetArrayLength(env_java, keys_java);
+    jlong* keys_ptr_java = (*env_java)->GetLongArrayElements(env_java, keys_java, NULL);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    // The arena of the previous batch is reused, invalidating its buffers
+    jfieldID arena_field = find_values_field(env_java, "arenaAddress", "J");
+    ustore_arena_t arena_c = (ustore_arena_t)(*env_java)->GetLongField(env_java, values_java, arena_field);
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_octet_t* found_presences_c = NULL;
+    ustore_length_t* found_offsets_c = NULL;
+    ustore_bytes_ptr_t found_values_c = NULL;
+    ustore_error_t error_c = NULL;
+    struct ustore_read_t read = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = &arena_c,
+        .options = options_c,
+        .tasks_count = (ustore_size_t)count_java,
+        .collections = &collection_ptr_c,
+        .keys = (ustore_key_t const*)keys_ptr_java,
+        .keys_stride = sizeof(jlong),
+        .presences = &found_presences_c,
+        .offsets = &found_offsets_c,
+        .values = &found_values_c,
+    };
+
+    ustore_read(&read);
+    (*env_java)->ReleaseLongArrayElements(env_java, keys_java, keys_ptr_java, JNI_ABORT);
+    (*env_java)->SetLongField(env_java, values_java, arena_field, (jlong)arena_c);
+    if (forward_ustore_error(env_java, error_c))
+        return;
+
+    jfieldID count_field = find_values_field(env_java, "count", "I");
+    (*env_java)->SetIntField(env_java, values_java, count_field, count_java);
+    if (!count_java || !found_offsets_c)
+        return;
+
+    // Export views into the arena, which stays alive until the `Values` are closed.
+    // JNI doesn't accept NULL addresses, even for empty buffers.
+    ustore_length_t contents_length_c = found_offsets_c[count_java];
+    void* contents_c = found_values_c ? (void*)found_values_c : (void*)found_offsets_c;
+    jobject contents_java = (*env_java)->NewDirectByteBuffer(env_java, contents_c, contents_length_c);
+    jobject offsets_java = (*env_java)->NewDirectByteBuffer( //
+        env_java,
+        found_offsets_c,
+        (jlong)(count_java + 1) * sizeof(ustore_length_t));
+    jobject presences_java = (*env_java)->NewDirectByteBuffer( //
+        env_java,
+        found_presences_c,
+        (jlong)(count_java + CHAR_BIT - 1) / CHAR_BIT);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    (*env_java)->SetObjectField(env_java,
+                                values_java,
+                                find_values_field(env_java, "contents", "Ljava/nio/ByteBuffer;"),
+                                contents_java);
+    (*env_java)->SetObjectField(env_java,
+                                values_java,
+                                find_values_field(env_java, "offsets", "Ljava/nio/ByteBuffer;"),
+                                offsets_java);
+    (*env_java)->SetObjectField(env_java,
+                                values_java,
+                                find_values_field(env_java, "presences", "Ljava/nio/ByteBuffer;"),
+                                presences_java);
+}
+
+JNIEXPORT jbooleanArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_containsKeys( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jlongArray keys_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return NULL;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return NULL;
+
+    jsize count_java = (*env_java)->GetArrayLength(env_java, keys_java);
+    jlong* keys_ptr_java = (*env_java)->GetLongArrayElements(env_java, keys_java, NULL);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return NULL;
+
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_octet_t* found_presences_c = NULL;
+    ustore_arena_t arena_c = NULL;
+    ustore_error_t error_c = NULL;
+    struct ustore_read_t read = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = &arena_c,
+        .options = options_c,
+        .tasks_count = (ustore_size_t)count_java,
+        .collections = &collection_ptr_c,
+        .keys = (ustore_key_t const*)keys_ptr_java,
+        .keys_stride = sizeof(jlong),
+        .presences = &found_presences_c,
+    };
+
+    ustore_read(&read);
+    (*env_java)->ReleaseLongArrayElements(env_java, keys_java, keys_ptr_java, JNI_ABORT);
+
+    if (forward_ustore_error(env_java, error_c)) {
+        ustore_arena_free(arena_c);
+        return NULL;
+    }
+
+    // Unpack the bitmap in place, inside of the Java array
+    jbooleanArray result_java = (*env_java)->NewBooleanArray(env_java, count_java);
+    jboolean* result_ptr_java = result_java ? (*env_java)->GetBooleanArrayElements(env_java, result_java, NULL) : NULL;
+    if (result_ptr_java) {
+        for (jsize i = 0; i != count_java; ++i)
+            result_ptr_java[i] = (found_presences_c[i / CHAR_BIT] & (1 << (i % CHAR_BIT))) ? JNI_TRUE : JNI_FALSE;
+        (*env_java)->ReleaseBooleanArrayElements(env_java, result_java, result_ptr_java, 0);
+    }
+
+    ustore_arena_free(arena_c);
+    return result_java;
+}
+
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_eraseMany( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jlongArray keys_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    jsize count_java = (*env_java)->GetArrayLength(env_java, keys_java);
+    jlong* keys_ptr_java = (*env_java)->GetLongArrayElements(env_java, keys_java, NULL);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_arena_t arena_c = NULL;
+    ustore_error_t error_c = NULL;
+    struct ustore_write_t write = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = &arena_c,
+        .options = options_c,
+        .tasks_count = (ustore_size_t)count_java,
+        .collections = &collection_ptr_c,
+        .keys = (ustore_key_t const*)keys_ptr_java,
+        .keys_stride = sizeof(jlong),
+    };
+
+    ustore_write(&write);
+    ustore_arena_free(arena_c);
+    (*env_java)->ReleaseLongArrayElements(env_java, keys_java, keys_ptr_java, JNI_ABORT);
+    forward_ustore_error(env_java, error_c);
+}
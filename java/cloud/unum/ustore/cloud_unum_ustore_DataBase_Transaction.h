@@ -49,6 +49,42 @@ JNIEXPORT jbyteArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_ge
  */
 JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_erase(JNIEnv*, jobject, jstring, jlong);
 
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    containsKeys
+ * Signature: (Ljava/lang/String;[J)[Z
+ */
+JNIEXPORT jbooleanArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_containsKeys(JNIEnv*,
+                                                                                               jobject,
+                                                                                               jstring,
+                                                                                               jlongArray);
+
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    putMany
+ * Signature: (Ljava/lang/String;[J[ILjava/nio/ByteBuffer;)V
+ */
+JNIEXPORT void JNICALL
+Java_cloud_unum_ustore_DataBase_00024Transaction_putMany(JNIEnv*, jobject, jstring, jlongArray, jintArray, jobject);
+
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    getMany
+ * Signature: (Ljava/lang/String;[JLcloud/unum/ustore/DataBase$Values;)V
+ */
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_getMany(JNIEnv*,
+                                                                                jobject,
+                                                                                jstring,
+                                                                                jlongArray,
+                                                                                jobject);
+
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    eraseMany
+ * Signature: (Ljava/lang/String;[J)V
+ */
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_eraseMany(JNIEnv*, jobject, jstring, jlongArray);
+
 #ifdef __cplusplus
 }
 #endif
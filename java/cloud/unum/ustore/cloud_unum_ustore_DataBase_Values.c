@@ -0,0 +1,13 @@
+#include "cloud_unum_ustore_Shared.h"
+#include "cloud_unum_ustore_DataBase_Values.h"
+
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Values_free_1(JNIEnv* env_java, jobject values_java) {
+
+    jfieldID arena_field = find_values_field(env_java, "arenaAddress", "J");
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    ustore_arena_t arena_c = (ustore_arena_t)(*env_java)->GetLongField(env_java, values_java, arena_field);
+    ustore_arena_free(arena_c);
+    (*env_java)->SetLongField(env_java, values_java, arena_field, 0);
+}
@@ -0,0 +1,20 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class cloud_unum_ustore_DataBase_Values */
+
+#ifndef _Included_cloud_unum_ustore_DataBase_Values
+#define _Included_cloud_unum_ustore_DataBase_Values
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     cloud_unum_ustore_DataBase_Values
+ * Method:    free_
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Values_free_1(JNIEnv*, jobject);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
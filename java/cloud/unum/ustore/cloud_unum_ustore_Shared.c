@@ -24,6 +24,11 @@ jfieldID find_txn_field(JNIEnv* env_java) {
     return txn_ptr_field;
 }
 
+jfieldID find_values_field(JNIEnv* env_java, char const* name, char const* signature) {
+    jclass values_class_java = (*env_java)->FindClass(env_java, "cloud/unum/ustore/DataBase$Values");
+    return values_class_java ? (*env_java)->GetFieldID(env_java, values_class_java, name, signature) : NULL;
+}
+
 ustore_database_t db_ptr(JNIEnv* env_java, jobject txn_java) {
     jfieldID db_ptr_field = find_db_field(env_java);
     long int db_ptr_java = (*env_java)->GetLongField(env_java, txn_java, db_ptr_field);
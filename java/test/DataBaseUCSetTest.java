@@ -2,6 +2,7 @@
 import cloud.unum.ustore.DataBaseUCSet;
 import org.junit.Test;
 
+import java.nio.ByteBuffer;
 import java.util.Arrays;
 
 public class DataBaseUCSetTest {
@@ -23,4 +24,31 @@ public class DataBaseUCSetTest {
         ctx.close();
         System.out.println("Success!");
     }
+
+    @Test
+    public void batches() {
+        DataBaseUCSet.Context ctx = new DataBaseUCSet.Context("");
+        long[] keys = { 1, 2, 3 };
+        int[] offsets = { 0, 3, 3, 8 };
+        ByteBuffer contents = ByteBuffer.allocateDirect(8);
+        contents.put("heyworld".getBytes());
+        ctx.putMany(keys, offsets, contents);
+
+        boolean[] found = ctx.containsKeys(new long[] { 1, 4, 3 });
+        assert found[0] && !found[1] && found[2] : "Wrong presences";
+
+        try (DataBaseUCSet.Values values = ctx.getMany(new long[] { 3, 4, 2, 1 })) {
+            assert values.count == 4 : "Wrong batch size";
+            assert Arrays.equals(values.getBytes(0), "world".getBytes()) : "Received wrong value";
+            assert values.getBytes(1) == null : "Received missing value";
+            assert values.getBytes(2).length == 0 : "Received non-empty value";
+            assert Arrays.equals(values.getBytes(3), "hey".getBytes()) : "Received wrong value";
+
+            ctx.eraseMany(new long[] { 1, 3 });
+            ctx.getMany(keys, values);
+            assert !values.contains(0) && values.contains(1) && !values.contains(2) : "Failed to erase";
+        }
+
+        ctx.close();
+    }
 }
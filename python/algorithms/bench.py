@@ -1,6 +1,9 @@
 
 import os
 import time
+import argparse
+
+import numpy as np
 
 import networkx as nx
 from networkx.algorithms.community import louvain_communities as networkx_louvain
@@ -25,30 +28,47 @@ datasets = [
 ]
 
 
+def load_edges(path: str) -> np.ndarray:
+    return np.loadtxt(path, dtype=np.int64, comments='#', ndmin=2)
+
+
 if __name__ == "__main__":
-    for name, dataset, _ in datasets:
+    parser = argparse.ArgumentParser(description='Compares Louvain implementations.')
+    parser.add_argument('--threads', type=int, default=os.cpu_count(),
+                        help='Number of threads for the C++ implementation')
+    parser.add_argument('--native-only', action='store_true',
+                        help='Skip NetworkX and the Python baseline, which are too slow for large graphs')
+    parser.add_argument('--edges', help='Path to a custom whitespace-separated edge list')
+    args = parser.parse_args()
 
-        G = nx.read_edgelist(os.path.join(dataset_dir, dataset), nodetype=int)
+    if args.edges:
+        datasets = [(os.path.basename(args.edges), args.edges, None)]
 
-        t1 = time.perf_counter()
-        networkx_louvain(G)
-        t2 = time.perf_counter()
-        print('Elapsed time for {} dataset with NetworkX: {:.3f}s '.format(name, t2-t1))
+    for name, dataset, _ in datasets:
 
+        edges = load_edges(os.path.join(dataset_dir, dataset))
         graph = ustore.DataBase().main.graph
-        for v1, v2 in G.edges:
-            graph.add_edge(v1, v2)
-        G.clear()
-
-        t1 = time.perf_counter()
-        louvain.best_partition(graph)
-        t2 = time.perf_counter()
+        graph.add_edges_from(edges[:, 0], edges[:, 1], np.arange(len(edges)))
+        print('Loaded {} dataset: {:,} edges'.format(name, len(edges)))
 
-        print('Elapsed time for {} dataset with UStore Python: {:.3f}s '.format(
-            name, t2-t1))
+        if not args.native_only:
+            G = nx.Graph()
+            G.add_edges_from(edges.tolist())
+            t1 = time.perf_counter()
+            networkx_louvain(G)
+            t2 = time.perf_counter()
+            print('Elapsed time for {} dataset with NetworkX: {:.3f}s '.format(name, t2-t1))
+            G.clear()
 
-        t1 = time.perf_counter()
-        graph.community_louvain()
-        t2 = time.perf_counter()
+            t1 = time.perf_counter()
+            louvain.best_partition(graph)
+            t2 = time.perf_counter()
+            print('Elapsed time for {} dataset with UStore Python: {:.3f}s '.format(
+                name, t2-t1))
 
-        print('Elapsed time for {} dataset with UStore C++: {:.3f}s '.format(name, t2-t1))
+        for threads in sorted({1, args.threads}):
+            t1 = time.perf_counter()
+            graph.community_louvain(threads=threads)
+            t2 = time.perf_counter()
+            print('Elapsed time for {} dataset with UStore C++ on {} threads: {:.3f}s, {:,.0f} edges/s'.format(
+                name, threads, t2-t1, len(edges) / (t2-t1)))
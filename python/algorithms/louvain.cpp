@@ -1,273 +1,493 @@
 /**
  * @file louvain.cpp
  * @author Davit Vardanyan
- * @version 0.1
+ * @version 0.2
  * @date 2023-01-26
  *
  * @brief Louvain algorithm for Community Detection.
  *
- * This Louvain algorithm implementation is split into 2 phases:
- * 1. Extract communities from a Graph database, building a super-graph of communities,
- * 2. Repeatedly extract higher-level communities from the in-memory graph of smaller communities.
- *
  * Just like in the original implementations, the goal is to maximize the modularity metric.
- * Unlike most implementations, however, during iterations we only compute the "delta",
- * which makes the implementation more efficient.
+ * Every level of the hierarchy is split into 2 phases:
+ * 1. Local moving: vertices join the neighboring communities with the highest modularity gain,
+ * 2. Coarsening: communities are collapsed into the vertices of the next, smaller, graph.
+ *
+ * The graph is exported from the database at once, as a CSR snapshot, and remapped into dense
+ * 32-bit positions. Every level is stored in flat arrays, and coarser levels are written over
+ * the finer ones, so that no allocations happen after the first level is built.
+ *
+ * Local moving is parallel and synchronous: every sweep decides the moves of all vertices from
+ * the communities left by the previous sweep, and only then applies them. Two lonely vertices
+ * could swap their communities forever, so a singleton can only join another singleton with a
+ * smaller ID. Sweeps that reduce the modularity are rolled back and repeated, with fewer vertices
+ * moving at once. As decisions don't depend on the order in which chunks are processed,
+ * the results are identical for any number of threads.
  *
  * @copyright Copyright (c) 2023
  */
+#include <algorithm> // `std::sort`
+#include <atomic>    // `std::atomic`
+#include <cstdint>   // `std::uint32_t`
+#include <limits>    // `std::numeric_limits`
+#include <memory>    // `std::unique_ptr`
+#include <stdexcept> // `std::length_error`
+#include <thread>    // `std::thread`
+#include <vector>    // `std::vector`
+
 #include "ustore/ustore.hpp"
 
 using namespace unum::ustore;
 using namespace unum;
 
-struct community_degree_t {
-    double in_degree {};
-    double tot_degree {};
+/// Position of a vertex or a community among the vertices of the current level.
+using louvain_idx_t = std::uint32_t;
+/// Number of directed edges between two vertices, fused together by deduplication or coarsening.
+using louvain_weight_t = std::uint32_t;
+
+struct louvain_edge_t {
+    louvain_idx_t target {};
+    louvain_weight_t weight {};
 };
 
-using partition_t = std::unordered_map<ustore_key_t, ustore_key_t>;
-using vertex_degrees_t = std::unordered_map<ustore_key_t, double>;
-using graph_t = std::unordered_map<ustore_key_t, std::unordered_map<ustore_key_t, double>>;
-using community_degrees_t = std::unordered_map<ustore_key_t, community_degree_t>;
-
-bool first_phase(graph_collection_t& graph,
-                 partition_t& partition,
-                 vertex_degrees_t& degrees,
-                 community_degrees_t& community_degrees,
-                 std::size_t count_edges) noexcept(false) {
-
-    bool improvement = false;
-    bool modified = true;
-    auto stream = graph.vertex_stream().throw_or_release();
-    vertex_degrees_t degree_in_coms;
-
-    while (modified) {
-        modified = false;
-        stream.seek_to_first();
-        while (!stream.is_end()) {
-            auto vertex = stream.key();
-            auto vertex_degree = degrees[vertex];
-            auto vertex_community = partition[vertex];
-            auto best_mod = 0.0;
-            auto best_com = vertex_community;
-            auto vertex_com_tot_degree = community_degrees[vertex_community].tot_degree;
-
-            degree_in_coms.clear();
-            auto neighbors = graph.neighbors(vertex).throw_or_release();
-            for (auto neighbor : neighbors)
-                degree_in_coms[partition[neighbor]] += 1;
-            auto vertex_in_vertex_com_degree = degree_in_coms[vertex_community];
-
-            for (auto neighbor : neighbors) {
-                auto neighbor_community = partition[neighbor];
-                if (vertex_community == neighbor_community)
-                    continue;
+struct louvain_partition_t {
+    /// Sorted IDs of all the vertices of the graph.
+    std::vector<ustore_key_t> vertices;
+    /// Community of every vertex, labeled with the smallest vertex ID in it.
+    std::vector<ustore_key_t> communities;
+    double modularity {};
+    std::size_t levels {};
+};
 
-                auto neighbor_com_tot_degree = community_degrees[neighbor_community].tot_degree;
-                auto vertex_in_neighbor_com_degree = degree_in_coms[neighbor_community];
-                auto delta = (1.0 / count_edges) * (vertex_in_neighbor_com_degree - vertex_in_vertex_com_degree) -
-                             (vertex_degree / (2.0 * (count_edges * count_edges))) *
-                                 (vertex_degree + neighbor_com_tot_degree - vertex_com_tot_degree);
+constexpr std::size_t louvain_chunk_size_k = 1024;
+constexpr std::size_t louvain_sweeps_limit_k = 64;
+constexpr std::size_t louvain_stride_limit_k = 16;
 
-                if (delta > best_mod) {
-                    best_mod = delta;
-                    best_com = neighbor_community;
-                }
-            }
-
-            if (best_com != vertex_community) {
-                community_degrees[vertex_community].tot_degree -= (vertex_degree - vertex_in_vertex_com_degree);
-                auto vertex_in_best_com_degree = degree_in_coms[best_com];
-                community_degrees[best_com].tot_degree += (vertex_degree - vertex_in_best_com_degree);
-                community_degrees[vertex_community].in_degree -= vertex_in_vertex_com_degree;
-                community_degrees[best_com].in_degree += vertex_in_best_com_degree;
-                partition[vertex] = best_com;
-                modified = true;
-                improvement = true;
-            }
-            ++stream;
+/**
+ * @brief Calls `process(chunk_idx, thread_idx, begin, end)` for consecutive chunks of `count`
+ * elements, in up to `threads_count` threads, including the calling one.
+ * Every thread takes the next chunk from a shared counter, once it is done with the previous one.
+ * If threads can't be spawned, the remaining chunks are processed by the calling thread.
+ */
+template <typename process_at>
+void louvain_parallel_for(std::size_t count, std::size_t threads_count, process_at&& process) {
+    std::size_t const chunks_count = divide_round_up(count, louvain_chunk_size_k);
+    std::atomic<std::size_t> next_chunk {0};
+    auto take_chunks = [&](std::size_t thread_idx) {
+        for (std::size_t chunk_idx = next_chunk++; chunk_idx < chunks_count; chunk_idx = next_chunk++) {
+            std::size_t begin = chunk_idx * louvain_chunk_size_k;
+            process(chunk_idx, thread_idx, begin, std::min(begin + louvain_chunk_size_k, count));
         }
+    };
+
+    threads_count = std::min(std::max<std::size_t>(threads_count, 1), std::max<std::size_t>(chunks_count, 1));
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(threads_count - 1);
+        while (threads.size() + 1 < threads_count)
+            threads.emplace_back(take_chunks, threads.size() + 1);
     }
-
-    return improvement;
+    catch (...) {
+    }
+    take_chunks(0);
+    for (auto& thread : threads)
+        thread.join();
 }
 
-bool second_phase(graph_t& graph,
-                  partition_t& partition,
-                  vertex_degrees_t& degrees,
-                  community_degrees_t& community_degrees,
-                  std::size_t count_edges) noexcept(false) {
-
-    bool improvement = false;
-    bool modified = true;
-    vertex_degrees_t degree_in_coms;
-
-    while (modified) {
-        modified = false;
-        for (auto const& graph_iter : graph) {
-            auto const& vertex = graph_iter.first;
-            auto const& neighbors = graph_iter.second;
-            auto vertex_degree = degrees[vertex];
-            auto vertex_community = partition[vertex];
-            auto best_mod = 0.0;
-            auto best_com = vertex_community;
-            auto vertex_com_tot_degree = community_degrees[vertex_community].tot_degree;
-
-            degree_in_coms.clear();
-            for (auto const& neighbor_iter : neighbors)
-                degree_in_coms[partition[neighbor_iter.first]] += neighbor_iter.second;
-            auto vertex_in_vertex_com_degree = degree_in_coms[vertex_community];
-
-            for (auto const& neighbor_iter : neighbors) {
-                auto neighbor_community = partition[neighbor_iter.first];
-                if (vertex_community == neighbor_community)
-                    continue;
-
-                auto neighbor_com_tot_degree = community_degrees[neighbor_community].tot_degree;
-                auto vertex_in_neighbor_com_degree = degree_in_coms[neighbor_community];
-                auto delta = (1.0 / count_edges) * (vertex_in_neighbor_com_degree - vertex_in_vertex_com_degree) -
-                             (vertex_degree / (2.0 * (count_edges * count_edges))) *
-                                 (vertex_degree + neighbor_com_tot_degree - vertex_com_tot_degree);
+/**
+ * @brief Sorts the edges by their targets, fusing the duplicates and summing their weights.
+ * @return The end of the deduplicated range.
+ */
+louvain_edge_t* sort_and_merge_edges(louvain_edge_t* begin, louvain_edge_t* end) noexcept {
+    if (begin == end)
+        return end;
+    std::sort(begin, end, [](louvain_edge_t const& a, louvain_edge_t const& b) { return a.target < b.target; });
+    louvain_edge_t* merged = begin;
+    for (louvain_edge_t* it = begin + 1; it != end; ++it) {
+        if (it->target == merged->target)
+            merged->weight += it->weight;
+        else
+            *++merged = *it;
+    }
+    return merged + 1;
+}
 
-                if (delta > best_mod) {
-                    best_mod = delta;
-                    best_com = neighbor_community;
+/**
+ * @brief State of the whole hierarchy. Arrays are sized for the first, largest, level,
+ * and only their prefixes are used by the following levels.
+ */
+struct louvain_t {
+    std::size_t threads_count = 1;
+
+    /// Symmetric graph of the current level in the CSR format. Self-loops keep the internal
+    /// weights of collapsed communities, so the weights of every row sum up to its degree.
+    std::size_t vertices_count = 0;
+    std::vector<std::size_t> offsets;
+    std::vector<louvain_edge_t> edges;
+    std::vector<std::uint64_t> degrees;
+    /// Sum of all the weights, or the doubled number of edges in the modularity formula.
+    std::uint64_t total_weight = 0;
+
+    std::vector<louvain_idx_t> communities;
+    std::vector<louvain_idx_t> next_communities;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> community_degrees;
+    std::unique_ptr<std::atomic<louvain_idx_t>[]> community_sizes;
+
+    /// Current level vertex of every original vertex.
+    std::vector<louvain_idx_t> membership;
+
+    /// Rows are first gathered into the `spare_edges`, at the upper bounds of their positions,
+    /// and then compacted back into `edges`.
+    std::vector<louvain_edge_t> spare_edges;
+    std::vector<std::size_t> spare_offsets;
+    std::vector<std::size_t> rows_lengths;
+    std::vector<louvain_idx_t> members;
+    std::vector<std::size_t> members_offsets;
+
+    std::vector<std::vector<louvain_edge_t>> threads_edges;
+    std::vector<std::size_t> chunks_moves;
+    std::vector<std::uint64_t> chunks_internal_weights;
+    std::vector<double> chunks_squared_degrees;
+
+    louvain_t(graph_csr_t const& csr, std::size_t threads) noexcept(false) : threads_count(threads) {
+
+        std::size_t const count = csr.vertices.size();
+        std::size_t const neighbors_count = csr.neighbors.size();
+        if (count >= std::numeric_limits<louvain_idx_t>::max() ||
+            neighbors_count > std::numeric_limits<louvain_weight_t>::max())
+            throw std::length_error("Graph is too large for 32-bit vertex positions and weights");
+
+        vertices_count = count;
+        offsets.resize(count + 1);
+        edges.resize(neighbors_count);
+        degrees.resize(count);
+        communities.resize(count);
+        next_communities.resize(count);
+        community_degrees.reset(new std::atomic<std::uint64_t>[count]);
+        community_sizes.reset(new std::atomic<louvain_idx_t>[count]);
+        membership.resize(count);
+        spare_edges.resize(neighbors_count);
+        spare_offsets.resize(count + 1);
+        rows_lengths.resize(count);
+        members.resize(count);
+        members_offsets.resize(count + 1);
+        threads_edges.resize(threads_count);
+
+        std::size_t const chunks_count = divide_round_up(count, louvain_chunk_size_k);
+        chunks_moves.resize(chunks_count);
+        chunks_internal_weights.resize(chunks_count);
+        chunks_squared_degrees.resize(chunks_count);
+
+        // Replace neighbors with their positions, dropping the ones without entries of their own
+        ustore_key_t const* vertices = csr.vertices.begin();
+        ustore_key_t const* vertices_end = csr.vertices.end();
+        std::copy(csr.offsets.begin(), csr.offsets.end(), spare_offsets.begin());
+        auto index_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) {
+                louvain_edge_t* row = spare_edges.data() + spare_offsets[i];
+                louvain_edge_t* row_end = row;
+                for (std::size_t j = csr.offsets[i]; j != csr.offsets[i + 1]; ++j) {
+                    ustore_key_t const neighbor = csr.neighbors[j];
+                    ustore_key_t const* it = std::lower_bound(vertices, vertices_end, neighbor);
+                    if (it != vertices_end && *it == neighbor)
+                        *row_end++ = {static_cast<louvain_idx_t>(it - vertices), 1};
                 }
+                rows_lengths[i] = sort_and_merge_edges(row, row_end) - row;
+                membership[i] = static_cast<louvain_idx_t>(i);
             }
+        };
+        louvain_parallel_for(count, threads_count, index_chunk);
+        compact_rows(count);
+    }
 
-            if (best_com != vertex_community) {
-                community_degrees[vertex_community].tot_degree -= (vertex_degree - vertex_in_vertex_com_degree);
-                auto vertex_in_best_com_degree = degree_in_coms[best_com];
-                community_degrees[best_com].tot_degree += (vertex_degree - vertex_in_best_com_degree);
-                community_degrees[vertex_community].in_degree -= vertex_in_vertex_com_degree;
-                community_degrees[best_com].in_degree += vertex_in_best_com_degree;
-                partition[vertex] = best_com;
-                modified = true;
-                improvement = true;
+    /**
+     * @brief Moves the `rows_lengths` edges, gathered at `spare_offsets`, into the `edges`,
+     * recomputing the `offsets`, the `degrees` and the `total_weight` of the new level.
+     */
+    void compact_rows(std::size_t count) {
+        offsets[0] = 0;
+        for (std::size_t i = 0; i != count; ++i)
+            offsets[i + 1] = offsets[i] + rows_lengths[i];
+
+        auto compact_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) {
+                louvain_edge_t const* row = spare_edges.data() + spare_offsets[i];
+                std::copy(row, row + rows_lengths[i], edges.data() + offsets[i]);
+                std::uint64_t degree = 0;
+                for (louvain_edge_t const* it = row; it != row + rows_lengths[i]; ++it)
+                    degree += it->weight;
+                degrees[i] = degree;
             }
-        }
+        };
+        louvain_parallel_for(count, threads_count, compact_chunk);
+
+        vertices_count = count;
+        total_weight = 0;
+        for (std::size_t i = 0; i != count; ++i)
+            total_weight += degrees[i];
     }
 
-    return improvement;
-}
+    /**
+     * @brief Places every vertex of the current level into a community of its own.
+     */
+    void reset_communities() {
+        auto reset_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) {
+                communities[i] = static_cast<louvain_idx_t>(i);
+                community_degrees[i].store(degrees[i], std::memory_order_relaxed);
+                community_sizes[i].store(1, std::memory_order_relaxed);
+            }
+        };
+        louvain_parallel_for(vertices_count, threads_count, reset_chunk);
+    }
 
-double modularity(partition_t const& partition, community_degrees_t const& community_degrees, double deg_sum) noexcept {
-    auto m = deg_sum / 2.0;
-    auto norm = 1.0 / (m * m);
-    auto res = 0.0;
-    for (auto const& iter : partition) {
-        community_degree_t const& community_degree = community_degrees.at(iter.second);
-        res += ((community_degree.tot_degree - community_degree.in_degree) / m) - (deg_sum * deg_sum * norm);
+    double modularity() {
+        auto modularity_chunk = [&](std::size_t chunk_idx, std::size_t, std::size_t begin, std::size_t end) {
+            std::uint64_t internal_weight = 0;
+            double squared_degrees = 0;
+            for (std::size_t i = begin; i != end; ++i) {
+                for (std::size_t j = offsets[i]; j != offsets[i + 1]; ++j)
+                    if (communities[edges[j].target] == communities[i])
+                        internal_weight += edges[j].weight;
+                // Communities are labeled by the positions of vertices, so they are chunked the same way
+                double degree = static_cast<double>(community_degrees[i].load(std::memory_order_relaxed));
+                squared_degrees += degree * degree;
+            }
+            chunks_internal_weights[chunk_idx] = internal_weight;
+            chunks_squared_degrees[chunk_idx] = squared_degrees;
+        };
+        louvain_parallel_for(vertices_count, threads_count, modularity_chunk);
+
+        // Partial sums are reduced in a fixed order, to keep the results reproducible
+        std::size_t const chunks_count = divide_round_up(vertices_count, louvain_chunk_size_k);
+        std::uint64_t internal_weight = 0;
+        double squared_degrees = 0;
+        for (std::size_t chunk_idx = 0; chunk_idx != chunks_count; ++chunk_idx) {
+            internal_weight += chunks_internal_weights[chunk_idx];
+            squared_degrees += chunks_squared_degrees[chunk_idx];
+        }
+        double const total = static_cast<double>(total_weight);
+        return internal_weight / total - squared_degrees / (total * total);
     }
-    return res;
-}
 
-graph_t induce_community_graph(graph_collection_t& graph, partition_t const& partition) noexcept(false) {
+    /**
+     * @brief Picks the best community for every vertex into `next_communities`,
+     * without changing the communities themselves. Only the vertices at positions
+     * equal to `phase` modulo `stride` are allowed to move.
+     * @return The number of vertices, that will change their community.
+     */
+    std::size_t decide_moves(std::size_t stride, std::size_t phase) {
+        auto decide_chunk = [&](std::size_t chunk_idx, std::size_t thread_idx, std::size_t begin, std::size_t end) {
+            std::vector<louvain_edge_t>& weights = threads_edges[thread_idx];
+            std::size_t moves = 0;
+            for (std::size_t i = begin; i != end; ++i) {
+                louvain_idx_t const own = communities[i];
+                next_communities[i] = own;
+                if (i % stride != phase)
+                    continue;
 
-    graph_t induced_graph;
-    auto stream = graph.vertex_stream().throw_or_release();
+                // Sum up the weights of edges to every neighboring community, skipping self-loops
+                weights.clear();
+                for (std::size_t j = offsets[i]; j != offsets[i + 1]; ++j)
+                    if (edges[j].target != i)
+                        weights.push_back({communities[edges[j].target], edges[j].weight});
+                auto weights_end = sort_and_merge_edges(weights.data(), weights.data() + weights.size());
+
+                // Gains are scaled by the total weight, which doesn't change the comparisons
+                double const share = static_cast<double>(degrees[i]) / total_weight;
+                auto community_degree = [&](louvain_idx_t community) {
+                    return static_cast<double>(community_degrees[community].load(std::memory_order_relaxed));
+                };
+                louvain_weight_t own_weight = 0;
+                for (auto it = weights.data(); it != weights_end; ++it)
+                    if (it->target == own)
+                        own_weight = it->weight;
+                double best_gain = own_weight - share * (community_degree(own) - degrees[i]);
+                louvain_idx_t best = own;
+                for (auto it = weights.data(); it != weights_end; ++it) {
+                    if (it->target == own)
+                        continue;
+                    double gain = it->weight - share * community_degree(it->target);
+                    if (gain > best_gain) {
+                        best_gain = gain;
+                        best = it->target;
+                    }
+                }
 
-    while (!stream.is_end()) {
-        auto vertex = stream.key();
-        auto vertex_com = partition.at(vertex);
-        auto neighbors = graph.neighbors(vertex).throw_or_release();
-        for (auto neighbor : neighbors) {
-            auto neighbor_com = partition.at(neighbor);
-            if (vertex_com == neighbor_com)
-                continue;
-            induced_graph[vertex_com][neighbor_com] += 1;
-        }
-        ++stream;
+                bool const swaps_singletons = community_sizes[own].load(std::memory_order_relaxed) == 1 &&
+                                              community_sizes[best].load(std::memory_order_relaxed) == 1;
+                if (best == own || (swaps_singletons && best > own))
+                    continue;
+                next_communities[i] = best;
+                ++moves;
+            }
+            chunks_moves[chunk_idx] = moves;
+        };
+        louvain_parallel_for(vertices_count, threads_count, decide_chunk);
+
+        std::size_t const chunks_count = divide_round_up(vertices_count, louvain_chunk_size_k);
+        std::size_t moves = 0;
+        for (std::size_t chunk_idx = 0; chunk_idx != chunks_count; ++chunk_idx)
+            moves += chunks_moves[chunk_idx];
+        return moves;
     }
 
-    return induced_graph;
-}
-
-graph_t induce_community_graph(graph_t const& graph, partition_t const& partition) noexcept(false) {
+    /**
+     * @brief Moves the vertices from `communities` to `next_communities`, and swaps the two.
+     * Calling it twice in a row rolls the moves back.
+     */
+    void apply_moves() {
+        auto apply_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) {
+                louvain_idx_t const from = communities[i];
+                louvain_idx_t const to = next_communities[i];
+                if (from == to)
+                    continue;
+                community_degrees[from].fetch_sub(degrees[i], std::memory_order_relaxed);
+                community_degrees[to].fetch_add(degrees[i], std::memory_order_relaxed);
+                community_sizes[from].fetch_sub(1, std::memory_order_relaxed);
+                community_sizes[to].fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        louvain_parallel_for(vertices_count, threads_count, apply_chunk);
+        std::swap(communities, next_communities);
+    }
 
-    graph_t induced_graph;
-    for (auto const& graph_iter : graph) {
-        auto vertex_com = partition.at(graph_iter.first);
-        for (auto const& neighbor_iter : graph_iter.second) {
-            auto neighbor_com = partition.at(neighbor_iter.first);
-            if (vertex_com == neighbor_com)
+    /**
+     * @brief Repeats the sweeps of local moving, until the modularity stops growing.
+     * If simultaneous moves of neighbors reduce the modularity, the sweep is rolled back,
+     * and repeated with only a half of vertices allowed to move at once.
+     * @return The modularity of the resulting communities.
+     */
+    double move_locally(double modularity_before, double min_modularity_growth) {
+        std::size_t stride = 1;
+        for (std::size_t sweep = 0; sweep != louvain_sweeps_limit_k; ++sweep) {
+            if (!decide_moves(stride, sweep % stride))
+                break;
+            apply_moves();
+            double modularity_after = modularity();
+            if (modularity_after < modularity_before) {
+                apply_moves();
+                if (stride == louvain_stride_limit_k)
+                    break;
+                stride *= 2;
                 continue;
-            induced_graph[vertex_com][neighbor_com] += neighbor_iter.second;
+            }
+            bool const converged = modularity_after - modularity_before <= min_modularity_growth;
+            modularity_before = modularity_after;
+            if (converged)
+                break;
         }
+        return modularity_before;
     }
 
-    return induced_graph;
-}
-
-partition_t best_partition(graph_collection_t& graph_collection,
-                           float min_modularity_growth = 0.0000001) noexcept(false) {
-
-    auto count_vertices = graph_collection.number_of_vertices();
-    auto count_edges = graph_collection.number_of_edges();
-
-    partition_t partition;
-    std::vector<partition_t> partitions;
-    vertex_degrees_t vertex_degrees;
-    community_degrees_t community_degrees;
-
-    partition.reserve(count_vertices);
-    vertex_degrees.reserve(count_vertices);
-    community_degrees.reserve(count_vertices);
-
-    auto stream = graph_collection.vertex_stream().throw_or_release();
-    while (!stream.is_end()) {
-        auto vertices = stream.keys_batch();
-        auto degrees = graph_collection.degrees(vertices).throw_or_release();
-        for (std::size_t i = 0; i != vertices.size(); ++i) {
-            partition[vertices[i]] = vertices[i];
-            vertex_degrees[vertices[i]] = degrees[i];
-            community_degrees[vertices[i]] = {0, degrees[i]};
+    /**
+     * @brief Collapses every non-empty community into a single vertex of the next level,
+     * numbering them in the order of the vertices, that label them.
+     * Updates the `membership` of the original vertices.
+     * @return false, if no two vertices ended up in the same community.
+     */
+    bool coarsen() {
+        // Number the non-empty communities, reusing `next_communities` for the mapping,
+        // and reuse the `degrees` of the previous level for the new vertices
+        louvain_idx_t const count = static_cast<louvain_idx_t>(vertices_count);
+        louvain_idx_t coarse_count = 0;
+        std::vector<louvain_idx_t>& renumbered = next_communities;
+        for (louvain_idx_t community = 0; community != count; ++community) {
+            if (!community_sizes[community].load(std::memory_order_relaxed))
+                continue;
+            renumbered[community] = coarse_count;
+            ++coarse_count;
+        }
+        if (coarse_count == count)
+            return false;
+
+        // Group the vertices by their new positions with a counting sort
+        std::fill_n(members_offsets.begin(), coarse_count + 1, 0);
+        for (louvain_idx_t i = 0; i != count; ++i)
+            ++members_offsets[renumbered[communities[i]] + 1];
+        for (louvain_idx_t coarse = 0; coarse != coarse_count; ++coarse)
+            members_offsets[coarse + 1] += members_offsets[coarse];
+        std::copy_n(members_offsets.begin(), coarse_count, rows_lengths.begin());
+        for (louvain_idx_t i = 0; i != count; ++i)
+            members[rows_lengths[renumbered[communities[i]]]++] = i;
+
+        // Every coarse row needs at most as much space, as the rows of its members together
+        spare_offsets[0] = 0;
+        for (louvain_idx_t coarse = 0; coarse != coarse_count; ++coarse) {
+            std::size_t length = 0;
+            for (std::size_t j = members_offsets[coarse]; j != members_offsets[coarse + 1]; ++j)
+                length += offsets[members[j] + 1] - offsets[members[j]];
+            spare_offsets[coarse + 1] = spare_offsets[coarse] + length;
         }
-        stream.seek_to_next_batch();
-    }
 
-    bool improvement = first_phase(graph_collection, partition, vertex_degrees, community_degrees, count_edges);
-    auto mod = modularity(partition, community_degrees, count_edges);
-    auto graph = induce_community_graph(graph_collection, partition);
-    partitions.insert(partitions.begin(), std::move(partition));
-
-    while (improvement) {
-        partition_t partition;
-        partition.reserve(graph.size());
-        vertex_degrees.clear();
-        community_degrees.clear();
-
-        auto degree_sum = 0;
-        count_edges = 0;
-        for (auto const& graph_iter : graph) {
-            partition[graph_iter.first] = graph_iter.first;
-            double degree = 0;
-            for (auto const& neighbor_iter : graph_iter.second) {
-                degree += neighbor_iter.second;
-                count_edges += 1;
+        auto gather_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t coarse = begin; coarse != end; ++coarse) {
+                louvain_edge_t* row = spare_edges.data() + spare_offsets[coarse];
+                louvain_edge_t* row_end = row;
+                for (std::size_t j = members_offsets[coarse]; j != members_offsets[coarse + 1]; ++j)
+                    for (std::size_t k = offsets[members[j]]; k != offsets[members[j] + 1]; ++k)
+                        *row_end++ = {renumbered[communities[edges[k].target]], edges[k].weight};
+                rows_lengths[coarse] = sort_and_merge_edges(row, row_end) - row;
             }
-            degree_sum += degree;
-            vertex_degrees[graph_iter.first] = degree;
-            community_degrees[graph_iter.first] = {0, degree};
-        }
+        };
+        louvain_parallel_for(coarse_count, threads_count, gather_chunk);
 
-        improvement = second_phase(graph, partition, vertex_degrees, community_degrees, count_edges / 2);
-        auto new_mod = modularity(partition, community_degrees, degree_sum / 2);
-        if (new_mod - mod <= min_modularity_growth)
-            break;
+        auto relabel_chunk = [&](std::size_t, std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i)
+                membership[i] = renumbered[communities[membership[i]]];
+        };
+        louvain_parallel_for(membership.size(), threads_count, relabel_chunk);
 
-        graph = induce_community_graph(graph, partition);
-        partitions.insert(partitions.begin(), std::move(partition));
-        mod = new_mod;
+        compact_rows(coarse_count);
+        return true;
     }
+};
 
-    partition = partitions[0];
-    for (std::size_t index = 1; index != partitions.size(); ++index) {
-        for (auto const& iter : partitions[index])
-            partitions[index][iter.first] = partition[iter.second];
-        partition = partitions[index];
+/**
+ * @brief Detects the communities in a CSR snapshot of a graph, exported with `ustore_vertex_role_any_k`.
+ * The `csr` must stay valid until the call returns.
+ */
+louvain_partition_t best_partition(graph_csr_t const& csr,
+                                   std::size_t threads_count = 1,
+                                   double min_modularity_growth = 0.0000001) noexcept(false) {
+
+    louvain_partition_t partition;
+    partition.vertices.assign(csr.vertices.begin(), csr.vertices.end());
+    partition.communities = partition.vertices;
+    if (partition.vertices.empty())
+        return partition;
+
+    louvain_t louvain(csr, threads_count);
+    if (!louvain.total_weight)
+        return partition;
+
+    louvain.reset_communities();
+    partition.modularity = louvain.modularity();
+    while (true) {
+        double modularity = louvain.move_locally(partition.modularity, min_modularity_growth);
+        if (modularity - partition.modularity <= min_modularity_growth)
+            break;
+        if (!louvain.coarsen())
+            break;
+        partition.modularity = modularity;
+        ++partition.levels;
+        louvain.reset_communities();
     }
 
+    // Vertices are sorted, so the first member of every community has the smallest ID
+    std::vector<ustore_key_t> labels(louvain.vertices_count, ustore_key_unknown_k);
+    for (std::size_t i = 0; i != partition.vertices.size(); ++i) {
+        ustore_key_t& label = labels[louvain.membership[i]];
+        if (label == ustore_key_unknown_k)
+            label = partition.vertices[i];
+        partition.communities[i] = label;
+    }
     return partition;
-}
\ No newline at end of file
+}
+
+louvain_partition_t best_partition(graph_collection_t& graph_collection,
+                                   std::size_t threads_count = 1,
+                                   double min_modularity_growth = 0.0000001) noexcept(false) {
+    // The snapshot stays valid in the arena of `graph_collection`, until its next call
+    graph_csr_t csr = graph_collection.export_csr(ustore_vertex_role_any_k, false).throw_or_release();
+    return best_partition(csr, threads_count, min_modularity_growth);
+}
@@ -20,6 +20,59 @@ struct py_bin_req_t {
     ustore_length_t len {0};
 };
 
+#pragma region Zero-copy Exports
+
+/**
+ * @brief Arena with exported results, shared by all the NumPy arrays and Arrow buffers
+ * viewing it, so that it isn't reused by the next request to the same collection.
+ */
+using py_arena_ptr_t = std::shared_ptr<arena_t>;
+
+/**
+ * @brief Arrow buffer viewing a part of an exported arena, which it keeps alive.
+ */
+class py_arena_buffer_t final : public arrow::Buffer {
+    py_arena_ptr_t arena_;
+
+  public:
+    py_arena_buffer_t(void const* data, std::size_t size, py_arena_ptr_t arena) noexcept
+        : arrow::Buffer(reinterpret_cast<std::uint8_t const*>(data), static_cast<std::int64_t>(size)),
+          arena_(std::move(arena)) {}
+};
+
+inline std::shared_ptr<arrow::Buffer> wrap_into_buffer(void const* data, std::size_t size, py_arena_ptr_t const& arena) {
+    return std::make_shared<py_arena_buffer_t>(data, size, arena);
+}
+
+/**
+ * @brief Capsule releasing its share of an exported arena,
+ * once the last NumPy array using it as a `base` is collected.
+ */
+inline py::capsule wrap_into_capsule(py_arena_ptr_t const& arena) {
+    return py::capsule(new py_arena_ptr_t(arena), [](void* ptr) { delete reinterpret_cast<py_arena_ptr_t*>(ptr); });
+}
+
+template <typename element_at>
+py::array_t<element_at> wrap_into_numpy(element_at const* begin, std::size_t count, py::capsule const& owner) {
+    return py::array_t<element_at>(count, begin, owner);
+}
+
+/**
+ * @brief Wraps arena-backed results into a Python object, without copies.
+ */
+inline py::object wrap_into_python(std::shared_ptr<arrow::Array> const& array) {
+    PyObject* obj_ptr = arrow::py::wrap_array(array);
+    return py::reinterpret_steal<py::object>(obj_ptr);
+}
+
+/**
+ * @brief Checks if the keys argument is a single key or a batch of keys,
+ * which may also be passed as NumPy or Arrow arrays.
+ */
+inline bool is_single_key(PyObject* key_py) {
+    return !PySequence_Check(key_py) && !arrow::py::is_array(key_py);
+}
+
 #pragma region Writes
 
 /**
@@ -217,6 +270,7 @@ static py::object has_many_binaries(py_collection_gt<collection_at>& collection,
     PyObject* tuple_ptr = PyTuple_New(places.size());
     for (std::size_t i = 0; i != places.size(); ++i) {
         PyObject* obj_ptr = presences[i] ? Py_True : Py_False;
+        Py_INCREF(obj_ptr);
         PyTuple_SetItem(tuple_ptr, i, obj_ptr);
     }
     return py::reinterpret_steal<py::object>(tuple_ptr);
@@ -230,6 +284,7 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
     ustore_length_t* found_lengths = nullptr;
     ustore_bytes_ptr_t found_values = nullptr;
     bool const export_arrow = collection.export_into_arrow();
+    py_arena_ptr_t arena = export_arrow ? std::make_shared<arena_t>(collection.db()) : nullptr;
 
     parsed_places_t parsed_places {keys_py, collection.native};
     places_arg_t places = parsed_places;
@@ -240,7 +295,7 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
         read.db = collection.db();
         read.error = status.member_ptr();
         read.transaction = collection.txn();
-        read.arena = collection.member_arena();
+        read.arena = export_arrow ? arena->member_ptr() : collection.member_arena();
         read.options = collection.options();
         read.tasks_count = places.count;
         read.collections = collection.member_collection();
@@ -257,19 +312,13 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
     }
 
     if (export_arrow) {
+        // The buffers are views into the `arena`, that will be freed with the last of them
         auto shared_length = static_cast<int64_t>(places.count);
-        auto shared_offsets = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_offsets),
-            (shared_length + 1) * sizeof(ustore_length_t));
-        auto shared_data = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_values),
-            static_cast<int64_t>(found_offsets[places.count]));
-        auto shared_bitmap = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_presences),
-            divide_round_up<int64_t>(shared_length, CHAR_BIT));
-        auto shared = std::make_shared<arrow::BinaryArray>(shared_length, shared_offsets, shared_data, shared_bitmap);
-        PyObject* obj_ptr = arrow::py::wrap_array(std::static_pointer_cast<arrow::Array>(shared));
-        return py::reinterpret_steal<py::object>(obj_ptr);
+        auto shared_offsets = wrap_into_buffer(found_offsets, (shared_length + 1) * sizeof(ustore_length_t), arena);
+        auto shared_data = wrap_into_buffer(found_values, found_offsets[places.count], arena);
+        auto shared_bitmap = wrap_into_buffer(found_presences, divide_round_up<int64_t>(shared_length, CHAR_BIT), arena);
+        return wrap_into_python(
+            std::make_shared<arrow::BinaryArray>(shared_length, shared_offsets, shared_data, shared_bitmap));
     }
     else {
         embedded_blobs_t bins {places.size(), found_offsets, found_lengths, found_values};
@@ -285,13 +334,13 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
 
 template <typename collection_at>
 static py::object has_binary(py_collection_gt<collection_at>& collection, py::object key_py) {
-    auto is_single = !PySequence_Check(key_py.ptr());
+    auto is_single = is_single_key(key_py.ptr());
     auto func = is_single ? &has_one_binary<collection_at> : &has_many_binaries<collection_at>;
     return func(collection, key_py.ptr());
 }
 
 static py::object read_binary(py_blobs_collection_t& collection, py::object key_py) {
-    auto is_single = !PySequence_Check(key_py.ptr());
+    auto is_single = is_single_key(key_py.ptr());
     auto func = is_single ? &read_one_binary : &read_many_binaries;
     return func(collection, key_py.ptr());
 }
@@ -359,12 +408,12 @@ static py::array_t<ustore_key_t> scan_binary( //
     status_t status;
     ustore_length_t* found_lengths = nullptr;
     ustore_key_t* found_keys = nullptr;
-    bool const export_arrow = collection.export_into_arrow();
+    py_arena_ptr_t arena = std::make_shared<arena_t>(collection.db());
     ustore_scan_t scan {};
     scan.db = collection.db();
     scan.error = status.member_ptr();
     scan.transaction = collection.txn();
-    scan.arena = collection.member_arena();
+    scan.arena = arena->member_ptr();
     scan.options = collection.options();
     scan.tasks_count = 1;
     scan.collections = collection.member_collection();
@@ -377,18 +426,8 @@ static py::array_t<ustore_key_t> scan_binary( //
 
     status.throw_unhandled();
 
-    if (export_arrow) {
-        auto shared_length = static_cast<int64_t>(found_lengths[0]);
-        auto shared_data = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_keys),
-            shared_length * sizeof(ustore_key_t));
-        static_assert(std::is_same_v<ustore_key_t, int64_t>, "Change the following line!");
-        auto shared = std::make_shared<arrow::NumericArray<arrow::Int64Type>>(shared_length, shared_data);
-        PyObject* obj_ptr = arrow::py::wrap_array(std::static_pointer_cast<arrow::Array>(shared));
-        return py::reinterpret_steal<py::object>(obj_ptr);
-    }
-    else
-        return py::array_t<ustore_key_t>(found_lengths[0], found_keys);
+    // The keys are viewed by NumPy in place, keeping the `arena` alive
+    return wrap_into_numpy<ustore_key_t>(found_keys, found_lengths[0], wrap_into_capsule(arena));
 }
 
 template <typename collection_at>
@@ -396,140 +435,67 @@ static std::size_t get_length(py_collection_gt<collection_at>& collection) {
     return collection.native.size();
 }
 
-#if 0
 /**
- * @brief Exports values into preallocated multi-dimensional NumPy-like buffers.
- *        The most performant batch-reading method, ideal for ML.
- *
- * Contrary to most data types exposed by the Python interpreter,
- * buffers are not @c PyObject pointers but rather simple C structures.
- * This allows them to be created and copied very simply.
- * When a generic wrapper around a buffer is needed, a @c memoryview
- * object can be created.
- * https://docs.python.org/3/c-api/buffer.html#buffer-structure
+ * @brief Exports values into a new NumPy matrix, with one row per key, truncating longer values
+ * and padding shorter ones with `padding`. The most performant batch-reading method, ideal for ML.
  *
- * @param keys       A NumPy array of keys.
- * @param values_arr A buffer-protocol object, whose `shape` has 2 dims
- *                   the `itemsize` is just one byte. The first dimensions
- *                   must match with `len(keys)` and the second one must be
- *                   at least 8 for us be able to efficiently reuse that memory.
+ * @return Tuple of the `uint8` matrix of shape `(len(keys), truncation)` and
+ *         the `uint32` vector with the lengths of the exported prefixes.
  *
- * @param values_lengths May be nullptr.
- *
- * https://pybind11.readthedocs.io/en/stable/advanced/pycpp/numpy.html#buffer-protocol
- * https://pybind11.readthedocs.io/en/stable/advanced/cast/overview.html#list-of-all-builtin-conversions
- * https://docs.python.org/3/c-api/buffer.html
+ * https://pybind11.readthedocs.io/en/stable/advanced/pycpp/numpy.html
  */
-void fill_tensor( //
-    ustore_database_t db_ptr,
-    ustore_transaction_t txn_ptr,
-    ustore_collection_t collection_ptr,
-    managed_arena_t& arena,
-    py::handle keys_arr,
-    py::handle values_arr,
-    py::handle values_lengths_arr,
-    std::uint8_t padding_char = 0) {
-
-    // Check if we are receiving protocol buffers
-    PyObject* keys_obj = keys_arr.ptr();
-    PyObject* values_obj = values_arr.ptr();
-    PyObject* values_lengths_obj = values_lengths_arr.ptr();
-    if (!PyObject_CheckBuffer(keys_obj) | !PyObject_CheckBuffer(values_obj) | !PyObject_CheckBuffer(values_lengths_obj))
-        throw std::invalid_argument("All arguments must implement the buffer protocol");
-
-    // Take buffer protocol handles
-    // Flags can be: https://docs.python.org/3/c-api/buffer.html#readonly-format
-    auto output_flags = PyBUF_WRITABLE | PyBUF_ANY_CONTIGUOUS | PyBUF_STRIDED;
-    py_received_buffer_t keys, values, values_lengths;
-    keys.initialized = PyObject_GetBuffer(keys_obj, &keys.py, PyBUF_ANY_CONTIGUOUS) == 0;
-    values.initialized = PyObject_GetBuffer(values_obj, &values.py, output_flags) == 0;
-    values_lengths.initialized = PyObject_GetBuffer(values_lengths_obj, &values_lengths.py, output_flags) == 0;
-    if (!keys.initialized | !values.initialized | !values_lengths.initialized)
-        throw std::invalid_argument("Couldn't obtain buffer overviews");
-    if (!values.py.shape | !values_lengths.py.shape | !values.py.strides | !values_lengths.py.strides)
-        throw std::invalid_argument("Outputs shape wasn't inferred");
-
-    // Validate the format of `keys`
-    if (keys.py.itemsize != sizeof(ustore_key_t))
-        throw std::invalid_argument("Keys type mismatch");
-    if (keys.py.ndim != 1 || !PyBuffer_IsContiguous(&keys.py, 'A'))
-        throw std::invalid_argument("Keys must be placed in a continuous 1 dimensional array");
-    if (keys.py.strides[0] != sizeof(ustore_key_t))
-        throw std::invalid_argument("Keys can't be strided");
-    ustore_size_t const tasks_count = static_cast<ustore_size_t>(keys.py.len / keys.py.itemsize);
-    ustore_key_t const* keys_ptr = reinterpret_cast<ustore_key_t const*>(keys.py.buf);
-
-    // Validate the format of `values`
-    if (values.py.ndim != 2)
-        throw std::invalid_argument("Output tensor must have rank 2");
-    if (values.py.itemsize != sizeof(std::uint8_t))
-        throw std::invalid_argument("Output tensor must have single-byte entries");
-    if ((values.py.shape[0] <= 0) || values.py.shape[1] <= 0)
-        throw std::invalid_argument("Output tensor sides can't be zero");
-    if ((values.py.strides[0] <= 0) || values.py.strides[1] <= 0)
-        throw std::invalid_argument("Output tensor strides can't be negative");
-    if (tasks_count != static_cast<ustore_size_t>(values.py.shape[0]))
-        throw std::invalid_argument("Number of input keys and output slots doesn't match");
-    auto outputs_bytes = reinterpret_cast<std::uint8_t*>(values.py.buf);
-    auto outputs_bytes_stride = static_cast<std::size_t>(values.py.strides[0]);
-    auto output_bytes_cap = static_cast<ustore_length_t>(values.py.shape[1]);
-
-    // Validate the format of `values_lengths`
-    if (values_lengths.py.ndim != 1)
-        throw std::invalid_argument("Lengths tensor must have rank 1");
-    if (values_lengths.py.itemsize != sizeof(ustore_length_t))
-        throw std::invalid_argument("Lengths tensor must have 4-byte entries");
-    if (values_lengths.py.shape[0] <= 0)
-        throw std::invalid_argument("Lengths tensor sides can't be zero");
-    if (values_lengths.py.strides[0] <= 0)
-        throw std::invalid_argument("Lengths tensor strides can't be negative");
-    if (tasks_count != static_cast<ustore_size_t>(values_lengths.py.shape[0]))
-        throw std::invalid_argument("Number of input keys and output slots doesn't match");
-    auto outputs_lengths_bytes = reinterpret_cast<std::uint8_t*>(values_lengths.py.buf);
-    auto outputs_lengths_bytes_stride = static_cast<std::size_t>(values_lengths.py.strides[0]);
-
-    // Perform the read
-    [[maybe_unused]] py::gil_scoped_release release;
+static py::tuple read_matrix( //
+    py_blobs_collection_t& collection,
+    py::object keys_py,
+    std::size_t truncation,
+    std::uint8_t padding) {
+
     status_t status;
+    ustore_length_t* found_offsets = nullptr;
     ustore_length_t* found_lengths = nullptr;
     ustore_bytes_ptr_t found_values = nullptr;
-    ustore_options_t options = ustore_options_default_k;
-    ustore_read_t read {};
-    read.db = db_ptr;
-    read.error = status.internal_cptr();
-    read.transaction = txn_ptr;
-    read.arena = arena.internal_cptr();
-    read.options = options;
-    read.tasks_count = tasks_count;
-    read.collections = &collection_ptr;
-    read.keys = keys_ptr;
-    read.keys_stride = sizeof(ustore_key_t);
-    read.lengths = &found_lengths;
-    read.values = &found_values;
-
-    ustore_read(&read);
 
-    status.throw_unhandled();
+    parsed_places_t parsed_places {keys_py.ptr(), collection.native};
+    places_arg_t places = parsed_places;
+    auto rows = static_cast<py::ssize_t>(places.count);
+    py::array_t<std::uint8_t> values({rows, static_cast<py::ssize_t>(truncation)});
+    py::array_t<ustore_length_t> lengths(rows);
+    std::uint8_t* values_begin = values.mutable_data();
+    ustore_length_t* lengths_begin = lengths.mutable_data();
 
-    // Export the data into the matrix
-    taped_values_view_t inputs {found_lengths, found_values, tasks_count};
-    tape_iterator_t input_it = inputs.begin();
-    for (ustore_size_t i = 0; i != tasks_count; ++i, ++input_it) {
-        value_view_t input = *input_it;
-        auto input_bytes = reinterpret_cast<std::uint8_t const*>(input.begin());
-        auto input_length = static_cast<ustore_length_t const>(input.size());
-        std::uint8_t* output_bytes = outputs_bytes + outputs_bytes_stride * i;
-        ustore_length_t& output_length =
-            *reinterpret_cast<ustore_length_t*>(outputs_lengths_bytes + outputs_lengths_bytes_stride * i);
-
-        std::size_t count_copy = std::min(output_bytes_cap, input_length);
-        std::size_t count_pads = output_bytes_cap - count_copy;
-        std::memcpy(output_bytes, input_bytes, count_copy);
-        std::memset(output_bytes + count_copy, padding_char, count_pads);
-
-        output_length = count_copy;
+    {
+        [[maybe_unused]] py::gil_scoped_release release;
+        ustore_read_t read {};
+        read.db = collection.db();
+        read.error = status.member_ptr();
+        read.transaction = collection.txn();
+        read.arena = collection.member_arena();
+        read.options = collection.options();
+        read.tasks_count = places.count;
+        read.collections = collection.member_collection();
+        read.keys = places.keys_begin.get();
+        read.keys_stride = places.keys_begin.stride();
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+
+        ustore_read(&read);
+        status.throw_unhandled();
+
+        // Export the data into the matrix, without creating any Python objects
+        embedded_blobs_t bins {places.size(), found_offsets, found_lengths, found_values};
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            value_view_t val = bins[i];
+            std::uint8_t* row = values_begin + i * truncation;
+            std::size_t count_copy = std::min<std::size_t>(truncation, val.size());
+            if (count_copy)
+                std::memcpy(row, val.begin(), count_copy);
+            std::memset(row + count_copy, padding, truncation - count_copy);
+            lengths_begin[i] = static_cast<ustore_length_t>(count_copy);
+        }
     }
+
+    return py::make_tuple(values, lengths);
 }
-#endif
 
 } // namespace unum::ustore::pyb
\ No newline at end of file
@@ -153,7 +153,12 @@ void ustore::wrap_database(py::module& m) {
     // Apache Arrow shared memory handles:
     py_collection.def(
         "get_matrix",
-        [](py_blobs_collection_t& py_collection, py::object keys, std::size_t truncation, char padding) { return 0; });
+        [](py_blobs_collection_t& py_collection, py::object keys, std::size_t truncation, char padding) {
+            return read_matrix(py_collection, keys, truncation, static_cast<std::uint8_t>(padding));
+        },
+        py::arg("keys"),
+        py::arg("truncation"),
+        py::arg("padding") = '\0');
     py_collection.def("set_matrix",
                       [](py_blobs_collection_t& py_collection, py::object keys, py::object vals) { return 0; });
 
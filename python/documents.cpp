@@ -235,10 +235,10 @@ static py::object read_one_doc(py_docs_collection_t& py_collection, PyObject* ke
 }
 
 static py::object read_many_docs(py_docs_collection_t& py_collection, PyObject* keys_py) {
-    if (!PySequence_Check(keys_py))
-        throw std::invalid_argument("Keys Must Be Sequence");
-    std::vector<ustore_key_t> keys(PySequence_Size(keys_py));
-    py_transform_n(keys_py, &py_to_scalar<ustore_key_t>, keys.begin());
+    // NumPy and Arrow arrays of keys are viewed in place
+    parsed_places_t parsed_places {keys_py, py_collection.native};
+    places_arg_t places = parsed_places;
+    keys_view_t keys {places.keys_begin, places.count};
     py::list values(keys.size());
 
     auto maybe_retrieved = py_collection.native[keys].value();
@@ -250,7 +250,7 @@ static py::object read_many_docs(py_docs_collection_t& py_collection, PyObject*
 }
 
 static py::object read_doc(py_docs_collection_t& py_collection, py::object key_py) {
-    auto is_single = !PySequence_Check(key_py.ptr());
+    auto is_single = is_single_key(key_py.ptr());
     auto func = is_single ? &read_one_doc : &read_many_docs;
     return func(py_collection, key_py.ptr());
 }
@@ -283,6 +283,67 @@ static void patch(py_docs_collection_t& py_collection, py::object key_py, py::ob
     py_collection.native[key].patch(value_view_t(json_str));
 }
 
+static ustore_doc_aggregation_t parse_aggregation(std::string_view name) {
+    if (name == "count")
+        return ustore_doc_aggregate_count_k;
+    if (name == "sum")
+        return ustore_doc_aggregate_sum_k;
+    if (name == "min")
+        return ustore_doc_aggregate_min_k;
+    if (name == "max")
+        return ustore_doc_aggregate_max_k;
+    if (name == "avg")
+        return ustore_doc_aggregate_avg_k;
+    throw std::invalid_argument("Unknown aggregation, expecting: count, sum, min, max or avg");
+}
+
+/**
+ * @brief Evaluates `(function, field)` pairs over a range of documents on the native side.
+ * Returns a dictionary, mapping every group value, or `None` for documents without the
+ * grouping field, to the list of results in the order of `aggregations`.
+ */
+static py::object aggregate_docs(py_docs_collection_t& py_collection,
+                                 std::vector<std::pair<std::string, std::optional<std::string>>> const& aggregations,
+                                 std::optional<std::string> const& group_by,
+                                 std::size_t threads,
+                                 ustore_key_t min_key,
+                                 ustore_key_t max_key) {
+
+    std::vector<ustore_doc_aggregation_t> functions(aggregations.size());
+    std::vector<ustore_str_view_t> fields(aggregations.size());
+    for (std::size_t i = 0; i != aggregations.size(); ++i) {
+        functions[i] = parse_aggregation(aggregations[i].first);
+        fields[i] = aggregations[i].second ? aggregations[i].second->c_str() : nullptr;
+    }
+
+    docs_collection_t& native = py_collection.native;
+    expected_gt<docs_aggregates_t> maybe_aggregates;
+    {
+        [[maybe_unused]] py::gil_scoped_release release;
+        maybe_aggregates = native.aggregate({functions.data(), functions.size()},
+                                            {fields.data(), fields.size()},
+                                            group_by ? group_by->c_str() : nullptr,
+                                            threads,
+                                            min_key,
+                                            max_key);
+    }
+    maybe_aggregates.throw_unhandled();
+    docs_aggregates_t const& aggregates = *maybe_aggregates;
+
+    py::dict result;
+    for (std::size_t group_idx = 0; group_idx != aggregates.groups_count; ++group_idx) {
+        py::list results(functions.size());
+        for (std::size_t i = 0; i != functions.size(); ++i)
+            results[i] = functions[i] == ustore_doc_aggregate_count_k
+                             ? py::object(py::int_(static_cast<std::size_t>(aggregates.result(i, group_idx))))
+                             : py::object(py::float_(aggregates.result(i, group_idx)));
+        auto group = aggregates.group(group_idx);
+        py::object group_py = group ? py::object(py::str(group->data(), group->size())) : py::object(py::none {});
+        result[group_py] = results;
+    }
+    return result;
+}
+
 void ustore::wrap_document(py::module& m) {
     using py_docs_kvstream_t = py_stream_with_ending_gt<docs_pairs_stream_t>;
 
@@ -307,6 +368,13 @@ void ustore::wrap_document(py::module& m) {
 
     py_docs_collection.def("merge", &merge);
     py_docs_collection.def("patch", &patch);
+    py_docs_collection.def("aggregate",
+                           &aggregate_docs,
+                           py::arg("aggregations"),
+                           py::arg("group_by") = std::nullopt,
+                           py::arg("threads") = 1,
+                           py::arg("min_key") = std::numeric_limits<ustore_key_t>::min(),
+                           py::arg("max_key") = std::numeric_limits<ustore_key_t>::max());
 
     py_docs_collection.def_property_readonly("keys", [](py_docs_collection_t& py_collection) {
         blobs_range_t members(py_collection.db(), py_collection.txn(), 0, *py_collection.member_collection());
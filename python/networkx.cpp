@@ -1,4 +1,5 @@
 #include <charconv>
+#include <thread>
 
 #include "pybind.hpp"
 #include "crud.hpp"
@@ -107,6 +108,8 @@ struct nodes_stream_t {
     nodes_stream_t(
         keys_stream_t&& stream, docs_collection_t& col, bool data, std::string field, std::string default_value)
         : native(std::move(stream)), collection(col), read_data(data), field(field), default_value(default_value) {
+        // Following batches are scanned, while Python is processing this one
+        native.fetch_in_background().throw_unhandled();
         nodes = native.keys_batch();
         if (read_data)
             attrs = read_attributes(collection, nodes.strided(), field.size() ? field.c_str() : nullptr);
@@ -148,6 +151,7 @@ struct edges_stream_t {
     edges_stream_t(
         graph_stream_t&& stream, docs_collection_t& col, bool data, std::string field, std::string default_value)
         : native(std::move(stream)), collection(col), read_data(data), field(field), default_value(default_value) {
+        native.fetch_in_background().throw_unhandled();
         edges = native.edges_batch();
         if (read_data)
             attrs = read_attributes(collection, edges.edge_ids.immutable(), field.size() ? field.c_str() : nullptr);
@@ -218,6 +222,7 @@ struct degrees_stream_t {
 
     degrees_stream_t(keys_stream_t&& stream, py_graph_t& net, std::string field, ustore_vertex_role_t role)
         : keys_stream(std::move(stream)), graph(net), weight_field(field), vertex_role(role) {
+        keys_stream.fetch_in_background().throw_unhandled();
         fetched_nodes = keys_stream.keys_batch();
         compute_degrees(graph,
                         fetched_nodes,
@@ -297,6 +302,177 @@ py::object wrap_into_buffer(py_graph_t& g, strided_range_gt<element_at> range) {
     return py::reinterpret_steal<py::object>(obj);
 }
 
+/**
+ * @brief Owns the arena with an exported CSR, until the last NumPy array viewing it is released.
+ */
+struct csr_part_t {
+    arena_t arena;
+    graph_csr_t csr;
+    status_t status;
+
+    csr_part_t(ustore_database_t db) : arena(db) {}
+};
+
+template <typename element_at>
+py::array_t<element_at> wrap_into_array(ptr_range_gt<element_at> range, py::object const& owner) {
+    return py::array_t<element_at>(range.size(), range.begin(), owner);
+}
+
+/**
+ * @brief Splits the key space into up to `threads` ranges at the quantiles of a random sample of vertices.
+ * Transactions are exported as a single range.
+ */
+std::vector<ustore_key_t> split_key_space(py_graph_t& g, std::size_t threads) {
+    std::vector<ustore_key_t> split_points;
+    if (threads <= 1 || g.index.txn())
+        return split_points;
+    arena_t sample_arena(g.index.db());
+    blobs_range_t members(g.index.db(), nullptr, g.index.snap(), g.index);
+    auto sample = keys_range_t {members}.sample(threads * 64, sample_arena).throw_or_release();
+    std::vector<ustore_key_t> sorted(sample.begin(), sample.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 1; i < threads && sorted.size(); ++i)
+        split_points.push_back(sorted[i * sorted.size() / threads]);
+    split_points.erase(std::unique(split_points.begin(), split_points.end()), split_points.end());
+    return split_points;
+}
+
+/**
+ * @brief Exports every range between the `split_points` into a separate part, calling
+ * `export_part(graph, min_vertex, max_vertex)` from a separate thread, with the GIL released.
+ */
+template <typename export_part_at>
+std::vector<std::unique_ptr<csr_part_t>> export_parts(py_graph_t& g,
+                                                      std::vector<ustore_key_t> const& split_points,
+                                                      export_part_at&& export_part) {
+    ustore_database_t db = g.index.db();
+    std::vector<std::unique_ptr<csr_part_t>> parts;
+    for (std::size_t i = 0; i <= split_points.size(); ++i)
+        parts.push_back(std::make_unique<csr_part_t>(db));
+    {
+        [[maybe_unused]] py::gil_scoped_release release;
+        auto export_at = [&](std::size_t i) {
+            csr_part_t& part = *parts[i];
+            ustore_key_t min_vertex = i ? split_points[i - 1] : std::numeric_limits<ustore_key_t>::min();
+            ustore_key_t max_vertex =
+                i != split_points.size() ? split_points[i] - 1 : std::numeric_limits<ustore_key_t>::max();
+            graph_collection_t graph(db, g.index, g.index.txn(), g.index.snap(), part.arena.member_ptr());
+            expected_gt<graph_csr_t> maybe = export_part(graph, min_vertex, max_vertex);
+            if (maybe)
+                part.csr = *maybe;
+            else
+                part.status = maybe.release_status();
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1; i < parts.size(); ++i)
+            workers.emplace_back(export_at, i);
+        export_at(0);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+    for (auto& part : parts)
+        part->status.throw_unhandled();
+    return parts;
+}
+
+/**
+ * @brief Exports the graph in the Compressed Sparse Row format, splitting the key space
+ * into `threads` ranges. Single-threaded exports are passed to NumPy without copies.
+ */
+py::tuple export_csr(py_graph_t& g, ustore_vertex_role_t role, bool export_edges, std::size_t threads) {
+
+    auto export_part = [&](graph_collection_t& graph, ustore_key_t min_vertex, ustore_key_t max_vertex) {
+        return graph.export_csr(role, export_edges, min_vertex, max_vertex);
+    };
+    auto parts = export_parts(g, split_key_space(g, threads), export_part);
+    if (parts.size() == 1) {
+        csr_part_t* part = parts[0].release();
+        py::capsule owner(part, [](void* ptr) { delete reinterpret_cast<csr_part_t*>(ptr); });
+        graph_csr_t& csr = part->csr;
+        if (!export_edges)
+            return py::make_tuple(wrap_into_array(csr.vertices, owner),
+                                  wrap_into_array(csr.offsets, owner),
+                                  wrap_into_array(csr.neighbors, owner));
+        return py::make_tuple(wrap_into_array(csr.vertices, owner),
+                              wrap_into_array(csr.offsets, owner),
+                              wrap_into_array(csr.neighbors, owner),
+                              wrap_into_array(csr.edges, owner));
+    }
+
+    // Concatenate the parts, shifting the offsets
+    std::size_t vertices_count = 0, neighbors_count = 0;
+    for (auto& part : parts)
+        vertices_count += part->csr.vertices.size(), neighbors_count += part->csr.neighbors.size();
+    py::array_t<ustore_key_t> vertices(vertices_count);
+    py::array_t<ustore_size_t> offsets(vertices_count + 1);
+    py::array_t<ustore_key_t> neighbors(neighbors_count);
+    py::array_t<ustore_key_t> edges(export_edges ? neighbors_count : 0);
+    std::size_t passed_vertices = 0, passed_neighbors = 0;
+    offsets.mutable_at(0) = 0;
+    for (auto& part : parts) {
+        graph_csr_t const& csr = part->csr;
+        std::copy(csr.vertices.begin(), csr.vertices.end(), vertices.mutable_data() + passed_vertices);
+        for (std::size_t i = 0; i != csr.vertices.size(); ++i)
+            offsets.mutable_at(passed_vertices + i + 1) = passed_neighbors + csr.offsets[i + 1];
+        std::copy(csr.neighbors.begin(), csr.neighbors.end(), neighbors.mutable_data() + passed_neighbors);
+        if (export_edges)
+            std::copy(csr.edges.begin(), csr.edges.end(), edges.mutable_data() + passed_neighbors);
+        passed_vertices += csr.vertices.size();
+        passed_neighbors += csr.neighbors.size();
+    }
+    if (!export_edges)
+        return py::make_tuple(vertices, offsets, neighbors);
+    return py::make_tuple(vertices, offsets, neighbors, edges);
+}
+
+/**
+ * @brief Exports the IDs and the degrees of all vertices into NumPy arrays, parsing just
+ * the headers of entries, splitting the key space into `threads` ranges.
+ */
+py::tuple export_degrees(py_graph_t& g, ustore_vertex_role_t role, std::size_t threads) {
+
+    auto export_part = [&](graph_collection_t& graph, ustore_key_t min_vertex, ustore_key_t max_vertex) {
+        return graph.export_degrees(role, min_vertex, max_vertex);
+    };
+    auto parts = export_parts(g, split_key_space(g, threads), export_part);
+
+    std::size_t vertices_count = 0;
+    for (auto& part : parts)
+        vertices_count += part->csr.vertices.size();
+    py::array_t<ustore_key_t> vertices(vertices_count);
+    py::array_t<ustore_vertex_degree_t> degrees(vertices_count);
+    std::size_t passed_vertices = 0;
+    for (auto& part : parts) {
+        graph_csr_t const& csr = part->csr;
+        std::copy(csr.vertices.begin(), csr.vertices.end(), vertices.mutable_data() + passed_vertices);
+        for (std::size_t i = 0; i != csr.vertices.size(); ++i)
+            degrees.mutable_at(passed_vertices + i) =
+                static_cast<ustore_vertex_degree_t>(csr.offsets[i + 1] - csr.offsets[i]);
+        passed_vertices += csr.vertices.size();
+    }
+    return py::make_tuple(vertices, degrees);
+}
+
+template <typename element_at>
+py::array_t<element_at> copy_into_array(ptr_range_gt<element_at> range) {
+    return py::array_t<element_at>(range.size(), range.begin());
+}
+
+/**
+ * @brief Calls `run(graph)` with the GIL released, and then `wrap(result)` to copy
+ * the outputs into NumPy arrays, before the temporary arena is freed.
+ */
+template <typename run_at, typename wrap_at>
+py::tuple run_algorithm(py_graph_t& g, run_at&& run, wrap_at&& wrap) {
+    arena_t arena(g.index.db());
+    graph_collection_t graph(g.index.db(), g.index, g.index.txn(), g.index.snap(), arena.member_ptr());
+    auto maybe_result = [&] {
+        [[maybe_unused]] py::gil_scoped_release release;
+        return run(graph);
+    }();
+    return wrap(std::move(maybe_result).throw_or_release());
+}
+
 void ustore::wrap_networkx(py::module& m) {
 
     auto degs = py::class_<degree_view_t>(m, "DegreeView", py::module_local());
@@ -354,6 +530,18 @@ void ustore::wrap_networkx(py::module& m) {
         return degrees_stream_t(std::move(stream), g, degs.weight, degs.roles);
     });
 
+    degs.def(
+        "to_numpy",
+        [](degree_view_t& degs, std::size_t threads) {
+            py_graph_t& g = *degs.net_ptr.lock().get();
+            if (degs.weight.size())
+                throw std::invalid_argument("Weighted degrees can't be exported");
+            return export_degrees(g, degs.roles, threads);
+        },
+        py::arg("threads") = 1,
+        "Exports NumPy arrays of sorted vertex IDs and their degrees, "
+        "scanning disjoint key ranges from `threads` threads.");
+
     degs_stream.def("__next__", [](degrees_stream_t& stream) { return stream.next(); });
 
     auto nodes_range = py::class_<nodes_range_t, std::shared_ptr<nodes_range_t>>(m, "NodesRange", py::module_local());
@@ -1037,12 +1225,83 @@ void ustore::wrap_networkx(py::module& m) {
 
     g.def(
         "community_louvain",
-        [](py_graph_t& g) {
-            graph_collection_t graph = g.ref();
-            auto partition = best_partition(graph);
-            return py::cast(partition);
+        [](py_graph_t& g, std::size_t threads) {
+            arena_t arena(g.index.db());
+            graph_collection_t graph(g.index.db(), g.index, g.index.txn(), g.index.snap(), arena.member_ptr());
+            louvain_partition_t partition;
+            {
+                [[maybe_unused]] py::gil_scoped_release release;
+                partition = best_partition(graph, threads);
+            }
+            py::dict result;
+            for (std::size_t i = 0; i != partition.vertices.size(); ++i)
+                result[py::int_(partition.vertices[i])] = py::int_(partition.communities[i]);
+            return result;
+        },
+        py::arg("threads") = 1,
+        "Detects communities with the Louvain method, treating edges as undirected. "
+        "Returns a dictionary, mapping every vertex to the smallest vertex ID in its community.");
+
+    g.def(
+        "pagerank",
+        [](py_graph_t& g, ustore_float_t alpha, std::size_t max_iter, ustore_float_t tol, std::size_t threads) {
+            return run_algorithm(
+                g,
+                [&](graph_collection_t& graph) { return graph.pagerank(threads, alpha, tol, max_iter); },
+                [](graph_ranks_t const& ranks) {
+                    return py::make_tuple(copy_into_array(ranks.vertices), copy_into_array(ranks.ranks));
+                });
+        },
+        py::arg("alpha") = 0.85f,
+        py::arg("max_iter") = 100,
+        py::arg("tol") = 1e-6f,
+        py::arg("threads") = 1,
+        "Ranks all the vertices with PageRank, following the outgoing edges. "
+        "Returns NumPy arrays of sorted vertex IDs and their ranks.");
+    g.def(
+        "weakly_connected_components",
+        [](py_graph_t& g, std::size_t threads) {
+            return run_algorithm(
+                g,
+                [&](graph_collection_t& graph) { return graph.components(threads); },
+                [](graph_components_t const& components) {
+                    return py::make_tuple(copy_into_array(components.vertices),
+                                          copy_into_array(components.components));
+                });
+        },
+        py::arg("threads") = 1,
+        "Finds the weakly connected components. Returns NumPy arrays of sorted vertex IDs "
+        "and the smallest vertex ID of the component of each.");
+    g.def(
+        "triangles",
+        [](py_graph_t& g, std::size_t threads) {
+            return run_algorithm(
+                g,
+                [&](graph_collection_t& graph) { return graph.triangles(threads); },
+                [](graph_triangles_t const& triangles) {
+                    return py::make_tuple(copy_into_array(triangles.vertices), copy_into_array(triangles.triangles));
+                });
+        },
+        py::arg("threads") = 1,
+        "Counts the triangles of every vertex, ignoring the directions of edges. "
+        "Returns NumPy arrays of sorted vertex IDs and the numbers of triangles containing them.");
+
+    g.def(
+        "to_csr",
+        [](py_graph_t& g, std::string const& direction, bool edges, std::size_t threads) {
+            ustore_vertex_role_t role = direction == "out" ? ustore_vertex_source_k
+                                        : direction == "in" ? ustore_vertex_target_k
+                                        : direction == "any"
+                                            ? ustore_vertex_role_any_k
+                                            : throw std::invalid_argument("Direction must be 'out', 'in' or 'any'");
+            return export_csr(g, role, edges, threads);
         },
-        "Community Louvain.");
+        py::arg("direction") = "out",
+        py::arg("edges") = false,
+        py::arg("threads") = 1,
+        "Exports the adjacency as NumPy arrays of sorted vertex IDs, `len(vertices) + 1` offsets, "
+        "neighbor IDs and optionally edge IDs, in the Compressed Sparse Row format. "
+        "Multiple threads export disjoint ranges of vertices concurrently.");
 
     // Making copies and subgraphs
     // https://networkx.org/documentation/stable/reference/classes/multidigraph.html#making-copies-and-subgraphs
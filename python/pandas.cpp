@@ -135,7 +135,19 @@ void correct_table(docs_table_t& table) {
     }
 }
 
-static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df) {
+/**
+ * @brief Releases the share of the exported arena, once Arrow releases the last column viewing it.
+ */
+static void release_arena_array(struct ArrowArray* array) {
+    delete reinterpret_cast<py_arena_ptr_t*>(array->private_data);
+    array->private_data = nullptr;
+    release_malloced_array(array);
+}
+
+/**
+ * @brief Resolves the keys of the selected rows, applying `head` and `tail`.
+ */
+static std::vector<ustore_key_t>& select_rows(py_table_collection_t& df) {
 
     // Extract the keys, if not explicitly defined
     if (std::holds_alternative<std::monostate>(df.rows_keys))
@@ -164,27 +176,18 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
     }
     keys_count = keys_end - keys_begin;
     if (keys_count != keys_found.size()) {
-        std::memmove(keys_found.data(), keys_begin, keys_count);
+        std::memmove(keys_found.data(), keys_begin, keys_count * sizeof(ustore_key_t));
         keys_found.resize(keys_count);
     }
+    return keys_found;
+}
 
-    auto collection =
-        docs_collection_t(df.binary.db(), df.binary, df.binary.txn(), df.binary.snap(), df.binary.member_arena());
-    auto members = collection[keys_found];
-
-    // Extract the present fields
-    if (std::holds_alternative<std::monostate>(df.columns_names)) {
-        auto fields = members.gist().throw_or_release();
-        auto names = std::vector<ustore_str_view_t>(fields.size());
-        transform_n(fields, names.size(), names.begin(), std::mem_fn(&std::string_view::data));
-        df.columns_names = names;
-    }
+static table_header_view_t selected_header(py_table_collection_t& df) {
 
     // Request the fields
     if (std::holds_alternative<std::monostate>(df.columns_types))
         throw std::invalid_argument("Column types must be specified");
 
-    // Now the primary part, performing the exports
     auto fields = strided_range(std::get<std::vector<ustore_str_view_t>>(df.columns_names)).immutable();
     table_header_view_t header;
     header.count = fields.size();
@@ -195,7 +198,14 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
             : strided_iterator_gt<ustore_doc_field_type_t const>(
                   std::get<std::vector<ustore_doc_field_type_t>>(df.columns_types).data(),
                   sizeof(ustore_doc_field_type_t));
-    docs_table_t table = members.gather(header).throw_or_release();
+    return header;
+}
+
+/**
+ * @brief Exports a gathered table into Arrow, viewing the memory of the `arena`, if it is passed.
+ */
+static std::shared_ptr<arrow::RecordBatch> export_table(docs_table_t table, py_arena_ptr_t const& arena = {}) {
+
     table_header_view_t table_header = table.header();
 
     // Exports results into Arrow
@@ -209,6 +219,10 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
         &c_arrow_array,
         status.member_ptr());
     status.throw_unhandled();
+    if (arena) {
+        c_arrow_array.private_data = new py_arena_ptr_t(arena);
+        c_arrow_array.release = &release_arena_array;
+    }
 
     correct_table(table);
     // Exports columns one-by-one
@@ -231,6 +245,205 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
     return arrow::ImportRecordBatch(&c_arrow_array, &c_arrow_schema).ValueOrDie();
 }
 
+/**
+ * @param arena If passed, the exported columns will view it and keep it alive.
+ * Otherwise, they stay valid only until the next request on this collection.
+ */
+static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df, py_arena_ptr_t const& arena = {}) {
+
+    auto& keys_found = select_rows(df);
+    ustore_arena_t* members_arena = arena ? arena->member_ptr() : df.binary.member_arena();
+    auto collection = docs_collection_t(df.binary.db(), df.binary, df.binary.txn(), df.binary.snap(), members_arena);
+    auto members = collection[keys_found];
+
+    // Extract the present fields
+    if (std::holds_alternative<std::monostate>(df.columns_names)) {
+        auto fields = members.gist().throw_or_release();
+        auto names = std::vector<ustore_str_view_t>(fields.size());
+        transform_n(fields, names.size(), names.begin(), std::mem_fn(&std::string_view::data));
+        df.columns_names = names;
+    }
+
+    // Now the primary part, performing the exports
+    docs_table_t table = members.gather(selected_header(df)).throw_or_release();
+    return export_table(table, arena);
+}
+
+/**
+ * @brief Streams the selected rows of a table in fixed-size record batches,
+ * gathering every next one only when it is requested. Each batch views its own
+ * arena, so the memory of the batches already consumed is released with them.
+ *
+ * Owns copies of the column names, types and explicitly selected keys, so that
+ * later changes to the `DataFrame` don't affect the batches in flight.
+ * Ranges of keys without `head` and `tail` limits are scanned lazily.
+ */
+class docs_batches_reader_t : public arrow::RecordBatchReader {
+
+    std::shared_ptr<py_table_collection_t> df_;
+    std::vector<std::string> names_;
+    std::vector<ustore_str_view_t> fields_;
+    std::vector<ustore_doc_field_type_t> types_;
+    std::vector<ustore_key_t> keys_;
+    std::shared_ptr<arrow::Schema> schema_;
+    std::optional<docs_table_stream_t> stream_;
+    bool started_ = false;
+
+  public:
+    docs_batches_reader_t(std::shared_ptr<py_table_collection_t> df, std::size_t rows_per_batch) : df_(std::move(df)) {
+
+        if (std::holds_alternative<std::monostate>(df_->columns_names))
+            throw std::invalid_argument("Columns must be selected for paged exports");
+        table_header_view_t header = selected_header(*df_);
+        for (std::size_t i = 0; i != header.count; ++i) {
+            names_.emplace_back(header.fields_begin[i]);
+            types_.push_back(header.types_begin[i]);
+        }
+        for (std::string const& name : names_)
+            fields_.push_back(name.c_str());
+        header.fields_begin = {fields_.data(), sizeof(ustore_str_view_t)};
+        header.types_begin = {types_.data(), sizeof(ustore_doc_field_type_t)};
+
+        // The schema doesn't depend on the contents, as every gathered column may have NULLs
+        static ustore_octet_t const validities_k = 0;
+        status_t status;
+        ArrowSchema c_arrow_schema;
+        ArrowArray c_arrow_array;
+        ustore_to_arrow_schema(0, header.count, &c_arrow_schema, &c_arrow_array, status.member_ptr());
+        status.throw_unhandled();
+        for (std::size_t i = 0; i != header.count; ++i)
+            ustore_to_arrow_column( //
+                0,
+                fields_[i],
+                types_[i],
+                &validities_k,
+                nullptr,
+                nullptr,
+                c_arrow_schema.children[i],
+                c_arrow_array.children[i],
+                status.member_ptr());
+        c_arrow_array.release(&c_arrow_array);
+        status.throw_unhandled();
+        schema_ = arrow::ImportSchema(&c_arrow_schema).ValueOrDie();
+
+        blobs_collection_t& binary = df_->binary;
+        bool const is_limited = df_->head != std::numeric_limits<std::size_t>::max() ||
+                                df_->tail != std::numeric_limits<std::size_t>::max();
+        if (std::holds_alternative<std::vector<ustore_key_t>>(df_->rows_keys) || is_limited) {
+            keys_ = select_rows(*df_);
+            stream_.emplace(binary.db(),
+                            binary,
+                            binary.txn(),
+                            binary.snap(),
+                            header,
+                            ptr_range_gt<ustore_key_t const> {keys_.data(), keys_.size()},
+                            rows_per_batch);
+        }
+        else {
+            py_table_keys_range_t range;
+            if (std::holds_alternative<py_table_keys_range_t>(df_->rows_keys))
+                range = std::get<py_table_keys_range_t>(df_->rows_keys);
+            stream_.emplace(binary.db(),
+                            binary,
+                            binary.txn(),
+                            binary.snap(),
+                            header,
+                            rows_per_batch,
+                            1,
+                            range.min,
+                            range.max);
+        }
+    }
+
+    std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+    arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+        py_arena_ptr_t arena = std::make_shared<arena_t>(df_->binary.db());
+        stream_->on(*arena);
+        status_t status = started_ ? stream_->seek_to_next_batch() : stream_->seek_to_first();
+        started_ = true;
+        if (!status)
+            return arrow::Status::IOError(status.message());
+        if (stream_->is_end()) {
+            batch->reset();
+            return arrow::Status::OK();
+        }
+        try {
+            *batch = export_table(stream_->page(), arena);
+        }
+        catch (std::exception const& e) {
+            return arrow::Status::Invalid(e.what());
+        }
+        return arrow::Status::OK();
+    }
+};
+
+static std::shared_ptr<docs_batches_reader_t> read_batches(py_table_collection_t& df, std::size_t rows_per_batch) {
+    return std::make_shared<docs_batches_reader_t>(df.shared_from_this(), rows_per_batch);
+}
+
+/**
+ * @brief Joins the record batches of a paged table, without gathering all of its rows at once.
+ */
+static std::shared_ptr<arrow::Table> materialize_paged(py_table_collection_t& df, std::size_t rows_per_batch) {
+    auto reader = read_batches(df, rows_per_batch);
+    return arrow::Table::FromRecordBatchReader(reader.get()).ValueOrDie();
+}
+
+static py::dtype numpy_dtype(arrow::DataType const& type) {
+    switch (type.id()) {
+    case arrow::Type::INT8: return py::dtype::of<std::int8_t>();
+    case arrow::Type::INT16: return py::dtype::of<std::int16_t>();
+    case arrow::Type::INT32: return py::dtype::of<std::int32_t>();
+    case arrow::Type::INT64: return py::dtype::of<std::int64_t>();
+    case arrow::Type::UINT8: return py::dtype::of<std::uint8_t>();
+    case arrow::Type::UINT16: return py::dtype::of<std::uint16_t>();
+    case arrow::Type::UINT32: return py::dtype::of<std::uint32_t>();
+    case arrow::Type::UINT64: return py::dtype::of<std::uint64_t>();
+    case arrow::Type::HALF_FLOAT: return py::dtype("e");
+    case arrow::Type::FLOAT: return py::dtype::of<float>();
+    case arrow::Type::DOUBLE: return py::dtype::of<double>();
+    default: throw std::invalid_argument("Only numeric columns can be exported into NumPy");
+    }
+}
+
+/**
+ * @brief Exports numeric columns of the same type into a column-major NumPy matrix.
+ * A single column is viewed in place, keeping the arena alive.
+ * Missing entries are exported as zeros, use `to_arrow` to tell them apart.
+ */
+static py::array to_numpy(py_table_collection_t& df) {
+
+    py_arena_ptr_t arena = std::make_shared<arena_t>(df.binary.db());
+    auto batch = materialize(df, arena);
+    if (!batch->num_columns())
+        throw std::invalid_argument("No columns to export");
+
+    auto type = batch->column(0)->type();
+    for (int column_idx = 1; column_idx != batch->num_columns(); ++column_idx)
+        if (!batch->column(column_idx)->type()->Equals(*type))
+            throw std::invalid_argument("Columns must be of the same type, use `astype`");
+
+    py::dtype dtype = numpy_dtype(*type);
+    auto rows = static_cast<py::ssize_t>(batch->num_rows());
+    auto columns = static_cast<py::ssize_t>(batch->num_columns());
+    auto itemsize = static_cast<py::ssize_t>(dtype.itemsize());
+    auto column_begin = [&](int column_idx) {
+        auto column = std::static_pointer_cast<arrow::PrimitiveArray>(batch->column(column_idx));
+        return column->values()->data() + column->offset() * itemsize;
+    };
+
+    if (columns == 1)
+        return py::array(dtype, {rows, columns}, {itemsize, itemsize}, column_begin(0), wrap_into_capsule(arena));
+
+    // Columns are stored separately, so we copy them one after another
+    py::array contiguous(dtype, {columns, rows});
+    auto contiguous_begin = reinterpret_cast<std::uint8_t*>(contiguous.mutable_data());
+    for (int column_idx = 0; column_idx != columns; ++column_idx)
+        std::memcpy(contiguous_begin + column_idx * rows * itemsize, column_begin(column_idx), rows * itemsize);
+    return py::array(dtype, {rows, columns}, {itemsize, rows * itemsize}, contiguous_begin, contiguous);
+}
+
 template <typename array_type_at>
 void add_key_value( //
     std::shared_ptr<arrow::Array> array,
@@ -410,12 +623,31 @@ void ustore::wrap_pandas(py::module& m) {
     // Addresses may be: specific IDs or a slice.
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.loc.html#pandas.DataFrame.loc
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.iloc.html#pandas.DataFrame.iloc
-    df.def("to_arrow", [](py_table_collection_t& df) {
-        auto record_batch = materialize(df);
-        // https://github.com/apache/arrow/blob/a270afc946398a0279b1971a315858d8b5f07e2d/cpp/src/arrow/python/pyarrow.h#L52
-        PyObject* table_python = arrow::py::wrap_batch(record_batch);
-        return py::reinterpret_steal<py::object>(table_python);
-    });
+    // With `rows_per_batch`, the rows are gathered in chunks of that size and joined into a Table.
+    df.def(
+        "to_arrow",
+        [](py_table_collection_t& df, std::size_t rows_per_batch) {
+            if (rows_per_batch)
+                return py::reinterpret_steal<py::object>(arrow::py::wrap_table(materialize_paged(df, rows_per_batch)));
+            auto record_batch = materialize(df, std::make_shared<arena_t>(df.binary.db()));
+            // https://github.com/apache/arrow/blob/a270afc946398a0279b1971a315858d8b5f07e2d/cpp/src/arrow/python/pyarrow.h#L52
+            PyObject* table_python = arrow::py::wrap_batch(record_batch);
+            return py::reinterpret_steal<py::object>(table_python);
+        },
+        py::arg("rows_per_batch") = 0);
+
+    // Lazily gathers the rows in chunks, exporting a `pyarrow.RecordBatchReader`
+    // through the `ArrowArrayStream` C interface.
+    df.def(
+        "to_batches",
+        [](py_table_collection_t& df, std::size_t rows_per_batch) {
+            ArrowArrayStream c_arrow_stream;
+            if (!arrow::ExportRecordBatchReader(read_batches(df, rows_per_batch), &c_arrow_stream).ok())
+                throw std::runtime_error("Failed to export the stream");
+            auto reader_type = py::module_::import("pyarrow").attr("RecordBatchReader");
+            return reader_type.attr("_import_from_c")(reinterpret_cast<std::uintptr_t>(&c_arrow_stream));
+        },
+        py::arg("rows_per_batch") = docs_table_stream_t::default_rows_per_page_k);
 
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.to_json.html
     df.def(
@@ -455,40 +687,83 @@ void ustore::wrap_pandas(py::module& m) {
         py::arg("path") = "");
 
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.to_parquet.html
-    df.def("to_parquet", [](py_table_collection_t& df, std::string const& path) {
-        auto batch = materialize(df);
-        auto outfile = arrow::io::FileOutputStream::Open(path).ValueOrDie();
-        std::unique_ptr<parquet::arrow::FileWriter> writer;
-        parquet::arrow::FileWriter::Open(*batch->schema(),
-                                         arrow::default_memory_pool(),
-                                         outfile,
-                                         parquet::default_writer_properties(),
-                                         &writer);
-
-        auto table = arrow::Table::FromRecordBatches(batch->schema(), {batch}).ValueOrDie();
-        if (!(writer->WriteTable(*table, batch->num_rows()).ok()))
-            throw std::runtime_error("Write Failure");
-
-        if (!writer->Close().ok())
-            throw std::runtime_error("Close Failure");
-    });
+    // With `rows_per_batch`, every chunk of rows is gathered and written as a separate row group.
+    df.def(
+        "to_parquet",
+        [](py_table_collection_t& df, std::string const& path, std::size_t rows_per_batch) {
+            std::shared_ptr<arrow::RecordBatchReader> reader;
+            std::shared_ptr<arrow::RecordBatch> batch;
+            if (rows_per_batch)
+                reader = read_batches(df, rows_per_batch);
+            else
+                batch = materialize(df);
+            auto schema = reader ? reader->schema() : batch->schema();
+            auto outfile = arrow::io::FileOutputStream::Open(path).ValueOrDie();
+            std::unique_ptr<parquet::arrow::FileWriter> writer;
+            parquet::arrow::FileWriter::Open(*schema,
+                                             arrow::default_memory_pool(),
+                                             outfile,
+                                             parquet::default_writer_properties(),
+                                             &writer);
+
+            auto write_batch = [&](std::shared_ptr<arrow::RecordBatch> const& batch) {
+                auto table = arrow::Table::FromRecordBatches(schema, {batch}).ValueOrDie();
+                if (!(writer->WriteTable(*table, batch->num_rows()).ok()))
+                    throw std::runtime_error("Write Failure");
+            };
+            if (!reader)
+                write_batch(batch);
+            else
+                while (true) {
+                    if (!reader->ReadNext(&batch).ok())
+                        throw std::runtime_error("Read Failure");
+                    if (!batch)
+                        break;
+                    write_batch(batch);
+                }
 
-    // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.to_csv.html
-    df.def("to_csv", [](py_table_collection_t& df, std::string const& path) {
-        auto batch = materialize(df);
-        auto output = arrow::io::FileOutputStream::Open(path).ValueOrDie();
+            if (!writer->Close().ok())
+                throw std::runtime_error("Close Failure");
+        },
+        py::arg("path"),
+        py::arg("rows_per_batch") = 0);
 
-        auto writer =
-            arrow::csv::MakeCSVWriter(output, batch->schema(), arrow::csv::WriteOptions::Defaults()).ValueOrDie();
-        if (!writer->WriteRecordBatch(*batch).ok())
-            throw std::runtime_error("Write Failure");
+    // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.to_csv.html
+    df.def(
+        "to_csv",
+        [](py_table_collection_t& df, std::string const& path, std::size_t rows_per_batch) {
+            std::shared_ptr<arrow::RecordBatchReader> reader;
+            std::shared_ptr<arrow::RecordBatch> batch;
+            if (rows_per_batch)
+                reader = read_batches(df, rows_per_batch);
+            else
+                batch = materialize(df);
+            auto schema = reader ? reader->schema() : batch->schema();
+            auto output = arrow::io::FileOutputStream::Open(path).ValueOrDie();
+
+            auto writer = arrow::csv::MakeCSVWriter(output, schema, arrow::csv::WriteOptions::Defaults()).ValueOrDie();
+            if (!reader) {
+                if (!writer->WriteRecordBatch(*batch).ok())
+                    throw std::runtime_error("Write Failure");
+            }
+            else
+                while (true) {
+                    if (!reader->ReadNext(&batch).ok())
+                        throw std::runtime_error("Read Failure");
+                    if (!batch)
+                        break;
+                    if (!writer->WriteRecordBatch(*batch).ok())
+                        throw std::runtime_error("Write Failure");
+                }
 
-        if (!writer->Close().ok() || !writer->Close().ok())
-            throw std::runtime_error("Close Failure");
-    });
+            if (!writer->Close().ok() || !writer->Close().ok())
+                throw std::runtime_error("Close Failure");
+        },
+        py::arg("path"),
+        py::arg("rows_per_batch") = 0);
 
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.to_numpy.html
-    // df.def("to_numpy", [](py_table_collection_t& df, py::handle mat) {});
+    df.def("to_numpy", &to_numpy);
 
     // https://pandas.pydata.org/docs/reference/api/pandas.DataFrame.index.html#pandas.DataFrame.index
     // df.def("index", [](py_table_collection_t& df) {});
@@ -1,5 +1,6 @@
 import pytest
 import numpy as np
+import pyarrow as pa
 
 import ustore.ucset as ustore
 
@@ -167,6 +168,27 @@ def iterate(col):
         (1, b'a'), (2, b'aa'), (3, b'aaa'), (4, b'aaaa'), (5, b'aaaaa'), (6, b'aaaaaa')]
 
 
+def zero_copy_reads(col):
+    col.clear()
+    keys = np.arange(1, 11, dtype=np.int64)
+    col.set(keys, [(f'{i}' * i).encode() for i in keys])
+
+    # Arrays must stay valid after the following requests reuse the collection memory
+    vals = col[keys]
+    scanned = col.scan(1, 10)
+    col.get(pa.array([1, 2], type=pa.int64()))
+    col.clear()
+    assert [v.as_py() for v in vals] == [(f'{i}' * i).encode() for i in keys]
+    assert np.array_equal(scanned, keys)
+
+    col.set(keys, [(f'{i}' * i).encode() for i in keys])
+    matrix, lengths = col.get_matrix(keys, 4, padding=ord('-'))
+    assert matrix.shape == (10, 4)
+    assert bytes(matrix[0]) == b'1---'
+    assert bytes(matrix[9]) == b'1010'
+    assert np.array_equal(lengths, [1, 2, 3, 4, 4, 4, 4, 4, 4, 4])
+
+
 def test_main_collection():
     db = ustore.DataBase()
     main = db.main
@@ -177,6 +199,7 @@ def test_main_collection():
     batch_insert(main)
     scan(main)
     iterate(main)
+    zero_copy_reads(main)
 
 
 def test_named_collections():
@@ -367,3 +390,25 @@ def test_docs_batch():
     doc_col.remove(keys)
     assert 1 not in doc_col
     assert 2 not in doc_col
+
+
+def test_docs_aggregate():
+    db = ustore.DataBase()
+    col = db['aggregate_col'].docs
+    col.set(list(range(4)), [
+        {'city': 'Yerevan', 'price': 10},
+        {'city': 'Berlin', 'price': 20},
+        {'city': 'Yerevan', 'price': 30},
+        {'price': 40},
+    ])
+
+    aggregations = [('count', None), ('sum', '/price'), ('min', '/price'),
+                    ('max', '/price'), ('avg', '/price')]
+    groups = col.aggregate(aggregations, group_by='/city', threads=2)
+    assert list(groups.keys()) == ['Berlin', 'Yerevan', None]
+    assert groups['Yerevan'] == [2, 40.0, 10.0, 30.0, 20.0]
+    assert groups[None] == [1, 40.0, 40.0, 40.0, 40.0]
+
+    assert col.aggregate([('count', None)], min_key=1, max_key=2) == {None: [2]}
+    with pytest.raises(Exception):
+        col.aggregate([('median', '/price')])
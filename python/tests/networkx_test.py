@@ -127,6 +127,87 @@ def test_neighbors():
     net.clear()
 
 
+def test_to_csr():
+    db = ustore.DataBase()
+    net = db.main.graph
+
+    sources = np.random.randint(1000, size=10000)
+    targets = np.random.randint(1000, size=10000)
+    net.add_edges_from(sources, targets, np.arange(10000))
+
+    vertices, offsets, neighbors, edges = net.to_csr(edges=True)
+    assert len(offsets) == len(vertices) + 1
+    assert offsets[-1] == len(neighbors) == len(edges) == 10000
+    assert np.all(np.diff(vertices) > 0)
+    for index in np.random.randint(len(vertices), size=20):
+        row = neighbors[offsets[index]:offsets[index + 1]]
+        assert sorted(row) == sorted(targets[sources == vertices[index]])
+
+    for direction in ['out', 'in', 'any']:
+        single = net.to_csr(direction=direction)
+        parallel = net.to_csr(direction=direction, threads=4)
+        for a, b in zip(single, parallel):
+            assert np.array_equal(a, b)
+
+    net.clear()
+
+def test_graph_algorithms():
+    db = ustore.DataBase()
+    net = db.main.graph
+
+    net.add_edges_from([1, 2, 3, 3, 10], [2, 3, 1, 4, 11], np.arange(5))
+
+    vertices, components = net.weakly_connected_components(threads=2)
+    assert np.array_equal(vertices, [1, 2, 3, 4, 10, 11])
+    assert np.array_equal(components, [1, 1, 1, 1, 10, 10])
+
+    vertices, triangles = net.triangles(threads=2)
+    assert np.array_equal(triangles, [1, 1, 1, 0, 0, 0])
+
+    vertices, ranks = net.pagerank(threads=2)
+    assert abs(ranks.sum() - 1) < 1e-4
+    assert ranks[3] > ranks[4]
+
+    net.clear()
+
+def test_community_louvain():
+    db = ustore.DataBase()
+    net = db.main.graph
+
+    # Two cliques of 4 vertices, connected by a single edge
+    for clique in ([1, 2, 3, 4], [5, 6, 7, 8]):
+        for i, u in enumerate(clique):
+            for v in clique[i + 1:]:
+                net.add_edge(u, v)
+    net.add_edge(4, 5)
+
+    partition = net.community_louvain()
+    assert partition == {1: 1, 2: 1, 3: 1, 4: 1, 5: 5, 6: 5, 7: 5, 8: 5}
+    assert net.community_louvain(threads=4) == partition
+
+    net.clear()
+
+def test_degree_to_numpy():
+    db = ustore.DataBase()
+    net = db.main.graph
+
+    sources = np.random.randint(1000, size=10000)
+    targets = np.random.randint(1000, size=10000)
+    net.add_edges_from(sources, targets, np.arange(10000))
+
+    vertices, degrees = net.out_degree.to_numpy()
+    assert np.all(np.diff(vertices) > 0)
+    assert degrees.sum() == 10000
+    assert list(degrees) == [net.out_degree[v] for v in vertices]
+
+    for view in [net.degree, net.in_degree, net.out_degree]:
+        single = view.to_numpy()
+        parallel = view.to_numpy(threads=4)
+        for a, b in zip(single, parallel):
+            assert np.array_equal(a, b)
+
+    net.clear()
+
 def test_degree():
     db = ustore.DataBase()
     net = ustore.Network(db, 'graph', 'nodes', 'edges')
@@ -78,6 +78,21 @@ def test_to_arrow():
     db.clear()
 
 
+def test_to_numpy():
+    db = ustore.DataBase()
+    table = create_table(db)
+    tweets = table[['tweets']].astype('int32').to_numpy()
+    assert tweets.dtype == np.int32
+    assert np.array_equal(tweets, [[2221], [3935], [45900]])
+
+    db = ustore.DataBase()
+    col = db.main
+    col.docs[0] = {'x': 1.0, 'y': 2.0}
+    col.docs[1] = {'x': 3.0, 'y': 4.0}
+    points = col.table[['x', 'y']].astype('float64').to_numpy()
+    assert np.array_equal(points, [[1.0, 2.0], [3.0, 4.0]])
+
+
 def test_update():
     db = ustore.DataBase()
     col = db.main
@@ -133,6 +148,38 @@ def test_parquet():
     db.clear()
 
 
+def test_paged():
+    db = ustore.DataBase()
+    docs = db.main.docs
+    for i in range(1000):
+        docs[i] = {'name': 'user-{}'.format(i), 'tweets': i}
+    table = db.main.table
+    table.astype({'name': 'str', 'tweets': 'int64'})
+
+    # Batches are gathered lazily, never exceeding the requested size
+    batches = list(table.to_batches(rows_per_batch=64))
+    assert len(batches) == 16
+    assert all(batch.num_rows <= 64 for batch in batches)
+    joined = pa.Table.from_batches(batches)
+    assert joined['tweets'].to_pylist() == list(range(1000))
+    assert joined['name'].to_pylist()[999] == 'user-999'
+
+    # Paged exports match the materialized ones
+    assert table.to_arrow(rows_per_batch=100) == pa.Table.from_batches(
+        [table.to_arrow()])
+    table.to_parquet('tmp/pandas_paged.parquet', rows_per_batch=100)
+    exported = ds.dataset('tmp/pandas_paged.parquet',
+                          format='parquet').to_table()
+    assert exported['tweets'].to_pylist() == list(range(1000))
+
+    # Selections of rows are respected
+    table.loc[[5, 3, 7]]
+    assert table.to_arrow(rows_per_batch=2)[
+        'tweets'].to_pylist() == [5, 3, 7]
+
+    db.clear()
+
+
 def test_json():
     db = ustore.DataBase()
     table = create_table(db)
@@ -0,0 +1,56 @@
+/**
+ * @file async_embedded.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Asynchronous submission layer for embedded engines.
+ * Sits on top of any @see "ustore.h"-compatible system.
+ *
+ * There is no network latency to hide, so operations are executed right away,
+ * on the submitting thread, and the returned futures are always ready.
+ * Remote clients implement the same interface with background workers.
+ */
+#include "ustore/async.h"
+#include "ustore/cpp/ranges_args.hpp" // `validate_submit`
+
+/*********************************************************/
+/*****************	 C++ Implementation	  ****************/
+/*********************************************************/
+
+using namespace unum::ustore;
+using namespace unum;
+
+/// Shared handle of all the completed operations, that needs no deallocation.
+static char completed_future_k = 0;
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
+
+void ustore_submit(ustore_submit_t* c_ptr) {
+
+    ustore_submit_t& c = *c_ptr;
+    validate_submit(c, c.error);
+    return_if_error_m(c.error);
+
+    if (c.read)
+        ustore_read(c.read);
+    else if (c.write)
+        ustore_write(c.write);
+    else if (c.scan)
+        ustore_scan(c.scan);
+    else
+        ustore_sample(c.sample);
+
+    if (c.callback)
+        c.callback(c.callback_context);
+    *c.future = &completed_future_k;
+}
+
+void ustore_future_wait(ustore_future_wait_t* c_ptr) {
+    ustore_future_wait_t& c = *c_ptr;
+    if (c.done)
+        *c.done = true;
+}
+
+void ustore_future_free(ustore_future_t) {
+}
@@ -4,9 +4,13 @@
  *
  * @brief Embedded Persistent Key-Value Store on top of @b LevelDB.
  * Has no support for collections, transactions or any non-CRUD jobs.
+ * With the "key_format" set to "bytewise", keys are stored in big-endian with a flipped sign bit,
+ * so that the built-in bytewise comparator can be used, instead of `key_comparator_t`.
  */
 #include <mutex>
 #include <fstream>
+#include <numeric>   // `std::iota`
+#include <algorithm> // `std::sort`
 
 #include <leveldb/db.h>
 #include <leveldb/comparator.h>
@@ -17,8 +21,11 @@
 #include "ustore/db.h"
 #include "ustore/cpp/ranges_args.hpp"   // `places_arg_t`
 #include "helpers/linked_array.hpp"  // `uninitialized_array_gt`
-#include "helpers/full_scan.hpp"     // `reservoir_sample_iterator`
+#include "helpers/full_scan.hpp"     // `seek_sample_iterator`
 #include "helpers/config_loader.hpp" // `config_loader_t`
+#include "helpers/metrics.hpp"       // `metered_call_t`
+#include "helpers/key_format.hpp"    // `encoded_key_gt`
+#include "helpers/collections_epoch.hpp" // `collections_epoch_bump_t`
 
 using namespace unum::ustore;
 using namespace unum;
@@ -41,6 +48,7 @@ using level_native_t = leveldb::DB;
 using level_status_t = leveldb::Status;
 using level_options_t = leveldb::Options;
 using level_iter_uptr_t = std::unique_ptr<leveldb::Iterator>;
+using level_key_t = encoded_key_gt<leveldb::Slice>;
 
 struct key_comparator_t final : public leveldb::Comparator {
 
@@ -64,6 +72,10 @@ struct key_comparator_t final : public leveldb::Comparator {
 
 static key_comparator_t const key_comparator_k = {};
 
+inline leveldb::Comparator const* key_comparator(key_format_t format) noexcept {
+    return format == key_format_t::bytewise_k ? leveldb::BytewiseComparator() : &key_comparator_k;
+}
+
 struct level_snapshot_t {
     leveldb::Snapshot const* snapshot = nullptr;
 };
@@ -72,16 +84,14 @@ struct level_db_t {
     std::unordered_map<ustore_size_t, level_snapshot_t*> snapshots;
     std::unique_ptr<level_native_t> native;
     std::mutex mutex;
+    /** @brief Encoding of the keys on disk, that can only be changed with the "migrate_keys" control. */
+    key_format_t key_format = key_format_t::native_k;
 };
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
 /*********************************************************/
 
-inline leveldb::Slice to_slice(ustore_key_t const& key) noexcept {
-    return {reinterpret_cast<char const*>(&key), sizeof(ustore_key_t)};
-}
-
 inline leveldb::Slice to_slice(value_view_t value) noexcept {
     return {reinterpret_cast<const char*>(value.begin()), value.size()};
 }
@@ -115,9 +125,11 @@ bool export_error(level_status_t const& status, ustore_error_t* c_error) {
 void ustore_database_init(ustore_database_init_t* c_ptr) {
 
     ustore_database_init_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     try {
         level_options_t options;
-        options.comparator = &key_comparator_k;
+        key_format_t key_format = key_format_t::native_k;
+        bool key_format_known = true;
         options.compression = leveldb::kNoCompression;
         options.create_if_missing = true;
 
@@ -141,7 +153,7 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         // Engine config
         return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
 
-        auto fill_options = [](json_t const& js, level_options_t& options) {
+        auto fill_options = [&](json_t const& js, level_options_t& options) {
             if (js.contains("write_buffer_size"))
                 options.write_buffer_size = js["write_buffer_size"];
             if (js.contains("max_file_size"))
@@ -159,6 +171,9 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
             if (js.contains("compression"))
                 if (js["compression"] == "kSnappyCompression" || js["compression"] == "snappy")
                     options.compression = leveldb::kSnappyCompression;
+            // Must match the format of the existing files, as LevelDB checks the name of the comparator
+            if (js.contains("key_format"))
+                key_format_known = parse_key_format(js["key_format"].get<std::string>(), key_format);
         };
 
         // Load from file
@@ -171,15 +186,23 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         // Override with nested
         if (!config.engine.config.empty())
             fill_options(config.engine.config, options);
+        return_error_if_m(key_format_known, c.error, args_wrong_k, "Key format must be \"native\" or \"bytewise\"");
+        options.comparator = key_comparator(key_format);
 
         level_db_t* db_ptr = new level_db_t;
         level_native_t* native_db = nullptr;
         level_status_t status = leveldb::DB::Open(options, root, &native_db);
+        return_error_if_m(status.ok() || !status.IsInvalidArgument() ||
+                              status.ToString().find("comparator") == std::string::npos,
+                          c.error,
+                          args_wrong_k,
+                          "Existing DB was written in another \"key_format\"");
         if (!status.ok()) {
             *c.error = "Couldn't open LevelDB";
             return;
         }
         db_ptr->native = std::unique_ptr<level_native_t>(native_db);
+        db_ptr->key_format = key_format;
         *c.db = db_ptr;
     }
     catch (json_t::type_error const&) {
@@ -265,7 +288,7 @@ void write_one( //
 
     auto place = places[0];
     auto content = contents[0];
-    auto key = to_slice(place.key);
+    level_key_t key {place.key, db.key_format};
     level_status_t status =
         !content ? db.native->Delete(options, key) : db.native->Put(options, key, to_slice(content));
     export_error(status, c_error);
@@ -279,16 +302,20 @@ void write_many( //
     ustore_error_t* c_error) {
 
     leveldb::WriteBatch batch;
-    for (std::size_t i = 0; i != places.size(); ++i) {
-        auto place = places[i];
-        auto content = contents[i];
-
-        auto key = to_slice(place.key);
-        if (!content)
-            batch.Delete(key);
-        else
-            batch.Put(key, to_slice(content));
-    }
+    dispatch_places(places, [&](auto const& places) {
+        dispatch_contents(contents, [&](auto const& contents) {
+            for (std::size_t i = 0; i != places.size(); ++i) {
+                auto place = places[i];
+                auto content = contents[i];
+
+                level_key_t key {place.key, db.key_format};
+                if (!content)
+                    batch.Delete(key);
+                else
+                    batch.Put(key, to_slice(content));
+            }
+        });
+    });
 
     level_status_t status = db.native->Write(options, &batch);
     export_error(status, c_error);
@@ -297,6 +324,7 @@ void write_many( //
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::write_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
@@ -312,6 +340,9 @@ void ustore_write(ustore_write_t* c_ptr) {
 
     validate_write(c.transaction, places, contents, c.options, c.error);
     return_if_error_m(c.error);
+    if constexpr (USTORE_USE_METRICS)
+        for (std::size_t i = 0; i != places.size(); ++i)
+            metered.bytes_in(contents[i].size());
 
     leveldb::WriteOptions options;
     if (c.options & ustore_option_write_flush_k)
@@ -337,7 +368,7 @@ void read_enumerate( //
 
     for (std::size_t i = 0; i != tasks.size(); ++i) {
         place_t place = tasks[i];
-        level_status_t status = db.native->Get(options, to_slice(place.key), &value);
+        level_status_t status = db.native->Get(options, level_key_t {place.key, db.key_format}, &value);
         if (!status.IsNotFound()) {
             if (export_error(status, c_error))
                 return;
@@ -350,9 +381,102 @@ void read_enumerate( //
     }
 }
 
+/**
+ * @brief Batches of this many keys are served by a single iterator sweep, instead of point lookups.
+ */
+constexpr std::size_t sweep_min_keys_k = 64;
+
+/**
+ * @brief Keys of a sweep this close to the previous one are reached with `Next`, rather than a `Seek`.
+ */
+constexpr std::size_t sweep_max_steps_k = 8;
+
+/**
+ * @brief Serves a batch, visiting the keys in sorted order with one iterator.
+ * Dense key ranges are mostly traversed with `Next`, while sparse keys still
+ * reuse the iterator position and the index blocks it has already loaded.
+ * Unsorted batches are staged in sorted order and enumerated in the original one.
+ */
+template <typename value_enumerator_at>
+void read_sweep( //
+    level_db_t& db,
+    places_arg_t tasks,
+    leveldb::ReadOptions const& options,
+    linked_memory_lock_t& arena,
+    value_enumerator_at enumerator,
+    ustore_error_t* c_error) {
+
+    bool sorted = true;
+    for (std::size_t i = 1; i != tasks.size() && sorted; ++i)
+        sorted = tasks[i - 1].key <= tasks[i].key;
+
+    auto order = arena.alloc<std::size_t>(tasks.size(), c_error);
+    return_if_error_m(c_error);
+    std::iota(order.begin(), order.end(), 0);
+    if (!sorted)
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return tasks[a].key < tasks[b].key;
+        });
+
+    // Without sorting, values can go straight into the output tape
+    std::string staged;
+    ptr_range_gt<ustore_length_t> staged_offsets;
+    ptr_range_gt<ustore_length_t> staged_lengths;
+    if (!sorted) {
+        staged_offsets = arena.alloc<ustore_length_t>(tasks.size(), c_error);
+        return_if_error_m(c_error);
+        staged_lengths = arena.alloc<ustore_length_t>(tasks.size(), c_error);
+        return_if_error_m(c_error);
+    }
+
+    level_iter_uptr_t it {db.native->NewIterator(options)};
+    bool positioned = false;
+    for (std::size_t i : order) {
+        ustore_key_t const key = tasks[i].key;
+        ustore_key_t current = 0;
+        std::size_t steps = 0;
+        if (positioned && it->Valid())
+            current = decode_key(it->key().data(), db.key_format);
+        while (positioned && it->Valid() && current < key && steps != sweep_max_steps_k) {
+            it->Next();
+            ++steps;
+            if (it->Valid())
+                current = decode_key(it->key().data(), db.key_format);
+        }
+        if (!positioned || (it->Valid() && current < key)) {
+            it->Seek(level_key_t {key, db.key_format});
+            positioned = true;
+            if (it->Valid())
+                current = decode_key(it->key().data(), db.key_format);
+        }
+
+        value_view_t value;
+        if (it->Valid() && current == key) {
+            leveldb::Slice found = it->value();
+            value = value_view_t {reinterpret_cast<ustore_bytes_cptr_t>(found.data()), found.size()};
+        }
+        if (sorted) {
+            enumerator(i, value);
+            continue;
+        }
+        staged_offsets[i] = static_cast<ustore_length_t>(staged.size());
+        staged_lengths[i] = value ? static_cast<ustore_length_t>(value.size()) : ustore_length_missing_k;
+        staged.append(reinterpret_cast<char const*>(value.begin()), value.size());
+    }
+    if (export_error(it->status(), c_error))
+        return;
+
+    for (std::size_t i = 0; i != tasks.size() && !sorted; ++i) {
+        auto begin = reinterpret_cast<ustore_bytes_cptr_t>(staged.data()) + staged_offsets[i];
+        enumerator(i, staged_lengths[i] != ustore_length_missing_k ? value_view_t {begin, staged_lengths[i]}
+                                                                    : value_view_t {});
+    }
+}
+
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::read_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -395,8 +519,12 @@ void ustore_read(ustore_read_t* c_ptr) {
             if (needs_export)
                 contents.insert(contents.size(), value.begin(), value.end(), c.error);
         };
-        read_enumerate(db, places, options, value_buffer, data_enumerator, c.error);
+        if (places.size() >= sweep_min_keys_k)
+            read_sweep(db, places, options, arena, data_enumerator, c.error);
+        else
+            read_enumerate(db, places, options, value_buffer, data_enumerator, c.error);
         offs[places.count] = contents.size();
+        metered.bytes_out(contents.size());
         if (needs_export)
             *c.values = reinterpret_cast<ustore_bytes_ptr_t>(contents.begin());
     }
@@ -408,6 +536,7 @@ void ustore_read(ustore_read_t* c_ptr) {
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::scan_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -431,6 +560,14 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Values are optionally exported in the same pass
+    uninitialized_array_gt<byte_t> values(arena);
+    ustore_length_t* values_offsets = nullptr;
+    if (c.values) {
+        values_offsets = arena.alloc<ustore_length_t>(total_keys + 1, c.error).begin();
+        return_if_error_m(c.error);
+    }
+
     // 2. Fetch the data
     leveldb::ReadOptions options;
     options.fill_cache = false;
@@ -450,12 +587,20 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     }
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         scan_t task = scans[i];
-        it->Seek(to_slice(task.min_key));
+        it->Seek(level_key_t {task.min_key, db.key_format});
         offsets[i] = keys_output - *c.keys;
 
         ustore_size_t j = 0;
         while (it->Valid() && j != task.limit) {
-            std::memcpy(keys_output, it->key().data(), sizeof(ustore_key_t));
+            if (c.values) {
+                auto value = it->value();
+                std::size_t old_size = values.size();
+                values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(old_size);
+                values.resize(old_size + value.size(), c.error);
+                return_if_error_m(c.error);
+                std::memcpy(values.begin() + old_size, value.data(), value.size());
+            }
+            *keys_output = decode_key(it->key().data(), db.key_format);
             ++keys_output;
             ++j;
             it->Next();
@@ -465,11 +610,19 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     }
 
     offsets[scans.size()] = keys_output - *c.keys;
+
+    if (c.values) {
+        values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(values.size());
+        *c.values = reinterpret_cast<ustore_bytes_ptr_t>(values.begin());
+        if (c.values_offsets)
+            *c.values_offsets = values_offsets;
+    }
 }
 
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::sample_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -495,6 +648,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     // 2. Fetch the data
     leveldb::ReadOptions options;
     options.fill_cache = false;
+    bool const approximate = c.options & ustore_option_sample_approximate_k;
     if (c.snapshot) {
         auto it = db.snapshots.find(c.snapshot);
         return_error_if_m(it != db.snapshots.end(), c.error, args_wrong_k, "The snapshot does'nt exist!");
@@ -512,7 +666,11 @@ void ustore_sample(ustore_sample_t* c_ptr) {
         return_if_error_m(c.error);
 
         ptr_range_gt<ustore_key_t> sampled_keys(keys_output, task.limit);
-        reservoir_sample_iterator(it, sampled_keys, c.error);
+        if (approximate)
+            seek_sample_iterator(it, db.key_format, sampled_keys, c.error);
+        else
+            reservoir_sample_iterator(it, db.key_format, sampled_keys, c.error);
+        return_if_error_m(c.error);
 
         counts[task_idx] = task.limit;
         keys_output += task.limit;
@@ -523,6 +681,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::measure_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -549,9 +708,9 @@ void ustore_measure(ustore_measure_t* c_ptr) {
         min_value_bytes[i] = static_cast<ustore_size_t>(0);
         max_value_bytes[i] = static_cast<ustore_size_t>(0);
 
-        ustore_key_t const min_key = start_keys[i];
-        ustore_key_t const max_key = end_keys[i];
-        leveldb::Range range(to_slice(min_key), to_slice(max_key));
+        level_key_t const min_key {start_keys[i], db.key_format};
+        level_key_t const max_key {end_keys[i], db.key_format};
+        leveldb::Range range(min_key, max_key);
         try {
             db.native->GetApproximateSizes(&range, 1, &approximate_size);
             min_space_usages[i] = approximate_size;
@@ -566,6 +725,48 @@ void ustore_measure(ustore_measure_t* c_ptr) {
     }
 }
 
+void ustore_erase_ranges(ustore_erase_ranges_t* c_ptr) {
+
+    ustore_erase_ranges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::erase_k, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(!c.tasks_count || (c.start_keys && c.end_keys), c.error, args_combo_k, "Need range bounds!");
+
+    level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+
+    // LevelDB has no range tombstones, so the keys are enumerated on the engine side
+    leveldb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    leveldb::WriteBatch batch;
+    try {
+        level_iter_uptr_t it {db.native->NewIterator(read_options)};
+        for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
+            return_error_if_m(!collections || collections[i] == ustore_collection_main_k,
+                              c.error,
+                              args_wrong_k,
+                              "Collections not supported by LevelDB!");
+            ustore_key_t const end_key = end_keys[i];
+            for (it->Seek(level_key_t {start_keys[i], db.key_format}); it->Valid(); it->Next()) {
+                if (decode_key(it->key().data(), db.key_format) >= end_key)
+                    break;
+                batch.Delete(it->key());
+            }
+        }
+    }
+    catch (...) {
+        *c.error = "Erase Failure";
+    }
+    return_if_error_m(c.error);
+
+    leveldb::WriteOptions options;
+    options.sync = c.options & ustore_option_write_flush_k;
+    level_status_t status = db.native->Write(options, &batch);
+    export_error(status, c.error);
+}
+
 /*********************************************************/
 /*****************	Collections Management	****************/
 /*********************************************************/
@@ -573,6 +774,7 @@ void ustore_measure(ustore_measure_t* c_ptr) {
 void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 
     ustore_collection_create_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     auto name_len = c.name ? std::strlen(c.name) : 0;
     return_error_if_m(name_len, c.error, args_wrong_k, "Collections not supported by LevelDB!");
 }
@@ -580,6 +782,7 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
 
     ustore_collection_drop_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     bool invalidate = c.mode == ustore_drop_keys_vals_handle_k;
     return_error_if_m(c.id == ustore_collection_main_k && !invalidate,
@@ -620,6 +823,73 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
         *c.names = nullptr;
 }
 
+/**
+ * @brief Copies all the pairs from a consistent snapshot into a new DB in the `directory`,
+ * encoding the keys in the given `format`. Both formats order the keys the same way,
+ * so the pairs are appended in sorted order.
+ */
+void migrate_keys(level_db_t& db, key_format_t format, std::string const& directory, ustore_error_t* c_error) {
+
+    level_options_t options;
+    options.comparator = key_comparator(format);
+    options.compression = leveldb::kNoCompression;
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    level_native_t* target_ptr = nullptr;
+    level_status_t status = leveldb::DB::Open(options, directory, &target_ptr);
+    if (export_error(status, c_error))
+        return;
+    std::unique_ptr<level_native_t> target(target_ptr);
+
+    constexpr std::size_t batch_pairs_k = 64 * 1024;
+    leveldb::Snapshot const* snapshot = db.native->GetSnapshot();
+    leveldb::ReadOptions read_options;
+    read_options.snapshot = snapshot;
+    read_options.fill_cache = false;
+    try {
+        leveldb::WriteBatch batch;
+        std::size_t batch_pairs = 0;
+        level_iter_uptr_t it {db.native->NewIterator(read_options)};
+        for (it->SeekToFirst(); it->Valid() && status.ok(); it->Next()) {
+            batch.Put(level_key_t {decode_key(it->key().data(), db.key_format), format}, it->value());
+            if (++batch_pairs == batch_pairs_k) {
+                status = target->Write(leveldb::WriteOptions(), &batch);
+                batch.Clear();
+                batch_pairs = 0;
+            }
+        }
+        if (status.ok())
+            status = it->status();
+        if (status.ok() && batch_pairs) {
+            leveldb::WriteOptions write_options;
+            write_options.sync = true;
+            status = target->Write(write_options, &batch);
+        }
+        export_error(status, c_error);
+    }
+    catch (...) {
+        *c_error = "Migration Failure";
+    }
+    db.native->ReleaseSnapshot(snapshot);
+}
+
+/**
+ * @brief Handles the "migrate_keys <native|bytewise> <directory>" control.
+ */
+void control_migrate_keys(level_db_t& db, ustore_database_control_t& c) {
+    std::string_view arguments = std::string_view(c.request).substr(std::strlen("migrate_keys "));
+    std::size_t const space = arguments.find(' ');
+    key_format_t format;
+    return_error_if_m(space != std::string_view::npos &&
+                          parse_key_format(std::string(arguments.substr(0, space)), format),
+                      c.error,
+                      args_wrong_k,
+                      "Expects \"migrate_keys <native|bytewise> <directory>\"");
+    std::string directory {arguments.substr(space + 1)};
+    return_error_if_m(!directory.empty(), c.error, args_wrong_k, "Missing target directory");
+    migrate_keys(db, format, directory, c.error);
+}
+
 void ustore_database_control(ustore_database_control_t* c_ptr) {
 
     ustore_database_control_t& c = *c_ptr;
@@ -629,7 +899,18 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
         return;
 
     *c.response = NULL;
-    *c.error = "Controls aren't supported in this implementation!";
+    if (is_metrics_request(c.request))
+        return control_metrics(c);
+    if (is_traces_request(c.request))
+        return control_traces(c);
+    if (std::strncmp(c.request, "migrate_keys ", std::strlen("migrate_keys ")) == 0)
+        return control_migrate_keys(*reinterpret_cast<level_db_t*>(c.db), c);
+    return_error_if_m(std::strcmp(c.request, "arenas") == 0,
+                      c.error,
+                      missing_feature_k,
+                      "Only \"arenas\", \"metrics\", \"traces\" and \"migrate_keys\" controls "
+                      "are supported in this implementation!");
+    control_arenas(c);
 }
 
 /*********************************************************/
@@ -662,6 +943,7 @@ void ustore_transaction_free(ustore_transaction_t) {
 void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
+    collections_epoch_bump_t bump;
     level_db_t* db = reinterpret_cast<level_db_t*>(c_db);
     delete db;
 }
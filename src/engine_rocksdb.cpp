@@ -15,13 +15,46 @@
  * Moreover, not being the default variant, its significantly less optimized,
  * so after numerous tests we decided to stick to `BlockBasedTable`.
  * https://github.com/facebook/rocksdb/wiki/PlainTable-Format
+ *
+ * ## Paginated Scans
+ * Every full page of a scan leaves its iterator in a small pool, so that the scan of the next page,
+ * starting right after the last returned key, continues without a new `Seek`. Pooled HEAD iterators
+ * are only reused, until the next write. Long scans read ahead and bypass the block cache.
+ *
+ * ## Key Formats
+ * Keys are stored in the byte order of the CPU and compared by `key_comparator_t`, unless the "KeyFormat"
+ * is "bytewise". Then they are stored as big-endian integers with a flipped sign bit, and the built-in
+ * bytewise comparator is used, which RocksDB inlines, instead of calling a virtual method per comparison.
+ * The comparator name is persisted, so the format of existing files is changed with the "migrate_keys" control.
+ *
+ * ## Group Commit
+ * RocksDB already merges concurrent writers, waiting for the same WAL sync. If the "GroupCommit" is configured,
+ * writes with `ustore_option_write_flush_k` reach the WAL unsynced, and a leader among their callers syncs it
+ * for all, optionally waiting up to "max_wait_microseconds" for more of them. `enable_pipelined_write` in
+ * "DBOptions" further overlaps the memtable inserts of one group with logging the next. `unordered_write`
+ * isn't exposed, as it breaks the snapshot guarantees of optimistic transactions.
+ *
+ * ## Hot Tier
+ * If the "HotTier" is configured, or the engine is compiled with `USTORE_ROCKSDB_HOT_TIER`,
+ * as the "hybrid" engine, copies of the most frequently read pairs are kept in memory.
+ * HEAD reads are served from them, while transactions, snapshots, scans and bulk
+ * operations bypass them, after the pending write-back pairs are flushed into RocksDB.
  */
 
 #include <mutex>
 #include <fstream>
 #include <filesystem>
+#include <atomic>    // `std::atomic`
+#include <thread>    // `std::thread`
+#include <numeric>   // `std::iota`
+#include <algorithm> // `std::stable_sort`
 
 #include <rocksdb/db.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/table.h>
+#include <rocksdb/table_properties.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/utilities/options_util.h>
 #include <rocksdb/utilities/transaction.h>
 #include <rocksdb/utilities/optimistic_transaction_db.h>
@@ -29,8 +62,14 @@
 #include "ustore/db.h"
 #include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
 #include "helpers/linked_array.hpp"   // `uninitialized_array_gt`
-#include "helpers/full_scan.hpp"      // `reservoir_sample_iterator`
+#include "helpers/full_scan.hpp"      // `seek_sample_iterator`
 #include "helpers/config_loader.hpp"  // `config_loader_t`
+#include "helpers/metrics.hpp"        // `metered_call_t`
+#include "helpers/group_commit.hpp"   // `group_commit_t`
+#include "helpers/hot_tier.hpp"       // `hot_tier_t`
+#include "helpers/key_format.hpp"     // `encoded_key_gt`
+#include "helpers/collections_epoch.hpp" // `collections_epoch_bump_t`
+#include "helpers/collection_companions.hpp" // `drop_companions`
 
 namespace stdfs = std::filesystem;
 using namespace unum::ustore;
@@ -50,8 +89,13 @@ bool const ustore_supports_snapshots_k = true;
 using rocks_native_t = rocksdb::OptimisticTransactionDB;
 using rocks_status_t = rocksdb::Status;
 using rocks_value_t = rocksdb::PinnableSlice;
-using rocks_txn_t = rocksdb::Transaction;
+using rocks_native_txn_t = rocksdb::Transaction;
 using rocks_collection_t = rocksdb::ColumnFamilyHandle;
+using rocks_key_t = encoded_key_gt<rocksdb::Slice>;
+
+#if !defined(USTORE_ROCKSDB_HOT_TIER)
+#define USTORE_ROCKSDB_HOT_TIER 0
+#endif
 
 struct key_comparator_t final : public rocksdb::Comparator {
     inline int Compare(rocksdb::Slice const& a, rocksdb::Slice const& b) const override {
@@ -62,14 +106,52 @@ struct key_comparator_t final : public rocksdb::Comparator {
         return ai < bi ? -1 : 1;
     }
     const char* Name() const override { return "i64"; }
-    void FindShortestSeparator(std::string*, rocksdb::Slice const&) const override {}
-    void FindShortSuccessor(std::string*) const override {}
+
+    /**
+     * Keys have fixed length, so they can't be shortened, but index blocks still benefit
+     * from "round" separators: the one with the most trailing zero bits in `[start, limit)`.
+     * Those share longer prefixes with the neighbors, when delta-encoded.
+     */
+    void FindShortestSeparator(std::string* start, rocksdb::Slice const& limit) const override {
+        if (start->size() != sizeof(ustore_key_t) || limit.size() != sizeof(ustore_key_t))
+            return;
+        std::uint64_t first = to_ordered(start->data());
+        std::uint64_t last = to_ordered(limit.data());
+        if (first >= last)
+            return;
+        for (std::size_t zeros = 63; zeros; --zeros) {
+            std::uint64_t rounded = (last - 1) & (~std::uint64_t(0) << zeros);
+            if (rounded >= first)
+                return store(start, rounded);
+        }
+        store(start, last - 1);
+    }
+
+    /**
+     * The last index entry of a file only has to compare bigger than every key in it.
+     * Files are still filtered by their real smallest and largest keys, so the biggest key is fine.
+     */
+    void FindShortSuccessor(std::string* key) const override {
+        if (key->size() == sizeof(ustore_key_t))
+            store(key, ~std::uint64_t(0));
+    }
+
     bool CanKeysWithDifferentByteContentsBeEqual() const override { return false; }
     bool IsSameLengthImmediateSuccessor(rocksdb::Slice const& s, rocksdb::Slice const& t) const override {
         auto si = *reinterpret_cast<ustore_key_t const*>(s.data());
         auto ti = *reinterpret_cast<ustore_key_t const*>(t.data());
         return si + 1 == ti;
     }
+
+  private:
+    /** @brief Maps signed keys to unsigned integers, preserving the order. */
+    static std::uint64_t to_ordered(char const* data) noexcept {
+        return static_cast<std::uint64_t>(*reinterpret_cast<ustore_key_t const*>(data)) ^ (std::uint64_t(1) << 63);
+    }
+    static void store(std::string* key, std::uint64_t ordered) noexcept {
+        auto native = static_cast<ustore_key_t>(ordered ^ (std::uint64_t(1) << 63));
+        std::memcpy(key->data(), &native, sizeof(ustore_key_t));
+    }
 };
 
 static key_comparator_t key_comparator_k = {};
@@ -78,17 +160,216 @@ struct rocks_snapshot_t {
     rocksdb::Snapshot const* snapshot = nullptr;
 };
 
+/**
+ * @brief Iterator, left by a scan that filled its page, to continue the next page without a `Seek`.
+ * It's positioned at the first key, not smaller than `lower_key`, which isn't always the start of RocksDB
+ * page, as we may be `Seek`-ing into the middle of it.
+ */
+struct rocks_cursor_t {
+    std::unique_ptr<rocksdb::Iterator> iterator;
+    rocks_collection_t* collection = nullptr;
+    rocksdb::Snapshot const* snapshot = nullptr;
+    /** @brief Latest sequence number before the iterator was created, to detect newer writes to HEAD. */
+    rocksdb::SequenceNumber sequence = 0;
+    ustore_key_t lower_key = 0;
+};
+
 struct rocks_db_t {
     std::vector<rocks_collection_t*> columns;
     std::unordered_map<ustore_size_t, rocks_snapshot_t*> snapshots;
     std::unique_ptr<rocks_native_t> native;
     std::mutex mutex;
+    /** @brief Counter for unique names of external SST files, written for bulk loads. */
+    std::atomic<std::size_t> ingested_files {0};
+    /** @brief Options for the collections, missing in `named_options`. */
+    rocksdb::ColumnFamilyOptions default_options;
+    /** @brief Options for the collections, configured by name in the "Collections" section. */
+    std::unordered_map<std::string, rocksdb::ColumnFamilyOptions> named_options;
+    /** @brief Block cache, shared by all the collections, if "BlockCache" is configured. */
+    std::shared_ptr<rocksdb::Cache> block_cache;
+    /** @brief Iterators of the recent paginated scans, with the most recent in the end. */
+    std::vector<rocks_cursor_t> cursors;
+    std::mutex cursors_mutex;
+    /** @brief Copies of the most frequently read pairs, if the "HotTier" is configured. */
+    std::unique_ptr<hot_tier_t> hot;
+    /** @brief Encoding of the keys on disk, that can only be changed with the "migrate_keys" control. */
+    key_format_t key_format = key_format_t::native_k;
+    /** @brief Shares the WAL syncs of concurrent durable writes, if the "GroupCommit" is configured. */
+    std::unique_ptr<group_commit_t> group_commit;
+
+    /**
+     * @brief Options for plain writes and transactions. Unless durability is requested, they skip the WAL.
+     * With the "GroupCommit", durable writes reach the WAL unsynced, and are synced by `sync_wal()`.
+     */
+    rocksdb::WriteOptions write_options(bool safe) const noexcept {
+        rocksdb::WriteOptions options;
+        options.sync = safe && !group_commit;
+        options.disableWAL = !safe;
+        return options;
+    }
+
+    rocksdb::Comparator const* comparator() const noexcept { return comparator_for(key_format); }
+    static rocksdb::Comparator const* comparator_for(key_format_t format) noexcept {
+        return format == key_format_t::bytewise_k ? rocksdb::BytewiseComparator() : &key_comparator_k;
+    }
+
+    rocksdb::ColumnFamilyOptions const& options_for(std::string const& name) const noexcept {
+        auto it = named_options.find(name);
+        return it != named_options.end() ? it->second : default_options;
+    }
 };
 
-inline rocksdb::Slice to_slice(ustore_key_t const& key) noexcept {
-    return {reinterpret_cast<char const*>(&key), sizeof(ustore_key_t)};
+/**
+ * @brief Transaction handle, that remembers the hints it was started with.
+ */
+struct rocks_txn_t {
+    std::unique_ptr<rocks_native_txn_t> native;
+    /**
+     * @brief Set for transactions started with `ustore_option_transaction_dont_watch_k`.
+     * They don't track any reads or writes, so they are never validated on commit.
+     */
+    bool dont_watch = false;
+    /** @brief Set for transactions started with `ustore_option_write_flush_k`, that are logged on commit. */
+    bool safe = false;
+};
+
+inline rocks_native_txn_t* rocks_transaction(ustore_transaction_t transaction) noexcept {
+    return transaction ? reinterpret_cast<rocks_txn_t*>(transaction)->native.get() : nullptr;
 }
 
+/**
+ * @brief Extends the options of a single operation with the hints of the whole transaction.
+ */
+inline ustore_options_t rocks_transaction_options(ustore_transaction_t transaction, ustore_options_t options) noexcept {
+    if (transaction && reinterpret_cast<rocks_txn_t*>(transaction)->dont_watch)
+        options = static_cast<ustore_options_t>(options | ustore_option_transaction_dont_watch_k);
+    return options;
+}
+
+static bool parse_compression(std::string const& name, rocksdb::CompressionType& type) noexcept {
+    static std::pair<char const*, rocksdb::CompressionType> const types[] = {
+        {"kNoCompression", rocksdb::kNoCompression},
+        {"kSnappyCompression", rocksdb::kSnappyCompression},
+        {"kZlibCompression", rocksdb::kZlibCompression},
+        {"kBZip2Compression", rocksdb::kBZip2Compression},
+        {"kLZ4Compression", rocksdb::kLZ4Compression},
+        {"kLZ4HCCompression", rocksdb::kLZ4HCCompression},
+        {"kXpressCompression", rocksdb::kXpressCompression},
+        {"kZSTD", rocksdb::kZSTD},
+    };
+    for (auto const& [type_name, type_value] : types)
+        if (name == type_name) {
+            type = type_value;
+            return true;
+        }
+    return false;
+}
+
+/**
+ * @brief Applies the "CFOptions" or a "Collections" entry on top of the already parsed options,
+ * so that every collection inherits the shared options and only overrides what it lists.
+ */
+static void parse_collection_options(json_t const& j_cf,
+                                     rocksdb::ColumnFamilyOptions& cf_options,
+                                     rocksdb::BlockBasedTableOptions& table_options,
+                                     ustore_error_t* c_error) {
+    if (j_cf.contains("max_write_buffer_number"))
+        cf_options.max_write_buffer_number = j_cf["max_write_buffer_number"];
+    if (j_cf.contains("write_buffer_size"))
+        cf_options.write_buffer_size = j_cf["write_buffer_size"];
+    if (j_cf.contains("target_file_size_base"))
+        cf_options.target_file_size_base = j_cf["target_file_size_base"];
+    if (j_cf.contains("max_compaction_bytes"))
+        cf_options.max_compaction_bytes = j_cf["max_compaction_bytes"];
+    if (j_cf.contains("level_compaction_dynamic_level_bytes"))
+        cf_options.level_compaction_dynamic_level_bytes = j_cf["level_compaction_dynamic_level_bytes"];
+    if (j_cf.contains("level0_stop_writes_trigger"))
+        cf_options.level0_stop_writes_trigger = j_cf["level0_stop_writes_trigger"];
+    if (j_cf.contains("target_file_size_multiplier"))
+        cf_options.target_file_size_multiplier = j_cf["target_file_size_multiplier"];
+    if (j_cf.contains("max_bytes_for_level_multiplier"))
+        cf_options.max_bytes_for_level_multiplier = j_cf["max_bytes_for_level_multiplier"];
+    if (j_cf.contains("compression")) {
+        return_error_if_m(parse_compression(j_cf["compression"].get<std::string>(), cf_options.compression),
+                          c_error,
+                          args_wrong_k,
+                          "Unknown compression type");
+        if (cf_options.compression != rocksdb::kNoCompression)
+            log_warning_m(
+                "We discourage general-purpose compression in favour "
+                "of modality-aware compression in UStore\n");
+    }
+    if (j_cf.contains("compression_per_level")) {
+        auto const& j_levels = j_cf["compression_per_level"];
+        return_error_if_m(j_levels.is_array(), c_error, args_wrong_k, "Compression per level must be an array");
+        cf_options.compression_per_level.clear();
+        for (auto const& j_level : j_levels) {
+            rocksdb::CompressionType type;
+            return_error_if_m(j_level.is_string() && parse_compression(j_level.get<std::string>(), type),
+                              c_error,
+                              args_wrong_k,
+                              "Unknown compression type");
+            cf_options.compression_per_level.push_back(type);
+        }
+    }
+
+    // Table options, that are only applicable to `BlockBasedTable`
+    if (j_cf.contains("block_size"))
+        table_options.block_size = j_cf["block_size"];
+    if (j_cf.contains("bloom_filter_bits")) {
+        double bits = j_cf["bloom_filter_bits"];
+        table_options.filter_policy.reset(bits > 0 ? rocksdb::NewBloomFilterPolicy(bits) : nullptr);
+    }
+    if (j_cf.contains("whole_key_filtering"))
+        table_options.whole_key_filtering = j_cf["whole_key_filtering"];
+    // The filters of the last level take most of the space, but don't help the lookups of missing keys
+    if (j_cf.contains("optimize_filters_for_hits"))
+        cf_options.optimize_filters_for_hits = j_cf["optimize_filters_for_hits"];
+}
+
+static void finalize_collection_options(rocks_db_t const& db,
+                                        rocksdb::ColumnFamilyOptions& cf_options,
+                                        rocksdb::BlockBasedTableOptions table_options) {
+    if (db.block_cache)
+        table_options.block_cache = db.block_cache;
+    // Filter blocks live in the shared cache, next to the data they guard
+    table_options.cache_index_and_filter_blocks = db.block_cache != nullptr;
+    table_options.pin_l0_filter_and_index_blocks_in_cache = db.block_cache != nullptr;
+    cf_options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+    cf_options.comparator = db.comparator();
+}
+
+/**
+ * @brief Number of scans, that can be continued without a `Seek`.
+ */
+constexpr std::size_t cursors_limit_k = 32;
+
+/**
+ * @brief Scans of this many keys are treated as sequential: they read ahead and bypass the block cache.
+ * Shorter ones are likely random lookups and are better served from the cache.
+ */
+constexpr ustore_length_t long_scan_k = 4096;
+
+/**
+ * @brief RocksDB read-ahead size for long scans, instead of the automatic read-ahead, that starts small.
+ */
+constexpr std::size_t long_scan_readahead_k = 2 * 1024 * 1024;
+
+/**
+ * @brief Smallest batches, worth the overhead of writing and ingesting SST files.
+ */
+constexpr std::size_t ingest_min_pairs_k = 4096;
+
+/**
+ * @brief Number of pairs per external SST file, so that big batches are written by several threads.
+ */
+constexpr std::size_t ingest_file_pairs_k = 256 * 1024;
+
+/**
+ * @brief Memory budget of the hot tier of the "hybrid" engine, unless configured explicitly.
+ */
+constexpr std::size_t hot_tier_default_capacity_k = 256 * 1024 * 1024;
+
 inline rocksdb::Slice to_slice(value_view_t value) noexcept {
     return {reinterpret_cast<const char*>(value.begin()), value.size()};
 }
@@ -121,6 +402,86 @@ rocks_collection_t* rocks_collection(rocks_db_t& db, ustore_collection_t collect
                                                   : reinterpret_cast<rocks_collection_t*>(collection);
 }
 
+/**
+ * @brief Syncs the WAL after a durable write, if the "GroupCommit" is configured.
+ * The sync is shared with other writers, waiting for it at the same time.
+ */
+void sync_wal(rocks_db_t& db, bool safe, ustore_error_t* c_error) noexcept {
+    if (!safe || !db.group_commit)
+        return;
+    bool synced = db.group_commit->commit([&]() noexcept { return db.native->SyncWAL().ok(); });
+    return_error_if_m(synced, c_error, error_unknown_k, "Failed to sync the write-ahead log");
+}
+
+/**
+ * @brief Writes the dirty pairs of the hot tier into RocksDB in one batch. Unless those are flushed
+ * for a `ustore_option_write_flush_k` operation, the batch skips the WAL, like the writes it replaces.
+ */
+struct hot_spill_t {
+    rocks_db_t& db;
+    bool safe = false;
+
+    void operator()(hot_tier_t::pairs_t const& pairs, ustore_error_t* c_error) const noexcept(false) {
+        rocksdb::WriteOptions options = db.write_options(safe);
+        rocksdb::WriteBatch batch;
+        for (auto const& [collection_key, value] : pairs) {
+            auto collection = rocks_collection(db, collection_key.collection);
+            rocks_key_t key {collection_key.key, db.key_format};
+            rocks_status_t status = value ? batch.Put(collection, key, to_slice(value)) : batch.Delete(collection, key);
+            if (export_error(status, c_error))
+                return;
+        }
+        if (!batch.Count() || export_error(db.native->Write(options, &batch), c_error))
+            return;
+        sync_wal(db, safe, c_error);
+    }
+};
+
+/**
+ * @brief Writes the pending write-back pairs into RocksDB, before the operations, that bypass the hot tier.
+ */
+void flush_hot(rocks_db_t& db, bool safe, ustore_error_t* c_error) noexcept {
+    if (!db.hot || !db.hot->has_dirty())
+        return;
+    safe_section("Flushing the hot tier", c_error, [&] { db.hot->flush(hot_spill_t {db, safe}, c_error); });
+}
+
+/**
+ * @brief Collects the keys, written by a transaction, to drop their copies from the hot tier after commit.
+ */
+struct written_keys_t final : public rocksdb::WriteBatch::Handler {
+    rocks_db_t& db;
+    std::vector<collection_key_t> keys;
+
+    written_keys_t(rocks_db_t& db) noexcept : db(db) {}
+
+    void add(std::uint32_t collection_id, rocksdb::Slice const& key) {
+        ustore_collection_t collection = ustore_collection_main_k;
+        if (collection_id != 0)
+            for (rocks_collection_t* column : db.columns)
+                if (column->GetID() == collection_id)
+                    collection = reinterpret_cast<ustore_collection_t>(column);
+        keys.push_back({collection, decode_key(key.data(), db.key_format)});
+    }
+
+    rocks_status_t PutCF(std::uint32_t id, rocksdb::Slice const& key, rocksdb::Slice const&) override {
+        add(id, key);
+        return rocks_status_t::OK();
+    }
+    rocks_status_t DeleteCF(std::uint32_t id, rocksdb::Slice const& key) override {
+        add(id, key);
+        return rocks_status_t::OK();
+    }
+    rocks_status_t SingleDeleteCF(std::uint32_t id, rocksdb::Slice const& key) override {
+        add(id, key);
+        return rocks_status_t::OK();
+    }
+    rocks_status_t MergeCF(std::uint32_t id, rocksdb::Slice const& key, rocksdb::Slice const&) override {
+        add(id, key);
+        return rocks_status_t::OK();
+    }
+};
+
 /*********************************************************/
 /*****************	    C Interface 	  ****************/
 /*********************************************************/
@@ -128,6 +489,7 @@ rocks_collection_t* rocks_collection(rocks_db_t& db, ustore_collection_t collect
 void ustore_database_init(ustore_database_init_t* c_ptr) {
 
     ustore_database_init_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     safe_section("Opening RocksDB", c.error, [&] {
         rocks_db_t* db_ptr = new rocks_db_t;
         rocks_status_t status;
@@ -153,7 +515,12 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         rocksdb::Options options;
         options.compression = rocksdb::kNoCompression;
         auto cf_options = rocksdb::ColumnFamilyOptions();
+        auto table_options = rocksdb::BlockBasedTableOptions();
+        rocksdb::OptimisticTransactionDBOptions txn_options;
         std::vector<rocksdb::ColumnFamilyDescriptor> column_descriptors;
+        std::size_t hot_capacity = USTORE_ROCKSDB_HOT_TIER ? hot_tier_default_capacity_k : 0;
+        hot_policy_t hot_policy = hot_policy_t::write_through_k;
+        std::size_t hot_admit_after = 2;
         return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
 
         // Load from file
@@ -170,6 +537,14 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         // Override with nested
         if (!config.engine.config.empty()) {
             auto const& js = config.engine.config;
+            // Must match the format of the existing files, as RocksDB checks the name of the comparator
+            if (js.contains("KeyFormat"))
+                return_error_if_m(js["KeyFormat"].is_string() &&
+                                      parse_key_format(js["KeyFormat"].get<std::string>(), db_ptr->key_format),
+                                  c.error,
+                                  args_wrong_k,
+                                  "Key format must be \"native\" or \"bytewise\"");
+
             if (js.contains("DBOptions")) {
                 auto j_db = js["DBOptions"];
                 if (j_db.contains("create_if_missing"))
@@ -180,59 +555,126 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
                     options.max_open_files = j_db["max_open_files"];
                 if (j_db.contains("max_file_opening_threads"))
                     options.max_file_opening_threads = j_db["max_file_opening_threads"];
+                if (j_db.contains("enable_pipelined_write"))
+                    options.enable_pipelined_write = j_db["enable_pipelined_write"];
+            }
+
+            // Durable writes are logged unsynced, and concurrent ones share a `SyncWAL`
+            if (js.contains("GroupCommit")) {
+                auto const& j_group = js["GroupCommit"];
+                std::size_t max_wait = j_group.value("max_wait_microseconds", std::size_t(0));
+                db_ptr->group_commit = std::make_unique<group_commit_t>(std::chrono::microseconds(max_wait));
+            }
+
+            // Transactions are optimistic and only take locks to validate the tracked keys on commit
+            if (js.contains("Transactions")) {
+                auto const& j_txn = js["Transactions"];
+                std::string validation = j_txn.value("validation", "parallel");
+                if (validation == "parallel")
+                    txn_options.validate_policy = rocksdb::OccValidationPolicy::kValidateParallel;
+                else if (validation == "serial")
+                    txn_options.validate_policy = rocksdb::OccValidationPolicy::kValidateSerial;
+                else
+                    return_error_if_m(false, c.error, args_wrong_k, "Validation must be \"parallel\" or \"serial\"");
+                if (j_txn.contains("lock_buckets"))
+                    txn_options.occ_lock_buckets = j_txn["lock_buckets"];
             }
 
             if (js.contains("CFOptions")) {
-                auto j_cf = js["CFOptions"];
-                if (j_cf.contains("max_write_buffer_number"))
-                    cf_options.max_write_buffer_number = j_cf["max_write_buffer_number"];
-                if (j_cf.contains("write_buffer_size"))
-                    cf_options.write_buffer_size = j_cf["write_buffer_size"];
-                if (j_cf.contains("target_file_size_base"))
-                    cf_options.target_file_size_base = j_cf["target_file_size_base"];
-                if (j_cf.contains("max_compaction_bytes"))
-                    cf_options.max_compaction_bytes = j_cf["max_compaction_bytes"];
-                if (j_cf.contains("level_compaction_dynamic_level_bytes"))
-                    cf_options.level_compaction_dynamic_level_bytes = j_cf["level_compaction_dynamic_level_bytes"];
-                if (j_cf.contains("level0_stop_writes_trigger"))
-                    cf_options.level0_stop_writes_trigger = j_cf["level0_stop_writes_trigger"];
-                if (j_cf.contains("target_file_size_multiplier"))
-                    cf_options.target_file_size_multiplier = j_cf["target_file_size_multiplier"];
-                if (j_cf.contains("max_bytes_for_level_multiplier"))
-                    cf_options.max_bytes_for_level_multiplier = j_cf["max_bytes_for_level_multiplier"];
-                if (j_cf.contains("compression"))
-                    if (j_cf["compression"] != "kNoCompression")
-                        log_warning_m(
-                            "We discourage general-purpose compression in favour "
-                            "of modality-aware compression in UStore\n");
+                parse_collection_options(js["CFOptions"], cf_options, table_options, c.error);
+                return_if_error_m(c.error);
+            }
+
+            if (js.contains("BlockCache")) {
+                auto const& j_cache = js["BlockCache"];
+                std::size_t capacity = 0;
+                return_error_if_m(j_cache.contains("capacity") &&
+                                      config_loader_t::parse_volume(j_cache, "capacity", capacity),
+                                  c.error,
+                                  args_wrong_k,
+                                  "Invalid block cache capacity");
+                std::string type = j_cache.value("type", "lru");
+                if (type == "lru")
+                    db_ptr->block_cache = rocksdb::NewLRUCache(capacity);
+                else if (type == "hyper_clock")
+                    db_ptr->block_cache =
+                        rocksdb::HyperClockCacheOptions(capacity, table_options.block_size).MakeSharedCache();
+                else
+                    return_error_if_m(false, c.error, args_wrong_k, "Block cache must be \"lru\" or \"hyper_clock\"");
+            }
+
+            // Frequently read pairs are kept in memory, in front of RocksDB, and a zero capacity disables that
+            if (js.contains("HotTier")) {
+                auto const& j_hot = js["HotTier"];
+                return_error_if_m(j_hot.contains("capacity") &&
+                                      config_loader_t::parse_volume(j_hot, "capacity", hot_capacity),
+                                  c.error,
+                                  args_wrong_k,
+                                  "Invalid hot tier capacity");
+                std::string policy = j_hot.value("policy", "write_through");
+                if (policy == "write_through")
+                    hot_policy = hot_policy_t::write_through_k;
+                else if (policy == "write_back")
+                    hot_policy = hot_policy_t::write_back_k;
+                else
+                    return_error_if_m(false,
+                                      c.error,
+                                      args_wrong_k,
+                                      "Hot tier policy must be \"write_through\" or \"write_back\"");
+                hot_admit_after = j_hot.value("admit_after", hot_admit_after);
+            }
+
+            if (js.contains("Collections")) {
+                auto const& j_collections = js["Collections"];
+                return_error_if_m(j_collections.is_object(), c.error, args_wrong_k, "Collections must be an object");
+                for (auto const& [name, j_collection] : j_collections.items()) {
+                    auto named_options = cf_options;
+                    auto named_table_options = table_options;
+                    parse_collection_options(j_collection, named_options, named_table_options, c.error);
+                    return_if_error_m(c.error);
+                    finalize_collection_options(*db_ptr, named_options, named_table_options);
+                    db_ptr->named_options.emplace(name, std::move(named_options));
+                }
             }
         }
+        finalize_collection_options(*db_ptr, cf_options, table_options);
+        db_ptr->default_options = cf_options;
 
         rocksdb::ConfigOptions config_options;
         status = rocksdb::LoadLatestOptions(config_options, root, &options, &column_descriptors);
         return_error_if_m(status.ok() || status.IsNotFound(), c.error, error_unknown_k, "Recovering RocksDB state");
 
-        cf_options.comparator = &key_comparator_k;
+        // Explicitly configured options override the ones recovered from the previous session
+        bool const tuned = !config.engine.config.empty();
         if (column_descriptors.empty())
             column_descriptors.push_back({rocksdb::kDefaultColumnFamilyName, std::move(cf_options)});
         else {
-            for (auto& column_descriptor : column_descriptors)
-                column_descriptor.options.comparator = &key_comparator_k;
+            for (auto& column_descriptor : column_descriptors) {
+                if (tuned)
+                    column_descriptor.options = db_ptr->options_for(column_descriptor.name);
+                column_descriptor.options.comparator = db_ptr->comparator();
+            }
         }
 
         options.create_if_missing = true;
-        options.comparator = &key_comparator_k;
+        options.comparator = db_ptr->comparator();
 
         // Storage paths
         for (auto const& disk : config.data_directories)
             options.db_paths.push_back({disk.path, disk.max_size});
 
         rocks_native_t* native_db = nullptr;
-        rocksdb::OptimisticTransactionDBOptions txn_options;
         status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+        return_error_if_m(status.ok() || !status.IsInvalidArgument() ||
+                              status.ToString().find("comparator") == std::string::npos,
+                          c.error,
+                          args_wrong_k,
+                          "Existing DB was written in another \"KeyFormat\"");
         return_error_if_m(status.ok(), c.error, error_unknown_k, "Opening RocksDB with options");
 
         db_ptr->native = std::unique_ptr<rocks_native_t>(native_db);
+        if (hot_capacity)
+            db_ptr->hot = std::make_unique<hot_tier_t>(hot_capacity, hot_policy, hot_admit_after);
         *c.db = db_ptr;
     });
 }
@@ -266,6 +708,9 @@ void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
+
     std::lock_guard<std::mutex> locker(db.mutex);
     auto it = db.snapshots.find(*c.id);
     if (it != db.snapshots.end())
@@ -297,6 +742,7 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
     if (!snap.snapshot)
         return;
 
+    drop_cursors(db, nullptr, snap.snapshot);
     db.native->ReleaseSnapshot(snap.snapshot);
     snap.snapshot = nullptr;
 
@@ -308,7 +754,7 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
 
 void write_one( //
     rocks_db_t& db,
-    rocks_txn_t* txn_ptr,
+    rocks_native_txn_t* txn_ptr,
     places_arg_t const& places,
     contents_arg_t const& contents,
     ustore_options_t const c_options,
@@ -317,14 +763,12 @@ void write_one( //
     bool const safe = c_options & ustore_option_write_flush_k;
     bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
 
-    rocksdb::WriteOptions options;
-    options.sync = safe;
-    options.disableWAL = !safe;
+    rocksdb::WriteOptions options = db.write_options(safe);
 
     auto place = places[0];
     auto content = contents[0];
     auto collection = rocks_collection(db, place.collection);
-    auto key = to_slice(place.key);
+    rocks_key_t key {place.key, db.key_format};
     rocks_status_t status;
 
     if (txn_ptr)
@@ -342,12 +786,14 @@ void write_one( //
                 ? db.native->Delete(options, collection, key)
                 : db.native->Put(options, collection, key, to_slice(content));
 
-    export_error(status, c_error);
+    if (export_error(status, c_error) || txn_ptr)
+        return;
+    sync_wal(db, safe, c_error);
 }
 
 void write_many( //
     rocks_db_t& db,
-    rocks_txn_t* txn_ptr,
+    rocks_native_txn_t* txn_ptr,
     places_arg_t const& places,
     contents_arg_t const& contents,
     ustore_options_t const c_options,
@@ -356,55 +802,169 @@ void write_many( //
     bool const safe = c_options & ustore_option_write_flush_k;
     bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
 
-    rocksdb::WriteOptions options;
-    options.sync = safe;
-    options.disableWAL = !safe;
+    rocksdb::WriteOptions options = db.write_options(safe);
 
     if (txn_ptr) {
-        for (std::size_t i = 0; i != places.size(); ++i) {
-            auto place = places[i];
-            auto content = contents[i];
-            auto collection = rocks_collection(db, place.collection);
-            auto key = to_slice(place.key);
-            auto status =   //
-                !content    //
-                    ? watch //
-                          ? txn_ptr->Delete(collection, key)
-                          : txn_ptr->DeleteUntracked(collection, key)
-                    : watch //
-                          ? txn_ptr->Put(collection, key, to_slice(content))
-                          : txn_ptr->PutUntracked(collection, key, to_slice(content));
-            export_error(status, c_error);
-            return_if_error_m(c_error);
-        }
+        dispatch_places(places, [&](auto const& places) {
+            dispatch_contents(contents, [&](auto const& contents) {
+                for (std::size_t i = 0; i != places.size(); ++i) {
+                    auto place = places[i];
+                    auto content = contents[i];
+                    auto collection = rocks_collection(db, place.collection);
+                    rocks_key_t key {place.key, db.key_format};
+                    auto status =   //
+                        !content    //
+                            ? watch //
+                                  ? txn_ptr->Delete(collection, key)
+                                  : txn_ptr->DeleteUntracked(collection, key)
+                            : watch //
+                                  ? txn_ptr->Put(collection, key, to_slice(content))
+                                  : txn_ptr->PutUntracked(collection, key, to_slice(content));
+                    export_error(status, c_error);
+                    return_if_error_m(c_error);
+                }
+            });
+        });
     }
     else {
         rocksdb::WriteBatch batch;
-        for (std::size_t i = 0; i != places.size(); ++i) {
-            auto place = places[i];
-            auto content = contents[i];
-            auto collection = rocks_collection(db, place.collection);
-            auto key = to_slice(place.key);
-            auto status = !content //
-                              ? batch.Delete(collection, key)
-                              : batch.Put(collection, key, to_slice(content));
-            export_error(status, c_error);
-        }
+        dispatch_places(places, [&](auto const& places) {
+            dispatch_contents(contents, [&](auto const& contents) {
+                for (std::size_t i = 0; i != places.size(); ++i) {
+                    auto place = places[i];
+                    auto content = contents[i];
+                    auto collection = rocks_collection(db, place.collection);
+                    rocks_key_t key {place.key, db.key_format};
+                    auto status = !content //
+                                      ? batch.Delete(collection, key)
+                                      : batch.Put(collection, key, to_slice(content));
+                    export_error(status, c_error);
+                }
+            });
+        });
 
         rocks_status_t status = db.native->Write(options, &batch);
-        export_error(status, c_error);
+        if (!export_error(status, c_error))
+            sync_wal(db, safe, c_error);
+    }
+}
+
+/**
+ * @brief Bulk-loads a batch, bypassing the memtables, the write-ahead log and the following compactions.
+ * Pairs are sorted, split into non-overlapping external SST files, written in parallel,
+ * and atomically ingested into all of the column families at once.
+ */
+void write_ingested( //
+    rocks_db_t& db,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_error_t* c_error) noexcept(false) {
+
+    // SST files must be sorted and can't contain duplicates, so only the last write of every key is kept
+    std::vector<std::size_t> order(places.size());
+    std::iota(order.begin(), order.end(), 0ul);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return places[a].collection_key() < places[b].collection_key();
+    });
+    std::size_t unique_count = 0;
+    for (std::size_t i = 0; i != order.size(); ++i)
+        if (i + 1 == order.size() || places[order[i]].collection_key() != places[order[i + 1]].collection_key())
+            order[unique_count++] = order[i];
+    order.resize(unique_count);
+
+    struct ingested_file_t {
+        rocks_collection_t* collection = nullptr;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::string path;
+        rocks_status_t status;
+    };
+
+    stdfs::path directory = stdfs::path(db.native->GetName()) / "ingest";
+    stdfs::create_directories(directory);
+    std::vector<ingested_file_t> files;
+    for (std::size_t begin = 0; begin != order.size();) {
+        ustore_collection_t collection = places[order[begin]].collection;
+        std::size_t end = begin;
+        while (end != order.size() && end - begin != ingest_file_pairs_k && places[order[end]].collection == collection)
+            ++end;
+
+        ingested_file_t file;
+        file.collection = rocks_collection(db, collection);
+        file.begin = begin;
+        file.end = end;
+        file.path = (directory / (std::to_string(db.ingested_files++) + ".sst")).string();
+        files.push_back(std::move(file));
+        begin = end;
+    }
+
+    std::atomic<std::size_t> next_file_idx {0};
+    auto write_files = [&]() noexcept {
+        for (std::size_t file_idx = next_file_idx++; file_idx < files.size(); file_idx = next_file_idx++) {
+            ingested_file_t& file = files[file_idx];
+            try {
+                rocksdb::SstFileWriter writer(rocksdb::EnvOptions(),
+                                              db.native->GetOptions(file.collection),
+                                              file.collection);
+                file.status = writer.Open(file.path);
+                for (std::size_t i = file.begin; i != file.end && file.status.ok(); ++i) {
+                    rocks_key_t key {places[order[i]].key, db.key_format};
+                    auto content = contents[order[i]];
+                    file.status = !content ? writer.Delete(key) : writer.Put(key, to_slice(content));
+                }
+                if (file.status.ok())
+                    file.status = writer.Finish();
+            }
+            catch (...) {
+                file.status = rocks_status_t::MemoryLimit();
+            }
+        }
+    };
+
+    std::size_t threads_count = std::min<std::size_t>(files.size(), std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 1; thread_idx < threads_count; ++thread_idx)
+        threads.emplace_back(write_files);
+    write_files();
+    for (auto& thread : threads)
+        thread.join();
+
+    // Successfully ingested files are moved into the DB, and the rest are removed
+    auto remove_files = [&]() noexcept {
+        for (auto const& file : files) {
+            std::error_code code;
+            stdfs::remove(file.path, code);
+        }
+    };
+    for (auto const& file : files)
+        if (export_error(file.status, c_error))
+            return remove_files();
+
+    // Files of the same column family are adjacent, as the pairs are sorted by collection
+    std::vector<rocksdb::IngestExternalFileArg> args;
+    for (auto const& file : files) {
+        if (args.empty() || args.back().column_family != file.collection) {
+            args.emplace_back();
+            args.back().column_family = file.collection;
+            args.back().options.move_files = true;
+        }
+        args.back().external_files.push_back(file.path);
     }
+    rocks_status_t status = db.native->IngestExternalFiles(args);
+    remove_files();
+    export_error(status, c_error);
 }
 
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::write_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
 
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
-    rocks_txn_t& txn = *reinterpret_cast<rocks_txn_t*>(c.transaction);
+    rocks_native_txn_t* txn_ptr = rocks_transaction(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
@@ -417,17 +977,43 @@ void ustore_write(ustore_write_t* c_ptr) {
 
     validate_write(c.transaction, places, contents, c.options, c.error);
     return_if_error_m(c.error);
+    if constexpr (USTORE_USE_METRICS)
+        for (std::size_t i = 0; i != places.size(); ++i)
+            metered.bytes_in(contents[i].size());
 
+    bool const bulk = (c.options & ustore_option_write_bulk_k) && !c.transaction && places.size() >= ingest_min_pairs_k;
+    bool const safe = c.options & ustore_option_write_flush_k;
+    hot_tier_t* hot = !c.transaction ? db.hot.get() : nullptr;
     safe_section("Writing into RocksDB", c.error, [&] {
-        auto func = c.tasks_count == 1 ? &write_one : &write_many;
-        func(db, &txn, places, contents, c.options, c.error);
+        // Write-back keeps the pairs in memory, unless they must be durable right away
+        if (hot && hot->policy() == hot_policy_t::write_back_k && !safe && !bulk)
+            return hot->stage(places, contents, hot_spill_t {db, false}, c.error);
+
+        hot_tier_t::epochs_t epochs {};
+        if (hot) {
+            hot->flush(hot_spill_t {db, safe}, c.error);
+            return_if_error_m(c.error);
+            epochs = hot->epochs();
+        }
+        if (bulk)
+            write_ingested(db, places, contents, c.error);
+        else {
+            auto func = c.tasks_count == 1 ? &write_one : &write_many;
+            func(db, txn_ptr, places, contents, rocks_transaction_options(c.transaction, c.options), c.error);
+        }
+
+        // The copies of partially applied writes may be stale, so all of them are dropped
+        if (hot && *c.error)
+            hot->drop_all();
+        else if (hot)
+            hot->refresh(places, contents, epochs);
     });
 }
 
 template <typename value_enumerator_at>
 void read_one( //
     rocks_db_t& db,
-    rocks_txn_t* txn_ptr,
+    rocks_native_txn_t* txn_ptr,
     rocks_snapshot_t* snap_ptr,
     places_arg_t places,
     ustore_options_t const c_options,
@@ -445,7 +1031,7 @@ void read_one( //
 
     place_t place = places[0];
     auto col = rocks_collection(db, place.collection);
-    auto key = to_slice(place.key);
+    rocks_key_t key {place.key, db.key_format};
     auto value_uptr = make_value(c_error);
     return_if_error_m(c_error);
 
@@ -467,14 +1053,20 @@ void read_one( //
         enumerator(0, value_view_t {});
 }
 
-template <typename value_enumerator_at>
+/**
+ * @brief Batched lookup, that pins the values in the block cache or memtables, instead of copying them,
+ * so that the `enumerator` is the only one to copy. Once all the values are found, the `reserve`
+ * callback receives their total size, to allocate the output at once.
+ */
+template <typename value_enumerator_at, typename reserve_at>
 void read_many( //
     rocks_db_t& db,
-    rocks_txn_t* txn_ptr,
+    rocks_native_txn_t* txn_ptr,
     rocks_snapshot_t* snap_ptr,
     places_arg_t places,
     ustore_options_t const c_options,
     value_enumerator_at enumerator,
+    reserve_at reserve,
     ustore_error_t* c_error) noexcept(false) {
 
     rocksdb::ReadOptions options;
@@ -484,28 +1076,68 @@ void read_many( //
         options.snapshot = snap_ptr->snapshot;
     }
 
+    // Keys, sorted by column family and then by key, don't have to be sorted again by RocksDB
     bool watch = !(c_options & ustore_option_transaction_dont_watch_k);
+    bool same_collection = true;
+    bool sorted = true;
     std::vector<rocks_collection_t*> cols(places.count);
+    std::vector<rocks_key_t> encoded_keys(places.count);
     std::vector<rocksdb::Slice> keys(places.count);
-    std::vector<std::string> vals(places.count);
+    dispatch_places(places, [&](auto const& places) {
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            place_t place = places[i];
+            cols[i] = rocks_collection(db, place.collection);
+            encoded_keys[i] = rocks_key_t {place.key, db.key_format};
+            keys[i] = encoded_keys[i];
+            same_collection &= cols[i] == cols[0];
+            if (i && sorted) {
+                auto previous_id = cols[i - 1]->GetID();
+                auto id = cols[i]->GetID();
+                place_t previous = places[i - 1];
+                sorted = previous_id < id || (previous_id == id && previous.key <= place.key);
+            }
+        }
+    });
+
+    // Transactions can't pin the values of watched keys, or those from different column families
+    bool const pinned = !txn_ptr || (!watch && same_collection);
+    std::vector<rocks_value_t> pinned_vals(pinned ? places.count : 0);
+    std::vector<std::string> copied_vals(pinned ? 0 : places.count);
+    std::vector<rocks_status_t> statuses(pinned ? places.count : 0);
+    if (!pinned)
+        statuses = watch //
+                       ? txn_ptr->MultiGetForUpdate(options, cols, keys, &copied_vals)
+                       : txn_ptr->MultiGet(options, cols, keys, &copied_vals);
+    else if (txn_ptr)
+        txn_ptr->MultiGet(options, cols[0], places.count, keys.data(), pinned_vals.data(), statuses.data(), sorted);
+    else
+        db.native->MultiGet(options,
+                            places.count,
+                            cols.data(),
+                            keys.data(),
+                            pinned_vals.data(),
+                            statuses.data(),
+                            sorted);
+
+    auto value = [&](std::size_t i) noexcept {
+        return pinned ? rocksdb::Slice(pinned_vals[i]) : rocksdb::Slice(copied_vals[i]);
+    };
+    std::size_t total_length = 0;
     for (std::size_t i = 0; i != places.size(); ++i) {
-        place_t place = places[i];
-        cols[i] = rocks_collection(db, place.collection);
-        keys[i] = to_slice(place.key);
+        if (statuses[i].IsNotFound())
+            continue;
+        if (export_error(statuses[i], c_error))
+            return;
+        total_length += value(i).size();
     }
+    reserve(total_length);
+    return_if_error_m(c_error);
 
-    std::vector<rocks_status_t> statuses = //
-        txn_ptr                            //
-            ? watch                        //
-                  ? txn_ptr->MultiGetForUpdate(options, cols, keys, &vals)
-                  : txn_ptr->MultiGet(options, cols, keys, &vals)
-            : db.native->MultiGet(options, cols, keys, &vals);
     for (std::size_t i = 0; i != places.size(); ++i) {
         if (!statuses[i].IsNotFound()) {
-            if (export_error(statuses[i], c_error))
-                return;
-            auto begin = reinterpret_cast<ustore_bytes_cptr_t>(vals[i].data());
-            auto length = static_cast<ustore_length_t>(vals[i].size());
+            rocksdb::Slice found = value(i);
+            auto begin = reinterpret_cast<ustore_bytes_cptr_t>(found.data());
+            auto length = static_cast<ustore_length_t>(found.size());
             enumerator(i, value_view_t {begin, length});
         }
         else
@@ -513,9 +1145,81 @@ void read_many( //
     }
 }
 
+/**
+ * @brief Reports the presences and lengths of values, without exporting them. Keys, that
+ * the bloom filters rule out, aren't fetched at all, and values found in the memtables
+ * are measured in place. The rest are fetched pinned in the block cache, avoiding copies.
+ * Transactions track their own writes and reads, so they can't use this path.
+ */
+template <typename value_enumerator_at>
+void read_sizes( //
+    rocks_db_t& db,
+    rocks_snapshot_t* snap_ptr,
+    places_arg_t places,
+    value_enumerator_at enumerator,
+    ustore_error_t* c_error) noexcept(false) {
+
+    rocksdb::ReadOptions options;
+    if (snap_ptr) {
+        auto it = db.snapshots.find(reinterpret_cast<std::size_t>(snap_ptr));
+        return_error_if_m(it != db.snapshots.end(), c_error, args_wrong_k, "The snapshot does'nt exist!");
+        options.snapshot = snap_ptr->snapshot;
+    }
+
+    std::vector<std::size_t> unknown_idxs;
+    std::vector<rocks_collection_t*> unknown_cols;
+    std::vector<rocksdb::Slice> unknown_keys;
+    std::vector<rocks_key_t> encoded_keys(places.count);
+    std::string memtable_value;
+    dispatch_places(places, [&](auto const& places) {
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            place_t place = places[i];
+            rocks_collection_t* col = rocks_collection(db, place.collection);
+            encoded_keys[i] = rocks_key_t {place.key, db.key_format};
+            rocksdb::Slice key = encoded_keys[i];
+            bool value_found = false;
+            memtable_value.clear();
+            if (!db.native->KeyMayExist(options, col, key, &memtable_value, &value_found))
+                enumerator(i, value_view_t {});
+            else if (value_found)
+                enumerator(i,
+                           value_view_t {reinterpret_cast<ustore_bytes_cptr_t>(memtable_value.data()),
+                                         static_cast<ustore_length_t>(memtable_value.size())});
+            else {
+                unknown_idxs.push_back(i);
+                unknown_cols.push_back(col);
+                unknown_keys.push_back(key);
+            }
+        }
+    });
+    if (unknown_idxs.empty())
+        return;
+
+    std::vector<rocks_value_t> pinned_vals(unknown_idxs.size());
+    std::vector<rocks_status_t> statuses(unknown_idxs.size());
+    db.native->MultiGet(options,
+                        unknown_idxs.size(),
+                        unknown_cols.data(),
+                        unknown_keys.data(),
+                        pinned_vals.data(),
+                        statuses.data());
+    for (std::size_t i = 0; i != unknown_idxs.size(); ++i) {
+        if (statuses[i].IsNotFound()) {
+            enumerator(unknown_idxs[i], value_view_t {});
+            continue;
+        }
+        if (export_error(statuses[i], c_error))
+            return;
+        auto begin = reinterpret_cast<ustore_bytes_cptr_t>(pinned_vals[i].data());
+        auto length = static_cast<ustore_length_t>(pinned_vals[i].size());
+        enumerator(unknown_idxs[i], value_view_t {begin, length});
+    }
+}
+
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::read_k, c.error};
 
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
@@ -525,7 +1229,7 @@ void ustore_read(ustore_read_t* c_ptr) {
     return_if_error_m(c.error);
 
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
-    rocks_txn_t& txn = *reinterpret_cast<rocks_txn_t*>(c.transaction);
+    rocks_native_txn_t* txn_ptr = rocks_transaction(c.transaction);
     rocks_snapshot_t& snap = *reinterpret_cast<rocks_snapshot_t*>(c.snapshot);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
@@ -554,20 +1258,99 @@ void ustore_read(ustore_read_t* c_ptr) {
         }
     };
 
+    // Some of the values may already be exported from the hot tier
+    auto data_reserver = [&](std::size_t length) {
+        if (needs_export)
+            contents.reserve(contents.size() + length, c.error);
+    };
+
+    // Presences and lengths are answered without exporting the values, if possible
+    bool const sizes_only = !needs_export && !c.offsets && !txn_ptr;
+    hot_tier_t* hot = !c.transaction && !c.snapshot ? db.hot.get() : nullptr;
     safe_section("Reading from RocksDB", c.error, [&] {
-        c.tasks_count == 1 //
-            ? read_one(db, &txn, &snap, places, c.options, data_enumerator, c.error)
-            : read_many(db, &txn, &snap, places, c.options, data_enumerator, c.error);
+        ustore_options_t const options = rocks_transaction_options(c.transaction, c.options);
+        auto read_engine = [&](places_arg_t const& places, auto&& enumerator) {
+            sizes_only           ? read_sizes(db, &snap, places, enumerator, c.error)
+            : places.size() == 1 ? read_one(db, txn_ptr, &snap, places, options, enumerator, c.error)
+                                 : read_many(db, txn_ptr, &snap, places, options, enumerator, data_reserver, c.error);
+        };
+        if (hot)
+            hot->read(places, read_engine, data_enumerator, hot_spill_t {db, false}, c.error);
+        else
+            read_engine(places, data_enumerator);
         offs[places.count] = contents.size();
+        metered.bytes_out(contents.size());
 
         if (needs_export)
             *c.values = reinterpret_cast<ustore_bytes_ptr_t>(contents.begin());
     });
 }
 
+/**
+ * @brief Takes the pooled iterator, positioned at `start_key`, if there were no writes since it was created.
+ * @return Empty cursor, if nothing matches.
+ */
+rocks_cursor_t take_cursor(rocks_db_t& db,
+                           rocks_collection_t* collection,
+                           rocksdb::Snapshot const* snapshot,
+                           ustore_key_t start_key) noexcept {
+    std::lock_guard<std::mutex> locker(db.cursors_mutex);
+    rocksdb::SequenceNumber sequence = snapshot ? 0 : db.native->GetLatestSequenceNumber();
+    for (auto it = db.cursors.rbegin(); it != db.cursors.rend(); ++it) {
+        rocks_cursor_t& cursor = *it;
+        if (cursor.collection != collection || cursor.snapshot != snapshot || cursor.sequence != sequence)
+            continue;
+        // The iterator points to the first key after `lower_key`, so it can also serve
+        // any start key between the two.
+        bool const valid = cursor.iterator->Valid();
+        if (start_key < cursor.lower_key ||
+            (valid && decode_key(cursor.iterator->key().data(), db.key_format) < start_key))
+            continue;
+        rocks_cursor_t result = std::move(cursor);
+        db.cursors.erase(std::next(it).base());
+        return result;
+    }
+    return {};
+}
+
+void return_cursor(rocks_db_t& db, rocks_cursor_t&& cursor) noexcept {
+    std::lock_guard<std::mutex> locker(db.cursors_mutex);
+    // Cursors, invalidated by newer writes, are useless
+    rocksdb::SequenceNumber sequence = db.native->GetLatestSequenceNumber();
+    db.cursors.erase(std::remove_if(db.cursors.begin(),
+                                    db.cursors.end(),
+                                    [=](rocks_cursor_t const& old) {
+                                        return !old.snapshot && old.sequence != sequence;
+                                    }),
+                     db.cursors.end());
+    if (db.cursors.size() == cursors_limit_k)
+        db.cursors.erase(db.cursors.begin());
+    // Failing to pool an iterator only costs a `Seek` in the next scan
+    try {
+        db.cursors.push_back(std::move(cursor));
+    }
+    catch (...) {
+    }
+}
+
+/**
+ * @brief Releases the iterators, that would otherwise outlive the collection or the snapshot.
+ */
+void drop_cursors(rocks_db_t& db, rocks_collection_t* collection, rocksdb::Snapshot const* snapshot) noexcept {
+    std::lock_guard<std::mutex> locker(db.cursors_mutex);
+    db.cursors.erase(std::remove_if(db.cursors.begin(),
+                                    db.cursors.end(),
+                                    [=](rocks_cursor_t const& cursor) {
+                                        return (collection && cursor.collection == collection) ||
+                                               (snapshot && cursor.snapshot == snapshot);
+                                    }),
+                     db.cursors.end());
+}
+
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::scan_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -583,6 +1366,8 @@ void ustore_scan(ustore_scan_t* c_ptr) {
 
     validate_scan(c.transaction, tasks, c.options, c.error);
     return_if_error_m(c.error);
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
 
     // 1. Allocate a tape for all the values to be fetched
     auto offsets = arena.alloc_or_dummy(tasks.count + 1, c.error, c.offsets);
@@ -594,45 +1379,87 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
-    // 2. Fetch the data
-    rocksdb::ReadOptions options;
-    options.fill_cache = false;
-
-    if (c.snapshot)
-        options.snapshot = snap.snapshot;
+    // Values are optionally exported in the same pass
+    uninitialized_array_gt<byte_t> values(arena);
+    ustore_length_t* values_offsets = nullptr;
+    if (c.values) {
+        values_offsets = arena.alloc<ustore_length_t>(total_keys + 1, c.error).begin();
+        return_if_error_m(c.error);
+    }
 
+    // 2. Fetch the data
+    rocksdb::Snapshot const* snapshot = c.snapshot ? snap.snapshot : nullptr;
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         scan_t task = tasks[i];
         auto collection = rocks_collection(db, task.collection);
 
-        std::unique_ptr<rocksdb::Iterator> it;
-        safe_section("Creating a RocksDB iterator", c.error, [&] {
-            it = c.transaction //
-                     ? std::unique_ptr<rocksdb::Iterator>(txn.GetIterator(options, collection))
-                     : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
-        });
-        return_if_error_m(c.error);
+        // Transactional iterators include the uncommitted writes, so they aren't pooled
+        rocks_cursor_t cursor;
+        if (!c.transaction)
+            cursor = take_cursor(db, collection, snapshot, task.min_key);
+
+        if (!cursor.iterator) {
+            rocksdb::ReadOptions options;
+            options.snapshot = snapshot;
+            bool const long_scan = task.limit >= long_scan_k;
+            options.fill_cache = !long_scan;
+            if (long_scan)
+                options.readahead_size = long_scan_readahead_k;
+
+            cursor.collection = collection;
+            cursor.snapshot = snapshot;
+            cursor.sequence = snapshot ? 0 : db.native->GetLatestSequenceNumber();
+            safe_section("Creating a RocksDB iterator", c.error, [&] {
+                cursor.iterator = c.transaction //
+                                      ? std::unique_ptr<rocksdb::Iterator>(txn.native->GetIterator(options, collection))
+                                      : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
+            });
+            return_if_error_m(c.error);
+            cursor.iterator->Seek(rocks_key_t {task.min_key, db.key_format});
+        }
 
         offsets[i] = keys_output - *c.keys;
 
+        rocksdb::Iterator& it = *cursor.iterator;
         ustore_size_t j = 0;
-        it->Seek(to_slice(task.min_key));
-        while (it->Valid() && j != task.limit) {
-            std::memcpy(keys_output, it->key().data(), sizeof(ustore_key_t));
+        while (it.Valid() && j != task.limit) {
+            if (c.values) {
+                auto value = it.value();
+                std::size_t old_size = values.size();
+                values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(old_size);
+                values.resize(old_size + value.size(), c.error);
+                return_if_error_m(c.error);
+                std::memcpy(values.begin() + old_size, value.data(), value.size());
+            }
+            *keys_output = decode_key(it.key().data(), db.key_format);
             ++keys_output;
             ++j;
-            it->Next();
+            it.Next();
         }
-
         counts[i] = j;
+
+        // Only full pages are likely to be followed by the next ones
+        bool const paginated = j != 0 && j == task.limit && keys_output[-1] != std::numeric_limits<ustore_key_t>::max();
+        if (paginated && !c.transaction && it.status().ok()) {
+            cursor.lower_key = keys_output[-1] + 1;
+            return_cursor(db, std::move(cursor));
+        }
     }
 
     offsets[tasks.size()] = keys_output - *c.keys;
+
+    if (c.values) {
+        values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(values.size());
+        *c.values = reinterpret_cast<ustore_bytes_ptr_t>(values.begin());
+        if (c.values_offsets)
+            *c.values_offsets = values_offsets;
+    }
 }
 
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::sample_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -646,6 +1473,8 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_length_t const> lens {c.count_limits, c.count_limits_stride};
     sample_args_t samples {collections, lens, c.tasks_count};
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
 
     // 1. Allocate a tape for all the values to be fetched
     auto offsets = arena.alloc_or_dummy(samples.count + 1, c.error, c.offsets);
@@ -660,6 +1489,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     // 2. Fetch the data
     rocksdb::ReadOptions options;
     options.fill_cache = false;
+    bool const approximate = c.options & ustore_option_sample_approximate_k;
 
     if (c.snapshot)
         options.snapshot = snap.snapshot;
@@ -672,13 +1502,17 @@ void ustore_sample(ustore_sample_t* c_ptr) {
         std::unique_ptr<rocksdb::Iterator> it;
         safe_section("Creating a RocksDB iterator", c.error, [&] {
             it = c.transaction //
-                     ? std::unique_ptr<rocksdb::Iterator>(txn.GetIterator(options, collection))
+                     ? std::unique_ptr<rocksdb::Iterator>(txn.native->GetIterator(options, collection))
                      : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
         });
         return_if_error_m(c.error);
 
         ptr_range_gt<ustore_key_t> sampled_keys(keys_output, task.limit);
-        reservoir_sample_iterator(it, sampled_keys, c.error);
+        if (approximate)
+            seek_sample_iterator(it, db.key_format, sampled_keys, c.error);
+        else
+            reservoir_sample_iterator(it, db.key_format, sampled_keys, c.error);
+        return_if_error_m(c.error);
 
         counts[task_idx] = task.limit;
         keys_output += task.limit;
@@ -689,6 +1523,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::measure_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -707,39 +1542,111 @@ void ustore_measure(ustore_measure_t* c_ptr) {
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
     rocksdb::SizeApproximationOptions options;
-
-    rocksdb::Range range;
-    uint64_t approximate_size = 0;
-    uint64_t keys_count = 0;
-    uint64_t sst_files_size = 0;
-    rocks_status_t status;
+    options.include_memtables = true;
+    options.include_files = true;
+    options.files_size_error_margin = 0.1;
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
 
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         auto collection = rocks_collection(db, collections[i]);
-        ustore_key_t const min_key = start_keys[i];
-        ustore_key_t const max_key = end_keys[i];
-        range = rocksdb::Range(to_slice(min_key), to_slice(max_key));
+        rocks_key_t const min_key {start_keys[i], db.key_format};
+        rocks_key_t const max_key {end_keys[i], db.key_format};
+        rocksdb::Range range(min_key, max_key);
+
+        uint64_t range_size = 0;
+        uint64_t memtable_count = 0;
+        uint64_t memtable_size = 0;
+        rocksdb::TablePropertiesCollection tables;
         safe_section("Retrieving properties from RocksDB", c.error, [&] {
-            status = db.native->GetApproximateSizes(options, collection, &range, 1, &approximate_size);
+            rocks_status_t status = db.native->GetApproximateSizes(options, collection, &range, 1, &range_size);
             if (export_error(status, c.error))
                 return;
-            db.native->GetIntProperty(collection, "rocksdb.estimate-num-keys", &keys_count);
-            db.native->GetIntProperty(collection, "rocksdb.total-sst-files-size", &sst_files_size);
+            db.native->GetApproximateMemTableStats(collection, range, &memtable_count, &memtable_size);
+            status = db.native->GetPropertiesOfTablesInRange(collection, &range, 1, &tables);
+            export_error(status, c.error);
         });
         return_if_error_m(c.error);
 
-        min_cardinalities[i] = static_cast<ustore_size_t>(0);
-        max_cardinalities[i] = static_cast<ustore_size_t>(keys_count);
-        min_value_bytes[i] = static_cast<ustore_size_t>(0);
-        max_value_bytes[i] = std::numeric_limits<ustore_size_t>::max();
-        min_space_usages[i] = approximate_size;
-        max_space_usages[i] = sst_files_size;
+        // Files, overlapping with the range, may also contain keys outside of it
+        uint64_t files_entries = 0;
+        uint64_t files_deletions = 0;
+        uint64_t files_value_bytes = 0;
+        uint64_t files_size = 0;
+        for (auto const& [name, table] : tables) {
+            files_entries += table->num_entries;
+            files_deletions += table->num_deletions;
+            files_value_bytes += table->raw_value_size;
+            files_size += table->data_size + table->index_size + table->filter_size;
+        }
+
+        // The share of the overlapping files, that falls into the range
+        uint64_t const range_files_size = range_size > memtable_size ? range_size - memtable_size : 0;
+        double const share = files_size ? std::min(1.0, double(range_files_size) / double(files_size)) : 0.0;
+        uint64_t const live_entries = files_entries > files_deletions ? files_entries - files_deletions : 0;
+        uint64_t const memtable_value_bytes =
+            memtable_size > memtable_count * sizeof(ustore_key_t) ? memtable_size - memtable_count * sizeof(ustore_key_t)
+                                                                 : 0;
+
+        min_cardinalities[i] = static_cast<ustore_size_t>(live_entries * share) + memtable_count;
+        max_cardinalities[i] = static_cast<ustore_size_t>(files_entries + memtable_count);
+        min_value_bytes[i] = static_cast<ustore_size_t>(files_value_bytes * share) + memtable_value_bytes;
+        max_value_bytes[i] = static_cast<ustore_size_t>(files_value_bytes + memtable_size);
+        min_space_usages[i] = static_cast<ustore_size_t>(range_size);
+        max_space_usages[i] = static_cast<ustore_size_t>(std::max(range_size, files_size + memtable_size));
+    }
+}
+
+void ustore_erase_ranges(ustore_erase_ranges_t* c_ptr) {
+
+    ustore_erase_ranges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::erase_k, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(!c.tasks_count || (c.start_keys && c.end_keys), c.error, args_combo_k, "Need range bounds!");
+
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+
+    bool const safe = c.options & ustore_option_write_flush_k;
+    rocksdb::WriteOptions options = db.write_options(safe);
+
+    flush_hot(db, safe, c.error);
+    return_if_error_m(c.error);
+
+    // Range tombstones hide the keys without visiting them, and are dropped by compactions
+    rocksdb::WriteBatch batch;
+    for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
+        ustore_key_t const& start_key = start_keys[i];
+        ustore_key_t const& end_key = end_keys[i];
+        if (end_key <= start_key)
+            continue;
+        auto collection = rocks_collection(db, collections ? collections[i] : ustore_collection_main_k);
+        rocks_status_t status = batch.DeleteRange(collection,
+                                                  rocks_key_t {start_key, db.key_format},
+                                                  rocks_key_t {end_key, db.key_format});
+        if (export_error(status, c.error))
+            return;
     }
+    if (!batch.Count())
+        return;
+
+    rocks_status_t status;
+    safe_section("Writing range tombstones", c.error, [&] {
+        status = db.native->Write(options, &batch);
+        if (db.hot)
+            db.hot->drop_all();
+    });
+    return_if_error_m(c.error);
+    if (!export_error(status, c.error))
+        sync_wal(db, safe, c.error);
 }
 
 void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 
     ustore_collection_create_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     auto name_len = c.name ? std::strlen(c.name) : 0;
     return_error_if_m(name_len, c.error, args_wrong_k, "Default collection is always present");
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
@@ -752,9 +1659,7 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
     }
 
     rocks_collection_t* collection = nullptr;
-    auto cf_options = rocksdb::ColumnFamilyOptions();
-    cf_options.comparator = &key_comparator_k;
-    rocks_status_t status = db.native->CreateColumnFamily(std::move(cf_options), c.name, &collection);
+    rocks_status_t status = db.native->CreateColumnFamily(db.options_for(c.name), c.name, &collection);
     if (!export_error(status, c.error)) {
         db.columns.push_back(collection);
         *c.id = reinterpret_cast<ustore_collection_t>(collection);
@@ -764,6 +1669,7 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
 
     ustore_collection_drop_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     bool invalidate = c.mode == ustore_drop_keys_vals_handle_k;
@@ -771,25 +1677,36 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
                       c.error,
                       args_combo_k,
                       "Default collection can't be invalidated.");
+    drop_companions(c);
+    return_if_error_m(c.error);
 
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
     rocks_collection_t* collection_ptr = reinterpret_cast<rocks_collection_t*>(c.id);
     rocks_collection_t* collection_ptr_to_clear = nullptr;
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
+    if (db.hot)
+        safe_section("Dropping the hot tier", c.error, [&] { db.hot->drop_all(); });
+    return_if_error_m(c.error);
 
     if (c.id == ustore_collection_main_k)
         collection_ptr_to_clear = db.native->DefaultColumnFamily();
     else {
-        for (auto it = db.columns.begin(); it != db.columns.end(); it++) {
-            collection_ptr_to_clear = reinterpret_cast<rocks_collection_t*>(*it);
-            if (collection_ptr_to_clear == collection_ptr)
+        for (auto it = db.columns.begin(); it != db.columns.end(); it++)
+            if (reinterpret_cast<rocks_collection_t*>(*it) == collection_ptr) {
+                collection_ptr_to_clear = collection_ptr;
                 break;
-        }
+            }
+        // Companions are dropped along with their parents, so their handles may already be gone
+        if (!collection_ptr_to_clear)
+            return;
     }
 
     rocksdb::WriteOptions options;
     options.sync = true;
 
     if (c.mode == ustore_drop_keys_vals_handle_k) {
+        drop_cursors(db, collection_ptr_to_clear, nullptr);
         for (auto it = db.columns.begin(); it != db.columns.end(); it++) {
             if (collection_ptr_to_clear == *it) {
                 rocks_status_t status = db.native->DropColumnFamily(collection_ptr_to_clear);
@@ -802,23 +1719,39 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
         return;
     }
     else if (c.mode == ustore_drop_keys_vals_k) {
+        // The upper bound of `DeleteRange` is exclusive, so the biggest key is deleted separately
+        rocks_key_t const min_key {std::numeric_limits<ustore_key_t>::min(), db.key_format};
+        rocks_key_t const max_key {std::numeric_limits<ustore_key_t>::max(), db.key_format};
         rocksdb::WriteBatch batch;
-        auto it =
-            std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(rocksdb::ReadOptions(), collection_ptr_to_clear));
-        for (it->SeekToFirst(); it->Valid(); it->Next())
-            batch.Delete(collection_ptr_to_clear, it->key());
-        rocks_status_t status = db.native->Write(options, &batch);
+        rocks_status_t status = batch.DeleteRange(collection_ptr_to_clear, min_key, max_key);
+        if (status.ok())
+            status = batch.Delete(collection_ptr_to_clear, max_key);
+        if (status.ok())
+            status = db.native->Write(options, &batch);
         export_error(status, c.error);
         return;
     }
 
     else if (c.mode == ustore_drop_vals_k) {
+        // Keys have to stay, so they are rewritten, but in bounded batches,
+        // instead of materializing the whole collection in memory
+        constexpr std::size_t batch_pairs_k = 64 * 1024;
+        rocksdb::ReadOptions read_options;
+        read_options.fill_cache = false;
         rocksdb::WriteBatch batch;
-        auto it =
-            std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(rocksdb::ReadOptions(), collection_ptr_to_clear));
-        for (it->SeekToFirst(); it->Valid(); it->Next())
-            batch.Put(collection_ptr_to_clear, it->key(), rocksdb::Slice());
-        rocks_status_t status = db.native->Write(options, &batch);
+        rocks_status_t status;
+        auto it = std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(read_options, collection_ptr_to_clear));
+        for (it->SeekToFirst(); it->Valid() && status.ok(); it->Next()) {
+            status = batch.Put(collection_ptr_to_clear, it->key(), rocksdb::Slice());
+            if (status.ok() && batch.Count() == batch_pairs_k) {
+                status = db.native->Write(options, &batch);
+                batch.Clear();
+            }
+        }
+        if (status.ok())
+            status = it->status();
+        if (status.ok() && batch.Count())
+            status = db.native->Write(options, &batch);
         export_error(status, c.error);
         return;
     }
@@ -868,11 +1801,140 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
     offs[i] = static_cast<ustore_length_t>(names - *c.names);
 }
 
+/**
+ * @brief Reports the occupancy and the hit rate of the hot tier, in response to the "usage" control.
+ */
+void control_usage(rocks_db_t& db, ustore_database_control_t& c) noexcept {
+    hot_tier_t::usage_t usage;
+    if (db.hot)
+        usage = db.hot->usage();
+
+    char response[512];
+    int response_length = std::snprintf( //
+        response,
+        sizeof(response),
+        "{\"hot_tier\":{\"capacity_bytes\":%zu,\"used_bytes\":%zu,\"pairs\":%zu,\"dirty_pairs\":%zu,"
+        "\"hits\":%zu,\"misses\":%zu}}",
+        usage.capacity_bytes,
+        usage.used_bytes,
+        usage.pairs,
+        usage.dirty_pairs,
+        usage.hits,
+        usage.misses);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto response_chars = arena.alloc<char>(response_length + 1, c.error);
+    return_if_error_m(c.error);
+    std::memcpy(response_chars.begin(), response, response_length + 1);
+    *c.response = response_chars.begin();
+}
+
+/**
+ * @brief Copies every collection from a consistent snapshot into a new DB in the `directory`,
+ * encoding the keys in the given `format`. Both formats order the keys the same way,
+ * so the pairs are appended in sorted order, and the new DB is flushed once in the end.
+ */
+void migrate_keys(rocks_db_t& db, key_format_t format, std::string const& directory, ustore_error_t* c_error) {
+
+    // Options of the target can't be copied entirely, as they include the paths of the source
+    rocksdb::DBOptions options;
+    options.create_if_missing = true;
+    options.create_missing_column_families = true;
+    options.error_if_exists = true;
+    std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+    for (rocks_collection_t* column : db.columns) {
+        rocksdb::ColumnFamilyOptions column_options = db.native->GetOptions(column);
+        column_options.comparator = rocks_db_t::comparator_for(format);
+        descriptors.push_back({column->GetName(), std::move(column_options)});
+    }
+
+    rocksdb::DB* target_ptr = nullptr;
+    std::vector<rocks_collection_t*> target_columns;
+    rocks_status_t status = rocksdb::DB::Open(options, directory, descriptors, &target_columns, &target_ptr);
+    if (export_error(status, c_error))
+        return;
+    std::unique_ptr<rocksdb::DB> target(target_ptr);
+
+    constexpr std::size_t batch_pairs_k = 64 * 1024;
+    rocksdb::Snapshot const* snapshot = db.native->GetSnapshot();
+    rocksdb::ReadOptions read_options;
+    read_options.snapshot = snapshot;
+    read_options.fill_cache = false;
+    read_options.readahead_size = long_scan_readahead_k;
+    rocksdb::WriteOptions write_options;
+    write_options.disableWAL = true;
+    safe_section("Migrating keys", c_error, [&] {
+        rocksdb::WriteBatch batch;
+        for (std::size_t i = 0; i != db.columns.size() && status.ok(); ++i) {
+            auto it = std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(read_options, db.columns[i]));
+            for (it->SeekToFirst(); it->Valid() && status.ok(); it->Next()) {
+                rocks_key_t key {decode_key(it->key().data(), db.key_format), format};
+                status = batch.Put(target_columns[i], key, it->value());
+                if (status.ok() && batch.Count() == batch_pairs_k) {
+                    status = target->Write(write_options, &batch);
+                    batch.Clear();
+                }
+            }
+            if (status.ok())
+                status = it->status();
+        }
+        if (status.ok() && batch.Count())
+            status = target->Write(write_options, &batch);
+        if (status.ok())
+            status = target->Flush(rocksdb::FlushOptions(), target_columns);
+        export_error(status, c_error);
+    });
+    db.native->ReleaseSnapshot(snapshot);
+
+    for (rocks_collection_t* column : target_columns)
+        target->DestroyColumnFamilyHandle(column);
+    status = target->Close();
+    if (!*c_error)
+        export_error(status, c_error);
+}
+
+/**
+ * @brief Handles the "migrate_keys <native|bytewise> <directory>" control.
+ */
+void control_migrate_keys(rocks_db_t& db, ustore_database_control_t& c) {
+    std::string_view arguments = std::string_view(c.request).substr(std::strlen("migrate_keys "));
+    std::size_t const space = arguments.find(' ');
+    key_format_t format;
+    return_error_if_m(space != std::string_view::npos &&
+                          parse_key_format(std::string(arguments.substr(0, space)), format),
+                      c.error,
+                      args_wrong_k,
+                      "Expects \"migrate_keys <native|bytewise> <directory>\"");
+    std::string directory {arguments.substr(space + 1)};
+    return_error_if_m(!directory.empty(), c.error, args_wrong_k, "Missing target directory");
+
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
+    safe_section("Migrating keys", c.error, [&] { migrate_keys(db, format, directory, c.error); });
+}
+
 void ustore_database_control(ustore_database_control_t* c_ptr) {
 
     ustore_database_control_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
+
     *c.response = NULL;
-    *c.error = "Controls aren't supported in this implementation!";
+    if (is_metrics_request(c.request))
+        return control_metrics(c);
+    if (is_traces_request(c.request))
+        return control_traces(c);
+    if (std::strcmp(c.request, "usage") == 0)
+        return control_usage(*reinterpret_cast<rocks_db_t*>(c.db), c);
+    if (std::strncmp(c.request, "migrate_keys ", std::strlen("migrate_keys ")) == 0)
+        return control_migrate_keys(*reinterpret_cast<rocks_db_t*>(c.db), c);
+    return_error_if_m(std::strcmp(c.request, "arenas") == 0,
+                      c.error,
+                      missing_feature_k,
+                      "Only \"usage\", \"arenas\", \"metrics\", \"traces\" "
+                      "and \"migrate_keys\" controls are supported!");
+    control_arenas(c);
 }
 
 void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
@@ -884,17 +1946,32 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 
     bool const safe = c.options & ustore_option_write_flush_k;
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
-    rocks_txn_t& txn = **reinterpret_cast<rocks_txn_t**>(c.transaction);
+    rocks_txn_t* txn_ptr = reinterpret_cast<rocks_txn_t*>(*c.transaction);
+    flush_hot(db, false, c.error);
+    return_if_error_m(c.error);
+    std::unique_ptr<rocks_txn_t> new_txn_ptr;
+    if (!txn_ptr) {
+        safe_section("Allocating a transaction", c.error, [&] { new_txn_ptr = std::make_unique<rocks_txn_t>(); });
+        return_if_error_m(c.error);
+        txn_ptr = new_txn_ptr.get();
+    }
+
     rocksdb::OptimisticTransactionOptions txn_options;
     txn_options.set_snapshot = false;
-    rocksdb::WriteOptions options;
-    options.sync = safe;
-    options.disableWAL = !safe;
-    auto new_txn = db.native->BeginTransaction(options, txn_options, &txn);
-    if (!new_txn)
+    rocksdb::WriteOptions options = db.write_options(safe);
+
+    // The old transaction object is reinitialized and returned, if it's passed
+    auto new_txn = db.native->BeginTransaction(options, txn_options, txn_ptr->native.get());
+    if (!new_txn) {
         *c.error = "Couldn't start a transaction!";
-    else
-        *c.transaction = new_txn;
+        return;
+    }
+    if (new_txn != txn_ptr->native.get())
+        txn_ptr->native.reset(new_txn);
+    txn_ptr->dont_watch = c.options & ustore_option_transaction_dont_watch_k;
+    txn_ptr->safe = safe;
+    new_txn_ptr.release();
+    *c.transaction = txn_ptr;
 }
 
 void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
@@ -908,15 +1985,37 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
     rocks_txn_t& txn = *reinterpret_cast<rocks_txn_t*>(c.transaction);
 
+    // Pending write-back pairs must reach RocksDB to be validated against,
+    // and the copies of the pairs, written by the transaction, become stale
+    std::optional<written_keys_t> written;
+    if (db.hot) {
+        flush_hot(db, false, c.error);
+        return_if_error_m(c.error);
+        safe_section("Collecting transaction keys", c.error, [&] {
+            written.emplace(db);
+            export_error(txn.native->GetWriteBatch()->GetWriteBatch()->Iterate(&*written), c.error);
+        });
+        return_if_error_m(c.error);
+    }
+
+    // Durability may also be requested on commit, if the transaction was started without it
+    bool const safe = txn.safe || (c.options & ustore_option_write_flush_k);
+    if (safe && !txn.safe)
+        txn.native->SetWriteOptions(db.write_options(true));
+
     if (c.sequence_number)
         db.mutex.lock();
-    rocks_status_t status = txn.Commit();
+    rocks_status_t status = txn.native->Commit();
     export_error(status, c.error);
     if (c.sequence_number) {
         if (status.ok())
             *c.sequence_number = db.native->GetLatestSequenceNumber();
         db.mutex.unlock();
     }
+    if (written && status.ok())
+        db.hot->drop(written->keys);
+    if (status.ok())
+        sync_wal(db, safe, c.error);
 }
 
 void ustore_arena_free(ustore_arena_t c_arena) {
@@ -932,7 +2031,14 @@ void ustore_transaction_free(ustore_transaction_t c_transaction) {
 void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
+    collections_epoch_bump_t bump;
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
+    ustore_error_t error = nullptr;
+    flush_hot(db, true, &error);
+    if (error)
+        log_warning_m("Couldn't flush the hot tier: %s\n", error);
+    db.hot.reset();
+    db.cursors.clear();
     for (rocks_collection_t* cf : db.columns)
         db.native->DestroyColumnFamilyHandle(cf);
     db.native.reset();
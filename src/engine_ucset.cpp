@@ -7,37 +7,52 @@
  * It keeps all the pairs sorted and is pretty fast for a BST-based container.
  */
 
-#include <stdio.h> // Saving/reading from disk
+#include <stdio.h>    // Saving/reading from disk
+#include <unistd.h>   // `fsync`, `pread`, `pwrite`
+#include <fcntl.h>    // `open`
+#include <sys/mman.h> // `mmap`
+#include <sys/stat.h> // `fstat`
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <shared_mutex>
-#include <mutex>      // `std::unique_lock`
-#include <numeric>    // `std::accumulate`
-#include <atomic>     // Thread-safe generation counters
-#include <filesystem> // Enumerating the directory
-#include <fstream>    // Passing file contents to JSON parser
+#include <mutex>              // `std::unique_lock`
+#include <numeric>            // `std::accumulate`
+#include <atomic>             // Thread-safe generation counters
+#include <filesystem>         // Enumerating the directory
+#include <fstream>            // Passing file contents to JSON parser
+#include <charconv>           // `std::from_chars`
+#include <algorithm>          // `std::sort`
+#include <thread>             // Background checkpoints
+#include <chrono>             // `std::chrono::seconds`
+#include <condition_variable> // Group commit of the write-ahead log
 
 // TODO: These alternative containers need further testing:
 // #include <ucset/consistent_avl.hpp> // `ucset::consistent_avl_gt`
-// #include <ucset/partitioned.hpp>    // `ucset::partitioned_gt`
 #include <ucset/consistent_set.hpp> // `ucset::consistent_set_gt`
 #include <ucset/locked.hpp>         // `ucset::locked_gt`
+#include <ucset/partitioned.hpp>    // `ucset::partitioned_gt`
 
 #include <nlohmann/json.hpp>       // `nlohmann::json`
 #include <arrow/io/file.h>         // `arrow::io::ReadableFile`
-#include <parquet/stream_reader.h> // `parquet::StreamReader`
+#include <arrow/table.h>           // `arrow::Table`
+#include <parquet/arrow/reader.h>  // `parquet::arrow::FileReader`
 #include <parquet/stream_writer.h> // `parquet::StreamWriter`
 
 #include "ustore/db.h"
 #include "helpers/file.hpp"
 #include "helpers/linked_memory.hpp" // `linked_memory_t`
+#include "helpers/metrics.hpp"       // `metered_call_t`
 #include "helpers/linked_array.hpp"  // `unintialized_vector_gt`
 #include "helpers/config_loader.hpp" // `config_loader_t`
+#include "helpers/slab_allocator.hpp" // `slab_allocator_t`
+#include "helpers/collections_epoch.hpp" // `collections_epoch_bump_t`
+#include "helpers/collection_companions.hpp" // `drop_companions`
 #include "ustore/cpp/ranges_args.hpp"   // `places_arg_t`
 
 /*********************************************************/
@@ -49,7 +64,7 @@ ustore_length_t const ustore_length_missing_k = std::numeric_limits<ustore_lengt
 ustore_key_t const ustore_key_unknown_k = std::numeric_limits<ustore_key_t>::max();
 bool const ustore_supports_transactions_k = true;
 bool const ustore_supports_named_collections_k = true;
-bool const ustore_supports_snapshots_k = false;
+bool const ustore_supports_snapshots_k = true;
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -62,17 +77,66 @@ using namespace unum;
 namespace stdfs = std::filesystem;
 using json_t = nlohmann::json;
 
-using blob_allocator_t = std::allocator<byte_t>;
+/**
+ * @brief Slabs for the values of all pairs in the process.
+ * Never destroyed, as static databases may outlive it otherwise.
+ */
+slab_allocator_t& blob_slabs() noexcept {
+    static slab_allocator_t* slabs = new slab_allocator_t();
+    return *slabs;
+}
+
+/**
+ * @brief Stateless handle to the `blob_slabs()`, so small values don't fragment the heap.
+ */
+struct blob_allocator_t {
+    using value_type = byte_t;
+    byte_t* allocate(std::size_t n) noexcept { return static_cast<byte_t*>(blob_slabs().allocate(n)); }
+    void deallocate(byte_t* ptr, std::size_t n) noexcept { blob_slabs().deallocate(ptr, n); }
+};
 
 struct ucset_options_t {
     bool encryption = false;
     bool compression = false;
+    /**
+     * @brief Bytes of values to keep in memory, evicting the colder ones to a spill file beyond it.
+     * Values of all the databases in the process share the same slabs, so they are counted together.
+     * Zero means no limit.
+     */
     size_t memory_limit = 0;
+
+    /** @brief Logs every write, so that persistence doesn't depend on a clean shutdown. */
+    bool write_ahead_log = true;
+    /**
+     * @brief Path of an image, exported by the "export_image" control, to memory-map on start.
+     * The persisted directory then only keeps the changes, made on top of it.
+     */
+    std::string image_path;
+
+    /** @brief Period of background checkpoints, that persist the changed collections. */
+    size_t checkpoint_interval_seconds = 60;
+    /** @brief Size of the log, that triggers a checkpoint before the period expires. */
+    size_t checkpoint_log_size = 64ul * 1024ul * 1024ul;
+    /**
+     * @brief Time, a leader of concurrent durable commits may wait for more of them to join its `fsync`.
+     * A lonely committer never waits. Zero means syncing immediately.
+     */
+    size_t group_commit_wait_microseconds = 0;
 };
 
 struct pair_t {
+    /** @brief Set for values evicted to the spill file, when the `range` holds the file offset instead of the address. */
+    static constexpr std::uint8_t spilled_k = 1;
+    /** @brief Set by every read and cleared by eviction sweeps, so that the hot values stay in memory. */
+    static constexpr std::uint8_t referenced_k = 2;
+    /** @brief Set for values, allocated by the caller with `std::malloc`, rather than `blob_slabs()`. */
+    static constexpr std::uint8_t adopted_k = 4;
+    /** @brief Set for temporary pairs, that view the values of the memory-mapped image. */
+    static constexpr std::uint8_t mapped_k = 8;
+
     collection_key_t collection_key;
     value_view_t range;
+    mutable std::atomic<std::uint8_t> flags {0};
 
     pair_t() = default;
     pair_t(pair_t const&) = delete;
@@ -92,23 +156,78 @@ struct pair_t {
             range = other;
     }
 
+    /** @brief Takes ownership of a value, allocated by the caller with `std::malloc`. */
+    static pair_t adopt(collection_key_t collection_key, value_view_t owned) noexcept {
+        pair_t pair {collection_key};
+        pair.range = owned;
+        if (owned.size()) {
+            blob_slabs().adopt(owned.size());
+            pair.flags.store(adopted_k, std::memory_order_relaxed);
+        }
+        return pair;
+    }
+
+    /** @brief Views a value of the memory-mapped image, without owning it. */
+    static pair_t map(collection_key_t collection_key, value_view_t mapped) noexcept {
+        pair_t pair {collection_key};
+        pair.range = mapped;
+        pair.flags.store(mapped_k, std::memory_order_relaxed);
+        return pair;
+    }
+
     ~pair_t() noexcept {
-        if (range.size())
-            blob_allocator_t {}.deallocate((byte_t*)range.data(), range.size());
+        release_value();
         range = {};
     }
 
     pair_t(pair_t&& other) noexcept
-        : collection_key(other.collection_key), range(std::exchange(other.range, value_view_t {})) {}
+        : collection_key(other.collection_key), range(std::exchange(other.range, value_view_t {})),
+          flags(other.flags.exchange(0, std::memory_order_relaxed)) {}
 
     pair_t& operator=(pair_t&& other) noexcept {
         std::swap(collection_key, other.collection_key);
         std::swap(range, other.range);
+        flags.store(other.flags.exchange(flags.load(std::memory_order_relaxed), std::memory_order_relaxed),
+                    std::memory_order_relaxed);
         return *this;
     }
 
     operator collection_key_t() const noexcept { return collection_key; }
     explicit operator bool() const noexcept { return range; }
+
+    bool is_spilled() const noexcept { return flags.load(std::memory_order_relaxed) & spilled_k; }
+    std::uint64_t spilled_offset() const noexcept { return reinterpret_cast<std::uintptr_t>(range.data()); }
+
+    void touch() const noexcept {
+        if (!(flags.load(std::memory_order_relaxed) & referenced_k))
+            flags.fetch_or(referenced_k, std::memory_order_relaxed);
+    }
+
+    /** @return true If the pair was referenced since the previous call. */
+    bool untouch() noexcept { return flags.fetch_and(static_cast<std::uint8_t>(~referenced_k), std::memory_order_relaxed) & referenced_k; }
+
+    void release_value() noexcept {
+        if (!range.size() || is_spilled() || (flags.load(std::memory_order_relaxed) & mapped_k))
+            return;
+        if (flags.load(std::memory_order_relaxed) & adopted_k)
+            blob_slabs().deallocate_adopted((byte_t*)range.data(), range.size());
+        else
+            blob_allocator_t {}.deallocate((byte_t*)range.data(), range.size());
+    }
+
+    /** @brief Releases the memory of the value, once it is written to the spill file at `offset`. */
+    void mark_spilled(std::uint64_t offset) noexcept {
+        release_value();
+        range = {reinterpret_cast<byte_t const*>(static_cast<std::uintptr_t>(offset)), range.size()};
+        flags.store(static_cast<std::uint8_t>((flags.load(std::memory_order_relaxed) & referenced_k) | spilled_k),
+                    std::memory_order_relaxed);
+    }
+
+    /** @brief Adopts the memory, where the spilled value was read back into. */
+    void mark_resident(byte_t* begin) noexcept {
+        range = {begin, range.size()};
+        flags.fetch_and(static_cast<std::uint8_t>(~spilled_k), std::memory_order_relaxed);
+    }
 };
 
 struct pair_compare_t {
@@ -122,22 +241,62 @@ struct pair_compare_t {
 /*****************  Using Consistent Sets ****************/
 /*********************************************************/
 
+#if !defined(USTORE_UCSET_PARTITIONS)
+#define USTORE_UCSET_PARTITIONS 64
+#endif
+
+/**
+ * @brief Spreads the keys of every collection across all partitions,
+ * so that concurrent writers into the same collection rarely share a lock.
+ */
+struct collection_key_hash_t {
+    std::size_t operator()(collection_key_t const& collection_key) const noexcept {
+        std::uint64_t hash = static_cast<std::uint64_t>(collection_key.key) * 0x9E3779B97F4A7C15ull;
+        hash ^= static_cast<std::uint64_t>(collection_key.collection) + (hash >> 29);
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
 // using ucset_t = ucset_gt<pair_t, pair_compare_t>;
 // using ucset_t = consistent_avl_gt<pair_t, pair_compare_t>;
-// using ucset_t = partitioned_gt< //
-//     ucset_gt<pair_t, pair_compare_t>,
-//     std::hash<collection_key_t>,
-//     std::shared_mutex,
-//     64>;
-using ucset_t = locked_gt<consistent_set_gt<pair_t, pair_compare_t>, std::shared_mutex>;
+// Contended waits for these locks are reported by the "metrics" control, if compiled with `USTORE_USE_METRICS`
+using pairs_mutex_t = metered_mutex_gt<std::shared_mutex, lock_site_t::ucset_pairs_k>;
+using snapshots_mutex_t = metered_mutex_gt<std::shared_mutex, lock_site_t::ucset_snapshots_k>;
+using log_order_mutex_t = metered_mutex_gt<std::mutex, lock_site_t::ucset_log_order_k>;
+
+#if USTORE_UCSET_PARTITIONED
+// Every partition is locked separately, and ordered lookups, like `upper_bound`,
+// take the smallest of the partitions' results, so scans remain ordered.
+using ucset_t = partitioned_gt< //
+    consistent_set_gt<pair_t, pair_compare_t>,
+    collection_key_hash_t,
+    pairs_mutex_t,
+    USTORE_UCSET_PARTITIONS>;
+#else
+using ucset_t = locked_gt<consistent_set_gt<pair_t, pair_compare_t>, pairs_mutex_t>;
+#endif
 using transaction_t = typename ucset_t::transaction_t;
 using generation_t = typename ucset_t::generation_t;
 
-template <typename set_or_transaction_at, typename callback_at>
+/**
+ * @brief Transaction of the underlying set, that accumulates its writes,
+ * to append them to the write-ahead log on commit.
+ */
+struct logged_transaction_t {
+    transaction_t pairs;
+    std::vector<byte_t> logged;
+    /** @brief Keys of all the writes, which versions must be preserved for snapshots on commit. */
+    std::vector<collection_key_t> written;
+    /** @brief Keys of the writes, that hide the visible pairs of the image, until shadowed on commit. */
+    std::set<collection_key_t> image_writes;
+};
+
+template <typename set_or_transaction_at, typename found_at, typename missing_at>
 ucset::status_t find_and_watch(set_or_transaction_at& set_or_transaction,
                                collection_key_t collection_key,
                                ustore_options_t options,
-                               callback_at&& callback) noexcept {
+                               found_at&& found,
+                               missing_at&& missing) noexcept {
 
     if constexpr (!std::is_same<set_or_transaction_at, ucset_t>()) {
         bool dont_watch = options & ustore_option_transaction_dont_watch_k;
@@ -148,8 +307,11 @@ ucset::status_t find_and_watch(set_or_transaction_at& set_or_transaction,
 
     auto find_status = set_or_transaction.find(
         collection_key,
-        [&](pair_t const& pair) noexcept { callback(pair.range); },
-        [&]() noexcept { callback(value_view_t {}); });
+        [&](pair_t const& pair) noexcept {
+            pair.touch();
+            found(pair);
+        },
+        [&]() noexcept { missing(); });
     return find_status;
 }
 
@@ -226,6 +388,762 @@ ucset::status_t scan_full(set_or_transaction_at& set_or_transaction, callback_at
     return {};
 }
 
+/*********************************************************/
+/*****************	  Write-Ahead Log	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Kinds of records in the write-ahead log.
+ * IDs of collections are assigned anew on every start, so every log file
+ * starts with creation records for all the collections present at that point.
+ */
+enum class wal_record_t : std::uint32_t {
+    pairs_k = 1,
+    collection_created_k = 2,
+    collection_dropped_k = 3,
+    ranges_erased_k = 4,
+};
+
+constexpr std::uint32_t wal_magic_k = 0x4C415755; // "UWAL"
+constexpr std::string_view wal_prefix_k = ".wal.";
+constexpr std::size_t wal_pair_overhead_k = sizeof(ustore_collection_t) + sizeof(ustore_key_t) + sizeof(ustore_length_t);
+
+struct wal_header_t {
+    std::uint32_t magic;
+    wal_record_t kind;
+    std::uint64_t length;
+    std::uint64_t checksum;
+};
+
+/**
+ * @brief FNV-1a hash of a record body, to detect the torn tail of the log after a crash.
+ */
+std::uint64_t wal_checksum(byte_t const* body, std::size_t length) noexcept {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i != length; ++i)
+        hash = (hash ^ static_cast<std::uint8_t>(body[i])) * 1099511628211ull;
+    return hash;
+}
+
+std::size_t wal_pair_size(value_view_t value) noexcept {
+    return wal_pair_overhead_k + value.size();
+}
+
+/**
+ * @brief Serializes a pair into the body of `wal_record_t::pairs_k` record.
+ * Missing values mark removals.
+ */
+byte_t* dump_wal_pair(collection_key_t collection_key, value_view_t value, byte_t* output) noexcept {
+    ustore_length_t length = value ? static_cast<ustore_length_t>(value.size()) : ustore_length_missing_k;
+    std::memcpy(output, &collection_key.collection, sizeof(ustore_collection_t));
+    std::memcpy(output + sizeof(ustore_collection_t), &collection_key.key, sizeof(ustore_key_t));
+    std::memcpy(output + sizeof(ustore_collection_t) + sizeof(ustore_key_t), &length, sizeof(ustore_length_t));
+    if (value.size())
+        std::memcpy(output + wal_pair_overhead_k, value.begin(), value.size());
+    return output + wal_pair_overhead_k + value.size();
+}
+
+/**
+ * @brief Passes every pair of a `wal_record_t::pairs_k` record body to `callback(collection_key, value)`.
+ * @return false If the body is corrupted.
+ */
+template <typename callback_at>
+bool for_each_wal_pair(value_view_t body, callback_at&& callback) noexcept {
+    byte_t const* it = body.begin();
+    byte_t const* end = body.end();
+    while (it != end) {
+        if (static_cast<std::size_t>(end - it) < wal_pair_overhead_k)
+            return false;
+        collection_key_t collection_key;
+        ustore_length_t length = 0;
+        std::memcpy(&collection_key.collection, it, sizeof(ustore_collection_t));
+        std::memcpy(&collection_key.key, it + sizeof(ustore_collection_t), sizeof(ustore_key_t));
+        std::memcpy(&length, it + sizeof(ustore_collection_t) + sizeof(ustore_key_t), sizeof(ustore_length_t));
+        it += wal_pair_overhead_k;
+        if (length == ustore_length_missing_k) {
+            callback(collection_key, value_view_t {});
+            continue;
+        }
+        if (static_cast<std::size_t>(end - it) < length)
+            return false;
+        callback(collection_key, length ? value_view_t {it, length} : value_view_t::make_empty());
+        it += length;
+    }
+    return true;
+}
+
+/**
+ * @brief Append-only log of the changes, made since the last checkpoint.
+ *
+ * Writers apply their changes in memory and append them to the log under the `order()` lock,
+ * so that the log replays them in the same order. The slow part - writing and syncing the file -
+ * happens outside of it: the first waiting writer becomes the leader and writes the records of
+ * all the others at once, so that concurrent commits share a single `fsync`.
+ */
+class write_ahead_log_t {
+    std::string directory_;
+    log_order_mutex_t order_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable written_;
+    file_handle_t file_;
+    std::size_t file_number_ = 0;
+    std::size_t file_size_ = 0;
+    std::vector<byte_t> pending_;
+    std::uint64_t appended_ = 0;
+    std::uint64_t flushed_ = 0;
+    std::uint64_t synced_ = 0;
+    std::uint64_t sync_wanted_ = 0;
+    std::size_t committers_ = 0;
+    bool writing_ = false;
+    bool failed_ = false;
+
+    std::condition_variable group_delay_;
+    std::chrono::microseconds group_wait_ {0};
+
+    /** @brief Collections changed since the last checkpoint and names of the dropped ones, guarded by `order()`. */
+    std::unordered_set<ustore_collection_t> dirty_;
+    std::unordered_set<std::string> dropped_;
+
+    std::mutex checkpoints_mutex_;
+    std::condition_variable checkpoints_wakeup_;
+    std::thread checkpoints_;
+    std::size_t checkpoint_log_size_ = 0;
+    bool stopping_ = false;
+
+    std::string file_path(std::size_t number) const {
+        return stdfs::path(directory_) / (std::string(wal_prefix_k) + std::to_string(number));
+    }
+
+    /** @brief Writes the `pending_` records to the file, expecting the `mutex_` to be locked, but no leader. */
+    void write_pending(std::unique_lock<std::mutex>& lock, bool sync) noexcept {
+        writing_ = true;
+        std::vector<byte_t> records;
+        records.swap(pending_);
+        std::uint64_t last = appended_;
+        sync |= sync_wanted_ > synced_;
+        lock.unlock();
+
+        bool written = std::fwrite(records.data(), 1, records.size(), file_) == records.size();
+        written = written && std::fflush(file_) == 0;
+        if (sync)
+            written = written && ::fsync(::fileno(file_)) == 0;
+
+        lock.lock();
+        failed_ |= !written;
+        flushed_ = last;
+        if (sync)
+            synced_ = last;
+        writing_ = false;
+        // Keep the memory of the largest batch for the following ones
+        if (pending_.empty()) {
+            records.clear();
+            records.swap(pending_);
+        }
+        written_.notify_all();
+    }
+
+  public:
+    ~write_ahead_log_t() noexcept { stop_checkpoints(); }
+
+    /**
+     * @brief Lists the numbers of log files in the `directory`, in the order of their creation.
+     */
+    static std::vector<std::size_t> file_numbers(std::string const& directory) noexcept(false) {
+        std::vector<std::size_t> numbers;
+        for (auto const& dir_entry : stdfs::directory_iterator {directory}) {
+            std::string name = dir_entry.path().filename();
+            if (name.size() <= wal_prefix_k.size() || name.compare(0, wal_prefix_k.size(), wal_prefix_k) != 0)
+                continue;
+            std::size_t number = 0;
+            auto suffix = std::string_view(name).substr(wal_prefix_k.size());
+            auto result = std::from_chars(suffix.data(), suffix.data() + suffix.size(), number);
+            if (result.ec == std::errc() && result.ptr == suffix.data() + suffix.size())
+                numbers.push_back(number);
+        }
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+
+    std::string const& directory() const noexcept { return directory_; }
+    void set_group_wait(std::chrono::microseconds wait) noexcept { group_wait_ = wait; }
+    std::unique_lock<log_order_mutex_t> order() noexcept { return std::unique_lock<log_order_mutex_t>(order_mutex_); }
+
+    /**
+     * @brief Starts a new log file in the `directory`, following the `last_number`.
+     */
+    void open(std::string const& directory, std::size_t last_number, ustore_error_t* c_error) noexcept {
+        directory_ = directory;
+        file_number_ = last_number + 1;
+        auto status = file_.open(file_path(file_number_).c_str(), "ab");
+        return_error_if_m(status, c_error, error_unknown_k, "Couldn't open the write-ahead log");
+        file_size_ = 0;
+    }
+
+    /**
+     * @brief Appends a record, expecting the `order()` lock to be held by the caller.
+     * @return The ticket to wait for with `commit()`.
+     */
+    std::uint64_t append(wal_record_t kind, value_view_t body, ustore_error_t* c_error) noexcept {
+        wal_header_t header;
+        header.magic = wal_magic_k;
+        header.kind = kind;
+        header.length = body.size();
+        header.checksum = wal_checksum(body.begin(), body.size());
+        if (kind == wal_record_t::pairs_k)
+            for_each_wal_pair(body, [&](collection_key_t collection_key, value_view_t) {
+                dirty_.insert(collection_key.collection);
+            });
+
+        std::unique_lock lock(mutex_);
+        safe_section("Appending to the write-ahead log", c_error, [&] {
+            auto header_bytes = reinterpret_cast<byte_t const*>(&header);
+            pending_.insert(pending_.end(), header_bytes, header_bytes + sizeof(header));
+            pending_.insert(pending_.end(), body.begin(), body.end());
+        });
+        if (*c_error)
+            return 0;
+        file_size_ += sizeof(header) + body.size();
+        if (checkpoint_log_size_ && file_size_ >= checkpoint_log_size_)
+            checkpoints_wakeup_.notify_one();
+        return ++appended_;
+    }
+
+    void mark_dirty(ustore_collection_t collection) noexcept(false) { dirty_.insert(collection); }
+    void mark_dropped(std::string const& name) noexcept(false) { dropped_.insert(name); }
+
+    /**
+     * @brief Waits until the record with the `ticket` is written to the file,
+     * and synced to the disk, if `sync` is requested.
+     * Whichever writer finds no leader, becomes one, writing the records of all others.
+     * A leader, that has to sync, while others are committing, waits up to `set_group_wait()`
+     * for more records to share that sync.
+     */
+    void commit(std::uint64_t ticket, bool sync, ustore_error_t* c_error) noexcept {
+        std::unique_lock lock(mutex_);
+        if (sync)
+            sync_wanted_ = std::max(sync_wanted_, ticket);
+        ++committers_;
+        while (flushed_ < ticket || (sync && synced_ < ticket)) {
+            if (writing_) {
+                written_.wait(lock);
+                continue;
+            }
+            if (sync && group_wait_.count() && committers_ > 1) {
+                writing_ = true;
+                group_delay_.wait_for(lock, group_wait_);
+                writing_ = false;
+            }
+            write_pending(lock, sync);
+        }
+        --committers_;
+        return_error_if_m(!failed_, c_error, error_unknown_k, "Failed to write to the write-ahead log");
+    }
+
+    /**
+     * @brief Switches the writes to a new log file, that starts with the `created` collections,
+     * exporting the changes and the number of the finished file. Expects the `order()` lock to be held.
+     */
+    template <typename created_at>
+    void rotate(created_at&& created,
+                std::unordered_set<ustore_collection_t>& dirty,
+                std::unordered_set<std::string>& dropped,
+                std::size_t& finished_number,
+                ustore_error_t* c_error) noexcept {
+        std::unique_lock lock(mutex_);
+        while (writing_)
+            written_.wait(lock);
+        write_pending(lock, true);
+        return_error_if_m(!failed_, c_error, error_unknown_k, "Failed to write to the write-ahead log");
+        lock.unlock();
+
+        finished_number = file_number_;
+        auto status = file_.close();
+        return_error_if_m(status, c_error, error_unknown_k, "Couldn't close the write-ahead log");
+        open(directory_, finished_number, c_error);
+        return_if_error_m(c_error);
+        created(c_error);
+        return_if_error_m(c_error);
+
+        dirty.swap(dirty_);
+        dropped.swap(dropped_);
+        dirty_.clear();
+        dropped_.clear();
+    }
+
+    /**
+     * @brief Removes all the log files up to the `last_number`, once their changes are checkpointed.
+     */
+    void remove_files(std::size_t last_number) noexcept(false) {
+        for (std::size_t number : file_numbers(directory_))
+            if (number <= last_number)
+                stdfs::remove(file_path(number));
+    }
+
+    /**
+     * @brief Runs `checkpoint()` in a background thread every `interval_seconds`,
+     * or sooner, if the current log file grows beyond the `log_size`.
+     */
+    template <typename checkpoint_at>
+    void start_checkpoints(std::size_t interval_seconds, std::size_t log_size, checkpoint_at&& checkpoint) {
+        checkpoint_log_size_ = log_size;
+        checkpoints_ = std::thread([this, interval_seconds, checkpoint]() noexcept {
+            std::unique_lock lock(checkpoints_mutex_);
+            while (!stopping_) {
+                if (interval_seconds)
+                    checkpoints_wakeup_.wait_for(lock, std::chrono::seconds(interval_seconds));
+                else
+                    checkpoints_wakeup_.wait(lock);
+                if (stopping_)
+                    break;
+                lock.unlock();
+                checkpoint();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop_checkpoints() noexcept {
+        if (!checkpoints_.joinable())
+            return;
+        {
+            std::unique_lock lock(checkpoints_mutex_);
+            stopping_ = true;
+        }
+        checkpoints_wakeup_.notify_all();
+        checkpoints_.join();
+    }
+};
+
+/*********************************************************/
+/*****************	  Spilling to Disk	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Number of pairs, evicted under a single exclusive lock.
+ */
+constexpr std::size_t spill_batch_k = 256;
+
+/**
+ * @brief Append-only file with the values, evicted from memory to honor the `memory_limit`.
+ * Keys stay in memory, with the `range` of every evicted pair pointing into the file.
+ * Every value in it is also persisted in collections or the write-ahead log,
+ * so the file is recreated on every start and removed on close.
+ */
+class spill_file_t {
+    std::string path_;
+    int descriptor_ = -1;
+    std::atomic<std::uint64_t> size_ {0};
+
+    /** @brief Guards the eviction sweeps, as well as the following members. */
+    std::mutex evicting_mutex_;
+    collection_key_t hand_ {
+        std::numeric_limits<ustore_collection_t>::min(),
+        std::numeric_limits<ustore_key_t>::min(),
+    };
+    std::size_t exhausted_at_ = 0;
+
+  public:
+    ~spill_file_t() noexcept {
+        if (descriptor_ < 0)
+            return;
+        ::close(descriptor_);
+        std::remove(path_.c_str());
+    }
+
+    void open(std::string const& path, ustore_error_t* c_error) noexcept(false) {
+        path_ = path;
+        descriptor_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        return_error_if_m(descriptor_ >= 0, c_error, error_unknown_k, "Couldn't open the spill file");
+    }
+
+    std::uint64_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+    std::mutex& evicting_mutex() noexcept { return evicting_mutex_; }
+
+    /** @brief Position of the eviction sweep, guarded by the `evicting_mutex()`. */
+    collection_key_t& hand() noexcept { return hand_; }
+
+    /**
+     * @brief Memory usage, at which the last sweep failed to reach its target. Sweeps are
+     * postponed until it grows further, as other databases in the process share the same slabs.
+     */
+    std::size_t& exhausted_at() noexcept { return exhausted_at_; }
+
+    /** @brief Moves the value of a resident pair to the end of the file, releasing its memory. */
+    void evict(pair_t& pair, ustore_error_t* c_error) noexcept {
+        std::size_t length = pair.range.size();
+        std::uint64_t offset = size_.fetch_add(length, std::memory_order_relaxed);
+        for (std::size_t written = 0; written != length;) {
+            auto result = ::pwrite(descriptor_, pair.range.begin() + written, length - written, offset + written);
+            return_error_if_m(result > 0, c_error, error_unknown_k, "Failed to spill a value");
+            written += static_cast<std::size_t>(result);
+        }
+        pair.mark_spilled(offset);
+    }
+
+    /** @brief Reads the value of a spilled pair into the `output`, that fits `pair.range.size()` bytes. */
+    void load(pair_t const& pair, byte_t* output, ustore_error_t* c_error) const noexcept {
+        std::size_t length = pair.range.size();
+        std::uint64_t offset = pair.spilled_offset();
+        for (std::size_t read = 0; read != length;) {
+            auto result = ::pread(descriptor_, output + read, length - read, offset + read);
+            return_error_if_m(result > 0, c_error, error_unknown_k, "Failed to read a spilled value");
+            read += static_cast<std::size_t>(result);
+        }
+    }
+
+    /** @brief Brings the value of a spilled pair back into memory. */
+    void restore(pair_t& pair, ustore_error_t* c_error) noexcept {
+        auto begin = blob_allocator_t {}.allocate(pair.range.size());
+        return_error_if_m(begin != nullptr, c_error, out_of_memory_k, "Failed to restore a spilled value");
+        load(pair, begin, c_error);
+        if (*c_error)
+            return blob_allocator_t {}.deallocate(begin, pair.range.size());
+        pair.mark_resident(begin);
+    }
+};
+
+/*********************************************************/
+/*****************	   Immutable Images	  ****************/
+/*********************************************************/
+
+constexpr std::uint64_t image_magic_k = 0x31474d4945524f54ull;
+constexpr std::uint64_t image_shadows_magic_k = 0x3153574441485354ull;
+constexpr std::uint32_t image_version_k = 1;
+constexpr char const* image_shadows_file_k = ".image_shadows";
+
+/**
+ * @brief Starts every image file, followed by the `image_collection_header_t` of every collection
+ * and the tape of their names. Every collection is stored as a heap of values, followed by
+ * the sorted array of its keys and the array of `count + 1` offsets of values in the heap.
+ * All the offsets are in bytes from the start of the file, except for the offsets inside the heap.
+ */
+struct image_header_t {
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t collections_count;
+    /** @brief Random identifier, that ties the databases overlaying this image to it. */
+    std::uint64_t id;
+    std::uint64_t file_size;
+};
+
+struct image_collection_header_t {
+    std::uint64_t name_offset;
+    std::uint64_t name_length;
+    std::uint64_t count;
+    std::uint64_t values_offset;
+    std::uint64_t keys_offset;
+    std::uint64_t offsets_offset;
+};
+
+/**
+ * @brief Collection of the memory-mapped image, that serves the pairs straight from the page cache.
+ * Every key has a bit, that is set once the pair is overwritten or removed in memory,
+ * after which the in-memory set is the only source of truth for that key.
+ */
+struct image_collection_t {
+    std::string name;
+    ustore_collection_t id = ustore_collection_main_k;
+    std::size_t count = 0;
+    ustore_key_t const* keys = nullptr;
+    std::uint64_t const* offsets = nullptr;
+    byte_t const* values = nullptr;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> shadows;
+    /** @brief Position of the collection in the file, that the shadows are persisted in. */
+    std::size_t file_idx = 0;
+    /** @brief Set, if the collection was dropped with its handle. Guarded by the `restructuring_mutex`. */
+    bool dropped = false;
+
+    std::size_t words_count() const noexcept { return divide_round_up<std::size_t>(count, 64); }
+    value_view_t value(std::size_t idx) const noexcept {
+        return {values + offsets[idx], static_cast<std::size_t>(offsets[idx + 1] - offsets[idx])};
+    }
+
+    bool is_shadowed(std::size_t idx) const noexcept {
+        return shadows[idx / 64].load(std::memory_order_acquire) & (1ull << (idx % 64));
+    }
+    void shadow(std::size_t idx) noexcept { shadows[idx / 64].fetch_or(1ull << (idx % 64), std::memory_order_release); }
+
+    /** @brief Shadows the keys with indexes in `[begin, end)`, a word at a time. */
+    void shadow(std::size_t begin, std::size_t end) noexcept {
+        for (; begin != end && begin % 64; ++begin)
+            shadow(begin);
+        for (; end - begin >= 64; begin += 64)
+            shadows[begin / 64].store(~0ull, std::memory_order_release);
+        for (; begin != end; ++begin)
+            shadow(begin);
+    }
+
+    std::size_t lower_bound(ustore_key_t key) const noexcept { return std::lower_bound(keys, keys + count, key) - keys; }
+    std::size_t upper_bound(ustore_key_t key) const noexcept { return std::upper_bound(keys, keys + count, key) - keys; }
+
+    /** @brief Index of the first key, starting from `idx`, that isn't shadowed, or the `count`. */
+    std::size_t next_visible(std::size_t idx) const noexcept {
+        while (idx < count) {
+            std::uint64_t visible = ~shadows[idx / 64].load(std::memory_order_acquire) >> (idx % 64);
+            if (visible)
+                return std::min(count, idx + static_cast<std::size_t>(__builtin_ctzll(visible)));
+            idx = (idx / 64 + 1) * 64;
+        }
+        return count;
+    }
+};
+
+/**
+ * @brief Position of a visible pair in the image.
+ */
+struct image_entry_t {
+    image_collection_t const* collection = nullptr;
+    std::size_t idx = 0;
+
+    explicit operator bool() const noexcept { return collection; }
+    collection_key_t collection_key() const noexcept { return {collection->id, collection->keys[idx]}; }
+    value_view_t value() const noexcept { return collection->value(idx); }
+};
+
+/**
+ * @brief Sorted immutable copy of all the collections, exported by the "export_image" control,
+ * that is memory-mapped on start instead of being deserialized. New writes are applied to the
+ * in-memory set on top of it, and only the bits of the shadowed keys are persisted on checkpoints.
+ */
+class image_t {
+    int descriptor_ = -1;
+    byte_t const* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    std::uint64_t id_ = 0;
+    /** @brief Sorted by IDs, once those are assigned. */
+    std::vector<image_collection_t> collections_;
+
+  public:
+    image_t() = default;
+    image_t(image_t const&) = delete;
+    image_t& operator=(image_t const&) = delete;
+
+    ~image_t() noexcept {
+        if (map_)
+            munmap(const_cast<byte_t*>(map_), map_size_);
+        if (descriptor_ >= 0)
+            ::close(descriptor_);
+    }
+
+    std::size_t file_size() const noexcept { return map_size_; }
+    std::vector<image_collection_t>& collections() noexcept { return collections_; }
+    std::vector<image_collection_t> const& collections() const noexcept { return collections_; }
+
+    void open(std::string const& path, ustore_error_t* c_error) noexcept(false) {
+        descriptor_ = ::open(path.c_str(), O_RDONLY);
+        return_error_if_m(descriptor_ >= 0, c_error, args_wrong_k, "Couldn't open the image");
+        struct stat file_stat;
+        return_error_if_m(fstat(descriptor_, &file_stat) == 0, c_error, error_unknown_k, "Couldn't stat the image");
+        map_size_ = static_cast<std::size_t>(file_stat.st_size);
+        return_error_if_m(map_size_ >= sizeof(image_header_t), c_error, args_wrong_k, "The image is truncated");
+        void* mapped = mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, descriptor_, 0);
+        return_error_if_m(mapped != MAP_FAILED, c_error, error_unknown_k, "Couldn't map the image");
+        map_ = static_cast<byte_t const*>(mapped);
+
+        image_header_t header;
+        std::memcpy(&header, mapped, sizeof(header));
+        return_error_if_m(header.magic == image_magic_k && header.version == image_version_k,
+                          c_error,
+                          args_wrong_k,
+                          "Not an image of a UCSet database");
+        return_error_if_m(header.file_size == map_size_, c_error, args_wrong_k, "The image is truncated");
+        std::uint64_t const headers_end =
+            sizeof(image_header_t) + std::uint64_t(header.collections_count) * sizeof(image_collection_header_t);
+        return_error_if_m(headers_end <= map_size_, c_error, args_wrong_k, "The image is truncated");
+        id_ = header.id;
+
+        auto within = [&](std::uint64_t offset, std::uint64_t length) noexcept {
+            return offset <= map_size_ && length <= map_size_ - offset;
+        };
+        collections_.resize(header.collections_count);
+        for (std::size_t i = 0; i != collections_.size(); ++i) {
+            image_collection_header_t descriptor;
+            std::memcpy(&descriptor,
+                        map_ + sizeof(image_header_t) + i * sizeof(image_collection_header_t),
+                        sizeof(descriptor));
+            bool valid = within(descriptor.name_offset, descriptor.name_length) &&
+                         descriptor.count < map_size_ / sizeof(ustore_key_t) &&
+                         descriptor.keys_offset % alignof(ustore_key_t) == 0 &&
+                         descriptor.offsets_offset % alignof(std::uint64_t) == 0 &&
+                         within(descriptor.keys_offset, descriptor.count * sizeof(ustore_key_t)) &&
+                         within(descriptor.offsets_offset, (descriptor.count + 1) * sizeof(std::uint64_t));
+            return_error_if_m(valid, c_error, args_wrong_k, "The image is corrupted");
+
+            image_collection_t& collection = collections_[i];
+            collection.name.assign(reinterpret_cast<char const*>(map_ + descriptor.name_offset),
+                                   descriptor.name_length);
+            collection.count = descriptor.count;
+            collection.keys = reinterpret_cast<ustore_key_t const*>(map_ + descriptor.keys_offset);
+            collection.offsets = reinterpret_cast<std::uint64_t const*>(map_ + descriptor.offsets_offset);
+            collection.values = map_ + descriptor.values_offset;
+            std::uint64_t values_size = collection.offsets[collection.count];
+            return_error_if_m(within(descriptor.values_offset, values_size),
+                              c_error,
+                              args_wrong_k,
+                              "The image is corrupted");
+            collection.shadows.reset(new std::atomic<std::uint64_t>[collection.words_count()]());
+            collection.file_idx = i;
+        }
+    }
+
+    /** @brief The collections in the order of the file, that doesn't depend on the assigned IDs. */
+    std::vector<image_collection_t*> in_file_order() const noexcept(false) {
+        std::vector<image_collection_t*> ordered(collections_.size());
+        for (auto const& collection : collections_)
+            ordered[collection.file_idx] = const_cast<image_collection_t*>(&collection);
+        return ordered;
+    }
+
+    /** @brief Must be called once the IDs of collections are assigned, and before any lookups. */
+    void sort_collections() noexcept {
+        std::sort(collections_.begin(), collections_.end(), [](auto const& a, auto const& b) noexcept {
+            return a.id < b.id;
+        });
+    }
+
+    image_collection_t* find_collection(ustore_collection_t id) noexcept {
+        auto it = std::lower_bound(collections_.begin(), collections_.end(), id, [](auto const& c, auto id) noexcept {
+            return c.id < id;
+        });
+        return it != collections_.end() && it->id == id ? &*it : nullptr;
+    }
+    image_collection_t const* find_collection(ustore_collection_t id) const noexcept {
+        return const_cast<image_t*>(this)->find_collection(id);
+    }
+
+    /** @brief Finds the pair with the given key, unless it was shadowed. */
+    image_entry_t find(collection_key_t key) const noexcept {
+        image_collection_t const* collection = find_collection(key.collection);
+        if (!collection)
+            return {};
+        std::size_t idx = collection->lower_bound(key.key);
+        if (idx == collection->count || collection->keys[idx] != key.key || collection->is_shadowed(idx))
+            return {};
+        return {collection, idx};
+    }
+
+    /**
+     * @brief Finds the first visible pair, following the given key in any collection,
+     * skipping the ones, for which `hidden(collection_key)` is true.
+     */
+    template <typename hidden_at>
+    image_entry_t upper_bound(collection_key_t key, hidden_at&& hidden) const noexcept {
+        auto it = std::lower_bound(collections_.begin(),
+                                   collections_.end(),
+                                   key.collection,
+                                   [](auto const& c, auto id) noexcept { return c.id < id; });
+        for (; it != collections_.end(); ++it) {
+            std::size_t idx = it->id == key.collection ? it->upper_bound(key.key) : 0;
+            for (idx = it->next_visible(idx); idx != it->count; idx = it->next_visible(idx + 1))
+                if (!hidden(collection_key_t {it->id, it->keys[idx]}))
+                    return {&*it, idx};
+        }
+        return {};
+    }
+
+    /** @brief Passes every visible pair in `[lower, upper)` to `callback(image_entry_t)`. */
+    template <typename callback_at>
+    void for_each(collection_key_t lower, collection_key_t upper, callback_at&& callback) const noexcept(false) {
+        for (auto const& collection : collections_) {
+            if (collection.id < lower.collection || collection.id > upper.collection)
+                continue;
+            std::size_t idx = collection.id == lower.collection ? collection.lower_bound(lower.key) : 0;
+            std::size_t end = collection.id == upper.collection ? collection.lower_bound(upper.key) : collection.count;
+            for (idx = collection.next_visible(idx); idx < end; idx = collection.next_visible(idx + 1))
+                callback(image_entry_t {&collection, idx});
+        }
+    }
+
+    void shadow(collection_key_t key) noexcept {
+        image_collection_t* collection = find_collection(key.collection);
+        if (!collection)
+            return;
+        std::size_t idx = collection->lower_bound(key.key);
+        if (idx != collection->count && collection->keys[idx] == key.key)
+            collection->shadow(idx);
+    }
+
+    void shadow(collection_key_t lower, collection_key_t upper) noexcept {
+        for (auto& collection : collections_) {
+            if (collection.id < lower.collection || collection.id > upper.collection)
+                continue;
+            std::size_t idx = collection.id == lower.collection ? collection.lower_bound(lower.key) : 0;
+            std::size_t end = collection.id == upper.collection ? collection.lower_bound(upper.key) : collection.count;
+            if (idx < end)
+                collection.shadow(idx, end);
+        }
+    }
+
+    /**
+     * @brief Loads the bits of the shadowed keys, persisted by the database overlaying the image.
+     */
+    void load_shadows(std::string const& path, ustore_error_t* c_error) noexcept(false) {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs)
+            return;
+        std::uint64_t head[3];
+        ifs.read(reinterpret_cast<char*>(head), sizeof(head));
+        return_error_if_m(ifs && head[0] == image_shadows_magic_k, c_error, args_wrong_k, "Corrupted image shadows");
+        return_error_if_m(head[1] == id_ && head[2] == collections_.size(),
+                          c_error,
+                          args_wrong_k,
+                          "The directory overlays a different image");
+        std::vector<std::uint64_t> words;
+        for (image_collection_t* collection_ptr : in_file_order()) {
+            image_collection_t& collection = *collection_ptr;
+            std::uint64_t dropped = 0;
+            ifs.read(reinterpret_cast<char*>(&dropped), sizeof(dropped));
+            words.resize(collection.words_count());
+            ifs.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(std::uint64_t));
+            return_error_if_m(ifs, c_error, args_wrong_k, "Corrupted image shadows");
+            collection.dropped = dropped;
+            for (std::size_t i = 0; i != words.size(); ++i)
+                collection.shadows[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Persists the bits of the shadowed keys, replacing the previous file only once complete.
+     * Bits are only ever set, so the ones of the writes, that are still in the log, can be saved too.
+     */
+    void save_shadows(std::string const& path, ustore_error_t* c_error) const noexcept(false) {
+        std::string temporary_path = path + ".tmp";
+        {
+            std::ofstream ofs(temporary_path, std::ios::binary | std::ios::trunc);
+            std::uint64_t head[3] = {image_shadows_magic_k, id_, collections_.size()};
+            ofs.write(reinterpret_cast<char const*>(head), sizeof(head));
+            std::vector<std::uint64_t> words;
+            for (image_collection_t const* collection : in_file_order()) {
+                std::uint64_t dropped = collection->dropped;
+                ofs.write(reinterpret_cast<char const*>(&dropped), sizeof(dropped));
+                words.resize(collection->words_count());
+                for (std::size_t i = 0; i != words.size(); ++i)
+                    words[i] = collection->shadows[i].load(std::memory_order_relaxed);
+                ofs.write(reinterpret_cast<char const*>(words.data()), words.size() * sizeof(std::uint64_t));
+            }
+            return_error_if_m(ofs.flush(), c_error, error_unknown_k, "Couldn't save image shadows");
+        }
+        stdfs::rename(temporary_path, path);
+    }
+};
+
+/*********************************************************/
+/*****************	      Snapshots	      ****************/
+/*********************************************************/
+
+/**
+ * @brief Point-in-time view of the database, that only keeps the versions of pairs overwritten since.
+ * Only the newest snapshot collects the versions, while older ones look into the newer snapshots,
+ * before falling back to the HEAD state. Keys, that were missing, are preserved as pairs without values.
+ */
+struct snapshot_t {
+    ustore_snapshot_t id = 0;
+    /** @brief Guards the `versions` of the newest snapshot, as the older ones don't change. */
+    std::shared_mutex mutex;
+    std::map<collection_key_t, pair_t> versions;
+};
+
 /*********************************************************/
 /***************** Collections Management ****************/
 /*********************************************************/
@@ -273,11 +1191,40 @@ struct database_t {
      */
     std::string persisted_directory;
 
+    ucset_options_t options;
+
+    /**
+     * @brief Log of the changes, that aren't yet checkpointed into `persisted_directory`.
+     * Empty, if the logging is disabled or there is no persisted directory at all.
+     */
+    std::unique_ptr<write_ahead_log_t> log;
+
+    /**
+     * @brief Values, evicted from memory to stay within the `memory_limit`.
+     * Empty, if there is no limit.
+     */
+    std::unique_ptr<spill_file_t> spill;
+
+    /**
+     * @brief Memory-mapped pairs, that lay beneath the `pairs` until overwritten.
+     * Empty, unless the `image_path` is configured.
+     */
+    std::unique_ptr<image_t> image;
+
+    /**
+     * @brief Live snapshots, from the oldest to the newest.
+     * Writers share the lock, while creating and dropping snapshots takes it exclusively.
+     */
+    snapshots_mutex_t snapshots_mutex;
+    std::vector<std::unique_ptr<snapshot_t>> snapshots;
+
     database_t(ucset_t&& set) noexcept(false) : pairs(std::move(set)) {}
 
     database_t(database_t&& other) noexcept
         : pairs(std::move(other.pairs)), names(std::move(other.names)),
-          persisted_directory(std::move(other.persisted_directory)) {}
+          persisted_directory(std::move(other.persisted_directory)), options(other.options),
+          log(std::move(other.log)), spill(std::move(other.spill)), image(std::move(other.image)),
+          snapshots(std::move(other.snapshots)) {}
 };
 
 ustore_collection_t new_collection(database_t& db) noexcept {
@@ -299,10 +1246,501 @@ void export_error_code(ucset::status_t code, ustore_error_t* c_error) noexcept {
         *c_error = "Faced error!";
 }
 
+/**
+ * @brief The first key, following the given one in the order of the set.
+ */
+collection_key_t next_collection_key(collection_key_t collection_key) noexcept {
+    if (collection_key.key != std::numeric_limits<ustore_key_t>::max())
+        return {collection_key.collection, collection_key.key + 1};
+    return {collection_key.collection + 1, std::numeric_limits<ustore_key_t>::min()};
+}
+
+/**
+ * @brief The set or one of its transactions, layered on top of the memory-mapped image, if there is one.
+ * The visible pairs of the image are checked first, as the writers only shadow them once
+ * the new versions are in the set. Writes of the transaction hide the image pairs before the commit.
+ */
+template <typename set_or_transaction_at>
+class layered_gt {
+    set_or_transaction_at& pairs_;
+    image_t const* image_ = nullptr;
+    std::set<collection_key_t> const* hidden_ = nullptr;
+
+    bool is_hidden(collection_key_t key) const noexcept { return hidden_ && hidden_->count(key); }
+
+  public:
+    layered_gt(set_or_transaction_at& pairs, image_t const* image, std::set<collection_key_t> const* hidden) noexcept
+        : pairs_(pairs), image_(image), hidden_(hidden && !hidden->empty() ? hidden : nullptr) {}
+
+    ucset::status_t watch(collection_key_t key) noexcept {
+        if constexpr (std::is_same<set_or_transaction_at, ucset_t>())
+            return {};
+        else
+            return pairs_.watch(key);
+    }
+
+    template <typename found_at, typename missing_at = no_op_t>
+    ucset::status_t find(collection_key_t key, found_at&& found, missing_at&& missing = {}) noexcept {
+        if (image_ && !is_hidden(key))
+            if (image_entry_t entry = image_->find(key); entry) {
+                found(pair_t::map(key, entry.value()));
+                return {};
+            }
+        return pairs_.find(key, found, missing);
+    }
+
+    template <typename found_at, typename missing_at = no_op_t>
+    ucset::status_t upper_bound(collection_key_t key, found_at&& found, missing_at&& missing = {}) noexcept {
+        if (!image_)
+            return pairs_.upper_bound(key, found, missing);
+
+        // Keys, that are both in the set and the image, are about to be shadowed
+        image_entry_t mapped = image_->upper_bound(key, [&](collection_key_t key) noexcept { return is_hidden(key); });
+        bool passed = false;
+        auto status = pairs_.upper_bound(
+            key,
+            [&](pair_t const& pair) noexcept {
+                if (mapped && mapped.collection_key() < pair.collection_key)
+                    return;
+                passed = true;
+                found(pair);
+            },
+            []() noexcept {});
+        if (!status || passed)
+            return status;
+        if (mapped)
+            found(pair_t::map(mapped.collection_key(), mapped.value()));
+        else
+            missing();
+        return {};
+    }
+};
+
+layered_gt<ucset_t> layered(database_t& db) noexcept {
+    return {db.pairs, db.image.get(), nullptr};
+}
+
+layered_gt<transaction_t> layered(database_t& db, logged_transaction_t& txn) noexcept {
+    return {txn.pairs, db.image.get(), &txn.image_writes};
+}
+
+/**
+ * @brief Evicts the values, that weren't read since the previous sweep, to the spill file,
+ * until the memory usage drops below the `memory_limit`, with some headroom to amortize the sweeps.
+ * Works like the CLOCK algorithm, with the hand moving in the order of keys, and only locks
+ * the pairs exclusively in small batches. One thread sweeps at a time, while others keep going.
+ */
+void spill_cold_values(database_t& db, ustore_error_t* c_error) noexcept {
+
+    std::size_t const limit = db.options.memory_limit;
+    if (!db.spill || blob_slabs().requested_bytes() <= limit)
+        return;
+    std::unique_lock<std::mutex> lock(db.spill->evicting_mutex(), std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    std::size_t const target = limit - limit / 8;
+    std::size_t& exhausted_at = db.spill->exhausted_at();
+    if (exhausted_at && blob_slabs().requested_bytes() < exhausted_at + limit / 8)
+        return;
+
+    // Two full turns are enough to clear every reference and evict every value
+    collection_key_t& hand = db.spill->hand();
+    std::size_t turns = 0;
+    while (blob_slabs().requested_bytes() > target && turns != 2) {
+
+        // Find the bounds of the next batch, only sharing the lock with readers
+        collection_key_t first = hand;
+        collection_key_t last = hand;
+        std::size_t batch_size = 0;
+        bool reached_end = false;
+        while (batch_size != spill_batch_k && !reached_end) {
+            auto status = db.pairs.upper_bound(
+                last,
+                [&](pair_t const& pair) noexcept {
+                    last = pair.collection_key;
+                    if (!batch_size)
+                        first = last;
+                    ++batch_size;
+                },
+                [&]() noexcept { reached_end = true; });
+            if (!status)
+                return export_error_code(status, c_error);
+        }
+
+        if (batch_size) {
+            auto status = db.pairs.range(first, next_collection_key(last), [&](pair_t& pair) noexcept {
+                if (*c_error || !pair || pair.range.empty() || pair.is_spilled() || pair.untouch())
+                    return;
+                db.spill->evict(pair, c_error);
+            });
+            export_error_code(status, c_error);
+            return_if_error_m(c_error);
+        }
+
+        hand = last;
+        if (reached_end) {
+            hand = collection_key_t {
+                std::numeric_limits<ustore_collection_t>::min(),
+                std::numeric_limits<ustore_key_t>::min(),
+            };
+            ++turns;
+        }
+    }
+    exhausted_at = blob_slabs().requested_bytes() > target ? blob_slabs().requested_bytes() : 0;
+}
+
+ustore_snapshot_t new_snapshot_id(database_t const& db) noexcept {
+    bool is_new = false;
+    ustore_snapshot_t new_id = 0;
+    while (!is_new) {
+        auto top = static_cast<std::uint64_t>(std::rand());
+        auto bottom = static_cast<std::uint64_t>(std::rand());
+        new_id = static_cast<ustore_snapshot_t>((top << 32) | bottom);
+        is_new = new_id != 0;
+        for (auto const& snapshot : db.snapshots)
+            is_new &= new_id != snapshot->id;
+    }
+    return new_id;
+}
+
+/**
+ * @return The index of the snapshot in `db.snapshots`, or its size, if there is no such snapshot.
+ */
+std::size_t find_snapshot(database_t const& db, ustore_snapshot_t id) noexcept {
+    std::size_t snapshot_idx = 0;
+    while (snapshot_idx != db.snapshots.size() && db.snapshots[snapshot_idx]->id != id)
+        ++snapshot_idx;
+    return snapshot_idx;
+}
+
+/**
+ * @brief Copies the pair with its value, reading it from the spill file, if it was evicted.
+ */
+pair_t copy_pair(database_t& db, pair_t const& pair, ustore_error_t* c_error) noexcept {
+    if (!pair.is_spilled())
+        return pair_t {pair.collection_key, pair.range, c_error};
+
+    pair_t copy {pair.collection_key};
+    copy.range = pair.range;
+    copy.flags.store(pair_t::spilled_k, std::memory_order_relaxed);
+    db.spill->restore(copy, c_error);
+    return copy;
+}
+
+/**
+ * @brief Preserves the current versions of `count` keys, exported by `key(i)`, in the newest snapshot,
+ * unless they were already overwritten since it was taken.
+ * Expects the `snapshots_mutex` to be shared, until the new versions are written into the set.
+ */
+template <typename key_at>
+void preserve_versions(database_t& db, std::size_t count, key_at&& key, ustore_error_t* c_error) noexcept {
+
+    if (db.snapshots.empty())
+        return;
+
+    // Most of the time, hot keys would already be preserved
+    snapshot_t& newest = *db.snapshots.back();
+    {
+        std::shared_lock _ {newest.mutex};
+        bool all_preserved = true;
+        for (std::size_t i = 0; i != count && all_preserved; ++i)
+            all_preserved = newest.versions.find(key(i)) != newest.versions.end();
+        if (all_preserved)
+            return;
+    }
+
+    std::unique_lock _ {newest.mutex};
+    for (std::size_t i = 0; i != count; ++i) {
+        collection_key_t collection_key = key(i);
+        if (newest.versions.find(collection_key) != newest.versions.end())
+            continue;
+
+        pair_t version {collection_key};
+        auto status = layered(db).find(
+            collection_key,
+            [&](pair_t const& pair) noexcept { version = copy_pair(db, pair, c_error); },
+            []() noexcept {});
+        if (!status)
+            return export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        safe_section("Preserving a version", c_error, [&] {
+            newest.versions.emplace(collection_key, std::move(version));
+        });
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief The smallest key, that a bound of `preserve_range()` or `ucset_t::range()` stands for.
+ */
+collection_key_t lower_collection_key(ustore_collection_t collection) noexcept {
+    return {collection, std::numeric_limits<ustore_key_t>::min()};
+}
+
+collection_key_t lower_collection_key(collection_key_t collection_key) noexcept {
+    return collection_key;
+}
+
+/**
+ * @brief Preserves the versions of all the pairs in `[lower, upper)` in the newest snapshot, before those are erased.
+ * The bounds are either collection IDs, or `collection_key_t`-s within one collection.
+ * Expects the `snapshots_mutex` to be shared.
+ */
+template <typename bound_at>
+void preserve_range(database_t& db, bound_at lower, bound_at upper, ustore_error_t* c_error) noexcept {
+
+    if (db.snapshots.empty())
+        return;
+
+    snapshot_t& newest = *db.snapshots.back();
+    std::unique_lock _ {newest.mutex};
+    auto status = db.pairs.range(lower, upper, [&](pair_t& pair) noexcept {
+        if (*c_error || newest.versions.find(pair.collection_key) != newest.versions.end())
+            return;
+        pair_t version = copy_pair(db, pair, c_error);
+        return_if_error_m(c_error);
+        safe_section("Preserving a version", c_error, [&] {
+            newest.versions.emplace(pair.collection_key, std::move(version));
+        });
+    });
+    export_error_code(status, c_error);
+    return_if_error_m(c_error);
+    if (!db.image)
+        return;
+
+    db.image->for_each(lower_collection_key(lower), lower_collection_key(upper), [&](image_entry_t entry) {
+        collection_key_t collection_key = entry.collection_key();
+        if (*c_error || newest.versions.find(collection_key) != newest.versions.end())
+            return;
+        pair_t version {collection_key, entry.value(), c_error};
+        return_if_error_m(c_error);
+        safe_section("Preserving a version", c_error, [&] {
+            newest.versions.emplace(collection_key, std::move(version));
+        });
+    });
+}
+
+/**
+ * @brief Finds the version of the pair, visible from the snapshot with the given index.
+ * Expects the `snapshots_mutex` and the `mutex` of the newest snapshot to be shared.
+ * @return NULL, if the pair wasn't overwritten since that snapshot was taken.
+ */
+pair_t const* preserved_version(database_t const& db, std::size_t snapshot_idx, collection_key_t key) noexcept {
+    for (std::size_t idx = snapshot_idx; idx != db.snapshots.size(); ++idx) {
+        auto const& versions = db.snapshots[idx]->versions;
+        if (auto it = versions.find(key); it != versions.end())
+            return &it->second;
+    }
+    return nullptr;
+}
+
+template <typename found_at, typename missing_at>
+ucset::status_t find_in_snapshot(database_t& db,
+                                 std::size_t snapshot_idx,
+                                 collection_key_t collection_key,
+                                 found_at&& found,
+                                 missing_at&& missing) noexcept {
+
+    pair_t const* version = preserved_version(db, snapshot_idx, collection_key);
+    if (!version) {
+        auto head = layered(db);
+        return find_and_watch(head, collection_key, ustore_options_default_k, found, missing);
+    }
+
+    if (*version)
+        found(*version);
+    else
+        missing();
+    return {};
+}
+
+/**
+ * @brief Passes up to `range_limit` keys of the collection, starting from `start`, visible from the snapshot,
+ * into the `callback`. Those are merged from the HEAD state and the versions, preserved since the snapshot.
+ */
+template <typename callback_at>
+ucset::status_t scan_in_snapshot(database_t& db,
+                                 std::size_t snapshot_idx,
+                                 collection_key_t start,
+                                 std::size_t range_limit,
+                                 callback_at&& callback) noexcept {
+
+    auto head = layered(db);
+    collection_key_t previous = start;
+    bool inclusive = true;
+    std::size_t match_idx = 0;
+    while (match_idx != range_limit) {
+        collection_key_t next;
+        bool has_next = false;
+        auto consider = [&](collection_key_t candidate) noexcept {
+            if (candidate.collection != start.collection || (has_next && !(candidate < next)))
+                return;
+            next = candidate;
+            has_next = true;
+        };
+        auto consider_pair = [&](pair_t const& pair) noexcept {
+            consider(pair.collection_key);
+        };
+
+        auto status = inclusive ? head.find(previous, consider_pair, []() noexcept {}) : ucset::status_t {};
+        if (!status)
+            return status;
+        if (!has_next)
+            if (status = head.upper_bound(previous, consider_pair, []() noexcept {}); !status)
+                return status;
+        for (std::size_t idx = snapshot_idx; idx != db.snapshots.size(); ++idx) {
+            auto const& versions = db.snapshots[idx]->versions;
+            auto it = inclusive ? versions.lower_bound(previous) : versions.upper_bound(previous);
+            if (it != versions.end())
+                consider(it->first);
+        }
+        if (!has_next)
+            break;
+
+        // Keys, that were added after the snapshot was taken, are preserved as missing
+        previous = next;
+        inclusive = false;
+        pair_t const* version = preserved_version(db, snapshot_idx, next);
+        if (version && !*version)
+            continue;
+        callback(next);
+        ++match_idx;
+    }
+    return {};
+}
+
+/**
+ * @brief Drops the collection contents and, optionally, its handle, marking the changes for the next checkpoint.
+ * Expects the `restructuring_mutex`, the shared `snapshots_mutex` and the `order()` lock of the log,
+ * if present, to be held.
+ */
+void drop_collection(database_t& db, ustore_collection_t id, ustore_drop_mode_t mode, ustore_error_t* c_error) noexcept(
+    false) {
+
+    preserve_range(db, id, id + 1, c_error);
+    return_if_error_m(c_error);
+
+    if (mode == ustore_drop_keys_vals_handle_k) {
+        auto status = db.pairs.erase_range(id, id + 1, no_op_t {});
+        if (!status)
+            return export_error_code(status, c_error);
+        if (db.image)
+            if (image_collection_t* mapped = db.image->find_collection(id)) {
+                mapped->shadow(0, mapped->count);
+                mapped->dropped = true;
+            }
+
+        for (auto it = db.names.begin(); it != db.names.end(); ++it) {
+            if (id != it->second)
+                continue;
+            if (db.log)
+                db.log->mark_dropped(it->first);
+            db.names.erase(it);
+            break;
+        }
+        return;
+    }
+
+    if (db.log)
+        db.log->mark_dirty(id);
+
+    image_collection_t* mapped = db.image ? db.image->find_collection(id) : nullptr;
+    if (mode == ustore_drop_keys_vals_k) {
+        auto status = db.pairs.erase_range(id, id + 1, no_op_t {});
+        if (mapped)
+            mapped->shadow(0, mapped->count);
+        return export_error_code(status, c_error);
+    }
+
+    else if (mode == ustore_drop_vals_k) {
+        auto status = db.pairs.range(id, id + 1, [&](pair_t& pair) noexcept {
+            pair = pair_t {pair.collection_key, value_view_t::make_empty(), nullptr};
+        });
+        if (!status || !mapped)
+            return export_error_code(status, c_error);
+
+        // The keys of the image have to be copied into the set, to keep them with empty values
+        std::vector<pair_t> emptied;
+        for (std::size_t idx = mapped->next_visible(0); idx != mapped->count; idx = mapped->next_visible(idx + 1))
+            emptied.emplace_back(collection_key_t {id, mapped->keys[idx]}, value_view_t::make_empty(), nullptr);
+        status = db.pairs.upsert(std::make_move_iterator(emptied.begin()), std::make_move_iterator(emptied.end()));
+        if (status)
+            mapped->shadow(0, mapped->count);
+        return export_error_code(status, c_error);
+    }
+}
+
+/**
+ * @brief Erases the keys in `[start, end)` of the collection, marking it for the next checkpoint.
+ * Expects the shared `snapshots_mutex` and the `order()` lock of the log, if present, to be held.
+ */
+void erase_range(database_t& db,
+                 ustore_collection_t id,
+                 ustore_key_t start,
+                 ustore_key_t end,
+                 ustore_error_t* c_error) noexcept(false) {
+
+    if (end <= start)
+        return;
+
+    collection_key_t const lower {id, start};
+    collection_key_t const upper {id, end};
+    preserve_range(db, lower, upper, c_error);
+    return_if_error_m(c_error);
+
+    if (db.log)
+        db.log->mark_dirty(id);
+    auto status = db.pairs.erase_range(lower, upper, no_op_t {});
+    if (status && db.image)
+        db.image->shadow(lower, upper);
+    export_error_code(status, c_error);
+}
+
 /*********************************************************/
 /*****************	 Writing to Disk	  ****************/
 /*********************************************************/
 
+/**
+ * @brief Size of Parquet row groups. Smaller groups let the loading threads split large collections.
+ */
+constexpr std::int64_t row_group_bytes_k = 64 * 1024 * 1024;
+
+/**
+ * @brief Runs `task(task_idx, c_error)` for every index below `tasks_count` in a pool of threads,
+ * exporting the first of the faced errors.
+ */
+template <typename task_at>
+void for_each_in_parallel(std::size_t tasks_count, task_at&& task, ustore_error_t* c_error) noexcept(false) {
+
+    std::size_t threads_count = std::min<std::size_t>(tasks_count, std::thread::hardware_concurrency());
+    if (threads_count <= 1) {
+        for (std::size_t task_idx = 0; task_idx != tasks_count && !*c_error; ++task_idx)
+            safe_section("Persisting collection", c_error, [&] { task(task_idx, c_error); });
+        return;
+    }
+
+    std::atomic<std::size_t> next_task_idx {0};
+    std::atomic<bool> failed {false};
+    std::vector<ustore_error_t> errors(threads_count, nullptr);
+    std::vector<std::thread> threads;
+    threads.reserve(threads_count);
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back([&, thread_idx]() noexcept {
+            ustore_error_t* thread_error = &errors[thread_idx];
+            for (std::size_t task_idx = next_task_idx++; task_idx < tasks_count && !failed; task_idx = next_task_idx++) {
+                safe_section("Persisting collection", thread_error, [&] { task(task_idx, thread_error); });
+                if (*thread_error)
+                    failed = true;
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    for (ustore_error_t error : errors)
+        if (error && !*c_error)
+            *c_error = error;
+}
+
 void write_collection( //
     database_t const& db,
     ustore_collection_t collection_id,
@@ -327,12 +1765,21 @@ void write_collection( //
         parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, columns));
     parquet::WriterProperties::Builder builder;
     parquet::StreamWriter os {parquet::ParquetFileWriter::Open(out_file, schema, builder.build())};
+    os.SetMaxRowGroupSize(row_group_bytes_k);
 
     collection_key_t min(collection_id, std::numeric_limits<ustore_key_t>::min());
     collection_key_t max(collection_id, std::numeric_limits<ustore_key_t>::max());
+    std::vector<byte_t> spilled;
     auto status = db.pairs.range(min, max, [&](pair_t& pair) noexcept {
+        if (*c_error)
+            return;
         std::optional<std::string_view> value;
-        if (pair.range.size())
+        if (pair.is_spilled()) {
+            spilled.resize(pair.range.size());
+            db.spill->load(pair, spilled.data(), c_error);
+            value = std::string_view(reinterpret_cast<char const*>(spilled.data()), spilled.size());
+        }
+        else if (pair.range.size())
             value = std::string_view(pair.range);
         os << pair.collection_key.key << value << parquet::EndRow;
     });
@@ -340,83 +1787,561 @@ void write_collection( //
     return_if_error_m(c_error);
 }
 
-void write(database_t const& db, std::string const& dir_path, ustore_error_t* c_error) noexcept(false) {
-
-    // Check if the source directory even exists
-    if (!std::filesystem::is_directory(dir_path))
-        return;
-
-    auto main_path = stdfs::path(dir_path) / ".parquet";
-    write_collection(db, ustore_collection_main_k, main_path, c_error);
-    return_if_error_m(c_error);
+/**
+ * @brief Named collection with the path of the file, it is persisted in.
+ */
+struct persisted_collection_t {
+    ustore_collection_t id;
+    std::string path;
+};
+
+/**
+ * @brief Writes every collection into its own file, in a separate thread, if there are many.
+ */
+void write_collections(database_t const& db,
+                       std::vector<persisted_collection_t> const& collections,
+                       ustore_error_t* c_error) noexcept(false) {
+    auto write_one = [&](std::size_t collection_idx, ustore_error_t* c_error) {
+        write_collection(db, collections[collection_idx].id, collections[collection_idx].path, c_error);
+    };
+    for_each_in_parallel(collections.size(), write_one, c_error);
+}
+
+void write(database_t const& db, std::string const& dir_path, ustore_error_t* c_error) noexcept(false) {
+
+    // Check if the source directory even exists
+    if (!std::filesystem::is_directory(dir_path))
+        return;
+
+    std::vector<persisted_collection_t> collections;
+    collections.reserve(db.names.size() + 1);
+    collections.push_back({ustore_collection_main_k, stdfs::path(dir_path) / ".parquet"});
+    for (auto const& [collection_name, collection_id] : db.names)
+        collections.push_back({collection_id, stdfs::path(dir_path) / (collection_name + ".parquet")});
+    write_collections(db, collections, c_error);
+    return_if_error_m(c_error);
+    if (db.image)
+        db.image->save_shadows(stdfs::path(dir_path) / image_shadows_file_k, c_error);
+}
+
+bool ends_with(std::string_view str, std::string_view suffix) noexcept {
+    return str.size() >= suffix.size() &&
+           0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix.data(), suffix.size());
+}
+
+/**
+ * @brief Loads one row group of a persisted collection, copying the values straight
+ * from the column buffers, and inserts them in a single batch.
+ */
+void read_row_group(database_t& db,
+                    persisted_collection_t const& collection,
+                    int row_group,
+                    ustore_error_t* c_error) noexcept(false) {
+
+    std::shared_ptr<arrow::io::ReadableFile> in_file;
+    PARQUET_ASSIGN_OR_THROW(in_file, arrow::io::ReadableFile::Open(collection.path));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(in_file, arrow::default_memory_pool(), &reader));
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_THROW_NOT_OK(reader->ReadRowGroup(row_group, &table));
+
+    std::size_t const rows_count = static_cast<std::size_t>(table->num_rows());
+    std::vector<pair_t> pairs(rows_count);
+
+    // Columns may be split into chunks at different offsets, so they are traversed separately
+    std::size_t row_idx = 0;
+    for (auto const& chunk : table->column(0)->chunks()) {
+        auto const& keys = static_cast<arrow::Int64Array const&>(*chunk);
+        for (std::int64_t i = 0; i != keys.length(); ++i, ++row_idx)
+            pairs[row_idx].collection_key = collection_key_t {collection.id, keys.Value(i)};
+    }
+
+    row_idx = 0;
+    for (auto const& chunk : table->column(1)->chunks()) {
+        auto const& values = static_cast<arrow::BinaryArray const&>(*chunk);
+        for (std::int64_t i = 0; i != values.length(); ++i, ++row_idx) {
+            pair_t& pair = pairs[row_idx];
+            if (values.IsNull(i)) {
+                pair.range = value_view_t::make_empty();
+                continue;
+            }
+            pair = pair_t {pair.collection_key, value_view_t {values.GetView(i)}, c_error};
+            return_if_error_m(c_error);
+        }
+    }
+
+    auto status = db.pairs.upsert(std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end()));
+    export_error_code(status, c_error);
+    return_if_error_m(c_error);
+    if (db.image)
+        for (pair_t const& pair : pairs)
+            db.image->shadow(pair.collection_key);
+    spill_cold_values(db, c_error);
+}
+
+/**
+ * @brief Memory-maps the configured image, assigning new IDs to its collections,
+ * and restores the bits of the keys, that were shadowed before the restart.
+ */
+void mount_image(database_t& db, ustore_error_t* c_error) noexcept(false) {
+    auto image = std::make_unique<image_t>();
+    image->open(db.options.image_path, c_error);
+    return_if_error_m(c_error);
+    image->load_shadows(stdfs::path(db.persisted_directory) / image_shadows_file_k, c_error);
+    return_if_error_m(c_error);
+
+    // Dropped collections stay in the image, but all of their keys are shadowed
+    for (image_collection_t& collection : image->collections()) {
+        if (collection.name.empty())
+            continue;
+        collection.id = new_collection(db);
+        if (!collection.dropped)
+            db.names.emplace(collection.name, collection.id);
+    }
+    image->sort_collections();
+    db.image = std::move(image);
+}
+
+/**
+ * @brief Writes the HEAD state of all the collections into an image, that can be memory-mapped on start.
+ * Every collection is walked under the lock of the set, merging it with the visible pairs
+ * of the current image, if there is one. Expects the `restructuring_mutex` to be shared.
+ */
+void export_image(database_t& db, std::string const& path, ustore_error_t* c_error) noexcept(false) {
+
+    struct exported_collection_t {
+        ustore_collection_t id;
+        std::string_view name;
+    };
+    std::vector<exported_collection_t> collections;
+    collections.push_back({ustore_collection_main_k, {}});
+    for (auto const& [collection_name, collection_id] : db.names)
+        collections.push_back({collection_id, collection_name});
+
+    std::vector<image_collection_header_t> descriptors(collections.size());
+    std::uint64_t offset = sizeof(image_header_t) + collections.size() * sizeof(image_collection_header_t);
+    for (std::size_t i = 0; i != collections.size(); ++i) {
+        descriptors[i].name_offset = offset;
+        descriptors[i].name_length = collections[i].name.size();
+        offset += collections[i].name.size();
+    }
+
+    std::string temporary_path = path + ".tmp";
+    file_handle_t handle;
+    ustore::status_t status = handle.open(temporary_path.c_str(), "wb+");
+    return_error_if_m(status, c_error, error_unknown_k, "Couldn't create the image");
+    std::FILE* file = handle;
+    auto write_bytes = [&](void const* bytes, std::size_t length) noexcept {
+        bool written = !length || std::fwrite(bytes, 1, length, file) == length;
+        return_error_if_m(written, c_error, error_unknown_k, "Couldn't write the image");
+        offset += length;
+    };
+    auto align_to_words = [&]() noexcept {
+        std::uint64_t const zeros = 0;
+        write_bytes(&zeros, divide_round_up<std::uint64_t>(offset, sizeof(zeros)) * sizeof(zeros) - offset);
+    };
+    return_error_if_m(std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0,
+                      c_error,
+                      error_unknown_k,
+                      "Couldn't write the image");
+
+    std::vector<ustore_key_t> keys;
+    std::vector<std::uint64_t> offsets;
+    std::vector<byte_t> spilled;
+    for (std::size_t i = 0; i != collections.size(); ++i) {
+        ustore_collection_t collection_id = collections[i].id;
+        image_collection_t const* mapped = db.image ? db.image->find_collection(collection_id) : nullptr;
+        std::size_t mapped_idx = mapped ? mapped->next_visible(0) : 0;
+        keys.clear();
+        offsets.clear();
+        auto write_pair = [&](ustore_key_t key, value_view_t value) noexcept {
+            keys.push_back(key);
+            offsets.push_back(offset - descriptors[i].values_offset);
+            write_bytes(value.data(), value.size());
+        };
+        auto write_mapped_before = [&](ustore_key_t key, bool inclusive) noexcept {
+            for (; mapped_idx != (mapped ? mapped->count : 0) && !*c_error;
+                 mapped_idx = mapped->next_visible(mapped_idx + 1)) {
+                ustore_key_t mapped_key = mapped->keys[mapped_idx];
+                if (mapped_key > key || (mapped_key == key && !inclusive))
+                    break;
+                write_pair(mapped_key, mapped->value(mapped_idx));
+            }
+        };
+
+        descriptors[i].values_offset = offset;
+        auto range_status = db.pairs.range(collection_id, collection_id + 1, [&](pair_t& pair) noexcept {
+            if (*c_error)
+                return;
+            // The versions in the set take precedence over the ones in the image
+            write_mapped_before(pair.collection_key.key, false);
+            if (mapped_idx != (mapped ? mapped->count : 0) && mapped->keys[mapped_idx] == pair.collection_key.key)
+                mapped_idx = mapped->next_visible(mapped_idx + 1);
+            if (!pair || *c_error)
+                return;
+            if (!pair.is_spilled())
+                return write_pair(pair.collection_key.key, pair.range);
+            safe_section("Loading spilled value", c_error, [&] { spilled.resize(pair.range.size()); });
+            return_if_error_m(c_error);
+            db.spill->load(pair, spilled.data(), c_error);
+            return_if_error_m(c_error);
+            write_pair(pair.collection_key.key, value_view_t {spilled.data(), spilled.size()});
+        });
+        export_error_code(range_status, c_error);
+        return_if_error_m(c_error);
+        write_mapped_before(std::numeric_limits<ustore_key_t>::max(), true);
+        return_if_error_m(c_error);
+
+        offsets.push_back(offset - descriptors[i].values_offset);
+        descriptors[i].count = keys.size();
+        align_to_words();
+        descriptors[i].keys_offset = offset;
+        write_bytes(keys.data(), keys.size() * sizeof(ustore_key_t));
+        descriptors[i].offsets_offset = offset;
+        write_bytes(offsets.data(), offsets.size() * sizeof(std::uint64_t));
+        return_if_error_m(c_error);
+    }
+
+    // The headers are written last, once the layout is known
+    image_header_t header;
+    header.magic = image_magic_k;
+    header.version = image_version_k;
+    header.collections_count = static_cast<std::uint32_t>(collections.size());
+    header.id = (static_cast<std::uint64_t>(std::random_device {}()) << 32) | std::random_device {}();
+    header.file_size = offset;
+    return_error_if_m(std::fseek(file, 0, SEEK_SET) == 0, c_error, error_unknown_k, "Couldn't write the image");
+    write_bytes(&header, sizeof(header));
+    write_bytes(descriptors.data(), descriptors.size() * sizeof(image_collection_header_t));
+    for (auto const& collection : collections)
+        write_bytes(collection.name.data(), collection.name.size());
+    return_if_error_m(c_error);
+
+    bool synced = std::fflush(file) == 0 && ::fsync(fileno(file)) == 0;
+    return_error_if_m(synced, c_error, error_unknown_k, "Couldn't flush the image");
+    status = handle.close();
+    return_error_if_m(status, c_error, error_unknown_k, status.message());
+    stdfs::rename(temporary_path, path);
+}
+
+void read(database_t& db, std::string const& path, ustore_error_t* c_error) noexcept(false) {
+
+    // Clear the DB, before refilling it
+    db.names.clear();
+    auto status = db.pairs.clear();
+    export_error_code(status, c_error);
+    return_if_error_m(c_error);
+
+    // Persisted collections are applied on top of the image, if there is one
+    if (!db.options.image_path.empty()) {
+        mount_image(db, c_error);
+        return_if_error_m(c_error);
+    }
+
+    // Check if the source directory even exists
+    if (!std::filesystem::is_directory(path))
+        return;
+
+    // Loop over all persisted collections, assigning new IDs
+    std::vector<persisted_collection_t> collections;
+    std::vector<std::pair<std::size_t, int>> row_groups;
+    std::string_view extension {".parquet"};
+    for (auto const& dir_entry : std::filesystem::directory_iterator {path}) {
+        auto const& collection_path = dir_entry.path();
+        std::string collection_name = collection_path.filename();
+        if (!ends_with(collection_name, extension))
+            continue;
+
+        collection_name.resize(collection_name.size() - extension.size());
+        auto name_it = db.names.find(collection_name);
+        ustore_collection_t collection_id = collection_name.empty() ? ustore_collection_main_k
+                                            : name_it != db.names.end() ? name_it->second
+                                                                        : new_collection(db);
+        if (!collection_name.empty())
+            db.names.emplace(collection_name, collection_id);
+
+        auto metadata = parquet::ParquetFileReader::OpenFile(collection_path)->metadata();
+        for (int row_group = 0; row_group != metadata->num_row_groups(); ++row_group)
+            row_groups.emplace_back(collections.size(), row_group);
+        collections.push_back({collection_id, collection_path});
+    }
+
+    // Row groups of all the collections are loaded concurrently
+    auto read_one = [&](std::size_t task_idx, ustore_error_t* c_error) {
+        auto [collection_idx, row_group] = row_groups[task_idx];
+        read_row_group(db, collections[collection_idx], row_group, c_error);
+    };
+    for_each_in_parallel(row_groups.size(), read_one, c_error);
+}
+
+/*********************************************************/
+/*****************	Recovery & Checkpoints	****************/
+/*********************************************************/
+
+std::uint64_t log_collection_created(database_t& db,
+                                     ustore_collection_t id,
+                                     std::string_view name,
+                                     ustore_error_t* c_error) noexcept {
+    std::vector<byte_t> body;
+    safe_section("Logging new collection", c_error, [&] {
+        body.resize(sizeof(ustore_collection_t) + name.size());
+        std::memcpy(body.data(), &id, sizeof(ustore_collection_t));
+        std::memcpy(body.data() + sizeof(ustore_collection_t), name.data(), name.size());
+    });
+    if (*c_error)
+        return 0;
+    return db.log->append(wal_record_t::collection_created_k, {body.data(), body.size()}, c_error);
+}
+
+std::uint64_t log_collection_dropped(database_t& db,
+                                     ustore_collection_t id,
+                                     ustore_drop_mode_t mode,
+                                     ustore_error_t* c_error) noexcept {
+    std::uint32_t mode_code = static_cast<std::uint32_t>(mode);
+    byte_t body[sizeof(ustore_collection_t) + sizeof(mode_code)];
+    std::memcpy(body, &id, sizeof(ustore_collection_t));
+    std::memcpy(body + sizeof(ustore_collection_t), &mode_code, sizeof(mode_code));
+    return db.log->append(wal_record_t::collection_dropped_k, {body, sizeof(body)}, c_error);
+}
+
+/**
+ * @brief Serializes the `(collection, start, end)` triplets of the erased ranges,
+ * as the body of `wal_record_t::ranges_erased_k` record.
+ */
+std::uint64_t log_ranges_erased(database_t& db,
+                                strided_iterator_gt<ustore_collection_t const> collections,
+                                strided_iterator_gt<ustore_key_t const> start_keys,
+                                strided_iterator_gt<ustore_key_t const> end_keys,
+                                std::size_t count,
+                                ustore_error_t* c_error) noexcept {
+    constexpr std::size_t triplet_size_k = sizeof(ustore_collection_t) + 2 * sizeof(ustore_key_t);
+    std::vector<byte_t> body;
+    safe_section("Logging erased ranges", c_error, [&] { body.resize(count * triplet_size_k); });
+    if (*c_error)
+        return 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        ustore_collection_t collection = collections ? collections[i] : ustore_collection_main_k;
+        byte_t* triplet = body.data() + i * triplet_size_k;
+        std::memcpy(triplet, &collection, sizeof(ustore_collection_t));
+        std::memcpy(triplet + sizeof(ustore_collection_t), &start_keys[i], sizeof(ustore_key_t));
+        std::memcpy(triplet + sizeof(ustore_collection_t) + sizeof(ustore_key_t), &end_keys[i], sizeof(ustore_key_t));
+    }
+    return db.log->append(wal_record_t::ranges_erased_k, {body.data(), body.size()}, c_error);
+}
+
+/**
+ * @brief Starts the current log file with all the named collections,
+ * so that its records can be matched to the names on replay.
+ */
+void log_collections(database_t& db, ustore_error_t* c_error) noexcept {
+    for (auto const& [name, id] : db.names) {
+        log_collection_created(db, id, name, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Replays one log file on top of the state, loaded from the last checkpoint.
+ * @param valid_size The length of the prefix of the file, made of complete records.
+ * @return false If the file ends with a torn or corrupted record.
+ */
+bool replay_log_file(database_t& db,
+                     std::string const& file_path,
+                     std::size_t& valid_size,
+                     ustore_error_t* c_error) noexcept(false) {
+
+    std::ifstream ifs(file_path, std::ios::binary | std::ios::ate);
+    std::vector<byte_t> contents(static_cast<std::size_t>(ifs.tellg()));
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+
+    // Collections are identified by name across restarts, and this file may use different IDs
+    std::unordered_map<ustore_collection_t, ustore_collection_t> ids;
+    ids.emplace(ustore_collection_main_k, ustore_collection_main_k);
+
+    byte_t const* it = contents.data();
+    byte_t const* end = contents.data() + contents.size();
+    for (; it != end; valid_size = static_cast<std::size_t>(it - contents.data())) {
+        wal_header_t header;
+        if (static_cast<std::size_t>(end - it) < sizeof(header))
+            return false;
+        std::memcpy(&header, it, sizeof(header));
+        it += sizeof(header);
+        if (header.magic != wal_magic_k || static_cast<std::size_t>(end - it) < header.length)
+            return false;
+        if (header.checksum != wal_checksum(it, header.length))
+            return false;
+        value_view_t body {it, static_cast<std::size_t>(header.length)};
+        it += header.length;
+
+        switch (header.kind) {
+        case wal_record_t::collection_created_k: {
+            if (body.size() < sizeof(ustore_collection_t))
+                return false;
+            ustore_collection_t logged_id;
+            std::memcpy(&logged_id, body.begin(), sizeof(ustore_collection_t));
+            std::string name {reinterpret_cast<char const*>(body.begin()) + sizeof(ustore_collection_t),
+                              body.size() - sizeof(ustore_collection_t)};
+            auto name_it = db.names.find(name);
+            if (name_it == db.names.end()) {
+                name_it = db.names.emplace(name, new_collection(db)).first;
+                db.log->mark_dirty(name_it->second);
+            }
+            ids[logged_id] = name_it->second;
+            break;
+        }
+        case wal_record_t::collection_dropped_k: {
+            if (body.size() != sizeof(ustore_collection_t) + sizeof(std::uint32_t))
+                return false;
+            ustore_collection_t logged_id;
+            std::uint32_t mode_code;
+            std::memcpy(&logged_id, body.begin(), sizeof(ustore_collection_t));
+            std::memcpy(&mode_code, body.begin() + sizeof(ustore_collection_t), sizeof(mode_code));
+            auto id_it = ids.find(logged_id);
+            if (id_it == ids.end())
+                break;
+            drop_collection(db, id_it->second, static_cast<ustore_drop_mode_t>(mode_code), c_error);
+            if (*c_error)
+                return false;
+            if (mode_code == ustore_drop_keys_vals_handle_k)
+                ids.erase(id_it);
+            break;
+        }
+        case wal_record_t::ranges_erased_k: {
+            constexpr std::size_t triplet_size_k = sizeof(ustore_collection_t) + 2 * sizeof(ustore_key_t);
+            if (body.size() % triplet_size_k)
+                return false;
+            for (byte_t const* triplet = body.begin(); triplet != body.end(); triplet += triplet_size_k) {
+                ustore_collection_t logged_id;
+                ustore_key_t start, end;
+                std::memcpy(&logged_id, triplet, sizeof(ustore_collection_t));
+                std::memcpy(&start, triplet + sizeof(ustore_collection_t), sizeof(ustore_key_t));
+                std::memcpy(&end, triplet + sizeof(ustore_collection_t) + sizeof(ustore_key_t), sizeof(ustore_key_t));
+                auto id_it = ids.find(logged_id);
+                if (id_it == ids.end())
+                    continue;
+                erase_range(db, id_it->second, start, end, c_error);
+                if (*c_error)
+                    return false;
+            }
+            break;
+        }
+        case wal_record_t::pairs_k: {
+            bool valid = for_each_wal_pair(body, [&](collection_key_t collection_key, value_view_t value) {
+                auto id_it = ids.find(collection_key.collection);
+                if (*c_error || id_it == ids.end())
+                    return;
+                collection_key.collection = id_it->second;
+                pair_t pair {collection_key, value, c_error};
+                return_if_error_m(c_error);
+                export_error_code(db.pairs.upsert(std::move(pair)), c_error);
+                if (db.image)
+                    db.image->shadow(collection_key);
+                db.log->mark_dirty(collection_key.collection);
+            });
+            if (*c_error)
+                return false;
+            if (!valid)
+                return false;
+            spill_cold_values(db, c_error);
+            if (*c_error)
+                return false;
+            break;
+        }
+        default: return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Shrinks the log file to its `valid_size` and syncs it, before any later file is started.
+ */
+bool truncate_log_file(std::string const& file_path, std::size_t valid_size) noexcept {
+    int fd = ::open(file_path.c_str(), O_WRONLY);
+    if (fd < 0)
+        return false;
+    bool truncated = ::ftruncate(fd, static_cast<off_t>(valid_size)) == 0 && ::fsync(fd) == 0;
+    ::close(fd);
+    return truncated;
+}
 
-    for (auto const& collection : db.names) {
-        auto const& collection_name = collection.first;
-        auto const collection_path = stdfs::path(dir_path) / (collection_name + ".parquet");
-        write_collection(db, collection.second, collection_path, c_error);
+/**
+ * @brief Replays all the log files in the `persisted_directory`, left since the last checkpoint,
+ * and starts a new one. Old files are removed with the first checkpoint.
+ */
+void open_log(database_t& db, ustore_error_t* c_error) noexcept(false) {
+    db.log = std::make_unique<write_ahead_log_t>();
+    std::vector<std::size_t> numbers = write_ahead_log_t::file_numbers(db.persisted_directory);
+    for (std::size_t number : numbers) {
+        auto file_path = stdfs::path(db.persisted_directory) / (std::string(wal_prefix_k) + std::to_string(number));
+        std::size_t valid_size = 0;
+        bool complete = replay_log_file(db, file_path, valid_size, c_error);
         return_if_error_m(c_error);
+        if (complete)
+            continue;
+
+        // Only the newest file can be torn by a crash, and the following writes go into a new one,
+        // so the torn tail must be cut off before that, or the next replay would stop at it again
+        return_error_if_m(number == numbers.back(), c_error, error_unknown_k, "Write-ahead log is corrupted");
+        return_error_if_m(truncate_log_file(file_path, valid_size),
+                          c_error,
+                          error_unknown_k,
+                          "Couldn't cut the torn tail of the write-ahead log");
     }
-}
 
-bool ends_with(std::string_view str, std::string_view suffix) noexcept {
-    return str.size() >= suffix.size() &&
-           0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix.data(), suffix.size());
+    db.log->open(db.persisted_directory, numbers.empty() ? 0 : numbers.back(), c_error);
+    return_if_error_m(c_error);
+    log_collections(db, c_error);
 }
 
-void read(database_t& db, std::string const& path, ustore_error_t* c_error) noexcept(false) {
-
-    // Clear the DB, before refilling it
-    db.names.clear();
-    auto status = db.pairs.clear();
-    export_error_code(status, c_error);
-    return_if_error_m(c_error);
+/**
+ * @brief Persists the collections, changed since the previous checkpoint, and removes the logs, covering them.
+ * Writers are only blocked while the log is switched to a new file, as the older files can't
+ * be removed before the collections are fully written.
+ */
+void checkpoint(database_t& db, ustore_error_t* c_error) noexcept(false) {
 
-    // Check if the source directory even exists
-    if (!std::filesystem::is_directory(path))
-        return;
+    // Restructuring is blocked for the whole checkpoint, so that the names of collections stay valid
+    std::shared_lock _ {db.restructuring_mutex};
+    std::unordered_set<ustore_collection_t> dirty;
+    std::unordered_set<std::string> dropped;
+    std::size_t finished_number = 0;
+    {
+        auto order = db.log->order();
+        auto log_names = [&](ustore_error_t* c_error) noexcept {
+            log_collections(db, c_error);
+        };
+        db.log->rotate(log_names, dirty, dropped, finished_number, c_error);
+        return_if_error_m(c_error);
+    }
 
-    // Loop over all persisted collections, reading them one by one
-    std::string_view extension {".parquet"};
-    for (auto const& dir_entry : std::filesystem::directory_iterator {path}) {
-        auto const& collection_path = dir_entry.path();
-        std::string collection_name = collection_path.filename();
-        if (!ends_with(collection_name, extension))
-            continue;
+    for (std::string const& name : dropped)
+        if (db.names.find(name) == db.names.end())
+            stdfs::remove(stdfs::path(db.persisted_directory) / (name + ".parquet"));
 
-        collection_name.resize(collection_name.size() - extension.size());
-        ustore_collection_t collection_id = collection_name.empty() ? ustore_collection_main_k : new_collection(db);
-        if (!collection_name.empty())
-            db.names.emplace(collection_name, collection_id);
+    // Collections are written into temporary files, replacing the old ones only once complete
+    std::vector<persisted_collection_t> collections;
+    std::vector<std::string> final_paths;
+    auto add_changed = [&](std::string const& name, ustore_collection_t id) {
+        if (!dirty.count(id))
+            return;
+        auto collection_path = stdfs::path(db.persisted_directory) / (name + ".parquet");
+        collections.push_back({id, collection_path.string() + ".tmp"});
+        final_paths.push_back(collection_path);
+    };
+    add_changed("", ustore_collection_main_k);
+    for (auto const& [name, id] : db.names)
+        add_changed(name, id);
 
-        std::shared_ptr<arrow::io::ReadableFile> in_file;
-        PARQUET_ASSIGN_OR_THROW(in_file, arrow::io::ReadableFile::Open(collection_path));
-        parquet::StreamReader os {parquet::ParquetFileReader::Open(in_file)};
-
-        ustore_key_t key;
-        std::optional<std::string> value;
-        while (!os.eof()) {
-            os >> key >> value >> parquet::EndRow;
-
-            pair_t pair;
-            pair.collection_key.collection = collection_id;
-            pair.collection_key.key = key;
-
-            // Converting to our internal representation would require a copy
-            if (value) {
-                auto buf_len = value->size();
-                auto buf_ptr = blob_allocator_t {}.allocate(buf_len);
-                return_error_if_m(buf_ptr != nullptr, c_error, out_of_memory_k, "Failed to allocate a blob");
-                pair.range = value_view_t {buf_ptr, buf_len};
-                std::memcpy(buf_ptr, value->data(), value->size());
-            }
-            else
-                pair.range = value_view_t::make_empty();
+    write_collections(db, collections, c_error);
+    return_if_error_m(c_error);
+    for (std::size_t i = 0; i != collections.size(); ++i)
+        stdfs::rename(collections[i].path, final_paths[i]);
+    if (db.image)
+        db.image->save_shadows(stdfs::path(db.persisted_directory) / image_shadows_file_k, c_error);
+    return_if_error_m(c_error);
 
-            auto status = db.pairs.upsert(std::move(pair));
-            export_error_code(status, c_error);
-            return_if_error_m(c_error);
-        }
-    }
+    db.log->remove_files(finished_number);
 }
 
 /*********************************************************/
@@ -426,6 +2351,7 @@ void read(database_t& db, std::string const& path, ustore_error_t* c_error) noex
 void ustore_database_init(ustore_database_init_t* c_ptr) {
 
     ustore_database_init_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     safe_section("Initializing DBMS", c.error, [&] {
         auto maybe_pairs = ucset_t::make();
         return_error_if_m(maybe_pairs, c.error, error_unknown_k, "Couldn't build consistent set");
@@ -451,15 +2377,25 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
 
             // Engine config
             return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
-            return_error_if_m(config.engine.config.empty(), c.error, args_wrong_k, "Doesn't support nested configs");
 
             auto fill_options = [](json_t const& js, ucset_options_t& options) {
                 if (js.contains("encryption"))
                     options.encryption = js["encryption"];
                 if (js.contains("compression"))
                     options.compression = js["compression"];
-                if (js.contains("memory_limit"))
-                    options.memory_limit = js["memory_limit"];
+                if (!config_loader_t::parse_volume(js, "memory_limit", options.memory_limit))
+                    return false;
+                if (js.contains("write_ahead_log"))
+                    options.write_ahead_log = js["write_ahead_log"];
+                if (js.contains("checkpoint_interval_seconds"))
+                    options.checkpoint_interval_seconds = js["checkpoint_interval_seconds"];
+                if (js.contains("checkpoint_log_size"))
+                    options.checkpoint_log_size = js["checkpoint_log_size"];
+                if (js.contains("group_commit_wait_microseconds"))
+                    options.group_commit_wait_microseconds = js["group_commit_wait_microseconds"];
+                if (js.contains("image"))
+                    options.image_path = js["image"].get<std::string>();
+                return true;
             };
 
             // Load from file
@@ -468,37 +2404,102 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
                 std::ifstream ifs(config.engine.config_file_path);
                 return_error_if_m(ifs, c.error, args_wrong_k, "Config file not found");
                 auto js = json_t::parse(ifs);
-                fill_options(js, options);
+                return_error_if_m(fill_options(js, options), c.error, args_wrong_k, "Invalid memory limit");
             }
             // Override with nested
             if (!config.engine.config.empty())
-                fill_options(config.engine.config, options);
+                return_error_if_m(fill_options(config.engine.config, options),
+                                  c.error,
+                                  args_wrong_k,
+                                  "Invalid memory limit");
 
             db_ptr->persisted_directory = root;
+            db_ptr->options = options;
+            if (options.memory_limit) {
+                db_ptr->spill = std::make_unique<spill_file_t>();
+                db_ptr->spill->open(root / ".spill", c.error);
+                return_if_error_m(c.error);
+            }
             read(*db_ptr, db_ptr->persisted_directory, c.error);
+            return_if_error_m(c.error);
+
+            if (options.write_ahead_log) {
+                open_log(*db_ptr, c.error);
+                return_if_error_m(c.error);
+                db_ptr->log->set_group_wait(std::chrono::microseconds(options.group_commit_wait_microseconds));
+                db_ptr->log->start_checkpoints( //
+                    options.checkpoint_interval_seconds,
+                    options.checkpoint_log_size,
+                    [db_ptr]() noexcept {
+                        ustore_error_t c_error = nullptr;
+                        safe_section("Checkpointing", &c_error, [&] { checkpoint(*db_ptr, &c_error); });
+                    });
+            }
         }
         *c.db = db_ptr;
     });
 }
 
 void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
+
     ustore_snapshot_list_t& c = *c_ptr;
-    *c.count = 0;
-    if (c.ids)
-        *c.ids = nullptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count, c.error, args_combo_k, "Need outputs!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::shared_lock _ {db.snapshots_mutex};
+    std::size_t snapshots_count = db.snapshots.size();
+    *c.count = static_cast<ustore_size_t>(snapshots_count);
+
+    auto ids = arena.alloc_or_dummy(snapshots_count, c.error, c.ids);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != snapshots_count; ++i)
+        ids[i] = db.snapshots[i]->id;
 }
 
-void ustore_snapshot_create(ustore_snapshot_create_t*) {
-    // TODO
+void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
+
+    ustore_snapshot_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.id, c.error, args_wrong_k, "Need an output for the snapshot ID!");
+
+    // Waits for the running writers, so that they finish preserving into the previous snapshot
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::unique_lock _ {db.snapshots_mutex};
+    safe_section("Allocating snapshot handle", c.error, [&] {
+        auto snapshot = std::make_unique<snapshot_t>();
+        snapshot->id = new_snapshot_id(db);
+        db.snapshots.push_back(std::move(snapshot));
+        *c.id = db.snapshots.back()->id;
+    });
 }
 
-void ustore_snapshot_drop(ustore_snapshot_drop_t*) {
-    // TODO
+void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
+
+    ustore_snapshot_drop_t& c = *c_ptr;
+    if (!c.id)
+        return;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::unique_lock _ {db.snapshots_mutex};
+    std::size_t snapshot_idx = find_snapshot(db, c.id);
+    return_error_if_m(snapshot_idx != db.snapshots.size(), c.error, args_wrong_k, "The snapshot doesn't exist!");
+
+    // The older snapshot still needs the versions, it hasn't preserved itself,
+    // while the rest of them are garbage collected with the dropped one
+    if (snapshot_idx)
+        db.snapshots[snapshot_idx - 1]->versions.merge(db.snapshots[snapshot_idx]->versions);
+    db.snapshots.erase(db.snapshots.begin() + snapshot_idx);
 }
 
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::read_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -507,33 +2508,112 @@ void ustore_read(ustore_read_t* c_ptr) {
     return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     places_arg_t places {collections, keys, {}, c.tasks_count};
     validate_read(c.transaction, places, c.options, c.error);
     return_if_error_m(c.error);
 
-    // 1. Allocate a tape for all the values to be pulled
+    // 1. Allocate a tape for all the values to be pulled.
+    // Presences and lengths are known from the pairs, even the spilled ones,
+    // so if only those are requested, the values are neither copied nor loaded.
+    bool const sizes_only = !c.values && !c.offsets;
     growing_tape_t tape(arena);
-    tape.reserve(places.size(), c.error);
+    auto presences = arena.alloc_or_dummy(places.count, c.error, sizes_only ? c.presences : nullptr);
+    return_if_error_m(c.error);
+    auto lengths = arena.alloc_or_dummy(places.count, c.error, sizes_only ? c.lengths : nullptr);
+    return_if_error_m(c.error);
+    if (!sizes_only)
+        tape.reserve(places.size(), c.error);
     return_if_error_m(c.error);
-    auto back_inserter = [&](value_view_t value) noexcept {
-        tape.push_back(value, c.error);
+
+    // Spilled values are read from disk, and remembered to be brought back into memory
+    ptr_range_gt<collection_key_t> faulted_keys;
+    std::size_t faults_count = 0;
+    std::size_t sized_count = 0;
+    auto push_found = [&](pair_t const& pair) noexcept {
+        if (sizes_only) {
+            presences[sized_count] = true;
+            lengths[sized_count++] = static_cast<ustore_length_t>(pair.range.size());
+            return;
+        }
+        if (!pair.is_spilled())
+            return (void)tape.push_back(pair.range, c.error);
+
+        auto loaded = arena.alloc<byte_t>(pair.range.size(), c.error);
+        return_if_error_m(c.error);
+        db.spill->load(pair, loaded.begin(), c.error);
+        return_if_error_m(c.error);
+        tape.push_back(value_view_t {loaded.begin(), pair.range.size()}, c.error);
+        return_if_error_m(c.error);
+
+        if (!faulted_keys)
+            faulted_keys = arena.alloc<collection_key_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        faulted_keys[faults_count++] = pair.collection_key;
+    };
+    auto push_missing = [&]() noexcept {
+        if (sizes_only) {
+            presences[sized_count] = false;
+            lengths[sized_count++] = ustore_length_missing_k;
+            return;
+        }
+        tape.push_back(value_view_t {}, c.error);
     };
 
+    // Reads from a snapshot take precedence over the transaction, as in snapshot-backed transactions
+    std::shared_lock<snapshots_mutex_t> snapshots_lock;
+    std::shared_lock<std::shared_mutex> versions_lock;
+    std::size_t snapshot_idx = 0;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_idx = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_idx != db.snapshots.size(), c.error, args_wrong_k, "The snapshot doesn't exist!");
+        versions_lock = std::shared_lock {db.snapshots.back()->mutex};
+    }
+
     // 2. Pull the data
-    for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
-        place_t place = places[task_idx];
-        collection_key_t key = place.collection_key();
-        auto status = c.transaction //
-                          ? find_and_watch(txn, key, c.options, back_inserter)
-                          : find_and_watch(db.pairs, key, c.options, back_inserter);
-        if (!status)
-            return export_error_code(status, c.error);
+    ucset::status_t status;
+    auto head = layered(db);
+    dispatch_places(places, [&](auto const& places) noexcept {
+        for (std::size_t task_idx = 0; task_idx != places.size() && status && !*c.error; ++task_idx) {
+            collection_key_t key = places[task_idx].collection_key();
+            if (c.snapshot)
+                status = find_in_snapshot(db, snapshot_idx, key, push_found, push_missing);
+            else if (c.transaction) {
+                auto txn_head = layered(db, txn);
+                status = find_and_watch(txn_head, key, c.options, push_found, push_missing);
+            }
+            else
+                status = find_and_watch(head, key, c.options, push_found, push_missing);
+        }
+    });
+    if (!status)
+        return export_error_code(status, c.error);
+    return_if_error_m(c.error);
+    if (c.snapshot) {
+        versions_lock.unlock();
+        snapshots_lock.unlock();
+    }
+
+    // Faulted values are likely to be read again soon, unlike the ones the next sweep will find
+    for (std::size_t fault_idx = 0; fault_idx != faults_count; ++fault_idx) {
+        collection_key_t key = faulted_keys[fault_idx];
+        auto status = db.pairs.range(key, next_collection_key(key), [&](pair_t& pair) noexcept {
+            if (!*c.error && pair.is_spilled())
+                db.spill->restore(pair, c.error);
+        });
+        export_error_code(status, c.error);
+        return_if_error_m(c.error);
     }
+    if (faults_count)
+        spill_cold_values(db, c.error);
 
     // 3. Export the results
+    if (sizes_only)
+        return;
+    metered.bytes_out(tape.contents().size());
     if (c.presences)
         *c.presences = tape.presences().get();
     if (c.offsets)
@@ -547,6 +2627,7 @@ void ustore_read(ustore_read_t* c_ptr) {
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::write_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -555,7 +2636,7 @@ void ustore_write(ustore_write_t* c_ptr) {
     return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
+    logged_transaction_t* logged_txn = reinterpret_cast<logged_transaction_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
@@ -566,14 +2647,30 @@ void ustore_write(ustore_write_t* c_ptr) {
     places_arg_t places {collections, keys, {}, c.tasks_count};
     contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
 
-    validate_write(c.transaction, places, contents, c.options, c.error);
+    // Adoption is specific to this engine, so the shared validation doesn't know about it
+    bool const adopt = c.options & ustore_option_write_adopt_k;
+    auto const shared_options = static_cast<ustore_options_t>(c.options & ~ustore_option_write_adopt_k);
+    validate_write(c.transaction, places, contents, shared_options, c.error);
     return_if_error_m(c.error);
+    if constexpr (USTORE_USE_METRICS)
+        dispatch_contents(contents, [&](auto const& contents) noexcept {
+            for (std::size_t i = 0; i != contents.size(); ++i)
+                metered.bytes_in(contents[i].size());
+        });
+    if (adopt) {
+        return_error_if_m(!c.transaction, c.error, args_wrong_k, "Transactional writes can't adopt values");
+        bool has_offsets = false;
+        for (std::size_t i = 0; i != places.size() && c.offsets; ++i)
+            has_offsets |= offs[i] != 0;
+        return_error_if_m(!has_offsets, c.error, args_wrong_k, "Adopted values can't be addressed with offsets");
+    }
 
     // Writes are the only operations that significantly differ
     // in terms of transactional and batch operations.
     // The latter will also differ depending on the number
     // pairs you are working with - one or more.
     if (c.transaction) {
+        transaction_t& txn = logged_txn->pairs;
         bool dont_watch = c.options & ustore_option_transaction_dont_watch_k;
         for (std::size_t i = 0; i != places.size(); ++i) {
             place_t place = places[i];
@@ -594,47 +2691,144 @@ void ustore_write(ustore_write_t* c_ptr) {
 
             if (!status)
                 return export_error_code(status, c.error);
+            safe_section("Remembering transactional write", c.error, [&] {
+                logged_txn->written.push_back(key);
+                if (db.image && db.image->find(key))
+                    logged_txn->image_writes.insert(key);
+            });
+            return_if_error_m(c.error);
+
+            // The log is appended only on commit, if it succeeds
+            if (db.log)
+                safe_section("Logging transactional write", c.error, [&] {
+                    std::size_t logged_size = logged_txn->logged.size();
+                    logged_txn->logged.resize(logged_size + wal_pair_size(content));
+                    dump_wal_pair(key, content, logged_txn->logged.data() + logged_size);
+                });
+            return_if_error_m(c.error);
         }
         return;
     }
 
+    // Non-transactional writes copy or adopt the values and serialize them for the log
+    // before taking the lock, to keep the critical section short.
+    auto free_adopted = [&]() noexcept {
+        for (std::size_t i = 0; i != places.size() && adopt; ++i)
+            if (contents[i].size())
+                std::free(const_cast<byte_t*>(contents[i].data()));
+    };
+    value_view_t logged;
+    if (db.log) {
+        std::size_t logged_size = 0;
+        dispatch_contents(contents, [&](auto const& contents) noexcept {
+            for (std::size_t i = 0; i != contents.size(); ++i)
+                logged_size += wal_pair_size(contents[i]);
+        });
+        auto logged_bytes = arena.alloc<byte_t>(logged_size, c.error);
+        if (*c.error)
+            return free_adopted();
+        dispatch_places(places, [&](auto const& places) noexcept {
+            dispatch_contents(contents, [&](auto const& contents) noexcept {
+                byte_t* logged_end = logged_bytes.begin();
+                for (std::size_t i = 0; i != places.size(); ++i)
+                    logged_end = dump_wal_pair(places[i].collection_key(), contents[i], logged_end);
+            });
+        });
+        logged = value_view_t {logged_bytes.begin(), logged_size};
+    }
+
+    auto make_pair = [&](std::size_t i) noexcept {
+        collection_key_t key = places[i].collection_key();
+        return adopt ? pair_t::adopt(key, contents[i]) : pair_t {key, contents[i], c.error};
+    };
+
     // Non-transactional but atomic batch-write operation.
-    // It requires producing a copy of input data.
-    else if (c.tasks_count > 1) {
-        uninitialized_array_gt<pair_t> copies(places.count, arena, c.error);
+    // It requires producing a copy of input data, unless it's adopted.
+    uninitialized_array_gt<pair_t> copies(c.tasks_count > 1 ? places.count : 0, arena, c.error);
+    if (*c.error)
+        return free_adopted();
+    initialized_range_gt<pair_t> copies_constructed(copies);
+    pair_t* unique_end = copies.begin();
+    pair_t single;
+    if (c.tasks_count == 1) {
+        single = make_pair(0);
+        return_if_error_m(c.error);
+    }
+    else {
+        // Dense arguments are walked without strides, as most batches are laid out
+        dispatch_places(places, [&](auto const& places) noexcept {
+            dispatch_contents(contents, [&](auto const& contents) noexcept {
+                for (std::size_t i = 0; i != places.size() && !*c.error; ++i) {
+                    collection_key_t key = places[i].collection_key();
+                    copies[i] = adopt ? pair_t::adopt(key, contents[i]) : pair_t {key, contents[i], c.error};
+                }
+            });
+        });
         return_if_error_m(c.error);
-        initialized_range_gt<pair_t> copies_constructed(copies);
-
-        for (std::size_t i = 0; i != places.size(); ++i) {
-            place_t place = places[i];
-            value_view_t content = contents[i];
-            collection_key_t key = place.collection_key();
 
-            pair_t pair {key, content, c.error};
-            return_if_error_m(c.error);
-            copies[i] = std::move(pair);
+        // Sorted batches are merged into the set in a single pass,
+        // and only the last of the writes into the same key is kept
+        auto less = [](pair_t const& a, pair_t const& b) noexcept {
+            return a.collection_key < b.collection_key;
+        };
+        std::stable_sort(copies.begin(), copies.end(), less);
+        for (pair_t* it = copies.begin(); it != copies.end(); ++it) {
+            if (unique_end != copies.begin() && !less(unique_end[-1], *it))
+                unique_end[-1] = std::move(*it);
+            else
+                *unique_end++ = std::move(*it);
         }
-
-        auto status = db.pairs.upsert(std::make_move_iterator(copies.begin()), std::make_move_iterator(copies.end()));
-        return export_error_code(status, c.error);
     }
 
-    // Just a single non-batch write
-    else {
-        place_t place = places[0];
-        value_view_t content = contents[0];
-        collection_key_t key = place.collection_key();
+    // Snapshots keep the versions, that are about to be overwritten
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (c.tasks_count > 1)
+        preserve_versions(
+            db,
+            unique_end - copies.begin(),
+            [&](std::size_t i) noexcept { return copies[i].collection_key; },
+            c.error);
+    else
+        preserve_versions(
+            db,
+            1,
+            [&](std::size_t) noexcept { return single.collection_key; },
+            c.error);
+    return_if_error_m(c.error);
 
-        pair_t pair {key, content, c.error};
-        return_if_error_m(c.error);
-        auto status = db.pairs.upsert(std::move(pair));
+    // Changes must reach the log in the same order they are applied
+    std::unique_lock<log_order_mutex_t> order;
+    if (db.log)
+        order = db.log->order();
+    ucset::status_t status;
+
+    if (c.tasks_count > 1)
+        status = db.pairs.upsert(std::make_move_iterator(copies.begin()), std::make_move_iterator(unique_end));
+    else
+        status = db.pairs.upsert(std::move(single));
+
+    if (!status)
         return export_error_code(status, c.error);
+    if (db.image && c.tasks_count > 1)
+        for (pair_t const* it = copies.begin(); it != unique_end; ++it)
+            db.image->shadow(it->collection_key);
+    else if (db.image)
+        db.image->shadow(single.collection_key);
+    snapshots_lock.unlock();
+    if (db.log) {
+        std::uint64_t ticket = db.log->append(wal_record_t::pairs_k, logged, c.error);
+        order.unlock();
+        return_if_error_m(c.error);
+        db.log->commit(ticket, c.options & ustore_option_write_flush_k, c.error);
+        return_if_error_m(c.error);
     }
+    spill_cold_values(db, c.error);
 }
 
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::scan_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -643,7 +2837,7 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_length_t const> lens {c.count_limits, c.count_limits_stride};
@@ -662,6 +2856,34 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Values are optionally exported in the same pass, spilled ones - without bringing them back into memory
+    uninitialized_array_gt<byte_t> values(arena);
+    ustore_length_t* values_offsets = nullptr;
+    if (c.values) {
+        values_offsets = arena.alloc<ustore_length_t>(total_keys + 1, c.error).begin();
+        return_if_error_m(c.error);
+    }
+    auto export_value = [&](pair_t const& pair) noexcept {
+        std::size_t old_size = values.size();
+        values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(old_size);
+        values.resize(old_size + pair.range.size(), c.error);
+        return_if_error_m(c.error);
+        if (pair.is_spilled())
+            db.spill->load(pair, values.begin() + old_size, c.error);
+        else
+            std::memcpy(values.begin() + old_size, pair.range.begin(), pair.range.size());
+    };
+
+    std::shared_lock<snapshots_mutex_t> snapshots_lock;
+    std::shared_lock<std::shared_mutex> versions_lock;
+    std::size_t snapshot_idx = 0;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_idx = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_idx != db.snapshots.size(), c.error, args_wrong_k, "The snapshot doesn't exist!");
+        versions_lock = std::shared_lock {db.snapshots.back()->mutex};
+    }
+
     // 2. Fetch the data
     for (std::size_t task_idx = 0; task_idx != scans.count; ++task_idx) {
         scan_t scan = scans[task_idx];
@@ -669,21 +2891,53 @@ void ustore_scan(ustore_scan_t* c_ptr) {
 
         ustore_length_t matched_pairs_count = 0;
         auto found_pair = [&](pair_t const& pair) noexcept {
+            if (*c.error)
+                return;
+            if (c.values)
+                export_value(pair);
             *keys_output = pair.collection_key.key;
             ++keys_output;
             ++matched_pairs_count;
         };
 
+        auto found_key = [&](collection_key_t key) noexcept {
+            if (*c.error)
+                return;
+            if (c.values)
+                if (auto status = find_in_snapshot(db, snapshot_idx, key, export_value, []() noexcept {}); !status)
+                    return export_error_code(status, c.error);
+            *keys_output = key.key;
+            ++keys_output;
+            ++matched_pairs_count;
+        };
+
         auto previous_key = collection_key_t {scan.collection, scan.min_key};
-        auto status = c.transaction //
-                          ? scan_and_watch(txn, previous_key, scan.limit, c.options, found_pair)
-                          : scan_and_watch(db.pairs, previous_key, scan.limit, c.options, found_pair);
+        ucset::status_t status;
+        if (c.snapshot)
+            status = scan_in_snapshot(db, snapshot_idx, previous_key, scan.limit, found_key);
+        else if (c.transaction) {
+            auto txn_head = layered(db, txn);
+            status = scan_and_watch(txn_head, previous_key, scan.limit, c.options, found_pair);
+        }
+        else {
+            auto head = layered(db);
+            status = scan_and_watch(head, previous_key, scan.limit, c.options, found_pair);
+        }
         if (!status)
             return export_error_code(status, c.error);
+        return_if_error_m(c.error);
 
         counts[task_idx] = matched_pairs_count;
     }
     offsets[scans.count] = keys_output - *c.keys;
+    metered.bytes_out((keys_output - *c.keys) * sizeof(ustore_key_t) + (c.values ? values.size() : 0));
+
+    if (c.values) {
+        values_offsets[keys_output - *c.keys] = static_cast<ustore_length_t>(values.size());
+        *c.values = reinterpret_cast<ustore_bytes_ptr_t>(values.begin());
+        if (c.values_offsets)
+            *c.values_offsets = values_offsets;
+    }
 }
 
 struct key_from_pair_t {
@@ -710,6 +2964,7 @@ struct key_iterator_t {
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::sample_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     return_error_if_m(!c.transaction, c.error, uninitialized_state_k, "Transaction sampling aren't supported!");
     if (!c.tasks_count)
@@ -743,10 +2998,27 @@ void ustore_sample(ustore_sample_t* c_ptr) {
         collection_key_t min(task.collection, std::numeric_limits<ustore_key_t>::min());
         collection_key_t max(task.collection, std::numeric_limits<ustore_key_t>::max());
 
+        std::size_t const requested = task.limit;
         auto status = db.pairs.sample_range(min, max, random_generator, seen, task.limit, iter);
         export_error_code(status, c.error);
         return_if_error_m(c.error);
 
+        // The reservoir continues with the visible keys of the image
+        if (image_collection_t const* mapped = db.image ? db.image->find_collection(task.collection) : nullptr) {
+            std::size_t sampled = task.limit;
+            for (std::size_t idx = mapped->next_visible(0); idx != mapped->count; idx = mapped->next_visible(idx + 1)) {
+                ++seen;
+                if (sampled != requested) {
+                    keys_output[sampled++] = mapped->keys[idx];
+                    continue;
+                }
+                std::size_t replaced = std::uniform_int_distribution<std::size_t>(0, seen - 1)(random_generator);
+                if (replaced < requested)
+                    keys_output[replaced] = mapped->keys[idx];
+            }
+            task.limit = sampled;
+        }
+
         counts[task_idx] = task.limit;
         keys_output += task.limit;
     }
@@ -756,6 +3028,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::measure_k, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -772,7 +3045,7 @@ void ustore_measure(ustore_measure_t* c_ptr) {
     return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
@@ -785,26 +3058,84 @@ void ustore_measure(ustore_measure_t* c_ptr) {
         collection_key_t min(collection, min_key);
         collection_key_t max(collection, max_key);
 
+        // The range is walked under a shared lock, so counts are exact, and only
+        // the memory usage depends on how the values are rounded up by the slabs
         std::size_t cardinality = 0;
         std::size_t value_bytes = 0;
-        std::size_t space_usage = 0;
+        std::size_t min_space_usage = 0;
+        std::size_t max_space_usage = 0;
         auto status = db.pairs.range(min, max, [&](pair_t& pair) noexcept {
+            std::size_t const size = pair.range.size();
             ++cardinality;
-            value_bytes += pair.range.size();
-            space_usage += pair.range.size() + sizeof(pair_t);
+            value_bytes += size;
+            min_space_usage += sizeof(pair_t);
+            max_space_usage += sizeof(pair_t);
+            if (pair.is_spilled() || !size)
+                return;
+            min_space_usage += size;
+            max_space_usage += size > slab_allocator_t::max_block_size_k
+                                   ? size
+                                   : slab_allocator_t::block_size(slab_allocator_t::size_class(size));
         });
         export_error_code(status, c.error);
         return_if_error_m(c.error);
 
+        // Mapped pairs occupy the page cache, rather than the slabs
+        if (db.image)
+            db.image->for_each(min, max, [&](image_entry_t entry) noexcept {
+                std::size_t const size = entry.value().size();
+                ++cardinality;
+                value_bytes += size;
+                min_space_usage += size;
+                max_space_usage += size + sizeof(ustore_key_t) + sizeof(std::uint64_t);
+            });
+
         min_cardinalities[i] = static_cast<ustore_size_t>(cardinality);
-        max_cardinalities[i] = std::numeric_limits<ustore_size_t>::max();
-        min_value_bytes[i] = value_bytes;
-        max_value_bytes[i] = std::numeric_limits<ustore_size_t>::max();
-        min_space_usages[i] = space_usage;
-        max_space_usages[i] = std::numeric_limits<ustore_size_t>::max();
+        max_cardinalities[i] = static_cast<ustore_size_t>(cardinality);
+        min_value_bytes[i] = static_cast<ustore_size_t>(value_bytes);
+        max_value_bytes[i] = static_cast<ustore_size_t>(value_bytes);
+        min_space_usages[i] = static_cast<ustore_size_t>(min_space_usage);
+        max_space_usages[i] = static_cast<ustore_size_t>(max_space_usage);
     }
 }
 
+void ustore_erase_ranges(ustore_erase_ranges_t* c_ptr) {
+
+    ustore_erase_ranges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::erase_k, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(!c.tasks_count || (c.start_keys && c.end_keys), c.error, args_combo_k, "Need range bounds!");
+    if (!c.tasks_count)
+        return;
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+
+    // Snapshots keep the versions of erased pairs, and the log - the same order of changes
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    std::unique_lock<log_order_mutex_t> order;
+    if (db.log)
+        order = db.log->order();
+
+    safe_section("Erasing ranges", c.error, [&] {
+        for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
+            ustore_collection_t collection = collections ? collections[i] : ustore_collection_main_k;
+            erase_range(db, collection, start_keys[i], end_keys[i], c.error);
+        }
+    });
+    return_if_error_m(c.error);
+    snapshots_lock.unlock();
+    if (!db.log)
+        return;
+
+    std::uint64_t ticket = log_ranges_erased(db, collections, start_keys, end_keys, c.tasks_count, c.error);
+    order.unlock();
+    return_if_error_m(c.error);
+    db.log->commit(ticket, c.options & ustore_option_write_flush_k, c.error);
+}
+
 /*********************************************************/
 /*****************	Collections Management	****************/
 /*********************************************************/
@@ -812,6 +3143,7 @@ void ustore_measure(ustore_measure_t* c_ptr) {
 void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 
     ustore_collection_create_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     auto name_len = c.name ? std::strlen(c.name) : 0;
     return_error_if_m(name_len, c.error, args_wrong_k, "Default collection is always present");
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
@@ -823,13 +3155,32 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
     return_error_if_m(collection_it == db.names.end(), c.error, args_wrong_k, "Such collection already exists!");
 
     auto new_collection_id = new_collection(db);
-    safe_section("Inserting new collection", c.error, [&] { db.names.emplace(collection_name, new_collection_id); });
+    if (!db.log) {
+        safe_section("Inserting new collection", c.error, [&] { db.names.emplace(collection_name, new_collection_id); });
+        *c.id = new_collection_id;
+        return;
+    }
+
+    // Restructuring is rare, so it is always synced, to keep the names of collections durable
+    std::uint64_t ticket = 0;
+    {
+        auto order = db.log->order();
+        safe_section("Inserting new collection", c.error, [&] {
+            db.names.emplace(collection_name, new_collection_id);
+            db.log->mark_dirty(new_collection_id);
+        });
+        return_if_error_m(c.error);
+        ticket = log_collection_created(db, new_collection_id, collection_name, c.error);
+    }
+    return_if_error_m(c.error);
+    db.log->commit(ticket, true, c.error);
     *c.id = new_collection_id;
 }
 
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
 
     ustore_collection_drop_t& c = *c_ptr;
+    collections_epoch_bump_t bump;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     bool invalidate = c.mode == ustore_drop_keys_vals_handle_k;
@@ -837,34 +3188,24 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
                       c.error,
                       args_combo_k,
                       "Default collection can't be invalidated.");
+    drop_companions(c);
+    return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
     std::unique_lock _ {db.restructuring_mutex};
-
-    if (c.mode == ustore_drop_keys_vals_handle_k) {
-        auto status = db.pairs.erase_range(c.id, c.id + 1, no_op_t {});
-        if (!status)
-            return export_error_code(status, c.error);
-
-        for (auto it = db.names.begin(); it != db.names.end(); ++it) {
-            if (c.id != it->second)
-                continue;
-            db.names.erase(it);
-            break;
-        }
-    }
-
-    else if (c.mode == ustore_drop_keys_vals_k) {
-        auto status = db.pairs.erase_range(c.id, c.id + 1, no_op_t {});
-        return export_error_code(status, c.error);
-    }
-
-    else if (c.mode == ustore_drop_vals_k) {
-        auto status = db.pairs.range(c.id, c.id + 1, [&](pair_t& pair) noexcept {
-            pair = pair_t {pair.collection_key, value_view_t::make_empty(), nullptr};
-        });
-        return export_error_code(status, c.error);
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (!db.log)
+        return safe_section("Dropping collection", c.error, [&] { drop_collection(db, c.id, c.mode, c.error); });
+
+    std::uint64_t ticket = 0;
+    {
+        auto order = db.log->order();
+        safe_section("Dropping collection", c.error, [&] { drop_collection(db, c.id, c.mode, c.error); });
+        return_if_error_m(c.error);
+        ticket = log_collection_dropped(db, c.id, c.mode, c.error);
     }
+    return_if_error_m(c.error);
+    db.log->commit(ticket, true, c.error);
 }
 
 void ustore_collection_list(ustore_collection_list_t* c_ptr) {
@@ -915,7 +3256,108 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
     return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
 
     *c.response = NULL;
-    log_error_m(c.error, missing_feature_k, "Controls aren't supported in this implementation!");
+    if (std::strcmp(c.request, "arenas") == 0)
+        return control_arenas(c);
+    if (is_metrics_request(c.request))
+        return control_metrics(c);
+    if (is_traces_request(c.request))
+        return control_traces(c);
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::string_view const export_prefix = "export_image ";
+    if (std::strncmp(c.request, export_prefix.data(), export_prefix.size()) == 0) {
+        std::string path = c.request + export_prefix.size();
+        std::shared_lock _ {db.restructuring_mutex};
+        return safe_section("Exporting an image", c.error, [&] { export_image(db, path, c.error); });
+    }
+    return_error_if_m(std::strcmp(c.request, "usage") == 0,
+                      c.error,
+                      missing_feature_k,
+                      "Only \"usage\", \"export_image\", \"arenas\", \"metrics\" and \"traces\" controls "
+                      "are supported!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+
+    std::shared_lock _ {db.restructuring_mutex};
+    safe_section("Measuring memory usage", c.error, [&] {
+        // Report the pairs and the bytes of values in every collection
+        struct collection_usage_t {
+            std::string_view name;
+            std::size_t pairs = 0;
+            std::size_t value_bytes = 0;
+            std::size_t spilled_bytes = 0;
+            std::size_t mapped_bytes = 0;
+        };
+        std::unordered_map<ustore_collection_t, collection_usage_t> usages;
+        usages[ustore_collection_main_k].name = {};
+        for (auto const& [name, id] : db.names)
+            usages[id].name = name;
+        auto status = scan_full(db.pairs, [&](pair_t const& pair) noexcept {
+            auto usage_it = usages.find(pair.collection_key.collection);
+            if (!pair || usage_it == usages.end())
+                return;
+            usage_it->second.pairs++;
+            usage_it->second.value_bytes += pair.range.size();
+            if (pair.is_spilled())
+                usage_it->second.spilled_bytes += pair.range.size();
+        });
+        export_error_code(status, c.error);
+        return_if_error_m(c.error);
+        if (db.image)
+            for (image_collection_t const& mapped : db.image->collections()) {
+                auto usage_it = usages.find(mapped.id);
+                if (mapped.dropped || usage_it == usages.end())
+                    continue;
+                for (std::size_t idx = mapped.next_visible(0); idx != mapped.count; idx = mapped.next_visible(idx + 1)) {
+                    usage_it->second.pairs++;
+                    usage_it->second.mapped_bytes += mapped.value(idx).size();
+                }
+                usage_it->second.value_bytes += usage_it->second.mapped_bytes;
+            }
+
+        json_t collections = json_t::object();
+        for (auto const& [id, usage] : usages)
+            collections[std::string(usage.name)] = {
+                {"pairs", usage.pairs},
+                {"value_bytes", usage.value_bytes},
+                {"spilled_bytes", usage.spilled_bytes},
+                {"mapped_bytes", usage.mapped_bytes},
+            };
+
+        // Values of all the databases in the process share the same slabs
+        slab_allocator_t::usage_t usage = blob_slabs().usage();
+        json_t slabs = json_t::array();
+        for (auto const& class_usage : usage.classes)
+            if (class_usage.slabs)
+                slabs.push_back({
+                    {"block_bytes", class_usage.block_size},
+                    {"slabs", class_usage.slabs},
+                    {"blocks_used", class_usage.blocks_used},
+                });
+
+        json_t response = {
+            {"collections", std::move(collections)},
+            {"values_memory",
+             {
+                 {"requested_bytes", usage.requested_bytes},
+                 {"allocated_bytes", usage.allocated_bytes},
+                 {"reserved_bytes", usage.reserved_bytes},
+                 {"large_bytes", usage.large_bytes},
+                 {"adopted_bytes", usage.adopted_bytes},
+                 {"slab_bytes", slab_allocator_t::slab_size_k},
+                 {"slabs", std::move(slabs)},
+             }},
+            {"memory_limit", db.options.memory_limit},
+            {"spill_file_bytes", db.spill ? db.spill->size() : 0ul},
+            {"image_file_bytes", db.image ? db.image->file_size() : 0ul},
+        };
+        std::string response_str = response.dump();
+        auto response_chars = arena.alloc<char>(response_str.size() + 1, c.error);
+        return_if_error_m(c.error);
+        std::memcpy(response_chars.begin(), response_str.c_str(), response_str.size() + 1);
+        *c.response = response_chars.begin();
+    });
 }
 
 /*********************************************************/
@@ -936,12 +3378,16 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 
         auto maybe_txn = db.pairs.transaction();
         return_error_if_m(maybe_txn, c.error, error_unknown_k, "Couldn't start a transaction");
-        *c.transaction = std::make_unique<transaction_t>(std::move(maybe_txn).value()).release();
+        auto txn = logged_transaction_t {std::move(maybe_txn).value(), {}, {}, {}};
+        *c.transaction = std::make_unique<logged_transaction_t>(std::move(txn)).release();
     });
     return_if_error_m(c.error);
 
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(*c.transaction);
-    auto status = txn.reset();
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(*c.transaction);
+    txn.logged.clear();
+    txn.written.clear();
+    txn.image_writes.clear();
+    auto status = txn.pairs.reset();
     return export_error_code(status, c.error);
 }
 
@@ -953,20 +3399,64 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
 
     validate_transaction_commit(c.transaction, c.options, c.error);
     return_if_error_m(c.error);
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
-    auto status = txn.stage();
-    if (!status)
-        return export_error_code(status, c.error);
-    status = txn.commit();
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(c.transaction);
+    auto status = txn.pairs.stage();
     if (!status)
         return export_error_code(status, c.error);
 
-    if (c.sequence_number)
-        *c.sequence_number = txn.generation();
+    // If the commit fails, the preserved versions are still valid, as they match the HEAD state
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    preserve_versions(
+        db,
+        txn.written.size(),
+        [&](std::size_t i) noexcept { return txn.written[i]; },
+        c.error);
+    return_if_error_m(c.error);
+
+    bool flush = c.options & ustore_option_write_flush_k;
+    auto shadow_image = [&]() noexcept {
+        for (collection_key_t key : txn.image_writes)
+            db.image->shadow(key);
+        txn.image_writes.clear();
+    };
+    if (!db.log) {
+        status = txn.pairs.commit();
+        if (!status)
+            return export_error_code(status, c.error);
+        shadow_image();
+        snapshots_lock.unlock();
+        txn.written.clear();
+        if (c.sequence_number)
+            *c.sequence_number = txn.pairs.generation();
+
+        // TODO: Degrade the lock to "shared" state before starting expensive IO
+        if (flush)
+            safe_section("Saving to disk", c.error, [&] { write(db, db.persisted_directory, c.error); });
+        return_if_error_m(c.error);
+        return spill_cold_values(db, c.error);
+    }
 
-    // TODO: Degrade the lock to "shared" state before starting expensive IO
-    if (c.options & ustore_option_write_flush_k)
-        safe_section("Saving to disk", c.error, [&] { write(db, db.persisted_directory, c.error); });
+    // Only the in-memory commit and the append are ordered, while the IO is shared with other writers
+    std::uint64_t ticket = 0;
+    {
+        auto order = db.log->order();
+        status = txn.pairs.commit();
+        if (!status)
+            return export_error_code(status, c.error);
+        shadow_image();
+        if (!txn.logged.empty())
+            ticket = db.log->append(wal_record_t::pairs_k, {txn.logged.data(), txn.logged.size()}, c.error);
+    }
+    snapshots_lock.unlock();
+    return_if_error_m(c.error);
+    if (c.sequence_number)
+        *c.sequence_number = txn.pairs.generation();
+    txn.logged.clear();
+    txn.written.clear();
+    if (ticket)
+        db.log->commit(ticket, flush, c.error);
+    return_if_error_m(c.error);
+    spill_cold_values(db, c.error);
 }
 
 /*********************************************************/
@@ -980,16 +3470,27 @@ void ustore_arena_free(ustore_arena_t c_arena) {
 void ustore_transaction_free(ustore_transaction_t const c_transaction) {
     if (!c_transaction)
         return;
-    transaction_t& txn = *reinterpret_cast<transaction_t*>(c_transaction);
+    logged_transaction_t& txn = *reinterpret_cast<logged_transaction_t*>(c_transaction);
     delete &txn;
 }
 
 void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
+    collections_epoch_bump_t bump;
 
     database_t& db = *reinterpret_cast<database_t*>(c_db);
-    if (!db.persisted_directory.empty()) {
+    if (db.log) {
+        // Only the changed collections are written, after which no log is needed
+        db.log->stop_checkpoints();
+        ustore_error_t c_error = nullptr;
+        safe_section("Saving to disk", &c_error, [&] {
+            checkpoint(db, &c_error);
+            if (!c_error)
+                db.log->remove_files(std::numeric_limits<std::size_t>::max());
+        });
+    }
+    else if (!db.persisted_directory.empty()) {
         ustore_error_t c_error = nullptr;
         safe_section("Saving to disk", &c_error, [&] { write(db, db.persisted_directory, &c_error); });
     }
@@ -5,22 +5,51 @@
  * @brief Client library for Apache Arrow RPC server.
  * Converts native UStore operations into Arrows classical `DoPut`, `DoExchange`...
  * Understanding the costs of remote communication, might keep a cache.
+ *
+ * ## Sharding
+ *
+ * Given a comma-separated list of servers, the client connects to each of them,
+ * and routes every key to one of them, using consistent hashing in `shard_ring_t`.
+ * Batched reads and writes are split into concurrent requests to the owning servers,
+ * and the results are merged back in the original order. Scans are broadcast to all
+ * of them, merging the sorted keys. Named collections are created on every server,
+ * and are addressed by their IDs on the first one.
+ *
+ * Such clients are @b non-transactional: a failed batch may be applied on some of the
+ * servers, and separate requests to different servers don't observe a shared snapshot.
+ * So transactions, snapshots and the modalities, implemented on the server, are rejected.
  */
 
-#include <thread>      // `std::this_thread`
-#include <mutex>       // `std::mutex`
-#include <string_view> // `std::string_view`
+#include <thread>             // `std::this_thread`
+#include <vector>             // `std::vector`
+#include <mutex>              // `std::mutex`
+#include <string_view>        // `std::string_view`
+#include <optional>           // `std::optional`
+#include <algorithm>          // `std::fill`
+#include <cstring>            // `std::strlen`
+#include <charconv>           // `std::from_chars`
+#include <chrono>             // `std::chrono::steady_clock`
+#include <deque>              // `std::deque`
+#include <condition_variable> // `std::condition_variable`
+#include <unordered_map>      // `std::unordered_map`
 
 #include <fmt/core.h> // `fmt::format_to`
 #include <arrow/c/abi.h>
 #include <arrow/flight/client.h>
 #include <arrow/array/array_binary.h>
 #include <arrow/array/array_primitive.h>
+#include <arrow/array/array_nested.h> // `ar::ListArray`
 
 #include "ustore/db.h"
+#include "ustore/async.h"
+#include "ustore/docs.h"
+#include "ustore/graph.h"
 #include "ustore/arrow.h"
 #include "ustore/cpp/types.hpp" // `ustore_doc_field()`
 #include "helpers/arrow.hpp"
+#include "helpers/lru.hpp"        // `lru_cache_gt`
+#include "helpers/shard_ring.hpp" // `shard_ring_t`
+#include "helpers/tracing.hpp"    // `traced_span_t`
 
 /*********************************************************/
 /*****************   Structures & Consts  ****************/
@@ -40,26 +69,247 @@ bool const ustore_supports_snapshots_k = true;
 using namespace unum::ustore;
 using namespace unum;
 
+/**
+ * @brief Default number of tasks packed into every record batch sent to the server.
+ * Can be overridden with a `?chunk=` parameter in the URI passed to `ustore_database_init()`.
+ */
+constexpr std::size_t chunk_tasks_default_k = 1ul << 16;
+
+/**
+ * @brief Default time, for which the cached values are trusted without asking the server.
+ * Can be overridden with a `?cache_ttl=` parameter in milliseconds.
+ */
+constexpr std::size_t cache_ttl_default_k = 1000;
+
+/**
+ * @brief Bounded cache of values read outside of transactions and snapshots,
+ * including the missing ones. Every `DoExchange` answer reports the epoch of writes
+ * on the server. Entries only survive while it stays the same, and for at most `ttl`
+ * since it was last confirmed, as other clients may be writing meanwhile.
+ */
+struct read_cache_t {
+    using steady_clock_t = std::chrono::steady_clock;
+    using value_t = std::optional<std::string>;
+
+    lru_cache_gt<collection_key_t, value_t> entries;
+    steady_clock_t::duration ttl;
+    steady_clock_t::time_point validated_at;
+    std::optional<std::uint64_t> writes_epoch;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::mutex mutex;
+
+    read_cache_t(std::size_t capacity, std::size_t ttl_milliseconds)
+        : entries(capacity), ttl(std::chrono::milliseconds(ttl_milliseconds)) {}
+
+    /// Drops the entries, if they weren't confirmed for too long. Expects a held `mutex`.
+    void expire() noexcept {
+        if (steady_clock_t::now() - validated_at > ttl)
+            entries.clear();
+    }
+
+    /// Drops the entries, if the server has seen other writes. Expects a held `mutex`.
+    void validate(std::uint64_t epoch) noexcept {
+        if (writes_epoch != epoch)
+            entries.clear();
+        writes_epoch = epoch;
+        validated_at = steady_clock_t::now();
+    }
+
+    void drop(places_arg_t const& places) noexcept {
+        std::lock_guard<std::mutex> lk(mutex);
+        for (std::size_t i = 0; i != places.size(); ++i)
+            entries.pop(places[i].collection_key());
+    }
+
+    void drop_all() noexcept {
+        std::lock_guard<std::mutex> lk(mutex);
+        entries.clear();
+    }
+};
+
+/**
+ * @brief Default number of background threads executing the operations from `ustore_submit()`,
+ * which bounds the number of requests in flight. Can be overridden with an `?async=` parameter.
+ */
+constexpr std::size_t async_threads_default_k = 16;
+
+/**
+ * @brief State of an operation submitted with `ustore_submit()`.
+ * The worker doesn't touch it after marking it `done`, so the owner may free it then.
+ */
+struct rpc_future_t {
+    ustore_submit_t task {};
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+};
+
+/**
+ * @brief Background threads executing the submitted operations.
+ * Every worker issues one blocking call at a time, all sharing the gRPC channel
+ * of the client, which multiplexes concurrent calls over the same connection.
+ * On destruction, the queued operations are completed before the threads are joined.
+ */
+class rpc_workers_t {
+    std::vector<std::thread> threads_;
+    std::deque<rpc_future_t*> queue_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    void loop() noexcept {
+        while (true) {
+            rpc_future_t* future = nullptr;
+            {
+                std::unique_lock<std::mutex> lk(mutex_);
+                wake_.wait(lk, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty())
+                    return;
+                future = queue_.front();
+                queue_.pop_front();
+            }
+
+            ustore_submit_t const& task = future->task;
+            if (task.read)
+                ustore_read(task.read);
+            else if (task.write)
+                ustore_write(task.write);
+            else if (task.scan)
+                ustore_scan(task.scan);
+            else
+                ustore_sample(task.sample);
+            if (task.callback)
+                task.callback(task.callback_context);
+
+            std::lock_guard<std::mutex> lk(future->mutex);
+            future->done = true;
+            future->finished.notify_all();
+        }
+    }
+
+  public:
+    rpc_workers_t(std::size_t count) {
+        threads_.reserve(count);
+        for (std::size_t i = 0; i != count; ++i)
+            threads_.emplace_back(&rpc_workers_t::loop, this);
+    }
+
+    ~rpc_workers_t() noexcept {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    void push(rpc_future_t* future) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            queue_.push_back(future);
+        }
+        wake_.notify_one();
+    }
+};
+
+using rpc_reader_t = std::unique_ptr<arf::FlightStreamReader>;
+
 struct rpc_client_t {
     std::unique_ptr<arf::FlightClient> flight;
-    std::vector<std::unique_ptr<arf::FlightStreamReader>> readers;
+    /// Streams backing the outputs exported into every arena, until it is reused.
+    std::unordered_map<ustore_arena_t*, std::vector<rpc_reader_t>> readers;
+    std::mutex readers_lock;
     linked_memory_t arena;
     std::mutex arena_lock;
+    std::size_t chunk_tasks = chunk_tasks_default_k;
+    std::string compression;
+    std::size_t compression_min_bytes = compression_min_bytes_default_k;
+    std::unique_ptr<read_cache_t> cache;
+    std::size_t async_threads = async_threads_default_k;
+    std::once_flag workers_init;
+    /// Clients of every server in the sharded mode, in which this one isn't connected anywhere.
+    std::vector<rpc_client_t*> shards;
+    std::optional<shard_ring_t> ring;
+    /// IDs of named collections on every shard, addressed by their IDs on the first one.
+    std::unordered_map<ustore_collection_t, std::vector<ustore_collection_t>> shards_collections;
+    std::mutex shards_collections_lock;
+    /// Declared last, to finish the submitted operations, before anything else is destroyed.
+    std::unique_ptr<rpc_workers_t> workers;
 };
 
+void discard_readers(rpc_client_t& db, ustore_arena_t* arena, ustore_options_t options) noexcept {
+    if (options & ustore_option_dont_discard_memory_k)
+        return;
+    std::lock_guard<std::mutex> lk(db.readers_lock);
+    db.readers.erase(arena);
+}
+
+void hold_reader(rpc_client_t& db, ustore_arena_t* arena, rpc_reader_t reader) {
+    std::lock_guard<std::mutex> lk(db.readers_lock);
+    db.readers[arena].push_back(std::move(reader));
+}
+
+std::optional<std::string_view> uri_param(std::string_view uri, std::string const& name) noexcept {
+    auto params_offs = uri.find('?');
+    while (params_offs != std::string_view::npos) {
+        auto value_offs = params_offs + 1 + name.size();
+        if (uri.substr(params_offs + 1, name.size()) == name && value_offs < uri.size() && uri[value_offs] == '=') {
+            auto value = uri.substr(value_offs + 1);
+            return value.substr(0, value.find('&'));
+        }
+        params_offs = uri.find('&', params_offs + 1);
+    }
+    return std::nullopt;
+}
+
+std::size_t parse_size(std::string_view str, std::size_t default_) noexcept {
+    std::size_t result = default_;
+    std::from_chars(str.data(), str.data() + str.size(), result);
+    return result;
+}
+
 arf::FlightCallOptions arrow_call_options(arrow_mem_pool_t& pool) {
     arf::FlightCallOptions options;
     options.read_options = arrow_read_options(pool);
     options.write_options = arrow_write_options(pool);
     options.memory_manager = ar::CPUDevice::memory_manager(&pool);
+    // The server continues the trace of the call, that issues the RPC
+    if constexpr (USTORE_USE_TRACING)
+        if (current_span().valid())
+            options.headers.emplace_back(traceparent_header_k, format_traceparent(current_span()));
     return options;
 }
 
-void export_options(ustore_options_t options, std::string& cmd) {
+std::optional<std::uint64_t> writes_epoch(ar::Schema const& schema) noexcept {
+    auto const& metadata = schema.metadata();
+    int idx = metadata ? metadata->FindKey(kMetaWritesEpoch) : -1;
+    if (idx < 0)
+        return std::nullopt;
+    std::string const& str = metadata->value(idx);
+    std::uint64_t result = 0;
+    if (std::from_chars(str.data(), str.data() + str.size(), result).ec != std::errc())
+        return std::nullopt;
+    return result;
+}
+
+ar::Status compress_if_large(rpc_client_t const& db, ar::RecordBatch const& batch, arf::FlightCallOptions& options) {
+    return compress_if_large(options.write_options, batch, parse_compression(db.compression), db.compression_min_bytes);
+}
+
+void export_options(rpc_client_t const& db, ustore_options_t options, std::string& cmd) {
     if (options & ustore_option_read_shared_memory_k)
         fmt::format_to(std::back_inserter(cmd), "{}&", kParamFlagSharedMemRead);
     if (options & ustore_option_transaction_dont_watch_k)
         fmt::format_to(std::back_inserter(cmd), "{}&", kParamFlagDontWatch);
+    if (!db.compression.empty())
+        fmt::format_to(std::back_inserter(cmd),
+                       "{}={}&{}={}&",
+                       kParamCompression,
+                       db.compression,
+                       kParamCompressionMin,
+                       db.compression_min_bytes);
 
     // This flag shouldn't be forwarded to the server.
     // In standalone builds it only applies to the client.
@@ -67,48 +317,70 @@ void export_options(ustore_options_t options, std::string& cmd) {
     //     fmt::format_to(std::back_inserter(cmd), "{}&", kParamFlagDontDiscard);
 }
 
-/*********************************************************/
-/*****************	    C Interface 	  ****************/
-/*********************************************************/
-
-void ustore_database_init(ustore_database_init_t* c_ptr) {
-
-    ustore_database_init_t& c = *c_ptr;
-
-    safe_section("Starting client", c.error, [&] {
-        if (!c.config || !std::strlen(c.config))
-            c.config = "grpc://0.0.0.0:38709";
-
-        auto db_ptr = new rpc_client_t {};
-        auto maybe_location = arf::Location::Parse(c.config);
-        return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Server URI");
-
-        auto maybe_flight_ptr = arf::FlightClient::Connect(*maybe_location);
-        return_error_if_m(maybe_flight_ptr.ok(), c.error, network_k, "Flight Client Connection");
+/**
+ * @brief Streams the `batch` to the server in slices of `chunk_tasks` rows,
+ * sending the next slice before receiving the answer to the previous one.
+ * So the server is always busy, and at most two slices are in flight in each
+ * direction. The answers are joined into a single chunk of `pool` memory.
+ */
+ar::Result<std::shared_ptr<ar::Table>> exchange_in_chunks( //
+    arf::FlightClient::DoExchangeResult& exchange,
+    std::shared_ptr<ar::RecordBatch> const& batch,
+    std::size_t chunk_tasks,
+    ar::MemoryPool& pool) {
+
+    ar::Status ar_status = exchange.writer->Begin(batch->schema());
+    if (!ar_status.ok())
+        return ar_status;
+
+    // Bitmasks of different answers can only be joined at byte boundaries
+    chunk_tasks = divide_round_up<std::size_t>(std::max<std::size_t>(chunk_tasks, 1), CHAR_BIT) * CHAR_BIT;
+    std::size_t const tasks_count = static_cast<std::size_t>(batch->num_rows());
+    std::size_t const chunks_count = std::max<std::size_t>(divide_round_up(tasks_count, chunk_tasks), 1);
+    auto send_chunk = [&](std::size_t chunk_idx) {
+        std::size_t offset = chunk_idx * chunk_tasks;
+        std::size_t length = std::min(chunk_tasks, tasks_count - offset);
+        return exchange.writer->WriteRecordBatch(*batch->Slice(offset, length));
+    };
+
+    std::vector<std::shared_ptr<ar::RecordBatch>> answers;
+    answers.reserve(chunks_count);
+    ar_status = send_chunk(0);
+    for (std::size_t chunk_idx = 0; chunk_idx != chunks_count && ar_status.ok(); ++chunk_idx) {
+        ar_status = chunk_idx + 1 != chunks_count ? send_chunk(chunk_idx + 1) : exchange.writer->DoneWriting();
+        if (!ar_status.ok())
+            break;
+
+        ar::Result<arf::FlightStreamChunk> maybe_answer = exchange.reader->Next();
+        if (!maybe_answer.ok())
+            return maybe_answer.status();
+        if (!maybe_answer->data)
+            return ar::Status::IOError("Server closed the stream early");
+        answers.push_back(std::move(maybe_answer->data));
+    }
+    if (!ar_status.ok())
+        return ar_status;
 
-        linked_memory(reinterpret_cast<ustore_arena_t*>(&db_ptr->arena), ustore_option_dont_discard_memory_k, c.error);
-        return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Failed to allocate default arena.");
-        db_ptr->flight = maybe_flight_ptr.MoveValueUnsafe();
-        *c.db = db_ptr;
-    });
+    auto maybe_table = ar::Table::FromRecordBatches(std::move(answers));
+    if (!maybe_table.ok() || chunks_count == 1)
+        return maybe_table;
+    return maybe_table.ValueUnsafe()->CombineChunks(&pool);
 }
 
-void ustore_read(ustore_read_t* c_ptr) {
-
-    ustore_read_t& c = *c_ptr;
-    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
-    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
-
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Reads all the places of `c` from the server into the `arena`,
+ * optionally reporting the `writes_epoch` the server has answered with.
+ */
+void read_remote( //
+    rpc_client_t& db,
+    ustore_read_t& c,
+    linked_memory_lock_t& arena,
+    std::optional<std::uint64_t>* epoch = nullptr) {
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     places_arg_t places {collections, keys, {}, c.tasks_count};
 
-    ar::Status ar_status;
     arrow_mem_pool_t pool(arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
 
@@ -136,7 +408,7 @@ void ustore_read(ustore_read_t* c_ptr) {
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
     if (partial_mode)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
     constexpr bool has_keys_column = true;
@@ -197,24 +469,13 @@ void ustore_read(ustore_read_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
+    ar::Status ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
     ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
-    ar_status = result->writer->Begin(batch_ptr->schema());
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
-
-    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*input_table);
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
-
-    ar_status = result->writer->DoneWriting();
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
-
-    // Fetch the responses
-    // Requesting `ToTable` might be more efficient than concatenating and
-    // reallocating directly from our arena, as the underlying Arrow implementation
-    // may know the length of the entire dataset.
-    auto maybe_table = result->reader->ToTable();
+    // Large requests are streamed in chunks, receiving the answers in between
+    auto maybe_table = exchange_in_chunks(*result, batch_ptr, db.chunk_tasks, pool);
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
     return_error_if_m(table->num_columns() == 1, c.error, error_unknown_k, "Expecting one column");
@@ -263,249 +524,1475 @@ void ustore_read(ustore_read_t* c_ptr) {
         }
     }
 
-    db.readers.push_back(std::move(result->reader));
+    if (epoch)
+        *epoch = writes_epoch(*table->schema());
+    hold_reader(db, c.arena, std::move(result->reader));
 }
 
-void ustore_write(ustore_write_t* c_ptr) {
-
-    ustore_write_t& c = *c_ptr;
-    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
-
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Copies the cached values into the `arena` and reads the others from the server,
+ * caching them afterwards. Outputs are laid out just like the remote ones.
+ */
+void read_cached(rpc_client_t& db, ustore_read_t& c, linked_memory_lock_t& arena) {
 
-    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    read_cache_t& cache = *db.cache;
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
-    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
-    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
-    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
-    bits_view_t presences {c.presences};
-
     places_arg_t places {collections, keys, {}, c.tasks_count};
-    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
-
-    bool const same_collection = places.same_collection();
-    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const write_flush = c.options & ustore_option_write_flush_k;
-
-    bool const has_collections_column = collections && !same_collection;
-    constexpr bool has_keys_column = true;
-    bool const has_contents_column = vals != nullptr;
 
-    if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
-        return_if_error_m(c.error);
-        transform_n(collections, places.size(), continuous.begin());
-        collections = {continuous.begin(), places.size()};
-    }
+    // Views of all the values, starting with the cached ones, that are copied
+    // under the lock, as other threads may evict the entries right after
+    auto views = arena.alloc<value_view_t>(places.size(), c.error);
+    return_if_error_m(c.error);
+    auto cached = arena.alloc<read_cache_t::value_t const*>(places.size(), c.error);
+    return_if_error_m(c.error);
+    std::size_t misses_count = 0;
+    {
+        std::lock_guard<std::mutex> lk(cache.mutex);
+        cache.expire();
+        std::size_t cached_bytes = 0;
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            views[i] = value_view_t {};
+            cached[i] = cache.entries.get_ptr(places[i].collection_key());
+            misses_count += !cached[i];
+            cached_bytes += cached[i] && *cached[i] ? (*cached[i])->size() : 0;
+        }
+        cache.hits += places.size() - misses_count;
+        cache.misses += misses_count;
 
-    if (has_keys_column && !keys.is_continuous()) {
-        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
+        auto cached_tape = arena.alloc<byte_t>(cached_bytes, c.error);
         return_if_error_m(c.error);
-        transform_n(keys, places.size(), continuous.begin());
-        keys = {continuous.begin(), places.size()};
+        std::size_t cached_offset = 0;
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            if (!cached[i] || !*cached[i])
+                continue;
+            std::string const& value = **cached[i];
+            std::memcpy(cached_tape.begin() + cached_offset, value.data(), value.size());
+            views[i] = value_view_t {cached_tape.begin() + cached_offset, value.size()};
+            cached_offset += value.size();
+        }
     }
 
-    // Check if the input is continuous and is already in an Arrow-compatible form
-    ustore_bytes_cptr_t joined_vals_begin = vals ? vals[0] : nullptr;
-    if (has_contents_column && !contents.is_continuous()) {
-        size_t total = transform_reduce_n(contents, places.size(), 0ul, std::mem_fn(&value_view_t::size));
-        auto joined_vals = arena.alloc<byte_t>(total, c.error);
+    // Fetch the rest
+    std::optional<std::uint64_t> epoch;
+    if (misses_count) {
+        auto missed_collections = arena.alloc<ustore_collection_t>(misses_count, c.error);
         return_if_error_m(c.error);
-        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        auto missed_keys = arena.alloc<ustore_key_t>(misses_count, c.error);
         return_if_error_m(c.error);
-        size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
-        auto slots_presences = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        for (std::size_t i = 0, j = 0; i != places.size(); ++i) {
+            if (cached[i])
+                continue;
+            missed_collections[j] = places[i].collection;
+            missed_keys[j] = places[i].key;
+            ++j;
+        }
+
+        ustore_length_t* missed_offsets = nullptr;
+        ustore_length_t* missed_lengths = nullptr;
+        ustore_byte_t* missed_values = nullptr;
+        ustore_read_t missed = c;
+        missed.tasks_count = static_cast<ustore_size_t>(misses_count);
+        missed.collections = missed_collections.begin();
+        missed.collections_stride = sizeof(ustore_collection_t);
+        missed.keys = missed_keys.begin();
+        missed.keys_stride = sizeof(ustore_key_t);
+        missed.presences = nullptr;
+        missed.offsets = &missed_offsets;
+        missed.lengths = &missed_lengths;
+        missed.values = &missed_values;
+        read_remote(db, missed, arena, &epoch);
         return_if_error_m(c.error);
-        std::memset(slots_presences.begin(), 0, slots_count);
-        auto joined_presences = bits_span_t(slots_presences.begin());
 
-        // Exports into the Arrow-compatible form
-        ustore_length_t exported_bytes = 0;
-        for (std::size_t i = 0; i != c.tasks_count; ++i) {
-            auto value = contents[i];
-            joined_presences[i] = value;
-            joined_offs[i] = exported_bytes;
-            std::memcpy(joined_vals.begin() + exported_bytes, value.begin(), value.size());
-            exported_bytes += value.size();
+        for (std::size_t i = 0, j = 0; i != places.size(); ++i) {
+            if (cached[i])
+                continue;
+            if (missed_lengths[j] != ustore_length_missing_k)
+                views[i] = value_view_t {missed_values + missed_offsets[j], missed_lengths[j]};
+            else
+                views[i] = value_view_t {};
+            ++j;
         }
-        joined_offs[places.size()] = exported_bytes;
+    }
 
-        joined_vals_begin = (ustore_bytes_cptr_t)joined_vals.begin();
-        vals = {&joined_vals_begin, 0};
-        offs = {joined_offs.begin(), sizeof(ustore_key_t)};
-        presences = {slots_presences.begin()};
+    // Export in the same form as the server does
+    std::size_t total_bytes = transform_reduce_n(views.begin(), places.size(), 0ul, std::mem_fn(&value_view_t::size));
+    if (c.presences) {
+        std::size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
+        auto slots = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        return_if_error_m(c.error);
+        std::memset(slots.begin(), 0, slots_count);
+        auto presences = bits_span_t(slots.begin());
+        for (std::size_t i = 0; i != places.size(); ++i)
+            presences[i] = bool(views[i]);
+        *c.presences = slots.begin();
     }
-    // It may be the case, that we only have `c.tasks_count` offsets instead of `c.tasks_count+1`,
-    // which won't be enough for Arrow.
-    else if (has_contents_column && !contents.is_arrow()) {
-        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+    if (c.lengths) {
+        auto lengths = *c.lengths = arena.alloc<ustore_length_t>(places.size(), c.error).begin();
         return_if_error_m(c.error);
-        size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
-        auto slots_presences = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        for (std::size_t i = 0; i != places.size(); ++i)
+            lengths[i] = views[i] ? static_cast<ustore_length_t>(views[i].size()) : ustore_length_missing_k;
+    }
+    if (c.offsets || c.values) {
+        auto offsets = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        auto tape = arena.alloc<byte_t>(total_bytes, c.error);
         return_if_error_m(c.error);
-        std::memset(slots_presences.begin(), 0, slots_count);
-        auto joined_presences = bits_span_t(slots_presences.begin());
-
-        // Exports into the Arrow-compatible form
         ustore_length_t exported_bytes = 0;
-        for (std::size_t i = 0; i != c.tasks_count; ++i) {
-            auto value = contents[i];
-            joined_presences[i] = value;
-            joined_offs[i] = exported_bytes;
-            exported_bytes += value.size();
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            offsets[i] = exported_bytes;
+            if (views[i].size())
+                std::memcpy(tape.begin() + exported_bytes, views[i].begin(), views[i].size());
+            exported_bytes += static_cast<ustore_length_t>(views[i].size());
         }
-        joined_offs[places.size()] = exported_bytes;
+        offsets[places.size()] = exported_bytes;
+        if (c.offsets)
+            *c.offsets = offsets.begin();
+        if (c.values)
+            *c.values = reinterpret_cast<ustore_byte_t*>(tape.begin());
+    }
 
-        vals = {&joined_vals_begin, 0};
-        offs = {joined_offs.begin(), sizeof(ustore_key_t)};
-        presences = {slots_presences.begin()};
+    // Remember the fetched values, unless the server can't confirm they are fresh
+    if (!epoch)
+        return;
+    std::lock_guard<std::mutex> lk(cache.mutex);
+    cache.validate(*epoch);
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        if (cached[i])
+            continue;
+        read_cache_t::value_t value;
+        if (views[i])
+            value.emplace(reinterpret_cast<char const*>(views[i].begin()), views[i].size());
+        cache.entries.insert_or_assign(places[i].collection_key(), std::move(value));
     }
+}
 
-    // Now build-up the Arrow representation
-    ArrowArray input_array_c;
-    ArrowSchema input_schema_c;
-    auto count_collections = has_collections_column + has_keys_column + has_contents_column;
-    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Fetches the values of the keys, found by a scan, with a follow-up read,
+ * as the protocol only returns keys.
+ */
+void read_scanned(ustore_scan_t& c,
+                  linked_memory_lock_t& arena,
+                  ustore_key_t const* found_keys,
+                  ustore_length_t const* found_offsets) {
+    if (!c.values)
+        return;
 
-    if (has_collections_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgCols.c_str(),
-            ustore_doc_field<ustore_collection_t>(),
-            nullptr,
-            nullptr,
-            collections.get(),
-            input_schema_c.children[0],
-            input_array_c.children[0],
-            c.error);
-    return_if_error_m(c.error);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    places_arg_t places {collections, {}, {}, c.tasks_count};
+    bool const same_collection = places.same_collection();
+    std::size_t const found_count = found_offsets ? found_offsets[c.tasks_count] : 0;
+    ustore_collection_t const* found_collections = c.collections;
+    ustore_size_t found_collections_stride = 0;
+    if (!same_collection) {
+        auto expanded = arena.alloc<ustore_collection_t>(found_count, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != c.tasks_count; ++i)
+            std::fill(expanded.begin() + found_offsets[i], expanded.begin() + found_offsets[i + 1], collections[i]);
+        found_collections = expanded.begin();
+        found_collections_stride = sizeof(ustore_collection_t);
+    }
 
-    if (has_keys_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            "keys",
-            ustore_doc_field<ustore_key_t>(),
-            nullptr,
-            nullptr,
-            keys.get(),
-            input_schema_c.children[has_collections_column],
-            input_array_c.children[has_collections_column],
-            c.error);
-    return_if_error_m(c.error);
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c.error;
+    read.transaction = c.transaction;
+    read.snapshot = c.snapshot;
+    read.arena = arena;
+    read.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = found_count;
+    read.collections = found_collections;
+    read.collections_stride = found_collections_stride;
+    read.keys = found_keys;
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = c.values_offsets;
+    read.values = c.values;
+    ustore_read(&read);
+}
 
-    if (has_contents_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgVals.c_str(),
-            ustore_doc_field<value_view_t>(),
-            presences.get(),
-            offs.get(),
-            joined_vals_begin,
-            input_schema_c.children[has_collections_column + has_keys_column],
-            input_array_c.children[has_collections_column + has_keys_column],
-            c.error);
-    return_if_error_m(c.error);
+/*********************************************************/
+/*****************	       Sharding	      ****************/
+/*********************************************************/
+
+bool is_sharded(rpc_client_t const& db) noexcept {
+    return !db.shards.empty();
+}
+
+/**
+ * @brief Result of a call to one of the shards. Every client tracks the streams,
+ * backing the outputs in its arenas, so the shards can't share the arena of the caller.
+ */
+struct shard_call_t {
+    rpc_client_t* shard = nullptr;
+    ustore_arena_t arena = nullptr;
+    ustore_error_t error = nullptr;
+
+    shard_call_t() = default;
+    shard_call_t(shard_call_t const&) = delete;
+    shard_call_t& operator=(shard_call_t const&) = delete;
+    ~shard_call_t() noexcept {
+        if (shard)
+            discard_readers(*shard, &arena, ustore_options_default_k);
+        ustore_arena_free(arena);
+    }
+};
+
+/**
+ * @brief Part of a batch, routed to one of the shards, with the collections translated
+ * into the IDs, that shard uses.
+ */
+struct shard_batch_t : public shard_call_t {
+    /// Offsets of the tasks in the original batch.
+    std::vector<std::size_t> tasks;
+    std::vector<ustore_collection_t> collections;
+    std::vector<ustore_key_t> keys;
+};
+
+/**
+ * @brief Calls `callback(shard_idx)` for every passed shard concurrently,
+ * reusing the calling thread for the last one.
+ */
+template <typename callback_at>
+void for_each_shard(std::vector<std::size_t> const& shards_idxs, callback_at&& callback) {
+    if (shards_idxs.empty())
+        return;
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(shards_idxs.size() - 1);
+        for (std::size_t i = 0; i + 1 < shards_idxs.size(); ++i)
+            threads.emplace_back(callback, shards_idxs[i]);
+    }
+    catch (...) {
+        for (auto& thread : threads)
+            thread.join();
+        throw;
+    }
+    callback(shards_idxs.back());
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Propagates the first error reported by any of the shards.
+ */
+template <typename calls_at>
+void export_shards_error(calls_at const& calls, ustore_error_t* c_error) noexcept {
+    for (shard_call_t const& call : calls)
+        if (call.error) {
+            *c_error = call.error;
+            return;
+        }
+}
+
+/**
+ * @brief Lists the named collections on every shard and matches them by names,
+ * to learn the IDs of the collections, created through other clients.
+ */
+void map_collections(rpc_client_t& db, ustore_error_t* c_error) {
+    std::vector<shard_call_t> calls(db.shards.size());
+    std::vector<ustore_size_t> counts(db.shards.size());
+    std::vector<ustore_collection_t*> ids(db.shards.size());
+    std::vector<ustore_length_t*> offsets(db.shards.size());
+    std::vector<ustore_char_t*> names(db.shards.size());
+    for (std::size_t shard_idx = 0; shard_idx != db.shards.size(); ++shard_idx) {
+        shard_call_t& call = calls[shard_idx];
+        call.shard = db.shards[shard_idx];
+        ustore_collection_list_t list {};
+        list.db = call.shard;
+        list.error = &call.error;
+        list.arena = &call.arena;
+        list.count = &counts[shard_idx];
+        list.ids = &ids[shard_idx];
+        list.offsets = &offsets[shard_idx];
+        list.names = &names[shard_idx];
+        ustore_collection_list(&list);
+    }
+    export_shards_error(calls, c_error);
+    return_if_error_m(c_error);
+
+    auto mapping = match_collections(db.shards.size(), counts.data(), ids.data(), offsets.data(), names.data());
+    std::lock_guard<std::mutex> lk(db.shards_collections_lock);
+    db.shards_collections = std::move(mapping);
+}
+
+/**
+ * @brief Replaces the collection IDs of the first shard, exposed to the user,
+ * with the IDs the `shard_idx`-th shard uses for the same named collections.
+ */
+void translate_collections(rpc_client_t& db,
+                           std::size_t shard_idx,
+                           std::vector<ustore_collection_t>& collections,
+                           ustore_error_t* c_error) {
+    if (shard_idx == 0)
+        return;
+
+    std::unique_lock<std::mutex> lk(db.shards_collections_lock);
+    bool remapped = false;
+    for (ustore_collection_t& collection : collections) {
+        if (collection == ustore_collection_main_k)
+            continue;
+        auto it = db.shards_collections.find(collection);
+        if (it == db.shards_collections.end() && !remapped) {
+            lk.unlock();
+            map_collections(db, c_error);
+            return_if_error_m(c_error);
+            lk.lock();
+            remapped = true;
+            it = db.shards_collections.find(collection);
+        }
+        return_error_if_m(it != db.shards_collections.end(),
+                          c_error,
+                          args_wrong_k,
+                          "Collection is missing on some of the shards");
+        collection = it->second[shard_idx];
+    }
+}
+
+/**
+ * @brief Splits the tasks between the shards owning their keys, preserving their order.
+ * @param[out] routes The shard of every task.
+ * @param[out] rows The position of every task within the batch of its shard.
+ * @return Indexes of the shards, that received any tasks.
+ */
+std::vector<std::size_t> route_places(rpc_client_t& db,
+                                      places_arg_t const& places,
+                                      std::vector<shard_batch_t>& batches,
+                                      std::vector<std::size_t>& routes,
+                                      std::vector<std::size_t>& rows,
+                                      ustore_error_t* c_error) {
+    route_keys(*db.ring, places.size(), [&](std::size_t i) { return places[i].key; }, routes, rows);
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        place_t place = places[i];
+        shard_batch_t& batch = batches[routes[i]];
+        batch.tasks.push_back(i);
+        batch.collections.push_back(place.collection);
+        batch.keys.push_back(place.key);
+    }
+
+    std::vector<std::size_t> active;
+    for (std::size_t shard_idx = 0; shard_idx != batches.size(); ++shard_idx) {
+        shard_batch_t& batch = batches[shard_idx];
+        batch.shard = db.shards[shard_idx];
+        if (batch.tasks.empty())
+            continue;
+        translate_collections(db, shard_idx, batch.collections, c_error);
+        if (*c_error)
+            return {};
+        active.push_back(shard_idx);
+    }
+    return active;
+}
+
+/**
+ * @brief Reads the keys from the shards owning them in parallel,
+ * and merges the outputs in the order of tasks, just like the server lays them out.
+ */
+void read_sharded(rpc_client_t& db, ustore_read_t& c, linked_memory_lock_t& arena) {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    bool const wants_contents = c.values || c.offsets;
+    bool const wants_lengths = wants_contents || c.lengths;
+
+    std::size_t const shards_count = db.shards.size();
+    std::vector<shard_batch_t> batches(shards_count);
+    std::vector<std::size_t> routes;
+    std::vector<std::size_t> rows;
+    std::vector<ustore_octet_t*> shards_presences(shards_count);
+    std::vector<ustore_length_t*> shards_offsets(shards_count);
+    std::vector<ustore_length_t*> shards_lengths(shards_count);
+    std::vector<ustore_byte_t*> shards_values(shards_count);
+    safe_section("Reading from shards", c.error, [&] {
+        std::vector<std::size_t> active = route_places(db, places, batches, routes, rows, c.error);
+        return_if_error_m(c.error);
+        for_each_shard(active, [&](std::size_t shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            ustore_read_t read {};
+            read.db = batch.shard;
+            read.error = &batch.error;
+            read.arena = &batch.arena;
+            read.options = c.options;
+            read.tasks_count = static_cast<ustore_size_t>(batch.tasks.size());
+            read.collections = batch.collections.data();
+            read.collections_stride = sizeof(ustore_collection_t);
+            read.keys = batch.keys.data();
+            read.keys_stride = sizeof(ustore_key_t);
+            read.presences = !wants_lengths && c.presences ? &shards_presences[shard_idx] : nullptr;
+            read.lengths = wants_lengths ? &shards_lengths[shard_idx] : nullptr;
+            read.offsets = wants_contents ? &shards_offsets[shard_idx] : nullptr;
+            read.values = wants_contents ? &shards_values[shard_idx] : nullptr;
+            ustore_read(&read);
+        });
+    });
+    return_if_error_m(c.error);
+    export_shards_error(batches, c.error);
+    return_if_error_m(c.error);
+
+    // Every task is answered by the next unused row of its shard
+    merged_reads_t merged;
+    merged.routes = routes.data();
+    merged.rows = rows.data();
+    merged.presences = shards_presences.data();
+    merged.offsets = shards_offsets.data();
+    merged.lengths = shards_lengths.data();
+    merged.values = shards_values.data();
+
+    // Export in the same form as the server does
+    if (c.presences) {
+        std::size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
+        auto slots = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        return_if_error_m(c.error);
+        std::memset(slots.begin(), 0, slots_count);
+        auto presences = bits_span_t(slots.begin());
+        for (std::size_t i = 0; i != places.size(); ++i)
+            presences[i] = merged.present(i);
+        *c.presences = slots.begin();
+    }
+    if (c.lengths) {
+        auto lengths = *c.lengths = arena.alloc<ustore_length_t>(places.size(), c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.size(); ++i)
+            lengths[i] = merged.length(i);
+    }
+    if (wants_contents) {
+        std::size_t total_bytes = 0;
+        for (std::size_t i = 0; i != places.size(); ++i)
+            total_bytes += merged.present(i) ? merged.length(i) : 0;
+        auto offsets = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        auto tape = arena.alloc<byte_t>(total_bytes, c.error);
+        return_if_error_m(c.error);
+        ustore_length_t exported_bytes = 0;
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            offsets[i] = exported_bytes;
+            if (!merged.present(i) || !merged.length(i))
+                continue;
+            value_view_t value = merged.value(i);
+            std::memcpy(tape.begin() + exported_bytes, value.begin(), value.size());
+            exported_bytes += static_cast<ustore_length_t>(value.size());
+        }
+        offsets[places.size()] = exported_bytes;
+        if (c.offsets)
+            *c.offsets = offsets.begin();
+        if (c.values)
+            *c.values = reinterpret_cast<ustore_byte_t*>(tape.begin());
+    }
+}
+
+/**
+ * @brief Sends every shard the part of the batch with the keys it owns, in parallel.
+ * Those parts are applied independently, so a failure may leave some of them written.
+ */
+void write_sharded(rpc_client_t& db, ustore_write_t& c) {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
+    bits_view_t presences {c.presences};
+
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+    bool const has_contents = vals != nullptr;
+
+    std::vector<shard_batch_t> batches(db.shards.size());
+    std::vector<std::size_t> routes;
+    std::vector<std::size_t> rows;
+    std::vector<std::vector<ustore_bytes_cptr_t>> shards_values(db.shards.size());
+    std::vector<std::vector<ustore_length_t>> shards_lengths(db.shards.size());
+    safe_section("Writing to shards", c.error, [&] {
+        std::vector<std::size_t> active = route_places(db, places, batches, routes, rows, c.error);
+        return_if_error_m(c.error);
+
+        // Present values always have a non-NULL address, so deletions don't need a separate bitset
+        if (has_contents) {
+            for (std::size_t shard_idx : active) {
+                for (std::size_t task_idx : batches[shard_idx].tasks) {
+                    value_view_t value = contents[task_idx];
+                    shards_values[shard_idx].push_back(value ? ustore_bytes_cptr_t(value.begin()) : nullptr);
+                    shards_lengths[shard_idx].push_back(value ? value.size() : ustore_length_missing_k);
+                }
+            }
+        }
+
+        for_each_shard(active, [&](std::size_t shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            ustore_write_t write {};
+            write.db = batch.shard;
+            write.error = &batch.error;
+            write.arena = &batch.arena;
+            write.options = c.options;
+            write.tasks_count = static_cast<ustore_size_t>(batch.tasks.size());
+            write.collections = batch.collections.data();
+            write.collections_stride = sizeof(ustore_collection_t);
+            write.keys = batch.keys.data();
+            write.keys_stride = sizeof(ustore_key_t);
+            if (has_contents) {
+                write.values = shards_values[shard_idx].data();
+                write.values_stride = sizeof(ustore_bytes_cptr_t);
+                write.lengths = shards_lengths[shard_idx].data();
+                write.lengths_stride = sizeof(ustore_length_t);
+            }
+            ustore_write(&write);
+        });
+    });
+    return_if_error_m(c.error);
+    export_shards_error(batches, c.error);
+}
+
+/**
+ * @brief Scans every shard from the same starting keys and merges the sorted keys,
+ * keeping the smallest ones within the limit of every task. As the keys are spread
+ * between the shards, each of them may return up to the whole limit.
+ */
+void scan_sharded(rpc_client_t& db, ustore_scan_t& c, linked_memory_lock_t& arena) {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    std::size_t const shards_count = db.shards.size();
+
+    std::vector<shard_batch_t> batches(shards_count);
+    std::vector<std::size_t> all_shards(shards_count);
+    std::vector<ustore_length_t> continuous_limits(c.tasks_count);
+    std::vector<ustore_length_t*> shards_offsets(shards_count);
+    std::vector<ustore_key_t*> shards_keys(shards_count);
+    std::vector<ustore_key_t> found_keys;
+    std::vector<ustore_length_t> found_offsets;
+    safe_section("Scanning shards", c.error, [&] {
+        for (std::size_t i = 0; i != c.tasks_count; ++i)
+            continuous_limits[i] = limits[i];
+        for (std::size_t shard_idx = 0; shard_idx != shards_count; ++shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            batch.shard = db.shards[shard_idx];
+            batch.collections.resize(c.tasks_count);
+            batch.keys.resize(c.tasks_count);
+            for (std::size_t i = 0; i != c.tasks_count; ++i) {
+                batch.collections[i] = collections ? collections[i] : ustore_collection_main_k;
+                batch.keys[i] = start_keys[i];
+            }
+            translate_collections(db, shard_idx, batch.collections, c.error);
+            return_if_error_m(c.error);
+            all_shards[shard_idx] = shard_idx;
+        }
+
+        for_each_shard(all_shards, [&](std::size_t shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            ustore_scan_t scan {};
+            scan.db = batch.shard;
+            scan.error = &batch.error;
+            scan.arena = &batch.arena;
+            scan.options = c.options;
+            scan.tasks_count = c.tasks_count;
+            scan.collections = batch.collections.data();
+            scan.collections_stride = sizeof(ustore_collection_t);
+            scan.start_keys = batch.keys.data();
+            scan.start_keys_stride = sizeof(ustore_key_t);
+            scan.count_limits = continuous_limits.data();
+            scan.count_limits_stride = sizeof(ustore_length_t);
+            scan.offsets = &shards_offsets[shard_idx];
+            scan.keys = &shards_keys[shard_idx];
+            ustore_scan(&scan);
+        });
+        export_shards_error(batches, c.error);
+        return_if_error_m(c.error);
+
+        merge_scans(c.tasks_count,
+                    shards_count,
+                    shards_offsets.data(),
+                    shards_keys.data(),
+                    continuous_limits.data(),
+                    found_keys,
+                    found_offsets);
+    });
+    return_if_error_m(c.error);
+
+    auto exported_keys = arena.alloc<ustore_key_t>(found_keys.size(), c.error);
+    return_if_error_m(c.error);
+    std::copy(found_keys.begin(), found_keys.end(), exported_keys.begin());
+    auto exported_offsets = arena.alloc<ustore_length_t>(found_offsets.size(), c.error);
+    return_if_error_m(c.error);
+    std::copy(found_offsets.begin(), found_offsets.end(), exported_offsets.begin());
+
+    if (c.offsets)
+        *c.offsets = exported_offsets.begin();
+    if (c.keys)
+        *c.keys = exported_keys.begin();
+    if (c.counts) {
+        auto lens = *c.counts = arena.alloc<ustore_length_t>(c.tasks_count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != c.tasks_count; ++i)
+            lens[i] = found_offsets[i + 1] - found_offsets[i];
+    }
+    read_scanned(c, arena, exported_keys.begin(), exported_offsets.begin());
+}
+
+/**
+ * @brief Removes the ranges from every shard, in parallel.
+ */
+void erase_sharded(rpc_client_t& db, ustore_erase_ranges_t& c) {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    std::size_t const shards_count = db.shards.size();
+    std::vector<shard_batch_t> batches(shards_count);
+    std::vector<std::size_t> all_shards(shards_count);
+    safe_section("Erasing from shards", c.error, [&] {
+        for (std::size_t shard_idx = 0; shard_idx != shards_count; ++shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            batch.shard = db.shards[shard_idx];
+            batch.collections.resize(c.tasks_count);
+            for (std::size_t i = 0; i != c.tasks_count; ++i)
+                batch.collections[i] = collections ? collections[i] : ustore_collection_main_k;
+            translate_collections(db, shard_idx, batch.collections, c.error);
+            return_if_error_m(c.error);
+            all_shards[shard_idx] = shard_idx;
+        }
+
+        for_each_shard(all_shards, [&](std::size_t shard_idx) {
+            shard_batch_t& batch = batches[shard_idx];
+            ustore_erase_ranges_t erase = c;
+            erase.db = batch.shard;
+            erase.error = &batch.error;
+            erase.collections = batch.collections.data();
+            erase.collections_stride = sizeof(ustore_collection_t);
+            ustore_erase_ranges(&erase);
+        });
+    });
+    return_if_error_m(c.error);
+    export_shards_error(batches, c.error);
+}
+
+/**
+ * @brief Lists the named collections, present on every shard, by their IDs on the first one.
+ */
+void list_sharded(rpc_client_t& db, ustore_collection_list_t& c, linked_memory_lock_t& arena) {
+
+    shard_call_t call;
+    ustore_size_t count = 0;
+    ustore_collection_t* ids = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_char_t* names = nullptr;
+    safe_section("Listing shards", c.error, [&] {
+        map_collections(db, c.error);
+        return_if_error_m(c.error);
+        call.shard = db.shards.front();
+        ustore_collection_list_t list {};
+        list.db = call.shard;
+        list.error = &call.error;
+        list.arena = &call.arena;
+        list.count = &count;
+        list.ids = &ids;
+        list.offsets = &offsets;
+        list.names = &names;
+        ustore_collection_list(&list);
+    });
+    return_if_error_m(c.error);
+    if (call.error) {
+        *c.error = call.error;
+        return;
+    }
+
+    // Collections, missing on some of the shards, can't be addressed, so they are skipped
+    std::lock_guard<std::mutex> lk(db.shards_collections_lock);
+    std::size_t exported_count = 0, exported_bytes = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        if (!db.shards_collections.count(ids[i]))
+            continue;
+        exported_count += 1;
+        exported_bytes += std::strlen(names + offsets[i]) + 1;
+    }
+    auto exported_ids = arena.alloc<ustore_collection_t>(exported_count, c.error);
+    return_if_error_m(c.error);
+    auto exported_offsets = arena.alloc<ustore_length_t>(exported_count + 1, c.error);
+    return_if_error_m(c.error);
+    auto exported_names = arena.alloc<ustore_char_t>(exported_bytes, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0, j = 0, offset = 0; i != count; ++i) {
+        if (!db.shards_collections.count(ids[i]))
+            continue;
+        std::size_t name_bytes = std::strlen(names + offsets[i]) + 1;
+        std::memcpy(exported_names.begin() + offset, names + offsets[i], name_bytes);
+        exported_ids[j] = ids[i];
+        exported_offsets[j] = static_cast<ustore_length_t>(offset);
+        offset += name_bytes;
+        ++j;
+    }
+    exported_offsets[exported_count] = static_cast<ustore_length_t>(exported_bytes);
+
+    if (c.count)
+        *c.count = static_cast<ustore_size_t>(exported_count);
+    if (c.ids)
+        *c.ids = exported_ids.begin();
+    if (c.offsets)
+        *c.offsets = exported_offsets.begin();
+    if (c.names)
+        *c.names = exported_names.begin();
+}
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
+
+void ustore_database_init(ustore_database_init_t* c_ptr) {
+
+    ustore_database_init_t& c = *c_ptr;
+
+    safe_section("Starting client", c.error, [&] {
+        if (!c.config || !std::strlen(c.config))
+            c.config = "grpc://0.0.0.0:38709";
+
+        // The URI may end with transport settings, like `?chunk=1024&compression=zstd&compression_min=4096`:
+        // the number of tasks packed into every record batch and the IPC compression codec
+        // used for batches of at least `compression_min` bytes in both directions.
+        // With `?cache=100000&cache_ttl=500` up to that many values are cached on this side.
+        // With `?async=32` that many operations from `ustore_submit()` may run concurrently.
+        // A comma-separated list of servers, like `grpc://a:38709,grpc://b:38709?chunk=1024`,
+        // makes a sharded client over separate clients of every server, sharing the settings.
+        std::string_view uri {c.config};
+        std::string_view locations = uri.substr(0, uri.find('?'));
+        if (locations.find(',') != std::string_view::npos) {
+            std::string_view params = uri.substr(locations.size());
+            auto db_ptr = std::make_unique<rpc_client_t>();
+            auto free_shards = [&] {
+                for (rpc_client_t* shard : db_ptr->shards)
+                    ustore_database_free(shard);
+                db_ptr->shards.clear();
+            };
+            std::vector<std::string> names;
+            for (std::size_t begin = 0; begin <= locations.size();) {
+                std::size_t end = std::min(locations.find(',', begin), locations.size());
+                names.emplace_back(locations.substr(begin, end - begin));
+                begin = end + 1;
+            }
+            db_ptr->ring.emplace(names);
+            for (std::string const& name : names) {
+                return_error_if_m(!name.empty(), c.error, args_wrong_k, "Empty server URI in the list");
+                std::string config = name + std::string(params);
+                ustore_database_t shard = nullptr;
+                ustore_database_init_t init {};
+                init.config = config.c_str();
+                init.error = c.error;
+                init.db = &shard;
+                ustore_database_init(&init);
+                if (*c.error)
+                    return free_shards();
+                db_ptr->shards.push_back(reinterpret_cast<rpc_client_t*>(shard));
+            }
+            if (auto async = uri_param(uri, kParamAsyncThreads); async)
+                db_ptr->async_threads = std::max<std::size_t>(parse_size(*async, async_threads_default_k), 1);
+            linked_memory(reinterpret_cast<ustore_arena_t*>(&db_ptr->arena),
+                          ustore_option_dont_discard_memory_k,
+                          c.error);
+            if (*c.error)
+                return free_shards();
+            *c.db = db_ptr.release();
+            return;
+        }
+
+        auto db_ptr = new rpc_client_t {};
+        if (auto chunk = uri_param(uri, kParamChunkSize); chunk)
+            db_ptr->chunk_tasks = parse_size(*chunk, chunk_tasks_default_k);
+        if (auto compression = uri_param(uri, kParamCompression); compression) {
+            return_error_if_m(parse_compression(*compression) != ar::Compression::UNCOMPRESSED,
+                              c.error,
+                              args_wrong_k,
+                              "Unknown compression, choose lz4 or zstd");
+            db_ptr->compression = std::string(*compression);
+        }
+        if (auto compression_min = uri_param(uri, kParamCompressionMin); compression_min)
+            db_ptr->compression_min_bytes = parse_size(*compression_min, compression_min_bytes_default_k);
+        if (auto async = uri_param(uri, kParamAsyncThreads); async)
+            db_ptr->async_threads = std::max<std::size_t>(parse_size(*async, async_threads_default_k), 1);
+        if (auto cache = uri_param(uri, kParamCache); cache && parse_size(*cache, 0)) {
+            auto ttl = uri_param(uri, kParamCacheTTL);
+            db_ptr->cache = std::make_unique<read_cache_t>(parse_size(*cache, 0),
+                                                           ttl ? parse_size(*ttl, cache_ttl_default_k)
+                                                               : cache_ttl_default_k);
+        }
+        uri = uri.substr(0, uri.find('?'));
+
+        auto maybe_location = arf::Location::Parse(std::string(uri));
+        return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Server URI");
+
+        auto maybe_flight_ptr = arf::FlightClient::Connect(*maybe_location);
+        return_error_if_m(maybe_flight_ptr.ok(), c.error, network_k, "Flight Client Connection");
+
+        linked_memory(reinterpret_cast<ustore_arena_t*>(&db_ptr->arena), ustore_option_dont_discard_memory_k, c.error);
+        return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Failed to allocate default arena.");
+        db_ptr->flight = maybe_flight_ptr.MoveValueUnsafe();
+        *c.db = db_ptr;
+    });
+}
+
+void ustore_read(ustore_read_t* c_ptr) {
+
+    ustore_read_t& c = *c_ptr;
+    traced_span_t span {"rpc_read", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    discard_readers(db, c.arena, c.options);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    if (is_sharded(db)) {
+        return_error_if_m(!c.transaction && !c.snapshot,
+                          c.error,
+                          missing_feature_k,
+                          "Sharded clients are non-transactional");
+        return read_sharded(db, c, arena);
+    }
+
+    // Transactions and snapshots must observe their own state, so they always ask the server
+    bool const bypass_cache = c.options & ustore_option_read_bypass_cache_k;
+    if (db.cache && !bypass_cache && !c.transaction && !c.snapshot && c.tasks_count)
+        read_cached(db, c, arena);
+    else
+        read_remote(db, c, arena);
+}
+
+void ustore_write(ustore_write_t* c_ptr) {
+
+    ustore_write_t& c = *c_ptr;
+    traced_span_t span {"rpc_write", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (is_sharded(db)) {
+        return_error_if_m(!c.transaction && !c.snapshot,
+                          c.error,
+                          missing_feature_k,
+                          "Sharded clients are non-transactional");
+        return write_sharded(db, c);
+    }
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
+    bits_view_t presences {c.presences};
+
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+
+    bool const same_collection = places.same_collection();
+    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+    bool const write_flush = c.options & ustore_option_write_flush_k;
+
+    bool const has_collections_column = collections && !same_collection;
+    constexpr bool has_keys_column = true;
+    bool const has_contents_column = vals != nullptr;
+
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(collections, places.size(), continuous.begin());
+        collections = {continuous.begin(), places.size()};
+    }
+
+    if (has_keys_column && !keys.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(keys, places.size(), continuous.begin());
+        keys = {continuous.begin(), places.size()};
+    }
+
+    // Check if the input is continuous and is already in an Arrow-compatible form
+    ustore_bytes_cptr_t joined_vals_begin = vals ? vals[0] : nullptr;
+    if (has_contents_column && !contents.is_continuous()) {
+        size_t total = transform_reduce_n(contents, places.size(), 0ul, std::mem_fn(&value_view_t::size));
+        auto joined_vals = arena.alloc<byte_t>(total, c.error);
+        return_if_error_m(c.error);
+        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
+        auto slots_presences = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        return_if_error_m(c.error);
+        std::memset(slots_presences.begin(), 0, slots_count);
+        auto joined_presences = bits_span_t(slots_presences.begin());
+
+        // Exports into the Arrow-compatible form
+        ustore_length_t exported_bytes = 0;
+        for (std::size_t i = 0; i != c.tasks_count; ++i) {
+            auto value = contents[i];
+            joined_presences[i] = value;
+            joined_offs[i] = exported_bytes;
+            std::memcpy(joined_vals.begin() + exported_bytes, value.begin(), value.size());
+            exported_bytes += value.size();
+        }
+        joined_offs[places.size()] = exported_bytes;
+
+        joined_vals_begin = (ustore_bytes_cptr_t)joined_vals.begin();
+        vals = {&joined_vals_begin, 0};
+        offs = {joined_offs.begin(), sizeof(ustore_key_t)};
+        presences = {slots_presences.begin()};
+    }
+    // It may be the case, that we only have `c.tasks_count` offsets instead of `c.tasks_count+1`,
+    // which won't be enough for Arrow.
+    else if (has_contents_column && !contents.is_arrow()) {
+        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        size_t slots_count = divide_round_up<std::size_t>(places.size(), CHAR_BIT);
+        auto slots_presences = arena.alloc<ustore_octet_t>(slots_count, c.error);
+        return_if_error_m(c.error);
+        std::memset(slots_presences.begin(), 0, slots_count);
+        auto joined_presences = bits_span_t(slots_presences.begin());
+
+        // Exports into the Arrow-compatible form
+        ustore_length_t exported_bytes = 0;
+        for (std::size_t i = 0; i != c.tasks_count; ++i) {
+            auto value = contents[i];
+            joined_presences[i] = value;
+            joined_offs[i] = exported_bytes;
+            exported_bytes += value.size();
+        }
+        joined_offs[places.size()] = exported_bytes;
+
+        vals = {&joined_vals_begin, 0};
+        offs = {joined_offs.begin(), sizeof(ustore_key_t)};
+        presences = {slots_presences.begin()};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    auto count_collections = has_collections_column + has_keys_column + has_contents_column;
+    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    if (has_collections_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
+            nullptr,
+            nullptr,
+            collections.get(),
+            input_schema_c.children[0],
+            input_array_c.children[0],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_keys_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            "keys",
+            ustore_doc_field<ustore_key_t>(),
+            nullptr,
+            nullptr,
+            keys.get(),
+            input_schema_c.children[has_collections_column],
+            input_array_c.children[has_collections_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_contents_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgVals.c_str(),
+            ustore_doc_field<value_view_t>(),
+            presences.get(),
+            offs.get(),
+            joined_vals_begin,
+            input_schema_c.children[has_collections_column + has_keys_column],
+            input_array_c.children[has_collections_column + has_keys_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    // Send everything over the network and wait for the response
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightWrite);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    if (!has_collections_column && collections)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    if (write_flush)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagFlushWrite);
+
+    // Send the request to server
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
+    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+
+    // This writer has already been started!
+    // ar_status = result->writer->Begin(batch_ptr->schema());
+    // return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+
+    // Every record batch is applied separately, so only transactions can be split into chunks
+    auto table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
+    auto max_chunk_tasks = c.transaction ? static_cast<int64_t>(db.chunk_tasks) : -1;
+    ar_status = result->writer->WriteTable(*table, max_chunk_tasks);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+
+    ar_status = result->writer->DoneWriting();
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+
+    // Transactional writes only become visible on commit, which drops the whole cache
+    if (db.cache && !c.transaction)
+        db.cache->drop(places);
+
+    // Fetch the responses
+    // std::shared_ptr<ar::Buffer> response;
+    // ar_status = result->reader->ReadMetadata(&response);
+    // return_error_if_m(ar_status.ok(), c.error, network_k, "No response");
+}
+
+void ustore_paths_write(ustore_paths_write_t* c_ptr) {
+
+    ustore_paths_write_t& c = *c_ptr;
+    traced_span_t span {"rpc_paths_write", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_length_t const> path_offs {c.paths_offsets, c.paths_offsets_stride};
+    strided_iterator_gt<ustore_length_t const> path_lens {c.paths_lengths, c.paths_lengths_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> paths {reinterpret_cast<ustore_bytes_cptr_t const*>(c.paths),
+                                                          c.paths_stride};
+
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values_bytes, c.values_bytes_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.values_offsets, c.values_offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.values_lengths, c.values_lengths_stride};
+    bits_view_t presences {c.values_presences};
+
+    places_arg_t places {collections, {}, {}, c.tasks_count};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+    contents_arg_t path_contents {nullptr, path_offs, path_lens, paths, c.tasks_count, c.path_separator};
+
+    bool const same_collection = places.same_collection();
+    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+    bool const write_flush = c.options & ustore_option_write_flush_k;
+
+    bool const has_collections_column = collections && !same_collection;
+    constexpr bool has_paths_column = true;
+    bool const has_contents_column = vals != nullptr;
+
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(collections, places.size(), continuous.begin());
+        collections = {continuous.begin(), places.size()};
+    }
+
+    ustore_bytes_cptr_t joined_vals_begin = vals ? vals[0] : nullptr;
+    if (has_contents_column) {
+        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        ustore_to_continuous_bin(contents,
+                                 places.size(),
+                                 c.tasks_count,
+                                 &joined_vals_begin,
+                                 joined_offs,
+                                 arena,
+                                 c.error);
+        offs = {joined_offs.begin(), sizeof(ustore_length_t)};
+    }
+
+    ustore_bytes_cptr_t joined_paths_begin = paths[0];
+    if (has_paths_column) {
+        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        ustore_to_continuous_bin(path_contents,
+                                 places.size(),
+                                 c.tasks_count,
+                                 &joined_paths_begin,
+                                 joined_offs,
+                                 arena,
+                                 c.error);
+        path_offs = {joined_offs.begin(), sizeof(ustore_length_t)};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    auto count_collections = has_collections_column + has_paths_column + has_contents_column;
+    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    if (has_collections_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
+            nullptr,
+            nullptr,
+            collections.get(),
+            input_schema_c.children[0],
+            input_array_c.children[0],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_paths_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgPaths.c_str(),
+            ustore_doc_field<ustore_str_view_t>(),
+            nullptr,
+            path_offs.get(),
+            joined_paths_begin,
+            input_schema_c.children[has_collections_column],
+            input_array_c.children[has_collections_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_contents_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgVals.c_str(),
+            ustore_doc_field<value_view_t>(),
+            presences.get(),
+            offs.get(),
+            joined_vals_begin,
+            input_schema_c.children[has_collections_column + has_paths_column],
+            input_array_c.children[has_collections_column + has_paths_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    // Send everything over the network and wait for the response
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightWritePath);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    if (!has_collections_column && collections)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    if (write_flush)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagFlushWrite);
+
+    // Send the request to server
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
+    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+
+    // This writer has already been started!
+    // ar_status = result->writer->Begin(batch_ptr->schema());
+    // return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+
+    // Every record batch is applied separately, so only transactions can be split into chunks
+    auto table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
+    auto max_chunk_tasks = c.transaction ? static_cast<int64_t>(db.chunk_tasks) : -1;
+    ar_status = result->writer->WriteTable(*table, max_chunk_tasks);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+
+    ar_status = result->writer->DoneWriting();
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+
+    // Paths are hashed into buckets, which may share entries with other paths
+    if (db.cache && !c.transaction)
+        db.cache->drop_all();
+
+    // Fetch the responses
+    // std::shared_ptr<ar::Buffer> response;
+    // ar_status = result->reader->ReadMetadata(&response);
+    // return_error_if_m(ar_status.ok(), c.error, network_k, "No response");
+}
+
+void ustore_paths_match(ustore_paths_match_t* c_ptr) {
+
+    ustore_paths_match_t& c = *c_ptr;
+    traced_span_t span {"rpc_paths_match", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_length_t const> count_limits {c.match_counts_limits, c.match_counts_limits_stride};
+
+    strided_iterator_gt<ustore_length_t const> pattern_offs {c.patterns_offsets, c.patterns_offsets_stride};
+    strided_iterator_gt<ustore_length_t const> pattern_lens {c.patterns_lengths, c.patterns_lengths_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> patterns {reinterpret_cast<ustore_bytes_cptr_t const*>(c.patterns),
+                                                             c.patterns_stride};
+
+    strided_iterator_gt<ustore_length_t const> previous_offs {c.previous_offsets, c.previous_offsets_stride};
+    strided_iterator_gt<ustore_length_t const> previous_lens {c.previous_lengths, c.previous_lengths_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> previous {reinterpret_cast<ustore_bytes_cptr_t const*>(c.previous),
+                                                             c.previous_stride};
+
+    places_arg_t places {collections, {}, {}, c.tasks_count};
+    contents_arg_t pattern_contents {nullptr, pattern_offs, pattern_lens, patterns, c.tasks_count, c.path_separator};
+    contents_arg_t previous_contents {nullptr, previous_offs, previous_lens, previous, c.tasks_count, c.path_separator};
 
-    // Send everything over the network and wait for the response
     ar::Status ar_status;
     arrow_mem_pool_t pool(arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
 
     // Configure the `cmd` descriptor
+    bool const same_collection = places.same_collection();
+    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+    bool const request_only_counts = c.match_counts && !c.paths_strings;
+    char const* partial_mode = request_only_counts //
+                                   ? kParamReadPartPresences.c_str()
+                                   : nullptr;
+
     arf::FlightDescriptor descriptor;
     descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightWrite);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightMatchPath);
     if (c.transaction)
         fmt::format_to(std::back_inserter(descriptor.cmd),
                        "{}=0x{:0>16x}&",
                        kParamTransactionID,
                        std::uintptr_t(c.transaction));
-    if (!has_collections_column && collections)
+    if (same_named_collection)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    if (write_flush)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagFlushWrite);
+    if (partial_mode)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
+    export_options(db, c.options, descriptor.cmd);
+
+    bool const has_collections_column = collections && !same_collection;
+    bool const has_previous_column = previous != nullptr;
+    bool const has_limits_column = count_limits != nullptr;
+
+    // If all requests map to the same collection, we can avoid passing its ID
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
+        return_if_error_m(c.error);
+        transform_n(collections, places.count, continuous.begin());
+        collections = {continuous.begin(), sizeof(ustore_collection_t)};
+    }
+
+    if (has_limits_column && !count_limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(count_limits, places.size(), continuous.begin());
+        count_limits = {continuous.begin(), places.size()};
+    }
+
+    ustore_bytes_cptr_t joined_patrns_begin = patterns[0];
+    auto joined_patrns_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+    return_if_error_m(c.error);
+    ustore_to_continuous_bin(pattern_contents,
+                             places.size(),
+                             c.tasks_count,
+                             &joined_patrns_begin,
+                             joined_patrns_offs,
+                             arena,
+                             c.error);
+    pattern_offs = {joined_patrns_offs.begin(), sizeof(ustore_length_t)};
+
+    ustore_bytes_cptr_t joined_prevs_begin;
+    if (has_previous_column) {
+        joined_prevs_begin = previous[0];
+        auto joined_prevs_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        return_if_error_m(c.error);
+        ustore_to_continuous_bin(previous_contents,
+                                 places.size(),
+                                 c.tasks_count,
+                                 &joined_prevs_begin,
+                                 joined_prevs_offs,
+                                 arena,
+                                 c.error);
+        previous_offs = {joined_prevs_offs.begin(), sizeof(ustore_length_t)};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c, output_array_c;
+    ArrowSchema input_schema_c, output_schema_c;
+    auto count_collections = has_collections_column + has_limits_column + has_previous_column + 1;
+    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    if (has_collections_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
+            nullptr,
+            nullptr,
+            collections.get(),
+            input_schema_c.children[0],
+            input_array_c.children[0],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_limits_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCountLimits.c_str(),
+            ustore_doc_field<ustore_length_t>(),
+            nullptr,
+            nullptr,
+            count_limits.get(),
+            input_schema_c.children[has_collections_column],
+            input_array_c.children[has_collections_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_previous_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgPrevPatterns.c_str(),
+            ustore_doc_field<ustore_str_view_t>(),
+            nullptr,
+            previous_offs.get(),
+            joined_prevs_begin,
+            input_schema_c.children[has_collections_column + has_limits_column],
+            input_array_c.children[has_collections_column + has_limits_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    ustore_to_arrow_column( //
+        c.tasks_count,
+        kArgPatterns.c_str(),
+        ustore_doc_field<ustore_str_view_t>(),
+        nullptr,
+        pattern_offs.get(),
+        joined_patrns_begin,
+        input_schema_c.children[has_collections_column + has_limits_column + has_previous_column],
+        input_array_c.children[has_collections_column + has_limits_column + has_previous_column],
+        c.error);
+    return_if_error_m(c.error);
 
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    if (batch_ptr->num_rows() == 0)
+        return;
+    ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
+    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
-    // This writer has already been started!
-    // ar_status = result->writer->Begin(batch_ptr->schema());
-    // return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+    ar_status = result->writer->Begin(batch_ptr->schema());
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
 
-    auto table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*table);
+    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
+    ar_status = result->writer->WriteTable(*input_table);
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
 
     ar_status = result->writer->DoneWriting();
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
 
     // Fetch the responses
-    // std::shared_ptr<ar::Buffer> response;
-    // ar_status = result->reader->ReadMetadata(&response);
-    // return_error_if_m(ar_status.ok(), c.error, network_k, "No response");
+    // Requesting `ToTable` might be more efficient than concatenating and
+    // reallocating directly from our arena, as the underlying Arrow implementation
+    // may know the length of the entire dataset.
+    auto maybe_table = result->reader->ToTable();
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+    return_error_if_m(table->num_columns() >= 1, c.error, error_unknown_k, "Expecting one or two columns");
+
+    auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(0)->chunk(0));
+    *c.match_counts = (ustore_length_t*)array->raw_values();
+    if (!request_only_counts) {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(1)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
+        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
+
+        if (c.paths_offsets)
+            *c.paths_offsets = offs_ptr;
+        if (c.paths_strings)
+            *c.paths_strings = reinterpret_cast<ustore_char_t*>(data_ptr);
+    }
+
+    hold_reader(db, c.arena, std::move(result->reader));
 }
 
-void ustore_paths_write(ustore_paths_write_t* c_ptr) {
+void ustore_paths_read(ustore_paths_read_t* c_ptr) {
 
-    ustore_paths_write_t& c = *c_ptr;
+    ustore_paths_read_t& c = *c_ptr;
+    traced_span_t span {"rpc_paths_read", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
-    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_length_t const> path_offs {c.paths_offsets, c.paths_offsets_stride};
     strided_iterator_gt<ustore_length_t const> path_lens {c.paths_lengths, c.paths_lengths_stride};
     strided_iterator_gt<ustore_bytes_cptr_t const> paths {reinterpret_cast<ustore_bytes_cptr_t const*>(c.paths),
                                                           c.paths_stride};
 
-    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values_bytes, c.values_bytes_stride};
-    strided_iterator_gt<ustore_length_t const> offs {c.values_offsets, c.values_offsets_stride};
-    strided_iterator_gt<ustore_length_t const> lens {c.values_lengths, c.values_lengths_stride};
-    bits_view_t presences {c.values_presences};
-
     places_arg_t places {collections, {}, {}, c.tasks_count};
-    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
     contents_arg_t path_contents {nullptr, path_offs, path_lens, paths, c.tasks_count, c.path_separator};
 
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const write_flush = c.options & ustore_option_write_flush_k;
+    bool const request_only_presences = c.presences && !c.lengths && !c.values;
+    bool const request_only_lengths = c.lengths && !c.values;
+    char const* partial_mode = request_only_presences //
+                                   ? kParamReadPartPresences.c_str()
+                                   : request_only_lengths //
+                                         ? kParamReadPartLengths.c_str()
+                                         : nullptr;
+
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightReadPath);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (same_named_collection)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    if (partial_mode)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
     constexpr bool has_paths_column = true;
-    bool const has_contents_column = vals != nullptr;
 
+    // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
-        return_if_error_m(c.error);
-        transform_n(collections, places.size(), continuous.begin());
-        collections = {continuous.begin(), places.size()};
-    }
-
-    ustore_bytes_cptr_t joined_vals_begin = vals ? vals[0] : nullptr;
-    if (has_contents_column) {
-        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
         return_if_error_m(c.error);
-        ustore_to_continuous_bin(contents,
-                                 places.size(),
-                                 c.tasks_count,
-                                 &joined_vals_begin,
-                                 joined_offs,
-                                 arena,
-                                 c.error);
-        offs = {joined_offs.begin(), sizeof(ustore_length_t)};
+        transform_n(collections, places.count, continuous.begin());
+        collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
 
+    // Check if the paths are continuous and are already in an Arrow-compatible form
     ustore_bytes_cptr_t joined_paths_begin = paths[0];
     if (has_paths_column) {
         auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
@@ -521,10 +2008,10 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     }
 
     // Now build-up the Arrow representation
-    ArrowArray input_array_c;
-    ArrowSchema input_schema_c;
-    auto count_collections = has_collections_column + has_paths_column + has_contents_column;
-    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
+    ArrowArray input_array_c, output_array_c;
+    ArrowSchema input_schema_c, output_schema_c;
+    auto count_collections = has_collections_column + has_paths_column;
+    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
     if (has_collections_column)
@@ -553,168 +2040,130 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
             c.error);
     return_if_error_m(c.error);
 
-    if (has_contents_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgVals.c_str(),
-            ustore_doc_field<value_view_t>(),
-            presences.get(),
-            offs.get(),
-            joined_vals_begin,
-            input_schema_c.children[has_collections_column + has_paths_column],
-            input_array_c.children[has_collections_column + has_paths_column],
-            c.error);
-    return_if_error_m(c.error);
-
-    // Send everything over the network and wait for the response
-    ar::Status ar_status;
-    arrow_mem_pool_t pool(arena);
-    arf::FlightCallOptions options = arrow_call_options(pool);
-
-    // Configure the `cmd` descriptor
-    arf::FlightDescriptor descriptor;
-    descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightWritePath);
-    if (c.transaction)
-        fmt::format_to(std::back_inserter(descriptor.cmd),
-                       "{}=0x{:0>16x}&",
-                       kParamTransactionID,
-                       std::uintptr_t(c.transaction));
-    if (!has_collections_column && collections)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    if (write_flush)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagFlushWrite);
-
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    if (batch_ptr->num_rows() == 0)
+        return;
+    ar::Status ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
+    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
-    // This writer has already been started!
-    // ar_status = result->writer->Begin(batch_ptr->schema());
-    // return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+    // Large requests are streamed in chunks, receiving the answers in between
+    auto maybe_table = exchange_in_chunks(*result, batch_ptr, db.chunk_tasks, pool);
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
 
-    auto table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*table);
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+    if (request_only_presences) {
+        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt8Type>>(table->column(0)->chunk(0));
+        *c.presences = (ustore_octet_t*)array->raw_values();
+    }
+    else if (request_only_lengths) {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto lens_ptr = (ustore_length_t*)array->value_offsets()->data();
 
-    ar_status = result->writer->DoneWriting();
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+        if (c.lengths)
+            *c.lengths =
+                presences_ptr //
+                    ? arrow_replace_missing_scalars(presences_ptr, lens_ptr, table->num_rows(), ustore_length_missing_k)
+                    : lens_ptr;
+        if (c.presences)
+            *c.presences = presences_ptr;
+    }
+    else {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
+        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
 
-    // Fetch the responses
-    // std::shared_ptr<ar::Buffer> response;
-    // ar_status = result->reader->ReadMetadata(&response);
-    // return_error_if_m(ar_status.ok(), c.error, network_k, "No response");
+        if (c.presences)
+            *c.presences = presences_ptr;
+        if (c.offsets)
+            *c.offsets = offs_ptr;
+        if (c.values)
+            *c.values = data_ptr;
+
+        if (c.lengths) {
+            auto lens = *c.lengths = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+            return_if_error_m(c.error);
+            if (presences_ptr) {
+                auto presences = bits_view_t(presences_ptr);
+                for (std::size_t i = 0; i != places.count; ++i)
+                    lens[i] = presences[i] ? (offs_ptr[i + 1] - offs_ptr[i]) : ustore_length_missing_k;
+            }
+            else {
+                for (std::size_t i = 0; i != places.count; ++i)
+                    lens[i] = offs_ptr[i + 1] - offs_ptr[i];
+            }
+        }
+    }
+
+    hold_reader(db, c.arena, std::move(result->reader));
 }
 
-void ustore_paths_match(ustore_paths_match_t* c_ptr) {
+void ustore_scan(ustore_scan_t* c_ptr) {
 
-    ustore_paths_match_t& c = *c_ptr;
+    ustore_scan_t& c = *c_ptr;
+    traced_span_t span {"rpc_scan", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+    discard_readers(db, c.arena, c.options);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_length_t const> count_limits {c.match_counts_limits, c.match_counts_limits_stride};
-
-    strided_iterator_gt<ustore_length_t const> pattern_offs {c.patterns_offsets, c.patterns_offsets_stride};
-    strided_iterator_gt<ustore_length_t const> pattern_lens {c.patterns_lengths, c.patterns_lengths_stride};
-    strided_iterator_gt<ustore_bytes_cptr_t const> patterns {reinterpret_cast<ustore_bytes_cptr_t const*>(c.patterns),
-                                                             c.patterns_stride};
-
-    strided_iterator_gt<ustore_length_t const> previous_offs {c.previous_offsets, c.previous_offsets_stride};
-    strided_iterator_gt<ustore_length_t const> previous_lens {c.previous_lengths, c.previous_lengths_stride};
-    strided_iterator_gt<ustore_bytes_cptr_t const> previous {reinterpret_cast<ustore_bytes_cptr_t const*>(c.previous),
-                                                             c.previous_stride};
-
-    places_arg_t places {collections, {}, {}, c.tasks_count};
-    contents_arg_t pattern_contents {nullptr, pattern_offs, pattern_lens, patterns, c.tasks_count, c.path_separator};
-    contents_arg_t previous_contents {nullptr, previous_offs, previous_lens, previous, c.tasks_count, c.path_separator};
+    if (is_sharded(db)) {
+        return_error_if_m(!c.transaction && !c.snapshot,
+                          c.error,
+                          missing_feature_k,
+                          "Sharded clients are non-transactional");
+        return scan_sharded(db, c, arena);
+    }
 
-    ar::Status ar_status;
-    arrow_mem_pool_t pool(arena);
-    arf::FlightCallOptions options = arrow_call_options(pool);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    scans_arg_t scans {collections, start_keys, limits, c.tasks_count};
+    places_arg_t places {collections, start_keys, {}, c.tasks_count};
 
-    // Configure the `cmd` descriptor
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const request_only_counts = c.match_counts && !c.paths_strings;
-    char const* partial_mode = request_only_counts //
-                                   ? kParamReadPartPresences.c_str()
-                                   : nullptr;
-
-    arf::FlightDescriptor descriptor;
-    descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightMatchPath);
-    if (c.transaction)
-        fmt::format_to(std::back_inserter(descriptor.cmd),
-                       "{}=0x{:0>16x}&",
-                       kParamTransactionID,
-                       std::uintptr_t(c.transaction));
-    if (same_named_collection)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    if (partial_mode)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    bool const write_flush = c.options & ustore_option_write_flush_k;
 
-    bool const has_collections_column = collections && !same_collection;
-    bool const has_previous_column = previous != nullptr;
-    bool const has_limits_column = count_limits != nullptr;
+    bool const has_collections_column = !same_collection;
+    constexpr bool has_start_keys_column = true;
+    constexpr bool has_lens_column = true;
 
-    // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
+        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
         return_if_error_m(c.error);
-        transform_n(collections, places.count, continuous.begin());
-        collections = {continuous.begin(), sizeof(ustore_collection_t)};
+        transform_n(collections, places.size(), continuous.begin());
+        collections = {continuous.begin(), places.size()};
     }
 
-    if (has_limits_column && !count_limits.is_continuous()) {
-        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+    if (has_start_keys_column && !start_keys.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
         return_if_error_m(c.error);
-        transform_n(count_limits, places.size(), continuous.begin());
-        count_limits = {continuous.begin(), places.size()};
+        transform_n(start_keys, places.size(), continuous.begin());
+        start_keys = {continuous.begin(), places.size()};
     }
 
-    ustore_bytes_cptr_t joined_patrns_begin = patterns[0];
-    auto joined_patrns_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
-    return_if_error_m(c.error);
-    ustore_to_continuous_bin(pattern_contents,
-                             places.size(),
-                             c.tasks_count,
-                             &joined_patrns_begin,
-                             joined_patrns_offs,
-                             arena,
-                             c.error);
-    pattern_offs = {joined_patrns_offs.begin(), sizeof(ustore_length_t)};
-
-    ustore_bytes_cptr_t joined_prevs_begin;
-    if (has_previous_column) {
-        joined_prevs_begin = previous[0];
-        auto joined_prevs_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+    if (has_lens_column && !limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
         return_if_error_m(c.error);
-        ustore_to_continuous_bin(previous_contents,
-                                 places.size(),
-                                 c.tasks_count,
-                                 &joined_prevs_begin,
-                                 joined_prevs_offs,
-                                 arena,
-                                 c.error);
-        previous_offs = {joined_prevs_offs.begin(), sizeof(ustore_length_t)};
+        transform_n(limits, places.size(), continuous.begin());
+        limits = {continuous.begin(), places.size()};
     }
 
     // Now build-up the Arrow representation
     ArrowArray input_array_c, output_array_c;
     ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_limits_column + has_previous_column + 1;
-    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
+    auto count_collections = has_collections_column + has_start_keys_column + has_lens_column;
+    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
     if (has_collections_column)
@@ -730,43 +2179,49 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
             c.error);
     return_if_error_m(c.error);
 
-    if (has_limits_column)
+    if (has_start_keys_column)
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgCountLimits.c_str(),
-            ustore_doc_field<ustore_length_t>(),
+            kArgScanStarts.c_str(),
+            ustore_doc_field<ustore_key_t>(),
             nullptr,
             nullptr,
-            count_limits.get(),
+            start_keys.get(),
             input_schema_c.children[has_collections_column],
             input_array_c.children[has_collections_column],
             c.error);
     return_if_error_m(c.error);
 
-    if (has_previous_column)
+    if (has_lens_column)
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgPrevPatterns.c_str(),
-            ustore_doc_field<ustore_str_view_t>(),
+            kArgCountLimits.c_str(),
+            ustore_doc_field<ustore_length_t>(),
             nullptr,
-            previous_offs.get(),
-            joined_prevs_begin,
-            input_schema_c.children[has_collections_column + has_limits_column],
-            input_array_c.children[has_collections_column + has_limits_column],
+            nullptr,
+            limits.get(),
+            input_schema_c.children[has_collections_column + has_start_keys_column],
+            input_array_c.children[has_collections_column + has_start_keys_column],
             c.error);
     return_if_error_m(c.error);
 
-    ustore_to_arrow_column( //
-        c.tasks_count,
-        kArgPatterns.c_str(),
-        ustore_doc_field<ustore_str_view_t>(),
-        nullptr,
-        pattern_offs.get(),
-        joined_patrns_begin,
-        input_schema_c.children[has_collections_column + has_limits_column + has_previous_column],
-        input_array_c.children[has_collections_column + has_limits_column + has_previous_column],
-        c.error);
-    return_if_error_m(c.error);
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightScan);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (same_named_collection)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    export_options(db, c.options, descriptor.cmd);
 
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
@@ -775,6 +2230,8 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
+    ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
     ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
@@ -795,44 +2252,45 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
     auto maybe_table = result->reader->ToTable();
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
-    return_error_if_m(table->num_columns() >= 1, c.error, error_unknown_k, "Expecting one or two columns");
 
-    auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(0)->chunk(0));
-    *c.match_counts = (ustore_length_t*)array->raw_values();
-    if (!request_only_counts) {
-        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(1)->chunk(0));
-        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
-        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
-        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
+    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
+    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
+    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
+    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+    if (table->schema()->field(0)->name() == kArgKeysDeltas)
+        deltas_to_keys(data_ptr, static_cast<std::size_t>(keys_array->length()));
 
-        if (c.paths_offsets)
-            *c.paths_offsets = offs_ptr;
-        if (c.paths_strings)
-            *c.paths_strings = reinterpret_cast<ustore_char_t*>(data_ptr);
+    if (c.offsets)
+        *c.offsets = offs_ptr;
+    if (c.keys)
+        *c.keys = data_ptr;
+    if (c.counts) {
+        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i)
+            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
     }
 
-    db.readers.push_back(std::move(result->reader));
+    hold_reader(db, c.arena, std::move(result->reader));
+    read_scanned(c, arena, data_ptr, offs_ptr);
 }
 
-void ustore_paths_read(ustore_paths_read_t* c_ptr) {
+void ustore_sample(ustore_sample_t* c_ptr) {
 
-    ustore_paths_read_t& c = *c_ptr;
+    ustore_sample_t& c = *c_ptr;
+    traced_span_t span {"rpc_sample", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_length_t const> path_offs {c.paths_offsets, c.paths_offsets_stride};
-    strided_iterator_gt<ustore_length_t const> path_lens {c.paths_lengths, c.paths_lengths_stride};
-    strided_iterator_gt<ustore_bytes_cptr_t const> paths {reinterpret_cast<ustore_bytes_cptr_t const*>(c.paths),
-                                                          c.paths_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
 
     places_arg_t places {collections, {}, {}, c.tasks_count};
-    contents_arg_t path_contents {nullptr, path_offs, path_lens, paths, c.tasks_count, c.path_separator};
 
     ar::Status ar_status;
     arrow_mem_pool_t pool(arena);
@@ -841,17 +2299,10 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     // Configure the `cmd` descriptor
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const request_only_presences = c.presences && !c.lengths && !c.values;
-    bool const request_only_lengths = c.lengths && !c.values;
-    char const* partial_mode = request_only_presences //
-                                   ? kParamReadPartPresences.c_str()
-                                   : request_only_lengths //
-                                         ? kParamReadPartLengths.c_str()
-                                         : nullptr;
 
     arf::FlightDescriptor descriptor;
     descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightReadPath);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightSample);
     if (c.transaction)
         fmt::format_to(std::back_inserter(descriptor.cmd),
                        "{}=0x{:0>16x}&",
@@ -860,12 +2311,10 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
     if (same_named_collection)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    if (partial_mode)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
-    constexpr bool has_paths_column = true;
+    bool const has_limits_column = true;
 
     // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
@@ -875,25 +2324,17 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
         collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
 
-    // Check if the paths are continuous and are already in an Arrow-compatible form
-    ustore_bytes_cptr_t joined_paths_begin = paths[0];
-    if (has_paths_column) {
-        auto joined_offs = arena.alloc<ustore_length_t>(places.size() + 1, c.error);
+    if (has_limits_column && !limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
         return_if_error_m(c.error);
-        ustore_to_continuous_bin(path_contents,
-                                 places.size(),
-                                 c.tasks_count,
-                                 &joined_paths_begin,
-                                 joined_offs,
-                                 arena,
-                                 c.error);
-        path_offs = {joined_offs.begin(), sizeof(ustore_length_t)};
+        transform_n(limits, places.size(), continuous.begin());
+        limits = {continuous.begin(), places.size()};
     }
 
     // Now build-up the Arrow representation
     ArrowArray input_array_c, output_array_c;
     ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_paths_column;
+    auto count_collections = has_collections_column + has_limits_column;
     ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
@@ -910,14 +2351,14 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
             c.error);
     return_if_error_m(c.error);
 
-    if (has_paths_column)
+    if (has_limits_column)
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgPaths.c_str(),
-            ustore_doc_field<ustore_str_view_t>(),
+            kArgCountLimits.c_str(),
+            ustore_doc_field<ustore_length_t>(),
             nullptr,
-            path_offs.get(),
-            joined_paths_begin,
+            nullptr,
+            limits.get(),
             input_schema_c.children[has_collections_column],
             input_array_c.children[has_collections_column],
             c.error);
@@ -930,8 +2371,10 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
+    ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
     ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
-    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to Get with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
@@ -951,250 +2394,305 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
 
-    if (request_only_presences) {
-        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt8Type>>(table->column(0)->chunk(0));
-        *c.presences = (ustore_octet_t*)array->raw_values();
-    }
-    else if (request_only_lengths) {
-        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
-        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
-        auto lens_ptr = (ustore_length_t*)array->value_offsets()->data();
+    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
+    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
+    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
+    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+    if (table->schema()->field(0)->name() == kArgKeysDeltas)
+        deltas_to_keys(data_ptr, static_cast<std::size_t>(keys_array->length()));
 
-        if (c.lengths)
-            *c.lengths =
-                presences_ptr //
-                    ? arrow_replace_missing_scalars(presences_ptr, lens_ptr, table->num_rows(), ustore_length_missing_k)
-                    : lens_ptr;
-        if (c.presences)
-            *c.presences = presences_ptr;
+    if (c.offsets)
+        *c.offsets = offs_ptr;
+    if (c.keys)
+        *c.keys = data_ptr;
+    if (c.counts) {
+        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i)
+            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
     }
-    else {
-        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
-        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
-        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
-        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
 
-        if (c.presences)
-            *c.presences = presences_ptr;
-        if (c.offsets)
-            *c.offsets = offs_ptr;
-        if (c.values)
-            *c.values = data_ptr;
+    hold_reader(db, c.arena, std::move(result->reader));
+}
 
-        if (c.lengths) {
-            auto lens = *c.lengths = arena.alloc<ustore_length_t>(places.count, c.error).begin();
-            return_if_error_m(c.error);
-            if (presences_ptr) {
-                auto presences = bits_view_t(presences_ptr);
-                for (std::size_t i = 0; i != places.count; ++i)
-                    lens[i] = presences[i] ? (offs_ptr[i + 1] - offs_ptr[i]) : ustore_length_missing_k;
-            }
-            else {
-                for (std::size_t i = 0; i != places.count; ++i)
-                    lens[i] = offs_ptr[i + 1] - offs_ptr[i];
-            }
-        }
+void ustore_measure(ustore_measure_t* c_ptr) {
+
+    ustore_measure_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+}
+
+void ustore_erase_ranges(ustore_erase_ranges_t* c_ptr) {
+
+    ustore_erase_ranges_t& c = *c_ptr;
+    traced_span_t span {"rpc_erase_ranges", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(!c.tasks_count || (c.start_keys && c.end_keys), c.error, args_combo_k, "Need range bounds!");
+    if (!c.tasks_count)
+        return;
+
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (is_sharded(db))
+        return erase_sharded(db, c);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+
+    // Ranges are shipped as a flat buffer of `(collection, start, end)` triplets
+    constexpr std::size_t triplet_size_k = sizeof(ustore_collection_t) + 2 * sizeof(ustore_key_t);
+    std::string body;
+    safe_section("Packing ranges", c.error, [&] { body.resize(c.tasks_count * triplet_size_k); });
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        ustore_collection_t collection = collections ? collections[i] : ustore_collection_main_k;
+        char* triplet = body.data() + i * triplet_size_k;
+        std::memcpy(triplet, &collection, sizeof(ustore_collection_t));
+        std::memcpy(triplet + sizeof(ustore_collection_t), &start_keys[i], sizeof(ustore_key_t));
+        std::memcpy(triplet + sizeof(ustore_collection_t) + sizeof(ustore_key_t), &end_keys[i], sizeof(ustore_key_t));
     }
 
-    db.readers.push_back(std::move(result->reader));
+    arf::Action action;
+    fmt::format_to(std::back_inserter(action.type), "{}?", kFlightErase);
+    if (c.options & ustore_option_write_flush_k)
+        fmt::format_to(std::back_inserter(action.type), "{}&", kParamFlagFlushWrite);
+    action.body = ar::Buffer::FromString(std::move(body));
+
+    std::lock_guard<std::mutex> lk(db.arena_lock);
+    arrow_mem_pool_t pool(db.arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    if (db.cache)
+        db.cache->drop_all();
+    return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
-void ustore_scan(ustore_scan_t* c_ptr) {
+/*********************************************************/
+/*****************	 Remote Modalities	  ****************/
+/*********************************************************/
 
-    ustore_scan_t& c = *c_ptr;
+void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
+
+    ustore_graph_find_edges_t& c = *c_ptr;
+    traced_span_t span {"rpc_graph_find_edges", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.degrees_per_vertex, c.error, args_wrong_k, "Degrees must always be exported");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
+    if (!c.tasks_count)
+        return;
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
-    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
-    scans_arg_t scans {collections, start_keys, limits, c.tasks_count};
-    places_arg_t places {collections, start_keys, {}, c.tasks_count};
+    strided_iterator_gt<ustore_key_t const> vertices {c.vertices, c.vertices_stride};
+    strided_iterator_gt<ustore_vertex_role_t const> roles {c.roles, c.roles_stride};
+    strided_iterator_gt<ustore_key_t const> mins {c.neighbors_min, c.neighbors_min_stride};
+    strided_iterator_gt<ustore_key_t const> maxs {c.neighbors_max, c.neighbors_max_stride};
+    places_arg_t places {collections, vertices, {}, c.tasks_count};
+
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
 
+    // Configure the `cmd` descriptor
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const write_flush = c.options & ustore_option_write_flush_k;
+    bool const request_only_degrees = !c.edges_per_vertex;
 
-    bool const has_collections_column = !same_collection;
-    constexpr bool has_start_keys_column = true;
-    constexpr bool has_lens_column = true;
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightFindEdges);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (same_named_collection)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    if (request_only_degrees)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, kParamReadPartLengths);
+    export_options(db, c.options, descriptor.cmd);
+
+    bool const has_collections_column = collections && !same_collection;
+    bool const has_roles_column = bool(roles);
+    bool const has_mins_column = bool(mins);
+    bool const has_maxs_column = bool(maxs);
 
+    // All the integer columns must be properly strided
     if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
+        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
         return_if_error_m(c.error);
-        transform_n(collections, places.size(), continuous.begin());
-        collections = {continuous.begin(), places.size()};
+        transform_n(collections, places.count, continuous.begin());
+        collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
-
-    if (has_start_keys_column && !start_keys.is_continuous()) {
-        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
+    if (!vertices.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.count, c.error);
         return_if_error_m(c.error);
-        transform_n(start_keys, places.size(), continuous.begin());
-        start_keys = {continuous.begin(), places.size()};
+        transform_n(vertices, places.count, continuous.begin());
+        vertices = {continuous.begin(), sizeof(ustore_key_t)};
     }
-
-    if (has_lens_column && !limits.is_continuous()) {
-        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+    if (has_mins_column && !mins.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.count, c.error);
         return_if_error_m(c.error);
-        transform_n(limits, places.size(), continuous.begin());
-        limits = {continuous.begin(), places.size()};
+        transform_n(mins, places.count, continuous.begin());
+        mins = {continuous.begin(), sizeof(ustore_key_t)};
+    }
+    if (has_maxs_column && !maxs.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.count, c.error);
+        return_if_error_m(c.error);
+        transform_n(maxs, places.count, continuous.begin());
+        maxs = {continuous.begin(), sizeof(ustore_key_t)};
     }
 
-    // Now build-up the Arrow representation
-    ArrowArray input_array_c, output_array_c;
-    ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_start_keys_column + has_lens_column;
-    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
-    return_if_error_m(c.error);
-
-    if (has_collections_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgCols.c_str(),
-            ustore_doc_field<ustore_collection_t>(),
-            nullptr,
-            nullptr,
-            collections.get(),
-            input_schema_c.children[0],
-            input_array_c.children[0],
-            c.error);
+    // The size of C enums depends on the compiler, so roles are shipped as octets
+    auto roles_octets = arena.alloc<ustore_octet_t>(has_roles_column ? places.count : 0, c.error);
     return_if_error_m(c.error);
+    for (std::size_t i = 0; i != roles_octets.size(); ++i)
+        roles_octets[i] = static_cast<ustore_octet_t>(roles[i]);
 
-    if (has_start_keys_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgScanStarts.c_str(),
-            ustore_doc_field<ustore_key_t>(),
-            nullptr,
-            nullptr,
-            start_keys.get(),
-            input_schema_c.children[has_collections_column],
-            input_array_c.children[has_collections_column],
-            c.error);
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    auto count_columns = has_collections_column + 1 + has_roles_column + has_mins_column + has_maxs_column;
+    ustore_to_arrow_schema(places.count, count_columns, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
-    if (has_lens_column)
+    std::size_t column_idx = 0;
+    auto export_column = [&](std::string const& name, ustore_doc_field_type_t type, void const* contents) {
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgCountLimits.c_str(),
-            ustore_doc_field<ustore_length_t>(),
+            name.c_str(),
+            type,
             nullptr,
             nullptr,
-            limits.get(),
-            input_schema_c.children[has_collections_column + has_start_keys_column],
-            input_array_c.children[has_collections_column + has_start_keys_column],
+            contents,
+            input_schema_c.children[column_idx],
+            input_array_c.children[column_idx],
             c.error);
+        ++column_idx;
+    };
+    if (has_collections_column)
+        export_column(kArgCols, ustore_doc_field<ustore_collection_t>(), collections.get());
+    return_if_error_m(c.error);
+    export_column(kArgKeys, ustore_doc_field<ustore_key_t>(), vertices.get());
+    return_if_error_m(c.error);
+    if (has_roles_column)
+        export_column(kArgRoles, ustore_doc_field<ustore_octet_t>(), roles_octets.begin());
+    return_if_error_m(c.error);
+    if (has_mins_column)
+        export_column(kArgNeighborsMin, ustore_doc_field<ustore_key_t>(), mins.get());
+    return_if_error_m(c.error);
+    if (has_maxs_column)
+        export_column(kArgNeighborsMax, ustore_doc_field<ustore_key_t>(), maxs.get());
     return_if_error_m(c.error);
-
-    ar::Status ar_status;
-    arrow_mem_pool_t pool(arena);
-    arf::FlightCallOptions options = arrow_call_options(pool);
-
-    // Configure the `cmd` descriptor
-    arf::FlightDescriptor descriptor;
-    descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightScan);
-    if (c.transaction)
-        fmt::format_to(std::back_inserter(descriptor.cmd),
-                       "{}=0x{:0>16x}&",
-                       kParamTransactionID,
-                       std::uintptr_t(c.transaction));
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
-    if (same_named_collection)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    export_options(c.options, descriptor.cmd);
 
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    if (batch_ptr->num_rows() == 0)
-        return;
+    ar::Status ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
     ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
-    ar_status = result->writer->Begin(batch_ptr->schema());
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
-
-    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*input_table);
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
-
-    ar_status = result->writer->DoneWriting();
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
-
-    // Fetch the responses
-    // Requesting `ToTable` might be more efficient than concatenating and
-    // reallocating directly from our arena, as the underlying Arrow implementation
-    // may know the length of the entire dataset.
-    auto maybe_table = result->reader->ToTable();
+    // Large requests are streamed in chunks, receiving the answers in between
+    auto maybe_table = exchange_in_chunks(*result, batch_ptr, db.chunk_tasks, pool);
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
+    return_error_if_m(table->num_columns() == 1, c.error, error_unknown_k, "Expecting one column");
 
-    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
-    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
-    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
-    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+    // Missing vertices are marked with NULLs, and must be reported with the special degree
+    ustore_vertex_degree_t* degrees = nullptr;
+    if (request_only_degrees) {
+        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t const*)array->null_bitmap_data();
+        degrees = (ustore_vertex_degree_t*)array->raw_values();
+        if (presences_ptr) {
+            auto presences = bits_view_t(presences_ptr);
+            for (std::size_t i = 0; i != places.count; ++i)
+                if (!presences[i])
+                    degrees[i] = ustore_vertex_degree_missing_k;
+        }
+    }
+    else {
+        auto array = std::static_pointer_cast<ar::ListArray>(table->column(0)->chunk(0));
+        auto edges = std::static_pointer_cast<ar::NumericArray<ar::Int64Type>>(array->values());
+        auto presences_ptr = (ustore_octet_t const*)array->null_bitmap_data();
+        auto offs_ptr = (ustore_length_t const*)array->raw_value_offsets();
 
-    if (c.offsets)
-        *c.offsets = offs_ptr;
-    if (c.keys)
-        *c.keys = data_ptr;
-    if (c.counts) {
-        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        degrees = arena.alloc<ustore_vertex_degree_t>(places.count, c.error).begin();
         return_if_error_m(c.error);
+        auto presences = bits_view_t(presences_ptr);
         for (std::size_t i = 0; i != places.count; ++i)
-            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+            degrees[i] = !presences_ptr || presences[i] //
+                             ? static_cast<ustore_vertex_degree_t>((offs_ptr[i + 1] - offs_ptr[i]) / 3)
+                             : ustore_vertex_degree_missing_k;
+        *c.edges_per_vertex = (ustore_key_t*)edges->raw_values();
     }
+    *c.degrees_per_vertex = degrees;
 
-    db.readers.push_back(std::move(result->reader));
+    hold_reader(db, c.arena, std::move(result->reader));
 }
 
-void ustore_sample(ustore_sample_t* c_ptr) {
+void ustore_docs_read(ustore_docs_read_t* c_ptr) {
 
-    ustore_sample_t& c = *c_ptr;
+    ustore_docs_read_t& c = *c_ptr;
+    traced_span_t span {"rpc_docs_read", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
+    if (!c.tasks_count)
+        return;
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
-
-    places_arg_t places {collections, {}, {}, c.tasks_count};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    places_arg_t places {collections, keys, fields, c.tasks_count};
 
-    ar::Status ar_status;
     arrow_mem_pool_t pool(arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
 
     // Configure the `cmd` descriptor
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+    bool const request_only_presences = c.presences && !c.lengths && !c.values;
+    bool const request_only_lengths = c.lengths && !c.values;
+    char const* partial_mode = request_only_presences //
+                                   ? kParamReadPartPresences.c_str()
+                                   : request_only_lengths //
+                                         ? kParamReadPartLengths.c_str()
+                                         : nullptr;
 
     arf::FlightDescriptor descriptor;
     descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightSample);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightReadDocs);
     if (c.transaction)
         fmt::format_to(std::back_inserter(descriptor.cmd),
                        "{}=0x{:0>16x}&",
                        kParamTransactionID,
                        std::uintptr_t(c.transaction));
     fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamDocType, int(c.type));
+    if (c.threads_count > 1)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamThreadsCount, c.threads_count);
     if (same_named_collection)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    export_options(c.options, descriptor.cmd);
+    if (partial_mode)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
-    bool const has_limits_column = true;
+    bool const has_fields_column = bool(fields);
 
     // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
@@ -1204,18 +2702,38 @@ void ustore_sample(ustore_sample_t* c_ptr) {
         collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
 
-    if (has_limits_column && !limits.is_continuous()) {
-        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+    // When exporting keys, make sure they are properly strided
+    if (!keys.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.count, c.error);
         return_if_error_m(c.error);
-        transform_n(limits, places.size(), continuous.begin());
-        limits = {continuous.begin(), places.size()};
+        transform_n(keys, places.count, continuous.begin());
+        keys = {continuous.begin(), sizeof(ustore_key_t)};
+    }
+
+    // Fields are joined together with their NULL-terminators, so that the server
+    // can address them in place. Missing fields, selecting whole documents, stay empty.
+    ustore_char_t* joined_fields = nullptr;
+    ptr_range_gt<ustore_length_t> joined_fields_offs;
+    if (has_fields_column) {
+        joined_fields_offs = arena.alloc<ustore_length_t>(places.count + 1, c.error);
+        return_if_error_m(c.error);
+        joined_fields_offs[0] = 0;
+        for (std::size_t i = 0; i != places.count; ++i)
+            joined_fields_offs[i + 1] = joined_fields_offs[i] + (fields[i] ? std::strlen(fields[i]) + 1 : 0);
+        joined_fields = arena.alloc<ustore_char_t>(joined_fields_offs[places.count], c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i)
+            if (fields[i])
+                std::memcpy(joined_fields + joined_fields_offs[i],
+                            fields[i],
+                            joined_fields_offs[i + 1] - joined_fields_offs[i]);
     }
 
     // Now build-up the Arrow representation
-    ArrowArray input_array_c, output_array_c;
-    ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_limits_column;
-    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    auto count_columns = has_collections_column + 1 + has_fields_column;
+    ustore_to_arrow_schema(places.count, count_columns, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
     if (has_collections_column)
@@ -1231,16 +2749,29 @@ void ustore_sample(ustore_sample_t* c_ptr) {
             c.error);
     return_if_error_m(c.error);
 
-    if (has_limits_column)
+    ustore_to_arrow_column( //
+        c.tasks_count,
+        kArgKeys.c_str(),
+        ustore_doc_field<ustore_key_t>(),
+        nullptr,
+        nullptr,
+        keys.get(),
+        input_schema_c.children[has_collections_column],
+        input_array_c.children[has_collections_column],
+        c.error);
+    return_if_error_m(c.error);
+
+    if (has_fields_column)
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgCountLimits.c_str(),
-            ustore_doc_field<ustore_length_t>(),
-            nullptr,
+            kArgFields.c_str(),
+            ustore_doc_field_bin_k,
             nullptr,
-            limits.get(),
-            input_schema_c.children[has_collections_column],
-            input_array_c.children[has_collections_column],
+            joined_fields_offs.begin(),
+            joined_fields_offs[places.count] ? reinterpret_cast<void const*>(joined_fields)
+                                             : reinterpret_cast<void const*>(&zero_size_data_k),
+            input_schema_c.children[has_collections_column + 1],
+            input_array_c.children[has_collections_column + 1],
             c.error);
     return_if_error_m(c.error);
 
@@ -1249,55 +2780,261 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    if (batch_ptr->num_rows() == 0)
-        return;
+    ar::Status ar_status = compress_if_large(db, *batch_ptr, options);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Unsupported compression");
     ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
-    return_error_if_m(result.ok(), c.error, network_k, "Failed to Get with Arrow server");
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
-    ar_status = result->writer->Begin(batch_ptr->schema());
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+    // Large requests are streamed in chunks, receiving the answers in between
+    auto maybe_table = exchange_in_chunks(*result, batch_ptr, db.chunk_tasks, pool);
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+    return_error_if_m(table->num_columns() == 1, c.error, error_unknown_k, "Expecting one column");
 
-    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*input_table);
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+    if (request_only_presences) {
+        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt8Type>>(table->column(0)->chunk(0));
+        *c.presences = (ustore_octet_t*)array->raw_values();
+    }
+    else if (request_only_lengths) {
+        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto lens_ptr = (ustore_length_t*)array->raw_values();
+        if (presences_ptr) {
+            auto presences = bits_view_t(presences_ptr);
+            for (std::size_t i = 0; i != places.count; ++i)
+                if (!presences[i])
+                    lens_ptr[i] = ustore_length_missing_k;
+        }
+        *c.lengths = lens_ptr;
+        if (c.presences)
+            *c.presences = presences_ptr;
+    }
+    else {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
+        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
 
-    ar_status = result->writer->DoneWriting();
-    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+        if (c.presences)
+            *c.presences = presences_ptr;
+        if (c.offsets)
+            *c.offsets = offs_ptr;
+        if (c.values)
+            *c.values = data_ptr;
 
-    // Fetch the responses
-    // Requesting `ToTable` might be more efficient than concatenating and
-    // reallocating directly from our arena, as the underlying Arrow implementation
-    // may know the length of the entire dataset.
-    auto maybe_table = result->reader->ToTable();
-    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
-    auto table = maybe_table.ValueUnsafe();
+        if (c.lengths) {
+            auto lens = *c.lengths = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+            return_if_error_m(c.error);
+            auto presences = bits_view_t(presences_ptr);
+            for (std::size_t i = 0; i != places.count; ++i)
+                lens[i] = !presences_ptr || presences[i] ? (offs_ptr[i + 1] - offs_ptr[i]) : ustore_length_missing_k;
+        }
+    }
 
-    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
-    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
-    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
-    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+    hold_reader(db, c.arena, std::move(result->reader));
+}
 
-    if (c.offsets)
-        *c.offsets = offs_ptr;
-    if (c.keys)
-        *c.keys = data_ptr;
+void ustore_docs_aggregate(ustore_docs_aggregate_t* c_ptr) {
+
+    ustore_docs_aggregate_t& c = *c_ptr;
+    traced_span_t span {"rpc_docs_aggregate", c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.results, c.error, args_wrong_k, "No output place for results");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
+    discard_readers(db, c.arena, c.options);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_doc_aggregation_t const> functions {c.functions, c.functions_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    for (std::size_t i = 0; i != c.aggregations_count; ++i)
+        return_error_if_m(functions[i] == ustore_doc_aggregate_count_k || (fields && fields[i]),
+                          c.error,
+                          args_wrong_k,
+                          "Only counts can skip the field");
+
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightAggregateDocs);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, c.collection);
+    if (c.min_key)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamMinKey, *c.min_key);
+    if (c.max_key)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamMaxKey, *c.max_key);
+    if (c.group_by)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagGrouped);
+    if (c.threads_count > 1)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamThreadsCount, c.threads_count);
+    export_options(db, c.options, descriptor.cmd);
+
+    // Every aggregation is a row, and the grouping field, if any, is appended as the last one.
+    // Fields are joined together with their NULL-terminators, so that the server
+    // can address them in place. Missing fields, counting the documents, stay empty.
+    std::size_t const rows_count = c.aggregations_count + (c.group_by != nullptr);
+    auto row_field = [&](std::size_t i) noexcept -> ustore_str_view_t {
+        return i == c.aggregations_count ? c.group_by : fields ? fields[i] : nullptr;
+    };
+    auto row_functions = arena.alloc<ustore_length_t>(rows_count, c.error);
+    return_if_error_m(c.error);
+    auto joined_fields_offs = arena.alloc<ustore_length_t>(rows_count + 1, c.error);
+    return_if_error_m(c.error);
+    joined_fields_offs[0] = 0;
+    for (std::size_t i = 0; i != rows_count; ++i) {
+        ustore_str_view_t field = row_field(i);
+        row_functions[i] = i == c.aggregations_count ? 0 : static_cast<ustore_length_t>(functions[i]);
+        joined_fields_offs[i + 1] = joined_fields_offs[i] + (field ? std::strlen(field) + 1 : 0);
+    }
+    auto joined_fields = arena.alloc<ustore_char_t>(joined_fields_offs[rows_count], c.error).begin();
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != rows_count; ++i)
+        if (ustore_str_view_t field = row_field(i))
+            std::memcpy(joined_fields + joined_fields_offs[i],
+                        field,
+                        joined_fields_offs[i + 1] - joined_fields_offs[i]);
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    ustore_to_arrow_schema(rows_count, 2, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    ustore_to_arrow_column( //
+        rows_count,
+        kArgFunctions.c_str(),
+        ustore_doc_field<ustore_length_t>(),
+        nullptr,
+        nullptr,
+        rows_count ? reinterpret_cast<void const*>(row_functions.begin())
+                   : reinterpret_cast<void const*>(&zero_size_data_k),
+        input_schema_c.children[0],
+        input_array_c.children[0],
+        c.error);
+    return_if_error_m(c.error);
+
+    ustore_to_arrow_column( //
+        rows_count,
+        kArgFields.c_str(),
+        ustore_doc_field_bin_k,
+        nullptr,
+        joined_fields_offs.begin(),
+        joined_fields_offs[rows_count] ? reinterpret_cast<void const*>(joined_fields)
+                                       : reinterpret_cast<void const*>(&zero_size_data_k),
+        input_schema_c.children[1],
+        input_array_c.children[1],
+        c.error);
+    return_if_error_m(c.error);
+
+    // Send the request to server in a single chunk, as the rows only make sense together
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+
+    auto maybe_table = exchange_in_chunks(*result, batch_ptr, rows_count, pool);
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+    return_error_if_m(table->num_columns() == static_cast<int>(1 + 2 * c.aggregations_count),
+                      c.error,
+                      error_unknown_k,
+                      "Expecting a column of groups, and two columns per aggregation");
+
+    // Groups of documents without the grouping field arrive as NULLs
+    std::size_t const groups_count = static_cast<std::size_t>(table->num_rows());
+    auto groups = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+    auto presences_ptr = (ustore_octet_t const*)groups->null_bitmap_data();
+    auto offs_ptr = (ustore_length_t*)groups->value_offsets()->data();
+    auto presences = bits_view_t(presences_ptr);
+    if (c.groups_lengths) {
+        auto lens = *c.groups_lengths = arena.alloc<ustore_length_t>(groups_count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != groups_count; ++i)
+            lens[i] = !presences_ptr || presences[i] ? (offs_ptr[i + 1] - offs_ptr[i] - 1) : ustore_length_missing_k;
+    }
+    if (c.groups_count)
+        *c.groups_count = static_cast<ustore_size_t>(groups_count);
+    if (c.groups_offsets)
+        *c.groups_offsets = offs_ptr;
+    if (c.groups_strings)
+        *c.groups_strings = (ustore_byte_t*)groups->value_data()->data();
+
+    // Results and counts of different aggregations arrive in separate columns,
+    // but are exported as contiguous matrices, like in the embedded mode
+    auto results = *c.results = arena.alloc<double>(c.aggregations_count * groups_count, c.error).begin();
+    return_if_error_m(c.error);
+    ustore_size_t* counts = nullptr;
     if (c.counts) {
-        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        counts = *c.counts = arena.alloc<ustore_size_t>(c.aggregations_count * groups_count, c.error).begin();
         return_if_error_m(c.error);
-        for (std::size_t i = 0; i != places.count; ++i)
-            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+    }
+    using results_array_t = ar::NumericArray<ar::DoubleType>;
+    using counts_array_t = ar::NumericArray<ar::UInt64Type>;
+    for (std::size_t i = 0; i != c.aggregations_count && groups_count; ++i) {
+        auto column_results = std::static_pointer_cast<results_array_t>(table->column(1 + 2 * i)->chunk(0));
+        std::memcpy(results + i * groups_count, column_results->raw_values(), groups_count * sizeof(double));
+        if (!counts)
+            continue;
+        auto column_counts = std::static_pointer_cast<counts_array_t>(table->column(2 + 2 * i)->chunk(0));
+        std::memcpy(counts + i * groups_count, column_counts->raw_values(), groups_count * sizeof(ustore_size_t));
     }
 
-    db.readers.push_back(std::move(result->reader));
+    hold_reader(db, c.arena, std::move(result->reader));
 }
 
-void ustore_measure(ustore_measure_t* c_ptr) {
+/*********************************************************/
+/*****************	Asynchronous Submission	****************/
+/*********************************************************/
 
-    ustore_measure_t& c = *c_ptr;
-    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+void ustore_submit(ustore_submit_t* c_ptr) {
 
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    ustore_submit_t& c = *c_ptr;
+    validate_submit(c, c.error);
     return_if_error_m(c.error);
+
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    safe_section("Submitting operation", c.error, [&] {
+        // Clients, that never submit anything, don't need the threads
+        std::call_once(db.workers_init, [&] { db.workers = std::make_unique<rpc_workers_t>(db.async_threads); });
+        auto future = std::make_unique<rpc_future_t>();
+        future->task = c;
+        db.workers->push(future.get());
+        *c.future = future.release();
+    });
+}
+
+void ustore_future_wait(ustore_future_wait_t* c_ptr) {
+
+    ustore_future_wait_t& c = *c_ptr;
+    rpc_future_t& future = *reinterpret_cast<rpc_future_t*>(c.future);
+    std::unique_lock<std::mutex> lk(future.mutex);
+    if (c.blocking)
+        future.finished.wait(lk, [&] { return future.done; });
+    if (c.done)
+        *c.done = future.done;
+}
+
+void ustore_future_free(ustore_future_t c_future) {
+    if (!c_future)
+        return;
+    rpc_future_t* future = reinterpret_cast<rpc_future_t*>(c_future);
+    {
+        std::unique_lock<std::mutex> lk(future->mutex);
+        future->finished.wait(lk, [&] { return future->done; });
+    }
+    delete future;
 }
 
 /*********************************************************/
@@ -1307,12 +3044,33 @@ void ustore_measure(ustore_measure_t* c_ptr) {
 void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 
     ustore_collection_create_t& c = *c_ptr;
+    traced_span_t span {"rpc_collection_create", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     auto name_len = c.name ? std::strlen(c.name) : 0;
     return_error_if_m(name_len, c.error, args_wrong_k, "Default collection is always present");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
 
+    // Named collections are created on every shard, leaving the created ones on failures
+    if (is_sharded(db)) {
+        std::vector<ustore_collection_t> ids;
+        safe_section("Creating on shards", c.error, [&] { ids.resize(db.shards.size()); });
+        return_if_error_m(c.error);
+        for (std::size_t shard_idx = 0; shard_idx != db.shards.size(); ++shard_idx) {
+            ustore_collection_create_t create = c;
+            create.db = db.shards[shard_idx];
+            create.id = &ids[shard_idx];
+            ustore_collection_create(&create);
+            return_if_error_m(c.error);
+        }
+        *c.id = ids.front();
+        safe_section("Mapping collections", c.error, [&] {
+            std::lock_guard<std::mutex> lk(db.shards_collections_lock);
+            db.shards_collections[ids.front()] = std::move(ids);
+        });
+        return;
+    }
+
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}?{}={}", kFlightColCreate, kParamCollectionName, c.name);
     if (c.config)
@@ -1341,6 +3099,7 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
 
     ustore_collection_drop_t& c = *c_ptr;
+    traced_span_t span {"rpc_collection_drop", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     std::string_view mode;
@@ -1351,6 +3110,26 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     }
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (is_sharded(db)) {
+        safe_section("Dropping on shards", c.error, [&] {
+            for (std::size_t shard_idx = 0; shard_idx != db.shards.size(); ++shard_idx) {
+                std::vector<ustore_collection_t> id {c.id};
+                translate_collections(db, shard_idx, id, c.error);
+                return_if_error_m(c.error);
+                ustore_collection_drop_t drop = c;
+                drop.db = db.shards[shard_idx];
+                drop.id = id.front();
+                ustore_collection_drop(&drop);
+                return_if_error_m(c.error);
+            }
+        });
+        return_if_error_m(c.error);
+        if (c.mode == ustore_drop_keys_vals_handle_k) {
+            std::lock_guard<std::mutex> lk(db.shards_collections_lock);
+            db.shards_collections.erase(c.id);
+        }
+        return;
+    }
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type),
@@ -1365,20 +3144,27 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     arrow_mem_pool_t pool(db.arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
     ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    if (db.cache)
+        db.cache->drop_all();
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
 void ustore_collection_list(ustore_collection_list_t* c_ptr) {
 
     ustore_collection_list_t& c = *c_ptr;
+    traced_span_t span {"rpc_collection_list", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
-    if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+    discard_readers(db, c.arena, c.options);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
+    if (is_sharded(db)) {
+        return_error_if_m(!c.transaction, c.error, missing_feature_k, "Sharded clients are non-transactional");
+        return list_sharded(db, c, arena);
+    }
+
     ar::Status ar_status;
     arrow_mem_pool_t pool(arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
@@ -1413,7 +3199,40 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
         *c.ids = (ustore_collection_t*)array->raw_values();
     }
 
-    db.readers.push_back(std::move(stream_ptr));
+    hold_reader(db, c.arena, std::move(stream_ptr));
+}
+
+/**
+ * @brief Passes a control request to the server in a `DoAction` call.
+ * @return The textual response of the server.
+ */
+std::string control_remote(rpc_client_t& db,
+                           std::string const& action_type,
+                           std::string_view body,
+                           ustore_error_t* c_error) noexcept {
+    std::string text;
+    safe_section("Requesting server controls", c_error, [&] {
+        arf::Action action;
+        action.type = action_type;
+        if (!body.empty())
+            action.body = std::make_shared<ar::Buffer>(body);
+
+        ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream;
+        {
+            std::lock_guard<std::mutex> lk(db.arena_lock);
+            arrow_mem_pool_t pool(db.arena);
+            arf::FlightCallOptions options = arrow_call_options(pool);
+            maybe_stream = db.flight->DoAction(options, action);
+        }
+        return_error_if_m(maybe_stream.ok(), c_error, network_k, "Failed to act on Arrow server");
+        ar::Result<std::unique_ptr<arf::Result>> maybe_text = maybe_stream.ValueUnsafe()->Next();
+        return_error_if_m(maybe_text.ok() && maybe_text.ValueUnsafe(), c_error, network_k, "No response received");
+
+        std::shared_ptr<ar::Buffer> const& buffer = maybe_text.ValueUnsafe()->body;
+        if (buffer)
+            text.assign(reinterpret_cast<char const*>(buffer->data()), static_cast<std::size_t>(buffer->size()));
+    });
+    return text;
 }
 
 void ustore_database_control(ustore_database_control_t* c_ptr) {
@@ -1423,7 +3242,62 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
     return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
 
     *c.response = NULL;
-    log_error_m(c.error, missing_feature_k, "Controls aren't supported in this implementation!");
+    if (std::strcmp(c.request, "arenas") == 0)
+        return control_arenas(c);
+    return_error_if_m(!is_sharded(*reinterpret_cast<rpc_client_t*>(c.db)),
+                      c.error,
+                      missing_feature_k,
+                      "Sharded clients only support \"arenas\" controls");
+    bool is_metrics = std::strcmp(c.request, "metrics") == 0 || std::strcmp(c.request, "metrics/prometheus") == 0;
+    bool is_traces = is_traces_request(c.request);
+    return_error_if_m(is_metrics || is_traces || std::strcmp(c.request, "cache") == 0,
+                      c.error,
+                      missing_feature_k,
+                      "Only \"cache\", \"arenas\", \"metrics\" and \"traces\" controls are supported!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+
+    auto export_response = [&](std::string const& response) {
+        auto response_chars = arena.alloc<char>(response.size() + 1, c.error);
+        return_if_error_m(c.error);
+        std::memcpy(response_chars.begin(), response.c_str(), response.size() + 1);
+        *c.response = response_chars.begin();
+    };
+
+    // Metrics are collected by the server around its own engine calls
+    if (is_metrics) {
+        std::string text = control_remote(db, kFlightMetrics, c.request, c.error);
+        return_if_error_m(c.error);
+        return export_response(text);
+    }
+
+    // The client records its own spans around the RPCs, and the server around the engine calls
+    if (is_traces) {
+        std::string text = control_remote(db, kFlightTraces, {}, c.error);
+        return_if_error_m(c.error);
+        if constexpr (USTORE_USE_TRACING)
+            return control_traces(c, "ustore_client", text);
+        return export_response(text);
+    }
+
+    // Reports the counters of the client-side cache, if it was enabled
+    std::size_t capacity = 0, entries = 0, hits = 0, misses = 0;
+    if (db.cache) {
+        std::lock_guard<std::mutex> lk(db.cache->mutex);
+        capacity = db.cache->entries.capacity();
+        entries = db.cache->entries.size();
+        hits = db.cache->hits;
+        misses = db.cache->misses;
+    }
+    std::string response = fmt::format( //
+        "{{\"capacity\":{},\"entries\":{},\"hits\":{},\"misses\":{}}}",
+        capacity,
+        entries,
+        hits,
+        misses);
+    export_response(response);
 }
 
 /*********************************************************/
@@ -1431,6 +3305,7 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
 /*********************************************************/
 void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
     ustore_snapshot_list_t& c = *c_ptr;
+    traced_span_t span {"rpc_snapshot_list", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -1441,6 +3316,7 @@ void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
     arf::FlightCallOptions options = arrow_call_options(pool);
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
 
     arf::Ticket ticket {kFlightListSnap};
     ar::Result<std::unique_ptr<arf::FlightStreamReader>> maybe_stream = db.flight->DoGet(options, ticket);
@@ -1465,9 +3341,11 @@ void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
 
 void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
     ustore_snapshot_create_t& c = *c_ptr;
+    traced_span_t span {"rpc_snapshot_create", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}", kFlightSnapCreate);
@@ -1494,9 +3372,11 @@ void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
 
 void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
     ustore_snapshot_drop_t& c = *c_ptr;
+    traced_span_t span {"rpc_snapshot_drop", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}?{}={}", kFlightSnapCreate, kParamSnapshotID, c.id);
@@ -1515,10 +3395,12 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
 void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 
     ustore_transaction_init_t& c = *c_ptr;
+    traced_span_t span {"rpc_transaction_init", c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     return_error_if_m(c.transaction, c.error, uninitialized_state_k, "Transaction is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
 
     arf::Action action;
     ustore_size_t txn_id = *reinterpret_cast<ustore_size_t*>(c.transaction);
@@ -1552,9 +3434,11 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
 
     ustore_transaction_commit_t& c = *c_ptr;
+    traced_span_t span {"rpc_transaction_commit", c.error};
     return_error_if_m(c.transaction, c.error, uninitialized_state_k, "Transaction is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!is_sharded(db), c.error, missing_feature_k, "Unsupported by sharded clients");
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type),
@@ -1569,6 +3453,8 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     arrow_mem_pool_t pool(db.arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
     ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    if (db.cache)
+        db.cache->drop_all();
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
@@ -1589,6 +3475,9 @@ void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c_db);
+    db.workers.reset();
+    for (rpc_client_t* shard : db.shards)
+        ustore_database_free(shard);
     db.arena.release_all();
     delete &db;
 }
@@ -10,6 +10,9 @@
  */
 
 #include <mutex>
+#include <condition_variable> // `std::condition_variable`
+#include <array>      // `std::array`
+#include <atomic>     // `std::atomic`
 #include <fstream>    // `std::ifstream`
 #include <charconv>   // `std::from_chars`
 #include <chrono>     // `std::time_point`
@@ -18,7 +21,11 @@
 #include <filesystem> // Enumerating and creating directories
 #include <unordered_map>
 #include <unordered_set>
+#include <random>     // `std::random_device`
+#include <thread>     // `std::thread`
 
+#include <arrow/builder.h>        // Packing the change stream
+#include <arrow/flight/client.h> // Following the primary server
 #include <arrow/flight/server.h> // RPC Server Implementation
 #include <clipp.h>               // Command Line Interface
 
@@ -26,6 +33,11 @@
 #include "ustore/cpp/types.hpp" // `hash_combine`
 
 #include "helpers/arrow.hpp"
+#include "helpers/change_log.hpp"      // `change_log_t`
+#include "helpers/change_stream.hpp"   // `changes_copier_t`
+#include "helpers/metrics.hpp"         // `metered_mutex_gt`
+#include "helpers/reads_coalescer.hpp" // `reads_coalescer_t`
+#include "helpers/tracing.hpp"         // `traced_span_t`
 #include "ustore/arrow.h"
 
 using namespace unum::ustore;
@@ -38,10 +50,14 @@ using sys_time_t = std::chrono::time_point<sys_clock_t>;
 
 inline static arf::ActionType const kActionColOpen {kFlightColCreate, "Find a collection descriptor by name."};
 inline static arf::ActionType const kActionColDrop {kFlightColDrop, "Delete a named collection."};
+inline static arf::ActionType const kActionErase {kFlightErase, "Erase ranges of keys from collections."};
 inline static arf::ActionType const kActionSnapOpen {kFlightSnapCreate, "Find a snapshot descriptor by name."};
 inline static arf::ActionType const kActionSnapDrop {kFlightSnapDrop, "Delete a named snapshot."};
 inline static arf::ActionType const kActionTxnBegin {kFlightTxnBegin, "Starts an ACID transaction and returns its ID."};
 inline static arf::ActionType const kActionTxnCommit {kFlightTxnCommit, "Commit a previously started transaction."};
+inline static arf::ActionType const kActionMetrics {kFlightMetrics, "Export the metrics of the engine calls."};
+inline static arf::ActionType const kActionTraces {kFlightTraces, "Drain the spans of the finished engine calls."};
+inline static arf::ActionType const kActionReplication {kFlightReplication, "Report the replication state."};
 
 /**
  * @brief Searches for a "value" among key-value pairs passed in URI after path.
@@ -175,6 +191,19 @@ client_id_t parse_client_id(arf::ServerCallContext const& ctx) noexcept {
     return static_cast<client_id_t>(std::hash<std::string> {}(peer_addr));
 }
 
+/**
+ * @brief Extracts the span of the client, that issued the RPC, from its "traceparent" header.
+ */
+span_context_t parse_remote_span(arf::ServerCallContext const& ctx) noexcept {
+    if constexpr (!USTORE_USE_TRACING)
+        return {};
+    auto const& headers = ctx.incoming_headers();
+    auto it = headers.find(traceparent_header_k);
+    if (it == headers.end())
+        return {};
+    return parse_traceparent(std::string_view(it->second.data(), it->second.size()));
+}
+
 base_id_t parse_u64_hex(std::string_view str, base_id_t default_ = 0) noexcept {
     // if (str.size() != 16 + 2)
     //     return default_;
@@ -220,11 +249,7 @@ struct session_id_hash_t {
 };
 
 /**
- * ## Critique
- * Using `shared_ptr`s inside is not the best design decision,
- * but it boils down to having a good LRU-cache implementation
- * with copy-less lookup possibilities. Neither Boost, nor other
- * popular FOSS C++ implementations have that.
+ * @brief Handles owned by a session, while it's running or idle.
  */
 struct running_txn_t {
     ustore_transaction_t txn {};
@@ -233,13 +258,48 @@ struct running_txn_t {
     bool executing {};
 };
 
-using client_to_txn_t = std::unordered_map<session_id_t, running_txn_t, session_id_hash_t>;
+/**
+ * @brief Session stored in a shard of `sessions_t`. Idle sessions are linked
+ * into an intrusive list, that orders them by `last_access`. Nodes of the
+ * `std::unordered_map` never move, so those links remain valid until erasure.
+ */
+struct session_entry_t {
+    session_id_t id {};
+    running_txn_t running {};
+    session_entry_t* older = nullptr;
+    session_entry_t* newer = nullptr;
+};
+
+using client_to_txn_t = std::unordered_map<session_id_t, session_entry_t, session_id_hash_t>;
 
-struct aging_txn_order_t {
-    client_to_txn_t const& sessions;
+/**
+ * @brief Independently locked part of `sessions_t`.
+ * Sessions are appended to the idle list with the current time, whenever
+ * they stop executing, so the list stays sorted from the oldest to the newest
+ * without any comparisons, and both updates and evictions are O(1).
+ */
+struct sessions_shard_t {
+    metered_mutex_gt<std::mutex, lock_site_t::flight_sessions_k> mutex;
+    // Reusable object handles:
+    std::vector<ustore_arena_t> free_arenas;
+    std::vector<ustore_transaction_t> free_txns;
+    /// Links each session to memory used for its operations:
+    client_to_txn_t client_to_txn;
+    session_entry_t* oldest = nullptr;
+    session_entry_t* newest = nullptr;
+
+    void link_idle(session_entry_t& entry) noexcept {
+        entry.older = newest;
+        entry.newer = nullptr;
+        (newest ? newest->newer : oldest) = &entry;
+        newest = &entry;
+    }
 
-    bool operator()(session_id_t const& a, session_id_t const& b) const noexcept {
-        return sessions.at(a).last_access > sessions.at(b).last_access;
+    void unlink_idle(session_entry_t& entry) noexcept {
+        (entry.older ? entry.older->newer : oldest) = entry.newer;
+        (entry.newer ? entry.newer->older : newest) = entry.older;
+        entry.older = nullptr;
+        entry.newer = nullptr;
     }
 };
 
@@ -259,148 +319,211 @@ struct session_lock_t {
  * holds ownership of any "transaction handle" or "memory arena" for too long. So if
  * a client goes mute or disconnects, we can reuse same memory for other connections
  * and clients.
+ *
+ * Sessions and free handles are split between shards by the hash of session IDs,
+ * so concurrent requests rarely contend for the same mutex. When a shard runs out
+ * of handles, they are taken from the other shards, one lock at a time. Eviction
+ * only checks the oldest idle session of every shard.
  */
 class sessions_t {
-    std::mutex mutex_;
-    // Reusable object handles:
-    std::vector<ustore_arena_t> free_arenas_;
-    std::vector<ustore_transaction_t> free_txns_;
-    /// Links each session to memory used for its operations:
-    client_to_txn_t client_to_txn_;
+    static constexpr std::size_t shards_count_k = 16;
+
+    std::array<sessions_shard_t, shards_count_k> shards_;
+    std::atomic<std::size_t> next_shard_ {0};
     ustore_database_t db_ = nullptr;
     // On Postgre 9.6+ is set to same 30 seconds.
     std::size_t milliseconds_timeout = 30'000;
 
-    running_txn_t pop(ustore_error_t* c_error) noexcept {
-
-        auto it = std::min_element(client_to_txn_.begin(), client_to_txn_.end(), [](auto left, auto right) {
-            return left.second.last_access < right.second.last_access && !left.second.executing;
-        });
+    std::size_t shard_idx(session_id_t session_id) const noexcept {
+        return session_id_hash_t {}(session_id) % shards_count_k;
+    }
 
-        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(it->second.last_access - sys_clock_t::now());
-        if (age.count() < milliseconds_timeout || it->second.executing) {
-            log_error_m(c_error, error_unknown_k, "Too many concurrent sessions");
-            return {};
+    /**
+     * @brief Takes a free handle, starting from the shard at `first_idx`.
+     * Never holds more than one lock at a time.
+     */
+    template <typename handle_at>
+    bool take(std::vector<handle_at> sessions_shard_t::*free_handles, std::size_t first_idx, handle_at& handle) {
+        for (std::size_t i = 0; i != shards_count_k; ++i) {
+            sessions_shard_t& shard = shards_[(first_idx + i) % shards_count_k];
+            std::unique_lock _ {shard.mutex};
+            std::vector<handle_at>& handles = shard.*free_handles;
+            if (handles.empty())
+                continue;
+            handle = handles.back();
+            handles.pop_back();
+            return true;
         }
+        return false;
+    }
 
-        running_txn_t released = it->second;
-        client_to_txn_.erase(it);
-        released.executing = false;
-        return released;
+    template <typename handle_at>
+    void give(std::vector<handle_at> sessions_shard_t::*free_handles, std::size_t idx, handle_at handle) noexcept {
+        sessions_shard_t& shard = shards_[idx];
+        std::unique_lock _ {shard.mutex};
+        (shard.*free_handles).push_back(handle);
     }
 
-    void submit(session_id_t session_id, running_txn_t running_txn) noexcept {
-        running_txn.executing = false;
-        auto res = client_to_txn_.insert_or_assign(session_id, running_txn);
+    /**
+     * @brief Evicts an idle session, that wasn't accessed for longer than the timeout.
+     */
+    running_txn_t pop(std::size_t first_idx, ustore_error_t* c_error) noexcept {
+        auto now = sys_clock_t::now();
+        for (std::size_t i = 0; i != shards_count_k; ++i) {
+            sessions_shard_t& shard = shards_[(first_idx + i) % shards_count_k];
+            std::unique_lock _ {shard.mutex};
+            session_entry_t* oldest = shard.oldest;
+            if (!oldest)
+                continue;
+            auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - oldest->running.last_access);
+            if (age.count() < static_cast<std::int64_t>(milliseconds_timeout))
+                continue;
+
+            running_txn_t released = oldest->running;
+            session_id_t released_id = oldest->id;
+            shard.unlink_idle(*oldest);
+            shard.client_to_txn.erase(released_id);
+            released.executing = false;
+            return released;
+        }
+
+        log_error_m(c_error, error_unknown_k, "Too many concurrent sessions");
+        return {};
     }
 
   public:
-    sessions_t(ustore_database_t db, std::size_t n) : db_(db), free_arenas_(n), free_txns_(n), client_to_txn_(n) {
-        std::fill_n(free_arenas_.begin(), n, nullptr);
-        std::fill_n(free_txns_.begin(), n, nullptr);
+    sessions_t(ustore_database_t db, std::size_t n) : db_(db) {
+        for (sessions_shard_t& shard : shards_) {
+            shard.free_arenas.reserve(n);
+            shard.free_txns.reserve(n);
+            shard.client_to_txn.reserve(n / shards_count_k + 1);
+        }
+        for (std::size_t i = 0; i != n; ++i) {
+            shards_[i % shards_count_k].free_arenas.push_back(nullptr);
+            shards_[i % shards_count_k].free_txns.push_back(nullptr);
+        }
     }
 
     ~sessions_t() noexcept {
-        for (auto a : free_arenas_)
-            ustore_arena_free(a);
-        for (auto t : free_txns_)
-            ustore_transaction_free(t);
+        for (sessions_shard_t& shard : shards_) {
+            for (auto a : shard.free_arenas)
+                ustore_arena_free(a);
+            for (auto t : shard.free_txns)
+                ustore_transaction_free(t);
+            for (auto& [id, entry] : shard.client_to_txn) {
+                ustore_arena_free(entry.running.arena);
+                ustore_transaction_free(entry.running.txn);
+            }
+        }
     }
 
     running_txn_t continue_txn(session_id_t session_id, ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
+        sessions_shard_t& shard = shards_[shard_idx(session_id)];
+        std::unique_lock _ {shard.mutex};
 
-        auto it = client_to_txn_.find(session_id);
-        if (it == client_to_txn_.end()) {
+        auto it = shard.client_to_txn.find(session_id);
+        if (it == shard.client_to_txn.end()) {
             log_error_m(c_error, args_wrong_k, "Transaction was terminated, start a new one");
             return {};
         }
 
-        running_txn_t& running = it->second;
+        session_entry_t& entry = it->second;
+        running_txn_t& running = entry.running;
         if (running.executing) {
             log_error_m(c_error, args_wrong_k, "Transaction can't be modified concurrently.");
             return {};
         }
 
+        // Executing sessions can't be evicted
+        shard.unlink_idle(entry);
         running.executing = true;
         running.last_access = sys_clock_t::now();
-
-        // Update the heap order.
-        // With a single change shouldn't take more than `log2(n)` operations.
         return running;
     }
 
     running_txn_t request_txn(session_id_t session_id, ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
-
-        auto it = client_to_txn_.find(session_id);
-        if (it != client_to_txn_.end()) {
-            log_error_m(c_error, args_wrong_k, "Such transaction is already running, just continue using it.");
-            return {};
+        std::size_t idx = shard_idx(session_id);
+        {
+            sessions_shard_t& shard = shards_[idx];
+            std::unique_lock _ {shard.mutex};
+            if (shard.client_to_txn.count(session_id)) {
+                log_error_m(c_error, args_wrong_k, "Such transaction is already running, just continue using it.");
+                return {};
+            }
         }
 
+        running_txn_t running {};
+        bool has_arena = take(&sessions_shard_t::free_arenas, idx, running.arena);
+        bool has_txn = has_arena && take(&sessions_shard_t::free_txns, idx, running.txn);
+
         // Consider evicting some of the old sessions, if there are no more empty slots
-        if (free_txns_.empty() || free_arenas_.empty()) {
-            running_txn_t running = pop(c_error);
+        if (!has_txn) {
+            if (has_arena)
+                give(&sessions_shard_t::free_arenas, idx, running.arena);
+            running = pop(idx, c_error);
             if (*c_error)
                 return {};
-            running.executing = true;
-            running.last_access = sys_clock_t::now();
-            return running;
         }
 
-        // If we have free slots
-        running_txn_t running {};
-        running.arena = free_arenas_.back();
-        running.txn = free_txns_.back();
         running.executing = true;
         running.last_access = sys_clock_t::now();
-        free_arenas_.pop_back();
-        free_txns_.pop_back();
         return running;
     }
 
     void hold_txn(session_id_t session_id, running_txn_t running_txn) noexcept {
-        std::unique_lock _ {mutex_};
-        submit(session_id, running_txn);
+        sessions_shard_t& shard = shards_[shard_idx(session_id)];
+        std::unique_lock _ {shard.mutex};
+
+        auto [it, inserted] = shard.client_to_txn.try_emplace(session_id);
+        session_entry_t& entry = it->second;
+        if (!inserted && !entry.running.executing)
+            shard.unlink_idle(entry);
+
+        running_txn.executing = false;
+        running_txn.last_access = sys_clock_t::now();
+        entry.id = session_id;
+        entry.running = running_txn;
+        shard.link_idle(entry);
     }
 
     void release_txn(running_txn_t running_txn) noexcept {
-        std::unique_lock _ {mutex_};
-        free_arenas_.push_back(running_txn.arena);
-        free_txns_.push_back(running_txn.txn);
+        std::size_t idx = next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_count_k;
+        sessions_shard_t& shard = shards_[idx];
+        std::unique_lock _ {shard.mutex};
+        shard.free_arenas.push_back(running_txn.arena);
+        shard.free_txns.push_back(running_txn.txn);
     }
 
     void release_txn(session_id_t session_id) noexcept {
-        std::unique_lock _ {mutex_};
-        auto it = client_to_txn_.find(session_id);
-        if (it == client_to_txn_.end())
+        sessions_shard_t& shard = shards_[shard_idx(session_id)];
+        std::unique_lock _ {shard.mutex};
+        auto it = shard.client_to_txn.find(session_id);
+        if (it == shard.client_to_txn.end())
             return;
-        it->second.executing = false;
-        free_arenas_.push_back(it->second.arena);
-        free_txns_.push_back(it->second.txn);
-        client_to_txn_.erase(it);
+        session_entry_t& entry = it->second;
+        if (!entry.running.executing)
+            shard.unlink_idle(entry);
+        shard.free_arenas.push_back(entry.running.arena);
+        shard.free_txns.push_back(entry.running.txn);
+        shard.client_to_txn.erase(it);
     }
 
-    ustore_arena_t request_arena(ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
-        // Consider evicting some of the old sessions, if there are no more empty slots
-        if (free_arenas_.empty()) {
-            running_txn_t running = pop(c_error);
-            if (*c_error)
-                return nullptr;
-            free_txns_.push_back(running.txn);
-            return running.arena;
-        }
+    ustore_arena_t request_arena(session_id_t session_id, ustore_error_t* c_error) noexcept {
+        std::size_t idx = shard_idx(session_id);
+        ustore_arena_t arena = nullptr;
+        if (take(&sessions_shard_t::free_arenas, idx, arena))
+            return arena;
 
-        ustore_arena_t arena = free_arenas_.back();
-        free_arenas_.pop_back();
-        return arena;
+        // Consider evicting some of the old sessions, if there are no more empty slots
+        running_txn_t running = pop(idx, c_error);
+        if (*c_error)
+            return nullptr;
+        give(&sessions_shard_t::free_txns, idx, running.txn);
+        return running.arena;
     }
 
-    void release_arena(ustore_arena_t arena) noexcept {
-        std::unique_lock _ {mutex_};
-        free_arenas_.push_back(arena);
+    void release_arena(session_id_t session_id, ustore_arena_t arena) noexcept {
+        give(&sessions_shard_t::free_arenas, shard_idx(session_id), arena);
     }
 
     session_lock_t lock(session_id_t id, ustore_error_t* c_error) noexcept {
@@ -409,7 +532,7 @@ class sessions_t {
             return {*this, id, running.txn, running.arena};
         }
         else
-            return {*this, id, nullptr, request_arena(c_error)};
+            return {*this, id, nullptr, request_arena(id, c_error)};
     }
 };
 
@@ -419,7 +542,7 @@ session_lock_t::~session_lock_t() noexcept {
             session_id,
             running_txn_t {txn, arena, sys_clock_t::now(), true});
     else
-        sessions.release_arena(arena);
+        sessions.release_arena(session_id, arena);
 }
 
 struct session_params_t {
@@ -430,6 +553,10 @@ struct session_params_t {
     std::optional<std::string_view> collection_id;
     std::optional<std::string_view> collection_drop_mode;
     std::optional<std::string_view> read_part;
+    std::optional<std::string_view> doc_type;
+    std::optional<std::string_view> threads_count;
+    std::optional<std::string_view> compression;
+    std::optional<std::string_view> compression_min;
 
     std::optional<std::string_view> opt_snapshot;
     std::optional<std::string_view> opt_flush;
@@ -459,6 +586,10 @@ session_params_t session_params(arf::ServerCallContext const& server_call, std::
 
     result.collection_drop_mode = param_value(params, kParamDropMode);
     result.read_part = param_value(params, kParamReadPart);
+    result.doc_type = param_value(params, kParamDocType);
+    result.threads_count = param_value(params, kParamThreadsCount);
+    result.compression = param_value(params, kParamCompression);
+    result.compression_min = param_value(params, kParamCompressionMin);
 
     result.opt_flush = param_value(params, kParamFlagFlushWrite);
     result.opt_dont_watch = param_value(params, kParamFlagDontWatch);
@@ -491,21 +622,415 @@ ustore_str_view_t get_null_terminated(std::shared_ptr<ar::Buffer> const& buf_ptr
     return buf_ptr ? get_null_terminated(*buf_ptr) : nullptr;
 }
 
+/**
+ * @brief How long a `changes` stream waits for new changes, before ending,
+ * so that the replicas reconnect and observe the latest head of the log.
+ */
+constexpr std::chrono::milliseconds changes_wait_k {1000};
+
+/// Number of keys copied from every collection at once, when a replica copies the whole database.
+constexpr ustore_length_t changes_copy_chunk_k = 4096;
+
+/// Number of logged batches packed into every record batch of a `changes` stream.
+constexpr std::size_t changes_chunk_k = 256;
+
+std::uint64_t unix_milliseconds() noexcept {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(sys_clock_t::now().time_since_epoch());
+    return static_cast<std::uint64_t>(now.count());
+}
+
+std::uint64_t parse_u64_decimal(std::string_view str, std::uint64_t default_ = 0) noexcept {
+    std::uint64_t result = default_;
+    std::from_chars(str.data(), str.data() + str.size(), result);
+    return result;
+}
+
+/**
+ * @brief Builds the `changes` schema with one change per row, where every row
+ * has the sequence number and the time of the batch it belongs to.
+ */
+std::shared_ptr<ar::Schema> changes_schema(std::uint64_t origin, ustore_sequence_number_t head) {
+    auto metadata = ar::key_value_metadata({kMetaChangesOrigin, kMetaChangesHead},
+                                           {std::to_string(origin), std::to_string(head)});
+    return ar::schema(
+        {
+            ar::field(kArgSequences, ar::uint64(), false),
+            ar::field(kArgTimes, ar::uint64(), false),
+            ar::field(kArgKinds, ar::uint8(), false),
+            ar::field(kArgCols, ar::uint64(), false),
+            ar::field(kArgKeys, ar::int64(), false),
+            ar::field(kArgEndKeys, ar::int64(), false),
+            ar::field(kArgVals, ar::binary(), true),
+            ar::field(kArgPaths, ar::binary(), false),
+        },
+        metadata);
+}
+
+/**
+ * @brief Accumulates the rows of the `changes` stream, until they are packed into a record batch.
+ */
+class changes_builder_t {
+    ar::UInt64Builder sequences_;
+    ar::UInt64Builder times_;
+    ar::UInt8Builder kinds_;
+    ar::UInt64Builder collections_;
+    ar::Int64Builder keys_;
+    ar::Int64Builder end_keys_;
+    ar::BinaryBuilder values_;
+    ar::BinaryBuilder paths_;
+    std::int64_t rows_ = 0;
+
+  public:
+    std::int64_t size() const noexcept { return rows_; }
+
+    ar::Status append(ustore_sequence_number_t sequence,
+                      std::uint64_t time_ms,
+                      change_kind_t kind,
+                      ustore_collection_t collection,
+                      ustore_key_t key,
+                      ustore_key_t end_key,
+                      std::optional<std::string_view> value,
+                      std::string_view path = {}) {
+        ARROW_RETURN_NOT_OK(sequences_.Append(sequence));
+        ARROW_RETURN_NOT_OK(times_.Append(time_ms));
+        ARROW_RETURN_NOT_OK(kinds_.Append(static_cast<std::uint8_t>(kind)));
+        ARROW_RETURN_NOT_OK(collections_.Append(collection));
+        ARROW_RETURN_NOT_OK(keys_.Append(key));
+        ARROW_RETURN_NOT_OK(end_keys_.Append(end_key));
+        ARROW_RETURN_NOT_OK(value ? values_.Append(*value) : values_.AppendNull());
+        ARROW_RETURN_NOT_OK(paths_.Append(path));
+        ++rows_;
+        return ar::Status::OK();
+    }
+
+    ar::Status append(change_batch_t const& batch) {
+        for (change_t const& change : batch.changes) {
+            std::optional<std::string_view> value;
+            if (change.value)
+                value = *change.value;
+            ARROW_RETURN_NOT_OK(append(batch.sequence,
+                                       batch.time_ms,
+                                       change.kind,
+                                       change.collection,
+                                       change.key,
+                                       change.end_key,
+                                       value,
+                                       change.path));
+        }
+        return ar::Status::OK();
+    }
+
+    ar::Result<std::shared_ptr<ar::RecordBatch>> finish(std::shared_ptr<ar::Schema> const& schema) {
+        std::vector<std::shared_ptr<ar::Array>> columns(8);
+        ARROW_RETURN_NOT_OK(sequences_.Finish(&columns[0]));
+        ARROW_RETURN_NOT_OK(times_.Finish(&columns[1]));
+        ARROW_RETURN_NOT_OK(kinds_.Finish(&columns[2]));
+        ARROW_RETURN_NOT_OK(collections_.Finish(&columns[3]));
+        ARROW_RETURN_NOT_OK(keys_.Finish(&columns[4]));
+        ARROW_RETURN_NOT_OK(end_keys_.Finish(&columns[5]));
+        ARROW_RETURN_NOT_OK(values_.Finish(&columns[6]));
+        ARROW_RETURN_NOT_OK(paths_.Finish(&columns[7]));
+        return ar::RecordBatch::Make(schema, std::exchange(rows_, 0), std::move(columns));
+    }
+};
+
+/**
+ * @brief Lazily produces the `changes` stream for one reader.
+ *
+ * If the reader can't continue from the log, because it is new, was following another
+ * run of the server, or fell too far behind, the whole database is copied first.
+ * @see `changes_copier_t` for the consistency of such copies.
+ */
+class changes_reader_t final : public ar::RecordBatchReader {
+    change_log_t& log_;
+    std::shared_ptr<ar::Schema> schema_;
+    changes_builder_t builder_;
+    ustore_sequence_number_t streamed_ = 0;
+    std::optional<changes_copier_t> copier_;
+
+    ar::Status copy_next() {
+        change_batch_t batch;
+        status_t status = copier_->next(batch);
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+        ARROW_RETURN_NOT_OK(builder_.append(batch));
+        if (copier_->finished()) {
+            streamed_ = copier_->mark();
+            copier_.reset();
+        }
+        return ar::Status::OK();
+    }
+
+    ar::Status tail_next() {
+        auto batches = log_.since(streamed_, changes_chunk_k, changes_wait_k);
+        if (!batches)
+            return ar::Status::IOError("The change log was truncated past the requested sequence number");
+        for (change_batch_ptr_t const& batch : *batches) {
+            ARROW_RETURN_NOT_OK(builder_.append(*batch));
+            streamed_ = batch->sequence;
+        }
+        return ar::Status::OK();
+    }
+
+  public:
+    changes_reader_t(ustore_database_t db, change_log_t& log, ustore_sequence_number_t since, bool copy) noexcept
+        : log_(log), schema_(changes_schema(log.origin(), log.head())), streamed_(since) {
+        if (copy)
+            copier_.emplace(db, log.head(), changes_copy_chunk_k);
+    }
+
+    std::shared_ptr<ar::Schema> schema() const override { return schema_; }
+
+    ar::Status ReadNext(std::shared_ptr<ar::RecordBatch>* batch_ptr) override {
+        *batch_ptr = nullptr;
+        if (copier_)
+            ARROW_RETURN_NOT_OK(copy_next());
+        else
+            ARROW_RETURN_NOT_OK(tail_next());
+
+        // An empty batch ends the stream, once nothing was logged for a while
+        if (!builder_.size())
+            return ar::Status::OK();
+        ARROW_ASSIGN_OR_RAISE(*batch_ptr, builder_.finish(schema_));
+        return ar::Status::OK();
+    }
+};
+
+/**
+ * @brief Follows the `changes` stream of a primary server in a background thread,
+ * applying the changes to the local database in the same order.
+ *
+ * Whenever the stream can't be applied, the replica asks for a full copy.
+ * @see `changes_applier_t` for the mapping of collections.
+ */
+class replicator_t {
+    std::string primary_uri_;
+    std::atomic<std::uint64_t>& writes_epoch_;
+    std::unique_ptr<arf::FlightClient> client_;
+    changes_applier_t applier_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool stopping_ = false;
+    bool connected_ = false;
+    std::uint64_t origin_ = 0;
+    ustore_sequence_number_t applied_ = 0;
+    ustore_sequence_number_t primary_head_ = 0;
+    std::uint64_t applied_time_ms_ = 0;
+    std::string error_;
+    std::thread thread_;
+
+    bool stopping() const noexcept {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return stopping_;
+    }
+
+    ar::Status apply(ar::RecordBatch const& batch) {
+        if (!batch.schema()->Equals(*changes_schema(0, 0), false))
+            return ar::Status::Invalid("Unexpected schema of the change stream");
+        auto sequences = std::static_pointer_cast<ar::UInt64Array>(batch.GetColumnByName(kArgSequences));
+        auto times = std::static_pointer_cast<ar::UInt64Array>(batch.GetColumnByName(kArgTimes));
+        auto kinds = std::static_pointer_cast<ar::UInt8Array>(batch.GetColumnByName(kArgKinds));
+        auto collections = std::static_pointer_cast<ar::UInt64Array>(batch.GetColumnByName(kArgCols));
+        auto keys = std::static_pointer_cast<ar::Int64Array>(batch.GetColumnByName(kArgKeys));
+        auto end_keys = std::static_pointer_cast<ar::Int64Array>(batch.GetColumnByName(kArgEndKeys));
+        auto values = std::static_pointer_cast<ar::BinaryArray>(batch.GetColumnByName(kArgVals));
+        auto paths = std::static_pointer_cast<ar::BinaryArray>(batch.GetColumnByName(kArgPaths));
+
+        std::int64_t const rows = batch.num_rows();
+        std::vector<change_view_t> changes(static_cast<std::size_t>(rows));
+        for (std::int64_t row = 0; row != rows; ++row) {
+            change_view_t& change = changes[static_cast<std::size_t>(row)];
+            if (kinds->Value(row) > static_cast<std::uint8_t>(change_kind_t::mark_k))
+                return ar::Status::Invalid("Unknown kind of change");
+            change.kind = static_cast<change_kind_t>(kinds->Value(row));
+            change.collection = collections->Value(row);
+            change.key = keys->Value(row);
+            change.end_key = end_keys->Value(row);
+            if (values->IsValid(row))
+                change.value = values->GetView(row);
+            change.path = paths->GetView(row);
+        }
+        status_t status = applier_.apply(changes.data(), changes.size());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+        writes_epoch_.fetch_add(1, std::memory_order_release);
+
+        // Rows of a full copy aren't numbered, until its final mark,
+        // and until then the local state doesn't match any position in the log
+        std::lock_guard<std::mutex> lk(mutex_);
+        for (std::int64_t row = rows; row != 0; --row) {
+            if (kinds->Value(row - 1) == static_cast<std::uint8_t>(change_kind_t::reset_k)) {
+                applied_ = 0;
+                break;
+            }
+            if (!sequences->Value(row - 1))
+                continue;
+            applied_ = sequences->Value(row - 1);
+            applied_time_ms_ = times->Value(row - 1);
+            primary_head_ = std::max(primary_head_, applied_);
+            break;
+        }
+        return ar::Status::OK();
+    }
+
+    ar::Status follow() {
+        if (!client_) {
+            ARROW_ASSIGN_OR_RAISE(arf::Location location, arf::Location::Parse(primary_uri_));
+            ARROW_ASSIGN_OR_RAISE(client_, arf::FlightClient::Connect(location));
+        }
+
+        arf::Ticket ticket;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            ticket.ticket = kFlightChanges + "?" + kParamChangesSince + "=" + std::to_string(applied_) + "&" +
+                            kParamChangesOrigin + "=" + std::to_string(origin_);
+        }
+        ARROW_ASSIGN_OR_RAISE(std::unique_ptr<arf::FlightStreamReader> reader,
+                              client_->DoGet(arf::FlightCallOptions {}, ticket));
+        ARROW_ASSIGN_OR_RAISE(std::shared_ptr<ar::Schema> schema, reader->GetSchema());
+        std::shared_ptr<ar::KeyValueMetadata const> metadata = schema->metadata();
+        if (!metadata || !metadata->Contains(kMetaChangesOrigin) || !metadata->Contains(kMetaChangesHead))
+            return ar::Status::Invalid("The primary didn't report the state of its change log");
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            origin_ = parse_u64_decimal(metadata->Get(kMetaChangesOrigin).ValueOr(""));
+            primary_head_ = parse_u64_decimal(metadata->Get(kMetaChangesHead).ValueOr(""));
+            connected_ = true;
+            error_.clear();
+        }
+
+        while (!stopping()) {
+            ARROW_ASSIGN_OR_RAISE(arf::FlightStreamChunk chunk, reader->Next());
+            if (!chunk.data)
+                break;
+            ar::Status applied = apply(*chunk.data);
+            if (applied.ok())
+                continue;
+
+            // The local state may no longer match the primary, so it must be copied again
+            std::lock_guard<std::mutex> lk(mutex_);
+            applied_ = 0;
+            return applied;
+        }
+        return ar::Status::OK();
+    }
+
+    void loop() noexcept {
+        while (!stopping()) {
+            ar::Status followed = follow();
+            if (followed.ok())
+                continue;
+
+            std::unique_lock<std::mutex> lk(mutex_);
+            client_.reset();
+            connected_ = false;
+            error_ = followed.ToString();
+            stopped_.wait_for(lk, changes_wait_k, [&] { return stopping_; });
+        }
+    }
+
+  public:
+    replicator_t(ustore_database_t db, std::string primary_uri, std::atomic<std::uint64_t>& writes_epoch)
+        : primary_uri_(std::move(primary_uri)), writes_epoch_(writes_epoch), applier_(db),
+          applied_time_ms_(unix_milliseconds()), thread_(&replicator_t::loop, this) {}
+
+    ~replicator_t() noexcept {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stopping_ = true;
+        }
+        stopped_.notify_all();
+        thread_.join();
+    }
+
+    /**
+     * @brief Reports the progress in JSON, including the lag behind the last known state
+     * of the primary, both in the number of batches and in milliseconds.
+     */
+    std::string status() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        ustore_sequence_number_t lag = primary_head_ > applied_ ? primary_head_ - applied_ : 0;
+        std::uint64_t now_ms = unix_milliseconds();
+        std::uint64_t lag_ms = lag && now_ms > applied_time_ms_ ? now_ms - applied_time_ms_ : 0;
+        std::string escaped_error;
+        for (char c : error_)
+            if (c == '"' || c == '\\')
+                escaped_error.append({'\\', c});
+            else if (static_cast<unsigned char>(c) >= 0x20)
+                escaped_error.push_back(c);
+        return "{\"role\":\"replica\",\"primary\":\"" + primary_uri_ +                  //
+               "\",\"connected\":" + (connected_ ? "true" : "false") +                  //
+               ",\"sequence\":" + std::to_string(applied_) +                            //
+               ",\"primary_sequence\":" + std::to_string(std::max(primary_head_, applied_)) + //
+               ",\"lag_sequences\":" + std::to_string(lag) +                            //
+               ",\"lag_ms\":" + std::to_string(lag_ms) +                                //
+               ",\"error\":\"" + escaped_error + "\"}";
+    }
+};
+
 /**
  * @brief Remote Procedure Call implementation on top of Apache Arrow Flight RPC.
- * Currently only implements only the binary interface, which is enough even for
- * Document and Graph logic to work properly with most of encoding/decoding
- * shifted to client side.
+ * Mostly implements the binary interface, which is enough even for Document
+ * and Graph logic to work properly with most of encoding/decoding shifted to
+ * client side. The most common lookups of those modalities are also executed
+ * here, so that only the answers are shipped.
  *
  * ## Endpoints
  *
  * - write?col=x&txn=y&lengths&watch&shared (DoPut)
  * - read?col=x&txn=y&flush (DoExchange)
+ * - read_docs?col=x&txn=y&type=z&threads=n (DoExchange): Sub-documents of given `fields`
+ * - aggregate_docs?col=x&txn=y&min_key=a&max_key=b&grouped&threads=n (DoExchange): Aggregates of `fields`,
+ *   optionally grouped by the field in the last row, answering with a column of groups, followed by
+ *   a column of results and a column of counts for every aggregation
+ * - find_edges?col=x&txn=y&part=lengths (DoExchange): Lists of edges or just the degrees
  * - collection_upsert?col=x (DoAction): Returns collection ID
  *   Payload buffer: Collection opening config.
  * - collection_remove?col=x (DoAction): Drops a collection
+ * - erase_ranges?flush (DoAction): Erases `[start, end)` ranges of keys
+ *   Payload buffer: Packed `(collection, start, end)` triplets.
  * - txn_begin?txn=y (DoAction): Starts a transaction with a potentially custom ID
  * - txn_commit?txn=y (DoAction): Commits a transaction with a given ID
+ * - changes?since=n&origin=z (DoGet): Streams the changes following the `since` sequence number
+ * - replication (DoAction): Reports the state of the change log or the lag of the replica
+ *
+ * ## Streaming
+ *
+ * Inputs of `DoPut` and `DoExchange` calls may be split into many record batches.
+ * Each is executed separately, and for exchanges is answered with one output batch,
+ * before the next one is received. Clients decide on the size of chunks.
+ *
+ * ## Caching
+ *
+ * The schema of every `DoExchange` answer carries the `writes_epoch` metadata:
+ * the number of writes, commits, erasures and collection removals applied before the request.
+ * Clients caching the values may keep them only while the epoch stays the same.
+ *
+ * ## Coalescing
+ *
+ * Small concurrent reads outside of transactions are merged into shared engine calls,
+ * if they target the same snapshot. When the engine is busy, the first of them waits
+ * up to `coalesce_delay` for others to join, until `coalesce_tasks` keys are gathered.
+ * A zero delay disables coalescing. @see `reads_coalescer_t`.
+ *
+ * ## Replication
+ *
+ * With `--change-log`, every applied write, erasure, collection creation or removal,
+ * and every committed transaction is appended to a bounded in-memory log, where each
+ * batch gets the next sequence number. The `changes` stream tails that log, starting
+ * with a full copy of the database, if the reader can't continue from its position.
+ * The engine calls and the appends are serialized, so the log follows the engine order.
+ * That also serializes the syncs of `flush`-ed commits, which the engines otherwise share
+ * between concurrent sessions, if group commit is configured.
+ *
+ * With `--replicate-from`, the server replaces its database with a copy of the primary,
+ * refusing to start on a non-empty one without `--overwrite-local`. It then follows the
+ * `changes` stream of the primary in a background thread and rejects every modification.
+ * Replication is asynchronous: a replica serves a prefix of the primary history,
+ * lagging by at most the time it takes to ship and apply the following batches.
+ * Snapshots of a replica capture such prefixes as well. Clients caching the values
+ * can tail the same stream to invalidate them. @see `change_log_t`, `replicator_t`.
  *
  * ## Concurrency
  *
@@ -515,15 +1040,145 @@ ustore_str_view_t get_null_terminated(std::shared_ptr<ar::Buffer> const& buf_ptr
 class UStoreService : public arf::FlightServerBase {
     database_t db_;
     sessions_t sessions_;
+    std::atomic<std::uint64_t> writes_epoch_ {0};
+    reads_coalescer_t reads_coalescer_;
+
+    change_log_t changes_;
+    /// Held from the engine call until the append, so that the log follows the engine order.
+    std::mutex changes_order_;
+    /// Changes of the running transactions, appended to the log once they commit.
+    std::unordered_map<session_id_t, std::vector<change_t>, session_id_hash_t> changes_staged_;
+    std::mutex changes_staged_mutex_;
+    /// Set on replicas. Destroyed first, so that it stops before the database is closed.
+    std::unique_ptr<replicator_t> replicator_;
+
+    bool is_replica() const noexcept { return replicator_ != nullptr; }
+
+    /**
+     * @brief Locks the order of changes, when they are logged and applied outside of transactions.
+     * Changes of transactions are applied on commit, and only that is ordered.
+     */
+    std::unique_lock<std::mutex> order_changes(bool is_txn) {
+        if (!changes_.enabled() || is_txn)
+            return {};
+        return std::unique_lock<std::mutex>(changes_order_);
+    }
+
+    /**
+     * @brief Logs the changes produced by `make_changes()`, unless the log is disabled.
+     * Changes of transactions are staged until the commit.
+     */
+    template <typename make_changes_at>
+    void log_changes(session_id_t const& session_id, bool is_txn, make_changes_at&& make_changes) {
+        if (!changes_.enabled())
+            return;
+        std::vector<change_t> changes = make_changes();
+        if (changes.empty())
+            return;
+        if (!is_txn) {
+            changes_.append(std::move(changes));
+            return;
+        }
+        std::lock_guard<std::mutex> lk(changes_staged_mutex_);
+        std::vector<change_t>& staged = changes_staged_[session_id];
+        staged.insert(staged.end(),
+                      std::make_move_iterator(changes.begin()),
+                      std::make_move_iterator(changes.end()));
+    }
+
+    /// @return The staged changes of a transaction, forgetting them.
+    std::vector<change_t> unstage_changes(session_id_t const& session_id) {
+        std::lock_guard<std::mutex> lk(changes_staged_mutex_);
+        auto it = changes_staged_.find(session_id);
+        if (it == changes_staged_.end())
+            return {};
+        std::vector<change_t> changes = std::move(it->second);
+        changes_staged_.erase(it);
+        return changes;
+    }
+
+    /**
+     * @brief Replicas can't create collections, but find the replicated ones by name,
+     * so that clients can address them with local IDs.
+     */
+    ar::Result<ustore_collection_t> find_replicated_collection(session_params_t const& params) {
+        status_t status;
+        auto session = sessions_.lock(params.session_id, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        ustore_size_t count = 0;
+        ustore_collection_t* ids = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_str_span_t names = nullptr;
+        ustore_collection_list_t list {};
+        list.db = db_;
+        list.error = status.member_ptr();
+        list.arena = &session.arena;
+        list.count = &count;
+        list.ids = &ids;
+        list.offsets = &offsets;
+        list.names = &names;
+        ustore_collection_list(&list);
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        for (std::size_t i = 0; i != count; ++i)
+            if (std::string_view(names + offsets[i]) == *params.collection_name)
+                return ids[i];
+        return ar::Status::Invalid("Replicas are read-only");
+    }
+
+    /// Random ID of this run, as the sequence numbers of the change log restart with every one.
+    static std::uint64_t random_origin() {
+        std::random_device random_device;
+        return (std::uint64_t(random_device()) << 32) | random_device();
+    }
+
+    std::string replication_status() const {
+        if (is_replica())
+            return replicator_->status();
+        change_log_t::usage_t usage = changes_.usage();
+        return "{\"role\":\"primary\",\"origin\":" + std::to_string(changes_.origin()) + //
+               ",\"sequence\":" + std::to_string(usage.head) +                              //
+               ",\"oldest\":" + std::to_string(usage.oldest) +                              //
+               ",\"batches\":" + std::to_string(usage.batches) +                            //
+               ",\"used_bytes\":" + std::to_string(usage.used_bytes) +                      //
+               ",\"capacity_bytes\":" + std::to_string(changes_.capacity_bytes()) + "}";
+    }
 
   public:
-    UStoreService(database_t&& db, std::size_t capacity = 4096) : db_(std::move(db)), sessions_(db_, capacity) {}
+    /**
+     * @param changes_capacity  Bytes retained in the change log. Zero disables it.
+     * @param primary_uri       The server to replicate. Empty for primaries.
+     */
+    UStoreService( //
+        database_t&& db,
+        std::size_t capacity = 4096,
+        std::chrono::microseconds coalesce_delay = std::chrono::microseconds(100),
+        std::size_t coalesce_tasks = 1024,
+        std::size_t changes_capacity = 0,
+        std::string primary_uri = {})
+        : db_(std::move(db)), sessions_(db_, capacity), reads_coalescer_(db_, coalesce_delay, coalesce_tasks),
+          changes_(changes_capacity, random_origin()) {
+        if (!primary_uri.empty())
+            replicator_ = std::make_unique<replicator_t>(db_, std::move(primary_uri), writes_epoch_);
+    }
 
     ar::Status ListActions( //
         arf::ServerCallContext const&,
         std::vector<arf::ActionType>* actions) override {
         *actions =
-            {kActionColOpen, kActionColDrop, kActionSnapOpen, kActionSnapDrop, kActionTxnBegin, kActionTxnCommit};
+            {kActionColOpen,
+             kActionColDrop,
+             kActionErase,
+             kActionSnapOpen,
+             kActionSnapDrop,
+             kActionTxnBegin,
+             kActionTxnCommit,
+             kActionMetrics,
+             kActionTraces,
+             kActionReplication};
         return ar::Status::OK();
     }
 
@@ -551,11 +1206,44 @@ class UStoreService : public arf::FlightServerBase {
         return ar::Status::OK();
     }
 
+    /**
+     * @brief Forwards a textual request to `ustore_database_control()`, returning the response as is.
+     */
+    ar::Status respond_control(session_params_t const& params,
+                               ustore_str_view_t request,
+                               std::unique_ptr<arf::ResultStream>* results_ptr) {
+
+        status_t status;
+        ustore_arena_t arena = sessions_.request_arena(params.session_id, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db_;
+        control.arena = &arena;
+        control.error = status.member_ptr();
+        control.request = request;
+        control.response = &response;
+
+        ustore_database_control(&control);
+        auto result = std::make_unique<arf::Result>();
+        if (status)
+            result->body = ar::Buffer::FromString(std::string(response));
+        sessions_.release_arena(params.session_id, arena);
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        *results_ptr = std::make_unique<SingleResultStream>(std::move(result));
+        return ar::Status::OK();
+    }
+
     ar::Status DoAction( //
         arf::ServerCallContext const& server_call,
         arf::Action const& action,
         std::unique_ptr<arf::ResultStream>* results_ptr) override {
 
+        traced_span_t span {"flight_do_action", parse_remote_span(server_call)};
         ar::Status ar_status;
         session_params_t params = session_params(server_call, action.type);
         status_t status;
@@ -571,6 +1259,12 @@ class UStoreService : public arf::FlightServerBase {
             c_collection_name = (ustore_str_span_t)params.collection_name->begin();
             c_collection_name[params.collection_name->size()] = 0;
 
+            if (is_replica()) {
+                ARROW_ASSIGN_OR_RAISE(ustore_collection_t collection_id, find_replicated_collection(params));
+                *results_ptr = return_scalar<ustore_collection_t>(collection_id);
+                return ar::Status::OK();
+            }
+
             ustore_collection_t collection_id = 0;
             ustore_str_view_t collection_config = get_null_terminated(action.body);
             ustore_collection_create_t collection_init {};
@@ -580,9 +1274,17 @@ class UStoreService : public arf::FlightServerBase {
             collection_init.config = collection_config;
             collection_init.id = &collection_id;
 
+            auto order = order_changes(false);
             ustore_collection_create(&collection_init);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            log_changes(params.session_id, false, [&] {
+                change_t change;
+                change.kind = change_kind_t::create_k;
+                change.collection = collection_id;
+                change.value = std::string(params.collection_name->begin(), params.collection_name->size());
+                return std::vector<change_t> {std::move(change)};
+            });
 
             *results_ptr = return_scalar<ustore_collection_t>(collection_id);
             return ar::Status::OK();
@@ -592,6 +1294,8 @@ class UStoreService : public arf::FlightServerBase {
         if (is_query(action.type, kActionColDrop.type)) {
             if (!params.collection_id)
                 return ar::Status::Invalid("Missing collection ID argument");
+            if (is_replica())
+                return ar::Status::Invalid("Replicas are read-only");
 
             ustore_drop_mode_t mode =                               //
                 params.collection_drop_mode == kParamDropModeValues //
@@ -610,9 +1314,70 @@ class UStoreService : public arf::FlightServerBase {
             collection_drop.id = c_collection_id;
             collection_drop.mode = mode;
 
+            auto order = order_changes(false);
             ustore_collection_drop(&collection_drop);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            log_changes(params.session_id, false, [&] {
+                change_t change;
+                change.kind = change_kind_t::drop_k;
+                change.collection = c_collection_id;
+                change.key = static_cast<ustore_key_t>(mode);
+                return std::vector<change_t> {std::move(change)};
+            });
+            writes_epoch_.fetch_add(1, std::memory_order_release);
+            *results_ptr = return_empty();
+            return ar::Status::OK();
+        }
+
+        // Erasing ranges of keys
+        if (is_query(action.type, kActionErase.type)) {
+            constexpr std::size_t triplet_size_k = sizeof(ustore_collection_t) + 2 * sizeof(ustore_key_t);
+            std::size_t const body_size = action.body ? static_cast<std::size_t>(action.body->size()) : 0;
+            if (body_size % triplet_size_k)
+                return ar::Status::Invalid("Ranges must be packed into (collection, start, end) triplets");
+            if (is_replica())
+                return ar::Status::Invalid("Replicas are read-only");
+
+            // The body may be unaligned, so the triplets are copied out
+            auto triplets = reinterpret_cast<byte_t const*>(body_size ? action.body->data() : nullptr);
+            ustore_size_t const count = static_cast<ustore_size_t>(body_size / triplet_size_k);
+            std::vector<ustore_collection_t> collections(count);
+            std::vector<ustore_key_t> bounds(count * 2);
+            for (std::size_t i = 0; i != count; ++i) {
+                std::memcpy(&collections[i], triplets + i * triplet_size_k, sizeof(ustore_collection_t));
+                std::memcpy(&bounds[i * 2],
+                            triplets + i * triplet_size_k + sizeof(ustore_collection_t),
+                            2 * sizeof(ustore_key_t));
+            }
+
+            ustore_erase_ranges_t erase {};
+            erase.db = db_;
+            erase.error = status.member_ptr();
+            erase.options = ustore_options(params);
+            erase.tasks_count = count;
+            erase.collections = collections.data();
+            erase.collections_stride = sizeof(ustore_collection_t);
+            erase.start_keys = bounds.data();
+            erase.start_keys_stride = 2 * sizeof(ustore_key_t);
+            erase.end_keys = bounds.data() + 1;
+            erase.end_keys_stride = 2 * sizeof(ustore_key_t);
+
+            auto order = order_changes(false);
+            ustore_erase_ranges(&erase);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            log_changes(params.session_id, false, [&] {
+                std::vector<change_t> changes(count);
+                for (std::size_t i = 0; i != count; ++i) {
+                    changes[i].kind = change_kind_t::erase_k;
+                    changes[i].collection = collections[i];
+                    changes[i].key = bounds[i * 2];
+                    changes[i].end_key = bounds[i * 2 + 1];
+                }
+                return changes;
+            });
+            writes_epoch_.fetch_add(1, std::memory_order_release);
             *results_ptr = return_empty();
             return ar::Status::OK();
         }
@@ -661,6 +1426,8 @@ class UStoreService : public arf::FlightServerBase {
 
         // Starting a transaction
         if (is_query(action.type, kActionTxnBegin.type)) {
+            if (is_replica())
+                return ar::Status::Invalid("Replicas are read-only");
             if (!params.transaction_id)
                 params.session_id.txn_id = static_cast<txn_id_t>(std::rand());
 
@@ -683,6 +1450,7 @@ class UStoreService : public arf::FlightServerBase {
             }
 
             // Don't forget to add the transaction to active sessions
+            unstage_changes(params.session_id);
             sessions_.hold_txn(params.session_id, session);
             *results_ptr = return_scalar<txn_id_t>(params.session_id.txn_id);
             return ar::Status::OK();
@@ -691,6 +1459,8 @@ class UStoreService : public arf::FlightServerBase {
         if (is_query(action.type, kActionTxnCommit.type)) {
             if (!params.transaction_id)
                 return ar::Status::Invalid("Missing transaction ID argument");
+            if (is_replica())
+                return ar::Status::Invalid("Replicas are read-only");
 
             running_txn_t session = sessions_.continue_txn(params.session_id, status.member_ptr());
             if (!status) {
@@ -704,35 +1474,67 @@ class UStoreService : public arf::FlightServerBase {
             txn_commit.transaction = session.txn;
             txn_commit.options = ustore_options(params);
 
+            auto order = order_changes(false);
             ustore_transaction_commit(&txn_commit);
+            std::vector<change_t> changes = unstage_changes(params.session_id);
             if (!status) {
                 sessions_.release_txn(params.session_id);
                 return ar::Status::ExecutionError(status.message());
             }
+            log_changes(params.session_id, false, [&] { return std::move(changes); });
 
             sessions_.release_txn(params.session_id);
+            writes_epoch_.fetch_add(1, std::memory_order_release);
             *results_ptr = return_empty();
             return ar::Status::OK();
         }
 
+        // Exporting the metrics, by default in the Prometheus text format
+        if (is_query(action.type, kActionMetrics.type)) {
+            ustore_str_view_t request = get_null_terminated(action.body);
+            if (!request || !is_metrics_request(request))
+                request = "metrics/prometheus";
+            return respond_control(params, request, results_ptr);
+        }
+
+        // Draining the finished spans in the OTLP/JSON format
+        if (is_query(action.type, kActionTraces.type))
+            return respond_control(params, "traces", results_ptr);
+
+        // Reporting the state of the change log or the lag of the replica, in JSON
+        if (is_query(action.type, kActionReplication.type)) {
+            auto result = std::make_unique<arf::Result>();
+            result->body = ar::Buffer::FromString(replication_status());
+            *results_ptr = std::make_unique<SingleResultStream>(std::move(result));
+            return ar::Status::OK();
+        }
+
         return ar::Status::NotImplemented("Unknown action type: ", action.type);
     }
 
-    ar::Status DoExchange( //
-        arf::ServerCallContext const& server_call,
-        std::unique_ptr<arf::FlightMessageReader> request_ptr,
-        std::unique_ptr<arf::FlightMessageWriter> response_ptr) override {
+    /**
+     * @brief Answers one of the record batches streamed into a `DoExchange` call.
+     * The first answer begins the response stream, the following ones are
+     * appended to it under the same schema.
+     */
+    ar::Status exchange_batch( //
+        arf::FlightDescriptor const& desc,
+        session_params_t const& params,
+        session_lock_t& session,
+        ar::RecordBatch const& input_batch,
+        arf::FlightMessageWriter& response,
+        std::shared_ptr<ar::Schema>& response_schema,
+        std::uint64_t writes_epoch) {
 
         ar::Status ar_status;
-        arf::FlightMessageReader& request = *request_ptr;
-        arf::FlightMessageWriter& response = *response_ptr;
-        arf::FlightDescriptor const& desc = request.descriptor();
-        session_params_t params = session_params(server_call, desc.cmd);
         status_t status;
 
-        ArrowSchema input_schema_c, output_schema_c;
-        ArrowArray input_batch_c, output_batch_c;
-        if (ar_status = unpack_table(request.ToTable(), input_schema_c, input_batch_c); !ar_status.ok())
+        exported_batch_t input;
+        ArrowSchema& input_schema_c = input.schema;
+        ArrowArray& input_batch_c = input.array;
+        ArrowSchema output_schema_c;
+        ArrowArray output_batch_c;
+        if (ar_status = ar::ExportRecordBatch(input_batch, &input_batch_c, &input_schema_c); !ar_status.ok())
             return ar_status;
 
         bool is_empty_values = false;
@@ -751,11 +1553,6 @@ class UStoreService : public arf::FlightServerBase {
         if (params.snapshot_id)
             c_snapshot_id = parse_snap_id(*params.snapshot_id);
 
-        // Reserve resources for the execution of this request
-        auto session = sessions_.lock(params.session_id, status.member_ptr());
-        if (!status)
-            return ar::Status::ExecutionError(status.message());
-
         if (is_query(desc.cmd, kFlightRead)) {
 
             /// @param `keys`
@@ -794,7 +1591,10 @@ class UStoreService : public arf::FlightServerBase {
             read.lengths = request_only_lengths ? &found_lengths : nullptr;
             read.values = request_content ? &found_values : nullptr;
 
-            ustore_read(&read);
+            if (reads_coalescer_.accepts(read))
+                reads_coalescer_.read(read);
+            else
+                ustore_read(&read);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
 
@@ -1032,6 +1832,351 @@ class UStoreService : public arf::FlightServerBase {
             if (!status)
                 return ar::Status::ExecutionError(status.message());
         }
+        else if (is_query(desc.cmd, kFlightFindEdges)) {
+
+            /// @param `keys`
+            auto input_vertices = get_keys(input_schema_c, input_batch_c, kArgKeys);
+            if (!input_vertices)
+                return ar::Status::Invalid("Vertices must have been provided for edges lookups");
+
+            /// @param `roles`, `neighbors_min`, `neighbors_max`
+            auto input_roles = get_octets(input_schema_c, input_batch_c, kArgRoles);
+            auto input_mins = get_keys(input_schema_c, input_batch_c, kArgNeighborsMin);
+            auto input_maxs = get_keys(input_schema_c, input_batch_c, kArgNeighborsMax);
+
+            bool const request_only_degrees = params.read_part == kParamReadPartLengths;
+            ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
+            auto arena = linked_memory(&session.arena, ustore_options_default_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Roles are transferred as octets, as the size of C enums may differ between builds
+            auto roles = arena.alloc<ustore_vertex_role_t>(input_roles ? tasks_count : 0, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            for (std::size_t i = 0; i != roles.size(); ++i)
+                roles[i] = static_cast<ustore_vertex_role_t>(input_roles[i]);
+
+            ustore_vertex_degree_t* found_degrees = nullptr;
+            ustore_key_t* found_edges = nullptr;
+            ustore_graph_find_edges_t find {};
+            find.db = db_;
+            find.error = status.member_ptr();
+            find.transaction = session.txn;
+            find.snapshot = c_snapshot_id;
+            find.arena = &session.arena;
+            find.options = ustore_options(params);
+            find.tasks_count = tasks_count;
+            find.collections = input_collections.get();
+            find.collections_stride = input_collections.stride();
+            find.vertices = input_vertices.get();
+            find.vertices_stride = input_vertices.stride();
+            find.roles = roles.begin();
+            find.roles_stride = roles.size() ? sizeof(ustore_vertex_role_t) : 0;
+            find.neighbors_min = input_mins.get();
+            find.neighbors_min_stride = input_mins.stride();
+            find.neighbors_max = input_maxs.get();
+            find.neighbors_max_stride = input_maxs.stride();
+            find.degrees_per_vertex = &found_degrees;
+            find.edges_per_vertex = request_only_degrees ? nullptr : &found_edges;
+
+            ustore_graph_find_edges(&find);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Missing vertices are exported as NULLs
+            auto presences = arena.alloc<ustore_octet_t>(divide_round_up<std::size_t>(tasks_count, CHAR_BIT),
+                                                         status.member_ptr());
+            auto offsets = arena.alloc<ustore_length_t>(request_only_degrees ? 0 : tasks_count + 1,
+                                                        status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            std::fill(presences.begin(), presences.end(), ustore_octet_t {0});
+            bits_span_t presences_bits {presences.begin()};
+            ustore_length_t exported_keys = 0;
+            for (std::size_t i = 0; i != tasks_count; ++i) {
+                bool is_present = found_degrees[i] != ustore_vertex_degree_missing_k;
+                presences_bits[i] = is_present;
+                if (request_only_degrees)
+                    continue;
+                offsets[i] = exported_keys;
+                exported_keys += is_present ? found_degrees[i] * 3u : 0u;
+            }
+            if (!request_only_degrees)
+                offsets[tasks_count] = exported_keys;
+
+            ustore_to_arrow_schema(tasks_count, 1, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            if (request_only_degrees)
+                ustore_to_arrow_column( //
+                    tasks_count,
+                    kArgLengths.c_str(),
+                    ustore_doc_field<ustore_vertex_degree_t>(),
+                    presences.begin(),
+                    nullptr,
+                    found_degrees,
+                    output_schema_c.children[0],
+                    output_batch_c.children[0],
+                    status.member_ptr());
+            else
+                ustore_to_arrow_list( //
+                    tasks_count,
+                    kArgEdges.c_str(),
+                    ustore_doc_field<ustore_key_t>(),
+                    presences.begin(),
+                    offsets.begin(),
+                    exported_keys ? reinterpret_cast<void const*>(found_edges)
+                                  : reinterpret_cast<void const*>(&zero_size_data_k),
+                    output_schema_c.children[0],
+                    output_batch_c.children[0],
+                    status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
+        else if (is_query(desc.cmd, kFlightReadDocs)) {
+
+            /// @param `keys`
+            auto input_keys = get_keys(input_schema_c, input_batch_c, kArgKeys);
+            if (!input_keys)
+                return ar::Status::Invalid("Keys must have been provided for reads");
+
+            /// @param `fields`
+            auto input_fields = get_contents(input_schema_c, input_batch_c, kArgFields);
+
+            bool const request_only_presences = params.read_part == kParamReadPartPresences;
+            bool const request_only_lengths = params.read_part == kParamReadPartLengths;
+            bool const request_content = !request_only_lengths && !request_only_presences;
+            ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
+            auto arena = linked_memory(&session.arena, ustore_options_default_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Fields are transferred with their NULL-terminators, so we can point into the received buffer.
+            // Empty entries select whole documents.
+            auto fields = arena.alloc<ustore_str_view_t>(input_fields.contents_begin ? tasks_count : 0,
+                                                         status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            for (std::size_t i = 0; i != fields.size(); ++i) {
+                value_view_t field = input_fields[i];
+                fields[i] = field.size() ? reinterpret_cast<ustore_str_view_t>(field.data()) : nullptr;
+            }
+
+            ustore_bytes_ptr_t found_values = nullptr;
+            ustore_length_t* found_offsets = nullptr;
+            ustore_length_t* found_lengths = nullptr;
+            ustore_octet_t* found_presences = nullptr;
+            ustore_docs_read_t read {};
+            read.db = db_;
+            read.error = status.member_ptr();
+            read.transaction = session.txn;
+            read.snapshot = c_snapshot_id;
+            read.arena = &session.arena;
+            read.options = ustore_options(params);
+            read.type = static_cast<ustore_doc_field_type_t>(
+                params.doc_type ? parse_snap_id(*params.doc_type, ustore_doc_field_json_k) : ustore_doc_field_json_k);
+            read.tasks_count = tasks_count;
+            read.collections = input_collections.get();
+            read.collections_stride = input_collections.stride();
+            read.keys = input_keys.get();
+            read.keys_stride = input_keys.stride();
+            read.fields = fields.begin();
+            read.fields_stride = fields.size() ? sizeof(ustore_str_view_t) : 0;
+            read.threads_count = params.threads_count ? parse_snap_id(*params.threads_count) : 0;
+            read.presences = &found_presences;
+            read.offsets = request_content ? &found_offsets : nullptr;
+            read.lengths = request_only_lengths ? &found_lengths : nullptr;
+            read.values = request_content ? &found_values : nullptr;
+
+            ustore_docs_read(&read);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            is_empty_values = request_content && (found_values == nullptr);
+
+            ustore_size_t result_length =
+                request_only_presences ? divide_round_up<ustore_size_t>(tasks_count, CHAR_BIT) : tasks_count;
+            ustore_to_arrow_schema(result_length, 1, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            if (request_content)
+                ustore_to_arrow_column( //
+                    result_length,
+                    kArgVals.c_str(),
+                    ustore_doc_field_bin_k,
+                    found_presences,
+                    found_offsets,
+                    found_values,
+                    output_schema_c.children[0],
+                    output_batch_c.children[0],
+                    status.member_ptr());
+            else if (request_only_lengths)
+                ustore_to_arrow_column( //
+                    result_length,
+                    kArgLengths.c_str(),
+                    ustore_doc_field<ustore_length_t>(),
+                    found_presences,
+                    nullptr,
+                    found_lengths,
+                    output_schema_c.children[0],
+                    output_batch_c.children[0],
+                    status.member_ptr());
+            else if (request_only_presences)
+                ustore_to_arrow_column( //
+                    result_length,
+                    kArgPresences.c_str(),
+                    ustore_doc_field<ustore_octet_t>(),
+                    nullptr,
+                    nullptr,
+                    found_presences,
+                    output_schema_c.children[0],
+                    output_batch_c.children[0],
+                    status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
+        else if (is_query(desc.cmd, kFlightAggregateDocs)) {
+
+            /// @param `functions`
+            auto input_functions = get_lengths(input_schema_c, input_batch_c, kArgFunctions);
+            if (!input_functions)
+                return ar::Status::Invalid("Functions must have been provided for aggregations");
+
+            /// @param `fields`
+            auto input_fields = get_contents(input_schema_c, input_batch_c, kArgFields);
+
+            // With the `grouped` flag, the last row carries the grouping field instead of an aggregation
+            bool const grouped = param_value(desc.cmd, kParamFlagGrouped).has_value();
+            ustore_size_t rows_count = static_cast<ustore_size_t>(input_batch_c.length);
+            if (grouped && !rows_count)
+                return ar::Status::Invalid("Grouping field must have been provided");
+            ustore_size_t aggregations_count = rows_count - grouped;
+
+            // Keys are signed, so they are parsed separately from the other decimal params
+            auto parse_key = [&](std::string const& name, ustore_key_t default_) {
+                ustore_key_t result = default_;
+                auto value = param_value(desc.cmd, name);
+                if (value)
+                    std::from_chars(value->data(), value->data() + value->size(), result);
+                return result;
+            };
+            ustore_key_t min_key = parse_key(kParamMinKey, std::numeric_limits<ustore_key_t>::min());
+            ustore_key_t max_key = parse_key(kParamMaxKey, std::numeric_limits<ustore_key_t>::max());
+
+            auto arena = linked_memory(&session.arena, ustore_options_default_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Fields are transferred with their NULL-terminators, so we can point into the received buffer.
+            // Empty entries count the documents.
+            auto fields = arena.alloc<ustore_str_view_t>(rows_count, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            auto functions = arena.alloc<ustore_doc_aggregation_t>(aggregations_count, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            for (std::size_t i = 0; i != rows_count; ++i) {
+                value_view_t field = input_fields.contents_begin ? input_fields[i] : value_view_t {};
+                fields[i] = field.size() ? reinterpret_cast<ustore_str_view_t>(field.data()) : nullptr;
+            }
+            for (std::size_t i = 0; i != aggregations_count; ++i)
+                functions[i] = static_cast<ustore_doc_aggregation_t>(input_functions[i]);
+            if (grouped && !fields[aggregations_count])
+                return ar::Status::Invalid("Grouping field must have been provided");
+
+            ustore_size_t groups_count = 0;
+            ustore_length_t* groups_offsets = nullptr;
+            ustore_length_t* groups_lengths = nullptr;
+            ustore_byte_t* groups_strings = nullptr;
+            ustore_size_t* found_counts = nullptr;
+            double* found_results = nullptr;
+            ustore_docs_aggregate_t aggregate {};
+            aggregate.db = db_;
+            aggregate.error = status.member_ptr();
+            aggregate.transaction = session.txn;
+            aggregate.snapshot = c_snapshot_id;
+            aggregate.arena = &session.arena;
+            aggregate.options = ustore_options(params);
+            aggregate.collection = input_collections ? input_collections[0] : ustore_collection_main_k;
+            aggregate.min_key = &min_key;
+            aggregate.max_key = &max_key;
+            aggregate.aggregations_count = aggregations_count;
+            aggregate.functions = functions.begin();
+            aggregate.functions_stride = sizeof(ustore_doc_aggregation_t);
+            aggregate.fields = fields.begin();
+            aggregate.fields_stride = sizeof(ustore_str_view_t);
+            aggregate.group_by = grouped ? fields[aggregations_count] : nullptr;
+            aggregate.threads_count = params.threads_count ? parse_snap_id(*params.threads_count) : 0;
+            aggregate.groups_count = &groups_count;
+            aggregate.groups_offsets = &groups_offsets;
+            aggregate.groups_lengths = &groups_lengths;
+            aggregate.groups_strings = &groups_strings;
+            aggregate.counts = &found_counts;
+            aggregate.results = &found_results;
+
+            ustore_docs_aggregate(&aggregate);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // The group of documents without the grouping field is exported as NULL
+            auto groups_presences = arena.alloc<ustore_octet_t>(divide_round_up<std::size_t>(groups_count, CHAR_BIT),
+                                                                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            std::fill(groups_presences.begin(), groups_presences.end(), 0);
+            for (std::size_t i = 0; i != groups_count; ++i)
+                if (groups_lengths[i] != ustore_length_missing_k)
+                    groups_presences[i / CHAR_BIT] |= static_cast<ustore_octet_t>(1u << (i % CHAR_BIT));
+
+            // One column of groups, followed by the results and the counts of every aggregation
+            is_empty_values = groups_offsets[groups_count] == 0;
+            ustore_size_t columns_count = 1 + 2 * aggregations_count;
+            ustore_to_arrow_schema(groups_count, columns_count, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_column( //
+                groups_count,
+                kArgGroups.c_str(),
+                ustore_doc_field_bin_k,
+                groups_presences.begin(),
+                groups_offsets,
+                is_empty_values ? reinterpret_cast<void const*>(&zero_size_data_k)
+                                : reinterpret_cast<void const*>(groups_strings),
+                output_schema_c.children[0],
+                output_batch_c.children[0],
+                status.member_ptr());
+            for (std::size_t i = 0; status && i != aggregations_count; ++i) {
+                ustore_to_arrow_column( //
+                    groups_count,
+                    kArgResults.c_str(),
+                    ustore_doc_field<double>(),
+                    nullptr,
+                    nullptr,
+                    groups_count ? reinterpret_cast<void const*>(found_results + i * groups_count)
+                                 : reinterpret_cast<void const*>(&zero_size_data_k),
+                    output_schema_c.children[1 + 2 * i],
+                    output_batch_c.children[1 + 2 * i],
+                    status.member_ptr());
+                if (!status)
+                    break;
+                ustore_to_arrow_column( //
+                    groups_count,
+                    kArgCounts.c_str(),
+                    ustore_doc_field<ustore_size_t>(),
+                    nullptr,
+                    nullptr,
+                    groups_count ? reinterpret_cast<void const*>(found_counts + i * groups_count)
+                                 : reinterpret_cast<void const*>(&zero_size_data_k),
+                    output_schema_c.children[2 + 2 * i],
+                    output_batch_c.children[2 + 2 * i],
+                    status.member_ptr());
+            }
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
         else if (is_query(desc.cmd, kFlightScan)) {
 
             /// @param `start_keys`
@@ -1070,6 +2215,13 @@ class UStoreService : public arf::FlightServerBase {
             if (!status)
                 return ar::Status::ExecutionError(status.message());
 
+            // Sorted keys compress much better as deltas, so those are sent to clients requesting compression
+            char const* keys_column_name = kArgKeys.c_str();
+            if (params.compression) {
+                keys_to_deltas(found_keys, found_offsets[tasks_count]);
+                keys_column_name = kArgKeysDeltas.c_str();
+            }
+
             ustore_to_arrow_schema(found_offsets[tasks_count],
                                    2,
                                    &output_schema_c,
@@ -1080,7 +2232,7 @@ class UStoreService : public arf::FlightServerBase {
 
             ustore_to_arrow_column( //
                 found_offsets[tasks_count],
-                kArgKeys.c_str(),
+                keys_column_name,
                 ustore_doc_field<ustore_key_t>(),
                 nullptr,
                 nullptr,
@@ -1138,6 +2290,13 @@ class UStoreService : public arf::FlightServerBase {
             if (!status)
                 return ar::Status::ExecutionError(status.message());
 
+            // Sorted keys compress much better as deltas, so those are sent to clients requesting compression
+            char const* keys_column_name = kArgKeys.c_str();
+            if (params.compression) {
+                keys_to_deltas(found_keys, found_offsets[tasks_count]);
+                keys_column_name = kArgKeysDeltas.c_str();
+            }
+
             ustore_to_arrow_schema(found_offsets[tasks_count],
                                    2,
                                    &output_schema_c,
@@ -1148,7 +2307,7 @@ class UStoreService : public arf::FlightServerBase {
 
             ustore_to_arrow_column( //
                 found_offsets[tasks_count],
-                kArgKeys.c_str(),
+                keys_column_name,
                 ustore_doc_field<ustore_key_t>(),
                 nullptr,
                 nullptr,
@@ -1184,32 +2343,96 @@ class UStoreService : public arf::FlightServerBase {
         if (!ar_status.ok())
             return ar_status;
 
-        ar_status = response.Begin(table->schema());
-        if (!ar_status.ok())
-            return ar_status;
-
-        ar_status = response.WriteRecordBatch(*table);
-        if (!ar_status.ok())
-            return ar_status;
+        // Answers to different batches may only differ in the nullability of columns
+        if (!response_schema) {
+            // Compress the answers only if the client can decode them, and the first one isn't tiny
+            ar::ipc::IpcWriteOptions write_options = ar::ipc::IpcWriteOptions::Defaults();
+            if (params.compression) {
+                std::size_t min_bytes = params.compression_min
+                                            ? parse_snap_id(*params.compression_min, compression_min_bytes_default_k)
+                                            : compression_min_bytes_default_k;
+                auto type = parse_compression(*params.compression);
+                ar_status = compress_if_large(write_options, *table, type, min_bytes);
+                if (!ar_status.ok())
+                    return ar_status;
+            }
+            // Lets caching clients know, if their values may be outdated
+            auto metadata = ar::key_value_metadata({kMetaWritesEpoch}, {std::to_string(writes_epoch)});
+            response_schema = table->schema()->WithMetadata(metadata);
+            ar_status = response.Begin(response_schema, write_options);
+            if (!ar_status.ok())
+                return ar_status;
+        }
+        else if (!table->schema()->Equals(*response_schema))
+            table = ar::RecordBatch::Make(response_schema, table->num_rows(), table->columns());
 
-        return response.Close();
+        return response.WriteRecordBatch(*table);
     }
 
-    ar::Status DoPut( //
+    ar::Status DoExchange( //
         arf::ServerCallContext const& server_call,
         std::unique_ptr<arf::FlightMessageReader> request_ptr,
-        std::unique_ptr<arf::FlightMetadataWriter> response_ptr) override {
+        std::unique_ptr<arf::FlightMessageWriter> response_ptr) override {
 
-        ar::Status ar_status;
+        traced_span_t span {"flight_do_exchange", parse_remote_span(server_call)};
         arf::FlightMessageReader& request = *request_ptr;
-        arf::FlightMetadataWriter& response = *response_ptr;
+        arf::FlightMessageWriter& response = *response_ptr;
         arf::FlightDescriptor const& desc = request.descriptor();
         session_params_t params = session_params(server_call, desc.cmd);
         status_t status;
 
-        ArrowSchema input_schema_c;
-        ArrowArray input_batch_c;
-        if (ar_status = unpack_table(request.ToTable(), input_schema_c, input_batch_c); !ar_status.ok())
+        // Reserve resources for the execution of this request
+        auto session = sessions_.lock(params.session_id, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        // Large requests arrive in many record batches. Each is answered as soon as
+        // it is received, while the client is still sending the following ones,
+        // so neither side materializes the whole exchange at once.
+        // Captured before any reads, so the answers can't be older than the epoch
+        std::uint64_t writes_epoch = writes_epoch_.load(std::memory_order_acquire);
+        std::shared_ptr<ar::Schema> response_schema;
+        while (true) {
+            ar::Result<arf::FlightStreamChunk> maybe_chunk = request.Next();
+            if (!maybe_chunk.ok())
+                return maybe_chunk.status();
+            std::shared_ptr<ar::RecordBatch> const& input_batch = maybe_chunk->data;
+            if (!input_batch)
+                break;
+
+            ar::Status ar_status = exchange_batch( //
+                desc,
+                params,
+                session,
+                *input_batch,
+                response,
+                response_schema,
+                writes_epoch);
+            if (!ar_status.ok())
+                return ar_status;
+        }
+
+        return response.Close();
+    }
+
+    /**
+     * @brief Applies one of the record batches streamed into a `DoPut` call.
+     * Every batch is a separate write, so clients only split atomic batches
+     * inside of transactions.
+     */
+    ar::Status put_batch( //
+        arf::FlightDescriptor const& desc,
+        session_params_t const& params,
+        session_lock_t& session,
+        ar::RecordBatch const& input_batch) {
+
+        ar::Status ar_status;
+        status_t status;
+
+        exported_batch_t input;
+        ArrowSchema& input_schema_c = input.schema;
+        ArrowArray& input_batch_c = input.array;
+        if (ar_status = ar::ExportRecordBatch(input_batch, &input_batch_c, &input_schema_c); !ar_status.ok())
             return ar_status;
 
         if (is_query(desc.cmd, kFlightWrite)) {
@@ -1231,10 +2454,6 @@ class UStoreService : public arf::FlightServerBase {
 
             auto input_vals = get_contents(input_schema_c, input_batch_c, kArgVals);
 
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
             ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
             ustore_write_t write {};
             write.db = db_;
@@ -1255,10 +2474,24 @@ class UStoreService : public arf::FlightServerBase {
             write.values = input_vals.contents_begin.get();
             write.values_stride = input_vals.contents_begin.stride();
 
+            auto order = order_changes(session.is_txn());
             ustore_write(&write);
 
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            log_changes(params.session_id, session.is_txn(), [&] {
+                std::vector<change_t> changes(tasks_count);
+                for (std::size_t i = 0; i != tasks_count; ++i) {
+                    value_view_t value = input_vals[i];
+                    changes[i].collection = input_collections ? input_collections[i] : ustore_collection_main_k;
+                    changes[i].key = input_keys[i];
+                    if (value)
+                        changes[i].value.emplace(value.c_str(), value.size());
+                }
+                return changes;
+            });
+            if (!session.is_txn())
+                writes_epoch_.fetch_add(1, std::memory_order_release);
         }
         else if (is_query(desc.cmd, kFlightWritePath)) {
             /// @param `keys`
@@ -1278,10 +2511,6 @@ class UStoreService : public arf::FlightServerBase {
 
             auto input_vals = get_contents(input_schema_c, input_batch_c, kArgVals);
 
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
             ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
             ustore_paths_write_t write {};
             write.db = db_;
@@ -1307,10 +2536,58 @@ class UStoreService : public arf::FlightServerBase {
             write.values_bytes = input_vals.contents_begin.get();
             write.values_bytes_stride = input_vals.contents_begin.stride();
 
+            auto order = order_changes(session.is_txn());
             ustore_paths_write(&write);
 
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            log_changes(params.session_id, session.is_txn(), [&] {
+                std::vector<change_t> changes(tasks_count);
+                for (std::size_t i = 0; i != tasks_count; ++i) {
+                    value_view_t path = input_paths[i];
+                    value_view_t value = input_vals[i];
+                    changes[i].kind = change_kind_t::write_path_k;
+                    changes[i].collection = input_collections ? input_collections[i] : ustore_collection_main_k;
+                    changes[i].path.assign(path.c_str(), path.size());
+                    if (value)
+                        changes[i].value.emplace(value.c_str(), value.size());
+                }
+                return changes;
+            });
+            if (!session.is_txn())
+                writes_epoch_.fetch_add(1, std::memory_order_release);
+        }
+        return ar::Status::OK();
+    }
+
+    ar::Status DoPut( //
+        arf::ServerCallContext const& server_call,
+        std::unique_ptr<arf::FlightMessageReader> request_ptr,
+        std::unique_ptr<arf::FlightMetadataWriter>) override {
+
+        traced_span_t span {"flight_do_put", parse_remote_span(server_call)};
+        arf::FlightMessageReader& request = *request_ptr;
+        arf::FlightDescriptor const& desc = request.descriptor();
+        session_params_t params = session_params(server_call, desc.cmd);
+        status_t status;
+        if (is_replica())
+            return ar::Status::Invalid("Replicas are read-only");
+
+        auto session = sessions_.lock(params.session_id, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        while (true) {
+            ar::Result<arf::FlightStreamChunk> maybe_chunk = request.Next();
+            if (!maybe_chunk.ok())
+                return maybe_chunk.status();
+            std::shared_ptr<ar::RecordBatch> const& input_batch = maybe_chunk->data;
+            if (!input_batch)
+                break;
+
+            ar::Status ar_status = put_batch(desc, params, session, *input_batch);
+            if (!ar_status.ok())
+                return ar_status;
         }
         return ar::Status::OK();
     }
@@ -1320,6 +2597,7 @@ class UStoreService : public arf::FlightServerBase {
         arf::Ticket const& ticket,
         std::unique_ptr<arf::FlightDataStream>* response_ptr) override {
 
+        traced_span_t span {"flight_do_get", parse_remote_span(server_call)};
         ar::Status ar_status;
         session_params_t params = session_params(server_call, ticket.ticket);
         status_t status;
@@ -1455,15 +2733,49 @@ class UStoreService : public arf::FlightServerBase {
             *response_ptr = std::move(stream);
             return ar::Status::OK();
         }
+        else if (is_query(ticket.ticket, kFlightChanges)) {
+            if (!changes_.enabled())
+                return ar::Status::NotImplemented("The change log is disabled, restart with `--change-log`");
+
+            auto since_param = param_value(ticket.ticket, kParamChangesSince);
+            auto origin_param = param_value(ticket.ticket, kParamChangesOrigin);
+            ustore_sequence_number_t since = since_param ? parse_u64_decimal(*since_param) : 0;
+            std::uint64_t origin = origin_param ? parse_u64_decimal(*origin_param) : 0;
+
+            // Readers that can't continue from the log get a full copy first
+            bool copy = !changes_.continues(origin, since);
+            auto reader = std::make_shared<changes_reader_t>(db_, changes_, since, copy);
+            *response_ptr = std::make_unique<arf::RecordBatchStream>(std::move(reader));
+            return ar::Status::OK();
+        }
         return ar::Status::OK();
     }
 };
 
-ar::Status run_server(ustore_str_view_t config, int port, bool quiet) {
+ar::Status run_server( //
+    ustore_str_view_t config,
+    int port,
+    bool quiet,
+    std::chrono::microseconds coalesce_delay,
+    std::size_t coalesce_tasks,
+    std::size_t changes_capacity,
+    std::string const& primary_uri,
+    bool overwrite_local) {
 
     database_t db;
     db.open(config).throw_unhandled();
 
+    // Replicas start with a full copy of the primary, that replaces all the local data
+    if (!primary_uri.empty() && !overwrite_local) {
+        bool empty = false;
+        status_t status = database_is_empty(db, empty);
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+        if (!empty)
+            return ar::Status::Invalid("The local database isn't empty and would be replaced by the copy of the primary, "
+                                       "pass `--overwrite-local` to confirm");
+    }
+
     arf::Location server_location = arf::Location::ForGrpcTcp("0.0.0.0", port).ValueUnsafe();
     arf::FlightServerOptions options(server_location);
 
@@ -1475,7 +2787,13 @@ ar::Status run_server(ustore_str_view_t config, int port, bool quiet) {
     arrow_mem_pool_t pool(arena);
     options.memory_manager = ar::CPUDevice::memory_manager(&pool);
 
-    auto server = std::make_unique<UStoreService>(std::move(db));
+    auto server = std::make_unique<UStoreService>( //
+        std::move(db),
+        4096,
+        coalesce_delay,
+        coalesce_tasks,
+        changes_capacity,
+        primary_uri);
     ARROW_RETURN_NOT_OK(server->Init(options));
     if (!quiet)
         std::printf("Listening on port: %i\n", server->port());
@@ -1492,12 +2810,28 @@ int main(int argc, char* argv[]) {
     int port = 38709;
     bool quiet = false;
     bool help = false;
+    std::size_t coalesce_delay = 100;
+    std::size_t coalesce_tasks = 1024;
+    std::size_t change_log_mb = 0;
+    std::string primary_uri;
+    bool overwrite_local = false;
 
     auto cli = ( //
         (option("--config") & value("path", config_path))
             .doc("Configuration file path. The default configuration file path is " + config_path),
         (option("-p", "--port") & value("port", port))
             .doc("Port to use for connection. The default connection port is 38709"),
+        (option("--coalesce-delay") & value("us", coalesce_delay))
+            .doc("Microseconds a small read may wait for others to share an engine call. Zero disables. Default 100"),
+        (option("--coalesce-tasks") & value("n", coalesce_tasks))
+            .doc("Maximum number of keys in a coalesced read. The default is 1024"),
+        (option("--change-log") & value("MB", change_log_mb))
+            .doc("Megabytes of recent changes retained for replicas. Zero disables. Default 0"),
+        (option("--replicate-from") & value("uri", primary_uri))
+            .doc("Follow a primary, like grpc://0.0.0.0:38709, serving only reads. Expects an empty database"),
+        option("--overwrite-local")
+            .set(overwrite_local)
+            .doc("Let `--replicate-from` replace the data of a non-empty database"),
         option("-q", "--quiet").set(quiet).doc("Silence outputs"),
         option("-h", "--help").set(help).doc("Print this help information on this tool and exit"));
 
@@ -1509,6 +2843,10 @@ int main(int argc, char* argv[]) {
         std::cout << make_man_page(cli, argv[0]);
         exit(0);
     }
+    if (change_log_mb && !primary_uri.empty()) {
+        std::cerr << "Replicas can't be followed, so `--change-log` and `--replicate-from` are exclusive" << std::endl;
+        exit(1);
+    }
 
     // Clearing the config_path input argument
     if (!config_path.empty()) {
@@ -1535,5 +2873,16 @@ int main(int argc, char* argv[]) {
         config = std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
     }
 
-    return run_server(config.c_str(), port, quiet).ok() ? EXIT_SUCCESS : EXIT_FAILURE;
+    auto served = run_server( //
+        config.c_str(),
+        port,
+        quiet,
+        std::chrono::microseconds(coalesce_delay),
+        coalesce_tasks,
+        change_log_mb << 20,
+        primary_uri,
+        overwrite_local);
+    if (!served.ok())
+        std::cerr << served.ToString() << std::endl;
+    return served.ok() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -6,6 +6,7 @@
  */
 #pragma once
 #include <string>
+#include <optional>
 #include <string_view>
 
 #pragma GCC diagnostic push
@@ -18,6 +19,9 @@
 #include <arrow/table.h>
 #include <arrow/memory_pool.h>
 #include <arrow/c/bridge.h>
+#include <arrow/util/byte_size.h>
+#include <arrow/util/compression.h>
+#include <arrow/util/key_value_metadata.h>
 #pragma GCC diagnostic pop
 
 #include "linked_memory.hpp"       // `linked_memory_lock_t`
@@ -39,6 +43,7 @@ inline static std::string const kFlightListCols = "list_collections";   /// `DoG
 inline static std::string const kFlightSample = "sample";               /// `DoGet`
 inline static std::string const kFlightColCreate = "create_collection"; /// `DoAction`
 inline static std::string const kFlightColDrop = "remove_collection";   /// `DoAction`
+inline static std::string const kFlightErase = "erase_ranges";          /// `DoAction`
 
 inline static std::string const kFlightListSnap = "list_snapshots";    /// `DoGet`
 inline static std::string const kFlightSnapCreate = "create_snapshot"; /// `DoAction`
@@ -47,13 +52,22 @@ inline static std::string const kFlightSnapDrop = "remove_snapshot";   /// `DoAc
 inline static std::string const kFlightTxnBegin = "begin_transaction";   /// `DoAction`
 inline static std::string const kFlightTxnCommit = "commit_transaction"; /// `DoAction`
 
-inline static std::string const kFlightWrite = "write";          /// `DoPut`
-inline static std::string const kFlightRead = "read";            /// `DoExchange`
-inline static std::string const kFlightWritePath = "write_path"; /// `DoPut`
-inline static std::string const kFlightMatchPath = "match_path"; /// `DoExchange`
-inline static std::string const kFlightReadPath = "read_path";   /// `DoExchange`
-inline static std::string const kFlightScan = "scan";            /// `DoExchange`
-inline static std::string const kFlightMeasure = "measure";      /// `DoExchange`
+inline static std::string const kFlightMetrics = "metrics"; /// `DoAction`
+inline static std::string const kFlightTraces = "traces";   /// `DoAction`
+
+inline static std::string const kFlightChanges = "changes";         /// `DoGet`
+inline static std::string const kFlightReplication = "replication"; /// `DoAction`
+
+inline static std::string const kFlightWrite = "write";                  /// `DoPut`
+inline static std::string const kFlightRead = "read";                    /// `DoExchange`
+inline static std::string const kFlightWritePath = "write_path";         /// `DoPut`
+inline static std::string const kFlightMatchPath = "match_path";         /// `DoExchange`
+inline static std::string const kFlightReadPath = "read_path";           /// `DoExchange`
+inline static std::string const kFlightScan = "scan";                    /// `DoExchange`
+inline static std::string const kFlightMeasure = "measure";              /// `DoExchange`
+inline static std::string const kFlightFindEdges = "find_edges";         /// `DoExchange`
+inline static std::string const kFlightReadDocs = "read_docs";           /// `DoExchange`
+inline static std::string const kFlightAggregateDocs = "aggregate_docs"; /// `DoExchange`
 
 inline static std::string const kArgSnaps = "snapshots";
 inline static std::string const kArgCols = "collections";
@@ -68,25 +82,61 @@ inline static std::string const kArgNames = "names";
 inline static std::string const kArgPaths = "paths";
 inline static std::string const kArgPatterns = "patterns";
 inline static std::string const kArgPrevPatterns = "prev_patterns";
+inline static std::string const kArgRoles = "roles";
+inline static std::string const kArgNeighborsMin = "neighbors_min";
+inline static std::string const kArgNeighborsMax = "neighbors_max";
+inline static std::string const kArgEdges = "edges";
+inline static std::string const kArgKeysDeltas = "keys_deltas";
+inline static std::string const kArgSequences = "sequences";
+inline static std::string const kArgTimes = "times";
+inline static std::string const kArgKinds = "kinds";
+inline static std::string const kArgEndKeys = "end_keys";
+inline static std::string const kArgFunctions = "functions";
+inline static std::string const kArgGroups = "groups";
+inline static std::string const kArgResults = "results";
+inline static std::string const kArgCounts = "counts";
 
 inline static std::string const kParamCollectionID = "collection_id";
 inline static std::string const kParamCollectionName = "collection_name";
 inline static std::string const kParamSnapshotID = "snapshot_id";
 inline static std::string const kParamTransactionID = "transaction_id";
 inline static std::string const kParamReadPart = "part";
+inline static std::string const kParamChunkSize = "chunk";
 inline static std::string const kParamDropMode = "mode";
 inline static std::string const kParamFlagFlushWrite = "flush";
 inline static std::string const kParamFlagDontWatch = "dont_watch";
 inline static std::string const kParamFlagDontDiscard = "";
 inline static std::string const kParamFlagSharedMemRead = "shared";
+inline static std::string const kParamDocType = "type";
+inline static std::string const kParamThreadsCount = "threads";
+inline static std::string const kParamCompression = "compression";
+inline static std::string const kParamCompressionMin = "compression_min";
+inline static std::string const kParamCache = "cache";
+inline static std::string const kParamCacheTTL = "cache_ttl";
+inline static std::string const kParamAsyncThreads = "async";
+inline static std::string const kParamChangesSince = "since";
+inline static std::string const kParamChangesOrigin = "origin";
+inline static std::string const kParamMinKey = "min_key";
+inline static std::string const kParamMaxKey = "max_key";
+inline static std::string const kParamFlagGrouped = "grouped";
 
 inline static std::string const kParamReadPartLengths = "lengths";
 inline static std::string const kParamReadPartPresences = "presences";
 
+inline static std::string const kParamCompressionLZ4 = "lz4";
+inline static std::string const kParamCompressionZSTD = "zstd";
+
 inline static std::string const kParamDropModeValues = "values";
 inline static std::string const kParamDropModeContents = "contents";
 inline static std::string const kParamDropModeCollection = "collection";
 
+/// Schema metadata of `DoExchange` answers: Decimal counter of writes applied before the request
+inline static std::string const kMetaWritesEpoch = "writes_epoch";
+/// Schema metadata of `changes` streams: Random ID of the server run, that numbers the changes
+inline static std::string const kMetaChangesOrigin = "changes_origin";
+/// Schema metadata of `changes` streams: Decimal sequence number of the last logged change
+inline static std::string const kMetaChangesHead = "changes_head";
+
 class arrow_mem_pool_t final : public ar::MemoryPool {
     linked_memory_t resource_;
     int64_t bytes_allocated_ = 0;
@@ -160,6 +210,58 @@ ar::ipc::IpcWriteOptions arrow_write_options(arrow_mem_pool_t& pool) {
     return options;
 }
 
+/**
+ * @brief Smallest batch worth compressing. Smaller ones would only pay for the codec overhead.
+ */
+constexpr std::size_t compression_min_bytes_default_k = 64ul * 1024ul;
+
+inline ar::Compression::type parse_compression(std::string_view name) noexcept {
+    if (name == kParamCompressionLZ4)
+        return ar::Compression::LZ4_FRAME;
+    if (name == kParamCompressionZSTD)
+        return ar::Compression::ZSTD;
+    return ar::Compression::UNCOMPRESSED;
+}
+
+/**
+ * @brief Enables IPC buffers compression for streams starting with a `batch`
+ * of at least `min_bytes`. Readers detect the codec from the messages themselves.
+ */
+inline ar::Status compress_if_large( //
+    ar::ipc::IpcWriteOptions& options,
+    ar::RecordBatch const& batch,
+    ar::Compression::type type,
+    std::size_t min_bytes) {
+
+    if (type == ar::Compression::UNCOMPRESSED)
+        return ar::Status::OK();
+    if (static_cast<std::size_t>(ar::util::TotalBufferSize(batch)) < min_bytes)
+        return ar::Status::OK();
+
+    auto maybe_codec = ar::util::Codec::Create(type);
+    if (!maybe_codec.ok())
+        return maybe_codec.status();
+    options.codec = std::shared_ptr<ar::util::Codec>(maybe_codec.MoveValueUnsafe());
+    return ar::Status::OK();
+}
+
+/**
+ * @brief Replaces sorted keys with differences between neighbors, that
+ * compress far better. Wraps around on overflow, so any sequence is reversible.
+ */
+inline void keys_to_deltas(ustore_key_t* keys, std::size_t count) noexcept {
+    for (std::size_t i = count; i > 1; --i)
+        keys[i - 1] = static_cast<ustore_key_t>(std::uint64_t(keys[i - 1]) - std::uint64_t(keys[i - 2]));
+}
+
+/**
+ * @brief Reverts `keys_to_deltas()` in place.
+ */
+inline void deltas_to_keys(ustore_key_t* keys, std::size_t count) noexcept {
+    for (std::size_t i = 1; i < count; ++i)
+        keys[i] = static_cast<ustore_key_t>(std::uint64_t(keys[i]) + std::uint64_t(keys[i - 1]));
+}
+
 ar::Result<std::shared_ptr<ar::RecordBatch>> combined_batch(std::shared_ptr<ar::Table> table,
                                                             ar::MemoryPool* pool = ar::default_memory_pool()) {
     return table->num_rows() ? table->CombineChunksToBatch(pool) : ar::RecordBatch::MakeEmpty(table->schema(), pool);
@@ -185,6 +287,25 @@ ar::Status unpack_table( //
     return ar_status;
 }
 
+/**
+ * @brief C representation of a received `ar::RecordBatch`,
+ * that releases the underlying Arrow objects, once out of scope.
+ */
+struct exported_batch_t {
+    ArrowSchema schema {};
+    ArrowArray array {};
+
+    exported_batch_t() = default;
+    exported_batch_t(exported_batch_t const&) = delete;
+    exported_batch_t& operator=(exported_batch_t const&) = delete;
+    ~exported_batch_t() noexcept {
+        if (array.release)
+            array.release(&array);
+        if (schema.release)
+            schema.release(&schema);
+    }
+};
+
 inline expected_gt<std::size_t> column_idx(ArrowSchema const& schema_c, std::string_view name) {
     auto begin = schema_c.children;
     auto end = begin + schema_c.n_children;
@@ -289,6 +410,18 @@ inline strided_iterator_gt<ustore_length_t> get_lengths( //
     return {begin, sizeof(ustore_length_t)};
 }
 
+inline strided_iterator_gt<ustore_octet_t> get_octets( //
+    ArrowSchema const& schema_c,
+    ArrowArray const& batch_c,
+    std::string_view arg_name) {
+    auto maybe_idx = column_idx(schema_c, arg_name);
+    if (!maybe_idx)
+        return {};
+
+    auto& array = *batch_c.children[*maybe_idx];
+    return {(ustore_octet_t*)array.buffers[1], sizeof(ustore_octet_t)};
+}
+
 inline contents_arg_t get_contents( //
     ArrowSchema const& schema_c,
     ArrowArray const& batch_c,
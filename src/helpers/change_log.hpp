@@ -0,0 +1,167 @@
+/**
+ * @file change_log.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Bounded in-memory stream of sequence-numbered changes, applied to a database.
+ */
+#pragma once
+#include <algorithm>          // `std::min`
+#include <chrono>             // `std::chrono::system_clock`
+#include <condition_variable> // `std::condition_variable`
+#include <deque>              // `std::deque`
+#include <memory>             // `std::shared_ptr`
+#include <mutex>              // `std::mutex`
+#include <optional>           // `std::optional`
+#include <string>             // `std::string`
+#include <vector>             // `std::vector`
+
+#include "ustore/db.h" // `ustore_sequence_number_t`
+
+namespace unum::ustore {
+
+enum class change_kind_t : std::uint8_t {
+    /// Upserts the `value` of `key`, or removes it, if the `value` is missing.
+    write_k = 0,
+    /// Upserts the `value` of a variable-length `path`, or removes it.
+    write_path_k = 1,
+    /// Removes the keys in `[key, end_key)`.
+    erase_k = 2,
+    /// Creates a collection, named `value`, that the source of changes addresses as `collection`.
+    create_k = 3,
+    /// Drops a `collection`, passing the `ustore_drop_mode_t` in `key`.
+    drop_k = 4,
+    /// Clears the whole database, before a full copy of it is streamed.
+    reset_k = 5,
+    /// Doesn't change anything, but marks the end of a full copy.
+    mark_k = 6,
+};
+
+struct change_t {
+    change_kind_t kind = change_kind_t::write_k;
+    ustore_collection_t collection = 0;
+    ustore_key_t key = 0;
+    ustore_key_t end_key = 0;
+    std::optional<std::string> value;
+    std::string path;
+
+    std::size_t bytes() const noexcept { return sizeof(change_t) + (value ? value->size() : 0) + path.size(); }
+};
+
+/**
+ * @brief Changes applied together, like a `ustore_write()` batch or a committed transaction.
+ */
+struct change_batch_t {
+    ustore_sequence_number_t sequence = 0;
+    /// Milliseconds since the Unix epoch, when the batch was appended.
+    std::uint64_t time_ms = 0;
+    std::vector<change_t> changes;
+    std::size_t bytes = 0;
+};
+
+using change_batch_ptr_t = std::shared_ptr<change_batch_t const>;
+
+/**
+ * @brief Retains the most recent batches of changes, up to `capacity_bytes`,
+ * numbering them with consecutive sequence numbers, starting from one.
+ * Readers tail the log by the last sequence number they have seen,
+ * and are told when the batches they need were already evicted.
+ *
+ * Shared pointers let readers export the batches without holding the lock.
+ * A zero capacity disables the log.
+ */
+class change_log_t {
+    std::deque<change_batch_ptr_t> batches_;
+    std::size_t capacity_bytes_ = 0;
+    std::size_t used_bytes_ = 0;
+    std::uint64_t origin_ = 0;
+    ustore_sequence_number_t head_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable appended_;
+
+  public:
+    /**
+     * @param origin Random ID of this log, as the sequence numbers restart with every run of the server.
+     */
+    change_log_t(std::size_t capacity_bytes, std::uint64_t origin) noexcept
+        : capacity_bytes_(capacity_bytes), origin_(origin) {}
+
+    bool enabled() const noexcept { return capacity_bytes_; }
+    std::size_t capacity_bytes() const noexcept { return capacity_bytes_; }
+    std::uint64_t origin() const noexcept { return origin_; }
+
+    struct usage_t {
+        ustore_sequence_number_t head = 0;
+        ustore_sequence_number_t oldest = 0;
+        std::size_t batches = 0;
+        std::size_t used_bytes = 0;
+    };
+
+    usage_t usage() const noexcept {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return {head_, batches_.empty() ? head_ + 1 : batches_.front()->sequence, batches_.size(), used_bytes_};
+    }
+
+    ustore_sequence_number_t head() const noexcept {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return head_;
+    }
+
+    /**
+     * @brief Checks if a reader, that has applied the batches of the `origin` log up to `since`,
+     * can follow this log from there. Others need a full copy of the database first.
+     */
+    bool continues(std::uint64_t origin, ustore_sequence_number_t since) const noexcept {
+        usage_t current = usage();
+        return since && origin == origin_ && since <= current.head && since + 1 >= current.oldest;
+    }
+
+    /**
+     * @brief Appends the changes as a new batch, evicting the oldest ones to fit.
+     * @return The sequence number of the new batch.
+     */
+    ustore_sequence_number_t append(std::vector<change_t>&& changes) {
+        using namespace std::chrono;
+        auto batch = std::make_shared<change_batch_t>();
+        auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        batch->time_ms = static_cast<std::uint64_t>(now.count());
+        batch->changes = std::move(changes);
+        for (change_t const& change : batch->changes)
+            batch->bytes += change.bytes();
+
+        ustore_sequence_number_t sequence = 0;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            sequence = batch->sequence = ++head_;
+            used_bytes_ += batch->bytes;
+            batches_.push_back(std::move(batch));
+            while (used_bytes_ > capacity_bytes_ && batches_.size() > 1) {
+                used_bytes_ -= batches_.front()->bytes;
+                batches_.pop_front();
+            }
+        }
+        appended_.notify_all();
+        return sequence;
+    }
+
+    /**
+     * @brief Collects up to `limit` batches following `since`, waiting up to `timeout` for new ones.
+     * @return NULL-opt, if some of the following batches were already evicted.
+     */
+    std::optional<std::vector<change_batch_ptr_t>> since(ustore_sequence_number_t since,
+                                                         std::size_t limit,
+                                                         std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        appended_.wait_for(lk, timeout, [&] { return head_ > since; });
+        if (since >= head_)
+            return std::vector<change_batch_ptr_t> {};
+        if (batches_.empty() || batches_.front()->sequence > since + 1)
+            return std::nullopt;
+
+        // Sequence numbers are consecutive, so the position of the next batch is known
+        std::size_t const first = static_cast<std::size_t>(since + 1 - batches_.front()->sequence);
+        std::size_t const count = std::min(limit, batches_.size() - first);
+        return std::vector<change_batch_ptr_t>(batches_.begin() + first, batches_.begin() + first + count);
+    }
+};
+
+} // namespace unum::ustore
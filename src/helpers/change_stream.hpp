@@ -0,0 +1,466 @@
+/**
+ * @file change_stream.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Produces and applies the stream of changes, that replicas follow.
+ *
+ * A primary answers readers, that can't continue from its `change_log_t`,
+ * with a full copy of the database, made by `changes_copier_t`, and then tails
+ * the log. Replicas pass every part of that stream to `changes_applier_t`.
+ * Neither depends on the transport, so both can be tested locally.
+ */
+#pragma once
+#include <algorithm>     // `std::max`
+#include <chrono>        // `std::chrono::system_clock`
+#include <limits>        // `std::numeric_limits`
+#include <optional>      // `std::optional`
+#include <string>        // `std::string`
+#include <string_view>   // `std::string_view`
+#include <unordered_map> // `std::unordered_map`
+#include <vector>        // `std::vector`
+
+#include "ustore/db.h"
+#include "ustore/blobs.h"
+#include "ustore/paths.h"
+#include "ustore/cpp/status.hpp" // `status_t`
+#include "ustore/cpp/types.hpp"  // `arena_t`
+#include "change_log.hpp"        // `change_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Lists the named collections of the database.
+ */
+inline status_t list_named_collections(ustore_database_t db,
+                                       arena_t& arena,
+                                       std::unordered_map<std::string, ustore_collection_t>& ids_by_names) {
+    status_t status;
+    ustore_size_t count = 0;
+    ustore_collection_t* ids = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_str_span_t names = nullptr;
+    ustore_collection_list_t list {};
+    list.db = db;
+    list.error = status.member_ptr();
+    list.arena = arena.member_ptr();
+    list.count = &count;
+    list.ids = &ids;
+    list.offsets = &offsets;
+    list.names = &names;
+    ustore_collection_list(&list);
+    if (!status)
+        return status;
+    for (std::size_t i = 0; i != count; ++i)
+        ids_by_names.emplace(names + offsets[i], ids[i]);
+    return status;
+}
+
+/**
+ * @brief Checks if the database has neither named collections, nor keys in the main one,
+ * so that a replica can start copying into it without destroying anything.
+ */
+inline status_t database_is_empty(ustore_database_t db, bool& empty) {
+    arena_t arena(db);
+    std::unordered_map<std::string, ustore_collection_t> ids_by_names;
+    status_t status = list_named_collections(db, arena, ids_by_names);
+    if (!status)
+        return status;
+
+    ustore_collection_t collection = ustore_collection_main_k;
+    ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_length_t limit = 1;
+    ustore_length_t* found_counts = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_scan_t scan {};
+    scan.db = db;
+    scan.error = status.member_ptr();
+    scan.arena = arena.member_ptr();
+    scan.tasks_count = 1;
+    scan.collections = &collection;
+    scan.start_keys = &start_key;
+    scan.count_limits = &limit;
+    scan.counts = &found_counts;
+    scan.keys = &found_keys;
+    ustore_scan(&scan);
+    if (!status)
+        return status;
+    empty = ids_by_names.empty() && !found_counts[0];
+    return status;
+}
+
+/**
+ * @brief Copies the whole database as batches of changes: a `reset`, the creations of
+ * the named collections, chunks of writes of all the pairs, and a final `mark`.
+ *
+ * The copy isn't isolated from concurrent writes. Only the `mark` is numbered, with
+ * the head of the log, observed before the copy started. Replaying the log from there
+ * overwrites every pair, that may have changed meanwhile, as every change is idempotent.
+ */
+class changes_copier_t {
+    ustore_database_t db_ = nullptr;
+    arena_t arena_;
+    ustore_sequence_number_t mark_ = 0;
+    ustore_length_t chunk_ = 0;
+    bool started_ = false;
+    bool finished_ = false;
+    std::vector<ustore_collection_t> collections_;
+    std::size_t collection_idx_ = 0;
+    std::optional<ustore_key_t> next_key_ = std::numeric_limits<ustore_key_t>::min();
+
+    status_t start(std::vector<change_t>& changes) {
+        changes.push_back({change_kind_t::reset_k});
+        std::unordered_map<std::string, ustore_collection_t> ids_by_names;
+        status_t status = list_named_collections(db_, arena_, ids_by_names);
+        if (!status)
+            return status;
+
+        collections_.push_back(ustore_collection_main_k);
+        for (auto const& [name, id] : ids_by_names) {
+            changes.push_back({change_kind_t::create_k, id, 0, 0, name});
+            collections_.push_back(id);
+        }
+        started_ = true;
+        return status;
+    }
+
+    /// Appends the writes of the next non-empty chunk of pairs, if any are left.
+    status_t copy_next(std::vector<change_t>& changes) {
+        status_t status;
+        while (collection_idx_ != collections_.size()) {
+            if (!next_key_) {
+                ++collection_idx_;
+                next_key_ = std::numeric_limits<ustore_key_t>::min();
+                continue;
+            }
+
+            ustore_collection_t collection = collections_[collection_idx_];
+            ustore_key_t start_key = *next_key_;
+            ustore_length_t limit = chunk_;
+            ustore_length_t* found_counts = nullptr;
+            ustore_key_t* found_keys = nullptr;
+            ustore_scan_t scan {};
+            scan.db = db_;
+            scan.error = status.member_ptr();
+            scan.arena = arena_.member_ptr();
+            scan.tasks_count = 1;
+            scan.collections = &collection;
+            scan.start_keys = &start_key;
+            scan.count_limits = &limit;
+            scan.counts = &found_counts;
+            scan.keys = &found_keys;
+            ustore_scan(&scan);
+            if (!status)
+                return status;
+
+            ustore_length_t const found_count = found_counts[0];
+            if (found_count < limit || found_keys[found_count - 1] == std::numeric_limits<ustore_key_t>::max())
+                next_key_ = std::nullopt;
+            else
+                next_key_ = found_keys[found_count - 1] + 1;
+            if (!found_count)
+                continue;
+
+            ustore_length_t* offsets = nullptr;
+            ustore_length_t* lengths = nullptr;
+            ustore_byte_t* values = nullptr;
+            ustore_read_t read {};
+            read.db = db_;
+            read.error = status.member_ptr();
+            read.arena = arena_.member_ptr();
+            read.options = ustore_option_dont_discard_memory_k;
+            read.tasks_count = found_count;
+            read.collections = &collection;
+            read.keys = found_keys;
+            read.keys_stride = sizeof(ustore_key_t);
+            read.offsets = &offsets;
+            read.lengths = &lengths;
+            read.values = &values;
+            ustore_read(&read);
+            if (!status)
+                return status;
+
+            // Pairs removed after the scan are skipped, their removals will be replayed anyway
+            for (std::size_t i = 0; i != found_count; ++i) {
+                if (lengths[i] == ustore_length_missing_k)
+                    continue;
+                std::string value {reinterpret_cast<char const*>(values) + offsets[i], lengths[i]};
+                changes.push_back({change_kind_t::write_k, collection, found_keys[i], 0, std::move(value)});
+            }
+            if (!changes.empty())
+                return status;
+        }
+        return status;
+    }
+
+  public:
+    /**
+     * @param mark  Head of the log, observed before the copy started.
+     * @param chunk Number of keys copied from a collection at once.
+     */
+    changes_copier_t(ustore_database_t db, ustore_sequence_number_t mark, std::size_t chunk) noexcept
+        : db_(db), arena_(db), mark_(mark), chunk_(static_cast<ustore_length_t>(std::max<std::size_t>(chunk, 1))) {}
+
+    bool finished() const noexcept { return finished_; }
+    ustore_sequence_number_t mark() const noexcept { return mark_; }
+
+    /**
+     * @brief Exports the next part of the copy, unless it is `finished()`.
+     * Only the last one, holding just the `mark`, has a non-zero sequence number.
+     */
+    status_t next(change_batch_t& batch) {
+        batch = {};
+        status_t status;
+        if (finished_)
+            return status;
+        if (!started_)
+            status = start(batch.changes);
+        if (status)
+            status = copy_next(batch.changes);
+        if (!status || !batch.changes.empty())
+            return status;
+
+        using namespace std::chrono;
+        auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        batch.sequence = mark_;
+        batch.time_ms = static_cast<std::uint64_t>(now.count());
+        batch.changes.push_back({change_kind_t::mark_k});
+        finished_ = true;
+        return status;
+    }
+};
+
+/**
+ * @brief Non-owning view of a `change_t`, so that the changes can be applied
+ * straight from the buffers, they were received into.
+ */
+struct change_view_t {
+    change_kind_t kind = change_kind_t::write_k;
+    ustore_collection_t collection = 0;
+    ustore_key_t key = 0;
+    ustore_key_t end_key = 0;
+    std::optional<std::string_view> value;
+    std::string_view path;
+
+    change_view_t() = default;
+    change_view_t(change_t const& change) noexcept
+        : kind(change.kind), collection(change.collection), key(change.key), end_key(change.end_key),
+          path(change.path) {
+        if (change.value)
+            value = *change.value;
+    }
+};
+
+/**
+ * @brief Applies the changes of another database, in the same order.
+ *
+ * Collections are created under the same names, but may get different IDs,
+ * so the applier remembers the local ID of every collection of the source.
+ * Consecutive writes and erasures are merged into batches.
+ */
+class changes_applier_t {
+    ustore_database_t db_ = nullptr;
+    arena_t arena_;
+    /// Local IDs of collections, by their IDs in the source of changes.
+    std::unordered_map<ustore_collection_t, ustore_collection_t> collections_;
+
+    status_t local_collection(ustore_collection_t source_id, ustore_collection_t& local_id) const {
+        if (source_id == ustore_collection_main_k) {
+            local_id = ustore_collection_main_k;
+            return {};
+        }
+        auto it = collections_.find(source_id);
+        if (it == collections_.end())
+            return status_t::status_view("Unknown collection in the change stream");
+        local_id = it->second;
+        return {};
+    }
+
+    status_t reset() {
+        std::unordered_map<std::string, ustore_collection_t> ids_by_names;
+        status_t status = list_named_collections(db_, arena_, ids_by_names);
+        if (!status)
+            return status;
+        for (auto const& [name, id] : ids_by_names) {
+            ustore_collection_drop_t drop {};
+            drop.db = db_;
+            drop.error = status.member_ptr();
+            drop.id = id;
+            drop.mode = ustore_drop_keys_vals_handle_k;
+            ustore_collection_drop(&drop);
+            if (!status)
+                return status;
+        }
+        ustore_collection_drop_t drop {};
+        drop.db = db_;
+        drop.error = status.member_ptr();
+        drop.id = ustore_collection_main_k;
+        drop.mode = ustore_drop_keys_vals_k;
+        ustore_collection_drop(&drop);
+        if (!status)
+            return status;
+        collections_.clear();
+        return status;
+    }
+
+    status_t create(ustore_collection_t source_id, std::string const& name) {
+        status_t status;
+        ustore_collection_t id = ustore_collection_main_k;
+        ustore_collection_create_t create {};
+        create.db = db_;
+        create.error = status.member_ptr();
+        create.name = name.c_str();
+        create.id = &id;
+        ustore_collection_create(&create);
+
+        // The collection may have been created during the copy, which is replayed again
+        if (!status) {
+            std::unordered_map<std::string, ustore_collection_t> ids_by_names;
+            status_t listed = list_named_collections(db_, arena_, ids_by_names);
+            auto it = ids_by_names.find(name);
+            if (!listed || it == ids_by_names.end())
+                return status;
+            status.release_error();
+            id = it->second;
+        }
+        collections_[source_id] = id;
+        return status;
+    }
+
+    /// Applies the changes in `[begin, end)` of the same `kind`.
+    status_t apply_run(change_view_t const* begin, change_view_t const* end) {
+        status_t status;
+        change_kind_t const kind = begin->kind;
+        std::size_t const count = static_cast<std::size_t>(end - begin);
+        std::vector<ustore_collection_t> local_collections(count);
+        if (kind == change_kind_t::write_k || kind == change_kind_t::write_path_k || kind == change_kind_t::erase_k)
+            for (std::size_t i = 0; i != count && status; ++i)
+                status = local_collection(begin[i].collection, local_collections[i]);
+        if (!status)
+            return status;
+
+        switch (kind) {
+        case change_kind_t::write_k:
+        case change_kind_t::write_path_k: {
+            std::vector<ustore_key_t> keys(count);
+            std::vector<ustore_bytes_cptr_t> contents(count);
+            std::vector<ustore_length_t> lengths(count);
+            std::vector<ustore_str_view_t> paths(count);
+            std::vector<ustore_length_t> paths_lengths(count);
+            for (std::size_t i = 0; i != count; ++i) {
+                change_view_t const& change = begin[i];
+                keys[i] = change.key;
+                contents[i] = change.value ? reinterpret_cast<ustore_bytes_cptr_t>(change.value->data()) : nullptr;
+                lengths[i] = change.value ? static_cast<ustore_length_t>(change.value->size()) : ustore_length_missing_k;
+                paths[i] = change.path.data();
+                paths_lengths[i] = static_cast<ustore_length_t>(change.path.size());
+            }
+
+            if (kind == change_kind_t::write_k) {
+                ustore_write_t write {};
+                write.db = db_;
+                write.error = status.member_ptr();
+                write.arena = arena_.member_ptr();
+                write.tasks_count = static_cast<ustore_size_t>(count);
+                write.collections = local_collections.data();
+                write.collections_stride = sizeof(ustore_collection_t);
+                write.keys = keys.data();
+                write.keys_stride = sizeof(ustore_key_t);
+                write.values = contents.data();
+                write.values_stride = sizeof(ustore_bytes_cptr_t);
+                write.lengths = lengths.data();
+                write.lengths_stride = sizeof(ustore_length_t);
+                ustore_write(&write);
+            }
+            else {
+                ustore_paths_write_t write {};
+                write.db = db_;
+                write.error = status.member_ptr();
+                write.arena = arena_.member_ptr();
+                write.tasks_count = static_cast<ustore_size_t>(count);
+                write.collections = local_collections.data();
+                write.collections_stride = sizeof(ustore_collection_t);
+                write.paths = paths.data();
+                write.paths_stride = sizeof(ustore_str_view_t);
+                write.paths_lengths = paths_lengths.data();
+                write.paths_lengths_stride = sizeof(ustore_length_t);
+                write.values_bytes = contents.data();
+                write.values_bytes_stride = sizeof(ustore_bytes_cptr_t);
+                write.values_lengths = lengths.data();
+                write.values_lengths_stride = sizeof(ustore_length_t);
+                ustore_paths_write(&write);
+            }
+            break;
+        }
+        case change_kind_t::erase_k: {
+            std::vector<ustore_key_t> start_keys(count);
+            std::vector<ustore_key_t> end_keys(count);
+            for (std::size_t i = 0; i != count; ++i)
+                start_keys[i] = begin[i].key, end_keys[i] = begin[i].end_key;
+            ustore_erase_ranges_t erase {};
+            erase.db = db_;
+            erase.error = status.member_ptr();
+            erase.tasks_count = static_cast<ustore_size_t>(count);
+            erase.collections = local_collections.data();
+            erase.collections_stride = sizeof(ustore_collection_t);
+            erase.start_keys = start_keys.data();
+            erase.start_keys_stride = sizeof(ustore_key_t);
+            erase.end_keys = end_keys.data();
+            erase.end_keys_stride = sizeof(ustore_key_t);
+            ustore_erase_ranges(&erase);
+            break;
+        }
+        case change_kind_t::create_k:
+            for (change_view_t const* it = begin; it != end && status; ++it)
+                status = create(it->collection, std::string(it->value.value_or(std::string_view {})));
+            break;
+        case change_kind_t::drop_k:
+            for (change_view_t const* it = begin; it != end && status; ++it) {
+                ustore_collection_t id = ustore_collection_main_k;
+                status = local_collection(it->collection, id);
+                if (!status)
+                    break;
+                ustore_collection_drop_t drop {};
+                drop.db = db_;
+                drop.error = status.member_ptr();
+                drop.id = id;
+                drop.mode = static_cast<ustore_drop_mode_t>(it->key);
+                ustore_collection_drop(&drop);
+                if (status && drop.mode == ustore_drop_keys_vals_handle_k)
+                    collections_.erase(it->collection);
+            }
+            break;
+        case change_kind_t::reset_k: status = reset(); break;
+        case change_kind_t::mark_k: break;
+        default: return status_t::status_view("Unknown kind of change");
+        }
+        return status;
+    }
+
+  public:
+    changes_applier_t(ustore_database_t db) noexcept : db_(db), arena_(db) {}
+
+    /**
+     * @brief Applies the `changes` in order. On failure, the local state may no longer
+     * match any position in the source, so it must be copied again.
+     */
+    status_t apply(change_view_t const* changes, std::size_t count) {
+        status_t status;
+        for (std::size_t begin = 0, end = 0; begin != count && status; begin = end) {
+            change_kind_t const kind = changes[begin].kind;
+            bool const merges = kind == change_kind_t::write_k || kind == change_kind_t::write_path_k ||
+                                kind == change_kind_t::erase_k;
+            end = begin + 1;
+            while (merges && end != count && changes[end].kind == kind)
+                ++end;
+            status = apply_run(changes + begin, changes + end);
+        }
+        return status;
+    }
+
+    status_t apply(change_batch_t const& batch) {
+        std::vector<change_view_t> views(batch.changes.begin(), batch.changes.end());
+        return apply(views.data(), views.size());
+    }
+};
+
+} // namespace unum::ustore
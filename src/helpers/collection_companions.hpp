@@ -0,0 +1,77 @@
+/**
+ * @file collection_companions.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Names of the collections, that modalities keep next to the ones with user data.
+ *
+ * Vector indexes live in "<name>.hnsw", while graphs keep recent changes of adjacency lists
+ * in "<name>.deltas" and the split neighborhoods of high-degree vertices in "<name>.buckets".
+ * They mean nothing without their parent, so engines drop or clear them together with it.
+ */
+#pragma once
+#include <string_view> // `std::string_view`
+
+#include "ustore/db.h" // `ustore_collection_drop_t`
+
+namespace unum::ustore {
+
+inline constexpr std::string_view vectors_index_suffix_k = ".hnsw";
+inline constexpr std::string_view graph_deltas_suffix_k = ".deltas";
+inline constexpr std::string_view graph_buckets_suffix_k = ".buckets";
+inline constexpr std::string_view companion_suffixes_k[] = {
+    vectors_index_suffix_k,
+    graph_deltas_suffix_k,
+    graph_buckets_suffix_k,
+};
+
+inline bool is_companion(std::string_view parent, std::string_view name) noexcept {
+    if (name.size() <= parent.size() || name.substr(0, parent.size()) != parent)
+        return false;
+    for (std::string_view suffix : companion_suffixes_k)
+        if (name.substr(parent.size()) == suffix)
+            return true;
+    return false;
+}
+
+/**
+ * @brief Applies `c` to the companions of `c.id`, before the collection itself is dropped,
+ * while its name can still be listed. Dropping the handle drops theirs, while clearing
+ * either keys or values removes all of their contents, as indexes over missing values
+ * are meaningless. Must be called outside of the locks of the engine.
+ */
+inline void drop_companions(ustore_collection_drop_t const& c) noexcept {
+    ustore_arena_t arena = nullptr;
+    ustore_size_t count = 0;
+    ustore_collection_t* ids = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_char_t* names = nullptr;
+    ustore_collection_list_t list {};
+    list.db = c.db;
+    list.error = c.error;
+    list.arena = &arena;
+    list.count = &count;
+    list.ids = &ids;
+    list.offsets = &offsets;
+    list.names = &names;
+    ustore_collection_list(&list);
+
+    // The default collection is nameless, so its companions are named just by suffixes
+    std::string_view parent;
+    bool found = c.id == ustore_collection_main_k;
+    for (std::size_t i = 0; !*c.error && !found && i != count; ++i)
+        if (ids[i] == c.id)
+            parent = names + offsets[i], found = true;
+
+    for (std::size_t i = 0; !*c.error && found && i != count; ++i) {
+        if (!is_companion(parent, names + offsets[i]))
+            continue;
+        ustore_collection_drop_t companion_drop = c;
+        companion_drop.id = ids[i];
+        companion_drop.mode =
+            c.mode == ustore_drop_keys_vals_handle_k ? ustore_drop_keys_vals_handle_k : ustore_drop_keys_vals_k;
+        ustore_collection_drop(&companion_drop);
+    }
+    ustore_arena_free(arena);
+}
+
+} // namespace unum::ustore
@@ -0,0 +1,80 @@
+/**
+ * @file collections_epoch.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Process-wide counter of changes to the lists of collections.
+ *
+ * Modalities derive some of their state from the names of collections, like the secondary
+ * indexes and dictionaries of documents, and cache it between calls in `epoch_cache_gt`.
+ * Engines bump the epoch after opening or closing a database and creating or dropping
+ * a collection, invalidating all of those caches. The epoch stays zero in processes,
+ * where no engine tracks it, like remote clients, and nothing gets cached.
+ */
+#pragma once
+#include <atomic>  // `std::atomic`
+#include <cstdint> // `std::uint64_t`
+#include <map>     // `std::map`
+#include <memory>  // `std::shared_ptr`
+#include <mutex>   // `std::mutex`
+
+namespace unum::ustore {
+
+inline std::atomic<std::uint64_t> collections_epoch_ {0};
+
+/**
+ * @brief Must be called after the change is visible to other threads,
+ * so that the state derived before it is tagged with an older epoch.
+ */
+inline void bump_collections_epoch() noexcept { collections_epoch_.fetch_add(1, std::memory_order_acq_rel); }
+
+/**
+ * @return Zero, if the epoch isn't tracked and nothing should be cached.
+ */
+inline std::uint64_t collections_epoch() noexcept { return collections_epoch_.load(std::memory_order_acquire); }
+
+/**
+ * @brief Bumps the epoch on every exit from the scope, successful or not.
+ */
+struct collections_epoch_bump_t {
+    ~collections_epoch_bump_t() noexcept { bump_collections_epoch(); }
+};
+
+/**
+ * @brief Immutable values, derived from the collections and shared between threads,
+ * until the epoch, in which they were derived, passes. Readers keep the `std::shared_ptr`,
+ * so the replaced values are freed, once the last of them is done.
+ */
+template <typename key_at, typename value_at>
+class epoch_cache_gt {
+    struct entry_t {
+        std::uint64_t epoch = 0;
+        std::shared_ptr<value_at const> value;
+    };
+
+    std::mutex mutex_;
+    std::map<key_at, entry_t> entries_;
+
+  public:
+    std::shared_ptr<value_at const> find(key_at const& key, std::uint64_t epoch) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        return it != entries_.end() && it->second.epoch == epoch ? it->second.value : nullptr;
+    }
+
+    /**
+     * @brief Remembers the `value`, evicting everything derived in other epochs.
+     * Values are silently dropped, if the cache can't grow.
+     */
+    void insert(key_at const& key, std::uint64_t epoch, std::shared_ptr<value_at const> value) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end();)
+            it = it->second.epoch != epoch ? entries_.erase(it) : std::next(it);
+        try {
+            entries_[key] = entry_t {epoch, std::move(value)};
+        }
+        catch (...) {
+        }
+    }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,874 @@
+/**
+ * @file distances.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Dot products, norms and L2 distances with SIMD kernels.
+ *
+ * Covers `i8` quantized vectors, used during index traversal, as well as
+ * `f16` and `f32` originals, used for exact comparisons. Every kernel only
+ * produces raw sums, leaving the scaling and normalization to the caller.
+ *
+ * The best implementation for the current CPU is picked once per process,
+ * on the first call to `distance_kernels()`:
+ * - x86: AVX-512 with VNNI, AVX2 with FMA and F16C or serial code.
+ * - Arm: SVE or NEON, if enabled at compile time, or serial code.
+ *
+ * Integer kernels accumulate into 32-bit lanes, so inputs must be shorter
+ * than 2^17 dimensions. Binary kernels take lengths in bytes, not bits.
+ */
+#pragma once
+#include <cstdint> // `std::int8_t`
+#include <cstring> // `std::memcpy`
+#include <cmath>   // `std::sqrt`
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define USTORE_DISTANCES_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define USTORE_DISTANCES_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_SVE)
+#define USTORE_DISTANCES_SVE 1
+#include <arm_sve.h>
+#endif
+
+namespace unum::ustore {
+
+using f16_bits_t = std::uint16_t;
+
+/**
+ * @brief Components of the cosine similarity: `ab` products and squared norms.
+ */
+template <typename scalar_at>
+struct dot_and_norms_gt {
+    scalar_at ab = 0;
+    scalar_at aa = 0;
+    scalar_at bb = 0;
+};
+
+using i8_dot_and_norms_t = dot_and_norms_gt<std::int64_t>;
+using f32_dot_and_norms_t = dot_and_norms_gt<float>;
+
+enum class simd_isa_t {
+    serial_k = 0,
+    avx2_k,
+    avx512_k,
+    neon_k,
+    sve_k,
+};
+
+/**
+ * @brief Table of kernels, specialized for a certain instruction set.
+ * @see `distance_kernels()`.
+ */
+struct distance_kernels_t {
+    simd_isa_t isa = simd_isa_t::serial_k;
+    char const* name = "serial";
+
+    std::int64_t (*i8_dot)(std::int8_t const*, std::int8_t const*, std::size_t) noexcept = nullptr;
+    i8_dot_and_norms_t (*i8_dot_and_norms)(std::int8_t const*, std::int8_t const*, std::size_t) noexcept = nullptr;
+    std::int64_t (*i8_l2_squared)(std::int8_t const*, std::int8_t const*, std::size_t) noexcept = nullptr;
+
+    float (*f32_dot)(float const*, float const*, std::size_t) noexcept = nullptr;
+    f32_dot_and_norms_t (*f32_dot_and_norms)(float const*, float const*, std::size_t) noexcept = nullptr;
+    float (*f32_l2_squared)(float const*, float const*, std::size_t) noexcept = nullptr;
+
+    float (*f16_dot)(f16_bits_t const*, f16_bits_t const*, std::size_t) noexcept = nullptr;
+    f32_dot_and_norms_t (*f16_dot_and_norms)(f16_bits_t const*, f16_bits_t const*, std::size_t) noexcept = nullptr;
+    float (*f16_l2_squared)(f16_bits_t const*, f16_bits_t const*, std::size_t) noexcept = nullptr;
+
+    std::size_t (*b1_hamming)(std::uint8_t const*, std::uint8_t const*, std::size_t) noexcept = nullptr;
+};
+
+/**
+ * @brief Converts IEEE 754 half-precision bits into a single-precision float.
+ * Handles subnormals, infinities and NaNs.
+ */
+inline float f16_to_f32(f16_bits_t half) noexcept {
+    std::uint32_t sign = (half & 0x8000u) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1Fu;
+    std::uint32_t mantissa = half & 0x3FFu;
+    std::uint32_t bits = 0;
+    if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else if (exponent)
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    else if (mantissa) {
+        // Normalize the subnormal value
+        exponent = 113u;
+        while (!(mantissa & 0x400u))
+            mantissa <<= 1, --exponent;
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+    else
+        bits = sign;
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief Converts a single-precision float into IEEE 754 half-precision bits.
+ * Rounds to the nearest even value, producing subnormals and infinities where needed.
+ */
+inline f16_bits_t f32_to_f16(float value) noexcept {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::uint32_t sign = (bits >> 16) & 0x8000u;
+    std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+    if (magnitude >= 0x7F800000u)
+        return static_cast<f16_bits_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    if (magnitude >= 0x477FF000u)
+        return static_cast<f16_bits_t>(sign | 0x7C00u);
+    if (magnitude < 0x33000000u)
+        return static_cast<f16_bits_t>(sign);
+
+    std::uint32_t half, rest, halfway;
+    if (magnitude < 0x38800000u) {
+        // Denormalize the value, that is too small for the half-precision exponent
+        std::uint32_t shift = 126u - (magnitude >> 23);
+        std::uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1u);
+        halfway = 1u << (shift - 1u);
+    }
+    else {
+        half = (magnitude - 0x38000000u) >> 13;
+        rest = magnitude & 0x1FFFu;
+        halfway = 0x1000u;
+    }
+    half += rest > halfway || (rest == halfway && (half & 1u));
+    return static_cast<f16_bits_t>(sign | half);
+}
+
+#pragma region Serial
+
+inline std::int64_t i8_dot_serial(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    std::int64_t ab = 0;
+    for (std::size_t i = 0; i != n; ++i)
+        ab += std::int32_t(a[i]) * std::int32_t(b[i]);
+    return ab;
+}
+
+inline i8_dot_and_norms_t i8_dot_and_norms_serial(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    i8_dot_and_norms_t result;
+    for (std::size_t i = 0; i != n; ++i) {
+        std::int32_t ai = a[i], bi = b[i];
+        result.ab += ai * bi;
+        result.aa += ai * ai;
+        result.bb += bi * bi;
+    }
+    return result;
+}
+
+inline std::int64_t i8_l2_squared_serial(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    std::int64_t sum = 0;
+    for (std::size_t i = 0; i != n; ++i) {
+        std::int32_t diff = std::int32_t(a[i]) - std::int32_t(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+template <typename scalar_at, typename convert_at>
+float dot_serial(scalar_at const* a, scalar_at const* b, std::size_t n, convert_at convert) noexcept {
+    float ab = 0;
+    for (std::size_t i = 0; i != n; ++i)
+        ab += convert(a[i]) * convert(b[i]);
+    return ab;
+}
+
+template <typename scalar_at, typename convert_at>
+f32_dot_and_norms_t dot_and_norms_serial(scalar_at const* a, scalar_at const* b, std::size_t n, convert_at convert) noexcept {
+    f32_dot_and_norms_t result;
+    for (std::size_t i = 0; i != n; ++i) {
+        float ai = convert(a[i]), bi = convert(b[i]);
+        result.ab += ai * bi;
+        result.aa += ai * ai;
+        result.bb += bi * bi;
+    }
+    return result;
+}
+
+template <typename scalar_at, typename convert_at>
+float l2_squared_serial(scalar_at const* a, scalar_at const* b, std::size_t n, convert_at convert) noexcept {
+    float sum = 0;
+    for (std::size_t i = 0; i != n; ++i) {
+        float diff = convert(a[i]) - convert(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+inline float f32_identity(float x) noexcept {
+    return x;
+}
+
+inline float f32_dot_serial(float const* a, float const* b, std::size_t n) noexcept {
+    return dot_serial(a, b, n, &f32_identity);
+}
+inline f32_dot_and_norms_t f32_dot_and_norms_serial(float const* a, float const* b, std::size_t n) noexcept {
+    return dot_and_norms_serial(a, b, n, &f32_identity);
+}
+inline float f32_l2_squared_serial(float const* a, float const* b, std::size_t n) noexcept {
+    return l2_squared_serial(a, b, n, &f32_identity);
+}
+inline float f16_dot_serial(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return dot_serial(a, b, n, &f16_to_f32);
+}
+inline f32_dot_and_norms_t f16_dot_and_norms_serial(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return dot_and_norms_serial(a, b, n, &f16_to_f32);
+}
+inline float f16_l2_squared_serial(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return l2_squared_serial(a, b, n, &f16_to_f32);
+}
+
+inline std::size_t b1_hamming_serial(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) noexcept {
+    auto word = [](std::uint8_t const* ptr) noexcept {
+        std::uint64_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    };
+    // Independent counters hide the latency of population counts
+    std::uint64_t counts[4] = {0, 0, 0, 0};
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        counts[0] += __builtin_popcountll(word(a + i) ^ word(b + i));
+        counts[1] += __builtin_popcountll(word(a + i + 8) ^ word(b + i + 8));
+        counts[2] += __builtin_popcountll(word(a + i + 16) ^ word(b + i + 16));
+        counts[3] += __builtin_popcountll(word(a + i + 24) ^ word(b + i + 24));
+    }
+    for (; i + 8 <= n; i += 8)
+        counts[0] += __builtin_popcountll(word(a + i) ^ word(b + i));
+    for (; i != n; ++i)
+        counts[1] += __builtin_popcount(unsigned(a[i] ^ b[i]));
+    return counts[0] + counts[1] + counts[2] + counts[3];
+}
+
+#pragma endregion
+
+#if defined(USTORE_DISTANCES_X86)
+#pragma region AVX2
+
+#define USTORE_AVX2_TARGET __attribute__((target("avx2,fma,f16c,popcnt")))
+
+USTORE_AVX2_TARGET inline std::int32_t reduce_avx2(__m256i x) noexcept {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+USTORE_AVX2_TARGET inline float reduce_avx2(__m256 x) noexcept {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+/// Sign-extends 16 consecutive bytes into 16-bit lanes.
+USTORE_AVX2_TARGET inline __m256i load_i8x16_avx2(std::int8_t const* ptr) noexcept {
+    return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr)));
+}
+
+USTORE_AVX2_TARGET inline std::int64_t i8_dot_avx2(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    __m256i ab = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        ab = _mm256_add_epi32(ab, _mm256_madd_epi16(load_i8x16_avx2(a + i), load_i8x16_avx2(b + i)));
+    return reduce_avx2(ab) + i8_dot_serial(a + i, b + i, n - i);
+}
+
+USTORE_AVX2_TARGET inline i8_dot_and_norms_t i8_dot_and_norms_avx2(std::int8_t const* a,
+                                                                   std::int8_t const* b,
+                                                                   std::size_t n) noexcept {
+    __m256i ab = _mm256_setzero_si256();
+    __m256i aa = _mm256_setzero_si256();
+    __m256i bb = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i ai = load_i8x16_avx2(a + i);
+        __m256i bi = load_i8x16_avx2(b + i);
+        ab = _mm256_add_epi32(ab, _mm256_madd_epi16(ai, bi));
+        aa = _mm256_add_epi32(aa, _mm256_madd_epi16(ai, ai));
+        bb = _mm256_add_epi32(bb, _mm256_madd_epi16(bi, bi));
+    }
+    i8_dot_and_norms_t result = i8_dot_and_norms_serial(a + i, b + i, n - i);
+    result.ab += reduce_avx2(ab);
+    result.aa += reduce_avx2(aa);
+    result.bb += reduce_avx2(bb);
+    return result;
+}
+
+USTORE_AVX2_TARGET inline std::int64_t i8_l2_squared_avx2(std::int8_t const* a,
+                                                          std::int8_t const* b,
+                                                          std::size_t n) noexcept {
+    __m256i sum = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i diff = _mm256_sub_epi16(load_i8x16_avx2(a + i), load_i8x16_avx2(b + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(diff, diff));
+    }
+    return reduce_avx2(sum) + i8_l2_squared_serial(a + i, b + i, n - i);
+}
+
+USTORE_AVX2_TARGET inline __m256 load_f32x8_avx2(float const* ptr) noexcept {
+    return _mm256_loadu_ps(ptr);
+}
+
+USTORE_AVX2_TARGET inline __m256 load_f32x8_avx2(f16_bits_t const* ptr) noexcept {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr)));
+}
+
+template <typename scalar_at, typename convert_at>
+USTORE_AVX2_TARGET float dot_avx2(scalar_at const* a, scalar_at const* b, std::size_t n, convert_at convert) noexcept {
+    __m256 ab = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        ab = _mm256_fmadd_ps(load_f32x8_avx2(a + i), load_f32x8_avx2(b + i), ab);
+    return reduce_avx2(ab) + dot_serial(a + i, b + i, n - i, convert);
+}
+
+template <typename scalar_at, typename convert_at>
+USTORE_AVX2_TARGET f32_dot_and_norms_t dot_and_norms_avx2(scalar_at const* a,
+                                                          scalar_at const* b,
+                                                          std::size_t n,
+                                                          convert_at convert) noexcept {
+    __m256 ab = _mm256_setzero_ps();
+    __m256 aa = _mm256_setzero_ps();
+    __m256 bb = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 ai = load_f32x8_avx2(a + i);
+        __m256 bi = load_f32x8_avx2(b + i);
+        ab = _mm256_fmadd_ps(ai, bi, ab);
+        aa = _mm256_fmadd_ps(ai, ai, aa);
+        bb = _mm256_fmadd_ps(bi, bi, bb);
+    }
+    f32_dot_and_norms_t result = dot_and_norms_serial(a + i, b + i, n - i, convert);
+    result.ab += reduce_avx2(ab);
+    result.aa += reduce_avx2(aa);
+    result.bb += reduce_avx2(bb);
+    return result;
+}
+
+template <typename scalar_at, typename convert_at>
+USTORE_AVX2_TARGET float l2_squared_avx2(scalar_at const* a,
+                                         scalar_at const* b,
+                                         std::size_t n,
+                                         convert_at convert) noexcept {
+    __m256 sum = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 diff = _mm256_sub_ps(load_f32x8_avx2(a + i), load_f32x8_avx2(b + i));
+        sum = _mm256_fmadd_ps(diff, diff, sum);
+    }
+    return reduce_avx2(sum) + l2_squared_serial(a + i, b + i, n - i, convert);
+}
+
+USTORE_AVX2_TARGET inline float f32_dot_avx2(float const* a, float const* b, std::size_t n) noexcept {
+    return dot_avx2(a, b, n, &f32_identity);
+}
+USTORE_AVX2_TARGET inline f32_dot_and_norms_t f32_dot_and_norms_avx2(float const* a,
+                                                                     float const* b,
+                                                                     std::size_t n) noexcept {
+    return dot_and_norms_avx2(a, b, n, &f32_identity);
+}
+USTORE_AVX2_TARGET inline float f32_l2_squared_avx2(float const* a, float const* b, std::size_t n) noexcept {
+    return l2_squared_avx2(a, b, n, &f32_identity);
+}
+USTORE_AVX2_TARGET inline float f16_dot_avx2(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return dot_avx2(a, b, n, &f16_to_f32);
+}
+USTORE_AVX2_TARGET inline f32_dot_and_norms_t f16_dot_and_norms_avx2(f16_bits_t const* a,
+                                                                     f16_bits_t const* b,
+                                                                     std::size_t n) noexcept {
+    return dot_and_norms_avx2(a, b, n, &f16_to_f32);
+}
+USTORE_AVX2_TARGET inline float f16_l2_squared_avx2(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return l2_squared_avx2(a, b, n, &f16_to_f32);
+}
+
+/// Uses the scalar `popcnt` instruction, which keeps up with shuffle-based AVX2 counters on short codes.
+USTORE_AVX2_TARGET inline std::size_t b1_hamming_avx2(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) noexcept {
+    auto word = [](std::uint8_t const* ptr) noexcept {
+        std::uint64_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    };
+    // Independent counters hide the latency of population counts
+    std::uint64_t counts[4] = {0, 0, 0, 0};
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        counts[0] += _mm_popcnt_u64(word(a + i) ^ word(b + i));
+        counts[1] += _mm_popcnt_u64(word(a + i + 8) ^ word(b + i + 8));
+        counts[2] += _mm_popcnt_u64(word(a + i + 16) ^ word(b + i + 16));
+        counts[3] += _mm_popcnt_u64(word(a + i + 24) ^ word(b + i + 24));
+    }
+    for (; i + 8 <= n; i += 8)
+        counts[0] += _mm_popcnt_u64(word(a + i) ^ word(b + i));
+    for (; i != n; ++i)
+        counts[1] += _mm_popcnt_u32(unsigned(a[i] ^ b[i]));
+    return counts[0] + counts[1] + counts[2] + counts[3];
+}
+
+#pragma endregion
+#pragma region AVX512
+
+#define USTORE_AVX512_TARGET __attribute__((target("avx512f,avx512bw,avx512vl,avx512vnni,avx2,fma,f16c,popcnt")))
+
+/// Sign-extends up to 32 consecutive bytes into 16-bit lanes, zeroing the rest.
+USTORE_AVX512_TARGET inline __m512i load_i8x32_avx512(std::int8_t const* ptr, std::size_t n) noexcept {
+    __mmask32 mask = n >= 32 ? __mmask32(0xFFFFFFFFu) : __mmask32((1u << n) - 1u);
+    return _mm512_cvtepi8_epi16(_mm256_maskz_loadu_epi8(mask, ptr));
+}
+
+/// Sign-extends 32 consecutive bytes into 16-bit lanes.
+USTORE_AVX512_TARGET inline __m512i load_i8x32_avx512(std::int8_t const* ptr) noexcept {
+    return _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr)));
+}
+
+/**
+ * @brief Shared loop of all the `i8` kernels. Keeps two independent chains of
+ * accumulators to hide the latency of VNNI instructions. Masked loads are
+ * only used for the tail.
+ */
+template <typename accumulate_at>
+USTORE_AVX512_TARGET void i8_loop_avx512(std::int8_t const* a,
+                                         std::int8_t const* b,
+                                         std::size_t n,
+                                         accumulate_at&& accumulate) noexcept {
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        accumulate(0, load_i8x32_avx512(a + i), load_i8x32_avx512(b + i));
+        accumulate(1, load_i8x32_avx512(a + i + 32), load_i8x32_avx512(b + i + 32));
+    }
+    for (; i < n; i += 32)
+        accumulate(0, load_i8x32_avx512(a + i, n - i), load_i8x32_avx512(b + i, n - i));
+}
+
+USTORE_AVX512_TARGET inline std::int64_t i8_dot_avx512(std::int8_t const* a,
+                                                       std::int8_t const* b,
+                                                       std::size_t n) noexcept {
+    __m512i ab[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    i8_loop_avx512(a, b, n, [&](std::size_t chain, __m512i ai, __m512i bi) USTORE_AVX512_TARGET {
+        ab[chain] = _mm512_dpwssd_epi32(ab[chain], ai, bi);
+    });
+    return _mm512_reduce_add_epi32(_mm512_add_epi32(ab[0], ab[1]));
+}
+
+USTORE_AVX512_TARGET inline i8_dot_and_norms_t i8_dot_and_norms_avx512(std::int8_t const* a,
+                                                                       std::int8_t const* b,
+                                                                       std::size_t n) noexcept {
+    __m512i ab[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    __m512i aa[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    __m512i bb[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    i8_loop_avx512(a, b, n, [&](std::size_t chain, __m512i ai, __m512i bi) USTORE_AVX512_TARGET {
+        ab[chain] = _mm512_dpwssd_epi32(ab[chain], ai, bi);
+        aa[chain] = _mm512_dpwssd_epi32(aa[chain], ai, ai);
+        bb[chain] = _mm512_dpwssd_epi32(bb[chain], bi, bi);
+    });
+    i8_dot_and_norms_t result;
+    result.ab = _mm512_reduce_add_epi32(_mm512_add_epi32(ab[0], ab[1]));
+    result.aa = _mm512_reduce_add_epi32(_mm512_add_epi32(aa[0], aa[1]));
+    result.bb = _mm512_reduce_add_epi32(_mm512_add_epi32(bb[0], bb[1]));
+    return result;
+}
+
+USTORE_AVX512_TARGET inline std::int64_t i8_l2_squared_avx512(std::int8_t const* a,
+                                                              std::int8_t const* b,
+                                                              std::size_t n) noexcept {
+    __m512i sum[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    i8_loop_avx512(a, b, n, [&](std::size_t chain, __m512i ai, __m512i bi) USTORE_AVX512_TARGET {
+        __m512i diff = _mm512_sub_epi16(ai, bi);
+        sum[chain] = _mm512_dpwssd_epi32(sum[chain], diff, diff);
+    });
+    return _mm512_reduce_add_epi32(_mm512_add_epi32(sum[0], sum[1]));
+}
+
+USTORE_AVX512_TARGET inline __m512 load_f32x16_avx512(float const* ptr, std::size_t n) noexcept {
+    __mmask16 mask = n >= 16 ? __mmask16(0xFFFFu) : __mmask16((1u << n) - 1u);
+    return _mm512_maskz_loadu_ps(mask, ptr);
+}
+
+USTORE_AVX512_TARGET inline __m512 load_f32x16_avx512(f16_bits_t const* ptr, std::size_t n) noexcept {
+    __mmask16 mask = n >= 16 ? __mmask16(0xFFFFu) : __mmask16((1u << n) - 1u);
+    return _mm512_cvtph_ps(_mm256_maskz_loadu_epi16(mask, ptr));
+}
+
+template <typename scalar_at>
+USTORE_AVX512_TARGET float dot_avx512(scalar_at const* a, scalar_at const* b, std::size_t n) noexcept {
+    __m512 ab = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < n; i += 16)
+        ab = _mm512_fmadd_ps(load_f32x16_avx512(a + i, n - i), load_f32x16_avx512(b + i, n - i), ab);
+    return _mm512_reduce_add_ps(ab);
+}
+
+template <typename scalar_at>
+USTORE_AVX512_TARGET f32_dot_and_norms_t dot_and_norms_avx512(scalar_at const* a,
+                                                              scalar_at const* b,
+                                                              std::size_t n) noexcept {
+    __m512 ab = _mm512_setzero_ps();
+    __m512 aa = _mm512_setzero_ps();
+    __m512 bb = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < n; i += 16) {
+        __m512 ai = load_f32x16_avx512(a + i, n - i);
+        __m512 bi = load_f32x16_avx512(b + i, n - i);
+        ab = _mm512_fmadd_ps(ai, bi, ab);
+        aa = _mm512_fmadd_ps(ai, ai, aa);
+        bb = _mm512_fmadd_ps(bi, bi, bb);
+    }
+    f32_dot_and_norms_t result;
+    result.ab = _mm512_reduce_add_ps(ab);
+    result.aa = _mm512_reduce_add_ps(aa);
+    result.bb = _mm512_reduce_add_ps(bb);
+    return result;
+}
+
+template <typename scalar_at>
+USTORE_AVX512_TARGET float l2_squared_avx512(scalar_at const* a, scalar_at const* b, std::size_t n) noexcept {
+    __m512 sum = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < n; i += 16) {
+        __m512 diff = _mm512_sub_ps(load_f32x16_avx512(a + i, n - i), load_f32x16_avx512(b + i, n - i));
+        sum = _mm512_fmadd_ps(diff, diff, sum);
+    }
+    return _mm512_reduce_add_ps(sum);
+}
+
+USTORE_AVX512_TARGET inline float f32_dot_avx512(float const* a, float const* b, std::size_t n) noexcept {
+    return dot_avx512(a, b, n);
+}
+USTORE_AVX512_TARGET inline f32_dot_and_norms_t f32_dot_and_norms_avx512(float const* a,
+                                                                         float const* b,
+                                                                         std::size_t n) noexcept {
+    return dot_and_norms_avx512(a, b, n);
+}
+USTORE_AVX512_TARGET inline float f32_l2_squared_avx512(float const* a, float const* b, std::size_t n) noexcept {
+    return l2_squared_avx512(a, b, n);
+}
+USTORE_AVX512_TARGET inline float f16_dot_avx512(f16_bits_t const* a, f16_bits_t const* b, std::size_t n) noexcept {
+    return dot_avx512(a, b, n);
+}
+USTORE_AVX512_TARGET inline f32_dot_and_norms_t f16_dot_and_norms_avx512(f16_bits_t const* a,
+                                                                         f16_bits_t const* b,
+                                                                         std::size_t n) noexcept {
+    return dot_and_norms_avx512(a, b, n);
+}
+USTORE_AVX512_TARGET inline float f16_l2_squared_avx512(f16_bits_t const* a,
+                                                        f16_bits_t const* b,
+                                                        std::size_t n) noexcept {
+    return l2_squared_avx512(a, b, n);
+}
+
+#pragma endregion
+#endif // USTORE_DISTANCES_X86
+
+#if defined(USTORE_DISTANCES_NEON)
+#pragma region NEON
+
+inline std::int64_t i8_dot_neon(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    int32x4_t ab = vdupq_n_s32(0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t ai = vld1q_s8(a + i);
+        int8x16_t bi = vld1q_s8(b + i);
+        ab = vpadalq_s16(ab, vmull_s8(vget_low_s8(ai), vget_low_s8(bi)));
+        ab = vpadalq_s16(ab, vmull_high_s8(ai, bi));
+    }
+    return vaddvq_s32(ab) + i8_dot_serial(a + i, b + i, n - i);
+}
+
+inline i8_dot_and_norms_t i8_dot_and_norms_neon(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    int32x4_t ab = vdupq_n_s32(0);
+    int32x4_t aa = vdupq_n_s32(0);
+    int32x4_t bb = vdupq_n_s32(0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t ai = vld1q_s8(a + i);
+        int8x16_t bi = vld1q_s8(b + i);
+        ab = vpadalq_s16(ab, vmull_s8(vget_low_s8(ai), vget_low_s8(bi)));
+        ab = vpadalq_s16(ab, vmull_high_s8(ai, bi));
+        aa = vpadalq_s16(aa, vmull_s8(vget_low_s8(ai), vget_low_s8(ai)));
+        aa = vpadalq_s16(aa, vmull_high_s8(ai, ai));
+        bb = vpadalq_s16(bb, vmull_s8(vget_low_s8(bi), vget_low_s8(bi)));
+        bb = vpadalq_s16(bb, vmull_high_s8(bi, bi));
+    }
+    i8_dot_and_norms_t result = i8_dot_and_norms_serial(a + i, b + i, n - i);
+    result.ab += vaddvq_s32(ab);
+    result.aa += vaddvq_s32(aa);
+    result.bb += vaddvq_s32(bb);
+    return result;
+}
+
+inline std::int64_t i8_l2_squared_neon(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    int32x4_t sum = vdupq_n_s32(0);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t diff = vsubl_s8(vld1_s8(a + i), vld1_s8(b + i));
+        sum = vmlal_s16(sum, vget_low_s16(diff), vget_low_s16(diff));
+        sum = vmlal_high_s16(sum, diff, diff);
+    }
+    return vaddvq_s32(sum) + i8_l2_squared_serial(a + i, b + i, n - i);
+}
+
+inline float f32_dot_neon(float const* a, float const* b, std::size_t n) noexcept {
+    float32x4_t ab = vdupq_n_f32(0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        ab = vfmaq_f32(ab, vld1q_f32(a + i), vld1q_f32(b + i));
+    return vaddvq_f32(ab) + f32_dot_serial(a + i, b + i, n - i);
+}
+
+inline f32_dot_and_norms_t f32_dot_and_norms_neon(float const* a, float const* b, std::size_t n) noexcept {
+    float32x4_t ab = vdupq_n_f32(0);
+    float32x4_t aa = vdupq_n_f32(0);
+    float32x4_t bb = vdupq_n_f32(0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t ai = vld1q_f32(a + i);
+        float32x4_t bi = vld1q_f32(b + i);
+        ab = vfmaq_f32(ab, ai, bi);
+        aa = vfmaq_f32(aa, ai, ai);
+        bb = vfmaq_f32(bb, bi, bi);
+    }
+    f32_dot_and_norms_t result = f32_dot_and_norms_serial(a + i, b + i, n - i);
+    result.ab += vaddvq_f32(ab);
+    result.aa += vaddvq_f32(aa);
+    result.bb += vaddvq_f32(bb);
+    return result;
+}
+
+inline float f32_l2_squared_neon(float const* a, float const* b, std::size_t n) noexcept {
+    float32x4_t sum = vdupq_n_f32(0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t diff = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        sum = vfmaq_f32(sum, diff, diff);
+    }
+    return vaddvq_f32(sum) + f32_l2_squared_serial(a + i, b + i, n - i);
+}
+
+inline std::size_t b1_hamming_neon(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) noexcept {
+    uint32x4_t sum = vdupq_n_u32(0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t bits = vcntq_u8(veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        sum = vpadalq_u16(sum, vpaddlq_u8(bits));
+    }
+    return vaddvq_u32(sum) + b1_hamming_serial(a + i, b + i, n - i);
+}
+
+#pragma endregion
+#endif // USTORE_DISTANCES_NEON
+
+#if defined(USTORE_DISTANCES_SVE)
+#pragma region SVE
+
+inline std::int64_t i8_dot_sve(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    svint32_t ab = svdup_s32(0);
+    for (std::size_t i = 0; i < n; i += svcntb()) {
+        svbool_t mask = svwhilelt_b8(i, n);
+        ab = svdot_s32(ab, svld1_s8(mask, a + i), svld1_s8(mask, b + i));
+    }
+    return svaddv_s32(svptrue_b32(), ab);
+}
+
+inline i8_dot_and_norms_t i8_dot_and_norms_sve(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    svint32_t ab = svdup_s32(0);
+    svint32_t aa = svdup_s32(0);
+    svint32_t bb = svdup_s32(0);
+    for (std::size_t i = 0; i < n; i += svcntb()) {
+        svbool_t mask = svwhilelt_b8(i, n);
+        svint8_t ai = svld1_s8(mask, a + i);
+        svint8_t bi = svld1_s8(mask, b + i);
+        ab = svdot_s32(ab, ai, bi);
+        aa = svdot_s32(aa, ai, ai);
+        bb = svdot_s32(bb, bi, bi);
+    }
+    i8_dot_and_norms_t result;
+    result.ab = svaddv_s32(svptrue_b32(), ab);
+    result.aa = svaddv_s32(svptrue_b32(), aa);
+    result.bb = svaddv_s32(svptrue_b32(), bb);
+    return result;
+}
+
+inline std::int64_t i8_l2_squared_sve(std::int8_t const* a, std::int8_t const* b, std::size_t n) noexcept {
+    // The difference of two bytes may not fit into a byte, so widen to 16 bits.
+    svint64_t sum = svdup_s64(0);
+    for (std::size_t i = 0; i < n; i += svcnth()) {
+        svbool_t mask = svwhilelt_b16(i, n);
+        svint16_t diff = svsub_s16_x(mask, svld1sb_s16(mask, a + i), svld1sb_s16(mask, b + i));
+        sum = svdot_s64(sum, diff, diff);
+    }
+    return svaddv_s64(svptrue_b64(), sum);
+}
+
+inline float f32_dot_sve(float const* a, float const* b, std::size_t n) noexcept {
+    svfloat32_t ab = svdup_f32(0);
+    for (std::size_t i = 0; i < n; i += svcntw()) {
+        svbool_t mask = svwhilelt_b32(i, n);
+        ab = svmla_f32_m(mask, ab, svld1_f32(mask, a + i), svld1_f32(mask, b + i));
+    }
+    return svaddv_f32(svptrue_b32(), ab);
+}
+
+inline f32_dot_and_norms_t f32_dot_and_norms_sve(float const* a, float const* b, std::size_t n) noexcept {
+    svfloat32_t ab = svdup_f32(0);
+    svfloat32_t aa = svdup_f32(0);
+    svfloat32_t bb = svdup_f32(0);
+    for (std::size_t i = 0; i < n; i += svcntw()) {
+        svbool_t mask = svwhilelt_b32(i, n);
+        svfloat32_t ai = svld1_f32(mask, a + i);
+        svfloat32_t bi = svld1_f32(mask, b + i);
+        ab = svmla_f32_m(mask, ab, ai, bi);
+        aa = svmla_f32_m(mask, aa, ai, ai);
+        bb = svmla_f32_m(mask, bb, bi, bi);
+    }
+    f32_dot_and_norms_t result;
+    result.ab = svaddv_f32(svptrue_b32(), ab);
+    result.aa = svaddv_f32(svptrue_b32(), aa);
+    result.bb = svaddv_f32(svptrue_b32(), bb);
+    return result;
+}
+
+inline float f32_l2_squared_sve(float const* a, float const* b, std::size_t n) noexcept {
+    svfloat32_t sum = svdup_f32(0);
+    for (std::size_t i = 0; i < n; i += svcntw()) {
+        svbool_t mask = svwhilelt_b32(i, n);
+        svfloat32_t diff = svsub_f32_m(mask, svld1_f32(mask, a + i), svld1_f32(mask, b + i));
+        sum = svmla_f32_m(mask, sum, diff, diff);
+    }
+    return svaddv_f32(svptrue_b32(), sum);
+}
+
+#pragma endregion
+#endif // USTORE_DISTANCES_SVE
+
+/**
+ * @brief Checks if the current CPU can execute kernels of a certain instruction set.
+ */
+inline bool simd_isa_supported(simd_isa_t isa) noexcept {
+    switch (isa) {
+    case simd_isa_t::serial_k: return true;
+#if defined(USTORE_DISTANCES_X86)
+    case simd_isa_t::avx2_k:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c") &&
+               __builtin_cpu_supports("popcnt");
+    case simd_isa_t::avx512_k:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512vnni") &&
+               simd_isa_supported(simd_isa_t::avx2_k);
+#endif
+#if defined(USTORE_DISTANCES_NEON)
+    case simd_isa_t::neon_k: return true;
+#endif
+#if defined(USTORE_DISTANCES_SVE)
+    case simd_isa_t::sve_k: return true;
+#endif
+    default: return false;
+    }
+}
+
+/**
+ * @brief Assembles the table of kernels for a specific instruction set,
+ * without checking if it's supported. Missing kernels are backed by serial code.
+ * @see `simd_isa_supported()`.
+ */
+inline distance_kernels_t distance_kernels_for(simd_isa_t isa) noexcept {
+    distance_kernels_t kernels;
+    kernels.i8_dot = &i8_dot_serial;
+    kernels.i8_dot_and_norms = &i8_dot_and_norms_serial;
+    kernels.i8_l2_squared = &i8_l2_squared_serial;
+    kernels.f32_dot = &f32_dot_serial;
+    kernels.f32_dot_and_norms = &f32_dot_and_norms_serial;
+    kernels.f32_l2_squared = &f32_l2_squared_serial;
+    kernels.f16_dot = &f16_dot_serial;
+    kernels.f16_dot_and_norms = &f16_dot_and_norms_serial;
+    kernels.f16_l2_squared = &f16_l2_squared_serial;
+    kernels.b1_hamming = &b1_hamming_serial;
+
+    switch (isa) {
+#if defined(USTORE_DISTANCES_X86)
+    case simd_isa_t::avx2_k:
+        kernels.isa = isa;
+        kernels.name = "avx2";
+        kernels.i8_dot = &i8_dot_avx2;
+        kernels.i8_dot_and_norms = &i8_dot_and_norms_avx2;
+        kernels.i8_l2_squared = &i8_l2_squared_avx2;
+        kernels.f32_dot = &f32_dot_avx2;
+        kernels.f32_dot_and_norms = &f32_dot_and_norms_avx2;
+        kernels.f32_l2_squared = &f32_l2_squared_avx2;
+        kernels.f16_dot = &f16_dot_avx2;
+        kernels.f16_dot_and_norms = &f16_dot_and_norms_avx2;
+        kernels.f16_l2_squared = &f16_l2_squared_avx2;
+        kernels.b1_hamming = &b1_hamming_avx2;
+        break;
+    case simd_isa_t::avx512_k:
+        kernels.isa = isa;
+        kernels.name = "avx512";
+        kernels.i8_dot = &i8_dot_avx512;
+        kernels.i8_dot_and_norms = &i8_dot_and_norms_avx512;
+        kernels.i8_l2_squared = &i8_l2_squared_avx512;
+        kernels.f32_dot = &f32_dot_avx512;
+        kernels.f32_dot_and_norms = &f32_dot_and_norms_avx512;
+        kernels.f32_l2_squared = &f32_l2_squared_avx512;
+        kernels.f16_dot = &f16_dot_avx512;
+        kernels.f16_dot_and_norms = &f16_dot_and_norms_avx512;
+        kernels.f16_l2_squared = &f16_l2_squared_avx512;
+        kernels.b1_hamming = &b1_hamming_avx2;
+        break;
+#endif
+#if defined(USTORE_DISTANCES_NEON)
+    case simd_isa_t::neon_k:
+        kernels.isa = isa;
+        kernels.name = "neon";
+        kernels.i8_dot = &i8_dot_neon;
+        kernels.i8_dot_and_norms = &i8_dot_and_norms_neon;
+        kernels.i8_l2_squared = &i8_l2_squared_neon;
+        kernels.f32_dot = &f32_dot_neon;
+        kernels.f32_dot_and_norms = &f32_dot_and_norms_neon;
+        kernels.f32_l2_squared = &f32_l2_squared_neon;
+        kernels.b1_hamming = &b1_hamming_neon;
+        break;
+#endif
+#if defined(USTORE_DISTANCES_SVE)
+    case simd_isa_t::sve_k:
+        kernels.isa = isa;
+        kernels.name = "sve";
+        kernels.i8_dot = &i8_dot_sve;
+        kernels.i8_dot_and_norms = &i8_dot_and_norms_sve;
+        kernels.i8_l2_squared = &i8_l2_squared_sve;
+        kernels.f32_dot = &f32_dot_sve;
+        kernels.f32_dot_and_norms = &f32_dot_and_norms_sve;
+        kernels.f32_l2_squared = &f32_l2_squared_sve;
+#if defined(USTORE_DISTANCES_NEON)
+        kernels.b1_hamming = &b1_hamming_neon;
+#endif
+        break;
+#endif
+    default: break;
+    }
+    return kernels;
+}
+
+/**
+ * @brief Returns the fastest kernels supported by the current CPU.
+ * The choice is made once and cached for the lifetime of the process.
+ */
+inline distance_kernels_t const& distance_kernels() noexcept {
+    static distance_kernels_t const kernels = [] {
+        simd_isa_t preferences[] = {simd_isa_t::sve_k, simd_isa_t::avx512_k, simd_isa_t::neon_k, simd_isa_t::avx2_k};
+        for (simd_isa_t isa : preferences)
+            if (simd_isa_supported(isa))
+                return distance_kernels_for(isa);
+        return distance_kernels_for(simd_isa_t::serial_k);
+    }();
+    return kernels;
+}
+
+} // namespace unum::ustore
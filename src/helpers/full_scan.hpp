@@ -6,8 +6,11 @@
  */
 #pragma once
 #include <random>
+#include <algorithm> // `std::sort`
+#include <type_traits>
 
 #include "ustore/blobs.h"
+#include "helpers/key_format.hpp" // `decode_key`
 
 namespace unum::ustore {
 
@@ -27,6 +30,8 @@ void full_scan_collection( //
     while (!*error) {
         ustore_length_t* found_blobs_count {};
         ustore_key_t* found_blobs_keys {};
+        ustore_length_t* found_blobs_offsets {};
+        ustore_byte_t* found_blobs_data {};
         ustore_scan_t scan {};
         scan.db = db;
         scan.error = error;
@@ -39,35 +44,14 @@ void full_scan_collection( //
         scan.count_limits = &read_ahead;
         scan.counts = &found_blobs_count;
         scan.keys = &found_blobs_keys;
+        scan.values_offsets = &found_blobs_offsets;
+        scan.values = &found_blobs_data;
 
+        // Keys and values are fetched in the same pass
         ustore_scan(&scan);
         if (*error)
             break;
 
-        if (found_blobs_count[0] <= 1)
-            // We have reached the end of collection
-            break;
-
-        ustore_length_t* found_blobs_offsets {};
-        ustore_byte_t* found_blobs_data {};
-        ustore_read_t read {};
-        read.db = db;
-        read.error = error;
-        read.transaction = transaction;
-        read.arena = arena;
-        read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
-        read.tasks_count = found_blobs_count[0];
-        read.collections = &collection;
-        read.collections_stride = 0;
-        read.keys = found_blobs_keys;
-        read.keys_stride = sizeof(ustore_key_t);
-        read.offsets = &found_blobs_offsets;
-        read.values = &found_blobs_data;
-
-        ustore_read(&read);
-        if (*error)
-            break;
-
         ustore_length_t const count_blobs = found_blobs_count[0];
         joined_blobs_iterator_t found_blobs {found_blobs_offsets, found_blobs_data};
         for (std::size_t i = 0; i != count_blobs; ++i, ++found_blobs) {
@@ -76,6 +60,10 @@ void full_scan_collection( //
                 return;
         }
 
+        if (count_blobs < read_ahead)
+            // We have reached the end of collection
+            break;
+
         start_key = found_blobs_keys[count_blobs - 1] + 1;
     }
 }
@@ -86,6 +74,7 @@ void full_scan_collection( //
  */
 template <typename level_or_rocks_iterator_at>
 void reservoir_sample_iterator(level_or_rocks_iterator_at&& iterator,
+                               key_format_t format,
                                ptr_range_gt<ustore_key_t> sampled_keys,
                                ustore_error_t* c_error) noexcept {
 
@@ -96,13 +85,65 @@ void reservoir_sample_iterator(level_or_rocks_iterator_at&& iterator,
     std::size_t i = 0;
     for (iterator->SeekToFirst(); i < sampled_keys.size(); ++i, iterator->Next()) {
         return_error_if_m(iterator->Valid(), c_error, 0, "Sample Failure!");
-        std::memcpy(&sampled_keys[i], iterator->key().data(), sizeof(ustore_key_t));
+        sampled_keys[i] = decode_key(iterator->key().data(), format);
     }
 
     for (std::size_t j = 0; iterator->Valid(); ++i, iterator->Next()) {
         j = dist(random_generator) % (i + 1);
         if (j < sampled_keys.size())
-            std::memcpy(&sampled_keys[j], iterator->key().data(), sizeof(ustore_key_t));
+            sampled_keys[j] = decode_key(iterator->key().data(), format);
+    }
+}
+
+/**
+ * @brief Approximately uniform sampling for RocksDB or LevelDB collections, costing O(k) seeks.
+ *
+ * Draws k random targets between the first and the last present keys, and picks the
+ * first present key at or after each. Keys following wide gaps in the key space are
+ * therefore picked more often than with `reservoir_sample_iterator`. Dense or tiny
+ * collections, that can't provide k distinct keys that way, fall back to the reservoir.
+ */
+template <typename level_or_rocks_iterator_at>
+void seek_sample_iterator(level_or_rocks_iterator_at&& iterator,
+                          key_format_t format,
+                          ptr_range_gt<ustore_key_t> sampled_keys,
+                          ustore_error_t* c_error) noexcept {
+
+    using slice_t = std::decay_t<decltype(iterator->key())>;
+    if (sampled_keys.empty())
+        return;
+
+    iterator->SeekToFirst();
+    return_error_if_m(iterator->Valid(), c_error, 0, "Sample Failure!");
+    ustore_key_t const first_key = decode_key(iterator->key().data(), format);
+    iterator->SeekToLast();
+    ustore_key_t const last_key = decode_key(iterator->key().data(), format);
+
+    // With less than two keys of span per sample, seeks would mostly collide
+    std::uint64_t const span = static_cast<std::uint64_t>(last_key) - static_cast<std::uint64_t>(first_key);
+    if (span / 2 < sampled_keys.size())
+        return reservoir_sample_iterator(iterator, format, sampled_keys, c_error);
+
+    std::random_device random_device;
+    std::mt19937_64 random_generator(random_device());
+    std::uniform_int_distribution<std::uint64_t> dist(0, span);
+    for (auto& key : sampled_keys)
+        key = static_cast<ustore_key_t>(static_cast<std::uint64_t>(first_key) + dist(random_generator));
+    std::sort(sampled_keys.begin(), sampled_keys.end());
+
+    // Every seek starts past the previous pick, so the sample has no duplicates
+    for (std::size_t i = 0; i != sampled_keys.size(); ++i) {
+        ustore_key_t target = sampled_keys[i];
+        if (i) {
+            ustore_key_t const previous = sampled_keys[i - 1];
+            if (previous == last_key)
+                return reservoir_sample_iterator(iterator, format, sampled_keys, c_error);
+            target = std::max(target, previous + 1);
+        }
+        iterator->Seek(encoded_key_gt<slice_t>(target, format));
+        if (!iterator->Valid())
+            return reservoir_sample_iterator(iterator, format, sampled_keys, c_error);
+        sampled_keys[i] = decode_key(iterator->key().data(), format);
     }
 }
 
@@ -0,0 +1,77 @@
+/**
+ * @file group_commit.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Coalesces the log syncs of concurrent durable writes.
+ *
+ * Small transactions, committed with `ustore_option_write_flush_k`, spend most
+ * of their time waiting for `fsync`. Here every writer takes a ticket, once its
+ * changes are in the log, and the first writer without a leader syncs the log
+ * for all the tickets taken so far. Others just wait for it to finish.
+ *
+ * If the leader sees other writers around, it may wait up to a configured
+ * amount of microseconds, before syncing, letting more of them join the batch.
+ * A lonely writer never waits, so sequential workloads aren't penalized.
+ */
+#pragma once
+#include <chrono>             // `std::chrono::microseconds`
+#include <condition_variable> // `std::condition_variable`
+#include <cstddef>            // `std::size_t`
+#include <cstdint>            // `std::uint64_t`
+#include <mutex>              // `std::mutex`
+
+namespace unum::ustore {
+
+class group_commit_t {
+    std::mutex mutex_;
+    std::condition_variable synced_cv_;
+    std::condition_variable delay_cv_;
+    std::chrono::microseconds max_wait_ {0};
+    std::uint64_t requested_ = 0;
+    std::uint64_t synced_ = 0;
+    std::size_t waiting_ = 0;
+    bool syncing_ = false;
+    bool failed_ = false;
+
+  public:
+    explicit group_commit_t(std::chrono::microseconds max_wait = {}) noexcept : max_wait_(max_wait) {}
+    group_commit_t(group_commit_t const&) = delete;
+    group_commit_t& operator=(group_commit_t const&) = delete;
+
+    std::chrono::microseconds max_wait() const noexcept { return max_wait_; }
+
+    /**
+     * @brief Waits until the log is synced past the changes of the caller,
+     * that must have already been written to it with no sync of their own.
+     * @param sync Callback, syncing the log and returning false on failure.
+     * @return false If this or a previous sync has failed. The log can't be trusted afterwards.
+     */
+    template <typename sync_at>
+    bool commit(sync_at&& sync) noexcept {
+        std::unique_lock lock(mutex_);
+        std::uint64_t const ticket = ++requested_;
+        ++waiting_;
+        while (synced_ < ticket && !failed_) {
+            if (syncing_) {
+                synced_cv_.wait(lock);
+                continue;
+            }
+
+            syncing_ = true;
+            if (max_wait_.count() && waiting_ > 1)
+                delay_cv_.wait_for(lock, max_wait_);
+            std::uint64_t const target = requested_;
+            lock.unlock();
+            bool const succeeded = sync();
+            lock.lock();
+            failed_ |= !succeeded;
+            synced_ = target;
+            syncing_ = false;
+            synced_cv_.notify_all();
+        }
+        --waiting_;
+        return !failed_;
+    }
+};
+
+} // namespace unum::ustore
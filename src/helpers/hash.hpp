@@ -0,0 +1,122 @@
+/**
+ * @file hash.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Stable non-cryptographic hashing of byte strings.
+ *
+ * Unlike `std::hash`, which output is implementation-defined and differs between
+ * standard libraries, these hashes are fixed, so they can be persisted. The construction
+ * follows the 4th final revision of wyhash by Wang Yi. Inputs are read as little-endian
+ * words on every platform, so the outputs don't depend on the CPU either.
+ * Changing anything here changes the keys of persisted paths collections!
+ */
+#pragma once
+#include <cstdint>     // `std::uint64_t`
+#include <cstring>     // `std::memcpy`
+#include <string_view> // `std::string_view`
+
+namespace unum::ustore {
+
+namespace stable_hash_detail {
+
+constexpr std::uint64_t secret_k[4] = {
+    0x2d358dccaa6c78a5ull,
+    0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull,
+    0x4d5a2da51de1aa47ull,
+};
+
+inline void multiply(std::uint64_t& a, std::uint64_t& b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    a = static_cast<std::uint64_t>(product);
+    b = static_cast<std::uint64_t>(product >> 64);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<std::uint32_t>(a), lb = static_cast<std::uint32_t>(b);
+    std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    std::uint64_t carry = t < rl;
+    std::uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    a = lo;
+    b = hi;
+#endif
+}
+
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) noexcept {
+    multiply(a, b);
+    return a ^ b;
+}
+
+inline std::uint64_t read8(unsigned char const* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline std::uint64_t read4(unsigned char const* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline std::uint64_t read3(unsigned char const* p, std::size_t k) noexcept {
+    return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+} // namespace stable_hash_detail
+
+/**
+ * @brief Hashes a string into 64 bits, identically on every platform and toolchain.
+ * Different `seed` values produce independent hashes of the same input.
+ */
+inline std::uint64_t stable_hash(std::string_view str, std::uint64_t seed = 0) noexcept {
+    using namespace stable_hash_detail;
+    auto p = reinterpret_cast<unsigned char const*>(str.data());
+    std::size_t const len = str.size();
+    seed ^= mix(seed ^ secret_k[0], secret_k[1]);
+
+    std::uint64_t a = 0, b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+            a = read3(p, len);
+    }
+    else {
+        std::size_t i = len;
+        if (i > 48) {
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ secret_k[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ secret_k[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ secret_k[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ secret_k[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= secret_k[1];
+    b ^= seed;
+    multiply(a, b);
+    return mix(a ^ secret_k[0] ^ len, b ^ secret_k[1]);
+}
+
+} // namespace unum::ustore
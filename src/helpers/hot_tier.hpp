@@ -0,0 +1,473 @@
+/**
+ * @file hot_tier.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief In-memory tier of frequently read pairs, in front of a persistent engine.
+ */
+#pragma once
+#include <array>    // `std::array`
+#include <atomic>   // `std::atomic`
+#include <memory>   // `std::unique_ptr`
+#include <mutex>    // `std::mutex`
+#include <optional> // `std::optional`
+#include <string>   // `std::string`
+#include <utility>  // `std::pair`
+#include <vector>   // `std::vector`
+
+#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+#include "helpers/lru.hpp"            // `lru_cache_gt`
+
+namespace unum::ustore {
+
+/**
+ * @brief How the writes reach the persistent engine.
+ *
+ * - Write-through: writes are applied to the engine first, and then to the copies in memory.
+ * - Write-back: writes stay in memory, until they are evicted or a flush is forced, like by
+ *   scans, snapshots or transactions, that must see them. Writes with `ustore_option_write_flush_k`
+ *   are always flushed before returning.
+ */
+enum class hot_policy_t {
+    write_through_k,
+    write_back_k,
+};
+
+/**
+ * @brief Count-Min sketch of recent accesses with 4 rows of saturating small counters.
+ * Once the number of recorded accesses reaches `sample`, all the counters are halved,
+ * so that the popularity fades with time, like in TinyLFU.
+ * Concurrent updates may be lost, which only makes the estimates less precise.
+ */
+class frequency_sketch_t {
+    static constexpr std::size_t depth_k = 4;
+    static constexpr std::uint8_t max_count_k = 15;
+
+    std::unique_ptr<std::atomic<std::uint8_t>[]> counters_;
+    std::size_t mask_ = 0;
+    std::size_t sample_ = 0;
+    std::atomic<std::size_t> recorded_ {0};
+    std::mutex aging_mutex_;
+
+    std::size_t slot(std::uint64_t hash, std::size_t row) const noexcept {
+        std::uint64_t mixed = (hash + row) * 0x9E3779B97F4A7C15ull;
+        return row * (mask_ + 1) + static_cast<std::size_t>((mixed >> 32) & mask_);
+    }
+
+    void age() noexcept {
+        std::unique_lock<std::mutex> lock(aging_mutex_, std::try_to_lock);
+        if (!lock || recorded_.load(std::memory_order_relaxed) < sample_)
+            return;
+        for (std::size_t i = 0; i != depth_k * (mask_ + 1); ++i)
+            counters_[i].store(counters_[i].load(std::memory_order_relaxed) >> 1, std::memory_order_relaxed);
+        recorded_.store(0, std::memory_order_relaxed);
+    }
+
+  public:
+    /** @param width Number of counters in every row, rounded up to a power of two. */
+    explicit frequency_sketch_t(std::size_t width) {
+        std::size_t columns = 64;
+        while (columns < width)
+            columns *= 2;
+        counters_.reset(new std::atomic<std::uint8_t>[depth_k * columns]());
+        mask_ = columns - 1;
+        sample_ = columns * 10;
+    }
+
+    void record(std::uint64_t hash) noexcept {
+        for (std::size_t row = 0; row != depth_k; ++row) {
+            std::atomic<std::uint8_t>& counter = counters_[slot(hash, row)];
+            std::uint8_t count = counter.load(std::memory_order_relaxed);
+            if (count != max_count_k)
+                counter.store(count + 1, std::memory_order_relaxed);
+        }
+        if (recorded_.fetch_add(1, std::memory_order_relaxed) + 1 >= sample_)
+            age();
+    }
+
+    std::uint8_t estimate(std::uint64_t hash) const noexcept {
+        std::uint8_t result = max_count_k;
+        for (std::size_t row = 0; row != depth_k; ++row)
+            result = std::min(result, counters_[slot(hash, row)].load(std::memory_order_relaxed));
+        return result;
+    }
+};
+
+/**
+ * @brief Bounded copies of the most frequently read pairs, including the missing ones,
+ * split into independently locked shards, each with its own LRU order.
+ *
+ * Keys are admitted after being requested at least `admit_after` times recently,
+ * and only if they are at least as popular as the entries they would evict.
+ * Every change of a shard, other than an admission, increments its epoch. Values, fetched
+ * from the engine on a miss, are only admitted, if the epoch hasn't changed since the miss,
+ * so that a concurrent write can't be shadowed by an older value.
+ *
+ * Transactions and snapshots bypass this tier and work directly with the engine,
+ * so all of the dirty pairs are flushed before those are started or committed.
+ */
+class hot_tier_t {
+  public:
+    static constexpr std::size_t shards_k = 64;
+    /** @brief Accounted memory usage of an entry, on top of its value. */
+    static constexpr std::size_t entry_overhead_k = 96;
+
+    /** @brief Shared, so that the hits can be exported after the shard is unlocked. NULL for missing values. */
+    using value_t = std::shared_ptr<std::string const>;
+    using epochs_t = std::array<std::uint64_t, shards_k>;
+    /** @brief Dirty pairs, passed to the engine on evictions and flushes. */
+    using pairs_t = std::vector<std::pair<collection_key_t, value_view_t>>;
+
+    struct usage_t {
+        std::size_t capacity_bytes = 0;
+        std::size_t used_bytes = 0;
+        std::size_t pairs = 0;
+        std::size_t dirty_pairs = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+  private:
+    struct entry_t {
+        value_t value;
+        bool dirty = false;
+    };
+
+    struct shard_t {
+        lru_cache_gt<collection_key_t, entry_t> entries;
+        std::size_t bytes = 0;
+        std::size_t dirty = 0;
+        std::atomic<std::uint64_t> epoch {0};
+        std::mutex mutex;
+
+        shard_t(std::size_t capacity) : entries(capacity) {}
+    };
+
+    std::unique_ptr<std::unique_ptr<shard_t>[]> shards_;
+    frequency_sketch_t sketch_;
+    std::size_t shard_capacity_ = 0;
+    std::size_t admit_after_ = 0;
+    hot_policy_t policy_;
+    std::atomic<std::size_t> dirty_ {0};
+    std::atomic<std::size_t> hits_ {0};
+    std::atomic<std::size_t> misses_ {0};
+
+    static std::uint64_t hash(collection_key_t key) noexcept {
+        return static_cast<std::uint64_t>(std::hash<collection_key_t> {}(key)) * 0x9E3779B97F4A7C15ull;
+    }
+    static std::size_t shard_idx(std::uint64_t hash) noexcept { return static_cast<std::size_t>(hash >> 58); }
+    static std::size_t cost(value_t const& value) noexcept { return entry_overhead_k + (value ? value->size() : 0); }
+
+    static value_t copy(value_view_t value) noexcept(false) {
+        return value ? std::make_shared<std::string const>(std::string_view(value)) : value_t {};
+    }
+    static value_view_t view(value_t const& value) noexcept {
+        return value ? value_view_t {std::string_view(*value)} : value_view_t {};
+    }
+
+    void bump(shard_t& shard) noexcept { shard.epoch.fetch_add(1, std::memory_order_release); }
+
+    void clean(shard_t& shard, entry_t& entry) noexcept {
+        if (!entry.dirty)
+            return;
+        entry.dirty = false;
+        --shard.dirty;
+        dirty_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Pops the least recently used entries, until `needed` more bytes fit into the shard.
+     * Dirty entries are passed to `spill` first. Expects the shard `mutex` to be held.
+     * @param popularity If set, fails as soon as the next victim is more popular.
+     * @return false, if the space wasn't freed.
+     */
+    template <typename spill_at>
+    bool make_space(shard_t& shard,
+                    std::size_t needed,
+                    std::optional<std::uint8_t> popularity,
+                    spill_at&& spill,
+                    ustore_error_t* c_error) noexcept(false) {
+        while (shard.bytes + needed > shard_capacity_ || shard.entries.size() >= shard.entries.capacity()) {
+            auto oldest = shard.entries.oldest();
+            if (!oldest)
+                return false;
+            auto const& [key, entry_ref] = *oldest;
+            entry_t& entry = entry_ref.get();
+            if (popularity && sketch_.estimate(hash(key)) > *popularity)
+                return false;
+            if (entry.dirty) {
+                pairs_t pairs {{key, view(entry.value)}};
+                spill(pairs, c_error);
+                if (*c_error)
+                    return false;
+                clean(shard, entry);
+            }
+            shard.bytes -= cost(entry.value);
+            shard.entries.evict();
+        }
+        return true;
+    }
+
+  public:
+    /**
+     * @param capacity      Memory budget for all the copies, in bytes.
+     * @param admit_after   Number of recent requests, needed to admit a key into memory.
+     */
+    hot_tier_t(std::size_t capacity, hot_policy_t policy, std::size_t admit_after) noexcept(false)
+        : sketch_(capacity / entry_overhead_k), shard_capacity_(capacity / shards_k), admit_after_(admit_after),
+          policy_(policy) {
+        shards_.reset(new std::unique_ptr<shard_t>[shards_k]);
+        for (std::size_t i = 0; i != shards_k; ++i)
+            shards_[i] = std::make_unique<shard_t>(shard_capacity_ / entry_overhead_k + 2);
+    }
+
+    hot_policy_t policy() const noexcept { return policy_; }
+    bool has_dirty() const noexcept { return dirty_.load(std::memory_order_relaxed) != 0; }
+    std::size_t hits() const noexcept { return hits_.load(std::memory_order_relaxed); }
+    std::size_t misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+
+    usage_t usage() noexcept {
+        usage_t result;
+        result.capacity_bytes = shard_capacity_ * shards_k;
+        result.hits = hits();
+        result.misses = misses();
+        for (std::size_t i = 0; i != shards_k; ++i) {
+            shard_t& shard = *shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            result.used_bytes += shard.bytes;
+            result.pairs += shard.entries.size();
+            result.dirty_pairs += shard.dirty;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Current epochs of all the shards, to be passed into `refresh()` after a write into the engine.
+     */
+    epochs_t epochs() const noexcept {
+        epochs_t result;
+        for (std::size_t i = 0; i != shards_k; ++i)
+            result[i] = shards_[i]->epoch.load(std::memory_order_acquire);
+        return result;
+    }
+
+    /**
+     * @brief Passes the values of all the `places` to `enumerator(task_idx, value)` in order, taking them from
+     * memory, or from `read_misses(misses, enumerator)`, which may answer in any order, and admitting its answers.
+     * Misses are exported to a continuous places argument, so `read_misses` may use the batched paths.
+     */
+    template <typename read_misses_at, typename enumerator_at, typename spill_at>
+    void read(places_arg_t const& places,
+              read_misses_at&& read_misses,
+              enumerator_at&& enumerator,
+              spill_at&& spill,
+              ustore_error_t* c_error) noexcept(false) {
+
+        std::vector<value_t> values(places.size());
+        std::vector<std::size_t> miss_idxs;
+        std::vector<ustore_collection_t> miss_collections;
+        std::vector<ustore_key_t> miss_keys;
+        std::vector<std::uint64_t> miss_epochs;
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            collection_key_t key = places[i].collection_key();
+            std::uint64_t key_hash = hash(key);
+            shard_t& shard = *shards_[shard_idx(key_hash)];
+            sketch_.record(key_hash);
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (entry_t* entry = shard.entries.get_ptr(key); entry) {
+                values[i] = entry->value;
+                continue;
+            }
+            miss_idxs.push_back(i);
+            miss_collections.push_back(key.collection);
+            miss_keys.push_back(key.key);
+            miss_epochs.push_back(shard.epoch.load(std::memory_order_relaxed));
+        }
+        hits_.fetch_add(places.size() - miss_idxs.size(), std::memory_order_relaxed);
+        misses_.fetch_add(miss_idxs.size(), std::memory_order_relaxed);
+
+        // If nothing was found in memory, the engine answers directly, without intermediate copies
+        auto admit_miss = [&](std::size_t miss_idx, value_view_t value) {
+            collection_key_t key {miss_collections[miss_idx], miss_keys[miss_idx]};
+            admit(key, value, miss_epochs[miss_idx], spill, c_error);
+        };
+        if (miss_idxs.size() == places.size())
+            return read_misses(places, [&](std::size_t i, value_view_t value) {
+                enumerator(i, value);
+                admit_miss(i, value);
+            });
+
+        if (!miss_idxs.empty()) {
+            places_arg_t misses;
+            misses.collections_begin = {miss_collections.data(), sizeof(ustore_collection_t)};
+            misses.keys_begin = {miss_keys.data(), sizeof(ustore_key_t)};
+            misses.count = miss_idxs.size();
+            read_misses(misses, [&](std::size_t miss_idx, value_view_t value) {
+                values[miss_idxs[miss_idx]] = copy(value);
+                admit_miss(miss_idx, value);
+            });
+        }
+        for (std::size_t i = 0; i != places.size(); ++i)
+            enumerator(i, view(values[i]));
+    }
+
+    /**
+     * @brief Keeps a copy of the `value`, fetched from the engine, if the key is popular enough,
+     * and the shard hasn't changed since the `epoch` was observed.
+     */
+    template <typename spill_at>
+    void admit(collection_key_t key,
+               value_view_t value,
+               std::uint64_t epoch,
+               spill_at&& spill,
+               ustore_error_t* c_error) noexcept(false) {
+
+        std::uint64_t key_hash = hash(key);
+        std::uint8_t popularity = sketch_.estimate(key_hash);
+        std::size_t needed = entry_overhead_k + value.size();
+        if (popularity < admit_after_ || needed > shard_capacity_)
+            return;
+
+        shard_t& shard = *shards_[shard_idx(key_hash)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.epoch.load(std::memory_order_relaxed) != epoch || shard.entries.contains(key))
+            return;
+        if (!make_space(shard, needed, popularity, spill, c_error))
+            return;
+        shard.entries.insert(key, entry_t {copy(value), false});
+        shard.bytes += needed;
+    }
+
+    /**
+     * @brief Updates the copies of the pairs, just written into the engine, and drops those,
+     * that could have been concurrently changed by other writers since the `epochs` were observed.
+     * Dirty entries are newer than the engine state, so they are kept.
+     */
+    void refresh(places_arg_t const& places, contents_arg_t const& contents, epochs_t expected) noexcept(false) {
+        for (std::size_t i = 0; i != places.size(); ++i) {
+            collection_key_t key = places[i].collection_key();
+            std::size_t const idx = shard_idx(hash(key));
+            shard_t& shard = *shards_[idx];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bool const exclusive = shard.epoch.load(std::memory_order_relaxed) == expected[idx];
+            bump(shard);
+            if (exclusive)
+                expected[idx] = shard.epoch.load(std::memory_order_relaxed);
+
+            entry_t* entry = shard.entries.get_ptr(key);
+            if (!entry || entry->dirty)
+                continue;
+            shard.bytes -= cost(entry->value);
+            std::size_t const needed = entry_overhead_k + contents[i].size();
+            if (!exclusive || shard.bytes + needed > shard_capacity_) {
+                shard.entries.pop(key);
+                continue;
+            }
+            entry->value = copy(contents[i]);
+            shard.bytes += needed;
+        }
+    }
+
+    /**
+     * @brief Keeps the writes in memory as dirty entries, for the write-back policy.
+     * Entries evicted to make space, and the values too big to fit, are passed to `spill`.
+     */
+    template <typename spill_at>
+    void stage(places_arg_t const& places,
+               contents_arg_t const& contents,
+               spill_at&& spill,
+               ustore_error_t* c_error) noexcept(false) {
+        for (std::size_t i = 0; i != places.size() && !*c_error; ++i) {
+            collection_key_t key = places[i].collection_key();
+            std::uint64_t key_hash = hash(key);
+            shard_t& shard = *shards_[shard_idx(key_hash)];
+            value_t value = copy(contents[i]);
+            std::size_t const needed = cost(value);
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bump(shard);
+            if (auto old = shard.entries.pop(key); old) {
+                shard.bytes -= cost(old->value);
+                clean(shard, *old);
+            }
+            if (needed > shard_capacity_ || !make_space(shard, needed, std::nullopt, spill, c_error)) {
+                return_if_error_m(c_error);
+                pairs_t pairs {{key, view(value)}};
+                spill(pairs, c_error);
+                continue;
+            }
+            shard.entries.insert(key, entry_t {std::move(value), true});
+            shard.bytes += needed;
+            ++shard.dirty;
+            dirty_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Passes all the dirty pairs to `spill`, one shard at a time, keeping them in memory as clean.
+     * Shards are kept locked until their pairs reach the engine.
+     */
+    template <typename spill_at>
+    void flush(spill_at&& spill, ustore_error_t* c_error) noexcept(false) {
+        if (!has_dirty())
+            return;
+        pairs_t pairs;
+        for (std::size_t i = 0; i != shards_k; ++i) {
+            shard_t& shard = *shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.dirty)
+                continue;
+            pairs.clear();
+            shard.entries.for_each([&](collection_key_t const& key, entry_t const& entry) {
+                if (entry.dirty)
+                    pairs.emplace_back(key, view(entry.value));
+            });
+            spill(pairs, c_error);
+            return_if_error_m(c_error);
+            shard.entries.for_each([&](collection_key_t const&, entry_t& entry) { clean(shard, entry); });
+        }
+    }
+
+    /**
+     * @brief Drops the clean copies of the given keys, like the ones written by a committed transaction.
+     */
+    void drop(std::vector<collection_key_t> const& keys) noexcept {
+        for (collection_key_t key : keys) {
+            shard_t& shard = *shards_[shard_idx(hash(key))];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bump(shard);
+            entry_t* entry = shard.entries.get_ptr(key);
+            if (!entry || entry->dirty)
+                continue;
+            shard.bytes -= cost(entry->value);
+            shard.entries.pop(key);
+        }
+    }
+
+    /**
+     * @brief Drops all the clean copies, after the engine state was changed in bulk,
+     * like by range deletions or collection drops.
+     */
+    void drop_all() noexcept(false) {
+        std::vector<collection_key_t> clean_keys;
+        for (std::size_t i = 0; i != shards_k; ++i) {
+            shard_t& shard = *shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bump(shard);
+            if (!shard.dirty) {
+                shard.entries.clear();
+                shard.bytes = 0;
+                continue;
+            }
+            clean_keys.clear();
+            shard.entries.for_each([&](collection_key_t const& key, entry_t const& entry) {
+                if (!entry.dirty)
+                    clean_keys.push_back(key);
+            });
+            for (collection_key_t key : clean_keys)
+                shard.bytes -= cost(shard.entries.pop(key)->value);
+        }
+    }
+};
+
+} // namespace unum::ustore
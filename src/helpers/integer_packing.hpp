@@ -0,0 +1,118 @@
+/**
+ * @file integer_packing.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Bit-packing of 64-bit integer streams in fixed-size blocks.
+ *
+ * Every block of up to `packed_block_k` integers starts with a single byte,
+ * defining the number of bits used for every integer in that block, followed
+ * by the bits themselves, in the little-endian order. Sequences of small
+ * integers, like deltas between sorted IDs, shrink proportionally, while
+ * blocks of identical zeros take just one byte.
+ */
+#pragma once
+#include <algorithm> // `std::min`
+#include <cstdint>   // `std::uint64_t`
+
+namespace unum::ustore {
+
+static constexpr std::size_t packed_block_k = 128;
+
+inline std::uint64_t zigzag_encode(std::int64_t value) noexcept {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t value) noexcept {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1u);
+}
+
+inline std::size_t bits_needed(std::uint64_t value) noexcept {
+    return value ? 64u - static_cast<std::size_t>(__builtin_clzll(value)) : 0u;
+}
+
+inline std::uint64_t low_bits_mask(std::size_t bits) noexcept {
+    return bits >= 64u ? ~std::uint64_t(0) : ((std::uint64_t(1) << bits) - 1u);
+}
+
+/**
+ * @brief Upper bound for the size of `count` packed integers.
+ */
+inline std::size_t packed_integers_bound(std::size_t count) noexcept {
+    return (count + packed_block_k - 1u) / packed_block_k + count * sizeof(std::uint64_t);
+}
+
+/**
+ * @brief Packs `count` integers, produced by `value(i)`, which may be called more than once.
+ * @return The end of the written bytes.
+ */
+template <typename value_at>
+std::uint8_t* pack_integers(std::size_t count, value_at&& value, std::uint8_t* output) noexcept {
+    for (std::size_t block_begin = 0; block_begin < count; block_begin += packed_block_k) {
+        std::size_t block_end = std::min(block_begin + packed_block_k, count);
+        std::uint64_t bits_union = 0;
+        for (std::size_t i = block_begin; i != block_end; ++i)
+            bits_union |= value(i);
+        std::size_t width = bits_needed(bits_union);
+        *output++ = static_cast<std::uint8_t>(width);
+
+        // The pending bits never exceed 7 between the appended chunks of 56 bits
+        std::uint64_t pending = 0;
+        std::size_t pending_bits = 0;
+        for (std::size_t i = block_begin; i != block_end && width; ++i) {
+            std::uint64_t remaining = value(i);
+            for (std::size_t remaining_bits = width; remaining_bits;) {
+                std::size_t chunk_bits = std::min<std::size_t>(remaining_bits, 56u);
+                pending |= (remaining & low_bits_mask(chunk_bits)) << pending_bits;
+                pending_bits += chunk_bits;
+                remaining = chunk_bits < 64u ? remaining >> chunk_bits : 0u;
+                remaining_bits -= chunk_bits;
+                for (; pending_bits >= 8u; pending >>= 8u, pending_bits -= 8u)
+                    *output++ = static_cast<std::uint8_t>(pending);
+            }
+        }
+        if (pending_bits)
+            *output++ = static_cast<std::uint8_t>(pending);
+    }
+    return output;
+}
+
+/**
+ * @brief Unpacks `count` integers, passing them to `callback(i, value)`.
+ * @return The end of the consumed bytes or NULL, if the input is truncated or corrupted.
+ */
+template <typename callback_at>
+std::uint8_t const* unpack_integers(std::uint8_t const* input,
+                                    std::uint8_t const* input_end,
+                                    std::size_t count,
+                                    callback_at&& callback) noexcept {
+    for (std::size_t block_begin = 0; block_begin < count; block_begin += packed_block_k) {
+        std::size_t block_end = std::min(block_begin + packed_block_k, count);
+        if (input == input_end)
+            return nullptr;
+        std::size_t width = *input++;
+        std::size_t block_bytes = ((block_end - block_begin) * width + 7u) / 8u;
+        if (width > 64u || static_cast<std::size_t>(input_end - input) < block_bytes)
+            return nullptr;
+        std::uint8_t const* block_data = input;
+
+        std::uint64_t pending = 0;
+        std::size_t pending_bits = 0;
+        for (std::size_t i = block_begin; i != block_end; ++i) {
+            std::uint64_t result = 0;
+            for (std::size_t result_bits = 0; result_bits != width;) {
+                std::size_t chunk_bits = std::min<std::size_t>(width - result_bits, 56u);
+                for (; pending_bits < chunk_bits; pending_bits += 8u)
+                    pending |= std::uint64_t(*input++) << pending_bits;
+                result |= (pending & low_bits_mask(chunk_bits)) << result_bits;
+                pending >>= chunk_bits;
+                pending_bits -= chunk_bits;
+                result_bits += chunk_bits;
+            }
+            callback(i, result);
+        }
+        input = block_data + block_bytes;
+    }
+    return input;
+}
+
+} // namespace unum::ustore
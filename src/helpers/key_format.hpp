@@ -0,0 +1,80 @@
+/**
+ * @file key_format.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief On-disk formats of integer keys in LSM-tree engines.
+ *
+ * The "native" format stores keys in the byte order of the CPU, so LevelDB and RocksDB
+ * need a custom comparator, that reinterprets them as signed integers on every comparison.
+ * The "bytewise" format flips the sign bit and stores keys in big-endian. Such keys sort
+ * the same way with a plain `memcmp`, so the default comparator of the engine can be used,
+ * along with all of its inlined fast paths in memtables, seeks and compactions.
+ */
+#pragma once
+#include <cstdint> // `std::uint64_t`
+#include <cstring> // `std::memcpy`
+#include <string>  // `std::string`
+
+#include "ustore/db.h" // `ustore_key_t`
+
+namespace unum::ustore {
+
+enum class key_format_t {
+    native_k,
+    bytewise_k,
+};
+
+inline bool parse_key_format(std::string const& name, key_format_t& format) noexcept {
+    if (name == "native")
+        format = key_format_t::native_k;
+    else if (name == "bytewise")
+        format = key_format_t::bytewise_k;
+    else
+        return false;
+    return true;
+}
+
+inline char const* key_format_name(key_format_t format) noexcept {
+    return format == key_format_t::bytewise_k ? "bytewise" : "native";
+}
+
+inline void encode_key(ustore_key_t key, key_format_t format, char* bytes) noexcept {
+    if (format == key_format_t::bytewise_k) {
+        std::uint64_t ordered = static_cast<std::uint64_t>(key) ^ (std::uint64_t(1) << 63);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        ordered = __builtin_bswap64(ordered);
+#endif
+        std::memcpy(bytes, &ordered, sizeof(ordered));
+    }
+    else
+        std::memcpy(bytes, &key, sizeof(key));
+}
+
+inline ustore_key_t decode_key(char const* bytes, key_format_t format) noexcept {
+    if (format == key_format_t::bytewise_k) {
+        std::uint64_t ordered;
+        std::memcpy(&ordered, bytes, sizeof(ordered));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        ordered = __builtin_bswap64(ordered);
+#endif
+        return static_cast<ustore_key_t>(ordered ^ (std::uint64_t(1) << 63));
+    }
+    ustore_key_t key;
+    std::memcpy(&key, bytes, sizeof(key));
+    return key;
+}
+
+/**
+ * @brief Owns the encoded bytes of a key and views them as a `slice_at` of the engine,
+ * so it must outlive the slices it was converted into.
+ */
+template <typename slice_at>
+struct encoded_key_gt {
+    char bytes[sizeof(ustore_key_t)];
+
+    encoded_key_gt() noexcept = default;
+    encoded_key_gt(ustore_key_t key, key_format_t format) noexcept { encode_key(key, format, bytes); }
+    operator slice_at() const noexcept { return {bytes, sizeof(bytes)}; }
+};
+
+} // namespace unum::ustore
@@ -84,13 +84,18 @@ class limited_priority_queue_gt {
                 return false;
         }
         else {
+            // Free the slot of the last kept element, evicting the lowest priority one if needed
             if (length_ == capacity_)
-                std::destroy_at(ptr_ + capacity_ - 1);
-            auto source_ptr = element_ptr;
-            for (; source_ptr + 1 != end; ++source_ptr)
-                source_ptr[1] = std::move(source_ptr[0]);
+                std::destroy_at(--end);
+            else
+                ++length_;
+            if (end == element_ptr) {
+                new (end) element_t(std::move(element));
+                return true;
+            }
+            new (end) element_t(std::move(end[-1]));
+            std::move_backward(element_ptr, end - 1, end);
             *element_ptr = std::move(element);
-            length_ += length_ < capacity_;
             return true;
         }
     }
@@ -187,6 +187,9 @@ class growing_tape_t {
         presences_.resize(divide_round_up(old_count + 1, bits_in_byte_k), c_error);
         if (*c_error)
             return value_view_t {};
+        // Trailing bits of the last byte are exported as well, so they must not be garbage
+        if (old_count % bits_in_byte_k == 0)
+            presences_[old_count / bits_in_byte_k] = 0;
         presences()[old_count] = bool(value);
 
         // We need to store one more offset for Apache Arrow.
@@ -5,34 +5,82 @@
  * @brief Helper functions Polymorphic Memory Allocators.
  */
 #pragma once
-#include <sys/mman.h> // `mmap`
-#include <limits.h>   // `CHAR_BIT`
-#include <cstring>    // `std::memcpy`
-#include <stdexcept>  // `std::runtime_error`
-#include <memory>     // `std::allocator`
-#include <vector>     // `std::vector`
-#include <numeric>    // `std::accumulate`
+#include <sys/mman.h>    // `mmap`
+#include <sys/syscall.h> // `SYS_mbind`, `SYS_getcpu`
+#include <unistd.h>      // `syscall`
+#include <limits.h>      // `CHAR_BIT`
+#include <cstring>       // `std::memcpy`
+#include <stdexcept>     // `std::runtime_error`
+#include <memory>        // `std::allocator`
+#include <vector>        // `std::vector`
+#include <numeric>       // `std::accumulate`
+#include <atomic>        // `std::atomic`
+#include <cstdio>        // `std::snprintf`
 
 #include "ustore/cpp/types.hpp"  // `byte_t`, `next_power_of_two`
 #include "ustore/cpp/ranges.hpp" // `strided_range_gt`
 #include "ustore/cpp/status.hpp" // `out_of_memory_k`
 
+#if USTORE_USE_CUDA
+#include <cuda_runtime_api.h> // `cudaMallocManaged`
+#endif
+
+#if !defined(MAP_HUGETLB)
+#define MAP_HUGETLB 0
+#endif
+#if !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
 namespace unum::ustore {
 
+/**
+ * @brief Chain of growing arenas, from which the exported data is allocated.
+ *
+ * Depending on the `kind_t`, the arenas are:
+ * - `sys_k`: taken from `std::malloc`.
+ * - `shared_k`: mapped as shared memory, to be passed to other processes.
+ * - `unified_k`: addressable from GPUs, if compiled with `USTORE_USE_CUDA`.
+ * - `local_k`: mapped on the NUMA node of the calling CPU.
+ * - `huge_k`: like `local_k`, but backed with 2 MB pages.
+ * - `giant_k`: like `local_k`, but backed with 1 GB pages.
+ *
+ * Huge pages must be reserved by the system administrator. If they aren't,
+ * we fall back to smaller pages, and ask the kernel to merge them transparently.
+ *
+ * ## Recycling
+ *
+ * Arenas up to `recycled_size_limit_k` aren't returned to the system, when chains
+ * are trimmed or released. Instead, chains keep their largest arena for the next call,
+ * and the rest are kept in a small `thread_local` pool, to be picked by the next
+ * chains on the same thread. So even calls with temporary arenas, like most bindings
+ * make, don't allocate memory from the system on every request.
+ *
+ * All the pools of the process hold at most `pooled_bytes_limit_k`, so servers with
+ * many threads don't keep idle memory. Arenas of the `local_k` kind are never pooled,
+ * as their pages are bound to the NUMA node of the thread, that mapped them.
+ */
 struct linked_memory_t {
     static constexpr std::size_t initial_size_k = 1024ul * 1024ul;
     static constexpr std::size_t growth_factor_k = 2ul;
+    static constexpr std::size_t huge_page_size_k = 2ul * 1024ul * 1024ul;
+    static constexpr std::size_t giant_page_size_k = 1024ul * 1024ul * 1024ul;
+    static constexpr std::size_t recycled_size_limit_k = 16ul * 1024ul * 1024ul;
+    static constexpr std::size_t pool_capacity_k = 4ul;
+    static constexpr std::size_t pooled_bytes_limit_k = 128ul * 1024ul * 1024ul;
 
     struct arena_header_t;
     arena_header_t* first_ptr_ = nullptr;
 
-    enum class kind_t { sys_k = 0, shared_k, unified_k };
+    enum class kind_t { sys_k = 0, shared_k, unified_k, local_k, huge_k, giant_k };
     struct arena_header_t {
         arena_header_t* next = nullptr;
         std::size_t capacity = 0;
         std::size_t used = 0;
         kind_t kind = kind_t::sys_k;
         bool can_release_memory = false;
+        /// @brief Most bytes ever used by the chain at once. Is only tracked in the first arena.
+        std::size_t peak = 0;
 
         void* alloc_internally(std::size_t length, std::size_t alignment) noexcept {
             auto arena_start = std::intptr_t(this);
@@ -47,14 +95,112 @@ struct linked_memory_t {
         }
     };
 
+    /**
+     * @brief Process-wide counters of all the arenas. Updated with relaxed atomics.
+     */
+    struct usage_t {
+        std::atomic<std::size_t> reserved_bytes = 0;
+        std::atomic<std::size_t> pooled_bytes = 0;
+        std::atomic<std::size_t> allocations = 0;
+        std::atomic<std::size_t> reuses = 0;
+    };
+
+    /**
+     * @brief The bytes reserved, used, and used at most, by a single chain.
+     */
+    struct chain_usage_t {
+        std::size_t arenas = 0;
+        std::size_t reserved_bytes = 0;
+        std::size_t used_bytes = 0;
+        std::size_t peak_bytes = 0;
+    };
+
+    static usage_t& usage() noexcept {
+        static usage_t usage;
+        return usage;
+    }
+
+    struct pool_t {
+        arena_header_t* arenas[pool_capacity_k] = {};
+        ~pool_t() noexcept {
+            for (arena_header_t* arena : arenas) {
+                if (!arena)
+                    continue;
+                usage().pooled_bytes.fetch_sub(arena->capacity, std::memory_order_relaxed);
+                release_arena(arena);
+            }
+        }
+    };
+
+    static pool_t& pool() noexcept {
+        thread_local pool_t pool;
+        return pool;
+    }
+
+    static constexpr std::size_t page_size(kind_t kind) noexcept {
+        return kind == kind_t::giant_k ? giant_page_size_k : kind == kind_t::huge_k ? huge_page_size_k : 1;
+    }
+
+    static void* map_anonymous(std::size_t length, int flags) noexcept {
+        void* begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | flags, -1, 0);
+        return begin != MAP_FAILED ? begin : nullptr;
+    }
+
+    /**
+     * @brief Asks the kernel to place the pages of the range on the NUMA node of the calling CPU,
+     * once they are touched. Uses raw system calls, not to depend on `libnuma`.
+     * The policy is "preferred", so if the node is full, others are used.
+     */
+    static void prefer_local_node(void* begin, std::size_t length) noexcept {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+        constexpr int mpol_preferred_k = 1;
+        constexpr std::size_t bits_per_word_k = sizeof(unsigned long) * CHAR_BIT;
+        constexpr std::size_t max_nodes_k = 1024;
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= max_nodes_k)
+            return;
+        unsigned long nodes_mask[max_nodes_k / bits_per_word_k] = {};
+        nodes_mask[node / bits_per_word_k] = 1ul << (node % bits_per_word_k);
+        syscall(SYS_mbind, begin, length, mpol_preferred_k, nodes_mask, max_nodes_k + 1, 0);
+#else
+        (void)begin, (void)length;
+#endif
+    }
+
+    static void* map_local(std::size_t length, kind_t kind) noexcept {
+        void* begin = nullptr;
+        if (kind == kind_t::giant_k)
+            begin = map_anonymous(length, MAP_PRIVATE | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+        if (!begin && kind != kind_t::local_k)
+            begin = map_anonymous(length, MAP_PRIVATE | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+        if (!begin && (begin = map_anonymous(length, MAP_PRIVATE)) && kind != kind_t::local_k) {
+#if defined(MADV_HUGEPAGE)
+            madvise(begin, length, MADV_HUGEPAGE);
+#endif
+        }
+        if (begin)
+            prefer_local_node(begin, length);
+        return begin;
+    }
+
     static arena_header_t* alloc_arena(std::size_t length, kind_t kind) noexcept {
+        length = next_multiple(length, page_size(kind));
         void* begin = nullptr;
         switch (kind) {
         case kind_t::sys_k: begin = std::malloc(length); break;
-        case kind_t::shared_k:
-            begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+        case kind_t::shared_k: begin = map_anonymous(length, MAP_SHARED); break;
+        case kind_t::unified_k:
+#if USTORE_USE_CUDA
+            if (cudaMallocManaged(&begin, length, cudaMemAttachGlobal) != cudaSuccess)
+                begin = nullptr;
+#else
+            // Without accelerators, all the memory is unified
+            begin = std::malloc(length);
+#endif
             break;
-        case kind_t::unified_k: break;
+        case kind_t::local_k:
+        case kind_t::huge_k:
+        case kind_t::giant_k: begin = map_local(length, kind); break;
         }
         auto header_ptr = (arena_header_t*)begin;
         if (!header_ptr)
@@ -64,26 +210,112 @@ struct linked_memory_t {
         header_ptr->kind = kind;
         header_ptr->capacity = length;
         header_ptr->used = sizeof(arena_header_t);
+        usage().reserved_bytes.fetch_add(length, std::memory_order_relaxed);
+        usage().allocations.fetch_add(1, std::memory_order_relaxed);
         return header_ptr;
     }
 
     static void release_arena(arena_header_t* arena) noexcept {
+        usage().reserved_bytes.fetch_sub(arena->capacity, std::memory_order_relaxed);
         switch (arena->kind) {
         case kind_t::sys_k: std::free(arena); break;
-        case kind_t::shared_k: munmap(arena, arena->capacity); break;
-        case kind_t::unified_k: break;
+        case kind_t::unified_k:
+#if USTORE_USE_CUDA
+            cudaFree(arena);
+#else
+            std::free(arena);
+#endif
+            break;
+        case kind_t::shared_k:
+        case kind_t::local_k:
+        case kind_t::huge_k:
+        case kind_t::giant_k: munmap(arena, arena->capacity); break;
         }
     }
 
+    /**
+     * @brief Picks the smallest pooled arena of the same `kind` fitting `length` bytes,
+     * or allocates a new one.
+     */
+    static arena_header_t* acquire_arena(std::size_t length, kind_t kind) noexcept {
+        pool_t& recycled = pool();
+        arena_header_t** best = nullptr;
+        for (arena_header_t*& arena : recycled.arenas)
+            if (arena && arena->kind == kind && arena->capacity >= length)
+                if (!best || (*best)->capacity > arena->capacity)
+                    best = &arena;
+        if (!best)
+            return alloc_arena(length, kind);
+
+        arena_header_t* arena = std::exchange(*best, nullptr);
+        usage().pooled_bytes.fetch_sub(arena->capacity, std::memory_order_relaxed);
+        usage().reuses.fetch_add(1, std::memory_order_relaxed);
+        arena->next = nullptr;
+        arena->used = sizeof(arena_header_t);
+        arena->can_release_memory = false;
+        arena->peak = 0;
+        return arena;
+    }
+
+    /**
+     * @brief Puts the arena into the pool, evicting a smaller one if it's full,
+     * or releases it, if it's too big, NUMA-bound, or all the pools are full.
+     */
+    static void recycle_arena(arena_header_t* arena) noexcept {
+        if (arena->capacity > recycled_size_limit_k || arena->kind == kind_t::local_k)
+            return release_arena(arena);
+
+        pool_t& recycled = pool();
+        arena_header_t** smallest = &recycled.arenas[0];
+        for (arena_header_t*& slot : recycled.arenas) {
+            if (!slot) {
+                smallest = &slot;
+                break;
+            }
+            if (slot->capacity < (*smallest)->capacity)
+                smallest = &slot;
+        }
+        if (*smallest && (*smallest)->capacity >= arena->capacity)
+            return release_arena(arena);
+
+        // Reserve the difference first, so that concurrent threads can't exceed the limit together
+        std::size_t added = arena->capacity - (*smallest ? (*smallest)->capacity : 0);
+        if (usage().pooled_bytes.fetch_add(added, std::memory_order_relaxed) + added > pooled_bytes_limit_k) {
+            usage().pooled_bytes.fetch_sub(added, std::memory_order_relaxed);
+            return release_arena(arena);
+        }
+        if (*smallest)
+            release_arena(*smallest);
+        *smallest = arena;
+    }
+
     arena_header_t& first_ref() noexcept { return *reinterpret_cast<arena_header_t*>(first_ptr_); }
 
-    bool start_if_null(kind_t kind) noexcept {
+    chain_usage_t chain_usage() const noexcept {
+        chain_usage_t result;
+        for (arena_header_t* current = first_ptr_; current; current = current->next) {
+            result.arenas++;
+            result.reserved_bytes += current->capacity;
+            result.used_bytes += current->used - sizeof(arena_header_t);
+        }
+        result.peak_bytes = std::max(first_ptr_ ? first_ptr_->peak : 0, result.used_bytes);
+        return result;
+    }
+
+    bool start_if_null(kind_t kind, bool keep_old_data = false) noexcept {
         if (first_ptr_ && first_ptr_->kind == kind)
             return true;
 
-        first_ptr_ = alloc_arena(initial_size_k, kind);
+        // If the older data is still in use, keep allocating from the same arenas
+        if (first_ptr_ && (keep_old_data || !first_ptr_->can_release_memory))
+            return true;
+
+        release_all();
+        first_ptr_ = acquire_arena(initial_size_k, kind);
+        if (!first_ptr_)
+            return false;
         first_ptr_->can_release_memory = true;
-        return first_ptr_;
+        return true;
     }
 
     bool lock_release_calls() noexcept { return std::exchange(first_ref().can_release_memory, false); }
@@ -119,7 +351,7 @@ struct linked_memory_t {
 
         // We need to append a new even bigger bucket.
         auto new_capacity = std::max(last->capacity * growth_factor_k, length + alignment + sizeof(arena_header_t));
-        auto new_arena = alloc_arena(new_capacity, first_ref().kind);
+        auto new_arena = acquire_arena(new_capacity, first_ref().kind);
         if (!new_arena)
             return nullptr;
 
@@ -130,18 +362,38 @@ struct linked_memory_t {
     void release_all() noexcept {
         arena_header_t* current = first_ptr_;
         while (current != nullptr)
-            release_arena(std::exchange(current, current->next));
+            recycle_arena(std::exchange(current, current->next));
         first_ptr_ = nullptr;
     }
 
+    /**
+     * @brief Discards the contents, but keeps the largest recyclable arena of the chain,
+     * so that the next calls of the same size fit without new allocations.
+     */
     void release_partially() noexcept {
         if (!first_ptr_)
             return;
-        arena_header_t* current = first_ptr_->next;
-        while (current != nullptr)
-            release_arena(std::exchange(current, current->next));
+
+        arena_header_t* kept = first_ptr_;
+        for (arena_header_t* current = first_ptr_->next; current; current = current->next)
+            if (current->capacity <= recycled_size_limit_k && current->capacity > kept->capacity)
+                kept = current;
+
+        chain_usage_t const old_usage = chain_usage();
+        bool const can_release_memory = first_ptr_->can_release_memory;
+        arena_header_t* current = first_ptr_;
+        while (current != nullptr) {
+            arena_header_t* next = current->next;
+            if (current != kept)
+                recycle_arena(current);
+            current = next;
+        }
+
+        first_ptr_ = kept;
         first_ptr_->next = nullptr;
         first_ptr_->used = sizeof(arena_header_t);
+        first_ptr_->can_release_memory = can_release_memory;
+        first_ptr_->peak = old_usage.peak_bytes;
     }
 };
 
@@ -168,7 +420,7 @@ struct linked_memory_lock_t {
 
     linked_memory_lock_t(linked_memory_t& memory, linked_memory_t::kind_t kind, bool keep_old_data = false) noexcept
         : memory(memory) {
-        if (memory.start_if_null(kind))
+        if (memory.start_if_null(kind, keep_old_data))
             if ((owns_the_lock = memory.lock_release_calls()) && !keep_old_data)
                 memory.release_partially();
     }
@@ -243,14 +495,50 @@ inline linked_memory_lock_t linked_memory(ustore_arena_t* c_arena, ustore_option
 
     static_assert(sizeof(ustore_arena_t) == sizeof(linked_memory_t));
     linked_memory_t& ref = *reinterpret_cast<linked_memory_t*>(c_arena);
-    linked_memory_t::kind_t kind = (options & ustore_option_read_shared_memory_k) //
-                                       ? linked_memory_t::kind_t::shared_k
-                                       : linked_memory_t::kind_t::sys_k;
+    using kind_t = linked_memory_t::kind_t;
+    kind_t kind = (options & ustore_option_read_shared_memory_k)  ? kind_t::shared_k
+                  : (options & ustore_option_arena_unified_k)     ? kind_t::unified_k
+                  : (options & ustore_option_arena_giant_pages_k) ? kind_t::giant_k
+                  : (options & ustore_option_arena_huge_pages_k)  ? kind_t::huge_k
+                  : (options & ustore_option_arena_numa_local_k)  ? kind_t::local_k
+                                                                  : kind_t::sys_k;
     bool keep_old_data = options & ustore_option_dont_discard_memory_k;
 
     return linked_memory_lock_t(ref, kind, keep_old_data);
 }
 
+/**
+ * @brief Answers the "arenas" request of `ustore_database_control()` with a JSON object
+ * of the process-wide counters, and the usage of the `c.arena` chain, before it's reused
+ * for the response.
+ */
+inline void control_arenas(ustore_database_control_t& c) noexcept {
+    linked_memory_t::chain_usage_t chain = reinterpret_cast<linked_memory_t*>(c.arena)->chain_usage();
+    linked_memory_t::usage_t const& usage = linked_memory_t::usage();
+
+    char response[512];
+    int response_length = std::snprintf( //
+        response,
+        sizeof(response),
+        "{\"reserved_bytes\":%zu,\"pooled_bytes\":%zu,\"allocations\":%zu,\"reuses\":%zu,"
+        "\"arena\":{\"arenas\":%zu,\"reserved_bytes\":%zu,\"used_bytes\":%zu,\"peak_bytes\":%zu}}",
+        usage.reserved_bytes.load(std::memory_order_relaxed),
+        usage.pooled_bytes.load(std::memory_order_relaxed),
+        usage.allocations.load(std::memory_order_relaxed),
+        usage.reuses.load(std::memory_order_relaxed),
+        chain.arenas,
+        chain.reserved_bytes,
+        chain.used_bytes,
+        chain.peak_bytes);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto response_chars = arena.alloc<char>(response_length + 1, c.error);
+    return_if_error_m(c.error);
+    std::memcpy(response_chars.begin(), response, response_length + 1);
+    *c.response = response_chars.begin();
+}
+
 inline void clear_linked_memory(ustore_arena_t& c_arena) noexcept {
     static_assert(sizeof(ustore_arena_t) == sizeof(linked_memory_t));
     linked_memory_t& ref = reinterpret_cast<linked_memory_t&>(c_arena);
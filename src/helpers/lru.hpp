@@ -5,7 +5,10 @@
  * @brief Least-Recently Used cache
  */
 #pragma once
-#include "helpers.hpp"
+#include <list>          // `std::list`
+#include <optional>      // `std::optional`
+#include <functional>    // `std::reference_wrapper`
+#include <unordered_map> // `std::unordered_map`
 
 namespace unum::ustore {
 
@@ -18,16 +21,18 @@ namespace unum::ustore {
  * - Allows popping key-value pairs.
  * - Uses `unordered_map` for faster lookups and preallocation.
  *
+ * Pointers to values remain valid until those entries are evicted or popped.
+ *
  * https://www.boost.org/doc/libs/1_67_0/boost/compute/detail/lru_cache.hpp
  */
-template <typename key_at, typename value_at>
+template <typename key_at, typename value_at, typename hash_at = std::hash<key_at>>
 class lru_cache_gt {
 
   public:
     using key_type = key_at;
     using value_type = value_at;
     using list_type = std::list<key_type>;
-    using map_type = std::unordered_map<key_type, std::pair<value_type, typename list_type::iterator>>;
+    using map_type = std::unordered_map<key_type, std::pair<value_type, typename list_type::iterator>, hash_at>;
 
   private:
     map_type map_;
@@ -41,8 +46,12 @@ class lru_cache_gt {
     size_t size() const { return map_.size(); }
     size_t capacity() const { return capacity_; }
     bool empty() const { return map_.empty(); }
-    bool contains(key_type const& key) { return map_.find(key) != map_.end(); }
+    bool contains(key_type const& key) const { return map_.find(key) != map_.end(); }
 
+    /**
+     * @brief Inserts a new entry, unless the key is already present.
+     * Evicts the least recently used entry, if the cache is full.
+     */
     void insert(key_type const& key, value_type&& value) {
         auto i = map_.find(key);
         if (i != map_.end())
@@ -50,28 +59,32 @@ class lru_cache_gt {
         if (size() >= capacity_)
             evict();
         list_.push_front(key);
-        map_[key] = std::make_pair(std::move(value), list_.begin());
+        map_.emplace(key, std::make_pair(std::move(value), list_.begin()));
     }
 
-    value_type const* get_ptr(key_type const& key) {
+    /**
+     * @brief Inserts a new entry or replaces the value of an existing one,
+     * marking it as the most recently used.
+     */
+    void insert_or_assign(key_type const& key, value_type&& value) {
         auto i = map_.find(key);
         if (i == map_.end())
-            return std::nullopt;
-
-        auto j = i->second.second;
-        if (j != list_.begin()) {
-            list_.erase(j);
-            list_.push_front(key);
+            return insert(key, std::move(value));
+        i->second.first = std::move(value);
+        list_.splice(list_.begin(), list_, i->second.second);
+    }
 
-            // update iterator in map
-            j = list_.begin();
-            value_type const& value = i->second.first;
-            map_[key] = std::make_pair(value, j);
-            return &value;
-        }
+    /**
+     * @brief Finds the value and marks it as the most recently used.
+     * @return NULL if the key is missing.
+     */
+    value_type* get_ptr(key_type const& key) {
+        auto i = map_.find(key);
+        if (i == map_.end())
+            return nullptr;
 
-        // the item is already at the front of the most recently
-        // used list so just return it
+        // Moving the node within the list keeps the iterator valid
+        list_.splice(list_.begin(), list_, i->second.second);
         return &i->second.first;
     }
 
@@ -80,16 +93,8 @@ class lru_cache_gt {
         if (i == map_.end())
             return std::nullopt;
 
-        value_type result;
-        auto j = i->second.second;
-        if (j != list_.begin()) {
-            std::swap(result, i->second.first);
-            list_.erase(j);
-        }
-        else {
-            std::swap(result, list_.front());
-            list_.pop_front();
-        }
+        std::optional<value_type> result {std::move(i->second.first)};
+        list_.erase(i->second.second);
         map_.erase(i);
         return result;
     }
@@ -100,15 +105,30 @@ class lru_cache_gt {
     }
 
     void evict() {
+        if (list_.empty())
+            return;
         auto i = --list_.end();
         map_.erase(*i);
         list_.erase(i);
     }
 
-    std::optional<std::pair<key_type, std::reference_wrapper<value_type>>> oldset() {
-        auto i = --list_.end();
-        map_.erase(*i);
-        list_.erase(i);
+    /**
+     * @brief Passes every entry to `callback(key, value)`, without changing their order.
+     */
+    template <typename callback_at>
+    void for_each(callback_at&& callback) {
+        for (auto& [key, value_and_position] : map_)
+            callback(key, value_and_position.first);
+    }
+
+    /**
+     * @brief Exposes the least recently used entry, the next to be evicted.
+     */
+    std::optional<std::pair<key_type, std::reference_wrapper<value_type>>> oldest() {
+        if (list_.empty())
+            return std::nullopt;
+        key_type const& key = list_.back();
+        return std::make_pair(key, std::ref(map_.find(key)->second.first));
     }
 };
 
@@ -0,0 +1,535 @@
+/**
+ * @file metrics.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Optional counters and latency histograms of the C API calls.
+ * Compiled out, unless `USTORE_USE_METRICS` is defined.
+ * The same scopes open tracing spans, if `USTORE_USE_TRACING` is defined.
+ */
+#pragma once
+#include <atomic>   // `std::atomic`
+#include <chrono>   // `std::chrono::steady_clock`
+#include <array>    // `std::array`
+#include <limits>   // `std::numeric_limits`
+#include <string>   // `std::string`
+#include <cstdio>   // `std::snprintf`
+#include <cstring>  // `std::strcmp`
+#include <utility>  // `std::declval`
+#include <iterator> // `std::size`
+
+#include "ustore/db.h"
+#include "helpers/linked_memory.hpp" // `linked_memory_t::usage`
+#include "helpers/tracing.hpp"       // `traced_span_t`
+
+#if !defined(USTORE_USE_METRICS)
+#define USTORE_USE_METRICS 0
+#endif
+
+namespace unum::ustore {
+
+/**
+ * @brief Instrumented entry points of the C API, including modalities.
+ * Modalities are built on top of binary calls, so those get counted as well.
+ */
+enum class metric_op_t : std::size_t {
+    read_k = 0,
+    write_k,
+    scan_k,
+    sample_k,
+    measure_k,
+    erase_k,
+    docs_write_k,
+    docs_read_k,
+    docs_gist_k,
+    docs_gather_k,
+    docs_aggregate_k,
+    docs_find_k,
+    paths_write_k,
+    paths_read_k,
+    paths_match_k,
+    graph_find_edges_k,
+    graph_traverse_k,
+    graph_export_csr_k,
+    graph_pagerank_k,
+    graph_components_k,
+    graph_triangles_k,
+    graph_upsert_edges_k,
+    graph_remove_edges_k,
+    graph_upsert_vertices_k,
+    graph_remove_vertices_k,
+    vectors_write_k,
+    vectors_read_k,
+    vectors_search_k,
+    vectors_index_build_k,
+    count_k,
+};
+
+/**
+ * @brief Instrumented locks, that are frequently contended under load.
+ */
+enum class lock_site_t : std::size_t {
+    ucset_pairs_k = 0,
+    ucset_snapshots_k,
+    ucset_log_order_k,
+    flight_sessions_k,
+    count_k,
+};
+
+inline constexpr char const* metric_op_names_k[] = {
+    "read",
+    "write",
+    "scan",
+    "sample",
+    "measure",
+    "erase",
+    "docs_write",
+    "docs_read",
+    "docs_gist",
+    "docs_gather",
+    "docs_aggregate",
+    "docs_find",
+    "paths_write",
+    "paths_read",
+    "paths_match",
+    "graph_find_edges",
+    "graph_traverse",
+    "graph_export_csr",
+    "graph_pagerank",
+    "graph_components",
+    "graph_triangles",
+    "graph_upsert_edges",
+    "graph_remove_edges",
+    "graph_upsert_vertices",
+    "graph_remove_vertices",
+    "vectors_write",
+    "vectors_read",
+    "vectors_search",
+    "vectors_index_build",
+};
+
+inline constexpr char const* lock_site_names_k[] = {
+    "ucset_pairs",
+    "ucset_snapshots",
+    "ucset_log_order",
+    "flight_sessions",
+};
+
+static_assert(std::size(metric_op_names_k) == static_cast<std::size_t>(metric_op_t::count_k));
+static_assert(std::size(lock_site_names_k) == static_cast<std::size_t>(lock_site_t::count_k));
+
+/**
+ * @brief HDR-style histogram of nanosecond durations with a fixed relative error.
+ * Every power-of-two range is split into 4 linear sub-buckets, so recording is
+ * just a count of leading zeros and a relaxed increment.
+ */
+struct latency_histogram_t {
+    static constexpr std::size_t sub_buckets_k = 4;
+    static constexpr std::size_t buckets_k = 63 * sub_buckets_k;
+
+    std::array<std::atomic<std::uint64_t>, buckets_k> counts {};
+    std::atomic<std::uint64_t> total_ns {0};
+
+    static std::size_t bucket(std::uint64_t ns) noexcept {
+        if (ns < sub_buckets_k)
+            return static_cast<std::size_t>(ns);
+        std::size_t octave = 63 - static_cast<std::size_t>(__builtin_clzll(ns));
+        std::size_t sub = static_cast<std::size_t>(ns >> (octave - 2)) & (sub_buckets_k - 1);
+        return (octave - 1) * sub_buckets_k + sub;
+    }
+
+    /// @brief Smallest duration, that falls into the @p idx bucket.
+    static std::uint64_t bucket_floor(std::size_t idx) noexcept {
+        if (idx < sub_buckets_k)
+            return idx;
+        std::size_t octave = idx / sub_buckets_k + 1;
+        std::uint64_t sub = idx % sub_buckets_k;
+        return (sub_buckets_k + sub) << (octave - 2);
+    }
+
+    void record(std::uint64_t ns) noexcept {
+        counts[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+};
+
+struct alignas(64) op_metrics_t {
+    std::atomic<std::uint64_t> calls {0};
+    std::atomic<std::uint64_t> errors {0};
+    std::atomic<std::uint64_t> bytes_in {0};
+    std::atomic<std::uint64_t> bytes_out {0};
+    latency_histogram_t latency;
+};
+
+/**
+ * @brief Process-wide registry of all the counters. Threads are spread across
+ * shards, to avoid bouncing the same cache lines between cores on hot paths.
+ */
+struct metrics_t {
+    static constexpr std::size_t shards_k = 8;
+
+    struct shard_t {
+        std::array<op_metrics_t, static_cast<std::size_t>(metric_op_t::count_k)> ops;
+        std::array<latency_histogram_t, static_cast<std::size_t>(lock_site_t::count_k)> lock_waits;
+    };
+    std::array<shard_t, shards_k> shards;
+
+    static metrics_t& global() noexcept {
+        static metrics_t metrics;
+        return metrics;
+    }
+
+    static shard_t& local() noexcept {
+        static std::atomic<std::size_t> next_shard {0};
+        thread_local std::size_t shard_idx = next_shard.fetch_add(1, std::memory_order_relaxed) % shards_k;
+        return global().shards[shard_idx];
+    }
+};
+
+using metrics_clock_t = std::chrono::steady_clock;
+
+inline std::uint64_t nanoseconds_since(metrics_clock_t::time_point start) noexcept {
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(metrics_clock_t::now() - start);
+    return static_cast<std::uint64_t>(duration.count());
+}
+
+#if USTORE_USE_METRICS
+
+/**
+ * @brief Scope of a single C API call. Counts it on destruction, including
+ * the time spent and the error, if the call has exported one.
+ */
+class metered_call_t {
+    traced_span_t span_;
+    op_metrics_t& op_;
+    ustore_error_t* error_;
+    metrics_clock_t::time_point start_;
+
+  public:
+    metered_call_t(metric_op_t op, ustore_error_t* error) noexcept
+        : span_(metric_op_names_k[static_cast<std::size_t>(op)], error),
+          op_(metrics_t::local().ops[static_cast<std::size_t>(op)]), error_(error), start_(metrics_clock_t::now()) {}
+    metered_call_t(metered_call_t const&) = delete;
+    metered_call_t& operator=(metered_call_t const&) = delete;
+
+    ~metered_call_t() noexcept {
+        op_.latency.record(nanoseconds_since(start_));
+        op_.calls.fetch_add(1, std::memory_order_relaxed);
+        if (error_ && *error_)
+            op_.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void bytes_in(std::size_t count) noexcept { op_.bytes_in.fetch_add(count, std::memory_order_relaxed); }
+    void bytes_out(std::size_t count) noexcept { op_.bytes_out.fetch_add(count, std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Drop-in replacement for standard mutexes, that records the time spent
+ * waiting for them. Uncontended acquisitions succeed on the first `try_lock`
+ * and don't even query the clock.
+ */
+template <typename mutex_at, lock_site_t site_ak>
+class metered_mutex_gt : public mutex_at {
+
+    static void record(metrics_clock_t::time_point start) noexcept {
+        metrics_t::local().lock_waits[static_cast<std::size_t>(site_ak)].record(nanoseconds_since(start));
+    }
+
+  public:
+    void lock() {
+        if (mutex_at::try_lock())
+            return;
+        auto start = metrics_clock_t::now();
+        mutex_at::lock();
+        record(start);
+    }
+
+    template <typename shared_at = mutex_at>
+    auto lock_shared() -> decltype(std::declval<shared_at&>().lock_shared()) {
+        if (mutex_at::try_lock_shared())
+            return;
+        auto start = metrics_clock_t::now();
+        mutex_at::lock_shared();
+        record(start);
+    }
+};
+
+#else
+
+class metered_call_t {
+    traced_span_t span_;
+
+  public:
+    metered_call_t(metric_op_t op, ustore_error_t* error) noexcept
+        : span_(metric_op_names_k[static_cast<std::size_t>(op)], error) {}
+    metered_call_t(metered_call_t const&) = delete;
+    metered_call_t& operator=(metered_call_t const&) = delete;
+
+    void bytes_in(std::size_t) noexcept {}
+    void bytes_out(std::size_t) noexcept {}
+};
+
+template <typename mutex_at, lock_site_t>
+using metered_mutex_gt = mutex_at;
+
+#endif
+
+/**
+ * @brief Non-atomic sum of the histograms of all shards.
+ */
+struct latency_summary_t {
+    std::array<std::uint64_t, latency_histogram_t::buckets_k> counts {};
+    std::uint64_t total_ns = 0;
+    std::uint64_t count = 0;
+
+    void add(latency_histogram_t const& histogram) noexcept {
+        for (std::size_t i = 0; i != latency_histogram_t::buckets_k; ++i) {
+            std::uint64_t bucket_count = histogram.counts[i].load(std::memory_order_relaxed);
+            counts[i] += bucket_count;
+            count += bucket_count;
+        }
+        total_ns += histogram.total_ns.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Upper estimate of the @p quantile, within the relative error of the buckets.
+    std::uint64_t quantile(double quantile) const noexcept {
+        std::uint64_t threshold = static_cast<std::uint64_t>(quantile * count);
+        std::uint64_t passed = 0;
+        for (std::size_t i = 0; i != latency_histogram_t::buckets_k; ++i) {
+            passed += counts[i];
+            if (passed > threshold)
+                return i + 1 != latency_histogram_t::buckets_k ? latency_histogram_t::bucket_floor(i + 1)
+                                                               : std::numeric_limits<std::uint64_t>::max();
+        }
+        return 0;
+    }
+
+    /// @brief Number of durations shorter than `2^octave` nanoseconds.
+    std::uint64_t count_below_octave(std::size_t octave) const noexcept {
+        std::size_t end = std::min((octave - 1) * latency_histogram_t::sub_buckets_k, latency_histogram_t::buckets_k);
+        std::uint64_t result = 0;
+        for (std::size_t i = 0; i != end; ++i)
+            result += counts[i];
+        return result;
+    }
+};
+
+struct op_summary_t {
+    std::uint64_t calls = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    latency_summary_t latency;
+};
+
+struct metrics_summary_t {
+    std::array<op_summary_t, static_cast<std::size_t>(metric_op_t::count_k)> ops;
+    std::array<latency_summary_t, static_cast<std::size_t>(lock_site_t::count_k)> lock_waits;
+
+    static metrics_summary_t collect() noexcept {
+        metrics_summary_t result;
+        for (metrics_t::shard_t const& shard : metrics_t::global().shards) {
+            for (std::size_t i = 0; i != result.ops.size(); ++i) {
+                op_summary_t& op = result.ops[i];
+                op_metrics_t const& counters = shard.ops[i];
+                op.calls += counters.calls.load(std::memory_order_relaxed);
+                op.errors += counters.errors.load(std::memory_order_relaxed);
+                op.bytes_in += counters.bytes_in.load(std::memory_order_relaxed);
+                op.bytes_out += counters.bytes_out.load(std::memory_order_relaxed);
+                op.latency.add(counters.latency);
+            }
+            for (std::size_t i = 0; i != result.lock_waits.size(); ++i)
+                result.lock_waits[i].add(shard.lock_waits[i]);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Power-of-two bounds of the exported Prometheus histograms,
+ * from about a microsecond to about a minute.
+ */
+inline constexpr std::size_t prometheus_first_octave_k = 10;
+inline constexpr std::size_t prometheus_last_octave_k = 36;
+
+inline void append_prometheus_histogram(std::string& out,
+                                        char const* name,
+                                        char const* label,
+                                        char const* label_value,
+                                        latency_summary_t const& latency) {
+    char line[256];
+    for (std::size_t octave = prometheus_first_octave_k; octave <= prometheus_last_octave_k; ++octave) {
+        double bound_seconds = static_cast<double>(1ull << octave) / 1e9;
+        std::snprintf(line,
+                      sizeof(line),
+                      "%s_bucket{%s=\"%s\",le=\"%.9g\"} %llu\n",
+                      name,
+                      label,
+                      label_value,
+                      bound_seconds,
+                      static_cast<unsigned long long>(latency.count_below_octave(octave)));
+        out += line;
+    }
+    std::snprintf(line,
+                  sizeof(line),
+                  "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n%s_sum{%s=\"%s\"} %.9g\n%s_count{%s=\"%s\"} %llu\n",
+                  name,
+                  label,
+                  label_value,
+                  static_cast<unsigned long long>(latency.count),
+                  name,
+                  label,
+                  label_value,
+                  static_cast<double>(latency.total_ns) / 1e9,
+                  name,
+                  label,
+                  label_value,
+                  static_cast<unsigned long long>(latency.count));
+    out += line;
+}
+
+/**
+ * @brief Formats all the metrics in the Prometheus text exposition format.
+ * Operations that were never called are skipped.
+ */
+inline std::string metrics_to_prometheus(metrics_summary_t const& summary) {
+    std::string out;
+    char line[256];
+    auto append_counter = [&](char const* name, char const* help, auto member) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+        out += line;
+        for (std::size_t i = 0; i != summary.ops.size(); ++i) {
+            if (!summary.ops[i].calls)
+                continue;
+            std::snprintf(line,
+                          sizeof(line),
+                          "%s{op=\"%s\"} %llu\n",
+                          name,
+                          metric_op_names_k[i],
+                          static_cast<unsigned long long>(summary.ops[i].*member));
+            out += line;
+        }
+    };
+    append_counter("ustore_calls_total", "Number of finished C API calls.", &op_summary_t::calls);
+    append_counter("ustore_errors_total", "Number of C API calls, that exported an error.", &op_summary_t::errors);
+    append_counter("ustore_bytes_in_total", "Bytes of values passed into C API calls.", &op_summary_t::bytes_in);
+    append_counter("ustore_bytes_out_total", "Bytes of values exported from C API calls.", &op_summary_t::bytes_out);
+
+    out += "# HELP ustore_call_duration_seconds Latency of C API calls.\n";
+    out += "# TYPE ustore_call_duration_seconds histogram\n";
+    for (std::size_t i = 0; i != summary.ops.size(); ++i)
+        if (summary.ops[i].calls)
+            append_prometheus_histogram(out,
+                                        "ustore_call_duration_seconds",
+                                        "op",
+                                        metric_op_names_k[i],
+                                        summary.ops[i].latency);
+
+    out += "# HELP ustore_lock_wait_seconds Time spent waiting for contended locks.\n";
+    out += "# TYPE ustore_lock_wait_seconds histogram\n";
+    for (std::size_t i = 0; i != summary.lock_waits.size(); ++i)
+        append_prometheus_histogram(out,
+                                    "ustore_lock_wait_seconds",
+                                    "site",
+                                    lock_site_names_k[i],
+                                    summary.lock_waits[i]);
+
+    linked_memory_t::usage_t const& usage = linked_memory_t::usage();
+    std::snprintf(line,
+                  sizeof(line),
+                  "# HELP ustore_arena_allocations_total Arenas allocated from the system.\n"
+                  "# TYPE ustore_arena_allocations_total counter\nustore_arena_allocations_total %zu\n"
+                  "# HELP ustore_arena_reuses_total Arenas taken from the thread-local pools.\n"
+                  "# TYPE ustore_arena_reuses_total counter\nustore_arena_reuses_total %zu\n"
+                  "# HELP ustore_arena_reserved_bytes Bytes reserved for arenas.\n"
+                  "# TYPE ustore_arena_reserved_bytes gauge\nustore_arena_reserved_bytes %zu\n",
+                  usage.allocations.load(std::memory_order_relaxed),
+                  usage.reuses.load(std::memory_order_relaxed),
+                  usage.reserved_bytes.load(std::memory_order_relaxed));
+    out += line;
+    return out;
+}
+
+/**
+ * @brief Formats all the metrics as a JSON object with latency quantiles,
+ * digestible by humans, unlike the Prometheus histograms.
+ */
+inline std::string metrics_to_json(metrics_summary_t const& summary) {
+    std::string out = "{\"calls\":{";
+    char entry[512];
+    bool first = true;
+    for (std::size_t i = 0; i != summary.ops.size(); ++i) {
+        op_summary_t const& op = summary.ops[i];
+        if (!op.calls)
+            continue;
+        std::snprintf(entry,
+                      sizeof(entry),
+                      "%s\"%s\":{\"calls\":%llu,\"errors\":%llu,\"bytes_in\":%llu,\"bytes_out\":%llu,"
+                      "\"mean_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu}",
+                      first ? "" : ",",
+                      metric_op_names_k[i],
+                      static_cast<unsigned long long>(op.calls),
+                      static_cast<unsigned long long>(op.errors),
+                      static_cast<unsigned long long>(op.bytes_in),
+                      static_cast<unsigned long long>(op.bytes_out),
+                      static_cast<unsigned long long>(op.latency.total_ns / op.calls),
+                      static_cast<unsigned long long>(op.latency.quantile(0.5)),
+                      static_cast<unsigned long long>(op.latency.quantile(0.99)),
+                      static_cast<unsigned long long>(op.latency.quantile(0.999)));
+        out += entry;
+        first = false;
+    }
+    out += "},\"lock_waits\":{";
+    for (std::size_t i = 0; i != summary.lock_waits.size(); ++i) {
+        latency_summary_t const& waits = summary.lock_waits[i];
+        std::snprintf(entry,
+                      sizeof(entry),
+                      "%s\"%s\":{\"contended\":%llu,\"total_ns\":%llu,\"p99_ns\":%llu}",
+                      i ? "," : "",
+                      lock_site_names_k[i],
+                      static_cast<unsigned long long>(waits.count),
+                      static_cast<unsigned long long>(waits.total_ns),
+                      static_cast<unsigned long long>(waits.quantile(0.99)));
+        out += entry;
+    }
+    linked_memory_t::usage_t const& usage = linked_memory_t::usage();
+    std::snprintf(entry,
+                  sizeof(entry),
+                  "},\"arenas\":{\"allocations\":%zu,\"reuses\":%zu,\"reserved_bytes\":%zu}}",
+                  usage.allocations.load(std::memory_order_relaxed),
+                  usage.reuses.load(std::memory_order_relaxed),
+                  usage.reserved_bytes.load(std::memory_order_relaxed));
+    out += entry;
+    return out;
+}
+
+inline bool is_metrics_request(ustore_str_view_t request) noexcept {
+    return std::strcmp(request, "metrics") == 0 || std::strcmp(request, "metrics/prometheus") == 0;
+}
+
+/**
+ * @brief Answers the "metrics" request of `ustore_database_control()` with a JSON object,
+ * and the "metrics/prometheus" request with the Prometheus text exposition format.
+ */
+inline void control_metrics(ustore_database_control_t& c) noexcept {
+    return_error_if_m(USTORE_USE_METRICS,
+                      c.error,
+                      missing_feature_k,
+                      "Metrics are only collected, if compiled with USTORE_USE_METRICS");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+
+    std::string response;
+    safe_section("Formatting metrics", c.error, [&] {
+        metrics_summary_t summary = metrics_summary_t::collect();
+        response = std::strcmp(c.request, "metrics") == 0 ? metrics_to_json(summary) : metrics_to_prometheus(summary);
+    });
+    return_if_error_m(c.error);
+
+    auto response_chars = arena.alloc<char>(response.size() + 1, c.error);
+    return_if_error_m(c.error);
+    std::memcpy(response_chars.begin(), response.c_str(), response.size() + 1);
+    *c.response = response_chars.begin();
+}
+
+} // namespace unum::ustore
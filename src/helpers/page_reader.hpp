@@ -0,0 +1,253 @@
+/**
+ * @file page_reader.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Batched reads of fixed-size pages from a memory-mapped file.
+ *
+ * With `USTORE_USE_IO_URING` on Linux, every batch is submitted to an
+ * `io_uring` with a single system call, and the pages are read into private
+ * buffers. Otherwise, or if the kernel refuses to set up a ring, the pages
+ * are first hinted with `MADV_WILLNEED`, so that the kernel starts fetching
+ * all of them at once, and are then accessed through the mapping.
+ *
+ * The ring is driven with raw system calls, so no `liburing` is needed.
+ */
+#pragma once
+#include <algorithm> // `std::max`
+#include <cerrno>    // `errno`
+#include <cstdint>   // `std::uint64_t`
+#include <cstring>   // `std::memset`
+
+#include <sys/mman.h> // `madvise`
+#include <unistd.h>   // `pread`
+
+#if defined(USTORE_USE_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> // `io_uring_params`
+#include <sys/syscall.h>    // `__NR_io_uring_setup`
+#define USTORE_PAGE_READER_URING 1
+#else
+#define USTORE_PAGE_READER_URING 0
+#endif
+
+#include "ustore/cpp/types.hpp" // `byte_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Fetches batches of pages of the same size from a file, that is
+ * also mapped into memory. Isn't thread-safe, but is cheap to construct,
+ * so every thread or call should have its own reader.
+ */
+class page_reader_t {
+    int fd_ = -1;
+    byte_t const* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    std::size_t page_size_ = 0;
+    std::size_t capacity_ = 0;
+    byte_t* buffers_ = nullptr;
+
+#if USTORE_PAGE_READER_URING
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    bool setup_ring(unsigned entries) noexcept {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd < 0)
+            return false;
+        ring_fd_ = ring_fd;
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_map)
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        auto map_ring = [&](std::size_t size, off_t offset) noexcept {
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+            return ptr == MAP_FAILED ? nullptr : ptr;
+        };
+        sq_ring_ = map_ring(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_map ? sq_ring_ : map_ring(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map_ring(sqes_size_, IORING_OFF_SQES));
+        if (!sq_ring_ || !cq_ring_ || !sqes_) {
+            close_ring();
+            return false;
+        }
+
+        auto sq_ring = static_cast<byte_t*>(sq_ring_);
+        auto cq_ring = static_cast<byte_t*>(cq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+        return true;
+    }
+
+    void close_ring() noexcept {
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_)
+            munmap(sq_ring_, sq_ring_size_);
+        if (ring_fd_ >= 0)
+            ::close(ring_fd_);
+        ring_fd_ = -1;
+        sq_ring_ = cq_ring_ = nullptr;
+        sqes_ = nullptr;
+    }
+
+    /**
+     * @brief Submits the whole batch at once and waits for all of it.
+     * Pages, that the ring failed to read completely, are re-read with `pread`.
+     */
+    bool read_ring(std::uint64_t const* offsets, std::size_t count, byte_t const** pages) noexcept {
+        unsigned tail = *sq_tail_;
+        unsigned mask = *sq_mask_;
+        for (std::size_t i = 0; i != count; ++i, ++tail) {
+            unsigned idx = tail & mask;
+            io_uring_sqe& sqe = sqes_[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = fd_;
+            sqe.addr = reinterpret_cast<std::uint64_t>(buffers_ + i * page_size_);
+            sqe.len = static_cast<std::uint32_t>(page_size_);
+            sqe.off = offsets[i];
+            sqe.user_data = i;
+            sq_array_[idx] = idx;
+            pages[i] = nullptr;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+        std::size_t submitted = 0, completed = 0;
+        while (completed != count) {
+            unsigned to_submit = static_cast<unsigned>(count - submitted);
+            unsigned to_wait = static_cast<unsigned>(count - completed);
+            long result = syscall(__NR_io_uring_enter, ring_fd_, to_submit, to_wait, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result < 0 && errno != EINTR)
+                return false;
+            if (result > 0)
+                submitted += static_cast<std::size_t>(result);
+
+            unsigned head = *cq_head_;
+            for (; head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE); ++head, ++completed) {
+                io_uring_cqe const& cqe = cqes_[head & *cq_mask_];
+                std::size_t i = static_cast<std::size_t>(cqe.user_data);
+                bool complete = cqe.res == static_cast<std::int32_t>(page_size_);
+                if (complete || read_direct(offsets[i], buffers_ + i * page_size_))
+                    pages[i] = buffers_ + i * page_size_;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+        for (std::size_t i = 0; i != count; ++i)
+            if (!pages[i])
+                return false;
+        return true;
+    }
+#endif
+
+    bool read_direct(std::uint64_t offset, byte_t* buffer) noexcept {
+        std::size_t done = 0;
+        while (done != page_size_) {
+            ssize_t result = pread(fd_, buffer + done, page_size_ - done, static_cast<off_t>(offset + done));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0)
+                return false;
+            done += static_cast<std::size_t>(result);
+        }
+        return true;
+    }
+
+    void read_mapped(std::uint64_t const* offsets, std::size_t count, byte_t const** pages) noexcept {
+        static std::size_t const os_page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        for (std::size_t i = 0; i != count; ++i) {
+            std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(map_ + offsets[i]);
+            std::uintptr_t aligned = begin & ~(os_page_size - 1u);
+            madvise(reinterpret_cast<void*>(aligned), begin + page_size_ - aligned, MADV_WILLNEED);
+        }
+        for (std::size_t i = 0; i != count; ++i)
+            pages[i] = map_ + offsets[i];
+    }
+
+  public:
+    /** @brief Whether the batches can be submitted to an `io_uring`, if the kernel allows. */
+    static constexpr bool can_use_ring_k = USTORE_PAGE_READER_URING;
+
+    page_reader_t(int fd, byte_t const* map, std::size_t map_size, std::size_t page_size) noexcept
+        : fd_(fd), map_(map), map_size_(map_size), page_size_(page_size) {}
+
+    page_reader_t(page_reader_t const&) = delete;
+    page_reader_t& operator=(page_reader_t const&) = delete;
+
+    ~page_reader_t() noexcept {
+#if USTORE_PAGE_READER_URING
+        close_ring();
+#endif
+    }
+
+    /**
+     * @brief Prepares to read batches of up to `capacity` pages.
+     * @param buffers Memory for `capacity` pages, aligned to the page size, or NULL to always read through the mapping.
+     */
+    void reserve(std::size_t capacity, byte_t* buffers) noexcept {
+        capacity_ = capacity;
+        buffers_ = buffers;
+#if USTORE_PAGE_READER_URING
+        if (buffers_ && ring_fd_ < 0)
+            setup_ring(static_cast<unsigned>(capacity_));
+#endif
+    }
+
+    /**
+     * @brief Checks if the batches are submitted to an `io_uring`.
+     */
+    bool uses_ring() const noexcept {
+#if USTORE_PAGE_READER_URING
+        return ring_fd_ >= 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Fetches up to `capacity` pages, starting at the given `offsets`.
+     * The exported pointers are only valid until the next call.
+     * @return false If some of the pages are out of bounds or couldn't be read.
+     */
+    bool read(std::uint64_t const* offsets, std::size_t count, byte_t const** pages) noexcept {
+        if (count > capacity_)
+            return false;
+        for (std::size_t i = 0; i != count; ++i)
+            if (offsets[i] + page_size_ > map_size_)
+                return false;
+
+#if USTORE_PAGE_READER_URING
+        if (ring_fd_ >= 0)
+            return read_ring(offsets, count, pages);
+#endif
+        read_mapped(offsets, count, pages);
+        return true;
+    }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,221 @@
+/**
+ * @file reads_coalescer.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Merging of small concurrent reads into shared engine calls, used by the Arrow Flight server.
+ */
+#pragma once
+#include <chrono>             // `std::chrono::microseconds`
+#include <condition_variable> // `std::condition_variable`
+#include <cstring>            // `std::memcpy`
+#include <memory>             // `std::shared_ptr`
+#include <mutex>              // `std::mutex`
+#include <unordered_map>      // `std::unordered_map`
+#include <vector>             // `std::vector`
+
+#include "ustore/blobs.h"             // `ustore_read_t`
+#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+#include "linked_memory.hpp"          // `linked_memory_lock_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Merges small concurrent reads outside of transactions into shared engine calls.
+ *
+ * The first read to arrive opens a group for its snapshot, the following ones join it,
+ * until it has `max_tasks` tasks or is taken for execution. If no other groups are being
+ * read from the engine, the opener executes its group right away, so an idle server adds
+ * no latency. Otherwise it waits up to `max_delay` for others to join. Engines then serve
+ * the whole group with one batched lookup, like `MultiGet` in RocksDB. Every participant
+ * copies its own slice of the results into its arena, exactly as `ustore_read()` would.
+ *
+ * ## Errors
+ *
+ * Errors don't fan out. If the shared call fails, every participant repeats its own read
+ * alone, so that a single malformed request, like one naming a dropped collection, fails
+ * only its sender, while the rest still get their results or their own errors.
+ */
+class reads_coalescer_t {
+    struct group_t {
+        std::vector<ustore_collection_t> collections;
+        std::vector<ustore_key_t> keys;
+        bool needs_values = false;
+
+        std::vector<ustore_length_t> offsets;
+        std::vector<ustore_length_t> lengths;
+        std::vector<byte_t> values;
+        ustore_error_t error = nullptr;
+        bool done = false;
+        std::condition_variable changed;
+    };
+
+    ustore_database_t db_ = nullptr;
+    std::chrono::microseconds max_delay_ {0};
+    std::size_t max_tasks_ = 0;
+
+    std::mutex mutex_;
+    std::unordered_map<ustore_snapshot_t, std::shared_ptr<group_t>> open_groups_;
+    std::size_t running_groups_ = 0;
+
+    void execute(group_t& group, ustore_snapshot_t snapshot, ustore_arena_t* arena) noexcept {
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db_;
+        read.error = &group.error;
+        read.snapshot = snapshot;
+        read.arena = arena;
+        read.tasks_count = static_cast<ustore_size_t>(group.keys.size());
+        read.collections = group.collections.data();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = group.keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = group.needs_values ? &found_offsets : nullptr;
+        read.lengths = &found_lengths;
+        read.values = group.needs_values ? &found_values : nullptr;
+        ustore_read(&read);
+        if (group.error)
+            return;
+
+        // The arena of the executing session will be reused, so keep a copy
+        safe_section("Copying coalesced reads", &group.error, [&] {
+            std::size_t const tasks_count = group.keys.size();
+            group.lengths.assign(found_lengths, found_lengths + tasks_count);
+            if (!group.needs_values)
+                return;
+            group.offsets.resize(tasks_count + 1);
+            ustore_length_t exported_bytes = 0;
+            for (std::size_t i = 0; i != tasks_count; ++i) {
+                group.offsets[i] = exported_bytes;
+                exported_bytes += found_lengths[i] != ustore_length_missing_k ? found_lengths[i] : 0;
+            }
+            group.offsets[tasks_count] = exported_bytes;
+            group.values.resize(exported_bytes);
+            for (std::size_t i = 0; i != tasks_count; ++i)
+                if (found_lengths[i] && found_lengths[i] != ustore_length_missing_k)
+                    std::memcpy(group.values.data() + group.offsets[i],
+                                found_values + found_offsets[i],
+                                found_lengths[i]);
+        });
+    }
+
+    void export_slice(group_t const& group, std::size_t offset, ustore_read_t& c) noexcept {
+        if (group.error)
+            return ustore_read(&c);
+
+        linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+        return_if_error_m(c.error);
+
+        std::size_t const tasks_count = c.tasks_count;
+        ustore_length_t const* lengths = group.lengths.data() + offset;
+        if (c.presences) {
+            std::size_t slots_count = divide_round_up<std::size_t>(tasks_count, CHAR_BIT);
+            auto slots = arena.alloc<ustore_octet_t>(slots_count, c.error);
+            return_if_error_m(c.error);
+            std::memset(slots.begin(), 0, slots_count);
+            auto presences = bits_span_t(slots.begin());
+            for (std::size_t i = 0; i != tasks_count; ++i)
+                presences[i] = lengths[i] != ustore_length_missing_k;
+            *c.presences = slots.begin();
+        }
+        if (c.lengths) {
+            auto exported = arena.alloc<ustore_length_t>(tasks_count, c.error);
+            return_if_error_m(c.error);
+            std::memcpy(exported.begin(), lengths, tasks_count * sizeof(ustore_length_t));
+            *c.lengths = exported.begin();
+        }
+        if (c.offsets || c.values) {
+            ustore_length_t const* offsets = group.offsets.data() + offset;
+            ustore_length_t const first_offset = offsets[0];
+            std::size_t const slice_bytes = offsets[tasks_count] - first_offset;
+            auto exported_offsets = arena.alloc<ustore_length_t>(tasks_count + 1, c.error);
+            return_if_error_m(c.error);
+            auto exported_values = arena.alloc<byte_t>(slice_bytes, c.error);
+            return_if_error_m(c.error);
+            for (std::size_t i = 0; i <= tasks_count; ++i)
+                exported_offsets[i] = offsets[i] - first_offset;
+            if (slice_bytes)
+                std::memcpy(exported_values.begin(), group.values.data() + first_offset, slice_bytes);
+            if (c.offsets)
+                *c.offsets = exported_offsets.begin();
+            if (c.values)
+                *c.values = reinterpret_cast<ustore_bytes_ptr_t>(exported_values.begin());
+        }
+    }
+
+  public:
+    reads_coalescer_t(ustore_database_t db, std::chrono::microseconds max_delay, std::size_t max_tasks) noexcept
+        : db_(db), max_delay_(max_delay), max_tasks_(max_tasks) {}
+
+    /**
+     * @brief Checks if the read is small enough to share an engine call with others.
+     * Transactions must track their own reads, so they are never coalesced.
+     */
+    bool accepts(ustore_read_t const& c) const noexcept {
+        return max_delay_.count() && !c.transaction && !(c.options & ustore_option_read_shared_memory_k) &&
+               c.tasks_count && c.tasks_count <= max_tasks_ / 4;
+    }
+
+    /**
+     * @brief Reads the presences, offsets, lengths and values requested by `c`,
+     * potentially along with other concurrent reads. Expects `accepts(c)`.
+     */
+    void read(ustore_read_t& c) noexcept {
+        strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+        strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+        places_arg_t places {collections, keys, {}, c.tasks_count};
+
+        std::shared_ptr<group_t> group;
+        std::size_t offset = 0;
+        bool leads = false;
+        std::unique_lock<std::mutex> lk(mutex_);
+        safe_section("Joining coalesced reads", c.error, [&] {
+            std::shared_ptr<group_t>& open_group = open_groups_[c.snapshot];
+            if (!open_group) {
+                open_group = std::make_shared<group_t>();
+                open_group->collections.reserve(max_tasks_ + max_tasks_ / 4);
+                open_group->keys.reserve(max_tasks_ + max_tasks_ / 4);
+                leads = true;
+            }
+            group = open_group;
+            offset = group->keys.size();
+            for (std::size_t i = 0; i != places.size(); ++i) {
+                group->collections.push_back(places[i].collection);
+                group->keys.push_back(places[i].key);
+            }
+            group->needs_values |= c.offsets || c.values;
+            if (group->keys.size() >= max_tasks_) {
+                open_groups_.erase(c.snapshot);
+                group->changed.notify_all();
+            }
+        });
+        if (*c.error)
+            return;
+
+        if (!leads) {
+            group->changed.wait(lk, [&] { return group->done; });
+            lk.unlock();
+            return export_slice(*group, offset, c);
+        }
+
+        // Wait for others to join, only if the engine is busy anyways
+        if (running_groups_)
+            group->changed.wait_for(lk, max_delay_, [&] { return group->keys.size() >= max_tasks_; });
+        if (auto it = open_groups_.find(c.snapshot); it != open_groups_.end() && it->second == group)
+            open_groups_.erase(it);
+        ++running_groups_;
+        lk.unlock();
+
+        execute(*group, c.snapshot, c.arena);
+
+        lk.lock();
+        --running_groups_;
+        group->done = true;
+        group->changed.notify_all();
+        lk.unlock();
+        export_slice(*group, offset, c);
+    }
+};
+
+} // namespace unum::ustore
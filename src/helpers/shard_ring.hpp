@@ -0,0 +1,187 @@
+/**
+ * @file shard_ring.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Consistent hashing of keys onto a list of servers, and merging of their replies.
+ *
+ * The sharded client splits every batch with `route_keys()`, sends the parts to the servers,
+ * and combines the replies with `merged_reads_t`, `merge_scans()` and `match_collections()`.
+ * None of them depend on the transport, so they can be tested without servers.
+ */
+#pragma once
+#include <algorithm>     // `std::upper_bound`
+#include <cstdint>       // `std::uint64_t`
+#include <string>        // `std::string`
+#include <string_view>   // `std::string_view`
+#include <unordered_map> // `std::unordered_map`
+#include <utility>       // `std::pair`
+#include <vector>        // `std::vector`
+
+#include "ustore/db.h"           // `ustore_key_t`
+#include "ustore/cpp/types.hpp"  // `value_view_t`
+#include "ustore/cpp/ranges.hpp" // `bits_view_t`
+#include "hash.hpp"               // `stable_hash`
+
+namespace unum::ustore {
+
+/**
+ * @brief Ring of virtual nodes, with every shard owning `replicas` points on it.
+ * A key belongs to the first point following its hash, wrapping around the ring.
+ *
+ * Points are derived from the shard names, rather than their positions in the list,
+ * so adding or removing a shard only remaps the keys of the affected arcs.
+ * The hashes are stable, so every client with the same list routes keys identically.
+ */
+class shard_ring_t {
+    std::vector<std::pair<std::uint64_t, std::size_t>> points_;
+    std::size_t shards_count_ = 0;
+
+  public:
+    static constexpr std::size_t replicas_default_k = 128;
+
+    shard_ring_t(std::vector<std::string> const& names, std::size_t replicas = replicas_default_k)
+        : shards_count_(names.size()) {
+        points_.reserve(names.size() * replicas);
+        for (std::size_t shard = 0; shard != names.size(); ++shard) {
+            for (std::size_t replica = 0; replica != replicas; ++replica) {
+                std::string point_name = names[shard] + "#" + std::to_string(replica);
+                points_.emplace_back(stable_hash(point_name), shard);
+            }
+        }
+        std::sort(points_.begin(), points_.end());
+    }
+
+    std::size_t size() const noexcept { return shards_count_; }
+
+    std::size_t shard(ustore_key_t key) const noexcept {
+        // Serialize in little-endian order, so that big-endian clients agree on the placement
+        char bytes[sizeof(ustore_key_t)];
+        auto word = static_cast<std::uint64_t>(key);
+        for (std::size_t i = 0; i != sizeof(ustore_key_t); ++i)
+            bytes[i] = static_cast<char>(word >> (i * 8));
+        std::uint64_t hash = stable_hash(std::string_view(bytes, sizeof(bytes)));
+
+        auto it = std::upper_bound(points_.begin(),
+                                   points_.end(),
+                                   hash,
+                                   [](std::uint64_t hash, auto const& point) { return hash < point.first; });
+        return it != points_.end() ? it->second : points_.front().second;
+    }
+};
+
+/**
+ * @brief Routes every task to the shard owning its key, preserving the order of tasks within every shard.
+ * @param[out] routes The shard of every task.
+ * @param[out] rows The position of every task within the part of the batch, sent to its shard.
+ */
+template <typename key_of_at>
+void route_keys(shard_ring_t const& ring,
+                std::size_t tasks_count,
+                key_of_at&& key_of,
+                std::vector<std::size_t>& routes,
+                std::vector<std::size_t>& rows) {
+    std::vector<std::size_t> shards_sizes(ring.size());
+    routes.resize(tasks_count);
+    rows.resize(tasks_count);
+    for (std::size_t i = 0; i != tasks_count; ++i) {
+        std::size_t shard = ring.shard(key_of(i));
+        routes[i] = shard;
+        rows[i] = shards_sizes[shard]++;
+    }
+}
+
+/**
+ * @brief Outputs of reads, that every shard answered for its part of the batch,
+ * addressed in the order of tasks of the whole batch, following `route_keys()`.
+ * If lengths were requested, presences are derived from them.
+ */
+struct merged_reads_t {
+    std::size_t const* routes = nullptr;
+    std::size_t const* rows = nullptr;
+    ustore_octet_t* const* presences = nullptr;
+    ustore_length_t* const* offsets = nullptr;
+    ustore_length_t* const* lengths = nullptr;
+    ustore_byte_t* const* values = nullptr;
+
+    ustore_length_t length(std::size_t task) const noexcept { return lengths[routes[task]][rows[task]]; }
+
+    bool present(std::size_t task) const noexcept {
+        return lengths[routes[task]] ? length(task) != ustore_length_missing_k
+                                     : bits_view_t(presences[routes[task]])[rows[task]];
+    }
+
+    value_view_t value(std::size_t task) const noexcept {
+        std::size_t shard = routes[task];
+        return {values[shard] + offsets[shard][rows[task]], length(task)};
+    }
+};
+
+/**
+ * @brief Merges the sorted keys, that every shard found for each of the scan tasks,
+ * keeping the smallest ones within the limit of every task. Shards without outputs are skipped.
+ * @param[out] keys The merged keys of all tasks.
+ * @param[out] offsets The `tasks_count + 1` offsets of the first key of every task in `keys`.
+ */
+inline void merge_scans(std::size_t tasks_count,
+                        std::size_t shards_count,
+                        ustore_length_t* const* shards_offsets,
+                        ustore_key_t* const* shards_keys,
+                        ustore_length_t const* limits,
+                        std::vector<ustore_key_t>& keys,
+                        std::vector<ustore_length_t>& offsets) {
+    keys.clear();
+    offsets.resize(tasks_count + 1);
+
+    // Every shard returns sorted keys, so the merged prefix only needs in-place merges
+    for (std::size_t i = 0; i != tasks_count; ++i) {
+        std::size_t const task_begin = keys.size();
+        offsets[i] = static_cast<ustore_length_t>(task_begin);
+        for (std::size_t shard = 0; shard != shards_count; ++shard) {
+            ustore_length_t const* shard_offsets = shards_offsets[shard];
+            if (!shard_offsets)
+                continue;
+            std::size_t const merged_end = keys.size();
+            keys.insert(keys.end(),
+                        shards_keys[shard] + shard_offsets[i],
+                        shards_keys[shard] + shard_offsets[i + 1]);
+            std::inplace_merge(keys.begin() + task_begin, keys.begin() + merged_end, keys.end());
+        }
+        keys.resize(std::min<std::size_t>(keys.size(), task_begin + limits[i]));
+    }
+    offsets[tasks_count] = static_cast<ustore_length_t>(keys.size());
+}
+
+/**
+ * @brief Matches the named collections, listed by every shard, by their names.
+ * @return The IDs on every shard, addressed by the IDs on the first one.
+ * Collections, missing on any of the shards, are skipped.
+ */
+inline std::unordered_map<ustore_collection_t, std::vector<ustore_collection_t>> match_collections(
+    std::size_t shards_count,
+    ustore_size_t const* counts,
+    ustore_collection_t* const* ids,
+    ustore_length_t* const* offsets,
+    ustore_char_t* const* names) {
+
+    std::unordered_map<std::string_view, ustore_collection_t> ids_by_names;
+    std::unordered_map<ustore_collection_t, std::vector<ustore_collection_t>> mapping;
+    for (std::size_t i = 0; i != counts[0]; ++i)
+        mapping[ids[0][i]].resize(shards_count, ustore_collection_main_k);
+    for (std::size_t shard = 1; shard != shards_count; ++shard) {
+        ids_by_names.clear();
+        for (std::size_t i = 0; i != counts[shard]; ++i)
+            ids_by_names.emplace(names[shard] + offsets[shard][i], ids[shard][i]);
+        for (std::size_t i = 0; i != counts[0]; ++i) {
+            auto it = ids_by_names.find(names[0] + offsets[0][i]);
+            if (it == ids_by_names.end())
+                mapping.erase(ids[0][i]);
+            else if (auto row = mapping.find(ids[0][i]); row != mapping.end())
+                row->second[shard] = it->second;
+        }
+    }
+    for (auto& [id, row] : mapping)
+        row[0] = id;
+    return mapping;
+}
+
+} // namespace unum::ustore
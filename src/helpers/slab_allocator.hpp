@@ -0,0 +1,212 @@
+/**
+ * @file helpers/slab_allocator.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Size-class allocator for large numbers of small blobs.
+ */
+#pragma once
+#include <cstdint> // `std::uint64_t`
+#include <cstddef> // `std::size_t`
+#include <cstdlib> // `std::free`
+#include <atomic>  // `std::atomic`
+#include <mutex>   // `std::mutex`
+#include <new>     // `std::nothrow`
+#include <array>   // `std::array`
+#include <utility> // `std::exchange`
+
+namespace unum::ustore {
+
+/**
+ * @brief Packs small allocations of similar sizes into big slabs, instead of separate heap allocations.
+ *
+ * Requested sizes are rounded up to one of `size_classes_k` classes: multiples of 8 bytes
+ * up to 64, and then four classes per every power of two, up to `max_block_size_k`.
+ * Freed blocks form a linked list within each class and are reused by the following allocations.
+ * Bigger blobs are forwarded to `::operator new`. Like `std::allocator`, the caller has to pass
+ * the same size to `deallocate`, that was passed to `allocate`.
+ *
+ * Slabs are never returned to the OS, until the allocator itself is destroyed.
+ * Blocks, allocated by others with `std::malloc`, can also be adopted, to be accounted
+ * together with the rest and released with `deallocate_adopted`.
+ */
+class slab_allocator_t {
+  public:
+    static constexpr std::size_t size_classes_k = 32;
+    static constexpr std::size_t max_block_size_k = 4096;
+    static constexpr std::size_t slab_size_k = 64 * 1024;
+
+    struct class_usage_t {
+        std::size_t block_size = 0;
+        std::size_t slabs = 0;
+        std::size_t blocks_used = 0;
+    };
+
+    struct usage_t {
+        /** @brief Sum of all the requested sizes, currently in use. */
+        std::size_t requested_bytes = 0;
+        /** @brief Sum of sizes of all the used blocks, including the rounding overheads. */
+        std::size_t allocated_bytes = 0;
+        /** @brief Memory of all the slabs, including the free blocks. */
+        std::size_t reserved_bytes = 0;
+        /** @brief Memory of the blobs bigger than `max_block_size_k`. */
+        std::size_t large_bytes = 0;
+        /** @brief Memory of the adopted blocks. */
+        std::size_t adopted_bytes = 0;
+        std::array<class_usage_t, size_classes_k> classes;
+    };
+
+    static constexpr std::size_t block_size(std::size_t class_idx) noexcept {
+        if (class_idx < 8)
+            return (class_idx + 1) * 8;
+        std::size_t power = 6 + (class_idx - 8) / 4;
+        std::size_t step = std::size_t(1) << (power - 2);
+        return (std::size_t(1) << power) + ((class_idx - 8) % 4 + 1) * step;
+    }
+
+    static constexpr std::size_t size_class(std::size_t size) noexcept {
+        if (size <= 64)
+            return size ? (size - 1) / 8 : 0;
+        std::size_t power = 0;
+        while ((std::size_t(1) << (power + 1)) < size)
+            ++power;
+        std::size_t step = std::size_t(1) << (power - 2);
+        std::size_t steps = (size - (std::size_t(1) << power) + step - 1) / step;
+        return 8 + (power - 6) * 4 + steps - 1;
+    }
+
+  private:
+    struct free_block_t {
+        free_block_t* next;
+    };
+
+    struct slab_t {
+        slab_t* next;
+    };
+
+    /** @brief Slabs are prefixed with a link to the previous slab of the same class, padded for alignment. */
+    static constexpr std::size_t slab_header_k = 16;
+
+    struct size_class_t {
+        std::mutex mutex;
+        free_block_t* free_blocks = nullptr;
+        slab_t* slabs = nullptr;
+        std::size_t slabs_count = 0;
+        std::size_t blocks_used = 0;
+    };
+
+    std::array<size_class_t, size_classes_k> classes_;
+    std::atomic<std::size_t> requested_bytes_ {0};
+    std::atomic<std::size_t> large_bytes_ {0};
+    std::atomic<std::size_t> adopted_bytes_ {0};
+
+    bool add_slab(size_class_t& bucket, std::size_t block_size) noexcept {
+        auto slab = static_cast<slab_t*>(::operator new(slab_size_k, std::nothrow));
+        if (!slab)
+            return false;
+        slab->next = bucket.slabs;
+        bucket.slabs = slab;
+        ++bucket.slabs_count;
+
+        auto begin = reinterpret_cast<std::uint8_t*>(slab) + slab_header_k;
+        auto end = reinterpret_cast<std::uint8_t*>(slab) + slab_size_k;
+        for (auto block = begin; block + block_size <= end; block += block_size) {
+            auto free_block = reinterpret_cast<free_block_t*>(block);
+            free_block->next = bucket.free_blocks;
+            bucket.free_blocks = free_block;
+        }
+        return true;
+    }
+
+  public:
+    slab_allocator_t() noexcept = default;
+    slab_allocator_t(slab_allocator_t const&) = delete;
+    slab_allocator_t& operator=(slab_allocator_t const&) = delete;
+
+    ~slab_allocator_t() noexcept {
+        for (auto& bucket : classes_)
+            while (bucket.slabs)
+                ::operator delete(std::exchange(bucket.slabs, bucket.slabs->next));
+    }
+
+    /** @return NULL, if the memory is exhausted. */
+    void* allocate(std::size_t size) noexcept {
+        if (size > max_block_size_k) {
+            void* ptr = ::operator new(size, std::nothrow);
+            if (ptr) {
+                large_bytes_ += size;
+                requested_bytes_ += size;
+            }
+            return ptr;
+        }
+
+        std::size_t class_idx = size_class(size);
+        size_class_t& bucket = classes_[class_idx];
+        std::unique_lock _ {bucket.mutex};
+        if (!bucket.free_blocks && !add_slab(bucket, block_size(class_idx)))
+            return nullptr;
+        free_block_t* block = bucket.free_blocks;
+        bucket.free_blocks = block->next;
+        ++bucket.blocks_used;
+        requested_bytes_ += size;
+        return block;
+    }
+
+    void deallocate(void* ptr, std::size_t size) noexcept {
+        if (!ptr)
+            return;
+        requested_bytes_ -= size;
+        if (size > max_block_size_k) {
+            large_bytes_ -= size;
+            return ::operator delete(ptr);
+        }
+
+        size_class_t& bucket = classes_[size_class(size)];
+        std::unique_lock _ {bucket.mutex};
+        auto block = static_cast<free_block_t*>(ptr);
+        block->next = bucket.free_blocks;
+        bucket.free_blocks = block;
+        --bucket.blocks_used;
+    }
+
+    /** @brief Accounts a block of `size` bytes, allocated with `std::malloc` by someone else. */
+    void adopt(std::size_t size) noexcept {
+        adopted_bytes_ += size;
+        requested_bytes_ += size;
+    }
+
+    void deallocate_adopted(void* ptr, std::size_t size) noexcept {
+        if (!ptr)
+            return;
+        adopted_bytes_ -= size;
+        requested_bytes_ -= size;
+        std::free(ptr);
+    }
+
+    /** @brief Cheap to query sum of the requested sizes, currently in use. */
+    std::size_t requested_bytes() const noexcept { return requested_bytes_.load(std::memory_order_relaxed); }
+
+    usage_t usage() noexcept {
+        usage_t result;
+        result.requested_bytes = requested_bytes_;
+        result.large_bytes = large_bytes_;
+        result.adopted_bytes = adopted_bytes_;
+        result.allocated_bytes = result.large_bytes + result.adopted_bytes;
+        for (std::size_t class_idx = 0; class_idx != size_classes_k; ++class_idx) {
+            size_class_t& bucket = classes_[class_idx];
+            std::unique_lock _ {bucket.mutex};
+            class_usage_t& class_usage = result.classes[class_idx];
+            class_usage.block_size = block_size(class_idx);
+            class_usage.slabs = bucket.slabs_count;
+            class_usage.blocks_used = bucket.blocks_used;
+            result.allocated_bytes += class_usage.blocks_used * class_usage.block_size;
+            result.reserved_bytes += class_usage.slabs * slab_size_k;
+        }
+        return result;
+    }
+};
+
+static_assert(slab_allocator_t::block_size(slab_allocator_t::size_classes_k - 1) ==
+                  slab_allocator_t::max_block_size_k,
+              "Size classes must cover all the small blocks");
+
+} // namespace unum::ustore
@@ -0,0 +1,352 @@
+/**
+ * @file tracing.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Optional spans around C API calls, modality stages and RPCs.
+ * Compiled out, unless `USTORE_USE_TRACING` is defined.
+ *
+ * Spans use the OpenTelemetry data model: a 128-bit trace ID shared by all
+ * the spans of one request, and a 64-bit ID per span, linked to its parent.
+ * Within a process the parent is the innermost open span of the current thread.
+ * Between processes the context travels in the W3C "traceparent" header.
+ * Finished spans are kept in bounded buffers, and drained in the OTLP/JSON
+ * format, that an OpenTelemetry collector accepts as is.
+ */
+#pragma once
+#include <array>       // `std::array`
+#include <atomic>      // `std::atomic`
+#include <functional>  // `std::hash`
+#include <chrono>      // `std::chrono::system_clock`
+#include <mutex>       // `std::mutex`
+#include <random>      // `std::mt19937_64`
+#include <string>      // `std::string`
+#include <string_view> // `std::string_view`
+#include <vector>      // `std::vector`
+#include <thread>      // `std::this_thread::get_id`
+#include <cstdio>      // `std::snprintf`
+#include <cstring>     // `std::strcmp`
+
+#include "ustore/db.h"
+#include "helpers/linked_memory.hpp" // `linked_memory`
+
+#if !defined(USTORE_USE_TRACING)
+#define USTORE_USE_TRACING 0
+#endif
+
+namespace unum::ustore {
+
+inline constexpr char const* traceparent_header_k = "traceparent";
+
+struct span_context_t {
+    std::uint64_t trace_id_high = 0;
+    std::uint64_t trace_id_low = 0;
+    std::uint64_t span_id = 0;
+
+    bool valid() const noexcept { return (trace_id_high || trace_id_low) && span_id; }
+};
+
+/**
+ * @brief Parses the W3C "traceparent" header: "00-{32 hex trace ID}-{16 hex span ID}-{2 hex flags}".
+ * @return Invalid context, if the header is malformed.
+ */
+inline span_context_t parse_traceparent(std::string_view header) noexcept {
+    span_context_t result;
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-')
+        return result;
+
+    auto parse_hex = [&](std::size_t offset, std::size_t length, std::uint64_t& value) {
+        value = 0;
+        for (std::size_t i = offset; i != offset + length; ++i) {
+            char ch = header[i];
+            std::uint64_t digit = ch >= '0' && ch <= '9'   ? ch - '0'
+                                  : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10
+                                  : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10
+                                                           : 16;
+            if (digit == 16)
+                return false;
+            value = (value << 4) | digit;
+        }
+        return true;
+    };
+    span_context_t parsed;
+    if (parse_hex(3, 16, parsed.trace_id_high) && //
+        parse_hex(19, 16, parsed.trace_id_low) && //
+        parse_hex(36, 16, parsed.span_id))
+        result = parsed;
+    return result;
+}
+
+/**
+ * @brief Formats the W3C "traceparent" header, always marking the trace as sampled.
+ */
+inline std::string format_traceparent(span_context_t const& context) {
+    char header[56];
+    std::snprintf(header,
+                  sizeof(header),
+                  "00-%016llx%016llx-%016llx-01",
+                  static_cast<unsigned long long>(context.trace_id_high),
+                  static_cast<unsigned long long>(context.trace_id_low),
+                  static_cast<unsigned long long>(context.span_id));
+    return header;
+}
+
+struct finished_span_t {
+    span_context_t context;
+    std::uint64_t parent_span_id = 0;
+    char const* name = nullptr;
+    std::uint64_t start_unix_ns = 0;
+    std::uint64_t end_unix_ns = 0;
+    bool failed = false;
+};
+
+/**
+ * @brief Process-wide storage of finished spans.
+ *
+ * Spans are appended to one of a few shards, picked per thread, so that
+ * concurrent calls rarely contend. Every shard is a ring buffer: if nobody
+ * drains them, the oldest spans are overwritten and counted as dropped.
+ */
+class spans_t {
+  public:
+    static constexpr std::size_t shards_count_k = 8;
+    static constexpr std::size_t spans_per_shard_k = 4096;
+
+  private:
+    struct alignas(64) shard_t {
+        std::mutex mutex;
+        std::vector<finished_span_t> ring;
+        std::size_t next = 0;
+        std::size_t dropped = 0;
+    };
+    std::array<shard_t, shards_count_k> shards_;
+
+  public:
+    static spans_t& global() noexcept {
+        static spans_t spans;
+        return spans;
+    }
+
+    void record(finished_span_t const& span) noexcept {
+        static std::atomic<std::size_t> threads_count {0};
+        thread_local std::size_t shard_idx = threads_count.fetch_add(1, std::memory_order_relaxed) % shards_count_k;
+        shard_t& shard = shards_[shard_idx];
+        std::lock_guard<std::mutex> lock {shard.mutex};
+        if (shard.ring.size() < spans_per_shard_k) {
+            try {
+                shard.ring.push_back(span);
+                return;
+            }
+            catch (...) {
+            }
+        }
+        ++shard.dropped;
+        if (shard.ring.empty())
+            return;
+        shard.ring[shard.next] = span;
+        shard.next = (shard.next + 1) % shard.ring.size();
+    }
+
+    /**
+     * @brief Moves all the finished spans into @p spans, emptying the buffers.
+     * @return The number of spans overwritten since the last drain.
+     */
+    std::size_t drain(std::vector<finished_span_t>& spans) noexcept(false) {
+        std::size_t dropped = 0;
+        for (shard_t& shard : shards_) {
+            std::lock_guard<std::mutex> lock {shard.mutex};
+            spans.insert(spans.end(), shard.ring.begin() + shard.next, shard.ring.end());
+            spans.insert(spans.end(), shard.ring.begin(), shard.ring.begin() + shard.next);
+            dropped += shard.dropped;
+            shard.ring.clear();
+            shard.next = 0;
+            shard.dropped = 0;
+        }
+        return dropped;
+    }
+};
+
+/**
+ * @brief The innermost open span of the calling thread, the parent of the next one.
+ */
+inline span_context_t& current_span() noexcept {
+    thread_local span_context_t context;
+    return context;
+}
+
+inline std::uint64_t random_span_id() noexcept {
+    thread_local std::mt19937_64 generator {std::random_device {}() ^
+                                            std::hash<std::thread::id> {}(std::this_thread::get_id())};
+    std::uint64_t id = 0;
+    while (!id)
+        id = generator();
+    return id;
+}
+
+inline std::uint64_t unix_nanoseconds() noexcept {
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count());
+}
+
+#if USTORE_USE_TRACING
+
+/**
+ * @brief Scope of a single span. Becomes the parent of the spans opened
+ * on the same thread until it is destroyed, and then gets recorded.
+ * The @p name must outlive the program, so should be a string literal.
+ */
+class traced_span_t {
+    finished_span_t span_;
+    ustore_error_t* error_;
+    span_context_t previous_;
+
+  public:
+    traced_span_t(char const* name, ustore_error_t* error = nullptr) noexcept
+        : traced_span_t(name, current_span(), error) {}
+
+    /**
+     * @brief Continues a trace started elsewhere, like the one received from an RPC client.
+     */
+    traced_span_t(char const* name, span_context_t const& parent, ustore_error_t* error = nullptr) noexcept
+        : error_(error), previous_(current_span()) {
+        span_.name = name;
+        if (parent.valid()) {
+            span_.context.trace_id_high = parent.trace_id_high;
+            span_.context.trace_id_low = parent.trace_id_low;
+            span_.parent_span_id = parent.span_id;
+        }
+        else {
+            span_.context.trace_id_high = random_span_id();
+            span_.context.trace_id_low = random_span_id();
+        }
+        span_.context.span_id = random_span_id();
+        span_.start_unix_ns = unix_nanoseconds();
+        current_span() = span_.context;
+    }
+    traced_span_t(traced_span_t const&) = delete;
+    traced_span_t& operator=(traced_span_t const&) = delete;
+
+    ~traced_span_t() noexcept {
+        span_.end_unix_ns = unix_nanoseconds();
+        span_.failed = error_ && *error_;
+        spans_t::global().record(span_);
+        current_span() = previous_;
+    }
+
+    span_context_t const& context() const noexcept { return span_.context; }
+};
+
+#else
+
+class traced_span_t {
+  public:
+    traced_span_t(char const*, ustore_error_t* = nullptr) noexcept {}
+    traced_span_t(char const*, span_context_t const&, ustore_error_t* = nullptr) noexcept {}
+    traced_span_t(traced_span_t const&) = delete;
+    traced_span_t& operator=(traced_span_t const&) = delete;
+
+    span_context_t context() const noexcept { return {}; }
+};
+
+#endif
+
+inline constexpr std::string_view otlp_prefix_k = "{\"resourceSpans\":[";
+inline constexpr std::string_view otlp_suffix_k = "]}";
+
+/**
+ * @brief Formats spans as an OTLP/JSON "ExportTraceServiceRequest",
+ * ready to be posted to the "/v1/traces" endpoint of a collector.
+ * @param service   The "service.name" attribute of the exporting process.
+ */
+inline std::string spans_to_otlp_json(std::vector<finished_span_t> const& spans,
+                                      std::size_t dropped,
+                                      char const* service = "ustore") {
+    std::string out {otlp_prefix_k};
+    char entry[320];
+    std::snprintf(entry,
+                  sizeof(entry),
+                  "{\"resource\":{\"attributes\":["
+                  "{\"key\":\"service.name\",\"value\":{\"stringValue\":\"%s\"}},"
+                  "{\"key\":\"ustore.dropped_spans\",\"value\":{\"intValue\":\"%zu\"}}"
+                  "]},\"scopeSpans\":[{\"scope\":{\"name\":\"ustore\"},\"spans\":[",
+                  service,
+                  dropped);
+    out += entry;
+    for (std::size_t i = 0; i != spans.size(); ++i) {
+        finished_span_t const& span = spans[i];
+        char parent[40] = "";
+        if (span.parent_span_id)
+            std::snprintf(parent,
+                          sizeof(parent),
+                          ",\"parentSpanId\":\"%016llx\"",
+                          static_cast<unsigned long long>(span.parent_span_id));
+        std::snprintf(entry,
+                      sizeof(entry),
+                      "%s{\"traceId\":\"%016llx%016llx\",\"spanId\":\"%016llx\"%s,\"name\":\"%s\",\"kind\":1,"
+                      "\"startTimeUnixNano\":\"%llu\",\"endTimeUnixNano\":\"%llu\",\"status\":{\"code\":%d}}",
+                      i ? "," : "",
+                      static_cast<unsigned long long>(span.context.trace_id_high),
+                      static_cast<unsigned long long>(span.context.trace_id_low),
+                      static_cast<unsigned long long>(span.context.span_id),
+                      parent,
+                      span.name,
+                      static_cast<unsigned long long>(span.start_unix_ns),
+                      static_cast<unsigned long long>(span.end_unix_ns),
+                      span.failed ? 2 : 1);
+        out += entry;
+    }
+    out += "]}]}";
+    out += otlp_suffix_k;
+    return out;
+}
+
+/**
+ * @brief Appends the resources of another OTLP/JSON export, like the one received
+ * from a server, to the @p out export, so both can be posted at once.
+ * @return False, if @p other wasn't produced by `spans_to_otlp_json()`.
+ */
+inline bool merge_otlp_json(std::string& out, std::string_view other) {
+    std::size_t min_length = otlp_prefix_k.size() + otlp_suffix_k.size();
+    if (other.size() <= min_length || other.substr(0, otlp_prefix_k.size()) != otlp_prefix_k ||
+        other.substr(other.size() - otlp_suffix_k.size()) != otlp_suffix_k)
+        return false;
+    std::string_view resources = other.substr(otlp_prefix_k.size(), other.size() - min_length);
+    out.insert(out.size() - otlp_suffix_k.size(), ",");
+    out.insert(out.size() - otlp_suffix_k.size(), resources);
+    return true;
+}
+
+inline bool is_traces_request(ustore_str_view_t request) noexcept { return std::strcmp(request, "traces") == 0; }
+
+/**
+ * @brief Answers the "traces" request of `ustore_database_control()`,
+ * draining the spans finished since the previous request.
+ * @param remote    Optional OTLP/JSON export of another process to merge with.
+ */
+inline void control_traces(ustore_database_control_t& c,
+                           char const* service = "ustore",
+                           std::string_view remote = {}) noexcept {
+    return_error_if_m(USTORE_USE_TRACING,
+                      c.error,
+                      missing_feature_k,
+                      "Spans are only recorded, if compiled with USTORE_USE_TRACING");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+
+    std::string response;
+    safe_section("Formatting spans", c.error, [&] {
+        std::vector<finished_span_t> spans;
+        std::size_t dropped = spans_t::global().drain(spans);
+        response = spans_to_otlp_json(spans, dropped, service);
+        bool merged = remote.empty() || merge_otlp_json(response, remote);
+        return_error_if_m(merged, c.error, error_unknown_k, "Unexpected format of remote spans");
+    });
+    return_if_error_m(c.error);
+
+    auto response_chars = arena.alloc<char>(response.size() + 1, c.error);
+    return_if_error_m(c.error);
+    std::memcpy(response_chars.begin(), response.c_str(), response.size() + 1);
+    *c.response = response_chars.begin();
+}
+
+} // namespace unum::ustore
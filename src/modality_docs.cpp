@@ -8,7 +8,16 @@
 #include <cstdio>      // `std::snprintf`
 #include <cctype>      // `std::isdigit`
 #include <charconv>    // `std::to_chars`
+#include <climits>     // `CHAR_BIT`
+#include <cmath>       // `std::isnan`
+#include <map>         // `std::map`
+#include <memory>      // `std::shared_ptr`
+#include <numeric>     // `std::iota`
+#include <string>      // `std::string`
 #include <string_view> // `std::string_view`
+#include <thread>      // `std::thread`
+#include <tuple>       // `std::tuple`
+#include <vector>      // `std::vector`
 
 #include <fmt/format.h> // `fmt::format_int`
 
@@ -16,12 +25,16 @@
 #include <yyjson.h>            // Primary internal JSON representation
 #include <bson.h>              // Converting from/to BSON
 #include <mpack_header_only.h> // Converting from/to MsgPack
+#include <zstd.h>              // Compressing with shared dictionaries
+#include <zdict.h>             // Training shared dictionaries
 
-#include "ustore/docs.h"                //
-#include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
-#include "helpers/linked_array.hpp"  // `growing_tape_t`
-#include "helpers/algorithm.hpp"     // `transform_n`
-#include "ustore/cpp/ranges_args.hpp"   // `places_arg_t`
+#include "ustore/docs.h"                 //
+#include "helpers/linked_memory.hpp"     // `linked_memory_lock_t`
+#include "helpers/linked_array.hpp"      // `growing_tape_t`
+#include "helpers/algorithm.hpp"         // `transform_n`
+#include "helpers/metrics.hpp"           // `metered_call_t`
+#include "helpers/collections_epoch.hpp" // `epoch_cache_gt`
+#include "ustore/cpp/ranges_args.hpp"    // `places_arg_t`
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -235,6 +248,319 @@ simdjson::ondemand::object& reset(simdjson::ondemand::object& doc) noexcept {
     return doc;
 }
 
+/*********************************************************/
+/*****************	 Packed Documents	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Prefix of documents, stored as an already parsed tree of `yyjson_val` nodes.
+ * The leading zero byte can't start a JSON text, so both forms can coexist in one collection.
+ *
+ * The nodes follow in the order of the immutable `yyjson_doc`, where containers address
+ * their next siblings with relative offsets. Only strings have to be patched: instead of
+ * pointers they keep offsets in the pool of NULL-terminated strings, following the nodes.
+ * So fields can be found walking the bytes in place, and the whole tree can be relocated
+ * into memory with a copy and a single pass, without parsing a single character.
+ */
+constexpr char packed_doc_magic_k[4] = {'\0', 'u', 'j', '1'};
+constexpr std::size_t packed_doc_header_k = sizeof(packed_doc_magic_k) + sizeof(std::uint32_t);
+
+bool is_packed_doc(value_view_t bytes) noexcept {
+    return bytes.size() >= packed_doc_header_k &&
+           std::memcmp(bytes.data(), packed_doc_magic_k, sizeof(packed_doc_magic_k)) == 0;
+}
+
+bool is_packed_string(yyjson_val* node) noexcept {
+    return yyjson_is_str(node) || yyjson_is_raw(node);
+}
+
+/**
+ * @brief Potentially unaligned nodes and strings of a packed document.
+ */
+struct packed_doc_view_t {
+    byte_t const* nodes = nullptr;
+    std::size_t count = 0;
+    char const* pool = nullptr;
+    std::size_t pool_size = 0;
+
+    yyjson_val node(std::size_t idx) const noexcept {
+        yyjson_val result;
+        std::memcpy(&result, nodes + idx * sizeof(yyjson_val), sizeof(yyjson_val));
+        return result;
+    }
+
+    /** @brief Number of nodes in the subtree of `node`, including itself. */
+    std::size_t subtree(yyjson_val node) const noexcept {
+        return yyjson_is_ctn(&node) ? node.uni.ofs / sizeof(yyjson_val) : 1u;
+    }
+
+    /** @return NULL If the string is out of the pool bounds. */
+    char const* string(yyjson_val node) const noexcept {
+        std::size_t offset = node.uni.ofs;
+        std::size_t length = yyjson_get_len(&node);
+        return offset < pool_size && length < pool_size - offset ? pool + offset : nullptr;
+    }
+};
+
+/**
+ * @return false If the `bytes` aren't a packed document or are corrupted.
+ */
+bool unpack_view(value_view_t bytes, packed_doc_view_t& doc) noexcept {
+    if (!is_packed_doc(bytes))
+        return false;
+    std::uint32_t count = 0;
+    std::memcpy(&count, bytes.data() + sizeof(packed_doc_magic_k), sizeof(count));
+    std::size_t nodes_size = std::size_t(count) * sizeof(yyjson_val);
+    if (!count || bytes.size() - packed_doc_header_k < nodes_size)
+        return false;
+    doc.nodes = bytes.data() + packed_doc_header_k;
+    doc.count = count;
+    doc.pool = reinterpret_cast<char const*>(doc.nodes + nodes_size);
+    doc.pool_size = bytes.size() - packed_doc_header_k - nodes_size;
+    return doc.subtree(doc.node(0)) == count;
+}
+
+/**
+ * @brief Packs a parsed document, which must come straight from `yyjson_read_opts`,
+ * as only those keep all the nodes in one contiguous array.
+ */
+value_view_t pack_doc(yyjson_doc* doc, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+
+    yyjson_val* root = yyjson_doc_get_root(doc);
+    std::size_t count = yyjson_is_ctn(root) ? root->uni.ofs / sizeof(yyjson_val) : 1u;
+    std::size_t pool_size = 0;
+    for (std::size_t i = 0; i != count; ++i)
+        if (is_packed_string(root + i))
+            pool_size += yyjson_get_len(root + i) + 1u;
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+        log_error_m(c_error, args_wrong_k, "Document is too large to pack");
+        return {};
+    }
+
+    std::size_t nodes_size = count * sizeof(yyjson_val);
+    auto packed = arena.alloc<byte_t>(packed_doc_header_k + nodes_size + pool_size, c_error);
+    if (*c_error)
+        return {};
+    auto count_u32 = static_cast<std::uint32_t>(count);
+    std::memcpy(packed.begin(), packed_doc_magic_k, sizeof(packed_doc_magic_k));
+    std::memcpy(packed.begin() + sizeof(packed_doc_magic_k), &count_u32, sizeof(count_u32));
+
+    byte_t* nodes = packed.begin() + packed_doc_header_k;
+    char* pool = reinterpret_cast<char*>(nodes + nodes_size);
+    std::size_t pool_progress = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        yyjson_val node = root[i];
+        if (is_packed_string(&node)) {
+            std::size_t length = yyjson_get_len(&node);
+            std::memcpy(pool + pool_progress, node.uni.str, length);
+            pool[pool_progress + length] = '\0';
+            node.uni.ofs = pool_progress;
+            pool_progress += length + 1u;
+        }
+        std::memcpy(nodes + i * sizeof(yyjson_val), &node, sizeof(yyjson_val));
+    }
+    return {packed.begin(), packed.size()};
+}
+
+/**
+ * @brief Packs a JSON text, returning documents, that are already packed, untouched.
+ */
+value_view_t pack_doc(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    if (bytes.empty() || is_packed_doc(bytes))
+        return bytes;
+    yyjson_alc allocator = wrap_allocator(arena);
+    yyjson_read_flag flg = YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_INF_AND_NAN;
+    yyjson_doc* doc = yyjson_read_opts((char*)bytes.data(), (size_t)bytes.size(), flg, &allocator, NULL);
+    log_error_if_m(doc, c_error, 0, "Failed to parse document!");
+    return doc ? pack_doc(doc, arena, c_error) : value_view_t {};
+}
+
+/**
+ * @brief Compares an unescaped object key with a token of a JSON-Pointer, where "~0" means "~" and "~1" - "/".
+ */
+bool pointer_token_matches(std::string_view token, char const* key, std::size_t key_length) noexcept {
+    std::size_t key_progress = 0;
+    for (std::size_t i = 0; i != token.size(); ++i, ++key_progress) {
+        char expected = token[i];
+        if (expected == '~' && i + 1 != token.size() && (token[i + 1] == '0' || token[i + 1] == '1'))
+            expected = token[++i] == '0' ? '~' : '/';
+        if (key_progress == key_length || key[key_progress] != expected)
+            return false;
+    }
+    return key_progress == key_length;
+}
+
+/**
+ * @brief Finds the child of the `idx`-th node under the object key or the array position `token`.
+ * @return The index of the child or the number of nodes, if it's missing.
+ */
+std::size_t packed_child(packed_doc_view_t const& doc, std::size_t idx, std::string_view token, bool is_pointer) noexcept {
+
+    std::size_t const missing = doc.count;
+    yyjson_val node = doc.node(idx);
+    std::size_t children = yyjson_get_len(&node);
+    std::size_t child = idx + 1;
+    if (yyjson_is_obj(&node)) {
+        for (std::size_t i = 0; i != children && child + 1 < doc.count; ++i) {
+            yyjson_val key = doc.node(child);
+            char const* key_begin = doc.string(key);
+            if (!key_begin)
+                return missing;
+            std::size_t key_length = yyjson_get_len(&key);
+            bool matches = is_pointer ? pointer_token_matches(token, key_begin, key_length)
+                                      : token == std::string_view(key_begin, key_length);
+            if (matches)
+                return child + 1;
+            child += 1u + doc.subtree(doc.node(child + 1));
+        }
+        return missing;
+    }
+
+    if (!yyjson_is_arr(&node) || !is_pointer)
+        return missing;
+    std::size_t position = 0;
+    auto parsed = std::from_chars(token.data(), token.data() + token.size(), position);
+    if (token.empty() || parsed.ec != std::errc() || parsed.ptr != token.data() + token.size() || position >= children)
+        return missing;
+    for (std::size_t i = 0; i != position && child < doc.count; ++i)
+        child += doc.subtree(doc.node(child));
+    return child < doc.count ? child : missing;
+}
+
+/**
+ * @brief Finds the top-level key or the JSON-Pointer `field` in a packed document, walking it in place.
+ * @return The index of the found node or the number of nodes, if the field is missing.
+ */
+std::size_t packed_find(packed_doc_view_t const& doc, ustore_str_view_t field) noexcept {
+
+    if (!field)
+        return 0;
+    if (field[0] != '/')
+        return packed_child(doc, 0, field, false);
+
+    std::size_t idx = 0;
+    std::string_view path = field;
+    while (!path.empty() && idx != doc.count) {
+        std::size_t token_end = path.find('/', 1);
+        if (token_end == std::string_view::npos)
+            token_end = path.size();
+        idx = packed_child(doc, idx, path.substr(1, token_end - 1), true);
+        path.remove_prefix(token_end);
+    }
+    return idx;
+}
+
+/**
+ * @brief Copies the subtree of the `idx`-th node into the `arena`, pointing its strings into the pool.
+ * The result is valid only while the packed document is.
+ */
+yyjson_val* packed_relocate(packed_doc_view_t const& doc,
+                            std::size_t idx,
+                            linked_memory_lock_t& arena,
+                            ustore_error_t* c_error) noexcept {
+
+    std::size_t count = doc.subtree(doc.node(idx));
+    if (!count || count > doc.count - idx) {
+        log_error_m(c_error, consistency_k, "Corrupted packed document");
+        return nullptr;
+    }
+    auto nodes = arena.alloc<yyjson_val>(count, c_error);
+    if (*c_error)
+        return nullptr;
+    std::memcpy(nodes.begin(), doc.nodes + idx * sizeof(yyjson_val), count * sizeof(yyjson_val));
+    for (yyjson_val& node : nodes) {
+        if (!is_packed_string(&node))
+            continue;
+        char const* string = doc.string(node);
+        if (!string) {
+            log_error_m(c_error, consistency_k, "Corrupted packed document");
+            return nullptr;
+        }
+        node.uni.str = string;
+    }
+    return nodes.begin();
+}
+
+/**
+ * @brief Finds the `field` in a packed document, relocating only the found subtree.
+ * Scalars are copied into `scalar`, so that no memory is allocated for them.
+ * @return NULL If the `field` is missing.
+ */
+yyjson_val* packed_lookup(packed_doc_view_t const& doc,
+                          ustore_str_view_t field,
+                          yyjson_val& scalar,
+                          linked_memory_lock_t& arena,
+                          ustore_error_t* c_error) noexcept {
+
+    std::size_t idx = packed_find(doc, field);
+    if (idx == doc.count)
+        return nullptr;
+    scalar = doc.node(idx);
+    if (yyjson_is_ctn(&scalar))
+        return packed_relocate(doc, idx, arena, c_error);
+    if (is_packed_string(&scalar)) {
+        char const* string = doc.string(scalar);
+        log_error_if_m(string, c_error, consistency_k, "Corrupted packed document");
+        if (!string)
+            return nullptr;
+        scalar.uni.str = string;
+    }
+    return &scalar;
+}
+
+/**
+ * @brief Wraps the entire relocated tree into an immutable document, which doesn't own any memory.
+ */
+yyjson_doc* unpack_doc(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    packed_doc_view_t view;
+    log_error_if_m(unpack_view(bytes, view), c_error, consistency_k, "Corrupted packed document");
+    if (*c_error)
+        return nullptr;
+    yyjson_val* root = packed_relocate(view, 0, arena, c_error);
+    if (*c_error)
+        return nullptr;
+    auto doc = arena.alloc<yyjson_doc>(1, c_error);
+    if (*c_error)
+        return nullptr;
+    std::memset(doc.begin(), 0, sizeof(yyjson_doc));
+    doc[0].root = root;
+    doc[0].alc = wrap_allocator(arena);
+    doc[0].dat_read = bytes.size();
+    doc[0].val_read = view.count;
+    return doc.begin();
+}
+
+/**
+ * @brief Transcodes a packed document or its `field` into a padded NULL-terminated JSON text.
+ * @return An empty value, if the `field` is missing.
+ */
+value_view_t packed_to_json(value_view_t bytes,
+                            ustore_str_view_t field,
+                            linked_memory_lock_t& arena,
+                            ustore_error_t* c_error) noexcept {
+    packed_doc_view_t view;
+    log_error_if_m(unpack_view(bytes, view), c_error, consistency_k, "Corrupted packed document");
+    if (*c_error)
+        return {};
+    yyjson_val scalar;
+    yyjson_val* found = packed_lookup(view, field, scalar, arena, c_error);
+    if (!found)
+        return value_view_t::make_empty();
+
+    size_t json_length = 0;
+    yyjson_alc allocator = wrap_allocator(arena);
+    char* json = yyjson_val_write_opts(found, 0, &allocator, &json_length, NULL);
+    log_error_if_m(json, c_error, 0, "Failed to serialize the document!");
+    if (*c_error)
+        return {};
+    auto padded = arena.alloc<byte_t>(json_length + sj::SIMDJSON_PADDING, c_error);
+    if (*c_error)
+        return {};
+    std::memcpy(padded.begin(), json, json_length);
+    std::memset(padded.begin() + json_length, 0, sj::SIMDJSON_PADDING);
+    return {padded.begin(), json_length};
+}
+
 json_t json_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
 
     if (bytes.empty())
@@ -242,9 +568,16 @@ json_t json_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_
 
     json_t result;
     yyjson_alc allocator = wrap_allocator(arena);
-    yyjson_read_flag flg = YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_INF_AND_NAN;
-    result.handle = yyjson_read_opts((char*)bytes.data(), (size_t)bytes.size(), flg, &allocator, NULL);
-    log_error_if_m(result.handle, c_error, 0, "Failed to parse document!");
+    if (is_packed_doc(bytes)) {
+        result.handle = unpack_doc(bytes, arena, c_error);
+        if (!result.handle)
+            return result;
+    }
+    else {
+        yyjson_read_flag flg = YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_INF_AND_NAN;
+        result.handle = yyjson_read_opts((char*)bytes.data(), (size_t)bytes.size(), flg, &allocator, NULL);
+        log_error_if_m(result.handle, c_error, 0, "Failed to parse document!");
+    }
     result.mut_handle = yyjson_doc_mut_copy(result.handle, &allocator);
     return result;
 }
@@ -1037,125 +1370,2007 @@ value_view_t any_dump(json_branch_t json,
 }
 
 /*********************************************************/
-/*****************	 Primary Functions	  ****************/
+/*****************	 Compressed Documents	  ****************/
 /*********************************************************/
 
-void modify_field( //
-    yyjson_mut_doc* original_doc,
-    yyjson_mut_val* modifier,
-    ustore_str_view_t field,
-    doc_modification_t const c_modification,
-    ustore_error_t* c_error) {
+/**
+ * @brief ZStandard frames start with this magic number. The first byte is an opening
+ * parenthesis, that can't start a JSON text, and the packed documents start with zero,
+ * so compressed documents can coexist with both forms in one collection.
+ */
+constexpr char compressed_doc_magic_k[4] = {'\x28', '\xB5', '\x2F', '\xFD'};
 
-    std::string_view json_ptr(field);
-    auto last_key_pos = json_ptr.rfind('/');
-    auto last_key_or_idx = json_ptr.substr(last_key_pos + 1);
-    auto is_idx = std::all_of(last_key_or_idx.begin(), last_key_or_idx.end(), [](char c) { return std::isdigit(c); });
+/**
+ * @brief Every dictionary is stored under its ID, which the ZStandard frames reference,
+ * and the one compressing new documents is duplicated under this key.
+ */
+constexpr ustore_key_t active_dictionary_key_k = 0;
+constexpr std::size_t default_dictionary_size_k = 32 * 1024;
+constexpr int compression_level_k = 3;
 
-    yyjson_mut_val* val = json_lookupn(original_doc->root, json_ptr.data(), last_key_pos);
-    return_error_if_m(val, c_error, 0, "Invalid field!");
+bool is_compressed_doc(value_view_t bytes) noexcept {
+    return bytes.size() >= sizeof(compressed_doc_magic_k) &&
+           std::memcmp(bytes.data(), compressed_doc_magic_k, sizeof(compressed_doc_magic_k)) == 0;
+}
 
-    if (yyjson_mut_is_arr(val)) {
-        return_error_if_m(is_idx || last_key_or_idx == "-", c_error, 0, "Invalid field!");
-        size_t idx = 0;
-        std::from_chars(last_key_or_idx.begin(), last_key_or_idx.end(), idx);
-        if (c_modification == doc_modification_t::merge_k) {
-            yyjson_mut_val* mergeable = yyjson_mut_arr_get(val, idx);
-            return_error_if_m(mergeable, c_error, 0, "Invalid field!");
-            yyjson_mut_val* merge_result = yyjson_mut_merge_patch(original_doc, mergeable, modifier);
-            return_error_if_m(merge_result, c_error, 0, "Failed To Merge!");
-            return_error_if_m(yyjson_mut_arr_replace(val, idx, merge_result), c_error, 0, "Failed To Merge!");
-        }
-        else if (c_modification == doc_modification_t::insert_k) {
-            auto result = is_idx //
-                              ? yyjson_mut_arr_insert(val, modifier, idx)
-                              : yyjson_mut_arr_add_val(val, modifier);
-            return_error_if_m(result, c_error, 0, "Failed To Insert!");
-        }
-        else if (c_modification == doc_modification_t::remove_k) {
-            return_error_if_m(yyjson_mut_arr_remove(val, idx), c_error, 0, "Failed To Remove!");
-        }
-        else if (c_modification == doc_modification_t::update_k) {
-            return_error_if_m(yyjson_mut_arr_replace(val, idx, modifier), c_error, 0, "Failed To Update!");
-        }
-        else if (c_modification == doc_modification_t::upsert_k) {
-            auto result = yyjson_mut_arr_get(val, idx) //
-                              ? yyjson_mut_arr_replace(val, idx, modifier) != nullptr
-                              : yyjson_mut_arr_append(val, modifier);
-            return_error_if_m(result, c_error, 0, "Failed To Upsert!");
-        }
-        else {
-            return_error_m(c_error, "Invalid Modification Mode!");
-        }
+/**
+ * @brief Size of a compressed document once decompressed, which every frame we write carries,
+ * or zero, if the frame is corrupted.
+ */
+std::size_t decompressed_size(value_view_t frame) noexcept {
+    auto size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    return size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR ? 0u : static_cast<std::size_t>(size);
+}
+
+/**
+ * @brief ZStandard dictionary, digested once for compression or decompression.
+ */
+struct doc_dictionary_t {
+    ZSTD_CDict* compression = nullptr;
+    ZSTD_DDict* decompression = nullptr;
+
+    doc_dictionary_t() = default;
+    doc_dictionary_t(doc_dictionary_t const&) = delete;
+    doc_dictionary_t& operator=(doc_dictionary_t const&) = delete;
+    ~doc_dictionary_t() noexcept {
+        ZSTD_freeCDict(compression);
+        ZSTD_freeDDict(decompression);
     }
-    else if (yyjson_mut_is_obj(val)) {
-        if (c_modification == doc_modification_t::merge_k) {
-            yyjson_mut_val* mergeable = yyjson_mut_obj_getn(val, last_key_or_idx.data(), last_key_or_idx.size());
-            yyjson_mut_val* merge_result = yyjson_mut_merge_patch(original_doc, mergeable, modifier);
-            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-            yyjson_mut_obj_replace(val, key, merge_result);
-        }
-        else if (c_modification == doc_modification_t::insert_k) {
-            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-            return_error_if_m(yyjson_mut_obj_add(val, key, modifier), c_error, 0, "Failed To Insert!");
-        }
-        else if (c_modification == doc_modification_t::remove_k) {
-            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-            return_error_if_m(yyjson_mut_obj_remove(val, key), c_error, 0, "Failed To Remove!");
-        }
-        else if (c_modification == doc_modification_t::update_k) {
-            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-            return_error_if_m(yyjson_mut_obj_replace(val, key, modifier), c_error, 0, "Failed To Update!");
-        }
-        else if (c_modification == doc_modification_t::upsert_k) {
-            if (yyjson_mut_obj_get(val, last_key_or_idx.data())) {
-                yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-                return_error_if_m(yyjson_mut_obj_replace(val, key, modifier), c_error, 0, "Failed To Update!");
-            }
-            else {
-                yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
-                return_error_if_m(yyjson_mut_obj_add(val, key, modifier), c_error, 0, "Failed To Update!");
+};
+
+using doc_dictionary_key_t = std::tuple<ustore_database_t, ustore_collection_t, ustore_key_t>;
+static epoch_cache_gt<doc_dictionary_key_t, doc_dictionary_t> doc_dictionaries;
+
+/**
+ * @brief Shared dictionaries of compressed collections, read and digested lazily,
+ * as digesting a dictionary takes longer, than compressing a small document with it.
+ * Digests are shared between the calls, until the collections epoch changes.
+ * Replacing the active dictionary in `ustore_docs_compression_set` bumps the epoch too.
+ */
+class doc_dictionaries_t {
+    struct digested_t {
+        ustore_collection_t dictionaries = ustore_collection_main_k;
+        ustore_key_t key = active_dictionary_key_k;
+        std::shared_ptr<doc_dictionary_t const> digest;
+    };
+
+    ustore_database_t db_;
+    linked_memory_lock_t& arena_;
+    std::vector<digested_t> digested_;
+    ZSTD_CCtx* compression_ = nullptr;
+    ZSTD_DCtx* decompression_ = nullptr;
+
+    /**
+     * @brief Reads and digests the dictionary under the `key`: the active one for compression,
+     * others for decompression. Missing dictionaries are remembered with empty digests.
+     */
+    doc_dictionary_t const* digest(ustore_collection_t dictionaries,
+                                   ustore_key_t key,
+                                   ustore_error_t* c_error) noexcept {
+        for (digested_t const& digested : digested_)
+            if (digested.dictionaries == dictionaries && digested.key == key)
+                return digested.digest.get();
+
+        std::uint64_t epoch = collections_epoch();
+        doc_dictionary_key_t shared_key {db_, dictionaries, key};
+        std::shared_ptr<doc_dictionary_t const> shared = epoch ? doc_dictionaries.find(shared_key, epoch) : nullptr;
+        if (!shared) {
+            ustore_bytes_ptr_t found_values = nullptr;
+            ustore_length_t* found_offsets = nullptr;
+            ustore_length_t* found_lengths = nullptr;
+            ustore_read_t read {};
+            read.db = db_;
+            read.error = c_error;
+            read.arena = arena_;
+            read.options = ustore_option_dont_discard_memory_k;
+            read.tasks_count = 1;
+            read.collections = &dictionaries;
+            read.keys = &key;
+            read.offsets = &found_offsets;
+            read.lengths = &found_lengths;
+            read.values = &found_values;
+            ustore_read(&read);
+            if (*c_error)
+                return nullptr;
+
+            std::shared_ptr<doc_dictionary_t> digest;
+            safe_section("Digesting dictionary", c_error, [&] { digest = std::make_shared<doc_dictionary_t>(); });
+            if (*c_error)
+                return nullptr;
+            if (found_lengths[0] != ustore_length_missing_k) {
+                void const* dictionary = found_values + found_offsets[0];
+                if (key == active_dictionary_key_k)
+                    digest->compression = ZSTD_createCDict(dictionary, found_lengths[0], compression_level_k);
+                else
+                    digest->decompression = ZSTD_createDDict(dictionary, found_lengths[0]);
+                log_error_if_m(digest->compression || digest->decompression,
+                               c_error,
+                               consistency_k,
+                               "Corrupted compression dictionary");
+                if (*c_error)
+                    return nullptr;
             }
+            if (epoch)
+                doc_dictionaries.insert(shared_key, epoch, digest);
+            shared = std::move(digest);
         }
-        else {
-            return_error_m(c_error, "Invalid Modification Mode!");
-        }
+
+        safe_section("Digesting dictionary", c_error, [&] {
+            digested_.push_back({dictionaries, key, std::move(shared)});
+        });
+        return *c_error ? nullptr : digested_.back().digest.get();
     }
-}
 
-ustore_str_view_t field_concat(ustore_str_view_t field,
-                            ustore_str_view_t suffix,
-                            linked_memory_lock_t& arena,
-                            ustore_error_t* c_error) {
-    auto field_len = field ? std::strlen(field) : 0;
-    auto suffix_len = suffix ? std::strlen(suffix) : 0;
+  public:
+    doc_dictionaries_t(ustore_database_t db, linked_memory_lock_t& arena) noexcept : db_(db), arena_(arena) {}
+    doc_dictionaries_t(doc_dictionaries_t const&) = delete;
+    doc_dictionaries_t& operator=(doc_dictionaries_t const&) = delete;
 
-    if (!(field_len | suffix_len))
-        return nullptr;
-    if (!field_len)
-        return suffix;
-    if (!suffix_len)
-        return field;
+    ~doc_dictionaries_t() noexcept {
+        ZSTD_freeCCtx(compression_);
+        ZSTD_freeDCtx(decompression_);
+    }
 
-    auto result = arena.alloc<char>(field_len + suffix_len + 1, c_error).begin();
-    std::memcpy(result, field, field_len);
-    std::memcpy(result + field_len, suffix, suffix_len);
-    result[field_len + suffix_len] = '\0';
-    return result;
+    /**
+     * @brief Compresses the `doc` with the active dictionary of the `dictionaries` collection.
+     * @return The `doc` itself, if there is no active dictionary or the document doesn't shrink.
+     */
+    value_view_t compress(ustore_collection_t dictionaries, value_view_t doc, ustore_error_t* c_error) noexcept {
+        if (doc.empty())
+            return doc;
+        doc_dictionary_t const* digested = digest(dictionaries, active_dictionary_key_k, c_error);
+        if (*c_error)
+            return {};
+        if (!digested->compression)
+            return doc;
+
+        if (!compression_)
+            compression_ = ZSTD_createCCtx();
+        log_error_if_m(compression_, c_error, out_of_memory_k, "Failed to allocate a compression context");
+        if (*c_error)
+            return {};
+        std::size_t capacity = ZSTD_compressBound(doc.size());
+        auto compressed = arena_.alloc<byte_t>(capacity, c_error);
+        if (*c_error)
+            return {};
+        std::size_t length = ZSTD_compress_usingCDict( //
+            compression_,
+            compressed.begin(),
+            capacity,
+            doc.data(),
+            doc.size(),
+            digested->compression);
+        log_error_if_m(!ZSTD_isError(length), c_error, error_unknown_k, "Failed to compress a document");
+        if (*c_error)
+            return {};
+        return length < doc.size() ? value_view_t {compressed.begin(), length} : doc;
+    }
+
+    /**
+     * @brief Decompresses the `frame` into exactly `decompressed_size(frame)` bytes of the `output`,
+     * using the dictionary, that the frame references by ID.
+     */
+    void decompress(ustore_collection_t dictionaries,
+                    value_view_t frame,
+                    byte_t* output,
+                    std::size_t output_length,
+                    ustore_error_t* c_error) noexcept {
+        auto key = static_cast<ustore_key_t>(ZSTD_getDictID_fromFrame(frame.data(), frame.size()));
+        return_error_if_m(key != active_dictionary_key_k, c_error, consistency_k, "Corrupted compressed document");
+        doc_dictionary_t const* digested = digest(dictionaries, key, c_error);
+        return_if_error_m(c_error);
+        return_error_if_m(digested->decompression,
+                          c_error,
+                          consistency_k,
+                          "Missing dictionary of a compressed document");
+
+        if (!decompression_)
+            decompression_ = ZSTD_createDCtx();
+        return_error_if_m(decompression_, c_error, out_of_memory_k, "Failed to allocate a decompression context");
+        std::size_t length = ZSTD_decompress_usingDDict( //
+            decompression_,
+            output,
+            output_length,
+            frame.data(),
+            frame.size(),
+            digested->decompression);
+        return_error_if_m(length == output_length, c_error, consistency_k, "Corrupted compressed document");
+    }
+};
+
+/*********************************************************/
+/*****************	 Secondary Indexes	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Indexes are stored in hidden collections, named like the indexed ones,
+ * followed by one of these infixes and the indexed field.
+ */
+constexpr std::string_view numeric_index_infix_k = ".index.f64:";
+constexpr std::string_view string_index_infix_k = ".index.str:";
+
+/**
+ * @brief Materialized columns are stored in hidden collections with this infix,
+ * holding the value of the field of every document under the same key.
+ * @see `ustore_docs_column_create_t`.
+ */
+constexpr std::string_view column_infix_k = ".column:";
+
+/**
+ * @brief Collections storing packed documents are marked with an empty hidden collection,
+ * named like them, followed by this suffix.
+ * @see `ustore_docs_storage_set_t`.
+ */
+constexpr std::string_view packed_storage_suffix_k = ".storage:packed";
+
+/**
+ * @brief Collections storing compressed documents keep the shared dictionaries in a hidden collection,
+ * named like them, followed by this suffix.
+ * @see `ustore_docs_compression_set_t`.
+ */
+constexpr std::string_view dictionaries_suffix_k = ".storage:zstd";
+
+/**
+ * @brief Collections with field catalogs keep them in a hidden collection, named like them, followed by this suffix.
+ * @see `ustore_docs_catalog_set_t`.
+ */
+constexpr std::string_view catalog_suffix_k = ".catalog";
+
+inline std::string_view index_infix(bool numeric) noexcept {
+    return numeric ? numeric_index_infix_k : string_index_infix_k;
 }
 
-void patch( //
-    yyjson_mut_doc* original_doc,
-    yyjson_mut_val* patch_doc,
-    ustore_str_view_t field,
-    linked_memory_lock_t& arena,
-    ustore_error_t* c_error) {
+/**
+ * @brief Number of documents or index entries read at once, when building or querying an index.
+ */
+constexpr std::size_t index_batch_size_k = 1024;
 
-    return_error_if_m(yyjson_mut_is_arr(patch_doc), c_error, 0, "Invalid Patch Doc!");
-    yyjson_mut_val* obj;
-    yyjson_mut_arr_iter arr_iter;
-    yyjson_mut_arr_iter_init(patch_doc, &arr_iter);
-    while ((obj = yyjson_mut_arr_iter_next(&arr_iter))) {
+bool is_numeric_type(ustore_doc_field_type_t type) noexcept {
+    switch (type) {
+    case ustore_doc_field_i8_k:
+    case ustore_doc_field_i16_k:
+    case ustore_doc_field_i32_k:
+    case ustore_doc_field_i64_k:
+    case ustore_doc_field_u8_k:
+    case ustore_doc_field_u16_k:
+    case ustore_doc_field_u32_k:
+    case ustore_doc_field_u64_k:
+    case ustore_doc_field_f16_k:
+    case ustore_doc_field_f32_k:
+    case ustore_doc_field_f64_k: return true;
+    default: return false;
+    }
+}
+
+/**
+ * @brief Maps numbers to keys, preserving the order of 64-bit floats.
+ */
+ustore_key_t numeric_index_key(double number) noexcept {
+    constexpr std::uint64_t sign_k = std::uint64_t(1) << 63;
+    number = number == 0 ? 0.0 : number; // Merges the negative zero
+    std::uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    bits = (bits & sign_k) ? ~bits : (bits | sign_k);
+    return static_cast<ustore_key_t>(bits ^ sign_k);
+}
+
+/**
+ * @brief Maps strings to keys by their first 8 bytes, preserving the lexicographic order, but not the uniqueness.
+ */
+ustore_key_t string_index_key(std::string_view string) noexcept {
+    constexpr std::uint64_t sign_k = std::uint64_t(1) << 63;
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i != sizeof(bits); ++i)
+        bits = (bits << CHAR_BIT) | (i < string.size() ? std::uint8_t(string[i]) : 0u);
+    return static_cast<ustore_key_t>(bits ^ sign_k);
+}
+
+/**
+ * @brief Document ID in an entry of an index, with the full value of the field, if it's a string.
+ * Entries are serialized as the length of the value, its bytes and the ID, sorted by value and ID.
+ */
+struct index_entry_t {
+    std::string_view value;
+    ustore_key_t doc_key = 0;
+
+    bool operator<(index_entry_t const& other) const noexcept {
+        return value != other.value ? value < other.value : doc_key < other.doc_key;
+    }
+    bool operator==(index_entry_t const& other) const noexcept {
+        return value == other.value && doc_key == other.doc_key;
+    }
+};
+
+constexpr std::size_t index_entry_overhead_k = sizeof(ustore_length_t) + sizeof(ustore_key_t);
+
+/**
+ * @brief Passes every entry of a serialized index value to `callback`.
+ * @return false If the value is corrupted.
+ */
+template <typename callback_at>
+bool for_each_index_entry(value_view_t bytes, callback_at&& callback) noexcept {
+    char const* it = bytes.c_str();
+    char const* end = it + bytes.size();
+    while (it != end) {
+        ustore_length_t length = 0;
+        if (static_cast<std::size_t>(end - it) < index_entry_overhead_k)
+            return false;
+        std::memcpy(&length, it, sizeof(length));
+        if (static_cast<std::size_t>(end - it) < index_entry_overhead_k + length)
+            return false;
+        index_entry_t entry;
+        entry.value = {it + sizeof(length), length};
+        std::memcpy(&entry.doc_key, it + sizeof(length) + length, sizeof(entry.doc_key));
+        callback(entry);
+        it += index_entry_overhead_k + length;
+    }
+    return true;
+}
+
+char* dump_index_entry(index_entry_t const& entry, char* output) noexcept {
+    auto length = static_cast<ustore_length_t>(entry.value.size());
+    std::memcpy(output, &length, sizeof(length));
+    std::memcpy(output + sizeof(length), entry.value.data(), entry.value.size());
+    std::memcpy(output + sizeof(length) + length, &entry.doc_key, sizeof(entry.doc_key));
+    return output + index_entry_overhead_k + length;
+}
+
+struct doc_index_t {
+    /** @brief The collection of indexed documents. */
+    ustore_collection_t collection = ustore_collection_main_k;
+    /** @brief The hidden collection with index entries or column cells. */
+    ustore_collection_t index = ustore_collection_main_k;
+    /** @brief NULL-terminated field, shared with the name of the `index`. */
+    std::string_view field;
+    bool numeric = false;
+    /** @brief Marks materialized columns, which map document keys to cells, rather than values to keys. */
+    bool column = false;
+    /** @brief Marks collections of packed documents, where the `index` is just an empty marker. */
+    bool packed = false;
+    /** @brief Marks collections of compressed documents, where the `index` holds the shared dictionaries. */
+    bool dictionaries = false;
+    /** @brief Marks collections with field catalogs, where the `index` holds the counters of every path. */
+    bool catalog = false;
+
+    /** @brief Checks if it's a secondary index, mapping the values of the `field` to document keys. */
+    bool is_index() const noexcept { return !column && !packed && !dictionaries && !catalog; }
+};
+
+/**
+ * @brief Collections of a database and the indexes resolved from their names, shared between the calls.
+ */
+struct doc_catalog_t {
+    std::vector<ustore_collection_t> ids;
+    std::vector<ustore_length_t> offsets;
+    std::vector<ustore_char_t> names;
+    std::vector<doc_index_t> indexes;
+};
+
+static epoch_cache_gt<ustore_database_t, doc_catalog_t> doc_catalogs;
+
+/**
+ * @brief Lists the collections once, resolving the secondary indexes and materialized columns from their names.
+ * The results are cached per database until a collection is created or dropped, as most calls only read them.
+ */
+class doc_indexes_t {
+    linked_memory_lock_t& arena_;
+    ustore_size_t count_ = 0;
+    ustore_collection_t* ids_ = nullptr;
+    ustore_length_t* offsets_ = nullptr;
+    ustore_char_t* names_ = nullptr;
+    uninitialized_array_gt<doc_index_t> listed_;
+    ptr_range_gt<doc_index_t const> indexes_;
+    std::shared_ptr<doc_catalog_t const> cached_;
+
+    void adopt(std::shared_ptr<doc_catalog_t const> cached) noexcept {
+        cached_ = std::move(cached);
+        count_ = static_cast<ustore_size_t>(cached_->ids.size());
+        ids_ = const_cast<ustore_collection_t*>(cached_->ids.data());
+        offsets_ = const_cast<ustore_length_t*>(cached_->offsets.data());
+        names_ = const_cast<ustore_char_t*>(cached_->names.data());
+        indexes_ = {cached_->indexes.data(), cached_->indexes.data() + cached_->indexes.size()};
+    }
+
+    /**
+     * @brief Copies the listed collections into the cache, rebasing the fields onto the copied names.
+     */
+    void share(ustore_database_t db, std::uint64_t epoch) noexcept {
+        ustore_error_t error = nullptr;
+        safe_section("Caching collections", &error, [&] {
+            auto shared = std::make_shared<doc_catalog_t>();
+            std::size_t names_length = 0;
+            for (std::size_t i = 0; i != count_; ++i) {
+                std::size_t name_end = offsets_[i] + std::strlen(names_ + offsets_[i]) + 1;
+                names_length = std::max(names_length, name_end);
+            }
+            shared->ids.assign(ids_, ids_ + count_);
+            shared->offsets.assign(offsets_, offsets_ + count_);
+            shared->names.assign(names_, names_ + names_length);
+            shared->indexes.assign(listed_.begin(), listed_.end());
+            for (doc_index_t& index : shared->indexes)
+                index.field = {shared->names.data() + (index.field.data() - names_), index.field.size()};
+            doc_catalogs.insert(db, epoch, shared);
+        });
+    }
+
+  public:
+    doc_indexes_t(linked_memory_lock_t& arena) noexcept : arena_(arena), listed_(arena) {}
+
+    void list(ustore_database_t db, ustore_error_t* c_error) noexcept {
+        std::uint64_t epoch = collections_epoch();
+        if (epoch)
+            if (auto cached = doc_catalogs.find(db, epoch); cached)
+                return adopt(std::move(cached));
+
+        ustore_collection_list_t list {};
+        list.db = db;
+        list.error = c_error;
+        list.arena = arena_;
+        list.options = ustore_option_dont_discard_memory_k;
+        list.count = &count_;
+        list.ids = &ids_;
+        list.offsets = &offsets_;
+        list.names = &names_;
+        ustore_collection_list(&list);
+        return_if_error_m(c_error);
+
+        for (std::size_t i = 0; i != count_; ++i) {
+            std::string_view name = names_ + offsets_[i];
+            for (std::string_view infix :
+                 {numeric_index_infix_k,
+                  string_index_infix_k,
+                  column_infix_k,
+                  packed_storage_suffix_k,
+                  dictionaries_suffix_k,
+                  catalog_suffix_k}) {
+                auto infix_offset = name.find(infix);
+                doc_index_t index;
+                if (infix_offset == std::string_view::npos || !find(name.substr(0, infix_offset), index.collection))
+                    continue;
+                index.index = ids_[i];
+                index.field = name.substr(infix_offset + infix.size());
+                index.numeric = infix == numeric_index_infix_k;
+                index.column = infix == column_infix_k;
+                index.packed = infix == packed_storage_suffix_k;
+                index.dictionaries = infix == dictionaries_suffix_k;
+                index.catalog = infix == catalog_suffix_k;
+                if ((index.packed || index.dictionaries || index.catalog) && !index.field.empty())
+                    continue;
+                listed_.push_back(index, c_error);
+                return_if_error_m(c_error);
+                break;
+            }
+        }
+        indexes_ = {listed_.begin(), listed_.end()};
+        if (epoch)
+            share(db, epoch);
+    }
+
+    ptr_range_gt<doc_index_t const> all() const noexcept { return indexes_; }
+
+    bool indexed(ustore_collection_t collection) const noexcept {
+        return std::any_of(indexes_.begin(), indexes_.end(), [=](doc_index_t const& index) {
+            return index.collection == collection;
+        });
+    }
+
+    bool has_indexes() const noexcept {
+        return std::any_of(indexes_.begin(), indexes_.end(), [](doc_index_t const& index) {
+            return index.is_index();
+        });
+    }
+
+    bool has_catalogs() const noexcept {
+        return std::any_of(indexes_.begin(), indexes_.end(), [](doc_index_t const& index) { return index.catalog; });
+    }
+
+    bool packed(ustore_collection_t collection) const noexcept {
+        return std::any_of(indexes_.begin(), indexes_.end(), [=](doc_index_t const& index) {
+            return index.packed && index.collection == collection;
+        });
+    }
+
+    /**
+     * @return true If the documents of the `collection` are compressed, exporting the `id` of the dictionaries.
+     */
+    bool find_dictionaries(ustore_collection_t collection, ustore_collection_t& id) const noexcept {
+        for (doc_index_t const& index : indexes_)
+            if (index.dictionaries && index.collection == collection) {
+                id = index.index;
+                return true;
+            }
+        return false;
+    }
+
+    /**
+     * @return true If the `collection` has a field catalog, exporting the `id` of the catalog.
+     */
+    bool find_catalog(ustore_collection_t collection, ustore_collection_t& id) const noexcept {
+        for (doc_index_t const& index : indexes_)
+            if (index.catalog && index.collection == collection) {
+                id = index.index;
+                return true;
+            }
+        return false;
+    }
+
+    /**
+     * @return true If the `field` of the `collection` is materialized, exporting the `id` of the column.
+     */
+    bool find_column(ustore_collection_t collection, std::string_view field, ustore_collection_t& id) const noexcept {
+        for (doc_index_t const& index : indexes_)
+            if (index.column && index.collection == collection && index.field == field) {
+                id = index.index;
+                return true;
+            }
+        return false;
+    }
+
+    /**
+     * @return true If the collection with such `name` exists. The main collection is named with an empty string.
+     */
+    bool find(std::string_view name, ustore_collection_t& id) const noexcept {
+        if (name.empty()) {
+            id = ustore_collection_main_k;
+            return true;
+        }
+        for (std::size_t i = 0; i != count_; ++i)
+            if (name == std::string_view(names_ + offsets_[i])) {
+                id = ids_[i];
+                return true;
+            }
+        return false;
+    }
+
+    bool name_of(ustore_collection_t id, std::string_view& name) const noexcept {
+        if (id == ustore_collection_main_k) {
+            name = {};
+            return true;
+        }
+        auto it = std::find(ids_, ids_ + count_, id);
+        if (it == ids_ + count_)
+            return false;
+        name = names_ + offsets_[it - ids_];
+        return true;
+    }
+
+    /**
+     * @brief Builds the NULL-terminated name of the index or column on the `field` of `collection`.
+     */
+    std::string_view index_name(ustore_collection_t collection,
+                                std::string_view field,
+                                std::string_view infix,
+                                ustore_error_t* c_error) noexcept {
+        std::string_view name;
+        log_error_if_m(name_of(collection, name), c_error, args_wrong_k, "Collection not found");
+        if (*c_error)
+            return {};
+        auto joined = arena_.alloc<char>(name.size() + infix.size() + field.size() + 1u, c_error);
+        if (*c_error)
+            return {};
+        char* output = std::copy(name.begin(), name.end(), joined.begin());
+        output = std::copy(infix.begin(), infix.end(), output);
+        output = std::copy(field.begin(), field.end(), output);
+        *output = '\0';
+        return {joined.begin(), joined.size() - 1u};
+    }
+};
+
+yyjson_val* parse_indexed_doc(value_view_t bytes, linked_memory_lock_t& arena) noexcept {
+    if (bytes.empty())
+        return nullptr;
+    packed_doc_view_t packed;
+    if (unpack_view(bytes, packed)) {
+        ustore_error_t error = nullptr;
+        return packed_relocate(packed, 0, arena, &error);
+    }
+    yyjson_alc allocator = wrap_allocator(arena);
+    yyjson_read_flag flg = YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_INF_AND_NAN;
+    yyjson_doc* doc = yyjson_read_opts((char*)bytes.data(), (size_t)bytes.size(), flg, &allocator, NULL);
+    return doc ? yyjson_doc_get_root(doc) : nullptr;
+}
+
+/**
+ * @brief Same as `ustore_read()` with the `offsets` and `values` requested, but decompresses the documents
+ * of compressed collections into the `arena`, rebuilding the tape only if any of the found ones is compressed.
+ */
+void read_docs(ustore_read_t& read, linked_memory_lock_t& arena) noexcept {
+
+    ustore_error_t* c_error = read.error;
+    ustore_length_t** requested_lengths = read.lengths;
+    ustore_length_t* found_lengths = nullptr;
+    read.lengths = &found_lengths;
+    ustore_read(&read);
+    read.lengths = requested_lengths;
+    return_if_error_m(c_error);
+    if (requested_lengths)
+        *requested_lengths = found_lengths;
+
+    std::size_t const count = read.tasks_count;
+    ustore_length_t const* found_offsets = *read.offsets;
+    ustore_bytes_ptr_t found_values = *read.values;
+    auto found_doc = [&](std::size_t i) {
+        if (found_lengths[i] == ustore_length_missing_k)
+            return value_view_t {};
+        return value_view_t {found_values + found_offsets[i], found_lengths[i]};
+    };
+
+    bool has_compressed = false;
+    std::size_t total_length = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        value_view_t doc = found_doc(i);
+        if (!is_compressed_doc(doc)) {
+            total_length += doc.size();
+            continue;
+        }
+        std::size_t length = decompressed_size(doc);
+        return_error_if_m(length, c_error, consistency_k, "Corrupted compressed document");
+        total_length += length;
+        has_compressed = true;
+    }
+    if (!has_compressed)
+        return;
+
+    doc_indexes_t indexes(arena);
+    indexes.list(read.db, c_error);
+    return_if_error_m(c_error);
+    auto offsets = arena.alloc<ustore_length_t>(count + 1, c_error);
+    return_if_error_m(c_error);
+    auto lengths = arena.alloc<ustore_length_t>(count, c_error);
+    return_if_error_m(c_error);
+    auto values = arena.alloc<byte_t>(total_length + sj::SIMDJSON_PADDING, c_error);
+    return_if_error_m(c_error);
+
+    doc_dictionaries_t dictionaries(read.db, arena);
+    strided_iterator_gt<ustore_collection_t const> collections {read.collections, read.collections_stride};
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        value_view_t doc = found_doc(i);
+        offsets[i] = static_cast<ustore_length_t>(offset);
+        lengths[i] = found_lengths[i];
+        if (!is_compressed_doc(doc)) {
+            if (doc.size())
+                std::memcpy(values.begin() + offset, doc.data(), doc.size());
+            offset += doc.size();
+            continue;
+        }
+
+        ustore_collection_t collection = collections ? collections[i] : ustore_collection_main_k;
+        ustore_collection_t dictionaries_id = ustore_collection_main_k;
+        return_error_if_m(indexes.find_dictionaries(collection, dictionaries_id),
+                          c_error,
+                          consistency_k,
+                          "Missing dictionaries of compressed documents");
+        std::size_t length = decompressed_size(doc);
+        dictionaries.decompress(dictionaries_id, doc, values.begin() + offset, length, c_error);
+        return_if_error_m(c_error);
+        lengths[i] = static_cast<ustore_length_t>(length);
+        offset += length;
+    }
+    offsets[count] = static_cast<ustore_length_t>(offset);
+    std::memset(values.begin() + offset, 0, sj::SIMDJSON_PADDING);
+
+    *read.offsets = offsets.begin();
+    *read.values = reinterpret_cast<ustore_bytes_ptr_t>(values.begin());
+    if (requested_lengths)
+        *requested_lengths = lengths.begin();
+}
+
+/**
+ * @brief Extracts the indexed value of the field from a parsed document.
+ * @return false If the document misses the field or holds a value of a different type.
+ */
+bool indexed_value(yyjson_val* doc, doc_index_t const& index, ustore_key_t& index_key, std::string_view& value) noexcept {
+    yyjson_val* field = doc ? json_lookup(doc, index.field.data()) : nullptr;
+    if (!field)
+        return false;
+
+    if (index.numeric) {
+        double number = 0;
+        if (yyjson_is_real(field))
+            number = yyjson_get_real(field);
+        else if (yyjson_is_uint(field))
+            number = static_cast<double>(yyjson_get_uint(field));
+        else if (yyjson_is_sint(field))
+            number = static_cast<double>(yyjson_get_sint(field));
+        else
+            return false;
+        if (std::isnan(number))
+            return false;
+        index_key = numeric_index_key(number);
+        value = {};
+        return true;
+    }
+
+    if (!yyjson_is_str(field))
+        return false;
+    value = {yyjson_get_str(field), yyjson_get_len(field)};
+    index_key = string_index_key(value);
+    return true;
+}
+
+/**
+ * @brief Cells of materialized columns start with a byte of the JSON type and subtype,
+ * followed by the 8 bytes of a number or the contents of a string.
+ */
+std::size_t column_cell_size(yyjson_val* value) noexcept {
+    switch (yyjson_get_type(value)) {
+    case YYJSON_TYPE_NUM: return 1u + sizeof(std::uint64_t);
+    case YYJSON_TYPE_STR: return 1u + yyjson_get_len(value);
+    default: return 1u;
+    }
+}
+
+char* dump_column_cell(yyjson_val* value, char* output) noexcept {
+    yyjson_type const type = yyjson_get_type(value);
+    *output++ = static_cast<char>(type | yyjson_get_subtype(value));
+    if (type == YYJSON_TYPE_NUM) {
+        std::memcpy(output, &value->uni.u64, sizeof(std::uint64_t));
+        return output + sizeof(std::uint64_t);
+    }
+    if (type == YYJSON_TYPE_STR) {
+        std::memcpy(output, yyjson_get_str(value), yyjson_get_len(value));
+        return output + yyjson_get_len(value);
+    }
+    return output;
+}
+
+/**
+ * @brief Reconstructs the cached value of a field without parsing the document.
+ * Containers are restored without their contents, as they are only reported as collisions.
+ * @return NULL If the cell is missing or empty, just like the document it mirrors.
+ */
+yyjson_val* load_column_cell(value_view_t cell, yyjson_val& value) noexcept {
+    if (cell.empty())
+        return nullptr;
+    char const* payload = cell.c_str() + 1;
+    std::size_t payload_length = cell.size() - 1u;
+    value.tag = static_cast<std::uint8_t>(cell.c_str()[0]);
+    value.uni.u64 = 0;
+    switch (value.tag & YYJSON_TYPE_MASK) {
+    case YYJSON_TYPE_NUM:
+        if (payload_length != sizeof(std::uint64_t))
+            return nullptr;
+        std::memcpy(&value.uni.u64, payload, sizeof(std::uint64_t));
+        break;
+    case YYJSON_TYPE_STR:
+        value.tag |= static_cast<std::uint64_t>(payload_length) << YYJSON_TAG_BIT;
+        value.uni.str = payload;
+        break;
+    default: break;
+    }
+    return &value;
+}
+
+struct index_update_t {
+    ustore_collection_t index = ustore_collection_main_k;
+    ustore_key_t index_key = 0;
+    index_entry_t entry;
+    bool insert = false;
+};
+
+/**
+ * @brief Compares the indexed fields of old and new versions of documents,
+ * appending the needed changes of index entries to `updates`.
+ * @param old_doc Callback returning the stored version of the `i`-th document.
+ * @param new_doc Callback returning the written version of the `i`-th document.
+ */
+template <typename old_doc_at, typename new_doc_at>
+void collect_index_updates(ptr_range_gt<doc_index_t const> indexes,
+                           ptr_range_gt<collection_key_t const> places,
+                           old_doc_at&& old_doc,
+                           new_doc_at&& new_doc,
+                           uninitialized_array_gt<index_update_t>& updates,
+                           linked_memory_lock_t& arena,
+                           ustore_error_t* c_error) noexcept {
+
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        collection_key_t const& place = places[i];
+        bool indexed = std::any_of(indexes.begin(), indexes.end(), [&](doc_index_t const& index) {
+            return index.collection == place.collection && index.is_index();
+        });
+        if (!indexed)
+            continue;
+
+        yyjson_val* old_root = parse_indexed_doc(old_doc(i), arena);
+        yyjson_val* new_root = parse_indexed_doc(new_doc(i), arena);
+        for (doc_index_t const& index : indexes) {
+            if (index.collection != place.collection || !index.is_index())
+                continue;
+
+            index_update_t old_update, new_update;
+            bool had_value = indexed_value(old_root, index, old_update.index_key, old_update.entry.value);
+            bool has_value = indexed_value(new_root, index, new_update.index_key, new_update.entry.value);
+            if (had_value && has_value && old_update.index_key == new_update.index_key &&
+                old_update.entry.value == new_update.entry.value)
+                continue;
+
+            if (had_value) {
+                old_update.index = index.index;
+                old_update.entry.doc_key = place.key;
+                old_update.insert = false;
+                updates.push_back(old_update, c_error);
+                return_if_error_m(c_error);
+            }
+            if (has_value) {
+                new_update.index = index.index;
+                new_update.entry.doc_key = place.key;
+                new_update.insert = true;
+                updates.push_back(new_update, c_error);
+                return_if_error_m(c_error);
+            }
+        }
+    }
+}
+
+struct write_task_t {
+    ustore_collection_t collection = ustore_collection_main_k;
+    ustore_key_t key = 0;
+    ustore_bytes_cptr_t value = nullptr;
+    ustore_length_t length = 0;
+};
+
+/**
+ * @brief Reads the index entries touched by `updates`, applies the updates,
+ * and appends the new contents of those entries to the `tasks` of the upcoming write.
+ */
+void apply_index_updates(ustore_database_t const c_db,
+                         ustore_transaction_t const c_txn,
+                         ustore_options_t const c_options,
+                         ptr_range_gt<index_update_t> updates,
+                         uninitialized_array_gt<write_task_t>& tasks,
+                         linked_memory_lock_t& arena,
+                         ustore_error_t* c_error) noexcept {
+
+    if (updates.empty())
+        return;
+
+    auto same_entry = [](index_update_t const& a, index_update_t const& b) noexcept {
+        return a.index == b.index && a.index_key == b.index_key;
+    };
+    std::sort(updates.begin(), updates.end(), [](index_update_t const& a, index_update_t const& b) noexcept {
+        if (a.index != b.index)
+            return a.index < b.index;
+        if (a.index_key != b.index_key)
+            return a.index_key < b.index_key;
+        return a.entry < b.entry;
+    });
+
+    // Read the current state of every touched entry
+    std::size_t first_task = tasks.size();
+    for (std::size_t i = 0; i != updates.size(); ++i) {
+        if (i && same_entry(updates[i - 1], updates[i]))
+            continue;
+        write_task_t task;
+        task.collection = updates[i].index;
+        task.key = updates[i].index_key;
+        tasks.push_back(task, c_error);
+        return_if_error_m(c_error);
+    }
+    std::size_t entries_count = tasks.size() - first_task;
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_txn;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = entries_count;
+    read.collections = &tasks[first_task].collection;
+    read.collections_stride = sizeof(write_task_t);
+    read.keys = &tasks[first_task].key;
+    read.keys_stride = sizeof(write_task_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    // Merge the old entries with the inserted ones, skipping the removed ones
+    uninitialized_array_gt<index_entry_t> merged(arena);
+    index_update_t const* updates_it = updates.begin();
+    for (std::size_t i = 0; i != entries_count; ++i) {
+        index_update_t const* updates_end = updates_it;
+        while (updates_end != updates.end() && same_entry(*updates_it, *updates_end))
+            ++updates_end;
+
+        merged.resize(0, c_error);
+        return_if_error_m(c_error);
+        bool valid = true;
+        if (found_lengths[i] != ustore_length_missing_k)
+            valid = for_each_index_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                                         [&](index_entry_t const& entry) { merged.push_back(entry, c_error); });
+        return_error_if_m(valid, c_error, consistency_k, "Corrupted index entry");
+        return_if_error_m(c_error);
+        for (auto it = updates_it; it != updates_end; ++it)
+            if (it->insert)
+                merged.push_back(it->entry, c_error);
+        return_if_error_m(c_error);
+
+        std::sort(merged.begin(), merged.end());
+        auto merged_end = std::unique(merged.begin(), merged.end());
+        merged_end = std::remove_if(merged.begin(), merged_end, [=](index_entry_t const& entry) {
+            return std::any_of(updates_it, updates_end, [&](index_update_t const& update) {
+                return !update.insert && update.entry == entry;
+            });
+        });
+
+        std::size_t size = 0;
+        for (auto it = merged.begin(); it != merged_end; ++it)
+            size += index_entry_overhead_k + it->value.size();
+        write_task_t& task = tasks[first_task + i];
+        if (size) {
+            auto dumped = arena.alloc<char>(size, c_error);
+            return_if_error_m(c_error);
+            char* output = dumped.begin();
+            for (auto it = merged.begin(); it != merged_end; ++it)
+                output = dump_index_entry(*it, output);
+            task.value = reinterpret_cast<ustore_bytes_cptr_t>(dumped.begin());
+            task.length = static_cast<ustore_length_t>(size);
+        }
+        updates_it = updates_end;
+    }
+}
+
+/**
+ * @brief Appends the writes of cells of materialized columns to `tasks`,
+ * mirroring the new versions of documents, including their removals.
+ */
+template <typename new_doc_at>
+void collect_column_cells(ptr_range_gt<doc_index_t const> columns,
+                          ptr_range_gt<collection_key_t const> places,
+                          new_doc_at&& new_doc,
+                          uninitialized_array_gt<write_task_t>& tasks,
+                          linked_memory_lock_t& arena,
+                          ustore_error_t* c_error) noexcept {
+
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        collection_key_t const& place = places[i];
+        bool materialized = std::any_of(columns.begin(), columns.end(), [&](doc_index_t const& column) {
+            return column.collection == place.collection && column.column;
+        });
+        if (!materialized)
+            continue;
+
+        value_view_t doc = new_doc(i);
+        yyjson_val* root = parse_indexed_doc(doc, arena);
+        for (doc_index_t const& column : columns) {
+            if (column.collection != place.collection || !column.column)
+                continue;
+
+            write_task_t task;
+            task.collection = column.index;
+            task.key = place.key;
+            if (root) {
+                yyjson_val* value = json_lookup(root, column.field.data());
+                auto cell = arena.alloc<char>(column_cell_size(value), c_error);
+                return_if_error_m(c_error);
+                dump_column_cell(value, cell.begin());
+                task.value = reinterpret_cast<ustore_bytes_cptr_t>(cell.begin());
+                task.length = static_cast<ustore_length_t>(cell.size());
+            }
+            else if (doc)
+                // Documents, that can't be parsed, get empty cells, removed documents - lose them
+                task.value = reinterpret_cast<ustore_bytes_cptr_t>(doc.data());
+            tasks.push_back(task, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+}
+
+/**
+ * @brief Kinds of scalar values, counted separately in field catalogs.
+ */
+enum catalog_kind_t : std::uint8_t {
+    catalog_null_k = 0,
+    catalog_bool_k,
+    catalog_uint_k,
+    catalog_sint_k,
+    catalog_real_k,
+    catalog_str_k,
+    catalog_kinds_k,
+};
+
+catalog_kind_t catalog_kind(yyjson_val* value) noexcept {
+    switch (yyjson_get_type(value)) {
+    case YYJSON_TYPE_NULL: return catalog_null_k;
+    case YYJSON_TYPE_BOOL: return catalog_bool_k;
+    case YYJSON_TYPE_NUM:
+        return yyjson_is_uint(value) ? catalog_uint_k : yyjson_is_sint(value) ? catalog_sint_k : catalog_real_k;
+    default: return catalog_str_k;
+    }
+}
+
+/**
+ * @brief Numbers of documents, holding every kind of scalar value under the `path`.
+ * Every value in a catalog collection holds the entries of all the paths with the same `catalog_key()`.
+ */
+struct catalog_entry_t {
+    std::string_view path;
+    std::uint64_t counts[catalog_kinds_k] = {};
+
+    std::uint64_t total() const noexcept { return std::accumulate(counts, counts + catalog_kinds_k, std::uint64_t(0)); }
+};
+
+constexpr std::size_t catalog_entry_overhead_k = sizeof(ustore_length_t) + sizeof(std::uint64_t) * catalog_kinds_k;
+
+/**
+ * @brief Hashes the path with FNV-1a, clearing the sign bit to never collide with `ustore_key_unknown_k`.
+ */
+ustore_key_t catalog_key(std::string_view path) noexcept {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : path)
+        hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+    return static_cast<ustore_key_t>(hash >> 1);
+}
+
+/**
+ * @brief Picks the narrowest column type, that fits all the values, counted in a catalog `entry`.
+ */
+ustore_doc_field_type_t catalog_type(catalog_entry_t const& entry) noexcept {
+    if (entry.counts[catalog_str_k])
+        return ustore_doc_field_str_k;
+    if (entry.counts[catalog_real_k])
+        return ustore_doc_field_f64_k;
+    if (entry.counts[catalog_sint_k])
+        return ustore_doc_field_i64_k;
+    if (entry.counts[catalog_uint_k])
+        return ustore_doc_field_u64_k;
+    if (entry.counts[catalog_bool_k])
+        return ustore_doc_field_bool_k;
+    if (entry.counts[catalog_null_k])
+        return ustore_doc_field_null_k;
+    return ustore_doc_field_str_k;
+}
+
+/**
+ * @brief Passes every entry of a serialized catalog value to `callback`.
+ * @return false If the value is corrupted.
+ */
+template <typename callback_at>
+bool for_each_catalog_entry(value_view_t bytes, callback_at&& callback) noexcept {
+    char const* it = bytes.c_str();
+    char const* end = it + bytes.size();
+    while (it != end) {
+        ustore_length_t length = 0;
+        if (static_cast<std::size_t>(end - it) < catalog_entry_overhead_k)
+            return false;
+        std::memcpy(&length, it, sizeof(length));
+        if (static_cast<std::size_t>(end - it) < catalog_entry_overhead_k + length)
+            return false;
+        catalog_entry_t entry;
+        entry.path = {it + sizeof(length), length};
+        std::memcpy(entry.counts, it + sizeof(length) + length, sizeof(entry.counts));
+        callback(entry);
+        it += catalog_entry_overhead_k + length;
+    }
+    return true;
+}
+
+char* dump_catalog_entry(catalog_entry_t const& entry, char* output) noexcept {
+    auto length = static_cast<ustore_length_t>(entry.path.size());
+    std::memcpy(output, &length, sizeof(length));
+    std::memcpy(output + sizeof(length), entry.path.data(), entry.path.size());
+    std::memcpy(output + sizeof(length) + length, entry.counts, sizeof(entry.counts));
+    return output + catalog_entry_overhead_k + length;
+}
+
+/**
+ * @brief Passes every scalar of the document to `callback(path, value)`,
+ * naming the paths the same way as `ustore_docs_gist()` does.
+ */
+template <typename callback_at>
+void for_each_scalar(yyjson_val* node,
+                     field_path_buffer_t& path,
+                     std::size_t path_len,
+                     callback_at&& callback,
+                     ustore_error_t* c_error) noexcept {
+
+    auto constexpr slash_len = 1;
+    auto constexpr terminator_len = 1;
+
+    if (yyjson_is_obj(node)) {
+        yyjson_val* key;
+        yyjson_obj_iter iter;
+        yyjson_obj_iter_init(node, &iter);
+        while ((key = yyjson_obj_iter_next(&iter)) && !*c_error) {
+            std::size_t key_len = yyjson_get_len(key);
+            return_error_if_m(path_len + slash_len + key_len + terminator_len < field_path_len_limit_k,
+                              c_error,
+                              args_wrong_k,
+                              "Path is too long!");
+            path[path_len] = '/';
+            std::memcpy(path + path_len + slash_len, yyjson_get_str(key), key_len);
+            for_each_scalar(yyjson_obj_iter_get_val(key), path, path_len + slash_len + key_len, callback, c_error);
+        }
+    }
+    else if (yyjson_is_arr(node)) {
+        std::size_t idx = 0;
+        yyjson_val* val;
+        yyjson_arr_iter iter;
+        yyjson_arr_iter_init(node, &iter);
+        while ((val = yyjson_arr_iter_next(&iter)) && !*c_error) {
+            path[path_len] = '/';
+            auto printed = print_number(path + path_len + slash_len, path + field_path_len_limit_k, idx);
+            return_error_if_m(!printed.empty(), c_error, args_wrong_k, "Path is too long!");
+            for_each_scalar(val, path, path_len + slash_len + printed.size(), callback, c_error);
+            ++idx;
+        }
+    }
+    else
+        callback(std::string_view(path, path_len), node);
+}
+
+struct catalog_update_t {
+    ustore_collection_t catalog = ustore_collection_main_k;
+    ustore_key_t key = 0;
+    std::string_view path;
+    catalog_kind_t kind = catalog_null_k;
+    std::int64_t delta = 0;
+};
+
+/**
+ * @brief Uncounts the scalars of old versions of documents and counts the scalars of the new ones,
+ * appending the changes of counters to `updates`.
+ * @param old_doc Callback returning the stored version of the `i`-th document.
+ * @param new_doc Callback returning the written version of the `i`-th document.
+ */
+template <typename old_doc_at, typename new_doc_at>
+void collect_catalog_updates(ptr_range_gt<doc_index_t const> catalogs,
+                             ptr_range_gt<collection_key_t const> places,
+                             old_doc_at&& old_doc,
+                             new_doc_at&& new_doc,
+                             uninitialized_array_gt<catalog_update_t>& updates,
+                             linked_memory_lock_t& arena,
+                             ustore_error_t* c_error) noexcept {
+
+    field_path_buffer_t path = {0};
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        collection_key_t const& place = places[i];
+        auto catalog = std::find_if(catalogs.begin(), catalogs.end(), [&](doc_index_t const& index) {
+            return index.catalog && index.collection == place.collection;
+        });
+        if (catalog == catalogs.end())
+            continue;
+        value_view_t old_bytes = old_doc(i);
+        value_view_t new_bytes = new_doc(i);
+        if (old_bytes == new_bytes)
+            continue;
+
+        for (std::int64_t delta : {-1, 1}) {
+            yyjson_val* root = parse_indexed_doc(delta < 0 ? old_bytes : new_bytes, arena);
+            if (!root)
+                continue;
+            auto count_scalar = [&](std::string_view field, yyjson_val* value) noexcept {
+                auto copy = arena.alloc<char>(field.size(), c_error);
+                return_if_error_m(c_error);
+                std::memcpy(copy.begin(), field.data(), field.size());
+                catalog_update_t update;
+                update.catalog = catalog->index;
+                update.key = catalog_key(field);
+                update.path = {copy.begin(), field.size()};
+                update.kind = catalog_kind(value);
+                update.delta = delta;
+                updates.push_back(update, c_error);
+            };
+            for_each_scalar(root, path, 0, count_scalar, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+}
+
+/**
+ * @brief Reads the catalog values touched by `updates`, adds up the counters,
+ * and appends the new contents of those values to the `tasks` of the upcoming write.
+ */
+void apply_catalog_updates(ustore_database_t const c_db,
+                           ustore_transaction_t const c_txn,
+                           ustore_options_t const c_options,
+                           ptr_range_gt<catalog_update_t> updates,
+                           uninitialized_array_gt<write_task_t>& tasks,
+                           linked_memory_lock_t& arena,
+                           ustore_error_t* c_error) noexcept {
+
+    auto same_value = [](catalog_update_t const& a, catalog_update_t const& b) noexcept {
+        return a.catalog == b.catalog && a.key == b.key;
+    };
+    auto same_counter = [=](catalog_update_t const& a, catalog_update_t const& b) noexcept {
+        return same_value(a, b) && a.path == b.path && a.kind == b.kind;
+    };
+    std::sort(updates.begin(), updates.end(), [](catalog_update_t const& a, catalog_update_t const& b) noexcept {
+        if (a.catalog != b.catalog)
+            return a.catalog < b.catalog;
+        if (a.key != b.key)
+            return a.key < b.key;
+        if (a.path != b.path)
+            return a.path < b.path;
+        return a.kind < b.kind;
+    });
+
+    // Sum the deltas of every counter, so that the paths present in both versions of documents aren't rewritten
+    catalog_update_t* updates_end = updates.begin();
+    for (catalog_update_t const& update : updates) {
+        if (updates_end != updates.begin() && same_counter(updates_end[-1], update))
+            updates_end[-1].delta += update.delta;
+        else
+            *updates_end++ = update;
+    }
+    updates_end = std::remove_if(updates.begin(), updates_end, [](catalog_update_t const& update) noexcept {
+        return !update.delta;
+    });
+    if (updates_end == updates.begin())
+        return;
+
+    // Read the current state of every touched value
+    std::size_t first_task = tasks.size();
+    for (auto it = updates.begin(); it != updates_end; ++it) {
+        if (it != updates.begin() && same_value(it[-1], *it))
+            continue;
+        write_task_t task;
+        task.collection = it->catalog;
+        task.key = it->key;
+        tasks.push_back(task, c_error);
+        return_if_error_m(c_error);
+    }
+    std::size_t values_count = tasks.size() - first_task;
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_txn;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = values_count;
+    read.collections = &tasks[first_task].collection;
+    read.collections_stride = sizeof(write_task_t);
+    read.keys = &tasks[first_task].key;
+    read.keys_stride = sizeof(write_task_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    uninitialized_array_gt<catalog_entry_t> merged(arena);
+    catalog_update_t const* value_begin = updates.begin();
+    for (std::size_t i = 0; i != values_count; ++i) {
+        catalog_update_t const* value_end = value_begin;
+        while (value_end != updates_end && same_value(*value_begin, *value_end))
+            ++value_end;
+
+        merged.resize(0, c_error);
+        return_if_error_m(c_error);
+        bool valid = true;
+        if (found_lengths[i] != ustore_length_missing_k)
+            valid = for_each_catalog_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                                           [&](catalog_entry_t const& entry) { merged.push_back(entry, c_error); });
+        return_error_if_m(valid, c_error, consistency_k, "Corrupted field catalog");
+        return_if_error_m(c_error);
+
+        for (auto it = value_begin; it != value_end; ++it) {
+            auto entry = std::find_if(merged.begin(), merged.end(), [&](catalog_entry_t const& entry) {
+                return entry.path == it->path;
+            });
+            if (entry == merged.end()) {
+                catalog_entry_t added;
+                added.path = it->path;
+                merged.push_back(added, c_error);
+                return_if_error_m(c_error);
+                entry = merged.end() - 1;
+            }
+            // Counters may only go below zero, if the documents were written while the catalog was being filled
+            auto count = static_cast<std::int64_t>(entry->counts[it->kind]) + it->delta;
+            entry->counts[it->kind] = static_cast<std::uint64_t>(std::max<std::int64_t>(count, 0));
+        }
+        auto merged_end = std::remove_if(merged.begin(), merged.end(), [](catalog_entry_t const& entry) noexcept {
+            return !entry.total();
+        });
+
+        std::size_t size = 0;
+        for (auto it = merged.begin(); it != merged_end; ++it)
+            size += catalog_entry_overhead_k + it->path.size();
+        write_task_t& task = tasks[first_task + i];
+        if (size) {
+            auto dumped = arena.alloc<char>(size, c_error);
+            return_if_error_m(c_error);
+            char* output = dumped.begin();
+            for (auto it = merged.begin(); it != merged_end; ++it)
+                output = dump_catalog_entry(*it, output);
+            task.value = reinterpret_cast<ustore_bytes_cptr_t>(dumped.begin());
+            task.length = static_cast<ustore_length_t>(size);
+        }
+        value_begin = value_end;
+    }
+}
+
+/**
+ * @brief Scans the entire `catalog` in batches, passing every entry to `callback`.
+ * The entries stay valid until the `arena` is reset.
+ */
+template <typename callback_at>
+void for_each_cataloged_field(ustore_database_t const c_db,
+                              ustore_transaction_t const c_txn,
+                              ustore_snapshot_t const c_snapshot,
+                              ustore_collection_t const catalog,
+                              ustore_options_t const c_options,
+                              linked_memory_lock_t& arena,
+                              ustore_error_t* c_error,
+                              callback_at&& callback) noexcept {
+
+    auto options = ustore_options_t(c_options | ustore_option_dont_discard_memory_k);
+    for (ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();;) {
+        ustore_length_t count_limit = static_cast<ustore_length_t>(index_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c_db;
+        scan.error = c_error;
+        scan.transaction = c_txn;
+        scan.snapshot = c_snapshot;
+        scan.arena = arena;
+        scan.options = options;
+        scan.tasks_count = 1;
+        scan.collections = &catalog;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c_error);
+        std::size_t found_count = found_counts[0];
+        if (!found_count)
+            break;
+
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.transaction = c_txn;
+        read.snapshot = c_snapshot;
+        read.arena = arena;
+        read.options = options;
+        read.tasks_count = found_count;
+        read.collections = &catalog;
+        read.keys = found_keys;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        ustore_read(&read);
+        return_if_error_m(c_error);
+
+        for (std::size_t i = 0; i != found_count; ++i) {
+            if (found_lengths[i] == ustore_length_missing_k)
+                continue;
+            bool valid = for_each_catalog_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                                                callback);
+            return_error_if_m(valid, c_error, consistency_k, "Corrupted field catalog");
+            return_if_error_m(c_error);
+        }
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != index_batch_size_k || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
+    }
+}
+
+void write_tasks(ustore_database_t const c_db,
+                 ustore_transaction_t const c_txn,
+                 ustore_options_t const c_options,
+                 ptr_range_gt<write_task_t const> tasks,
+                 linked_memory_lock_t& arena,
+                 ustore_error_t* c_error) noexcept {
+    if (tasks.empty())
+        return;
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_txn;
+    write.arena = arena;
+    write.options = c_options;
+    write.tasks_count = tasks.size();
+    write.collections = &tasks[0].collection;
+    write.collections_stride = sizeof(write_task_t);
+    write.keys = &tasks[0].key;
+    write.keys_stride = sizeof(write_task_t);
+    write.lengths = &tasks[0].length;
+    write.lengths_stride = sizeof(write_task_t);
+    write.values = &tasks[0].value;
+    write.values_stride = sizeof(write_task_t);
+    ustore_write(&write);
+}
+
+/**
+ * @brief Number of times the private transaction of `write_indexed_docs()` is retried,
+ * if the counters of field catalogs were changed by other writers.
+ */
+constexpr std::size_t catalog_commit_attempts_k = 16;
+
+/**
+ * @brief Writes the documents together with the updated entries of secondary indexes, counters of field catalogs
+ * and cells of materialized columns in a single batch, expecting some of the collections to be in `indexes`.
+ */
+void write_listed_indexed_docs(ustore_database_t const c_db,
+                               ustore_transaction_t const c_txn,
+                               doc_indexes_t const& indexes,
+                               places_arg_t const& places,
+                               contents_arg_t const& contents,
+                               ustore_options_t const c_options,
+                               linked_memory_lock_t& arena,
+                               ustore_error_t* c_error) noexcept {
+
+    // Only the last write of every document defines its indexed values
+    auto latest = arena.alloc<collection_key_t>(places.size(), c_error);
+    return_if_error_m(c_error);
+    auto latest_tasks = arena.alloc<std::size_t>(places.size(), c_error);
+    return_if_error_m(c_error);
+    std::iota(latest_tasks.begin(), latest_tasks.end(), 0u);
+    std::stable_sort(latest_tasks.begin(), latest_tasks.end(), [&](std::size_t a, std::size_t b) {
+        return places[a].collection_key() < places[b].collection_key();
+    });
+    std::size_t latest_count = 0;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        bool is_last = i + 1 == places.size() ||
+                       places[latest_tasks[i]].collection_key() != places[latest_tasks[i + 1]].collection_key();
+        if (!is_last)
+            continue;
+        latest_tasks[latest_count] = latest_tasks[i];
+        latest[latest_count] = places[latest_tasks[i]].collection_key();
+        ++latest_count;
+    }
+
+    // Only secondary indexes and field catalogs need the previous versions of documents
+    auto read_options = ustore_options_t(c_options & ~ustore_option_write_bulk_k);
+    if (c_txn)
+        read_options = ustore_options_t(read_options & ~ustore_option_transaction_dont_watch_k);
+    uninitialized_array_gt<index_update_t> updates(arena);
+    uninitialized_array_gt<catalog_update_t> catalog_updates(arena);
+    if (indexes.has_indexes() || indexes.has_catalogs()) {
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.transaction = c_txn;
+        read.arena = arena;
+        read.options = read_options;
+        read.tasks_count = latest_count;
+        read.collections = &latest[0].collection;
+        read.collections_stride = sizeof(collection_key_t);
+        read.keys = &latest[0].key;
+        read.keys_stride = sizeof(collection_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        read_docs(read, arena);
+        return_if_error_m(c_error);
+
+        auto old_doc = [&](std::size_t i) { return value_view_t {found_values + found_offsets[i], found_lengths[i]}; };
+        auto new_doc = [&](std::size_t i) { return contents[latest_tasks[i]]; };
+        ptr_range_gt<collection_key_t const> latest_places {latest.begin(), latest.begin() + latest_count};
+        collect_index_updates(indexes.all(), latest_places, old_doc, new_doc, updates, arena, c_error);
+        return_if_error_m(c_error);
+        collect_catalog_updates(indexes.all(), latest_places, old_doc, new_doc, catalog_updates, arena, c_error);
+        return_if_error_m(c_error);
+    }
+
+    uninitialized_array_gt<write_task_t> tasks(arena);
+    tasks.reserve(places.size() + updates.size(), c_error);
+    return_if_error_m(c_error);
+    doc_dictionaries_t dictionaries(c_db, arena);
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        value_view_t doc = contents[i];
+        if (doc && indexes.packed(places[i].collection)) {
+            doc = pack_doc(doc, arena, c_error);
+            return_if_error_m(c_error);
+        }
+        ustore_collection_t dictionaries_id = ustore_collection_main_k;
+        if (doc && indexes.find_dictionaries(places[i].collection, dictionaries_id)) {
+            doc = dictionaries.compress(dictionaries_id, doc, c_error);
+            return_if_error_m(c_error);
+        }
+        write_task_t task;
+        task.collection = places[i].collection;
+        task.key = places[i].key;
+        task.value = doc ? reinterpret_cast<ustore_bytes_cptr_t>(doc.data()) : nullptr;
+        task.length = doc ? static_cast<ustore_length_t>(doc.size()) : 0;
+        tasks.push_back(task, c_error);
+    }
+    apply_index_updates(c_db, c_txn, read_options, {updates.begin(), updates.end()}, tasks, arena, c_error);
+    return_if_error_m(c_error);
+    apply_catalog_updates(c_db,
+                          c_txn,
+                          read_options,
+                          {catalog_updates.begin(), catalog_updates.end()},
+                          tasks,
+                          arena,
+                          c_error);
+    return_if_error_m(c_error);
+    collect_column_cells(
+        indexes.all(),
+        {latest.begin(), latest.begin() + latest_count},
+        [&](std::size_t i) { return contents[latest_tasks[i]]; },
+        tasks,
+        arena,
+        c_error);
+    return_if_error_m(c_error);
+
+    write_tasks(c_db, c_txn, c_options, {tasks.begin(), tasks.end()}, arena, c_error);
+}
+
+/**
+ * @brief Writes the documents together with the updated entries of secondary indexes, counters of field catalogs
+ * and cells of materialized columns in a single batch, so that all are updated atomically.
+ * Documents of collections with packed storage are packed and those with dictionaries are compressed on the way.
+ *
+ * Counters of field catalogs are read, updated and written back. Outside of user transactions,
+ * that happens in a private one, watching the counters and retried if they change meanwhile,
+ * so that concurrent writers don't lose each other's updates. Engines without transactions,
+ * like LevelDB, can't isolate concurrent writers of the same catalog.
+ * @return false If none of the collections is indexed, packed or compressed, leaving the documents for the caller.
+ */
+bool write_indexed_docs(ustore_database_t const c_db,
+                        ustore_transaction_t const c_txn,
+                        places_arg_t const& places,
+                        contents_arg_t const& contents,
+                        ustore_options_t const c_options,
+                        linked_memory_lock_t& arena,
+                        ustore_error_t* c_error) noexcept {
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c_db, c_error);
+    if (*c_error)
+        return true;
+    bool indexed = false;
+    bool cataloged = false;
+    for (std::size_t i = 0; i != places.size() && !cataloged; ++i) {
+        ustore_collection_t catalog = ustore_collection_main_k;
+        indexed = indexed || indexes.indexed(places[i].collection);
+        cataloged = indexes.find_catalog(places[i].collection, catalog);
+    }
+    if (!indexed)
+        return false;
+    if (c_txn || !cataloged) {
+        write_listed_indexed_docs(c_db, c_txn, indexes, places, contents, c_options, arena, c_error);
+        return true;
+    }
+
+    ustore_transaction_t txn = nullptr;
+    ustore_error_t txn_error = nullptr;
+    ustore_transaction_init_t txn_init {};
+    txn_init.db = c_db;
+    txn_init.error = &txn_error;
+    txn_init.transaction = &txn;
+    ustore_transaction_init(&txn_init);
+    if (txn_error) {
+        ustore_error_free(txn_error);
+        write_listed_indexed_docs(c_db, nullptr, indexes, places, contents, c_options, arena, c_error);
+        return true;
+    }
+
+    auto staged_options = ustore_options_t(c_options & ~(ustore_option_write_bulk_k | ustore_option_write_flush_k));
+    bool committed = false;
+    for (std::size_t attempt = 0; attempt != catalog_commit_attempts_k && !committed && !*c_error; ++attempt) {
+        if (attempt) {
+            ustore_transaction_init(&txn_init);
+            if (txn_error) {
+                *c_error = txn_error;
+                break;
+            }
+        }
+        write_listed_indexed_docs(c_db, txn, indexes, places, contents, staged_options, arena, c_error);
+        if (*c_error)
+            break;
+
+        // Any failed commit is retried, as engines don't tell conflicts apart from other errors,
+        // and the error of the last attempt is reported
+        ustore_transaction_commit_t txn_commit {};
+        txn_commit.db = c_db;
+        txn_commit.error = &txn_error;
+        txn_commit.transaction = txn;
+        txn_commit.options = ustore_options_t(c_options & ustore_option_write_flush_k);
+        ustore_transaction_commit(&txn_commit);
+        committed = !txn_error;
+        if (!committed && attempt + 1 == catalog_commit_attempts_k)
+            *c_error = txn_error;
+        else
+            ustore_error_free(std::exchange(txn_error, nullptr));
+    }
+    ustore_transaction_free(txn);
+    return true;
+}
+
+/**
+ * @brief Reads the present documents of the `collection` in batches, resetting the memory between them,
+ * and writes the tasks, that `callback(places, found_doc, tasks, batch, c_error)` appends for every batch.
+ */
+template <typename callback_at>
+void rewrite_present_docs(ustore_database_t const c_db,
+                          ustore_collection_t const collection,
+                          ustore_options_t const c_options,
+                          ustore_error_t* c_error,
+                          callback_at&& callback) noexcept {
+
+    arena_t batch_arena(c_db);
+    auto batch_options = ustore_options_t(c_options & ~ustore_option_dont_discard_memory_k);
+    for (ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();;) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c_error);
+        return_if_error_m(c_error);
+
+        ustore_length_t count_limit = static_cast<ustore_length_t>(index_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c_db;
+        scan.error = c_error;
+        scan.arena = batch;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c_error);
+        std::size_t found_count = found_counts[0];
+        if (!found_count)
+            break;
+
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.arena = batch;
+        read.options = batch_options;
+        read.tasks_count = found_count;
+        read.collections = &collection;
+        read.keys = found_keys;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        read_docs(read, batch);
+        return_if_error_m(c_error);
+
+        auto places = batch.alloc<collection_key_t>(found_count, c_error);
+        return_if_error_m(c_error);
+        for (std::size_t i = 0; i != found_count; ++i)
+            places[i] = collection_key_t {collection, found_keys[i]};
+
+        auto found_doc = [&](std::size_t i) {
+            return value_view_t {found_values + found_offsets[i], found_lengths[i]};
+        };
+        uninitialized_array_gt<write_task_t> tasks(batch);
+        callback(ptr_range_gt<collection_key_t const> {places.begin(), places.end()}, found_doc, tasks, batch, c_error);
+        return_if_error_m(c_error);
+        write_tasks(c_db, nullptr, batch_options, {tasks.begin(), tasks.end()}, batch, c_error);
+        return_if_error_m(c_error);
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != index_batch_size_k || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
+    }
+}
+
+/**
+ * @brief Fills a new index or column with the present documents.
+ */
+void index_present_docs(ustore_database_t const c_db,
+                        doc_index_t const& index,
+                        ustore_options_t const c_options,
+                        ustore_error_t* c_error) noexcept {
+
+    auto batch_options = ustore_options_t(c_options & ~ustore_option_dont_discard_memory_k);
+    rewrite_present_docs(c_db,
+                         index.collection,
+                         c_options,
+                         c_error,
+                         [&](ptr_range_gt<collection_key_t const> places,
+                             auto const& found_doc,
+                             uninitialized_array_gt<write_task_t>& tasks,
+                             linked_memory_lock_t& batch,
+                             ustore_error_t* c_error) noexcept {
+                             if (index.column)
+                                 return collect_column_cells({&index, &index + 1}, places, found_doc, tasks, batch, c_error);
+
+                             uninitialized_array_gt<index_update_t> updates(batch);
+                             collect_index_updates(
+                                 {&index, &index + 1},
+                                 places,
+                                 [](std::size_t) { return value_view_t {}; },
+                                 found_doc,
+                                 updates,
+                                 batch,
+                                 c_error);
+                             return_if_error_m(c_error);
+                             apply_index_updates(c_db,
+                                                 nullptr,
+                                                 batch_options,
+                                                 {updates.begin(), updates.end()},
+                                                 tasks,
+                                                 batch,
+                                                 c_error);
+                         });
+}
+
+/**
+ * @brief Rewrites the present documents of the `collection` in the packed form or as JSON texts,
+ * compressing them with the active dictionary from the `dictionaries` collection, if it's passed.
+ * Without dictionaries, skips the documents, that are already stored in the requested form.
+ */
+void convert_present_docs(ustore_database_t const c_db,
+                          ustore_collection_t const collection,
+                          bool const pack,
+                          ustore_collection_t const* dictionaries_id,
+                          ustore_options_t const c_options,
+                          ustore_error_t* c_error) noexcept {
+
+    rewrite_present_docs(c_db,
+                         collection,
+                         c_options,
+                         c_error,
+                         [&](ptr_range_gt<collection_key_t const> places,
+                             auto const& found_doc,
+                             uninitialized_array_gt<write_task_t>& tasks,
+                             linked_memory_lock_t& batch,
+                             ustore_error_t* c_error) noexcept {
+                             doc_dictionaries_t dictionaries(c_db, batch);
+                             for (std::size_t i = 0; i != places.size(); ++i) {
+                                 value_view_t doc = found_doc(i);
+                                 if (doc.empty() || (!dictionaries_id && is_packed_doc(doc) == pack))
+                                     continue;
+                                 if (is_packed_doc(doc) != pack)
+                                     doc = pack ? pack_doc(doc, batch, c_error)
+                                                : packed_to_json(doc, nullptr, batch, c_error);
+                                 return_if_error_m(c_error);
+                                 if (dictionaries_id)
+                                     doc = dictionaries.compress(*dictionaries_id, doc, c_error);
+                                 return_if_error_m(c_error);
+
+                                 write_task_t task;
+                                 task.collection = collection;
+                                 task.key = places[i].key;
+                                 task.value = reinterpret_cast<ustore_bytes_cptr_t>(doc.data());
+                                 task.length = static_cast<ustore_length_t>(doc.size());
+                                 tasks.push_back(task, c_error);
+                                 return_if_error_m(c_error);
+                             }
+                         });
+}
+
+/*********************************************************/
+/*****************	 Parallel Parsing	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Smallest number of documents worth parsing in a separate thread.
+ */
+constexpr std::size_t docs_per_thread_min_k = 256;
+
+/**
+ * @brief Splits a batch of documents into contiguous slices, starting at multiples of `alignment`,
+ * so that bitmaps of different slices never share bytes.
+ */
+struct docs_slices_t {
+    std::size_t count = 0;
+    std::size_t slices = 1;
+    std::size_t alignment = 1;
+
+    docs_slices_t(std::size_t count, std::size_t threads_count, std::size_t alignment) noexcept
+        : count(count), alignment(alignment) {
+        std::size_t max_slices = std::max<std::size_t>(count / std::max(docs_per_thread_min_k, alignment), 1);
+        slices = std::min(std::max<std::size_t>(threads_count, 1), max_slices);
+    }
+
+    std::size_t begin(std::size_t slice_idx) const noexcept {
+        return slice_idx == slices ? count : count * slice_idx / slices / alignment * alignment;
+    }
+    std::size_t end(std::size_t slice_idx) const noexcept { return begin(slice_idx + 1); }
+};
+
+/**
+ * @brief Owns separate memory for every slice of documents, so that they can be parsed concurrently.
+ * Allocations made by a slice outlive its lock and are released with this object.
+ */
+class slices_memory_t {
+    ptr_range_gt<ustore_arena_t> arenas_;
+    ptr_range_gt<ustore_error_t> errors_;
+
+  public:
+    slices_memory_t(std::size_t slices, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+        arenas_ = arena.alloc<ustore_arena_t>(slices, c_error);
+        if (*c_error)
+            return;
+        errors_ = arena.alloc<ustore_error_t>(slices, c_error);
+        if (*c_error)
+            return;
+        std::fill(arenas_.begin(), arenas_.end(), nullptr);
+        std::fill(errors_.begin(), errors_.end(), nullptr);
+    }
+    slices_memory_t(slices_memory_t const&) = delete;
+    slices_memory_t& operator=(slices_memory_t const&) = delete;
+    ~slices_memory_t() noexcept {
+        for (ustore_arena_t memory : arenas_)
+            ustore_arena_free(memory);
+    }
+
+    linked_memory_lock_t lock(std::size_t slice_idx, ustore_options_t options) noexcept {
+        auto slice_options = ustore_options_t(options & ~ustore_option_dont_discard_memory_k);
+        return linked_memory(&arenas_[slice_idx], slice_options, &errors_[slice_idx]);
+    }
+    ustore_error_t* error(std::size_t slice_idx) noexcept { return &errors_[slice_idx]; }
+
+    /**
+     * @brief Reports the error of the first failed slice, if any.
+     */
+    void export_error(ustore_error_t* c_error) const noexcept {
+        for (ustore_error_t error : errors_)
+            if (error) {
+                *c_error = error;
+                return;
+            }
+    }
+};
+
+/**
+ * @brief Calls `slice_docs(slice_idx)` for every slice, in up to `slices.slices` threads, including the calling one.
+ * If threads can't be spawned, the remaining slices are processed in the calling thread.
+ */
+template <typename slice_docs_at>
+void for_each_docs_slice(docs_slices_t const& slices, slice_docs_at&& slice_docs) noexcept {
+    if (slices.slices == 1)
+        return slice_docs(std::size_t(0));
+
+    std::vector<std::thread> threads;
+    std::size_t spawned = 1;
+    try {
+        threads.reserve(slices.slices - 1);
+        for (; spawned != slices.slices; ++spawned)
+            threads.emplace_back(slice_docs, spawned);
+    }
+    catch (...) {
+    }
+    for (std::size_t slice_idx = spawned; slice_idx != slices.slices; ++slice_idx)
+        slice_docs(slice_idx);
+    slice_docs(std::size_t(0));
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/*********************************************************/
+/*****************	 Primary Functions	  ****************/
+/*********************************************************/
+
+void modify_field( //
+    yyjson_mut_doc* original_doc,
+    yyjson_mut_val* modifier,
+    ustore_str_view_t field,
+    doc_modification_t const c_modification,
+    ustore_error_t* c_error) {
+
+    std::string_view json_ptr(field);
+    auto last_key_pos = json_ptr.rfind('/');
+    auto last_key_or_idx = json_ptr.substr(last_key_pos + 1);
+    auto is_idx = std::all_of(last_key_or_idx.begin(), last_key_or_idx.end(), [](char c) { return std::isdigit(c); });
+
+    yyjson_mut_val* val = json_lookupn(original_doc->root, json_ptr.data(), last_key_pos);
+    return_error_if_m(val, c_error, 0, "Invalid field!");
+
+    if (yyjson_mut_is_arr(val)) {
+        return_error_if_m(is_idx || last_key_or_idx == "-", c_error, 0, "Invalid field!");
+        size_t idx = 0;
+        std::from_chars(last_key_or_idx.begin(), last_key_or_idx.end(), idx);
+        if (c_modification == doc_modification_t::merge_k) {
+            yyjson_mut_val* mergeable = yyjson_mut_arr_get(val, idx);
+            return_error_if_m(mergeable, c_error, 0, "Invalid field!");
+            yyjson_mut_val* merge_result = yyjson_mut_merge_patch(original_doc, mergeable, modifier);
+            return_error_if_m(merge_result, c_error, 0, "Failed To Merge!");
+            return_error_if_m(yyjson_mut_arr_replace(val, idx, merge_result), c_error, 0, "Failed To Merge!");
+        }
+        else if (c_modification == doc_modification_t::insert_k) {
+            auto result = is_idx //
+                              ? yyjson_mut_arr_insert(val, modifier, idx)
+                              : yyjson_mut_arr_add_val(val, modifier);
+            return_error_if_m(result, c_error, 0, "Failed To Insert!");
+        }
+        else if (c_modification == doc_modification_t::remove_k) {
+            return_error_if_m(yyjson_mut_arr_remove(val, idx), c_error, 0, "Failed To Remove!");
+        }
+        else if (c_modification == doc_modification_t::update_k) {
+            return_error_if_m(yyjson_mut_arr_replace(val, idx, modifier), c_error, 0, "Failed To Update!");
+        }
+        else if (c_modification == doc_modification_t::upsert_k) {
+            auto result = yyjson_mut_arr_get(val, idx) //
+                              ? yyjson_mut_arr_replace(val, idx, modifier) != nullptr
+                              : yyjson_mut_arr_append(val, modifier);
+            return_error_if_m(result, c_error, 0, "Failed To Upsert!");
+        }
+        else {
+            return_error_m(c_error, "Invalid Modification Mode!");
+        }
+    }
+    else if (yyjson_mut_is_obj(val)) {
+        if (c_modification == doc_modification_t::merge_k) {
+            yyjson_mut_val* mergeable = yyjson_mut_obj_getn(val, last_key_or_idx.data(), last_key_or_idx.size());
+            yyjson_mut_val* merge_result = yyjson_mut_merge_patch(original_doc, mergeable, modifier);
+            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+            yyjson_mut_obj_replace(val, key, merge_result);
+        }
+        else if (c_modification == doc_modification_t::insert_k) {
+            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+            return_error_if_m(yyjson_mut_obj_add(val, key, modifier), c_error, 0, "Failed To Insert!");
+        }
+        else if (c_modification == doc_modification_t::remove_k) {
+            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+            return_error_if_m(yyjson_mut_obj_remove(val, key), c_error, 0, "Failed To Remove!");
+        }
+        else if (c_modification == doc_modification_t::update_k) {
+            yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+            return_error_if_m(yyjson_mut_obj_replace(val, key, modifier), c_error, 0, "Failed To Update!");
+        }
+        else if (c_modification == doc_modification_t::upsert_k) {
+            if (yyjson_mut_obj_get(val, last_key_or_idx.data())) {
+                yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+                return_error_if_m(yyjson_mut_obj_replace(val, key, modifier), c_error, 0, "Failed To Update!");
+            }
+            else {
+                yyjson_mut_val* key = yyjson_mut_strncpy(original_doc, last_key_or_idx.data(), last_key_or_idx.size());
+                return_error_if_m(yyjson_mut_obj_add(val, key, modifier), c_error, 0, "Failed To Update!");
+            }
+        }
+        else {
+            return_error_m(c_error, "Invalid Modification Mode!");
+        }
+    }
+}
+
+ustore_str_view_t field_concat(ustore_str_view_t field,
+                            ustore_str_view_t suffix,
+                            linked_memory_lock_t& arena,
+                            ustore_error_t* c_error) {
+    auto field_len = field ? std::strlen(field) : 0;
+    auto suffix_len = suffix ? std::strlen(suffix) : 0;
+
+    if (!(field_len | suffix_len))
+        return nullptr;
+    if (!field_len)
+        return suffix;
+    if (!suffix_len)
+        return field;
+
+    auto result = arena.alloc<char>(field_len + suffix_len + 1, c_error).begin();
+    std::memcpy(result, field, field_len);
+    std::memcpy(result + field_len, suffix, suffix_len);
+    result[field_len + suffix_len] = '\0';
+    return result;
+}
+
+void patch( //
+    yyjson_mut_doc* original_doc,
+    yyjson_mut_val* patch_doc,
+    ustore_str_view_t field,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    return_error_if_m(yyjson_mut_is_arr(patch_doc), c_error, 0, "Invalid Patch Doc!");
+    yyjson_mut_val* obj;
+    yyjson_mut_arr_iter arr_iter;
+    yyjson_mut_arr_iter_init(patch_doc, &arr_iter);
+    while ((obj = yyjson_mut_arr_iter_next(&arr_iter))) {
         return_error_if_m(yyjson_mut_is_obj(obj), c_error, 0, "Invalid Patch Doc!");
         yyjson_mut_obj_iter obj_iter;
         yyjson_mut_obj_iter_init(obj, &obj_iter);
@@ -1285,7 +3500,7 @@ void read_unique_docs( //
     read.lengths = &found_binary_lens;
     read.values = &found_binary_begin;
 
-    ustore_read(&read);
+    read_docs(read, arena);
 
     auto found_binaries = joined_blobs_t(places.count, found_binary_offs, found_binary_begin);
     auto found_binary_it = found_binaries.begin();
@@ -1351,7 +3566,7 @@ void read_modify_unique_docs( //
         read.offsets = &found_binary_offs;
         read.values = &found_binary_begin;
 
-        ustore_read(&read);
+        read_docs(read, arena);
         return_if_error_m(c_error);
 
         auto found_binaries = joined_blobs_t(places.count, found_binary_offs, found_binary_begin);
@@ -1474,7 +3689,7 @@ void read_modify_docs( //
     read.offsets = &found_binary_offs;
     read.values = &found_binary_begin;
 
-    ustore_read(&read);
+    read_docs(read, arena);
     return_if_error_m(c_error);
 
     // We will later need to locate the data for every separate request.
@@ -1496,6 +3711,68 @@ void read_modify_docs( //
     }
 }
 
+/**
+ * @brief Checks if the `modification` only replaces the value under a JSON-Pointer with a fixed-width scalar.
+ */
+bool is_scalar_replacement(ustore_str_view_t field,
+                           yyjson_mut_val* modifier,
+                           doc_modification_t const modification) noexcept {
+    yyjson_type type = yyjson_mut_get_type(modifier);
+    return field && field[0] == '/' &&
+           (modification == doc_modification_t::update_k || modification == doc_modification_t::upsert_k) &&
+           (type == YYJSON_TYPE_NUM || type == YYJSON_TYPE_BOOL || type == YYJSON_TYPE_NULL);
+}
+
+/**
+ * @brief Replaces the scalar under the JSON-Pointer `field` of a stored document, without parsing it.
+ * In JSON texts the new value must take exactly as many bytes, as the old one, while in packed documents
+ * any number, boolean or null fits into the node of an old number, boolean or null.
+ * @see `is_scalar_replacement`.
+ *
+ * @param doc Mutable copy of the document, padded for SIMDJSON, if it's a JSON text.
+ * @return false If the document has to be parsed and dumped instead.
+ */
+bool modify_in_place(ptr_range_gt<byte_t> doc,
+                     ustore_str_view_t field,
+                     yyjson_mut_val* modifier,
+                     sj::ondemand::parser& parser,
+                     linked_memory_lock_t& arena) noexcept {
+
+    packed_doc_view_t packed;
+    if (unpack_view(value_view_t {doc.begin(), doc.size()}, packed)) {
+        std::size_t idx = packed_find(packed, field);
+        if (idx == packed.count)
+            return false;
+        yyjson_val node = packed.node(idx);
+        if (yyjson_is_ctn(&node) || is_packed_string(&node))
+            return false;
+        node.tag = modifier->tag;
+        node.uni = modifier->uni;
+        std::memcpy(doc.begin() + (packed.nodes - doc.begin()) + idx * sizeof(yyjson_val), &node, sizeof(node));
+        return true;
+    }
+
+    auto doc_begin = reinterpret_cast<char const*>(doc.begin());
+    auto padded_doc = sj::padded_string_view(doc_begin, doc.size(), doc.size() + sj::SIMDJSON_PADDING);
+    sj::ondemand::document parsed;
+    sj::ondemand::value value;
+    sj::ondemand::json_type type;
+    if (parser.iterate(padded_doc).get(parsed) || parsed.at_pointer(field).get(value) || value.type().get(type) ||
+        type == sj::ondemand::json_type::object || type == sj::ondemand::json_type::array)
+        return false;
+    std::string_view token = value.raw_json_token();
+    while (!token.empty() && std::isspace(static_cast<unsigned char>(token.back())))
+        token.remove_suffix(1);
+
+    size_t printed_length = 0;
+    yyjson_alc allocator = wrap_allocator(arena);
+    char* printed = yyjson_mut_val_write_opts(modifier, 0, &allocator, &printed_length, NULL);
+    if (!printed || printed_length != token.size())
+        return false;
+    std::memcpy(doc.begin() + (token.data() - doc_begin), printed, printed_length);
+    return true;
+}
+
 void read_modify_write( //
     ustore_database_t const c_db,
     ustore_transaction_t const c_txn,
@@ -1507,39 +3784,101 @@ void read_modify_write( //
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) noexcept {
 
+    traced_span_t span {"docs_read_modify_write", c_error};
+
+    // Remember the stored versions, to later apply all the modifications of the same document at once
+    auto found_docs = arena.alloc<value_view_t>(places.size(), c_error);
+    return_if_error_m(c_error);
+    auto remember_doc = [&](ustore_size_t task_idx, ustore_str_view_t, value_view_t binary_doc) {
+        found_docs[task_idx] = binary_doc;
+    };
+
+    places_arg_t unique_places;
+    auto opts = c_txn ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
+    read_modify_docs(c_db, c_txn, places, opts, c_modification, arena, unique_places, c_error, remember_doc);
+    return_if_error_m(c_error);
+
+    // Repeated documents are exported in the sorted order of `unique_places`,
+    // with all of their modifications applied in the original order
+    auto tasks_order = arena.alloc<std::size_t>(places.size(), c_error);
+    return_if_error_m(c_error);
+    std::iota(tasks_order.begin(), tasks_order.end(), 0u);
+    if (unique_places.count != places.count)
+        std::stable_sort(tasks_order.begin(), tasks_order.end(), [&](std::size_t a, std::size_t b) {
+            return places[a].collection_key() < places[b].collection_key();
+        });
+
     growing_tape_t growing_tape {arena};
-    growing_tape.reserve(places.size(), c_error);
+    growing_tape.reserve(unique_places.size(), c_error);
     return_if_error_m(c_error);
 
     yyjson_alc allocator = wrap_allocator(arena);
-    auto safe_callback = [&](ustore_size_t task_idx, ustore_str_view_t field, value_view_t binary_doc) {
-        json_t parsed = any_parse(binary_doc, internal_format_k, arena, c_error);
-        if (!contents[task_idx]) {
-            any_dump({nullptr, parsed.mut_handle->root}, internal_format_k, arena, growing_tape, c_error);
-            return;
-        }
+    sj::ondemand::parser parser;
+    for (std::size_t group_begin = 0; group_begin != places.size();) {
+        std::size_t group_end = group_begin + 1;
+        while (group_end != places.size() && unique_places.count != places.count &&
+               places[tasks_order[group_end]].collection_key() == places[tasks_order[group_begin]].collection_key())
+            ++group_end;
+
+        // The stored version is parsed only once some modification can't be applied in place
+        value_view_t binary_doc = found_docs[tasks_order[group_begin]];
+        ptr_range_gt<byte_t> doc_copy;
+        json_t parsed;
+        for (std::size_t i = group_begin; i != group_end; ++i) {
+            std::size_t task_idx = tasks_order[i];
+            if (!contents[task_idx])
+                continue;
+
+            ustore_str_view_t field = places[task_idx].field;
+            json_t parsed_task = any_parse(contents[task_idx], c_type, arena, c_error);
+            return_if_error_m(c_error);
 
-        // This error is extremely unlikely, as we have previously accepted the data into the store.
-        return_if_error_m(c_error);
-        if (!parsed.mut_handle)
-            parsed.mut_handle = yyjson_doc_mut_copy(parsed.handle, &allocator);
+            yyjson_mut_val* modifier = parsed_task.mut_handle->root;
+            bool in_place = !parsed && !binary_doc.empty() && is_scalar_replacement(field, modifier, c_modification);
+            if (in_place && doc_copy.empty()) {
+                doc_copy = arena.alloc<byte_t>(binary_doc.size() + sj::SIMDJSON_PADDING, c_error);
+                return_if_error_m(c_error);
+                std::memcpy(doc_copy.begin(), binary_doc.data(), binary_doc.size());
+                std::memset(doc_copy.begin() + binary_doc.size(), 0, sj::SIMDJSON_PADDING);
+                doc_copy = {doc_copy.begin(), doc_copy.begin() + binary_doc.size()};
+            }
+            if (in_place && modify_in_place(doc_copy, field, modifier, parser, arena))
+                continue;
+
+            if (!parsed) {
+                value_view_t current = doc_copy.empty() ? binary_doc : value_view_t {doc_copy.begin(), doc_copy.size()};
+                parsed = any_parse(current, internal_format_k, arena, c_error);
+                // This error is extremely unlikely, as we have previously accepted the data into the store.
+                return_if_error_m(c_error);
+                if (parsed && !parsed.mut_handle)
+                    parsed.mut_handle = yyjson_doc_mut_copy(parsed.handle, &allocator);
+            }
 
-        json_t parsed_task = any_parse(contents[task_idx], c_type, arena, c_error);
-        return_if_error_m(c_error);
+            // Perform modifications
+            modify(parsed, modifier, field, c_modification, arena, c_error);
+            return_if_error_m(c_error);
+        }
 
-        // Perform modifications
-        modify(parsed, parsed_task.mut_handle->root, field, c_modification, arena, c_error);
-        any_dump({nullptr, parsed.mut_handle->root}, internal_format_k, arena, growing_tape, c_error);
+        if (parsed)
+            any_dump({nullptr, parsed.mut_handle->root}, internal_format_k, arena, growing_tape, c_error);
+        else
+            growing_tape.push_back(doc_copy.empty() ? binary_doc : value_view_t {doc_copy.begin(), doc_copy.size()},
+                                   c_error);
         return_if_error_m(c_error);
-    };
-
-    places_arg_t unique_places;
-    auto opts = c_txn ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
-    read_modify_docs(c_db, c_txn, places, opts, c_modification, arena, unique_places, c_error, safe_callback);
-    return_if_error_m(c_error);
+        group_begin = group_end;
+    }
 
     // By now, the tape contains concatenated updates docs:
     ustore_byte_t* tape_begin = reinterpret_cast<ustore_byte_t*>(growing_tape.contents().begin().get());
+    ustore_bytes_cptr_t tape_cbegin = tape_begin;
+    contents_arg_t updated_docs;
+    updated_docs.offsets_begin = {growing_tape.offsets().begin().get(), growing_tape.offsets().stride()};
+    updated_docs.lengths_begin = {growing_tape.lengths().begin().get(), growing_tape.lengths().stride()};
+    updated_docs.contents_begin = {&tape_cbegin, 0};
+    updated_docs.count = unique_places.count;
+    if (write_indexed_docs(c_db, c_txn, unique_places, updated_docs, c_options, arena, c_error))
+        return;
+
     ustore_write_t write {};
     write.db = c_db;
     write.error = c_error;
@@ -1563,6 +3902,7 @@ void read_modify_write( //
 void ustore_docs_write(ustore_docs_write_t* c_ptr) {
 
     ustore_docs_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_write_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -1607,12 +3947,13 @@ void ustore_docs_write(ustore_docs_write_t* c_ptr) {
     places_arg_t places {collections, keys, fields, c.tasks_count};
     contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
 
+    // Partial updates have to read the documents first, so they aren't bulk loaded
     if (has_fields || c.type != internal_format_k || c.modification != ustore_doc_modify_upsert_k)
         return read_modify_write(c.db,
                                  c.transaction,
                                  places,
                                  contents,
-                                 c.options,
+                                 ustore_options_t(c.options & ~ustore_option_write_bulk_k),
                                  static_cast<doc_modification_t>(c.modification),
                                  c.type,
                                  arena,
@@ -1630,12 +3971,17 @@ void ustore_docs_write(ustore_docs_write_t* c_ptr) {
 
     sj::dom::parser parser;
     for (std::size_t i = 0; i < contents.size(); ++i) {
+        if (!contents[i])
+            continue;
         std::memcpy(document.begin(), contents[i].data(), contents[i].size());
         std::memset(document.begin() + contents[i].size(), 0, sj::SIMDJSON_PADDING);
         auto result = parser.parse((const char*)document.begin(), contents[i].size(), false);
         return_error_if_m(result.error() == sj::SUCCESS, c.error, 0, "Invalid Json!");
     }
 
+    if (write_indexed_docs(c.db, c.transaction, places, contents, c.options, arena, c.error))
+        return;
+
     ustore_write_t write {};
     write.db = c.db;
     write.error = c.error;
@@ -1658,9 +4004,173 @@ void ustore_docs_write(ustore_docs_write_t* c_ptr) {
     ustore_write(&write);
 }
 
+/**
+ * @brief Exports a padded document or its `field` in the requested `type`, appending it to the `tape`.
+ */
+void export_read_doc(value_view_t binary_doc,
+                     ustore_str_view_t field,
+                     ustore_doc_field_type_t type,
+                     sj::ondemand::parser& parser,
+                     growing_tape_t& tape,
+                     linked_memory_lock_t& arena,
+                     ustore_error_t* c_error) noexcept {
+    // Packed documents are transcoded at the boundary, only within the requested field
+    if (is_packed_doc(binary_doc)) {
+        bool whole_doc = type == ustore_doc_field_msgpack_k || type == ustore_doc_field_bson_k;
+        binary_doc = packed_to_json(binary_doc, whole_doc ? nullptr : field, arena, c_error);
+        return_if_error_m(c_error);
+        field = nullptr;
+    }
+    if (binary_doc.empty()) {
+        tape.push_back(binary_doc, c_error);
+        return;
+    }
+
+    std::string_view result;
+    auto padded_doc =
+        sj::padded_string_view(binary_doc.c_str(), binary_doc.size(), binary_doc.size() + sj::SIMDJSON_PADDING);
+
+    string_t output {arena};
+    if (type == ustore_doc_field_msgpack_k) {
+        json_to_mpack(padded_doc, output, c_error);
+        result = {output.data(), output.size()};
+    }
+    else if (type == ustore_doc_field_bson_k) {
+        bson_error_t error;
+        bson_t* b = bson_new_from_json((uint8_t*)binary_doc.c_str(), -1, &error);
+        result = {(const char*)bson_get_data(b), b->len};
+        tape.push_back(result, c_error);
+        tape.add_terminator(byte_t {0}, c_error);
+        return_if_error_m(c_error);
+        bson_clear(&b);
+        return;
+    }
+    else {
+        auto maybe_doc = parser.iterate(padded_doc);
+        return_error_if_m(maybe_doc.error() == sj::SUCCESS, c_error, 0, "Fail To Parse Document!");
+        printed_number_buffer_t print_buffer;
+        if (maybe_doc.value().is_scalar())
+            result = get_value(maybe_doc.value(), type, print_buffer);
+        else {
+            auto parsed = maybe_doc.value().get_value();
+            auto branch = simdjson_lookup(parsed.value(), field);
+            result = get_value(branch, type, print_buffer);
+        }
+    }
+    tape.push_back(result, c_error);
+    tape.add_terminator(byte_t {0}, c_error);
+    return_if_error_m(c_error);
+}
+
+/**
+ * @brief Entries of a tape, exported by one slice of documents.
+ */
+struct slice_tape_t {
+    ustore_length_t const* offsets = nullptr;
+    ustore_length_t const* lengths = nullptr;
+    byte_t const* contents = nullptr;
+};
+
+/**
+ * @brief Reads all the documents at once, exporting disjoint slices of them in separate threads,
+ * and joining their tapes in the original order, exactly as a single thread would.
+ */
+void read_docs_in_slices(ustore_docs_read_t const& c,
+                         places_arg_t const& places,
+                         docs_slices_t const& slices,
+                         growing_tape_t& growing_tape,
+                         linked_memory_lock_t& arena) noexcept {
+
+    ustore_byte_t* found_binary_begin {};
+    ustore_length_t* found_binary_offs {};
+    ustore_length_t* found_binary_lens {};
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c.error;
+    read.transaction = c.transaction;
+    read.snapshot = c.snapshot;
+    read.arena = arena;
+    read.options = c.options;
+    read.tasks_count = c.tasks_count;
+    read.collections = c.collections;
+    read.collections_stride = c.collections_stride;
+    read.keys = c.keys;
+    read.keys_stride = c.keys_stride;
+    read.offsets = &found_binary_offs;
+    read.lengths = &found_binary_lens;
+    read.values = &found_binary_begin;
+    read_docs(read, arena);
+    return_if_error_m(c.error);
+    auto found_binaries = joined_blobs_t(places.count, found_binary_offs, found_binary_begin);
+
+    slices_memory_t memory(slices.slices, arena, c.error);
+    return_if_error_m(c.error);
+    auto tapes = arena.alloc<slice_tape_t>(slices.slices, c.error);
+    return_if_error_m(c.error);
+
+    for_each_docs_slice(slices, [&](std::size_t slice_idx) noexcept {
+        ustore_error_t* slice_error = memory.error(slice_idx);
+        linked_memory_lock_t slice_arena = memory.lock(slice_idx, c.options);
+        if (*slice_error)
+            return;
+
+        std::size_t begin = slices.begin(slice_idx);
+        std::size_t end = slices.end(slice_idx);
+        ustore_length_t max_length = 0;
+        for (std::size_t task_idx = begin; task_idx != end; ++task_idx)
+            if (found_binary_lens[task_idx] != ustore_length_missing_k)
+                max_length = std::max(max_length, found_binary_lens[task_idx]);
+        auto document = slice_arena.alloc<byte_t>(max_length + sj::SIMDJSON_PADDING, slice_error);
+        if (*slice_error)
+            return;
+
+        growing_tape_t tape {slice_arena};
+        tape.reserve(end - begin, slice_error);
+        if (*slice_error)
+            return;
+        sj::ondemand::parser parser;
+        for (std::size_t task_idx = begin; task_idx != end; ++task_idx) {
+            value_view_t binary_doc = found_binaries[task_idx];
+            std::memcpy(document.begin(), binary_doc.data(), binary_doc.size());
+            std::memset(document.begin() + binary_doc.size(), 0, sj::SIMDJSON_PADDING);
+            ustore_str_view_t field = places.fields_begin ? places.fields_begin[task_idx] : nullptr;
+            export_read_doc(value_view_t(document.begin(), binary_doc.size()),
+                            field,
+                            c.type,
+                            parser,
+                            tape,
+                            slice_arena,
+                            slice_error);
+            if (*slice_error)
+                return;
+        }
+        tapes[slice_idx].offsets = tape.offsets().begin().get();
+        tapes[slice_idx].lengths = tape.lengths().begin().get();
+        tapes[slice_idx].contents = tape.contents().begin().get();
+    });
+    memory.export_error(c.error);
+    return_if_error_m(c.error);
+
+    // Join the tapes, preserving the terminators
+    for (std::size_t slice_idx = 0; slice_idx != slices.slices; ++slice_idx) {
+        slice_tape_t const& tape = tapes[slice_idx];
+        for (std::size_t i = 0; i != slices.end(slice_idx) - slices.begin(slice_idx); ++i) {
+            value_view_t entry {tape.contents + tape.offsets[i], tape.lengths[i]};
+            growing_tape.push_back(entry, c.error);
+            return_if_error_m(c.error);
+            if (tape.offsets[i + 1] - tape.offsets[i] > entry.size())
+                growing_tape.add_terminator(byte_t {0}, c.error);
+            return_if_error_m(c.error);
+        }
+    }
+}
+
+#if !defined(USTORE_FLIGHT_CLIENT) // Remote clients forward this call to the server, see `flight_client.cpp`
+
 void ustore_docs_read(ustore_docs_read_t* c_ptr) {
 
     ustore_docs_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_read_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -1685,11 +4195,49 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
         read.keys = c.keys;
         read.keys_stride = c.keys_stride;
         read.presences = c.presences;
-        read.offsets = c.offsets;
-        read.lengths = c.lengths;
-        read.values = c.values;
+        if (!c.values && !c.lengths)
+            return ustore_read(&read);
+
+        // Packed documents have to be found and transcoded, if there are any
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        read_docs(read, arena);
+        return_if_error_m(c.error);
+
+        auto found_binaries = joined_blobs_t(c.tasks_count, found_offsets, found_values);
+        bool has_packed = false;
+        for (std::size_t i = 0; i != c.tasks_count && !has_packed; ++i)
+            has_packed = found_lengths[i] != ustore_length_missing_k && is_packed_doc(found_binaries[i]);
+        if (has_packed) {
+            growing_tape_t growing_tape {arena};
+            growing_tape.reserve(c.tasks_count, c.error);
+            return_if_error_m(c.error);
+            for (std::size_t i = 0; i != c.tasks_count; ++i) {
+                value_view_t binary_doc = found_binaries[i];
+                if (found_lengths[i] == ustore_length_missing_k)
+                    binary_doc = value_view_t {};
+                else if (is_packed_doc(binary_doc))
+                    binary_doc = packed_to_json(binary_doc, nullptr, arena, c.error);
+                return_if_error_m(c.error);
+                growing_tape.push_back(binary_doc, c.error);
+                return_if_error_m(c.error);
+            }
+            found_offsets = growing_tape.offsets().begin().get();
+            found_lengths = growing_tape.lengths().begin().get();
+            found_values = reinterpret_cast<ustore_byte_t*>(growing_tape.contents().begin().get());
+        }
 
-        return ustore_read(&read);
+        if (c.offsets)
+            *c.offsets = found_offsets;
+        if (c.lengths)
+            *c.lengths = found_lengths;
+        if (c.values)
+            *c.values = found_values;
+        return;
     }
 
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
@@ -1703,60 +4251,29 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
     growing_tape_t growing_tape {arena};
     growing_tape.reserve(places.size(), c.error);
     return_if_error_m(c.error);
-    sj::ondemand::parser parser;
-
-    auto safe_callback = [&](ustore_size_t, ustore_str_view_t field, value_view_t binary_doc) {
-        if (binary_doc.empty()) {
-            growing_tape.push_back(binary_doc, c.error);
-            return;
-        }
-
-        std::string_view result;
-        auto padded_doc =
-            sj::padded_string_view(binary_doc.c_str(), binary_doc.size(), binary_doc.size() + sj::SIMDJSON_PADDING);
-
-        string_t output {arena};
-        if (c.type == ustore_doc_field_msgpack_k) {
-            json_to_mpack(padded_doc, output, c.error);
-            result = {output.data(), output.size()};
-        }
-        else if (c.type == ustore_doc_field_bson_k) {
-            bson_error_t error;
-            bson_t* b = bson_new_from_json((uint8_t*)binary_doc.c_str(), -1, &error);
-            result = {(const char*)bson_get_data(b), b->len};
-            growing_tape.push_back(result, c.error);
-            growing_tape.add_terminator(byte_t {0}, c.error);
-            return_if_error_m(c.error);
-            bson_clear(&b);
-            return;
-        }
-        else {
-            auto maybe_doc = parser.iterate(padded_doc);
-            return_error_if_m(maybe_doc.error() == sj::SUCCESS, c.error, 0, "Fail To Parse Document!");
-            printed_number_buffer_t print_buffer;
-            if (maybe_doc.value().is_scalar())
-                result = get_value(maybe_doc.value(), c.type, print_buffer);
-            else {
-                auto parsed = maybe_doc.value().get_value();
-                auto branch = simdjson_lookup(parsed.value(), field);
-                result = get_value(branch, c.type, print_buffer);
-            }
-        }
-        growing_tape.push_back(result, c.error);
-        growing_tape.add_terminator(byte_t {0}, c.error);
-        return_if_error_m(c.error);
-    };
 
-    places_arg_t unique_places;
-    read_modify_docs(c.db,
-                     c.transaction,
-                     places,
-                     c.options,
-                     doc_modification_t::nothing_k,
-                     arena,
-                     unique_places,
-                     c.error,
-                     safe_callback);
+    // Large batches can be split between threads, each parsing its slice into a separate tape
+    docs_slices_t slices(places.size(), c.threads_count, 1);
+    if (slices.slices > 1)
+        read_docs_in_slices(c, places, slices, growing_tape, arena);
+    else {
+        sj::ondemand::parser parser;
+        auto safe_callback = [&](ustore_size_t, ustore_str_view_t field, value_view_t binary_doc) {
+            export_read_doc(binary_doc, field, c.type, parser, growing_tape, arena, c.error);
+        };
+
+        places_arg_t unique_places;
+        read_modify_docs(c.db,
+                         c.transaction,
+                         places,
+                         c.options,
+                         doc_modification_t::nothing_k,
+                         arena,
+                         unique_places,
+                         c.error,
+                         safe_callback);
+    }
+    return_if_error_m(c.error);
 
     if (c.offsets)
         *c.offsets = growing_tape.offsets().begin().get();
@@ -1766,6 +4283,8 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
         *c.values = reinterpret_cast<ustore_byte_t*>(growing_tape.contents().begin().get());
 }
 
+#endif
+
 /*********************************************************/
 /*****************	 Tabular Exports	  ****************/
 /*********************************************************/
@@ -1837,14 +4356,84 @@ void gist_recursively(yyjson_val* node,
     }
 }
 
+/**
+ * @brief Lists the fields of entire collections from their catalogs, adding up the counters of the same paths.
+ */
+void gist_catalogs(ustore_docs_gist_t& c, linked_memory_lock_t& arena) noexcept {
+
+    doc_indexes_t catalogs(arena);
+    catalogs.list(c.db, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    uninitialized_array_gt<catalog_entry_t> sorted_entries(arena);
+    auto merge_entry = [&](catalog_entry_t const& entry) noexcept {
+        auto it = std::lower_bound(sorted_entries.begin(),
+                                   sorted_entries.end(),
+                                   entry.path,
+                                   [](catalog_entry_t const& sorted, std::string_view path) noexcept {
+                                       return sorted.path < path;
+                                   });
+        if (it == sorted_entries.end() || it->path != entry.path)
+            return sorted_entries.insert(it - sorted_entries.begin(), &entry, &entry + 1, c.error);
+        for (std::size_t kind = 0; kind != catalog_kinds_k; ++kind)
+            it->counts[kind] += entry.counts[kind];
+    };
+    for (ustore_size_t collection_idx = 0; collection_idx != c.docs_count; ++collection_idx) {
+        ustore_collection_t collection = collections ? collections[collection_idx] : ustore_collection_main_k;
+        bool repeated = false;
+        for (ustore_size_t previous_idx = 0; previous_idx != collection_idx && !repeated; ++previous_idx)
+            repeated = collection == (collections ? collections[previous_idx] : ustore_collection_main_k);
+        if (repeated)
+            continue;
+
+        ustore_collection_t catalog = ustore_collection_main_k;
+        return_error_if_m(catalogs.find_catalog(collection, catalog),
+                          c.error,
+                          args_combo_k,
+                          "Collection has no field catalog");
+        for_each_cataloged_field(c.db, c.transaction, c.snapshot, catalog, c.options, arena, c.error, merge_entry);
+        return_if_error_m(c.error);
+    }
+
+    growing_tape_t exported_paths(arena);
+    auto counts = arena.alloc<ustore_size_t>(sorted_entries.size(), c.error);
+    return_if_error_m(c.error);
+    auto types = arena.alloc<ustore_doc_field_type_t>(sorted_entries.size(), c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != sorted_entries.size(); ++i) {
+        catalog_entry_t const& entry = sorted_entries[i];
+        exported_paths.push_back(entry.path, c.error);
+        return_if_error_m(c.error);
+        exported_paths.add_terminator(byte_t {0}, c.error);
+        return_if_error_m(c.error);
+        counts[i] = static_cast<ustore_size_t>(entry.total());
+        types[i] = catalog_type(entry);
+    }
+
+    if (c.fields_count)
+        *c.fields_count = static_cast<ustore_size_t>(sorted_entries.size());
+    if (c.offsets)
+        *c.offsets = exported_paths.offsets().begin().get();
+    if (c.fields)
+        *c.fields = reinterpret_cast<ustore_char_t*>(exported_paths.contents().begin().get());
+    if (c.counts)
+        *c.counts = counts.begin();
+    if (c.types)
+        *c.types = types.begin();
+}
+
 void ustore_docs_gist(ustore_docs_gist_t* c_ptr) {
 
     ustore_docs_gist_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_gist_k, c.error};
     if (!c.docs_count)
         return;
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
+    if (!c.keys)
+        return gist_catalogs(c, arena);
 
     ustore_byte_t* found_binary_begin {};
     ustore_length_t* found_binary_offs {};
@@ -1865,7 +4454,7 @@ void ustore_docs_gist(ustore_docs_gist_t* c_ptr) {
     read.lengths = nullptr;
     read.values = &found_binary_begin;
 
-    ustore_read(&read);
+    read_docs(read, arena);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
@@ -1983,34 +4572,75 @@ struct column_begin_t {
     }
 };
 
-void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
-
-    ustore_docs_gather_t& c = *c_ptr;
-    if (!c.docs_count || !c.fields_count)
-        return;
-
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Suggests the type of the `field` from the counters in the `catalogs`,
+ * falling back to strings, if the field isn't cataloged.
+ */
+ustore_doc_field_type_t cataloged_type(ustore_docs_gather_t const& c,
+                                       ptr_range_gt<ustore_collection_t const> catalogs,
+                                       ustore_str_view_t field,
+                                       linked_memory_lock_t& arena,
+                                       ustore_error_t* c_error) noexcept {
+
+    if (catalogs.empty() || !field)
+        return ustore_doc_field_str_k;
+
+    // Catalogs name the fields with JSON-Pointers
+    std::string_view path = field;
+    if (path.empty() || path.front() != '/') {
+        auto pointer = arena.alloc<char>(path.size() + 1, c_error);
+        if (*c_error)
+            return ustore_doc_field_str_k;
+        pointer[0] = '/';
+        std::memcpy(pointer.begin() + 1, path.data(), path.size());
+        path = {pointer.begin(), pointer.size()};
+    }
 
-    // Retrieve the entire documents before we can sample internal fields
-    ustore_byte_t* found_binary_begin {};
-    ustore_length_t* found_binary_offs {};
+    ustore_key_t key = catalog_key(path);
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
     ustore_read_t read {};
     read.db = c.db;
-    read.error = c.error;
+    read.error = c_error;
     read.transaction = c.transaction;
     read.snapshot = c.snapshot;
     read.arena = arena;
-    read.options = c.options;
-    read.tasks_count = c.docs_count;
-    read.collections = c.collections;
-    read.collections_stride = c.collections_stride;
-    read.keys = c.keys;
-    read.keys_stride = c.keys_stride;
-    read.offsets = &found_binary_offs;
-    read.values = &found_binary_begin;
-
+    read.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = catalogs.size();
+    read.collections = catalogs.begin();
+    read.collections_stride = sizeof(ustore_collection_t);
+    read.keys = &key;
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
     ustore_read(&read);
+    if (*c_error)
+        return ustore_doc_field_str_k;
+
+    catalog_entry_t merged;
+    merged.path = path;
+    for (std::size_t i = 0; i != catalogs.size(); ++i) {
+        if (found_lengths[i] == ustore_length_missing_k)
+            continue;
+        for_each_catalog_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                               [&](catalog_entry_t const& entry) {
+                                   if (entry.path == path)
+                                       for (std::size_t kind = 0; kind != catalog_kinds_k; ++kind)
+                                           merged.counts[kind] += entry.counts[kind];
+                               });
+    }
+    return catalog_type(merged);
+}
+
+void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
+
+    ustore_docs_gather_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_gather_k, c.error};
+    if (!c.docs_count || !c.fields_count)
+        return;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
@@ -2018,8 +4648,109 @@ void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
     strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
     strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
 
-    joined_blobs_t found_binaries {c.docs_count, found_binary_offs, found_binary_begin};
-    joined_blobs_iterator_t found_binary_it = found_binaries.begin();
+    // Materialized fields are read from the cached cells, instead of parsing the documents
+    auto cached = arena.alloc<bool>(c.fields_count, c.error);
+    return_if_error_m(c.error);
+    auto cached_cells = arena.alloc<joined_blobs_t>(c.fields_count, c.error);
+    return_if_error_m(c.error);
+    std::fill(cached.begin(), cached.end(), false);
+    doc_indexes_t columns(arena);
+    columns.list(c.db, c.error);
+    return_if_error_m(c.error);
+    bool needs_docs = columns.all().empty();
+    if (!needs_docs) {
+        auto column_ids = arena.alloc<ustore_collection_t>(c.docs_count, c.error);
+        return_if_error_m(c.error);
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+            bool found_columns = true;
+            for (ustore_size_t doc_idx = 0; doc_idx != c.docs_count && found_columns; ++doc_idx) {
+                ustore_collection_t collection = collections ? collections[doc_idx] : ustore_collection_main_k;
+                bool same_collection = doc_idx && collections && collection == collections[doc_idx - 1];
+                if (same_collection)
+                    column_ids[doc_idx] = column_ids[doc_idx - 1];
+                else
+                    found_columns = columns.find_column(collection, fields[field_idx], column_ids[doc_idx]);
+            }
+            if (!found_columns) {
+                needs_docs = true;
+                continue;
+            }
+
+            ustore_byte_t* found_cells_begin {};
+            ustore_length_t* found_cells_offs {};
+            ustore_read_t read {};
+            read.db = c.db;
+            read.error = c.error;
+            read.transaction = c.transaction;
+            read.snapshot = c.snapshot;
+            read.arena = arena;
+            read.options = c.options;
+            read.tasks_count = c.docs_count;
+            read.collections = column_ids.begin();
+            read.collections_stride = sizeof(ustore_collection_t);
+            read.keys = c.keys;
+            read.keys_stride = c.keys_stride;
+            read.offsets = &found_cells_offs;
+            read.values = &found_cells_begin;
+            ustore_read(&read);
+            return_if_error_m(c.error);
+            cached[field_idx] = true;
+            cached_cells[field_idx] = joined_blobs_t {c.docs_count, found_cells_offs, found_cells_begin};
+        }
+    }
+
+    // Fields of default types take the types, suggested by the catalogs of collections of the documents
+    auto resolved_types = arena.alloc<ustore_doc_field_type_t>(c.fields_count, c.error);
+    return_if_error_m(c.error);
+    uninitialized_array_gt<ustore_collection_t> catalogs(arena);
+    bool listed_catalogs = false;
+    for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        resolved_types[field_idx] = types ? types[field_idx] : ustore_doc_field_default_k;
+        if (resolved_types[field_idx] != ustore_doc_field_default_k)
+            continue;
+        for (ustore_size_t doc_idx = 0; doc_idx != c.docs_count && !listed_catalogs && columns.has_catalogs();
+             ++doc_idx) {
+            ustore_collection_t collection = collections ? collections[doc_idx] : ustore_collection_main_k;
+            ustore_collection_t catalog = ustore_collection_main_k;
+            if (!columns.find_catalog(collection, catalog) ||
+                std::find(catalogs.begin(), catalogs.end(), catalog) != catalogs.end())
+                continue;
+            catalogs.push_back(catalog, c.error);
+            return_if_error_m(c.error);
+        }
+        listed_catalogs = true;
+        resolved_types[field_idx] =
+            cataloged_type(c, {catalogs.begin(), catalogs.end()}, fields[field_idx], arena, c.error);
+        return_if_error_m(c.error);
+    }
+    types = {resolved_types.begin(), sizeof(ustore_doc_field_type_t)};
+    if (c.columns_types)
+        *c.columns_types = resolved_types.begin();
+
+    // Retrieve the entire documents before we can sample internal fields
+    joined_blobs_t found_binaries;
+    if (needs_docs) {
+        ustore_byte_t* found_binary_begin {};
+        ustore_length_t* found_binary_offs {};
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = c.error;
+        read.transaction = c.transaction;
+        read.snapshot = c.snapshot;
+        read.arena = arena;
+        read.options = c.options;
+        read.tasks_count = c.docs_count;
+        read.collections = c.collections;
+        read.collections_stride = c.collections_stride;
+        read.keys = c.keys;
+        read.keys_stride = c.keys_stride;
+        read.offsets = &found_binary_offs;
+        read.values = &found_binary_begin;
+
+        read_docs(read, arena);
+        return_if_error_m(c.error);
+        found_binaries = joined_blobs_t {c.docs_count, found_binary_offs, found_binary_begin};
+    }
 
     // Estimate the amount of memory needed to store at least scalars and columns addresses
     // TODO: Align offsets of bitmaps to 64-byte boundaries for Arrow
@@ -2126,61 +4857,925 @@ void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
     }
 
     // Go though all the documents extracting and type-checking the relevant parts
-    printed_number_buffer_t print_buffer;
+    auto gather_docs = [&](std::size_t begin,
+                           std::size_t end,
+                           linked_memory_lock_t& memory,
+                           string_t& string_tape,
+                           ustore_error_t* c_error) noexcept {
+        printed_number_buffer_t print_buffer;
+        for (ustore_size_t doc_idx = begin; doc_idx != end; ++doc_idx) {
+            json_t doc;
+            yyjson_val* root = nullptr;
+            packed_doc_view_t packed;
+            bool is_packed = false;
+            if (needs_docs) {
+                value_view_t binary_doc = found_binaries[doc_idx];
+                is_packed = is_packed_doc(binary_doc);
+                if (is_packed) {
+                    bool valid = unpack_view(binary_doc, packed);
+                    return_error_if_m(valid, c_error, consistency_k, "Corrupted packed document");
+                }
+                else {
+                    doc = any_parse(binary_doc, internal_format_k, memory, c_error);
+                    return_if_error_m(c_error);
+                    if (!doc)
+                        continue;
+                    root = yyjson_doc_get_root(doc.handle);
+                }
+            }
+
+            for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+
+                // Find this field within document or its materialized column
+                ustore_doc_field_type_t type = types[field_idx];
+                ustore_str_view_t field = fields[field_idx];
+                yyjson_val cell;
+                yyjson_val* found_value = cached[field_idx] ? load_column_cell(cached_cells[field_idx][doc_idx], cell)
+                                          : is_packed       ? packed_lookup(packed, field, cell, memory, c_error)
+                                                            : json_lookup(root, field);
+                return_if_error_m(c_error);
+                if (cached[field_idx] && !found_value)
+                    continue;
+
+                column_begin_t column {};
+                column.validities = (*c.columns_validities)[field_idx];
+                column.conversions = (*(c.columns_conversions ? c.columns_conversions : c.columns_validities))[field_idx];
+                column.collisions = (*(c.columns_collisions ? c.columns_collisions : c.columns_validities))[field_idx];
+                column.scalars = addresses_scalars[field_idx];
+                column.str_offsets = addresses_offs[field_idx];
+                column.str_lengths = addresses_lens[field_idx];
+
+                bool is_last = doc_idx == c.docs_count - 1;
+                // Export the types
+                switch (type) {
+
+                case ustore_doc_field_bool_k: column.set<bool>(doc_idx, found_value); break;
+
+                case ustore_doc_field_i8_k: column.set<std::int8_t>(doc_idx, found_value); break;
+                case ustore_doc_field_i16_k: column.set<std::int16_t>(doc_idx, found_value); break;
+                case ustore_doc_field_i32_k: column.set<std::int32_t>(doc_idx, found_value); break;
+                case ustore_doc_field_i64_k: column.set<std::int64_t>(doc_idx, found_value); break;
+
+                case ustore_doc_field_u8_k: column.set<std::uint8_t>(doc_idx, found_value); break;
+                case ustore_doc_field_u16_k: column.set<std::uint16_t>(doc_idx, found_value); break;
+                case ustore_doc_field_u32_k: column.set<std::uint32_t>(doc_idx, found_value); break;
+                case ustore_doc_field_u64_k: column.set<std::uint64_t>(doc_idx, found_value); break;
+
+                case ustore_doc_field_f32_k: column.set<float>(doc_idx, found_value); break;
+                case ustore_doc_field_f64_k: column.set<double>(doc_idx, found_value); break;
+
+                case ustore_doc_field_str_k:
+                    column.set_str(doc_idx, found_value, print_buffer, string_tape, true, is_last, c_error);
+                    break;
+                case ustore_doc_field_bin_k:
+                    column.set_str(doc_idx, found_value, print_buffer, string_tape, false, is_last, c_error);
+                    break;
+
+                default: break;
+                }
+            }
+        }
+    };
+
+    // Large batches can be split between threads, each exporting strings into a separate tape.
+    // Slices start at multiples of 8 documents, so that different threads never share bitmap bytes.
     string_t string_tape(arena);
-    for (ustore_size_t doc_idx = 0; doc_idx != c.docs_count; ++doc_idx, ++found_binary_it) {
-        value_view_t binary_doc = *found_binary_it;
-        json_t doc = any_parse(binary_doc, internal_format_k, arena, c.error);
+    docs_slices_t slices(c.docs_count, c.threads_count, CHAR_BIT);
+    if (slices.slices == 1)
+        gather_docs(0, c.docs_count, arena, string_tape, c.error);
+    else {
+        slices_memory_t memory(slices.slices, arena, c.error);
+        return_if_error_m(c.error);
+        auto tapes = arena.alloc<std::string_view>(slices.slices, c.error);
+        return_if_error_m(c.error);
+        for_each_docs_slice(slices, [&](std::size_t slice_idx) noexcept {
+            ustore_error_t* slice_error = memory.error(slice_idx);
+            linked_memory_lock_t slice_arena = memory.lock(slice_idx, c.options);
+            if (*slice_error)
+                return;
+            string_t slice_tape(slice_arena);
+            gather_docs(slices.begin(slice_idx), slices.end(slice_idx), slice_arena, slice_tape, slice_error);
+            tapes[slice_idx] = {slice_tape.data(), slice_tape.size()};
+        });
+        memory.export_error(c.error);
         return_if_error_m(c.error);
-        if (!doc)
-            continue;
-        yyjson_val* root = yyjson_doc_get_root(doc.handle);
 
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        // Join the strings, shifting their offsets, including the trailing one
+        for (std::size_t slice_idx = 0; slice_idx != slices.slices && has_string_columns; ++slice_idx) {
+            auto shift = static_cast<ustore_length_t>(string_tape.size());
+            string_tape.insert(string_tape.size(), tapes[slice_idx].begin(), tapes[slice_idx].end(), c.error);
+            return_if_error_m(c.error);
+            std::size_t end = slices.end(slice_idx) + (slice_idx + 1 == slices.slices);
+            for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+                if (ustore_length_t* offsets = addresses_offs[field_idx])
+                    for (std::size_t doc_idx = slices.begin(slice_idx); doc_idx != end; ++doc_idx)
+                        offsets[doc_idx] += shift;
+        }
+    }
 
-            // Find this field within document
-            ustore_doc_field_type_t type = types[field_idx];
-            ustore_str_view_t field = fields[field_idx];
-            yyjson_val* found_value = json_lookup(root, field);
-
-            column_begin_t column {};
-            column.validities = (*c.columns_validities)[field_idx];
-            column.conversions = (*(c.columns_conversions ? c.columns_conversions : c.columns_validities))[field_idx];
-            column.collisions = (*(c.columns_collisions ? c.columns_collisions : c.columns_validities))[field_idx];
-            column.scalars = addresses_scalars[field_idx];
-            column.str_offsets = addresses_offs[field_idx];
-            column.str_lengths = addresses_lens[field_idx];
-
-            bool is_last = doc_idx == c.docs_count - 1;
-            // Export the types
-            switch (type) {
+    *c.joined_strings = reinterpret_cast<ustore_byte_t*>(string_tape.data());
+}
+
+#if !defined(USTORE_FLIGHT_CLIENT) // Remote clients forward this call to the server, see `flight_client.cpp`
 
-            case ustore_doc_field_bool_k: column.set<bool>(doc_idx, found_value); break;
+/**
+ * @brief Number of documents, which keys are scanned and fields are gathered at once during aggregation.
+ */
+constexpr std::size_t aggregate_batch_size_k = 4096;
 
-            case ustore_doc_field_i8_k: column.set<std::int8_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i16_k: column.set<std::int16_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i32_k: column.set<std::int32_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i64_k: column.set<std::int64_t>(doc_idx, found_value); break;
+/**
+ * @brief Running count, sum and bounds of the values of a field in a group of documents.
+ */
+struct aggregate_state_t {
+    std::size_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double value) noexcept {
+        ++count;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
 
-            case ustore_doc_field_u8_k: column.set<std::uint8_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u16_k: column.set<std::uint16_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u32_k: column.set<std::uint32_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u64_k: column.set<std::uint64_t>(doc_idx, found_value); break;
+    double result(ustore_doc_aggregation_t function) const noexcept {
+        double const nan = std::numeric_limits<double>::quiet_NaN();
+        switch (function) {
+        case ustore_doc_aggregate_count_k: return static_cast<double>(count);
+        case ustore_doc_aggregate_sum_k: return sum;
+        case ustore_doc_aggregate_min_k: return count ? min : nan;
+        case ustore_doc_aggregate_max_k: return count ? max : nan;
+        case ustore_doc_aggregate_avg_k: return count ? sum / count : nan;
+        default: return nan;
+        }
+    }
+};
 
-            case ustore_doc_field_f32_k: column.set<float>(doc_idx, found_value); break;
-            case ustore_doc_field_f64_k: column.set<double>(doc_idx, found_value); break;
+/**
+ * @brief States of all the aggregations in every group, ordered by the grouping values.
+ * Documents without those values, or all of them, if there is no grouping, go to the `missing` group.
+ */
+struct aggregate_groups_t {
+    using states_t = std::vector<aggregate_state_t>;
+
+    std::size_t aggregations_count = 0;
+    std::map<std::string, states_t, std::less<>> valued;
+    states_t missing;
+    bool has_missing = false;
+
+    aggregate_state_t* find(std::string_view value) noexcept(false) {
+        auto it = valued.find(value);
+        if (it == valued.end())
+            it = valued.emplace(std::string(value), states_t(aggregations_count)).first;
+        return it->second.data();
+    }
 
-            case ustore_doc_field_str_k:
-                column.set_str(doc_idx, found_value, print_buffer, string_tape, true, is_last, c.error);
-                break;
-            case ustore_doc_field_bin_k:
-                column.set_str(doc_idx, found_value, print_buffer, string_tape, false, is_last, c.error);
-                break;
+    aggregate_state_t* find_missing() noexcept(false) {
+        if (!has_missing)
+            missing.resize(aggregations_count), has_missing = true;
+        return missing.data();
+    }
 
-            default: break;
+    std::size_t size() const noexcept { return valued.size() + has_missing; }
+};
+
+void ustore_docs_aggregate(ustore_docs_aggregate_t* c_ptr) {
+
+    ustore_docs_aggregate_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_aggregate_k, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.results, c.error, args_combo_k, "No outputs requested");
+    return_error_if_m(c.functions || !c.aggregations_count, c.error, args_combo_k, "Missing aggregation functions");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_doc_aggregation_t const> functions {c.functions, c.functions_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+
+    // Every distinct aggregated field is gathered once, as a 64-bit float,
+    // following the grouping field, gathered as a string
+    constexpr std::size_t counted_docs_k = std::numeric_limits<std::size_t>::max();
+    bool const grouped = c.group_by != nullptr;
+    auto columns = arena.alloc<std::size_t>(c.aggregations_count, c.error);
+    return_if_error_m(c.error);
+    uninitialized_array_gt<ustore_str_view_t> gathered_fields(arena);
+    uninitialized_array_gt<ustore_doc_field_type_t> gathered_types(arena);
+    if (grouped) {
+        gathered_fields.push_back(c.group_by, c.error);
+        return_if_error_m(c.error);
+        gathered_types.push_back(ustore_doc_field_str_k, c.error);
+        return_if_error_m(c.error);
+    }
+    for (std::size_t i = 0; i != c.aggregations_count; ++i) {
+        ustore_doc_aggregation_t function = functions[i];
+        ustore_str_view_t field = fields ? fields[i] : nullptr;
+        return_error_if_m(std::size_t(function) <= std::size_t(ustore_doc_aggregate_avg_k),
+                          c.error,
+                          args_wrong_k,
+                          "Unknown aggregation function");
+        return_error_if_m(field || function == ustore_doc_aggregate_count_k,
+                          c.error,
+                          args_combo_k,
+                          "Only counts can skip the field");
+        if (!field) {
+            columns[i] = counted_docs_k;
+            continue;
+        }
+
+        std::size_t column = grouped;
+        while (column != gathered_fields.size() && std::strcmp(gathered_fields[column], field) != 0)
+            ++column;
+        if (column == gathered_fields.size()) {
+            gathered_fields.push_back(field, c.error);
+            return_if_error_m(c.error);
+            gathered_types.push_back(ustore_doc_field_f64_k, c.error);
+            return_if_error_m(c.error);
+        }
+        columns[i] = column;
+    }
+
+    aggregate_groups_t groups;
+    groups.aggregations_count = c.aggregations_count;
+    if (!grouped)
+        safe_section("Aggregating documents", c.error, [&] { groups.find_missing(); });
+    return_if_error_m(c.error);
+
+    // Documents are read in batches into a separate memory, so that only the results accumulate in the `arena`
+    arena_t batch_arena(c.db);
+    auto batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    ustore_key_t min_key = c.min_key ? *c.min_key : std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t max_key = c.max_key ? *c.max_key : std::numeric_limits<ustore_key_t>::max();
+    for (ustore_key_t start_key = min_key; start_key <= max_key;) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c.error);
+        return_if_error_m(c.error);
+
+        ustore_length_t count_limit = static_cast<ustore_length_t>(aggregate_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.snapshot = c.snapshot;
+        scan.arena = batch;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+
+        std::size_t found_count = std::upper_bound(found_keys, found_keys + found_counts[0], max_key) - found_keys;
+        if (!found_count)
+            break;
+
+        ustore_octet_t** validities = nullptr;
+        ustore_byte_t** scalars = nullptr;
+        ustore_length_t** offsets = nullptr;
+        ustore_length_t** lengths = nullptr;
+        ustore_byte_t* strings = nullptr;
+        if (gathered_fields.size()) {
+            ustore_docs_gather_t gather {};
+            gather.db = c.db;
+            gather.error = c.error;
+            gather.transaction = c.transaction;
+            gather.snapshot = c.snapshot;
+            gather.arena = batch;
+            gather.options = batch_options;
+            gather.docs_count = found_count;
+            gather.fields_count = gathered_fields.size();
+            gather.collections = &c.collection;
+            gather.keys = found_keys;
+            gather.keys_stride = sizeof(ustore_key_t);
+            gather.fields = gathered_fields.begin();
+            gather.fields_stride = sizeof(ustore_str_view_t);
+            gather.types = gathered_types.begin();
+            gather.types_stride = sizeof(ustore_doc_field_type_t);
+            gather.threads_count = c.threads_count;
+            gather.columns_validities = &validities;
+            gather.columns_scalars = &scalars;
+            gather.columns_offsets = &offsets;
+            gather.columns_lengths = &lengths;
+            gather.joined_strings = &strings;
+            ustore_docs_gather(&gather);
+            return_if_error_m(c.error);
+        }
+
+        // Reduce the columns in the order of keys, so that sums don't depend on the number of threads
+        safe_section("Aggregating documents", c.error, [&] {
+            for (std::size_t doc_idx = 0; doc_idx != found_count; ++doc_idx) {
+                bool const has_group = grouped && bits_view_t(validities[0])[doc_idx];
+                aggregate_state_t* states =
+                    has_group ? groups.find({(char const*)strings + offsets[0][doc_idx], lengths[0][doc_idx]})
+                              : groups.find_missing();
+                for (std::size_t i = 0; i != c.aggregations_count; ++i) {
+                    std::size_t column = columns[i];
+                    if (column == counted_docs_k)
+                        ++states[i].count;
+                    else if (bits_view_t(validities[column])[doc_idx])
+                        states[i].add(reinterpret_cast<double const*>(scalars[column])[doc_idx]);
+                }
             }
+        });
+        return_if_error_m(c.error);
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != aggregate_batch_size_k || last_key == max_key)
+            break;
+        start_key = last_key + 1;
+    }
+
+    // Export the groups, with their values separated by NULL-terminators, and the results
+    std::size_t const groups_count = groups.size();
+    std::size_t strings_length = 0;
+    for (auto const& [value, states] : groups.valued)
+        strings_length += value.size() + 1;
+    auto exported_offsets = arena.alloc<ustore_length_t>(groups_count + 1, c.error);
+    return_if_error_m(c.error);
+    auto exported_lengths = arena.alloc<ustore_length_t>(groups_count, c.error);
+    return_if_error_m(c.error);
+    auto exported_strings = arena.alloc<ustore_byte_t>(strings_length, c.error);
+    return_if_error_m(c.error);
+    auto exported_counts = arena.alloc<ustore_size_t>(c.counts ? c.aggregations_count * groups_count : 0, c.error);
+    return_if_error_m(c.error);
+    auto exported_results = arena.alloc<double>(c.aggregations_count * groups_count, c.error);
+    return_if_error_m(c.error);
+
+    std::size_t group_idx = 0;
+    auto export_states = [&](aggregate_state_t const* states) noexcept {
+        for (std::size_t i = 0; i != c.aggregations_count; ++i) {
+            exported_results[i * groups_count + group_idx] = states[i].result(functions[i]);
+            if (c.counts)
+                exported_counts[i * groups_count + group_idx] = static_cast<ustore_size_t>(states[i].count);
         }
+    };
+    exported_offsets[0] = 0;
+    for (auto const& [value, states] : groups.valued) {
+        std::memcpy(exported_strings.begin() + exported_offsets[group_idx], value.data(), value.size());
+        exported_strings[exported_offsets[group_idx] + value.size()] = 0;
+        exported_lengths[group_idx] = static_cast<ustore_length_t>(value.size());
+        exported_offsets[group_idx + 1] = static_cast<ustore_length_t>(exported_offsets[group_idx] + value.size() + 1);
+        export_states(states.data());
+        ++group_idx;
+    }
+    if (groups.has_missing) {
+        exported_lengths[group_idx] = ustore_length_missing_k;
+        exported_offsets[group_idx + 1] = exported_offsets[group_idx];
+        export_states(groups.missing.data());
     }
 
-    *c.joined_strings = reinterpret_cast<ustore_byte_t*>(string_tape.data());
+    if (c.groups_count)
+        *c.groups_count = static_cast<ustore_size_t>(groups_count);
+    if (c.groups_offsets)
+        *c.groups_offsets = exported_offsets.begin();
+    if (c.groups_lengths)
+        *c.groups_lengths = exported_lengths.begin();
+    if (c.groups_strings)
+        *c.groups_strings = exported_strings.begin();
+    if (c.counts)
+        *c.counts = exported_counts.begin();
+    *c.results = exported_results.begin();
+}
+
+#endif
+
+void ustore_docs_index_create(ustore_docs_index_create_t* c_ptr) {
+
+    ustore_docs_index_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field && *c.field, c.error, args_wrong_k, "Indexed field is missing");
+    bool numeric = is_numeric_type(c.type);
+    return_error_if_m(numeric || c.type == ustore_doc_field_str_k,
+                      c.error,
+                      args_wrong_k,
+                      "Only numeric and string fields can be indexed");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view index_name = indexes.index_name(c.collection, c.field, index_infix(numeric), c.error);
+    return_if_error_m(c.error);
+    doc_index_t index;
+    return_error_if_m(!indexes.find(index_name, index.index), c.error, args_combo_k, "Index already exists");
+
+    ustore_collection_create_t collection_init {};
+    collection_init.db = c.db;
+    collection_init.error = c.error;
+    collection_init.name = index_name.data();
+    collection_init.config = "";
+    collection_init.id = &index.index;
+    ustore_collection_create(&collection_init);
+    return_if_error_m(c.error);
+    index.collection = c.collection;
+    index.field = index_name.substr(index_name.size() - std::strlen(c.field));
+    index.numeric = numeric;
+
+    index_present_docs(c.db, index, c.options, c.error);
+}
+
+void ustore_docs_index_drop(ustore_docs_index_drop_t* c_ptr) {
+
+    ustore_docs_index_drop_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field && *c.field, c.error, args_wrong_k, "Indexed field is missing");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view index_name = indexes.index_name(c.collection, c.field, index_infix(is_numeric_type(c.type)), c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t index_id = ustore_collection_main_k;
+    return_error_if_m(indexes.find(index_name, index_id), c.error, args_wrong_k, "Index not found");
+
+    ustore_collection_drop_t collection_drop {};
+    collection_drop.db = c.db;
+    collection_drop.error = c.error;
+    collection_drop.id = index_id;
+    collection_drop.mode = ustore_drop_keys_vals_handle_k;
+    ustore_collection_drop(&collection_drop);
+}
+
+void ustore_docs_find(ustore_docs_find_t* c_ptr) {
+
+    ustore_docs_find_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::docs_find_k, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field && *c.field, c.error, args_wrong_k, "Indexed field is missing");
+    return_error_if_m(c.keys, c.error, args_combo_k, "No outputs requested");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    bool numeric = is_numeric_type(c.type);
+    return_error_if_m(numeric || c.type == ustore_doc_field_str_k,
+                      c.error,
+                      args_wrong_k,
+                      "Only numeric and string fields can be indexed");
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view index_name = indexes.index_name(c.collection, c.field, index_infix(numeric), c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t index_id = ustore_collection_main_k;
+    return_error_if_m(indexes.find(index_name, index_id), c.error, args_wrong_k, "Index not found");
+
+    // Numbers define the keys exactly, while strings - only the first bytes
+    ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t max_key = std::numeric_limits<ustore_key_t>::max();
+    std::string_view min_value, max_value;
+    if (numeric) {
+        double min_number = 0, max_number = 0;
+        if (c.min_value) {
+            bool parsed = parse_entire_number(c.min_value, c.min_value + std::strlen(c.min_value), min_number);
+            return_error_if_m(parsed && !std::isnan(min_number), c.error, args_wrong_k, "Lower bound isn't a number");
+            min_key = numeric_index_key(min_number);
+        }
+        if (c.max_value) {
+            bool parsed = parse_entire_number(c.max_value, c.max_value + std::strlen(c.max_value), max_number);
+            return_error_if_m(parsed && !std::isnan(max_number), c.error, args_wrong_k, "Upper bound isn't a number");
+            max_key = numeric_index_key(max_number);
+        }
+    }
+    else {
+        if (c.min_value)
+            min_value = c.min_value, min_key = string_index_key(min_value);
+        if (c.max_value)
+            max_value = c.max_value, max_key = string_index_key(max_value);
+    }
+    auto in_range = [&](index_entry_t const& entry) noexcept {
+        return numeric || ((!c.min_value || entry.value >= min_value) && (!c.max_value || entry.value <= max_value));
+    };
+
+    // Entries are read in batches into a separate memory, so that only the results accumulate in the `arena`
+    uninitialized_array_gt<ustore_key_t> found(arena);
+    arena_t batch_arena(c.db);
+    auto batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    for (ustore_key_t start_key = min_key; start_key <= max_key;) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c.error);
+        return_if_error_m(c.error);
+
+        ustore_length_t count_limit = static_cast<ustore_length_t>(index_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.snapshot = c.snapshot;
+        scan.arena = batch;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &index_id;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+
+        std::size_t found_count = std::upper_bound(found_keys, found_keys + found_counts[0], max_key) - found_keys;
+        if (!found_count)
+            break;
+
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = c.error;
+        read.transaction = c.transaction;
+        read.snapshot = c.snapshot;
+        read.arena = batch;
+        read.options = batch_options;
+        read.tasks_count = found_count;
+        read.collections = &index_id;
+        read.keys = found_keys;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        ustore_read(&read);
+        return_if_error_m(c.error);
+
+        for (std::size_t i = 0; i != found_count; ++i) {
+            if (found_lengths[i] == ustore_length_missing_k)
+                continue;
+            bool valid = for_each_index_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                                              [&](index_entry_t const& entry) {
+                                                  if (in_range(entry))
+                                                      found.push_back(entry.doc_key, c.error);
+                                              });
+            return_error_if_m(valid, c.error, consistency_k, "Corrupted index entry");
+            return_if_error_m(c.error);
+        }
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != index_batch_size_k || last_key == max_key)
+            break;
+        start_key = last_key + 1;
+    }
+
+    if (c.count)
+        *c.count = static_cast<ustore_size_t>(found.size());
+    *c.keys = found.begin();
+}
+
+void ustore_docs_column_create(ustore_docs_column_create_t* c_ptr) {
+
+    ustore_docs_column_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field && *c.field, c.error, args_wrong_k, "Materialized field is missing");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view column_name = indexes.index_name(c.collection, c.field, column_infix_k, c.error);
+    return_if_error_m(c.error);
+    doc_index_t column;
+    return_error_if_m(!indexes.find(column_name, column.index), c.error, args_combo_k, "Column already exists");
+
+    ustore_collection_create_t collection_init {};
+    collection_init.db = c.db;
+    collection_init.error = c.error;
+    collection_init.name = column_name.data();
+    collection_init.config = "";
+    collection_init.id = &column.index;
+    ustore_collection_create(&collection_init);
+    return_if_error_m(c.error);
+    column.collection = c.collection;
+    column.field = column_name.substr(column_name.size() - std::strlen(c.field));
+    column.column = true;
+    index_present_docs(c.db, column, c.options, c.error);
+}
+
+void ustore_docs_column_drop(ustore_docs_column_drop_t* c_ptr) {
+
+    ustore_docs_column_drop_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field && *c.field, c.error, args_wrong_k, "Materialized field is missing");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view column_name = indexes.index_name(c.collection, c.field, column_infix_k, c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t column_id = ustore_collection_main_k;
+    return_error_if_m(indexes.find(column_name, column_id), c.error, args_wrong_k, "Column not found");
+
+    ustore_collection_drop_t collection_drop {};
+    collection_drop.db = c.db;
+    collection_drop.error = c.error;
+    collection_drop.id = column_id;
+    collection_drop.mode = ustore_drop_keys_vals_handle_k;
+    ustore_collection_drop(&collection_drop);
+}
+
+void ustore_docs_storage_set(ustore_docs_storage_set_t* c_ptr) {
+
+    ustore_docs_storage_set_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.storage == ustore_doc_storage_json_k || c.storage == ustore_doc_storage_packed_k,
+                      c.error,
+                      args_wrong_k,
+                      "Unknown storage form");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view marker_name = indexes.index_name(c.collection, {}, packed_storage_suffix_k, c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t marker = ustore_collection_main_k;
+    bool was_packed = indexes.find(marker_name, marker);
+    bool pack = c.storage == ustore_doc_storage_packed_k;
+    if (was_packed == pack)
+        return;
+
+    // The marker changes first, so that the documents, written concurrently, already take the new form
+    if (pack) {
+        ustore_collection_create_t collection_init {};
+        collection_init.db = c.db;
+        collection_init.error = c.error;
+        collection_init.name = marker_name.data();
+        collection_init.config = "";
+        collection_init.id = &marker;
+        ustore_collection_create(&collection_init);
+    }
+    else {
+        ustore_collection_drop_t collection_drop {};
+        collection_drop.db = c.db;
+        collection_drop.error = c.error;
+        collection_drop.id = marker;
+        collection_drop.mode = ustore_drop_keys_vals_handle_k;
+        ustore_collection_drop(&collection_drop);
+    }
+    return_if_error_m(c.error);
+    ustore_collection_t dictionaries = ustore_collection_main_k;
+    bool compressed = indexes.find_dictionaries(c.collection, dictionaries);
+    convert_present_docs(c.db, c.collection, pack, compressed ? &dictionaries : nullptr, c.options, c.error);
+}
+
+void ustore_docs_compression_set(ustore_docs_compression_set_t* c_ptr) {
+
+    ustore_docs_compression_set_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view dictionaries_name = indexes.index_name(c.collection, {}, dictionaries_suffix_k, c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t dictionaries = ustore_collection_main_k;
+    bool was_compressed = indexes.find(dictionaries_name, dictionaries);
+    bool pack = indexes.packed(c.collection);
+
+    // Removing the active dictionary first stops the compression of concurrent writes,
+    // while the old dictionaries are still needed for reads, until the documents are converted
+    if (!c.samples_count) {
+        if (!was_compressed)
+            return;
+        write_task_t deactivation;
+        deactivation.collection = dictionaries;
+        deactivation.key = active_dictionary_key_k;
+        write_tasks(c.db,
+                    nullptr,
+                    ustore_option_dont_discard_memory_k,
+                    {&deactivation, &deactivation + 1},
+                    arena,
+                    c.error);
+        return_if_error_m(c.error);
+        bump_collections_epoch();
+        convert_present_docs(c.db, c.collection, pack, &dictionaries, c.options, c.error);
+        return_if_error_m(c.error);
+
+        ustore_collection_drop_t collection_drop {};
+        collection_drop.db = c.db;
+        collection_drop.error = c.error;
+        collection_drop.id = dictionaries;
+        collection_drop.mode = ustore_drop_keys_vals_handle_k;
+        ustore_collection_drop(&collection_drop);
+        return;
+    }
+
+    // Sample the documents in the form, in which they will be compressed
+    ustore_length_t samples_limit = static_cast<ustore_length_t>(c.samples_count);
+    ustore_length_t* found_counts = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_sample_t sample {};
+    sample.db = c.db;
+    sample.error = c.error;
+    sample.arena = arena;
+    sample.options = ustore_options_t(ustore_option_dont_discard_memory_k | ustore_option_sample_approximate_k);
+    sample.tasks_count = 1;
+    sample.collections = &c.collection;
+    sample.count_limits = &samples_limit;
+    sample.counts = &found_counts;
+    sample.keys = &found_keys;
+    ustore_sample(&sample);
+    return_if_error_m(c.error);
+    std::size_t found_count = found_counts[0];
+    return_error_if_m(found_count, c.error, args_wrong_k, "No documents to train the dictionary on");
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c.error;
+    read.arena = arena;
+    read.options = ustore_option_dont_discard_memory_k;
+    read.tasks_count = found_count;
+    read.collections = &c.collection;
+    read.keys = found_keys;
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    read_docs(read, arena);
+    return_if_error_m(c.error);
+
+    growing_tape_t samples {arena};
+    samples.reserve(found_count, c.error);
+    return_if_error_m(c.error);
+    auto samples_lengths = arena.alloc<std::size_t>(found_count, c.error);
+    return_if_error_m(c.error);
+    std::size_t samples_count = 0;
+    for (std::size_t i = 0; i != found_count; ++i) {
+        if (found_lengths[i] == ustore_length_missing_k || !found_lengths[i])
+            continue;
+        value_view_t doc {found_values + found_offsets[i], found_lengths[i]};
+        if (is_packed_doc(doc) != pack)
+            doc = pack ? pack_doc(doc, arena, c.error) : packed_to_json(doc, nullptr, arena, c.error);
+        return_if_error_m(c.error);
+        samples.push_back(doc, c.error);
+        return_if_error_m(c.error);
+        samples_lengths[samples_count++] = doc.size();
+    }
+
+    std::size_t dictionary_capacity = c.dictionary_size ? c.dictionary_size : default_dictionary_size_k;
+    auto dictionary = arena.alloc<byte_t>(dictionary_capacity, c.error);
+    return_if_error_m(c.error);
+    std::size_t dictionary_length = ZDICT_trainFromBuffer( //
+        dictionary.begin(),
+        dictionary_capacity,
+        samples.contents().begin().get(),
+        samples_lengths.begin(),
+        static_cast<unsigned>(samples_count));
+    return_error_if_m(!ZDICT_isError(dictionary_length),
+                      c.error,
+                      args_wrong_k,
+                      "Failed to train the dictionary, sample more documents");
+    auto dictionary_key = static_cast<ustore_key_t>(ZDICT_getDictID(dictionary.begin(), dictionary_length));
+
+    if (!was_compressed) {
+        ustore_collection_create_t collection_init {};
+        collection_init.db = c.db;
+        collection_init.error = c.error;
+        collection_init.name = dictionaries_name.data();
+        collection_init.config = "";
+        collection_init.id = &dictionaries;
+        ustore_collection_create(&collection_init);
+        return_if_error_m(c.error);
+    }
+
+    // The dictionary is stored under its ID before it's activated, so that every written frame can be decompressed
+    write_task_t dictionary_tasks[2];
+    for (ustore_key_t key : {dictionary_key, active_dictionary_key_k}) {
+        write_task_t& task = dictionary_tasks[key == active_dictionary_key_k];
+        task.collection = dictionaries;
+        task.key = key;
+        task.value = reinterpret_cast<ustore_bytes_cptr_t>(dictionary.begin());
+        task.length = static_cast<ustore_length_t>(dictionary_length);
+    }
+    write_tasks(c.db,
+                nullptr,
+                ustore_option_dont_discard_memory_k,
+                {dictionary_tasks, dictionary_tasks + 2},
+                arena,
+                c.error);
+    return_if_error_m(c.error);
+    bump_collections_epoch();
+    convert_present_docs(c.db, c.collection, pack, &dictionaries, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Once all the documents are recompressed, the previously trained dictionaries can be removed
+    ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_length_t dictionaries_limit = static_cast<ustore_length_t>(index_batch_size_k);
+    ustore_scan_t scan {};
+    scan.db = c.db;
+    scan.error = c.error;
+    scan.arena = arena;
+    scan.options = ustore_option_dont_discard_memory_k;
+    scan.tasks_count = 1;
+    scan.collections = &dictionaries;
+    scan.start_keys = &start_key;
+    scan.count_limits = &dictionaries_limit;
+    scan.counts = &found_counts;
+    scan.keys = &found_keys;
+    ustore_scan(&scan);
+    return_if_error_m(c.error);
+
+    uninitialized_array_gt<write_task_t> removals(arena);
+    for (std::size_t i = 0; i != found_counts[0]; ++i) {
+        if (found_keys[i] == active_dictionary_key_k || found_keys[i] == dictionary_key)
+            continue;
+        write_task_t removal;
+        removal.collection = dictionaries;
+        removal.key = found_keys[i];
+        removals.push_back(removal, c.error);
+        return_if_error_m(c.error);
+    }
+    write_tasks(c.db, nullptr, ustore_option_dont_discard_memory_k, {removals.begin(), removals.end()}, arena, c.error);
+}
+
+void ustore_docs_catalog_set(ustore_docs_catalog_set_t* c_ptr) {
+
+    ustore_docs_catalog_set_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    doc_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view catalog_name = indexes.index_name(c.collection, {}, catalog_suffix_k, c.error);
+    return_if_error_m(c.error);
+    doc_index_t catalog;
+    bool was_enabled = indexes.find(catalog_name, catalog.index);
+    if (was_enabled == c.enabled)
+        return;
+
+    if (!c.enabled) {
+        ustore_collection_drop_t collection_drop {};
+        collection_drop.db = c.db;
+        collection_drop.error = c.error;
+        collection_drop.id = catalog.index;
+        collection_drop.mode = ustore_drop_keys_vals_handle_k;
+        ustore_collection_drop(&collection_drop);
+        return;
+    }
+
+    // The catalog is created first, so that the documents, written concurrently, are already counted
+    ustore_collection_create_t collection_init {};
+    collection_init.db = c.db;
+    collection_init.error = c.error;
+    collection_init.name = catalog_name.data();
+    collection_init.config = "";
+    collection_init.id = &catalog.index;
+    ustore_collection_create(&collection_init);
+    return_if_error_m(c.error);
+    catalog.collection = c.collection;
+    catalog.catalog = true;
+
+    auto batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    rewrite_present_docs(c.db,
+                         c.collection,
+                         c.options,
+                         c.error,
+                         [&](ptr_range_gt<collection_key_t const> places,
+                             auto const& found_doc,
+                             uninitialized_array_gt<write_task_t>& tasks,
+                             linked_memory_lock_t& batch,
+                             ustore_error_t* c_error) noexcept {
+                             uninitialized_array_gt<catalog_update_t> updates(batch);
+                             collect_catalog_updates(
+                                 {&catalog, &catalog + 1},
+                                 places,
+                                 [](std::size_t) { return value_view_t {}; },
+                                 found_doc,
+                                 updates,
+                                 batch,
+                                 c_error);
+                             return_if_error_m(c_error);
+                             apply_catalog_updates(c.db,
+                                                   nullptr,
+                                                   batch_options,
+                                                   {updates.begin(), updates.end()},
+                                                   tasks,
+                                                   batch,
+                                                   c_error);
+                         });
 }
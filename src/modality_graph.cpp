@@ -10,15 +10,42 @@
  * - output degree
  * - inbound neighborships: neighbor ID + edge ID
  * - outbound neighborships: neighbor ID + edge ID
+ *
+ * Neighborships are either stored plainly, or delta-encoded and bit-packed.
+ * Packed entries are decoded into the plain layout right after being read,
+ * so all the updates operate on the plain layout only.
+ * @see `ustore_graph_encoding_t`.
+ *
+ * High-degree vertices also get delta segments in a companion collection,
+ * named like the original one, but with a ".deltas" suffix. New neighborships
+ * of such vertices are appended to the segment, so upserting an edge doesn't
+ * rewrite the whole adjacency list. Once the segment outgrows a threshold,
+ * proportional to the square root of the vertex degree, it is merged back.
+ * Readers merge segments on the fly, so they are invisible outside this file.
+ *
+ * Even higher-degree vertices are split into buckets of neighbor ID ranges,
+ * stored in a ".buckets" companion collection. The original entry then keeps
+ * only the total degrees and a directory of buckets, so updates only rewrite
+ * the buckets they touch, and range-limited lookups only read the relevant ones.
  */
 
-#include <numeric>  // `std::accumulate`
-#include <optional> // `std::optional`
-#include <limits>   // `std::numeric_limits`
+#include <atomic>      // `std::atomic`
+#include <numeric>     // `std::accumulate`
+#include <optional>    // `std::optional`
+#include <climits>     // `CHAR_BIT`
+#include <cmath>       // `std::sqrt`
+#include <limits>      // `std::numeric_limits`
+#include <string_view> // `std::string_view`
+#include <thread>      // `std::thread`
+#include <vector>      // `std::vector`
 
 #include "ustore/ustore.hpp"
-#include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
-#include "helpers/algorithm.hpp"     // `equal_subrange`
+#include "helpers/linked_memory.hpp"         // `linked_memory_lock_t`
+#include "helpers/linked_array.hpp"          // `uninitialized_array_gt`
+#include "helpers/algorithm.hpp"             // `equal_subrange`
+#include "helpers/integer_packing.hpp"       // `pack_integers`
+#include "helpers/metrics.hpp"               // `metered_call_t`
+#include "helpers/collection_companions.hpp" // `graph_deltas_suffix_k`
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -36,6 +63,16 @@ struct updated_entry_t : public collection_key_t {
     ustore_bytes_ptr_t content = nullptr;
     ustore_length_t length = ustore_length_missing_k;
     ustore_vertex_degree_t degree_delta = 0;
+    bool packed = false;
+    /** @brief Set for vertices, that may have a delta segment. */
+    bool delta = false;
+    /** @brief The part of `content`, stored in the main collection, if `delta` is set. */
+    ustore_bytes_ptr_t base_content = nullptr;
+    ustore_length_t base_length = ustore_length_missing_k;
+    /** @brief Set for vertices, which `content` is a directory of buckets. */
+    bool sharded = false;
+    /** @brief Set for the buckets of sharded vertices. */
+    bool bucket = false;
     inline operator value_view_t() const noexcept { return {content, length}; }
 };
 
@@ -63,6 +100,936 @@ ptr_range_gt<neighborship_t const> neighbors(value_view_t bytes, ustore_vertex_r
     return neighbors(degrees, reinterpret_cast<ustore_key_t const*>(degrees + 2), role);
 }
 
+/*********************************************************/
+/*****************	 Packed Neighborhoods ****************/
+/*********************************************************/
+
+/**
+ * @brief Marks packed entries in the top bit of the outbound degree,
+ * so that the degrees can be parsed without decoding the neighborships.
+ */
+constexpr ustore_vertex_degree_t packed_degree_flag_k = ustore_vertex_degree_t(1)
+                                                        << (sizeof(ustore_vertex_degree_t) * CHAR_BIT - 1);
+
+/**
+ * @brief Marks vertices, that may have a delta segment, in the top bit of the inbound degree.
+ */
+constexpr ustore_vertex_degree_t delta_degree_flag_k = packed_degree_flag_k;
+
+/**
+ * @brief Marks vertices, split into buckets, in the second top bit of the inbound degree.
+ */
+constexpr ustore_vertex_degree_t sharded_degree_flag_k = delta_degree_flag_k >> 1;
+constexpr ustore_vertex_degree_t inbound_flags_k = delta_degree_flag_k | sharded_degree_flag_k;
+
+bool is_packed(value_view_t bytes) noexcept {
+    if (bytes.size() < bytes_in_degrees_header_k)
+        return false;
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin());
+    return degrees[0] & packed_degree_flag_k;
+}
+
+/**
+ * @brief Parses the degree from the header of either a plain or a packed entry.
+ */
+ustore_vertex_degree_t degree_of(value_view_t bytes, ustore_vertex_role_t role) noexcept {
+    if (bytes.size() < bytes_in_degrees_header_k)
+        return 0;
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin());
+    auto outbound = degrees[0] & ~packed_degree_flag_k;
+    auto inbound = degrees[1] & ~inbound_flags_k;
+    switch (role) {
+    case ustore_vertex_source_k: return outbound;
+    case ustore_vertex_target_k: return inbound;
+    case ustore_vertex_role_any_k: return outbound + inbound;
+    default: return 0;
+    }
+}
+
+std::size_t unpacked_size(value_view_t packed) noexcept {
+    return bytes_in_degrees_header_k + degree_of(packed, ustore_vertex_role_any_k) * sizeof(neighborship_t);
+}
+
+/**
+ * @brief Packed entries are padded to keep the following entries on tapes aligned, like the plain ones.
+ */
+constexpr std::size_t packed_alignment_k = sizeof(ustore_key_t);
+
+std::size_t packed_size_bound(value_view_t unpacked) noexcept {
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(unpacked.begin());
+    auto streams_bound = (packed_integers_bound(degrees[0]) + packed_integers_bound(degrees[1])) * 2u;
+    return bytes_in_degrees_header_k + streams_bound + packed_alignment_k;
+}
+
+/**
+ * @brief Encodes every role into two streams: deltas between sorted neighbor IDs,
+ * and zigzag-encoded deltas between edge IDs, that are only sorted within the same neighbor.
+ * @return The size of the packed entry.
+ */
+std::size_t pack_neighborhood(value_view_t unpacked, byte_t* packed) noexcept {
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(unpacked.begin());
+    auto ships = reinterpret_cast<neighborship_t const*>(degrees + 2);
+    auto packed_degrees = reinterpret_cast<ustore_vertex_degree_t*>(packed);
+    packed_degrees[0] = degrees[0] | packed_degree_flag_k;
+    packed_degrees[1] = degrees[1];
+
+    auto output = reinterpret_cast<std::uint8_t*>(packed) + bytes_in_degrees_header_k;
+    for (std::size_t role_idx = 0; role_idx != 2; ++role_idx) {
+        neighborship_t const* role_ships = ships + (role_idx ? degrees[0] : 0u);
+        auto neighbor_delta = [=](std::size_t i) noexcept {
+            return i ? std::uint64_t(role_ships[i].neighbor_id) - std::uint64_t(role_ships[i - 1].neighbor_id)
+                     : zigzag_encode(role_ships[0].neighbor_id);
+        };
+        auto edge_delta = [=](std::size_t i) noexcept {
+            auto previous = i ? std::uint64_t(role_ships[i - 1].edge_id) : 0u;
+            return zigzag_encode(static_cast<std::int64_t>(std::uint64_t(role_ships[i].edge_id) - previous));
+        };
+        output = pack_integers(degrees[role_idx], neighbor_delta, output);
+        output = pack_integers(degrees[role_idx], edge_delta, output);
+    }
+    std::size_t size = output - reinterpret_cast<std::uint8_t*>(packed);
+    std::size_t padding = (packed_alignment_k - size % packed_alignment_k) % packed_alignment_k;
+    std::fill_n(output, padding, std::uint8_t(0));
+    return size + padding;
+}
+
+/**
+ * @brief Decodes a packed entry into `unpacked_size()` bytes of the plain layout.
+ * @return false If the entry is corrupted.
+ */
+bool unpack_neighborhood(value_view_t packed, byte_t* unpacked) noexcept {
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(unpacked);
+    auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
+    degrees[0] = degree_of(packed, ustore_vertex_source_k);
+    degrees[1] = degree_of(packed, ustore_vertex_target_k);
+
+    auto input = reinterpret_cast<std::uint8_t const*>(packed.begin()) + bytes_in_degrees_header_k;
+    auto input_end = reinterpret_cast<std::uint8_t const*>(packed.end());
+    for (std::size_t role_idx = 0; role_idx != 2 && input; ++role_idx) {
+        neighborship_t* role_ships = ships + (role_idx ? degrees[0] : 0u);
+        auto neighbor_id = std::uint64_t(0);
+        input = unpack_integers(input, input_end, degrees[role_idx], [&](std::size_t i, std::uint64_t delta) noexcept {
+            neighbor_id = i ? neighbor_id + delta : static_cast<std::uint64_t>(zigzag_decode(delta));
+            role_ships[i].neighbor_id = static_cast<ustore_key_t>(neighbor_id);
+        });
+        if (!input)
+            break;
+        auto edge_id = std::uint64_t(0);
+        input = unpack_integers(input, input_end, degrees[role_idx], [&](std::size_t i, std::uint64_t delta) noexcept {
+            edge_id += static_cast<std::uint64_t>(zigzag_decode(delta));
+            role_ships[i].edge_id = static_cast<ustore_key_t>(edge_id);
+        });
+    }
+    return input && static_cast<std::size_t>(input_end - input) < packed_alignment_k;
+}
+
+/**
+ * @brief Replaces packed entries with their plain copies in the `arena`,
+ * and moves the delta flags from the headers into `updated_entry_t::delta`.
+ * @param decode_all Whether to decode the packed entries without delta segments.
+ */
+void unpack_entries(strided_range_gt<updated_entry_t> entries,
+                    bool decode_all,
+                    linked_memory_lock_t& arena,
+                    ustore_error_t* c_error) {
+    auto should_unpack = [=](updated_entry_t const& entry) noexcept {
+        return entry.length != ustore_length_missing_k && is_packed(entry) && (decode_all || entry.delta);
+    };
+    std::size_t total_size = 0;
+    for (updated_entry_t& entry : entries) {
+        if (entry.length == ustore_length_missing_k || entry.length < bytes_in_degrees_header_k)
+            continue;
+        auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(entry.content);
+        entry.delta = degrees[1] & delta_degree_flag_k;
+        entry.sharded = degrees[1] & sharded_degree_flag_k;
+        if (!is_packed(entry))
+            degrees[1] &= ~delta_degree_flag_k;
+        else if (should_unpack(entry))
+            total_size += unpacked_size(entry);
+    }
+    if (!total_size)
+        return;
+
+    auto buffer = arena.alloc<byte_t>(total_size, c_error);
+    return_if_error_m(c_error);
+    byte_t* output = buffer.begin();
+    for (updated_entry_t& entry : entries) {
+        if (!should_unpack(entry))
+            continue;
+        auto size = unpacked_size(entry);
+        return_error_if_m(unpack_neighborhood(entry, output), c_error, consistency_k, "Corrupted graph entry");
+        entry.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+        entry.length = static_cast<ustore_length_t>(size);
+        entry.packed = true;
+        output += size;
+    }
+}
+
+/**
+ * @brief Encodes the updated entries, that were packed before or are requested to be packed.
+ */
+void pack_entries(strided_range_gt<updated_entry_t> entries,
+                  bool pack_all,
+                  linked_memory_lock_t& arena,
+                  ustore_error_t* c_error) {
+    auto should_pack = [=](updated_entry_t const& entry) noexcept {
+        return entry.length != ustore_length_missing_k && entry.length >= bytes_in_degrees_header_k &&
+               !entry.sharded && (pack_all || entry.packed);
+    };
+    std::size_t total_size = 0;
+    for (updated_entry_t const& entry : entries)
+        if (should_pack(entry))
+            total_size += packed_size_bound(entry);
+    if (!total_size)
+        return;
+
+    auto buffer = arena.alloc<byte_t>(total_size, c_error);
+    return_if_error_m(c_error);
+    byte_t* output = buffer.begin();
+    for (updated_entry_t& entry : entries) {
+        if (!should_pack(entry))
+            continue;
+        auto size = pack_neighborhood(entry, output);
+        entry.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+        entry.length = static_cast<ustore_length_t>(size);
+        output += size;
+    }
+}
+
+/*********************************************************/
+/*****************	   Delta Segments	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Vertices with fewer neighborships are always rewritten in full.
+ */
+constexpr std::size_t delta_min_degree_k = 256;
+constexpr std::string_view deltas_suffix_k = graph_deltas_suffix_k;
+
+bool has_delta(value_view_t bytes) noexcept {
+    if (bytes.size() < bytes_in_degrees_header_k)
+        return false;
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin());
+    return degrees[1] & delta_degree_flag_k;
+}
+
+/**
+ * @brief Maximum number of neighborships in a delta segment, before it's merged into the base entry.
+ * Balances rewriting the segment on every append against rewriting the base entry on every merge.
+ */
+std::size_t delta_capacity(std::size_t base_degree) noexcept {
+    return std::max<std::size_t>(32u, static_cast<std::size_t>(2.0 * std::sqrt(double(base_degree))));
+}
+
+/**
+ * @brief Resolves the companion collections, named like the original ones with a suffix,
+ * listing the collections at most once.
+ */
+class companion_collections_t {
+    ustore_database_t db_ = nullptr;
+    std::string_view suffix_;
+    linked_memory_lock_t& arena_;
+    ustore_error_t* error_ = nullptr;
+
+    ustore_size_t count_ = 0;
+    ustore_collection_t* ids_ = nullptr;
+    ustore_length_t* offsets_ = nullptr;
+    ustore_char_t* names_ = nullptr;
+    bool listed_ = false;
+
+    ustore_collection_t last_collection_ = ustore_collection_main_k;
+    ustore_collection_t last_companion_ = ustore_collection_main_k;
+    bool last_found_ = false;
+    bool last_valid_ = false;
+
+  public:
+    companion_collections_t(ustore_database_t db,
+                            std::string_view suffix,
+                            linked_memory_lock_t& arena,
+                            ustore_error_t* error) noexcept
+        : db_(db), suffix_(suffix), arena_(arena), error_(error) {}
+
+    /**
+     * @return true If the companion of `collection` exists or was created.
+     */
+    bool find(ustore_collection_t collection, bool create, ustore_collection_t& companion_id) noexcept {
+        if (last_valid_ && last_collection_ == collection && (last_found_ || !create)) {
+            companion_id = last_companion_;
+            return last_found_;
+        }
+
+        if (!listed_) {
+            ustore_collection_list_t list {};
+            list.db = db_;
+            list.error = error_;
+            list.arena = arena_;
+            list.options = ustore_option_dont_discard_memory_k;
+            list.count = &count_;
+            list.ids = &ids_;
+            list.offsets = &offsets_;
+            list.names = &names_;
+            ustore_collection_list(&list);
+            if (*error_)
+                return false;
+            listed_ = true;
+        }
+
+        std::string_view name;
+        if (collection != ustore_collection_main_k) {
+            auto it = std::find(ids_, ids_ + count_, collection);
+            if (it == ids_ + count_)
+                return false;
+            name = names_ + offsets_[it - ids_];
+        }
+
+        auto companion = arena_.alloc<char>(name.size() + suffix_.size() + 1u, error_);
+        if (*error_)
+            return false;
+        std::copy(name.begin(), name.end(), companion.begin());
+        std::copy(suffix_.begin(), suffix_.end(), companion.begin() + name.size());
+        companion[companion.size() - 1u] = '\0';
+        std::string_view companion_name {companion.begin(), companion.size() - 1u};
+
+        last_collection_ = collection;
+        last_valid_ = true;
+        last_found_ = false;
+        for (std::size_t i = 0; i != count_ && !last_found_; ++i)
+            if (companion_name == std::string_view(names_ + offsets_[i]))
+                last_companion_ = ids_[i], last_found_ = true;
+
+        if (!last_found_ && create) {
+            ustore_collection_create_t collection_init {};
+            collection_init.db = db_;
+            collection_init.error = error_;
+            collection_init.name = companion.begin();
+            collection_init.config = "";
+            collection_init.id = &last_companion_;
+            ustore_collection_create(&collection_init);
+            if (*error_)
+                return false;
+            last_found_ = true;
+            listed_ = false;
+        }
+
+        companion_id = last_companion_;
+        return last_found_;
+    }
+};
+
+/**
+ * @brief Merges the delta segments into the plain `entries` with the `delta` flag,
+ * remembering the parts from the main collection in `updated_entry_t::base_content`.
+ */
+void merge_deltas( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    strided_range_gt<updated_entry_t> entries,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    std::size_t delta_count = 0;
+    for (updated_entry_t& entry : entries) {
+        if (!entry.delta)
+            continue;
+        entry.base_content = entry.content;
+        entry.base_length = entry.length;
+        ++delta_count;
+    }
+    if (!delta_count)
+        return;
+
+    auto collections = arena.alloc<ustore_collection_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+    auto keys = arena.alloc<ustore_key_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+    auto indices = arena.alloc<std::size_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+
+    companion_collections_t deltas {c_db, deltas_suffix_k, arena, c_error};
+    std::size_t found_count = 0;
+    for (std::size_t i = 0; i != entries.size(); ++i) {
+        updated_entry_t const& entry = entries[i];
+        if (!entry.delta)
+            continue;
+        bool found = deltas.find(entry.collection, false, collections[found_count]);
+        return_if_error_m(c_error);
+        if (!found)
+            continue;
+        keys[found_count] = entry.key;
+        indices[found_count] = i;
+        ++found_count;
+    }
+    if (!found_count)
+        return;
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.snapshot = c_snapshot;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = found_count;
+    read.collections = collections.begin();
+    read.collections_stride = sizeof(ustore_collection_t);
+    read.keys = keys.begin();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    auto segment_at = [&](std::size_t i) noexcept {
+        return found_lengths[i] == ustore_length_missing_k
+                   ? value_view_t {}
+                   : value_view_t {found_values + found_offsets[i], found_lengths[i]};
+    };
+    std::size_t total_size = 0;
+    for (std::size_t i = 0; i != found_count; ++i)
+        total_size += entries[indices[i]].length + degree_of(segment_at(i), ustore_vertex_role_any_k) * sizeof(neighborship_t);
+
+    auto buffer = arena.alloc<byte_t>(total_size, c_error);
+    return_if_error_m(c_error);
+    byte_t* output = buffer.begin();
+    for (std::size_t i = 0; i != found_count; ++i) {
+        value_view_t segment = segment_at(i);
+        if (!degree_of(segment, ustore_vertex_role_any_k))
+            continue;
+
+        updated_entry_t& entry = entries[indices[i]];
+        auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(output);
+        auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
+        degrees[0] = degree_of(entry, ustore_vertex_source_k) + degree_of(segment, ustore_vertex_source_k);
+        degrees[1] = degree_of(entry, ustore_vertex_target_k) + degree_of(segment, ustore_vertex_target_k);
+        for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k}) {
+            auto base_ships = neighbors(entry, role);
+            auto segment_ships = neighbors(segment, role);
+            ships = std::merge(base_ships.begin(), base_ships.end(), segment_ships.begin(), segment_ships.end(), ships);
+        }
+
+        std::size_t size = reinterpret_cast<byte_t*>(ships) - output;
+        entry.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+        entry.length = static_cast<ustore_length_t>(size);
+        output += size;
+    }
+}
+
+/**
+ * @brief Parses the outbound and inbound degrees of vertices from the headers of their entries,
+ * adding the headers of delta segments, without decoding, merging or stitching any neighborships.
+ * Directories of sharded vertices already hold the total degrees.
+ * @param degrees Output pairs of degrees, with `ustore_vertex_degree_missing_k` for missing vertices.
+ */
+void read_degrees( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    find_edges_t const& vertices,
+    joined_blobs_t values,
+    ustore_options_t const c_options,
+    ustore_vertex_degree_t* degrees,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    std::size_t delta_count = 0;
+    joined_blobs_iterator_t values_it = values.begin();
+    for (std::size_t i = 0; i != vertices.size(); ++i, ++values_it) {
+        value_view_t value = *values_it;
+        degrees[i * 2 + 0] = value ? degree_of(value, ustore_vertex_source_k) : ustore_vertex_degree_missing_k;
+        degrees[i * 2 + 1] = value ? degree_of(value, ustore_vertex_target_k) : ustore_vertex_degree_missing_k;
+        delta_count += has_delta(value);
+    }
+    if (!delta_count)
+        return;
+
+    auto delta_collections = arena.alloc<ustore_collection_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+    auto delta_keys = arena.alloc<ustore_key_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+    auto indices = arena.alloc<std::size_t>(delta_count, c_error);
+    return_if_error_m(c_error);
+
+    companion_collections_t deltas {c_db, deltas_suffix_k, arena, c_error};
+    std::size_t found_count = 0;
+    values_it = values.begin();
+    for (std::size_t i = 0; i != vertices.size(); ++i, ++values_it) {
+        if (!has_delta(*values_it))
+            continue;
+        find_edge_t vertex = vertices[i];
+        bool found = deltas.find(vertex.collection, false, delta_collections[found_count]);
+        return_if_error_m(c_error);
+        if (!found)
+            continue;
+        delta_keys[found_count] = vertex.vertex_id;
+        indices[found_count] = i;
+        ++found_count;
+    }
+    if (!found_count)
+        return;
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.snapshot = c_snapshot;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = found_count;
+    read.collections = delta_collections.begin();
+    read.collections_stride = sizeof(ustore_collection_t);
+    read.keys = delta_keys.begin();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    for (std::size_t i = 0; i != found_count; ++i) {
+        if (found_lengths[i] == ustore_length_missing_k)
+            continue;
+        value_view_t segment {found_values + found_offsets[i], found_lengths[i]};
+        degrees[indices[i] * 2 + 0] += degree_of(segment, ustore_vertex_source_k);
+        degrees[indices[i] * 2 + 1] += degree_of(segment, ustore_vertex_target_k);
+    }
+}
+
+/*********************************************************/
+/*****************  Sharded Neighborhoods  ***************/
+/*********************************************************/
+
+constexpr ustore_vertex_degree_t default_max_bucket_degree_k = 1u << 16;
+constexpr std::string_view buckets_suffix_k = graph_buckets_suffix_k;
+
+/**
+ * @brief A single entry in the directory of a sharded vertex, following its degrees header.
+ * The bucket contains all the neighborships with neighbor IDs from its `lower_bound`
+ * until the `lower_bound` of the next bucket. Buckets have the same layout as vertices.
+ */
+struct bucket_ref_t {
+    ustore_key_t lower_bound = std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t key = 0;
+    ustore_vertex_degree_t degrees[2] = {0, 0};
+};
+
+bool is_sharded(value_view_t bytes) noexcept {
+    if (bytes.size() < bytes_in_degrees_header_k)
+        return false;
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin());
+    return degrees[1] & sharded_degree_flag_k;
+}
+
+ptr_range_gt<bucket_ref_t> buckets_of(value_view_t directory) noexcept {
+    if (directory.size() < bytes_in_degrees_header_k)
+        return {};
+    auto refs = reinterpret_cast<bucket_ref_t*>(const_cast<byte_t*>(directory.begin()) + bytes_in_degrees_header_k);
+    return {refs, (directory.size() - bytes_in_degrees_header_k) / sizeof(bucket_ref_t)};
+}
+
+bucket_ref_t& bucket_for(ptr_range_gt<bucket_ref_t> buckets, ustore_key_t neighbor_id) noexcept {
+    auto it = std::upper_bound(buckets.begin(), buckets.end(), neighbor_id, [](ustore_key_t id, bucket_ref_t const& b) {
+        return id < b.lower_bound;
+    });
+    return *(it - 1);
+}
+
+/**
+ * @brief Checks if the `i`-th bucket may contain neighbor IDs from `min` to `max` inclusive.
+ */
+bool bucket_overlaps(ptr_range_gt<bucket_ref_t> buckets, std::size_t i, ustore_key_t min, ustore_key_t max) noexcept {
+    return buckets[i].lower_bound <= max && (i + 1 == buckets.size() || buckets[i + 1].lower_bound > min);
+}
+
+/**
+ * @brief Cuts a plain neighborhood into slices of about `slice_degree` neighborships
+ * in the order of neighbor IDs, never splitting the edges of the same neighbor.
+ * Calls `callback(lower_bound, outgoing, incoming)` for every slice.
+ */
+template <typename callback_at>
+void slice_neighborhood(value_view_t plain, ustore_key_t lower_bound, std::size_t slice_degree, callback_at&& callback) {
+    auto outgoing = neighbors(plain, ustore_vertex_source_k);
+    auto incoming = neighbors(plain, ustore_vertex_target_k);
+    auto outgoing_it = outgoing.begin(), outgoing_begin = outgoing.begin();
+    auto incoming_it = incoming.begin(), incoming_begin = incoming.begin();
+    std::size_t slice_size = 0;
+    while (outgoing_it != outgoing.end() || incoming_it != incoming.end()) {
+        ustore_key_t next_id = outgoing_it == outgoing.end()   ? incoming_it->neighbor_id
+                               : incoming_it == incoming.end() ? outgoing_it->neighbor_id
+                                                               : std::min(outgoing_it->neighbor_id, incoming_it->neighbor_id);
+        if (slice_size >= slice_degree) {
+            callback(lower_bound,
+                     ptr_range_gt<neighborship_t const> {outgoing_begin, outgoing_it},
+                     ptr_range_gt<neighborship_t const> {incoming_begin, incoming_it});
+            lower_bound = next_id, outgoing_begin = outgoing_it, incoming_begin = incoming_it, slice_size = 0;
+        }
+        for (; outgoing_it != outgoing.end() && outgoing_it->neighbor_id == next_id; ++outgoing_it)
+            ++slice_size;
+        for (; incoming_it != incoming.end() && incoming_it->neighbor_id == next_id; ++incoming_it)
+            ++slice_size;
+    }
+    callback(lower_bound,
+             ptr_range_gt<neighborship_t const> {outgoing_begin, outgoing_it},
+             ptr_range_gt<neighborship_t const> {incoming_begin, incoming_it});
+}
+
+std::size_t count_slices(value_view_t plain, std::size_t slice_degree) noexcept {
+    std::size_t count = 0;
+    slice_neighborhood(plain, 0, slice_degree, [&](ustore_key_t, auto const&, auto const&) noexcept { ++count; });
+    return count;
+}
+
+/**
+ * @brief Writes the plain layout of a bucket with the given neighborships.
+ * @return The end of the written bytes.
+ */
+byte_t* dump_bucket(ptr_range_gt<neighborship_t const> outgoing,
+                    ptr_range_gt<neighborship_t const> incoming,
+                    byte_t* output) noexcept {
+    auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(output);
+    auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
+    degrees[0] = static_cast<ustore_vertex_degree_t>(outgoing.size());
+    degrees[1] = static_cast<ustore_vertex_degree_t>(incoming.size());
+    ships = std::copy(outgoing.begin(), outgoing.end(), ships);
+    ships = std::copy(incoming.begin(), incoming.end(), ships);
+    return reinterpret_cast<byte_t*>(ships);
+}
+
+/**
+ * @brief Replaces the directories of sharded `entries` with plain neighborhoods, stitched from the buckets.
+ * If `c_neighbors_min` and `c_neighbors_max` are passed, only the overlapping buckets are read.
+ */
+void stitch_buckets( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    strided_range_gt<updated_entry_t> entries,
+    strided_iterator_gt<ustore_key_t const> c_neighbors_min,
+    strided_iterator_gt<ustore_key_t const> c_neighbors_max,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    bool ranged = c_neighbors_min && c_neighbors_max;
+    auto needs_bucket = [&](std::size_t i, std::size_t j) noexcept {
+        return !ranged || bucket_overlaps(buckets_of(entries[i]), j, c_neighbors_min[i], c_neighbors_max[i]);
+    };
+
+    std::size_t buckets_count = 0;
+    for (std::size_t i = 0; i != entries.size(); ++i)
+        if (entries[i].sharded)
+            for (std::size_t j = 0; j != buckets_of(entries[i]).size(); ++j)
+                buckets_count += needs_bucket(i, j);
+    if (!buckets_count)
+        return;
+
+    auto buckets = arena.alloc<updated_entry_t>(buckets_count, c_error);
+    return_if_error_m(c_error);
+    companion_collections_t companions {c_db, buckets_suffix_k, arena, c_error};
+    std::size_t passed_buckets = 0;
+    for (std::size_t i = 0; i != entries.size(); ++i) {
+        if (!entries[i].sharded)
+            continue;
+        ustore_collection_t companion = ustore_collection_main_k;
+        bool found = companions.find(entries[i].collection, false, companion);
+        return_if_error_m(c_error);
+        return_error_if_m(found, c_error, consistency_k, "Missing graph buckets");
+        auto refs = buckets_of(entries[i]);
+        for (std::size_t j = 0; j != refs.size(); ++j) {
+            if (!needs_bucket(i, j))
+                continue;
+            updated_entry_t& bucket = buckets[passed_buckets++];
+            bucket = updated_entry_t {};
+            bucket.collection = companion;
+            bucket.key = refs[j].key;
+        }
+    }
+
+    auto collections = buckets.strided().immutable().members(&updated_entry_t::collection);
+    auto keys = buckets.strided().immutable().members(&updated_entry_t::key);
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.snapshot = c_snapshot;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = buckets_count;
+    read.collections = collections.begin().get();
+    read.collections_stride = collections.begin().stride();
+    read.keys = keys.begin().get();
+    read.keys_stride = keys.begin().stride();
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    for (std::size_t i = 0; i != buckets_count; ++i) {
+        buckets[i].content = found_values + found_offsets[i];
+        buckets[i].length = found_lengths[i];
+        return_error_if_m(found_lengths[i] != ustore_length_missing_k, c_error, consistency_k, "Missing graph bucket");
+    }
+    unpack_entries(buckets.strided(), true, arena, c_error);
+    return_if_error_m(c_error);
+
+    std::size_t total_size = 0;
+    for (updated_entry_t const& bucket : buckets)
+        total_size += bucket.length;
+    total_size += entries.size() * bytes_in_degrees_header_k;
+    auto buffer = arena.alloc<byte_t>(total_size, c_error);
+    return_if_error_m(c_error);
+
+    byte_t* output = buffer.begin();
+    passed_buckets = 0;
+    for (std::size_t i = 0; i != entries.size(); ++i) {
+        updated_entry_t& entry = entries[i];
+        if (!entry.sharded)
+            continue;
+
+        std::size_t used_count = 0;
+        for (std::size_t j = 0; j != buckets_of(entry).size(); ++j)
+            used_count += needs_bucket(i, j);
+        auto used = ptr_range_gt<updated_entry_t> {buckets.begin() + passed_buckets, used_count};
+        passed_buckets += used_count;
+
+        auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(output);
+        auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
+        degrees[0] = degrees[1] = 0;
+        for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k})
+            for (updated_entry_t const& bucket : used) {
+                auto bucket_ships = neighbors(bucket, role);
+                ships = std::copy(bucket_ships.begin(), bucket_ships.end(), ships);
+                degrees[role == ustore_vertex_target_k] += static_cast<ustore_vertex_degree_t>(bucket_ships.size());
+            }
+
+        std::size_t size = reinterpret_cast<byte_t*>(ships) - output;
+        entry.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+        entry.length = static_cast<ustore_length_t>(size);
+        entry.sharded = false;
+        output += size;
+    }
+}
+
+/**
+ * @brief Exposes the entries of a read tape in the plain layout, decoding the packed ones,
+ * merging the delta segments and stitching the buckets in the `arena`.
+ * @param decode Whether the neighborships are needed, or just the degrees.
+ */
+ptr_range_gt<value_view_t> read_entries( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    ustore_size_t const c_count,
+    ustore_collection_t const* c_collections,
+    ustore_size_t const c_collections_stride,
+    ustore_key_t const* c_keys,
+    ustore_size_t const c_keys_stride,
+    joined_blobs_t values,
+    bool decode,
+    strided_iterator_gt<ustore_key_t const> c_neighbors_min,
+    strided_iterator_gt<ustore_key_t const> c_neighbors_max,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    auto views = arena.alloc<value_view_t>(c_count, c_error);
+    if (*c_error)
+        return {};
+
+    bool needs_decoding = false;
+    joined_blobs_iterator_t values_it = values.begin();
+    for (std::size_t i = 0; i != c_count; ++i, ++values_it) {
+        views[i] = *values_it;
+        needs_decoding |= (decode && (is_packed(views[i]) || is_sharded(views[i]))) || has_delta(views[i]);
+    }
+    if (!needs_decoding)
+        return views;
+
+    strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c_keys, c_keys_stride};
+    auto entries = arena.alloc<updated_entry_t>(c_count, c_error);
+    if (*c_error)
+        return {};
+    for (std::size_t i = 0; i != c_count; ++i) {
+        entries[i] = updated_entry_t {};
+        entries[i].collection = collections ? collections[i] : ustore_collection_main_k;
+        entries[i].key = keys[i];
+        entries[i].content = ustore_bytes_ptr_t(views[i].data());
+        entries[i].length = views[i] ? static_cast<ustore_length_t>(views[i].size()) : ustore_length_missing_k;
+    }
+
+    unpack_entries(entries.strided(), decode, arena, c_error);
+    if (*c_error)
+        return {};
+    merge_deltas(c_db, c_transaction, c_snapshot, entries.strided(), c_options, arena, c_error);
+    if (*c_error)
+        return {};
+    if (decode)
+        stitch_buckets(c_db,
+                       c_transaction,
+                       c_snapshot,
+                       entries.strided(),
+                       c_neighbors_min,
+                       c_neighbors_max,
+                       c_options,
+                       arena,
+                       c_error);
+    if (*c_error)
+        return {};
+
+    for (std::size_t i = 0; i != c_count; ++i)
+        if (entries[i].length != ustore_length_missing_k)
+            views[i] = value_view_t {entries[i].content, entries[i].length};
+    return views;
+}
+
+/**
+ * @brief Writes the updated entries back. Neighborships appended to vertices with delta segments
+ * stay in those segments, until they outgrow the `delta_capacity()`. Every other entry is written
+ * into the main collection in full, packed if it was packed before or if `pack_all` is requested.
+ * @param appending Whether the entries have only gained neighborships, since being read.
+ * @param raw_writes Additional entries to write as is, like the counters of bucket keys.
+ */
+void write_entries( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    strided_range_gt<updated_entry_t> entries,
+    bool appending,
+    bool pack_all,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error,
+    ptr_range_gt<updated_entry_t const> raw_writes = {}) {
+
+    std::size_t count = entries.size();
+    if (!count && raw_writes.empty())
+        return;
+
+    auto is_appended = [=](updated_entry_t const& entry) noexcept {
+        if (!appending || !entry.delta || entry.sharded || entry.base_length == ustore_length_missing_k ||
+            entry.length == ustore_length_missing_k)
+            return false;
+        value_view_t base {entry.base_content, entry.base_length};
+        auto base_degree = degree_of(base, ustore_vertex_role_any_k);
+        auto appended_degree = degree_of(entry, ustore_vertex_role_any_k) - base_degree;
+        return appended_degree <= delta_capacity(base_degree);
+    };
+
+    // The base entries go into the first half, and segments - into the second
+    auto writes = arena.alloc<updated_entry_t>(count * 2u + raw_writes.size(), c_error);
+    return_if_error_m(c_error);
+    std::size_t bases_count = 0;
+    std::size_t segments_count = 0;
+    std::size_t appended_size = 0;
+    for (updated_entry_t const& entry : entries)
+        if (is_appended(entry))
+            appended_size += entry.length - entry.base_length + bytes_in_degrees_header_k;
+
+    auto appended = arena.alloc<byte_t>(appended_size, c_error);
+    return_if_error_m(c_error);
+    byte_t* output = appended.begin();
+    for (updated_entry_t const& entry : entries) {
+        updated_entry_t& segment = writes[count + segments_count];
+        segment = updated_entry_t {};
+        segment.collection = entry.collection;
+        segment.key = entry.key;
+
+        if (is_appended(entry)) {
+            value_view_t base {entry.base_content, entry.base_length};
+            auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(output);
+            auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
+            degrees[0] = degree_of(entry, ustore_vertex_source_k) - degree_of(base, ustore_vertex_source_k);
+            degrees[1] = degree_of(entry, ustore_vertex_target_k) - degree_of(base, ustore_vertex_target_k);
+            for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k}) {
+                auto base_ships = neighbors(base, role);
+                auto merged_ships = neighbors(entry, role);
+                ships = std::set_difference( //
+                    merged_ships.begin(),
+                    merged_ships.end(),
+                    base_ships.begin(),
+                    base_ships.end(),
+                    ships);
+            }
+
+            std::size_t size = reinterpret_cast<byte_t*>(ships) - output;
+            segment.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+            segment.length = static_cast<ustore_length_t>(size);
+            output += size;
+            ++segments_count;
+            continue;
+        }
+
+        // Large vertices are flagged, even before the first segment is written.
+        // For previously flagged vertices the segment is no longer needed.
+        // Buckets and directories of sharded vertices never have segments.
+        updated_entry_t& base = writes[bases_count++];
+        base = entry;
+        base.delta = entry.length != ustore_length_missing_k && !entry.sharded && !entry.bucket &&
+                     degree_of(entry, ustore_vertex_role_any_k) >= delta_min_degree_k;
+        if (entry.delta || base.delta)
+            ++segments_count;
+    }
+
+    auto bases = ptr_range_gt<updated_entry_t> {writes.begin(), bases_count}.strided();
+    pack_entries(bases, pack_all, arena, c_error);
+    return_if_error_m(c_error);
+    for (updated_entry_t& base : bases)
+        if (base.delta)
+            reinterpret_cast<ustore_vertex_degree_t*>(base.content)[1] |= delta_degree_flag_k;
+
+    // Place the segments right after the base entries, skipping removals from missing companions
+    companion_collections_t deltas {c_db, deltas_suffix_k, arena, c_error};
+    std::size_t writes_count = bases_count;
+    for (std::size_t i = 0; i != segments_count; ++i) {
+        updated_entry_t segment = writes[count + i];
+        bool found = deltas.find(segment.collection, segment.content != nullptr, segment.collection);
+        return_if_error_m(c_error);
+        if (found)
+            writes[writes_count++] = segment;
+    }
+    for (updated_entry_t const& raw_write : raw_writes)
+        writes[writes_count++] = raw_write;
+
+    auto written = ptr_range_gt<updated_entry_t> {writes.begin(), writes_count}.strided();
+    auto collections = written.immutable().members(&updated_entry_t::collection);
+    auto keys = written.immutable().members(&updated_entry_t::key);
+    auto contents = written.immutable().members(&updated_entry_t::content);
+    auto lengths = written.immutable().members(&updated_entry_t::length);
+
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_transaction;
+    write.arena = arena;
+    write.options = c_options;
+    write.tasks_count = writes_count;
+    write.collections = collections.begin().get();
+    write.collections_stride = collections.begin().stride();
+    write.keys = keys.begin().get();
+    write.keys_stride = keys.begin().stride();
+    write.lengths = lengths.begin().get();
+    write.lengths_stride = lengths.begin().stride();
+    write.values = contents.begin().get();
+    write.values_stride = contents.begin().stride();
+
+    ustore_write(&write);
+}
+
 struct neighborhood_t {
     ustore_key_t center = 0;
     ptr_range_gt<neighborship_t const> targets;
@@ -303,6 +1270,58 @@ void erase_from_entry(updated_entry_t& entry,
     entry.length -= sizeof(neighborship_t) * len;
 }
 
+/**
+ * @brief Exports the degrees of vertices, parsed from the headers of the `found_values`.
+ */
+void export_degrees( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    ustore_size_t const c_vertices_count,
+    ustore_collection_t const* c_collections,
+    ustore_size_t const c_collections_stride,
+    ustore_key_t const* c_vertices,
+    ustore_size_t const c_vertices_stride,
+    ustore_vertex_role_t const* c_roles,
+    ustore_size_t const c_roles_stride,
+    joined_blobs_t found_values,
+    ustore_options_t const c_options,
+    ustore_vertex_degree_t** c_degrees_per_vertex,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    auto degrees = arena.alloc_or_dummy(c_vertices_count, c_error, c_degrees_per_vertex);
+    return_if_error_m(c_error);
+    auto role_degrees = arena.alloc<ustore_vertex_degree_t>(c_vertices_count * 2, c_error);
+    return_if_error_m(c_error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
+    strided_iterator_gt<ustore_key_t const> vertices {c_vertices, c_vertices_stride};
+    strided_iterator_gt<ustore_vertex_role_t const> roles {c_roles, c_roles_stride};
+    find_edges_t find_edges {collections, vertices, roles, c_vertices_count};
+    read_degrees(c_db,
+                 c_transaction,
+                 c_snapshot,
+                 find_edges,
+                 found_values,
+                 c_options,
+                 role_degrees.begin(),
+                 arena,
+                 c_error);
+    return_if_error_m(c_error);
+
+    for (std::size_t i = 0; i != c_vertices_count; ++i) {
+        ustore_vertex_degree_t outbound = role_degrees[i * 2 + 0];
+        ustore_vertex_degree_t inbound = role_degrees[i * 2 + 1];
+        if (outbound == ustore_vertex_degree_missing_k) {
+            degrees[i] = ustore_vertex_degree_missing_k;
+            continue;
+        }
+        ustore_vertex_role_t role = find_edges[i].role;
+        degrees[i] = ((role & ustore_vertex_source_k) ? outbound : 0u) + ((role & ustore_vertex_target_k) ? inbound : 0u);
+    }
+}
+
 template <bool export_center_ak = true, bool export_neighbor_ak = true, bool export_edge_ak = true>
 void export_edge_tuples( //
     ustore_database_t const c_db,
@@ -319,6 +1338,12 @@ void export_edge_tuples( //
     ustore_vertex_role_t const* c_roles,
     ustore_size_t const c_roles_stride,
 
+    ustore_key_t const* c_neighbors_min,
+    ustore_size_t const c_neighbors_min_stride,
+
+    ustore_key_t const* c_neighbors_max,
+    ustore_size_t const c_neighbors_max_stride,
+
     ustore_options_t const c_options,
 
     ustore_vertex_degree_t** c_degrees_per_vertex,
@@ -349,22 +1374,64 @@ void export_edge_tuples( //
     ustore_read(&read);
     return_if_error_m(c_error);
 
-    joined_blobs_t values {c_vertices_count, c_found_offsets, c_found_values};
+    // Degrees are parsed from the headers, so only the exported or filtered neighborships need decoding
+    joined_blobs_t found_values {c_vertices_count, c_found_offsets, c_found_values};
+    constexpr std::size_t tuple_size_k = export_center_ak + export_neighbor_ak + export_edge_ak;
+    // Either bound may be omitted, leaving that side of the range open
+    ustore_key_t const lowest_neighbor = std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t const highest_neighbor = std::numeric_limits<ustore_key_t>::max();
+    bool ranged = c_neighbors_min || c_neighbors_max;
+    strided_iterator_gt<ustore_key_t const> neighbors_min {c_neighbors_min ? c_neighbors_min : &lowest_neighbor,
+                                                           c_neighbors_min ? c_neighbors_min_stride : 0};
+    strided_iterator_gt<ustore_key_t const> neighbors_max {c_neighbors_max ? c_neighbors_max : &highest_neighbor,
+                                                           c_neighbors_max ? c_neighbors_max_stride : 0};
+    if constexpr (tuple_size_k == 0)
+        if (!ranged)
+            return export_degrees(c_db,
+                                  c_transaction,
+                                  c_snapshot,
+                                  c_vertices_count,
+                                  c_collections,
+                                  c_collections_stride,
+                                  c_vertices,
+                                  c_vertices_stride,
+                                  c_roles,
+                                  c_roles_stride,
+                                  found_values,
+                                  c_options,
+                                  c_degrees_per_vertex,
+                                  arena,
+                                  c_error);
+
+    auto values = read_entries( //
+        c_db,
+        c_transaction,
+        c_snapshot,
+        c_vertices_count,
+        c_collections,
+        c_collections_stride,
+        c_vertices,
+        c_vertices_stride,
+        found_values,
+        tuple_size_k != 0 || ranged,
+        ranged ? neighbors_min : strided_iterator_gt<ustore_key_t const> {},
+        ranged ? neighbors_max : strided_iterator_gt<ustore_key_t const> {},
+        c_options,
+        arena,
+        c_error);
+    return_if_error_m(c_error);
+
     strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
     strided_range_gt<ustore_key_t const> vertices {{c_vertices, c_vertices_stride}, c_vertices_count};
     strided_iterator_gt<ustore_vertex_role_t const> roles {c_roles, c_roles_stride};
-    constexpr std::size_t tuple_size_k = export_center_ak + export_neighbor_ak + export_edge_ak;
 
     find_edges_t find_edges {collections, vertices.begin(), roles, c_vertices_count};
 
     // Estimate the amount of memory we will need for the arena
     std::size_t count_ids = 0;
     if constexpr (tuple_size_k != 0) {
-        joined_blobs_iterator_t values_it = values.begin();
-        for (ustore_size_t i = 0; i != c_vertices_count; ++i, ++values_it) {
-            value_view_t value = *values_it;
-            count_ids += neighbors(value, find_edges[i].role).size();
-        }
+        for (ustore_size_t i = 0; i != c_vertices_count; ++i)
+            count_ids += degree_of(values[i], find_edges[i].role);
         count_ids *= tuple_size_k;
     }
 
@@ -375,9 +1442,8 @@ void export_edge_tuples( //
     return_if_error_m(c_error);
 
     std::size_t passed_ids = 0;
-    joined_blobs_iterator_t values_it = values.begin();
-    for (std::size_t i = 0; i != c_vertices_count; ++i, ++values_it) {
-        value_view_t value = *values_it;
+    for (std::size_t i = 0; i != c_vertices_count; ++i) {
+        value_view_t value = values[i];
         find_edge_t find_edge = find_edges[i];
 
         // Some values may be missing
@@ -386,11 +1452,16 @@ void export_edge_tuples( //
             continue;
         }
 
+        // Ranged lookups count the degrees by filtering the neighbors
         ustore_vertex_degree_t degree = 0;
+        auto in_range = [&](neighborship_t n) noexcept {
+            return !ranged || (n.neighbor_id >= neighbors_min[i] && n.neighbor_id <= neighbors_max[i]);
+        };
         if (find_edge.role & ustore_vertex_source_k) {
-            auto ns = neighbors(value, ustore_vertex_source_k);
-            if constexpr (tuple_size_k != 0)
-                for (neighborship_t n : ns) {
+            if (tuple_size_k != 0 || ranged)
+                for (neighborship_t n : neighbors(value, ustore_vertex_source_k)) {
+                    if (!in_range(n))
+                        continue;
                     if constexpr (export_center_ak)
                         ids[passed_ids + 0] = find_edge.vertex_id;
                     if constexpr (export_neighbor_ak)
@@ -398,13 +1469,16 @@ void export_edge_tuples( //
                     if constexpr (export_edge_ak)
                         ids[passed_ids + export_center_ak + export_neighbor_ak] = n.edge_id;
                     passed_ids += tuple_size_k;
+                    ++degree;
                 }
-            degree += static_cast<ustore_vertex_degree_t>(ns.size());
+            else
+                degree += degree_of(value, ustore_vertex_source_k);
         }
         if (find_edge.role & ustore_vertex_target_k) {
-            auto ns = neighbors(value, ustore_vertex_target_k);
-            if constexpr (tuple_size_k != 0)
-                for (neighborship_t n : ns) {
+            if (tuple_size_k != 0 || ranged)
+                for (neighborship_t n : neighbors(value, ustore_vertex_target_k)) {
+                    if (!in_range(n))
+                        continue;
                     if constexpr (export_neighbor_ak)
                         ids[passed_ids + 0] = n.neighbor_id;
                     if constexpr (export_center_ak)
@@ -412,54 +1486,395 @@ void export_edge_tuples( //
                     if constexpr (export_edge_ak)
                         ids[passed_ids + export_center_ak + export_neighbor_ak] = n.edge_id;
                     passed_ids += tuple_size_k;
+                    ++degree;
                 }
-            degree += static_cast<ustore_vertex_degree_t>(ns.size());
+            else
+                degree += degree_of(value, ustore_vertex_target_k);
+        }
+        degrees[i] = degree;
+    }
+}
+
+void pull_and_link_for_updates( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    strided_range_gt<updated_entry_t> unique_entries,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    traced_span_t span {"graph_pull_and_link_for_updates", c_error};
+
+    // Fetch the existing entries
+    ustore_bytes_ptr_t found_binary_begin = nullptr;
+    ustore_length_t* found_binary_offs = nullptr;
+    ustore_size_t unique_count = static_cast<ustore_size_t>(unique_entries.size());
+    auto collections = unique_entries.immutable().members(&updated_entry_t::collection);
+    auto keys = unique_entries.immutable().members(&updated_entry_t::key);
+    auto opts = c_transaction ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.arena = arena;
+    read.options = opts;
+    read.tasks_count = unique_count;
+    read.collections = collections.begin().get();
+    read.collections_stride = collections.begin().stride();
+    read.keys = keys.begin().get();
+    read.keys_stride = keys.begin().stride();
+    read.offsets = &found_binary_offs;
+    read.values = &found_binary_begin;
+
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    // Link the response buffer to `unique_entries`
+    joined_blobs_t found_binaries {unique_count, found_binary_offs, found_binary_begin};
+    for (std::size_t i = 0; i != unique_count; ++i) {
+        auto found_binary = found_binaries[i];
+        unique_entries[i].content = ustore_bytes_ptr_t(found_binary.data());
+        unique_entries[i].length =
+            found_binary ? static_cast<ustore_length_t>(found_binary.size()) : ustore_length_missing_k;
+    }
+    unpack_entries(unique_entries, true, arena, c_error);
+    return_if_error_m(c_error);
+    merge_deltas(c_db, c_transaction, {}, unique_entries, opts, arena, c_error);
+}
+
+/**
+ * @brief Routes the updates of sharded vertices into their buckets, fetching those in bulk,
+ * and splits the vertices and buckets, that outgrow the `max_bucket_degree`.
+ * New bucket keys are taken from a counter, stored under `ustore_key_unknown_k` in the companion.
+ */
+class buckets_t {
+    ustore_database_t db_ = nullptr;
+    ustore_transaction_t transaction_ = nullptr;
+    ustore_options_t options_ = ustore_options_default_k;
+    linked_memory_lock_t& arena_;
+    ustore_error_t* error_ = nullptr;
+
+    companion_collections_t companions_;
+    uninitialized_array_gt<updated_entry_t> entries_;
+    uninitialized_array_gt<updated_entry_t> counters_;
+    std::size_t fetched_count_ = 0;
+
+    ustore_collection_t companion_of(updated_entry_t const& vertex, bool create) noexcept {
+        ustore_collection_t companion = ustore_collection_main_k;
+        bool found = companions_.find(vertex.collection, create, companion);
+        if (!*error_ && !found)
+            log_error_m(error_, consistency_k, "Missing graph buckets");
+        return companion;
+    }
+
+    updated_entry_t* fetched(ustore_collection_t companion, ustore_key_t key) noexcept {
+        auto fetched = ptr_range_gt<updated_entry_t> {entries_.begin(), fetched_count_};
+        auto idx = offset_in_sorted(fetched, collection_key_t {companion, key});
+        return idx != fetched_count_ && entries_[idx].collection == companion && entries_[idx].key == key
+                   ? &entries_[idx]
+                   : nullptr;
+    }
+
+    ustore_key_t allocate_key(ustore_collection_t companion) noexcept {
+        for (updated_entry_t& counter : counters_)
+            if (counter.collection == companion)
+                return (*reinterpret_cast<ustore_key_t*>(counter.content))++;
+
+        ustore_bytes_ptr_t found_value = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_read_t read {};
+        read.db = db_;
+        read.error = error_;
+        read.transaction = transaction_;
+        read.arena = arena_;
+        read.options = options_;
+        read.tasks_count = 1;
+        read.collections = &companion;
+        read.keys = &ustore_key_unknown_k;
+        read.lengths = &found_lengths;
+        read.values = &found_value;
+        ustore_read(&read);
+        if (*error_)
+            return 0;
+
+        auto next_key = arena_.alloc<ustore_key_t>(1, error_);
+        if (*error_)
+            return 0;
+        next_key[0] = 0;
+        if (found_lengths[0] == sizeof(ustore_key_t))
+            std::memcpy(next_key.begin(), found_value, sizeof(ustore_key_t));
+
+        updated_entry_t counter;
+        counter.collection = companion;
+        counter.key = ustore_key_unknown_k;
+        counter.content = reinterpret_cast<ustore_bytes_ptr_t>(next_key.begin());
+        counter.length = sizeof(ustore_key_t);
+        counters_.push_back(counter, error_);
+        return next_key[0]++;
+    }
+
+    /**
+     * @brief Rebuilds the directory of a sharded `vertex`, refreshing the degrees of fetched buckets,
+     * dropping the emptied ones and splitting the overgrown ones into slices of `slice_degree`.
+     * The first bucket is never dropped, as it covers the smallest IDs.
+     */
+    void redistribute(updated_entry_t& vertex, std::size_t max_bucket_degree, std::size_t slice_degree) noexcept {
+        ustore_collection_t companion = companion_of(vertex, false);
+        return_if_error_m(error_);
+        auto refs = buckets_of(vertex);
+        bool changed = false;
+        std::size_t refs_count = 0;
+        for (bucket_ref_t const& ref : refs) {
+            updated_entry_t* bucket = fetched(companion, ref.key);
+            if (!bucket || !bucket->degree_delta)
+                refs_count += 1;
+            else if (degree_of(*bucket, ustore_vertex_role_any_k) > max_bucket_degree)
+                refs_count += count_slices(*bucket, slice_degree), changed = true;
+            else
+                refs_count += degree_of(*bucket, ustore_vertex_role_any_k) != 0 || &ref == refs.begin(), changed = true;
+        }
+        if (!changed)
+            return;
+
+        auto directory = arena_.alloc<byte_t>(bytes_in_degrees_header_k + refs_count * sizeof(bucket_ref_t), error_);
+        return_if_error_m(error_);
+        auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(directory.begin());
+        auto new_refs = reinterpret_cast<bucket_ref_t*>(directory.begin() + bytes_in_degrees_header_k);
+        std::size_t passed_refs = 0;
+        for (bucket_ref_t ref : refs) {
+            updated_entry_t* bucket = fetched(companion, ref.key);
+            if (!bucket || !bucket->degree_delta) {
+                new_refs[passed_refs++] = ref;
+                continue;
+            }
+
+            ref.degrees[0] = degree_of(*bucket, ustore_vertex_source_k);
+            ref.degrees[1] = degree_of(*bucket, ustore_vertex_target_k);
+            if (!ref.degrees[0] && !ref.degrees[1] && passed_refs) {
+                bucket->content = nullptr;
+                bucket->length = ustore_length_missing_k;
+                continue;
+            }
+            if (ref.degrees[0] + ref.degrees[1] <= max_bucket_degree) {
+                new_refs[passed_refs++] = ref;
+                continue;
+            }
+
+            // The first slice stays in the original bucket, the others get new keys
+            updated_entry_t original = *bucket;
+            bool is_first = true;
+            slice_neighborhood(original, ref.lower_bound, slice_degree, [&](ustore_key_t lower_bound, auto out, auto in) {
+                return_if_error_m(error_);
+                auto content = arena_.alloc<byte_t>( //
+                    bytes_in_degrees_header_k + (out.size() + in.size()) * sizeof(neighborship_t),
+                    error_);
+                return_if_error_m(error_);
+                dump_bucket(out, in, content.begin());
+
+                updated_entry_t slice = original;
+                slice.key = is_first ? original.key : allocate_key(companion);
+                slice.content = reinterpret_cast<ustore_bytes_ptr_t>(content.begin());
+                slice.length = static_cast<ustore_length_t>(content.size());
+                slice.degree_delta = 1;
+                if (is_first)
+                    *fetched(companion, original.key) = slice;
+                else
+                    entries_.push_back(slice, error_);
+                is_first = false;
+
+                bucket_ref_t& new_ref = new_refs[passed_refs++];
+                new_ref.lower_bound = lower_bound;
+                new_ref.key = slice.key;
+                new_ref.degrees[0] = static_cast<ustore_vertex_degree_t>(out.size());
+                new_ref.degrees[1] = static_cast<ustore_vertex_degree_t>(in.size());
+            });
+            return_if_error_m(error_);
+        }
+
+        degrees[0] = degrees[1] = 0;
+        for (std::size_t i = 0; i != passed_refs; ++i)
+            degrees[0] += new_refs[i].degrees[0], degrees[1] += new_refs[i].degrees[1];
+        degrees[1] |= sharded_degree_flag_k;
+        vertex.content = reinterpret_cast<ustore_bytes_ptr_t>(directory.begin());
+        vertex.length = static_cast<ustore_length_t>(bytes_in_degrees_header_k + passed_refs * sizeof(bucket_ref_t));
+        vertex.degree_delta = std::max<ustore_vertex_degree_t>(vertex.degree_delta, 1);
+    }
+
+    /**
+     * @brief Replaces the plain neighborhood of `vertex` with a directory of new buckets.
+     */
+    void shard(updated_entry_t& vertex, std::size_t slice_degree) noexcept {
+        ustore_collection_t companion = companion_of(vertex, true);
+        return_if_error_m(error_);
+        std::size_t refs_count = count_slices(vertex, slice_degree);
+        auto directory = arena_.alloc<byte_t>(bytes_in_degrees_header_k + refs_count * sizeof(bucket_ref_t), error_);
+        return_if_error_m(error_);
+        auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(directory.begin());
+        auto refs = reinterpret_cast<bucket_ref_t*>(directory.begin() + bytes_in_degrees_header_k);
+        degrees[0] = degree_of(vertex, ustore_vertex_source_k);
+        degrees[1] = degree_of(vertex, ustore_vertex_target_k) | sharded_degree_flag_k;
+
+        std::size_t passed_refs = 0;
+        auto min_id = std::numeric_limits<ustore_key_t>::min();
+        slice_neighborhood(vertex, min_id, slice_degree, [&](ustore_key_t lower_bound, auto out, auto in) {
+            return_if_error_m(error_);
+            auto content = arena_.alloc<byte_t>( //
+                bytes_in_degrees_header_k + (out.size() + in.size()) * sizeof(neighborship_t),
+                error_);
+            return_if_error_m(error_);
+            dump_bucket(out, in, content.begin());
+
+            updated_entry_t bucket;
+            bucket.collection = companion;
+            bucket.key = allocate_key(companion);
+            bucket.content = reinterpret_cast<ustore_bytes_ptr_t>(content.begin());
+            bucket.length = static_cast<ustore_length_t>(content.size());
+            bucket.degree_delta = 1;
+            bucket.packed = vertex.packed;
+            bucket.bucket = true;
+            entries_.push_back(bucket, error_);
+
+            bucket_ref_t& ref = refs[passed_refs++];
+            ref.lower_bound = lower_bound;
+            ref.key = bucket.key;
+            ref.degrees[0] = static_cast<ustore_vertex_degree_t>(out.size());
+            ref.degrees[1] = static_cast<ustore_vertex_degree_t>(in.size());
+        });
+        return_if_error_m(error_);
+
+        vertex.content = reinterpret_cast<ustore_bytes_ptr_t>(directory.begin());
+        vertex.length = static_cast<ustore_length_t>(directory.size());
+        vertex.sharded = true;
+    }
+
+  public:
+    buckets_t(ustore_database_t db,
+              ustore_transaction_t transaction,
+              ustore_options_t options,
+              linked_memory_lock_t& arena,
+              ustore_error_t* error) noexcept
+        : db_(db), transaction_(transaction), options_(options), arena_(arena), error_(error),
+          companions_(db, buckets_suffix_k, arena, error), entries_(arena), counters_(arena) {}
+
+    /**
+     * @brief Schedules the bucket of a sharded `vertex`, that may contain `neighbor_id`, for `fetch()`.
+     */
+    void request(updated_entry_t const& vertex, ustore_key_t neighbor_id) noexcept {
+        if (!vertex.sharded)
+            return;
+        updated_entry_t bucket;
+        bucket.collection = companion_of(vertex, false);
+        return_if_error_m(error_);
+        bucket.key = bucket_for(buckets_of(vertex), neighbor_id).key;
+        bucket.bucket = true;
+        entries_.push_back(bucket, error_);
+    }
+
+    void fetch() noexcept {
+        auto unique_count = sort_and_deduplicate(entries_.begin(), entries_.end());
+        entries_.resize(unique_count, error_);
+        return_if_error_m(error_);
+        auto unique_strided = ptr_range_gt<updated_entry_t> {entries_.begin(), unique_count}.strided();
+        pull_and_link_for_updates(db_, transaction_, unique_strided, options_, arena_, error_);
+        return_if_error_m(error_);
+        for (updated_entry_t& bucket : unique_strided) {
+            return_error_if_m(bucket.length != ustore_length_missing_k, error_, consistency_k, "Missing graph bucket");
+            bucket.bucket = true;
+        }
+        fetched_count_ = unique_count;
+    }
+
+    ptr_range_gt<updated_entry_t> fetched() noexcept { return {entries_.begin(), fetched_count_}; }
+
+    /**
+     * @return The fetched bucket of a sharded `vertex`, that contains `neighbor_id`, or the `vertex` itself.
+     * NULL, if the bucket wasn't requested before the `fetch()`.
+     */
+    updated_entry_t* route(updated_entry_t& vertex, ustore_key_t neighbor_id) noexcept {
+        if (!vertex.sharded)
+            return &vertex;
+        ustore_collection_t companion = companion_of(vertex, false);
+        updated_entry_t* bucket = fetched(companion, bucket_for(buckets_of(vertex), neighbor_id).key);
+        if (!bucket)
+            log_error_m(error_, consistency_k, "Unfetched graph bucket");
+        return bucket;
+    }
+
+    /**
+     * @brief Schedules the removal of all the buckets of a sharded `vertex`.
+     */
+    void remove(updated_entry_t& vertex) noexcept {
+        if (!vertex.sharded)
+            return;
+        ustore_collection_t companion = companion_of(vertex, false);
+        return_if_error_m(error_);
+        for (bucket_ref_t const& ref : buckets_of(vertex)) {
+            updated_entry_t* bucket = fetched(companion, ref.key);
+            updated_entry_t removed;
+            removed.collection = companion;
+            removed.key = ref.key;
+            removed.degree_delta = 1;
+            removed.bucket = true;
+            if (bucket)
+                *bucket = removed;
+            else
+                entries_.push_back(removed, error_);
+            return_if_error_m(error_);
         }
-        degrees[i] = degree;
+        vertex.sharded = false;
     }
-}
-
-void pull_and_link_for_updates( //
-    ustore_database_t const c_db,
-    ustore_transaction_t const c_transaction,
-    strided_range_gt<updated_entry_t> unique_entries,
-    ustore_options_t const c_options,
-    linked_memory_lock_t& arena,
-    ustore_error_t* c_error) {
-
-    // Fetch the existing entries
-    ustore_bytes_ptr_t found_binary_begin = nullptr;
-    ustore_length_t* found_binary_offs = nullptr;
-    ustore_size_t unique_count = static_cast<ustore_size_t>(unique_entries.size());
-    auto collections = unique_entries.immutable().members(&updated_entry_t::collection);
-    auto keys = unique_entries.immutable().members(&updated_entry_t::key);
-    auto opts = c_transaction ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
-    ustore_read_t read {};
-    read.db = c_db;
-    read.error = c_error;
-    read.transaction = c_transaction;
-    read.arena = arena;
-    read.options = opts;
-    read.tasks_count = unique_count;
-    read.collections = collections.begin().get();
-    read.collections_stride = collections.begin().stride();
-    read.keys = keys.begin().get();
-    read.keys_stride = keys.begin().stride();
-    read.offsets = &found_binary_offs;
-    read.values = &found_binary_begin;
 
-    ustore_read(&read);
-    return_if_error_m(c_error);
+    /**
+     * @brief Splits the overgrown buckets of the `vertices` and refreshes their directories.
+     * @param growing Whether the plain vertices, that gained neighborships, may be sharded.
+     */
+    void rebalance(ptr_range_gt<updated_entry_t> vertices,
+                   ustore_vertex_degree_t max_bucket_degree,
+                   bool growing) noexcept {
+        std::size_t slice_degree = std::max<std::size_t>(max_bucket_degree / 2u, 1u);
+        for (updated_entry_t& vertex : vertices) {
+            if (vertex.sharded)
+                redistribute(vertex, max_bucket_degree, slice_degree);
+            else if (growing && vertex.degree_delta && vertex.length != ustore_length_missing_k &&
+                     degree_of(vertex, ustore_vertex_role_any_k) > max_bucket_degree)
+                shard(vertex, slice_degree);
+            return_if_error_m(error_);
+        }
+    }
 
-    // Link the response buffer to `unique_entries`
-    joined_blobs_t found_binaries {unique_count, found_binary_offs, found_binary_begin};
-    for (std::size_t i = 0; i != unique_count; ++i) {
-        auto found_binary = found_binaries[i];
-        unique_entries[i].content = ustore_bytes_ptr_t(found_binary.data());
-        unique_entries[i].length =
-            found_binary ? static_cast<ustore_length_t>(found_binary.size()) : ustore_length_missing_k;
+    /**
+     * @brief Writes the changed `vertices` together with the changed buckets and the key counters.
+     */
+    void write(ptr_range_gt<updated_entry_t> vertices, bool appending, bool pack_all) noexcept {
+        auto vertices_end = std::partition(vertices.begin(), vertices.end(), std::mem_fn(&updated_entry_t::degree_delta));
+        auto buckets_end = std::partition(entries_.begin(), entries_.end(), std::mem_fn(&updated_entry_t::degree_delta));
+        std::size_t vertices_count = vertices_end - vertices.begin();
+        std::size_t buckets_count = buckets_end - entries_.begin();
+        if (!buckets_count)
+            return write_entries(db_,
+                                 transaction_,
+                                 ptr_range_gt<updated_entry_t> {vertices.begin(), vertices_count}.strided(),
+                                 appending,
+                                 pack_all,
+                                 options_,
+                                 arena_,
+                                 error_);
+
+        auto changed = arena_.alloc<updated_entry_t>(vertices_count + buckets_count, error_);
+        return_if_error_m(error_);
+        std::copy(vertices.begin(), vertices_end, changed.begin());
+        std::copy(entries_.begin(), buckets_end, changed.begin() + vertices_count);
+        write_entries(db_,
+                      transaction_,
+                      changed.strided(),
+                      appending,
+                      pack_all,
+                      options_,
+                      arena_,
+                      error_,
+                      {counters_.begin(), counters_.size()});
     }
-}
+};
 
 template <bool erase_ak>
 void update_neighborhoods( //
@@ -480,6 +1895,8 @@ void update_neighborhoods( //
     ustore_size_t const c_targets_stride,
 
     ustore_options_t const c_options,
+    ustore_graph_encoding_t const c_encoding,
+    ustore_vertex_degree_t const c_max_bucket_degree,
 
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) {
@@ -509,9 +1926,10 @@ void update_neighborhoods( //
     pull_and_link_for_updates(c_db, c_transaction, unique_strided, c_options, arena, c_error);
     return_if_error_m(c_error);
 
-    // Define our primary for-loop
+    // Define our primary for-loop, where the updates of sharded vertices go into their buckets
+    buckets_t buckets {c_db, c_transaction, c_options, arena, c_error};
     auto for_each_task = [&](auto entry_role_target_edge_callback) {
-        for (std::size_t i = 0; i != c_tasks_count; ++i) {
+        for (std::size_t i = 0; i != c_tasks_count && !*c_error; ++i) {
             auto collection = edge_collections[i];
             auto source_id = sources_ids[i];
             auto target_id = targets_ids[i];
@@ -522,66 +1940,71 @@ void update_neighborhoods( //
             entry_role_target_edge_callback(unique_entries[target_idx], ustore_vertex_target_k, source_id, edge_id);
         }
     };
+    auto routed = [&](auto callback) {
+        return [&, callback](updated_entry_t& entry, ustore_vertex_role_t role, ustore_key_t neighbor_id, ustore_key_t edge_id) {
+            if (updated_entry_t* routed_entry = buckets.route(entry, neighbor_id))
+                callback(*routed_entry, role, neighbor_id, edge_id);
+        };
+    };
+
+    for_each_task([&](updated_entry_t& entry, ustore_vertex_role_t, ustore_key_t neighbor_id, ustore_key_t) {
+        buckets.request(entry, neighbor_id);
+    });
+    return_if_error_m(c_error);
+    buckets.fetch();
+    return_if_error_m(c_error);
 
     if constexpr (erase_ak)
-        for_each_task(&erase_from_entry);
+        for_each_task(routed(&erase_from_entry));
     else {
         // Unlike erasing, which can reuse the memory, her we need three passes:
         // 1. estimating final size
-        for_each_task(&count_inserts_into_entry);
+        for_each_task(routed(&count_inserts_into_entry));
         // 2. reallocating into bigger buffers
-        for (std::size_t i = 0; i != unique_count; ++i) {
-            auto& unique_entry = unique_entries[i];
+        auto reallocate = [&](updated_entry_t& unique_entry) {
             auto bytes_present = unique_entry.length != ustore_length_missing_k ? unique_entry.length : 0;
             auto bytes_for_relations = unique_entry.degree_delta * sizeof(neighborship_t);
             auto bytes_for_degrees = bytes_present > bytes_in_degrees_header_k ? 0 : bytes_in_degrees_header_k;
             auto new_size = bytes_present + bytes_for_relations + bytes_for_degrees;
             auto new_buffer = arena.alloc<byte_t>(new_size, c_error);
-            return_if_error_m(c_error);
+            if (*c_error)
+                return;
             std::memcpy(new_buffer.begin(), unique_entry.content, bytes_present);
 
             unique_entry.content = (ustore_bytes_ptr_t)new_buffer.begin();
             // No need to grow `length` here, we will update in `insert_into_entry` later
             unique_entry.length = bytes_present;
-        }
+        };
+        for (std::size_t i = 0; i != unique_count && !*c_error; ++i)
+            if (!unique_entries[i].sharded)
+                reallocate(unique_entries[i]);
+        for (std::size_t i = 0; i != buckets.fetched().size() && !*c_error; ++i)
+            reallocate(buckets.fetched()[i]);
+        return_if_error_m(c_error);
         // 3. performing insertions
-        for_each_task(&insert_into_entry);
+        for_each_task(routed(&insert_into_entry));
     }
+    return_if_error_m(c_error);
+
+    // Buckets are split, when they outgrow the limit, and vertices are sharded
+    auto max_bucket_degree = c_max_bucket_degree ? c_max_bucket_degree : default_max_bucket_degree_k;
+    buckets.rebalance(unique_entries, max_bucket_degree, !erase_ak);
+    return_if_error_m(c_error);
 
     // Some of the requested updates may have been completely useless, like:
     // > upserting an existing relation.
     // > removing a missing relation.
     // So we can further optimize by cancelling those writes.
-    std::partition(unique_entries.begin(), unique_entries.end(), std::mem_fn(&updated_entry_t::degree_delta));
-
-    // Dump the data back to disk!
-    auto collections = unique_strided.immutable().members(&updated_entry_t::collection);
-    auto keys = unique_strided.immutable().members(&updated_entry_t::key);
-    auto contents = unique_strided.immutable().members(&updated_entry_t::content);
-    auto lengths = unique_strided.immutable().members(&updated_entry_t::length);
-
-    ustore_write_t write {};
-    write.db = c_db;
-    write.error = c_error;
-    write.transaction = c_transaction;
-    write.arena = arena;
-    write.options = c_options;
-    write.tasks_count = unique_count;
-    write.collections = collections.begin().get();
-    write.collections_stride = collections.begin().stride();
-    write.keys = keys.begin().get();
-    write.keys_stride = keys.begin().stride();
-    write.lengths = lengths.begin().get();
-    write.lengths_stride = lengths.begin().stride();
-    write.values = contents.begin().get();
-    write.values_stride = contents.begin().stride();
-
-    ustore_write(&write);
+    bool pack_all = c_encoding == ustore_graph_encoding_packed_k;
+    buckets.write(unique_entries, !erase_ak, pack_all);
 }
 
+#if !defined(USTORE_FLIGHT_CLIENT) // Remote clients forward this call to the server, see `flight_client.cpp`
+
 void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
 
     ustore_graph_find_edges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_find_edges_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -603,6 +2026,10 @@ void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
         c.vertices_stride,
         c.roles,
         c.roles_stride,
+        c.neighbors_min,
+        c.neighbors_min_stride,
+        c.neighbors_max,
+        c.neighbors_max_stride,
         c.options,
         c.degrees_per_vertex,
         c.edges_per_vertex,
@@ -610,9 +2037,660 @@ void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
         c.error);
 }
 
+#endif
+
+/**
+ * @brief Removes from the sorted `discovered` keys all the `visited` ones,
+ * and merges the remaining into the sorted `visited`.
+ * @return The number of remaining `discovered` keys.
+ */
+std::size_t exclude_and_merge(ustore_key_t* discovered,
+                              std::size_t discovered_count,
+                              uninitialized_array_gt<ustore_key_t>& visited,
+                              ustore_error_t* c_error) {
+
+    std::size_t new_count = 0;
+    ustore_key_t const* visited_it = visited.begin();
+    ustore_key_t const* visited_end = visited.end();
+    for (std::size_t i = 0; i != discovered_count; ++i) {
+        visited_it = std::lower_bound(visited_it, visited_end, discovered[i]);
+        if (visited_it == visited_end || *visited_it != discovered[i])
+            discovered[new_count++] = discovered[i];
+    }
+    if (!new_count)
+        return 0;
+
+    // Merge from the back, to avoid additional allocations
+    std::size_t old_count = visited.size();
+    visited.resize(old_count + new_count, c_error);
+    if (*c_error)
+        return 0;
+    ustore_key_t* merged = visited.begin();
+    for (std::size_t old_left = old_count, new_left = new_count; new_left;) {
+        ustore_key_t* output = merged + old_left + new_left - 1;
+        *output = old_left && merged[old_left - 1] > discovered[new_left - 1] ? merged[--old_left]
+                                                                               : discovered[--new_left];
+    }
+    return new_count;
+}
+
+void ustore_graph_traverse(ustore_graph_traverse_t* c_ptr) {
+
+    ustore_graph_traverse_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_traverse_k, c.error};
+    return_error_if_m(c.visited, c.error, args_combo_k, "No outputs requested");
+    return_error_if_m(c.sources || !c.sources_count, c.error, args_combo_k, "Missing sources");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    auto offsets = arena.alloc_or_dummy(c.hops + 2, c.error, c.offsets_per_hop);
+    return_if_error_m(c.error);
+
+    // Vertices in the order of discovery and their sorted copy, to check for membership
+    uninitialized_array_gt<ustore_key_t> visited(c.sources_count, arena, c.error);
+    return_if_error_m(c.error);
+    strided_range_gt<ustore_key_t const> sources {{c.sources, c.sources_stride}, c.sources_count};
+    std::copy(sources.begin(), sources.end(), visited.begin());
+    visited.resize(sort_and_deduplicate(visited.begin(), visited.end()), c.error);
+    uninitialized_array_gt<ustore_key_t> visited_sorted(visited.size(), arena, c.error);
+    return_if_error_m(c.error);
+    std::copy(visited.begin(), visited.end(), visited_sorted.begin());
+
+    strided_iterator_gt<ustore_size_t const> fanouts {c.fanouts, c.fanouts_stride};
+    std::size_t frontier_begin = 0;
+    std::size_t frontier_end = visited.size();
+    offsets[0] = 0;
+    offsets[1] = static_cast<ustore_length_t>(frontier_end);
+
+    for (std::size_t hop = 0; hop != c.hops; ++hop) {
+        std::size_t frontier_count = frontier_end - frontier_begin;
+        if (frontier_count) {
+            ustore_vertex_degree_t* degrees = nullptr;
+            ustore_key_t* neighbors = nullptr;
+            export_edge_tuples<false, true, false>( //
+                c.db,
+                c.transaction,
+                c.snapshot,
+                frontier_count,
+                &c.collection,
+                0,
+                visited.begin() + frontier_begin,
+                sizeof(ustore_key_t),
+                &c.role,
+                0,
+                nullptr,
+                0,
+                nullptr,
+                0,
+                c.options,
+                &degrees,
+                &neighbors,
+                arena,
+                c.error);
+            return_if_error_m(c.error);
+
+            // Compact the exported neighbors, respecting the fan-out limit
+            std::size_t fanout = c.fanouts && fanouts[hop] ? fanouts[hop] : std::numeric_limits<std::size_t>::max();
+            std::size_t exported_count = 0;
+            std::size_t discovered_count = 0;
+            for (std::size_t i = 0; i != frontier_count; ++i) {
+                std::size_t degree = degrees[i] != ustore_vertex_degree_missing_k ? degrees[i] : 0;
+                std::size_t followed = std::min(degree, fanout);
+                std::copy_n(neighbors + exported_count, followed, neighbors + discovered_count);
+                exported_count += degree;
+                discovered_count += followed;
+            }
+
+            discovered_count = sort_and_deduplicate(neighbors, neighbors + discovered_count);
+            discovered_count = exclude_and_merge(neighbors, discovered_count, visited_sorted, c.error);
+            return_if_error_m(c.error);
+
+            visited.insert(visited.size(), neighbors, neighbors + discovered_count, c.error);
+            return_if_error_m(c.error);
+        }
+
+        frontier_begin = frontier_end;
+        frontier_end = visited.size();
+        offsets[hop + 2] = static_cast<ustore_length_t>(frontier_end);
+    }
+
+    *c.visited = visited.begin();
+    if (c.visited_count)
+        *c.visited_count = static_cast<ustore_size_t>(visited.size());
+}
+
+/**
+ * @brief Number of vertices, which keys or neighborhoods are read at once during the CSR export.
+ */
+constexpr std::size_t csr_batch_size_k = 4096;
+
+void ustore_graph_export_csr(ustore_graph_export_csr_t* c_ptr) {
+
+    ustore_graph_export_csr_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_export_csr_k, c.error};
+    return_error_if_m(c.vertices && c.offsets, c.error, args_combo_k, "No outputs requested");
+    return_error_if_m(c.neighbors || !c.edges, c.error, args_combo_k, "Edge IDs are exported with neighbors");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Intermediate batches are read into a separate arena, reset every time,
+    // so that only the outputs accumulate in the `arena`
+    arena_t batch_arena(c.db);
+    auto batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    ustore_key_t min_vertex = c.min_vertex ? *c.min_vertex : std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t max_vertex = c.max_vertex ? *c.max_vertex : std::numeric_limits<ustore_key_t>::max();
+
+    // The first pass collects the IDs and, from the headers, the degrees of vertices
+    uninitialized_array_gt<ustore_key_t> vertices(arena);
+    uninitialized_array_gt<ustore_size_t> offsets(arena);
+    offsets.push_back(0, c.error);
+    return_if_error_m(c.error);
+    for (ustore_key_t start_key = min_vertex; start_key <= max_vertex;) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c.error);
+        return_if_error_m(c.error);
+
+        ustore_length_t count_limit = static_cast<ustore_length_t>(csr_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.snapshot = c.snapshot;
+        scan.arena = batch;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+
+        ustore_size_t found_count = std::upper_bound(found_keys, found_keys + found_counts[0], max_vertex) - found_keys;
+        if (!found_count)
+            break;
+
+        ustore_vertex_degree_t* degrees = nullptr;
+        export_edge_tuples<false, false, false>( //
+            c.db,
+            c.transaction,
+            c.snapshot,
+            found_count,
+            &c.collection,
+            0,
+            found_keys,
+            sizeof(ustore_key_t),
+            &c.role,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            batch_options,
+            &degrees,
+            nullptr,
+            batch,
+            c.error);
+        return_if_error_m(c.error);
+
+        vertices.insert(vertices.size(), found_keys, found_keys + found_count, c.error);
+        return_if_error_m(c.error);
+        offsets.reserve(offsets.size() + found_count, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != found_count; ++i) {
+            std::size_t degree = degrees[i] != ustore_vertex_degree_missing_k ? degrees[i] : 0;
+            offsets.push_back(offsets[offsets.size() - 1] + degree, c.error);
+        }
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != csr_batch_size_k || last_key == max_vertex)
+            break;
+        start_key = last_key + 1;
+    }
+
+    // The second pass fills the neighbors and the edge IDs, allocated at once
+    std::size_t vertices_count = vertices.size();
+    std::size_t neighborships_count = offsets[vertices_count];
+    std::size_t exported_arrays = c.neighbors ? (c.edges ? 2u : 1u) : 0u;
+    auto exported = arena.alloc<ustore_key_t>(neighborships_count * exported_arrays, c.error);
+    return_if_error_m(c.error);
+    ustore_key_t* neighbors = exported.begin();
+    ustore_key_t* edges = c.edges ? neighbors + neighborships_count : nullptr;
+    for (std::size_t batch_begin = 0; batch_begin < vertices_count && exported_arrays; batch_begin += csr_batch_size_k) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c.error);
+        return_if_error_m(c.error);
+
+        std::size_t batch_count = std::min(csr_batch_size_k, vertices_count - batch_begin);
+        ustore_vertex_degree_t* degrees = nullptr;
+        ustore_key_t* tuples = nullptr;
+        export_edge_tuples<false, true, true>( //
+            c.db,
+            c.transaction,
+            c.snapshot,
+            batch_count,
+            &c.collection,
+            0,
+            vertices.begin() + batch_begin,
+            sizeof(ustore_key_t),
+            &c.role,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            batch_options,
+            &degrees,
+            &tuples,
+            batch,
+            c.error);
+        return_if_error_m(c.error);
+
+        for (std::size_t i = 0; i != batch_count; ++i) {
+            std::size_t offset = offsets[batch_begin + i];
+            std::size_t degree = degrees[i] != ustore_vertex_degree_missing_k ? degrees[i] : 0;
+            return_error_if_m(offset + degree == offsets[batch_begin + i + 1],
+                              c.error,
+                              consistency_k,
+                              "Graph changed during the export, use a snapshot");
+            for (std::size_t j = 0; j != degree; ++j, tuples += 2) {
+                neighbors[offset + j] = tuples[0];
+                if (edges)
+                    edges[offset + j] = tuples[1];
+            }
+        }
+    }
+
+    if (c.vertices_count)
+        *c.vertices_count = static_cast<ustore_size_t>(vertices_count);
+    *c.vertices = vertices.begin();
+    *c.offsets = offsets.begin();
+    if (c.neighbors)
+        *c.neighbors = neighbors;
+    if (c.edges)
+        *c.edges = edges;
+}
+
+/*********************************************************/
+/*****************	  Graph Algorithms	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Number of vertices in every chunk of work of the graph algorithms.
+ * Small enough for idle threads to share the work around high-degree vertices.
+ */
+constexpr std::size_t algorithm_chunk_size_k = 256;
+
+std::size_t count_vertices_chunks(std::size_t vertices_count) noexcept {
+    return divide_round_up(vertices_count, algorithm_chunk_size_k);
+}
+
+/**
+ * @brief Calls `process(chunk_idx, begin, end)` for consecutive chunks of `vertices_count` vertices,
+ * in up to `threads_count` threads, including the calling one. Every thread takes the next chunk
+ * from a shared counter, once it is done with the previous one. If threads can't be spawned,
+ * the remaining chunks are processed by the calling thread.
+ */
+template <typename process_at>
+void for_each_vertices_chunk(std::size_t vertices_count, std::size_t threads_count, process_at&& process) noexcept {
+    std::size_t const chunks_count = count_vertices_chunks(vertices_count);
+    std::atomic<std::size_t> next_chunk {0};
+    auto take_chunks = [&]() {
+        for (std::size_t chunk_idx = next_chunk++; chunk_idx < chunks_count; chunk_idx = next_chunk++) {
+            std::size_t begin = chunk_idx * algorithm_chunk_size_k;
+            process(chunk_idx, begin, std::min(begin + algorithm_chunk_size_k, vertices_count));
+        }
+    };
+
+    threads_count = std::min(std::max<std::size_t>(threads_count, 1), std::max<std::size_t>(chunks_count, 1));
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(threads_count - 1);
+        while (threads.size() + 1 < threads_count)
+            threads.emplace_back(take_chunks);
+    }
+    catch (...) {
+    }
+    take_chunks();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Adjacency of the whole graph in the CSR format, where neighbors are replaced with
+ * their positions among `vertices`. Neighbors without entries of their own are marked with -1.
+ */
+struct indexed_csr_t {
+    arena_t arena;
+    ustore_size_t vertices_count = 0;
+    ustore_key_t* vertices = nullptr;
+    ustore_size_t* offsets = nullptr;
+    ustore_key_t* neighbors = nullptr;
+
+    indexed_csr_t(ustore_database_t db) noexcept : arena(db) {}
+
+    std::size_t degree(std::size_t i) const noexcept { return offsets[i + 1] - offsets[i]; }
+    bool same_vertices(indexed_csr_t const& other) const noexcept {
+        return vertices_count == other.vertices_count &&
+               std::equal(vertices, vertices + vertices_count, other.vertices);
+    }
+};
+
+/**
+ * @brief Exports the adjacency of the graph, addressed by an algorithm request `c`,
+ * mapping the neighbor IDs into positions in parallel. Without `export_neighbors`,
+ * only the degrees are parsed from the headers of entries.
+ */
+template <typename request_at>
+void export_indexed_csr(request_at& c, ustore_vertex_role_t role, bool export_neighbors, indexed_csr_t& csr) {
+
+    ustore_graph_export_csr_t graph_export {};
+    graph_export.db = c.db;
+    graph_export.error = c.error;
+    graph_export.transaction = c.transaction;
+    graph_export.snapshot = c.snapshot;
+    graph_export.arena = csr.arena.member_ptr();
+    graph_export.options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    graph_export.collection = c.collection;
+    graph_export.role = role;
+    graph_export.vertices_count = &csr.vertices_count;
+    graph_export.vertices = &csr.vertices;
+    graph_export.offsets = &csr.offsets;
+    graph_export.neighbors = export_neighbors ? &csr.neighbors : nullptr;
+    ustore_graph_export_csr(&graph_export);
+    return_if_error_m(c.error);
+    if (!export_neighbors)
+        return;
+
+    ustore_key_t const* vertices = csr.vertices;
+    ustore_key_t const* vertices_end = csr.vertices + csr.vertices_count;
+    for_each_vertices_chunk(csr.vertices_count, c.threads_count, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = csr.offsets[begin]; i != csr.offsets[end]; ++i) {
+            ustore_key_t const* it = std::lower_bound(vertices, vertices_end, csr.neighbors[i]);
+            csr.neighbors[i] = it != vertices_end && *it == csr.neighbors[i] ? it - vertices : -1;
+        }
+    });
+}
+
+void ustore_graph_pagerank(ustore_graph_pagerank_t* c_ptr) {
+
+    ustore_graph_pagerank_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_pagerank_k, c.error};
+    return_error_if_m(c.vertices && c.ranks, c.error, args_combo_k, "No outputs requested");
+    double const damping = c.damping ? c.damping : 0.85;
+    double const tolerance = c.tolerance ? c.tolerance : 1e-6;
+    std::size_t const iterations_limit = c.iterations_limit ? c.iterations_limit : 100;
+    return_error_if_m(damping > 0 && damping < 1, c.error, args_wrong_k, "Damping must be between zero and one");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Ranks are pulled from the predecessors, divided by their out-degrees, parsed from the headers
+    indexed_csr_t incoming(c.db), outgoing(c.db);
+    export_indexed_csr(c, ustore_vertex_target_k, true, incoming);
+    return_if_error_m(c.error);
+    export_indexed_csr(c, ustore_vertex_source_k, false, outgoing);
+    return_if_error_m(c.error);
+    return_error_if_m(incoming.same_vertices(outgoing),
+                      c.error,
+                      consistency_k,
+                      "Graph changed during the export, use a snapshot");
+
+    std::size_t const vertices_count = incoming.vertices_count;
+    std::size_t const chunks_count = count_vertices_chunks(vertices_count);
+    auto vertices = arena.alloc<ustore_key_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    auto ranks = arena.alloc<ustore_float_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    std::copy_n(incoming.vertices, vertices_count, vertices.begin());
+
+    // Ranks and their shares, passed to every successor, are double-buffered,
+    // so that threads never read the values updated in the same iteration
+    arena_t work_arena(c.db);
+    linked_memory_lock_t work = linked_memory(work_arena.member_ptr(), ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto buffers = work.alloc<double>(vertices_count * 4 + chunks_count * 2, c.error);
+    return_if_error_m(c.error);
+    double* old_ranks = buffers.begin();
+    double* new_ranks = old_ranks + vertices_count;
+    double* old_shares = new_ranks + vertices_count;
+    double* new_shares = old_shares + vertices_count;
+    double* chunks_changes = new_shares + vertices_count;
+    double* chunks_dangling = chunks_changes + chunks_count;
+
+    double dangling = 0;
+    for (std::size_t i = 0; i != vertices_count; ++i) {
+        std::size_t out_degree = outgoing.degree(i);
+        old_ranks[i] = 1.0 / vertices_count;
+        old_shares[i] = out_degree ? old_ranks[i] / out_degree : 0.0;
+        dangling += out_degree ? 0.0 : old_ranks[i];
+    }
+
+    std::size_t iterations = 0;
+    while (iterations != iterations_limit && vertices_count) {
+        double const teleport = (1.0 - damping + damping * dangling) / vertices_count;
+        auto rank_chunk = [&](std::size_t chunk_idx, std::size_t begin, std::size_t end) {
+            double chunk_changes = 0, chunk_dangling = 0;
+            for (std::size_t i = begin; i != end; ++i) {
+                double pulled = 0;
+                for (std::size_t j = incoming.offsets[i]; j != incoming.offsets[i + 1]; ++j)
+                    pulled += incoming.neighbors[j] >= 0 ? old_shares[incoming.neighbors[j]] : 0.0;
+                std::size_t out_degree = outgoing.degree(i);
+                new_ranks[i] = teleport + damping * pulled;
+                new_shares[i] = out_degree ? new_ranks[i] / out_degree : 0.0;
+                chunk_changes += std::abs(new_ranks[i] - old_ranks[i]);
+                chunk_dangling += out_degree ? 0.0 : new_ranks[i];
+            }
+            chunks_changes[chunk_idx] = chunk_changes;
+            chunks_dangling[chunk_idx] = chunk_dangling;
+        };
+        for_each_vertices_chunk(vertices_count, c.threads_count, rank_chunk);
+
+        std::swap(old_ranks, new_ranks);
+        std::swap(old_shares, new_shares);
+        ++iterations;
+        dangling = std::accumulate(chunks_dangling, chunks_dangling + chunks_count, 0.0);
+        if (std::accumulate(chunks_changes, chunks_changes + chunks_count, 0.0) < tolerance)
+            break;
+    }
+
+    // Edges to vertices without entries lose a bit of mass, so the ranks are normalized
+    double total = std::accumulate(old_ranks, old_ranks + vertices_count, 0.0);
+    for (std::size_t i = 0; i != vertices_count; ++i)
+        ranks[i] = static_cast<ustore_float_t>(old_ranks[i] / total);
+
+    if (c.vertices_count)
+        *c.vertices_count = static_cast<ustore_size_t>(vertices_count);
+    if (c.iterations)
+        *c.iterations = static_cast<ustore_size_t>(iterations);
+    *c.vertices = vertices.begin();
+    *c.ranks = ranks.begin();
+}
+
+void ustore_graph_components(ustore_graph_components_t* c_ptr) {
+
+    ustore_graph_components_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_components_k, c.error};
+    return_error_if_m(c.vertices && c.components, c.error, args_combo_k, "No outputs requested");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Every edge is followed once, from its source
+    indexed_csr_t outgoing(c.db);
+    export_indexed_csr(c, ustore_vertex_source_k, true, outgoing);
+    return_if_error_m(c.error);
+
+    std::size_t const vertices_count = outgoing.vertices_count;
+    std::size_t const chunks_count = count_vertices_chunks(vertices_count);
+    auto vertices = arena.alloc<ustore_key_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    auto components = arena.alloc<ustore_key_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    std::copy_n(outgoing.vertices, vertices_count, vertices.begin());
+
+    arena_t work_arena(c.db);
+    linked_memory_lock_t work = linked_memory(work_arena.member_ptr(), ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto parents = work.alloc<std::atomic<std::size_t>>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    auto chunks_roots = work.alloc<std::size_t>(chunks_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != vertices_count; ++i)
+        new (&parents[i]) std::atomic<std::size_t>(i);
+
+    // Parents always precede their children, so the smallest vertex of a component becomes its root.
+    // Following the links, they are halved, which is safe, as every parent remains an ancestor.
+    auto find_root = [&](std::size_t i) noexcept {
+        std::size_t parent = parents[i].load(std::memory_order_relaxed);
+        while (parent != i) {
+            std::size_t grandparent = parents[parent].load(std::memory_order_relaxed);
+            if (grandparent != parent)
+                parents[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            i = grandparent;
+            parent = parents[i].load(std::memory_order_relaxed);
+        }
+        return i;
+    };
+    auto unite = [&](std::size_t a, std::size_t b) noexcept {
+        while (true) {
+            a = find_root(a);
+            b = find_root(b);
+            if (a == b)
+                return;
+            if (a < b)
+                std::swap(a, b);
+            // Only roots are linked, and only if no other thread did it first
+            std::size_t expected = a;
+            if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                return;
+        }
+    };
+
+    for_each_vertices_chunk(vertices_count, c.threads_count, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            for (std::size_t j = outgoing.offsets[i]; j != outgoing.offsets[i + 1]; ++j)
+                if (outgoing.neighbors[j] >= 0)
+                    unite(i, static_cast<std::size_t>(outgoing.neighbors[j]));
+    });
+    auto label_chunk = [&](std::size_t chunk_idx, std::size_t begin, std::size_t end) {
+        std::size_t chunk_roots = 0;
+        for (std::size_t i = begin; i != end; ++i) {
+            std::size_t root = find_root(i);
+            components[i] = vertices[root];
+            chunk_roots += root == i;
+        }
+        chunks_roots[chunk_idx] = chunk_roots;
+    };
+    for_each_vertices_chunk(vertices_count, c.threads_count, label_chunk);
+
+    if (c.vertices_count)
+        *c.vertices_count = static_cast<ustore_size_t>(vertices_count);
+    if (c.components_count)
+        *c.components_count = static_cast<ustore_size_t>(
+            std::accumulate(chunks_roots.begin(), chunks_roots.end(), std::size_t(0)));
+    *c.vertices = vertices.begin();
+    *c.components = components.begin();
+}
+
+void ustore_graph_triangles(ustore_graph_triangles_t* c_ptr) {
+
+    ustore_graph_triangles_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_triangles_k, c.error};
+    return_error_if_m(c.vertices && (c.triangles || c.triangles_count),
+                      c.error,
+                      args_combo_k,
+                      "No outputs requested");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    indexed_csr_t csr(c.db);
+    export_indexed_csr(c, ustore_vertex_role_any_k, true, csr);
+    return_if_error_m(c.error);
+
+    std::size_t const vertices_count = csr.vertices_count;
+    std::size_t const chunks_count = count_vertices_chunks(vertices_count);
+    auto vertices = arena.alloc<ustore_key_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    auto triangles = arena.alloc_or_dummy(vertices_count, c.error, c.triangles);
+    return_if_error_m(c.error);
+    std::copy_n(csr.vertices, vertices_count, vertices.begin());
+
+    arena_t work_arena(c.db);
+    linked_memory_lock_t work = linked_memory(work_arena.member_ptr(), ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto ends = work.alloc<std::size_t>(vertices_count, c.error);
+    return_if_error_m(c.error);
+    auto counts = work.alloc<std::atomic<std::size_t>>(c.triangles ? vertices_count : 0, c.error);
+    return_if_error_m(c.error);
+    auto chunks_triangles = work.alloc<std::size_t>(chunks_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != counts.size(); ++i)
+        new (&counts[i]) std::atomic<std::size_t>(0);
+
+    // Outgoing and incoming neighbors are merged into one sorted set, excluding the vertex itself
+    for_each_vertices_chunk(vertices_count, c.threads_count, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            ustore_key_t* neighbors = csr.neighbors + csr.offsets[i];
+            ustore_key_t* neighbors_end = csr.neighbors + csr.offsets[i + 1];
+            ustore_key_t const self = static_cast<ustore_key_t>(i);
+            auto is_excluded = [=](ustore_key_t j) { return j < 0 || j == self; };
+            neighbors_end = std::remove_if(neighbors, neighbors_end, is_excluded);
+            ends[i] = csr.offsets[i] + sort_and_deduplicate(neighbors, neighbors_end);
+        }
+    });
+
+    // Every triangle `(i, j, k)`, where `i < j < k`, is found from `i`
+    auto count_chunk = [&](std::size_t chunk_idx, std::size_t begin, std::size_t end) {
+        std::size_t chunk_triangles = 0;
+        for (std::size_t i = begin; i != end; ++i) {
+            ustore_key_t const* i_begin = csr.neighbors + csr.offsets[i];
+            ustore_key_t const* i_end = csr.neighbors + ends[i];
+            ustore_key_t const* i_greater = std::upper_bound(i_begin, i_end, ustore_key_t(i));
+            for (ustore_key_t const* j_it = i_greater; j_it != i_end; ++j_it) {
+                std::size_t const j = static_cast<std::size_t>(*j_it);
+                ustore_key_t const* j_begin = csr.neighbors + csr.offsets[j];
+                ustore_key_t const* j_end = csr.neighbors + ends[j];
+                ustore_key_t const* j_greater = std::upper_bound(j_begin, j_end, *j_it);
+                for (ustore_key_t const *a = j_it + 1, *b = j_greater; a != i_end && b != j_end;) {
+                    if (*a < *b)
+                        ++a;
+                    else if (*b < *a)
+                        ++b;
+                    else {
+                        ++chunk_triangles;
+                        if (counts.size()) {
+                            counts[i].fetch_add(1, std::memory_order_relaxed);
+                            counts[j].fetch_add(1, std::memory_order_relaxed);
+                            counts[static_cast<std::size_t>(*a)].fetch_add(1, std::memory_order_relaxed);
+                        }
+                        ++a, ++b;
+                    }
+                }
+            }
+        }
+        chunks_triangles[chunk_idx] = chunk_triangles;
+    };
+    for_each_vertices_chunk(vertices_count, c.threads_count, count_chunk);
+
+    for (std::size_t i = 0; i != counts.size(); ++i)
+        triangles[i] = static_cast<ustore_size_t>(counts[i].load(std::memory_order_relaxed));
+    if (c.vertices_count)
+        *c.vertices_count = static_cast<ustore_size_t>(vertices_count);
+    if (c.triangles_count)
+        *c.triangles_count = static_cast<ustore_size_t>(
+            std::accumulate(chunks_triangles.begin(), chunks_triangles.end(), std::size_t(0)));
+    *c.vertices = vertices.begin();
+}
+
 void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
 
     ustore_graph_upsert_edges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_upsert_edges_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -632,6 +2710,8 @@ void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
         c.targets_ids,
         c.targets_stride,
         c.options,
+        c.encoding,
+        c.max_bucket_degree,
         arena,
         c.error);
 }
@@ -639,6 +2719,7 @@ void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
 void ustore_graph_remove_edges(ustore_graph_remove_edges_t* c_ptr) {
 
     ustore_graph_remove_edges_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_remove_edges_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -658,6 +2739,8 @@ void ustore_graph_remove_edges(ustore_graph_remove_edges_t* c_ptr) {
         c.targets_ids,
         c.targets_stride,
         c.options,
+        ustore_graph_encoding_plain_k,
+        0,
         arena,
         c.error);
 }
@@ -665,6 +2748,7 @@ void ustore_graph_remove_edges(ustore_graph_remove_edges_t* c_ptr) {
 void ustore_graph_upsert_vertices(ustore_graph_upsert_vertices_t* c_ptr) {
 
     ustore_graph_upsert_vertices_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_upsert_vertices_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -719,6 +2803,7 @@ void ustore_graph_upsert_vertices(ustore_graph_upsert_vertices_t* c_ptr) {
 void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
 
     ustore_graph_remove_vertices_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::graph_remove_vertices_k, c.error};
     if (!c.tasks_count)
         return;
 
@@ -743,6 +2828,10 @@ void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
         c.vertices_stride,
         c.roles,
         c.roles_stride,
+        nullptr,
+        0,
+        nullptr,
+        0,
         c.options,
         &degrees_per_vertex,
         &neighbors_per_vertex,
@@ -752,7 +2841,12 @@ void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
 
     // Enumerate the opposite ends, from which that same reference must be removed.
     // Here all the keys will be in the sorted order.
-    auto unique_count = std::accumulate(degrees_per_vertex, degrees_per_vertex + c.tasks_count, c.tasks_count);
+    auto degree_at = [=](std::size_t i) noexcept {
+        return degrees_per_vertex[i] != ustore_vertex_degree_missing_k ? degrees_per_vertex[i] : 0u;
+    };
+    std::size_t unique_count = c.tasks_count;
+    for (std::size_t i = 0; i != c.tasks_count; ++i)
+        unique_count += degree_at(i);
     auto unique_entries = arena.alloc<updated_entry_t>(unique_count, c.error);
     return_if_error_m(c.error);
     std::fill(unique_entries.begin(), unique_entries.end(), updated_entry_t {});
@@ -761,12 +2855,13 @@ void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
     // We may also face repetitions when connected vertices are removed.
     {
         auto planned_entries = unique_entries.begin();
+        ustore_key_t const* neighbor_ids = neighbors_per_vertex;
         for (std::size_t i = 0; i != c.tasks_count; ++i) {
             auto collection = planned_entries->collection = vertex_collections[i];
             planned_entries->key = vertices[i];
             ++planned_entries;
-            for (std::size_t j = 0; j != degrees_per_vertex[i]; ++j, ++neighbors_per_vertex, ++planned_entries)
-                planned_entries->collection = collection, planned_entries->key = *neighbors_per_vertex;
+            for (std::size_t j = 0; j != degree_at(i); ++j, ++neighbor_ids, ++planned_entries)
+                planned_entries->collection = collection, planned_entries->key = *neighbor_ids;
         }
         unique_count = sort_and_deduplicate(unique_entries.begin(), planned_entries);
         unique_entries = {unique_entries.begin(), unique_count};
@@ -778,51 +2873,56 @@ void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
     pull_and_link_for_updates(c.db, c.transaction, unique_strided, c.options, arena, c.error);
     return_if_error_m(c.error);
 
+    // The neighbors are taken from the exported lists, as the sharded vertices only hold directories
+    auto for_each_neighbor = [&](auto vertex_neighbor_callback) {
+        ustore_key_t const* neighbor_ids = neighbors_per_vertex;
+        for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
+            auto vertex_collection = vertex_collections[i];
+            auto vertex_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, vertices[i]});
+            updated_entry_t& vertex_value = unique_entries[vertex_idx];
+            for (std::size_t j = 0; j != degree_at(i); ++j, ++neighbor_ids) {
+                auto neighbor_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, *neighbor_ids});
+                vertex_neighbor_callback(i, vertex_value, unique_entries[neighbor_idx]);
+            }
+            vertex_neighbor_callback(i, vertex_value, vertex_value);
+        }
+    };
+
+    buckets_t buckets {c.db, c.transaction, c.options, arena, c.error};
+    for_each_neighbor([&](std::size_t i, updated_entry_t& vertex_value, updated_entry_t& neighbor_value) {
+        if (&vertex_value != &neighbor_value)
+            buckets.request(neighbor_value, vertices[i]);
+    });
+    return_if_error_m(c.error);
+    buckets.fetch();
+    return_if_error_m(c.error);
+
     // From every opposite end - remove a match, and only then - the content itself
-    for (std::size_t i = 0; i != unique_strided.size(); ++i) {
-        auto vertex_collection = vertex_collections[i];
+    for_each_neighbor([&](std::size_t i, updated_entry_t& vertex_value, updated_entry_t& neighbor_value) {
         auto vertex_id = vertices[i];
         auto vertex_role = vertex_roles ? vertex_roles[i] : ustore_vertex_role_any_k;
-
-        auto vertex_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, vertex_id});
-        updated_entry_t& vertex_value = unique_entries[vertex_idx];
-
-        for (neighborship_t n : neighbors(vertex_value, vertex_role)) {
-            auto neighbor_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, n.neighbor_id});
-            updated_entry_t& neighbor_value = unique_entries[neighbor_idx];
-            if (vertex_role == ustore_vertex_role_any_k) {
-                erase_from_entry(neighbor_value, ustore_vertex_source_k, vertex_id);
-                erase_from_entry(neighbor_value, ustore_vertex_target_k, vertex_id);
-            }
-            else
-                erase_from_entry(neighbor_value, invert(vertex_role), vertex_id);
+        if (&vertex_value == &neighbor_value) {
+            buckets.remove(vertex_value);
+            vertex_value.content = nullptr;
+            vertex_value.length = ustore_length_missing_k;
+            vertex_value.degree_delta = std::max<ustore_vertex_degree_t>(vertex_value.degree_delta, 1);
+            return;
         }
 
-        vertex_value.content = nullptr;
-        vertex_value.length = ustore_length_missing_k;
-    }
+        updated_entry_t* routed_value = buckets.route(neighbor_value, vertex_id);
+        if (!routed_value)
+            return;
+        if (vertex_role == ustore_vertex_role_any_k) {
+            erase_from_entry(*routed_value, ustore_vertex_source_k, vertex_id);
+            erase_from_entry(*routed_value, ustore_vertex_target_k, vertex_id);
+        }
+        else
+            erase_from_entry(*routed_value, invert(vertex_role), vertex_id);
+    });
+    return_if_error_m(c.error);
 
     // Now we will go through all the explicitly deleted vertices
-    auto collections = unique_strided.immutable().members(&updated_entry_t::collection);
-    auto keys = unique_strided.immutable().members(&updated_entry_t::key);
-    auto lengths = unique_strided.immutable().members(&updated_entry_t::length);
-    auto contents = unique_strided.immutable().members(&updated_entry_t::content);
-
-    ustore_write_t write {};
-    write.db = c.db;
-    write.error = c.error;
-    write.transaction = c.transaction;
-    write.arena = arena;
-    write.options = c.options;
-    write.tasks_count = unique_count;
-    write.collections = collections.begin().get();
-    write.collections_stride = collections.begin().stride();
-    write.keys = keys.begin().get();
-    write.keys_stride = keys.begin().stride();
-    write.lengths = lengths.begin().get();
-    write.lengths_stride = lengths.begin().stride();
-    write.values = contents.begin().get();
-    write.values_stride = contents.begin().stride();
-
-    ustore_write(&write);
+    buckets.rebalance(unique_entries, default_max_bucket_degree_k, false);
+    return_if_error_m(c.error);
+    buckets.write(unique_entries, false, false);
 }
\ No newline at end of file
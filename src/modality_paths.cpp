@@ -6,12 +6,23 @@
  * Sits on top of any @see "ustore.h"-compatible system.
  *
  * For every string key hash we store:
- * - N = number of entries (1 if no collisions appeared)
+ * - N = number of entries (1 if no collisions appeared), with the highest bit set
+ * - N one-byte fingerprints of keys, padded to a multiple of 4 bytes
  * - N key offsets
  * - N value lengths
  * - N concatenated keys
  * - N concatenated values
  *
+ * Fingerprints are compared with SIMD before any key bytes are touched.
+ * Buckets written by older versions lack the flag and the fingerprints,
+ * but remain readable and get the fingerprints on their next update.
+ *
+ * ## Hashing
+ *
+ * New collections hash paths with a stable 64-bit hash, recording that choice
+ * in an empty-bucket-like metadata entry under the smallest key. Collections
+ * filled before that, keep hashing with `std::hash` to remain addressable.
+ *
  * ## Mirror "Directory" Entries for Nested Paths
  *
  * Furthermore, we need to store mirror entries, that will
@@ -23,8 +34,23 @@
  *
  * The mirror "directory" entries can have negative IDs.
  * Their values would be structured differently.
+ *
+ * ## Prefix Indexes
+ *
+ * Collections with a declared prefix index also keep every path in a hidden
+ * collection, ordered by the first 8 bytes of paths, so prefix matches don't
+ * have to visit every hash bucket. @see `ustore_paths_index_create_t`.
  */
 
+#include <cctype>        // `std::isalnum`
+#include <memory>        // `std::shared_ptr`
+#include <mutex>         // `std::mutex`
+#include <string>        // `std::string`
+#include <thread>        // `std::thread`
+#include <tuple>         // `std::tie`
+#include <unordered_map> // Compiled RegEx cache
+#include <vector>        // `std::vector`
+
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
 
@@ -35,6 +61,16 @@
 #include "helpers/linked_array.hpp"  // `uninitialized_array_gt`
 #include "helpers/algorithm.hpp"     // `sort_and_deduplicate`
 #include "helpers/full_scan.hpp"     // `full_scan_collection`
+#include "helpers/hash.hpp"          // `stable_hash`
+#include "helpers/metrics.hpp"       // `metered_call_t`
+
+#if defined(__SSE2__)
+#define USTORE_PATHS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define USTORE_PATHS_NEON 1
+#include <arm_neon.h>
+#endif
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -43,41 +79,100 @@
 using namespace unum::ustore;
 using namespace unum;
 
+/**
+ * @brief Hash functions, that map paths into bucket keys.
+ * Collections filled before the stable hash was introduced keep using `std::hash`,
+ * which differs between standard libraries. The choice is persisted per collection.
+ */
+enum class paths_hash_kind_t : ustore_length_t {
+    std_k = 0,
+    stable_k = 1,
+};
+
+/**
+ * @brief Collections hashed with the stable hash keep their metadata under this key,
+ * which the stable hash never produces. The entry looks like an empty bucket to scans.
+ */
+constexpr ustore_key_t paths_metadata_key_k = std::numeric_limits<ustore_key_t>::min();
+
+struct paths_metadata_t {
+    ustore_length_t empty_bucket_size = 0;
+    paths_hash_kind_t hash = paths_hash_kind_t::stable_k;
+};
+
+static paths_metadata_t const paths_metadata_k {};
+
 struct hash_t {
+    paths_hash_kind_t kind = paths_hash_kind_t::std_k;
+
     ustore_key_t operator()(std::string_view key_str) const noexcept {
-        using ucset_t = std::hash<std::string_view>;
-        auto result = ucset_t {}(key_str);
+        std::uint64_t result = kind == paths_hash_kind_t::stable_k //
+                                   ? stable_hash(key_str)
+                                   : std::hash<std::string_view> {}(key_str);
 #ifdef USTORE_DEBUG
         result %= 10ul;
 #endif
-        return static_cast<ustore_key_t>(result);
+        auto key = static_cast<ustore_key_t>(result);
+        if (kind == paths_hash_kind_t::stable_k && key == paths_metadata_key_k)
+            ++key;
+        return key;
     }
 };
 
+/**
+ * @brief All the entries of a bucket share the hash of their paths,
+ * so fingerprints are taken from an independently seeded hash.
+ */
+constexpr std::uint64_t fingerprint_seed_k = 0x7061746873ull;
+
+using fingerprint_t = std::uint8_t;
+
+inline fingerprint_t path_fingerprint(std::string_view key_str) noexcept {
+    return static_cast<fingerprint_t>(stable_hash(key_str, fingerprint_seed_k) >> 56);
+}
+
 constexpr std::size_t counter_size_k = sizeof(ustore_length_t);
 constexpr std::size_t bytes_in_header_k = counter_size_k;
+constexpr ustore_length_t fingerprints_flag_k = ustore_length_t(1) << 31;
 
-ustore_length_t get_bucket_size(value_view_t bucket) noexcept {
-    auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    return bucket.size() > bytes_in_header_k ? *lengths : 0u;
+inline std::size_t fingerprints_bytes(std::size_t count) noexcept {
+    return divide_round_up(count, counter_size_k) * counter_size_k;
 }
 
-ptr_range_gt<ustore_length_t const> get_bucket_counters(value_view_t bucket, ustore_length_t size) noexcept {
-    auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    return {lengths, lengths + size * 2u + 1u};
-}
+/**
+ * @brief Parsed layout of a bucket, that may or may not contain fingerprints.
+ * Buckets without the fingerprints flag in the header were written by older versions.
+ */
+struct bucket_view_t {
+    ustore_length_t size = 0;
+    fingerprint_t const* fingerprints = nullptr;
+    ustore_length_t const* keys_lengths = nullptr;
+    ustore_length_t const* vals_lengths = nullptr;
+    byte_t const* keys = nullptr;
+    byte_t const* vals = nullptr;
+};
 
-consecutive_strs_iterator_t get_bucket_keys(value_view_t bucket, ustore_length_t size) noexcept {
-    auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    auto bytes_for_counters = size * 2u * counter_size_k;
-    return {lengths + 1u, bucket.data() + bytes_in_header_k + bytes_for_counters};
+bucket_view_t parse_bucket(value_view_t bucket) noexcept {
+    bucket_view_t view;
+    if (bucket.size() <= bytes_in_header_k)
+        return view;
+
+    auto header = *reinterpret_cast<ustore_length_t const*>(bucket.data());
+    view.size = header & ~fingerprints_flag_k;
+    auto counters = bucket.data() + bytes_in_header_k;
+    if (header & fingerprints_flag_k) {
+        view.fingerprints = reinterpret_cast<fingerprint_t const*>(counters);
+        counters += fingerprints_bytes(view.size);
+    }
+    view.keys_lengths = reinterpret_cast<ustore_length_t const*>(counters);
+    view.vals_lengths = view.keys_lengths + view.size;
+    view.keys = counters + view.size * 2u * counter_size_k;
+    view.vals = view.keys + std::accumulate(view.keys_lengths, view.keys_lengths + view.size, std::size_t(0));
+    return view;
 }
 
-consecutive_blobs_iterator_t get_bucket_vals(value_view_t bucket, ustore_length_t size) noexcept {
-    auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    auto bytes_for_counters = size * 2u * counter_size_k;
-    auto bytes_for_keys = std::accumulate(lengths + 1u, lengths + 1u + size, 0ul);
-    return {lengths + 1u + size, bucket.data() + bytes_in_header_k + bytes_for_counters + bytes_for_keys};
+ustore_length_t get_bucket_size(value_view_t bucket) noexcept {
+    return parse_bucket(bucket).size;
 }
 
 struct bucket_member_t {
@@ -90,20 +185,83 @@ struct bucket_member_t {
 
 template <typename bucket_member_callback_at>
 void for_each_in_bucket(value_view_t bucket, bucket_member_callback_at member_callback) noexcept {
-    auto bucket_size = get_bucket_size(bucket);
-    if (!bucket_size)
-        return;
-    auto bucket_keys = get_bucket_keys(bucket, bucket_size);
-    auto bucket_vals = get_bucket_vals(bucket, bucket_size);
-    for (std::size_t i = 0; i != bucket_size; ++i, ++bucket_keys, ++bucket_vals)
-        member_callback(bucket_member_t {i, *bucket_keys, *bucket_vals});
+    bucket_view_t view = parse_bucket(bucket);
+    auto key = view.keys;
+    auto val = view.vals;
+    for (std::size_t i = 0; i != view.size; ++i) {
+        auto key_length = view.keys_lengths[i];
+        auto val_length = view.vals_lengths[i];
+        member_callback(bucket_member_t {
+            i,
+            std::string_view {reinterpret_cast<char const*>(key), key_length},
+            value_view_t {val, val_length},
+        });
+        key += key_length;
+        val += val_length;
+    }
+}
+
+/**
+ * @brief Calls `callback` with the indexes of fingerprints equal to `wanted`, until it returns false.
+ * Compares 16 fingerprints at a time with SSE2 or NEON, if those are available.
+ */
+template <typename callback_at>
+void for_each_fingerprint_match(fingerprint_t const* fingerprints,
+                                std::size_t count,
+                                fingerprint_t wanted,
+                                callback_at&& callback) noexcept {
+    std::size_t i = 0;
+#if defined(USTORE_PATHS_SSE2)
+    __m128i wanted_vec = _mm_set1_epi8(static_cast<char>(wanted));
+    for (; i + 16 <= count; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(fingerprints + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted_vec)));
+        for (; mask; mask &= mask - 1u)
+            if (!callback(i + static_cast<std::size_t>(__builtin_ctz(mask))))
+                return;
+    }
+#elif defined(USTORE_PATHS_NEON)
+    uint8x16_t wanted_vec = vdupq_n_u8(wanted);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t matches = vceqq_u8(vld1q_u8(fingerprints + i), wanted_vec);
+        // Narrow every matching byte to a nibble of a 64-bit mask
+        uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+        std::uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+        while (mask) {
+            auto lane = static_cast<std::size_t>(__builtin_ctzll(mask)) / 4u;
+            if (!callback(i + lane))
+                return;
+            mask &= ~(0xFull << (lane * 4u));
+        }
+    }
+#endif
+    for (; i != count; ++i)
+        if (fingerprints[i] == wanted && !callback(i))
+            return;
 }
 
 bucket_member_t find_in_bucket(value_view_t bucket, std::string_view key_str) noexcept {
+    bucket_view_t view = parse_bucket(bucket);
     bucket_member_t result;
-    for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
-        if (member.key == key_str)
-            result = member;
+    if (!view.fingerprints || view.size == 1) {
+        for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
+            if (member.key == key_str)
+                result = member;
+        });
+        return result;
+    }
+
+    // Only the entries with matching fingerprints are compared byte-by-byte
+    for_each_fingerprint_match(view.fingerprints, view.size, path_fingerprint(key_str), [&](std::size_t i) {
+        if (view.keys_lengths[i] != key_str.size())
+            return true;
+        auto key_offset = std::accumulate(view.keys_lengths, view.keys_lengths + i, std::size_t(0));
+        auto key = std::string_view {reinterpret_cast<char const*>(view.keys) + key_offset, key_str.size()};
+        if (key != key_str)
+            return true;
+        auto val_offset = std::accumulate(view.vals_lengths, view.vals_lengths + i, std::size_t(0));
+        result = bucket_member_t {i, key, value_view_t {view.vals + val_offset, view.vals_lengths[i]}};
+        return false;
     });
     return result;
 }
@@ -146,107 +304,529 @@ bool is_prefix(std::string_view prefix_or_pattern) noexcept {
 }
 
 /**
- * @brief Removes part of variable length string.
- * @return The shortened view of the input. Will start from same address.
+ * @brief Replaces the value of a path in a bucket, or removes the path, if the `value` is missing.
  */
-value_view_t remove_part(value_view_t full, value_view_t part) noexcept {
-    auto removed_length = part.size();
-    auto moved_length = full.size() - part.size();
-    std::memmove((void*)part.begin(), (void*)part.end(), moved_length);
-    return {full.begin(), full.size() - removed_length};
-}
+struct bucket_edit_t {
+    std::string_view key;
+    value_view_t value;
+};
 
-void remove_from_bucket(value_view_t& bucket, std::string_view key_str) noexcept {
-    // If the entry was present, it must be clamped.
-    // Matching key and length entry will be removed.
-    auto [old_idx, old_key, old_val] = find_in_bucket(bucket, key_str);
-    if (!old_val)
-        return;
+/**
+ * @brief Rebuilds the `bucket` in the layout with fingerprints, applying all of the `edits` in one pass.
+ * Edits must be sorted by keys and unique. Updated entries are moved to the end of the bucket.
+ * The new bucket is allocated in the `arena`, so the old one remains untouched.
+ */
+void rebuild_bucket( //
+    value_view_t& bucket,
+    ptr_range_gt<bucket_edit_t const> edits,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    auto is_edited = [&](std::string_view key) {
+        if (edits.size() == 1)
+            return edits[0].key == key;
+        auto it = std::lower_bound(edits.begin(), edits.end(), key, [](bucket_edit_t const& edit, std::string_view key) {
+            return edit.key < key;
+        });
+        return it != edits.end() && it->key == key;
+    };
+
+    bucket_view_t old = parse_bucket(bucket);
+    std::size_t new_size = 0;
+    std::size_t new_bytes_for_keys = 0;
+    std::size_t new_bytes_for_vals = 0;
+    bool changed = false;
+    auto count = [&](std::string_view member_key, value_view_t member_val) {
+        ++new_size;
+        new_bytes_for_keys += member_key.size();
+        new_bytes_for_vals += member_val.size();
+    };
+    for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
+        if (!is_edited(member.key))
+            count(member.key, member.value);
+        else
+            changed = true;
+    });
+    for (bucket_edit_t const& edit : edits)
+        if (edit.value)
+            count(edit.key, edit.value), changed = true;
 
-    // Most of the time slots contain just one entry
-    auto old_size = get_bucket_size(bucket);
-    if (old_size == 1) {
+    // Removing missing paths doesn't affect the bucket
+    if (!changed)
+        return;
+    if (!new_size) {
         bucket = {};
         return;
     }
 
-    bucket = remove_part(bucket, old_val);
-    bucket = remove_part(bucket, old_key);
+    auto new_bytes_for_fingerprints = fingerprints_bytes(new_size);
+    auto new_bytes_for_counters = new_size * 2u * counter_size_k;
+    auto new_bytes = bytes_in_header_k + new_bytes_for_fingerprints + new_bytes_for_counters + new_bytes_for_keys +
+                     new_bytes_for_vals;
+
+    auto new_begin = arena.alloc<byte_t>(new_bytes, c_error, counter_size_k).begin();
+    return_if_error_m(c_error);
+    *reinterpret_cast<ustore_length_t*>(new_begin) = static_cast<ustore_length_t>(new_size) | fingerprints_flag_k;
+    auto new_fingerprints = reinterpret_cast<fingerprint_t*>(new_begin + bytes_in_header_k);
+    std::memset(new_fingerprints, 0, new_bytes_for_fingerprints);
+    auto new_keys_lengths = reinterpret_cast<ustore_length_t*>(new_begin + bytes_in_header_k + new_bytes_for_fingerprints);
+    auto new_vals_lengths = new_keys_lengths + new_size;
+    auto new_keys_output = reinterpret_cast<byte_t*>(new_vals_lengths + new_size);
+    auto new_vals_output = new_keys_output + new_bytes_for_keys;
 
-    // Remove the value counter
-    auto begin = bucket.data();
-    value_view_t value_length_bytes {begin + counter_size_k * (old_size + old_idx + 1u), counter_size_k};
-    bucket = remove_part(bucket, value_length_bytes);
-    value_view_t key_length_bytes {begin + counter_size_k * (old_idx + 1u), counter_size_k};
-    bucket = remove_part(bucket, key_length_bytes);
+    std::size_t new_idx = 0;
+    auto append = [&](std::string_view member_key, value_view_t member_val, fingerprint_t fingerprint) {
+        new_fingerprints[new_idx] = fingerprint;
+        new_keys_lengths[new_idx] = static_cast<ustore_length_t>(member_key.size());
+        new_vals_lengths[new_idx] = static_cast<ustore_length_t>(member_val.size());
+        std::memcpy(new_keys_output, member_key.data(), member_key.size());
+        std::memcpy(new_vals_output, member_val.data(), member_val.size());
+        new_keys_output += member_key.size();
+        new_vals_output += member_val.size();
+        ++new_idx;
+    };
+    for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
+        if (is_edited(member.key))
+            return;
+        // Buckets from older versions get their fingerprints on first rewrite
+        auto fingerprint = old.fingerprints ? old.fingerprints[member.idx] : path_fingerprint(member.key);
+        append(member.key, member.value, fingerprint);
+    });
+    for (bucket_edit_t const& edit : edits)
+        if (edit.value)
+            append(edit.key, edit.value, path_fingerprint(edit.key));
 
-    // Decrement the size
-    auto lengths = (ustore_length_t*)begin;
-    lengths[0] -= 1u;
+    bucket = {new_begin, new_bytes};
 }
 
-void upsert_in_bucket( //
-    value_view_t& bucket,
-    std::string_view key,
-    value_view_t val,
-    linked_memory_lock_t& arena,
-    ustore_error_t* c_error) noexcept {
+/*********************************************************/
+/*****************	     Hash Versions	  ****************/
+/*********************************************************/
 
-    auto old_size = get_bucket_size(bucket);
-    auto old_bytes_for_counters = old_size * 2u * counter_size_k;
-    auto old_lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    auto old_bytes_for_keys = bucket ? std::accumulate(old_lengths + 1u, old_lengths + 1u + old_size, 0ul) : 0ul;
-    auto old_bytes_for_vals =
-        bucket ? std::accumulate(old_lengths + 1u + old_size, old_lengths + 1u + old_size * 2ul, 0ul) : 0ul;
-    auto [old_idx, old_key, old_val] = find_in_bucket(bucket, key);
-    bool is_missing = !old_val;
+/**
+ * @brief Resolves the hash functions of all the collections addressed in a batch,
+ * reading their metadata at once. Collections without metadata are hashed with `std::hash`,
+ * unless they are still empty and are about to be written into. Those switch to the
+ * stable hash, and their metadata is expected to be added to the same write.
+ */
+class paths_hashes_t {
+    uninitialized_array_gt<ustore_collection_t> collections_;
+    uninitialized_array_gt<hash_t> hashes_;
+    uninitialized_array_gt<ustore_collection_t> initialized_;
+
+  public:
+    paths_hashes_t(linked_memory_lock_t& arena) noexcept : collections_(arena), hashes_(arena), initialized_(arena) {}
+
+    void resolve(ustore_database_t db,
+                 ustore_transaction_t txn,
+                 ustore_snapshot_t snapshot,
+                 ustore_options_t options,
+                 strided_iterator_gt<ustore_collection_t const> collections,
+                 std::size_t tasks_count,
+                 bool initialize,
+                 linked_memory_lock_t& arena,
+                 ustore_error_t* c_error) noexcept {
+
+        if (!tasks_count)
+            return;
+        collections_.resize(collections ? tasks_count : 1, c_error);
+        return_if_error_m(c_error);
+        if (collections)
+            for (std::size_t i = 0; i != tasks_count; ++i)
+                collections_[i] = collections[i];
+        else
+            collections_[0] = ustore_collection_main_k;
+        collections_.resize(sort_and_deduplicate(collections_.begin(), collections_.end()), c_error);
+        hashes_.resize(collections_.size(), c_error);
+        return_if_error_m(c_error);
+
+        ustore_octet_t* found_presences {};
+        ustore_length_t* found_offsets {};
+        ustore_length_t* found_lengths {};
+        ustore_byte_t* found_values {};
+        ustore_read_t read {};
+        read.db = db;
+        read.error = c_error;
+        read.transaction = txn;
+        read.snapshot = snapshot;
+        read.arena = arena;
+        read.options = options;
+        read.tasks_count = collections_.size();
+        read.collections = collections_.begin();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = &paths_metadata_key_k;
+        read.keys_stride = 0;
+        read.presences = &found_presences;
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        ustore_read(&read);
+        return_if_error_m(c_error);
+
+        bits_view_t presences {found_presences};
+        uninitialized_array_gt<ustore_collection_t> unknown(arena);
+        for (std::size_t i = 0; i != collections_.size(); ++i) {
+            // Older collections may contain a genuine bucket under the reserved key
+            paths_metadata_t metadata;
+            bool has_metadata = presences[i] && found_lengths[i] == sizeof(paths_metadata_t);
+            if (has_metadata)
+                std::memcpy(&metadata, found_values + found_offsets[i], sizeof(paths_metadata_t));
+            has_metadata &= metadata.empty_bucket_size == 0;
+            if (has_metadata) {
+                return_error_if_m(metadata.hash == paths_hash_kind_t::std_k ||
+                                      metadata.hash == paths_hash_kind_t::stable_k,
+                                  c_error,
+                                  missing_feature_k,
+                                  "Unsupported paths hash, update the library");
+                hashes_[i] = hash_t {metadata.hash};
+                continue;
+            }
 
-    auto new_size = old_size + is_missing;
-    auto new_bytes_for_counters = new_size * 2u * counter_size_k;
-    auto new_bytes_for_keys = old_bytes_for_keys - old_key.size() + key.size();
-    auto new_bytes_for_vals = old_bytes_for_vals - old_val.size() + val.size();
-    auto new_bytes = bytes_in_header_k + new_bytes_for_counters + new_bytes_for_keys + new_bytes_for_vals;
+            hashes_[i] = hash_t {paths_hash_kind_t::std_k};
+            if (initialize) {
+                unknown.push_back(collections_[i], c_error);
+                return_if_error_m(c_error);
+            }
+        }
+        if (!unknown.size())
+            return;
+
+        // Only the collections, that are still empty, can switch to the stable hash
+        ustore_key_t const start_key = std::numeric_limits<ustore_key_t>::min();
+        ustore_length_t const count_limit = 1;
+        ustore_length_t* found_counts {};
+        ustore_key_t* found_keys {};
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = c_error;
+        scan.transaction = txn;
+        scan.snapshot = snapshot;
+        scan.arena = arena;
+        scan.options = options;
+        scan.tasks_count = unknown.size();
+        scan.collections = unknown.begin();
+        scan.collections_stride = sizeof(ustore_collection_t);
+        scan.start_keys = &start_key;
+        scan.start_keys_stride = 0;
+        scan.count_limits = &count_limit;
+        scan.count_limits_stride = 0;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c_error);
+
+        for (std::size_t i = 0; i != unknown.size(); ++i) {
+            if (found_counts[i])
+                continue;
+            hashes_[offset_in_sorted(collections_, unknown[i])] = hash_t {paths_hash_kind_t::stable_k};
+            initialized_.push_back(unknown[i], c_error);
+            return_if_error_m(c_error);
+        }
+    }
 
-    auto new_begin = arena.alloc<byte_t>(new_bytes, c_error).begin();
-    return_if_error_m(c_error);
-    auto new_lengths = reinterpret_cast<ustore_length_t*>(new_begin);
-    new_lengths[0] = new_size;
-    auto new_keys_lengths = new_lengths + 1ul;
-    auto new_vals_lengths = new_lengths + 1ul + new_size;
-    auto new_keys_output = new_begin + bytes_in_header_k + new_bytes_for_counters;
-    auto new_vals_output = new_begin + bytes_in_header_k + new_bytes_for_counters + new_bytes_for_keys;
-
-    auto old_keys = get_bucket_keys(bucket, old_size);
-    auto old_vals = get_bucket_vals(bucket, old_size);
-    std::size_t new_idx = 0;
-    for (std::size_t i = 0; i != old_size; ++i, ++old_keys, ++old_vals) {
-        if (!is_missing && i == old_idx)
-            continue;
+    hash_t operator[](ustore_collection_t collection) const noexcept {
+        return hashes_.begin()[offset_in_sorted(collections_, collection)];
+    }
 
-        value_view_t old_key = *old_keys;
-        value_view_t old_val = *old_vals;
-        new_keys_lengths[new_idx] = static_cast<ustore_length_t>(old_key.size());
-        new_vals_lengths[new_idx] = static_cast<ustore_length_t>(old_val.size());
-        std::memcpy(new_keys_output, old_key.data(), old_key.size());
-        std::memcpy(new_vals_output, old_val.data(), old_val.size());
+    /** @brief Collections, that must receive their metadata with the upcoming write. */
+    ptr_range_gt<ustore_collection_t const> initialized() const noexcept {
+        return {initialized_.begin(), initialized_.end()};
+    }
+};
 
-        new_keys_output += old_key.size();
-        new_vals_output += old_val.size();
-        ++new_idx;
+/*********************************************************/
+/*****************	    Prefix Indexes	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Prefix indexes are stored in hidden collections, named like the indexed ones, followed by this suffix.
+ * @see `ustore_paths_index_create_t`.
+ */
+constexpr std::string_view prefix_index_suffix_k = ".paths.prefix";
+
+/**
+ * @brief Number of buckets read at once, when building an index.
+ */
+constexpr std::size_t prefix_index_batch_size_k = 1024;
+
+/**
+ * @brief Maps paths to keys by their first 8 bytes, preserving the lexicographic order, but not the uniqueness.
+ * Missing bytes are replaced with `padding`, so that the first and last keys of a prefix range can be found.
+ */
+ustore_key_t prefix_index_key(std::string_view path, std::uint8_t padding = 0) noexcept {
+    constexpr std::uint64_t sign_k = std::uint64_t(1) << 63;
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i != sizeof(bits); ++i)
+        bits = (bits << 8) | (i < path.size() ? std::uint8_t(path[i]) : padding);
+    return static_cast<ustore_key_t>(bits ^ sign_k);
+}
+
+/**
+ * @brief Passes every path of a serialized index entry to `callback`.
+ * Paths are serialized as their length followed by their bytes, sorted lexicographically.
+ * @return false If the entry is corrupted.
+ */
+template <typename callback_at>
+bool for_each_prefix_entry(value_view_t bytes, callback_at&& callback) noexcept {
+    auto it = reinterpret_cast<char const*>(bytes.data());
+    auto end = it + bytes.size();
+    while (it != end) {
+        if (static_cast<std::size_t>(end - it) < counter_size_k)
+            return false;
+        ustore_length_t length;
+        std::memcpy(&length, it, counter_size_k);
+        if (static_cast<std::size_t>(end - it) < counter_size_k + length)
+            return false;
+        callback(std::string_view {it + counter_size_k, length});
+        it += counter_size_k + length;
     }
+    return true;
+}
 
-    // Append the new entry at the end
-    new_keys_lengths[new_idx] = static_cast<ustore_length_t>(key.size());
-    new_vals_lengths[new_idx] = static_cast<ustore_length_t>(val.size());
-    std::memcpy(new_keys_output, key.data(), key.size());
-    std::memcpy(new_vals_output, val.data(), val.size());
+struct prefix_index_t {
+    /** @brief The collection of indexed paths. */
+    ustore_collection_t collection = ustore_collection_main_k;
+    /** @brief The hidden collection with sorted paths. */
+    ustore_collection_t index = ustore_collection_main_k;
+};
 
-    bucket = {new_begin, new_bytes};
+/**
+ * @brief Lists the collections once, resolving the prefix indexes from their names.
+ */
+class prefix_indexes_t {
+    linked_memory_lock_t& arena_;
+    ustore_size_t count_ = 0;
+    ustore_collection_t* ids_ = nullptr;
+    ustore_length_t* offsets_ = nullptr;
+    ustore_char_t* names_ = nullptr;
+    uninitialized_array_gt<prefix_index_t> indexes_;
+
+  public:
+    prefix_indexes_t(linked_memory_lock_t& arena) noexcept : arena_(arena), indexes_(arena) {}
+
+    void list(ustore_database_t db, ustore_error_t* c_error) noexcept {
+        if (!ustore_supports_named_collections_k)
+            return;
+
+        ustore_collection_list_t list {};
+        list.db = db;
+        list.error = c_error;
+        list.arena = arena_;
+        list.options = ustore_option_dont_discard_memory_k;
+        list.count = &count_;
+        list.ids = &ids_;
+        list.offsets = &offsets_;
+        list.names = &names_;
+        ustore_collection_list(&list);
+        return_if_error_m(c_error);
+
+        for (std::size_t i = 0; i != count_; ++i) {
+            std::string_view name = names_ + offsets_[i];
+            prefix_index_t index;
+            if (name.size() < prefix_index_suffix_k.size() ||
+                name.substr(name.size() - prefix_index_suffix_k.size()) != prefix_index_suffix_k ||
+                !find(name.substr(0, name.size() - prefix_index_suffix_k.size()), index.collection))
+                continue;
+            index.index = ids_[i];
+            indexes_.push_back(index, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+    bool empty() const noexcept { return !indexes_.size(); }
+
+    /**
+     * @return true If the `collection` is indexed, exporting the `id` of the index.
+     */
+    bool find_index(ustore_collection_t collection, ustore_collection_t& id) const noexcept {
+        for (prefix_index_t const& index : indexes_)
+            if (index.collection == collection) {
+                id = index.index;
+                return true;
+            }
+        return false;
+    }
+
+    /**
+     * @return true If the collection with such `name` exists. The main collection is named with an empty string.
+     */
+    bool find(std::string_view name, ustore_collection_t& id) const noexcept {
+        if (name.empty()) {
+            id = ustore_collection_main_k;
+            return true;
+        }
+        for (std::size_t i = 0; i != count_; ++i)
+            if (name == std::string_view(names_ + offsets_[i])) {
+                id = ids_[i];
+                return true;
+            }
+        return false;
+    }
+
+    /**
+     * @brief Builds the NULL-terminated name of the prefix index of `collection`.
+     */
+    std::string_view index_name(ustore_collection_t collection, ustore_error_t* c_error) noexcept {
+        std::string_view name;
+        if (collection != ustore_collection_main_k) {
+            auto it = std::find(ids_, ids_ + count_, collection);
+            log_error_if_m(it != ids_ + count_, c_error, args_wrong_k, "Collection not found");
+            if (*c_error)
+                return {};
+            name = names_ + offsets_[it - ids_];
+        }
+        auto joined = arena_.alloc<char>(name.size() + prefix_index_suffix_k.size() + 1u, c_error);
+        if (*c_error)
+            return {};
+        char* output = std::copy(name.begin(), name.end(), joined.begin());
+        output = std::copy(prefix_index_suffix_k.begin(), prefix_index_suffix_k.end(), output);
+        *output = '\0';
+        return {joined.begin(), joined.size() - 1u};
+    }
+};
+
+/**
+ * @brief Path added to or removed from a prefix index.
+ */
+struct prefix_edit_t {
+    ustore_collection_t index = ustore_collection_main_k;
+    ustore_key_t index_key = 0;
+    std::string_view path;
+    bool insert = false;
+
+    bool same_entry(prefix_edit_t const& other) const noexcept {
+        return index == other.index && index_key == other.index_key;
+    }
+    bool operator<(prefix_edit_t const& other) const noexcept {
+        if (index != other.index)
+            return index < other.index;
+        if (index_key != other.index_key)
+            return index_key < other.index_key;
+        return path < other.path;
+    }
+};
+
+/**
+ * @brief Reads the index entries touched by `edits`, applies the edits, keeping the last one for every path,
+ * and appends the new contents of those entries to `places` and `entries` of the upcoming write.
+ */
+void apply_prefix_edits(ustore_database_t const c_db,
+                        ustore_transaction_t const c_txn,
+                        ustore_options_t const c_options,
+                        ptr_range_gt<prefix_edit_t> edits,
+                        uninitialized_array_gt<collection_key_t>& places,
+                        uninitialized_array_gt<value_view_t>& entries,
+                        linked_memory_lock_t& arena,
+                        ustore_error_t* c_error) noexcept {
+
+    if (edits.empty())
+        return;
+
+    // Stable sorting keeps the order of edits of the same path, so that only the last one is kept
+    std::stable_sort(edits.begin(), edits.end());
+    std::size_t unique_count = 0;
+    for (std::size_t i = 0; i != edits.size(); ++i)
+        if (i + 1 == edits.size() || !edits[i].same_entry(edits[i + 1]) || edits[i].path != edits[i + 1].path)
+            edits[unique_count++] = edits[i];
+    edits = {edits.begin(), unique_count};
+
+    std::size_t first_place = places.size();
+    for (std::size_t i = 0; i != edits.size(); ++i) {
+        if (i && edits[i - 1].same_entry(edits[i]))
+            continue;
+        places.push_back(collection_key_t {edits[i].index, edits[i].index_key}, c_error);
+        return_if_error_m(c_error);
+    }
+    std::size_t entries_count = places.size() - first_place;
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_txn;
+    read.arena = arena;
+    read.options = c_options;
+    read.tasks_count = entries_count;
+    read.collections = &places[first_place].collection;
+    read.collections_stride = sizeof(collection_key_t);
+    read.keys = &places[first_place].key;
+    read.keys_stride = sizeof(collection_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    // Merge the sorted old paths with the sorted edits
+    uninitialized_array_gt<std::string_view> old_paths(arena);
+    uninitialized_array_gt<std::string_view> new_paths(arena);
+    prefix_edit_t const* edits_it = edits.begin();
+    for (std::size_t i = 0; i != entries_count; ++i) {
+        old_paths.resize(0, c_error);
+        new_paths.resize(0, c_error);
+        return_if_error_m(c_error);
+        bool valid = true;
+        if (found_lengths[i] != ustore_length_missing_k)
+            valid = for_each_prefix_entry(value_view_t {found_values + found_offsets[i], found_lengths[i]},
+                                          [&](std::string_view path) { old_paths.push_back(path, c_error); });
+        return_error_if_m(valid, c_error, consistency_k, "Corrupted prefix index entry");
+        return_if_error_m(c_error);
+
+        std::size_t old_idx = 0;
+        prefix_edit_t const* edits_end = edits_it;
+        for (; edits_end != edits.end() && edits_it->same_entry(*edits_end); ++edits_end) {
+            for (; old_idx != old_paths.size() && old_paths[old_idx] < edits_end->path; ++old_idx)
+                new_paths.push_back(old_paths[old_idx], c_error);
+            if (old_idx != old_paths.size() && old_paths[old_idx] == edits_end->path)
+                ++old_idx;
+            if (edits_end->insert)
+                new_paths.push_back(edits_end->path, c_error);
+        }
+        for (; old_idx != old_paths.size(); ++old_idx)
+            new_paths.push_back(old_paths[old_idx], c_error);
+        return_if_error_m(c_error);
+        edits_it = edits_end;
+
+        std::size_t size = 0;
+        for (std::string_view path : new_paths)
+            size += counter_size_k + path.size();
+        value_view_t entry;
+        if (size) {
+            auto dumped = arena.alloc<byte_t>(size, c_error);
+            return_if_error_m(c_error);
+            byte_t* output = dumped.begin();
+            for (std::string_view path : new_paths) {
+                auto length = static_cast<ustore_length_t>(path.size());
+                std::memcpy(output, &length, counter_size_k);
+                std::memcpy(output + counter_size_k, path.data(), path.size());
+                output += counter_size_k + path.size();
+            }
+            entry = {dumped.begin(), size};
+        }
+        entries.push_back(entry, c_error);
+        return_if_error_m(c_error);
+    }
 }
 
+/**
+ * @brief Position of a path in a write batch, used to group the edits of every bucket.
+ */
+struct bucket_task_t {
+    std::size_t bucket_idx;
+    std::string_view path;
+    std::size_t task_idx;
+
+    bool operator<(bucket_task_t const& other) const noexcept {
+        return std::tie(bucket_idx, path, task_idx) < std::tie(other.bucket_idx, other.path, other.task_idx);
+    }
+};
+
 void ustore_paths_write(ustore_paths_write_t* c_ptr) {
 
     ustore_paths_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::paths_write_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -256,16 +836,24 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     keys_str_args.contents_begin = {(ustore_bytes_cptr_t const*)c.paths, c.paths_stride};
     keys_str_args.count = c.tasks_count;
 
+    auto tasks_col_keys = arena.alloc<collection_key_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
     auto unique_col_keys = arena.alloc<collection_key_t>(c.tasks_count, c.error);
     return_if_error_m(c.error);
 
     // Parse and hash input string unique_col_keys
-    hash_t hash;
+    auto opts = c.transaction ? ustore_options_t(c.options & ~ustore_option_transaction_dont_watch_k) : c.options;
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    for (std::size_t i = 0; i != c.tasks_count; ++i)
-        unique_col_keys[i] = {collections ? collections[i] : ustore_collection_main_k, hash(keys_str_args[i])};
+    paths_hashes_t hashes(arena);
+    hashes.resolve(c.db, c.transaction, {}, opts, collections, c.tasks_count, true, arena, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto collection = collections ? collections[i] : ustore_collection_main_k;
+        tasks_col_keys[i] = {collection, hashes[collection](keys_str_args[i])};
+    }
 
     // We must sort and deduplicate this bucket IDs
+    std::copy(tasks_col_keys.begin(), tasks_col_keys.end(), unique_col_keys.begin());
     unique_col_keys = {unique_col_keys.begin(), sort_and_deduplicate(unique_col_keys.begin(), unique_col_keys.end())};
 
     // Read from disk
@@ -281,7 +869,6 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     unique_places.keys_begin = unique_col_keys_strided.members(&collection_key_t::key).begin();
     unique_places.fields_begin = {};
     unique_places.count = static_cast<ustore_size_t>(unique_col_keys.size());
-    auto opts = c.transaction ? ustore_options_t(c.options & ~ustore_option_transaction_dont_watch_k) : c.options;
     ustore_read_t read {};
     read.db = c.db;
     read.error = c.error;
@@ -310,22 +897,88 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values_bytes, c.values_bytes_stride};
     contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
 
+    // Paths added to or removed from indexed collections are mirrored in their prefix indexes
+    prefix_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    uninitialized_array_gt<prefix_edit_t> edits(arena);
+
+    // Group the edits by buckets, so that every bucket is rebuilt once
+    auto tasks = arena.alloc<bucket_task_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto bucket_edits = arena.alloc<bucket_edit_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i)
+        tasks[i] = {offset_in_sorted(unique_col_keys, tasks_col_keys[i]), keys_str_args[i], i};
+    std::sort(tasks.begin(), tasks.end());
+
     // Update every unique bucket
-    for (std::size_t i = 0; i != c.tasks_count; ++i) {
-        std::string_view key_str = keys_str_args[i];
-        ustore_key_t key = hash(key_str);
-        value_view_t new_val = contents[i];
-        collection_key_t collection_key {collections ? collections[i] : ustore_collection_main_k, key};
-        auto bucket_idx = offset_in_sorted(unique_col_keys, collection_key);
+    for (std::size_t group_begin = 0; group_begin != c.tasks_count;) {
+        auto bucket_idx = tasks[group_begin].bucket_idx;
+        auto group_end = group_begin;
+        std::size_t edits_count = 0;
+        for (; group_end != c.tasks_count && tasks[group_end].bucket_idx == bucket_idx; ++group_end) {
+            // Only the last write of every path in the batch matters
+            bucket_task_t const& task = tasks[group_end];
+            bool is_overwritten = group_end + 1 != c.tasks_count && tasks[group_end + 1].bucket_idx == bucket_idx &&
+                                  tasks[group_end + 1].path == task.path;
+            if (!is_overwritten)
+                bucket_edits[edits_count++] = bucket_edit_t {task.path, contents[task.task_idx]};
+        }
+        ptr_range_gt<bucket_edit_t const> group_edits {bucket_edits.begin(), bucket_edits.begin() + edits_count};
         value_view_t& bucket = updated_buckets[bucket_idx];
 
-        if (new_val) {
-            upsert_in_bucket(bucket, key_str, new_val, arena, c.error);
+        ustore_collection_t index_id = ustore_collection_main_k;
+        if (!indexes.empty() && indexes.find_index(unique_col_keys[bucket_idx].collection, index_id))
+            for (bucket_edit_t const& edit : group_edits) {
+                if (bool(find_in_bucket(bucket, edit.key)) == bool(edit.value))
+                    continue;
+                auto edit_key = prefix_index_key(edit.key);
+                edits.push_back(prefix_edit_t {index_id, edit_key, edit.key, bool(edit.value)}, c.error);
+                return_if_error_m(c.error);
+            }
+
+        rebuild_bucket(bucket, group_edits, arena, c.error);
+        return_if_error_m(c.error);
+        group_begin = group_end;
+    }
+
+    // The index entries and the metadata of new collections are appended to the same batch,
+    // to be updated atomically with the buckets
+    auto initialized = hashes.initialized();
+    bool extended = edits.size() || initialized.size();
+    uninitialized_array_gt<collection_key_t> written_places(arena);
+    uninitialized_array_gt<value_view_t> written_values(arena);
+    if (extended) {
+        auto written_count = unique_col_keys.size() + initialized.size() + edits.size();
+        written_places.reserve(written_count, c.error);
+        written_values.reserve(written_count, c.error);
+        return_if_error_m(c.error);
+        written_places.insert(0, unique_col_keys.begin(), unique_col_keys.end(), c.error);
+        return_if_error_m(c.error);
+        written_values.insert(0, updated_buckets.begin(), updated_buckets.end(), c.error);
+        return_if_error_m(c.error);
+        value_view_t metadata {reinterpret_cast<byte_t const*>(&paths_metadata_k), sizeof(paths_metadata_t)};
+        for (ustore_collection_t collection : initialized) {
+            written_places.push_back(collection_key_t {collection, paths_metadata_key_k}, c.error);
+            return_if_error_m(c.error);
+            written_values.push_back(metadata, c.error);
             return_if_error_m(c.error);
         }
-        else
-            remove_from_bucket(bucket, key_str);
     }
+    if (edits.size()) {
+        apply_prefix_edits(c.db,
+                           c.transaction,
+                           opts,
+                           {edits.begin(), edits.end()},
+                           written_places,
+                           written_values,
+                           arena,
+                           c.error);
+        return_if_error_m(c.error);
+    }
+    collection_key_t const* places = extended ? written_places.begin() : unique_col_keys.begin();
+    value_view_t const* values = extended ? written_values.begin() : updated_buckets.begin();
 
     ustore_write_t write {};
     write.db = c.db;
@@ -333,14 +986,14 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     write.transaction = c.transaction;
     write.arena = arena;
     write.options = opts;
-    write.tasks_count = unique_places.count;
-    write.collections = unique_places.collections_begin.get();
-    write.collections_stride = unique_places.collections_begin.stride();
-    write.keys = unique_places.keys_begin.get();
-    write.keys_stride = unique_places.keys_begin.stride();
-    write.lengths = updated_buckets[0].member_length();
+    write.tasks_count = extended ? written_places.size() : unique_places.count;
+    write.collections = &places->collection;
+    write.collections_stride = sizeof(collection_key_t);
+    write.keys = &places->key;
+    write.keys_stride = sizeof(collection_key_t);
+    write.lengths = values->member_length();
     write.lengths_stride = sizeof(value_view_t);
-    write.values = updated_buckets[0].member_ptr();
+    write.values = values->member_ptr();
     write.values_stride = sizeof(value_view_t);
 
     // Once all is updated, we can safely write back
@@ -350,6 +1003,7 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
 void ustore_paths_read(ustore_paths_read_t* c_ptr) {
 
     ustore_paths_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::paths_read_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -367,9 +1021,12 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     return_if_error_m(c.error);
 
     // Parse and hash input string buckets_keys
-    hash_t hash;
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    paths_hashes_t hashes(arena);
+    hashes.resolve(c.db, c.transaction, c.snapshot, c.options, collections, c.tasks_count, false, arena, c.error);
+    return_if_error_m(c.error);
     for (std::size_t i = 0; i != c.tasks_count; ++i)
-        buckets_keys[i] = hash(keys_str_args[i]);
+        buckets_keys[i] = hashes[collections ? collections[i] : ustore_collection_main_k](keys_str_args[i]);
 
     // Read from disk
     // We don't need:
@@ -382,6 +1039,7 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     read.db = c.db;
     read.error = c.error;
     read.transaction = c.transaction;
+    read.snapshot = c.snapshot;
     read.arena = arena;
     read.options = c.options;
     read.tasks_count = c.tasks_count;
@@ -398,8 +1056,7 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     // Some of the entries will contain more then one key-value pair in case of collisions.
     ustore_length_t exported_volume = 0;
     joined_blobs_t buckets {c.tasks_count, buckets_offsets, buckets_values};
-    auto presences =
-        arena.alloc_or_dummy(divide_round_up<std::size_t>(c.tasks_count, bits_in_byte_k), c.error, c.presences);
+    auto presences = arena.alloc_or_dummy(c.tasks_count, c.error, c.presences);
     auto lengths = arena.alloc_or_dummy(c.tasks_count, c.error, c.lengths);
     auto offsets = arena.alloc_or_dummy(c.tasks_count, c.error, c.offsets);
 
@@ -431,15 +1088,16 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
 }
 
 /**
- * - Same collection
- * - One scan request
- * - May have previous results
+ * @brief Exports the paths from buckets with keys in the `[start_key, end_key]` range, that satisfy the `predicate`.
+ * If `previous_path` is passed, the matches are skipped, until it's reached.
  */
 template <typename predicate_at>
-void full_scan_collection_w_predicate( //
+void scan_buckets_w_predicate( //
     ustore_database_t c_db,
     ustore_transaction_t c_transaction,
     ustore_collection_t c_collection,
+    ustore_key_t start_key,
+    ustore_key_t end_key,
     std::string_view previous_path,
     ustore_length_t c_count_limit,
     ustore_options_t c_options,
@@ -447,14 +1105,14 @@ void full_scan_collection_w_predicate( //
     growing_tape_t& paths,
     linked_memory_lock_t& arena,
     ustore_error_t* c_error,
-    predicate_at predicate) {
+    predicate_at&& predicate) {
 
-    hash_t hash;
     bool has_reached_previous = previous_path.empty();
-    ustore_key_t start_key = !previous_path.empty() ? hash(previous_path) : std::numeric_limits<ustore_key_t>::min();
 
     paths_count = 0;
-    auto scan_in_bucket = [&](ustore_key_t, value_view_t bucket) noexcept {
+    auto scan_in_bucket = [&](ustore_key_t key, value_view_t bucket) noexcept {
+        if (key > end_key)
+            return false;
         for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
             if (!predicate(member.key))
                 // Skip irrelevant entries
@@ -479,7 +1137,7 @@ void full_scan_collection_w_predicate( //
             ++paths_count;
         });
 
-        return paths_count < c_count_limit;
+        return paths_count < c_count_limit && key < end_key && !*c_error;
     };
 
     full_scan_collection(c_db,
@@ -493,14 +1151,149 @@ void full_scan_collection_w_predicate( //
                          scan_in_bucket);
 }
 
+/**
+ * @brief Matches from a single range of hashes, scanned in a separate thread with its own memory.
+ */
+struct scan_slice_t {
+    ustore_arena_t memory = nullptr;
+    ustore_error_t error = nullptr;
+    ustore_length_t count = 0;
+    ustore_length_t const* offsets = nullptr;
+    ustore_length_t const* lengths = nullptr;
+    byte_t const* contents = nullptr;
+};
+
+/**
+ * @brief Calls `scan_slice(slice_idx)` for every slice, in up to `slices_count` threads, including the calling one.
+ * If threads can't be spawned, the remaining slices are processed in the calling thread.
+ */
+template <typename scan_slice_at>
+void for_each_scan_slice(std::size_t slices_count, scan_slice_at&& scan_slice) noexcept {
+    if (slices_count == 1)
+        return scan_slice(std::size_t(0));
+
+    std::vector<std::thread> threads;
+    std::size_t spawned = 1;
+    try {
+        threads.reserve(slices_count - 1);
+        for (; spawned != slices_count; ++spawned)
+            threads.emplace_back(scan_slice, spawned);
+    }
+    catch (...) {
+    }
+    for (std::size_t slice_idx = spawned; slice_idx != slices_count; ++slice_idx)
+        scan_slice(slice_idx);
+    scan_slice(std::size_t(0));
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * - Same collection
+ * - One scan request
+ * - May have previous results
+ * - Outside of transactions, the range of hashes can be split between `threads_count` threads.
+ *   Every thread collects up to `c_count_limit` matches, which are then joined in the order of hashes.
+ */
+template <typename predicate_at>
+void full_scan_collection_w_predicate( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_collection_t c_collection,
+    hash_t hash,
+    std::string_view previous_path,
+    ustore_length_t c_count_limit,
+    ustore_options_t c_options,
+    std::size_t threads_count,
+    ustore_length_t& paths_count,
+    growing_tape_t& paths,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error,
+    predicate_at&& predicate) {
+
+    ustore_key_t start_key = !previous_path.empty() ? hash(previous_path) : std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t end_key = std::numeric_limits<ustore_key_t>::max();
+
+    // Transactions can't be shared between threads
+    std::size_t slices_count = c_transaction ? 1u : std::max<std::size_t>(threads_count, 1u);
+    if (slices_count == 1)
+        return scan_buckets_w_predicate(c_db,
+                                        c_transaction,
+                                        c_collection,
+                                        start_key,
+                                        end_key,
+                                        previous_path,
+                                        c_count_limit,
+                                        c_options,
+                                        paths_count,
+                                        paths,
+                                        arena,
+                                        c_error,
+                                        [&](std::string_view path) { return predicate(std::size_t(0), path); });
+
+    auto slices = arena.alloc<scan_slice_t>(slices_count, c_error);
+    return_if_error_m(c_error);
+    std::fill(slices.begin(), slices.end(), scan_slice_t {});
+
+    // Hashes are uniformly distributed, so equal ranges of keys hold similar numbers of buckets
+    auto span = static_cast<std::uint64_t>(end_key) - static_cast<std::uint64_t>(start_key);
+    auto slice_start = [&](std::size_t slice_idx) noexcept {
+        return static_cast<ustore_key_t>(static_cast<std::uint64_t>(start_key) + span / slices_count * slice_idx);
+    };
+    auto slice_options = ustore_options_t(c_options & ~ustore_option_dont_discard_memory_k);
+    for_each_scan_slice(slices_count, [&](std::size_t slice_idx) noexcept {
+        scan_slice_t& slice = slices[slice_idx];
+        linked_memory_lock_t slice_arena = linked_memory(&slice.memory, slice_options, &slice.error);
+        if (slice.error)
+            return;
+
+        // Only the first slice contains the previous result
+        growing_tape_t slice_paths(slice_arena);
+        ustore_key_t slice_end = slice_idx + 1 == slices_count ? end_key : slice_start(slice_idx + 1) - 1;
+        scan_buckets_w_predicate(c_db,
+                                 nullptr,
+                                 c_collection,
+                                 slice_start(slice_idx),
+                                 slice_end,
+                                 slice_idx ? std::string_view {} : previous_path,
+                                 c_count_limit,
+                                 slice_options,
+                                 slice.count,
+                                 slice_paths,
+                                 slice_arena,
+                                 &slice.error,
+                                 [&](std::string_view path) { return predicate(slice_idx, path); });
+        slice.offsets = slice_paths.offsets().begin().get();
+        slice.lengths = slice_paths.lengths().begin().get();
+        slice.contents = slice_paths.contents().begin().get();
+    });
+
+    paths_count = 0;
+    for (std::size_t slice_idx = 0; slice_idx != slices_count && !*c_error; ++slice_idx) {
+        scan_slice_t const& slice = slices[slice_idx];
+        if (slice.error)
+            *c_error = slice.error;
+        for (std::size_t i = 0; i != slice.count && paths_count < c_count_limit && !*c_error; ++i) {
+            paths.push_back(value_view_t {slice.contents + slice.offsets[i], slice.lengths[i]}, c_error);
+            if (!*c_error)
+                paths.add_terminator(byte_t {0}, c_error);
+            paths_count += !*c_error;
+        }
+    }
+    for (scan_slice_t& slice : slices)
+        ustore_arena_free(slice.memory);
+}
+
 void full_scan_w_prefix( //
     ustore_database_t const c_db,
     ustore_transaction_t const c_transaction,
     ustore_collection_t c_collection,
+    hash_t hash,
     std::string_view prefix,
     std::string_view previous_path,
     ustore_length_t c_count_limit,
     ustore_options_t const c_options,
+    std::size_t threads_count,
     ustore_length_t& count,
     growing_tape_t& paths,
     linked_memory_lock_t& arena,
@@ -510,103 +1303,299 @@ void full_scan_w_prefix( //
         c_db,
         c_transaction,
         c_collection,
+        hash,
         previous_path,
         c_count_limit,
         c_options,
+        threads_count,
         count,
         paths,
         arena,
         c_error,
-        [=](std::string_view body) { return starts_with(body, prefix); });
+        [=](std::size_t, std::string_view body) { return starts_with(body, prefix); });
 }
 
-struct pcre2_ctx_t {
-    linked_memory_lock_t& arena;
-    ustore_error_t* c_error;
-};
+/**
+ * @brief Exports the paths with a given `prefix`, that satisfy the `predicate`, in lexicographic order,
+ * scanning only the range of the prefix index, that can contain them.
+ */
+template <typename predicate_at>
+void index_scan_w_predicate( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_collection_t c_index,
+    std::string_view prefix,
+    std::string_view previous_path,
+    ustore_length_t c_count_limit,
+    ustore_options_t const c_options,
+    ustore_length_t& count,
+    growing_tape_t& paths,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error,
+    predicate_at&& predicate) {
+
+    count = 0;
+    if (!c_count_limit)
+        return;
+
+    ustore_key_t start_key = prefix_index_key(prefix, 0x00);
+    ustore_key_t end_key = prefix_index_key(prefix, 0xFF);
+    if (!previous_path.empty())
+        start_key = std::max(start_key, prefix_index_key(previous_path));
+    if (start_key > end_key)
+        return;
+
+    auto scan_in_entry = [&](ustore_key_t key, value_view_t entry) noexcept {
+        if (key > end_key)
+            return false;
+        bool valid = for_each_prefix_entry(entry, [&](std::string_view path) {
+            if (count >= c_count_limit || *c_error)
+                return;
+            if (!starts_with(path, prefix) || (!previous_path.empty() && path <= previous_path))
+                return;
+            if (!predicate(path))
+                return;
+            paths.push_back(path, c_error);
+            return_if_error_m(c_error);
+            paths.add_terminator(byte_t {0}, c_error);
+            return_if_error_m(c_error);
+            ++count;
+        });
+        log_error_if_m(valid, c_error, consistency_k, "Corrupted prefix index entry");
+        return count < c_count_limit && key < end_key && !*c_error;
+    };
 
-static void* pcre2_malloc(PCRE2_SIZE length, void* ctx_ptr) noexcept {
-    pcre2_ctx_t& ctx = *reinterpret_cast<pcre2_ctx_t*>(ctx_ptr);
-    return ctx.arena.alloc<byte_t>(static_cast<std::size_t>(length), ctx.c_error).begin();
+    full_scan_collection(c_db,
+                         c_transaction,
+                         c_index,
+                         c_options,
+                         start_key,
+                         std::min<ustore_length_t>(c_count_limit, prefix_index_batch_size_k),
+                         arena,
+                         c_error,
+                         scan_in_entry);
+}
+
+void index_scan_w_prefix( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_collection_t c_index,
+    std::string_view prefix,
+    std::string_view previous_path,
+    ustore_length_t c_count_limit,
+    ustore_options_t const c_options,
+    ustore_length_t& count,
+    growing_tape_t& paths,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    index_scan_w_predicate( //
+        c_db,
+        c_transaction,
+        c_index,
+        prefix,
+        previous_path,
+        c_count_limit,
+        c_options,
+        count,
+        paths,
+        arena,
+        c_error,
+        [](std::string_view) { return true; });
+}
+
+/**
+ * @brief Extracts the literal prefix, that every match of a RegEx anchored with `^` must start with.
+ * Stops at the first special or non-ASCII character, dropping the literals that can be skipped.
+ * @return Empty string, if the pattern isn't anchored or has alternatives.
+ */
+std::string_view regex_literal_prefix(std::string_view pattern,
+                                      linked_memory_lock_t& arena,
+                                      ustore_error_t* c_error) noexcept {
+    if (pattern.size() < 2 || pattern.front() != '^' || pattern.find('|') != std::string_view::npos)
+        return {};
+
+    auto prefix = arena.alloc<char>(pattern.size(), c_error);
+    if (*c_error)
+        return {};
+
+    std::size_t length = 0;
+    for (std::size_t i = 1; i != pattern.size();) {
+        char literal = pattern[i];
+        std::size_t next = i + 1;
+        if (literal == '\\') {
+            // Only escaped punctuation marks are literals, others are character classes
+            if (next == pattern.size() || std::isalnum(static_cast<unsigned char>(pattern[next])))
+                break;
+            literal = pattern[next++];
+        }
+        else if (!is_prefix({&pattern[i], 1}))
+            break;
+        if (static_cast<unsigned char>(literal) >= 0x80)
+            break;
+        if (next != pattern.size() && (pattern[next] == '?' || pattern[next] == '*' || pattern[next] == '{'))
+            break;
+        prefix[length++] = literal;
+        i = next;
+    }
+    return {prefix.begin(), length};
 }
 
-static void pcre2_free(void*, void*) noexcept {
-    // Our arenas only grow, we don't dealloc!
+/**
+ * @brief Compiled patterns are shared between calls and threads, as compiling and JIT-ing
+ * a pattern often costs more than matching it against thousands of paths.
+ * Once the cache grows beyond this many patterns, it is flushed.
+ */
+constexpr std::size_t regex_cache_capacity_k = 256;
+
+struct compiled_regex_t {
+    pcre2_code* code = nullptr;
+    bool jit = false;
+
+    compiled_regex_t(pcre2_code* code, bool jit) noexcept : code(code), jit(jit) {}
+    compiled_regex_t(compiled_regex_t const&) = delete;
+    compiled_regex_t& operator=(compiled_regex_t const&) = delete;
+    ~compiled_regex_t() noexcept { pcre2_code_free(code); }
+};
+
+using compiled_regex_ptr_t = std::shared_ptr<compiled_regex_t const>;
+
+class regex_cache_t {
+    std::mutex mutex_;
+    std::unordered_map<std::string, compiled_regex_ptr_t> patterns_;
+
+  public:
+    compiled_regex_ptr_t compile(std::string_view pattern, ustore_error_t* c_error) noexcept {
+        compiled_regex_ptr_t result;
+        safe_section("Compiling RegEx", c_error, [&] {
+            std::string key {pattern};
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = patterns_.find(key);
+                if (it != patterns_.end()) {
+                    result = it->second;
+                    return;
+                }
+            }
+
+            // https://www.pcre.org/current/doc/html/pcre2_compile.html
+            int pcre2_pattern_error_code = 0;
+            PCRE2_SIZE pcre2_pattern_error_offset = 0;
+            pcre2_code* pcre2_code = pcre2_compile( //
+                PCRE2_SPTR8(pattern.data()),
+                PCRE2_SIZE(pattern.size()),
+                PCRE2_MATCH_INVALID_UTF,
+                &pcre2_pattern_error_code,
+                &pcre2_pattern_error_offset,
+                nullptr);
+            return_error_if_m(pcre2_code, c_error, args_wrong_k, "Failed to compile the RegEx query");
+
+            // https://www.pcre.org/current/doc/html/pcre2_jit_compile.html
+            // Where JIT isn't supported, the patterns are interpreted
+            bool jit = pcre2_jit_compile(pcre2_code, PCRE2_JIT_COMPLETE) == 0;
+            result = std::make_shared<compiled_regex_t const>(pcre2_code, jit);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (patterns_.size() >= regex_cache_capacity_k)
+                patterns_.clear();
+            patterns_.emplace(std::move(key), result);
+        });
+        return result;
+    }
+};
+
+static regex_cache_t& regex_cache() noexcept {
+    static regex_cache_t cache;
+    return cache;
 }
 
-void full_scan_w_regex( //
+void scan_w_regex( //
     ustore_database_t const c_db,
     ustore_transaction_t const c_transaction,
     ustore_collection_t c_collection,
+    hash_t hash,
+    ustore_collection_t const* c_index,
     std::string_view pattern,
     std::string_view previous_path,
     ustore_length_t c_count_limit,
     ustore_options_t const c_options,
+    std::size_t threads_count,
     ustore_length_t& count,
     growing_tape_t& paths,
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) {
 
-    pcre2_ctx_t ctx {arena, c_error};
-
-    // https://www.pcre.org/current/doc/html/pcre2_compile.html
-    pcre2_general_context* pcre2_context = pcre2_general_context_create(&pcre2_malloc, &pcre2_free, &ctx);
-    pcre2_compile_context* pcre2_compile_context = pcre2_compile_context_create(pcre2_context);
-    int pcre2_pattern_error_code = 0;
-    PCRE2_SIZE pcre2_pattern_error_offset = 0;
-    pcre2_code* pcre2_code = pcre2_compile( //
-        PCRE2_SPTR8(pattern.data()),
-        PCRE2_SIZE(pattern.size()),
-        PCRE2_MATCH_INVALID_UTF,
-        &pcre2_pattern_error_code,
-        &pcre2_pattern_error_offset,
-        pcre2_compile_context);
-
-    // https://www.pcre.org/current/doc/html/pcre2_jit_compile.html
-    auto jit_status = pcre2_jit_compile(pcre2_code, PCRE2_JIT_COMPLETE);
-    if (jit_status != 0)
-        *c_error = "Failed to JIT-compile the RegEx query";
-
-    pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(pcre2_code, pcre2_context);
-    if (!match_data)
-        *c_error = "Failed to allocate memory for RegEx pattern matches";
-
-    if (!*c_error)
+    count = 0;
+    compiled_regex_ptr_t regex = regex_cache().compile(pattern, c_error);
+    return_if_error_m(c_error);
+
+    // Anchored patterns on indexed collections only check the paths with the same literal prefix
+    std::string_view literal_prefix = c_index ? regex_literal_prefix(pattern, arena, c_error) : std::string_view {};
+    return_if_error_m(c_error);
+    std::size_t slices_count = literal_prefix.empty() && !c_transaction ? std::max<std::size_t>(threads_count, 1u) : 1u;
+
+    // Every thread needs its own match data
+    auto matches_data = arena.alloc<pcre2_match_data*>(slices_count, c_error);
+    return_if_error_m(c_error);
+    for (auto& match_data : matches_data)
+        match_data = pcre2_match_data_create_from_pattern(regex->code, nullptr);
+    bool allocated = std::all_of(matches_data.begin(), matches_data.end(), [](pcre2_match_data* match_data) {
+        return match_data != nullptr;
+    });
+    log_error_if_m(allocated, c_error, out_of_memory_k, "Failed to allocate memory for RegEx pattern matches");
+
+    auto matches = [&](std::size_t slice_idx, std::string_view body) noexcept {
+        // https://www.pcre.org/current/doc/html/pcre2_jit_match.html
+        auto match = regex->jit ? &pcre2_jit_match : &pcre2_match;
+        auto found_matches = match( //
+            regex->code,
+            PCRE2_SPTR(body.data()),
+            PCRE2_SIZE(body.size()),
+            PCRE2_SIZE(0), // start offset
+            PCRE2_NO_UTF_CHECK,
+            matches_data[slice_idx],
+            NULL);
+        return found_matches > 0;
+    };
+
+    if (!*c_error && !literal_prefix.empty())
+        index_scan_w_predicate( //
+            c_db,
+            c_transaction,
+            *c_index,
+            literal_prefix,
+            previous_path,
+            c_count_limit,
+            c_options,
+            count,
+            paths,
+            arena,
+            c_error,
+            [&](std::string_view body) { return matches(0, body); });
+    else if (!*c_error)
         full_scan_collection_w_predicate( //
             c_db,
             c_transaction,
             c_collection,
+            hash,
             previous_path,
             c_count_limit,
             c_options,
+            slices_count,
             count,
             paths,
             arena,
             c_error,
-            [=](std::string_view body) {
-                // https://www.pcre.org/current/doc/html/pcre2_jit_match.html
-                // pcre2_match_data match_data;
-                // pcre2_match_context match_context;
-                auto found_matches = pcre2_jit_match( //
-                    pcre2_code,
-                    PCRE2_SPTR(body.data()),
-                    PCRE2_SIZE(body.size()),
-                    PCRE2_SIZE(0), // start offset
-                    PCRE2_NO_UTF_CHECK,
-                    match_data,
-                    NULL);
-                return found_matches > 0;
-            });
+            matches);
 
-    pcre2_match_data_free(match_data);
-    pcre2_code_free(pcre2_code);
-    pcre2_compile_context_free(pcre2_compile_context);
-    pcre2_general_context_free(pcre2_context);
+    for (pcre2_match_data* match_data : matches_data)
+        pcre2_match_data_free(match_data);
 }
 
 void ustore_paths_match(ustore_paths_match_t* c_ptr) {
 
     ustore_paths_match_t const& c = *c_ptr;
+    metered_call_t metered {metric_op_t::paths_match_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -632,23 +1621,80 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
     found_paths.reserve(count_limits_sum, c.error);
     return_if_error_m(c.error);
 
+    // Prefix indexes are only looked up, if some of the patterns can use them
+    prefix_indexes_t indexes(arena);
+    bool has_prefixes = false;
+    for (std::size_t i = 0; i != c.tasks_count && !has_prefixes; ++i) {
+        std::string_view pattern = patterns_args[i];
+        has_prefixes = is_prefix(pattern) || starts_with(pattern, "^");
+    }
+    if (has_prefixes)
+        indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+
+    // Full scans start from the bucket of the previous path, so they need its hash
+    paths_hashes_t hashes(arena);
+    if (c.previous)
+        hashes.resolve(c.db,
+                       c.transaction,
+                       {},
+                       c.options,
+                       {c.collections, c.collections_stride},
+                       c.tasks_count,
+                       false,
+                       arena,
+                       c.error);
+    return_if_error_m(c.error);
+
     for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
         auto col = collections ? collections[i] : ustore_collection_main_k;
         auto pattern = patterns_args[i];
         auto previous = previous_args[i];
         auto limit = count_limits[i];
-        auto func = is_prefix(pattern) ? &full_scan_w_prefix : &full_scan_w_regex;
-        func(c.db,
-             c.transaction,
-             col,
-             pattern,
-             previous,
-             limit,
-             c.options,
-             found_counts[i],
-             found_paths,
-             arena,
-             c.error);
+        ustore_collection_t index_id = ustore_collection_main_k;
+        bool indexed = indexes.find_index(col, index_id);
+        hash_t hash = c.previous ? hashes[col] : hash_t {};
+        if (!is_prefix(pattern))
+            scan_w_regex(c.db,
+                         c.transaction,
+                         col,
+                         hash,
+                         indexed ? &index_id : nullptr,
+                         pattern,
+                         previous,
+                         limit,
+                         c.options,
+                         c.threads_count,
+                         found_counts[i],
+                         found_paths,
+                         arena,
+                         c.error);
+        else if (indexed)
+            index_scan_w_prefix(c.db,
+                                c.transaction,
+                                index_id,
+                                pattern,
+                                previous,
+                                limit,
+                                c.options,
+                                found_counts[i],
+                                found_paths,
+                                arena,
+                                c.error);
+        else
+            full_scan_w_prefix(c.db,
+                               c.transaction,
+                               col,
+                               hash,
+                               pattern,
+                               previous,
+                               limit,
+                               c.options,
+                               c.threads_count,
+                               found_counts[i],
+                               found_paths,
+                               arena,
+                               c.error);
     }
 
     // Export the results
@@ -658,4 +1704,103 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
         *c.paths_offsets = found_paths.offsets().begin().get();
     if (c.paths_strings)
         *c.paths_strings = (ustore_char_t*)found_paths.contents().begin().get();
-}
\ No newline at end of file
+}
+
+void ustore_paths_index_create(ustore_paths_index_create_t* c_ptr) {
+
+    ustore_paths_index_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(ustore_supports_named_collections_k,
+                      c.error,
+                      missing_feature_k,
+                      "Prefix indexes require named collections");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    prefix_indexes_t indexes(arena);
+    indexes.list(c.db, c.error);
+    return_if_error_m(c.error);
+    std::string_view index_name = indexes.index_name(c.collection, c.error);
+    return_if_error_m(c.error);
+    ustore_collection_t index_id = ustore_collection_main_k;
+    return_error_if_m(!indexes.find(index_name, index_id), c.error, args_combo_k, "Index already exists");
+
+    ustore_collection_create_t collection_init {};
+    collection_init.db = c.db;
+    collection_init.error = c.error;
+    collection_init.name = index_name.data();
+    collection_init.config = "";
+    collection_init.id = &index_id;
+    ustore_collection_create(&collection_init);
+    return_if_error_m(c.error);
+
+    // Buckets are read in batches into a separate memory, and their paths are indexed batch by batch
+    arena_t batch_arena(c.db);
+    auto batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    for (ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();;) {
+        linked_memory_lock_t batch = linked_memory(batch_arena.member_ptr(), batch_options, c.error);
+        return_if_error_m(c.error);
+
+        ustore_length_t count_limit = static_cast<ustore_length_t>(prefix_index_batch_size_k);
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.arena = batch;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        scan.values_offsets = &found_offsets;
+        scan.values = &found_values;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+        std::size_t found_count = found_counts[0];
+        if (!found_count)
+            break;
+
+        uninitialized_array_gt<prefix_edit_t> edits(batch);
+        joined_blobs_iterator_t found_buckets {found_offsets, found_values};
+        for (std::size_t i = 0; i != found_count; ++i, ++found_buckets)
+            for_each_in_bucket(*found_buckets, [&](bucket_member_t const& member) {
+                edits.push_back(prefix_edit_t {index_id, prefix_index_key(member.key), member.key, true}, c.error);
+            });
+        return_if_error_m(c.error);
+
+        uninitialized_array_gt<collection_key_t> places(batch);
+        uninitialized_array_gt<value_view_t> entries(batch);
+        apply_prefix_edits(c.db, nullptr, batch_options, {edits.begin(), edits.end()}, places, entries, batch, c.error);
+        return_if_error_m(c.error);
+
+        if (places.size()) {
+            ustore_write_t write {};
+            write.db = c.db;
+            write.error = c.error;
+            write.arena = batch;
+            write.options = batch_options;
+            write.tasks_count = places.size();
+            write.collections = &places[0].collection;
+            write.collections_stride = sizeof(collection_key_t);
+            write.keys = &places[0].key;
+            write.keys_stride = sizeof(collection_key_t);
+            write.lengths = entries[0].member_length();
+            write.lengths_stride = sizeof(value_view_t);
+            write.values = entries[0].member_ptr();
+            write.values_stride = sizeof(value_view_t);
+            ustore_write(&write);
+            return_if_error_m(c.error);
+        }
+
+        ustore_key_t last_key = found_keys[found_count - 1];
+        if (found_count != prefix_index_batch_size_k || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
+    }
+}
@@ -6,156 +6,2484 @@
  * Sits on top of any @see "ustore.h"-compatible system.
  *
  * Internally quantizes often f32/f16 vectors into i8 representations,
- * later constructing a Navigable Small World Graph on those vectors.
- * During search relies on an algorithm resembling A*, adding a
- * stochastic component.
+ * stored under negated keys next to the originals. Those are linked into
+ * a Hierarchical Navigable Small World graph, that is updated incrementally
+ * on every write and traversed with a beam search on every query.
+ *
+ * ## Index Layout
+ *
+ * The graph lives in a companion collection, named like the original one,
+ * but with a ".hnsw" suffix. It keeps an @c index_header_t under the
+ * `ustore_key_unknown_k` and one fixed-size node per vector under the
+ * same key as the vector. Every node is an array of keys:
+ * - the number of layers it belongs to,
+ * - neighbors count and a fixed-capacity list of neighbors for every layer.
+ * The bottom layer has twice the capacity of upper layers.
+ *
+ * ## Disk Index Layout
+ *
+ * Disk-resident indexes are standalone files, exported from a collection
+ * with `ustore_vectors_index_build()`. Every section starts at a 4 KB boundary:
+ * - a `disk_index_header_t`,
+ * - keys, codebooks and quantized codes of all the vectors, kept in memory while searching,
+ * - pages of nodes, each node holding a full-precision vector, a neighbors count
+ *   and a fixed-capacity list of neighbors, identified by their positions in the file.
+ * Nodes never straddle page boundaries, so expanding a node is a single page read.
+ */
+#include <algorithm>   // `std::sort`
+#include <atomic>      // `std::atomic`
+#include <cmath>       // `std::sqrt`
+#include <cstdio>      // `std::rename`
+#include <cstring>     // `std::strlen`
+#include <limits>      // `std::numeric_limits`
+#include <memory>      // `std::make_unique`
+#include <numeric>     // `std::iota`
+#include <string_view> // `std::string_view`
+#include <thread>      // `std::thread`
+#include <vector>      // `std::vector`
+
+#include <fcntl.h>    // `open`
+#include <sys/mman.h> // `mmap`
+#include <sys/stat.h> // `fstat`
+#include <unistd.h>   // `close`
+
+#include "ustore/vectors.h"
+#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+
+#include "helpers/linked_memory.hpp"          // `linked_memory_lock_t`
+#include "helpers/algorithm.hpp"              // `transform_n`
+#include "helpers/file.hpp"                   // `file_handle_t`
+#include "helpers/full_scan.hpp"              // `full_scan_collection`
+#include "helpers/limited_priority_queue.hpp" // `limited_priority_queue_gt`
+#include "helpers/distances.hpp"              // `distance_kernels`
+#include "helpers/metrics.hpp"                // `metered_call_t`
+#include "helpers/page_reader.hpp"            // `page_reader_t`
+#include "helpers/collection_companions.hpp"  // `vectors_index_suffix_k`
+
+/*********************************************************/
+/*****************	 C++ Implementation	  ****************/
+/*********************************************************/
+
+using namespace unum::ustore;
+using namespace unum;
+
+using real_t = float;
+using quant_t = std::int8_t;
+using quant_product_t = std::int16_t;
+
+struct match_t {
+    ustore_key_t key;
+    ustore_float_t metric;
+};
+
+struct lower_similarity_t {
+    bool operator()(match_t const& a, match_t const& b) const noexcept { return a.metric < b.metric; }
+};
+
+using pq_t = limited_priority_queue_gt<match_t, lower_similarity_t>;
+
+/**
+ * @brief Sorted allow-list of keys, that may appear among the matches.
+ * Without keys, everything is allowed.
+ */
+struct keys_filter_t {
+    ustore_key_t const* keys = nullptr;
+    std::size_t count = 0;
+
+    explicit operator bool() const noexcept { return keys != nullptr; }
+    bool allows(ustore_key_t key) const noexcept { return !keys || std::binary_search(keys, keys + count, key); }
+};
+
+static constexpr quant_t float_scaling_k = 100;
+static constexpr quant_product_t product_scaling_k = float_scaling_k * float_scaling_k;
+
+struct metric_dot_t {
+    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
+        return real_t(distance_kernels().i8_dot(a, b, dims)) / product_scaling_k;
+    }
+};
+
+struct metric_cos_t {
+    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
+        i8_dot_and_norms_t parts = distance_kernels().i8_dot_and_norms(a, b, dims);
+        auto nominator = real_t(parts.ab) / product_scaling_k;
+        auto denominator = std::sqrt(real_t(parts.aa) / product_scaling_k) * //
+                           std::sqrt(real_t(parts.bb) / product_scaling_k);
+        return nominator / denominator;
+    }
+};
+
+struct metric_l2_t {
+    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
+        return std::sqrt(real_t(distance_kernels().i8_l2_squared(a, b, dims)) / product_scaling_k);
+    }
+};
+
+struct entry_t {
+    collection_key_t collection_key;
+    value_view_t value;
+};
+
+template <typename float_at = real_t>
+void quantize(float_at const* originals, std::size_t dims, quant_t* quants) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        quants[i] = static_cast<quant_t>(originals[i] * float_scaling_k);
+}
+
+void quantize(f16_bits_t const* originals, std::size_t dims, quant_t* quants) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        quants[i] = static_cast<quant_t>(f16_to_f32(originals[i]) * float_scaling_k);
+}
+
+void quantize(byte_t const* bytes, ustore_vector_scalar_t scalar_type, std::size_t dims, quant_t* quants) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: return quantize((real_t const*)bytes, dims, quants);
+    case ustore_vector_scalar_f64_k: return quantize((double const*)bytes, dims, quants);
+    case ustore_vector_scalar_f16_k: return quantize((f16_bits_t const*)bytes, dims, quants);
+    case ustore_vector_scalar_i8_k: return quantize((quant_t const*)bytes, dims, quants);
+    }
+}
+
+real_t metric(quant_t const* a, quant_t const* b, std::size_t dims, ustore_vector_metric_t kind) noexcept {
+    switch (kind) {
+    case ustore_vector_metric_dot_k: return metric_dot_t {}(a, b, dims);
+    case ustore_vector_metric_cos_k: return metric_cos_t {}(a, b, dims);
+    case ustore_vector_metric_l2_k: return metric_l2_t {}(a, b, dims);
+    default: return 0;
+    }
+}
+
+ustore_length_t size_bytes(ustore_vector_scalar_t scalar_type) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: return sizeof(real_t);
+    case ustore_vector_scalar_f64_k: return sizeof(double);
+    case ustore_vector_scalar_f16_k: return sizeof(std::int16_t);
+    case ustore_vector_scalar_i8_k: return sizeof(quant_t);
+    default: return 0;
+    }
+}
+
+struct vectors_arg_t {
+    strided_iterator_gt<ustore_bytes_cptr_t const> contents;
+    strided_iterator_gt<ustore_length_t const> offsets;
+    ustore_size_t vectors_stride;
+    ustore_vector_scalar_t scalar_type;
+    ustore_length_t dimensions;
+    ustore_size_t tasks_count = 1;
+
+    value_view_t operator[](std::size_t i) const noexcept {
+        if (!contents)
+            return {};
+        ustore_bytes_cptr_t begin = contents[i];
+        begin += offsets ? offsets[i] : 0u;
+        begin += vectors_stride * i;
+        return {begin, dimensions * size_bytes(scalar_type)};
+    }
+};
+
+/**
+ * @brief Converts the raw metric into closeness and vice versa.
+ * Closeness is higher for closer vectors, negating the L2 distance.
+ */
+real_t oriented_metric(real_t value, ustore_vector_metric_t kind) noexcept {
+    return kind == ustore_vector_metric_l2_k ? -value : value;
+}
+
+/*********************************************************/
+/*****************	     Quantization	  ****************/
+/*********************************************************/
+
+using code_t = ustore_byte_t;
+
+static constexpr std::size_t pq_subspace_dims_k = 2;
+static constexpr std::size_t pq_centroids_k = 16;
+static constexpr std::size_t pq_training_iterations_k = 10;
+static constexpr std::size_t pq_training_samples_k = 4096;
+/// Codebooks aren't trained, until the collection holds that many vectors.
+static constexpr std::size_t pq_training_samples_min_k = pq_centroids_k * 16;
+
+template <typename scalar_at>
+void convert(scalar_at const* originals, std::size_t dims, real_t* reals) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        reals[i] = static_cast<real_t>(originals[i]);
+}
+
+void convert(f16_bits_t const* originals, std::size_t dims, real_t* reals) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        reals[i] = f16_to_f32(originals[i]);
+}
+
+void convert(byte_t const* bytes, ustore_vector_scalar_t scalar_type, std::size_t dims, real_t* reals) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: return convert((real_t const*)bytes, dims, reals);
+    case ustore_vector_scalar_f64_k: return convert((double const*)bytes, dims, reals);
+    case ustore_vector_scalar_f16_k: return convert((f16_bits_t const*)bytes, dims, reals);
+    case ustore_vector_scalar_i8_k: return convert((quant_t const*)bytes, dims, reals);
+    }
+}
+
+template <typename scalar_at>
+void convert_reals(real_t const* reals, std::size_t dims, scalar_at* originals) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        originals[i] = static_cast<scalar_at>(reals[i]);
+}
+
+void convert_reals(real_t const* reals, std::size_t dims, f16_bits_t* originals) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        originals[i] = f32_to_f16(reals[i]);
+}
+
+void convert_reals(real_t const* reals, std::size_t dims, quant_t* originals) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        originals[i] = static_cast<quant_t>(std::lround(std::clamp<real_t>(reals[i], -128, 127)));
+}
+
+void convert_reals(real_t const* reals, std::size_t dims, ustore_vector_scalar_t scalar_type, byte_t* bytes) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: return convert_reals(reals, dims, (real_t*)bytes);
+    case ustore_vector_scalar_f64_k: return convert_reals(reals, dims, (double*)bytes);
+    case ustore_vector_scalar_f16_k: return convert_reals(reals, dims, (f16_bits_t*)bytes);
+    case ustore_vector_scalar_i8_k: return convert_reals(reals, dims, (quant_t*)bytes);
+    }
+}
+
+/**
+ * @brief Infers the type of stored originals, as only their length is known.
+ */
+bool scalar_type_of(ustore_length_t length, ustore_length_t dims, ustore_vector_scalar_t& scalar_type) noexcept {
+    ustore_vector_scalar_t scalar_types[] = {
+        ustore_vector_scalar_f32_k,
+        ustore_vector_scalar_f16_k,
+        ustore_vector_scalar_i8_k,
+        ustore_vector_scalar_f64_k,
+    };
+    for (ustore_vector_scalar_t candidate : scalar_types)
+        if (length == dims * size_bytes(candidate))
+            return scalar_type = candidate, true;
+    return false;
+}
+
+/**
+ * @brief Compact representation of vectors, compared on every step of the search.
+ * @see `ustore_vector_quantization_t`.
+ *
+ * Codes of different schemes are laid out in the following way:
+ * - `i8_k`: `dims` bytes, scaled by 100.
+ * - `i8_scaled_k`: a `real_t` scale, followed by `dims` bytes.
+ * - `pq4_k`: a 4-bit centroid index per every two dimensions, two indexes per byte.
+ * - `b1_k`: a bit per dimension, treated as a vector of +1 and -1 components.
+ *
+ * To compare product-quantized codes, dot products of all pairs of centroids
+ * within every subspace are tabulated in advance. All other metrics are derived
+ * from those products.
+ */
+class quantizer_t {
+    ustore_vector_quantization_t scheme_ = ustore_vector_quantization_i8_k;
+    std::size_t dims_ = 0;
+    real_t const* codebooks_ = nullptr;
+    ptr_range_gt<real_t> products_;
+    ptr_range_gt<real_t> reals_;
+
+    static real_t read_scale(code_t const* code) noexcept {
+        real_t scale;
+        std::memcpy(&scale, code, sizeof(scale));
+        return scale;
+    }
+
+    static std::size_t nibble(code_t const* code, std::size_t subspace) noexcept {
+        return (code[subspace / 2u] >> ((subspace & 1u) * 4u)) & 0x0Fu;
+    }
+
+    real_t const* subspace_products(std::size_t subspace) const noexcept {
+        return products_.begin() + subspace * pq_centroids_k * pq_centroids_k;
+    }
+
+    std::size_t hamming(code_t const* a, code_t const* b) const noexcept {
+        return distance_kernels().b1_hamming(a, b, code_size());
+    }
+
+    f32_dot_and_norms_t dot_and_norms(code_t const* a, code_t const* b) const noexcept {
+        f32_dot_and_norms_t result;
+        switch (scheme_) {
+        case ustore_vector_quantization_i8_scaled_k: {
+            real_t a_scale = read_scale(a), b_scale = read_scale(b);
+            i8_dot_and_norms_t parts = distance_kernels().i8_dot_and_norms( //
+                (quant_t const*)(a + sizeof(real_t)),
+                (quant_t const*)(b + sizeof(real_t)),
+                dims_);
+            result.ab = real_t(parts.ab) * a_scale * b_scale;
+            result.aa = real_t(parts.aa) * a_scale * a_scale;
+            result.bb = real_t(parts.bb) * b_scale * b_scale;
+            break;
+        }
+        case ustore_vector_quantization_pq4_k:
+            for (std::size_t subspace = 0; subspace != subspaces(dims_); ++subspace) {
+                real_t const* products = subspace_products(subspace);
+                std::size_t a_centroid = nibble(a, subspace), b_centroid = nibble(b, subspace);
+                result.ab += products[a_centroid * pq_centroids_k + b_centroid];
+                result.aa += products[a_centroid * pq_centroids_k + a_centroid];
+                result.bb += products[b_centroid * pq_centroids_k + b_centroid];
+            }
+            break;
+        case ustore_vector_quantization_b1_k:
+            result.ab = real_t(dims_) - 2 * real_t(hamming(a, b));
+            result.aa = result.bb = real_t(dims_);
+            break;
+        default: {
+            i8_dot_and_norms_t parts = distance_kernels().i8_dot_and_norms((quant_t const*)a, (quant_t const*)b, dims_);
+            result.ab = real_t(parts.ab) / product_scaling_k;
+            result.aa = real_t(parts.aa) / product_scaling_k;
+            result.bb = real_t(parts.bb) / product_scaling_k;
+            break;
+        }
+        }
+        return result;
+    }
+
+  public:
+    static std::size_t subspaces(std::size_t dims) noexcept {
+        return (dims + pq_subspace_dims_k - 1u) / pq_subspace_dims_k;
+    }
+
+    /**
+     * @brief Number of scalars in the trained state, that must be persisted.
+     */
+    static std::size_t codebooks_size(ustore_vector_quantization_t scheme, std::size_t dims) noexcept {
+        return scheme == ustore_vector_quantization_pq4_k ? subspaces(dims) * pq_centroids_k * pq_subspace_dims_k : 0;
+    }
+
+    static std::size_t code_size(ustore_vector_quantization_t scheme, std::size_t dims) noexcept {
+        switch (scheme) {
+        case ustore_vector_quantization_i8_scaled_k: return sizeof(real_t) + dims;
+        case ustore_vector_quantization_pq4_k: return (subspaces(dims) + 1u) / 2u;
+        case ustore_vector_quantization_b1_k: return (dims + 7u) / 8u;
+        default: return dims;
+        }
+    }
+
+    static std::size_t max_code_size(std::size_t dims) noexcept { return sizeof(real_t) + dims; }
+
+    static bool is_known(std::uint32_t scheme) noexcept { return scheme <= ustore_vector_quantization_b1_k; }
+
+    /**
+     * @brief Trains product-quantization codebooks with k-means over every subspace.
+     * @param samples Row-major matrix of real vectors, padded to a multiple of subspace dimensions.
+     */
+    static void train(real_t const* samples, std::size_t count, std::size_t dims, real_t* codebooks) noexcept {
+        std::size_t stride = subspaces(dims) * pq_subspace_dims_k;
+        real_t sums[pq_centroids_k][pq_subspace_dims_k];
+        std::size_t counts[pq_centroids_k];
+        for (std::size_t subspace = 0; subspace != subspaces(dims); ++subspace) {
+            real_t* centroids = codebooks + subspace * pq_centroids_k * pq_subspace_dims_k;
+            std::size_t offset = subspace * pq_subspace_dims_k;
+            for (std::size_t centroid = 0; centroid != pq_centroids_k; ++centroid)
+                std::copy_n(samples + (centroid * count / pq_centroids_k) * stride + offset,
+                            pq_subspace_dims_k,
+                            centroids + centroid * pq_subspace_dims_k);
+
+            for (std::size_t iteration = 0; iteration != pq_training_iterations_k; ++iteration) {
+                std::fill_n(&sums[0][0], pq_centroids_k * pq_subspace_dims_k, real_t(0));
+                std::fill_n(counts, pq_centroids_k, std::size_t(0));
+                for (std::size_t i = 0; i != count; ++i) {
+                    real_t const* sample = samples + i * stride + offset;
+                    std::size_t closest = nearest(centroids, sample);
+                    for (std::size_t j = 0; j != pq_subspace_dims_k; ++j)
+                        sums[closest][j] += sample[j];
+                    ++counts[closest];
+                }
+                // Empty clusters keep their previous centroids
+                for (std::size_t centroid = 0; centroid != pq_centroids_k; ++centroid)
+                    for (std::size_t j = 0; counts[centroid] && j != pq_subspace_dims_k; ++j)
+                        centroids[centroid * pq_subspace_dims_k + j] = sums[centroid][j] / counts[centroid];
+            }
+        }
+    }
+
+    static std::size_t nearest(real_t const* centroids, real_t const* sample) noexcept {
+        std::size_t closest = 0;
+        real_t closest_distance = std::numeric_limits<real_t>::max();
+        for (std::size_t centroid = 0; centroid != pq_centroids_k; ++centroid) {
+            real_t distance = 0;
+            for (std::size_t j = 0; j != pq_subspace_dims_k; ++j) {
+                real_t diff = centroids[centroid * pq_subspace_dims_k + j] - sample[j];
+                distance += diff * diff;
+            }
+            if (distance < closest_distance)
+                closest = centroid, closest_distance = distance;
+        }
+        return closest;
+    }
+
+    /**
+     * @brief Prepares the conversion buffers and the tables of centroids products.
+     * @param codebooks Trained state of size `codebooks_size()`, that must outlive the quantizer.
+     */
+    void init(ustore_vector_quantization_t scheme,
+              std::size_t dims,
+              real_t const* codebooks,
+              linked_memory_lock_t& arena,
+              ustore_error_t* c_error) noexcept {
+        scheme_ = scheme;
+        dims_ = dims;
+        codebooks_ = codebooks;
+        if (scheme == ustore_vector_quantization_i8_k)
+            return;
+
+        std::size_t padded_dims = subspaces(dims) * pq_subspace_dims_k;
+        if (reals_.size() < padded_dims) {
+            reals_ = arena.alloc<real_t>(padded_dims, c_error);
+            return_if_error_m(c_error);
+        }
+        std::fill(reals_.begin(), reals_.end(), real_t(0));
+        if (scheme != ustore_vector_quantization_pq4_k)
+            return;
+
+        std::size_t products_count = subspaces(dims) * pq_centroids_k * pq_centroids_k;
+        if (products_.size() < products_count) {
+            products_ = arena.alloc<real_t>(products_count, c_error);
+            return_if_error_m(c_error);
+        }
+        retabulate();
+    }
+
+    /**
+     * @brief Updates the table of centroids products after training.
+     */
+    void retabulate() noexcept {
+        for (std::size_t subspace = 0; subspace != subspaces(dims_); ++subspace) {
+            real_t const* centroids = codebooks_ + subspace * pq_centroids_k * pq_subspace_dims_k;
+            real_t* products = products_.begin() + subspace * pq_centroids_k * pq_centroids_k;
+            for (std::size_t i = 0; i != pq_centroids_k; ++i)
+                for (std::size_t j = 0; j != pq_centroids_k; ++j)
+                    products[i * pq_centroids_k + j] = std::inner_product(centroids + i * pq_subspace_dims_k,
+                                                                          centroids + (i + 1) * pq_subspace_dims_k,
+                                                                          centroids + j * pq_subspace_dims_k,
+                                                                          real_t(0));
+        }
+    }
+
+    ustore_vector_quantization_t scheme() const noexcept { return scheme_; }
+    std::size_t code_size() const noexcept { return code_size(scheme_, dims_); }
+
+    /**
+     * @brief Checks if comparisons with `metric()` overload, that takes norms, would use them.
+     */
+    bool needs_norms(ustore_vector_metric_t kind) const noexcept {
+        switch (kind) {
+        case ustore_vector_metric_cos_k: return true;
+        case ustore_vector_metric_l2_k:
+            return scheme_ == ustore_vector_quantization_i8_scaled_k || scheme_ == ustore_vector_quantization_pq4_k;
+        default: return false;
+        }
+    }
+
+    void encode(byte_t const* original, ustore_vector_scalar_t scalar_type, code_t* code) noexcept {
+        if (scheme_ == ustore_vector_quantization_i8_k)
+            return quantize(original, scalar_type, dims_, (quant_t*)code);
+
+        convert(original, scalar_type, dims_, reals_.begin());
+        switch (scheme_) {
+        case ustore_vector_quantization_i8_scaled_k: {
+            real_t max_magnitude = 0;
+            for (std::size_t i = 0; i != dims_; ++i)
+                max_magnitude = std::max(max_magnitude, std::abs(reals_[i]));
+            real_t scale = max_magnitude / 127;
+            std::memcpy(code, &scale, sizeof(scale));
+            auto quants = (quant_t*)(code + sizeof(real_t));
+            for (std::size_t i = 0; i != dims_; ++i)
+                quants[i] = scale != 0 ? static_cast<quant_t>(std::lround(reals_[i] / scale)) : quant_t(0);
+            break;
+        }
+        case ustore_vector_quantization_pq4_k:
+            std::fill_n(code, code_size(), code_t(0));
+            for (std::size_t subspace = 0; subspace != subspaces(dims_); ++subspace) {
+                real_t const* centroids = codebooks_ + subspace * pq_centroids_k * pq_subspace_dims_k;
+                std::size_t closest = nearest(centroids, reals_.begin() + subspace * pq_subspace_dims_k);
+                code[subspace / 2u] |= code_t(closest << ((subspace & 1u) * 4u));
+            }
+            break;
+        case ustore_vector_quantization_b1_k:
+            std::fill_n(code, code_size(), code_t(0));
+            for (std::size_t i = 0; i != dims_; ++i)
+                code[i / 8u] |= code_t(reals_[i] > 0) << (i % 8u);
+            break;
+        default: break;
+        }
+    }
+
+    real_t dot(code_t const* a, code_t const* b) const noexcept {
+        switch (scheme_) {
+        case ustore_vector_quantization_i8_scaled_k:
+            return real_t(distance_kernels().i8_dot((quant_t const*)(a + sizeof(real_t)),
+                                                    (quant_t const*)(b + sizeof(real_t)),
+                                                    dims_)) *
+                   read_scale(a) * read_scale(b);
+        case ustore_vector_quantization_pq4_k: {
+            real_t result = 0;
+            for (std::size_t subspace = 0; subspace != subspaces(dims_); ++subspace)
+                result += subspace_products(subspace)[nibble(a, subspace) * pq_centroids_k + nibble(b, subspace)];
+            return result;
+        }
+        case ustore_vector_quantization_b1_k: return real_t(dims_) - 2 * real_t(hamming(a, b));
+        default: return metric_dot_t {}((quant_t const*)a, (quant_t const*)b, dims_);
+        }
+    }
+
+    real_t norm(code_t const* a) const noexcept {
+        switch (scheme_) {
+        case ustore_vector_quantization_b1_k: return std::sqrt(real_t(dims_));
+        default: return std::sqrt(dot(a, a));
+        }
+    }
+
+    /**
+     * @brief Compares two codes, reusing their precomputed norms.
+     */
+    real_t metric(code_t const* a, code_t const* b, real_t a_norm, real_t b_norm, ustore_vector_metric_t kind) const noexcept {
+        switch (kind) {
+        case ustore_vector_metric_dot_k: return dot(a, b);
+        case ustore_vector_metric_cos_k: return dot(a, b) / (a_norm * b_norm);
+        case ustore_vector_metric_l2_k:
+            switch (scheme_) {
+            case ustore_vector_quantization_i8_k: return metric_l2_t {}((quant_t const*)a, (quant_t const*)b, dims_);
+            case ustore_vector_quantization_b1_k: return 2 * std::sqrt(real_t(hamming(a, b)));
+            default: return std::sqrt(std::max(a_norm * a_norm + b_norm * b_norm - 2 * dot(a, b), real_t(0)));
+            }
+        default: return 0;
+        }
+    }
+
+    real_t metric(code_t const* a, code_t const* b, ustore_vector_metric_t kind) const noexcept {
+        if (scheme_ == ustore_vector_quantization_i8_k)
+            return ::metric((quant_t const*)a, (quant_t const*)b, dims_, kind);
+        if (kind == ustore_vector_metric_dot_k)
+            return dot(a, b);
+        if (kind == ustore_vector_metric_l2_k && scheme_ == ustore_vector_quantization_b1_k)
+            return 2 * std::sqrt(real_t(hamming(a, b)));
+
+        f32_dot_and_norms_t parts = dot_and_norms(a, b);
+        if (kind == ustore_vector_metric_cos_k)
+            return parts.ab / (std::sqrt(parts.aa) * std::sqrt(parts.bb));
+        return std::sqrt(std::max(parts.aa + parts.bb - 2 * parts.ab, real_t(0)));
+    }
+
+    real_t closeness(code_t const* a, code_t const* b, ustore_vector_metric_t kind) const noexcept {
+        return oriented_metric(metric(a, b, kind), kind);
+    }
+};
+
+/*********************************************************/
+/*****************	     HNSW Index		  ****************/
+/*********************************************************/
+
+static constexpr ustore_length_t default_max_neighbors_k = 16;
+static constexpr ustore_length_t default_ef_construction_k = 64;
+static constexpr ustore_length_t default_ef_search_k = 64;
+static constexpr std::size_t max_levels_k = 16;
+static constexpr std::size_t initial_visited_capacity_k = 1024;
+static constexpr std::uint32_t index_magic_k = 0x484e5357; // "HNSW"
+static constexpr std::string_view index_suffix_k = vectors_index_suffix_k;
+static constexpr real_t missing_closeness_k = -std::numeric_limits<real_t>::infinity();
+
+std::uint64_t hash_key(ustore_key_t key) noexcept {
+    // SplitMix64 finalizer
+    auto x = static_cast<std::uint64_t>(key) + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Picks the top layer for a node, following an exponential
+ * distribution with `1 / ln(max_neighbors)` scale. Seeded with the key,
+ * so that re-inserting an entry doesn't reshape the graph.
+ */
+std::size_t random_level(ustore_key_t key, std::size_t max_neighbors) noexcept {
+    double uniform = (double(hash_key(key) >> 11) + 1.0) / double(1ull << 53);
+    double level = -std::log(uniform) / std::log(double(std::max<std::size_t>(max_neighbors, 2u)));
+    return std::min(static_cast<std::size_t>(level), max_levels_k - 1u);
+}
+
+struct index_header_t {
+    std::uint32_t magic = index_magic_k;
+    std::uint32_t dimensions = 0;
+    std::uint32_t metric = ustore_vector_metric_cos_k;
+    std::uint32_t max_neighbors = default_max_neighbors_k;
+    std::uint32_t max_level = 0;
+    std::uint32_t quantization = ustore_vector_quantization_i8_k;
+    ustore_key_t entry_key = 0;
+    std::uint64_t count = 0;
+};
+
+/**
+ * @brief Non-owning view of a node in the HNSW graph.
+ * @see The layout description in the beginning of this file.
+ */
+struct node_ref_t {
+    ustore_key_t* slots = nullptr;
+    std::size_t max_neighbors = 0;
+
+    static std::size_t capacity(std::size_t max_neighbors, std::size_t layer) noexcept {
+        return layer ? max_neighbors : max_neighbors * 2u;
+    }
+
+    static std::size_t slots_count(std::size_t max_neighbors, std::size_t levels) noexcept {
+        return levels ? 1u + (1u + max_neighbors * 2u) + (levels - 1u) * (1u + max_neighbors) : 1u;
+    }
+
+    std::size_t levels() const noexcept { return static_cast<std::size_t>(slots[0]); }
+    std::size_t size_bytes() const noexcept { return slots_count(max_neighbors, levels()) * sizeof(ustore_key_t); }
+
+    ustore_key_t* layer(std::size_t idx) const noexcept {
+        return slots + 1u + (idx ? (1u + max_neighbors * 2u) + (idx - 1u) * (1u + max_neighbors) : 0u);
+    }
+
+    ptr_range_gt<ustore_key_t> neighbors(std::size_t idx) const noexcept {
+        ustore_key_t* begin = layer(idx);
+        return {begin + 1, static_cast<std::size_t>(begin[0])};
+    }
+
+    void reset(std::size_t levels) noexcept {
+        std::fill_n(slots, slots_count(max_neighbors, levels), ustore_key_t(0));
+        slots[0] = static_cast<ustore_key_t>(levels);
+    }
+
+    void assign(std::size_t idx, ustore_key_t const* keys, std::size_t count) noexcept {
+        ustore_key_t* begin = layer(idx);
+        begin[0] = static_cast<ustore_key_t>(count);
+        std::copy_n(keys, count, begin + 1);
+    }
+
+    bool append(std::size_t idx, ustore_key_t key) noexcept {
+        ustore_key_t* begin = layer(idx);
+        auto count = static_cast<std::size_t>(begin[0]);
+        if (count == capacity(max_neighbors, idx))
+            return false;
+        begin[1 + count] = key;
+        begin[0] = static_cast<ustore_key_t>(count + 1);
+        return true;
+    }
+};
+
+struct candidate_t {
+    ustore_key_t key;
+    real_t closeness;
+    bool expanded;
+};
+
+struct lower_closeness_t {
+    bool operator()(candidate_t const& a, candidate_t const& b) const noexcept { return a.closeness < b.closeness; }
+};
+
+using candidates_t = limited_priority_queue_gt<candidate_t, lower_closeness_t>;
+
+/**
+ * @brief Open-addressing hash-set of keys, growing within the arena.
+ * Uses `ustore_key_unknown_k` as the empty slot marker.
+ */
+class visited_keys_t {
+    ptr_range_gt<ustore_key_t> slots_;
+    std::size_t count_ = 0;
+
+    bool insert_unchecked(ustore_key_t key) noexcept {
+        std::size_t mask = slots_.size() - 1u;
+        std::size_t idx = hash_key(key) & mask;
+        for (; slots_[idx] != ustore_key_unknown_k; idx = (idx + 1u) & mask)
+            if (slots_[idx] == key)
+                return false;
+        slots_[idx] = key;
+        ++count_;
+        return true;
+    }
+
+  public:
+    void reserve(std::size_t capacity, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+        std::size_t slots_count = next_power_of_two(std::max<std::size_t>(capacity * 2u, 64u));
+        if (slots_.size() >= slots_count)
+            return;
+
+        auto old_slots = slots_;
+        slots_ = arena.alloc<ustore_key_t>(slots_count, c_error);
+        return_if_error_m(c_error);
+        std::fill(slots_.begin(), slots_.end(), ustore_key_unknown_k);
+        count_ = 0;
+        for (ustore_key_t key : old_slots)
+            if (key != ustore_key_unknown_k)
+                insert_unchecked(key);
+    }
+
+    void clear() noexcept {
+        std::fill(slots_.begin(), slots_.end(), ustore_key_unknown_k);
+        count_ = 0;
+    }
+
+    /**
+     * @return true If the key wasn't present before.
+     */
+    bool insert(ustore_key_t key, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+        if ((count_ + 1u) * 2u > slots_.size()) {
+            reserve(count_ + 1u, arena, c_error);
+            if (*c_error)
+                return false;
+        }
+        return insert_unchecked(key);
+    }
+};
+
+/**
+ * @brief HNSW graph over quantized vectors of a single collection.
+ *
+ * All the nested reads go through a private arena, which is reset on
+ * every call. Only the fixed-size working buffers are allocated in the
+ * callers arena, so memory usage doesn't grow with the graph size.
+ */
+class index_t {
+    ustore_database_t db_;
+    ustore_transaction_t transaction_;
+    ustore_options_t options_;
+    linked_memory_lock_t& arena_;
+    ustore_error_t* error_;
+    arena_t scratch_;
+
+    ustore_collection_t vectors_collection_ = ustore_collection_main_k;
+    ustore_collection_t index_collection_ = ustore_collection_main_k;
+    index_header_t header_;
+    bool header_changed_ = false;
+    ptr_range_gt<real_t> codebooks_;
+    quantizer_t quantizer_;
+    bool trained_ = false;
+
+    std::size_t buffers_max_neighbors_ = 0;
+    ptr_range_gt<ustore_key_t> expanded_node_;
+    ptr_range_gt<ustore_key_t> inserted_node_;
+    ptr_range_gt<ustore_key_t> linked_nodes_;
+    ptr_range_gt<ustore_length_t> linked_offsets_;
+    ptr_range_gt<ustore_length_t> linked_lengths_;
+    ptr_range_gt<ustore_key_t> batch_keys_;
+    ptr_range_gt<ustore_key_t> pruned_keys_;
+    ptr_range_gt<ustore_key_t> quantized_keys_;
+    ptr_range_gt<candidate_t> pruned_candidates_;
+    ptr_range_gt<candidate_t> candidates_;
+    ptr_range_gt<candidate_t> allowed_candidates_;
+    visited_keys_t visited_;
+
+    ustore_options_t scratch_options() const noexcept {
+        auto hidden = ustore_option_dont_discard_memory_k | ustore_option_read_shared_memory_k;
+        return ustore_options_t(options_ & ~hidden);
+    }
+
+    std::size_t node_stride() const noexcept {
+        return node_ref_t::slots_count(buffers_max_neighbors_, max_levels_k);
+    }
+
+    void read_blobs(ustore_collection_t collection,
+                    ustore_key_t const* keys,
+                    std::size_t count,
+                    ustore_length_t*& offsets,
+                    ustore_length_t*& lengths,
+                    ustore_byte_t*& values) noexcept {
+        ustore_read_t read {};
+        read.db = db_;
+        read.error = error_;
+        read.transaction = transaction_;
+        read.arena = scratch_;
+        read.options = scratch_options();
+        read.tasks_count = count;
+        read.collections = &collection;
+        read.collections_stride = 0;
+        read.keys = keys;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &offsets;
+        read.lengths = &lengths;
+        read.values = &values;
+        ustore_read(&read);
+    }
+
+    void write_blobs(ustore_collection_t collection,
+                     ustore_key_t const* keys,
+                     std::size_t count,
+                     ustore_bytes_cptr_t values,
+                     ustore_length_t const* offsets,
+                     ustore_length_t const* lengths) noexcept {
+        ustore_write_t write {};
+        write.db = db_;
+        write.error = error_;
+        write.transaction = transaction_;
+        write.arena = scratch_;
+        write.options = scratch_options();
+        write.tasks_count = count;
+        write.collections = &collection;
+        write.keys = keys;
+        write.keys_stride = sizeof(ustore_key_t);
+        write.offsets = offsets;
+        write.offsets_stride = sizeof(ustore_length_t);
+        write.lengths = lengths;
+        write.lengths_stride = sizeof(ustore_length_t);
+        write.values = &values;
+        write.values_stride = 0;
+        ustore_write(&write);
+    }
+
+    bool read_node(ustore_key_t key, node_ref_t node) noexcept {
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        read_blobs(index_collection_, &key, 1, offsets, lengths, values);
+        if (*error_ || lengths[0] == ustore_length_missing_k || lengths[0] < sizeof(ustore_key_t))
+            return false;
+
+        std::size_t max_length = node_stride() * sizeof(ustore_key_t);
+        std::memcpy(node.slots, values + offsets[0], std::min<std::size_t>(lengths[0], max_length));
+        return node.levels() && node.levels() <= max_levels_k && node.size_bytes() == lengths[0];
+    }
+
+    void write_node(ustore_key_t key, node_ref_t node) noexcept {
+        ustore_length_t offset = 0;
+        ustore_length_t length = static_cast<ustore_length_t>(node.size_bytes());
+        write_blobs(index_collection_, &key, 1, reinterpret_cast<ustore_bytes_cptr_t>(node.slots), &offset, &length);
+    }
+
+    /**
+     * @brief Fetches quantized vectors for a batch of keys, calling back
+     * with a `NULL` pointer for the missing ones. Pointers are only valid
+     * until the next read.
+     */
+    template <typename callback_at>
+    void read_vectors(ustore_key_t const* keys, std::size_t count, callback_at&& callback) noexcept {
+        for (std::size_t i = 0; i != count; ++i)
+            quantized_keys_[i] = -keys[i];
+
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        read_blobs(vectors_collection_, quantized_keys_.begin(), count, offsets, lengths, values);
+        return_if_error_m(error_);
+
+        for (std::size_t i = 0; i != count; ++i) {
+            bool present = lengths[i] == quantizer_.code_size();
+            callback(i, present ? reinterpret_cast<code_t const*>(values + offsets[i]) : nullptr);
+        }
+    }
+
+    bool find_companion(bool create) noexcept {
+        ustore_size_t count = 0;
+        ustore_collection_t* ids {};
+        ustore_length_t* offsets {};
+        ustore_char_t* names {};
+        ustore_collection_list_t list {};
+        list.db = db_;
+        list.error = error_;
+        list.arena = scratch_;
+        list.options = scratch_options();
+        list.count = &count;
+        list.ids = &ids;
+        list.offsets = &offsets;
+        list.names = &names;
+        ustore_collection_list(&list);
+        if (*error_)
+            return false;
+
+        std::string_view name;
+        if (vectors_collection_ != ustore_collection_main_k) {
+            auto it = std::find(ids, ids + count, vectors_collection_);
+            if (it == ids + count)
+                return false;
+            name = names + offsets[it - ids];
+        }
+
+        auto companion = arena_.alloc<char>(name.size() + index_suffix_k.size() + 1u, error_);
+        if (*error_)
+            return false;
+        std::copy(name.begin(), name.end(), companion.begin());
+        std::copy(index_suffix_k.begin(), index_suffix_k.end(), companion.begin() + name.size());
+        companion[companion.size() - 1u] = '\0';
+        std::string_view companion_name {companion.begin(), companion.size() - 1u};
+
+        for (std::size_t i = 0; i != count; ++i) {
+            if (companion_name != std::string_view(names + offsets[i]))
+                continue;
+            index_collection_ = ids[i];
+            return true;
+        }
+
+        if (!create)
+            return false;
+
+        ustore_collection_create_t collection_init {};
+        collection_init.db = db_;
+        collection_init.error = error_;
+        collection_init.name = companion.begin();
+        collection_init.config = "";
+        collection_init.id = &index_collection_;
+        ustore_collection_create(&collection_init);
+        return !*error_;
+    }
+
+    void reserve_buffers(std::size_t max_neighbors, std::size_t ef) noexcept {
+        if (max_neighbors > buffers_max_neighbors_) {
+            buffers_max_neighbors_ = max_neighbors;
+            std::size_t stride = node_stride();
+            std::size_t max_batch = max_neighbors * 2u;
+            expanded_node_ = arena_.alloc<ustore_key_t>(stride, error_);
+            return_if_error_m(error_);
+            inserted_node_ = arena_.alloc<ustore_key_t>(stride, error_);
+            return_if_error_m(error_);
+            linked_nodes_ = arena_.alloc<ustore_key_t>(stride * max_batch, error_);
+            return_if_error_m(error_);
+            linked_offsets_ = arena_.alloc<ustore_length_t>(max_batch, error_);
+            return_if_error_m(error_);
+            linked_lengths_ = arena_.alloc<ustore_length_t>(max_batch, error_);
+            return_if_error_m(error_);
+            batch_keys_ = arena_.alloc<ustore_key_t>(max_batch, error_);
+            return_if_error_m(error_);
+            pruned_keys_ = arena_.alloc<ustore_key_t>(max_batch + 2u, error_);
+            return_if_error_m(error_);
+            quantized_keys_ = arena_.alloc<ustore_key_t>(max_batch + 2u, error_);
+            return_if_error_m(error_);
+            pruned_candidates_ = arena_.alloc<candidate_t>(max_batch, error_);
+            return_if_error_m(error_);
+        }
+        if (ef > candidates_.size()) {
+            candidates_ = arena_.alloc<candidate_t>(ef, error_);
+            return_if_error_m(error_);
+            allowed_candidates_ = arena_.alloc<candidate_t>(ef, error_);
+            return_if_error_m(error_);
+        }
+        visited_.reserve(initial_visited_capacity_k, arena_, error_);
+    }
+
+    candidates_t candidates(std::size_t capacity, std::size_t populated = 0) noexcept {
+        capacity = std::min(capacity, candidates_.size());
+        return {candidates_.begin(), candidates_.begin() + capacity, std::min(populated, capacity)};
+    }
+
+    /**
+     * @brief Restarts the traversal from the global entry point.
+     */
+    void start(code_t const* query, candidates_t& pool) noexcept {
+        visited_.clear();
+        visited_.insert(header_.entry_key, arena_, error_);
+        read_vectors(&header_.entry_key, 1, [&](std::size_t, code_t const* vector) noexcept {
+            auto entry_closeness = missing_closeness_k;
+            if (vector)
+                entry_closeness = quantizer_.closeness(query, vector, metric());
+            pool.push({header_.entry_key, entry_closeness, false});
+        });
+    }
+
+    /**
+     * @brief Prepares the best candidates of an upper layer to serve
+     * as entry points for the next one.
+     */
+    void restart(candidates_t& pool) noexcept {
+        visited_.clear();
+        for (std::size_t i = 0; i != pool.size() && !*error_; ++i) {
+            pool[i].expanded = false;
+            visited_.insert(pool[i].key, arena_, error_);
+        }
+    }
+
+    /**
+     * @brief Beam search within a single layer, always expanding the
+     * closest candidate, until all the candidates in the pool are expanded.
+     * @param allowed Optional pool, collecting every visited candidate, that passes the `filter`.
+     */
+    void search_layer(code_t const* query,
+                      std::size_t layer,
+                      candidates_t& pool,
+                      keys_filter_t const& filter = {},
+                      candidates_t* allowed = nullptr) noexcept {
+        node_ref_t node {expanded_node_.begin(), header_.max_neighbors};
+        while (!*error_) {
+            std::size_t idx = 0;
+            while (idx != pool.size() && pool[idx].expanded)
+                ++idx;
+            if (idx == pool.size())
+                break;
+
+            pool[idx].expanded = true;
+            if (!read_node(pool[idx].key, node) || node.levels() <= layer)
+                continue;
+
+            std::size_t fresh_count = 0;
+            for (ustore_key_t neighbor : node.neighbors(layer)) {
+                if (visited_.insert(neighbor, arena_, error_))
+                    batch_keys_[fresh_count++] = neighbor;
+                return_if_error_m(error_);
+            }
+            if (!fresh_count)
+                continue;
+
+            read_vectors(batch_keys_.begin(), fresh_count, [&](std::size_t i, code_t const* vector) noexcept {
+                if (!vector)
+                    return;
+                candidate_t candidate {batch_keys_[i], quantizer_.closeness(query, vector, metric()), false};
+                pool.push(candidate);
+                if (allowed && filter.allows(candidate.key))
+                    allowed->push(candidate);
+            });
+        }
+    }
+
+    /**
+     * @brief Keeps only the closest neighbors of an overflowing node.
+     */
+    void prune(ustore_key_t key, node_ref_t node, std::size_t layer, ustore_key_t extra) noexcept {
+        auto neighbors = node.neighbors(layer);
+        std::size_t count = 0;
+        pruned_keys_[count++] = key;
+        for (ustore_key_t neighbor : neighbors)
+            pruned_keys_[count++] = neighbor;
+        pruned_keys_[count++] = extra;
+
+        auto capacity = neighbors.size();
+        candidates_t pool {pruned_candidates_.begin(), pruned_candidates_.begin() + capacity};
+        code_t const* center = nullptr;
+        read_vectors(pruned_keys_.begin(), count, [&](std::size_t i, code_t const* vector) noexcept {
+            if (!i)
+                center = vector;
+            else if (center && vector)
+                pool.push({pruned_keys_[i], quantizer_.closeness(center, vector, metric()), false});
+        });
+        if (*error_ || !center)
+            return;
+
+        for (std::size_t i = 0; i != pool.size(); ++i)
+            pruned_keys_[i] = pool[i].key;
+        node.assign(layer, pruned_keys_.begin(), pool.size());
+    }
+
+    /**
+     * @brief Adds back-links from the chosen neighbors to the new node.
+     */
+    void link(ustore_key_t key, std::size_t layer, ustore_key_t const* neighbors, std::size_t count) noexcept {
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        read_blobs(index_collection_, neighbors, count, offsets, lengths, values);
+        return_if_error_m(error_);
+
+        // Copy the nodes out of the temporary memory, before it's reused for pruning
+        std::size_t stride = node_stride();
+        std::size_t max_length = stride * sizeof(ustore_key_t);
+        for (std::size_t i = 0; i != count; ++i) {
+            ustore_key_t* slots = linked_nodes_.begin() + i * stride;
+            node_ref_t node {slots, header_.max_neighbors};
+            bool valid = lengths[i] != ustore_length_missing_k && lengths[i] >= sizeof(ustore_key_t);
+            if (valid)
+                std::memcpy(slots, values + offsets[i], std::min<std::size_t>(lengths[i], max_length));
+            valid = valid && node.levels() > layer && node.levels() <= max_levels_k &&
+                    node.size_bytes() == lengths[i];
+            linked_offsets_[i] = static_cast<ustore_length_t>(i * max_length);
+            linked_lengths_[i] = valid ? static_cast<ustore_length_t>(node.size_bytes()) : ustore_length_missing_k;
+        }
+
+        for (std::size_t i = 0; i != count && !*error_; ++i) {
+            if (linked_lengths_[i] == ustore_length_missing_k)
+                continue;
+            node_ref_t node {linked_nodes_.begin() + i * stride, header_.max_neighbors};
+            auto existing = node.neighbors(layer);
+            if (std::find(existing.begin(), existing.end(), key) != existing.end())
+                continue;
+            if (!node.append(layer, key))
+                prune(neighbors[i], node, layer, key);
+        }
+        return_if_error_m(error_);
+
+        // Skip the invalid nodes, compacting the batch
+        std::size_t valid_count = 0;
+        for (std::size_t i = 0; i != count; ++i) {
+            if (linked_lengths_[i] == ustore_length_missing_k)
+                continue;
+            batch_keys_[valid_count] = neighbors[i];
+            linked_offsets_[valid_count] = linked_offsets_[i];
+            linked_lengths_[valid_count] = linked_lengths_[i];
+            ++valid_count;
+        }
+        if (!valid_count)
+            return;
+
+        auto values_begin = reinterpret_cast<ustore_bytes_cptr_t>(linked_nodes_.begin());
+        write_blobs(index_collection_,
+                    batch_keys_.begin(),
+                    valid_count,
+                    values_begin,
+                    linked_offsets_.begin(),
+                    linked_lengths_.begin());
+    }
+
+  public:
+    index_t(ustore_database_t db,
+            ustore_transaction_t transaction,
+            ustore_options_t options,
+            linked_memory_lock_t& arena,
+            ustore_error_t* error) noexcept
+        : db_(db), transaction_(transaction), options_(options), arena_(arena), error_(error), scratch_(db) {}
+
+    std::size_t dimensions() const noexcept { return header_.dimensions; }
+    std::size_t max_neighbors() const noexcept { return header_.max_neighbors; }
+    ustore_vector_metric_t metric() const noexcept { return static_cast<ustore_vector_metric_t>(header_.metric); }
+
+    /**
+     * @brief Codec of the vectors in the collection. Defaults to `ustore_vector_quantization_i8_k`,
+     * if the collection has no index.
+     */
+    quantizer_t& quantizer() noexcept { return quantizer_; }
+
+    /**
+     * @brief Checks if the quantizer must be trained on the first vectors, before they are encoded.
+     */
+    bool needs_training() const noexcept {
+        return header_.quantization == ustore_vector_quantization_pq4_k && !trained_;
+    }
+
+    /**
+     * @brief Keeps encoding the vectors with `ustore_vector_quantization_i8_k`, until the quantizer
+     * can be trained. The header isn't persisted meanwhile, so the collection is searched exhaustively.
+     */
+    void defer_training() noexcept {
+        quantizer_.init(ustore_vector_quantization_i8_k, header_.dimensions, nullptr, arena_, error_);
+    }
+
+    /**
+     * @brief Fits the quantizer to a sample of vectors.
+     * @param samples Row-major matrix, padded to a multiple of `pq_subspace_dims_k` dimensions.
+     */
+    void train(real_t const* samples, std::size_t count) noexcept {
+        if (!count)
+            return;
+        quantizer_t::train(samples, count, header_.dimensions, codebooks_.begin());
+        quantizer_.retabulate();
+        header_changed_ = true;
+        trained_ = true;
+    }
+
+    /**
+     * @brief Locates the index of a collection and fetches its header.
+     * @param create Whether to initialize a new index, if none exists.
+     * @return true If the index is ready for traversal and updates.
+     */
+    bool open(ustore_collection_t collection,
+              bool create,
+              ustore_length_t dimensions,
+              ustore_vector_metric_t metric,
+              ustore_vector_quantization_t quantization,
+              ustore_length_t max_neighbors,
+              std::size_t ef) noexcept {
+
+        flush();
+        if (*error_)
+            return false;
+
+        vectors_collection_ = collection;
+        header_ = {};
+        quantizer_.init(ustore_vector_quantization_i8_k, dimensions, nullptr, arena_, error_);
+        if (!ustore_supports_named_collections_k || !find_companion(create))
+            return false;
+
+        ustore_key_t header_key = ustore_key_unknown_k;
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        read_blobs(index_collection_, &header_key, 1, offsets, lengths, values);
+        if (*error_)
+            return false;
+
+        // The header is followed by the trained state of the quantizer, if any
+        bool exists = lengths[0] != ustore_length_missing_k && lengths[0] >= sizeof(index_header_t);
+        if (exists) {
+            std::memcpy(&header_, values + offsets[0], sizeof(index_header_t));
+            auto codebooks_size = quantizer_t::codebooks_size( //
+                static_cast<ustore_vector_quantization_t>(header_.quantization),
+                header_.dimensions);
+            bool valid = header_.magic == index_magic_k && header_.max_neighbors && header_.max_level < max_levels_k &&
+                         quantizer_t::is_known(header_.quantization) &&
+                         lengths[0] == sizeof(index_header_t) + codebooks_size * sizeof(real_t);
+            log_error_if_m(valid, error_, error_unknown_k, "Corrupted vectors index header");
+            if (!valid)
+                return false;
+        }
+        else if (!create || lengths[0] != ustore_length_missing_k)
+            return false;
+        else {
+            header_.dimensions = dimensions;
+            header_.metric = metric;
+            header_.quantization = quantization;
+            header_.max_neighbors = max_neighbors;
+            header_.entry_key = ustore_key_unknown_k;
+        }
+
+        quantization = static_cast<ustore_vector_quantization_t>(header_.quantization);
+        codebooks_ = arena_.alloc<real_t>(quantizer_t::codebooks_size(quantization, header_.dimensions), error_);
+        if (*error_)
+            return false;
+        trained_ = exists;
+        if (exists)
+            std::memcpy(codebooks_.begin(), values + offsets[0] + sizeof(index_header_t), codebooks_.size_bytes());
+        else
+            std::fill(codebooks_.begin(), codebooks_.end(), real_t(0));
+        quantizer_.init(quantization, header_.dimensions, codebooks_.begin(), arena_, error_);
+
+        reserve_buffers(header_.max_neighbors, ef);
+        return !*error_;
+    }
+
+    /**
+     * @brief Persists the updated header, if any nodes were added.
+     */
+    void flush() noexcept {
+        if (!header_changed_)
+            return;
+        header_changed_ = false;
+        auto blob = arena_.alloc<byte_t>(sizeof(index_header_t) + codebooks_.size_bytes(), error_);
+        return_if_error_m(error_);
+        std::memcpy(blob.begin(), &header_, sizeof(index_header_t));
+        std::memcpy(blob.begin() + sizeof(index_header_t), codebooks_.begin(), codebooks_.size_bytes());
+
+        ustore_key_t header_key = ustore_key_unknown_k;
+        ustore_length_t offset = 0;
+        ustore_length_t length = static_cast<ustore_length_t>(blob.size());
+        auto blob_begin = reinterpret_cast<ustore_bytes_cptr_t>(blob.begin());
+        write_blobs(index_collection_, &header_key, 1, blob_begin, &offset, &length);
+    }
+
+    /**
+     * @brief Finds at most `ef` closest entries to the `query`.
+     * With a `filter`, the whole graph remains traversable, but only the allowed entries are returned.
+     * @return Candidates sorted by decreasing closeness.
+     */
+    candidates_t search(code_t const* query, std::size_t ef, keys_filter_t const& filter = {}) noexcept {
+        candidates_t pool = candidates(1);
+        if (header_.entry_key == ustore_key_unknown_k)
+            return pool;
+
+        start(query, pool);
+        for (std::size_t layer = header_.max_level; layer != 0 && !*error_; --layer) {
+            restart(pool);
+            search_layer(query, layer, pool);
+        }
+
+        pool = candidates(ef, pool.size());
+        restart(pool);
+        if (!filter) {
+            search_layer(query, 0, pool);
+            return pool;
+        }
+
+        candidates_t allowed {allowed_candidates_.begin(), allowed_candidates_.begin() + std::min(ef, pool.capacity())};
+        for (std::size_t i = 0; i != pool.size(); ++i)
+            if (filter.allows(pool[i].key))
+                allowed.push(pool[i]);
+        search_layer(query, 0, pool, filter, &allowed);
+        return allowed;
+    }
+
+    /**
+     * @brief Links a vector, that is already written into the collection, into the graph.
+     * Re-inserted keys keep their layers, but get a fresh set of neighbors.
+     */
+    void insert(ustore_key_t key, code_t const* vector, std::size_t ef_construction) noexcept {
+        std::size_t const max_neighbors = header_.max_neighbors;
+        node_ref_t node {inserted_node_.begin(), max_neighbors};
+        bool exists = read_node(key, node);
+        return_if_error_m(error_);
+
+        std::size_t levels = exists ? node.levels() : random_level(key, max_neighbors) + 1u;
+        std::size_t top_layer = levels - 1u;
+        node.reset(levels);
+
+        bool is_first = header_.entry_key == ustore_key_unknown_k;
+        if (!is_first) {
+            candidates_t pool = candidates(1);
+            start(vector, pool);
+            for (std::size_t layer = header_.max_level; layer > top_layer && !*error_; --layer) {
+                restart(pool);
+                search_layer(vector, layer, pool);
+            }
+
+            pool = candidates(ef_construction, pool.size());
+            for (std::size_t layer = std::min<std::size_t>(top_layer, header_.max_level) + 1u; layer-- != 0;) {
+                restart(pool);
+                search_layer(vector, layer, pool);
+                return_if_error_m(error_);
+
+                // Choose the closest existing candidates as neighbors
+                std::size_t capacity = node_ref_t::capacity(max_neighbors, layer);
+                std::size_t count = 0;
+                for (std::size_t i = 0; i != pool.size() && count != capacity; ++i)
+                    if (pool[i].key != key && pool[i].closeness != missing_closeness_k)
+                        batch_keys_[count++] = pool[i].key;
+
+                node.assign(layer, batch_keys_.begin(), count);
+                link(key, layer, node.neighbors(layer).begin(), count);
+                return_if_error_m(error_);
+            }
+        }
+
+        write_node(key, node);
+        return_if_error_m(error_);
+
+        if (is_first || top_layer > header_.max_level) {
+            header_.entry_key = key;
+            header_.max_level = static_cast<std::uint32_t>(top_layer);
+            header_changed_ = true;
+        }
+        if (!exists) {
+            ++header_.count;
+            header_changed_ = true;
+        }
+    }
+};
+
+/*********************************************************/
+/*****************	  Exhaustive Search	  ****************/
+/*********************************************************/
+
+static constexpr std::size_t scan_page_k = 1024;
+static constexpr std::size_t scan_tile_k = 64;
+
+/**
+ * @brief Quantized vectors fetched from the collection in a single pass.
+ * Norms are only computed for metrics, that need them.
+ * @see `quantizer_t::needs_norms()`.
+ */
+struct scan_page_t {
+    code_t const** vectors;
+    ustore_key_t* keys;
+    real_t* norms;
+    std::size_t count;
+};
+
+/**
+ * @brief Group of queries, that target the same collection.
+ * Each query has its own priority queue, so threads processing
+ * disjoint subsets of queries never synchronize.
+ */
+struct scan_queries_t {
+    code_t const* vectors;
+    std::size_t stride;
+    real_t const* norms;
+    pq_t* matches;
+    std::size_t count;
+};
+
+/**
+ * @brief Compares a page of vectors to a group of queries.
+ * Vectors are visited in tiles, small enough to stay in cache, while being compared to every query.
+ * Norms are reused across queries, so mostly a single dot product is computed for every pair.
+ */
+void compare_page(quantizer_t const& quantizer,
+                  scan_page_t const& page,
+                  scan_queries_t const& queries,
+                  ustore_vector_metric_t kind,
+                  real_t threshold) noexcept {
+
+    bool needs_norms = quantizer.needs_norms(kind);
+    for (std::size_t tile_begin = 0; tile_begin < page.count; tile_begin += scan_tile_k) {
+        std::size_t tile_end = std::min(tile_begin + scan_tile_k, page.count);
+        for (std::size_t i = 0; i != queries.count; ++i) {
+            code_t const* query = queries.vectors + i * queries.stride;
+            real_t query_norm = needs_norms ? queries.norms[i] : real_t(0);
+            pq_t& matches = queries.matches[i];
+            for (std::size_t j = tile_begin; j != tile_end; ++j) {
+                real_t vector_norm = needs_norms ? page.norms[j] : real_t(0);
+                real_t result = quantizer.metric(query, page.vectors[j], query_norm, vector_norm, kind);
+                if (result < threshold)
+                    continue;
+                matches.push({page.keys[j], oriented_metric(result, kind)});
+            }
+        }
+    }
+}
+
+/**
+ * @brief Evaluates a group of queries in a single pass over the collection.
+ * The quantized vectors are fetched in pages and every page is compared to all
+ * the queries, optionally splitting the queries between several threads.
+ * With a `filter`, only the allowed vectors are fetched, instead of scanning the whole collection.
+ */
+void scan_group(ustore_database_t db,
+                ustore_transaction_t transaction,
+                ustore_collection_t collection,
+                ustore_options_t options,
+                quantizer_t const& quantizer,
+                scan_queries_t const& queries,
+                ustore_vector_metric_t kind,
+                real_t threshold,
+                keys_filter_t const& filter,
+                std::size_t threads_count,
+                linked_memory_lock_t& arena,
+                ustore_error_t* c_error) noexcept {
+
+    bool needs_norms = quantizer.needs_norms(kind);
+    auto page_vectors = arena.alloc<code_t const*>(scan_page_k, c_error);
+    return_if_error_m(c_error);
+    auto page_keys = arena.alloc<ustore_key_t>(scan_page_k, c_error);
+    return_if_error_m(c_error);
+    auto page_norms = arena.alloc<real_t>(needs_norms ? scan_page_k : 0, c_error);
+    return_if_error_m(c_error);
+
+    scan_page_t page {page_vectors.begin(), page_keys.begin(), page_norms.begin(), 0};
+    threads_count = std::max<std::size_t>(std::min(threads_count, queries.count), 1);
+    auto compare_slice = [&](std::size_t thread_idx) noexcept {
+        std::size_t begin = queries.count * thread_idx / threads_count;
+        std::size_t end = queries.count * (thread_idx + 1) / threads_count;
+        scan_queries_t slice = queries;
+        slice.vectors += begin * queries.stride;
+        slice.norms += needs_norms ? begin : 0;
+        slice.matches += begin;
+        slice.count = end - begin;
+        compare_page(quantizer, page, slice, kind, threshold);
+    };
+
+    auto flush = [&]() noexcept {
+        if (threads_count == 1) {
+            compare_slice(0);
+            page.count = 0;
+            return;
+        }
+
+        // If threads can't be spawned, the remaining slices are processed in the calling thread
+        std::vector<std::thread> threads;
+        std::size_t spawned = 1;
+        try {
+            threads.reserve(threads_count - 1);
+            for (; spawned != threads_count; ++spawned)
+                threads.emplace_back(compare_slice, spawned);
+        }
+        catch (...) {
+        }
+        for (std::size_t thread_idx = spawned; thread_idx != threads_count; ++thread_idx)
+            compare_slice(thread_idx);
+        compare_slice(0);
+        for (auto& thread : threads)
+            thread.join();
+        page.count = 0;
+    };
+
+    auto code_size = quantizer.code_size();
+    auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
+        if (key >= 0)
+            return false;
+        if (vector.size() != code_size)
+            return true;
+        auto code = (code_t const*)vector.data();
+        page.vectors[page.count] = code;
+        page.keys[page.count] = key;
+        if (needs_norms)
+            page.norms[page.count] = quantizer.norm(code);
+        if (++page.count == scan_page_k)
+            flush();
+        return true;
+    };
+
+    if (!filter) {
+        auto min_key = std::numeric_limits<ustore_key_t>::min();
+        full_scan_collection(db, transaction, collection, options, min_key, scan_page_k, arena, c_error, callback);
+    }
+    else {
+        auto quantized_keys = arena.alloc<ustore_key_t>(scan_page_k, c_error);
+        return_if_error_m(c_error);
+        for (std::size_t begin = 0; begin < filter.count && !*c_error; begin += scan_page_k) {
+            std::size_t count = std::min(scan_page_k, filter.count - begin);
+            for (std::size_t i = 0; i != count; ++i)
+                quantized_keys[i] = -filter.keys[begin + i];
+
+            ustore_length_t* offsets {};
+            ustore_length_t* lengths {};
+            ustore_byte_t* values {};
+            ustore_read_t read {};
+            read.db = db;
+            read.error = c_error;
+            read.transaction = transaction;
+            read.arena = arena;
+            read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
+            read.tasks_count = count;
+            read.collections = &collection;
+            read.collections_stride = 0;
+            read.keys = quantized_keys.begin();
+            read.keys_stride = sizeof(ustore_key_t);
+            read.offsets = &offsets;
+            read.lengths = &lengths;
+            read.values = &values;
+            ustore_read(&read);
+            if (*c_error)
+                break;
+
+            // Pages are compared before the next read, that reuses the keys buffer
+            for (std::size_t i = 0; i != count; ++i)
+                if (lengths[i] != ustore_length_missing_k)
+                    callback(quantized_keys[i], value_view_t {values + offsets[i], lengths[i]});
+            if (page.count)
+                flush();
+        }
+    }
+    if (page.count && !*c_error)
+        flush();
+}
+
+/*********************************************************/
+/*****************	      Re-ranking	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Computes the metric between original vectors, skipping quantization.
+ * Integer originals are compared as they are, in the same units, as `convert()`
+ * gives them. Unlike the `i8_k` codes, they carry no fixed scale, so the results
+ * match the ones of `f32` vectors with the same components.
+ */
+real_t exact_metric(ustore_bytes_cptr_t a,
+                    ustore_bytes_cptr_t b,
+                    std::size_t dims,
+                    ustore_vector_scalar_t scalar_type,
+                    ustore_vector_metric_t kind) noexcept {
+
+    auto compute = [&](auto dot, auto dot_and_norms, auto l2_squared, auto const* a, auto const* b) noexcept {
+        switch (kind) {
+        case ustore_vector_metric_dot_k: return real_t(dot(a, b, dims));
+        case ustore_vector_metric_cos_k: {
+            auto parts = dot_and_norms(a, b, dims);
+            return real_t(parts.ab) / (std::sqrt(real_t(parts.aa)) * std::sqrt(real_t(parts.bb)));
+        }
+        case ustore_vector_metric_l2_k: return std::sqrt(real_t(l2_squared(a, b, dims)));
+        default: return real_t(0);
+        }
+    };
+
+    distance_kernels_t const& kernels = distance_kernels();
+    auto narrow = [](double x) noexcept {
+        return static_cast<float>(x);
+    };
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k:
+        return compute(kernels.f32_dot,
+                       kernels.f32_dot_and_norms,
+                       kernels.f32_l2_squared,
+                       (float const*)a,
+                       (float const*)b);
+    case ustore_vector_scalar_f16_k:
+        return compute(kernels.f16_dot,
+                       kernels.f16_dot_and_norms,
+                       kernels.f16_l2_squared,
+                       (f16_bits_t const*)a,
+                       (f16_bits_t const*)b);
+    case ustore_vector_scalar_i8_k:
+        return compute(kernels.i8_dot,
+                       kernels.i8_dot_and_norms,
+                       kernels.i8_l2_squared,
+                       (quant_t const*)a,
+                       (quant_t const*)b);
+    case ustore_vector_scalar_f64_k:
+        return compute([&](double const* a, double const* b, std::size_t n) { return dot_serial(a, b, n, narrow); },
+                       [&](double const* a, double const* b, std::size_t n) {
+                           return dot_and_norms_serial(a, b, n, narrow);
+                       },
+                       [&](double const* a, double const* b, std::size_t n) {
+                           return l2_squared_serial(a, b, n, narrow);
+                       },
+                       (double const*)a,
+                       (double const*)b);
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Recomputes the metrics of quantized candidates using the original vectors,
+ * fetched with a single batched read, and keeps only the best `count_limits` of every task.
+ * Candidates with originals of unexpected size keep their approximate metric.
+ */
+void rerank(ustore_vectors_search_t const& c,
+            vectors_arg_t const& queries_args,
+            strided_iterator_gt<ustore_collection_t const> collections,
+            strided_range_gt<ustore_length_t const> count_limits,
+            ptr_range_gt<pq_t> tasks_matches,
+            linked_memory_lock_t& arena) noexcept {
+
+    auto total_candidates = transform_reduce_n(tasks_matches.begin(), c.tasks_count, 0ul, [](pq_t const& pq) {
+        return pq.size();
+    });
+    auto candidates_collections = arena.alloc<ustore_collection_t>(total_candidates, c.error);
+    return_if_error_m(c.error);
+    auto candidates_keys = arena.alloc<ustore_key_t>(total_candidates, c.error);
+    return_if_error_m(c.error);
+
+    for (std::size_t i = 0, candidate_idx = 0; i != c.tasks_count; ++i)
+        for (match_t const& match : tasks_matches[i])
+            candidates_collections[candidate_idx] = collections ? collections[i] : ustore_collection_main_k,
+            candidates_keys[candidate_idx] = std::abs(match.key), ++candidate_idx;
+
+    ustore_length_t* offsets = nullptr;
+    ustore_length_t* lengths = nullptr;
+    ustore_byte_t* values = nullptr;
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c.error;
+    read.transaction = c.transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = total_candidates;
+    read.collections = candidates_collections.begin();
+    read.collections_stride = sizeof(ustore_collection_t);
+    read.keys = candidates_keys.begin();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &offsets;
+    read.lengths = &lengths;
+    read.values = &values;
+    ustore_read(&read);
+    return_if_error_m(c.error);
+
+    auto vector_size = c.dimensions * size_bytes(c.scalar_type);
+    for (std::size_t i = 0, candidate_idx = 0; i != c.tasks_count; ++i) {
+        pq_t& pq = tasks_matches[i];
+        match_t* matches_begin = pq.data();
+        match_t* matches_end = matches_begin;
+        auto query = (ustore_bytes_cptr_t)queries_args[i].begin();
+        for (match_t const& match : pq) {
+            ustore_length_t length = lengths[candidate_idx];
+            ustore_bytes_cptr_t original = values + offsets[candidate_idx];
+            ++candidate_idx;
+
+            // Missing originals belong to entries removed since the quantized scan
+            if (length == ustore_length_missing_k)
+                continue;
+            match_t reranked = match;
+            if (length == vector_size) {
+                real_t exact = exact_metric(query, original, c.dimensions, c.scalar_type, c.metric);
+                if (exact < c.metric_threshold)
+                    continue;
+                reranked.metric = oriented_metric(exact, c.metric);
+            }
+            *matches_end++ = reranked;
+        }
+
+        std::sort(matches_begin, matches_end, [](match_t const& a, match_t const& b) noexcept {
+            return a.metric > b.metric;
+        });
+        auto count = std::min<std::size_t>(matches_end - matches_begin, count_limits[i]);
+        pq.clear();
+        new (&pq) pq_t {matches_begin, matches_begin + count_limits[i], count};
+    }
+}
+
+/*********************************************************/
+/*****************	      Disk Index	  ****************/
+/*********************************************************/
+
+static constexpr std::uint32_t disk_index_magic_k = 0x414d4156; // "VAMA"
+static constexpr std::size_t disk_page_k = 4096;
+static constexpr std::size_t disk_scan_page_k = 4096;
+static constexpr ustore_length_t default_disk_max_neighbors_k = 64;
+static constexpr ustore_length_t default_disk_ef_construction_k = 100;
+static constexpr ustore_float_t default_disk_alpha_k = 1.2f;
+static constexpr ustore_length_t default_beam_width_k = 4;
+
+using node_id_t = std::uint32_t;
+
+/**
+ * @brief Leading page of a disk-resident index file.
+ * @see The layout description in the beginning of this file.
+ */
+struct disk_index_header_t {
+    std::uint32_t magic = disk_index_magic_k;
+    std::uint32_t dimensions = 0;
+    std::uint32_t metric = ustore_vector_metric_cos_k;
+    std::uint32_t quantization = ustore_vector_quantization_i8_k;
+    std::uint32_t max_neighbors = 0;
+    std::uint32_t node_size = 0;
+    std::uint32_t nodes_per_page = 0;
+    std::uint32_t page_size = 0;
+    std::uint64_t count = 0;
+    std::uint64_t medoid = 0;
+    std::uint64_t keys_offset = 0;
+    std::uint64_t codebooks_offset = 0;
+    std::uint64_t codes_offset = 0;
+    std::uint64_t nodes_offset = 0;
+
+    disk_index_header_t() = default;
+    disk_index_header_t(std::size_t dims,
+                        ustore_vector_metric_t kind,
+                        ustore_vector_quantization_t scheme,
+                        std::size_t neighbors,
+                        std::size_t nodes_count) noexcept
+        : dimensions(static_cast<std::uint32_t>(dims)), metric(kind), quantization(scheme),
+          max_neighbors(static_cast<std::uint32_t>(neighbors)), count(nodes_count) {
+        node_size = static_cast<std::uint32_t>(dims * sizeof(real_t) + (1u + neighbors) * sizeof(node_id_t));
+        page_size = static_cast<std::uint32_t>(divide_round_up<std::size_t>(node_size, disk_page_k) * disk_page_k);
+        nodes_per_page = page_size / node_size;
+        keys_offset = disk_page_k;
+        codebooks_offset = keys_offset + count * sizeof(ustore_key_t);
+        codes_offset = codebooks_offset + codebooks_size() * sizeof(real_t);
+        nodes_offset = divide_round_up<std::uint64_t>(codes_offset + count * code_size(), disk_page_k) * disk_page_k;
+    }
+
+    ustore_vector_quantization_t scheme() const noexcept {
+        return static_cast<ustore_vector_quantization_t>(quantization);
+    }
+    std::size_t code_size() const noexcept { return quantizer_t::code_size(scheme(), dimensions); }
+    std::size_t codebooks_size() const noexcept { return quantizer_t::codebooks_size(scheme(), dimensions); }
+    std::uint64_t pages_count() const noexcept { return divide_round_up<std::uint64_t>(count, nodes_per_page); }
+    std::uint64_t file_size() const noexcept { return nodes_offset + pages_count() * page_size; }
+
+    std::uint64_t page_offset(node_id_t id) const noexcept {
+        return nodes_offset + std::uint64_t(id / nodes_per_page) * page_size;
+    }
+    std::size_t offset_in_page(node_id_t id) const noexcept { return std::size_t(id % nodes_per_page) * node_size; }
+};
+
+static_assert(sizeof(disk_index_header_t) <= disk_page_k, "The header must fit into the first page");
+
+/**
+ * @brief Non-owning view of a node record within a page of the index file.
+ * The full-precision vector is followed by the number of neighbors and a fixed-capacity list of them.
+ */
+struct disk_node_ref_t {
+    byte_t const* begin = nullptr;
+    std::size_t dims = 0;
+    std::size_t max_neighbors = 0;
+
+    real_t const* vector() const noexcept { return reinterpret_cast<real_t const*>(begin); }
+    ptr_range_gt<node_id_t const> neighbors() const noexcept {
+        auto slots = reinterpret_cast<node_id_t const*>(begin + dims * sizeof(real_t));
+        return {slots + 1, std::min<std::size_t>(slots[0], max_neighbors)};
+    }
+};
+
+/**
+ * @brief Vamana graph over full-precision vectors, built in memory before being exported to disk.
+ *
+ * As in DiskANN, the graph starts with random edges and every node is re-inserted twice:
+ * first keeping only the strictly non-redundant neighbors, then relaxing the pruning by `alpha`.
+ * Nodes are inserted from several threads, each node guarded by a one-byte spin-lock.
+ *
+ * Neighbors are pruned with the L2 distance for the dot-product metric,
+ * as the pruning rule needs a non-negative distance.
  */
-#include <cmath> // `std::sqrt`
+class vamana_t {
+    real_t const* vectors_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t dims_ = 0;
+    std::size_t max_neighbors_ = 0;
+    ustore_vector_metric_t metric_ = ustore_vector_metric_cos_k;
+    node_id_t* adjacency_ = nullptr;
+    std::atomic<bool>* locks_ = nullptr;
+    node_id_t medoid_ = 0;
 
-#include "ustore/vectors.h"
-#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+    node_id_t* slots(node_id_t id) const noexcept { return adjacency_ + std::size_t(id) * (1u + max_neighbors_); }
 
-#include "helpers/linked_memory.hpp"          // `linked_memory_lock_t`
-#include "helpers/algorithm.hpp"              // `transform_n`
-#include "helpers/full_scan.hpp"              // `full_scan_collection`
-#include "helpers/limited_priority_queue.hpp" // `limited_priority_queue_gt`
+    void lock(node_id_t id) const noexcept {
+        while (locks_[id].exchange(true, std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    void unlock(node_id_t id) const noexcept { locks_[id].store(false, std::memory_order_release); }
 
-/*********************************************************/
-/*****************	 C++ Implementation	  ****************/
-/*********************************************************/
+    std::size_t copy_neighbors(node_id_t id, node_id_t* neighbors) const noexcept {
+        lock(id);
+        node_id_t const* begin = slots(id);
+        std::size_t degree = begin[0];
+        std::copy_n(begin + 1, degree, neighbors);
+        unlock(id);
+        return degree;
+    }
 
-using namespace unum::ustore;
-using namespace unum;
+  public:
+    /**
+     * @brief Per-thread buffers of the construction.
+     */
+    struct workspace_t {
+        ptr_range_gt<candidate_t> pool;
+        ptr_range_gt<candidate_t> pruned;
+        ptr_range_gt<node_id_t> neighbors;
+        ptr_range_gt<node_id_t> selected;
+        ptr_range_gt<std::uint32_t> visited;
+        std::uint32_t epoch = 0;
+    };
 
-using real_t = float;
-using quant_t = std::int8_t;
-using quant_product_t = std::int16_t;
+    real_t distance(real_t const* a, node_id_t b) const noexcept {
+        auto a_bytes = reinterpret_cast<ustore_bytes_cptr_t>(a);
+        auto b_bytes = reinterpret_cast<ustore_bytes_cptr_t>(vector(b));
+        if (metric_ != ustore_vector_metric_cos_k)
+            return exact_metric(a_bytes, b_bytes, dims_, ustore_vector_scalar_f32_k, ustore_vector_metric_l2_k);
+        real_t similarity = exact_metric(a_bytes, b_bytes, dims_, ustore_vector_scalar_f32_k, metric_);
+        return std::isnan(similarity) ? real_t(2) : real_t(1) - similarity;
+    }
 
-struct match_t {
-    ustore_key_t key;
-    ustore_float_t metric;
-};
+    real_t const* vector(node_id_t id) const noexcept { return vectors_ + std::size_t(id) * dims_; }
+    ptr_range_gt<node_id_t const> neighbors(node_id_t id) const noexcept { return {slots(id) + 1, slots(id)[0]}; }
+    node_id_t medoid() const noexcept { return medoid_; }
 
-struct lower_similarity_t {
-    bool operator()(match_t const& a, match_t const& b) const noexcept { return a.metric < b.metric; }
-};
+    void init(real_t const* vectors,
+              std::size_t count,
+              std::size_t dims,
+              std::size_t max_neighbors,
+              ustore_vector_metric_t metric,
+              linked_memory_lock_t& arena,
+              ustore_error_t* c_error) noexcept {
+        vectors_ = vectors, count_ = count, dims_ = dims, max_neighbors_ = max_neighbors, metric_ = metric;
+        adjacency_ = arena.alloc<node_id_t>(count * (1u + max_neighbors), c_error).begin();
+        return_if_error_m(c_error);
+        locks_ = arena.alloc<std::atomic<bool>>(count, c_error).begin();
+        return_if_error_m(c_error);
+        for (std::size_t i = 0; i != count; ++i)
+            new (locks_ + i) std::atomic<bool>(false);
 
-using pq_t = limited_priority_queue_gt<match_t, lower_similarity_t>;
+        // Random edges, seeded with the node identifiers, make the graph navigable from the start
+        std::size_t degree = std::min(max_neighbors, count - 1u);
+        for (std::size_t i = 0; i != count; ++i) {
+            node_id_t* begin = slots(static_cast<node_id_t>(i));
+            begin[0] = 0;
+            for (std::size_t attempt = 0; begin[0] != degree && attempt != degree * 4u; ++attempt) {
+                auto shift = hash_key(static_cast<ustore_key_t>(i * max_neighbors + attempt)) % (count - 1u);
+                auto neighbor = static_cast<node_id_t>((i + 1u + shift) % count);
+                if (std::find(begin + 1, begin + 1 + begin[0], neighbor) == begin + 1 + begin[0])
+                    begin[1 + begin[0]++] = neighbor;
+            }
+        }
 
-static constexpr quant_t float_scaling_k = 100;
-static constexpr quant_product_t product_scaling_k = float_scaling_k * float_scaling_k;
+        // The entry point is the closest vector to the centroid
+        auto centroid = arena.alloc<real_t>(dims, c_error);
+        return_if_error_m(c_error);
+        std::fill(centroid.begin(), centroid.end(), real_t(0));
+        for (std::size_t i = 0; i != count; ++i)
+            for (std::size_t j = 0; j != dims; ++j)
+                centroid[j] += vectors[i * dims + j] / real_t(count);
+        real_t closest_distance = std::numeric_limits<real_t>::max();
+        for (std::size_t i = 0; i != count; ++i)
+            if (real_t d = distance(centroid.begin(), static_cast<node_id_t>(i)); d < closest_distance)
+                closest_distance = d, medoid_ = static_cast<node_id_t>(i);
+    }
 
-template <typename number_at>
-number_at square(number_at n) noexcept {
-    return n * n;
-}
+    void reserve(workspace_t& workspace, std::size_t ef, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+        workspace.pool = arena.alloc<candidate_t>(ef, c_error);
+        return_if_error_m(c_error);
+        workspace.pruned = arena.alloc<candidate_t>(ef + max_neighbors_ + 1u, c_error);
+        return_if_error_m(c_error);
+        workspace.neighbors = arena.alloc<node_id_t>(max_neighbors_, c_error);
+        return_if_error_m(c_error);
+        workspace.selected = arena.alloc<node_id_t>(max_neighbors_, c_error);
+        return_if_error_m(c_error);
+        workspace.visited = arena.alloc<std::uint32_t>(count_, c_error);
+        return_if_error_m(c_error);
+        std::fill(workspace.visited.begin(), workspace.visited.end(), std::uint32_t(0));
+    }
 
-struct metric_dot_t {
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
-        std::int64_t sum = 0;
-        for (std::size_t i = 0; i != dims; ++i) {
-            quant_product_t ai = a[i];
-            quant_product_t bi = b[i];
-            sum += ai * bi;
+    /**
+     * @brief Greedy beam search from the medoid, ranking the candidates by negated distance.
+     */
+    candidates_t search(real_t const* query, workspace_t& workspace) const noexcept {
+        if (++workspace.epoch == 0) {
+            std::fill(workspace.visited.begin(), workspace.visited.end(), std::uint32_t(0));
+            workspace.epoch = 1;
+        }
+
+        candidates_t pool {workspace.pool.begin(), workspace.pool.end()};
+        workspace.visited[medoid_] = workspace.epoch;
+        pool.push({medoid_, -distance(query, medoid_), false});
+        while (true) {
+            std::size_t idx = 0;
+            while (idx != pool.size() && pool[idx].expanded)
+                ++idx;
+            if (idx == pool.size())
+                break;
+
+            pool[idx].expanded = true;
+            auto expanded = static_cast<node_id_t>(pool[idx].key);
+            std::size_t degree = copy_neighbors(expanded, workspace.neighbors.begin());
+            for (std::size_t i = 0; i != degree; ++i) {
+                node_id_t neighbor = workspace.neighbors[i];
+                if (workspace.visited[neighbor] == workspace.epoch)
+                    continue;
+                workspace.visited[neighbor] = workspace.epoch;
+                pool.push({neighbor, -distance(query, neighbor), false});
+            }
         }
-        return real_t(sum) / product_scaling_k;
+        return pool;
     }
-};
 
-struct metric_cos_t {
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
-        std::int64_t sum = 0, a_norm = 0, b_norm = 0;
-        for (std::size_t i = 0; i != dims; ++i) {
-            quant_product_t ai = a[i];
-            quant_product_t bi = b[i];
-            sum += ai * bi;
-            a_norm += square(ai);
-            b_norm += square(bi);
-        }
-        auto nominator = real_t(sum) / product_scaling_k;
-        auto denominator = std::sqrt(real_t(a_norm) / product_scaling_k) * //
-                           std::sqrt(real_t(b_norm) / product_scaling_k);
-        return nominator / denominator;
+    /**
+     * @brief Robust pruning: takes the candidates from the closest, skipping the ones,
+     * that are `alpha` times closer to an already selected neighbor, than to the `center`.
+     * @return The number of `selected` neighbors.
+     */
+    std::size_t prune(node_id_t center, candidate_t* candidates, std::size_t count, real_t alpha, node_id_t* selected)
+        const noexcept {
+        std::sort(candidates, candidates + count, [](candidate_t const& a, candidate_t const& b) noexcept {
+            return a.closeness != b.closeness ? a.closeness > b.closeness : a.key < b.key;
+        });
+        std::size_t selected_count = 0;
+        for (std::size_t i = 0; i != count && selected_count != max_neighbors_; ++i) {
+            auto id = static_cast<node_id_t>(candidates[i].key);
+            if (id == center || (i && candidates[i - 1].key == candidates[i].key))
+                continue;
+            real_t to_center = -candidates[i].closeness;
+            bool occluded = false;
+            for (std::size_t j = 0; j != selected_count && !occluded; ++j)
+                occluded = alpha * distance(vector(selected[j]), id) <= to_center;
+            if (!occluded)
+                selected[selected_count++] = id;
+        }
+        return selected_count;
+    }
+
+    /**
+     * @brief Picks new neighbors for a node and links them back to it,
+     * pruning the neighbors, that overflow.
+     */
+    void insert(node_id_t id, real_t alpha, workspace_t& workspace) const noexcept {
+        real_t const* query = vector(id);
+        candidates_t pool = search(query, workspace);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i != pool.size(); ++i)
+            workspace.pruned[count++] = pool[i];
+        std::size_t degree = copy_neighbors(id, workspace.neighbors.begin());
+        for (std::size_t i = 0; i != degree; ++i)
+            workspace.pruned[count++] = {workspace.neighbors[i], -distance(query, workspace.neighbors[i]), false};
+
+        std::size_t selected_count = prune(id, workspace.pruned.begin(), count, alpha, workspace.selected.begin());
+        lock(id);
+        slots(id)[0] = static_cast<node_id_t>(selected_count);
+        std::copy_n(workspace.selected.begin(), selected_count, slots(id) + 1);
+        unlock(id);
+
+        for (std::size_t i = 0; i != selected_count; ++i) {
+            node_id_t neighbor = workspace.selected[i];
+            lock(neighbor);
+            node_id_t* begin = slots(neighbor);
+            node_id_t* end = begin + 1 + begin[0];
+            if (std::find(begin + 1, end, id) == end) {
+                if (begin[0] != max_neighbors_)
+                    *end = id, ++begin[0];
+                else {
+                    std::size_t linked_count = 0;
+                    real_t const* center = vector(neighbor);
+                    for (node_id_t const* it = begin + 1; it != end; ++it)
+                        workspace.pruned[linked_count++] = {*it, -distance(center, *it), false};
+                    workspace.pruned[linked_count++] = {id, -distance(center, id), false};
+                    std::size_t kept = prune(neighbor, workspace.pruned.begin(), linked_count, alpha, begin + 1);
+                    begin[0] = static_cast<node_id_t>(kept);
+                }
+            }
+            unlock(neighbor);
+        }
     }
 };
 
-struct metric_l2_t {
+/**
+ * @brief Calls `process(thread_idx, task_idx)` for every task in up to `threads_count` threads,
+ * including the calling one. If threads can't be spawned, the remaining tasks are processed
+ * by the calling thread.
+ */
+template <typename process_at>
+void for_each_task(std::size_t tasks_count, std::size_t threads_count, process_at&& process) noexcept {
+    std::atomic<std::size_t> next_task {0};
+    auto take_tasks = [&](std::size_t thread_idx) {
+        for (std::size_t task_idx = next_task++; task_idx < tasks_count; task_idx = next_task++)
+            process(thread_idx, task_idx);
+    };
+
+    threads_count = std::max<std::size_t>(threads_count, 1);
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(threads_count - 1);
+        while (threads.size() + 1 < threads_count)
+            threads.emplace_back(take_tasks, threads.size() + 1);
+    }
+    catch (...) {
+    }
+    take_tasks(0);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Memory-mapped disk-resident index. Keys, codes and codebooks are copied into memory,
+ * while the pages of nodes are only read on demand. Immutable after opening, so it can be
+ * shared between concurrent searches.
+ */
+struct disk_index_t {
+    int fd = -1;
+    byte_t const* map = nullptr;
+    std::size_t map_size = 0;
+    disk_index_header_t header;
+    std::vector<ustore_key_t> keys;
+    std::vector<real_t> codebooks;
+    std::vector<code_t> codes;
+
+    disk_index_t() = default;
+    disk_index_t(disk_index_t const&) = delete;
+    disk_index_t& operator=(disk_index_t const&) = delete;
 
-    real_t operator()(quant_t const* a, std::size_t dims) const noexcept {
-        std::int64_t sum = 0;
-        for (std::size_t i = 0; i != dims; ++i)
-            sum += square<quant_product_t>(a[i]);
-        return std::sqrt(real_t(sum) / product_scaling_k);
+    ~disk_index_t() noexcept {
+        if (map)
+            munmap(const_cast<byte_t*>(map), map_size);
+        if (fd >= 0)
+            ::close(fd);
     }
 
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
-        std::int64_t sum = 0;
-        for (std::size_t i = 0; i != dims; ++i)
-            sum += square<quant_product_t>(a[i] - b[i]);
-        return std::sqrt(real_t(sum) / product_scaling_k);
+    code_t const* code(node_id_t id) const noexcept { return codes.data() + std::size_t(id) * header.code_size(); }
+    disk_node_ref_t node(byte_t const* page, node_id_t id) const noexcept {
+        return {page + header.offset_in_page(id), header.dimensions, header.max_neighbors};
+    }
+
+    void open(char const* path, ustore_error_t* c_error) {
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        return_error_if_m(fd >= 0, c_error, args_wrong_k, "Couldn't open the vectors index file");
+        struct stat file_stat;
+        return_error_if_m(fstat(fd, &file_stat) == 0, c_error, error_unknown_k, "Couldn't inspect the vectors index");
+        map_size = static_cast<std::size_t>(file_stat.st_size);
+        return_error_if_m(map_size >= disk_page_k, c_error, args_wrong_k, "Not a vectors index file");
+
+        void* mapped = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        return_error_if_m(mapped != MAP_FAILED, c_error, error_unknown_k, "Couldn't map the vectors index");
+        map = static_cast<byte_t const*>(mapped);
+        std::memcpy(&header, mapped, sizeof(header));
+
+        bool valid = header.magic == disk_index_magic_k && header.dimensions && header.max_neighbors &&
+                     header.count < std::numeric_limits<node_id_t>::max() && quantizer_t::is_known(header.quantization) &&
+                     header.metric <= ustore_vector_metric_l2_k;
+        disk_index_header_t expected {header.dimensions,
+                                      static_cast<ustore_vector_metric_t>(header.metric),
+                                      header.scheme(),
+                                      header.max_neighbors,
+                                      header.count};
+        valid = valid && header.node_size == expected.node_size && header.page_size == expected.page_size &&
+                header.nodes_offset == expected.nodes_offset && expected.file_size() <= map_size &&
+                (!header.count || header.medoid < header.count);
+        return_error_if_m(valid, c_error, args_wrong_k, "Corrupted vectors index header");
+
+        // Only the head of the file is copied into memory, while the pages of nodes are read on demand
+        keys.resize(header.count);
+        std::copy_n(reinterpret_cast<ustore_key_t const*>(map + header.keys_offset), keys.size(), keys.data());
+        codebooks.resize(header.codebooks_size());
+        std::copy_n(reinterpret_cast<real_t const*>(map + header.codebooks_offset), codebooks.size(), codebooks.data());
+        codes.resize(header.count * header.code_size());
+        std::copy_n(reinterpret_cast<code_t const*>(map + header.codes_offset), codes.size(), codes.data());
+        madvise(const_cast<byte_t*>(map), header.nodes_offset, MADV_DONTNEED);
+        madvise(const_cast<byte_t*>(map) + header.nodes_offset, map_size - header.nodes_offset, MADV_RANDOM);
     }
 };
 
-struct entry_t {
-    collection_key_t collection_key;
-    value_view_t value;
+/**
+ * @brief Beam search over a disk-resident index. Candidates are ranked by comparing
+ * the in-memory codes, while the `beam_width` closest of them are expanded together,
+ * fetching their pages in a single batch. Every expanded node brings its full-precision
+ * vector, so the matches are ranked exactly, without additional reads.
+ */
+class disk_search_t {
+    disk_index_t const& index_;
+    linked_memory_lock_t& arena_;
+    ustore_error_t* error_;
+    quantizer_t quantizer_;
+    page_reader_t reader_;
+    std::size_t beam_width_;
+
+    ptr_range_gt<candidate_t> candidates_;
+    visited_keys_t visited_;
+    ptr_range_gt<node_id_t> beam_;
+    ptr_range_gt<std::uint64_t> offsets_;
+    ptr_range_gt<byte_t const*> pages_;
+    ptr_range_gt<real_t> query_;
+    ptr_range_gt<code_t> code_;
+
+  public:
+    disk_search_t(disk_index_t const& index,
+                  std::size_t beam_width,
+                  linked_memory_lock_t& arena,
+                  ustore_error_t* error) noexcept
+        : index_(index), arena_(arena), error_(error),
+          reader_(index.fd, index.map, index.map_size, index.header.page_size), beam_width_(beam_width) {
+
+        disk_index_header_t const& header = index.header;
+        quantizer_.init(header.scheme(), header.dimensions, index.codebooks.data(), arena, error);
+        return_if_error_m(error);
+        beam_ = arena.alloc<node_id_t>(beam_width, error);
+        return_if_error_m(error);
+        offsets_ = arena.alloc<std::uint64_t>(beam_width, error);
+        return_if_error_m(error);
+        pages_ = arena.alloc<byte_t const*>(beam_width, error);
+        return_if_error_m(error);
+        query_ = arena.alloc<real_t>(header.dimensions, error);
+        return_if_error_m(error);
+        code_ = arena.alloc<code_t>(quantizer_t::max_code_size(header.dimensions), error);
+        return_if_error_m(error);
+        visited_.reserve(initial_visited_capacity_k, arena, error);
+        return_if_error_m(error);
+
+        byte_t* buffers = nullptr;
+        if (page_reader_t::can_use_ring_k) {
+            buffers = arena.alloc<byte_t>(beam_width * header.page_size, error, disk_page_k).begin();
+            return_if_error_m(error);
+        }
+        reader_.reserve(beam_width, buffers);
+    }
+
+    /**
+     * @brief Finds the closest entries to the `query`, exporting up to `matches.capacity()` of them.
+     */
+    void search(byte_t const* query,
+                ustore_vector_scalar_t scalar_type,
+                ustore_vector_metric_t kind,
+                real_t threshold,
+                keys_filter_t const& filter,
+                std::size_t ef,
+                pq_t& matches) noexcept {
+
+        disk_index_header_t const& header = index_.header;
+        if (!header.count)
+            return;
+        if (ef > candidates_.size()) {
+            candidates_ = arena_.alloc<candidate_t>(ef, error_);
+            return_if_error_m(error_);
+        }
+
+        convert(query, scalar_type, header.dimensions, query_.begin());
+        quantizer_.encode(query, scalar_type, code_.begin());
+        auto query_bytes = reinterpret_cast<ustore_bytes_cptr_t>(query_.begin());
+
+        candidates_t pool {candidates_.begin(), candidates_.begin() + ef};
+        auto medoid = static_cast<node_id_t>(header.medoid);
+        visited_.clear();
+        visited_.insert(medoid, arena_, error_);
+        pool.push({medoid, quantizer_.closeness(code_.begin(), index_.code(medoid), kind), false});
+
+        while (!*error_) {
+            std::size_t beam_size = 0;
+            for (std::size_t i = 0; i != pool.size() && beam_size != beam_width_; ++i) {
+                if (pool[i].expanded)
+                    continue;
+                pool[i].expanded = true;
+                beam_[beam_size] = static_cast<node_id_t>(pool[i].key);
+                offsets_[beam_size] = header.page_offset(beam_[beam_size]);
+                ++beam_size;
+            }
+            if (!beam_size)
+                break;
+
+            bool fetched = reader_.read(offsets_.begin(), beam_size, pages_.begin());
+            return_error_if_m(fetched, error_, error_unknown_k, "Couldn't read the pages of the vectors index");
+
+            for (std::size_t i = 0; i != beam_size && !*error_; ++i) {
+                disk_node_ref_t node = index_.node(pages_[i], beam_[i]);
+                ustore_key_t key = index_.keys[beam_[i]];
+                auto vector = reinterpret_cast<ustore_bytes_cptr_t>(node.vector());
+                real_t exact = exact_metric(query_bytes, vector, header.dimensions, ustore_vector_scalar_f32_k, kind);
+                if (exact >= threshold && filter.allows(key))
+                    matches.push({key, oriented_metric(exact, kind)});
+
+                for (node_id_t neighbor : node.neighbors()) {
+                    if (neighbor >= header.count || !visited_.insert(neighbor, arena_, error_))
+                        continue;
+                    pool.push({neighbor, quantizer_.closeness(code_.begin(), index_.code(neighbor), kind), false});
+                }
+            }
+        }
+    }
 };
 
-template <typename float_at = real_t>
-void quantize(float_at const* originals, std::size_t dims, quant_t* quants) noexcept {
-    for (std::size_t i = 0; i != dims; ++i)
-        quants[i] = static_cast<quant_t>(originals[i] * float_scaling_k);
-}
+/**
+ * @brief Calls `callback(keys, count, offsets, lengths, values)` for consecutive pages of original vectors
+ * of a collection. Every page reuses the memory of the previous one.
+ * @param with_values Whether to fetch the vectors or only their lengths.
+ */
+template <typename callback_at>
+void for_each_vectors_page(ustore_vectors_index_build_t const& c,
+                           arena_t& scratch,
+                           bool with_values,
+                           callback_at&& callback) noexcept {
 
-void quantize(byte_t const* bytes, ustore_vector_scalar_t scalar_type, std::size_t dims, quant_t* quants) noexcept {
-    switch (scalar_type) {
-    case ustore_vector_scalar_f32_k: return quantize((real_t const*)bytes, dims, quants);
-    case ustore_vector_scalar_f64_k: return quantize((double const*)bytes, dims, quants);
-    case ustore_vector_scalar_f16_k: return quantize((std::int16_t const*)bytes, dims, quants);
-    case ustore_vector_scalar_i8_k: return quantize((quant_t const*)bytes, dims, quants);
+    auto hidden = ustore_option_dont_discard_memory_k | ustore_option_read_shared_memory_k;
+    auto options = ustore_options_t(c.options & ~hidden);
+    ustore_key_t start_key = 0;
+    ustore_length_t count_limit = disk_scan_page_k;
+    while (!*c.error) {
+        ustore_length_t* found_counts {};
+        ustore_key_t* found_keys {};
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.arena = scratch.member_ptr();
+        scan.options = options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        if (*c.error || !found_counts[0])
+            break;
+
+        ustore_length_t count = found_counts[0];
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = c.error;
+        read.transaction = c.transaction;
+        read.arena = scratch.member_ptr();
+        read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
+        read.tasks_count = count;
+        read.collections = &c.collection;
+        read.collections_stride = 0;
+        read.keys = found_keys;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = with_values ? &offsets : nullptr;
+        read.lengths = &lengths;
+        read.values = with_values ? &values : nullptr;
+        ustore_read(&read);
+        if (*c.error)
+            break;
+
+        callback(found_keys, count, offsets, lengths, values);
+        if (count < count_limit)
+            break;
+        start_key = found_keys[count - 1] + 1;
     }
 }
 
-real_t metric(quant_t const* a, quant_t const* b, std::size_t dims, ustore_vector_metric_t kind) noexcept {
-    switch (kind) {
-    case ustore_vector_metric_dot_k: return metric_dot_t {}(a, b, dims);
-    case ustore_vector_metric_cos_k: return metric_cos_t {}(a, b, dims);
-    case ustore_vector_metric_l2_k: return metric_l2_t {}(a, b, dims);
-    default: return 0;
+/**
+ * @brief Writes all the sections of the index file in order, padding them to the page boundaries.
+ */
+void export_disk_index(disk_index_header_t const& header,
+                       vamana_t const& graph,
+                       ustore_key_t const* keys,
+                       real_t const* codebooks,
+                       code_t const* codes,
+                       char const* path,
+                       linked_memory_lock_t& arena,
+                       ustore_error_t* c_error) noexcept {
+
+    auto page = arena.alloc<byte_t>(header.page_size, c_error);
+    return_if_error_m(c_error);
+
+    file_handle_t file;
+    status_t status = file.open(path, "wb");
+    return_error_if_m(status, c_error, args_wrong_k, "Couldn't create the vectors index file");
+
+    std::uint64_t written = 0;
+    auto write = [&](void const* data, std::size_t length) noexcept {
+        if (*c_error || !length)
+            return;
+        log_error_if_m(std::fwrite(data, 1, length, file) == length,
+                       c_error,
+                       error_unknown_k,
+                       "Couldn't write the vectors index file");
+        written += length;
+    };
+    auto pad_to = [&](std::uint64_t offset) noexcept {
+        std::fill(page.begin(), page.end(), byte_t(0));
+        while (written < offset && !*c_error)
+            write(page.begin(), std::min<std::uint64_t>(offset - written, page.size()));
+    };
+
+    write(&header, sizeof(header));
+    pad_to(header.keys_offset);
+    write(keys, header.count * sizeof(ustore_key_t));
+    write(codebooks, header.codebooks_size() * sizeof(real_t));
+    write(codes, header.count * header.code_size());
+    pad_to(header.nodes_offset);
+
+    std::size_t const vector_size = header.dimensions * sizeof(real_t);
+    for (std::uint64_t page_idx = 0; page_idx != header.pages_count() && !*c_error; ++page_idx) {
+        std::fill(page.begin(), page.end(), byte_t(0));
+        for (std::size_t i = 0; i != header.nodes_per_page; ++i) {
+            std::uint64_t id = page_idx * header.nodes_per_page + i;
+            if (id >= header.count)
+                break;
+            byte_t* record = page.begin() + i * header.node_size;
+            auto neighbors = graph.neighbors(static_cast<node_id_t>(id));
+            auto degree = static_cast<node_id_t>(neighbors.size());
+            std::memcpy(record, graph.vector(static_cast<node_id_t>(id)), vector_size);
+            std::memcpy(record + vector_size, &degree, sizeof(degree));
+            std::memcpy(record + vector_size + sizeof(degree), neighbors.begin(), neighbors.size() * sizeof(node_id_t));
+        }
+        write(page.begin(), page.size());
     }
+    return_if_error_m(c_error);
+
+    status = file.close();
+    return_error_if_m(status, c_error, error_unknown_k, "Couldn't flush the vectors index file");
 }
 
-ustore_length_t size_bytes(ustore_vector_scalar_t scalar_type) noexcept {
-    switch (scalar_type) {
-    case ustore_vector_scalar_f32_k: return sizeof(real_t);
-    case ustore_vector_scalar_f64_k: return sizeof(double);
-    case ustore_vector_scalar_f16_k: return sizeof(std::int16_t);
-    case ustore_vector_scalar_i8_k: return sizeof(quant_t);
-    default: return 0;
+/**
+ * @brief Searches the `disk_index` of a request, exporting at most `count_limits` matches per task.
+ */
+void search_disk_index(ustore_vectors_search_t const& c,
+                       vectors_arg_t const& queries_args,
+                       strided_range_gt<ustore_length_t const> count_limits,
+                       keys_filter_t const& filter,
+                       std::size_t ef_search,
+                       ptr_range_gt<pq_t> tasks_matches,
+                       linked_memory_lock_t& arena) noexcept {
+
+    disk_index_t const& index = *reinterpret_cast<disk_index_t const*>(c.disk_index);
+    return_error_if_m(index.header.dimensions == c.dimensions && index.header.metric == std::uint32_t(c.metric),
+                      c.error,
+                      args_wrong_k,
+                      "Disk index was built for different dimensions or metric");
+
+    std::size_t beam_width = c.beam_width ? c.beam_width : default_beam_width_k;
+    disk_search_t search {index, beam_width, arena, c.error};
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto query = reinterpret_cast<byte_t const*>(queries_args[i].begin());
+        auto ef = std::max<std::size_t>(ef_search, count_limits[i]);
+        search.search(query, c.scalar_type, c.metric, c.metric_threshold, filter, ef, tasks_matches[i]);
+        return_if_error_m(c.error);
     }
 }
 
-struct vectors_arg_t {
-    strided_iterator_gt<ustore_bytes_cptr_t const> contents;
-    strided_iterator_gt<ustore_length_t const> offsets;
-    ustore_size_t vectors_stride;
+/**
+ * @brief Trains the quantizer of an untrained index on the vectors in `[group_begin, group_end)`
+ * and the ones already in the collection, that were stored unindexed. A single small batch
+ * would define the codebooks forever, so training is deferred, until the collection holds
+ * `pq_training_samples_min_k` vectors. Once trained, the earlier vectors are re-encoded
+ * and linked into the graph.
+ * @return true If the quantizer was trained.
+ */
+bool train_index(index_t& index,
+                 ustore_vectors_write_t const& c,
+                 places_arg_t const& places,
+                 vectors_arg_t const& vectors,
+                 std::size_t group_begin,
+                 std::size_t group_end,
+                 std::size_t ef_construction,
+                 linked_memory_lock_t& arena) noexcept {
+
+    // Earlier vectors, overwritten by this batch, aren't part of the backlog
+    auto group_keys = arena.alloc<ustore_key_t>(group_end - group_begin, c.error);
+    if (*c.error)
+        return false;
+    std::size_t group_count = 0;
+    for (std::size_t task_idx = group_begin; task_idx != group_end; ++task_idx) {
+        group_keys[task_idx - group_begin] = places[task_idx].key;
+        group_count += vectors[task_idx].begin() != nullptr;
+    }
+    std::sort(group_keys.begin(), group_keys.end());
+    auto in_group = [&](ustore_key_t key) noexcept {
+        return std::binary_search(group_keys.begin(), group_keys.end(), key);
+    };
+
+    ustore_vectors_index_build_t scan {};
+    scan.db = c.db;
+    scan.error = c.error;
+    scan.transaction = c.transaction;
+    scan.options = c.options;
+    scan.collection = places[group_begin].collection;
+    scan.dimensions = c.dimensions;
+    arena_t scratch(c.db);
     ustore_vector_scalar_t scalar_type;
-    ustore_length_t dimensions;
-    ustore_size_t tasks_count = 1;
+    std::size_t backlog_count = 0;
+    for_each_vectors_page(scan, scratch, false, [&](ustore_key_t const* keys, std::size_t page_count, auto, auto lengths, auto) {
+        for (std::size_t i = 0; i != page_count; ++i)
+            backlog_count += lengths[i] != ustore_length_missing_k && !in_group(keys[i]) &&
+                             scalar_type_of(lengths[i], c.dimensions, scalar_type);
+    });
+    if (*c.error || backlog_count + group_count < pq_training_samples_min_k)
+        return false;
 
-    value_view_t operator[](std::size_t i) const noexcept {
-        if (!contents)
-            return {};
-        ustore_bytes_cptr_t begin = contents[i];
-        begin += offsets ? offsets[i] : 0u;
-        begin += vectors_stride * i;
-        return {begin, dimensions * size_bytes(scalar_type)};
+    // The backlog comes first, followed by the vectors of the batch
+    std::size_t padded_dims = quantizer_t::subspaces(c.dimensions) * pq_subspace_dims_k;
+    auto backlog_keys = arena.alloc<ustore_key_t>(backlog_count, c.error);
+    if (*c.error)
+        return false;
+    auto samples = arena.alloc<real_t>((backlog_count + group_count) * padded_dims, c.error);
+    if (*c.error)
+        return false;
+    std::fill(samples.begin(), samples.end(), real_t(0));
+    std::size_t samples_count = 0;
+    auto gather = [&](ustore_key_t const* keys,
+                      std::size_t page_count,
+                      ustore_length_t const* offsets,
+                      ustore_length_t const* lengths,
+                      ustore_byte_t const* values) noexcept {
+        for (std::size_t i = 0; i != page_count && samples_count != backlog_count; ++i) {
+            if (lengths[i] == ustore_length_missing_k || in_group(keys[i]) ||
+                !scalar_type_of(lengths[i], c.dimensions, scalar_type))
+                continue;
+            auto original = reinterpret_cast<byte_t const*>(values + offsets[i]);
+            convert(original, scalar_type, c.dimensions, samples.begin() + padded_dims * samples_count);
+            backlog_keys[samples_count++] = keys[i];
+        }
+    };
+    for_each_vectors_page(scan, scratch, true, gather);
+    if (*c.error)
+        return false;
+    backlog_count = samples_count;
+    for (std::size_t task_idx = group_begin; task_idx != group_end; ++task_idx)
+        if (auto original_begin = vectors[task_idx].begin(); original_begin)
+            convert(original_begin, c.scalar_type, c.dimensions, samples.begin() + padded_dims * samples_count++);
+
+    // Evenly spaced rows are picked, if there are too many samples
+    std::size_t training_count = std::min(samples_count, pq_training_samples_k);
+    real_t const* training = samples.begin();
+    if (training_count != samples_count) {
+        auto picked = arena.alloc<real_t>(training_count * padded_dims, c.error);
+        if (*c.error)
+            return false;
+        for (std::size_t i = 0; i != training_count; ++i)
+            std::copy_n(samples.begin() + (i * samples_count / training_count) * padded_dims,
+                        padded_dims,
+                        picked.begin() + i * padded_dims);
+        training = picked.begin();
     }
-};
+    index.train(training, training_count);
+    if (!backlog_count)
+        return true;
+
+    // Re-encode the backlog and link it into the graph, before the vectors of the batch
+    quantizer_t& quantizer = index.quantizer();
+    std::size_t code_size = quantizer.code_size();
+    auto codes = arena.alloc<code_t>(backlog_count * code_size, c.error);
+    if (*c.error)
+        return false;
+    auto mirror_keys = arena.alloc<ustore_key_t>(backlog_count, c.error);
+    if (*c.error)
+        return false;
+    auto mirror_offsets = arena.alloc<ustore_length_t>(backlog_count, c.error);
+    if (*c.error)
+        return false;
+    for (std::size_t i = 0; i != backlog_count; ++i) {
+        auto original = reinterpret_cast<byte_t const*>(samples.begin() + i * padded_dims);
+        quantizer.encode(original, ustore_vector_scalar_f32_k, codes.begin() + i * code_size);
+        mirror_keys[i] = -backlog_keys[i];
+        mirror_offsets[i] = static_cast<ustore_length_t>(i * code_size);
+    }
+
+    auto code_length = static_cast<ustore_length_t>(code_size);
+    auto codes_begin = reinterpret_cast<ustore_bytes_cptr_t>(codes.begin());
+    ustore_write_t write {};
+    write.db = c.db;
+    write.error = c.error;
+    write.transaction = c.transaction;
+    write.arena = c.arena;
+    write.options = c.options;
+    write.tasks_count = backlog_count;
+    write.collections = &scan.collection;
+    write.keys = mirror_keys.begin();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.offsets = mirror_offsets.begin();
+    write.offsets_stride = sizeof(ustore_length_t);
+    write.lengths = &code_length;
+    write.values = &codes_begin;
+    ustore_write(&write);
+    if (*c.error)
+        return false;
+
+    for (std::size_t i = 0; i != backlog_count && !*c.error; ++i)
+        index.insert(backlog_keys[i], codes.begin() + i * code_size, ef_construction);
+    return !*c.error;
+}
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
 
 void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
 
     ustore_vectors_write_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::vectors_write_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -171,7 +2499,8 @@ void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
     auto quantized_entries = arena.alloc<entry_t>(c.tasks_count * 2u, c.error);
     return_if_error_m(c.error);
 
-    auto quantized_vectors = arena.alloc<quant_t>(c.tasks_count * c.dimensions, c.error);
+    auto code_stride = quantizer_t::max_code_size(c.dimensions);
+    auto codes = arena.alloc<code_t>(c.tasks_count * code_stride, c.error);
     return_if_error_m(c.error);
 
     // Add the original entries
@@ -182,78 +2511,53 @@ void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
         entry.value = vectors_args[task_idx];
     }
 
+    // Consecutive tasks targeting the same collection are grouped,
+    // as the quantization scheme is defined by the index of the collection
+    auto max_neighbors = c.max_neighbors ? c.max_neighbors : default_max_neighbors_k;
+    auto ef_construction = c.ef_construction ? c.ef_construction : default_ef_construction_k;
+    index_t index {c.db, c.transaction, c.options, arena, c.error};
+    auto next_group = [&](std::size_t group_begin) noexcept {
+        std::size_t group_end = group_begin + 1;
+        while (group_end != c.tasks_count && places_args[group_end].collection == places_args[group_begin].collection)
+            ++group_end;
+        return group_end;
+    };
+    auto open_group = [&](std::size_t group_begin) noexcept {
+        auto collection = places_args[group_begin].collection;
+        bool indexed = index.open(collection, true, c.dimensions, c.metric, c.quantization, max_neighbors, ef_construction);
+        log_error_if_m(!indexed || index.dimensions() == c.dimensions,
+                       c.error,
+                       args_wrong_k,
+                       "Vectors dimensions don't match the collection index");
+        return indexed && !*c.error;
+    };
+
     // Add the mirror tasks for quantized copies
-    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
-        auto original_begin = vectors_args[task_idx].begin();
-        auto quantized_begin = quantized_vectors.begin() + task_idx * c.dimensions;
-        entry_t& entry = quantized_entries[c.tasks_count + task_idx];
-        entry.collection_key.collection = places_args[task_idx].collection;
-        entry.collection_key.key = -places_args[task_idx].key;
-        entry.value = value_view_t {(ustore_bytes_cptr_t)quantized_begin, c.dimensions};
-        quantize(original_begin, c.scalar_type, c.dimensions, quantized_begin);
-    }
-
-#if 0 // Future Complex Index Logic
-
-    // Search greedily for closest entries to the provided vectors.
-    ustore_length_t starting_samples_limit = 128;
-    std::size_t max_search_rounds = 10;
-    std::size_t max_neighbors = 4;
-
-    // First, we need to random sample some starting points.
-    ustore_length_t* starting_samples_offsets = NULL;
-    ustore_length_t* starting_samples_counts = NULL;
-    ustore_key_t* starting_samples_keys = NULL;
-    ustore_sample_t sample {};
-    sample.db = c.db;
-    sample.error = c.error;
-    sample.transaction = c.transaction;
-    sample.arena = c.arena;
-    sample.options = c.options;
-    sample.collections = &first.collection_key.collection;
-    sample.collections_stride = sizeof(entry_t);
-    sample.count_limits = &starting_samples_limit;
-    sample.count_limits_stride = 0;
-    sample.offsets = &starting_samples_offsets;
-    sample.counts = &starting_samples_counts;
-    sample.keys = &starting_samples_keys;
-    ustore_sample(&sample);
-    return_if_error_m(c.error);
+    for (std::size_t group_begin = 0, group_end = 0; group_begin != c.tasks_count; group_begin = group_end) {
+        group_end = next_group(group_begin);
+        bool indexed = open_group(group_begin);
+        return_if_error_m(c.error);
 
-    // Allocate two priority queues per request.
-    // One will be used for top candidates, the other one for top results.
-    std::size_t bytes_per_queue = pq_t::implicit_memory_usage(max_neighbors);
-    std::size_t bytes_for_queues = c.tasks_count * 2ul * bytes_per_queue;
-    auto buffer_for_queues = arena.alloc<byte_t>(bytes_for_queues, c.error);
-    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
-        implicit_init(buffer_for_queues + bytes_per_queue * (task_idx * 2ul), max_neighbors);
-        implicit_init(buffer_for_queues + bytes_per_queue * (task_idx * 2ul + 1ul), max_neighbors);
-    }
-
-    // First organize connections between the vectors in
-    // the current batch mapping into the same space.
-    // ! This is a quadratic complexity step.
-    for (std::size_t a_idx = 0; a_idx != c.tasks_count; ++a_idx) {
-        auto a_place = places_args[a_idx];
-        auto a_quants = quantized_vectors.begin() + a_idx * c.dimensions;
-        for (std::size_t b_idx = 0; b_idx != c.tasks_count; ++b_idx) {
-            auto b_place = places_args[b_idx];
-            auto b_quants = quantized_vectors.begin() + b_idx * c.dimensions;
-            if (a_place.collection != b_place.collection)
-                continue;
+        if (indexed && index.needs_training() &&
+            !train_index(index, c, places_args, vectors_args, group_begin, group_end, ef_construction, arena)) {
+            return_if_error_m(c.error);
+            index.defer_training();
+        }
 
-            match_t match;
-            match.key = key;
-            match.metric = metric(a_quants, b_quants, c.dimensions, c.metric);
-            pq.push(match);
+        quantizer_t& quantizer = index.quantizer();
+        for (std::size_t task_idx = group_begin; task_idx != group_end; ++task_idx) {
+            auto original_begin = vectors_args[task_idx].begin();
+            auto code_begin = codes.begin() + task_idx * code_stride;
+            entry_t& entry = quantized_entries[c.tasks_count + task_idx];
+            entry.collection_key.collection = places_args[task_idx].collection;
+            entry.collection_key.key = -places_args[task_idx].key;
+            if (!original_begin)
+                continue;
+            entry.value = value_view_t {(ustore_bytes_cptr_t)code_begin, static_cast<ustore_length_t>(quantizer.code_size())};
+            quantizer.encode(original_begin, c.scalar_type, code_begin);
         }
     }
 
-    // Greedily search for multiple rounds.
-
-    // Introduce bidirectional links.
-#endif
-
     // Submit both original and quantized entries
     entry_t& first = quantized_entries[0];
     ustore_write_t write {};
@@ -272,21 +2576,42 @@ void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
     write.values = first.value.member_ptr();
     write.values_stride = sizeof(entry_t);
     ustore_write(&write);
+    return_if_error_m(c.error);
+
+    // Link the new vectors into the graphs of their collections.
+    // Removed entries aren't unlinked, as traversal skips the missing vectors.
+    for (std::size_t group_begin = 0, group_end = 0; group_begin != c.tasks_count; group_begin = group_end) {
+        group_end = next_group(group_begin);
+        bool indexed = open_group(group_begin);
+        return_if_error_m(c.error);
+        if (!indexed || index.needs_training())
+            continue;
+
+        for (std::size_t task_idx = group_begin; task_idx != group_end; ++task_idx) {
+            auto place = places_args[task_idx];
+            if (!vectors_args[task_idx].begin() || place.key == ustore_key_unknown_k)
+                continue;
+            index.insert(place.key, codes.begin() + task_idx * code_stride, ef_construction);
+            return_if_error_m(c.error);
+        }
+    }
+    index.flush();
 }
 
 void ustore_vectors_read(ustore_vectors_read_t* c_ptr) {
 
     ustore_vectors_read_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::vectors_read_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
-    places_arg_t places_args {collections, keys, {}, c.tasks_count};
-
     auto vector_size = c.dimensions * size_bytes(c.scalar_type);
+    return_error_if_m(vector_size, c.error, args_wrong_k, "Vectors must have a known scalar type and dimensions");
 
-    // Read from disk, but potentially re-layout the data response.
+    // Exporting only the offsets guarantees an in-order tape without gaps
+    ustore_length_t* tape_offsets {};
+    ustore_byte_t* tape {};
     ustore_read_t read {};
     read.db = c.db;
     read.error = c.error;
@@ -298,19 +2623,197 @@ void ustore_vectors_read(ustore_vectors_read_t* c_ptr) {
     read.collections_stride = c.collections_stride;
     read.keys = keys.get();
     read.keys_stride = keys.stride();
-    read.offsets = c.offsets;
+    read.offsets = &tape_offsets;
     read.presences = c.presences;
-    read.values = c.vectors;
+    read.values = &tape;
     ustore_read(&read);
     return_if_error_m(c.error);
 
-    // From here on, if we have the offsets don't form identical-length chunks,
-    // we must compact the range:
+    // If all the vectors are present and were written in the requested type,
+    // the tape already forms a dense matrix and can be exported as is
+    bool dense = true;
+    for (std::size_t i = 0; i != c.tasks_count && dense; ++i)
+        dense = tape_offsets[i + 1] - tape_offsets[i] == vector_size && tape_offsets[i] == i * vector_size;
+
+    if (c.offsets) {
+        auto offsets = arena.alloc<ustore_length_t>(c.tasks_count + 1, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i <= c.tasks_count; ++i)
+            offsets[i] = static_cast<ustore_length_t>(i * vector_size);
+        *c.offsets = offsets.begin();
+    }
+    if (dense) {
+        if (c.vectors)
+            *c.vectors = tape;
+        return;
+    }
+
+    // Otherwise the matrix is assembled in a single pass over the tape,
+    // converting the originals and zero-filling the missing rows
+    auto matrix = arena.alloc<byte_t>(c.tasks_count * vector_size, c.error);
+    return_if_error_m(c.error);
+    auto reals = arena.alloc<real_t>(c.dimensions, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto original = reinterpret_cast<byte_t const*>(tape + tape_offsets[i]);
+        byte_t* row = matrix.begin() + i * vector_size;
+        ustore_length_t length = tape_offsets[i + 1] - tape_offsets[i];
+        ustore_vector_scalar_t scalar_type;
+        if (length == vector_size)
+            std::memcpy(row, original, vector_size);
+        else if (scalar_type_of(length, c.dimensions, scalar_type)) {
+            convert(original, scalar_type, c.dimensions, reals.begin());
+            convert_reals(reals.begin(), c.dimensions, c.scalar_type, row);
+        }
+        else
+            std::memset(row, 0, vector_size);
+    }
+    if (c.vectors)
+        *c.vectors = reinterpret_cast<ustore_byte_t*>(matrix.begin());
+}
+
+void ustore_vectors_index_build(ustore_vectors_index_build_t* c_ptr) {
+
+    ustore_vectors_index_build_t& c = *c_ptr;
+    metered_call_t metered {metric_op_t::vectors_index_build_k, c.error};
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    return_error_if_m(c.dimensions && c.path, c.error, args_wrong_k, "Vectors dimensions and index path are required");
+    return_error_if_m(quantizer_t::is_known(c.quantization) && c.metric <= ustore_vector_metric_l2_k,
+                      c.error,
+                      args_wrong_k,
+                      "Unknown metric or quantization scheme");
+
+    std::size_t max_neighbors = c.max_neighbors ? c.max_neighbors : default_disk_max_neighbors_k;
+    std::size_t ef_construction = c.ef_construction ? c.ef_construction : default_disk_ef_construction_k;
+    ef_construction = std::max(ef_construction, max_neighbors);
+    real_t alpha = c.alpha > 0 ? c.alpha : default_disk_alpha_k;
+
+    // Vectors are counted first, to gather them into a single matrix
+    arena_t scratch(c.db);
+    std::size_t count = 0;
+    ustore_vector_scalar_t scalar_type;
+    for_each_vectors_page(c, scratch, false, [&](ustore_key_t const*, std::size_t page_count, auto, auto lengths, auto) {
+        for (std::size_t i = 0; i != page_count; ++i)
+            count += lengths[i] != ustore_length_missing_k && scalar_type_of(lengths[i], c.dimensions, scalar_type);
+    });
+    return_if_error_m(c.error);
+    return_error_if_m(count < std::numeric_limits<node_id_t>::max(),
+                      c.error,
+                      args_wrong_k,
+                      "Too many vectors for a single index");
+
+    auto keys = arena.alloc<ustore_key_t>(count, c.error);
+    return_if_error_m(c.error);
+    auto vectors = arena.alloc<real_t>(count * c.dimensions, c.error);
+    return_if_error_m(c.error);
+    std::size_t gathered = 0;
+    auto gather = [&](ustore_key_t const* page_keys,
+                      std::size_t page_count,
+                      ustore_length_t const* offsets,
+                      ustore_length_t const* lengths,
+                      ustore_byte_t const* values) noexcept {
+        for (std::size_t i = 0; i != page_count && gathered != count; ++i) {
+            if (lengths[i] == ustore_length_missing_k || !scalar_type_of(lengths[i], c.dimensions, scalar_type))
+                continue;
+            auto original = reinterpret_cast<byte_t const*>(values + offsets[i]);
+            convert(original, scalar_type, c.dimensions, vectors.begin() + gathered * c.dimensions);
+            keys[gathered++] = page_keys[i];
+        }
+    };
+    for_each_vectors_page(c, scratch, true, gather);
+    return_if_error_m(c.error);
+    count = gathered;
+
+    // Codes are compared while searching, so they are derived from the same matrix
+    disk_index_header_t header {c.dimensions, c.metric, c.quantization, max_neighbors, count};
+    auto codebooks = arena.alloc<real_t>(header.codebooks_size(), c.error);
+    return_if_error_m(c.error);
+    std::fill(codebooks.begin(), codebooks.end(), real_t(0));
+    quantizer_t quantizer;
+    quantizer.init(c.quantization, c.dimensions, codebooks.begin(), arena, c.error);
+    return_if_error_m(c.error);
+    if (c.quantization == ustore_vector_quantization_pq4_k && count) {
+        std::size_t padded_dims = quantizer_t::subspaces(c.dimensions) * pq_subspace_dims_k;
+        std::size_t samples_count = std::min<std::size_t>(count, pq_training_samples_k);
+        auto samples = arena.alloc<real_t>(samples_count * padded_dims, c.error);
+        return_if_error_m(c.error);
+        std::fill(samples.begin(), samples.end(), real_t(0));
+        for (std::size_t i = 0; i != samples_count; ++i)
+            std::copy_n(vectors.begin() + i * c.dimensions, c.dimensions, samples.begin() + i * padded_dims);
+        quantizer_t::train(samples.begin(), samples_count, c.dimensions, codebooks.begin());
+        quantizer.retabulate();
+    }
+
+    std::size_t code_size = header.code_size();
+    auto codes = arena.alloc<code_t>(count * code_size, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != count; ++i) {
+        auto original = reinterpret_cast<byte_t const*>(vectors.begin() + i * c.dimensions);
+        quantizer.encode(original, ustore_vector_scalar_f32_k, codes.begin() + i * code_size);
+    }
+
+    vamana_t graph;
+    if (count) {
+        graph.init(vectors.begin(), count, c.dimensions, max_neighbors, c.metric, arena, c.error);
+        return_if_error_m(c.error);
+
+        std::size_t threads_count = std::min<std::size_t>(std::max<std::size_t>(c.threads_count, 1), count);
+        auto workspaces = arena.alloc<vamana_t::workspace_t>(threads_count, c.error);
+        return_if_error_m(c.error);
+        for (vamana_t::workspace_t& workspace : workspaces) {
+            new (&workspace) vamana_t::workspace_t();
+            graph.reserve(workspace, ef_construction, arena, c.error);
+            return_if_error_m(c.error);
+        }
+
+        // Nodes are inserted in a pseudo-random order, but the graph doesn't depend on the order of keys
+        auto order = arena.alloc<node_id_t>(count, c.error);
+        return_if_error_m(c.error);
+        std::iota(order.begin(), order.end(), node_id_t(0));
+        std::sort(order.begin(), order.end(), [&](node_id_t a, node_id_t b) noexcept {
+            return hash_key(keys[a]) < hash_key(keys[b]);
+        });
+        for (real_t pass_alpha : {real_t(1), alpha})
+            for_each_task(count, threads_count, [&](std::size_t thread_idx, std::size_t task_idx) noexcept {
+                graph.insert(order[task_idx], pass_alpha, workspaces[thread_idx]);
+            });
+        header.medoid = graph.medoid();
+    }
+
+    // The file is written next to the target and renamed, so that readers never see a partial index
+    std::size_t path_length = std::strlen(c.path);
+    auto temporary_path = arena.alloc<char>(path_length + 5u, c.error);
+    return_if_error_m(c.error);
+    std::memcpy(temporary_path.begin(), c.path, path_length);
+    std::memcpy(temporary_path.begin() + path_length, ".tmp", 5u);
+    export_disk_index(header, graph, keys.begin(), codebooks.begin(), codes.begin(), temporary_path.begin(), arena, c.error);
+    if (!*c.error && std::rename(temporary_path.begin(), c.path) != 0)
+        log_error_m(c.error, error_unknown_k, "Couldn't replace the vectors index file");
+    if (*c.error)
+        std::remove(temporary_path.begin());
+}
+
+void ustore_vectors_index_open(ustore_vectors_index_open_t* c_ptr) {
+
+    ustore_vectors_index_open_t& c = *c_ptr;
+    return_error_if_m(c.path && c.index, c.error, args_wrong_k, "Index path and output handle are required");
+    safe_section("Opening vectors index", c.error, [&] {
+        auto index = std::make_unique<disk_index_t>();
+        index->open(c.path, c.error);
+        if (!*c.error)
+            *c.index = index.release();
+    });
+}
+
+void ustore_vectors_index_free(ustore_vectors_index_t c_index) {
+    delete reinterpret_cast<disk_index_t*>(c_index);
 }
 
 void ustore_vectors_search(ustore_vectors_search_t* c_ptr) {
 
     ustore_vectors_search_t const& c = *c_ptr;
+    metered_call_t metered {metric_op_t::vectors_search_k, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -337,45 +2840,126 @@ void ustore_vectors_search(ustore_vectors_search_t* c_ptr) {
     auto found_metrics = arena.alloc_or_dummy(count_limits_sum, c.error, c.match_metrics);
     return_if_error_m(c.error);
 
-    auto temp_matches = arena.alloc<match_t>(count_limits_max, c.error);
+    // Disk-resident indexes compare the full-precision vectors anyway
+    std::size_t oversampling = c.disk_index ? 1 : std::max<std::size_t>(c.oversampling, 1);
+    auto temp_matches = arena.alloc<match_t>(count_limits_sum * oversampling, c.error);
     return_if_error_m(c.error);
-    auto quant_query = arena.alloc<quant_t>(c.dimensions, c.error);
+    auto tasks_matches = arena.alloc<pq_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto code_stride = quantizer_t::max_code_size(c.dimensions);
+    auto codes = arena.alloc<code_t>(c.tasks_count * code_stride, c.error);
+    return_if_error_m(c.error);
+    auto codes_norms = arena.alloc<real_t>(c.tasks_count, c.error);
     return_if_error_m(c.error);
 
-    ustore_length_t total_exported_matches = 0;
-    for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
-        auto col = collections ? collections[i] : ustore_collection_main_k;
-        auto query = queries_args[i];
-        auto limit = count_limits[i];
-        quantize(query.begin(), c.scalar_type, c.dimensions, quant_query.begin());
+    ustore_length_t total_reserved_matches = 0;
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto matches_begin = temp_matches.begin() + total_reserved_matches;
+        new (&tasks_matches[i]) pq_t {matches_begin, matches_begin + count_limits[i] * oversampling};
+        total_reserved_matches += count_limits[i] * oversampling;
+    }
 
-        pq_t pq {temp_matches.begin(), temp_matches.begin() + limit};
+    keys_filter_t filter {c.allowed_keys, c.allowed_keys_count};
+    return_error_if_m(!filter || std::is_sorted(filter.keys, filter.keys + filter.count),
+                      c.error,
+                      args_wrong_k,
+                      "Allowed keys must be sorted");
 
-        auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
-            if (key >= 0)
-                return false;
-            match_t match;
-            match.key = key;
-            match.metric = metric(quant_query.begin(), (quant_t const*)vector.data(), c.dimensions, c.metric);
-            if (match.metric < c.metric_threshold)
-                return true;
+    std::size_t ef_search = c.ef_search ? c.ef_search : default_ef_search_k;
+    if (c.disk_index) {
+        search_disk_index(c, queries_args, count_limits, filter, ef_search, tasks_matches, arena);
+        return_if_error_m(c.error);
+    }
 
-            pq.push(match);
-            return true;
-        };
+    index_t index {c.db, c.transaction, c.options, arena, c.error};
 
-        auto min_key = std::numeric_limits<ustore_key_t>::min();
-        full_scan_collection(c.db, c.transaction, col, c.options, min_key, limit, arena, c.error, callback);
-        auto count = pq.size();
+    // Consecutive tasks targeting the same collection are grouped,
+    // so that an exhaustive search passes over the collection only once
+    std::size_t const collections_tasks_count = c.disk_index ? 0 : c.tasks_count;
+    for (std::size_t group_begin = 0, group_end = 0; group_begin != collections_tasks_count; group_begin = group_end) {
+        auto col = collections ? collections[group_begin] : ustore_collection_main_k;
+        group_end = group_begin + 1;
+        while (group_end != c.tasks_count && (!collections || collections[group_end] == col))
+            ++group_end;
+
+        auto ef = std::max<std::size_t>(ef_search, count_limits_max * oversampling);
+        auto quantization = ustore_vector_quantization_i8_k;
+        bool indexed = index.open(col, false, c.dimensions, c.metric, quantization, default_max_neighbors_k, ef);
+        return_if_error_m(c.error);
+
+        // Indexed collections only contain vectors of matching dimensions
+        return_error_if_m(!indexed || index.dimensions() == c.dimensions,
+                          c.error,
+                          args_wrong_k,
+                          "Queries dimensions don't match the collection index");
+
+        // Queries are encoded the same way as the vectors of the collection
+        quantizer_t& quantizer = index.quantizer();
+        for (std::size_t i = group_begin; i != group_end; ++i) {
+            code_t* code = codes.begin() + i * code_stride;
+            quantizer.encode(queries_args[i].begin(), c.scalar_type, code);
+            codes_norms[i] = quantizer.norm(code);
+        }
+
+        // Matches are ranked by closeness and exported with the original metric
+        // Short allow-lists are cheaper to compare exhaustively, than to traverse the graph
+        bool allowed_few = filter && filter.count <= ef * index.max_neighbors() * 2u;
+        if (!indexed || index.metric() != c.metric || allowed_few) {
+            scan_queries_t queries;
+            queries.vectors = codes.begin() + group_begin * code_stride;
+            queries.stride = code_stride;
+            queries.norms = codes_norms.begin() + group_begin;
+            queries.matches = tasks_matches.begin() + group_begin;
+            queries.count = group_end - group_begin;
+            scan_group(c.db,
+                       c.transaction,
+                       col,
+                       c.options,
+                       quantizer,
+                       queries,
+                       c.metric,
+                       c.metric_threshold,
+                       filter,
+                       c.threads_count,
+                       arena,
+                       c.error);
+            return_if_error_m(c.error);
+            continue;
+        }
+
+        for (std::size_t i = group_begin; i != group_end; ++i) {
+            pq_t& pq = tasks_matches[i];
+            auto limit = count_limits[i] * oversampling;
+            auto code = codes.begin() + i * code_stride;
+            candidates_t candidates = index.search(code, std::max<std::size_t>(ef_search, limit), filter);
+            return_if_error_m(c.error);
+            for (std::size_t j = 0; j != candidates.size() && pq.size() != limit; ++j) {
+                candidate_t const& candidate = candidates[j];
+                if (candidate.closeness == missing_closeness_k)
+                    continue;
+                if (oriented_metric(candidate.closeness, c.metric) < c.metric_threshold)
+                    continue;
+                pq.push({candidate.key, candidate.closeness});
+            }
+        }
+    }
+
+    if (oversampling > 1) {
+        rerank(c, queries_args, collections, count_limits, tasks_matches, arena);
+        return_if_error_m(c.error);
+    }
 
+    ustore_length_t total_exported_matches = 0;
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        pq_t const& pq = tasks_matches[i];
+        auto count = pq.size();
         found_counts[i] = count;
         found_offsets[i] = total_exported_matches;
 
         for (std::size_t j = 0; j != count; ++j)
-            found_keys[total_exported_matches + j] = std::abs(temp_matches[j].key), //
-                found_metrics[total_exported_matches + j] = temp_matches[j].metric;
+            found_keys[total_exported_matches + j] = std::abs(pq.begin()[j].key), //
+                found_metrics[total_exported_matches + j] = oriented_metric(pq.begin()[j].metric, c.metric);
 
         total_exported_matches += count;
-        pq.clear();
     }
-}
\ No newline at end of file
+}
@@ -9,11 +9,15 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <vector>
+#include <deque>    // Pipelined requests
+#include <optional>
 #include <string>
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <thread>   // Thread pool
 #include <charconv> // Parsing integers
 #include <iostream> // Logging to `std::cerr`
@@ -36,7 +40,9 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/config.hpp>
 
 #if defined(__clang__)
@@ -46,6 +52,8 @@
 #elif defined(_MSC_VER)
 #endif
 
+#include <nlohmann/json.hpp> // `nlohmann::json`
+
 #include "ustore/ustore.hpp"
 
 namespace beast = boost::beast;   // from <boost/beast.hpp>
@@ -63,31 +71,31 @@ static constexpr char const* mime_msgpack_k = "application/msgpack";
 static constexpr char const* mime_cbor_k = "application/cbor";
 static constexpr char const* mime_bson_k = "application/bson";
 static constexpr char const* mime_ubjson_k = "application/ubjson";
+static constexpr char const* mime_ndjson_k = "application/x-ndjson";
+static constexpr char const* mime_prometheus_k = "text/plain; version=0.0.4";
+
+using json_t = nlohmann::json;
 
 ustore_doc_field_type_t mime_to_format(beast::string_view mime) {
     if (mime == mime_json_k)
-        return ustore_field_json_k;
-    else if (mime == "application/json-patch+json")
-        return ustore_format_json_patch_k;
+        return ustore_doc_field_json_k;
     else if (mime == mime_msgpack_k)
-        return ustore_format_msgpack_k;
+        return ustore_doc_field_msgpack_k;
     else if (mime == mime_bson_k)
-        return ustore_format_bson_k;
-    else if (mime == mime_cbor_k)
-        return ustore_format_cbor_k;
-    else if (mime == mime_ubjson_k)
-        return ustore_format_ubjson_k;
-    else if (mime == "application/vnd.apache.arrow.stream" || mime == "application/vnd.apache.arrow.file")
-        return ustore_format_arrow_k;
-    else if (mime == "application/vnd.apache.parquet")
-        return ustore_format_parquet_k;
+        return ustore_doc_field_bson_k;
     else
         return ustore_doc_field_default_k;
 }
 
+/**
+ * @brief State shared by all the connections: the database and
+ * the pool of threads, on which the blocking database calls run.
+ */
 struct db_w_clients_t : public std::enable_shared_from_this<db_w_clients_t> {
     database_t session;
-    int running_transactions;
+    net::thread_pool workers;
+
+    db_w_clients_t(std::size_t workers_count) : workers(workers_count) {}
 };
 
 void log_failure(beast::error_code ec, char const* what) {
@@ -119,26 +127,157 @@ std::optional<beast::string_view> param_value(beast::string_view query_params, b
     if (key_begin == query_params.end())
         return std::nullopt;
 
-    char preceding_char = *(key_begin - 1);
-    bool isnt_part_of_bigger_key = (preceding_char != '?') & (preceding_char != '&') & (preceding_char != '/');
-    if (!isnt_part_of_bigger_key)
-        return std::nullopt;
+    char preceding_char = key_begin != query_params.begin() ? *(key_begin - 1) : '?';
+    bool is_part_of_bigger_key = (preceding_char != '?') & (preceding_char != '&') & (preceding_char != '/');
+    if (is_part_of_bigger_key)
+        return param_value(beast::string_view {key_begin + 1, static_cast<size_t>(query_params.end() - key_begin - 1)},
+                           param_name);
 
     auto value_begin = key_begin + param_name.size();
     auto value_end = std::find(value_begin, query_params.end(), '&');
     return beast::string_view {value_begin, static_cast<size_t>(value_end - value_begin)};
 }
 
+/**
+ * @brief Opens the collection named in the "col=" parameter, if present,
+ *        or falls back to the main one.
+ * @return NULL on success, or the reason of failure.
+ */
+std::optional<std::string> parse_collection(database_t& db,
+                                            beast::string_view params_str,
+                                            ustore_collection_t& collection) {
+    collection = ustore_collection_main_k;
+    auto collection_val = param_value(params_str, "col=");
+    if (!collection_val)
+        return std::nullopt;
+
+    std::string collection_name(collection_val->data(), std::min<std::size_t>(collection_val->size(), 64ul));
+    auto maybe_collection = db.find_or_create(collection_name.c_str());
+    if (!maybe_collection)
+        return std::string(maybe_collection.release_status().message());
+    collection = *maybe_collection;
+    return std::nullopt;
+}
+
+/**
+ * @brief Produces the next part of a chunked response, appending to `chunk`.
+ * @return False, if it was the last part.
+ */
+using next_chunk_t = std::function<bool(std::string& chunk)>;
+
+static constexpr char const base64_chars_k[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void append_base64(std::string& output, ustore_bytes_cptr_t input, std::size_t length) {
+    output.reserve(output.size() + (length + 2) / 3 * 4);
+    std::size_t i = 0;
+    for (; i + 2 < length; i += 3) {
+        std::uint32_t triple = (input[i] << 16) | (input[i + 1] << 8) | input[i + 2];
+        output.push_back(base64_chars_k[(triple >> 18) & 63]);
+        output.push_back(base64_chars_k[(triple >> 12) & 63]);
+        output.push_back(base64_chars_k[(triple >> 6) & 63]);
+        output.push_back(base64_chars_k[triple & 63]);
+    }
+    if (i == length)
+        return;
+
+    std::uint32_t triple = (input[i] << 16) | (i + 1 < length ? input[i + 1] << 8 : 0);
+    output.push_back(base64_chars_k[(triple >> 18) & 63]);
+    output.push_back(base64_chars_k[(triple >> 12) & 63]);
+    output.push_back(i + 1 < length ? base64_chars_k[(triple >> 6) & 63] : '=');
+    output.push_back('=');
+}
+
+/**
+ * @return False, if the `input` isn't a valid padded Base64 string.
+ */
+bool append_from_base64(std::string& output, std::string_view input) {
+    if (input.size() % 4)
+        return false;
+
+    auto decode = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A';
+        if (c >= 'a' && c <= 'z')
+            return c - 'a' + 26;
+        if (c >= '0' && c <= '9')
+            return c - '0' + 52;
+        return c == '+' ? 62 : c == '/' ? 63 : -1;
+    };
+
+    output.reserve(output.size() + input.size() / 4 * 3);
+    for (std::size_t i = 0; i != input.size(); i += 4) {
+        bool is_last = i + 4 == input.size();
+        std::size_t padding = is_last ? (input[i + 3] == '=') + (input[i + 2] == '=') : 0;
+        std::uint32_t quad = 0;
+        for (std::size_t j = 0; j != 4 - padding; ++j) {
+            int sextet = decode(input[i + j]);
+            if (sextet < 0)
+                return false;
+            quad |= std::uint32_t(sextet) << (18 - 6 * j);
+        }
+        output.push_back(char(quad >> 16));
+        if (padding < 2)
+            output.push_back(char((quad >> 8) & 0xFF));
+        if (padding < 1)
+            output.push_back(char(quad & 0xFF));
+    }
+    return true;
+}
+
+/**
+ * @brief Appends one line of NDJSON, describing a binary value in the `{_id, _bin}` form.
+ * Missing values are exported as NULLs.
+ */
+void append_ndjson_entry(std::string& output, ustore_key_t key, ustore_bytes_cptr_t value, ustore_length_t length) {
+    output += "{\"_id\":";
+    output += std::to_string(key);
+    output += ",\"_bin\":";
+    if (length == ustore_length_missing_k)
+        output += "null";
+    else {
+        output.push_back('"');
+        append_base64(output, value, length);
+        output.push_back('"');
+    }
+    output += "}\n";
+}
+
+/**
+ * @brief Parses the `{keys: [int]}` payload of batch requests.
+ * @return False, if the payload is malformed.
+ */
+bool parse_keys(std::string const& payload, std::vector<ustore_key_t>& keys) {
+    json_t payload_dict = json_t::parse(payload, nullptr, false);
+    if (payload_dict.is_discarded() || !payload_dict.is_object())
+        return false;
+    auto keys_it = payload_dict.find("keys");
+    if (keys_it == payload_dict.end() || !keys_it->is_array())
+        return false;
+
+    keys.reserve(keys_it->size());
+    for (auto const& key_json : *keys_it) {
+        if (!key_json.is_number_integer())
+            return false;
+        keys.push_back(key_json.template get<ustore_key_t>());
+    }
+    return true;
+}
+
+/**
+ * @brief Handles a single key. Runs on one of the worker threads.
+ * @param arena Memory for the lookups. Lives until the response is sent,
+ *              so the bodies may point into it without copies.
+ */
 template <typename body_at, typename allocator_at, typename send_response_at>
-void respond_to_one(db_session_t& session,
+void respond_to_one(database_t& db,
+                    arena_t& arena,
                     http::request<body_at, http::basic_fields<allocator_at>>&& req,
                     send_response_at&& send_response) {
 
     http::verb received_verb = req.method();
     beast::string_view received_path = req.target();
 
-    transaction_t txn(session.db());
-    blobs_collection_t collection;
+    ustore_collection_t collection = ustore_collection_main_k;
     ustore_key_t key = 0;
     ustore_options_t options = ustore_options_default_k;
 
@@ -159,55 +298,43 @@ void respond_to_one(db_session_t& session,
     }
 
     // Parse the collection name string.
-    if (auto collection_val = param_value(params_str, "col="); collection_val) {
-        char collection_name_buffer[65] = {0};
-        std::memcpy(collection_name_buffer, collection_val->data(), std::min(collection_val->size(), 64ul));
-
-        status_t status;
-        ustore_collection_create_t collection_init {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .name = collection_name_buffer,
-            .id = &collection.raw,
-        };
-
-        ustore_collection_create(&collection_init);
-        if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
-    }
+    if (auto failure = parse_collection(db, params_str, collection); failure)
+        return send_response(make_error(req, http::status::internal_server_error, *failure));
 
     // Once we know, which collection, key and transaction user is
     // interested in - perform the actions depending on verbs.
+    status_t status;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.arena = arena.member_ptr();
+    read.options = options;
+    read.tasks_count = 1;
+    read.collections = &collection;
+    read.keys = &key;
+    read.lengths = &found_lengths;
+
     switch (received_verb) {
 
         // Read the data:
     case http::verb::get: {
 
-        arena_t tape(session.db());
-        status_t status;
-        ustore_read_t read {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-        };
-
+        read.offsets = &found_offsets;
+        read.values = &found_values;
         ustore_read(&read);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
-        ustore_bytes_ptr_t begin = tape.ptr + sizeof(ustore_length_t);
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (!len)
+        ustore_length_t len = found_lengths[0];
+        if (len == ustore_length_missing_k)
             return send_response(make_error(req, http::status::not_found, "Missing key"));
 
+        // The body points straight into the `arena`, no copies involved
         http::buffer_body::value_type body;
-        body.data = begin;
+        body.data = found_values + found_offsets[0];
         body.size = len;
         body.more = false;
 
@@ -226,30 +353,15 @@ void respond_to_one(db_session_t& session,
         // Check the data:
     case http::verb::head: {
 
-        arena_t tape(session.db());
-        status_t status;
-        options = ustore_option_read_lengths_k;
-        ustore_read_t read {
-            .db = session.db(),
-            .transaction = txn.raw,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .options = options,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-            .error = error.member_ptr(),
-        };
-
         ustore_read(&read);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (!len)
+        ustore_length_t len = found_lengths[0];
+        if (len == ustore_length_missing_k)
             return send_response(make_error(req, http::status::not_found, "Missing key"));
 
-        http::response<http::empty_body> res;
+        http::response<http::empty_body> res {http::status::ok, req.version()};
         res.set(http::field::server, server_name_k);
         res.set(http::field::content_type, mime_binary_k);
         res.content_length(len);
@@ -259,27 +371,13 @@ void respond_to_one(db_session_t& session,
 
     // Insert data if it's missing:
     case http::verb::post: {
-        arena_t tape(session.db());
-        status_t status;
-        options = ustore_option_read_lengths_k;
-        ustore_read_t read {
-            .db = session.db(),
-            .transaction = txn.raw,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .options = options,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-            .error = error.member_ptr(),
-        };
 
         ustore_read(&read);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (len)
+        ustore_length_t len = found_lengths[0];
+        if (len != ustore_length_missing_k)
             return send_response(make_error(req, http::status::conflict, "Duplicate key"));
 
         [[fallthrough]];
@@ -299,60 +397,49 @@ void respond_to_one(db_session_t& session,
             return send_response(
                 make_error(req, http::status::unsupported_media_type, "Only binary payload is allowed"));
 
-        status_t status;
-        auto value = req.body();
-        auto value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+        auto const& value = req.body();
+        auto value_ptr = reinterpret_cast<ustore_bytes_cptr_t>(value.data());
         auto value_len = static_cast<ustore_length_t>(*opt_payload_len);
-        ustore_length_t value_off = 0;
-
-        ustore_write_t write {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options.collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .offsets = &value_off,
-            .lengths = &value_len,
-            .values = &value_ptr,
-        };
+
+        ustore_write_t write {};
+        write.db = db;
+        write.error = status.member_ptr();
+        write.arena = arena.member_ptr();
+        write.options = options;
+        write.tasks_count = 1;
+        write.collections = &collection;
+        write.keys = &key;
+        write.lengths = &value_len;
+        write.values = &value_ptr;
 
         ustore_write(&write);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
-        http::response<http::empty_body> res;
+        http::response<http::empty_body> res {http::status::ok, req.version()};
         res.set(http::field::server, server_name_k);
         res.set(http::field::content_type, mime_binary_k);
         res.keep_alive(req.keep_alive());
         return send_response(std::move(res));
     }
 
-        // Upsert data:
+        // Remove data:
     case http::verb::delete_: {
 
-        status_t status;
-        ustore_bytes_ptr_t value_ptr = nullptr;
-        ustore_length_t value_len = 0;
-        ustore_length_t value_off = 0;
-
-        ustore_write_t write {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options.collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .offsets = &value_off,
-            .lengths = &value_len,
-            .values = &value_ptr,
-        };
+        ustore_write_t write {};
+        write.db = db;
+        write.error = status.member_ptr();
+        write.arena = arena.member_ptr();
+        write.options = options;
+        write.tasks_count = 1;
+        write.collections = &collection;
+        write.keys = &key;
 
         ustore_write(&write);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
-        http::response<http::empty_body> res;
+        http::response<http::empty_body> res {http::status::ok, req.version()};
         res.set(http::field::server, server_name_k);
         res.set(http::field::content_type, mime_binary_k);
         res.keep_alive(req.keep_alive());
@@ -366,16 +453,253 @@ void respond_to_one(db_session_t& session,
     }
 }
 
+/**
+ * @brief Handles many keys of one collection in a single request.
+ * Variable length binary values are exchanged in NDJSON, one `{_id, _bin}` object per line.
+ */
 template <typename body_at, typename allocator_at, typename send_response_at>
-void respond_to_aos(db_session_t& session,
+void respond_to_batch(database_t& db,
+                      arena_t& arena,
+                      http::request<body_at, http::basic_fields<allocator_at>>&& req,
+                      send_response_at&& send_response) {
+
+    http::verb received_verb = req.method();
+    beast::string_view received_path = req.target();
+
+    ustore_collection_t collection = ustore_collection_main_k;
+    auto params_begin = std::find(received_path.begin(), received_path.end(), '?');
+    auto params_str = beast::string_view {params_begin, static_cast<size_t>(received_path.end() - params_begin)};
+    if (auto failure = parse_collection(db, params_str, collection); failure)
+        return send_response(make_error(req, http::status::internal_server_error, *failure));
+
+    status_t status;
+    std::vector<ustore_key_t> keys;
+    switch (received_verb) {
+
+        // Read the data:
+    case http::verb::get: {
+
+        if (!parse_keys(req.body(), keys))
+            return send_response(make_error(req, http::status::bad_request, "Expects a `{keys: [int]}` object"));
+
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.tasks_count = static_cast<ustore_size_t>(keys.size());
+        read.collections = &collection;
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+
+        ustore_read(&read);
+        if (!status)
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+
+        std::string response_str;
+        for (std::size_t i = 0; i != keys.size(); ++i)
+            append_ndjson_entry(response_str, keys[i], found_values + found_offsets[i], found_lengths[i]);
+
+        http::response<http::string_body> res {
+            std::piecewise_construct,
+            std::make_tuple(std::move(response_str)),
+            std::make_tuple(http::status::ok, req.version()),
+        };
+        res.set(http::field::server, server_name_k);
+        res.set(http::field::content_type, mime_ndjson_k);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return send_response(std::move(res));
+    }
+
+        // Upsert or remove the data:
+    case http::verb::put:
+    case http::verb::delete_: {
+
+        // All the values are decoded into one tape
+        std::string tape;
+        std::vector<ustore_length_t> offsets;
+        std::vector<ustore_length_t> lengths;
+        if (received_verb == http::verb::delete_) {
+            if (!parse_keys(req.body(), keys))
+                return send_response(make_error(req, http::status::bad_request, "Expects a `{keys: [int]}` object"));
+        }
+        else {
+            std::string_view lines = req.body();
+            while (!lines.empty()) {
+                auto line_end = std::min(lines.find('\n'), lines.size());
+                auto line = lines.substr(0, line_end);
+                lines.remove_prefix(std::min(line_end + 1, lines.size()));
+                if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+                    continue;
+
+                json_t entry = json_t::parse(line, nullptr, false);
+                auto id_it = entry.is_object() ? entry.find("_id") : entry.end();
+                auto bin_it = entry.is_object() ? entry.find("_bin") : entry.end();
+                if (entry.is_discarded() || id_it == entry.end() || !id_it->is_number_integer() ||
+                    bin_it == entry.end() || !(bin_it->is_string() || bin_it->is_null()))
+                    return send_response(
+                        make_error(req, http::status::bad_request, "Expects `{_id: int, _bin: str|null}` lines"));
+
+                keys.push_back(id_it->template get<ustore_key_t>());
+                offsets.push_back(static_cast<ustore_length_t>(tape.size()));
+                if (bin_it->is_null())
+                    lengths.push_back(ustore_length_missing_k);
+                else if (append_from_base64(tape, bin_it->template get_ref<std::string const&>()))
+                    lengths.push_back(static_cast<ustore_length_t>(tape.size() - offsets.back()));
+                else
+                    return send_response(make_error(req, http::status::bad_request, "Invalid Base64 in `_bin`"));
+            }
+        }
+
+        auto tape_begin = reinterpret_cast<ustore_bytes_cptr_t>(tape.data());
+        ustore_write_t write {};
+        write.db = db;
+        write.error = status.member_ptr();
+        write.arena = arena.member_ptr();
+        write.tasks_count = static_cast<ustore_size_t>(keys.size());
+        write.collections = &collection;
+        write.keys = keys.data();
+        write.keys_stride = sizeof(ustore_key_t);
+        if (received_verb == http::verb::put) {
+            write.offsets = offsets.data();
+            write.offsets_stride = sizeof(ustore_length_t);
+            write.lengths = lengths.data();
+            write.lengths_stride = sizeof(ustore_length_t);
+            write.values = &tape_begin;
+        }
+
+        ustore_write(&write);
+        if (!status)
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+
+        http::response<http::empty_body> res {http::status::ok, req.version()};
+        res.set(http::field::server, server_name_k);
+        res.keep_alive(req.keep_alive());
+        return send_response(std::move(res));
+    }
+
+    //
+    default: {
+        return send_response(make_error(req, http::status::bad_request, "Unsupported HTTP verb"));
+    }
+    }
+}
+
+/**
+ * @brief Streams the entries of a collection in key order as chunked NDJSON,
+ * one page of `{_id, _bin}` lines per chunk, so a full export is a single response.
+ * If the `limit` is reached, the last line is a `{_next: int}` cursor to resume from.
+ */
+template <typename body_at, typename allocator_at, typename send_response_at>
+void respond_to_scan(database_t& db,
+                     arena_t& arena,
+                     http::request<body_at, http::basic_fields<allocator_at>>&& req,
+                     send_response_at&& send_response) {
+
+    if (req.method() != http::verb::get)
+        return send_response(make_error(req, http::status::bad_request, "Unsupported HTTP verb"));
+
+    beast::string_view received_path = req.target();
+    auto params_begin = std::find(received_path.begin(), received_path.end(), '?');
+    auto params_str = beast::string_view {params_begin, static_cast<size_t>(received_path.end() - params_begin)};
+
+    ustore_collection_t collection = ustore_collection_main_k;
+    if (auto failure = parse_collection(db, params_str, collection); failure)
+        return send_response(make_error(req, http::status::internal_server_error, *failure));
+
+    auto parse_integer = [&](char const* name, auto& value) {
+        auto value_str = param_value(params_str, name);
+        if (!value_str)
+            return true;
+        auto result = std::from_chars(value_str->data(), value_str->data() + value_str->size(), value);
+        return result.ec == std::errc();
+    };
+
+    ustore_key_t min_key = std::numeric_limits<ustore_key_t>::min();
+    std::size_t limit = std::numeric_limits<std::size_t>::max();
+    ustore_length_t page = 1024;
+    if (!parse_integer("min=", min_key) || !parse_integer("limit=", limit) || !parse_integer("page=", page) || !page)
+        return send_response(make_error(req, http::status::bad_request, "Couldn't parse the scan arguments"));
+
+    http::response<http::empty_body> res {http::status::ok, req.version()};
+    res.set(http::field::server, server_name_k);
+    res.set(http::field::content_type, mime_ndjson_k);
+    res.keep_alive(req.keep_alive());
+    res.chunked(true);
+
+    // Every chunk is requested separately, once the previous one is sent
+    ustore_database_t c_db = db;
+    ustore_arena_t* c_arena = arena.member_ptr();
+    auto next = [=, exported = std::size_t(0), finished = false](std::string& chunk) mutable {
+        if (finished)
+            return false;
+
+        status_t status;
+        ustore_length_t count_limit = static_cast<ustore_length_t>(std::min<std::size_t>(page, limit - exported));
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c_db;
+        scan.error = status.member_ptr();
+        scan.arena = c_arena;
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &min_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        scan.values_offsets = &found_offsets;
+        scan.values = &found_values;
+
+        ustore_scan(&scan);
+        if (!status) {
+            // The status line is already sent, so the error becomes the last line
+            chunk += json_t {{"_error", status.message()}}.dump();
+            chunk.push_back('\n');
+            return false;
+        }
+
+        ustore_length_t found_count = found_counts[0];
+        for (ustore_length_t i = 0; i != found_count; ++i)
+            append_ndjson_entry(chunk,
+                                found_keys[i],
+                                found_values + found_offsets[i],
+                                found_offsets[i + 1] - found_offsets[i]);
+
+        exported += found_count;
+        bool reached_end = found_count < count_limit || //
+                           found_keys[found_count - 1] == std::numeric_limits<ustore_key_t>::max();
+        if (!reached_end)
+            min_key = found_keys[found_count - 1] + 1;
+        finished = reached_end || exported >= limit;
+        if (!reached_end && exported >= limit) {
+            chunk += "{\"_next\":";
+            chunk += std::to_string(min_key);
+            chunk += "}\n";
+        }
+        return !finished;
+    };
+    return send_response(std::move(res), next_chunk_t(std::move(next)));
+}
+
+template <typename body_at, typename allocator_at, typename send_response_at>
+void respond_to_aos(database_t& db,
+                    arena_t& arena,
                     http::request<body_at, http::basic_fields<allocator_at>>&& req,
                     send_response_at&& send_response) {
 
     http::verb received_verb = req.method();
     beast::string_view received_path = req.target();
 
-    transaction_t txn(session.db());
-    std::vector<blobs_collection_t> collections(session.db());
+    ustore_collection_t collection = ustore_collection_main_k;
     ustore_options_t options = ustore_options_default_k;
     std::vector<ustore_key_t> keys;
 
@@ -390,26 +714,8 @@ void respond_to_aos(db_session_t& session,
     }
 
     // Parse the collection name string.
-    if (auto collection_val = param_value(params_str, "col="); collection_val) {
-        char collection_name_buffer[65] = {0};
-        std::memcpy(collection_name_buffer, collection_val->data(), std::min(collection_val->size(), 64ul));
-
-        status_t status;
-        blobs_collection_t collection(session.db());
-        ustore_collection_create_t collection_init {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .name = collection_name_buffer,
-            .id = &collection.raw,
-        };
-
-        ustore_collection_create(&collection_init);
-        if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
-
-        collections.raw_array.emplace_back(std::exchange(collection.raw, nullptr));
-        // ustore_option_read_colocated(&options, true);
-    }
+    if (auto failure = parse_collection(db, params_str, collection); failure)
+        return send_response(make_error(req, http::status::internal_server_error, *failure));
 
     // Make sure we support the requested content type
     auto payload_type = req[http::field::content_type];
@@ -546,20 +852,52 @@ void respond_to_aos(db_session_t& session,
  * @brief Primary dispatch point, routing incoming HTTP requests
  *        into underlying UStore calls, preparing results and sending back.
  */
+/**
+ * @brief Exports the counters and latency histograms of the engine calls,
+ * in the text format scraped by Prometheus.
+ */
 template <typename body_at, typename allocator_at, typename send_response_at>
-void route_request(db_session_t& session,
+void respond_to_metrics(database_t& db,
+                        arena_t& arena,
+                        http::request<body_at, http::basic_fields<allocator_at>>&& req,
+                        send_response_at&& send_response) {
+
+    if (req.method() != http::verb::get)
+        return send_response(make_error(req, http::status::bad_request, "Unsupported HTTP verb"));
+
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.arena = arena.member_ptr();
+    control.error = status.member_ptr();
+    control.request = "metrics/prometheus";
+    control.response = &response;
+
+    ustore_database_control(&control);
+    if (!status)
+        return send_response(make_error(req, http::status::not_implemented, status.message()));
+
+    http::response<http::string_body> res {http::status::ok, req.version()};
+    res.set(http::field::server, server_name_k);
+    res.set(http::field::content_type, mime_prometheus_k);
+    res.keep_alive(req.keep_alive());
+    res.body() = std::string(response);
+    res.prepare_payload();
+    return send_response(std::move(res));
+}
+
+template <typename body_at, typename allocator_at, typename send_response_at>
+void route_request(database_t& db,
+                   arena_t& arena,
                    http::request<body_at, http::basic_fields<allocator_at>>&& req,
                    send_response_at&& send_response) {
 
-    http::verb received_verb = req.method();
     beast::string_view received_path = req.target();
-    fmt::print("Received path: {} {}\n",
-               std::string(beast::http::to_string(received_verb)),
-               std::string(received_path));
 
     // Modifying single entries:
     if (received_path.starts_with("/one/"))
-        return respond_to_one(session, std::move(req), send_response);
+        return respond_to_one(db, arena, std::move(req), send_response);
 
     // Modifying collections:
     else if (received_path.starts_with("/col/")) {
@@ -575,7 +913,15 @@ void route_request(db_session_t& session,
 
     // Array-of-Structures:
     else if (received_path.starts_with("/aos/"))
-        return respond_to_aos(session, std::move(req), send_response);
+        return respond_to_aos(db, arena, std::move(req), send_response);
+
+    // Batches of binary values:
+    else if (received_path.starts_with("/batch/"))
+        return respond_to_batch(db, arena, std::move(req), send_response);
+
+    // Exporting whole collections:
+    else if (received_path.starts_with("/scan/"))
+        return respond_to_scan(db, arena, std::move(req), send_response);
 
     // Structure-of-Arrays:
     else if (received_path.starts_with("/soa/"))
@@ -585,50 +931,123 @@ void route_request(db_session_t& session,
     else if (received_path.starts_with("/arrow/"))
         return send_response(make_error(req, http::status::bad_request, "Batch API aren't implemented yet"));
 
+    // Monitoring:
+    else if (received_path == "/metrics")
+        return respond_to_metrics(db, arena, std::move(req), send_response);
+
     return send_response(make_error(req, http::status::bad_request, "Unknown request"));
 }
 
 /**
  * @brief A communication channel/session for a single client.
+ *
+ * ## Threading
+ *
+ * Sockets are only touched from the connections strand, on the I/O threads.
+ * Requests are answered on the worker threads of `db_w_clients_t`, so that
+ * slow disk reads don't stall the other connections sharing an I/O thread.
+ *
+ * ## Pipelining
+ *
+ * HTTP/1.1 clients may send the next request before receiving the previous
+ * answer. We keep reading, while fewer than `pipeline_limit_k` requests are
+ * in flight, and answer them strictly in the order of arrival, even if the
+ * workers complete them in a different one. Connections stay open, unless
+ * the client or the response asks to close them.
+ *
+ * ## Memory
+ *
+ * Every request gets its own arena, which outlives the sent response,
+ * so the bodies may point into the memory exported by the database.
  */
 class web_db_session_t : public std::enable_shared_from_this<web_db_session_t> {
+
+    static constexpr std::size_t pipeline_limit_k = 16;
+    static constexpr std::size_t body_limit_k = 64ul * 1024ul * 1024ul;
+
+    /**
+     * @brief A request in flight, and later its response.
+     * Mutated only on the strand, except for the `arena`,
+     * owned by the worker until the response is posted back.
+     */
+    struct pending_t {
+        arena_t arena;
+        std::shared_ptr<void> response;
+        std::function<void()> write;
+
+        pending_t(ustore_database_t db) noexcept : arena(db) {}
+    };
+
     // This is the C++11 equivalent of a generic lambda.
     // The function object is used to send an HTTP message.
-    struct send_request_t {
-        web_db_session_t& self_;
-
-        explicit send_request_t(web_db_session_t& self) noexcept : self_(self) {}
+    struct send_response_t {
+        std::shared_ptr<web_db_session_t> self_;
+        std::shared_ptr<pending_t> pending_;
 
-        template <bool ir_request_ak, typename body_at, typename fields_at>
-        void operator()(http::message<ir_request_ak, body_at, fields_at>&& msg) const {
+        template <bool is_request_ak, typename body_at, typename fields_at>
+        void operator()(http::message<is_request_ak, body_at, fields_at>&& msg) const {
             // The lifetime of the message has to extend
             // for the duration of the async operation so
             // we use a `std::shared_ptr` to manage it.
-            auto sp = std::make_shared<http::message<ir_request_ak, body_at, fields_at>>(std::move(msg));
-
-            // Store a type-erased version of the shared
-            // pointer in the class to keep it alive.
-            self_.res_ = sp;
+            auto sp = std::make_shared<http::message<is_request_ak, body_at, fields_at>>(std::move(msg));
+
+            // The socket can only be touched from the strand
+            net::post(self_->stream_.get_executor(), [self = self_, pending = pending_, sp] {
+                // Store a type-erased version of the shared
+                // pointer in the class to keep it alive.
+                pending->response = sp;
+                pending->write = [raw_self = self.get(), raw_sp = sp.get()] {
+                    http::async_write(raw_self->stream_,
+                                      *raw_sp,
+                                      beast::bind_front_handler(&web_db_session_t::on_write,
+                                                                raw_self->shared_from_this(),
+                                                                raw_sp->need_eof()));
+                };
+                self->do_write();
+            });
+        }
 
-            // Write the response
-            http::async_write(
-                self_.stream_,
-                *sp,
-                beast::bind_front_handler(&web_db_session_t::on_write, self_.shared_from_this(), sp->need_eof()));
+        /**
+         * @brief Sends the `header` and then the chunks produced by `next` on the workers,
+         * one after another, until it reports the last one.
+         */
+        void operator()(http::response<http::empty_body>&& header, next_chunk_t&& next) const {
+            auto stream = std::make_shared<stream_t>(std::move(header), std::move(next));
+            net::post(self_->stream_.get_executor(), [self = self_, pending = pending_, stream] {
+                pending->response = stream;
+                pending->write = [raw_self = self.get(), raw_stream = stream.get()] {
+                    raw_self->write_stream(raw_stream->shared_from_this());
+                };
+                self->do_write();
+            });
         }
     };
 
+    struct stream_t : public std::enable_shared_from_this<stream_t> {
+        http::response<http::empty_body> header;
+        http::response_serializer<http::empty_body> serializer;
+        next_chunk_t next;
+        std::string chunk;
+        bool is_last = false;
+
+        stream_t(http::response<http::empty_body>&& header, next_chunk_t&& next)
+            : header(std::move(header)), serializer(this->header), next(std::move(next)) {}
+    };
+
     beast::tcp_stream stream_;
     beast::flat_buffer buffer_;
     std::shared_ptr<db_w_clients_t> db_;
-    db_session_t db_session_;
-    http::request<http::string_body> req_;
-    std::shared_ptr<void> res_;
-    send_request_t send_request_;
+    std::optional<http::request_parser<http::string_body>> parser_;
+
+    /// @brief Requests in the order of arrival, answered from the front.
+    std::deque<std::shared_ptr<pending_t>> pipeline_;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool closing_ = false;
 
   public:
     web_db_session_t(tcp::socket&& socket, std::shared_ptr<db_w_clients_t> const& session)
-        : stream_(std::move(socket)), db_(session), db_session_(session->session()), send_request_(*this) {}
+        : stream_(std::move(socket)), db_(session) {}
 
     /**
      * @brief Start the asynchronous operation.
@@ -643,9 +1062,14 @@ class web_db_session_t : public std::enable_shared_from_this<web_db_session_t> {
     }
 
     void do_read() {
+        if (reading_ || closing_ || pipeline_.size() >= pipeline_limit_k)
+            return;
+
         // Make the request empty before reading,
         // otherwise the operation behavior is undefined.
-        req_ = {};
+        parser_.emplace();
+        parser_->body_limit(body_limit_k);
+        reading_ = true;
 
         // Set the timeout.
         stream_.expires_after(std::chrono::seconds(30));
@@ -653,27 +1077,56 @@ class web_db_session_t : public std::enable_shared_from_this<web_db_session_t> {
         // Read a request
         http::async_read(stream_,
                          buffer_,
-                         req_,
+                         *parser_,
                          beast::bind_front_handler(&web_db_session_t::on_read, shared_from_this()));
     }
 
     void on_read(beast::error_code ec, std::size_t bytes_transferred) {
         boost::ignore_unused(bytes_transferred);
-
-        if (ec == http::error::end_of_stream)
-            // This means they closed the connection
-            return do_close();
+        reading_ = false;
+
+        // This means they closed the connection, or timed out.
+        // Finish answering the pipelined requests first.
+        if (ec == http::error::end_of_stream || ec == beast::error::timeout) {
+            closing_ = true;
+            if (pipeline_.empty())
+                do_close();
+            return;
+        }
 
         if (ec)
             return log_failure(ec, "read");
 
-        // send_at the response
-        route_request(db_session_, std::move(req_), send_request_);
+        http::request<http::string_body> req = parser_->release();
+        closing_ = !req.keep_alive();
+
+        // Hand it to the workers, keeping the slot for the answer
+        auto pending = std::make_shared<pending_t>(db_->session);
+        pipeline_.push_back(pending);
+        net::post(db_->workers,
+                  [send = send_response_t {shared_from_this(), pending}, req = std::move(req)]() mutable {
+                      route_request(send.self_->db_->session, send.pending_->arena, std::move(req), send);
+                  });
+
+        // Proceed with the next pipelined request
+        do_read();
+    }
+
+    void do_write() {
+        if (writing_ || pipeline_.empty() || !pipeline_.front()->write)
+            return;
+
+        writing_ = true;
+        pipeline_.front()->write();
     }
 
     void on_write(bool close, beast::error_code ec, std::size_t bytes_transferred) {
         boost::ignore_unused(bytes_transferred);
 
+        // We're done with the response so delete it
+        writing_ = false;
+        pipeline_.pop_front();
+
         if (ec)
             return log_failure(ec, "write");
 
@@ -682,14 +1135,54 @@ class web_db_session_t : public std::enable_shared_from_this<web_db_session_t> {
             // the response indicated the "Connection: close" semantic.
             return do_close();
 
-        // We're done with the response so delete it
-        res_ = nullptr;
+        if (closing_ && pipeline_.empty())
+            return do_close();
 
-        // Read another request
+        // Send the next completed response and read another request
+        do_write();
         do_read();
     }
 
+    void write_stream(std::shared_ptr<stream_t> stream) {
+        stream_.expires_after(std::chrono::seconds(30));
+        http::async_write_header(stream_, stream->serializer, [self = shared_from_this(), stream](auto ec, auto n) {
+            if (ec)
+                return self->on_write(true, ec, n);
+            self->produce_chunk(std::move(stream));
+        });
+    }
+
+    void produce_chunk(std::shared_ptr<stream_t> stream) {
+        net::post(db_->workers, [self = shared_from_this(), stream]() mutable {
+            stream->chunk.clear();
+            stream->is_last = !stream->next(stream->chunk);
+            net::post(self->stream_.get_executor(),
+                      [self, stream = std::move(stream)]() mutable { self->write_chunk(std::move(stream)); });
+        });
+    }
+
+    void write_chunk(std::shared_ptr<stream_t> stream) {
+        auto on_chunk = [self = shared_from_this(), stream](beast::error_code ec, std::size_t n) {
+            if (ec)
+                return self->on_write(true, ec, n);
+            if (!stream->is_last)
+                return self->produce_chunk(std::move(stream));
+            net::async_write(self->stream_,
+                             http::make_chunk_last(),
+                             beast::bind_front_handler(&web_db_session_t::on_write,
+                                                       self,
+                                                       stream->header.need_eof()));
+        };
+
+        // Empty chunks would be mistaken for the last one
+        stream_.expires_after(std::chrono::seconds(30));
+        if (stream->chunk.empty())
+            return on_chunk({}, 0);
+        net::async_write(stream_, http::make_chunk(net::buffer(stream->chunk)), std::move(on_chunk));
+    }
+
     void do_close() {
+        closing_ = true;
         beast::error_code ec;
         stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
     }
@@ -764,10 +1257,11 @@ int main(int argc, char* argv[]) {
 
     // Check command line arguments
     if (argc < 4) {
-        std::cerr << "Usage: ustore_beast_server <address> <port> <threads> <db_config_path>?\n"
+        std::cerr << "Usage: ustore_beast_server <address> <port> <threads> <db_config_path>? <workers>?\n"
                   << "Example:\n"
                   << "    ustore_beast_server 0.0.0.0 8080 1\n"
                   << "    ustore_beast_server 0.0.0.0 8080 1 ./config.json\n"
+                  << "    ustore_beast_server 0.0.0.0 8080 1 ./config.json 16\n"
                   << "";
         return EXIT_FAILURE;
     }
@@ -776,6 +1270,8 @@ int main(int argc, char* argv[]) {
     auto const address = net::ip::make_address(argv[1]);
     auto const port = static_cast<unsigned short>(std::atoi(argv[2]));
     auto const threads = std::max<int>(1, std::atoi(argv[3]));
+    auto const workers = argc >= 6 ? std::max<int>(1, std::atoi(argv[5]))
+                                   : std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()));
     auto db_config = std::string();
 
     // Read the configuration file
@@ -788,17 +1284,10 @@ int main(int argc, char* argv[]) {
     }
 
     // Check if we can initialize the DB
-    auto session = std::make_shared<db_w_clients_t>();
-    status_t status;
-    ustore_database_init_t database {
-        .config = db_config.c_str(),
-        .db = &session->raw,
-        .error = error.member_ptr(),
-    };
-
-    ustore_database_init(&database);
+    auto session = std::make_shared<db_w_clients_t>(static_cast<std::size_t>(workers));
+    status_t status = session->session.open(db_config.c_str());
     if (!status) {
-        std::cerr << "Couldn't initialize DB: " << error.raw << std::endl;
+        std::cerr << "Couldn't initialize DB: " << status.message() << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -813,5 +1302,6 @@ int main(int argc, char* argv[]) {
         v.emplace_back([&io_context] { io_context.run(); });
     io_context.run();
 
+    session->workers.join();
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -5,12 +5,17 @@
 #include <unistd.h>   // `close` files
 
 #include <ctime>
+#include <cctype>
 #include <vector>
 #include <cstring>
+#include <limits>
 #include <numeric>
 #include <fstream>
 #include <algorithm>
 #include <filesystem>
+#include <mutex>              // `std::mutex`
+#include <thread>             // `std::thread`
+#include <condition_variable> // `std::condition_variable`
 
 #include <arrow/api.h>
 #include <arrow/array.h>
@@ -23,6 +28,8 @@
 #include <arrow/io/api.h>
 #include <arrow/io/file.h>
 #include <arrow/compute/api_aggregate.h>
+#include <arrow/compute/cast.h>
+#include <arrow/ipc/writer.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/stream_writer.h>
 
@@ -32,6 +39,7 @@
 #include <ustore/ustore.hpp>
 #include <ustore/cpp/ranges.hpp>
 #include <ustore/cpp/blobs_range.hpp>      // `keys_stream_t`
+#include <ustore/cpp/windows_prefetch.hpp> // `windows_prefetch_gt`
 #include <../helpers/linked_memory.hpp> // `linked_memory_lock_t`
 
 #include "dataset.h"
@@ -54,7 +62,6 @@ using counts_t = ptr_range_gt<ustore_size_t>;
 using chunked_array_t = std::shared_ptr<arrow::ChunkedArray>;
 using array_t = std::shared_ptr<arrow::Array>;
 using int_builder_t = arrow::NumericBuilder<arrow::Int64Type>;
-using docs_t = ptr_range_gt<value_view_t>;
 
 enum ustore_dataset_ext_t {
     parquet_k = 0,
@@ -599,13 +606,13 @@ void fields_parser( //
 
 #pragma region - Upserting
 
-void upsert_docs(ustore_docs_import_t& c, docs_t& docs, ustore_size_t task_count) {
+void upsert_docs(ustore_docs_import_t& c, ustore_arena_t* arena, value_view_t const* docs, ustore_size_t task_count) {
 
     ustore_docs_write_t docs_write {
         .db = c.db,
         .error = c.error,
-        .arena = c.arena,
-        .options = ustore_option_dont_discard_memory_k,
+        .arena = arena,
+        .options = ustore_options_t(c.options & ustore_option_write_bulk_k),
         .tasks_count = task_count,
         .type = ustore_doc_field_json_k,
         .modification = ustore_doc_modify_upsert_k,
@@ -622,473 +629,819 @@ void upsert_docs(ustore_docs_import_t& c, docs_t& docs, ustore_size_t task_count
 
 #pragma endregion - Upserting
 
-#pragma region - Docs
-
-void import_parquet(ustore_docs_import_t& c, std::shared_ptr<arrow::Table>& table, ustore_size_t& rows_count) {
-
-    arrow::Status status;
-    arrow::MemoryPool* pool = arrow::default_memory_pool();
-
-    // Open File
-    auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
-    return_error_if_m(maybe_input.ok(), c.error, 0, status.ToString().c_str());
-    auto input = *maybe_input;
-
-    std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-    status = parquet::arrow::OpenFile(input, pool, &arrow_reader);
-    return_error_if_m(status.ok(), c.error, 0, status.ToString().c_str());
-
-    // Read File into table
-    status = arrow_reader->ReadTable(&table);
-    return_error_if_m(status.ok(), c.error, 0, status.ToString().c_str());
-}
-
-void import_csv(ustore_docs_import_t& c, std::shared_ptr<arrow::Table>& table) {
-
-    arrow::io::IOContext io_context = arrow::io::default_io_context();
-    auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
-    return_error_if_m(maybe_input.ok(), c.error, 0, "Can't open file");
-    std::shared_ptr<arrow::io::InputStream> input = *maybe_input;
-
-    auto read_options = arrow::csv::ReadOptions::Defaults();
-    auto parse_options = arrow::csv::ParseOptions::Defaults();
-    auto convert_options = arrow::csv::ConvertOptions::Defaults();
-
-    // Instantiate TableReader from input stream and options
-    auto maybe_reader = arrow::csv::TableReader::Make(io_context, input, read_options, parse_options, convert_options);
-    return_error_if_m(maybe_reader.ok(), c.error, 0, "Can't instantiate reader");
-    std::shared_ptr<arrow::csv::TableReader> reader = *maybe_reader;
-
-    // Read table from CSV file
-    auto maybe_table = reader->Read();
-    return_error_if_m(maybe_table.ok(), c.error, 0, "Can't read file");
-    table = *maybe_table;
-}
+#pragma region - Pipeline
 
-void parse_arrow_table(ustore_docs_import_t& c, std::shared_ptr<arrow::Table> const& table) {
+/**
+ * @brief A slice of the input, and the documents or edges parsed from it.
+ * Documents either reference the input directly, or the rebuilt `tape`.
+ */
+struct import_batch_t {
+    enum class state_t { free_k, parsing_k, ready_k };
 
-    fields_t fields;
-    ustore_size_t used_mem = 0;
-    ustore_char_t* field = nullptr;
-    std::string json = "{";
-    ustore_char_t* json_cstr = nullptr;
-    arrow_visitor_t visitor(json);
-    auto arena = linked_memory(c.arena, c.options, c.error);
+    state_t state = state_t::free_k;
+    ustore_error_t error = nullptr;
 
-    if (!c.fields) {
-        auto clmn_names = table->ColumnNames();
-        c.fields_count = clmn_names.size();
-        auto names = arena.alloc<ustore_str_view_t>(c.fields_count, c.error);
-
-        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx) {
-            field = arena.alloc<ustore_char_t>(clmn_names[idx].size() + 1, c.error).begin();
-            std::memcpy(field, clmn_names[idx].data(), clmn_names[idx].size() + 1);
-            names[idx] = field;
-        }
+    std::string_view text;
+    int row_group = 0;
+    std::shared_ptr<arrow::Table> table;
 
-        c.fields_stride = sizeof(ustore_str_view_t);
-        fields = fields_t {names.begin(), c.fields_stride};
-    }
-    else {
-        fields = fields_t {c.fields, c.fields_stride};
-        c.fields_count = c.fields_count;
+    std::string tape;
+    std::vector<std::size_t> ends;
+    std::vector<value_view_t> docs;
+    std::vector<edge_t> edges;
+
+    void reset() noexcept {
+        state = state_t::free_k;
+        error = nullptr;
+        text = {};
+        table.reset();
+        tape.clear();
+        ends.clear();
+        docs.clear();
+        edges.clear();
     }
 
-    auto columns = arena.alloc<chunked_array_t>(c.fields_count, c.error);
-    auto chunks = arena.alloc<array_t>(c.fields_count, c.error);
-
-    auto columns_begin = columns.begin();
-    auto chunks_begin = chunks.begin();
-
-    for (ustore_size_t idx = 0; idx < c.fields_count; ++idx, ++columns_begin, ++chunks_begin) {
-        new (columns_begin) chunked_array_t();
-        new (chunks_begin) array_t();
-        chunked_array_t column = table->GetColumnByName(fields[idx]);
-        return_error_if_m(column, c.error, 0, fmt::format("{} is not exist", fields[idx]).c_str());
-        columns[idx] = column;
+    /// @brief Adds views of the documents rebuilt in the `tape`, once it won't be reallocated.
+    void export_tape() {
+        docs.reserve(docs.size() + ends.size());
+        for (std::size_t idx = 0, begin = 0; idx != ends.size(); begin = ends[idx], ++idx)
+            docs.emplace_back(reinterpret_cast<ustore_bytes_cptr_t>(tape.data() + begin), ends[idx] - begin);
     }
+};
 
-    ustore_size_t count = columns[0]->num_chunks();
-    auto values = arena.alloc<value_view_t>(table->num_rows(), c.error);
-
-    ustore_size_t idx = 0;
-    for (ustore_size_t chunk_idx = 0, g_idx = 0; chunk_idx != count; ++chunk_idx, g_idx = 0) {
+/**
+ * @brief Threads with inputs of slower formats can burn through many megabytes of JSON per second,
+ * so batches are capped to keep the memory usage of the pipeline under `2 * threads * 64 MB`,
+ * regardless of `max_batch_size` and the size of the input.
+ */
+constexpr ustore_size_t parsed_batch_limit_k = 64ul * 1024ul * 1024ul;
 
-        for (auto column : columns) {
-            chunks[g_idx] = column->chunk(chunk_idx);
-            ++g_idx;
-        }
-
-        for (ustore_size_t value_idx = 0; value_idx < columns[0]->chunk(chunk_idx)->length(); ++value_idx) {
+template <typename task_at>
+ustore_size_t threads_count(task_at const& c) noexcept {
+    ustore_size_t count = c.threads_count ? c.threads_count : std::thread::hardware_concurrency();
+    return std::max<ustore_size_t>(count, 1);
+}
 
-            g_idx = 0;
-            for (auto it = fields; g_idx < c.fields_count; ++g_idx, ++it) {
-                fmt::format_to(std::back_inserter(json), "\"{}\":", *it);
-                visitor.idx = value_idx;
-                arrow::VisitArrayInline(*chunks[g_idx].get(), &visitor);
+/**
+ * @brief Imports a dataset in three stages:
+ * 1. `fetch` picks the next slice of the input, one batch at a time, under a lock.
+ * 2. `parse` converts it to documents or edges on one of `c.threads_count` threads.
+ * 3. `write` gets the batches on the calling thread, in the order they were fetched,
+ *    so that later duplicates still overwrite the earlier ones.
+ *
+ * Batches are recycled through a fixed ring of slots, so that parsers stall, instead
+ * of buffering, when the writes fall behind.
+ */
+template <typename task_at, typename fetch_at, typename parse_at, typename write_at>
+void import_in_parallel(task_at& c, fetch_at&& fetch, parse_at&& parse, write_at&& write) {
+
+    using state_t = import_batch_t::state_t;
+    std::vector<import_batch_t> slots(threads_count(c) * 2);
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t fetched = 0;
+    bool exhausted = false;
+    bool stopped = false;
+
+    auto work = [&](std::size_t thread_idx) {
+        std::unique_lock lock(mutex);
+        while (true) {
+            changed.wait(lock, [&] {
+                return stopped || exhausted || slots[fetched % slots.size()].state == state_t::free_k;
+            });
+            if (stopped || exhausted)
+                return;
+
+            import_batch_t& batch = slots[fetched % slots.size()];
+            bool has_more = false;
+            try {
+                has_more = fetch(batch);
+            }
+            catch (...) {
+                batch.error = "Failed to read the dataset";
+                has_more = true;
+            }
+            if (!has_more) {
+                exhausted = true;
+                changed.notify_all();
+                return;
             }
 
-            json[json.size() - 1] = '}';
-            json.push_back('\n');
-            json_cstr = arena.alloc<ustore_char_t>(json.size() + 1, c.error).begin();
-            std::memcpy(json_cstr, json.data(), json.size() + 1);
-
-            values[idx] = json_cstr;
-            used_mem += json.size();
-            json = "{";
-            ++idx;
-
-            if (used_mem >= c.max_batch_size) {
-                upsert_docs(c, values, idx);
-                used_mem = 0;
-                idx = 0;
+            ++fetched;
+            batch.state = state_t::parsing_k;
+            lock.unlock();
+            if (!batch.error) {
+                try {
+                    parse(thread_idx, batch);
+                }
+                catch (simdjson::simdjson_error const& ex) {
+                    batch.error = simdjson::error_message(ex.error());
+                }
+                catch (...) {
+                    batch.error = "Failed to parse the dataset";
+                }
             }
+            lock.lock();
+            batch.state = state_t::ready_k;
+            changed.notify_all();
         }
-    }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
-}
+    };
 
-void import_whole_ndjson(ustore_docs_import_t& c, simdjson::ondemand::document_stream& docs, ustore_size_t rows_count) {
+    std::vector<std::thread> threads;
+    threads.reserve(slots.size() / 2);
+    for (std::size_t thread_idx = 0; thread_idx != slots.size() / 2; ++thread_idx)
+        threads.emplace_back(work, thread_idx);
+
+    for (std::size_t written = 0; !*c.error; ++written) {
+        import_batch_t& batch = slots[written % slots.size()];
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return batch.state == state_t::ready_k || (exhausted && written == fetched); });
+            if (batch.state != state_t::ready_k)
+                break;
+        }
 
-    ustore_size_t idx = 0;
-    ustore_size_t used_mem = 0;
+        if (batch.error)
+            *c.error = batch.error;
+        else
+            write(batch);
 
-    auto arena = linked_memory(c.arena, c.options, c.error);
-    auto values = arena.alloc<value_view_t>(rows_count, c.error);
+        std::unique_lock lock(mutex);
+        batch.reset();
+        changed.notify_all();
+    }
 
-    for (auto doc : docs) {
-        simdjson::ondemand::object object = doc.get_object().value();
-        values[idx] = rewinded(object).raw_json().value();
-        used_mem += values[idx].size();
-        ++idx;
-        if (used_mem >= c.max_batch_size) {
-            upsert_docs(c, values, idx);
-            idx = 0;
-        }
+    {
+        std::unique_lock lock(mutex);
+        stopped = true;
+        changed.notify_all();
     }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
+    for (auto& thread : threads)
+        thread.join();
 }
 
-void import_sub_ndjson(ustore_docs_import_t& c,
-                       simdjson::ondemand::document_stream& docs,
-                       ustore_size_t rows_count) noexcept {
+/**
+ * @brief Reads row groups in parallel, each thread with its own reader of the file,
+ * as Parquet decoding dominates the import time.
+ */
+template <typename task_at, typename prepare_at, typename parse_at, typename write_at>
+void import_parquet(task_at& c, prepare_at&& prepare, parse_at&& parse, write_at&& write) {
 
-    auto arena = linked_memory(c.arena, c.options, c.error);
-    auto fields = prepare_fields(c, arena);
-    ustore_size_t max_size = c.fields_count * symbols_count_k;
-    for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
-        max_size += strlen(fields[idx]);
-
-    auto values = arena.alloc<value_view_t>(rows_count, c.error);
-
-    ustore_size_t used_mem = 0;
-    std::string json = "{";
-    ustore_char_t* json_cstr = nullptr;
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+    auto open_reader = [&](std::unique_ptr<parquet::arrow::FileReader>& reader) {
+        auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
+        if (!maybe_input.ok())
+            return false;
+        return parquet::arrow::OpenFile(*maybe_input, pool, &reader).ok();
+    };
 
-    counts_t counts = arena.alloc<ustore_size_t>(c.fields_count, c.error);
+    std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
+    return_error_if_m(open_reader(arrow_reader), c.error, 0, "Can't open file");
+    std::shared_ptr<arrow::Schema> schema;
+    return_error_if_m(arrow_reader->GetSchema(&schema).ok(), c.error, 0, "Can't read the schema");
+    prepare(*schema);
     return_if_error_m(c.error);
 
-    auto tape = arena.alloc<ustore_char_t>(max_size, c.error);
-    return_if_error_m(c.error);
-    fields_parser(c.error, arena, c.fields_count, fields, counts, tape);
+    int row_groups_count = arrow_reader->num_row_groups();
+    int next_row_group = 0;
+    std::vector<std::unique_ptr<parquet::arrow::FileReader>> readers(threads_count(c));
+    readers[0] = std::move(arrow_reader);
+
+    import_in_parallel(
+        c,
+        [&](import_batch_t& batch) {
+            if (next_row_group == row_groups_count)
+                return false;
+            batch.row_group = next_row_group++;
+            return true;
+        },
+        [&](std::size_t thread_idx, import_batch_t& batch) {
+            auto& reader = readers[thread_idx];
+            if (!reader && !open_reader(reader)) {
+                batch.error = "Can't open file";
+                return;
+            }
+            if (!reader->ReadRowGroup(batch.row_group, &batch.table).ok()) {
+                batch.error = "Can't read a row group";
+                return;
+            }
+            parse(*batch.table, batch);
+            batch.table.reset();
+        },
+        write);
+}
 
-    ustore_size_t idx = 0;
-    for (auto doc : docs) {
-        simdjson::ondemand::object object = doc.get_object().value();
+/**
+ * @brief Streams the file in blocks, that Arrow parses ahead of time on its own pool,
+ * while our threads convert the previous blocks.
+ */
+template <typename task_at, typename prepare_at, typename parse_at, typename write_at>
+void import_csv(task_at& c, prepare_at&& prepare, parse_at&& parse, write_at&& write) {
 
-        try {
-            simdjson_object_parser(object, counts, fields, c.fields_count, tape, json);
-        }
-        catch (simdjson::simdjson_error const& ex) {
-            *c.error = ex.what();
-            return_if_error_m(c.error);
-        }
+    arrow::io::IOContext io_context = arrow::io::default_io_context();
+    auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
+    return_error_if_m(maybe_input.ok(), c.error, 0, "Can't open file");
+    std::shared_ptr<arrow::io::InputStream> input = *maybe_input;
 
-        json.push_back('\n');
-        json_cstr = arena.alloc<ustore_char_t>(json.size() + 1, c.error).begin();
-        std::memcpy(json_cstr, json.data(), json.size() + 1);
+    auto read_options = arrow::csv::ReadOptions::Defaults();
+    auto parse_options = arrow::csv::ParseOptions::Defaults();
+    auto convert_options = arrow::csv::ConvertOptions::Defaults();
+    read_options.block_size = static_cast<std::int32_t>(std::min(c.max_batch_size, parsed_batch_limit_k / 4));
 
-        values[idx] = json_cstr;
-        used_mem += json.size();
-        json = "{";
-        ++idx;
+    auto maybe_reader =
+        arrow::csv::StreamingReader::Make(io_context, input, read_options, parse_options, convert_options);
+    return_error_if_m(maybe_reader.ok(), c.error, 0, "Can't instantiate reader");
+    std::shared_ptr<arrow::csv::StreamingReader> reader = *maybe_reader;
+    prepare(*reader->schema());
+    return_if_error_m(c.error);
 
-        if (used_mem >= c.max_batch_size) {
-            upsert_docs(c, values, idx);
-            idx = 0;
-        }
-    }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
+    import_in_parallel(
+        c,
+        [&](import_batch_t& batch) {
+            std::shared_ptr<arrow::RecordBatch> record_batch;
+            if (!reader->ReadNext(&record_batch).ok()) {
+                batch.error = "Can't read file";
+                return true;
+            }
+            if (!record_batch)
+                return false;
+            auto maybe_table = arrow::Table::FromRecordBatches({record_batch});
+            if (!maybe_table.ok())
+                batch.error = "Can't read file";
+            else
+                batch.table = *maybe_table;
+            return true;
+        },
+        [&](std::size_t, import_batch_t& batch) {
+            parse(*batch.table, batch);
+            batch.table.reset();
+        },
+        write);
 }
 
-void import_ndjson_docs(ustore_docs_import_t& c) {
+/**
+ * @brief Splits the memory-mapped file into newline-aligned slices, parsed by different threads.
+ * The `parse` callback receives every object, while the `batch.text` it references is mapped.
+ */
+template <typename task_at, typename parse_at, typename write_at>
+void import_ndjson(task_at& c, parse_at&& parse, write_at&& write) {
 
     auto handle = open(c.paths_pattern, O_RDONLY);
     return_error_if_m(handle != -1, c.error, 0, "Can't open file");
 
     ustore_size_t file_size = std::filesystem::file_size(std::filesystem::path(c.paths_pattern));
+    if (!file_size) {
+        close(handle);
+        return;
+    }
     auto begin = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    if (begin == MAP_FAILED) {
+        close(handle);
+        return_error_m(c.error, "Can't map file");
+    }
     std::string_view mapped_content = std::string_view(reinterpret_cast<ustore_char_t const*>(begin), file_size);
     madvise(begin, file_size, MADV_SEQUENTIAL);
 
-    std::ifstream file(c.paths_pattern);
-    ustore_size_t rows_count =
-        std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n') + 1;
-
-    simdjson::ondemand::parser parser;
-    simdjson::ondemand::document_stream docs = parser.iterate_many( //
-        mapped_content.data(),
-        mapped_content.size(),
-        1000000ul);
-
-    if (!c.fields)
-        import_whole_ndjson(c, docs, rows_count);
-    else
-        import_sub_ndjson(c, docs, rows_count);
+    ustore_size_t slice_size = std::min(c.max_batch_size, parsed_batch_limit_k);
+    ustore_size_t offset = 0;
+    std::vector<simdjson::ondemand::parser> parsers(threads_count(c));
+
+    import_in_parallel(
+        c,
+        [&](import_batch_t& batch) {
+            if (offset == mapped_content.size())
+                return false;
+            std::size_t end = mapped_content.size();
+            if (mapped_content.size() - offset > slice_size) {
+                std::size_t new_line = mapped_content.find('\n', offset + slice_size - 1);
+                end = new_line == std::string_view::npos ? end : new_line + 1;
+            }
+            batch.text = mapped_content.substr(offset, end - offset);
+            offset = end;
+            return true;
+        },
+        [&](std::size_t thread_idx, import_batch_t& batch) {
+            simdjson::ondemand::document_stream docs = parsers[thread_idx].iterate_many( //
+                batch.text.data(),
+                batch.text.size(),
+                std::max<std::size_t>(batch.text.size(), 1000000ul));
+
+            for (auto doc : docs) {
+                simdjson::ondemand::object object = doc.get_object().value();
+                parse(object, batch);
+            }
+            batch.export_tape();
+        },
+        write);
 
-    munmap((void*)mapped_content.data(), mapped_content.size());
+    munmap(begin, file_size);
     close(handle);
 }
 
-void export_whole_docs( //
-    ustore_error_t* error,
-    linked_memory_lock_t& arena,
-    ptr_range_gt<ustore_key_t const>& keys,
-    ptr_range_gt<ustore_key_t>* keys_ptr,
-    ptr_range_gt<ustore_char_t*>* docs_ptr,
-    parquet::StreamWriter* os_ptr,
-    val_t const& values,
-    int handle,
-    ext_t pcn) {
-
-    ptr_range_gt<ustore_char_t*>& docs_vec = *docs_ptr;
-    ptr_range_gt<ustore_key_t>& keys_vec = *keys_ptr;
-    parquet::StreamWriter& os = *os_ptr;
-
-    ustore_size_t idx = 0;
-    auto iter = keys.begin();
-
-    simdjson::ondemand::parser parser;
-    simdjson::ondemand::document_stream docs = parser.iterate_many( //
-        values.first,
-        values.second,
-        1000000ul);
-
-    for (auto doc : docs) {
-        simdjson::ondemand::object obj = doc.get_object().value();
-        auto value = rewinded(obj).raw_json().value();
-        auto json = std::string(value.data(), value.size());
-        json.pop_back();
-
-        if (pcn == parquet_k) {
-            os << *iter << json.data();
-            os << parquet::EndRow;
-        }
-        else if (pcn == csv_k) {
-            keys_vec[idx] = *iter;
-            docs_vec[idx] = arena.alloc<ustore_char_t>(json.size() + 1, error).begin();
-            std::memcpy(docs_vec[idx], json.data(), json.size() + 1);
-            ++idx;
-        }
-        else {
-            auto str = fmt::format("{{\"_id\":{},\"doc\":{}}}\n", *iter, json.data());
-            write(handle, str.data(), str.size());
-        }
-        ++iter;
-    }
-}
+#pragma endregion - Pipeline
 
-void export_sub_docs( //
-    ustore_docs_export_t& c,
-    linked_memory_lock_t& arena,
-    parquet::StreamWriter* os_ptr,
-    ptr_range_gt<ustore_char_t*>* docs_ptr,
-    ptr_range_gt<ustore_key_t>* keys_ptr,
-    ptr_range_gt<ustore_key_t const>& keys,
-    ptr_range_gt<ustore_char_t> const& tape,
-    fields_t const& fields,
-    counts_t const& counts,
-    val_t const& values,
-    int handle,
-    ext_t pcn) {
+#pragma region - Docs
 
-    ptr_range_gt<ustore_char_t*>& docs_vec = *docs_ptr;
-    ptr_range_gt<ustore_key_t>& keys_vec = *keys_ptr;
-    parquet::StreamWriter& os = *os_ptr;
+/**
+ * @brief Checks that the requested fields exist in the dataset, or lists all of its columns.
+ */
+void arrow_fields(ustore_docs_import_t& c, linked_memory_lock_t& arena, arrow::Schema const& schema, fields_t& fields) {
 
-    ustore_size_t idx = 0;
-    auto iter = keys.begin();
-    std::string json = prefix_k;
+    if (c.fields) {
+        fields = fields_t {c.fields, c.fields_stride};
+        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
+            return_error_if_m(schema.GetFieldIndex(fields[idx]) != -1,
+                              c.error,
+                              args_wrong_k,
+                              "Requested field is missing in the dataset");
+        return;
+    }
 
-    simdjson::ondemand::parser parser;
-    simdjson::ondemand::document_stream docs = parser.iterate_many( //
-        values.first,
-        values.second,
-        1000000ul);
-
-    for (auto doc : docs) {
-        simdjson::ondemand::object obj = doc.get_object().value();
-        try {
-            simdjson_object_parser(obj, counts, fields, c.fields_count, tape, json);
-        }
-        catch (simdjson::simdjson_error const& ex) {
-            *c.error = ex.what();
-            return_if_error_m(c.error);
-        }
-        if (pcn == parquet_k) {
-            os << *iter << json.data();
-            os << parquet::EndRow;
-        }
-        else if (pcn == csv_k) {
-            keys_vec[idx] = *iter;
-            docs_vec[idx] = arena.alloc<ustore_char_t>(json.size() + 1, c.error).begin();
-            std::memcpy(docs_vec[idx], json.data(), json.size() + 1);
-            ++idx;
-        }
-        else {
-            auto str = fmt::format("{{\"_id\":{},\"doc\":{}}}\n", *iter, json.data());
-            write(handle, str.data(), str.size());
-        }
-        json = prefix_k;
-        ++iter;
+    auto names = arena.alloc<ustore_str_view_t>(schema.num_fields(), c.error);
+    return_if_error_m(c.error);
+    for (int idx = 0; idx < schema.num_fields(); ++idx) {
+        std::string const& name = schema.field(idx)->name();
+        auto field = arena.alloc<ustore_char_t>(name.size() + 1, c.error);
+        return_if_error_m(c.error);
+        std::memcpy(field.begin(), name.c_str(), name.size() + 1);
+        names[idx] = field.begin();
     }
+    c.fields_count = names.size();
+    c.fields_stride = sizeof(ustore_str_view_t);
+    fields = fields_t {names.begin(), c.fields_stride};
 }
 
-void make_parquet(ustore_docs_export_t& c, parquet::StreamWriter& os) {
-
-    parquet::schema::NodeVector nodes;
-    nodes.push_back(parquet::schema::PrimitiveNode::Make( //
-        "_id",
-        parquet::Repetition::REQUIRED,
-        parquet::Type::INT64,
-        parquet::ConvertedType::INT_64));
-
-    nodes.push_back(parquet::schema::PrimitiveNode::Make( //
-        "doc",
-        parquet::Repetition::REQUIRED,
-        parquet::Type::BYTE_ARRAY,
-        parquet::ConvertedType::UTF8));
+/**
+ * @brief Appends every row of the `table` to the `batch` as a separate JSON object.
+ */
+void parse_arrow_table( //
+    fields_t fields,
+    ustore_size_t fields_count,
+    arrow::Table const& table,
+    import_batch_t& batch) {
 
-    std::shared_ptr<parquet::schema::GroupNode> schema = std::static_pointer_cast<parquet::schema::GroupNode>(
-        parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, nodes));
+    std::vector<chunked_array_t> columns(fields_count);
+    for (ustore_size_t idx = 0; idx < fields_count; ++idx) {
+        columns[idx] = table.GetColumnByName(fields[idx]);
+        if (!columns[idx]) {
+            batch.error = "Requested field is missing in the dataset";
+            return;
+        }
+    }
 
-    auto maybe_outfile =
-        arrow::io::FileOutputStream::Open(fmt::format("{}{}", generate_file_name(), c.paths_extension));
-    return_error_if_m(maybe_outfile.ok(), c.error, 0, "Can't open file");
-    auto outfile = *maybe_outfile;
+    std::string& json = batch.tape;
+    arrow_visitor_t visitor(json);
+    std::vector<array_t> chunks(fields_count);
+    ustore_size_t count = fields_count ? columns[0]->num_chunks() : 0;
+    for (ustore_size_t chunk_idx = 0; chunk_idx != count; ++chunk_idx) {
 
-    parquet::WriterProperties::Builder builder;
-    builder.memory_pool(arrow::default_memory_pool());
-    builder.write_batch_size(c.max_batch_size);
+        for (ustore_size_t idx = 0; idx < fields_count; ++idx)
+            chunks[idx] = columns[idx]->chunk(chunk_idx);
 
-    os = parquet::StreamWriter {parquet::ParquetFileWriter::Open(outfile, schema, builder.build())};
+        for (ustore_size_t value_idx = 0; value_idx < chunks[0]->length(); ++value_idx) {
+            json.push_back('{');
+            for (ustore_size_t idx = 0; idx < fields_count; ++idx) {
+                fmt::format_to(std::back_inserter(json), "\"{}\":", fields[idx]);
+                visitor.idx = value_idx;
+                arrow::VisitArrayInline(*chunks[idx].get(), &visitor);
+            }
+            json.back() = '}';
+            json.push_back('\n');
+            batch.ends.push_back(json.size());
+        }
+    }
+    batch.export_tape();
 }
 
-int make_ndjson(ustore_docs_export_t& docs) {
-    return open(fmt::format("{}{}", generate_file_name(), docs.paths_extension).data(),
-                O_CREAT | O_WRONLY,
-                S_IRUSR | S_IWUSR);
+/**
+ * @brief Upserts the documents of a parsed batch, at most `c.max_batch_size` bytes at a time.
+ * Writes are done on a separate arena, so that the fields prepared in `c.arena` stay intact.
+ */
+void write_docs(ustore_docs_import_t& c, arena_t& arena, import_batch_t& batch) {
+    for (std::size_t begin = 0, idx = 0, used_mem = 0; idx != batch.docs.size() && !*c.error; ++idx) {
+        used_mem += batch.docs[idx].size();
+        if (used_mem < c.max_batch_size && idx + 1 != batch.docs.size())
+            continue;
+        upsert_docs(c, arena.member_ptr(), batch.docs.data() + begin, idx + 1 - begin);
+        begin = idx + 1;
+        used_mem = 0;
+    }
 }
 
-void write_in_parquet( //
-    ustore_docs_export_t& c,
-    linked_memory_lock_t& arena,
-    parquet::StreamWriter& ostream,
-    ptr_range_gt<ustore_key_t const>& keys,
-    ptr_range_gt<ustore_char_t> const& tape,
-    fields_t const& fields,
-    counts_t const& counts,
-    val_t const& values) {
+void import_arrow_docs(ustore_docs_import_t& c, ext_t ext) {
 
-    if (c.fields)
-        export_sub_docs(c, arena, &ostream, nullptr, nullptr, keys, tape, fields, counts, values, 0, parquet_k);
+    auto arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    fields_t fields;
+    arena_t write_arena(c.db);
+    auto prepare = [&](arrow::Schema const& schema) {
+        arrow_fields(c, arena, schema, fields);
+    };
+    auto parse = [&](arrow::Table const& table, import_batch_t& batch) {
+        parse_arrow_table(fields, c.fields_count, table, batch);
+    };
+    auto write = [&](import_batch_t& batch) {
+        write_docs(c, write_arena, batch);
+    };
+    if (ext == parquet_k)
+        import_parquet(c, prepare, parse, write);
     else
-        export_whole_docs(c.error, arena, keys, nullptr, nullptr, &ostream, values, 0, parquet_k);
+        import_csv(c, prepare, parse, write);
 }
 
-void write_in_csv( //
-    ustore_docs_export_t& c,
-    linked_memory_lock_t& arena,
-    ptr_range_gt<ustore_char_t*>& docs_vec,
-    ptr_range_gt<ustore_key_t>& keys_vec,
-    ptr_range_gt<ustore_key_t const>& keys,
-    int_builder_t& int_builder,
-    arrow::StringBuilder& string_builder,
-    ptr_range_gt<ustore_char_t> const& tape,
-    fields_t const& fields,
-    counts_t const& counts,
-    val_t const& values,
-    ustore_size_t size) {
-
-    arrow::Status status;
-    status = int_builder.Resize(int_builder.capacity() + size);
-    return_error_if_m(status.ok(), c.error, 0, "Can't resize builder");
-    status = string_builder.Resize(string_builder.capacity() + size);
-    return_error_if_m(status.ok(), c.error, 0, "Can't resize builder");
+/**
+ * @brief Whole documents are passed to the engine as views into the mapped file, without copies.
+ * Sub-documents are rebuilt from the "tape" of field names, shared by all threads.
+ */
+void import_ndjson_docs(ustore_docs_import_t& c) {
 
-    if (c.fields)
-        export_sub_docs(c, arena, nullptr, &docs_vec, &keys_vec, keys, tape, fields, counts, values, 0, csv_k);
-    else
-        export_whole_docs(c.error, arena, keys, &keys_vec, &docs_vec, nullptr, values, 0, csv_k);
+    fields_t fields;
+    counts_t counts;
+    tape_t tape;
+    if (c.fields) {
+        auto arena = linked_memory(c.arena, c.options, c.error);
+        return_if_error_m(c.error);
+        fields = prepare_fields(c, arena);
+        ustore_size_t max_size = c.fields_count * symbols_count_k;
+        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
+            max_size += strlen(fields[idx]);
+        counts = arena.alloc<ustore_size_t>(c.fields_count, c.error);
+        return_if_error_m(c.error);
+        tape = arena.alloc<ustore_char_t>(max_size, c.error);
+        return_if_error_m(c.error);
+        fields_parser(c.error, arena, c.fields_count, fields, counts, tape);
+        return_if_error_m(c.error);
+    }
 
-    status = int_builder.AppendValues(keys_vec.begin(), size);
-    return_error_if_m(status.ok(), c.error, 0, "Can't append keys");
-    status = string_builder.AppendValues((ustore_char_t const**)docs_vec.begin(), size);
-    return_error_if_m(status.ok(), c.error, 0, "Can't append docs");
+    arena_t write_arena(c.db);
+    import_ndjson(
+        c,
+        [&](simdjson::ondemand::object& object, import_batch_t& batch) {
+            if (!c.fields) {
+                batch.docs.emplace_back(rewinded(object).raw_json().value());
+                return;
+            }
+            batch.tape.push_back('{');
+            simdjson_object_parser(object, counts, fields, c.fields_count, tape, batch.tape);
+            batch.tape.push_back('\n');
+            batch.ends.push_back(batch.tape.size());
+        },
+        [&](import_batch_t& batch) { write_docs(c, write_arena, batch); });
 }
 
-void end_csv( //
-    ustore_docs_export_t& c,
-    arrow::StringBuilder& string_builder,
-    int_builder_t& int_builder) {
+/**
+ * @brief Appends rows to a new CSV, Parquet or NDJSON file: integer columns, optionally
+ * followed by a column of JSON documents, written as strings into CSV and Parquet,
+ * and embedded as is into NDJSON objects.
+ */
+struct rows_writer_t {
+    ext_t ext = unknown_k;
+    std::vector<ustore_str_view_t> keys_columns;
+    ustore_str_view_t docs_column = nullptr;
+
+    parquet::StreamWriter parquet;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> csv;
+    std::shared_ptr<arrow::Schema> csv_schema;
+    int ndjson = -1;
+    std::string json;
+
+    bool open(std::string const& path, ustore_size_t max_batch_size) {
+        if (ext == ndjson_k) {
+            ndjson = ::open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+            return ndjson != -1;
+        }
 
-    array_t keys_array;
-    array_t docs_array;
-    arrow::Status status;
+        auto maybe_outfile = arrow::io::FileOutputStream::Open(path);
+        if (!maybe_outfile.ok())
+            return false;
+        if (ext == csv_k) {
+            arrow::FieldVector fields;
+            for (ustore_str_view_t column : keys_columns)
+                fields.push_back(arrow::field(column, arrow::int64()));
+            if (docs_column)
+                fields.push_back(arrow::field(docs_column, arrow::large_binary()));
+            csv_schema = std::make_shared<arrow::Schema>(fields);
+            auto maybe_writer = arrow::csv::MakeCSVWriter(*maybe_outfile, csv_schema);
+            if (!maybe_writer.ok())
+                return false;
+            csv = *maybe_writer;
+            return true;
+        }
 
-    status = int_builder.Finish(&keys_array);
-    return_error_if_m(status.ok(), c.error, 0, "Can't finish array(keys)");
-    status = string_builder.Finish(&docs_array);
-    return_error_if_m(status.ok(), c.error, 0, "Can't finish array(docs)");
+        parquet::schema::NodeVector nodes;
+        for (ustore_str_view_t column : keys_columns)
+            nodes.push_back(parquet::schema::PrimitiveNode::Make( //
+                column,
+                parquet::Repetition::REQUIRED,
+                parquet::Type::INT64,
+                parquet::ConvertedType::INT_64));
+        if (docs_column)
+            nodes.push_back(parquet::schema::PrimitiveNode::Make( //
+                docs_column,
+                parquet::Repetition::REQUIRED,
+                parquet::Type::BYTE_ARRAY,
+                parquet::ConvertedType::UTF8));
+        auto schema = std::static_pointer_cast<parquet::schema::GroupNode>(
+            parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, nodes));
+        parquet::WriterProperties::Builder builder;
+        builder.memory_pool(arrow::default_memory_pool());
+        builder.write_batch_size(max_batch_size);
+        parquet = parquet::StreamWriter {parquet::ParquetFileWriter::Open(*maybe_outfile, schema, builder.build())};
+        return true;
+    }
 
-    arrow::FieldVector fields;
-    fields.push_back(arrow::field("_id", arrow::int64()));
-    fields.push_back(arrow::field("doc", arrow::large_binary()));
-    std::shared_ptr<arrow::Schema> schema = std::make_shared<arrow::Schema>(fields);
+    /**
+     * @param keys One array of `count` keys for each of the `keys_columns`.
+     * @param docs Array of `count` documents, if the `docs_column` is set.
+     */
+    bool write(ustore_key_t const* const* keys, std::string_view const* docs, std::size_t count) {
+        if (ext == parquet_k) {
+            for (std::size_t idx = 0; idx != count; ++idx) {
+                for (std::size_t column = 0; column != keys_columns.size(); ++column)
+                    parquet << keys[column][idx];
+                if (docs_column)
+                    parquet << docs[idx];
+                parquet << parquet::EndRow;
+            }
+            return true;
+        }
 
-    std::shared_ptr<arrow::Table> table;
-    table = arrow::Table::Make(schema, {keys_array, docs_array});
+        if (ext == csv_k) {
+            std::vector<array_t> columns;
+            for (std::size_t column = 0; column != keys_columns.size(); ++column) {
+                int_builder_t builder;
+                array_t array;
+                if (!builder.AppendValues(keys[column], count).ok() || !builder.Finish(&array).ok())
+                    return false;
+                columns.push_back(array);
+            }
+            if (docs_column) {
+                arrow::LargeBinaryBuilder builder;
+                array_t array;
+                for (std::size_t idx = 0; idx != count; ++idx)
+                    if (!builder.Append(docs[idx].data(), docs[idx].size()).ok())
+                        return false;
+                if (!builder.Finish(&array).ok())
+                    return false;
+                columns.push_back(array);
+            }
+            auto batch = arrow::RecordBatch::Make(csv_schema, count, columns);
+            return csv->WriteRecordBatch(*batch).ok();
+        }
 
-    auto maybe_outstream =
-        arrow::io::FileOutputStream::Open(fmt::format("{}{}", generate_file_name(), c.paths_extension));
-    return_error_if_m(maybe_outstream.ok(), c.error, 0, "Can't open file");
-    std::shared_ptr<arrow::io::FileOutputStream> outstream = *maybe_outstream;
+        json.clear();
+        for (std::size_t idx = 0; idx != count; ++idx) {
+            json.push_back('{');
+            for (std::size_t column = 0; column != keys_columns.size(); ++column)
+                fmt::format_to(std::back_inserter(json), "\"{}\":{},", keys_columns[column], keys[column][idx]);
+            if (docs_column)
+                fmt::format_to(std::back_inserter(json), "\"{}\":{},", docs_column, docs[idx]);
+            json.back() = '}';
+            json.push_back('\n');
+        }
+        for (std::size_t written = 0; written != json.size();) {
+            auto result = ::write(ndjson, json.data() + written, json.size() - written);
+            if (result <= 0)
+                return false;
+            written += static_cast<std::size_t>(result);
+        }
+        return true;
+    }
 
-    status = arrow::csv::WriteCSV(*table, arrow::csv::WriteOptions::Defaults(), outstream.get());
-    return_error_if_m(status.ok(), c.error, 0, "Can't write in file");
+    bool close() {
+        if (ext == parquet_k) {
+            parquet = parquet::StreamWriter {};
+            return true;
+        }
+        if (ext == csv_k)
+            return csv->Close().ok();
+        return ::close(ndjson) == 0;
+    }
+};
+
+/**
+ * @brief Number of keys scanned and documents read at once by every partition of the export.
+ */
+constexpr ustore_length_t export_batch_keys_k = 4096;
+
+/**
+ * @brief Number of random samples per partition, from which the split points of the key space are picked.
+ */
+constexpr ustore_length_t samples_per_partition_k = 64;
+
+/**
+ * @brief Picks `partitions + 1` boundaries, splitting the collection into ranges of similar sizes.
+ * Partitions may end up empty, if the collection is smaller than the sample.
+ */
+std::vector<ustore_key_t> export_split_points( //
+    ustore_docs_export_t& c,
+    ustore_snapshot_t snapshot,
+    ustore_size_t partitions) {
+
+    std::vector<ustore_key_t> bounds;
+    bounds.push_back(std::numeric_limits<ustore_key_t>::min());
+    if (partitions > 1) {
+        arena_t arena(c.db);
+        ustore_length_t count_limit = static_cast<ustore_length_t>(partitions * samples_per_partition_k);
+        ustore_length_t* counts = nullptr;
+        ustore_key_t* keys = nullptr;
+        ustore_sample_t sample {};
+        sample.db = c.db;
+        sample.error = c.error;
+        sample.snapshot = snapshot;
+        sample.arena = arena.member_ptr();
+        sample.tasks_count = 1;
+        sample.collections = &c.collection;
+        sample.count_limits = &count_limit;
+        sample.counts = &counts;
+        sample.keys = &keys;
+        ustore_sample(&sample);
+        if (*c.error)
+            return {};
+
+        std::vector<ustore_key_t> sampled(keys, keys + counts[0]);
+        std::sort(sampled.begin(), sampled.end());
+        for (std::size_t part = 1; part < partitions && !sampled.empty(); ++part) {
+            ustore_key_t split = sampled[part * sampled.size() / partitions];
+            if (split > bounds.back())
+                bounds.push_back(split);
+        }
+    }
+    bounds.push_back(std::numeric_limits<ustore_key_t>::max());
+    return bounds;
 }
 
-void end_ndjson(int fd) {
-    close(fd);
+/**
+ * @brief Window of keys of an exported partition with their whole documents.
+ */
+struct export_window_t {
+    ustore_key_t const* keys = nullptr;
+    ustore_size_t count = 0;
+    ustore_length_t const* offsets = nullptr;
+    ustore_length_t const* lengths = nullptr;
+    ustore_bytes_ptr_t values = nullptr;
+};
+
+/**
+ * @brief Scans the next window of keys of a partition, starting with `start_key`, and reads its documents.
+ */
+status_t fetch_export_window( //
+    ustore_docs_export_t const& c,
+    ustore_snapshot_t snapshot,
+    ustore_key_t max_key,
+    bool includes_max,
+    ustore_key_t start_key,
+    arena_t& arena,
+    export_window_t& window,
+    ustore_key_t& next_key) noexcept {
+
+    status_t status;
+    ustore_length_t count_limit = export_batch_keys_k;
+    ustore_length_t* found_counts = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_scan_t scan {};
+    scan.db = c.db;
+    scan.error = status.member_ptr();
+    scan.snapshot = snapshot;
+    scan.arena = arena.member_ptr();
+    scan.tasks_count = 1;
+    scan.collections = &c.collection;
+    scan.start_keys = &start_key;
+    scan.count_limits = &count_limit;
+    scan.counts = &found_counts;
+    scan.keys = &found_keys;
+    ustore_scan(&scan);
+    if (!status)
+        return status;
+
+    ustore_length_t found_count = found_counts[0];
+    bool last_batch = found_count < count_limit;
+    ustore_key_t const* keys_end = includes_max ? std::upper_bound(found_keys, found_keys + found_count, max_key)
+                                                : std::lower_bound(found_keys, found_keys + found_count, max_key);
+    ustore_size_t keys_count = keys_end - found_keys;
+    last_batch |= keys_count != found_count;
+    window = {found_keys, keys_count};
+    next_key = ustore_key_unknown_k;
+    if (!keys_count)
+        return {};
+
+    // Whole documents are requested in a single call, reusing the arena of the scan
+    ustore_length_t* offsets = nullptr;
+    ustore_length_t* lengths = nullptr;
+    ustore_bytes_ptr_t values = nullptr;
+    ustore_docs_read_t docs_read {};
+    docs_read.db = c.db;
+    docs_read.error = status.member_ptr();
+    docs_read.snapshot = snapshot;
+    docs_read.arena = arena.member_ptr();
+    docs_read.options = ustore_option_dont_discard_memory_k;
+    docs_read.type = ustore_doc_field_json_k;
+    docs_read.tasks_count = keys_count;
+    docs_read.collections = &c.collection;
+    docs_read.keys = found_keys;
+    docs_read.keys_stride = sizeof(ustore_key_t);
+    docs_read.offsets = &offsets;
+    docs_read.lengths = &lengths;
+    docs_read.values = &values;
+    ustore_docs_read(&docs_read);
+    if (!status)
+        return status;
+
+    window.offsets = offsets;
+    window.lengths = lengths;
+    window.values = values;
+    if (!last_batch && found_keys[keys_count - 1] != std::numeric_limits<ustore_key_t>::max())
+        next_key = found_keys[keys_count - 1] + 1;
+    return {};
 }
 
-void write_in_ndjson( //
-    ustore_docs_export_t& c,
-    linked_memory_lock_t& arena,
-    ptr_range_gt<ustore_key_t const>& keys,
-    ptr_range_gt<ustore_char_t> const& tape,
+/**
+ * @brief Exports the documents with keys in `[min_key, max_key)`, or `[min_key, max_key]`
+ * for the last partition, into a separate file. The next window of documents is fetched
+ * in the background, while the current one is projected and written.
+ */
+void export_partition( //
+    ustore_docs_export_t const& c,
+    ustore_snapshot_t snapshot,
+    ustore_key_t min_key,
+    ustore_key_t max_key,
+    bool includes_max,
+    std::string const& path,
     fields_t const& fields,
     counts_t const& counts,
-    val_t const& values,
-    int handle) {
+    tape_t const& tape,
+    ustore_error_t* error) {
+
+    rows_writer_t writer;
+    writer.ext = strcmp_(c.paths_extension, ".parquet") ? parquet_k
+                 : strcmp_(c.paths_extension, ".csv")   ? csv_k
+                                                        : ndjson_k;
+    writer.keys_columns = {"_id"};
+    writer.docs_column = "doc";
+    return_error_if_m(writer.open(path, c.max_batch_size), error, 0, "Can't open file");
+
+    windows_prefetch_gt<export_window_t> windows {
+        c.db,
+        1,
+        [&](ustore_key_t start_key, arena_t& arena, export_window_t& window, ustore_key_t& next_key) noexcept {
+            return fetch_export_window(c, snapshot, max_key, includes_max, start_key, arena, window, next_key);
+        },
+    };
+    status_t status = windows.restart(min_key);
 
-    if (c.fields)
-        export_sub_docs(c, arena, nullptr, nullptr, nullptr, keys, tape, fields, counts, values, handle, ndjson_k);
-    else
-        export_whole_docs(c.error, arena, keys, nullptr, nullptr, nullptr, values, handle, ndjson_k);
+    simdjson::ondemand::parser parser;
+    std::string projected;
+    std::vector<std::size_t> ends;
+    std::vector<std::string_view> docs;
+    std::vector<char> padded;
+
+    for (ustore_key_t next_key = min_key; status && next_key != ustore_key_unknown_k;) {
+        export_window_t window;
+        status = windows.next(window, next_key);
+        if (!status || !window.count)
+            break;
+
+        // Only the requested fields are materialized, the rest is skipped by the on-demand parser
+        projected.clear();
+        ends.clear();
+        docs.clear();
+        for (ustore_size_t idx = 0; idx != window.count; ++idx) {
+            std::string_view doc =
+                window.lengths[idx] == ustore_length_missing_k
+                    ? std::string_view("{}")
+                    : std::string_view(reinterpret_cast<char const*>(window.values) + window.offsets[idx],
+                                       window.lengths[idx]);
+            while (!doc.empty() && std::isspace(static_cast<unsigned char>(doc.back())))
+                doc.remove_suffix(1);
+            if (!c.fields) {
+                docs.push_back(doc);
+                continue;
+            }
+
+            padded.resize(doc.size() + simdjson::SIMDJSON_PADDING);
+            std::memcpy(padded.data(), doc.data(), doc.size());
+            try {
+                simdjson::ondemand::document parsed = parser.iterate(padded.data(), doc.size(), padded.size());
+                simdjson::ondemand::object object = parsed.get_object().value();
+                projected += prefix_k;
+                simdjson_object_parser(object, counts, fields, c.fields_count, tape, projected);
+            }
+            catch (simdjson::simdjson_error const& ex) {
+                return_error_m(error, simdjson::error_message(ex.error()));
+            }
+            ends.push_back(projected.size());
+        }
+        for (std::size_t idx = 0, begin = 0; idx != ends.size(); begin = ends[idx], ++idx)
+            docs.emplace_back(projected.data() + begin, ends[idx] - begin);
+
+        ustore_key_t const* columns[1] = {window.keys};
+        return_error_if_m(writer.write(columns, docs.data(), window.count), error, 0, "Can't write in file");
+    }
+    if (!status) {
+        *error = status.release_error();
+        return;
+    }
+    return_error_if_m(writer.close(), error, 0, "Can't write in file");
 }
 
 #pragma region - Main Functions(Docs)
@@ -1106,22 +1459,19 @@ void ustore_docs_import(ustore_docs_import_t* c_ptr) noexcept(false) {
     return_error_if_m(c.max_batch_size, c.error, uninitialized_state_k, "Max batch size is 0");
     return_error_if_m(c.paths_pattern, c.error, uninitialized_state_k, "Paths pattern is uninitialized");
 
+    arena_t arena(c.db);
     if (!c.arena)
-        c.arena = arena_t(c.db).member_ptr();
+        c.arena = arena.member_ptr();
 
     auto ext = std::filesystem::path(c.paths_pattern).extension();
-    ustore_size_t rows_count = 0;
     if (ext == ".ndjson")
         import_ndjson_docs(c);
-    else {
-        std::shared_ptr<arrow::Table> table;
-        if (ext == ".parquet")
-            import_parquet(c, table, rows_count);
-        else if (ext == ".csv")
-            import_csv(c, table);
-        return_if_error_m(c.error);
-        parse_arrow_table(c, table);
-    }
+    else if (ext == ".parquet")
+        import_arrow_docs(c, parquet_k);
+    else if (ext == ".csv")
+        import_arrow_docs(c, csv_k);
+    if (c.arena == arena.member_ptr())
+        c.arena = nullptr;
 }
 
 void ustore_docs_export(ustore_docs_export_t* c_ptr) noexcept(false) {
@@ -1141,116 +1491,273 @@ void ustore_docs_export(ustore_docs_export_t* c_ptr) noexcept(false) {
                                           : unknown_k;
     return_error_if_m(!(pcn == unknown_k), c.error, 0, "Not supported format");
 
-    if (!c.arena)
-        c.arena = arena_t(c.db).member_ptr();
-
-    int handle = 0;
-    parquet::StreamWriter os;
-    ptr_range_gt<ustore_char_t*> docs_vec;
-    ptr_range_gt<ustore_key_t> keys_vec;
-    arrow::StringBuilder string_builder;
-    int_builder_t int_builder;
-
-    ustore_size_t task_count = 1'000'000;
-    keys_stream_t stream(c.db, c.collection, task_count);
-    auto arena = linked_memory(c.arena, c.options, c.error);
+    arena_t default_arena(c.db);
+    auto arena = linked_memory(c.arena ? c.arena : default_arena.member_ptr(), c.options, c.error);
+    return_if_error_m(c.error);
 
     fields_t fields;
-    ptr_range_gt<ustore_char_t> tape;
-    auto counts = arena.alloc<ustore_size_t>(c.fields_count, c.error);
-
-    if (pcn == parquet_k)
-        make_parquet(c, os);
-    else if (pcn == csv_k) {
-        keys_vec = arena.alloc<ustore_key_t>(task_count, c.error);
-        docs_vec = arena.alloc<ustore_char_t*>(task_count, c.error);
-    }
-    else
-        handle = make_ndjson(c);
-
+    tape_t tape;
+    counts_t counts;
     if (c.fields) {
         fields = prepare_fields(c, arena);
         ustore_size_t max_size = c.fields_count * symbols_count_k;
         for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
             max_size += strlen(fields[idx]);
-
+        counts = arena.alloc<ustore_size_t>(c.fields_count, c.error);
+        return_if_error_m(c.error);
         tape = arena.alloc<ustore_char_t>(max_size, c.error);
+        return_if_error_m(c.error);
         fields_parser(c.error, arena, c.fields_count, fields, counts, tape);
+        return_if_error_m(c.error);
     }
 
-    auto status = stream.seek_to_first();
-    return_error_if_m(status, c.error, 0, "No batches in stream");
-
-    while (!stream.is_end()) {
-        val_t values {nullptr, 0};
-        ustore_length_t* offsets = nullptr;
-        ustore_length_t* lengths = nullptr;
-        auto keys = stream.keys_batch();
-
-        ustore_docs_read_t docs_read {
-            .db = c.db,
-            .error = c.error,
-            .arena = c.arena,
-            .options = ustore_option_dont_discard_memory_k,
-            .tasks_count = keys.size(),
-            .collections = &c.collection,
-            .keys = keys.begin(),
-            .keys_stride = sizeof(ustore_key_t),
-            .lengths = &lengths,
-        };
-        ustore_docs_read(&docs_read);
-
-        for (ustore_size_t idx = 0; idx < keys.size(); ++idx) {
-            ustore_size_t pre_idx = idx;
-            ustore_size_t size = 0;
-
-            do {
-                size += lengths[idx];
-                ++idx;
-            } while (size < c.max_batch_size && idx < keys.size());
-
-            ustore_docs_read_t docs_read {
-                .db = c.db,
-                .error = c.error,
-                .arena = c.arena,
-                .options = ustore_option_dont_discard_memory_k,
-                .tasks_count = idx - pre_idx,
-                .collections = &c.collection,
-                .keys = keys.begin() + pre_idx,
-                .keys_stride = sizeof(ustore_key_t),
-                .offsets = &offsets,
-                .values = &values.first,
-            };
-            ustore_docs_read(&docs_read);
-            values.second = offsets[idx - pre_idx - 1] + lengths[idx - 1];
-
-            if (pcn == parquet_k)
-                write_in_parquet(c, arena, os, keys, tape, fields, counts, values);
-            else if (pcn == csv_k)
-                write_in_csv(c,
-                             arena,
-                             docs_vec,
-                             keys_vec,
-                             keys,
-                             int_builder,
-                             string_builder,
-                             tape,
+    // All partitions observe the same state, regardless of concurrent writes
+    ustore_snapshot_t snapshot = 0;
+    ustore_snapshot_create_t snapshot_create {
+        .db = c.db,
+        .error = c.error,
+        .id = &snapshot,
+    };
+    ustore_snapshot_create(&snapshot_create);
+    return_if_error_m(c.error);
+
+    std::vector<ustore_key_t> bounds = export_split_points(c, snapshot, std::max<ustore_size_t>(c.threads_count, 1));
+    std::size_t parts_count = bounds.empty() ? 0 : bounds.size() - 1;
+    std::string name = generate_file_name();
+    std::vector<ustore_error_t> parts_errors(parts_count, nullptr);
+    std::vector<std::thread> threads;
+    for (std::size_t part = 0; part != parts_count; ++part) {
+        std::string path = parts_count == 1 ? fmt::format("{}{}", name, ext)
+                                            : fmt::format("{}_part{}{}", name, part, ext);
+        threads.emplace_back([&, part, path]() {
+            export_partition(c,
+                             snapshot,
+                             bounds[part],
+                             bounds[part + 1],
+                             part + 1 == parts_count,
+                             path,
                              fields,
                              counts,
-                             values,
-                             idx - pre_idx);
-            else
-                write_in_ndjson(c, arena, keys, tape, fields, counts, values, handle);
-        }
-        status = stream.seek_to_next_batch();
-        return_error_if_m(status, c.error, 0, "Invalid batch");
+                             tape,
+                             &parts_errors[part]);
+        });
     }
+    for (auto& thread : threads)
+        thread.join();
 
-    if (pcn == csv_k)
-        end_csv(c, string_builder, int_builder);
-    else if (pcn == ndjson_k)
-        end_ndjson(handle);
+    for (ustore_error_t error : parts_errors)
+        if (error && !*c.error)
+            *c.error = error;
+
+    ustore_error_t drop_error = nullptr;
+    ustore_snapshot_drop_t snapshot_drop {
+        .db = c.db,
+        .error = *c.error ? &drop_error : c.error,
+        .id = snapshot,
+    };
+    ustore_snapshot_drop(&snapshot_drop);
 }
 
 #pragma endregion - Main Functions(Docs)
-#pragma endregion - Docs
\ No newline at end of file
+#pragma endregion - Docs
+#pragma region - Graph
+
+/**
+ * @brief Converts the columns of edge members into `batch.edges`,
+ * casting any integer type to our keys.
+ */
+void parse_arrow_edges(ustore_graph_import_t const& c, arrow::Table const& table, import_batch_t& batch) {
+
+    auto maybe_combined = table.CombineChunks();
+    if (!maybe_combined.ok()) {
+        batch.error = "Can't combine chunks";
+        return;
+    }
+    std::shared_ptr<arrow::Table> combined = *maybe_combined;
+
+    auto column_ids = [&](ustore_str_view_t field, std::shared_ptr<arrow::Int64Array>& ids) {
+        chunked_array_t column = combined->GetColumnByName(field);
+        if (!column)
+            return false;
+        auto maybe_casted = arrow::compute::Cast(column, arrow::int64());
+        if (!maybe_casted.ok())
+            return false;
+        chunked_array_t casted = maybe_casted->chunked_array();
+        if (casted->null_count())
+            return false;
+        if (casted->num_chunks())
+            ids = std::static_pointer_cast<arrow::Int64Array>(casted->chunk(0));
+        return true;
+    };
+
+    std::shared_ptr<arrow::Int64Array> sources, targets, edges;
+    if (!column_ids(c.source_id_field, sources) || !column_ids(c.target_id_field, targets) ||
+        (c.edge_id_field && !column_ids(c.edge_id_field, edges))) {
+        batch.error = "Edge members must be non-null integer columns";
+        return;
+    }
+    if (!sources)
+        return;
+
+    batch.edges.resize(sources->length());
+    for (std::int64_t idx = 0; idx != sources->length(); ++idx) {
+        edge_t& edge = batch.edges[idx];
+        edge.source_id = sources->Value(idx);
+        edge.target_id = targets->Value(idx);
+        edge.id = edges ? edges->Value(idx) : ustore_default_edge_id_k;
+    }
+}
+
+/**
+ * @brief Upserts the accumulated edges at once, sorted by source vertex.
+ * Every vertex touched by the batch is read and written only once, no matter
+ * how many of its edges are in the batch, so the fewer batches - the better.
+ */
+void write_edges(ustore_graph_import_t& c, arena_t& arena, std::vector<edge_t>& edges) {
+
+    if (edges.empty())
+        return;
+    std::sort(edges.begin(), edges.end(), [](edge_t const& a, edge_t const& b) {
+        return a.source_id != b.source_id ? a.source_id < b.source_id : a.target_id < b.target_id;
+    });
+
+    ustore_graph_upsert_edges_t upsert {};
+    upsert.db = c.db;
+    upsert.error = c.error;
+    upsert.arena = arena.member_ptr();
+    upsert.options = ustore_options_t(c.options & ustore_option_write_bulk_k);
+    upsert.tasks_count = edges.size();
+    upsert.collections = &c.collection;
+    upsert.edges_ids = &edges[0].id;
+    upsert.edges_stride = sizeof(edge_t);
+    upsert.sources_ids = &edges[0].source_id;
+    upsert.sources_stride = sizeof(edge_t);
+    upsert.targets_ids = &edges[0].target_id;
+    upsert.targets_stride = sizeof(edge_t);
+    ustore_graph_upsert_edges(&upsert);
+    edges.clear();
+}
+
+void ustore_graph_import(ustore_graph_import_t* c_ptr) noexcept(false) {
+
+    ustore_graph_import_t& c = *c_ptr;
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.source_id_field && c.target_id_field,
+                      c.error,
+                      uninitialized_state_k,
+                      "source_id_field and target_id_field must be initialized");
+    return_error_if_m(c.max_batch_size, c.error, uninitialized_state_k, "Max batch size is 0");
+    return_error_if_m(c.paths_pattern, c.error, uninitialized_state_k, "Paths pattern is uninitialized");
+
+    // Parsed edges are accumulated until `max_batch_size`, to make upserts as big as possible
+    arena_t write_arena(c.db);
+    std::vector<edge_t> edges;
+    auto write = [&](import_batch_t& batch) {
+        edges.insert(edges.end(), batch.edges.begin(), batch.edges.end());
+        if (edges.size() * sizeof(edge_t) >= c.max_batch_size)
+            write_edges(c, write_arena, edges);
+    };
+    auto prepare = [&](arrow::Schema const& schema) {
+        return_error_if_m(schema.GetFieldIndex(c.source_id_field) != -1 &&
+                              schema.GetFieldIndex(c.target_id_field) != -1 &&
+                              (!c.edge_id_field || schema.GetFieldIndex(c.edge_id_field) != -1),
+                          c.error,
+                          args_wrong_k,
+                          "Requested field is missing in the dataset");
+    };
+    auto parse = [&](arrow::Table const& table, import_batch_t& batch) {
+        parse_arrow_edges(c, table, batch);
+    };
+
+    auto ext = std::filesystem::path(c.paths_pattern).extension();
+    if (ext == ".ndjson")
+        import_ndjson(
+            c,
+            [&](simdjson::ondemand::object& object, import_batch_t& batch) {
+                edge_t edge;
+                edge.source_id = object[c.source_id_field].get_int64().value();
+                edge.target_id = object[c.target_id_field].get_int64().value();
+                if (c.edge_id_field)
+                    edge.id = object[c.edge_id_field].get_int64().value();
+                batch.edges.push_back(edge);
+            },
+            write);
+    else if (ext == ".parquet")
+        import_parquet(c, prepare, parse, write);
+    else if (ext == ".csv")
+        import_csv(c, prepare, parse, write);
+    else
+        return_error_m(c.error, "Not supported format");
+
+    return_if_error_m(c.error);
+    write_edges(c, write_arena, edges);
+}
+
+void ustore_graph_export(ustore_graph_export_t* c_ptr) noexcept(false) {
+
+    ustore_graph_export_t& c = *c_ptr;
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.source_id_field && c.target_id_field,
+                      c.error,
+                      uninitialized_state_k,
+                      "source_id_field and target_id_field must be initialized");
+    return_error_if_m(c.paths_extension, c.error, uninitialized_state_k, "Paths extension is uninitialized");
+    return_error_if_m(c.max_batch_size, c.error, uninitialized_state_k, "Max batch size is 0");
+
+    auto ext = c.paths_extension;
+    ext_t pcn = strcmp_(ext, ".parquet")  ? parquet_k
+                : strcmp_(ext, ".csv")    ? csv_k
+                : strcmp_(ext, ".ndjson") ? ndjson_k
+                                          : unknown_k;
+    return_error_if_m(!(pcn == unknown_k), c.error, 0, "Not supported format");
+
+    // Every edge is listed once, in the neighborhood of its source
+    arena_t arena(c.db);
+    ustore_size_t vertices_count = 0;
+    ustore_key_t* vertices = nullptr;
+    ustore_size_t* offsets = nullptr;
+    ustore_key_t* neighbors = nullptr;
+    ustore_key_t* edges = nullptr;
+    ustore_graph_export_csr_t csr {};
+    csr.db = c.db;
+    csr.error = c.error;
+    csr.arena = c.arena ? c.arena : arena.member_ptr();
+    csr.options = c.options;
+    csr.collection = c.collection;
+    csr.role = ustore_vertex_source_k;
+    csr.vertices_count = &vertices_count;
+    csr.vertices = &vertices;
+    csr.offsets = &offsets;
+    csr.neighbors = &neighbors;
+    csr.edges = &edges;
+    ustore_graph_export_csr(&csr);
+    return_if_error_m(c.error);
+
+    rows_writer_t writer;
+    writer.ext = pcn;
+    writer.keys_columns = {c.source_id_field, c.target_id_field};
+    if (c.edge_id_field)
+        writer.keys_columns.push_back(c.edge_id_field);
+    std::string path = fmt::format("{}{}", generate_file_name(), c.paths_extension);
+    return_error_if_m(writer.open(path, c.max_batch_size), c.error, 0, "Can't open file");
+
+    // Rows are written in batches, for which the sources are expanded from the CSR offsets
+    std::size_t rows_per_batch = std::max<std::size_t>(c.max_batch_size / (sizeof(ustore_key_t) * 3), 1);
+    std::vector<ustore_key_t> sources;
+    for (std::size_t vertex_idx = 0; vertex_idx != vertices_count;) {
+        std::size_t first = offsets[vertex_idx];
+        sources.clear();
+        for (; vertex_idx != vertices_count && sources.size() < rows_per_batch; ++vertex_idx)
+            sources.insert(sources.end(), offsets[vertex_idx + 1] - offsets[vertex_idx], vertices[vertex_idx]);
+        ustore_key_t const* columns[3] = {sources.data(), neighbors + first, edges + first};
+        return_error_if_m(writer.write(columns, nullptr, sources.size()),
+                          c.error,
+                          0,
+                          "Can't write in file");
+    }
+    return_error_if_m(writer.close(), c.error, 0, "Can't write in file");
+}
+
+#pragma endregion - Graph
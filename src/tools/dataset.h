@@ -12,7 +12,7 @@ typedef struct ustore_docs_import_t {
     ustore_database_t db;
     ustore_error_t* error;
     ustore_arena_t* arena; // optional
-    ustore_options_t options; // ustore_options_default_k
+    ustore_options_t options; // ustore_options_default_k, or ustore_option_write_bulk_k for initial loads
 
     ustore_collection_t collection; // ustore_collection_main_k
     ustore_str_view_t paths_pattern; // ".*\\.(csv|ndjson|parquet)"
@@ -26,6 +26,7 @@ typedef struct ustore_docs_import_t {
 
     ustore_str_view_t id_field; // "_id"
     ustore_collection_t paths_collection; // ustore_collection_main_k
+    ustore_size_t threads_count; // optional, all cores by default
 
 } ustore_docs_import_t;
 
@@ -47,11 +48,55 @@ typedef struct ustore_docs_export_t {
     ustore_size_t fields_count; // optional
     ustore_str_view_t const* fields; // optional
     ustore_size_t fields_stride; // optional
+    ustore_size_t threads_count; // optional, one part file by default
 
 } ustore_docs_export_t;
 
 void ustore_docs_export(ustore_docs_export_t*);
 
+typedef struct ustore_graph_import_t {
+
+    ustore_database_t db;
+    ustore_error_t* error;
+    ustore_arena_t* arena; // optional
+    ustore_options_t options; // ustore_options_default_k, or ustore_option_write_bulk_k for initial loads
+
+    ustore_collection_t collection; // ustore_collection_main_k
+    ustore_str_view_t paths_pattern; // ".*\\.(csv|ndjson|parquet)"
+    ustore_size_t max_batch_size; // 1024ul * 1024ul * 1024ul
+    ustore_callback_t callback; // optional
+    ustore_callback_payload_t callback_payload; // optional
+
+    ustore_str_view_t source_id_field; // "source"
+    ustore_str_view_t target_id_field; // "target"
+    ustore_str_view_t edge_id_field; // optional, "edge"
+    ustore_size_t threads_count; // optional, all cores by default
+
+} ustore_graph_import_t;
+
+void ustore_graph_import(ustore_graph_import_t*);
+
+typedef struct ustore_graph_export_t {
+
+    ustore_database_t db;
+    ustore_error_t* error;
+    ustore_arena_t* arena; // optional
+    ustore_options_t options; // ustore_options_default_k
+
+    ustore_collection_t collection; // ustore_collection_main_k
+    ustore_str_view_t paths_extension; // ".parquet"
+    ustore_size_t max_batch_size; // 1024ul * 1024ul * 1024ul
+    ustore_callback_t callback; // optional
+    ustore_callback_payload_t callback_payload; // optional
+
+    ustore_str_view_t source_id_field; // "source"
+    ustore_str_view_t target_id_field; // "target"
+    ustore_str_view_t edge_id_field; // optional, "edge"
+
+} ustore_graph_export_t;
+
+void ustore_graph_export(ustore_graph_export_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
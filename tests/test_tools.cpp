@@ -3,8 +3,10 @@
 #include <sys/mman.h> // `mmap` to read datasets faster
 #include <unistd.h>
 
+#include <set>
 #include <string>
 #include <cstring>
+#include <fstream>
 #include <filesystem>
 #include <unordered_map>
 
@@ -1097,6 +1099,150 @@ TEST(import_export_docs_sub, csv_csv) {
     test_sub_docs(csv_path_k, ext_csv_k, cmp_table_docs_sub, true);
 }
 
+/**
+ * Imports a small edge list, exports it into every format, and imports
+ * every export back, expecting the same neighborhoods.
+ */
+TEST(import_export_graph, roundtrip) {
+    constexpr ustore_str_view_t edges_path_k = "sample_edges.ndjson";
+    constexpr std::size_t vertices_count_k = 100;
+    {
+        std::ofstream file(edges_path_k);
+        for (ustore_key_t source = 0; source != vertices_count_k; ++source)
+            for (ustore_key_t target = source + 1; target <= source + 3; ++target)
+                file << fmt::format("{{\"source\":{},\"target\":{},\"edge\":{}}}\n",
+                                    source,
+                                    target % vertices_count_k,
+                                    source * 10 + target);
+    }
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    status_t status;
+    auto import_graph = [&](ustore_str_view_t path) {
+        ustore_graph_import_t imp {
+            .db = db,
+            .error = status.member_ptr(),
+            .options = ustore_option_write_bulk_k,
+            .collection = ustore_collection_main_k,
+            .paths_pattern = path,
+            .max_batch_size = 1024,
+            .source_id_field = "source",
+            .target_id_field = "target",
+            .edge_id_field = "edge",
+            .threads_count = 4,
+        };
+        ustore_graph_import(&imp);
+        EXPECT_TRUE(status);
+    };
+    auto check_graph = [&] {
+        for (ustore_key_t vertex = 0; vertex != vertices_count_k; ++vertex) {
+            EXPECT_EQ(*net.degree(vertex, ustore_vertex_source_k), 3u);
+            EXPECT_EQ(*net.degree(vertex, ustore_vertex_target_k), 3u);
+        }
+        auto edges = *net.edges_between(5, 6);
+        ASSERT_EQ(edges.size(), 1u);
+        EXPECT_EQ(edges[0].id, 56);
+    };
+
+    import_graph(edges_path_k);
+    check_graph();
+
+    for (ustore_str_view_t ext : {ext_ndjson_k, ext_csv_k, ext_parquet_k}) {
+        std::set<std::string> old_paths;
+        for (auto const& entry : fs::directory_iterator(path_k))
+            old_paths.insert(entry.path());
+
+        ustore_graph_export_t exp {
+            .db = db,
+            .error = status.member_ptr(),
+            .collection = ustore_collection_main_k,
+            .paths_extension = ext,
+            .max_batch_size = 1024,
+            .source_id_field = "source",
+            .target_id_field = "target",
+            .edge_id_field = "edge",
+        };
+        ustore_graph_export(&exp);
+        EXPECT_TRUE(status);
+
+        std::string exported;
+        for (auto const& entry : fs::directory_iterator(path_k))
+            if (!old_paths.count(entry.path()))
+                exported = entry.path();
+        ASSERT_FALSE(exported.empty());
+
+        db.clear().throw_unhandled();
+        import_graph(exported.c_str());
+        check_graph();
+        std::remove(exported.c_str());
+    }
+
+    std::remove(edges_path_k);
+    db.clear().throw_unhandled();
+}
+
+/**
+ * Exports documents into several part files at once, expecting every
+ * document in exactly one of them, projected to the requested fields.
+ */
+TEST(import_export_docs_parts, projection) {
+    constexpr ustore_str_view_t docs_path_k = "sample_parts.ndjson";
+    constexpr std::size_t docs_count_k = 10'000;
+    {
+        std::ofstream file(docs_path_k);
+        for (ustore_key_t key = 0; key != docs_count_k; ++key)
+            file << fmt::format("{{\"id\":{},\"name\":\"doc{}\",\"skipped\":[1,2,3]}}\n", key, key);
+    }
+
+    status_t status;
+    ustore_docs_import_t imp {
+        .db = db,
+        .error = status.member_ptr(),
+        .collection = ustore_collection_main_k,
+        .paths_pattern = docs_path_k,
+        .max_batch_size = max_batch_size_k,
+        .id_field = "id",
+    };
+    ustore_docs_import(&imp);
+    EXPECT_TRUE(status);
+
+    ustore_str_view_t fields[1] = {"name"};
+    for (ustore_str_view_t ext : {ext_ndjson_k, ext_csv_k, ext_parquet_k}) {
+        std::set<std::string> old_paths;
+        for (auto const& entry : fs::directory_iterator(path_k))
+            old_paths.insert(entry.path());
+
+        ustore_docs_export_t exp {
+            .db = db,
+            .error = status.member_ptr(),
+            .collection = ustore_collection_main_k,
+            .paths_extension = ext,
+            .max_batch_size = max_batch_size_k,
+            .fields_count = 1,
+            .fields = fields,
+            .fields_stride = sizeof(ustore_str_view_t),
+            .threads_count = 4,
+        };
+        ustore_docs_export(&exp);
+        EXPECT_TRUE(status);
+
+        docs_t exported;
+        for (auto const& entry : fs::directory_iterator(path_k)) {
+            if (old_paths.count(entry.path()))
+                continue;
+            fill_docs_w_keys(entry.path().c_str());
+            for (auto const& [key, doc] : docs_w_keys)
+                EXPECT_TRUE(exported.emplace(key, doc).second);
+            std::remove(entry.path().c_str());
+        }
+        ASSERT_EQ(exported.size(), docs_count_k);
+        EXPECT_EQ(exported[42], "{\"name\":\"doc42\"}");
+    }
+
+    std::remove(docs_path_k);
+    db.clear().throw_unhandled();
+}
+
 TEST(crash_cases, docs_import) {
     test_crash_cases_docs_import(ndjson_path_k);
     test_crash_cases_docs_import(ndjson_path_k);
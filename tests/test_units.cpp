@@ -7,7 +7,13 @@
  */
 
 #include <vector>
+#include <algorithm>
+#include <random>
+#include <numeric>
+#include <cmath>
 #include <unordered_set>
+#include <set>
+#include <map>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -15,6 +21,7 @@
 #include <thread>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
 
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
@@ -24,6 +31,12 @@
 
 #include <ustore/arrow.h>
 #include "ustore/ustore.hpp"
+#include "change_stream.hpp"   // `changes_copier_t`, `changes_applier_t`
+#include "distances.hpp"       // `distance_kernels_for`
+#include "hash.hpp"            // `stable_hash`
+#include "linked_memory.hpp"   // `linked_memory_t`
+#include "reads_coalescer.hpp" // `reads_coalescer_t`
+#include "shard_ring.hpp"      // `shard_ring_t`
 
 using namespace unum::ustore;
 using namespace unum;
@@ -405,1833 +418,6360 @@ TEST(db, persistency) {
 }
 
 /**
- * Creates news collections under unique names.
- * Tests collection lookup by name, dropping/clearing existing collections.
+ * Populates collections and copies the directory without closing the DBMS, as if the process has crashed.
+ * The copy must recover all the changes from the write-ahead log, including removals and transactions.
  */
-TEST(db, named_collections) {
+TEST(db, persistency_write_ahead_log) {
+#if defined(USTORE_ENGINE_IS_UCSET)
+    if (!path())
+        return;
 
     clear_environment();
+    std::string crashed_path = path();
+    while (crashed_path.size() > 1 && crashed_path.back() == '/')
+        crashed_path.pop_back();
+    crashed_path += "_crashed";
+    std::filesystem::remove_all(crashed_path);
+
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    // We can't drop a missing collection, or the main one.
-    EXPECT_FALSE(*db.contains("unknown"));
-    EXPECT_FALSE(db.drop("unknown"));
-    EXPECT_FALSE(db.drop(""));
-
-    if (ustore_supports_named_collections_k) {
+    triplet_t triplet;
+    {
+        blobs_collection_t main_collection = db.main();
+        auto main_collection_ref = main_collection[triplet.keys];
+        round_trip(main_collection_ref, triplet);
+        EXPECT_TRUE(main_collection[triplet.keys[0]].erase());
 
-        EXPECT_TRUE(db["col1"]);
-        EXPECT_TRUE(db["col2"]);
+        blobs_collection_t named_collection = *db.create("collection");
+        auto named_collection_ref = named_collection[triplet.keys];
+        round_trip(named_collection_ref, triplet);
 
-        EXPECT_FALSE(db.create("col1"));
-        blobs_collection_t col1 = *db["col1"];
-        EXPECT_FALSE(db.create("col2"));
-        blobs_collection_t col2 = *db["col2"];
+        transaction_t txn = *db.transact();
+        EXPECT_TRUE(txn.main()[100].assign("transactional"));
+        EXPECT_TRUE(txn.commit());
+    }
+    std::filesystem::copy(path(), crashed_path, std::filesystem::copy_options::recursive);
+    db.close();
 
-        check_binary_collection(col1);
-        check_binary_collection(col2);
+    database_t recovered;
+    auto crashed_config = fmt::format(R"({{"version": "1.0", "directory": "{}"}})", crashed_path);
+    EXPECT_TRUE(recovered.open(crashed_config.c_str()));
+    {
+        blobs_collection_t main_collection = recovered.main();
+        EXPECT_EQ(main_collection.keys().size(), 3ul);
+        EXPECT_EQ(main_collection[triplet.keys[0]].value(), value_view_t {});
+        EXPECT_EQ(main_collection[100].value(), value_view_t("transactional"));
 
-        EXPECT_TRUE(db.drop("col1"));
-        EXPECT_TRUE(db.drop("col2"));
-        EXPECT_TRUE(*db.contains(""));
-        EXPECT_FALSE(*db.contains("col1"));
-        EXPECT_FALSE(*db.contains("col2"));
+        EXPECT_TRUE(*recovered.contains("collection"));
+        blobs_collection_t named_collection = *recovered["collection"];
+        auto named_collection_ref = named_collection[triplet.keys];
+        check_equalities(named_collection_ref, triplet);
     }
-
-    EXPECT_TRUE(db.clear());
-    EXPECT_TRUE(*db.contains(""));
+    recovered.close();
+    std::filesystem::remove_all(crashed_path);
+#endif
 }
 
 /**
- * Tests listing the names of present collections.
+ * Crashes in the middle of a log record, recovers, writes more and crashes again.
+ * The torn tail of the first log must not hide the records, committed after the recovery.
  */
-TEST(db, named_collections_list) {
-
-    if (!ustore_supports_named_collections_k)
+TEST(db, persistency_write_ahead_log_torn) {
+#if defined(USTORE_ENGINE_IS_UCSET)
+    if (!path())
         return;
 
     clear_environment();
+    std::string base_path = path();
+    while (base_path.size() > 1 && base_path.back() == '/')
+        base_path.pop_back();
+    std::string first_crash_path = base_path + "_torn_first";
+    std::string second_crash_path = base_path + "_torn_second";
+    std::filesystem::remove_all(first_crash_path);
+    std::filesystem::remove_all(second_crash_path);
+
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.main()[1].assign("before"));
+    std::filesystem::copy(path(), first_crash_path, std::filesystem::copy_options::recursive);
+    db.close();
 
-    blobs_collection_t col1 = *db.create("col1");
-    blobs_collection_t col2 = *db.create("col2");
-    blobs_collection_t col3 = *db.create("col3");
-    blobs_collection_t col4 = *db.create("col4");
-
-    EXPECT_TRUE(*db.contains("col1"));
-    EXPECT_TRUE(*db.contains("col2"));
-
-    auto maybe_txn = db.transact();
-    EXPECT_TRUE(maybe_txn);
-    auto maybe_cols = maybe_txn->collections();
-    EXPECT_TRUE(maybe_cols);
-
-    size_t count = 0;
-    std::vector<std::string> collections;
-    auto cols = *maybe_cols;
-    while (!cols.names.is_end()) {
-        collections.push_back(std::string(*cols.names));
-        ++cols.names;
-        ++count;
+    // Append a half of a record header to the newest log file
+    std::filesystem::path newest_log;
+    for (auto const& entry : std::filesystem::directory_iterator {first_crash_path})
+        if (entry.path().filename().string().rfind(".wal.", 0) == 0)
+            if (newest_log.empty() || std::stoul(entry.path().extension().string().substr(1)) >
+                                          std::stoul(newest_log.extension().string().substr(1)))
+                newest_log = entry.path();
+    ASSERT_FALSE(newest_log.empty());
+    {
+        std::ofstream torn(newest_log, std::ios::binary | std::ios::app);
+        torn.write("UWAL\1\0\0", 7);
     }
-    EXPECT_EQ(count, 4);
-    std::sort(collections.begin(), collections.end());
-    EXPECT_EQ(collections[0], "col1");
-    EXPECT_EQ(collections[1], "col2");
-    EXPECT_EQ(collections[2], "col3");
-    EXPECT_EQ(collections[3], "col4");
 
-    EXPECT_TRUE(db.drop("col1"));
-    EXPECT_FALSE(*db.contains("col1"));
-    EXPECT_FALSE(db.drop(""));
-    EXPECT_TRUE(db.main().clear());
+    database_t recovered;
+    auto first_config = fmt::format(R"({{"version": "1.0", "directory": "{}"}})", first_crash_path);
+    EXPECT_TRUE(recovered.open(first_config.c_str()));
+    EXPECT_EQ(recovered.main()[1].value(), value_view_t("before"));
+    EXPECT_TRUE(recovered.main()[2].assign("after"));
+    std::filesystem::copy(first_crash_path, second_crash_path, std::filesystem::copy_options::recursive);
+    recovered.close();
+
+    database_t twice_recovered;
+    auto second_config = fmt::format(R"({{"version": "1.0", "directory": "{}"}})", second_crash_path);
+    EXPECT_TRUE(twice_recovered.open(second_config.c_str()));
+    EXPECT_EQ(twice_recovered.main()[1].value(), value_view_t("before"));
+    EXPECT_EQ(twice_recovered.main()[2].value(), value_view_t("after"));
+    twice_recovered.close();
+
+    std::filesystem::remove_all(first_crash_path);
+    std::filesystem::remove_all(second_crash_path);
+#endif
+}
+
+#if defined(USTORE_ENGINE_IS_UCSET)
+static json_t memory_usage(database_t& db) {
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.error = status.member_ptr();
+    control.arena = arena.member_ptr();
+    control.request = "usage";
+    control.response = &response;
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
+    return response ? json_t::parse(response) : json_t {};
 }
+#endif
 
 /**
- * Tests clearing values in a collection, which would preserve the keys,
- * but empty the binary strings.
+ * Writes values of different sizes and checks that the "usage" control reports them,
+ * both per collection and for the shared memory slabs.
  */
-TEST(db, clear_values) {
+TEST(db, memory_usage) {
+#if defined(USTORE_ENGINE_IS_UCSET)
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    triplet_t triplet;
-    blobs_collection_t col = db.main();
-    auto collection_ref = col[triplet.keys];
-
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
-    check_length(collection_ref, triplet_t::val_size_k);
-
-    EXPECT_TRUE(col.clear_values());
-    check_length(collection_ref, 0);
-    col.clear();
-    check_length(collection_ref, ustore_length_missing_k);
-
-    EXPECT_TRUE(db.clear());
+    blobs_collection_t collection = *db.create("sized");
+    std::string long_value(10'000, 'x');
+    EXPECT_TRUE(collection[1].assign("short"));
+    EXPECT_TRUE(collection[2].assign(long_value.c_str()));
+    EXPECT_TRUE(db.main()[1].assign("main"));
+
+    auto usage = memory_usage(db);
+    ASSERT_FALSE(usage.is_null());
+    EXPECT_EQ(usage["collections"]["sized"]["pairs"], 2);
+    EXPECT_EQ(usage["collections"]["sized"]["value_bytes"], 5 + long_value.size());
+    EXPECT_EQ(usage["collections"][""]["pairs"], 1);
+    EXPECT_GE(usage["values_memory"]["requested_bytes"].get<std::size_t>(), 9 + long_value.size());
+    EXPECT_GE(usage["values_memory"]["large_bytes"].get<std::size_t>(), long_value.size());
+    EXPECT_GE(usage["values_memory"]["reserved_bytes"].get<std::size_t>(), usage["values_memory"]["slab_bytes"]);
+    db.close();
+#endif
 }
 
 /**
- * Tests presences with C and C++ Interfaces.
+ * Reads with short-lived arenas, expecting them to be recycled instead of allocated every time,
+ * and the "arenas" control to report the peak usage of the one it's given.
  */
-TEST(db, presences) {
+TEST(db, arenas_recycled) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    auto main = db.main();
-
-    constexpr std::size_t keys_count = 1000;
-    for (std::size_t i = 0; i != keys_count; ++i) {
-        if (i % 10)
-            main[i] = "value";
-    }
-
-    // Native C Interface
-    std::vector<ustore_key_t> keys(keys_count);
-    std::iota(keys.begin(), keys.end(), 0);
-    ustore_octet_t* found_presences = nullptr;
-    arena_t arena(db);
-    status_t status {};
-    ustore_read_t read {};
-    read.db = db;
-    read.error = status.member_ptr();
-    read.arena = arena.member_ptr();
-    read.tasks_count = keys_count;
-    read.keys = keys.data();
-    read.keys_stride = sizeof(ustore_key_t);
-    read.presences = &found_presences;
-
-    ustore_read(&read);
-    EXPECT_TRUE(status);
+    blobs_collection_t collection = db.main();
+    std::string long_value(100'000, 'x');
+    EXPECT_TRUE(collection[1].assign(long_value.c_str()));
+
+    auto arenas_usage = [&](arena_t& arena) {
+        status_t status;
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db;
+        control.error = status.member_ptr();
+        control.arena = arena.member_ptr();
+        control.request = "arenas";
+        control.response = &response;
+        ustore_database_control(&control);
+        EXPECT_TRUE(status);
+        return response ? json_t::parse(response) : json_t {};
+    };
 
-    for (std::size_t i = 0; i != keys_count; ++i) {
-        if (i % 10) {
-            EXPECT_TRUE(check_presence(found_presences, i));
-        }
-        else {
-            EXPECT_FALSE(check_presence(found_presences, i));
-        }
-    }
+    arena_t first_arena(db);
+    EXPECT_EQ(collection[1].on(first_arena).value()->size(), long_value.size());
+    auto before = arenas_usage(first_arena);
+    ASSERT_FALSE(before.is_null());
+    EXPECT_GE(before["arena"]["peak_bytes"].get<std::size_t>(), long_value.size());
 
-    // C++ Interface
-    auto presences = main[keys].present().throw_or_release();
-    for (std::size_t i = 0; i != keys_count; ++i) {
-        if (i % 10) {
-            EXPECT_TRUE(presences[i]);
-        }
-        else {
-            EXPECT_FALSE(presences[i]);
-        }
+    for (std::size_t i = 0; i != 100; ++i) {
+        arena_t arena(db);
+        EXPECT_EQ(collection[1].on(arena).value()->size(), long_value.size());
     }
+    auto after = arenas_usage(first_arena);
+    EXPECT_GE(after["reuses"].get<std::size_t>(), before["reuses"].get<std::size_t>() + 90);
+    db.close();
 }
 
-TEST(db, scan) {
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+/**
+ * Releases large arenas from many threads at once, expecting their pools
+ * to keep no more than the process-wide limit, while the threads are still alive.
+ */
+TEST(db, arenas_pooled_limit) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
     blobs_collection_t collection = db.main();
+    std::string long_value(6'000'000, 'x');
+    EXPECT_TRUE(collection[1].assign(long_value.c_str()));
+
+    constexpr std::size_t threads_count_k = 12;
+    std::atomic<std::size_t> released = 0;
+    std::atomic<bool> checked = false;
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count_k; ++thread_idx)
+        threads.emplace_back([&] {
+            {
+                arena_t first(db), second(db);
+                EXPECT_EQ(collection[1].on(first).value()->size(), long_value.size());
+                EXPECT_EQ(collection[1].on(second).value()->size(), long_value.size());
+            }
+            ++released;
+            while (!checked)
+                std::this_thread::yield();
+        });
+    while (released != threads_count_k)
+        std::this_thread::yield();
 
-    constexpr std::size_t keys_size = 1000;
-    std::array<ustore_key_t, keys_size> keys;
-    std::iota(std::begin(keys), std::end(keys), 0);
-    auto ref = collection[keys];
-    value_view_t value("value");
-    EXPECT_TRUE(ref.assign(value));
-    keys_stream_t stream(db, collection, 256);
-
-    EXPECT_TRUE(stream.seek_to_first());
-    ustore_key_t key = 0;
-    while (!stream.is_end()) {
-        EXPECT_EQ(stream.key(), key++);
-        ++stream;
-    }
-    EXPECT_EQ(key, keys_size);
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.error = status.member_ptr();
+    control.arena = arena.member_ptr();
+    control.request = "arenas";
+    control.response = &response;
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
+    checked = true;
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_NE(response, nullptr);
+    std::size_t pooled_bytes = json_t::parse(response)["pooled_bytes"].get<std::size_t>();
+    EXPECT_GT(pooled_bytes, 0ul);
+    EXPECT_LE(pooled_bytes, linked_memory_t::pooled_bytes_limit_k);
+    db.close();
 }
 
+#endif
+
 /**
- * Ordered batched scan over the main collection.
+ * Reads and writes a few values, expecting the "metrics" control to count them,
+ * or to report the missing feature, if the metrics were compiled out.
  */
-TEST(db, batch_scan) {
-
+TEST(db, metrics) {
+#if !defined(USTORE_FLIGHT_CLIENT)
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
     blobs_collection_t collection = db.main();
 
-    std::array<ustore_key_t, 512> keys;
-    std::iota(std::begin(keys), std::end(keys), 0);
-    auto ref = collection[keys];
-    value_view_t value("value");
-    EXPECT_TRUE(ref.assign(value));
-    keys_stream_t stream(db, collection, 256);
-
-    EXPECT_TRUE(stream.seek_to_first());
-    auto batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 256);
-    EXPECT_FALSE(stream.is_end());
-    for (ustore_key_t i = 0; i != 256; ++i)
-        EXPECT_EQ(batch[i], i);
-
-    EXPECT_TRUE(stream.seek_to_next_batch());
-    batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 256);
-    EXPECT_FALSE(stream.is_end());
-    for (ustore_key_t i = 0; i != 256; ++i)
-        EXPECT_EQ(batch[i], i + 256);
+    auto metrics = [&](ustore_str_view_t request, std::string& response_copy) {
+        arena_t arena(db);
+        status_t status;
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db;
+        control.error = status.member_ptr();
+        control.arena = arena.member_ptr();
+        control.request = request;
+        control.response = &response;
+        ustore_database_control(&control);
+        response_copy = response ? response : "";
+        return bool(status);
+    };
 
-    EXPECT_TRUE(stream.seek_to_next_batch());
-    batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 0);
-    EXPECT_TRUE(stream.is_end());
+    std::string before_text, after_text, prometheus_text;
+#if USTORE_USE_METRICS
+    EXPECT_TRUE(metrics("metrics", before_text));
+    for (ustore_key_t key = 0; key != 10; ++key)
+        EXPECT_TRUE(collection[key].assign("value"));
+    for (ustore_key_t key = 0; key != 10; ++key)
+        EXPECT_TRUE(collection[key].value());
+    EXPECT_TRUE(metrics("metrics", after_text));
+
+    auto before = json_t::parse(before_text);
+    auto after = json_t::parse(after_text);
+    auto calls = [](json_t const& json, char const* op) {
+        return json["calls"].contains(op) ? json["calls"][op]["calls"].get<std::size_t>() : std::size_t(0);
+    };
+    EXPECT_GE(calls(after, "write"), calls(before, "write") + 10);
+    EXPECT_GE(calls(after, "read"), calls(before, "read") + 10);
+    EXPECT_GE(after["calls"]["write"]["bytes_in"].get<std::size_t>(), 50u);
+
+    EXPECT_TRUE(metrics("metrics/prometheus", prometheus_text));
+    EXPECT_NE(prometheus_text.find("ustore_calls_total{op=\"read\"}"), std::string::npos);
+    EXPECT_NE(prometheus_text.find("ustore_call_duration_seconds_bucket{op=\"write\",le=\"+Inf\"}"),
+              std::string::npos);
+#else
+    EXPECT_FALSE(metrics("metrics", before_text));
+    EXPECT_FALSE(metrics("metrics/prometheus", prometheus_text));
+#endif
+    db.close();
+#endif
 }
 
 /**
- * Checks the "Read Commited" consistency guarantees of transactions.
- * Readers can't see the contents of pending (not committed) transactions.
- * https://jepsen.io/consistency/models/read-committed
+ * Upserts an edge, expecting the "traces" control to report the span of the modality call,
+ * as the parent of the stage span, which is itself the parent of the engine calls.
  */
-TEST(db, transaction_read_commited) {
-    if (!ustore_supports_transactions_k)
-        return;
-
+TEST(db, traces) {
+#if !defined(USTORE_FLIGHT_CLIENT)
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn = *db.transact();
-
-    triplet_t triplet;
-
-    auto txn_ref = txn[triplet.keys];
-    round_trip(txn_ref, triplet);
-
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+    graph_collection_t net = db.main<graph_collection_t>();
 
-    // Check for missing values before commit
-    check_length(collection_ref, ustore_length_missing_k);
-    EXPECT_TRUE(txn.commit());
-    EXPECT_TRUE(txn.reset());
+    auto traces = [&](std::string& response_copy) {
+        arena_t arena(db);
+        status_t status;
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db;
+        control.error = status.member_ptr();
+        control.arena = arena.member_ptr();
+        control.request = "traces";
+        control.response = &response;
+        ustore_database_control(&control);
+        response_copy = response ? response : "";
+        return bool(status);
+    };
 
-    // Validate that values match after commit
-    check_equalities(collection_ref, triplet);
+    std::string text;
+#if USTORE_USE_TRACING
+    // Drain the spans of the previous tests
+    EXPECT_TRUE(traces(text));
+    EXPECT_TRUE(net.upsert_edge(edge_t {1, 2, 9}));
+    EXPECT_TRUE(traces(text));
+
+    json_t spans = json_t::parse(text)["resourceSpans"][0]["scopeSpans"][0]["spans"];
+    auto find_span = [&](char const* name) {
+        for (json_t const& span : spans)
+            if (span["name"] == name)
+                return span;
+        return json_t {};
+    };
+    json_t upsert = find_span("graph_upsert_edges");
+    json_t stage = find_span("graph_pull_and_link_for_updates");
+    ASSERT_FALSE(upsert.is_null());
+    ASSERT_FALSE(stage.is_null());
+    EXPECT_FALSE(upsert.contains("parentSpanId"));
+    EXPECT_EQ(stage["traceId"], upsert["traceId"]);
+    EXPECT_EQ(stage["parentSpanId"], upsert["spanId"]);
+
+    std::size_t engine_calls = 0;
+    for (json_t const& span : spans)
+        engine_calls += span.value("parentSpanId", std::string()) == stage["spanId"].get<std::string>();
+    EXPECT_GE(engine_calls, 1u);
+#else
+    EXPECT_FALSE(traces(text));
+#endif
+    db.close();
+#endif
 }
 
 /**
- * Checks the "Snapshot Isolation" consistency guarantees of transactions.
- * If needed, readers can initiate snapshot-backed transactions.
- * All the reads, directed to that snapshot will not see newer operations,
- * affecting the HEAD state. From a consistency standpoint, it is a downgrade
- * from "Strictly Serializable" ACID transactions, but it is extremely useful
- * for numerous Business Intelligence applications.
- * https://jepsen.io/consistency/models/snapshot-isolation
+ * Compares the layout-specialized views of batched arguments, that engines walk
+ * in their hot loops, with the generic strided ones.
  */
-TEST(db, transaction_snapshot_isolation) {
-    if (!ustore_supports_snapshots_k)
-        return;
+TEST(db, dense_arguments) {
+    triplet_t triplet;
+    ustore_collection_t collection = ustore_collection_main_k;
+    std::size_t dense_count = 0;
+
+    std::array<places_arg_t, 3> all_places {{
+        {{}, {triplet.keys.data(), sizeof(ustore_key_t)}, {}, 3},
+        {{&collection, 0}, {triplet.keys.data(), sizeof(ustore_key_t)}, {}, 3},
+        {{}, {triplet.keys.data(), 0}, {}, 3},
+    }};
+    for (places_arg_t const& places : all_places)
+        dispatch_places(places, [&](auto const& dispatched) {
+            dense_count += !std::is_same_v<std::decay_t<decltype(dispatched)>, places_arg_t>;
+            for (std::size_t i = 0; i != places.size(); ++i) {
+                EXPECT_EQ(dispatched[i].collection, places[i].collection);
+                EXPECT_EQ(dispatched[i].key, places[i].key);
+            }
+        });
+    EXPECT_EQ(dense_count, 2u);
+
+    dense_count = 0;
+    for (contents_arg_t const& contents :
+         {triplet.contents_arrow(), triplet.contents_lengths(), triplet.contents_full()})
+        dispatch_contents(contents, [&](auto const& dispatched) {
+            dense_count += !std::is_same_v<std::decay_t<decltype(dispatched)>, contents_arg_t>;
+            for (std::size_t i = 0; i != contents.size(); ++i)
+                EXPECT_EQ(dispatched[i], contents[i]);
+        });
+    EXPECT_EQ(dense_count, 2u);
+}
 
+/**
+ * Writes unsorted batches with repeating keys, expecting the last write of every key to win,
+ * and batches of values, that the engine adopts instead of copying.
+ */
+TEST(db, batch_write_adopted) {
+#if defined(USTORE_ENGINE_IS_UCSET)
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
+    arena_t arena(db);
+    status_t status;
+    std::array<ustore_key_t, 4> keys {3, 1, 3, 2};
+    std::array<char const*, 4> values {"first", "one", "last", "two"};
+    ustore_write_t write {};
+    write.db = db;
+    write.error = status.member_ptr();
+    write.arena = arena.member_ptr();
+    write.tasks_count = keys.size();
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.values = reinterpret_cast<ustore_bytes_cptr_t const*>(values.data());
+    write.values_stride = sizeof(char const*);
+    ustore_write(&write);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(collection[1].value(), value_view_t("one"));
+    EXPECT_EQ(collection[2].value(), value_view_t("two"));
+    EXPECT_EQ(collection[3].value(), value_view_t("last"));
+
+    // Every adopted value is a separate allocation, freed by the engine
+    std::array<ustore_key_t, 3> adopted_keys {12, 10, 11};
+    std::array<ustore_bytes_cptr_t, 3> adopted_values {};
+    std::array<ustore_length_t, 3> adopted_lengths {};
+    for (std::size_t i = 0; i != adopted_keys.size(); ++i) {
+        std::string value = fmt::format("adopted-{}", adopted_keys[i]);
+        auto buffer = static_cast<ustore_bytes_ptr_t>(std::malloc(value.size()));
+        std::memcpy(buffer, value.data(), value.size());
+        adopted_values[i] = buffer;
+        adopted_lengths[i] = static_cast<ustore_length_t>(value.size());
+    }
+    write.options = ustore_option_write_adopt_k;
+    write.tasks_count = adopted_keys.size();
+    write.keys = adopted_keys.data();
+    write.values = adopted_values.data();
+    write.values_stride = sizeof(ustore_bytes_cptr_t);
+    write.lengths = adopted_lengths.data();
+    write.lengths_stride = sizeof(ustore_length_t);
+    ustore_write(&write);
+    EXPECT_TRUE(status);
+    for (ustore_key_t key : adopted_keys)
+        EXPECT_EQ(collection[key].value(), value_view_t(fmt::format("adopted-{}", key).c_str()));
 
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+    // Replacing the adopted values frees them
+    EXPECT_TRUE(collection[10].assign("copied"));
+    EXPECT_EQ(collection[10].value(), value_view_t("copied"));
+    db.close();
+#endif
+}
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+/**
+ * Big batches of sorted and shuffled keys, including missing ones, are read
+ * in the order they were requested, regardless of how the engine visits them.
+ */
+TEST(db, batch_read_big) {
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
-    round_trip(snap_ref, triplet);
-    round_trip(collection_ref, triplet_same_v);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-    // Validate that values match
-    auto maybe_retrieved = snap_ref.value();
-    auto const& retrieved = *maybe_retrieved;
-    auto it = retrieved.begin();
-    auto cont = triplet_same_v.contents_full();
-    for (std::size_t i = 0; i != cont.size(); ++i, ++it) {
-        auto expected_len = cont[i].size();
-        auto expected_begin = cont[i].begin();
+    for (ustore_key_t key = 0; key != 1000; key += 2)
+        EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
+
+    std::vector<ustore_key_t> keys(300);
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        keys[i] = static_cast<ustore_key_t>(i * 3);
+    for (bool shuffled : {false, true}) {
+        if (shuffled)
+            std::shuffle(keys.begin(), keys.end(), std::mt19937 {42});
+
+        arena_t arena(db);
+        status_t status;
+        ustore_length_t* offsets = nullptr;
+        ustore_length_t* lengths = nullptr;
+        ustore_byte_t* values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.tasks_count = keys.size();
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &offsets;
+        read.lengths = &lengths;
+        read.values = &values;
+        ustore_read(&read);
+        EXPECT_TRUE(status);
 
-        value_view_t retrieved_view = *it;
-        value_view_t expected_view(expected_begin, expected_begin + expected_len);
-        EXPECT_EQ(retrieved_view.size(), expected_view.size());
-        EXPECT_NE(retrieved_view, expected_view);
+        for (std::size_t i = 0; i != keys.size(); ++i) {
+            if (keys[i] % 2 || keys[i] >= 1000) {
+                EXPECT_EQ(lengths[i], ustore_length_missing_k);
+                continue;
+            }
+            std::string exported(reinterpret_cast<char const*>(values) + offsets[i], lengths[i]);
+            EXPECT_EQ(exported, std::to_string(keys[i]));
+        }
     }
-
-    snap = *db.snapshot();
-    auto ref = snap[triplet_same_v.keys];
-    round_trip(ref, triplet_same_v);
-
-    EXPECT_TRUE(db.clear());
+    db.close();
 }
-TEST(db, snapshots_list) {
-    if (!ustore_supports_snapshots_k)
-        return;
+
+/**
+ * Reads of just the presences or just the lengths are served without exporting the values,
+ * so they must match the values, that were written, including the missing ones.
+ */
+TEST(db, batch_read_sizes) {
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-    auto snap_1 = *db.snapshot();
-    auto snapshots = snap_1.snapshots();
-    auto snaps = *snapshots;
+    for (ustore_key_t key = 0; key != 1000; key += 2)
+        EXPECT_TRUE(collection[key].assign(std::string(key % 7 + 1, 'x').c_str()));
+
+    std::vector<ustore_key_t> keys(300);
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        keys[i] = static_cast<ustore_key_t>(i * 5);
+    for (bool watched : {false, true}) {
+        auto maybe_txn = db.transact();
+        bool const transactional = watched && maybe_txn;
+        auto expected_presence = [&](std::size_t i) {
+            return keys[i] % 2 == 0 && keys[i] < 1000;
+        };
+
+        // Both reads share the arena, so the first result is checked before the second read
+        auto lengths = transactional ? (*maybe_txn)[keys].length() : collection[keys].length();
+        EXPECT_TRUE(lengths);
+        for (std::size_t i = 0; i != keys.size(); ++i)
+            EXPECT_EQ(lengths->at(i), expected_presence(i) ? keys[i] % 7 + 1 : ustore_length_missing_k);
+
+        auto presences = transactional ? (*maybe_txn)[keys].present() : collection[keys].present();
+        EXPECT_TRUE(presences);
+        for (std::size_t i = 0; i != keys.size(); ++i)
+            EXPECT_EQ(presences->at(i), expected_presence(i));
+    }
+    db.close();
+}
 
-    EXPECT_EQ(snaps.size(), 1u);
+/**
+ * Erasing a range must remove exactly the keys in `[min_key, max_key)`,
+ * keeping the neighbors, other collections and the versions seen by snapshots.
+ */
+TEST(db, erase_ranges) {
 
-    auto snap_2 = *db.snapshot();
-    snapshots = snap_2.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 2u);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-    auto snap_3 = *db.snapshot();
-    snapshots = snap_3.snapshots();
-    snaps = *snapshots;
+    std::vector<ustore_key_t> keys(1000);
+    std::iota(keys.begin(), keys.end(), 0);
+    for (ustore_key_t key : keys)
+        EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
 
-    EXPECT_EQ(snaps.size(), 3u);
+    std::optional<blobs_collection_t> other;
+    if (ustore_supports_named_collections_k) {
+        other = *db["other"];
+        for (ustore_key_t key : keys)
+            EXPECT_TRUE((*other)[key].assign(std::to_string(key).c_str()));
+    }
 
-    snap_1 = *db.snapshot();
-    snapshots = snap_1.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 3u);
+    std::optional<context_t> snap;
+    if (ustore_supports_snapshots_k)
+        snap = *db.snapshot();
 
-    EXPECT_TRUE(db.clear());
+    EXPECT_TRUE(collection.erase(100, 200));
+    EXPECT_TRUE(collection.erase(500, 400));
+    EXPECT_TRUE(collection.erase(990, std::numeric_limits<ustore_key_t>::max()));
 
-    snapshots = snap_1.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 0u);
+    auto expected_presence = [](ustore_key_t key) {
+        return (key < 100 || key >= 200) && key < 990;
+    };
+    auto presences = collection[keys].present();
+    EXPECT_TRUE(presences);
+    for (ustore_key_t key : keys)
+        EXPECT_EQ(presences->at(key), expected_presence(key));
+
+    if (other) {
+        auto other_presences = (*other)[keys].present();
+        EXPECT_TRUE(other_presences);
+        for (ustore_key_t key : keys)
+            EXPECT_TRUE(other_presences->at(key));
+    }
+
+    if (snap) {
+        auto snap_presences = (*snap)[keys].present();
+        EXPECT_TRUE(snap_presences);
+        for (ustore_key_t key : keys)
+            EXPECT_TRUE(snap_presences->at(key));
+        snap.reset();
+    }
 
     EXPECT_TRUE(db.clear());
+    db.close();
 }
 
-TEST(db, transaction_with_snapshot) {
-    if (!ustore_supports_snapshots_k)
-        return;
+/**
+ * Remote clients stream large batches in chunks, so the answers to all chunks,
+ * including the last partial one, must be joined in the original order.
+ */
+TEST(db, batch_read_chunks) {
 
     clear_environment();
     database_t db;
+#if defined(USTORE_FLIGHT_CLIENT)
+    EXPECT_TRUE(db.open("grpc://0.0.0.0:38709?chunk=16"));
+#else
     EXPECT_TRUE(db.open(config().c_str()));
+#endif
+    blobs_collection_t collection = db.main();
 
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
+    for (ustore_key_t key = 0; key != 1000; key += 2)
+        EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
 
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+    std::vector<ustore_key_t> keys(301);
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        keys[i] = static_cast<ustore_key_t>(i * 3);
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+    arena_t arena(db);
+    status_t status;
+    ustore_octet_t* presences = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_length_t* lengths = nullptr;
+    ustore_byte_t* values = nullptr;
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.arena = arena.member_ptr();
+    read.tasks_count = keys.size();
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.presences = &presences;
+    ustore_read(&read);
+    EXPECT_TRUE(status);
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        EXPECT_EQ(bits_view_t(presences)[i], !(keys[i] % 2) && keys[i] < 1000);
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
-    check_equalities(snap_ref, triplet);
+    read.presences = nullptr;
+    read.offsets = &offsets;
+    read.lengths = &lengths;
+    read.values = &values;
+    ustore_read(&read);
+    EXPECT_TRUE(status);
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        if (keys[i] % 2 || keys[i] >= 1000) {
+            EXPECT_EQ(lengths[i], ustore_length_missing_k);
+            continue;
+        }
+        std::string exported(reinterpret_cast<char const*>(values) + offsets[i], lengths[i]);
+        EXPECT_EQ(exported, std::to_string(keys[i]));
+    }
+    db.close();
+}
 
-    round_trip(collection_ref, triplet_same_v);
+#if defined(USTORE_FLIGHT_CLIENT)
+static json_t cache_usage(database_t& db) {
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.error = status.member_ptr();
+    control.arena = arena.member_ptr();
+    control.request = "cache";
+    control.response = &response;
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
+    return response ? json_t::parse(response) : json_t {};
+}
+#endif
 
-    transaction_t txn = *db.transact();
-    auto txn_ref_1 = txn[triplet.keys];
-    check_equalities(txn_ref_1, triplet_same_v);
+/**
+ * Remote clients may cache the values they read, but must forget them on their own writes,
+ * and must still ask the server when the cache is bypassed.
+ */
+TEST(db, batch_read_cached) {
 
-    txn.set_snapshot(snap.snap());
-    auto txn_ref_2 = txn[triplet.keys];
-    check_equalities(txn_ref_2, triplet);
+    clear_environment();
+    database_t db;
+#if defined(USTORE_FLIGHT_CLIENT)
+    EXPECT_TRUE(db.open("grpc://0.0.0.0:38709?cache=64"));
+#else
+    EXPECT_TRUE(db.open(config().c_str()));
+#endif
+    blobs_collection_t collection = db.main();
 
-    snap = *db.snapshot();
-    txn.set_snapshot(snap.snap());
+    std::vector<ustore_key_t> keys {1, 2, 3, 4};
+    EXPECT_TRUE(collection[1].assign("one"));
+    EXPECT_TRUE(collection[2].assign("two"));
+    EXPECT_EQ(collection[keys].value()->size(), keys.size());
+    EXPECT_EQ(collection[1].value(), value_view_t("one"));
+    EXPECT_EQ(collection[3].value(), value_view_t {});
 
-    auto txn_ref_3 = txn[triplet.keys];
-    check_equalities(txn_ref_3, triplet_same_v);
-    EXPECT_TRUE(db.clear());
+    // Overwrite the cached values and remove the cached missing one
+    EXPECT_TRUE(collection[1].assign("uno"));
+    EXPECT_TRUE(collection[3].assign("tres"));
+    EXPECT_EQ(collection[1].value(), value_view_t("uno"));
+    EXPECT_EQ(collection[2].value(), value_view_t("two"));
+    EXPECT_EQ(collection[3].value(), value_view_t("tres"));
+
+    arena_t arena(db);
+    status_t status;
+    ustore_length_t* offsets = nullptr;
+    ustore_length_t* lengths = nullptr;
+    ustore_byte_t* values = nullptr;
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.arena = arena.member_ptr();
+    read.options = ustore_option_read_bypass_cache_k;
+    read.tasks_count = keys.size();
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &offsets;
+    read.lengths = &lengths;
+    read.values = &values;
+    ustore_read(&read);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(value_view_t(values + offsets[0], lengths[0]), value_view_t("uno"));
+    EXPECT_EQ(value_view_t(values + offsets[2], lengths[2]), value_view_t("tres"));
+    EXPECT_EQ(lengths[3], ustore_length_missing_k);
+
+#if defined(USTORE_FLIGHT_CLIENT)
+    auto usage = cache_usage(db);
+    ASSERT_FALSE(usage.is_null());
+    EXPECT_EQ(usage["capacity"], 64);
+    EXPECT_GT(usage["hits"].get<std::size_t>(), 0u);
+    EXPECT_GT(usage["misses"].get<std::size_t>(), 0u);
+    EXPECT_LE(usage["entries"].get<std::size_t>(), 4u);
+#endif
+    db.close();
 }
 
-TEST(db, set_wrong_snapshot) {
-    if (!ustore_supports_snapshots_k)
-        return;
+/**
+ * Submits many independent reads at once, each with its own arena,
+ * expecting the same results as from the synchronous calls.
+ */
+TEST(db, batch_read_async) {
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-
-    triplet_t triplet;
     blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+    constexpr std::size_t requests_count = 32;
+    for (ustore_key_t key = 0; key != static_cast<ustore_key_t>(requests_count); ++key)
+        EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
+
+    struct request_t {
+        ustore_key_t key = 0;
+        ustore_arena_t arena = nullptr;
+        ustore_error_t error = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_length_t* lengths = nullptr;
+        ustore_byte_t* values = nullptr;
+        ustore_read_t read {};
+        ustore_future_t future = nullptr;
+    };
+    std::vector<request_t> requests(requests_count);
+    std::atomic<std::size_t> completed {0};
+    status_t status;
+    for (std::size_t i = 0; i != requests_count; ++i) {
+        request_t& request = requests[i];
+        request.key = static_cast<ustore_key_t>(requests_count - i - 1);
+        request.read.db = db;
+        request.read.error = &request.error;
+        request.read.arena = &request.arena;
+        request.read.tasks_count = 1;
+        request.read.keys = &request.key;
+        request.read.offsets = &request.offsets;
+        request.read.lengths = &request.lengths;
+        request.read.values = &request.values;
+
+        ustore_submit_t submit {};
+        submit.db = db;
+        submit.error = status.member_ptr();
+        submit.read = &request.read;
+        submit.callback = [](void* context) { ++*reinterpret_cast<std::atomic<std::size_t>*>(context); };
+        submit.callback_context = &completed;
+        submit.future = &request.future;
+        ustore_submit(&submit);
+        EXPECT_TRUE(status);
+    }
 
-    auto snap = *db.snapshot();
+    for (request_t& request : requests) {
+        bool done = false;
+        ustore_future_wait_t wait {};
+        wait.future = request.future;
+        wait.blocking = true;
+        wait.done = &done;
+        ustore_future_wait(&wait);
+        EXPECT_TRUE(done);
+        EXPECT_EQ(request.error, nullptr);
+        std::string exported(reinterpret_cast<char const*>(request.values) + request.offsets[0], request.lengths[0]);
+        EXPECT_EQ(exported, std::to_string(request.key));
+        ustore_future_free(request.future);
+        ustore_arena_free(request.arena);
+    }
+    EXPECT_EQ(completed.load(), requests_count);
+
+    // Submitting nothing or more than one operation at once is rejected
+    ustore_future_t future = nullptr;
+    ustore_submit_t submit {};
+    submit.db = db;
+    submit.error = status.member_ptr();
+    submit.future = &future;
+    ustore_submit(&submit);
+    EXPECT_FALSE(status);
+    db.close();
+}
 
-    auto snap_ref = snap[triplet.keys];
-    check_equalities(snap_ref, triplet);
+/**
+ * Remote clients may compress large batches and receive the keys of scans as deltas,
+ * which must be transparent to the caller, even for keys spanning the whole range.
+ */
+TEST(db, batch_scan_compressed) {
 
-    auto snapshots = snap.snapshots();
-    auto snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 1u);
+    clear_environment();
+    database_t db;
+#if defined(USTORE_FLIGHT_CLIENT)
+    EXPECT_TRUE(db.open("grpc://0.0.0.0:38709?compression=zstd&compression_min=0"));
+#else
+    EXPECT_TRUE(db.open(config().c_str()));
+#endif
+    blobs_collection_t collection = db.main();
 
-    auto snapshot = snap.snap();
+    std::vector<ustore_key_t> keys(2048);
+    std::iota(keys.begin(), keys.end(), 0);
+    keys.front() = std::numeric_limits<ustore_key_t>::min() + 1;
+    keys.back() = std::numeric_limits<ustore_key_t>::max() - 1;
+    EXPECT_TRUE(collection[keys].assign(value_view_t("value")));
 
-    ustore_snapshot_t wrong_snap = 1u;
-    snap.set_snapshot(wrong_snap);
+    keys_stream_t stream(db, collection, keys.size());
+    EXPECT_TRUE(stream.seek(keys.front()));
+    auto batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), keys.size());
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        EXPECT_EQ(batch[i], keys[i]);
+
+    auto values = collection[keys].value();
+    EXPECT_TRUE(values);
+    auto it = values->begin();
+    for (std::size_t i = 0; i != keys.size(); ++i, ++it)
+        EXPECT_EQ(*it, value_view_t("value"));
+    db.close();
+}
 
-    auto wrong_snap_ref = snap[triplet.keys];
-    EXPECT_FALSE(wrong_snap_ref.value());
+/**
+ * Bulk writes are only a hint to the engine, so the results must match a regular batch:
+ * the last write of every key wins and missing values remove the keys.
+ */
+TEST(db, batch_write_bulk) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+    EXPECT_TRUE(collection[7].assign("removed"));
+
+    constexpr std::size_t writes_count = 10000;
+    constexpr ustore_key_t keys_count = 5000;
+    std::vector<ustore_key_t> keys(writes_count);
+    std::vector<std::string> strings(writes_count);
+    std::vector<ustore_bytes_cptr_t> values(writes_count);
+    std::vector<ustore_length_t> lengths(writes_count);
+    std::map<ustore_key_t, std::string> expected;
+    for (std::size_t i = 0; i != writes_count; ++i) {
+        keys[i] = static_cast<ustore_key_t>(i * 7919) % keys_count;
+        strings[i] = fmt::format("{}-{}", keys[i], i);
+        bool const remove = keys[i] == 7;
+        values[i] = remove ? nullptr : reinterpret_cast<ustore_bytes_cptr_t>(strings[i].data());
+        lengths[i] = remove ? ustore_length_missing_k : static_cast<ustore_length_t>(strings[i].size());
+        if (!remove)
+            expected[keys[i]] = strings[i];
+    }
 
-    snap.set_snapshot(snapshot);
-    auto right_snap_ref = snap[triplet.keys];
-    EXPECT_TRUE(right_snap_ref.value());
+    arena_t arena(db);
+    status_t status;
+    ustore_write_t write {};
+    write.db = db;
+    write.error = status.member_ptr();
+    write.arena = arena.member_ptr();
+    write.options = ustore_option_write_bulk_k;
+    write.tasks_count = writes_count;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.values = values.data();
+    write.values_stride = sizeof(ustore_bytes_cptr_t);
+    write.lengths = lengths.data();
+    write.lengths_stride = sizeof(ustore_length_t);
+    ustore_write(&write);
+    EXPECT_TRUE(status);
 
-    EXPECT_TRUE(db.clear());
+    EXPECT_EQ(expected.size(), static_cast<std::size_t>(keys_count - 1));
+    for (auto const& [key, value] : expected)
+        EXPECT_EQ(collection[key].value(), value_view_t(value.c_str()));
+    EXPECT_FALSE(*collection[7].present());
+    db.close();
 }
 
 /**
- * Creates news collection under unique names.
- * Fill data in collection. Checking/dropping/checking collection data by thread.
+ * Per-collection RocksDB options are applied to new and recovered collections alike,
+ * and invalid ones are reported on open.
  */
-TEST(db, snapshot_with_threads) {
-    if (!ustore_supports_snapshots_k)
+TEST(db, rocksdb_collection_options) {
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    if (!path())
         return;
 
     clear_environment();
+    std::string tuned_config = fmt::format(R"({{
+        "version": "1.0",
+        "directory": "{}",
+        "engine": {{
+            "config": {{
+                "CFOptions": {{"bloom_filter_bits": 10, "block_size": 16384}},
+                "BlockCache": {{"capacity": "64MB", "type": "lru"}},
+                "Collections": {{"tuned": {{"bloom_filter_bits": 16, "compression_per_level": ["kNoCompression"]}}}}
+            }}
+        }}
+    }})",
+                                           path());
 
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
-
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
+    EXPECT_TRUE(db.open(tuned_config.c_str()));
+    blobs_collection_t tuned = *db.create("tuned");
+    for (ustore_key_t key = 0; key != 1000; key += 2)
+        EXPECT_TRUE(tuned[key].assign(fmt::format("{}", key).c_str()));
+    db.close();
 
-    blobs_collection_t collection = db.main();
-    auto ref = collection[triplet.keys];
-    round_trip(ref, triplet);
+    EXPECT_TRUE(db.open(tuned_config.c_str()));
+    tuned = *db["tuned"];
+    for (ustore_key_t key = 0; key != 1000; ++key)
+        EXPECT_EQ(*tuned[key].present(), key % 2 == 0);
+    db.close();
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
+    std::string wrong_config = fmt::format(
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"CFOptions": {{"compression": "kMagic"}}}}}}}})",
+        path());
+    EXPECT_FALSE(db.open(wrong_config.c_str()));
+#endif
+}
 
-    round_trip(ref, triplet_same_v);
+/**
+ * Reads and writes through the RocksDB hot tier with both policies, expecting every path,
+ * that bypasses it, like transactions, snapshots and scans, to see the latest pairs.
+ */
+TEST(db, rocksdb_hot_tier) {
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    if (!path())
+        return;
 
-    std::shared_mutex mutex;
-    bool is_deleted = false;
-    auto task_read = [&]() {
-        while (true) {
-            std::shared_lock _ {mutex};
-            if (is_deleted) {
-                auto ref = snap[triplet.keys];
-                check_equalities(ref, triplet_same_v);
-                break;
-            }
-            check_equalities(snap_ref, triplet);
-        }
-    };
-
-    auto task_reset = [&]() {
-        std::unique_lock _ {mutex};
-        snap.set_snapshot(0);
-        is_deleted = true;
-    };
-
-    std::thread t1(task_read);
-    std::thread t2(task_reset);
-    t1.join();
-    t2.join();
-
-    EXPECT_TRUE(db.clear());
+    for (char const* policy : {"write_through", "write_back"}) {
+        clear_environment();
+        std::string hot_config = fmt::format( //
+            R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"HotTier": {{
+                "capacity": "1MB", "policy": "{}", "admit_after": 1}}}}}}}})",
+            path(),
+            policy);
+
+        database_t db;
+        EXPECT_TRUE(db.open(hot_config.c_str()));
+        blobs_collection_t collection = db.main();
+        for (ustore_key_t key = 0; key != 100; ++key)
+            EXPECT_TRUE(collection[key].assign(fmt::format("{}", key).c_str()));
+
+        // Repeated reads are served from memory, but must see the overwrites and removals
+        for (std::size_t repetition = 0; repetition != 3; ++repetition)
+            for (ustore_key_t key = 0; key != 100; ++key)
+                EXPECT_EQ(collection[key].value(), value_view_t(fmt::format("{}", key).c_str()));
+        EXPECT_TRUE(collection[10].assign("overwritten"));
+        EXPECT_TRUE(collection[11].clear());
+        EXPECT_TRUE(collection[12].erase());
+        EXPECT_EQ(collection[10].value(), value_view_t("overwritten"));
+        EXPECT_EQ(collection[11].value()->size(), 0ul);
+        EXPECT_FALSE(*collection[12].present());
+
+        // Paths, that bypass the hot tier
+        EXPECT_EQ(collection.keys().size(), 99ul);
+        context_t snap = *db.snapshot();
+        EXPECT_EQ(snap.main()[10].value(), value_view_t("overwritten"));
+
+        // Committed transactions must invalidate the copies of the pairs they wrote
+        transaction_t txn = *db.transact();
+        EXPECT_EQ(txn[20].value(), value_view_t("20"));
+        EXPECT_TRUE(txn[20].assign("transactional"));
+        EXPECT_TRUE(txn[21].erase());
+        EXPECT_TRUE(txn.commit());
+        EXPECT_EQ(collection[20].value(), value_view_t("transactional"));
+        EXPECT_FALSE(*collection[21].present());
+
+        EXPECT_TRUE(collection.erase(30, 40));
+        EXPECT_FALSE(*collection[35].present());
+        EXPECT_EQ(collection[40].value(), value_view_t("40"));
+
+        // Pending pairs are flushed on close
+        EXPECT_TRUE(collection[50].assign("last"));
+        db.close();
+        EXPECT_TRUE(db.open(hot_config.c_str()));
+        collection = db.main();
+        EXPECT_EQ(collection[50].value(), value_view_t("last"));
+        EXPECT_EQ(collection[20].value(), value_view_t("transactional"));
+        db.close();
+    }
+#endif
 }
 
-TEST(db, transaction_erase_missing) {
-    if (!ustore_supports_transactions_k)
+/**
+ * Writes more values, than the `memory_limit` allows, expecting the colder ones
+ * to be spilled to disk, while remaining readable and persisted on close.
+ */
+TEST(db, memory_limit) {
+#if defined(USTORE_ENGINE_IS_UCSET)
+    if (!path())
         return;
 
     clear_environment();
+    auto limited_config = fmt::format( //
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"memory_limit": "1MB"}}}}}})",
+        path());
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn1 = *db.transact();
-    transaction_t txn2 = *db.transact();
+    ASSERT_TRUE(db.open(limited_config.c_str()));
 
-    EXPECT_TRUE(txn2.main().at(-7297309151944849401).erase());
-    EXPECT_TRUE(txn1.main().at(-8640850744835793378).erase());
-    EXPECT_TRUE(txn1.commit());
-    EXPECT_TRUE(txn2.commit());
+    constexpr ustore_key_t keys_count = 4096;
+    auto make_value = [](ustore_key_t key) {
+        return fmt::format("{:0>1024}", key);
+    };
+    {
+        blobs_collection_t collection = *db.create("limited");
+        for (ustore_key_t key = 0; key != keys_count; ++key)
+            EXPECT_TRUE(collection[key].assign(make_value(key).c_str()));
+
+        auto usage = memory_usage(db);
+        ASSERT_FALSE(usage.is_null());
+        EXPECT_EQ(usage["collections"]["limited"]["pairs"], keys_count);
+        EXPECT_GT(usage["collections"]["limited"]["spilled_bytes"].get<std::size_t>(), 0ul);
+        EXPECT_GT(usage["spill_file_bytes"].get<std::size_t>(), 0ul);
+
+        for (ustore_key_t key = 0; key != keys_count; ++key)
+            EXPECT_EQ(collection[key].value(), value_view_t(make_value(key).c_str()));
+    }
+    db.close();
 
-    EXPECT_EQ(db.main().at(-8640850744835793378).value(), value_view_t {});
-    EXPECT_EQ(db.main().at(-7297309151944849401).value(), value_view_t {});
-    EXPECT_EQ(db.main().keys().size(), 0u);
+    EXPECT_TRUE(db.open(config().c_str()));
+    {
+        blobs_collection_t collection = *db["limited"];
+        for (ustore_key_t key = 0; key != keys_count; key += 64)
+            EXPECT_EQ(collection[key].value(), value_view_t(make_value(key).c_str()));
+    }
+    db.close();
+#endif
 }
 
-TEST(db, transaction_write_conflicting) {
-    if (!ustore_supports_transactions_k)
+/**
+ * Exports an image, starts a fresh database on top of it, and checks that
+ * the changes, including removals of the mapped keys, survive a restart.
+ */
+TEST(db, image) {
+#if defined(USTORE_ENGINE_IS_UCSET)
+    if (!path())
         return;
 
+    namespace stdfs = std::filesystem;
+    std::string image_path = (stdfs::temp_directory_path() / "ustore_test_units.image").string();
+    stdfs::remove(image_path);
+
     clear_environment();
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn1 = *db.transact();
-    transaction_t txn2 = *db.transact();
+    constexpr ustore_key_t keys_count = 1000;
+    {
+        EXPECT_TRUE(db.open(config().c_str()));
+        blobs_collection_t collection = *db.create("imaged");
+        for (ustore_key_t key = 0; key != keys_count; ++key)
+            EXPECT_TRUE(collection[key * 2].assign(std::to_string(key).c_str()));
+
+        arena_t arena(db);
+        status_t status;
+        std::string request = "export_image " + image_path;
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db;
+        control.error = status.member_ptr();
+        control.arena = arena.member_ptr();
+        control.request = request.c_str();
+        control.response = &response;
+        ustore_database_control(&control);
+        ASSERT_TRUE(status);
+        db.close();
+    }
 
-    EXPECT_TRUE(txn2.main().at(6).assign("a"));
-    EXPECT_TRUE(txn1.main().at(6).assign("b"));
-    EXPECT_TRUE(txn1.commit());
-    EXPECT_FALSE(txn2.commit());
+    clear_environment();
+    auto image_config = fmt::format( //
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"image": "{}"}}}}}})",
+        path(),
+        image_path);
+    {
+        EXPECT_TRUE(db.open(image_config.c_str()));
+        blobs_collection_t collection = *db["imaged"];
+        EXPECT_EQ(collection.keys().size(), static_cast<std::size_t>(keys_count));
+        EXPECT_EQ(collection[10].value(), value_view_t("5"));
+        EXPECT_FALSE(*collection[11].present());
+
+        auto usage = memory_usage(db);
+        EXPECT_EQ(usage["collections"]["imaged"]["pairs"], keys_count);
+        EXPECT_GT(usage["collections"]["imaged"]["mapped_bytes"].get<std::size_t>(), 0ul);
+
+        EXPECT_TRUE(collection[10].assign("ten"));
+        EXPECT_TRUE(collection[11].assign("eleven"));
+        EXPECT_TRUE(collection[12].erase());
+        EXPECT_EQ(collection[10].value(), value_view_t("ten"));
+        EXPECT_FALSE(*collection[12].present());
+        EXPECT_EQ(collection.keys().size(), static_cast<std::size_t>(keys_count));
+        db.close();
+    }
+    {
+        EXPECT_TRUE(db.open(image_config.c_str()));
+        blobs_collection_t collection = *db["imaged"];
+        EXPECT_EQ(collection[10].value(), value_view_t("ten"));
+        EXPECT_EQ(collection[11].value(), value_view_t("eleven"));
+        EXPECT_FALSE(*collection[12].present());
+        EXPECT_EQ(collection[14].value(), value_view_t("7"));
+        EXPECT_EQ(collection.keys().size(), static_cast<std::size_t>(keys_count));
+        db.close();
+    }
+    stdfs::remove(image_path);
+#endif
 }
 
 /**
- *
+ * Migrates a DB with native keys into the bytewise format and checks,
+ * that negative and positive keys keep their order and values.
  */
-TEST(db, transaction_sequenced_commit) {
-    if (!ustore_supports_transactions_k)
+TEST(db, migrate_keys) {
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_LEVELDB)
+    if (!path())
         return;
 
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    char const* format_key = "KeyFormat";
+#else
+    char const* format_key = "key_format";
+#endif
+
     clear_environment();
+    std::string migrated_path = std::string(path()) + "migrated/";
+    std::vector<ustore_key_t> keys {std::numeric_limits<ustore_key_t>::min(), -256, -1, 0, 1, 255, 256};
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
+    {
+        EXPECT_TRUE(db.open(config().c_str()));
+        blobs_collection_t collection = db.main();
+        for (ustore_key_t key : keys)
+            EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
+
+        arena_t arena(db);
+        status_t status;
+        std::string request = "migrate_keys bytewise " + migrated_path;
+        ustore_str_view_t response = nullptr;
+        ustore_database_control_t control {};
+        control.db = db;
+        control.error = status.member_ptr();
+        control.arena = arena.member_ptr();
+        control.request = request.c_str();
+        control.response = &response;
+        ustore_database_control(&control);
+        ASSERT_TRUE(status);
+        db.close();
+    }
 
-    EXPECT_TRUE(db.transact());
-    transaction_t txn = *db.transact();
+    auto migrated_config = [&](char const* format) {
+        return fmt::format(R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"{}": "{}"}}}}}})",
+                           migrated_path,
+                           format_key,
+                           format);
+    };
+    EXPECT_FALSE(db.open(migrated_config("native").c_str()));
+    {
+        EXPECT_TRUE(db.open(migrated_config("bytewise").c_str()));
+        blobs_collection_t collection = db.main();
+        for (ustore_key_t key : keys)
+            EXPECT_EQ(collection[key].value(), value_view_t(std::to_string(key).c_str()));
+
+        std::vector<ustore_key_t> scanned;
+        for (ustore_key_t key : collection.keys())
+            scanned.push_back(key);
+        EXPECT_EQ(scanned, keys);
+
+        // New writes are ordered the same way as the migrated ones
+        EXPECT_TRUE(collection[-2].assign("-2"));
+        keys.insert(keys.begin() + 2, -2);
+        scanned.clear();
+        for (ustore_key_t key : collection.keys())
+            scanned.push_back(key);
+        EXPECT_EQ(scanned, keys);
+        db.close();
+    }
+#endif
+}
 
-    triplet_t triplet;
-    auto txn_ref = txn[triplet.keys];
+/**
+ * Commits small durable transactions from many threads at once, so that the
+ * group commit merges their log syncs, and checks that all of them persist.
+ */
+TEST(db, group_commit) {
+#if defined(USTORE_ENGINE_IS_UCSET) || defined(USTORE_ENGINE_IS_ROCKSDB)
+    if (!path())
+        return;
 
-    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
-    auto maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    auto current_sequence_number = *maybe_sequence_number;
-    EXPECT_GT(current_sequence_number, 0);
-    EXPECT_TRUE(txn.reset());
-#if 0
-    auto previous_sequence_number = current_sequence_number;
-    EXPECT_TRUE(txn_ref.value());
-    maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    current_sequence_number = *maybe_sequence_number;
-    EXPECT_EQ(current_sequence_number, previous_sequence_number);
-    EXPECT_TRUE(txn.reset());
+#if defined(USTORE_ENGINE_IS_UCSET)
+    char const* group_config = R"({"group_commit_wait_microseconds": 1000})";
+#else
+    char const* group_config = R"({"GroupCommit": {"max_wait_microseconds": 1000}})";
+#endif
 
-    previous_sequence_number = current_sequence_number;
-    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
-    maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    current_sequence_number = *maybe_sequence_number;
-    EXPECT_GT(current_sequence_number, previous_sequence_number);
+    clear_environment();
+    auto grouped_config = fmt::format( //
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {}}}}})",
+        path(),
+        group_config);
+    database_t db;
+    EXPECT_TRUE(db.open(grouped_config.c_str()));
+
+    constexpr std::size_t threads_count = 8;
+    constexpr ustore_key_t txns_per_thread = 64;
+    std::atomic<std::size_t> committed {0};
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back([&, thread_idx] {
+            for (ustore_key_t i = 0; i != txns_per_thread; ++i) {
+                ustore_key_t key = static_cast<ustore_key_t>(thread_idx) * txns_per_thread + i;
+                transaction_t txn = *db.transact();
+                if (!txn[key].assign(std::to_string(key).c_str()))
+                    continue;
+                if (txn.commit(true))
+                    ++committed;
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(committed.load(), threads_count * txns_per_thread);
+    db.close();
+
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+    for (ustore_key_t key = 0; key != static_cast<ustore_key_t>(threads_count) * txns_per_thread; ++key)
+        EXPECT_EQ(collection[key].value(), value_view_t(std::to_string(key).c_str()));
+    db.close();
 #endif
 }
 
-#pragma region Paths Modality
-
 /**
- * Tests "Paths" Modality, with variable length keys.
- * Reads, writes, prefix matching and pattern matching.
+ * Creates news collections under unique names.
+ * Tests collection lookup by name, dropping/clearing existing collections.
  */
-TEST(db, paths) {
+TEST(db, named_collections) {
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    char const* keys[] {"Facebook", "Apple", "Amazon", "Netflix", "Google", "Nvidia", "Adobe"};
-    char const* vals[] {"F", "A", "A", "N", "G", "N", "A"};
-    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
-    ustore_char_t separator = '\0';
+    // We can't drop a missing collection, or the main one.
+    EXPECT_FALSE(*db.contains("unknown"));
+    EXPECT_FALSE(db.drop("unknown"));
+    EXPECT_FALSE(db.drop(""));
 
-    arena_t arena(db);
-    status_t status {};
-    ustore_paths_write_t paths_write {};
-    paths_write.db = db;
-    paths_write.error = status.member_ptr();
-    paths_write.arena = arena.member_ptr();
-    paths_write.tasks_count = keys_count;
-    paths_write.path_separator = separator;
-    paths_write.paths = keys;
-    paths_write.paths_stride = sizeof(char const*);
-    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
-    paths_write.values_bytes_stride = sizeof(char const*);
+    if (ustore_supports_named_collections_k) {
 
-    ustore_paths_write(&paths_write);
-    char* vals_recovered {};
-    ustore_paths_read_t paths_read {};
-    paths_read.db = db;
-    paths_read.error = status.member_ptr();
-    paths_read.arena = arena.member_ptr();
-    paths_read.tasks_count = keys_count;
-    paths_read.path_separator = separator;
-    paths_read.paths = keys;
-    paths_read.paths_stride = sizeof(char const*);
-    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+        EXPECT_TRUE(db["col1"]);
+        EXPECT_TRUE(db["col2"]);
 
-    ustore_paths_read(&paths_read);
-    EXPECT_TRUE(status);
-    EXPECT_EQ(std::string_view(vals_recovered, keys_count * 2),
-              std::string_view("F\0A\0A\0N\0G\0N\0A\0", keys_count * 2));
+        EXPECT_FALSE(db.create("col1"));
+        blobs_collection_t col1 = *db["col1"];
+        EXPECT_FALSE(db.create("col2"));
+        blobs_collection_t col2 = *db["col2"];
 
-    // Try getting either "Netflix" or "Nvidia" as one of the keys with "N" prefix
-    ustore_str_view_t prefix = "N";
-    ustore_length_t max_count = 1;
-    ustore_length_t* results_counts {};
-    ustore_length_t* tape_offsets {};
-    ustore_char_t* tape_begin {};
-    ustore_paths_match_t paths_match {};
-    paths_match.db = db;
-    paths_match.error = status.member_ptr();
-    paths_match.arena = arena.member_ptr();
-    paths_match.tasks_count = 1;
-    paths_match.match_counts_limits = &max_count;
-    paths_match.patterns = &prefix;
-    paths_match.match_counts = &results_counts;
-    paths_match.paths_offsets = &tape_offsets;
-    paths_match.paths_strings = &tape_begin;
+        check_binary_collection(col1);
+        check_binary_collection(col2);
 
-    ustore_paths_match(&paths_match);
-    auto first_match_for_a = std::string_view(tape_begin);
-    EXPECT_EQ(results_counts[0], 1);
-    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Nvidia");
+        EXPECT_TRUE(db.drop("col1"));
+        EXPECT_TRUE(db.drop("col2"));
+        EXPECT_TRUE(*db.contains(""));
+        EXPECT_FALSE(*db.contains("col1"));
+        EXPECT_FALSE(*db.contains("col2"));
+    }
 
-    // Try getting the remaining results, which is the other one from that same pair
-    max_count = 10;
-    paths_match.previous = &tape_begin;
-    paths_match.options = ustore_option_dont_discard_memory_k;
-    ustore_paths_match(&paths_match);
-    auto second_match_for_a = std::string_view(tape_begin);
-    EXPECT_EQ(results_counts[0], 1);
-    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Nvidia");
-    EXPECT_NE(first_match_for_a, second_match_for_a);
+    EXPECT_TRUE(db.clear());
+    EXPECT_TRUE(*db.contains(""));
+}
 
-    // Try performing parallel queries in the same collection
-    ustore_str_view_t prefixes[2] = {"A", "N"};
-    std::size_t prefixes_count = sizeof(prefixes) / sizeof(prefixes[0]);
-    max_count = 10;
-    paths_match.tasks_count = prefixes_count;
-    paths_match.patterns = prefixes;
-    paths_match.patterns_stride = sizeof(ustore_str_view_t);
-    paths_match.previous = nullptr;
-    ustore_paths_match(&paths_match);
-    auto total_count = std::accumulate(results_counts, results_counts + prefixes_count, 0ul);
-    strings_tape_iterator_t tape_iterator {total_count, tape_begin};
-    std::set<std::string> tape_parts;
-    while (!tape_iterator.is_end()) {
-        tape_parts.insert(*tape_iterator);
-        ++tape_iterator;
-    }
-    EXPECT_EQ(results_counts[0], 3);
-    EXPECT_EQ(results_counts[1], 2);
-    EXPECT_NE(tape_parts.find("Netflix"), tape_parts.end());
-    EXPECT_NE(tape_parts.find("Adobe"), tape_parts.end());
+/**
+ * Tests listing the names of present collections.
+ */
+TEST(db, named_collections_list) {
 
-    // Now try matching a Regular Expression
-    prefix = "Netflix|Google";
-    paths_match.tasks_count = 1;
-    paths_match.patterns = &prefix;
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 2);
-    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Google");
-    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Google");
+    if (!ustore_supports_named_collections_k)
+        return;
 
-    // Try a more complex regular expression
-    prefix = "A.*e";
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 2);
-    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe");
-    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe");
-
-    // Existing single letter prefix
-    prefix = "A";
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 3);
-    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe" || first_match_for_a == "Amazon");
-    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe" || second_match_for_a == "Amazon");
-
-    // Missing single letter prefix
-    prefix = "X";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Missing pattern
-    prefix = "X.*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    blobs_collection_t col1 = *db.create("col1");
+    blobs_collection_t col2 = *db.create("col2");
+    blobs_collection_t col3 = *db.create("col3");
+    blobs_collection_t col4 = *db.create("col4");
 
-    // Try a more complex regular expression
-    prefix = "oo:18:\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    EXPECT_TRUE(*db.contains("col1"));
+    EXPECT_TRUE(*db.contains("col2"));
 
-    // Try an even more complex regular expression
-    prefix = "oo:18:\\\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    auto maybe_txn = db.transact();
+    EXPECT_TRUE(maybe_txn);
+    auto maybe_cols = maybe_txn->collections();
+    EXPECT_TRUE(maybe_cols);
 
-    EXPECT_TRUE(db.clear());
+    size_t count = 0;
+    std::vector<std::string> collections;
+    auto cols = *maybe_cols;
+    while (!cols.names.is_end()) {
+        collections.push_back(std::string(*cols.names));
+        ++cols.names;
+        ++count;
+    }
+    EXPECT_EQ(count, 4);
+    std::sort(collections.begin(), collections.end());
+    EXPECT_EQ(collections[0], "col1");
+    EXPECT_EQ(collections[1], "col2");
+    EXPECT_EQ(collections[2], "col3");
+    EXPECT_EQ(collections[3], "col4");
 
-    // Try an even more complex regular expression on empty DB
-    prefix = "oo:18:\\\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    EXPECT_TRUE(db.drop("col1"));
+    EXPECT_FALSE(*db.contains("col1"));
+    EXPECT_FALSE(db.drop(""));
+    EXPECT_TRUE(db.main().clear());
 }
 
 /**
- * Tests "Paths" Modality, by forming bidirectional linked lists from string-to-string mappings.
- * Uses different-length unique strings. As the underlying modality may be implemented as a bucketed hash-map,
- * this test helps catch problems in bucket reorganization.
+ * Tests clearing values in a collection, which would preserve the keys,
+ * but empty the binary strings.
  */
-TEST(db, paths_linked_list) {
-    constexpr std::size_t count = 1000;
+TEST(db, clear_values) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    arena_t arena(db);
-    ustore_char_t separator = '\0';
-    status_t status;
+    triplet_t triplet;
+    blobs_collection_t col = db.main();
+    auto collection_ref = col[triplet.keys];
 
-    ustore_paths_write_t paths_write {};
-    paths_write.db = db;
-    paths_write.error = status.member_ptr();
-    paths_write.arena = arena.member_ptr();
-    paths_write.tasks_count = 1;
-    paths_write.path_separator = separator;
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
+    check_length(collection_ref, triplet_t::val_size_k);
 
-    ustore_paths_read_t paths_read {};
-    paths_read.db = db;
-    paths_read.error = status.member_ptr();
-    paths_read.arena = arena.member_ptr();
-    paths_read.tasks_count = 1;
-    paths_read.path_separator = separator;
+    EXPECT_TRUE(col.clear_values());
+    check_length(collection_ref, 0);
+    col.clear();
+    check_length(collection_ref, ustore_length_missing_k);
 
-    // Generate some random strings for our tests
-    constexpr auto alphabet = "abcdefghijklmnop";
-    auto make_random_str = []() {
-        auto str = std::string();
-        auto len = static_cast<std::size_t>(std::rand() % 100) + 8;
-        for (std::size_t i = 0; i != len; ++i)
-            str.push_back(alphabet[std::rand() % 16]);
-        return str;
-    };
-    std::set<std::string> unique;
-    while (unique.size() != count)
-        unique.insert(make_random_str());
+    EXPECT_TRUE(db.clear());
+}
 
-    // Lets form a linked list, where every key maps into the the next key.
-    // Then we will traverse the linked list from start to end.
-    // Then we will re-link it in reverse order and traverse again.
-    std::vector<ustore_str_view_t> begins(unique.size());
-    std::transform(unique.begin(), unique.end(), begins.begin(), [](std::string const& str) { return str.c_str(); });
+/**
+ * Tests presences with C and C++ Interfaces.
+ */
+TEST(db, presences) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    auto main = db.main();
 
-    // Link forward
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        paths_write.paths = &smaller;
-        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&bigger);
-        ustore_paths_write(&paths_write);
-        EXPECT_TRUE(status);
+    constexpr std::size_t keys_count = 1000;
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        if (i % 10)
+            main[i] = "value";
+    }
 
-        // Check if it was successfully written:
-        ustore_str_span_t bigger_received = nullptr;
-        paths_read.paths = &smaller;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    // Native C Interface
+    std::vector<ustore_key_t> keys(keys_count);
+    std::iota(keys.begin(), keys.end(), 0);
+    ustore_octet_t* found_presences = nullptr;
+    arena_t arena(db);
+    status_t status {};
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.arena = arena.member_ptr();
+    read.tasks_count = keys_count;
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.presences = &found_presences;
+
+    ustore_read(&read);
+    EXPECT_TRUE(status);
+
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        if (i % 10) {
+            EXPECT_TRUE(check_presence(found_presences, i));
+        }
+        else {
+            EXPECT_FALSE(check_presence(found_presences, i));
+        }
     }
 
-    // Traverse forward, counting the entries and checking the order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        ustore_str_span_t bigger_received = nullptr;
-        paths_read.paths = &smaller;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    // C++ Interface
+    auto presences = main[keys].present().throw_or_release();
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        if (i % 10) {
+            EXPECT_TRUE(presences[i]);
+        }
+        else {
+            EXPECT_FALSE(presences[i]);
+        }
     }
+}
 
-    // Re-link in reverse order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        paths_write.paths = &bigger;
-        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&smaller);
-        ustore_paths_write(&paths_write);
-        EXPECT_TRUE(status);
+TEST(db, scan) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-        // Check if it was successfully over-written:
-        ustore_str_span_t smaller_received = nullptr;
-        paths_read.paths = &bigger;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
-    }
+    constexpr std::size_t keys_size = 1000;
+    std::array<ustore_key_t, keys_size> keys;
+    std::iota(std::begin(keys), std::end(keys), 0);
+    auto ref = collection[keys];
+    value_view_t value("value");
+    EXPECT_TRUE(ref.assign(value));
+    keys_stream_t stream(db, collection, 256);
 
-    // Traverse backwards, counting the entries and checking the order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        ustore_str_span_t smaller_received = nullptr;
-        paths_read.paths = &bigger;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    EXPECT_TRUE(stream.seek_to_first());
+    ustore_key_t key = 0;
+    while (!stream.is_end()) {
+        EXPECT_EQ(stream.key(), key++);
+        ++stream;
     }
+    EXPECT_EQ(key, keys_size);
 }
 
-#pragma region Documents Modality
+/**
+ * Ordered batched scan over the main collection.
+ */
+TEST(db, batch_scan) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    std::array<ustore_key_t, 512> keys;
+    std::iota(std::begin(keys), std::end(keys), 0);
+    auto ref = collection[keys];
+    value_view_t value("value");
+    EXPECT_TRUE(ref.assign(value));
+    keys_stream_t stream(db, collection, 256);
+
+    EXPECT_TRUE(stream.seek_to_first());
+    auto batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 256);
+    EXPECT_FALSE(stream.is_end());
+    for (ustore_key_t i = 0; i != 256; ++i)
+        EXPECT_EQ(batch[i], i);
+
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 256);
+    EXPECT_FALSE(stream.is_end());
+    for (ustore_key_t i = 0; i != 256; ++i)
+        EXPECT_EQ(batch[i], i + 256);
+
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_TRUE(stream.is_end());
+}
+
+/**
+ * Consecutive pages of a scan must observe the writes, that happened between them,
+ * even if the engine continues the previous page instead of seeking again.
+ */
+TEST(db, batch_scan_pages) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    std::array<ustore_key_t, 512> keys;
+    for (std::size_t i = 0; i != keys.size(); ++i)
+        keys[i] = static_cast<ustore_key_t>(i * 2);
+    EXPECT_TRUE(collection[keys].assign("value"));
+    keys_stream_t stream(db, collection, 100);
+
+    EXPECT_TRUE(stream.seek_to_first());
+    auto batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 100);
+    EXPECT_EQ(batch[99], 198);
+
+    // The next page starts at 199, right where the previous one stopped
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 100);
+    EXPECT_EQ(batch[0], 200);
+    EXPECT_EQ(batch[99], 398);
+
+    EXPECT_TRUE(collection[399].assign("inserted"));
+    EXPECT_TRUE(collection[400].erase());
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 100);
+    EXPECT_EQ(batch[0], 399);
+    EXPECT_EQ(batch[1], 402);
+}
+
+/**
+ * Streams, that fetch the following windows in the background, must pass
+ * the same keys, values and edges in the same order, as the synchronous ones.
+ */
+TEST(db, background_streams) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    constexpr ustore_key_t keys_count = 1000;
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        EXPECT_TRUE(collection[key].assign(std::to_string(key).c_str()));
+
+    for (std::size_t windows_ahead : {1, 3}) {
+        keys_stream_t keys(db, collection, 64);
+        EXPECT_TRUE(keys.fetch_in_background(windows_ahead));
+        EXPECT_TRUE(keys.seek_to_first());
+        ustore_key_t expected = 0;
+        for (; !keys.is_end(); ++keys, ++expected)
+            EXPECT_EQ(keys.key(), expected);
+        EXPECT_EQ(expected, keys_count);
+
+        // Seeking elsewhere drops the windows, fetched ahead
+        EXPECT_TRUE(keys.seek(keys_count - 10));
+        std::size_t batched = 0;
+        while (true) {
+            batched += keys.keys_batch().size();
+            if (keys.is_end())
+                break;
+            EXPECT_TRUE(keys.seek_to_next_batch());
+        }
+        EXPECT_EQ(batched, 10ul);
+
+        pairs_stream_t pairs(db, collection, 64);
+        EXPECT_TRUE(pairs.seek_to_first());
+        EXPECT_TRUE(pairs.fetch_in_background(windows_ahead));
+        expected = 0;
+        for (; !pairs.is_end(); ++pairs, ++expected)
+            EXPECT_EQ(pairs.value(), value_view_t(std::to_string(expected).c_str()));
+        EXPECT_EQ(expected, keys_count);
+    }
+
+    graph_collection_t net = *db.create<graph_collection_t>("background");
+    std::vector<edge_t> edges;
+    for (ustore_key_t vertex = 0; vertex != 300; ++vertex)
+        edges.push_back({vertex, (vertex * 7 + 1) % 300, vertex});
+    EXPECT_TRUE(net.upsert_edges(edges_view_t {edges.data(), edges.data() + edges.size()}));
+
+    graph_stream_t stream(db, *net.member_ptr(), nullptr, 0, 16, ustore_vertex_source_k);
+    EXPECT_TRUE(stream.seek_to_first());
+    EXPECT_TRUE(stream.fetch_in_background(2));
+    std::size_t edges_count = 0;
+    for (; !stream.is_end(); ++stream, ++edges_count)
+        EXPECT_EQ(stream.edge(), edges[stream.edge().source_id]);
+    EXPECT_EQ(edges_count, edges.size());
+}
+
+/**
+ * Scans can export the values together with the keys, without a follow-up read.
+ */
+TEST(db, batch_scan_values) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    for (ustore_key_t key = 0; key != 100; ++key)
+        EXPECT_TRUE(collection[key * 3].assign(std::string(static_cast<std::size_t>(key % 7), 'a' + key % 26).c_str()));
+
+    arena_t arena(db);
+    status_t status;
+    std::array<ustore_key_t, 2> start_keys {10, 280};
+    std::array<ustore_length_t, 2> limits {5, 10};
+    ustore_length_t* counts = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_key_t* keys = nullptr;
+    ustore_length_t* values_offsets = nullptr;
+    ustore_byte_t* values = nullptr;
+
+    ustore_scan_t scan {};
+    scan.db = db;
+    scan.error = status.member_ptr();
+    scan.arena = arena.member_ptr();
+    scan.tasks_count = start_keys.size();
+    scan.start_keys = start_keys.data();
+    scan.start_keys_stride = sizeof(ustore_key_t);
+    scan.count_limits = limits.data();
+    scan.count_limits_stride = sizeof(ustore_length_t);
+    scan.counts = &counts;
+    scan.offsets = &offsets;
+    scan.keys = &keys;
+    scan.values_offsets = &values_offsets;
+    scan.values = &values;
+    ustore_scan(&scan);
+    EXPECT_TRUE(status);
+
+    EXPECT_EQ(counts[0], 5u);
+    EXPECT_EQ(counts[1], 6u);
+    for (std::size_t i = 0; i != offsets[2]; ++i) {
+        ustore_key_t key = keys[i] / 3;
+        std::string expected(static_cast<std::size_t>(key % 7), 'a' + key % 26);
+        std::string exported(reinterpret_cast<char const*>(values) + values_offsets[i],
+                             values_offsets[i + 1] - values_offsets[i]);
+        EXPECT_EQ(exported, expected);
+    }
+    EXPECT_EQ(keys[0], 12);
+    EXPECT_EQ(keys[5], 282);
+    db.close();
+}
+
+/**
+ * Size estimates of a range are consistent bounds, and exact where the engine can count.
+ */
+TEST(db, measure) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    for (ustore_key_t key = 0; key != 100; ++key)
+        EXPECT_TRUE(collection[key].assign("0123456789"));
+
+    auto maybe_estimates = collection.members(0, 50).size_estimates();
+    EXPECT_TRUE(maybe_estimates);
+    size_estimates_t estimates = *maybe_estimates;
+    EXPECT_LE(estimates.cardinality.min, estimates.cardinality.max);
+    EXPECT_LE(estimates.bytes_in_values.min, estimates.bytes_in_values.max);
+    EXPECT_LE(estimates.bytes_on_disk.min, estimates.bytes_on_disk.max);
+
+#if defined(USTORE_ENGINE_IS_UCSET)
+    EXPECT_EQ(estimates.cardinality.min, 50u);
+    EXPECT_EQ(estimates.cardinality.max, 50u);
+    EXPECT_EQ(estimates.bytes_in_values.min, 500u);
+    EXPECT_GE(estimates.bytes_on_disk.min, 500u);
+#endif
+    db.close();
+}
+
+/**
+ * Multi-way joins must export exactly the keys present in all collections,
+ * regardless of their order, the read-ahead and the number of partitions.
+ */
+TEST(db, keys_join) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    if (!ustore_supports_named_collections_k)
+        return;
+
+    blobs_collection_t users = *db["users"];
+    blobs_collection_t profiles = *db["profiles"];
+    blobs_collection_t embeddings = *db["embeddings"];
+
+    std::vector<ustore_key_t> users_keys, profiles_keys, embeddings_keys, expected;
+    for (ustore_key_t key = 0; key != 10000; ++key) {
+        users_keys.push_back(key);
+        if (key % 3 == 0)
+            profiles_keys.push_back(key);
+        if (key % 101 == 0)
+            embeddings_keys.push_back(key);
+        if (key % 3 == 0 && key % 101 == 0)
+            expected.push_back(key);
+    }
+    value_view_t value("value");
+    EXPECT_TRUE(users[users_keys].assign(value));
+    EXPECT_TRUE(profiles[profiles_keys].assign(value));
+    EXPECT_TRUE(embeddings[embeddings_keys].assign(value));
+
+    ustore_collection_t collections[3] = {users, profiles, embeddings};
+    keys_join_t join(db, {collections, collections + 3});
+    keys_join_stream_t stream = *join.keys_begin(64);
+    std::vector<ustore_key_t> joined;
+    for (; !stream.is_end(); ++stream)
+        joined.push_back(*stream);
+    EXPECT_EQ(joined, expected);
+
+    for (std::size_t threads_count : {1, 4}) {
+        std::mutex joined_mutex;
+        joined.clear();
+        EXPECT_TRUE(join.for_each_batch(
+            [&](ptr_range_gt<ustore_key_t const> batch) {
+                std::lock_guard<std::mutex> lock {joined_mutex};
+                joined.insert(joined.end(), batch.begin(), batch.end());
+            },
+            threads_count,
+            32));
+        std::sort(joined.begin(), joined.end());
+        EXPECT_EQ(joined, expected);
+    }
+
+    // Joining with an empty collection yields nothing
+    ustore_collection_t with_empty[2] = {users, *db["empty"]};
+    keys_join_stream_t empty_stream = *keys_join_t(db, {with_empty, with_empty + 2}).keys_begin();
+    EXPECT_TRUE(empty_stream.is_end());
+    db.close();
+}
+
+/**
+ * Approximate sampling, that seeks to random points of the keys range,
+ * still exports only distinct present keys.
+ */
+TEST(db, sample_approximate) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
+
+    for (ustore_key_t key = 0; key != 1000; ++key)
+        EXPECT_TRUE(collection[key * 1000 + key % 3].assign("value"));
+
+    arena_t arena(db);
+    status_t status;
+    std::array<ustore_length_t, 2> limits {100, 900};
+    ustore_length_t* counts = nullptr;
+    ustore_length_t* offsets = nullptr;
+    ustore_key_t* keys = nullptr;
+
+    ustore_sample_t sample {};
+    sample.db = db;
+    sample.error = status.member_ptr();
+    sample.arena = arena.member_ptr();
+    sample.options = ustore_option_sample_approximate_k;
+    sample.tasks_count = limits.size();
+    sample.count_limits = limits.data();
+    sample.count_limits_stride = sizeof(ustore_length_t);
+    sample.counts = &counts;
+    sample.offsets = &offsets;
+    sample.keys = &keys;
+    ustore_sample(&sample);
+    EXPECT_TRUE(status);
+
+    for (std::size_t task_idx = 0; task_idx != limits.size(); ++task_idx) {
+        EXPECT_EQ(counts[task_idx], limits[task_idx]);
+        std::set<ustore_key_t> unique(keys + offsets[task_idx], keys + offsets[task_idx + 1]);
+        EXPECT_EQ(unique.size(), limits[task_idx]);
+        for (ustore_key_t key : unique)
+            EXPECT_EQ(key % 1000, (key / 1000) % 3);
+    }
+    db.close();
+}
+
+/**
+ * Checks the "Read Commited" consistency guarantees of transactions.
+ * Readers can't see the contents of pending (not committed) transactions.
+ * https://jepsen.io/consistency/models/read-committed
+ */
+TEST(db, transaction_read_commited) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.transact());
+    transaction_t txn = *db.transact();
+
+    triplet_t triplet;
+
+    auto txn_ref = txn[triplet.keys];
+    round_trip(txn_ref, triplet);
+
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
+
+    // Check for missing values before commit
+    check_length(collection_ref, ustore_length_missing_k);
+    EXPECT_TRUE(txn.commit());
+    EXPECT_TRUE(txn.reset());
+
+    // Validate that values match after commit
+    check_equalities(collection_ref, triplet);
+}
+
+/**
+ * Checks the "Snapshot Isolation" consistency guarantees of transactions.
+ * If needed, readers can initiate snapshot-backed transactions.
+ * All the reads, directed to that snapshot will not see newer operations,
+ * affecting the HEAD state. From a consistency standpoint, it is a downgrade
+ * from "Strictly Serializable" ACID transactions, but it is extremely useful
+ * for numerous Business Intelligence applications.
+ * https://jepsen.io/consistency/models/snapshot-isolation
+ */
+TEST(db, transaction_snapshot_isolation) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
+
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
+
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
+
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+    round_trip(snap_ref, triplet);
+    round_trip(collection_ref, triplet_same_v);
+
+    // Validate that values match
+    auto maybe_retrieved = snap_ref.value();
+    auto const& retrieved = *maybe_retrieved;
+    auto it = retrieved.begin();
+    auto cont = triplet_same_v.contents_full();
+    for (std::size_t i = 0; i != cont.size(); ++i, ++it) {
+        auto expected_len = cont[i].size();
+        auto expected_begin = cont[i].begin();
+
+        value_view_t retrieved_view = *it;
+        value_view_t expected_view(expected_begin, expected_begin + expected_len);
+        EXPECT_EQ(retrieved_view.size(), expected_view.size());
+        EXPECT_NE(retrieved_view, expected_view);
+    }
+
+    snap = *db.snapshot();
+    auto ref = snap[triplet_same_v.keys];
+    round_trip(ref, triplet_same_v);
+
+    EXPECT_TRUE(db.clear());
+}
+TEST(db, snapshots_list) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    auto snap_1 = *db.snapshot();
+    auto snapshots = snap_1.snapshots();
+    auto snaps = *snapshots;
+
+    EXPECT_EQ(snaps.size(), 1u);
+
+    auto snap_2 = *db.snapshot();
+    snapshots = snap_2.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 2u);
+
+    auto snap_3 = *db.snapshot();
+    snapshots = snap_3.snapshots();
+    snaps = *snapshots;
+
+    EXPECT_EQ(snaps.size(), 3u);
+
+    snap_1 = *db.snapshot();
+    snapshots = snap_1.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 3u);
+
+    EXPECT_TRUE(db.clear());
+
+    snapshots = snap_1.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 0u);
+
+    EXPECT_TRUE(db.clear());
+}
+
+TEST(db, transaction_with_snapshot) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
+
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
+
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
+
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+    check_equalities(snap_ref, triplet);
+
+    round_trip(collection_ref, triplet_same_v);
+
+    transaction_t txn = *db.transact();
+    auto txn_ref_1 = txn[triplet.keys];
+    check_equalities(txn_ref_1, triplet_same_v);
+
+    txn.set_snapshot(snap.snap());
+    auto txn_ref_2 = txn[triplet.keys];
+    check_equalities(txn_ref_2, triplet);
+
+    snap = *db.snapshot();
+    txn.set_snapshot(snap.snap());
+
+    auto txn_ref_3 = txn[triplet.keys];
+    check_equalities(txn_ref_3, triplet_same_v);
+    EXPECT_TRUE(db.clear());
+}
+
+TEST(db, set_wrong_snapshot) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    triplet_t triplet;
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
+
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
+
+    auto snap = *db.snapshot();
+
+    auto snap_ref = snap[triplet.keys];
+    check_equalities(snap_ref, triplet);
+
+    auto snapshots = snap.snapshots();
+    auto snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 1u);
+
+    auto snapshot = snap.snap();
+
+    ustore_snapshot_t wrong_snap = 1u;
+    snap.set_snapshot(wrong_snap);
+
+    auto wrong_snap_ref = snap[triplet.keys];
+    EXPECT_FALSE(wrong_snap_ref.value());
+
+    snap.set_snapshot(snapshot);
+    auto right_snap_ref = snap[triplet.keys];
+    EXPECT_TRUE(right_snap_ref.value());
+
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Creates news collection under unique names.
+ * Fill data in collection. Checking/dropping/checking collection data by thread.
+ */
+TEST(db, snapshot_with_threads) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
+
+    blobs_collection_t collection = db.main();
+    auto ref = collection[triplet.keys];
+    round_trip(ref, triplet);
+
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+
+    round_trip(ref, triplet_same_v);
+
+    std::shared_mutex mutex;
+    bool is_deleted = false;
+    auto task_read = [&]() {
+        while (true) {
+            std::shared_lock _ {mutex};
+            if (is_deleted) {
+                auto ref = snap[triplet.keys];
+                check_equalities(ref, triplet_same_v);
+                break;
+            }
+            check_equalities(snap_ref, triplet);
+        }
+    };
+
+    auto task_reset = [&]() {
+        std::unique_lock _ {mutex};
+        snap.set_snapshot(0);
+        is_deleted = true;
+    };
+
+    std::thread t1(task_read);
+    std::thread t2(task_reset);
+    t1.join();
+    t2.join();
+
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Snapshots must keep seeing the overwritten, removed and added keys as they were,
+ * both in point reads and scans, even after newer snapshots and the collection itself are dropped.
+ */
+TEST(db, snapshot_versions) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    auto scanned = [](blobs_collection_t const& collection) {
+        std::vector<ustore_key_t> keys;
+        keys_range_t range = collection.keys();
+        for (keys_stream_t it = range.begin(); !it.is_end(); ++it)
+            keys.push_back(*it);
+        return keys;
+    };
+
+    blobs_collection_t collection = *db.create("versioned");
+    EXPECT_TRUE(collection.at(1).assign("first"));
+    EXPECT_TRUE(collection.at(2).assign("second"));
+    EXPECT_TRUE(collection.at(3).assign("third"));
+
+    auto snap = *db.snapshot();
+    blobs_collection_t snap_collection {db, collection, nullptr, snap.snap()};
+    EXPECT_TRUE(collection.at(1).assign("overwritten"));
+    EXPECT_TRUE(collection.at(2).erase());
+    EXPECT_TRUE(collection.at(4).assign("added"));
+
+    EXPECT_EQ(snap_collection.at(1).value(), value_view_t("first"));
+    EXPECT_EQ(snap_collection.at(2).value(), value_view_t("second"));
+    EXPECT_EQ(snap_collection.at(4).value(), value_view_t {});
+    EXPECT_EQ(scanned(snap_collection), (std::vector<ustore_key_t> {1, 2, 3}));
+    EXPECT_EQ(scanned(collection), (std::vector<ustore_key_t> {1, 3, 4}));
+
+    // The newer snapshot passes the versions it collected to the older one, when dropped
+    {
+        auto newer_snap = *db.snapshot();
+        blobs_collection_t newer_collection {db, collection, nullptr, newer_snap.snap()};
+        EXPECT_TRUE(collection.at(3).assign("changed"));
+        EXPECT_EQ(newer_collection.at(3).value(), value_view_t("third"));
+        EXPECT_EQ(scanned(newer_collection), (std::vector<ustore_key_t> {1, 3, 4}));
+    }
+    EXPECT_EQ(snap_collection.at(3).value(), value_view_t("third"));
+
+    EXPECT_TRUE(db.drop("versioned"));
+    EXPECT_EQ(snap_collection.at(1).value(), value_view_t("first"));
+    EXPECT_EQ(scanned(snap_collection), (std::vector<ustore_key_t> {1, 2, 3}));
+
+    EXPECT_TRUE(db.clear());
+}
+
+TEST(db, transaction_erase_missing) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.transact());
+    transaction_t txn1 = *db.transact();
+    transaction_t txn2 = *db.transact();
+
+    EXPECT_TRUE(txn2.main().at(-7297309151944849401).erase());
+    EXPECT_TRUE(txn1.main().at(-8640850744835793378).erase());
+    EXPECT_TRUE(txn1.commit());
+    EXPECT_TRUE(txn2.commit());
+
+    EXPECT_EQ(db.main().at(-8640850744835793378).value(), value_view_t {});
+    EXPECT_EQ(db.main().at(-7297309151944849401).value(), value_view_t {});
+    EXPECT_EQ(db.main().keys().size(), 0u);
+}
+
+TEST(db, transaction_write_conflicting) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.transact());
+    transaction_t txn1 = *db.transact();
+    transaction_t txn2 = *db.transact();
+
+    EXPECT_TRUE(txn2.main().at(6).assign("a"));
+    EXPECT_TRUE(txn1.main().at(6).assign("b"));
+    EXPECT_TRUE(txn1.commit());
+    EXPECT_FALSE(txn2.commit());
+}
+
+/**
+ * Transactions started without watches don't track their reads,
+ * so concurrent writes into the same keys don't fail their commits.
+ */
+TEST(db, transaction_unwatched) {
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.main().at(6).assign("a"));
+
+    status_t status;
+    ustore_transaction_t raw {};
+    ustore_transaction_init_t txn_init {};
+    txn_init.db = db;
+    txn_init.error = status.member_ptr();
+    txn_init.options = ustore_option_transaction_dont_watch_k;
+    txn_init.transaction = &raw;
+    ustore_transaction_init(&txn_init);
+    EXPECT_TRUE(status);
+
+    context_t unwatched {db, raw};
+    EXPECT_EQ(*unwatched.main().at(6).value(), "a");
+    EXPECT_TRUE(db.main().at(6).assign("b"));
+    EXPECT_TRUE(unwatched.commit());
+
+    // Watched transactions still conflict
+    transaction_t watched = *db.transact();
+    EXPECT_EQ(*watched.main().at(6).value(), "b");
+    EXPECT_TRUE(db.main().at(6).assign("c"));
+    EXPECT_FALSE(watched.commit());
+#endif
+}
+
+/**
+ *
+ */
+TEST(db, transaction_sequenced_commit) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    EXPECT_TRUE(db.transact());
+    transaction_t txn = *db.transact();
+
+    triplet_t triplet;
+    auto txn_ref = txn[triplet.keys];
+
+    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
+    auto maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    auto current_sequence_number = *maybe_sequence_number;
+    EXPECT_GT(current_sequence_number, 0);
+    EXPECT_TRUE(txn.reset());
+#if 0
+    auto previous_sequence_number = current_sequence_number;
+    EXPECT_TRUE(txn_ref.value());
+    maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    current_sequence_number = *maybe_sequence_number;
+    EXPECT_EQ(current_sequence_number, previous_sequence_number);
+    EXPECT_TRUE(txn.reset());
+
+    previous_sequence_number = current_sequence_number;
+    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
+    maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    current_sequence_number = *maybe_sequence_number;
+    EXPECT_GT(current_sequence_number, previous_sequence_number);
+#endif
+}
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+/**
+ * Reads random batches of present and missing keys from many threads through the coalescer
+ * of the Arrow Flight server, checking that every participant of a shared engine call
+ * gets exactly its own slice of presences, offsets, lengths and values.
+ */
+TEST(db, reads_coalescing) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.clear());
+
+    constexpr ustore_key_t keys_count_k = 1000;
+    auto value_of = [](ustore_key_t key) { return std::string(static_cast<std::size_t>(key % 7), 'a' + key % 26); };
+    for (ustore_key_t key = 0; key != keys_count_k; key += 2) {
+        std::string value = value_of(key);
+        EXPECT_TRUE(db.main()[key].assign(value_view_t {value.data(), value.size()}));
+    }
+
+    // Long delays let the threads pile up into shared groups even on a single core
+    reads_coalescer_t coalescer(db, std::chrono::milliseconds(5), 64);
+    constexpr std::size_t threads_count_k = 8;
+    constexpr std::size_t reads_per_thread_k = 50;
+    std::atomic<std::size_t> mismatches = 0;
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count_k; ++thread_idx)
+        threads.emplace_back([&, thread_idx] {
+            std::mt19937 generator(static_cast<std::uint32_t>(thread_idx));
+            arena_t arena(db);
+            for (std::size_t read_idx = 0; read_idx != reads_per_thread_k; ++read_idx) {
+                std::vector<ustore_key_t> keys(1 + generator() % 16);
+                for (ustore_key_t& key : keys)
+                    key = static_cast<ustore_key_t>(generator() % keys_count_k);
+
+                ustore_octet_t* presences = nullptr;
+                ustore_length_t* offsets = nullptr;
+                ustore_length_t* lengths = nullptr;
+                ustore_bytes_ptr_t values = nullptr;
+                status_t status;
+                ustore_collection_t collection = ustore_collection_main_k;
+                ustore_read_t read {};
+                read.db = db;
+                read.error = status.member_ptr();
+                read.arena = arena.member_ptr();
+                read.tasks_count = keys.size();
+                read.collections = &collection;
+                read.keys = keys.data();
+                read.keys_stride = sizeof(ustore_key_t);
+                read.presences = &presences;
+                read.offsets = &offsets;
+                read.lengths = &lengths;
+                read.values = &values;
+                if (!coalescer.accepts(read)) {
+                    ++mismatches;
+                    continue;
+                }
+                coalescer.read(read);
+                if (!status) {
+                    ++mismatches;
+                    continue;
+                }
+
+                bits_view_t present {presences};
+                for (std::size_t i = 0; i != keys.size(); ++i) {
+                    bool expected_present = keys[i] % 2 == 0;
+                    std::string expected = expected_present ? value_of(keys[i]) : std::string();
+                    bool matches = present[i] == expected_present &&
+                                   lengths[i] == (expected_present ? expected.size() : ustore_length_missing_k) &&
+                                   offsets[i + 1] - offsets[i] == expected.size() &&
+                                   std::string_view(reinterpret_cast<char const*>(values) + offsets[i],
+                                                    expected.size()) == expected;
+                    mismatches += !matches;
+                }
+            }
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    EXPECT_EQ(mismatches.load(), 0u);
+
+    // Transactions and oversized batches are read directly
+    transaction_t txn = *db.transact();
+    ustore_key_t key = 0;
+    ustore_read_t read {};
+    read.db = db;
+    read.tasks_count = 1;
+    read.keys = &key;
+    EXPECT_TRUE(coalescer.accepts(read));
+    read.transaction = txn;
+    EXPECT_FALSE(coalescer.accepts(read));
+    read.transaction = nullptr;
+    read.tasks_count = 17;
+    EXPECT_FALSE(coalescer.accepts(read));
+    EXPECT_TRUE(db.clear());
+}
+
+#endif
+
+#pragma region Paths Modality
+
+/**
+ * Tests "Paths" Modality, with variable length keys.
+ * Reads, writes, prefix matching and pattern matching.
+ */
+TEST(db, paths) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    char const* keys[] {"Facebook", "Apple", "Amazon", "Netflix", "Google", "Nvidia", "Adobe"};
+    char const* vals[] {"F", "A", "A", "N", "G", "N", "A"};
+    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
+    ustore_char_t separator = '\0';
+
+    arena_t arena(db);
+    status_t status {};
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = keys_count;
+    paths_write.path_separator = separator;
+    paths_write.paths = keys;
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
+    paths_write.values_bytes_stride = sizeof(char const*);
+
+    ustore_paths_write(&paths_write);
+    char* vals_recovered {};
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = keys_count;
+    paths_read.path_separator = separator;
+    paths_read.paths = keys;
+    paths_read.paths_stride = sizeof(char const*);
+    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+
+    ustore_paths_read(&paths_read);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(std::string_view(vals_recovered, keys_count * 2),
+              std::string_view("F\0A\0A\0N\0G\0N\0A\0", keys_count * 2));
+
+    // Try getting either "Netflix" or "Nvidia" as one of the keys with "N" prefix
+    ustore_str_view_t prefix = "N";
+    ustore_length_t max_count = 1;
+    ustore_length_t* results_counts {};
+    ustore_length_t* tape_offsets {};
+    ustore_char_t* tape_begin {};
+    ustore_paths_match_t paths_match {};
+    paths_match.db = db;
+    paths_match.error = status.member_ptr();
+    paths_match.arena = arena.member_ptr();
+    paths_match.tasks_count = 1;
+    paths_match.match_counts_limits = &max_count;
+    paths_match.patterns = &prefix;
+    paths_match.match_counts = &results_counts;
+    paths_match.paths_offsets = &tape_offsets;
+    paths_match.paths_strings = &tape_begin;
+
+    ustore_paths_match(&paths_match);
+    auto first_match_for_a = std::string_view(tape_begin);
+    EXPECT_EQ(results_counts[0], 1);
+    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Nvidia");
+
+    // Try getting the remaining results, which is the other one from that same pair
+    max_count = 10;
+    paths_match.previous = &tape_begin;
+    paths_match.options = ustore_option_dont_discard_memory_k;
+    ustore_paths_match(&paths_match);
+    auto second_match_for_a = std::string_view(tape_begin);
+    EXPECT_EQ(results_counts[0], 1);
+    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Nvidia");
+    EXPECT_NE(first_match_for_a, second_match_for_a);
+
+    // Try performing parallel queries in the same collection
+    ustore_str_view_t prefixes[2] = {"A", "N"};
+    std::size_t prefixes_count = sizeof(prefixes) / sizeof(prefixes[0]);
+    max_count = 10;
+    paths_match.tasks_count = prefixes_count;
+    paths_match.patterns = prefixes;
+    paths_match.patterns_stride = sizeof(ustore_str_view_t);
+    paths_match.previous = nullptr;
+    ustore_paths_match(&paths_match);
+    auto total_count = std::accumulate(results_counts, results_counts + prefixes_count, 0ul);
+    strings_tape_iterator_t tape_iterator {total_count, tape_begin};
+    std::set<std::string> tape_parts;
+    while (!tape_iterator.is_end()) {
+        tape_parts.insert(*tape_iterator);
+        ++tape_iterator;
+    }
+    EXPECT_EQ(results_counts[0], 3);
+    EXPECT_EQ(results_counts[1], 2);
+    EXPECT_NE(tape_parts.find("Netflix"), tape_parts.end());
+    EXPECT_NE(tape_parts.find("Adobe"), tape_parts.end());
+
+    // Now try matching a Regular Expression
+    prefix = "Netflix|Google";
+    paths_match.tasks_count = 1;
+    paths_match.patterns = &prefix;
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 2);
+    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Google");
+    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Google");
+
+    // Try a more complex regular expression
+    prefix = "A.*e";
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 2);
+    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe");
+    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe");
+
+    // Existing single letter prefix
+    prefix = "A";
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 3);
+    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe" || first_match_for_a == "Amazon");
+    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe" || second_match_for_a == "Amazon");
+
+    // Missing single letter prefix
+    prefix = "X";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Missing pattern
+    prefix = "X.*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Try a more complex regular expression
+    prefix = "oo:18:\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Try an even more complex regular expression
+    prefix = "oo:18:\\\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    EXPECT_TRUE(db.clear());
+
+    // Try an even more complex regular expression on empty DB
+    prefix = "oo:18:\\\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+}
+
+/**
+ * Checks that prefix matches over a collection with a prefix index see both the paths written
+ * before the index was declared and after, skip the removed ones, and paginate in lexicographic order.
+ */
+TEST(db, paths_prefix_index) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    blobs_collection_t collection = *db.create("files");
+    ustore_collection_t collection_id = collection;
+    arena_t arena(db);
+    status_t status;
+
+    auto write = [&](std::vector<char const*> const& paths, std::vector<char const*> const& values) {
+        ustore_paths_write_t paths_write {};
+        paths_write.db = db;
+        paths_write.error = status.member_ptr();
+        paths_write.arena = arena.member_ptr();
+        paths_write.tasks_count = paths.size();
+        paths_write.collections = &collection_id;
+        paths_write.paths = paths.data();
+        paths_write.paths_stride = sizeof(char const*);
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t const*>(values.data());
+        paths_write.values_bytes_stride = sizeof(char const*);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+    };
+    auto match = [&](ustore_str_view_t prefix, ustore_length_t limit, ustore_str_view_t previous = nullptr) {
+        ustore_length_t* counts {};
+        ustore_char_t* tape {};
+        ustore_paths_match_t paths_match {};
+        paths_match.db = db;
+        paths_match.error = status.member_ptr();
+        paths_match.arena = arena.member_ptr();
+        paths_match.tasks_count = 1;
+        paths_match.collections = &collection_id;
+        paths_match.match_counts_limits = &limit;
+        paths_match.patterns = &prefix;
+        paths_match.previous = previous ? &previous : nullptr;
+        paths_match.match_counts = &counts;
+        paths_match.paths_strings = &tape;
+        ustore_paths_match(&paths_match);
+        EXPECT_TRUE(status);
+        std::vector<std::string> found;
+        strings_tape_iterator_t tape_iterator {counts[0], tape};
+        for (; !tape_iterator.is_end(); ++tape_iterator)
+            found.emplace_back(*tape_iterator);
+        return found;
+    };
+
+    write({"home/b/1", "home/a/2", "home/a/1"}, {"x", "y", "z"});
+
+    ustore_paths_index_create_t index_create {};
+    index_create.db = db;
+    index_create.error = status.member_ptr();
+    index_create.arena = arena.member_ptr();
+    index_create.collection = collection_id;
+    ustore_paths_index_create(&index_create);
+    EXPECT_TRUE(status);
+
+    // Declaring the same index twice is an error
+    ustore_paths_index_create(&index_create);
+    EXPECT_FALSE(status);
+    status.release_error();
+
+    write({"home/abcdefgh/x", "var/log", "home/a/3", "home/a/2"}, {"p", "q", "r", nullptr});
+
+    using strings_t = std::vector<std::string>;
+    EXPECT_EQ(match("home/", 10), (strings_t {"home/a/1", "home/a/3", "home/abcdefgh/x", "home/b/1"}));
+    EXPECT_EQ(match("home/a", 2), (strings_t {"home/a/1", "home/a/3"}));
+    EXPECT_EQ(match("home/a", 10, "home/a/3"), (strings_t {"home/abcdefgh/x"}));
+    EXPECT_EQ(match("home/abcdefgh/", 10), (strings_t {"home/abcdefgh/x"}));
+    EXPECT_EQ(match("", 10).size(), 5u);
+    EXPECT_TRUE(match("tmp", 10).empty());
+
+    // RegEx patterns still scan the buckets, unless anchored
+    EXPECT_EQ(match("var/.*", 10), (strings_t {"var/log"}));
+    EXPECT_EQ(match("^home/a/[13]", 10), (strings_t {"home/a/1", "home/a/3"}));
+    EXPECT_EQ(match("^home/a\\/1?", 10), (strings_t {"home/a/1", "home/a/3"}));
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Checks that splitting the scans of hash buckets between threads
+ * exports the same matches in the same order, as a single thread does.
+ */
+TEST(db, paths_match_threads) {
+    constexpr std::size_t count = 1000;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    std::vector<std::string> paths(count);
+    std::vector<char const*> paths_ptrs(count);
+    for (std::size_t i = 0; i != count; ++i)
+        paths[i] = "logs/" + std::to_string(i), paths_ptrs[i] = paths[i].c_str();
+
+    arena_t arena(db);
+    status_t status;
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = count;
+    paths_write.paths = paths_ptrs.data();
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t const*>(paths_ptrs.data());
+    paths_write.values_bytes_stride = sizeof(char const*);
+    ustore_paths_write(&paths_write);
+    EXPECT_TRUE(status);
+
+    auto match = [&](ustore_str_view_t pattern, ustore_length_t limit, std::size_t threads_count) {
+        ustore_length_t* counts {};
+        ustore_char_t* tape {};
+        ustore_paths_match_t paths_match {};
+        paths_match.db = db;
+        paths_match.error = status.member_ptr();
+        paths_match.arena = arena.member_ptr();
+        paths_match.tasks_count = 1;
+        paths_match.match_counts_limits = &limit;
+        paths_match.patterns = &pattern;
+        paths_match.threads_count = threads_count;
+        paths_match.match_counts = &counts;
+        paths_match.paths_strings = &tape;
+        ustore_paths_match(&paths_match);
+        EXPECT_TRUE(status);
+        std::vector<std::string> found;
+        strings_tape_iterator_t tape_iterator {counts[0], tape};
+        for (; !tape_iterator.is_end(); ++tape_iterator)
+            found.emplace_back(*tape_iterator);
+        return found;
+    };
+
+    EXPECT_EQ(match("logs/.*7$", count, 4).size(), 100u);
+    EXPECT_EQ(match("logs/.*7$", count, 1), match("logs/.*7$", count, 4));
+    EXPECT_EQ(match("logs/.*7$", 10, 1), match("logs/.*7$", 10, 4));
+    EXPECT_EQ(match("logs/9", count, 3).size(), 111u);
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Tests "Paths" Modality hashing, checking that new collections record the stable hash in their metadata.
+ * In debug builds all paths collide into a few buckets, which exercises the fingerprints lookups.
+ */
+TEST(db, paths_stable_hash) {
+    // Persisted collections depend on these exact values, covering every branch of the construction
+    EXPECT_EQ(stable_hash(""), 0x93228a4de0eec5a2ull);
+    EXPECT_EQ(stable_hash("abc"), 0x989b4a209c1011c9ull);
+    EXPECT_EQ(stable_hash("stable/42"), 0xb703579e633dd88aull);
+    EXPECT_EQ(stable_hash("0123456789abcdef"), 0x88de385a856cfb95ull);
+    EXPECT_EQ(stable_hash("0123456789abcdefg"), 0x14f37288a5f8073aull);
+    EXPECT_EQ(stable_hash(std::string(49, 'x')), 0x4feafd95ec98170eull);
+    EXPECT_EQ(stable_hash("stable/42", 42), 0x7ac412c1ac59dc21ull);
+
+    constexpr std::size_t count = 1000;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    std::vector<std::string> paths(count);
+    std::vector<char const*> paths_ptrs(count);
+    for (std::size_t i = 0; i != count; ++i)
+        paths[i] = "stable/" + std::to_string(i), paths_ptrs[i] = paths[i].c_str();
+
+    arena_t arena(db);
+    status_t status;
+    auto write = [&](std::size_t first, std::size_t step, bool remove) {
+        std::vector<char const*> written;
+        for (std::size_t i = first; i < count; i += step)
+            written.push_back(paths_ptrs[i]);
+        ustore_paths_write_t paths_write {};
+        paths_write.db = db;
+        paths_write.error = status.member_ptr();
+        paths_write.arena = arena.member_ptr();
+        paths_write.tasks_count = written.size();
+        paths_write.paths = written.data();
+        paths_write.paths_stride = sizeof(char const*);
+        paths_write.values_bytes = remove ? nullptr : reinterpret_cast<ustore_bytes_cptr_t const*>(written.data());
+        paths_write.values_bytes_stride = sizeof(char const*);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+    };
+
+    write(0, 1, false);
+    blobs_collection_t collection = db.main();
+    auto metadata = collection[std::numeric_limits<ustore_key_t>::min()].value();
+    EXPECT_TRUE(metadata);
+    EXPECT_EQ(metadata->size(), 2 * sizeof(ustore_length_t));
+
+    // Remove every third path and read all of them back
+    write(0, 3, true);
+    ustore_octet_t* presences {};
+    ustore_length_t* offsets {};
+    ustore_char_t* values {};
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = count;
+    paths_read.paths = paths_ptrs.data();
+    paths_read.paths_stride = sizeof(char const*);
+    paths_read.presences = &presences;
+    paths_read.offsets = &offsets;
+    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&values);
+    ustore_paths_read(&paths_read);
+    EXPECT_TRUE(status);
+
+    bits_view_t found {presences};
+    for (std::size_t i = 0; i != count; ++i) {
+        EXPECT_EQ(found[i], i % 3 != 0);
+        if (found[i])
+            EXPECT_EQ(std::string_view(values + offsets[i]), paths[i]);
+    }
+
+    // The metadata entry must not show up in matches
+    ustore_str_view_t pattern = "";
+    ustore_length_t limit = count;
+    ustore_length_t* counts {};
+    ustore_paths_match_t paths_match {};
+    paths_match.db = db;
+    paths_match.error = status.member_ptr();
+    paths_match.arena = arena.member_ptr();
+    paths_match.tasks_count = 1;
+    paths_match.match_counts_limits = &limit;
+    paths_match.patterns = &pattern;
+    paths_match.match_counts = &counts;
+    ustore_paths_match(&paths_match);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(counts[0], count - 334);
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Tests "Paths" Modality batches, where the same paths are written more than once.
+ * Every bucket is rebuilt once per batch, so only the last write of every path must persist.
+ */
+TEST(db, paths_batch_repeats) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    char const* keys[] = {"a", "b", "a", "c", "b", "a"};
+    char const* vals[] = {"1", "2", "3", "4", nullptr, "5"};
+    ustore_length_t lengths[] = {1, 1, 1, 1, ustore_length_missing_k, 1};
+
+    arena_t arena(db);
+    status_t status;
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = 6;
+    paths_write.paths = keys;
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_lengths = lengths;
+    paths_write.values_lengths_stride = sizeof(ustore_length_t);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t const*>(vals);
+    paths_write.values_bytes_stride = sizeof(char const*);
+    ustore_paths_write(&paths_write);
+    EXPECT_TRUE(status);
+
+    ustore_octet_t* presences {};
+    ustore_length_t* offsets {};
+    ustore_char_t* values {};
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = 3;
+    paths_read.paths = keys;
+    paths_read.paths_stride = sizeof(char const*);
+    paths_read.presences = &presences;
+    paths_read.offsets = &offsets;
+    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&values);
+    ustore_paths_read(&paths_read);
+    EXPECT_TRUE(status);
+
+    bits_view_t found {presences};
+    EXPECT_TRUE(found[0]);
+    EXPECT_FALSE(found[1]);
+    EXPECT_EQ(std::string_view(values + offsets[0]), "5");
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Tests "Paths" Modality, by forming bidirectional linked lists from string-to-string mappings.
+ * Uses different-length unique strings. As the underlying modality may be implemented as a bucketed hash-map,
+ * this test helps catch problems in bucket reorganization.
+ */
+TEST(db, paths_linked_list) {
+    constexpr std::size_t count = 1000;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    arena_t arena(db);
+    ustore_char_t separator = '\0';
+    status_t status;
+
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = 1;
+    paths_write.path_separator = separator;
+
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = 1;
+    paths_read.path_separator = separator;
+
+    // Generate some random strings for our tests
+    constexpr auto alphabet = "abcdefghijklmnop";
+    auto make_random_str = []() {
+        auto str = std::string();
+        auto len = static_cast<std::size_t>(std::rand() % 100) + 8;
+        for (std::size_t i = 0; i != len; ++i)
+            str.push_back(alphabet[std::rand() % 16]);
+        return str;
+    };
+    std::set<std::string> unique;
+    while (unique.size() != count)
+        unique.insert(make_random_str());
+
+    // Lets form a linked list, where every key maps into the the next key.
+    // Then we will traverse the linked list from start to end.
+    // Then we will re-link it in reverse order and traverse again.
+    std::vector<ustore_str_view_t> begins(unique.size());
+    std::transform(unique.begin(), unique.end(), begins.begin(), [](std::string const& str) { return str.c_str(); });
+
+    // Link forward
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        paths_write.paths = &smaller;
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&bigger);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+
+        // Check if it was successfully written:
+        ustore_str_span_t bigger_received = nullptr;
+        paths_read.paths = &smaller;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    }
+
+    // Traverse forward, counting the entries and checking the order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        ustore_str_span_t bigger_received = nullptr;
+        paths_read.paths = &smaller;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    }
+
+    // Re-link in reverse order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        paths_write.paths = &bigger;
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&smaller);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+
+        // Check if it was successfully over-written:
+        ustore_str_span_t smaller_received = nullptr;
+        paths_read.paths = &bigger;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    }
+
+    // Traverse backwards, counting the entries and checking the order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        ustore_str_span_t smaller_received = nullptr;
+        paths_read.paths = &bigger;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    }
+}
+
+#pragma region Documents Modality
+
+std::vector<std::string> make_three_flat_docs() {
+    auto json1 = R"( {"person": "Alice", "age": 24} )"_json.dump();
+    auto json2 = R"( {"person": "Bob", "age": 25} )"_json.dump();
+    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
+    return {json1, json2, json3};
+}
+
+std::vector<std::string> make_three_nested_docs() {
+    auto json1 = R"( {"person": {"name":"Alice", "age": 24}} )"_json.dump();
+    auto json2 = R"( {"person": [{"name":"Bob", "age": 25}]} )"_json.dump();
+    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
+    return {json1, json2, json3};
+}
+
+/**
+ * Tests "Documents" Modality, mapping integers to structured hierarchical documents.
+ * Takes a basic flat JSON document, and checks if it can be imported in JSON, BSON
+ * and MessagePack forms, and later be properly accessed at field-level.
+ */
+TEST(db, docs_flat) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    // JSON
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto jsons = make_three_flat_docs();
+    collection[1] = jsons[0].c_str();
+    collection[2] = jsons[1].c_str();
+    collection[3] = jsons[2].c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), "\"Bob\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(3, "age")].value(), "26");
+
+    // Binary
+    auto maybe_person = collection[ckf(1, "person")].value(ustore_doc_field_str_k);
+    EXPECT_EQ(std::string_view(maybe_person->c_str(), maybe_person->size()), std::string_view("Alice"));
+
+    // BSON
+    bson_error_t error;
+    bson_t* bson = bson_new_from_json((uint8_t*)jsons[0].c_str(), -1, &error);
+    uint8_t const* buffer = bson_get_data(bson);
+    auto view = value_view_t(buffer, bson->len);
+    collection.at(4, ustore_doc_field_bson_k) = view;
+    M_EXPECT_EQ_JSON(*collection[4].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(4, "person")].value(), "\"Alice\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(4, "age")].value(), "24");
+    bson_clear(&bson);
+
+    // MsgPack
+    auto message_pack = *collection[1].value(ustore_doc_field_msgpack_k);
+    collection.at(5, ustore_doc_field_msgpack_k) = message_pack;
+    M_EXPECT_EQ_JSON(*collection[5].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(5, "person")].value(), "\"Alice\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(5, "age")].value(), "24");
+}
+
+/**
+ * Tries adding 3 simple nested JSONs, using JSON-Pointers
+ * to retrieve specific fields across multiple keys.
+ */
+TEST(db, docs_nested_batch) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+
+    auto jsons = make_three_nested_docs();
+    std::string continuous_jsons = jsons[0] + jsons[1] + jsons[2];
+    auto vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
+    std::array<ustore_length_t, 4> offsets = {
+        0,
+        static_cast<ustore_length_t>(jsons[0].size()),
+        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size()),
+        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size() + jsons[2].size()),
+    };
+    contents_arg_t values {};
+    values.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
+    values.contents_begin = {&vals_begin, 0};
+
+    std::array<ustore_key_t, 3> keys = {1, 2, 3};
+    auto ref = collection[keys];
+    EXPECT_TRUE(ref.assign(values));
+
+    // Read One By One
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[2].value(), jsons[1]);
+    M_EXPECT_EQ_JSON(*collection[3].value(), jsons[2]);
+
+    auto expected = R"({"name":"Alice", "age": 24})"_json.dump();
+    M_EXPECT_EQ_JSON(*collection[ckf(1, "person")].value(), expected);
+
+    expected = R"([{"name":"Bob", "age": 25}])"_json.dump();
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), expected);
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "/person/0/name")].value(), "\"Bob\"");
+
+    // Read sorted keys
+    check_equalities(ref, values);
+
+    // Read not sorted keys
+    std::array<ustore_key_t, 3> not_sorted_keys = {1, 3, 2};
+    auto not_sorted_ref = collection[not_sorted_keys];
+    std::string not_sorted_jsons = jsons[0] + jsons[2] + jsons[1];
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(not_sorted_jsons.data());
+    offsets[2] = jsons[0].size() + jsons[2].size();
+    offsets[3] = jsons[0].size() + jsons[2].size() + jsons[1].size();
+    check_equalities(not_sorted_ref, values);
+
+    // Read duplicate keys
+    std::array<ustore_key_t, 3> duplicate_keys = {1, 2, 1};
+    auto duplicate_ref = collection[duplicate_keys];
+    std::string duplicate_jsons = jsons[0] + jsons[1] + jsons[0];
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(duplicate_jsons.data());
+    offsets[2] = jsons[0].size() + jsons[1].size();
+    offsets[3] = jsons[0].size() + jsons[1].size() + jsons[0].size();
+    check_equalities(duplicate_ref, values);
+
+    // Read with fields
+    std::array<collection_key_field_t, 3> keys_with_fields = {
+        ckf(1, "person"),
+        ckf(2, "/person/0/name"),
+        ckf(3, "age"),
+    };
+    auto ref_with_fields = collection[keys_with_fields];
+    auto field_value1 = R"({"name":"Alice", "age": 24})"_json.dump();
+    auto field_value2 = R"("Bob")"_json.dump();
+    auto field_value3 = R"(26)"_json.dump();
+    std::string field_values = field_value1 + field_value2 + field_value3;
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(field_values.data());
+    offsets[1] = field_value1.size();
+    offsets[2] = field_value1.size() + field_value2.size();
+    offsets[3] = field_value1.size() + field_value2.size() + field_value3.size();
+    check_equalities(ref_with_fields, values);
+
+    // Check Invalid Json Write
+    std::string invalid_json = R"({"name":"Alice", } "age": 24})";
+    offsets[1] = jsons[0].size();
+    offsets[2] = jsons[0].size() + jsons[1].size();
+    offsets[3] = jsons[0].size() + jsons[1].size() + invalid_json.size();
+    continuous_jsons = jsons[0] + jsons[1] + invalid_json;
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
+
+    EXPECT_FALSE(ref.assign(values));
+}
+
+/**
+ * Performs basic JSON Pathes, JSON Merge-Patches, and sub-document level updates.
+ */
+TEST(db, docs_modify) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto jsons = make_three_nested_docs();
+    collection[1] = jsons[0].c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+
+    // Update
+    auto modifier = R"( {"person": {"name":"Charles", "age": 28}} )"_json.dump();
+    EXPECT_TRUE(collection[1].update(modifier.c_str()));
+    auto result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), modifier.c_str());
+
+    // Update By Field
+    modifier = R"( {"name": "Alice", "age": 24} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/person")].update(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[0].c_str());
+
+    // Insert
+    EXPECT_FALSE(collection[1].insert(jsons[1].c_str()));
+    EXPECT_TRUE(collection[2].insert(jsons[1].c_str()));
+    result = collection[2].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[1].c_str());
+
+    // Insert By Field
+    modifier = R"("Doe" )"_json.dump();
+    auto expected = R"({"person": [{"name":"Bob", "age": 25, "surname" : "Doe"}]})"_json.dump();
+    EXPECT_TRUE(collection[ckf(2, "/person/0/surname")].insert(modifier.c_str()));
+    result = collection[2].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+
+    // Upsert
+    EXPECT_TRUE(collection[1].upsert(jsons[2].c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[2].c_str());
+
+    // Upsert By Field
+    modifier = R"("Charles")"_json.dump();
+    expected = R"( {"person": "Charles", "age": 26} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/person")].upsert(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+
+    modifier = R"(70)"_json.dump();
+    expected = R"( {"person": "Charles", "age": 26, "weight" : 70} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/weight")].upsert(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+}
+
+/**
+ * Replaces scalar fields, that fit in place of the old values, and applies
+ * several modifications of the same documents within one batch.
+ */
+TEST(db, docs_modify_in_place) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+    collection[1] = R"( {"counter": 10, "flag": true, "name": "Alice"} )";
+    collection[2] = R"( {"counter": 7} )";
+
+    EXPECT_TRUE(collection[ckf(1, "/counter")].update("11"));
+    EXPECT_TRUE(collection[ckf(1, "/flag")].update("false"));
+    EXPECT_TRUE(collection[ckf(2, "/counter")].upsert("100"));
+    M_EXPECT_EQ_JSON(*collection[1].value(), R"( {"counter": 11, "flag": false, "name": "Alice"} )");
+    M_EXPECT_EQ_JSON(*collection[2].value(), R"( {"counter": 100} )");
+
+    // Modifications of the same document are applied in order, mixing in-place and parsed ones
+    std::array<collection_key_field_t, 4> fields = {
+        ckf(1, "/counter"),
+        ckf(2, "/counter"),
+        ckf(1, "/counter"),
+        ckf(1, "/name"),
+    };
+    std::string modifiers = R"(12813"Bob")";
+    auto vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(modifiers.data());
+    std::array<ustore_length_t, 5> offsets = {0, 2, 3, 5, 10};
+    contents_arg_t values {};
+    values.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
+    values.contents_begin = {&vals_begin, 0};
+    EXPECT_TRUE(collection[fields].update(values));
+    M_EXPECT_EQ_JSON(*collection[1].value(), R"( {"counter": 13, "flag": false, "name": "Bob"} )");
+    M_EXPECT_EQ_JSON(*collection[2].value(), R"( {"counter": 8} )");
+}
+
+/**
+ * Declares secondary indexes on a numeric and a string field, checking that the
+ * present documents are indexed, and that later upserts, updates and removals
+ * are reflected in equality and range lookups.
+ */
+TEST(db, docs_index) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto jsons = make_three_flat_docs();
+    collection[1] = jsons[0].c_str();
+    collection[2] = jsons[1].c_str();
+
+    auto found_keys = [&](ustore_str_view_t field, ustore_doc_field_type_t type, char const* min, char const* max) {
+        auto maybe = collection.find(field, type, min, max);
+        EXPECT_TRUE(maybe);
+        std::vector<ustore_key_t> keys(maybe->begin(), maybe->end());
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    using keys_t = std::vector<ustore_key_t>;
+
+    // Backfill the present documents
+    EXPECT_TRUE(collection.create_index("/age", ustore_doc_field_i64_k));
+    EXPECT_TRUE(collection.create_index("/person", ustore_doc_field_str_k));
+    EXPECT_FALSE(collection.create_index("/age", ustore_doc_field_i64_k));
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "0", "100"), (keys_t {1, 2}));
+    EXPECT_EQ(found_keys("/person", ustore_doc_field_str_k, "Bob", "Bob"), (keys_t {2}));
+
+    // Upserts are reflected immediately
+    collection[3] = jsons[2].c_str();
+    collection[4] = R"( {"person": "Alice", "age": -3.5} )";
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "25", "26"), (keys_t {2, 3}));
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "-10", "0"), (keys_t {4}));
+    EXPECT_EQ(found_keys("/person", ustore_doc_field_str_k, "Alice", "Alice"), (keys_t {1, 4}));
+    EXPECT_EQ(found_keys("/person", ustore_doc_field_str_k, "B", "Bz"), (keys_t {2}));
+
+    // Field-level updates move the entries
+    EXPECT_TRUE(collection[ckf(1, "/age")].upsert("30"));
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "24", "24"), (keys_t {}));
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "30", "30"), (keys_t {1}));
+
+    // Removals drop the entries
+    EXPECT_TRUE(collection[2].erase());
+    EXPECT_EQ(found_keys("/person", ustore_doc_field_str_k, "Bob", "Bob"), (keys_t {}));
+    EXPECT_EQ(found_keys("/age", ustore_doc_field_i64_k, "0", "100"), (keys_t {1, 3}));
+
+    EXPECT_TRUE(collection.drop_index("/age", ustore_doc_field_i64_k));
+    EXPECT_FALSE(collection.find("/age", ustore_doc_field_i64_k, "0", "100"));
+}
+
+/**
+ * Uses a well-known repository of JSON-Patches and JSON-MergePatches,
+ * to validate that document modifications work adequately in corner cases.
+ */
+TEST(db, docs_merge_and_patch) {
+    using json_t = nlohmann::json;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+
+    std::ifstream f_patch("tests/patch.json");
+    json_t j_object = json_t::parse(f_patch);
+    for (auto it : j_object) {
+        auto doc = it["doc"].dump();
+        auto patch = it["patch"].dump();
+        auto expected = it["expected"].dump();
+        collection[1] = doc.c_str();
+        EXPECT_TRUE(collection[1].patch(patch.c_str()));
+        auto maybe_value = collection[1].value();
+        EXPECT_TRUE(maybe_value);
+        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
+    }
+
+    std::ifstream f_merge("tests/merge.json");
+    j_object = json_t::parse(f_merge);
+    for (auto it : j_object) {
+        auto doc = it["doc"].dump();
+        auto merge = it["merge"].dump();
+        auto expected = it["expected"].dump();
+        collection[1] = doc.c_str();
+        EXPECT_TRUE(collection[1].merge(merge.c_str()));
+        auto maybe_value = collection[1].value();
+        EXPECT_TRUE(maybe_value);
+        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
+    }
+}
+
+/**
+ * Materializes some of the fields of documents, checking that gathering them
+ * produces the same tables as parsing the documents, even after updates.
+ */
+TEST(db, docs_table_materialized) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto json_alice = R"( { "person": "Alice", "age": 27, "height": 1 } )"_json.dump();
+    auto json_bob = R"( { "person": "Bob", "age": "27", "weight": 2 } )"_json.dump();
+    collection[1] = json_alice.c_str();
+    collection[2] = json_bob.c_str();
+    EXPECT_TRUE(collection.create_column("age"));
+    EXPECT_TRUE(collection.create_column("person"));
+    EXPECT_FALSE(collection.create_column("age"));
+    collection[3] = R"( { "person": ["Carl"], "age": 24.5 } )";
+
+    // Only materialized fields
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("age")
+                          .with<std::string_view>("person");
+        auto maybe_table = collection[{1, 2, 3}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_FALSE(col0[0].converted);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+        EXPECT_STREQ(col1[0].value.data(), "27");
+        EXPECT_STREQ(col1[2].value.data(), "24.5");
+        EXPECT_STREQ(col2[0].value.data(), "Alice");
+        EXPECT_STREQ(col2[1].value.data(), "Bob");
+        EXPECT_TRUE(col2[2].collides);
+    }
+
+    // Mixing materialized and parsed fields, after updates
+    EXPECT_TRUE(collection[ckf(1, "/age")].upsert("28"));
+    collection[2] = R"( { "person": "Bob", "height": 3 } )";
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("age")
+                          .with<std::int32_t>("height")
+                          .with<std::string_view>("person");
+        auto maybe_table = collection[{1, 2}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+
+        EXPECT_EQ(col0[0].value, 28);
+        EXPECT_FALSE(col0[1].valid);
+        EXPECT_EQ(col1[0].value, 1);
+        EXPECT_EQ(col1[1].value, 3);
+        EXPECT_STREQ(col2[1].value.data(), "Bob");
+    }
+
+    EXPECT_TRUE(collection.drop_column("age"));
+    EXPECT_FALSE(collection.drop_column("age"));
+}
+
+TEST(db, docs_packed_storage) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    blobs_collection_t blobs = db.main();
+    auto jsons = make_three_nested_docs();
+    collection[1] = jsons[0].c_str();
+    EXPECT_TRUE(collection.set_storage(ustore_doc_storage_packed_k));
+    collection[2] = jsons[1].c_str();
+    collection[3] = R"( { "person": "Carl", "age": 24, "tags": ["a~b", "c/d"] } )";
+
+    // Both the present and the new documents are packed, but exported as JSON
+    EXPECT_EQ(blobs[1].value()->c_str()[0], '\0');
+    EXPECT_EQ(blobs[2].value()->c_str()[0], '\0');
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[2].value(), jsons[1]);
+    M_EXPECT_EQ_JSON(*collection[ckf(3, "person")].value(), "\"Carl\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(3, "/tags/1")].value(), "\"c/d\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(1, "/person")].value(), "{\"name\":\"Alice\",\"age\":24}");
+
+    // Partial updates and tables work on top of packed documents
+    EXPECT_TRUE(collection[ckf(3, "/age")].update("25"));
+    EXPECT_EQ(blobs[3].value()->c_str()[0], '\0');
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("person")
+                          .with<std::string_view>("/tags/0");
+        auto maybe_table = collection[{3}].gather(header);
+        auto table = *maybe_table;
+        EXPECT_EQ(table.column<0>()[0].value, 25);
+        EXPECT_STREQ(table.column<1>()[0].value.data(), "Carl");
+        EXPECT_STREQ(table.column<2>()[0].value.data(), "a~b");
+    }
+
+    // Switching back restores the JSON texts
+    EXPECT_TRUE(collection.set_storage(ustore_doc_storage_json_k));
+    EXPECT_NE(blobs[3].value()->c_str()[0], '\0');
+    M_EXPECT_EQ_JSON(*collection[3].value(), R"( { "person": "Carl", "age": 25, "tags": ["a~b", "c/d"] } )");
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+}
+
+/**
+ * Compresses the documents with a dictionary, trained on the present ones,
+ * checking that reads, partial updates and tables see the original contents.
+ */
+TEST(db, docs_compressed_storage) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    blobs_collection_t blobs = db.main();
+    constexpr std::size_t docs_count = 1000;
+    auto make_doc = [](std::size_t i) {
+        return fmt::format(R"({{"id": {}, "name": "person-{}", "active": {}, "tags": ["a", "b"]}})",
+                           i,
+                           i * 7,
+                           i % 2 ? "true" : "false");
+    };
+    for (std::size_t i = 0; i != docs_count; ++i)
+        collection[static_cast<ustore_key_t>(i)] = make_doc(i).c_str();
+
+    // Both the present and the new documents are compressed, but exported as JSON
+    EXPECT_TRUE(collection.set_compression(docs_count));
+    collection[static_cast<ustore_key_t>(docs_count)] = make_doc(docs_count).c_str();
+    for (std::size_t i : {std::size_t(0), docs_count}) {
+        auto stored = *blobs[static_cast<ustore_key_t>(i)].value();
+        EXPECT_EQ(static_cast<std::uint8_t>(stored.c_str()[0]), 0x28);
+        EXPECT_LT(stored.size(), make_doc(i).size());
+    }
+    M_EXPECT_EQ_JSON(*collection[7].value(), make_doc(7));
+    M_EXPECT_EQ_JSON(*collection[ckf(7, "name")].value(), "\"person-49\"");
+
+    // Partial updates and tables work on top of compressed documents
+    EXPECT_TRUE(collection[ckf(3, "/active")].update("false"));
+    EXPECT_EQ(static_cast<std::uint8_t>(blobs[3].value()->c_str()[0]), 0x28);
+    M_EXPECT_EQ_JSON(*collection[ckf(3, "active")].value(), "false");
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("id")
+                          .with<std::string_view>("name");
+        auto maybe_table = collection[{5}].gather(header);
+        auto table = *maybe_table;
+        EXPECT_EQ(table.column<0>()[0].value, 5);
+        EXPECT_STREQ(table.column<1>()[0].value.data(), "person-35");
+    }
+
+    // Compression composes with packing, and disabling both restores the JSON texts
+    EXPECT_TRUE(collection.set_storage(ustore_doc_storage_packed_k));
+    M_EXPECT_EQ_JSON(*collection[5].value(), make_doc(5));
+    EXPECT_TRUE(collection.set_compression(0));
+    EXPECT_EQ(blobs[5].value()->c_str()[0], '\0');
+    EXPECT_TRUE(collection.set_storage(ustore_doc_storage_json_k));
+    M_EXPECT_EQ_JSON(*blobs[5].value(), make_doc(5));
+}
+
+/**
+ * Reads and gathers a large batch of documents in several threads,
+ * checking that the outputs match the ones of a single thread.
+ */
+TEST(db, docs_parallel_parsing) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    constexpr std::size_t docs_count = 3000;
+    std::vector<ustore_key_t> keys(docs_count);
+    for (std::size_t i = 0; i != docs_count; ++i) {
+        keys[i] = static_cast<ustore_key_t>(i);
+        if (i % 7 == 0)
+            continue;
+        auto json = fmt::format(R"({{"id": {}, "name": "doc-{}", "score": {}.5}})", i, i, i % 100);
+        collection[keys[i]] = json.c_str();
+    }
+
+    // Partial reads of fields
+    auto read_names = [&](std::size_t threads_count) {
+        arena_t arena(db);
+        status_t status;
+        ustore_str_view_t field = "/name";
+        ustore_length_t* offsets = nullptr;
+        ustore_length_t* lengths = nullptr;
+        ustore_bytes_ptr_t values = nullptr;
+        ustore_docs_read_t docs_read {};
+        docs_read.db = db;
+        docs_read.error = status.member_ptr();
+        docs_read.arena = arena.member_ptr();
+        docs_read.type = ustore_doc_field_str_k;
+        docs_read.tasks_count = docs_count;
+        docs_read.keys = keys.data();
+        docs_read.keys_stride = sizeof(ustore_key_t);
+        docs_read.fields = &field;
+        docs_read.threads_count = threads_count;
+        docs_read.offsets = &offsets;
+        docs_read.lengths = &lengths;
+        docs_read.values = &values;
+        ustore_docs_read(&docs_read);
+        EXPECT_TRUE(status);
+
+        std::vector<std::string> names(docs_count);
+        for (std::size_t i = 0; i != docs_count; ++i)
+            if (lengths[i] != ustore_length_missing_k)
+                names[i] = std::string(reinterpret_cast<char const*>(values) + offsets[i], lengths[i]);
+        return names;
+    };
+    auto serial_names = read_names(1);
+    EXPECT_EQ(serial_names[1], "doc-1");
+    EXPECT_EQ(read_names(4), serial_names);
+
+    // Columnar exports
+    auto header = table_header() //
+                      .with<std::int64_t>("id")
+                      .with<std::string_view>("name")
+                      .with<double>("score");
+    auto serial = *collection[keys].gather(header, true, 1);
+    auto parallel = *collection[keys].gather(header, true, 4);
+    for (std::size_t i = 0; i != docs_count; ++i) {
+        if (i % 7 == 0)
+            continue;
+        EXPECT_EQ(serial.column<0>()[i].value, static_cast<std::int64_t>(i));
+        EXPECT_EQ(parallel.column<0>()[i].value, serial.column<0>()[i].value);
+        EXPECT_EQ(parallel.column<0>()[i].valid, serial.column<0>()[i].valid);
+        EXPECT_EQ(parallel.column<1>()[i].value, serial.column<1>()[i].value);
+        EXPECT_EQ(parallel.column<2>()[i].value, serial.column<2>()[i].value);
+    }
+}
+
+/**
+ * Aggregates the fields of documents, grouped by a string field, checking the
+ * group of documents without it, and that parallel parsing doesn't change the results.
+ */
+TEST(db, docs_aggregate) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    constexpr std::size_t docs_count = 5000;
+    for (std::size_t i = 0; i != docs_count; ++i) {
+        std::string json = i % 10 == 0 //
+                               ? fmt::format(R"({{"score": {}}})", i % 100)
+                               : fmt::format(R"({{"color": "c{}", "score": {}}})", i % 3, i % 100);
+        collection[static_cast<ustore_key_t>(i)] = json.c_str();
+    }
+
+    ustore_doc_aggregation_t functions[] = {
+        ustore_doc_aggregate_count_k,
+        ustore_doc_aggregate_sum_k,
+        ustore_doc_aggregate_min_k,
+        ustore_doc_aggregate_max_k,
+        ustore_doc_aggregate_avg_k,
+    };
+    ustore_str_view_t fields[] = {nullptr, "/score", "/score", "/score", "/score"};
+
+    // Compute the expected results for every color, and the documents without it
+    std::map<std::string, std::vector<double>> expected_scores;
+    for (std::size_t i = 0; i != docs_count; ++i)
+        expected_scores[i % 10 == 0 ? std::string() : fmt::format("c{}", i % 3)].push_back(i % 100);
+
+    for (std::size_t threads_count : {1, 4}) {
+        auto maybe_aggregates = collection.aggregate({functions, 5}, {fields, 5}, "/color", threads_count);
+        EXPECT_TRUE(maybe_aggregates);
+        docs_aggregates_t aggregates = *maybe_aggregates;
+        EXPECT_EQ(aggregates.groups_count, 4u);
+
+        // Groups are sorted, and the missing one comes last
+        EXPECT_EQ(aggregates.group(0), std::optional<std::string_view>("c0"));
+        EXPECT_EQ(aggregates.group(2), std::optional<std::string_view>("c2"));
+        EXPECT_FALSE(aggregates.group(3));
+        for (std::size_t group_idx = 0; group_idx != aggregates.groups_count; ++group_idx) {
+            auto group = aggregates.group(group_idx);
+            std::vector<double> const& scores = expected_scores[group ? std::string(*group) : std::string()];
+            double sum = std::accumulate(scores.begin(), scores.end(), 0.0);
+            EXPECT_EQ(aggregates.result(0, group_idx), static_cast<double>(scores.size()));
+            EXPECT_EQ(aggregates.count(1, group_idx), scores.size());
+            EXPECT_EQ(aggregates.result(1, group_idx), sum);
+            EXPECT_EQ(aggregates.result(2, group_idx), *std::min_element(scores.begin(), scores.end()));
+            EXPECT_EQ(aggregates.result(3, group_idx), *std::max_element(scores.begin(), scores.end()));
+            EXPECT_DOUBLE_EQ(aggregates.result(4, group_idx), sum / scores.size());
+        }
+    }
+
+    // Without grouping, there is exactly one group, even for empty ranges
+    auto total = *collection.aggregate({functions, 2}, {fields, 2}, nullptr, 1, 100, 199);
+    EXPECT_EQ(total.groups_count, 1u);
+    EXPECT_FALSE(total.group(0));
+    EXPECT_EQ(total.result(0, 0), 100);
+    EXPECT_EQ(total.result(1, 0), 4950);
+
+    auto empty = *collection.aggregate({functions, 5}, {fields, 5}, nullptr, 1, docs_count, docs_count + 100);
+    EXPECT_EQ(empty.groups_count, 1u);
+    EXPECT_EQ(empty.result(0, 0), 0);
+    EXPECT_TRUE(std::isnan(empty.result(4, 0)));
+
+    // Only counts can skip the field
+    ustore_str_view_t missing_fields[] = {nullptr, nullptr};
+    EXPECT_FALSE(collection.aggregate({functions, 2}, {missing_fields, 2}));
+}
+
+/**
+ * Pages through a table in small chunks of rows, both over a range of keys and over
+ * a list of them, checking that every row is gathered exactly once.
+ */
+TEST(db, docs_table_stream) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    constexpr std::size_t docs_count = 1000;
+    for (std::size_t i = 0; i != docs_count; ++i) {
+        auto json = fmt::format(R"({{"id": {}, "name": "doc-{}"}})", i, i);
+        collection[static_cast<ustore_key_t>(i * 2)] = json.c_str();
+    }
+
+    auto header = table_header() //
+                      .with<std::int64_t>("id")
+                      .with<std::string_view>("name");
+    table_header_view_t header_view {header.fields().begin(), header.types().begin(), 2};
+
+    auto check_pages = [&](docs_table_stream_t& stream, std::vector<ustore_key_t> const& expected_keys) {
+        std::size_t rows = 0;
+        status_t status = stream.seek_to_first();
+        for (; status && !stream.is_end(); status = stream.seek_to_next_batch()) {
+            docs_table_t const& page = stream.page();
+            EXPECT_LE(page.rows(), stream.rows_per_page());
+            auto ids = page.column<std::int64_t>(0);
+            auto names = page.column<std::string_view>(1);
+            for (std::size_t i = 0; i != page.rows(); ++i, ++rows) {
+                EXPECT_EQ(stream.keys_batch()[i], expected_keys[rows]);
+                EXPECT_EQ(ids[i].value, expected_keys[rows] / 2);
+                EXPECT_EQ(names[i].value, fmt::format("doc-{}", expected_keys[rows] / 2));
+            }
+        }
+        EXPECT_TRUE(status);
+        EXPECT_EQ(rows, expected_keys.size());
+    };
+
+    // Pages of a range, with the last one cut in the middle
+    std::vector<ustore_key_t> expected_keys;
+    for (ustore_key_t key = 100; key <= 1001; key += 2)
+        expected_keys.push_back(key);
+    docs_table_stream_t range_stream = collection.table_stream(header_view, 64, 1, 99, 1001);
+    check_pages(range_stream, expected_keys);
+
+    // Pages of a list of keys, keeping the order
+    std::vector<ustore_key_t> keys {998, 0, 500, 2, 996, 4};
+    docs_table_stream_t keys_stream = collection.table_stream(header_view, {keys.data(), keys.size()}, 4, 2);
+    check_pages(keys_stream, keys);
+
+    // Empty ranges end immediately
+    docs_table_stream_t empty_stream = collection.table_stream(header_view, 64, 1, docs_count * 2, docs_count * 4);
+    EXPECT_TRUE(empty_stream.seek_to_first());
+    EXPECT_TRUE(empty_stream.is_end());
+}
+
+/**
+ * Enables the field catalog of a collection, checking that writes, updates and removals
+ * keep the counters in sync, and that gist and gather take the fields and types from it.
+ */
+TEST(db, docs_field_catalog) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t collection = db.main<docs_collection_t>();
+    collection[1] = R"({"person": "Alice", "age": 27, "tags": ["x"]})";
+    collection[2] = R"({"person": "Bob", "age": -3})";
+    collection[3] = R"({"person": "Carl", "height": 1.8})";
+
+    // Collections without catalogs can't be listed without keys
+    EXPECT_FALSE(collection.fields());
+    EXPECT_TRUE(collection.set_catalog(true));
+    collection[4] = R"({"person": "Dan", "age": 30})";
+    collection[3] = R"({"person": "Carl", "height": "tall"})";
+    EXPECT_TRUE(collection[2].erase());
+
+    using field_t = std::tuple<std::string, ustore_size_t, ustore_doc_field_type_t>;
+    auto fields_of_collection = [&] {
+        arena_t arena(db);
+        status_t status;
+        ustore_collection_t collection_id = collection;
+        ustore_size_t fields_count = 0;
+        ustore_length_t* offsets = nullptr;
+        ustore_char_t* fields = nullptr;
+        ustore_size_t* counts = nullptr;
+        ustore_doc_field_type_t* types = nullptr;
+        ustore_docs_gist_t docs_gist {};
+        docs_gist.db = db;
+        docs_gist.error = status.member_ptr();
+        docs_gist.arena = arena.member_ptr();
+        docs_gist.docs_count = 1;
+        docs_gist.collections = &collection_id;
+        docs_gist.fields_count = &fields_count;
+        docs_gist.offsets = &offsets;
+        docs_gist.fields = &fields;
+        docs_gist.counts = &counts;
+        docs_gist.types = &types;
+        ustore_docs_gist(&docs_gist);
+        EXPECT_TRUE(status);
+
+        std::vector<field_t> listed;
+        for (std::size_t i = 0; i != fields_count; ++i)
+            listed.emplace_back(fields + offsets[i], counts[i], types[i]);
+        return listed;
+    };
+    std::vector<field_t> expected {
+        {"/age", 2, ustore_doc_field_u64_k},
+        {"/height", 1, ustore_doc_field_str_k},
+        {"/person", 3, ustore_doc_field_str_k},
+        {"/tags/0", 1, ustore_doc_field_str_k},
+    };
+    EXPECT_EQ(fields_of_collection(), expected);
+    EXPECT_EQ(collection.fields()->size(), expected.size());
+
+    // Columns of default types take the type suggested by the catalog
+    {
+        arena_t arena(db);
+        status_t status;
+        ustore_key_t keys[] = {1, 4};
+        ustore_str_view_t field = "age";
+        ustore_doc_field_type_t type = ustore_doc_field_default_k;
+        ustore_octet_t** validities = nullptr;
+        ustore_byte_t** scalars = nullptr;
+        ustore_length_t** offsets = nullptr;
+        ustore_length_t** lengths = nullptr;
+        ustore_byte_t* strings = nullptr;
+        ustore_doc_field_type_t* resolved_types = nullptr;
+        ustore_docs_gather_t docs_gather {};
+        docs_gather.db = db;
+        docs_gather.error = status.member_ptr();
+        docs_gather.arena = arena.member_ptr();
+        docs_gather.docs_count = 2;
+        docs_gather.fields_count = 1;
+        docs_gather.keys = keys;
+        docs_gather.keys_stride = sizeof(ustore_key_t);
+        docs_gather.fields = &field;
+        docs_gather.types = &type;
+        docs_gather.columns_validities = &validities;
+        docs_gather.columns_scalars = &scalars;
+        docs_gather.columns_offsets = &offsets;
+        docs_gather.columns_lengths = &lengths;
+        docs_gather.joined_strings = &strings;
+        docs_gather.columns_types = &resolved_types;
+        ustore_docs_gather(&docs_gather);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(resolved_types[0], ustore_doc_field_u64_k);
+        EXPECT_EQ(reinterpret_cast<std::uint64_t const*>(scalars[0])[0], 27u);
+        EXPECT_EQ(reinterpret_cast<std::uint64_t const*>(scalars[0])[1], 30u);
+    }
+
+    // Disabling drops the catalog
+    EXPECT_TRUE(collection.set_catalog(false));
+    EXPECT_FALSE(collection.fields());
+}
+
+/**
+ * Writes distinct documents into a cataloged collection from several threads at once,
+ * checking that the counters of the catalog don't lose the updates of concurrent writers.
+ */
+TEST(db, docs_field_catalog_concurrent) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.main<docs_collection_t>().set_catalog(true));
+
+    constexpr std::size_t threads_count = 4;
+    constexpr ustore_key_t docs_per_thread = 50;
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back([&, thread_idx] {
+            docs_collection_t collection = db.main<docs_collection_t>();
+            for (ustore_key_t i = 0; i != docs_per_thread; ++i) {
+                ustore_key_t key = static_cast<ustore_key_t>(thread_idx) * docs_per_thread + i;
+                std::string doc = R"({"person": "P)" + std::to_string(key) + R"(", "age": )" + std::to_string(i) + "}";
+                EXPECT_TRUE(collection[key].assign(doc.c_str()));
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    arena_t arena(db);
+    status_t status;
+    ustore_collection_t collection_id = ustore_collection_main_k;
+    ustore_size_t fields_count = 0;
+    ustore_length_t* offsets = nullptr;
+    ustore_char_t* fields = nullptr;
+    ustore_size_t* counts = nullptr;
+    ustore_doc_field_type_t* types = nullptr;
+    ustore_docs_gist_t docs_gist {};
+    docs_gist.db = db;
+    docs_gist.error = status.member_ptr();
+    docs_gist.arena = arena.member_ptr();
+    docs_gist.docs_count = 1;
+    docs_gist.collections = &collection_id;
+    docs_gist.fields_count = &fields_count;
+    docs_gist.offsets = &offsets;
+    docs_gist.fields = &fields;
+    docs_gist.counts = &counts;
+    docs_gist.types = &types;
+    ustore_docs_gist(&docs_gist);
+    EXPECT_TRUE(status);
+
+    ASSERT_EQ(fields_count, 2u);
+    for (std::size_t i = 0; i != fields_count; ++i)
+        EXPECT_EQ(counts[i], threads_count * docs_per_thread) << (fields + offsets[i]);
+    db.close();
+}
+
+/**
+ * Fills document collection with info about Alice, Bob and Carl,
+ * sampling it later in a form of a table, using both low-level APIs,
+ * and higher-level compile-time C++ meta-programming abstractions.
+ */
+TEST(db, docs_table) {
+    using json_t = nlohmann::json;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    // Inject basic data
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto json_alice = R"( { "person": "Alice", "age": 27, "height": 1 } )"_json.dump();
+    auto json_bob = R"( { "person": "Bob", "age": "27", "weight": 2 } )"_json.dump();
+    auto json_carl = R"( { "person": "Carl", "age": 24 } )"_json.dump();
+    collection[1] = json_alice.c_str();
+    collection[2] = json_bob.c_str();
+    collection[3] = json_carl.c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), json_alice.c_str());
+    M_EXPECT_EQ_JSON(*collection[2].value(), json_bob.c_str());
+
+    // Just column names
+    {
+        auto maybe_fields = collection[1].gist();
+        auto fields = *maybe_fields;
+
+        std::vector<std::string> parsed;
+        for (auto field : fields)
+            parsed.emplace_back(field.data());
+
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/person"), parsed.end());
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/height"), parsed.end());
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/age"), parsed.end());
+        EXPECT_EQ(std::find(parsed.begin(), parsed.end(), "/weight"), parsed.end());
+    }
+
+    // Single cell
+    {
+        auto header = table_header().with<std::uint32_t>("age");
+        auto maybe_table = collection[1].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_FALSE(col0[0].converted);
+    }
+
+    // Single row
+    {
+        auto header = table_header() //
+                          .with<std::uint32_t>("age")
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("age");
+
+        auto maybe_table = collection[1].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_FALSE(col0[0].converted);
+        EXPECT_EQ(col1[0].value, 27);
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col2[0].value.data(), "27");
+        EXPECT_TRUE(col2[0].converted);
+    }
+
+    // Single column
+    {
+        auto header = table_header().with<std::int32_t>("age");
+        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+    }
+
+    // Single strings column
+    {
+        auto header = table_header().with<std::string_view>("age");
+        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_STREQ(col0[0].value.data(), "27");
+        EXPECT_TRUE(col0[0].converted);
+        EXPECT_STREQ(col0[1].value.data(), "27");
+        EXPECT_STREQ(col0[2].value.data(), "24");
+    }
+
+    // Multi-column
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("age")
+                          .with<std::string_view>("person")
+                          .with<float>("person")
+                          .with<std::int32_t>("height")
+                          .with<std::uint64_t>("weight");
+
+        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+        auto col3 = table.column<3>();
+        auto col4 = table.column<4>();
+        auto col5 = table.column<5>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+
+        EXPECT_STREQ(col1[0].value.data(), "27");
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col1[1].value.data(), "27");
+        EXPECT_STREQ(col1[2].value.data(), "24");
+    }
+
+    // Multi-column Type-punned exports
+    {
+        table_header_t header {{
+            field_type_t {"age", ustore_doc_field_i32_k},
+            field_type_t {"age", ustore_doc_field_str_k},
+            field_type_t {"person", ustore_doc_field_str_k},
+            field_type_t {"person", ustore_doc_field_f32_k},
+            field_type_t {"height", ustore_doc_field_i32_k},
+            field_type_t {"weight", ustore_doc_field_u64_k},
+        }};
+
+        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column(0).as<std::int32_t>();
+        auto col1 = table.column(1).as<value_view_t>();
+        auto col2 = table.column(2).as<value_view_t>();
+        auto col3 = table.column(3).as<float>();
+        auto col4 = table.column(4).as<std::int32_t>();
+        auto col5 = table.column(5).as<std::uint64_t>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+
+        EXPECT_STREQ(col1[0].value.c_str(), "27");
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col1[1].value.c_str(), "27");
+        EXPECT_STREQ(col1[2].value.c_str(), "24");
+    }
+}
+
+#pragma region Graph Modality
+
+edge_t make_edge(ustore_key_t edge_id, ustore_key_t v1, ustore_key_t v2) {
+    return {v1, v2, edge_id};
+}
+
+std::vector<edge_t> make_edges(std::size_t vertices_count = 2, std::size_t next_connect = 1) {
+    std::vector<edge_t> es;
+    ustore_key_t edge_id = 0;
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        ustore_key_t connect_with = vertex_id + next_connect;
+        while (connect_with < vertices_count) {
+            edge_id++;
+            es.push_back(make_edge(edge_id, vertex_id, connect_with));
+            connect_with = connect_with + next_connect;
+        }
+    }
+    return es;
+}
+
+/**
+ * Upserts disconnected vertices into the graph.
+ */
+TEST(db, graph_upsert_vertices) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    std::vector<ustore_key_t> vertices {1, 4, 5, 2};
+    EXPECT_TRUE(net.upsert_vertices(vertices));
+
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_TRUE(*net.contains(4));
+    EXPECT_TRUE(*net.contains(5));
+}
+
+/**
+ * Upserts an edge and its member vertices into the graph.
+ */
+TEST(db, graph_upsert_edge) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    edge_t edge {1, 2, 9};
+    EXPECT_TRUE(net.upsert_edge(edge));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(3));
+
+    auto neighbors = net.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 1);
+    EXPECT_EQ(neighbors[0], 2);
+}
+
+/**
+ * Tests "Graphs" Modality, with on of the simplest network designs - a triangle.
+ * Three vertices, three connections between them, forming 3 undirected, or 6 directed edges.
+ * Tests edge upserts, existence checks, degree computation, vertex removals.
+ */
+TEST(db, graph_triangle) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    // triangle
+    edge_t edge1 {1, 2, 9};
+    edge_t edge2 {2, 3, 10};
+    edge_t edge3 {3, 1, 11};
+
+    EXPECT_TRUE(net.upsert_edge(edge1));
+    EXPECT_TRUE(net.upsert_edge(edge2));
+    EXPECT_TRUE(net.upsert_edge(edge3));
+
+    auto neighbors = net.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 2);
+    EXPECT_EQ(neighbors[1], 3);
+
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(9));
+    EXPECT_FALSE(*net.contains(10));
+    EXPECT_FALSE(*net.contains(1000));
+
+    EXPECT_EQ(*net.degree(1), 2u);
+    EXPECT_EQ(*net.degree(2), 2u);
+    EXPECT_EQ(*net.degree(3), 2u);
+    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+
+    EXPECT_TRUE(net.edges_containing(1));
+    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+
+    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
+    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+
+    // Check scans
+    EXPECT_TRUE(net.edges());
+    {
+        std::vector<edge_t> expected_edges {edge1, edge2, edge3};
+        std::vector<edge_t> exported_edges;
+
+        auto present_edges = *net.edges(ustore_vertex_source_k);
+        auto present_it = std::move(present_edges).begin();
+        auto count_results = 0;
+        while (!present_it.is_end()) {
+            exported_edges.push_back(*present_it);
+            ++present_it;
+            ++count_results;
+        }
+        EXPECT_EQ(count_results, 3);
+        EXPECT_EQ(exported_edges, expected_edges);
+    }
+
+    // Remove a single edge, making sure that the nodes info persists
+    EXPECT_TRUE(net.remove_edges({
+        {{&edge1.source_id}, 1},
+        {{&edge1.target_id}, 1},
+        {{&edge1.id}, 1},
+    }));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+
+    // Bring that edge back
+    EXPECT_TRUE(net.upsert_edges({
+        {{&edge1.source_id}, 1},
+        {{&edge1.target_id}, 1},
+        {{&edge1.id}, 1},
+    }));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+
+    // Remove a vertex
+    ustore_key_t vertex_to_remove = 2;
+    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
+    EXPECT_FALSE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+
+    // Bring back the whole graph
+    EXPECT_TRUE(net.upsert_edge(edge1));
+    EXPECT_TRUE(net.upsert_edge(edge2));
+    EXPECT_TRUE(net.upsert_edge(edge3));
+    EXPECT_TRUE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+}
+
+/**
+ * Further complicates the `graph_triangle` test by performing all of the updates
+ * and lookups in batches. This detects inconsistencies in concurrent updates to
+ * the underlying binary representation, triggered from a single high-level
+ * graph operation.
+ */
+TEST(db, graph_triangle_batch) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    blobs_collection_t main = db.main();
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    std::vector<edge_t> triangle {
+        {1, 2, 9},
+        {2, 3, 10},
+        {3, 1, 11},
+    };
+
+    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(9));
+    EXPECT_FALSE(*net.contains(10));
+    EXPECT_FALSE(*net.contains(1000));
+
+    EXPECT_EQ(*net.degree(1), 2u);
+    EXPECT_EQ(*net.degree(2), 2u);
+    EXPECT_EQ(*net.degree(3), 2u);
+    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+
+    EXPECT_TRUE(net.edges_containing(1));
+    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+
+    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
+    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+
+    // Check scans
+    EXPECT_TRUE(net.edges());
+    {
+        std::vector<edge_t> expected_edges {triangle.begin(), triangle.end()};
+        std::vector<edge_t> exported_edges;
+
+        auto present_edges = *net.edges(ustore_vertex_source_k);
+        auto present_it = std::move(present_edges).begin();
+        size_t count_results = 0ul;
+        while (!present_it.is_end()) {
+            exported_edges.push_back(*present_it);
+            ++present_it;
+            ++count_results;
+        }
+        EXPECT_EQ(count_results, triangle.size());
+        EXPECT_EQ(exported_edges, expected_edges);
+    }
+
+    // Remove a single edge, making sure that the nodes info persists
+    EXPECT_TRUE(net.remove_edges(edges_view_t {
+        {{&triangle[0].source_id}, 1},
+        {{&triangle[0].target_id}, 1},
+        {{&triangle[0].id}, 1},
+    }));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+
+    // Bring that edge back
+    EXPECT_TRUE(net.upsert_edges(edges_view_t {
+        {{&triangle[0].source_id}, 1},
+        {{&triangle[0].target_id}, 1},
+        {{&triangle[0].id}, 1},
+    }));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+
+    // Remove a vertex
+    ustore_key_t vertex_to_remove = 2;
+    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
+    EXPECT_FALSE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+
+    // Bring back the whole graph
+    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
+    EXPECT_TRUE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+}
+
+/**
+ * Tries to make a transaction on a graph, that must fail to `commit`.
+ * Creates a "wedge": A-B-C. If a transaction changes the B-C edge,
+ * while A-B is updated externally, the commit will fail.
+ */
+TEST(db, graph_transaction_watch) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    edge_t edge_ab {'A', 'B', 19};
+    edge_t edge_bc {'B', 'C', 31};
+    EXPECT_TRUE(net.upsert_edge(edge_ab));
+    EXPECT_TRUE(net.upsert_edge(edge_bc));
 
-std::vector<std::string> make_three_flat_docs() {
-    auto json1 = R"( {"person": "Alice", "age": 24} )"_json.dump();
-    auto json2 = R"( {"person": "Bob", "age": 25} )"_json.dump();
-    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
-    return {json1, json2, json3};
-}
+    transaction_t txn = *db.transact();
+    graph_collection_t txn_net = txn.main<graph_collection_t>();
+    EXPECT_EQ(txn_net.degree('B'), 2);
+    EXPECT_TRUE(txn_net.remove_edge(edge_bc));
+    EXPECT_TRUE(net.remove_edge(edge_ab));
 
-std::vector<std::string> make_three_nested_docs() {
-    auto json1 = R"( {"person": {"name":"Alice", "age": 24}} )"_json.dump();
-    auto json2 = R"( {"person": [{"name":"Bob", "age": 25}]} )"_json.dump();
-    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
-    return {json1, json2, json3};
+    EXPECT_FALSE(txn.commit());
 }
 
 /**
- * Tests "Documents" Modality, mapping integers to structured hierarchical documents.
- * Takes a basic flat JSON document, and checks if it can be imported in JSON, BSON
- * and MessagePack forms, and later be properly accessed at field-level.
+ * Constructs a larger graph, validating the degrees in a resulting network afterward.
  */
-TEST(db, docs_flat) {
-
+TEST(db, graph_random_fill) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    // JSON
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto jsons = make_three_flat_docs();
-    collection[1] = jsons[0].c_str();
-    collection[2] = jsons[1].c_str();
-    collection[3] = jsons[2].c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), "\"Bob\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(3, "age")].value(), "26");
-
-    // Binary
-    auto maybe_person = collection[ckf(1, "person")].value(ustore_doc_field_str_k);
-    EXPECT_EQ(std::string_view(maybe_person->c_str(), maybe_person->size()), std::string_view("Alice"));
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    // BSON
-    bson_error_t error;
-    bson_t* bson = bson_new_from_json((uint8_t*)jsons[0].c_str(), -1, &error);
-    uint8_t const* buffer = bson_get_data(bson);
-    auto view = value_view_t(buffer, bson->len);
-    collection.at(4, ustore_doc_field_bson_k) = view;
-    M_EXPECT_EQ_JSON(*collection[4].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(4, "person")].value(), "\"Alice\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(4, "age")].value(), "24");
-    bson_clear(&bson);
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-    // MsgPack
-    auto message_pack = *collection[1].value(ustore_doc_field_msgpack_k);
-    collection.at(5, ustore_doc_field_msgpack_k) = message_pack;
-    M_EXPECT_EQ_JSON(*collection[5].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(5, "person")].value(), "\"Alice\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(5, "age")].value(), "24");
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_EQ(*graph.degree(vertex_id), 9u);
+    }
 }
 
 /**
- * Tries adding 3 simple nested JSONs, using JSON-Pointers
- * to retrieve specific fields across multiple keys.
+ * Inserts two edges with a shared vertex in two separate transactions.
+ * The latter insert must fail, as it depends on the preceding state of the vertex.
  */
-TEST(db, docs_nested_batch) {
+TEST(db, graph_conflicting_transactions) {
+    if (!ustore_supports_transactions_k)
+        return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
-
-    auto jsons = make_three_nested_docs();
-    std::string continuous_jsons = jsons[0] + jsons[1] + jsons[2];
-    auto vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
-    std::array<ustore_length_t, 4> offsets = {
-        0,
-        static_cast<ustore_length_t>(jsons[0].size()),
-        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size()),
-        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size() + jsons[2].size()),
-    };
-    contents_arg_t values {};
-    values.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
-    values.contents_begin = {&vals_begin, 0};
 
-    std::array<ustore_key_t, 3> keys = {1, 2, 3};
-    auto ref = collection[keys];
-    EXPECT_TRUE(ref.assign(values));
+    transaction_t txn = *db.transact();
+    graph_collection_t txn_net = txn.main<graph_collection_t>();
+    transaction_t txn2 = *db.transact();
+    graph_collection_t txn_net2 = txn2.main<graph_collection_t>();
 
-    // Read One By One
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[2].value(), jsons[1]);
-    M_EXPECT_EQ_JSON(*collection[3].value(), jsons[2]);
+    edge_t edge4 {4, 5, 15};
+    edge_t edge5 {5, 6, 16};
 
-    auto expected = R"({"name":"Alice", "age": 24})"_json.dump();
-    M_EXPECT_EQ_JSON(*collection[ckf(1, "person")].value(), expected);
+    EXPECT_TRUE(txn_net.upsert_edge(edge4));
+    EXPECT_TRUE(txn_net2.upsert_edge(edge5));
+    EXPECT_TRUE(txn.commit());
+    EXPECT_FALSE(txn2.commit());
+}
 
-    expected = R"([{"name":"Bob", "age": 25}])"_json.dump();
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), expected);
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "/person/0/name")].value(), "\"Bob\"");
+/**
+ * Takes a single Graph Store and populates it with various 5-vertex shapes:
+ * a star, a pentagon, and five self-loops.
+ */
+TEST(db, graph_layering_shapes) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Read sorted keys
-    check_equalities(ref, values);
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    // Read not sorted keys
-    std::array<ustore_key_t, 3> not_sorted_keys = {1, 3, 2};
-    auto not_sorted_ref = collection[not_sorted_keys];
-    std::string not_sorted_jsons = jsons[0] + jsons[2] + jsons[1];
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(not_sorted_jsons.data());
-    offsets[2] = jsons[0].size() + jsons[2].size();
-    offsets[3] = jsons[0].size() + jsons[2].size() + jsons[1].size();
-    check_equalities(not_sorted_ref, values);
+    std::vector<ustore_key_t> vertices = {1, 2, 3, 4, 5};
+    auto over_the_vertices = [&](bool exist, size_t degree) {
+        for (auto& vertex_id : vertices) {
+            EXPECT_EQ(*graph.contains(vertex_id), exist);
+            EXPECT_EQ(*graph.degree(vertex_id), degree);
+        }
+    };
 
-    // Read duplicate keys
-    std::array<ustore_key_t, 3> duplicate_keys = {1, 2, 1};
-    auto duplicate_ref = collection[duplicate_keys];
-    std::string duplicate_jsons = jsons[0] + jsons[1] + jsons[0];
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(duplicate_jsons.data());
-    offsets[2] = jsons[0].size() + jsons[1].size();
-    offsets[3] = jsons[0].size() + jsons[1].size() + jsons[0].size();
-    check_equalities(duplicate_ref, values);
+    // Before insertions, the graph is empty.
+    over_the_vertices(false, 0);
 
-    // Read with fields
-    std::array<collection_key_field_t, 3> keys_with_fields = {
-        ckf(1, "person"),
-        ckf(2, "/person/0/name"),
-        ckf(3, "age"),
+    std::vector<edge_t> star {
+        {1, 3, 1},
+        {1, 4, 2},
+        {2, 4, 3},
+        {2, 5, 4},
+        {3, 5, 5},
+    };
+    std::vector<edge_t> pentagon {
+        {1, 2, 6},
+        {2, 3, 7},
+        {3, 4, 8},
+        {4, 5, 9},
+        {5, 1, 10},
+    };
+    std::vector<edge_t> self_loops {
+        {1, 1, 11},
+        {2, 2, 12},
+        {3, 3, 13},
+        {4, 4, 14},
+        {5, 5, 15},
     };
-    auto ref_with_fields = collection[keys_with_fields];
-    auto field_value1 = R"({"name":"Alice", "age": 24})"_json.dump();
-    auto field_value2 = R"("Bob")"_json.dump();
-    auto field_value3 = R"(26)"_json.dump();
-    std::string field_values = field_value1 + field_value2 + field_value3;
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(field_values.data());
-    offsets[1] = field_value1.size();
-    offsets[2] = field_value1.size() + field_value2.size();
-    offsets[3] = field_value1.size() + field_value2.size() + field_value3.size();
-    check_equalities(ref_with_fields, values);
-
-    // Check Invalid Json Write
-    std::string invalid_json = R"({"name":"Alice", } "age": 24})";
-    offsets[1] = jsons[0].size();
-    offsets[2] = jsons[0].size() + jsons[1].size();
-    offsets[3] = jsons[0].size() + jsons[1].size() + invalid_json.size();
-    continuous_jsons = jsons[0] + jsons[1] + invalid_json;
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
 
-    EXPECT_FALSE(ref.assign(values));
+    EXPECT_TRUE(graph.upsert_edges(edges(star)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.remove_edges(edges(star)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(star)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.upsert_edges(edges(self_loops)));
+    over_the_vertices(true, 6u);
+    EXPECT_TRUE(graph.remove_edges(edges(star)));
+    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.remove_edges(edges(self_loops)));
+    over_the_vertices(true, 0);
+    EXPECT_TRUE(db.clear());
+    over_the_vertices(false, 0);
 }
 
 /**
- * Performs basic JSON Pathes, JSON Merge-Patches, and sub-document level updates.
+ * Tests vertex removals, which are the hardest operations on Graphs,
+ * as they trigger updates in all nodes connected to the removed one.
  */
-TEST(db, docs_modify) {
+TEST(db, graph_remove_vertices) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto jsons = make_three_nested_docs();
-    collection[1] = jsons[0].c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-
-    // Update
-    auto modifier = R"( {"person": {"name":"Charles", "age": 28}} )"_json.dump();
-    EXPECT_TRUE(collection[1].update(modifier.c_str()));
-    auto result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), modifier.c_str());
-
-    // Update By Field
-    modifier = R"( {"name": "Alice", "age": 24} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/person")].update(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[0].c_str());
-
-    // Insert
-    EXPECT_FALSE(collection[1].insert(jsons[1].c_str()));
-    EXPECT_TRUE(collection[2].insert(jsons[1].c_str()));
-    result = collection[2].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[1].c_str());
 
-    // Insert By Field
-    modifier = R"("Doe" )"_json.dump();
-    auto expected = R"({"person": [{"name":"Bob", "age": 25, "surname" : "Doe"}]})"_json.dump();
-    EXPECT_TRUE(collection[ckf(2, "/person/0/surname")].insert(modifier.c_str()));
-    result = collection[2].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    // Upsert
-    EXPECT_TRUE(collection[1].upsert(jsons[2].c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[2].c_str());
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-    // Upsert By Field
-    modifier = R"("Charles")"_json.dump();
-    expected = R"( {"person": "Charles", "age": 26} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/person")].upsert(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
+        EXPECT_TRUE(graph.remove_vertex(vertex_id));
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_FALSE(*graph.contains(vertex_id));
+    }
 
-    modifier = R"(70)"_json.dump();
-    expected = R"( {"person": "Charles", "age": 26, "weight" : 70} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/weight")].upsert(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    std::vector<ustore_key_t> vertices(vertices_count);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    EXPECT_TRUE(graph.remove_vertices(vertices));
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_FALSE(*graph.contains(vertex_id));
+    }
 }
 
 /**
- * Uses a well-known repository of JSON-Patches and JSON-MergePatches,
- * to validate that document modifications work adequately in corner cases.
+ * Removes just the known list of edges, checking that vertices remain
+ * in the graph, even though entirely disconnected.
  */
-TEST(db, docs_merge_and_patch) {
-    using json_t = nlohmann::json;
+TEST(db, graph_remove_edges_keep_vertices) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
 
-    std::ifstream f_patch("tests/patch.json");
-    json_t j_object = json_t::parse(f_patch);
-    for (auto it : j_object) {
-        auto doc = it["doc"].dump();
-        auto patch = it["patch"].dump();
-        auto expected = it["expected"].dump();
-        collection[1] = doc.c_str();
-        EXPECT_TRUE(collection[1].patch(patch.c_str()));
-        auto maybe_value = collection[1].value();
-        EXPECT_TRUE(maybe_value);
-        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
-    }
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    std::ifstream f_merge("tests/merge.json");
-    j_object = json_t::parse(f_merge);
-    for (auto it : j_object) {
-        auto doc = it["doc"].dump();
-        auto merge = it["merge"].dump();
-        auto expected = it["expected"].dump();
-        collection[1] = doc.c_str();
-        EXPECT_TRUE(collection[1].merge(merge.c_str()));
-        auto maybe_value = collection[1].value();
-        EXPECT_TRUE(maybe_value);
-        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    EXPECT_TRUE(graph.remove_edges(edges(edges_vec)));
+
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
     }
 }
-
 /**
- * Fills document collection with info about Alice, Bob and Carl,
- * sampling it later in a form of a table, using both low-level APIs,
- * and higher-level compile-time C++ meta-programming abstractions.
+ * Add edges to the graph. Checks how many edges each vertex has.
+ * Then remove the edges, making sure that the vertices aren't
+ * connected to each other anymore.
  */
-TEST(db, docs_table) {
-    using json_t = nlohmann::json;
+TEST(db, graph_get_vertex_edges) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    // Inject basic data
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto json_alice = R"( { "person": "Alice", "age": 27, "height": 1 } )"_json.dump();
-    auto json_bob = R"( { "person": "Bob", "age": "27", "weight": 2 } )"_json.dump();
-    auto json_carl = R"( { "person": "Carl", "age": 24 } )"_json.dump();
-    collection[1] = json_alice.c_str();
-    collection[2] = json_bob.c_str();
-    collection[3] = json_carl.c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), json_alice.c_str());
-    M_EXPECT_EQ_JSON(*collection[2].value(), json_bob.c_str());
-
-    // Just column names
-    {
-        auto maybe_fields = collection[1].gist();
-        auto fields = *maybe_fields;
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-        std::vector<std::string> parsed;
-        for (auto field : fields)
-            parsed.emplace_back(field.data());
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/person"), parsed.end());
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/height"), parsed.end());
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/age"), parsed.end());
-        EXPECT_EQ(std::find(parsed.begin(), parsed.end(), "/weight"), parsed.end());
+    std::vector<edge_t> received_edges;
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        auto es = *graph.edges_containing(vertex_id);
+        EXPECT_EQ(es.size(), 9u);
+        for (size_t i = 0; i != es.size(); ++i)
+            received_edges.push_back(es[i]);
     }
+    EXPECT_TRUE(graph.remove_edges(edges(received_edges)));
 
-    // Single cell
-    {
-        auto header = table_header().with<std::uint32_t>("age");
-        auto maybe_table = collection[1].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
-
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_FALSE(col0[0].converted);
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
+        EXPECT_EQ(graph.edges_containing(vertex_id)->size(), 0);
     }
+}
 
-    // Single row
-    {
-        auto header = table_header() //
-                          .with<std::uint32_t>("age")
-                          .with<std::int32_t>("age")
-                          .with<std::string_view>("age");
-
-        auto maybe_table = collection[1].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
-        auto col1 = table.column<1>();
-        auto col2 = table.column<2>();
+/**
+ * Getting the degrees of multiple vertices simultaneously.
+ */
+TEST(db, graph_degrees) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_FALSE(col0[0].converted);
-        EXPECT_EQ(col1[0].value, 27);
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col2[0].value.data(), "27");
-        EXPECT_TRUE(col2[0].converted);
-    }
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    // Single column
-    {
-        auto header = table_header().with<std::int32_t>("age");
-        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
+    constexpr std::size_t vertices_count = 1000;
+    std::vector<ustore_key_t> vertices(vertices_count);
+    std::iota(vertices.begin(), vertices.end(), 0);
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
-    }
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-    // Single strings column
-    {
-        auto header = table_header().with<std::string_view>("age");
-        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
+    auto degrees = *graph.degrees(strided_range(vertices).immutable());
+    EXPECT_EQ(degrees.size(), vertices_count);
+}
 
-        EXPECT_STREQ(col0[0].value.data(), "27");
-        EXPECT_TRUE(col0[0].converted);
-        EXPECT_STREQ(col0[1].value.data(), "27");
-        EXPECT_STREQ(col0[2].value.data(), "24");
-    }
+TEST(db, graph_neighbors) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Multi-column
-    {
-        auto header = table_header() //
-                          .with<std::int32_t>("age")
-                          .with<std::string_view>("age")
-                          .with<std::string_view>("person")
-                          .with<float>("person")
-                          .with<std::int32_t>("height")
-                          .with<std::uint64_t>("weight");
+    graph_collection_t graph = db.main<graph_collection_t>();
+    edge_t edge1 {1, 1, 17};
+    edge_t edge2 {1, 2, 15};
+    edge_t edge3 {2, 3, 16};
 
-        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
-        auto col1 = table.column<1>();
-        auto col2 = table.column<2>();
-        auto col3 = table.column<3>();
-        auto col4 = table.column<4>();
-        auto col5 = table.column<5>();
+    EXPECT_TRUE(graph.upsert_edge(edge1));
+    EXPECT_TRUE(graph.upsert_edge(edge2));
+    EXPECT_TRUE(graph.upsert_edge(edge3));
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
+    auto neighbors = graph.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 1);
+    EXPECT_EQ(neighbors[1], 2);
 
-        EXPECT_STREQ(col1[0].value.data(), "27");
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col1[1].value.data(), "27");
-        EXPECT_STREQ(col1[2].value.data(), "24");
-    }
+    neighbors = graph.neighbors(2).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 1);
+    EXPECT_EQ(neighbors[1], 3);
+}
 
-    // Multi-column Type-punned exports
-    {
-        table_header_t header {{
-            field_type_t {"age", ustore_doc_field_i32_k},
-            field_type_t {"age", ustore_doc_field_str_k},
-            field_type_t {"person", ustore_doc_field_str_k},
-            field_type_t {"person", ustore_doc_field_f32_k},
-            field_type_t {"height", ustore_doc_field_i32_k},
-            field_type_t {"weight", ustore_doc_field_u64_k},
-        }};
+/**
+ * Fills, updates and shrinks a multi-graph with packed neighborhoods,
+ * comparing the exported edges to a plain reference after every step.
+ */
+TEST(db, graph_packed_neighborhoods) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column(0).as<std::int32_t>();
-        auto col1 = table.column(1).as<value_view_t>();
-        auto col2 = table.column(2).as<value_view_t>();
-        auto col3 = table.column(3).as<float>();
-        auto col4 = table.column(4).as<std::int32_t>();
-        auto col5 = table.column(5).as<std::uint64_t>();
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
+    constexpr std::size_t vertices_count = 300;
+    constexpr std::size_t edges_count = 6000;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<ustore_key_t> vertices_distribution(0, vertices_count - 1);
+    std::uniform_int_distribution<ustore_key_t> edges_distribution(std::numeric_limits<ustore_key_t>::min());
+    std::vector<edge_t> edges_vec(edges_count);
+    for (edge_t& edge : edges_vec)
+        edge = make_edge(edges_distribution(generator), vertices_distribution(generator), vertices_distribution(generator));
+
+    std::set<std::tuple<ustore_key_t, ustore_key_t, ustore_key_t>> expected;
+    auto check = [&] {
+        for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+            auto outgoing = *graph.edges_containing(vertex_id, ustore_vertex_source_k);
+            auto it = expected.lower_bound({vertex_id, std::numeric_limits<ustore_key_t>::min(), 0});
+            for (std::size_t i = 0; i != outgoing.size(); ++i, ++it) {
+                ASSERT_NE(it, expected.end());
+                EXPECT_EQ(std::get<0>(*it), outgoing[i].source_id);
+                EXPECT_EQ(std::get<1>(*it), outgoing[i].target_id);
+                EXPECT_EQ(std::get<2>(*it), outgoing[i].id);
+            }
+            EXPECT_TRUE(it == expected.end() || std::get<0>(*it) != vertex_id);
+        }
+    };
 
-        EXPECT_STREQ(col1[0].value.c_str(), "27");
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col1[1].value.c_str(), "27");
-        EXPECT_STREQ(col1[2].value.c_str(), "24");
-    }
+    // Vertices stay packed, even when later updated without requesting it
+    auto half = edges_vec.begin() + edges_count / 2;
+    EXPECT_TRUE(graph.upsert_edges(edges(std::vector<edge_t>(edges_vec.begin(), half)), ustore_graph_encoding_packed_k));
+    EXPECT_TRUE(graph.upsert_edges(edges(std::vector<edge_t>(half, edges_vec.end()))));
+    for (edge_t const& edge : edges_vec)
+        expected.insert({edge.source_id, edge.target_id, edge.id});
+    check();
+
+    // Packed entries take less space, than 16 bytes per edge in both directions
+    blobs_collection_t blobs = db.main();
+    std::size_t total_bytes = 0;
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id)
+        total_bytes += (*blobs[vertex_id].value()).size();
+    EXPECT_LT(total_bytes, edges_count * 2 * sizeof(neighborship_t));
+
+    std::vector<edge_t> removed_edges(edges_vec.begin(), edges_vec.begin() + edges_count / 4);
+    EXPECT_TRUE(graph.remove_edges(edges(removed_edges)));
+    for (edge_t const& edge : removed_edges)
+        expected.erase({edge.source_id, edge.target_id, edge.id});
+    check();
+
+    std::vector<ustore_key_t> removed_vertices {0, 1, 2, 3, 4};
+    EXPECT_TRUE(graph.remove_vertices(removed_vertices));
+    for (auto it = expected.begin(); it != expected.end();)
+        it = std::get<0>(*it) < 5 || std::get<1>(*it) < 5 ? expected.erase(it) : std::next(it);
+    check();
 }
 
-#pragma region Graph Modality
+/**
+ * Appends edges one by one to a high-degree vertex, checking that its entry in
+ * the main collection isn't rewritten, until the delta segment is merged back.
+ */
+TEST(db, graph_delta_segments) {
+    for (ustore_graph_encoding_t encoding : {ustore_graph_encoding_plain_k, ustore_graph_encoding_packed_k}) {
+        clear_environment();
+        database_t db;
+        EXPECT_TRUE(db.open(config().c_str()));
+
+        graph_collection_t graph = db.main<graph_collection_t>();
+        blobs_collection_t blobs = db.main();
+        constexpr ustore_key_t hub = 0;
+        constexpr ustore_size_t initial_degree = 1000;
 
-edge_t make_edge(ustore_key_t edge_id, ustore_key_t v1, ustore_key_t v2) {
-    return {v1, v2, edge_id};
+        std::set<std::tuple<ustore_key_t, ustore_key_t, ustore_key_t>> expected;
+        std::vector<edge_t> initial_edges;
+        for (ustore_key_t i = 1; i <= static_cast<ustore_key_t>(initial_degree); ++i) {
+            initial_edges.push_back(make_edge(i, hub, i));
+            expected.insert({hub, i, i});
+        }
+        EXPECT_TRUE(graph.upsert_edges(edges(initial_edges), encoding));
+
+        auto check = [&] {
+            auto found = *graph.edges_containing(hub, ustore_vertex_source_k);
+            ASSERT_EQ(found.size(), expected.size());
+            auto it = expected.begin();
+            for (std::size_t i = 0; i != found.size(); ++i, ++it) {
+                EXPECT_EQ(std::get<0>(*it), found[i].source_id);
+                EXPECT_EQ(std::get<1>(*it), found[i].target_id);
+                EXPECT_EQ(std::get<2>(*it), found[i].id);
+            }
+            EXPECT_EQ(*graph.degree(hub), expected.size());
+        };
+        auto hub_entry = [&] {
+            return std::string(std::string_view(*blobs[hub].value()));
+        };
+
+        // Small appends land in the segment
+        std::string const base_entry = hub_entry();
+        ustore_key_t next_id = initial_degree + 1;
+        for (std::size_t i = 0; i != 20; ++i, ++next_id) {
+            EXPECT_TRUE(graph.upsert_edge(make_edge(next_id, hub, next_id)));
+            expected.insert({hub, next_id, next_id});
+        }
+        EXPECT_TRUE(graph.upsert_edge(make_edge(5, hub, 5)));
+        check();
+        EXPECT_EQ(hub_entry(), base_entry);
+
+        // Growing the segment enough, forces a merge
+        for (std::size_t i = 0; i != 100; ++i, ++next_id) {
+            EXPECT_TRUE(graph.upsert_edge(make_edge(next_id, hub, next_id)));
+            expected.insert({hub, next_id, next_id});
+        }
+        check();
+        EXPECT_NE(hub_entry(), base_entry);
+
+        // Removals merge the segment
+        EXPECT_TRUE(graph.upsert_edge(make_edge(next_id, hub, next_id)));
+        EXPECT_TRUE(graph.remove_edge(make_edge(next_id, hub, next_id)));
+        EXPECT_TRUE(graph.remove_edge(make_edge(7, hub, 7)));
+        expected.erase({hub, 7, 7});
+        check();
+
+        auto visited = graph.traverse(strided_range(std::vector<ustore_key_t> {hub}).immutable(), 1).throw_or_release();
+        EXPECT_EQ(visited.size(), expected.size() + 1);
+
+        // Removed vertices leave no segments behind
+        for (std::size_t i = 0; i != 10; ++i, ++next_id)
+            EXPECT_TRUE(graph.upsert_edge(make_edge(next_id, hub, next_id)));
+        EXPECT_TRUE(graph.remove_vertex(hub));
+        EXPECT_FALSE(*graph.contains(hub));
+        EXPECT_EQ(graph.edges_containing(ustore_key_t(1)).throw_or_release().size(), 0ul);
+        expected.clear();
+        for (ustore_key_t i = 1; i <= static_cast<ustore_key_t>(initial_degree); ++i)
+            expected.insert({hub, i, i + 1});
+        std::vector<edge_t> renewed_edges;
+        for (auto [source, target, id] : expected)
+            renewed_edges.push_back(make_edge(id, source, target));
+        EXPECT_TRUE(graph.upsert_edges(edges(renewed_edges), encoding));
+        check();
+    }
 }
 
-std::vector<edge_t> make_edges(std::size_t vertices_count = 2, std::size_t next_connect = 1) {
-    std::vector<edge_t> es;
-    ustore_key_t edge_id = 0;
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        ustore_key_t connect_with = vertex_id + next_connect;
-        while (connect_with < vertices_count) {
-            edge_id++;
-            es.push_back(make_edge(edge_id, vertex_id, connect_with));
-            connect_with = connect_with + next_connect;
+/**
+ * Grows a vertex far beyond a small bucket limit, checking that it's split into buckets,
+ * that the neighborhood is stitched back in order, and that updates and removals are routed.
+ */
+TEST(db, graph_sharded_neighborhoods) {
+    for (ustore_graph_encoding_t encoding : {ustore_graph_encoding_plain_k, ustore_graph_encoding_packed_k}) {
+        clear_environment();
+        database_t db;
+        EXPECT_TRUE(db.open(config().c_str()));
+
+        graph_collection_t graph = db.main<graph_collection_t>();
+        blobs_collection_t blobs = db.main();
+        constexpr ustore_key_t hub = 0;
+        constexpr ustore_key_t targets_count = 1000;
+        constexpr ustore_key_t sources_count = 300;
+        constexpr ustore_vertex_degree_t max_bucket_degree = 64;
+
+        std::set<std::tuple<ustore_key_t, ustore_key_t, ustore_key_t>> expected;
+        std::vector<edge_t> initial_edges;
+        for (ustore_key_t i = 1; i <= targets_count; ++i)
+            initial_edges.push_back(make_edge(i, hub, i));
+        for (ustore_key_t i = 1; i <= sources_count; ++i)
+            initial_edges.push_back(make_edge(targets_count + i, targets_count + i, hub));
+        for (edge_t const& edge : initial_edges)
+            expected.insert({edge.source_id, edge.target_id, edge.id});
+        EXPECT_TRUE(graph.upsert_edges(edges(initial_edges), encoding, max_bucket_degree));
+
+        auto check = [&] {
+            auto found = *graph.edges_containing(hub);
+            ASSERT_EQ(found.size(), expected.size());
+            std::set<std::tuple<ustore_key_t, ustore_key_t, ustore_key_t>> found_set;
+            for (std::size_t i = 0; i != found.size(); ++i)
+                found_set.insert({found[i].source_id, found[i].target_id, found[i].id});
+            EXPECT_EQ(found_set, expected);
+            EXPECT_EQ(*graph.degree(hub), expected.size());
+
+            auto outgoing = *graph.edges_containing(hub, ustore_vertex_source_k);
+            for (std::size_t i = 1; i < outgoing.size(); ++i)
+                EXPECT_LT(outgoing[i - 1].target_id, outgoing[i].target_id);
+        };
+        auto hub_entry_size = [&] {
+            return std::string_view(*blobs[hub].value()).size();
+        };
+        check();
+        EXPECT_LT(hub_entry_size(), expected.size() * sizeof(edge_t) / 4);
+
+        // Point lookups only read the relevant bucket
+        auto between = *graph.edges_between(hub, 500);
+        ASSERT_EQ(between.size(), 1ul);
+        EXPECT_EQ(between[0].target_id, 500);
+        EXPECT_EQ(graph.edges_between(hub, targets_count + 1).throw_or_release().size(), 0ul);
+
+        // Appends and removals go into the buckets
+        ustore_key_t next_id = targets_count + sources_count + 1;
+        for (std::size_t i = 0; i != 200; ++i, ++next_id) {
+            ustore_key_t target = 2 * next_id;
+            EXPECT_TRUE(graph.upsert_edges(edges(std::vector<edge_t> {make_edge(next_id, hub, target)}), encoding, max_bucket_degree));
+            expected.insert({hub, target, next_id});
+        }
+        for (ustore_key_t i = 100; i != 400; ++i) {
+            EXPECT_TRUE(graph.remove_edge(make_edge(i, hub, i)));
+            expected.erase({hub, i, i});
         }
+        check();
+        EXPECT_EQ(graph.edges_between(hub, 200).throw_or_release().size(), 0ul);
+        EXPECT_EQ(graph.edges_between(hub, 2 * (next_id - 1)).throw_or_release().size(), 1ul);
+
+        auto visited = graph.traverse(strided_range(std::vector<ustore_key_t> {hub}).immutable(), 1).throw_or_release();
+        EXPECT_EQ(visited.size(), expected.size() + 1);
+
+        // Removing a neighbor cleans its bucket, and removing the hub cleans all of them
+        EXPECT_TRUE(graph.remove_vertex(ustore_key_t(10)));
+        expected.erase({hub, 10, 10});
+        check();
+        EXPECT_TRUE(graph.remove_vertex(hub));
+        EXPECT_FALSE(*graph.contains(hub));
+        EXPECT_EQ(graph.edges_containing(ustore_key_t(1)).throw_or_release().size(), 0ul);
+        EXPECT_EQ(graph.edges_containing(ustore_key_t(targets_count + 1)).throw_or_release().size(), 0ul);
+
+        expected.clear();
+        EXPECT_TRUE(graph.upsert_edges(edges(initial_edges), encoding, max_bucket_degree));
+        for (edge_t const& edge : initial_edges)
+            expected.insert({edge.source_id, edge.target_id, edge.id});
+        check();
     }
-    return es;
 }
 
 /**
- * Upserts disconnected vertices into the graph.
+ * Limits the neighbors of plain and split vertices from one side only,
+ * checking that the missing bound leaves that side of the range open.
  */
-TEST(db, graph_upsert_vertices) {
+TEST(db, graph_neighbors_half_ranges) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
-    std::vector<ustore_key_t> vertices {1, 4, 5, 2};
-    EXPECT_TRUE(net.upsert_vertices(vertices));
+    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr ustore_key_t hub = 0;
+    constexpr ustore_key_t small = 2000;
+    constexpr ustore_key_t targets_count = 1000;
+    constexpr ustore_vertex_degree_t max_bucket_degree = 64;
+    std::vector<edge_t> initial_edges;
+    for (ustore_key_t i = 1; i <= targets_count; ++i)
+        initial_edges.push_back(make_edge(i, hub, i));
+    for (ustore_key_t i = 1; i <= 10; ++i)
+        initial_edges.push_back(make_edge(targets_count + i, small, i * 100));
+    EXPECT_TRUE(graph.upsert_edges(edges(initial_edges), ustore_graph_encoding_plain_k, max_bucket_degree));
 
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_TRUE(*net.contains(4));
-    EXPECT_TRUE(*net.contains(5));
+    arena_t arena(db);
+    status_t status;
+    auto find = [&](ustore_key_t vertex, ustore_key_t const* min, ustore_key_t const* max) {
+        ustore_vertex_role_t role = ustore_vertex_source_k;
+        ustore_vertex_degree_t* degrees = nullptr;
+        ustore_key_t* found_edges = nullptr;
+        ustore_graph_find_edges_t find_edges {};
+        find_edges.db = db;
+        find_edges.error = status.member_ptr();
+        find_edges.arena = arena.member_ptr();
+        find_edges.tasks_count = 1;
+        find_edges.vertices = &vertex;
+        find_edges.roles = &role;
+        find_edges.neighbors_min = min;
+        find_edges.neighbors_max = max;
+        find_edges.degrees_per_vertex = &degrees;
+        find_edges.edges_per_vertex = &found_edges;
+        ustore_graph_find_edges(&find_edges);
+        EXPECT_TRUE(status);
+
+        std::vector<ustore_key_t> targets;
+        for (ustore_vertex_degree_t i = 0; status && i != degrees[0]; ++i)
+            targets.push_back(found_edges[i * 3 + 1]);
+        return targets;
+    };
+
+    ustore_key_t const lower = 901, upper = 40;
+    std::vector<ustore_key_t> above = find(hub, &lower, nullptr);
+    ASSERT_EQ(above.size(), 100ul);
+    EXPECT_EQ(above.front(), 901);
+    EXPECT_EQ(above.back(), 1000);
+    std::vector<ustore_key_t> below = find(hub, nullptr, &upper);
+    ASSERT_EQ(below.size(), 40ul);
+    EXPECT_EQ(below.front(), 1);
+    EXPECT_EQ(below.back(), 40);
+    EXPECT_EQ(find(hub, nullptr, nullptr).size(), static_cast<std::size_t>(targets_count));
+
+    EXPECT_EQ(find(small, &lower, nullptr), (std::vector<ustore_key_t> {1000}));
+    EXPECT_EQ(find(small, nullptr, &upper), (std::vector<ustore_key_t> {}));
+    EXPECT_EQ(find(small, nullptr, nullptr).size(), 10ul);
 }
 
 /**
- * Upserts an edge and its member vertices into the graph.
+ * Clears and drops a graph with split neighborhoods, checking that its buckets go with it,
+ * so that a recreated graph of the same name doesn't see the stale ones.
  */
-TEST(db, graph_upsert_edge) {
+TEST(db, graph_companions_dropped) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
-    edge_t edge {1, 2, 9};
-    EXPECT_TRUE(net.upsert_edge(edge));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(3));
-
-    auto neighbors = net.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 1);
-    EXPECT_EQ(neighbors[0], 2);
+    constexpr ustore_key_t hub = 0;
+    constexpr ustore_key_t targets_count = 1000;
+    constexpr ustore_vertex_degree_t max_bucket_degree = 64;
+    std::vector<edge_t> hub_edges;
+    for (ustore_key_t i = 1; i <= targets_count; ++i)
+        hub_edges.push_back(make_edge(i, hub, i));
+
+    graph_collection_t graph = *db.create<graph_collection_t>("hubs");
+    EXPECT_TRUE(graph.upsert_edges(edges(hub_edges), ustore_graph_encoding_plain_k, max_bucket_degree));
+    blobs_collection_t buckets = *db.find("hubs.buckets");
+    EXPECT_GT(buckets.size(), 0ul);
+
+    // Clearing keeps the collections, but empties both
+    EXPECT_TRUE(graph.clear());
+    EXPECT_TRUE(*db.contains("hubs.buckets"));
+    EXPECT_EQ(buckets.size(), 0ul);
+
+    EXPECT_TRUE(graph.upsert_edges(edges(hub_edges), ustore_graph_encoding_plain_k, max_bucket_degree));
+    EXPECT_TRUE(graph.remove());
+    EXPECT_FALSE(*db.contains("hubs.buckets"));
+
+    graph = *db.create<graph_collection_t>("hubs");
+    EXPECT_TRUE(graph.upsert_edge(make_edge(1, hub, 1)));
+    EXPECT_EQ(*graph.degree(hub), 1u);
+    EXPECT_TRUE(db.clear());
 }
 
 /**
- * Tests "Graphs" Modality, with on of the simplest network designs - a triangle.
- * Three vertices, three connections between them, forming 3 undirected, or 6 directed edges.
- * Tests edge upserts, existence checks, degree computation, vertex removals.
+ * Compares the server-side breadth-first traversal against a reference one,
+ * with and without fan-out limits, in every direction.
  */
-TEST(db, graph_triangle) {
-
+TEST(db, graph_traverse) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
-
-    // triangle
-    edge_t edge1 {1, 2, 9};
-    edge_t edge2 {2, 3, 10};
-    edge_t edge3 {3, 1, 11};
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    EXPECT_TRUE(net.upsert_edge(edge1));
-    EXPECT_TRUE(net.upsert_edge(edge2));
-    EXPECT_TRUE(net.upsert_edge(edge3));
+    constexpr std::size_t vertices_count = 500;
+    constexpr std::size_t edges_count = 1000;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<ustore_key_t> vertices_distribution(0, vertices_count - 1);
+    std::set<std::pair<ustore_key_t, ustore_key_t>> unique_pairs;
+    while (unique_pairs.size() != edges_count)
+        unique_pairs.insert({vertices_distribution(generator), vertices_distribution(generator)});
+
+    std::vector<edge_t> edges_vec;
+    std::vector<std::vector<ustore_key_t>> successors(vertices_count), predecessors(vertices_count);
+    for (auto [source, target] : unique_pairs) {
+        edges_vec.push_back(make_edge(static_cast<ustore_key_t>(edges_vec.size()), source, target));
+        successors[source].push_back(target);
+        predecessors[target].push_back(source);
+    }
+    for (auto& ids : predecessors)
+        std::sort(ids.begin(), ids.end());
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-    auto neighbors = net.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
-    EXPECT_EQ(neighbors[0], 2);
-    EXPECT_EQ(neighbors[1], 3);
+    auto reference = [&](std::vector<ustore_key_t> frontier, std::size_t hops, ustore_vertex_role_t role, std::size_t fanout) {
+        std::sort(frontier.begin(), frontier.end());
+        frontier.erase(std::unique(frontier.begin(), frontier.end()), frontier.end());
+        std::set<ustore_key_t> visited(frontier.begin(), frontier.end());
+        std::vector<ustore_key_t> result = frontier;
+        for (std::size_t hop = 0; hop != hops; ++hop) {
+            std::set<ustore_key_t> discovered;
+            for (ustore_key_t vertex : frontier) {
+                if (vertex >= static_cast<ustore_key_t>(vertices_count))
+                    continue;
+                std::vector<ustore_key_t> neighbors;
+                if (role & ustore_vertex_source_k)
+                    neighbors.insert(neighbors.end(), successors[vertex].begin(), successors[vertex].end());
+                if (role & ustore_vertex_target_k)
+                    neighbors.insert(neighbors.end(), predecessors[vertex].begin(), predecessors[vertex].end());
+                if (fanout && neighbors.size() > fanout)
+                    neighbors.resize(fanout);
+                for (ustore_key_t neighbor : neighbors)
+                    if (!visited.count(neighbor))
+                        discovered.insert(neighbor);
+            }
+            frontier.assign(discovered.begin(), discovered.end());
+            visited.insert(frontier.begin(), frontier.end());
+            result.insert(result.end(), frontier.begin(), frontier.end());
+        }
+        return result;
+    };
 
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(9));
-    EXPECT_FALSE(*net.contains(10));
-    EXPECT_FALSE(*net.contains(1000));
+    std::vector<ustore_key_t> sources {7, 3, 7, 42};
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k, ustore_vertex_role_any_k})
+        for (std::size_t hops : {0, 1, 2, 4})
+            for (std::size_t fanout : {0, 1, 3}) {
+                auto visited = graph.traverse(strided_range(sources).immutable(), hops, role, fanout).throw_or_release();
+                auto expected = reference(sources, hops, role, fanout);
+                EXPECT_EQ(std::vector<ustore_key_t>(visited.begin(), visited.end()), expected);
+            }
 
-    EXPECT_EQ(*net.degree(1), 2u);
-    EXPECT_EQ(*net.degree(2), 2u);
-    EXPECT_EQ(*net.degree(3), 2u);
-    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+    // Offsets split the visited vertices by hops, missing vertices are kept only as sources
+    status_t status;
+    arena_t arena(db);
+    ustore_key_t const traversed_sources[] = {7, static_cast<ustore_key_t>(vertices_count * 2)};
+    ustore_key_t* visited = nullptr;
+    ustore_size_t visited_count = 0;
+    ustore_length_t* offsets = nullptr;
+    ustore_graph_traverse_t graph_traverse {};
+    graph_traverse.db = db;
+    graph_traverse.error = status.member_ptr();
+    graph_traverse.arena = arena.member_ptr();
+    graph_traverse.sources_count = 2;
+    graph_traverse.sources = traversed_sources;
+    graph_traverse.sources_stride = sizeof(ustore_key_t);
+    graph_traverse.role = ustore_vertex_source_k;
+    graph_traverse.hops = 3;
+    graph_traverse.visited = &visited;
+    graph_traverse.visited_count = &visited_count;
+    graph_traverse.offsets_per_hop = &offsets;
+    ustore_graph_traverse(&graph_traverse);
+    EXPECT_TRUE(status);
 
-    EXPECT_TRUE(net.edges_containing(1));
-    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+    std::vector<ustore_key_t> expected_sources {traversed_sources[0], traversed_sources[1]};
+    EXPECT_EQ(std::vector<ustore_key_t>(visited, visited + visited_count), reference(expected_sources, 3, ustore_vertex_source_k, 0));
+    EXPECT_EQ(offsets[0], 0u);
+    EXPECT_EQ(offsets[1], 2u);
+    EXPECT_EQ(offsets[2], 2u + successors[7].size());
+    EXPECT_EQ(offsets[4], visited_count);
+}
 
-    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
-    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+/**
+ * Exports a random graph, larger than a single read batch, in the CSR format,
+ * comparing it against the per-vertex lookups, and checking that the exports
+ * of disjoint key ranges concatenate into the full one.
+ */
+TEST(db, graph_export_csr) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Check scans
-    EXPECT_TRUE(net.edges());
-    {
-        std::vector<edge_t> expected_edges {edge1, edge2, edge3};
-        std::vector<edge_t> exported_edges;
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-        auto present_edges = *net.edges(ustore_vertex_source_k);
-        auto present_it = std::move(present_edges).begin();
-        auto count_results = 0;
-        while (!present_it.is_end()) {
-            exported_edges.push_back(*present_it);
-            ++present_it;
-            ++count_results;
+    constexpr std::size_t vertices_count = 5000;
+    constexpr std::size_t edges_count = 10000;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<ustore_key_t> vertices_distribution(0, vertices_count - 1);
+    std::vector<edge_t> edges_vec;
+    for (std::size_t i = 0; i != edges_count; ++i)
+        edges_vec.push_back(
+            make_edge(static_cast<ustore_key_t>(i), vertices_distribution(generator), vertices_distribution(generator)));
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    ustore_key_t const isolated = vertices_count * 2;
+    EXPECT_TRUE(graph.upsert_vertex(isolated));
+
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k, ustore_vertex_role_any_k}) {
+        arena_t arena(db);
+        graph_collection_t exporting(db, ustore_collection_main_k, nullptr, {}, arena.member_ptr());
+        graph_csr_t csr = exporting.export_csr(role).throw_or_release();
+        ASSERT_EQ(csr.offsets.size(), csr.vertices.size() + 1);
+        EXPECT_EQ(csr.offsets[0], 0u);
+        EXPECT_TRUE(std::is_sorted(csr.vertices.begin(), csr.vertices.end()));
+        EXPECT_EQ(csr.vertices[csr.vertices.size() - 1], isolated);
+
+        std::size_t total = 0;
+        for (std::size_t i = 0; i != csr.vertices.size(); ++i) {
+            // Outgoing edges come before the incoming ones
+            std::size_t outgoing_count = role & ustore_vertex_source_k //
+                                             ? *graph.degree(csr.vertices[i], ustore_vertex_source_k)
+                                             : 0;
+            auto expected = graph.edges_containing(csr.vertices[i], role).throw_or_release();
+            ASSERT_EQ(csr.offsets[i + 1] - csr.offsets[i], expected.size());
+            for (std::size_t j = 0; j != expected.size(); ++j) {
+                ustore_key_t neighbor = j < outgoing_count ? expected[j].target_id : expected[j].source_id;
+                EXPECT_EQ(csr.neighbors[csr.offsets[i] + j], neighbor);
+                EXPECT_EQ(csr.edges[csr.offsets[i] + j], expected[j].id);
+            }
+            total += expected.size();
         }
-        EXPECT_EQ(count_results, 3);
-        EXPECT_EQ(exported_edges, expected_edges);
+        EXPECT_EQ(csr.neighbors.size(), total);
+
+        // Disjoint ranges match the full export
+        arena_t lower_arena(db), upper_arena(db);
+        graph_collection_t lower_graph(db, ustore_collection_main_k, nullptr, {}, lower_arena.member_ptr());
+        graph_collection_t upper_graph(db, ustore_collection_main_k, nullptr, {}, upper_arena.member_ptr());
+        ustore_key_t const split = vertices_count / 2;
+        auto min_key = std::numeric_limits<ustore_key_t>::min();
+        auto max_key = std::numeric_limits<ustore_key_t>::max();
+        graph_csr_t lower = lower_graph.export_csr(role, false, min_key, split - 1).throw_or_release();
+        graph_csr_t upper = upper_graph.export_csr(role, false, split, max_key).throw_or_release();
+        EXPECT_EQ(lower.vertices.size() + upper.vertices.size(), csr.vertices.size());
+        EXPECT_EQ(lower.edges.size(), 0ul);
+        std::vector<ustore_key_t> joined(lower.neighbors.begin(), lower.neighbors.end());
+        joined.insert(joined.end(), upper.neighbors.begin(), upper.neighbors.end());
+        EXPECT_EQ(joined, std::vector<ustore_key_t>(csr.neighbors.begin(), csr.neighbors.end()));
+        EXPECT_EQ(*upper.vertices.begin(), csr.vertices[lower.vertices.size()]);
     }
+}
 
-    // Remove a single edge, making sure that the nodes info persists
-    EXPECT_TRUE(net.remove_edges({
-        {{&edge1.source_id}, 1},
-        {{&edge1.target_id}, 1},
-        {{&edge1.id}, 1},
-    }));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
-
-    // Bring that edge back
-    EXPECT_TRUE(net.upsert_edges({
-        {{&edge1.source_id}, 1},
-        {{&edge1.target_id}, 1},
-        {{&edge1.id}, 1},
-    }));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+/**
+ * Checks that degrees, parsed from the headers, match the exported neighborhoods
+ * for plain, packed, sharded vertices and vertices with delta segments.
+ */
+TEST(db, graph_export_degrees) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Remove a vertex
-    ustore_key_t vertex_to_remove = 2;
-    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
-    EXPECT_FALSE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+    graph_collection_t graph = db.main<graph_collection_t>();
 
-    // Bring back the whole graph
-    EXPECT_TRUE(net.upsert_edge(edge1));
-    EXPECT_TRUE(net.upsert_edge(edge2));
-    EXPECT_TRUE(net.upsert_edge(edge3));
-    EXPECT_TRUE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+    constexpr std::size_t vertices_count = 2000;
+    constexpr std::size_t edges_count = 4000;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<ustore_key_t> vertices_distribution(0, vertices_count - 1);
+    std::vector<edge_t> edges_vec;
+    for (std::size_t i = 0; i != edges_count; ++i)
+        edges_vec.push_back(
+            make_edge(static_cast<ustore_key_t>(i), vertices_distribution(generator), vertices_distribution(generator)));
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec), ustore_graph_encoding_packed_k));
+
+    // The first hub gets a delta segment, the second one is split into buckets
+    ustore_key_t next_id = edges_count;
+    ustore_key_t const delta_hub = vertices_count * 2, sharded_hub = delta_hub + 1;
+    std::vector<edge_t> hub_edges;
+    for (ustore_key_t i = 0; i != 1000; ++i, ++next_id)
+        hub_edges.push_back(make_edge(next_id, delta_hub, i));
+    EXPECT_TRUE(graph.upsert_edges(edges(hub_edges)));
+    for (ustore_key_t i = 0; i != 10; ++i, ++next_id)
+        EXPECT_TRUE(graph.upsert_edge(make_edge(next_id, delta_hub, vertices_count + i)));
+    hub_edges.clear();
+    for (ustore_key_t i = 0; i != 1000; ++i, ++next_id)
+        hub_edges.push_back(make_edge(next_id, i, sharded_hub));
+    EXPECT_TRUE(graph.upsert_edges(edges(hub_edges), ustore_graph_encoding_plain_k, 100));
+
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k, ustore_vertex_role_any_k}) {
+        arena_t arena(db);
+        graph_collection_t exporting(db, ustore_collection_main_k, nullptr, {}, arena.member_ptr());
+        graph_csr_t degrees = exporting.export_degrees(role).throw_or_release();
+        ASSERT_EQ(degrees.offsets.size(), degrees.vertices.size() + 1);
+        EXPECT_TRUE(degrees.neighbors.empty());
+        for (std::size_t i = 0; i != degrees.vertices.size(); ++i) {
+            auto expected = graph.edges_containing(degrees.vertices[i], role).throw_or_release();
+            ASSERT_EQ(degrees.offsets[i + 1] - degrees.offsets[i], expected.size());
+        }
+        EXPECT_EQ(*graph.degree(delta_hub, ustore_vertex_source_k), 1010u);
+        EXPECT_EQ(*graph.degree(sharded_hub, ustore_vertex_target_k), 1000u);
+    }
 }
 
 /**
- * Further complicates the `graph_triangle` test by performing all of the updates
- * and lookups in batches. This detects inconsistencies in concurrent updates to
- * the underlying binary representation, triggered from a single high-level
- * graph operation.
+ * Checks PageRank, weakly connected components and triangle counting on a small graph,
+ * with repeated edges, self-loops and isolated vertices, in one and in many threads.
  */
-TEST(db, graph_triangle_batch) {
-
+TEST(db, graph_algorithms) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    blobs_collection_t main = db.main();
-    graph_collection_t net = db.main<graph_collection_t>();
-
-    std::vector<edge_t> triangle {
-        {1, 2, 9},
-        {2, 3, 10},
-        {3, 1, 11},
+    graph_collection_t graph = db.main<graph_collection_t>();
+    std::vector<edge_t> edges_vec {
+        make_edge(1, 1, 2),
+        make_edge(2, 2, 3),
+        make_edge(3, 3, 1),
+        make_edge(4, 1, 2),
+        make_edge(5, 2, 1),
+        make_edge(6, 3, 4),
+        make_edge(7, 10, 11),
+        make_edge(8, 11, 11),
     };
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    EXPECT_TRUE(graph.upsert_vertex(20));
+    std::vector<ustore_key_t> const vertices {1, 2, 3, 4, 10, 11, 20};
+
+    arena_t single_arena(db), parallel_arena(db);
+    graph_collection_t single(db, ustore_collection_main_k, nullptr, {}, single_arena.member_ptr());
+    graph_collection_t parallel(db, ustore_collection_main_k, nullptr, {}, parallel_arena.member_ptr());
+
+    graph_components_t components = single.components().throw_or_release();
+    EXPECT_EQ(std::vector<ustore_key_t>(components.vertices.begin(), components.vertices.end()), vertices);
+    std::vector<ustore_key_t> labels(components.components.begin(), components.components.end());
+    EXPECT_EQ(labels, (std::vector<ustore_key_t> {1, 1, 1, 1, 10, 10, 20}));
+    EXPECT_EQ(components.count, 3u);
+
+    graph_triangles_t triangles = single.triangles().throw_or_release();
+    EXPECT_EQ(std::vector<ustore_size_t>(triangles.triangles.begin(), triangles.triangles.end()),
+              (std::vector<ustore_size_t> {1, 1, 1, 0, 0, 0, 0}));
+    EXPECT_EQ(triangles.count, 1u);
+
+    graph_ranks_t ranks = single.pagerank().throw_or_release();
+    ASSERT_EQ(ranks.ranks.size(), vertices.size());
+    EXPECT_NEAR(std::accumulate(ranks.ranks.begin(), ranks.ranks.end(), 0.0), 1.0, 1e-4);
+    EXPECT_GT(ranks.iterations, 0u);
+    EXPECT_LT(ranks.ranks[6], ranks.ranks[0]);
+
+    // Chunks are processed in a different order, but the results match
+    graph_ranks_t parallel_ranks = parallel.pagerank(4).throw_or_release();
+    for (std::size_t i = 0; i != vertices.size(); ++i)
+        EXPECT_NEAR(parallel_ranks.ranks[i], ranks.ranks[i], 1e-6);
+    graph_components_t parallel_components = parallel.components(4).throw_or_release();
+    EXPECT_TRUE(std::equal(labels.begin(), labels.end(), parallel_components.components.begin()));
+    EXPECT_EQ(parallel.triangles(4).throw_or_release().count, 1u);
+}
 
-    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(9));
-    EXPECT_FALSE(*net.contains(10));
-    EXPECT_FALSE(*net.contains(1000));
-
-    EXPECT_EQ(*net.degree(1), 2u);
-    EXPECT_EQ(*net.degree(2), 2u);
-    EXPECT_EQ(*net.degree(3), 2u);
-    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+#pragma region Vectors Modality
 
-    EXPECT_TRUE(net.edges_containing(1));
-    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+/**
+ * Random vectors with components in [-1, 1] under consecutive keys starting from one,
+ * shared by the tests of vector search.
+ */
+struct random_vectors_t {
+    std::size_t dimensions = 0;
+    std::vector<ustore_key_t> keys;
+    std::vector<float> vectors;
+
+    random_vectors_t(std::size_t dimensions, std::size_t count)
+        : dimensions(dimensions), keys(count), vectors(count * dimensions) {
+        std::iota(keys.begin(), keys.end(), 1);
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> distribution(-1, 1);
+        std::generate(vectors.begin(), vectors.end(), [&] { return distribution(generator); });
+    }
 
-    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
-    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+    /**
+     * Writes `count` vectors starting from the `first` one, or all of them by default,
+     * reporting the outcome in `status`.
+     */
+    void write(database_t& db,
+               arena_t& arena,
+               status_t& status,
+               ustore_vector_metric_t metric,
+               std::size_t first = 0,
+               std::size_t count = std::numeric_limits<std::size_t>::max(),
+               ustore_collection_t collection = ustore_collection_main_k,
+               ustore_vector_quantization_t quantization = ustore_vector_quantization_i8_k) {
+        float const* vector_first_begin = vectors.data() + first * dimensions;
+        ustore_vectors_write_t write {};
+        write.db = db;
+        write.arena = arena.member_ptr();
+        write.error = status.member_ptr();
+        write.dimensions = static_cast<ustore_length_t>(dimensions);
+        write.metric = metric;
+        write.quantization = quantization;
+        write.collections = &collection;
+        write.keys = keys.data() + first;
+        write.keys_stride = sizeof(ustore_key_t);
+        write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+        write.vectors_stride = sizeof(float) * dimensions;
+        write.tasks_count = std::min(count, keys.size() - first);
+        ustore_vectors_write(&write);
+    }
+};
 
-    // Check scans
-    EXPECT_TRUE(net.edges());
-    {
-        std::vector<edge_t> expected_edges {triangle.begin(), triangle.end()};
-        std::vector<edge_t> exported_edges;
+/**
+ * Compares every SIMD distance kernel, supported by the current CPU, against the serial baseline,
+ * on lengths that aren't multiples of the vector width, to cover the masked and scalar tails.
+ */
+TEST(db, vectors_distance_kernels) {
+    std::size_t lengths[] = {1, 3, 7, 15, 17, 31, 33, 63, 65, 100, 767, 1537};
+    std::size_t max_length = *std::max_element(std::begin(lengths), std::end(lengths));
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<std::int8_t> i8s(max_length * 2);
+    std::vector<float> f32s(max_length * 2);
+    std::vector<f16_bits_t> f16s(max_length * 2);
+    std::vector<std::uint8_t> b1s(max_length * 2);
+    for (std::size_t i = 0; i != max_length * 2; ++i) {
+        f32s[i] = distribution(generator);
+        i8s[i] = static_cast<std::int8_t>(f32s[i] * 127);
+        f16s[i] = f32_to_f16(f32s[i]);
+        b1s[i] = static_cast<std::uint8_t>(generator());
+    }
 
-        auto present_edges = *net.edges(ustore_vertex_source_k);
-        auto present_it = std::move(present_edges).begin();
-        size_t count_results = 0ul;
-        while (!present_it.is_end()) {
-            exported_edges.push_back(*present_it);
-            ++present_it;
-            ++count_results;
+    auto expect_near = [](float expected, float found, std::size_t length) {
+        EXPECT_NEAR(expected, found, 1e-4f * length + 1e-4f * std::abs(expected)) << "length " << length;
+    };
+    distance_kernels_t serial = distance_kernels_for(simd_isa_t::serial_k);
+    simd_isa_t isas[] = {simd_isa_t::avx2_k, simd_isa_t::avx512_k, simd_isa_t::neon_k, simd_isa_t::sve_k};
+    for (simd_isa_t isa : isas) {
+        if (!simd_isa_supported(isa))
+            continue;
+        distance_kernels_t kernels = distance_kernels_for(isa);
+        SCOPED_TRACE(kernels.name);
+        for (std::size_t length : lengths) {
+            std::int8_t const* i8_a = i8s.data();
+            std::int8_t const* i8_b = i8s.data() + max_length;
+            EXPECT_EQ(kernels.i8_dot(i8_a, i8_b, length), serial.i8_dot(i8_a, i8_b, length)) << "length " << length;
+            EXPECT_EQ(kernels.i8_l2_squared(i8_a, i8_b, length), serial.i8_l2_squared(i8_a, i8_b, length))
+                << "length " << length;
+            i8_dot_and_norms_t i8_found = kernels.i8_dot_and_norms(i8_a, i8_b, length);
+            i8_dot_and_norms_t i8_expected = serial.i8_dot_and_norms(i8_a, i8_b, length);
+            EXPECT_EQ(i8_found.ab, i8_expected.ab) << "length " << length;
+            EXPECT_EQ(i8_found.aa, i8_expected.aa) << "length " << length;
+            EXPECT_EQ(i8_found.bb, i8_expected.bb) << "length " << length;
+
+            float const* f32_a = f32s.data();
+            float const* f32_b = f32s.data() + max_length;
+            expect_near(serial.f32_dot(f32_a, f32_b, length), kernels.f32_dot(f32_a, f32_b, length), length);
+            expect_near(serial.f32_l2_squared(f32_a, f32_b, length),
+                        kernels.f32_l2_squared(f32_a, f32_b, length),
+                        length);
+            f32_dot_and_norms_t f32_found = kernels.f32_dot_and_norms(f32_a, f32_b, length);
+            f32_dot_and_norms_t f32_expected = serial.f32_dot_and_norms(f32_a, f32_b, length);
+            expect_near(f32_expected.ab, f32_found.ab, length);
+            expect_near(f32_expected.aa, f32_found.aa, length);
+            expect_near(f32_expected.bb, f32_found.bb, length);
+
+            f16_bits_t const* f16_a = f16s.data();
+            f16_bits_t const* f16_b = f16s.data() + max_length;
+            expect_near(serial.f16_dot(f16_a, f16_b, length), kernels.f16_dot(f16_a, f16_b, length), length);
+            expect_near(serial.f16_l2_squared(f16_a, f16_b, length),
+                        kernels.f16_l2_squared(f16_a, f16_b, length),
+                        length);
+            f32_dot_and_norms_t f16_found = kernels.f16_dot_and_norms(f16_a, f16_b, length);
+            f32_dot_and_norms_t f16_expected = serial.f16_dot_and_norms(f16_a, f16_b, length);
+            expect_near(f16_expected.ab, f16_found.ab, length);
+            expect_near(f16_expected.aa, f16_found.aa, length);
+            expect_near(f16_expected.bb, f16_found.bb, length);
+
+            std::uint8_t const* b1_a = b1s.data();
+            std::uint8_t const* b1_b = b1s.data() + max_length;
+            EXPECT_EQ(kernels.b1_hamming(b1_a, b1_b, length), serial.b1_hamming(b1_a, b1_b, length))
+                << "length " << length;
         }
-        EXPECT_EQ(count_results, triangle.size());
-        EXPECT_EQ(exported_edges, expected_edges);
     }
+}
 
-    // Remove a single edge, making sure that the nodes info persists
-    EXPECT_TRUE(net.remove_edges(edges_view_t {
-        {{&triangle[0].source_id}, 1},
-        {{&triangle[0].target_id}, 1},
-        {{&triangle[0].id}, 1},
-    }));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+/**
+ * Tests "Vector Modality", including both CRUD and more analytical approximate search
+ * operations with just three distinctly different vectors in R3 space with Cosine metric.
+ */
+TEST(db, vectors) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t dims_k = 3;
+    ustore_key_t keys[3] = {'a', 'b', 'c'};
+    float vectors[3][dims_k] = {
+        {0.3, 0.1, 0.2},
+        {0.35, 0.1, 0.2},
+        {-0.1, 0.2, 0.5},
+    };
 
-    // Bring that edge back
-    EXPECT_TRUE(net.upsert_edges(edges_view_t {
-        {{&triangle[0].source_id}, 1},
-        {{&triangle[0].target_id}, 1},
-        {{&triangle[0].id}, 1},
-    }));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+    arena_t arena(db);
+    status_t status;
 
-    // Remove a vertex
-    ustore_key_t vertex_to_remove = 2;
-    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
-    EXPECT_FALSE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = 3;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    // Bring back the whole graph
-    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
-    EXPECT_TRUE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+    ustore_length_t max_results = 2;
+    ustore_length_t* found_results = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_distances = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = 1;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    search.queries_stride = sizeof(float) * dims_k;
+    search.match_counts = &found_results;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_distances;
+    search.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    EXPECT_EQ(found_results[0], max_results);
+    EXPECT_EQ(found_keys[0], ustore_key_t('a'));
+    EXPECT_EQ(found_keys[1], ustore_key_t('b'));
 }
 
 /**
- * Tries to make a transaction on a graph, that must fail to `commit`.
- * Creates a "wedge": A-B-C. If a transaction changes the B-C edge,
- * while A-B is updated externally, the commit will fail.
+ * Reads vectors back as a dense matrix, both in the type they were written in
+ * and converted into other scalar types, zero-filling missing rows.
  */
-TEST(db, graph_transaction_watch) {
-    if (!ustore_supports_transactions_k)
-        return;
-
+TEST(db, vectors_read) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    graph_collection_t net = db.main<graph_collection_t>();
 
-    edge_t edge_ab {'A', 'B', 19};
-    edge_t edge_bc {'B', 'C', 31};
-    EXPECT_TRUE(net.upsert_edge(edge_ab));
-    EXPECT_TRUE(net.upsert_edge(edge_bc));
+    constexpr std::size_t dims_k = 3;
+    ustore_key_t keys[3] = {'a', 'b', 'c'};
+    float vectors[3][dims_k] = {
+        {0.5, -1.25, 2},
+        {4, 0.125, -8},
+        {-16, 32, 0.25},
+    };
 
-    transaction_t txn = *db.transact();
-    graph_collection_t txn_net = txn.main<graph_collection_t>();
-    EXPECT_EQ(txn_net.degree('B'), 2);
-    EXPECT_TRUE(txn_net.remove_edge(edge_bc));
-    EXPECT_TRUE(net.remove_edge(edge_ab));
+    arena_t arena(db);
+    status_t status;
 
-    EXPECT_FALSE(txn.commit());
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = 3;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    ustore_key_t requested_keys[4] = {'c', 'a', 'z', 'b'};
+    std::size_t requested_rows[4] = {2, 0, 3, 1};
+    ustore_octet_t* found_presences = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_byte_t* found_vectors = nullptr;
+    ustore_vectors_read_t read {};
+    read.db = db;
+    read.arena = arena.member_ptr();
+    read.error = status.member_ptr();
+    read.dimensions = dims_k;
+    read.tasks_count = 4;
+    read.keys = requested_keys;
+    read.keys_stride = sizeof(ustore_key_t);
+    read.presences = &found_presences;
+    read.offsets = &found_offsets;
+    read.vectors = &found_vectors;
+
+    read.scalar_type = ustore_vector_scalar_f32_k;
+    ustore_vectors_read(&read);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(found_presences[0], 0b1011);
+    for (std::size_t i = 0; i != 4; ++i) {
+        EXPECT_EQ(found_offsets[i], i * dims_k * sizeof(float));
+        float const* row = reinterpret_cast<float const*>(found_vectors) + i * dims_k;
+        for (std::size_t j = 0; j != dims_k; ++j)
+            EXPECT_EQ(row[j], requested_rows[i] < 3 ? vectors[requested_rows[i]][j] : 0.f);
+    }
+
+    read.scalar_type = ustore_vector_scalar_f64_k;
+    ustore_vectors_read(&read);
+    EXPECT_TRUE(status);
+    for (std::size_t i = 0; i != 4; ++i) {
+        double const* row = reinterpret_cast<double const*>(found_vectors) + i * dims_k;
+        for (std::size_t j = 0; j != dims_k; ++j)
+            EXPECT_EQ(row[j], requested_rows[i] < 3 ? vectors[requested_rows[i]][j] : 0.);
+    }
+
+    read.scalar_type = ustore_vector_scalar_i8_k;
+    ustore_vectors_read(&read);
+    EXPECT_TRUE(status);
+    std::int8_t const* row = reinterpret_cast<std::int8_t const*>(found_vectors);
+    EXPECT_EQ(row[0], -16);
+    EXPECT_EQ(row[1], 32);
+    EXPECT_EQ(row[dims_k * 2], 0);
 }
 
 /**
- * Constructs a larger graph, validating the degrees in a resulting network afterward.
+ * Builds the HNSW index incrementally over several batches and checks,
+ * that every stored vector is found as its own closest neighbor.
  */
-TEST(db, graph_random_fill) {
+TEST(db, vectors_index) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 512;
+    constexpr std::size_t batch_size_k = 64;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    arena_t arena(db);
+    status_t status;
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_EQ(*graph.degree(vertex_id), 9u);
+    for (std::size_t batch_start = 0; batch_start != count_k; batch_start += batch_size_k) {
+        dataset.write(db, arena, status, ustore_vector_metric_l2_k, batch_start, batch_size_k);
+        EXPECT_TRUE(status);
+    }
+
+    for (std::size_t query_idx = 0; query_idx < count_k; query_idx += 7) {
+        float* query_begin = vectors.data() + query_idx * dims_k;
+        ustore_length_t max_results = 5;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_l2_k;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+
+        EXPECT_EQ(found_results[0], max_results);
+        EXPECT_EQ(found_keys[0], keys[query_idx]);
+        EXPECT_TRUE(std::is_sorted(found_distances, found_distances + found_results[0]));
     }
 }
 
 /**
- * Inserts two edges with a shared vertex in two separate transactions.
- * The latter insert must fail, as it depends on the preceding state of the vertex.
+ * Drops a collection of vectors and recreates it with vectors of other dimensions,
+ * checking that the index is dropped with it, rather than picked up by the new collection.
  */
-TEST(db, graph_conflicting_transactions) {
-    if (!ustore_supports_transactions_k)
+TEST(db, vectors_index_dropped) {
+    if (!ustore_supports_named_collections_k)
         return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    transaction_t txn = *db.transact();
-    graph_collection_t txn_net = txn.main<graph_collection_t>();
-    transaction_t txn2 = *db.transact();
-    graph_collection_t txn_net2 = txn2.main<graph_collection_t>();
+    arena_t arena(db);
+    status_t status;
+    auto search_self = [&](random_vectors_t& dataset, std::size_t idx, ustore_collection_t collection) {
+        float const* query_begin = dataset.vectors.data() + idx * dataset.dimensions;
+        ustore_length_t max_results = 1;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = static_cast<ustore_length_t>(dataset.dimensions);
+        search.tasks_count = 1;
+        search.collections = &collection;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dataset.dimensions;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.metric = ustore_vector_metric_l2_k;
+        ustore_vectors_search(&search);
+        return status && found_results[0] && found_keys[0] == dataset.keys[idx];
+    };
 
-    edge_t edge4 {4, 5, 15};
-    edge_t edge5 {5, 6, 16};
+    random_vectors_t wide(16, 300);
+    blobs_collection_t collection = *db.create("vectors");
+    wide.write(db, arena, status, ustore_vector_metric_l2_k, 0, 300, collection);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(*db.contains("vectors.hnsw"));
+    EXPECT_TRUE(search_self(wide, 10, collection));
 
-    EXPECT_TRUE(txn_net.upsert_edge(edge4));
-    EXPECT_TRUE(txn_net2.upsert_edge(edge5));
-    EXPECT_TRUE(txn.commit());
-    EXPECT_FALSE(txn2.commit());
+    // Clearing empties the index, but keeps it
+    EXPECT_TRUE(collection.clear());
+    EXPECT_TRUE(*db.contains("vectors.hnsw"));
+    EXPECT_EQ(db.find("vectors.hnsw")->size(), 0ul);
+
+    EXPECT_TRUE(collection.drop());
+    EXPECT_FALSE(*db.contains("vectors.hnsw"));
+
+    random_vectors_t narrow(4, 300);
+    collection = *db.create("vectors");
+    narrow.write(db, arena, status, ustore_vector_metric_l2_k, 0, 300, collection);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(search_self(narrow, 10, collection));
+    EXPECT_TRUE(db.clear());
 }
 
-/**
- * Takes a single Graph Store and populates it with various 5-vertex shapes:
- * a star, a pentagon, and five self-loops.
- */
-TEST(db, graph_layering_shapes) {
+TEST(db, vectors_batch_search) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 3000;
+    constexpr std::size_t queries_count_k = 32;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
-    std::vector<ustore_key_t> vertices = {1, 2, 3, 4, 5};
-    auto over_the_vertices = [&](bool exist, size_t degree) {
-        for (auto& vertex_id : vertices) {
-            EXPECT_EQ(*graph.contains(vertex_id), exist);
-            EXPECT_EQ(*graph.degree(vertex_id), degree);
-        }
-    };
+    arena_t arena(db);
+    status_t status;
 
-    // Before insertions, the graph is empty.
-    over_the_vertices(false, 0);
+    dataset.write(db, arena, status, ustore_vector_metric_l2_k);
+    EXPECT_TRUE(status);
 
-    std::vector<edge_t> star {
-        {1, 3, 1},
-        {1, 4, 2},
-        {2, 4, 3},
-        {2, 5, 4},
-        {3, 5, 5},
-    };
-    std::vector<edge_t> pentagon {
-        {1, 2, 6},
-        {2, 3, 7},
-        {3, 4, 8},
-        {4, 5, 9},
-        {5, 1, 10},
-    };
-    std::vector<edge_t> self_loops {
-        {1, 1, 11},
-        {2, 2, 12},
-        {3, 3, 13},
-        {4, 4, 14},
-        {5, 5, 15},
+    // The index is built for L2, so searching by cosine similarity scans the whole collection
+    auto search = [&](std::size_t first_query, std::size_t queries_count, std::size_t threads_count) {
+        float* query_begin = vectors.data() + first_query * dims_k;
+        ustore_length_t max_results = 5;
+        ustore_length_t* found_results = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_metrics = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = queries_count;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_offsets = &found_offsets;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_metrics;
+        search.metric = ustore_vector_metric_cos_k;
+        search.threads_count = threads_count;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+
+        std::vector<std::vector<ustore_key_t>> results(queries_count);
+        for (std::size_t i = 0; i != queries_count; ++i) {
+            EXPECT_EQ(found_results[i], max_results);
+            EXPECT_EQ(found_keys[found_offsets[i]], keys[first_query + i]);
+            EXPECT_TRUE(std::is_sorted(found_metrics + found_offsets[i],
+                                       found_metrics + found_offsets[i] + found_results[i],
+                                       std::greater<ustore_float_t> {}));
+            results[i].assign(found_keys + found_offsets[i], found_keys + found_offsets[i] + found_results[i]);
+        }
+        return results;
     };
 
-    EXPECT_TRUE(graph.upsert_edges(edges(star)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.remove_edges(edges(star)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(star)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.upsert_edges(edges(self_loops)));
-    over_the_vertices(true, 6u);
-    EXPECT_TRUE(graph.remove_edges(edges(star)));
-    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.remove_edges(edges(self_loops)));
-    over_the_vertices(true, 0);
-    EXPECT_TRUE(db.clear());
-    over_the_vertices(false, 0);
+    auto batched = search(0, queries_count_k, 1);
+    auto parallel = search(0, queries_count_k, 4);
+    for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+        auto single = search(query_idx, 1, 1);
+        EXPECT_EQ(batched[query_idx], single[0]);
+        EXPECT_EQ(parallel[query_idx], single[0]);
+    }
 }
 
-/**
- * Tests vertex removals, which are the hardest operations on Graphs,
- * as they trigger updates in all nodes connected to the removed one.
- */
-TEST(db, graph_remove_vertices) {
+TEST(db, vectors_rerank) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 2000;
+    constexpr std::size_t queries_count_k = 100;
+    constexpr std::size_t max_results_k = 10;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    arena_t arena(db);
+    status_t status;
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
-        EXPECT_TRUE(graph.remove_vertex(vertex_id));
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_FALSE(*graph.contains(vertex_id));
-    }
+    dataset.write(db, arena, status, ustore_vector_metric_cos_k);
+    EXPECT_TRUE(status);
 
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
-    std::vector<ustore_key_t> vertices(vertices_count);
-    std::iota(vertices.begin(), vertices.end(), 0);
-    EXPECT_TRUE(graph.remove_vertices(vertices));
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_FALSE(*graph.contains(vertex_id));
+    auto cos = [&](float const* a, float const* b) {
+        float ab = 0, aa = 0, bb = 0;
+        for (std::size_t i = 0; i != dims_k; ++i)
+            ab += a[i] * b[i], aa += a[i] * a[i], bb += b[i] * b[i];
+        return ab / (std::sqrt(aa) * std::sqrt(bb));
+    };
+
+    float* query_begin = vectors.data();
+    ustore_length_t max_results = max_results_k;
+    ustore_length_t* found_results = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_metrics = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = queries_count_k;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+    search.queries_stride = sizeof(float) * dims_k;
+    search.match_counts = &found_results;
+    search.match_offsets = &found_offsets;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_metrics;
+    search.metric = ustore_vector_metric_cos_k;
+    search.oversampling = 4;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    // Re-ranked metrics must be exact and match the brute-force results
+    std::size_t recalled = 0;
+    for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+        float const* query = vectors.data() + query_idx * dims_k;
+        EXPECT_EQ(found_results[query_idx], max_results_k);
+        EXPECT_EQ(found_keys[found_offsets[query_idx]], keys[query_idx]);
+
+        std::vector<std::pair<float, ustore_key_t>> exact(count_k);
+        for (std::size_t i = 0; i != count_k; ++i)
+            exact[i] = {cos(query, vectors.data() + i * dims_k), keys[i]};
+        std::partial_sort(exact.begin(), exact.begin() + max_results_k, exact.end(), std::greater<> {});
+
+        for (std::size_t j = 0; j != found_results[query_idx]; ++j) {
+            ustore_key_t key = found_keys[found_offsets[query_idx] + j];
+            float metric = found_metrics[found_offsets[query_idx] + j];
+            EXPECT_NEAR(metric, cos(query, vectors.data() + (key - 1) * dims_k), 1e-5);
+            recalled += std::any_of(exact.begin(), exact.begin() + max_results_k, [&](auto const& match) {
+                return match.second == key;
+            });
+        }
     }
+    EXPECT_GE(recalled, queries_count_k * max_results_k * 99 / 100);
 }
 
 /**
- * Removes just the known list of edges, checking that vertices remain
- * in the graph, even though entirely disconnected.
+ * Re-ranks the matches of integer vectors and checks, that their exact metrics
+ * are in the same units, as the ones of floating-point vectors with the same components.
  */
-TEST(db, graph_remove_edges_keep_vertices) {
+TEST(db, vectors_rerank_integers) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 500;
+    constexpr std::size_t queries_count_k = 20;
+    constexpr std::size_t max_results_k = 5;
+    std::vector<ustore_key_t> keys(count_k);
+    std::iota(keys.begin(), keys.end(), 1);
+    std::vector<std::int8_t> vectors(count_k * dims_k);
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(-1, 1);
+    std::generate(vectors.begin(), vectors.end(), [&] { return static_cast<std::int8_t>(distribution(generator)); });
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
-    EXPECT_TRUE(graph.remove_edges(edges(edges_vec)));
+    arena_t arena(db);
+    status_t status;
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
+    std::int8_t const* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.scalar_type = ustore_vector_scalar_i8_k;
+    write.metric = ustore_vector_metric_l2_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = dims_k;
+    write.tasks_count = count_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    auto l2 = [&](std::int8_t const* a, std::int8_t const* b) {
+        float sum = 0;
+        for (std::size_t i = 0; i != dims_k; ++i)
+            sum += (float(a[i]) - float(b[i])) * (float(a[i]) - float(b[i]));
+        return std::sqrt(sum);
+    };
+
+    std::int8_t const* query_begin = vectors.data();
+    ustore_length_t max_results = max_results_k;
+    ustore_length_t* found_results = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_metrics = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.scalar_type = ustore_vector_scalar_i8_k;
+    search.tasks_count = queries_count_k;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+    search.queries_stride = dims_k;
+    search.match_counts = &found_results;
+    search.match_offsets = &found_offsets;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_metrics;
+    search.metric = ustore_vector_metric_l2_k;
+    search.oversampling = 4;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+        std::int8_t const* query = vectors.data() + query_idx * dims_k;
+        EXPECT_EQ(found_results[query_idx], max_results_k);
+        for (std::size_t j = 0; j != found_results[query_idx]; ++j) {
+            ustore_key_t key = found_keys[found_offsets[query_idx] + j];
+            float metric = found_metrics[found_offsets[query_idx] + j];
+            EXPECT_NEAR(metric, l2(query, vectors.data() + (key - 1) * dims_k), 1e-5);
+        }
     }
 }
+
 /**
- * Add edges to the graph. Checks how many edges each vertex has.
- * Then remove the edges, making sure that the vertices aren't
- * connected to each other anymore.
+ * Checks that every quantization scheme finds the exact neighbors,
+ * once the coarse matches are re-ranked using the original vectors.
+ * Sign bits are the coarsest, so they need the largest oversampling.
  */
-TEST(db, graph_get_vertex_edges) {
+TEST(db, vectors_quantization) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 64;
+    constexpr std::size_t count_k = 1000;
+    constexpr std::size_t queries_count_k = 50;
+    constexpr std::size_t max_results_k = 10;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
+
+    auto cos = [&](float const* a, float const* b) {
+        float ab = 0, aa = 0, bb = 0;
+        for (std::size_t i = 0; i != dims_k; ++i)
+            ab += a[i] * b[i], aa += a[i] * a[i], bb += b[i] * b[i];
+        return ab / (std::sqrt(aa) * std::sqrt(bb));
+    };
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    arena_t arena(db);
+    status_t status;
+    ustore_vector_quantization_t schemes[] = {
+        ustore_vector_quantization_i8_k,
+        ustore_vector_quantization_i8_scaled_k,
+        ustore_vector_quantization_pq4_k,
+        ustore_vector_quantization_b1_k,
+    };
+    for (ustore_vector_quantization_t scheme : schemes) {
+        blobs_collection_t collection = *db.create(std::to_string(scheme).c_str());
+        ustore_collection_t collection_id = collection;
 
-    std::vector<edge_t> received_edges;
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        auto es = *graph.edges_containing(vertex_id);
-        EXPECT_EQ(es.size(), 9u);
-        for (size_t i = 0; i != es.size(); ++i)
-            received_edges.push_back(es[i]);
-    }
-    EXPECT_TRUE(graph.remove_edges(edges(received_edges)));
+        dataset.write(db, arena, status, ustore_vector_metric_cos_k, 0, count_k, collection_id, scheme);
+        EXPECT_TRUE(status);
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
-        EXPECT_EQ(graph.edges_containing(vertex_id)->size(), 0);
+        float* query_begin = vectors.data();
+        ustore_length_t max_results = max_results_k;
+        ustore_length_t* found_results = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_metrics = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = queries_count_k;
+        search.collections = &collection_id;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_offsets = &found_offsets;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_metrics;
+        search.metric = ustore_vector_metric_cos_k;
+        search.oversampling = scheme == ustore_vector_quantization_b1_k ? 32 : 4;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+
+        std::size_t recalled = 0;
+        for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+            float const* query = vectors.data() + query_idx * dims_k;
+            EXPECT_EQ(found_results[query_idx], max_results_k);
+            EXPECT_EQ(found_keys[found_offsets[query_idx]], keys[query_idx]);
+
+            std::vector<std::pair<float, ustore_key_t>> exact(count_k);
+            for (std::size_t i = 0; i != count_k; ++i)
+                exact[i] = {cos(query, vectors.data() + i * dims_k), keys[i]};
+            std::partial_sort(exact.begin(), exact.begin() + max_results_k, exact.end(), std::greater<> {});
+
+            for (std::size_t j = 0; j != found_results[query_idx]; ++j) {
+                ustore_key_t key = found_keys[found_offsets[query_idx] + j];
+                recalled += std::any_of(exact.begin(), exact.begin() + max_results_k, [&](auto const& match) {
+                    return match.second == key;
+                });
+            }
+        }
+        EXPECT_GE(recalled, queries_count_k * max_results_k * 9 / 10);
     }
 }
 
 /**
- * Getting the degrees of multiple vertices simultaneously.
+ * Writes product-quantized vectors in batches, smaller than the minimal training sample,
+ * checking that they are searchable before the codebooks are trained and indexed after.
+ * Queries of other dimensions than the index are rejected.
  */
-TEST(db, graph_degrees) {
+TEST(db, vectors_quantization_training) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 32;
+    constexpr std::size_t count_k = 512;
+    constexpr std::size_t batch_k = 40;
+    constexpr std::size_t max_results_k = 5;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
-    constexpr std::size_t vertices_count = 1000;
-    std::vector<ustore_key_t> vertices(vertices_count);
-    std::iota(vertices.begin(), vertices.end(), 0);
+    arena_t arena(db);
+    status_t status;
+    blobs_collection_t collection = *db.create("pq");
+    ustore_collection_t collection_id = collection;
+    auto search_first = [&](std::size_t queries_count, ustore_length_t dims) {
+        float* query_begin = vectors.data();
+        ustore_length_t max_results = max_results_k;
+        ustore_length_t* found_results = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_metrics = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims;
+        search.tasks_count = queries_count;
+        search.collections = &collection_id;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_offsets = &found_offsets;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_metrics;
+        search.metric = ustore_vector_metric_cos_k;
+        search.oversampling = 4;
+        ustore_vectors_search(&search);
+
+        std::size_t found_self = 0;
+        for (std::size_t query_idx = 0; status && query_idx != queries_count; ++query_idx)
+            found_self += found_results[query_idx] && found_keys[found_offsets[query_idx]] == keys[query_idx];
+        return found_self;
+    };
 
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    for (std::size_t batch_begin = 0; batch_begin < count_k; batch_begin += batch_k) {
+        std::size_t batch_count = std::min(batch_k, count_k - batch_begin);
+        dataset.write(db,
+                      arena,
+                      status,
+                      ustore_vector_metric_cos_k,
+                      batch_begin,
+                      batch_count,
+                      collection_id,
+                      ustore_vector_quantization_pq4_k);
+        EXPECT_TRUE(status);
 
-    auto degrees = *graph.degrees(strided_range(vertices).immutable());
-    EXPECT_EQ(degrees.size(), vertices_count);
+        // Until the codebooks are trained, the collection is searched exhaustively
+        std::size_t written_count = batch_begin + batch_count;
+        EXPECT_EQ(search_first(std::min<std::size_t>(written_count, batch_k), dims_k),
+                  std::min<std::size_t>(written_count, batch_k));
+        EXPECT_TRUE(status);
+    }
+    EXPECT_GE(search_first(count_k, dims_k), count_k * 9 / 10);
+    EXPECT_TRUE(status);
+
+    search_first(1, dims_k / 2);
+    EXPECT_FALSE(status);
+    status.release_error();
 }
 
-TEST(db, graph_neighbors) {
+/**
+ * Filters the matches with allow-lists of keys, both short ones, that are compared
+ * exhaustively, and long ones, that are applied while traversing the index.
+ */
+TEST(db, vectors_filtered_search) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
-    edge_t edge1 {1, 1, 17};
-    edge_t edge2 {1, 2, 15};
-    edge_t edge3 {2, 3, 16};
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 6000;
+    constexpr std::size_t queries_count_k = 50;
+    constexpr std::size_t max_results_k = 10;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
-    EXPECT_TRUE(graph.upsert_edge(edge1));
-    EXPECT_TRUE(graph.upsert_edge(edge2));
-    EXPECT_TRUE(graph.upsert_edge(edge3));
+    arena_t arena(db);
+    status_t status;
 
-    auto neighbors = graph.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
-    EXPECT_EQ(neighbors[0], 1);
-    EXPECT_EQ(neighbors[1], 2);
+    dataset.write(db, arena, status, ustore_vector_metric_l2_k);
+    EXPECT_TRUE(status);
 
-    neighbors = graph.neighbors(2).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
-    EXPECT_EQ(neighbors[0], 1);
-    EXPECT_EQ(neighbors[1], 3);
-}
+    auto l2 = [&](float const* a, float const* b) {
+        float sum = 0;
+        for (std::size_t i = 0; i != dims_k; ++i)
+            sum += (a[i] - b[i]) * (a[i] - b[i]);
+        return sum;
+    };
 
-#pragma region Vectors Modality
+    for (std::size_t period : {2, 50}) {
+        std::vector<ustore_key_t> allowed;
+        for (ustore_key_t key : keys)
+            if (key % period == 0)
+                allowed.push_back(key);
+
+        float* query_begin = vectors.data();
+        ustore_length_t max_results = max_results_k;
+        ustore_length_t* found_results = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_metrics = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = queries_count_k;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_offsets = &found_offsets;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_metrics;
+        search.metric = ustore_vector_metric_l2_k;
+        search.allowed_keys = allowed.data();
+        search.allowed_keys_count = allowed.size();
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
 
-/**
- * Tests "Vector Modality", including both CRUD and more analytical approximate search
- * operations with just three distinctly different vectors in R3 space with Cosine metric.
- */
-TEST(db, vectors) {
+        std::size_t recalled = 0;
+        for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+            float const* query = vectors.data() + query_idx * dims_k;
+            EXPECT_EQ(found_results[query_idx], max_results_k);
+            if (keys[query_idx] % period == 0)
+                EXPECT_EQ(found_keys[found_offsets[query_idx]], keys[query_idx]);
+
+            std::vector<std::pair<float, ustore_key_t>> exact;
+            for (ustore_key_t key : allowed)
+                exact.emplace_back(l2(query, vectors.data() + (key - 1) * dims_k), key);
+            std::partial_sort(exact.begin(), exact.begin() + max_results_k, exact.end());
+
+            for (std::size_t j = 0; j != found_results[query_idx]; ++j) {
+                ustore_key_t key = found_keys[found_offsets[query_idx] + j];
+                EXPECT_EQ(key % period, 0);
+                recalled += std::any_of(exact.begin(), exact.begin() + max_results_k, [&](auto const& match) {
+                    return match.second == key;
+                });
+            }
+        }
+        EXPECT_GE(recalled, queries_count_k * max_results_k * 9 / 10);
+    }
+
+    // An empty allow-list filters out everything
+    ustore_key_t nothing = 0;
+    float* query_begin = vectors.data();
+    ustore_length_t max_results = max_results_k;
+    ustore_length_t* found_results = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = 1;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+    search.queries_stride = sizeof(float) * dims_k;
+    search.match_counts = &found_results;
+    search.metric = ustore_vector_metric_l2_k;
+    search.allowed_keys = &nothing;
+    search.allowed_keys_count = 0;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(found_results[0], 0u);
+}
+
+TEST(db, vectors_disk_index) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    constexpr std::size_t dims_k = 3;
-    ustore_key_t keys[3] = {'a', 'b', 'c'};
-    float vectors[3][dims_k] = {
-        {0.3, 0.1, 0.2},
-        {0.35, 0.1, 0.2},
-        {-0.1, 0.2, 0.5},
-    };
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 2000;
+    constexpr std::size_t queries_count_k = 50;
+    constexpr std::size_t max_results_k = 10;
+    random_vectors_t dataset(dims_k, count_k);
+    std::vector<ustore_key_t>& keys = dataset.keys;
+    std::vector<float>& vectors = dataset.vectors;
 
     arena_t arena(db);
     status_t status;
 
-    float* vector_first_begin = &vectors[0][0];
-    ustore_vectors_write_t write {};
-    write.db = db;
-    write.arena = arena.member_ptr();
-    write.error = status.member_ptr();
-    write.dimensions = dims_k;
-    write.keys = keys;
-    write.keys_stride = sizeof(ustore_key_t);
-    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
-    write.vectors_stride = sizeof(float) * dims_k;
-    write.tasks_count = 3;
-    ustore_vectors_write(&write);
+    dataset.write(db, arena, status, ustore_vector_metric_l2_k);
     EXPECT_TRUE(status);
 
-    ustore_length_t max_results = 2;
+    std::string index_path = (std::filesystem::temp_directory_path() / "ustore_vectors.vamana").string();
+    ustore_vectors_index_build_t build {};
+    build.db = db;
+    build.error = status.member_ptr();
+    build.arena = arena.member_ptr();
+    build.dimensions = dims_k;
+    build.metric = ustore_vector_metric_l2_k;
+    build.quantization = ustore_vector_quantization_i8_scaled_k;
+    build.path = index_path.c_str();
+    ustore_vectors_index_build(&build);
+    EXPECT_TRUE(status);
+
+    ustore_vectors_index_t index = nullptr;
+    ustore_vectors_index_open_t open {};
+    open.error = status.member_ptr();
+    open.path = index_path.c_str();
+    open.index = &index;
+    ustore_vectors_index_open(&open);
+    EXPECT_TRUE(status);
+    EXPECT_NE(index, nullptr);
+
+    float* query_begin = vectors.data();
+    ustore_length_t max_results = max_results_k;
     ustore_length_t* found_results = nullptr;
+    ustore_length_t* found_offsets = nullptr;
     ustore_key_t* found_keys = nullptr;
-    ustore_float_t* found_distances = nullptr;
+    ustore_float_t* found_metrics = nullptr;
     ustore_vectors_search_t search {};
     search.db = db;
     search.arena = arena.member_ptr();
     search.error = status.member_ptr();
     search.dimensions = dims_k;
-    search.tasks_count = 1;
+    search.tasks_count = queries_count_k;
     search.match_counts_limits = &max_results;
-    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
     search.queries_stride = sizeof(float) * dims_k;
     search.match_counts = &found_results;
+    search.match_offsets = &found_offsets;
     search.match_keys = &found_keys;
-    search.match_metrics = &found_distances;
-    search.metric = ustore_vector_metric_cos_k;
+    search.match_metrics = &found_metrics;
+    search.metric = ustore_vector_metric_l2_k;
+    search.disk_index = index;
     ustore_vectors_search(&search);
     EXPECT_TRUE(status);
 
-    EXPECT_EQ(found_results[0], max_results);
-    EXPECT_EQ(found_keys[0], ustore_key_t('a'));
-    EXPECT_EQ(found_keys[1], ustore_key_t('b'));
+    for (std::size_t query_idx = 0; query_idx != queries_count_k; ++query_idx) {
+        EXPECT_EQ(found_results[query_idx], max_results_k);
+        EXPECT_EQ(found_keys[found_offsets[query_idx]], keys[query_idx]);
+        ustore_float_t const* metrics = found_metrics + found_offsets[query_idx];
+        EXPECT_TRUE(std::is_sorted(metrics, metrics + found_results[query_idx]));
+    }
+
+    // The index only serves the metric it was built for
+    search.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_search(&search);
+    EXPECT_FALSE(status);
+    status.release_error();
+
+    ustore_vectors_index_free(index);
+    std::filesystem::remove(index_path);
+}
+
+#pragma region Replication
+
+/**
+ * The change log retains the most recent batches within its capacity, numbering them consecutively,
+ * and tells the readers, when the batches they need were already evicted.
+ */
+TEST(db, change_log_eviction) {
+    constexpr std::uint64_t origin_k = 42;
+    change_log_t log(1024, origin_k);
+    EXPECT_TRUE(log.enabled());
+    auto make_changes = [](ustore_key_t key, std::size_t length) {
+        std::vector<change_t> changes;
+        changes.push_back({change_kind_t::write_k, ustore_collection_main_k, key, 0, std::string(length, 'x')});
+        return changes;
+    };
+    for (ustore_key_t key = 0; key != 100; ++key)
+        EXPECT_EQ(log.append(make_changes(key, 100)), static_cast<ustore_sequence_number_t>(key + 1));
+
+    change_log_t::usage_t usage = log.usage();
+    EXPECT_EQ(usage.head, 100ul);
+    EXPECT_LE(usage.used_bytes, 1024ul);
+    EXPECT_GT(usage.batches, 1ul);
+    EXPECT_LT(usage.batches, 100ul);
+    EXPECT_EQ(usage.oldest + usage.batches, usage.head + 1);
+
+    // Readers can continue from any retained batch, but not from the evicted ones
+    EXPECT_FALSE(log.since(usage.oldest - 2, 10, {}));
+    EXPECT_FALSE(log.continues(origin_k, usage.oldest - 2));
+    EXPECT_TRUE(log.continues(origin_k, usage.oldest - 1));
+    EXPECT_TRUE(log.continues(origin_k, usage.head));
+    EXPECT_FALSE(log.continues(origin_k, usage.head + 1));
+    EXPECT_FALSE(log.continues(origin_k, 0));
+    EXPECT_FALSE(log.continues(origin_k + 1, usage.head));
+
+    auto batches = log.since(usage.oldest - 1, 3, {});
+    ASSERT_TRUE(batches);
+    ASSERT_EQ(batches->size(), 3ul);
+    for (std::size_t i = 0; i != batches->size(); ++i) {
+        EXPECT_EQ((*batches)[i]->sequence, usage.oldest + i);
+        EXPECT_EQ((*batches)[i]->changes.front().key, static_cast<ustore_key_t>(usage.oldest + i - 1));
+    }
+    auto tail = log.since(usage.head - 1, 10, {});
+    ASSERT_TRUE(tail);
+    EXPECT_EQ(tail->size(), 1ul);
+    auto none = log.since(usage.head, 10, std::chrono::milliseconds(1));
+    ASSERT_TRUE(none);
+    EXPECT_TRUE(none->empty());
+
+    // A batch, larger than the whole capacity, is retained alone
+    ustore_sequence_number_t large_sequence = log.append(make_changes(0, 4096));
+    EXPECT_EQ(log.usage().batches, 1ul);
+    EXPECT_FALSE(log.since(large_sequence - 2, 10, {}));
+    EXPECT_EQ(log.since(large_sequence - 1, 10, {})->size(), 1ul);
+
+    // Waiting readers are woken up by appends
+    std::thread appender([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        log.append(make_changes(1, 10));
+    });
+    auto woken = log.since(large_sequence, 10, std::chrono::seconds(10));
+    appender.join();
+    ASSERT_TRUE(woken);
+    ASSERT_EQ(woken->size(), 1ul);
+    EXPECT_EQ(woken->front()->sequence, large_sequence + 1);
+}
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+static std::string replica_config() {
+    if (!path())
+        return {};
+    std::string replica_path = path();
+    while (replica_path.size() > 1 && replica_path.back() == '/')
+        replica_path.pop_back();
+    replica_path += "_replica/";
+    std::filesystem::remove_all(replica_path);
+    std::filesystem::create_directories(replica_path);
+    return fmt::format(R"({{"version": "1.0", "directory": "{}"}})", replica_path);
+}
+
+using pairs_by_names_t = std::map<std::string, std::map<ustore_key_t, std::string>>;
+
+static pairs_by_names_t dump_pairs(database_t& db) {
+    pairs_by_names_t dump;
+    auto dump_collection = [&](std::string const& name, ustore_collection_t collection) {
+        std::map<ustore_key_t, std::string>& pairs = dump[name];
+        pairs_stream_t stream(db, collection);
+        EXPECT_TRUE(stream.seek_to_first());
+        for (; !stream.is_end(); ++stream) {
+            value_view_t value = stream.value();
+            pairs.emplace(stream.key(), std::string(reinterpret_cast<char const*>(value.begin()), value.size()));
+        }
+    };
+    dump_collection("", ustore_collection_main_k);
+    context_t context {db};
+    auto maybe_cols = context.collections();
+    EXPECT_TRUE(maybe_cols);
+    auto cols = *maybe_cols;
+    for (std::size_t i = 0; !cols.names.is_end(); ++cols.names, ++i)
+        dump_collection(std::string(*cols.names), cols.ids[i]);
+    return dump;
+}
+
+/**
+ * Writes or removes a value and logs it, like the Flight server with a change log.
+ */
+static void write_logged(database_t& db,
+                         change_log_t& log,
+                         ustore_collection_t collection,
+                         ustore_key_t key,
+                         std::optional<std::string> value) {
+    blobs_collection_t blobs(db, collection);
+    if (value)
+        EXPECT_TRUE(blobs[key].assign(value->c_str()));
+    else
+        EXPECT_TRUE(blobs[key].erase());
+    std::vector<change_t> changes;
+    changes.push_back({change_kind_t::write_k, collection, key, 0, std::move(value)});
+    log.append(std::move(changes));
+}
+
+static ustore_collection_t create_logged(database_t& db, change_log_t& log, std::string const& name) {
+    blobs_collection_t blobs = *db.create(name.c_str());
+    ustore_collection_t collection = *blobs.member_ptr();
+    std::vector<change_t> changes;
+    changes.push_back({change_kind_t::create_k, collection, 0, 0, name});
+    log.append(std::move(changes));
+    return collection;
+}
+
+/**
+ * Brings the replica up to the head of the `log`, like the replicas of the Flight server,
+ * copying the whole `primary` first, if it can't continue from `since` in the `origin` log.
+ */
+static void follow_primary(database_t& primary,
+                           change_log_t& log,
+                           changes_applier_t& applier,
+                           std::uint64_t& origin,
+                           ustore_sequence_number_t& since) {
+    if (!log.continues(origin, since)) {
+        changes_copier_t copier(primary, log.head(), 16);
+        change_batch_t batch;
+        while (!copier.finished()) {
+            EXPECT_TRUE(copier.next(batch));
+            EXPECT_TRUE(applier.apply(batch));
+        }
+        since = copier.mark();
+        origin = log.origin();
+    }
+    auto batches = log.since(since, std::numeric_limits<std::size_t>::max(), {});
+    ASSERT_TRUE(batches);
+    for (change_batch_ptr_t const& batch : *batches) {
+        EXPECT_TRUE(applier.apply(*batch));
+        since = batch->sequence;
+    }
+}
+
+/**
+ * Copies a database, while it is being modified, and then replays the log from the mark of the copy.
+ * The replica must converge to the primary, even if some changes were both copied and replayed.
+ */
+TEST(db, replication_copy_handoff) {
+    clear_environment();
+    database_t primary;
+    EXPECT_TRUE(primary.open(config().c_str()));
+    database_t replica;
+    EXPECT_TRUE(replica.open(replica_config().c_str()));
+
+    change_log_t log(1 << 20, 1);
+    ustore_collection_t named = create_logged(primary, log, "named");
+    for (ustore_key_t key = 0; key != 100; ++key) {
+        write_logged(primary, log, ustore_collection_main_k, key, std::to_string(key));
+        write_logged(primary, log, named, key, "named " + std::to_string(key));
+    }
+
+    changes_applier_t applier(replica);
+    changes_copier_t copier(primary, log.head(), 16);
+    EXPECT_EQ(copier.mark(), 201ul);
+
+    // Created after the mark, but before the collections are listed, so it is both copied and replayed
+    ustore_collection_t late = create_logged(primary, log, "late");
+    write_logged(primary, log, late, 1, "late");
+
+    change_batch_t batch;
+    std::size_t parts = 0;
+    while (!copier.finished()) {
+        EXPECT_TRUE(copier.next(batch));
+        EXPECT_TRUE(applier.apply(batch));
+        EXPECT_EQ(batch.sequence, copier.finished() ? copier.mark() : 0);
+        if (parts++ != 1)
+            continue;
+
+        // Change the pairs, that were already copied, as well as those, that weren't yet
+        write_logged(primary, log, ustore_collection_main_k, 5, "changed");
+        write_logged(primary, log, ustore_collection_main_k, 95, "changed");
+        write_logged(primary, log, named, 7, std::nullopt);
+        write_logged(primary, log, ustore_collection_main_k, 1000, "added");
+    }
+    EXPECT_GT(parts, 3ul);
+    EXPECT_NE(dump_pairs(primary), dump_pairs(replica));
+
+    std::uint64_t origin = log.origin();
+    ustore_sequence_number_t since = copier.mark();
+    follow_primary(primary, log, applier, origin, since);
+    EXPECT_EQ(since, log.head());
+    EXPECT_EQ(dump_pairs(primary), dump_pairs(replica));
+
+    // Afterwards, the replica just tails the log
+    write_logged(primary, log, late, 2, "later");
+    write_logged(primary, log, ustore_collection_main_k, 0, std::nullopt);
+    follow_primary(primary, log, applier, origin, since);
+    EXPECT_EQ(dump_pairs(primary), dump_pairs(replica));
+    EXPECT_EQ(dump_pairs(replica)["late"].size(), 2ul);
+}
+
+/**
+ * After a restart, the sequence numbers of the primary start over, with a new origin.
+ * The replica must not continue from its old position, but copy the primary again,
+ * dropping its own stale data, even if the new log has reached the same position.
+ */
+TEST(db, replication_primary_restart) {
+    clear_environment();
+    database_t primary;
+    EXPECT_TRUE(primary.open(config().c_str()));
+    database_t replica;
+    EXPECT_TRUE(replica.open(replica_config().c_str()));
+
+    bool empty = false;
+    EXPECT_TRUE(database_is_empty(replica, empty));
+    EXPECT_TRUE(empty);
+
+    change_log_t first_log(1 << 20, 1);
+    ustore_collection_t named = create_logged(primary, first_log, "named");
+    for (ustore_key_t key = 0; key != 10; ++key)
+        write_logged(primary, first_log, named, key, std::to_string(key));
+
+    changes_applier_t applier(replica);
+    std::uint64_t origin = 0;
+    ustore_sequence_number_t since = 0;
+    follow_primary(primary, first_log, applier, origin, since);
+    EXPECT_EQ(origin, 1ul);
+    EXPECT_EQ(since, first_log.head());
+    EXPECT_EQ(dump_pairs(primary), dump_pairs(replica));
+    EXPECT_TRUE(database_is_empty(replica, empty));
+    EXPECT_FALSE(empty);
+
+    // The primary restarts and changes, before the replica reconnects
+    change_log_t second_log(1 << 20, 2);
+    EXPECT_TRUE(primary.drop("named"));
+    for (ustore_key_t key = 0; key != 20; ++key)
+        write_logged(primary, second_log, ustore_collection_main_k, key, "restarted");
+    EXPECT_GE(second_log.head(), since);
+    EXPECT_TRUE(second_log.continues(2, since));
+    EXPECT_FALSE(second_log.continues(origin, since));
+
+    follow_primary(primary, second_log, applier, origin, since);
+    EXPECT_EQ(origin, 2ul);
+    EXPECT_EQ(since, second_log.head());
+    EXPECT_EQ(dump_pairs(primary), dump_pairs(replica));
+    EXPECT_FALSE(*replica.contains("named"));
+}
+
+#endif
+
+#pragma region Sharding
+
+/**
+ * Places keys on a ring of servers, checking that the placement is stable, roughly balanced,
+ * and that removing a server only moves the keys it owned.
+ */
+TEST(db, sharding_ring) {
+    std::vector<std::string> names {"grpc://a:38709", "grpc://b:38709", "grpc://c:38709", "grpc://d:38709"};
+    std::vector<std::string> fewer_names {names[0], names[1], names[3]};
+    shard_ring_t ring(names);
+    shard_ring_t same_ring(names);
+    shard_ring_t fewer_ring(fewer_names);
+    EXPECT_EQ(ring.size(), 4u);
+
+    constexpr ustore_key_t keys_count = 10000;
+    std::vector<std::size_t> counts(names.size());
+    for (ustore_key_t key = 0; key != keys_count; ++key) {
+        std::size_t shard = ring.shard(key);
+        ASSERT_LT(shard, names.size());
+        EXPECT_EQ(shard, same_ring.shard(key));
+        ++counts[shard];
+
+        std::string const& fewer_name = fewer_names[fewer_ring.shard(key)];
+        if (shard != 2)
+            EXPECT_EQ(fewer_name, names[shard]) << "key " << key;
+    }
+    for (std::size_t count : counts) {
+        EXPECT_GT(count, keys_count / 8);
+        EXPECT_LT(count, keys_count / 2);
+    }
+}
+
+/**
+ * Routes a batch of reads between simulated shards, that answer their parts in order,
+ * checking that the merged outputs come back in the order of tasks of the whole batch.
+ */
+TEST(db, sharding_merged_reads) {
+    shard_ring_t ring({"a", "b", "c"});
+    std::vector<ustore_key_t> keys(300);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    auto is_missing = [](ustore_key_t key) { return key % 7 == 3; };
+    auto value_of = [](ustore_key_t key) { return key % 5 ? "value-" + std::to_string(key) : std::string(); };
+
+    std::vector<std::size_t> routes, rows;
+    route_keys(ring, keys.size(), [&](std::size_t i) { return keys[i]; }, routes, rows);
+
+    // Every shard answers its own tasks, in the order they were routed
+    std::vector<std::vector<ustore_length_t>> offsets(ring.size()), lengths(ring.size());
+    std::vector<std::vector<ustore_byte_t>> tapes(ring.size());
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        std::size_t shard = routes[i];
+        ASSERT_EQ(rows[i], lengths[shard].size());
+        std::string value = value_of(keys[i]);
+        offsets[shard].push_back(static_cast<ustore_length_t>(tapes[shard].size()));
+        lengths[shard].push_back(is_missing(keys[i]) ? ustore_length_missing_k : value.size());
+        if (!is_missing(keys[i]))
+            tapes[shard].insert(tapes[shard].end(), value.begin(), value.end());
+    }
+    std::vector<ustore_length_t*> shards_offsets, shards_lengths;
+    std::vector<ustore_byte_t*> shards_values;
+    for (std::size_t shard = 0; shard != ring.size(); ++shard) {
+        ASSERT_FALSE(lengths[shard].empty());
+        shards_offsets.push_back(offsets[shard].data());
+        shards_lengths.push_back(lengths[shard].data());
+        shards_values.push_back(tapes[shard].data());
+    }
+
+    merged_reads_t merged;
+    merged.routes = routes.data();
+    merged.rows = rows.data();
+    merged.offsets = shards_offsets.data();
+    merged.lengths = shards_lengths.data();
+    merged.values = shards_values.data();
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        EXPECT_EQ(merged.present(i), !is_missing(keys[i])) << "key " << keys[i];
+        if (merged.present(i))
+            EXPECT_EQ(merged.value(i), value_view_t(value_of(keys[i]))) << "key " << keys[i];
+    }
+}
+
+/**
+ * Merges the sorted keys, that several shards found for the same scans,
+ * checking that every task keeps just the smallest keys within its limit.
+ */
+TEST(db, sharding_merged_scans) {
+    // Two tasks, answered by three shards, one of which returned nothing
+    std::vector<ustore_key_t> first_keys {1, 4, 9, 20, 21};
+    std::vector<ustore_length_t> first_offsets {0, 3, 5};
+    std::vector<ustore_key_t> second_keys {2, 3, 10, 25, 30, 31};
+    std::vector<ustore_length_t> second_offsets {0, 3, 6};
+    ustore_length_t* shards_offsets[] = {first_offsets.data(), nullptr, second_offsets.data()};
+    ustore_key_t* shards_keys[] = {first_keys.data(), nullptr, second_keys.data()};
+    ustore_length_t limits[] = {4, 10};
+
+    std::vector<ustore_key_t> keys;
+    std::vector<ustore_length_t> offsets;
+    merge_scans(2, 3, shards_offsets, shards_keys, limits, keys, offsets);
+    EXPECT_EQ(keys, (std::vector<ustore_key_t> {1, 2, 3, 4, 20, 21, 25, 30, 31}));
+    EXPECT_EQ(offsets, (std::vector<ustore_length_t> {0, 4, 9}));
+}
+
+/**
+ * Matches the named collections, listed by three shards, by names,
+ * checking that collections missing on any of the shards are skipped.
+ */
+TEST(db, sharding_collections_by_names) {
+    auto pack = [](std::vector<std::string> const& names, std::string& tape, std::vector<ustore_length_t>& offsets) {
+        for (std::string const& name : names) {
+            offsets.push_back(static_cast<ustore_length_t>(tape.size()));
+            tape.append(name).push_back('\0');
+        }
+    };
+    std::string tapes[3];
+    std::vector<ustore_length_t> offsets[3];
+    pack({"users", "posts", "likes"}, tapes[0], offsets[0]);
+    pack({"likes", "users", "posts"}, tapes[1], offsets[1]);
+    pack({"posts", "users"}, tapes[2], offsets[2]);
+    std::vector<ustore_collection_t> ids[3] = {{10, 11, 12}, {22, 20, 21}, {31, 30}};
+
+    ustore_size_t counts[] = {3, 3, 2};
+    ustore_collection_t* shards_ids[] = {ids[0].data(), ids[1].data(), ids[2].data()};
+    ustore_length_t* shards_offsets[] = {offsets[0].data(), offsets[1].data(), offsets[2].data()};
+    ustore_char_t* shards_names[] = {tapes[0].data(), tapes[1].data(), tapes[2].data()};
+    auto mapping = match_collections(3, counts, shards_ids, shards_offsets, shards_names);
+
+    EXPECT_EQ(mapping.size(), 2u);
+    EXPECT_EQ(mapping[10], (std::vector<ustore_collection_t> {10, 20, 30}));
+    EXPECT_EQ(mapping[11], (std::vector<ustore_collection_t> {11, 21, 31}));
+    EXPECT_EQ(mapping.count(12), 0u);
 }
 
 int main(int argc, char** argv) {